@@ -0,0 +1,59 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <benchmark/benchmark.h>
+
+#include "Shapes.h"
+#include "../src/infill.h"
+#include "../src/settings/Settings.h"
+
+namespace cura
+{
+
+/*
+ * Fills a sieve with 16 holes per side with 20% infill. The argument is the
+ * pattern, as the number of the EFillMethod.
+ *
+ * The patterns that need a fractal or a lightning tree computed over the whole
+ * mesh (cross, cross 3D, cubic subdivision and lightning) are left out, since
+ * those depend on more than one layer. Concentric is left out since it is the
+ * same as generating walls.
+ */
+static void BM_InfillGenerate(benchmark::State& state)
+{
+    const EFillMethod pattern = static_cast<EFillMethod>(state.range(0));
+    const Polygons sieve = makeSieve(16);
+    constexpr coord_t line_width = MM2INT(0.4);
+    constexpr coord_t line_distance = MM2INT(2.0); //20% infill.
+    constexpr coord_t infill_overlap = 0;
+    constexpr size_t infill_multiplier = 1;
+    const AngleDegrees fill_angle = 45;
+    constexpr coord_t z = MM2INT(1.0);
+    constexpr coord_t shift = 0;
+    constexpr coord_t max_resolution = MM2INT(0.5);
+    constexpr coord_t max_deviation = MM2INT(0.025);
+    const Settings settings;
+
+    for (auto _ : state)
+    {
+        Infill infill(pattern, false, false, sieve, line_width, line_distance, infill_overlap, infill_multiplier, fill_angle, z, shift, max_resolution, max_deviation);
+        std::vector<VariableWidthLines> toolpaths;
+        Polygons result_polygons;
+        Polygons result_lines;
+        infill.generate(toolpaths, result_polygons, result_lines, settings);
+        benchmark::DoNotOptimize(result_lines);
+    }
+}
+BENCHMARK(BM_InfillGenerate)
+    ->Arg(static_cast<int>(EFillMethod::LINES))
+    ->Arg(static_cast<int>(EFillMethod::GRID))
+    ->Arg(static_cast<int>(EFillMethod::CUBIC))
+    ->Arg(static_cast<int>(EFillMethod::TETRAHEDRAL))
+    ->Arg(static_cast<int>(EFillMethod::QUARTER_CUBIC))
+    ->Arg(static_cast<int>(EFillMethod::TRIANGLES))
+    ->Arg(static_cast<int>(EFillMethod::TRIHEXAGON))
+    ->Arg(static_cast<int>(EFillMethod::ZIG_ZAG))
+    ->Arg(static_cast<int>(EFillMethod::GYROID))
+    ->Unit(benchmark::kMillisecond);
+
+} //namespace cura
@@ -0,0 +1,53 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <benchmark/benchmark.h>
+
+#include "Shapes.h"
+#include "../src/PathOrderOptimizer.h"
+
+namespace cura
+{
+
+/*
+ * Orders the holes of a sieve, picking a seam for each. The argument is the
+ * number of holes per side of the sieve.
+ */
+static void BM_PathOrderOptimizerPolygons(benchmark::State& state)
+{
+    const Polygons sieve = makeSieve(state.range(0));
+    for (auto _ : state)
+    {
+        PathOrderOptimizer<ConstPolygonPointer> optimizer(Point(0, 0));
+        for (ConstPolygonRef polygon : sieve)
+        {
+            optimizer.addPolygon(polygon);
+        }
+        optimizer.optimize();
+        benchmark::DoNotOptimize(optimizer.paths);
+    }
+}
+BENCHMARK(BM_PathOrderOptimizerPolygons)->Arg(4)->Arg(16)->Arg(64);
+
+/*
+ * Orders the holes of a sieve cut up into short polylines, which may be
+ * printed in either direction. The argument is the number of holes per side of
+ * the sieve.
+ */
+static void BM_PathOrderOptimizerPolylines(benchmark::State& state)
+{
+    const Polygons polylines = cutIntoPolylines(makeSieve(state.range(0)));
+    for (auto _ : state)
+    {
+        PathOrderOptimizer<ConstPolygonPointer> optimizer(Point(0, 0));
+        for (ConstPolygonRef polyline : polylines)
+        {
+            optimizer.addPolyline(polyline);
+        }
+        optimizer.optimize();
+        benchmark::DoNotOptimize(optimizer.paths);
+    }
+}
+BENCHMARK(BM_PathOrderOptimizerPolylines)->Arg(4)->Arg(16)->Arg(64);
+
+} //namespace cura
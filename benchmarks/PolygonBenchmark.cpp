@@ -0,0 +1,86 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <benchmark/benchmark.h>
+
+#include "Shapes.h"
+#include "../src/utils/PolylineStitcher.h"
+#include "../src/utils/Simplify.h"
+
+namespace cura
+{
+
+/*
+ * The argument of each benchmark is the number of holes per side of the
+ * sieve, so the number of vertices grows quadratically with it.
+ */
+
+static void BM_PolygonsOffset(benchmark::State& state)
+{
+    const Polygons sieve = makeSieve(state.range(0));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(sieve.offset(-200));
+    }
+}
+BENCHMARK(BM_PolygonsOffset)->Arg(4)->Arg(16)->Arg(64);
+
+static void BM_PolygonsOffsetRound(benchmark::State& state)
+{
+    const Polygons sieve = makeSieve(state.range(0));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(sieve.offset(-200, ClipperLib::jtRound));
+    }
+}
+BENCHMARK(BM_PolygonsOffsetRound)->Arg(4)->Arg(16)->Arg(64);
+
+static void BM_PolygonsDifference(benchmark::State& state)
+{
+    const Polygons sieve = makeSieve(state.range(0));
+    Polygons shifted = sieve;
+    shifted.translate(Point(1000, 1000));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(sieve.difference(shifted));
+    }
+}
+BENCHMARK(BM_PolygonsDifference)->Arg(4)->Arg(16)->Arg(64);
+
+static void BM_PolygonsUnion(benchmark::State& state)
+{
+    const Polygons sieve = makeSieve(state.range(0));
+    Polygons shifted = sieve;
+    shifted.translate(Point(1000, 1000));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(sieve.unionPolygons(shifted));
+    }
+}
+BENCHMARK(BM_PolygonsUnion)->Arg(4)->Arg(16)->Arg(64);
+
+static void BM_Simplify(benchmark::State& state)
+{
+    const Polygons sieve = makeSieve(state.range(0), 512); //Very fine holes, so that there is a lot to simplify.
+    const Simplify simplifier(MM2INT(0.5), MM2INT(0.025), 50000);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(simplifier.polygon(sieve));
+    }
+}
+BENCHMARK(BM_Simplify)->Arg(4)->Arg(16)->Arg(64);
+
+static void BM_PolylineStitcher(benchmark::State& state)
+{
+    const Polygons polylines = cutIntoPolylines(makeSieve(state.range(0)));
+    for (auto _ : state)
+    {
+        Polygons result_lines;
+        Polygons result_polygons;
+        PolylineStitcher<Polygons, Polygon, Point>::stitch(polylines, result_lines, result_polygons, MM2INT(0.4));
+        benchmark::DoNotOptimize(result_polygons);
+    }
+}
+BENCHMARK(BM_PolylineStitcher)->Arg(4)->Arg(16)->Arg(64);
+
+} //namespace cura
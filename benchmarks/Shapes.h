@@ -0,0 +1,78 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef BENCHMARKS_SHAPES_H
+#define BENCHMARKS_SHAPES_H
+
+#include <cmath> //For std::cos and std::sin.
+
+#include "../src/utils/polygon.h"
+
+namespace cura
+{
+
+/*!
+ * Create a square plate with a grid of round holes in it, like a sieve.
+ *
+ * This has the long thin walls and many small features of typical layers, and
+ * its complexity grows with the number of holes.
+ * \param holes_per_side How many holes to put in each row and column.
+ * \param vertices_per_hole How many vertices to approximate each hole with.
+ * \return The outline of the plate, followed by all of its holes.
+ */
+inline Polygons makeSieve(const size_t holes_per_side, const size_t vertices_per_hole = 32)
+{
+    constexpr coord_t hole_spacing = 3000;
+    constexpr coord_t hole_radius = 1200;
+    const coord_t width = hole_spacing * static_cast<coord_t>(holes_per_side);
+
+    Polygons result;
+    PolygonRef plate = result.newPoly();
+    plate.emplace_back(0, 0);
+    plate.emplace_back(width, 0);
+    plate.emplace_back(width, width);
+    plate.emplace_back(0, width);
+
+    for (size_t x = 0; x < holes_per_side; x++)
+    {
+        for (size_t y = 0; y < holes_per_side; y++)
+        {
+            const Point center(hole_spacing * static_cast<coord_t>(x) + hole_spacing / 2, hole_spacing * static_cast<coord_t>(y) + hole_spacing / 2);
+            PolygonRef hole = result.newPoly();
+            for (size_t i = 0; i < vertices_per_hole; i++)
+            {
+                const double angle = -2 * M_PI * i / vertices_per_hole; //Clockwise, since it's a hole.
+                hole.emplace_back(center + Point(std::cos(angle) * hole_radius, std::sin(angle) * hole_radius));
+            }
+        }
+    }
+    return result;
+}
+
+/*!
+ * Cut polygons into short polylines, as if they were sliced from a mesh and
+ * still need to be stitched together.
+ * \param polygons The polygons to cut up.
+ * \param vertices_per_piece How many line segments each polyline gets.
+ * \return The polylines. Together they visit all vertices of the polygons.
+ */
+inline Polygons cutIntoPolylines(const Polygons& polygons, const size_t vertices_per_piece = 4)
+{
+    Polygons result;
+    for (ConstPolygonRef polygon : polygons)
+    {
+        for (size_t start = 0; start < polygon.size(); start += vertices_per_piece)
+        {
+            PolygonRef piece = result.newPoly();
+            for (size_t i = start; i <= start + vertices_per_piece && i <= polygon.size(); i++)
+            {
+                piece.add(polygon[i % polygon.size()]);
+            }
+        }
+    }
+    return result;
+}
+
+} //namespace cura
+
+#endif //BENCHMARKS_SHAPES_H
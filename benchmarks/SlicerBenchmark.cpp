@@ -0,0 +1,117 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <benchmark/benchmark.h>
+
+#include "../src/Application.h" //To set up a slice with settings.
+#include "../src/Slice.h" //To set up a scene to slice.
+#include "../src/slicer.h" //The unit being benchmarked.
+#include "../src/utils/FMatrix4x3.h" //To load STL files.
+#include "../tests/StressShapes.h" //To generate meshes of any size.
+
+namespace cura
+{
+
+class AdaptiveLayer;
+
+/*
+ * Slices tests/testModel.stl. The argument is the layer height in microns.
+ */
+static void BM_SlicerConstruction(benchmark::State& state)
+{
+    Application::getInstance().current_slice = new Slice(1);
+    Scene& scene = Application::getInstance().current_slice->scene;
+    scene.settings.add("slicing_tolerance", "middle");
+    scene.settings.add("layer_height_0", "0.2");
+    scene.settings.add("magic_mesh_surface_mode", "normal");
+    scene.settings.add("meshfix_extensive_stitching", "false");
+    scene.settings.add("meshfix_keep_open_polygons", "false");
+    scene.settings.add("minimum_polygon_circumference", "1");
+    scene.settings.add("meshfix_maximum_resolution", "0.04");
+    scene.settings.add("meshfix_maximum_deviation", "0.02");
+    scene.settings.add("xy_offset", "0");
+    scene.settings.add("xy_offset_layer_0", "0");
+    scene.settings.add("support_mesh", "false");
+    scene.settings.add("anti_overhang_mesh", "false");
+    scene.settings.add("cutting_mesh", "false");
+    scene.settings.add("infill_mesh", "false");
+
+    MeshGroup& mesh_group = scene.mesh_groups.back();
+    const FMatrix4x3 transformation;
+    if (!loadMeshIntoMeshGroup(&mesh_group, CURA_TESTS_DIR "/testModel.stl", transformation, scene.settings))
+    {
+        state.SkipWithError("Couldn't load testModel.stl.");
+        return;
+    }
+    Mesh& mesh = mesh_group.meshes[0];
+
+    const coord_t layer_thickness = state.range(0);
+    const coord_t initial_layer_thickness = scene.settings.get<coord_t>("layer_height_0");
+    const size_t layer_count = (mesh.getAABB().max.z - initial_layer_thickness) / layer_thickness + 1;
+    constexpr bool variable_layer_height = false;
+    constexpr std::vector<AdaptiveLayer>* variable_layer_height_values = nullptr;
+    for (auto _ : state)
+    {
+        Slicer slicer(&mesh, layer_thickness, layer_count, variable_layer_height, variable_layer_height_values);
+        benchmark::DoNotOptimize(slicer.layers);
+    }
+
+    delete Application::getInstance().current_slice;
+    Application::getInstance().current_slice = nullptr;
+}
+BENCHMARK(BM_SlicerConstruction)->Arg(200)->Arg(100)->Arg(50)->Unit(benchmark::kMillisecond);
+
+/*
+ * Slices a generated mesh: a grid of twisted parts with nested rings. The
+ * arguments are the number of parts, the nesting depth and the number of
+ * vertices per loop, to see how slicing scales with each of them.
+ */
+static void BM_SlicerStressMesh(benchmark::State& state)
+{
+    Application::getInstance().current_slice = new Slice(1);
+    Scene& scene = Application::getInstance().current_slice->scene;
+    scene.settings.add("slicing_tolerance", "middle");
+    scene.settings.add("layer_height_0", "0.2");
+    scene.settings.add("magic_mesh_surface_mode", "normal");
+    scene.settings.add("meshfix_extensive_stitching", "false");
+    scene.settings.add("meshfix_keep_open_polygons", "false");
+    scene.settings.add("minimum_polygon_circumference", "1");
+    scene.settings.add("meshfix_maximum_resolution", "0.04");
+    scene.settings.add("meshfix_maximum_deviation", "0.02");
+    scene.settings.add("meshfix_decimate_mesh", "false");
+    scene.settings.add("mesh_sort_by_height", "false");
+    scene.settings.add("xy_offset", "0");
+    scene.settings.add("xy_offset_layer_0", "0");
+    scene.settings.add("support_mesh", "false");
+    scene.settings.add("anti_overhang_mesh", "false");
+    scene.settings.add("cutting_mesh", "false");
+    scene.settings.add("infill_mesh", "false");
+
+    StressShapeParameters parameters;
+    parameters.part_count = state.range(0);
+    parameters.nesting_depth = state.range(1);
+    parameters.vertices_per_loop = state.range(2);
+    constexpr coord_t height = 20000;
+    constexpr size_t sections = 20;
+    constexpr double twist = 1.0;
+    Mesh mesh(scene.settings);
+    makeStressMesh(parameters, height, sections, twist, mesh);
+    mesh.finish();
+
+    constexpr coord_t layer_thickness = 100;
+    const size_t layer_count = (height - scene.settings.get<coord_t>("layer_height_0")) / layer_thickness + 1;
+    constexpr bool variable_layer_height = false;
+    constexpr std::vector<AdaptiveLayer>* variable_layer_height_values = nullptr;
+    for (auto _ : state)
+    {
+        Slicer slicer(&mesh, layer_thickness, layer_count, variable_layer_height, variable_layer_height_values);
+        benchmark::DoNotOptimize(slicer.layers);
+    }
+    state.counters["faces"] = mesh.faces.size();
+
+    delete Application::getInstance().current_slice;
+    Application::getInstance().current_slice = nullptr;
+}
+BENCHMARK(BM_SlicerStressMesh)->Args({ 1, 1, 64 })->Args({ 16, 1, 64 })->Args({ 16, 5, 64 })->Args({ 16, 5, 512 })->Unit(benchmark::kMillisecond);
+
+} //namespace cura
@@ -0,0 +1,53 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <benchmark/benchmark.h>
+
+#include "../src/settings/Settings.h" //To set firmware settings.
+#include "../src/timeEstimate.h" //The unit being benchmarked.
+
+namespace cura
+{
+
+/*
+ * Plans a zigzag of short moves, like a layer of infill, and calculates the
+ * print time. The argument is the number of moves.
+ */
+static void BM_TimeEstimateCalculator(benchmark::State& state)
+{
+    //Firmware settings of the Ultimaker 3.
+    Settings settings;
+    settings.add("machine_max_feedrate_x", "300");
+    settings.add("machine_max_feedrate_y", "300");
+    settings.add("machine_max_feedrate_z", "40");
+    settings.add("machine_max_feedrate_e", "45");
+    settings.add("machine_max_acceleration_x", "9000");
+    settings.add("machine_max_acceleration_y", "9000");
+    settings.add("machine_max_acceleration_z", "100");
+    settings.add("machine_max_acceleration_e", "10000");
+    settings.add("machine_max_jerk_xy", "20");
+    settings.add("machine_max_jerk_z", "0.4");
+    settings.add("machine_max_jerk_e", "5");
+    settings.add("machine_minimum_feedrate", "0");
+    settings.add("machine_acceleration", "3000");
+
+    const size_t move_count = state.range(0);
+    for (auto _ : state)
+    {
+        TimeEstimateCalculator calculator;
+        calculator.setFirmwareDefaults(settings);
+        calculator.setPosition(TimeEstimateCalculator::Position(0, 0, 0, 0));
+        double e = 0;
+        for (size_t move = 0; move < move_count; move++)
+        {
+            e += 0.1;
+            const double x = (move % 2 == 0) ? 0 : 50; //Back and forth over 50mm.
+            const double y = move * 0.4;
+            calculator.plan(TimeEstimateCalculator::Position(x, y, 0.2, e), Velocity(60), PrintFeatureType::Infill);
+        }
+        benchmark::DoNotOptimize(calculator.calculate());
+    }
+}
+BENCHMARK(BM_TimeEstimateCalculator)->Arg(1000)->Arg(100000);
+
+} //namespace cura
@@ -0,0 +1,38 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <benchmark/benchmark.h>
+
+#include "Shapes.h"
+#include "../src/SkeletalTrapezoidation.h"
+#include "../src/BeadingStrategy/BeadingStrategyFactory.h"
+
+namespace cura
+{
+
+/*
+ * Generates three walls in a sieve. The argument is the number of holes per
+ * side of the sieve.
+ */
+static void BM_SkeletalTrapezoidationGenerateToolpaths(benchmark::State& state)
+{
+    const Polygons sieve = makeSieve(state.range(0));
+    constexpr coord_t line_width = MM2INT(0.4);
+    constexpr coord_t wall_count = 3;
+    const BeadingStrategyPtr beading_strategy = BeadingStrategyFactory::makeStrategy(line_width, line_width, MM2INT(1.0), M_PI / 18, false, 0, 0, 0.5_r, 0.5_r, wall_count * 2);
+    constexpr coord_t discretization_step_size = MM2INT(0.8); //Same as WallToolPaths.
+    constexpr coord_t transition_filter_distance = MM2INT(1.0);
+    constexpr coord_t allowed_filter_deviation = MM2INT(0.2);
+    constexpr coord_t beading_propagation_transition_distance = MM2INT(1.0);
+
+    for (auto _ : state)
+    {
+        SkeletalTrapezoidation wall_maker(sieve, *beading_strategy, beading_strategy->getTransitioningAngle(), discretization_step_size, transition_filter_distance, allowed_filter_deviation, beading_propagation_transition_distance);
+        std::vector<VariableWidthLines> toolpaths;
+        wall_maker.generateToolpaths(toolpaths);
+        benchmark::DoNotOptimize(toolpaths);
+    }
+}
+BENCHMARK(BM_SkeletalTrapezoidationGenerateToolpaths)->Arg(4)->Arg(16)->Unit(benchmark::kMillisecond);
+
+} //namespace cura
@@ -0,0 +1,358 @@
+#!/usr/bin/python3
+
+## slice_benchmark.py
+# The slice_benchmark.py script measures how long CuraEngine takes to slice a
+# fixed corpus of models under a matrix of profiles.
+# The corpus is tests/testModel.stl plus synthetic models that are generated on
+# the fly, so they are the same on every machine:
+# * lattice: a grid of thin bars, with many small islands and holes.
+# * text: block letters, with many short walls and sharp corners.
+# * vase: a smooth, finely tessellated solid of revolution.
+# * plate: many separate small parts on the build plate.
+# * tower: a tall twisting tower, so that every layer is different.
+# For each model and profile it reports the wall time of each stage, the peak
+# memory use and a hash of the g-code. Comparing the results with those of an
+# earlier run finds performance regressions and changes in the output.
+
+import argparse
+import hashlib
+import json
+import math
+import os
+import re
+import statistics
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+
+## The profiles to slice each model with, as settings on top of the defaults.
+#  The settings in "extruder_1" go to a second extruder, that the model is
+#  loaded a second time for, next to the first copy.
+PROFILES = {
+    "defaults": {
+        "global": {},
+    },
+    "tree_support": {
+        "global": {"support_enable": "true", "support_structure": "tree"},
+    },
+    "lightning": {
+        "global": {"infill_pattern": "lightning", "infill_sparse_density": "15"},
+    },
+    "gyroid": {
+        "global": {"infill_pattern": "gyroid", "infill_sparse_density": "20"},
+    },
+    "multi_extruder": {
+        "global": {"machine_extruder_count": "2", "prime_tower_enable": "true"},
+        "extruder_1": {},
+    },
+}
+
+## The settings for each model, to apply to the mesh after loading it.
+#  Models that are built from overlapping boxes need their volumes merged.
+MODEL_SETTINGS = {
+    "lattice": {"meshfix_union_all": "true"},
+    "text": {"meshfix_union_all": "true"},
+}
+
+
+## Collects triangles and writes them to a binary STL file.
+class Mesh:
+    def __init__(self):
+        self.triangles = []
+
+    ## Add a quad as two triangles. The corners must be in counter-clockwise
+    #  order when looking at the outside.
+    def quad(self, a, b, c, d):
+        self.triangles.append((a, b, c))
+        self.triangles.append((a, c, d))
+
+    ## Add an axis-aligned box between two corners.
+    def box(self, x0, y0, z0, x1, y1, z1):
+        self.quad((x0, y0, z0), (x0, y1, z0), (x1, y1, z0), (x1, y0, z0)) #Bottom.
+        self.quad((x0, y0, z1), (x1, y0, z1), (x1, y1, z1), (x0, y1, z1)) #Top.
+        self.quad((x0, y0, z0), (x1, y0, z0), (x1, y0, z1), (x0, y0, z1)) #Front.
+        self.quad((x1, y1, z0), (x0, y1, z0), (x0, y1, z1), (x1, y1, z1)) #Back.
+        self.quad((x0, y1, z0), (x0, y0, z0), (x0, y0, z1), (x0, y1, z1)) #Left.
+        self.quad((x1, y0, z0), (x1, y1, z0), (x1, y1, z1), (x1, y0, z1)) #Right.
+
+    ## Add a closed solid of revolution around a vertical axis.
+    #  \param rings A list of (z, radius, twist) from bottom to top, where twist
+    #  is the angle in radians by which the ring is rotated.
+    def revolve(self, cx, cy, rings, segments):
+        def vertex(ring, segment):
+            z, radius, twist = ring
+            angle = 2 * math.pi * (segment % segments) / segments + twist #Wrap around, so that the seam closes exactly.
+            return (cx + radius * math.cos(angle), cy + radius * math.sin(angle), z)
+        for lower, upper in zip(rings, rings[1:]):
+            for segment in range(segments):
+                self.quad(vertex(lower, segment), vertex(lower, segment + 1), vertex(upper, segment + 1), vertex(upper, segment))
+        bottom_center = (cx, cy, rings[0][0])
+        top_center = (cx, cy, rings[-1][0])
+        for segment in range(segments):
+            self.triangles.append((bottom_center, vertex(rings[0], segment + 1), vertex(rings[0], segment)))
+            self.triangles.append((top_center, vertex(rings[-1], segment), vertex(rings[-1], segment + 1)))
+
+    def write(self, filename):
+        with open(filename, "wb") as file:
+            file.write(b"slice_benchmark".ljust(80, b" "))
+            file.write(struct.pack("<I", len(self.triangles)))
+            for triangle in self.triangles:
+                file.write(struct.pack("<3f", 0.0, 0.0, 0.0)) #CuraEngine computes the normals itself.
+                for vertex in triangle:
+                    file.write(struct.pack("<3f", *vertex))
+                file.write(struct.pack("<H", 0))
+
+
+def makeLattice():
+    mesh = Mesh()
+    cells = 6
+    cell_size = 8.0
+    bar = 1.2
+    size = cells * cell_size + bar
+    for i in range(cells + 1):
+        for j in range(cells + 1):
+            u = i * cell_size
+            v = j * cell_size
+            mesh.box(u, v, 0, u + bar, v + bar, size) #Pillars.
+            mesh.box(0, u, v, size, u + bar, v + bar) #Bars along X.
+            mesh.box(u, 0, v, u + bar, size, v + bar) #Bars along Y.
+    return mesh
+
+
+def makeText():
+    mesh = Mesh()
+    height = 5.0
+    letter_size = 16.0
+    spacing = 20.0
+    #Each letter is a list of strokes (x0, y0, x1, y1), in a 16x16mm box.
+    letters = [
+        [(0, 0, 16, 2), (0, 0, 2, 16), (0, 14, 16, 16)], #C
+        [(0, 0, 16, 2), (0, 0, 2, 16), (14, 0, 16, 16)], #U
+        [(0, 0, 2, 16), (0, 14, 16, 16), (14, 8, 16, 16), (0, 7, 16, 9), (8, 0, 10, 8), (10, 0, 16, 2)], #R
+        [(0, 0, 2, 16), (14, 0, 16, 16), (0, 14, 16, 16), (0, 7, 16, 9)], #A
+    ]
+    for row in range(3): #Several lines of text, to have enough of it.
+        for index, letter in enumerate(letters):
+            offset_x = index * spacing
+            offset_y = row * spacing
+            for x0, y0, x1, y1 in letter:
+                mesh.box(offset_x + x0 * letter_size / 16, offset_y + y0 * letter_size / 16, 0, offset_x + x1 * letter_size / 16, offset_y + y1 * letter_size / 16, height)
+    return mesh
+
+
+def makeVase():
+    mesh = Mesh()
+    rings = [(z * 0.5, 25 + 8 * math.sin(z * 0.5 / 12), 0) for z in range(241)]
+    mesh.revolve(35, 35, rings, 256)
+    return mesh
+
+
+def makePlate():
+    mesh = Mesh()
+    for i in range(10):
+        for j in range(10):
+            rings = [(0, 2, 0), (10, 2, 0)]
+            mesh.revolve(i * 8 + 3, j * 8 + 3, rings, 24)
+    return mesh
+
+
+def makeTower():
+    mesh = Mesh()
+    rings = [(z * 1.0, 10, z * math.pi / 200) for z in range(201)]
+    mesh.revolve(12, 12, rings, 6)
+    return mesh
+
+
+SYNTHETIC_MODELS = {
+    "lattice": makeLattice,
+    "text": makeText,
+    "vase": makeVase,
+    "plate": makePlate,
+    "tower": makeTower,
+}
+
+
+## Get the size of a binary STL model in the X direction, in millimetres.
+def readWidth(filename):
+    with open(filename, "rb") as file:
+        file.seek(80)
+        triangle_count = struct.unpack("<I", file.read(4))[0]
+        xs = []
+        for _ in range(triangle_count):
+            data = struct.unpack("<12fH", file.read(50))
+            xs += [data[3], data[6], data[9]]
+    return max(xs) - min(xs) if xs else 0.0
+
+
+## Generate the synthetic models in a directory and return the paths of all
+#  models of the corpus and their widths, by their names.
+def createCorpus(directory):
+    models = {"testModel": os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tests", "testModel.stl")}
+    for name, make in SYNTHETIC_MODELS.items():
+        filename = os.path.join(directory, name + ".stl")
+        make().write(filename)
+        models[name] = filename
+    widths = {name: readWidth(filename) for name, filename in models.items()}
+    return models, widths
+
+
+## Build the command line to slice a model with a profile.
+def sliceCommand(engine, definition, model, model_name, model_width, profile, output):
+    cmd = [engine, "slice", "-v", "-j", definition, "-o", output]
+    for key, value in profile["global"].items():
+        cmd += ["-s", "%s=%s" % (key, value)]
+    extruder_count = 2 if "extruder_1" in profile else 1
+    for extruder_nr in range(extruder_count):
+        cmd += ["-e%d" % extruder_nr]
+        for key, value in profile.get("extruder_%d" % extruder_nr, {}).items():
+            cmd += ["-s", "%s=%s" % (key, value)]
+        cmd += ["-l", model, "-s", "extruder_nr=%d" % extruder_nr]
+        if extruder_nr > 0: #Put the copy for the other extruder next to the first, in millimetres.
+            cmd += ["-s", "mesh_position_x=%f" % (extruder_nr * (model_width + 10))]
+        for key, value in MODEL_SETTINGS.get(model_name, {}).items():
+            cmd += ["-s", "%s=%s" % (key, value)]
+    return cmd
+
+
+## Slice once and measure it.
+#  \return A dictionary with the wall time, the time of each stage, the peak
+#  memory use and the hash of the g-code, or None if the engine failed.
+def runSlice(cmd, output, timeout):
+    with tempfile.TemporaryFile() as log_file:
+        start = time.time()
+        process = subprocess.Popen(cmd, stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL, stderr=log_file)
+        try:
+            if hasattr(os, "wait4"): #Unix: also get the peak memory use of this process alone.
+                deadline = start + timeout
+                while True:
+                    pid, status, usage = os.wait4(process.pid, os.WNOHANG)
+                    if pid != 0:
+                        break
+                    if time.time() > deadline:
+                        process.kill()
+                        process.wait()
+                        print("Timeout: %s" % " ".join(cmd))
+                        return None
+                    time.sleep(0.01)
+                process.returncode = os.waitstatus_to_exitcode(status)
+                peak_memory = usage.ru_maxrss * (1 if sys.platform == "darwin" else 1024) #Bytes on macOS, kilobytes elsewhere.
+            else:
+                process.wait(timeout)
+                peak_memory = 0
+        except subprocess.TimeoutExpired:
+            process.kill()
+            print("Timeout: %s" % " ".join(cmd))
+            return None
+        wall_time = time.time() - start
+
+        log_file.seek(0)
+        log = log_file.read().decode("utf-8", "replace")
+    if process.returncode != 0:
+        print("Execution failed: %s" % " ".join(cmd))
+        print("\n".join(log.split("\n")[-5:]))
+        return None
+
+    stage_times = {}
+    for match in re.finditer(r"Progress: (\S+) accomplished in\s*([0-9.]+)s, peak memory use\s*([0-9.]+)MB", log):
+        stage_times[match.group(1)] = stage_times.get(match.group(1), 0.0) + float(match.group(2)) #Summed over the mesh groups.
+        if peak_memory == 0:
+            peak_memory = max(peak_memory, int(float(match.group(3)) * 1024 * 1024))
+
+    gcode_hash = hashlib.sha256()
+    with open(output, "rb") as gcode:
+        for chunk in iter(lambda: gcode.read(1 << 20), b""):
+            gcode_hash.update(chunk)
+    return {"wall_time": wall_time, "stage_times": stage_times, "peak_memory": peak_memory, "gcode_hash": gcode_hash.hexdigest()}
+
+
+## Slice every model with every profile, \p repeat times each.
+#  The wall and stage times are the medians of the repeats, to be less
+#  sensitive to noise.
+def runBenchmark(engine, definition, models, widths, profiles, repeat, timeout, directory):
+    results = []
+    for model_name, model in models.items():
+        for profile_name in profiles:
+            output = os.path.join(directory, "%s_%s.gcode" % (model_name, profile_name))
+            cmd = sliceCommand(engine, definition, model, model_name, widths[model_name], PROFILES[profile_name], output)
+            runs = []
+            for _ in range(repeat):
+                run = runSlice(cmd, output, timeout)
+                if run is None:
+                    break
+                runs.append(run)
+            result = {"model": model_name, "profile": profile_name}
+            if len(runs) < repeat:
+                result["error"] = "failed"
+            else:
+                result["wall_time"] = statistics.median(run["wall_time"] for run in runs)
+                result["stage_times"] = {stage: statistics.median(run["stage_times"].get(stage, 0.0) for run in runs) for stage in runs[0]["stage_times"]}
+                result["peak_memory"] = max(run["peak_memory"] for run in runs)
+                result["gcode_hash"] = runs[0]["gcode_hash"]
+                result["deterministic"] = all(run["gcode_hash"] == runs[0]["gcode_hash"] for run in runs)
+                print("%-10s %-15s %8.2fs %8.1fMB  %s" % (model_name, profile_name, result["wall_time"], result["peak_memory"] / (1024 * 1024), result["gcode_hash"][:12]))
+            results.append(result)
+    return results
+
+
+## Compare the results with those of an earlier run.
+#  \return The number of cases that became slower or used more memory than
+#  allowed by \p tolerance, or failed.
+def compare(results, baseline, tolerance):
+    baseline_by_case = {(result["model"], result["profile"]): result for result in baseline}
+    regressions = 0
+    for result in results:
+        name = "%s/%s" % (result["model"], result["profile"])
+        if "error" in result:
+            print("FAILED     %s" % name)
+            regressions += 1
+            continue
+        old = baseline_by_case.get((result["model"], result["profile"]))
+        if old is None or "error" in old:
+            continue
+        time_ratio = result["wall_time"] / old["wall_time"] if old["wall_time"] > 0 else 1.0
+        memory_ratio = result["peak_memory"] / old["peak_memory"] if old["peak_memory"] > 0 else 1.0
+        status = "ok"
+        if time_ratio > 1 + tolerance or memory_ratio > 1 + tolerance:
+            status = "REGRESSION"
+            regressions += 1
+        elif time_ratio < 1 - tolerance:
+            status = "faster"
+        changed = " g-code changed" if result["gcode_hash"] != old["gcode_hash"] else ""
+        print("%-10s %-26s time %+6.1f%%  memory %+6.1f%%%s" % (status, name, (time_ratio - 1) * 100, (memory_ratio - 1) * 100, changed))
+        for stage, stage_time in result["stage_times"].items():
+            old_stage_time = old["stage_times"].get(stage, 0.0)
+            if old_stage_time > 0.1 and stage_time / old_stage_time > 1 + tolerance: #Point out which stages got slower, ignoring the tiny ones.
+                print("           %-26s %s %+6.1f%%" % ("", stage, (stage_time / old_stage_time - 1) * 100))
+    return regressions
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="CuraEngine end-to-end slicing benchmark")
+    parser.add_argument("json", type=str, help="Machine JSON file to use, such as fdmprinter.def.json")
+    parser.add_argument("engine", type=str, help="Engine executable")
+    parser.add_argument("--output", type=str, default="slice_benchmark.json", help="File to store the results in")
+    parser.add_argument("--baseline", type=str, help="Results of an earlier run to compare with")
+    parser.add_argument("--tolerance", type=float, default=0.1, help="How much slower or larger a case may get before it counts as a regression, as a fraction")
+    parser.add_argument("--repeat", type=int, default=3, help="How often to slice each case")
+    parser.add_argument("--timeout", type=float, default=600, help="Maximum time for a single slice, in seconds")
+    parser.add_argument("--models", type=str, nargs="+", help="Only slice these models of the corpus")
+    parser.add_argument("--profiles", type=str, nargs="+", choices=list(PROFILES.keys()), default=list(PROFILES.keys()), help="Only slice with these profiles")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as directory:
+        models, widths = createCorpus(directory)
+        if args.models:
+            models = {name: path for name, path in models.items() if name in args.models}
+        results = runBenchmark(args.engine, args.json, models, widths, args.profiles, args.repeat, args.timeout, directory)
+
+    with open(args.output, "w") as output_file:
+        json.dump(results, output_file, indent = 4)
+
+    failures = sum(1 for result in results if "error" in result)
+    if args.baseline:
+        with open(args.baseline, "r") as baseline_file:
+            failures = compare(results, json.load(baseline_file), args.tolerance)
+    sys.exit(1 if failures > 0 else 0)
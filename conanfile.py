@@ -23,12 +23,14 @@ class CuraEngineConan(ConanFile):
     options = {
         "enable_arcus": [True, False],
         "enable_openmp": [True, False],
-        "enable_testing": [True, False]
+        "enable_testing": [True, False],
+        "enable_benchmarks": [True, False]
     }
     default_options = {
         "enable_arcus": True,
         "enable_openmp": True,
-        "enable_testing": False
+        "enable_testing": False,
+        "enable_benchmarks": False
     }
     scm = {
         "type": "git",
@@ -59,6 +61,8 @@ class CuraEngineConan(ConanFile):
             self.tool_requires("protobuf/3.17.1")
         if self.options.enable_testing:
             self.test_requires("gtest/[>=1.10.0]")
+        if self.options.enable_benchmarks:
+            self.test_requires("benchmark/[>=1.6.1]")
 
     def requirements(self):
         self.requires("protobuf/3.17.1")
@@ -66,6 +70,7 @@ class CuraEngineConan(ConanFile):
         self.requires("boost/1.78.0")
         self.requires("rapidjson/1.1.0")
         self.requires("stb/20200203")
+        self.requires("zlib/1.2.12")
         if self.options.enable_arcus:
             self.requires("protobuf/3.17.1")
             self.requires("arcus/5.0.1-PullRequest0137.86@ultimaker/testing")
@@ -94,6 +99,7 @@ class CuraEngineConan(ConanFile):
 
         tc.variables["ENABLE_ARCUS"] = self.options.enable_arcus
         tc.variables["BUILD_TESTING"] = self.options.enable_testing
+        tc.variables["BUILD_BENCHMARKS"] = self.options.enable_benchmarks
         tc.variables["ENABLE_OPENMP"] = self.options.enable_openmp
         tc.variables["ALLOW_IN_SOURCE_BUILD"] = True
 
@@ -4,6 +4,8 @@
 #ifdef _OPENMP
     #include <omp.h> // omp_get_num_threads
 #endif // _OPENMP
+#include <cstdlib> //For getenv.
+#include <iostream> //To read jobs from stdin when serving.
 #include <string>
 #include "Application.h"
 #include "FffProcessor.h"
@@ -11,6 +13,7 @@
 #include "communication/CommandLine.h" //To use the command line to slice stuff.
 #include "progress/Progress.h"
 #include "utils/logoutput.h"
+#include "utils/SlowestParts.h" //To report the slowest layers and parts if requested in the environment.
 #include "utils/string.h" //For stringcasecompare.
 
 namespace cura
@@ -51,6 +54,7 @@ void Application::connect()
 #ifdef _OPENMP
     int n_threads;
 #endif // _OPENMP
+    bool send_slice_statistics = false;
 
     for(size_t argn = 3; argn < argc; argn++)
     {
@@ -64,6 +68,9 @@ void Application::connect()
                 case 'v':
                     increaseVerboseLevel();
                     break;
+                case 's':
+                    send_slice_statistics = true;
+                    break;
 #ifdef _OPENMP
                 case 'm':
                     str++;
@@ -85,6 +92,10 @@ void Application::connect()
 
     ArcusCommunication* arcus_communication = new ArcusCommunication();
     arcus_communication->connect(ip, port);
+    if (send_slice_statistics)
+    {
+        arcus_communication->enableSliceStatistics();
+    }
     communication = arcus_communication;
 }
 #endif //ARCUS
@@ -110,12 +121,16 @@ void Application::printHelp() const
     logAlways("CuraEngine connect <host>[:<port>] [-j <settings.def.json>]\n");
     logAlways("  --connect <host>[:<port>]\n\tConnect to <host> via a command socket, \n\tinstead of passing information via the command line\n");
     logAlways("  -v\n\tIncrease the verbose level (show log messages).\n");
+    logAlways("  -s\n\tAlso send statistics of the stages of the slice along with the progress.\n");
 #ifdef _OPENMP
     logAlways("  -m<thread_count>\n\tSet the desired number of threads. Supports only a single digit.\n");
 #endif // _OPENMP
     logAlways("\n");
 #endif //ARCUS
-    logAlways("CuraEngine slice [-v] [-p] [-j <settings.json>] [-s <settingkey>=<value>] [-g] [-e<extruder_nr>] [-o <output.gcode>] [-l <model.stl>] [--next]\n");
+    logAlways("CuraEngine serve\n");
+    logAlways("\tRead slice jobs from stdin, one per line, with the same arguments as the\n\tslice command. \"done\" is written to stdout after each job.\n\tDefinition files that were loaded before are reused by the next jobs.\n");
+    logAlways("\n");
+    logAlways("CuraEngine slice [-v] [-p] [-j <settings.json>] [-s <settingkey>=<value>] [-g] [-e<extruder_nr>] [-o <output.gcode>] [-l <model.stl>] [--next] [--trace <trace.json>] [--layer-statistics <statistics.csv>]\n");
     logAlways("  -v\n\tIncrease the verbose level (show log messages).\n");
 #ifdef _OPENMP
     logAlways("  -m<thread_count>\n\tSet the desired number of threads.\n");
@@ -123,17 +138,29 @@ void Application::printHelp() const
     logAlways("  -p\n\tLog progress information.\n");
     logAlways("  -j\n\tLoad settings.def.json file to register all settings and their defaults.\n");
     logAlways("  -s <setting>=<value>\n\tSet a setting to a value for the last supplied object, \n\textruder train, or general settings.\n");
-    logAlways("  -l <model_file>\n\tLoad an STL model. \n");
+    logAlways("  -l <model_file>\n\tLoad an STL, OBJ or 3MF model. \n");
     logAlways("  -g\n\tSwitch setting focus to the current mesh group only.\n\tUsed for one-at-a-time printing.\n");
     logAlways("  -e<extruder_nr>\n\tSwitch setting focus to the extruder train with the given number.\n");
     logAlways("  --next\n\tGenerate gcode for the previously supplied mesh group and append that to \n\tthe gcode of further models for one-at-a-time printing.\n");
-    logAlways("  -o <output_file>\n\tSpecify a file to which to write the generated gcode.\n");
+    logAlways("  --trace <trace_file>\n\tRecord how long each stage takes on each thread and layer, and write that to\n\ta JSON file that can be viewed in chrome://tracing or ui.perfetto.dev.\n");
+    logAlways("  --layer-statistics <statistics_file>\n\tCount polygons, paths, travel distance, combing fallbacks, memory and time\n\tper layer, and write that to a CSV file with a row per layer.\n");
+    logAlways("  -o <output_file>\n\tSpecify a file to which to write the generated gcode. If it ends in .gz, the gcode is compressed with gzip. If it ends in .gpack or .gpack.gz, the moves are stored in a packed binary format.\n");
     logAlways("\n");
     logAlways("The settings are appended to the last supplied object:\n");
     logAlways("CuraEngine slice [general settings] \n\t-g [current group settings] \n\t-e0 [extruder train 0 settings] \n\t-l obj_inheriting_from_last_extruder_train.stl [object settings] \n\t--next [next group settings]\n\t... etc.\n");
     logAlways("\n");
     logAlways("In order to load machine definitions from custom locations, you need to create the environment variable CURA_ENGINE_SEARCH_PATH, which should contain all search paths delimited by a (semi-)colon.\n");
     logAlways("\n");
+#ifdef _OPENMP
+    logAlways("To pin the threads to processors, set the standard OpenMP environment variables OMP_PROC_BIND (e.g. \"close\" or \"spread\") and OMP_PLACES (e.g. \"cores\" or \"{0}:8\"). When running several engines on one host, give each its own set of places, for instance the cores of one NUMA node, and a matching thread count with -m.\n");
+    logAlways("\n");
+#endif // _OPENMP
+    logAlways("To keep the parsed machine definitions between runs, set the environment variable CURA_ENGINE_CACHE_PATH to an existing directory to store them in. With the setting cache_mesh_slices, the sliced layers of the meshes are kept there too.\n");
+    logAlways("\n");
+    logAlways("To find out which layers and parts make a slice slow, set the environment variable CURA_ENGINE_SLOWEST_PARTS to the number of slowest walls, skins, support areas and layer plans to log at the end of each mesh group. To draw the outlines of those parts as SVG images, set CURA_ENGINE_SLOWEST_PARTS_SVG to an existing directory to write them to.\n");
+    logAlways("\n");
+    logAlways("SVG images of the slowest parts are only drawn for the layers in the environment variable CURA_ENGINE_SVG_LAYERS, if it is set, as a single layer number or a range such as 10-20.\n");
+    logAlways("\n");
 }
 
 void Application::printLicense() const
@@ -167,6 +194,61 @@ void Application::slice()
     communication = new CommandLine(arguments);
 }
 
+void Application::serve()
+{
+    CommandLine* command_line = new CommandLine(std::vector<std::string>());
+    communication = command_line;
+
+    std::string job;
+    while (std::getline(std::cin, job))
+    {
+        //Split the arguments, as a shell would for the slice command.
+        std::vector<std::string> arguments = { argv[0], "slice" };
+        std::string argument;
+        bool is_argument = false;
+        bool in_quotes = false;
+        for (const char character : job)
+        {
+            if (character == '"')
+            {
+                in_quotes = !in_quotes;
+                is_argument = true;
+            }
+            else if (!in_quotes && (character == ' ' || character == '\t' || character == '\r'))
+            {
+                if (is_argument)
+                {
+                    arguments.push_back(argument);
+                    argument.clear();
+                    is_argument = false;
+                }
+            }
+            else
+            {
+                argument.push_back(character);
+                is_argument = true;
+            }
+        }
+        if (is_argument)
+        {
+            arguments.push_back(argument);
+        }
+        if (arguments.size() <= 2) //Empty line.
+        {
+            continue;
+        }
+
+        command_line->setArguments(arguments);
+        while (communication->hasSlice())
+        {
+            communication->sliceNext();
+        }
+        current_slice = nullptr; //The slice only lived during sliceNext.
+        FffProcessor::getInstance()->reset(); //Closes the output file, so the job is complete now.
+        std::cout << "done" << std::endl;
+    }
+}
+
 void Application::run(const size_t argc, char** argv)
 {
     this->argc = argc;
@@ -175,6 +257,14 @@ void Application::run(const size_t argc, char** argv)
     printLicense();
     Progress::init();
 
+    //In the environment, so that it also works for slices started by the front-end.
+    const char* slowest_parts = getenv("CURA_ENGINE_SLOWEST_PARTS");
+    if (slowest_parts && std::atoi(slowest_parts) > 0)
+    {
+        const char* svg_directory = getenv("CURA_ENGINE_SLOWEST_PARTS_SVG");
+        SlowestParts::start(std::atoi(slowest_parts), svg_directory ? svg_directory : "");
+    }
+
     if (argc < 2)
     {
         printHelp();
@@ -187,6 +277,11 @@ void Application::run(const size_t argc, char** argv)
         {
 #ifdef _OPENMP
             log("OpenMP multithreading enabled, likely number of threads to be used: %u\n", omp_get_num_threads());
+#if _OPENMP >= 201511 //omp_get_num_places was added in OpenMP 4.5.
+            static const char* proc_bind_names[] = { "false", "true", "master", "close", "spread" };
+            const int proc_bind = omp_get_proc_bind();
+            log("Threads are bound to processors: %s, over %i places\n", (proc_bind >= 0 && proc_bind <= 4) ? proc_bind_names[proc_bind] : "unknown", omp_get_num_places());
+#endif
 #else
             log("OpenMP multithreading disabled\n");
 #endif
@@ -204,6 +299,11 @@ void Application::run(const size_t argc, char** argv)
     {
         slice();
     }
+    else if (stringcasecompare(argv[1], "serve") == 0)
+    {
+        serve();
+        return;
+    }
     else if (stringcasecompare(argv[1], "help") == 0)
     {
         printHelp();
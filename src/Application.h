@@ -90,6 +90,19 @@ protected:
      */
     void slice();
 
+    /*!
+     * \brief Keep slicing jobs that are read from stdin, until stdin is
+     * closed.
+     *
+     * Each line is one job, with the same arguments as the ``slice`` command.
+     * Arguments are separated by spaces, and can be put in double quotes to
+     * contain spaces. Once a job is done, "done" is written on a line of its
+     * own to stdout. The definition files and the threads are kept between the
+     * jobs, so that only the first job pays for setting them up. A job with
+     * invalid arguments ends the application, as with the ``slice`` command.
+     */
+    void serve();
+
 private:
     /*
      * \brief The number of arguments that the application was called with.
@@ -3,6 +3,7 @@
 
 #include "BeadingStrategyFactory.h"
 
+#include "CachedBeadingStrategy.h"
 #include "LimitedBeadingStrategy.h"
 #include "WideningBeadingStrategy.h"
 #include "DistributedBeadingStrategy.h"
@@ -51,6 +52,9 @@ BeadingStrategyPtr BeadingStrategyFactory::makeStrategy
     //Apply the LimitedBeadingStrategy last, since that adds a 0-width marker wall which other beading strategies shouldn't touch.
     logDebug("Applying the Limited Beading meta-strategy with maximum bead count = %d.\n", max_bead_count);
     ret = make_unique<LimitedBeadingStrategy>(max_bead_count, move(ret));
+
+    //Cache the results of the whole stack, since the skeletal trapezoidation computes the same beadings over and over.
+    ret = make_unique<CachedBeadingStrategy>(move(ret));
     return ret;
 }
 } // namespace cura
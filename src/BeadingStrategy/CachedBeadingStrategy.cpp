@@ -0,0 +1,80 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "CachedBeadingStrategy.h"
+
+namespace cura
+{
+
+CachedBeadingStrategy::CachedBeadingStrategy(BeadingStrategyPtr parent)
+    : BeadingStrategy(*parent)
+    , parent(std::move(parent))
+{
+}
+
+std::string CachedBeadingStrategy::toString() const
+{
+    return std::string("Cached+") + parent->toString();
+}
+
+size_t CachedBeadingStrategy::KeyHash::operator()(const std::pair<coord_t, coord_t>& key) const
+{
+    const size_t thickness_hash = std::hash<coord_t>()(key.first);
+    return thickness_hash ^ (std::hash<coord_t>()(key.second) + 0x9e3779b97f4a7c15ull + (thickness_hash << 6) + (thickness_hash >> 2));
+}
+
+CachedBeadingStrategy::Beading CachedBeadingStrategy::compute(coord_t thickness, coord_t bead_count) const
+{
+    const std::pair<coord_t, coord_t> key(thickness, bead_count);
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        const auto cached = cache.find(key);
+        if (cached != cache.end())
+        {
+            return cached->second;
+        }
+    }
+
+    //Compute outside of the lock, so that other threads can look up their beadings in the meanwhile.
+    Beading beading = parent->compute(thickness, bead_count);
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (cache.size() >= max_cache_size)
+    {
+        cache.clear();
+    }
+    cache.emplace(key, beading);
+    return beading;
+}
+
+coord_t CachedBeadingStrategy::getOptimalThickness(coord_t bead_count) const
+{
+    return parent->getOptimalThickness(bead_count);
+}
+
+coord_t CachedBeadingStrategy::getTransitionThickness(coord_t lower_bead_count) const
+{
+    return parent->getTransitionThickness(lower_bead_count);
+}
+
+coord_t CachedBeadingStrategy::getOptimalBeadCount(coord_t thickness) const
+{
+    return parent->getOptimalBeadCount(thickness);
+}
+
+coord_t CachedBeadingStrategy::getTransitioningLength(coord_t lower_bead_count) const
+{
+    return parent->getTransitioningLength(lower_bead_count);
+}
+
+float CachedBeadingStrategy::getTransitionAnchorPos(coord_t lower_bead_count) const
+{
+    return parent->getTransitionAnchorPos(lower_bead_count);
+}
+
+std::vector<coord_t> CachedBeadingStrategy::getNonlinearThicknesses(coord_t lower_bead_count) const
+{
+    return parent->getNonlinearThicknesses(lower_bead_count);
+}
+
+} // namespace cura
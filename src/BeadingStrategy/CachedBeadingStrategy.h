@@ -0,0 +1,71 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef CACHED_BEADING_STRATEGY_H
+#define CACHED_BEADING_STRATEGY_H
+
+#include <mutex>
+#include <unordered_map>
+
+#include "BeadingStrategy.h"
+
+namespace cura
+{
+
+/*!
+ * This is a meta-strategy that can be applied on top of any other beading
+ * strategy. It remembers the beadings computed by the strategy below it, so
+ * that computing the beading for the same thickness and bead count again is
+ * just a lookup.
+ *
+ * The skeletal trapezoidation computes the beading for every node and every
+ * junction it propagates through. Many of those share the same thickness, for
+ * instance along parallel edges of the outline. Since the thickness is already
+ * an integer coordinate, the remembered beadings are exactly the ones that the
+ * strategy below would compute.
+ *
+ * This strategy is safe to use from multiple threads at once.
+ */
+class CachedBeadingStrategy : public BeadingStrategy
+{
+public:
+    /*!
+     * Takes responsibility for deleting \param parent
+     */
+    CachedBeadingStrategy(BeadingStrategyPtr parent);
+
+    virtual ~CachedBeadingStrategy() override = default;
+
+    Beading compute(coord_t thickness, coord_t bead_count) const override;
+    coord_t getOptimalThickness(coord_t bead_count) const override;
+    coord_t getTransitionThickness(coord_t lower_bead_count) const override;
+    coord_t getOptimalBeadCount(coord_t thickness) const override;
+    coord_t getTransitioningLength(coord_t lower_bead_count) const override;
+    float getTransitionAnchorPos(coord_t lower_bead_count) const override;
+    std::vector<coord_t> getNonlinearThicknesses(coord_t lower_bead_count) const override;
+    std::string toString() const override;
+
+protected:
+    /*!
+     * Hashes the combination of thickness and bead count that a beading is
+     * computed for.
+     */
+    struct KeyHash
+    {
+        size_t operator()(const std::pair<coord_t, coord_t>& key) const;
+    };
+
+    /*!
+     * The maximum number of beadings to remember. If more are computed, all of
+     * them are forgotten and the cache starts over, to bound the memory usage
+     * for outlines with very many different thicknesses.
+     */
+    static constexpr size_t max_cache_size = 1 << 16;
+
+    const BeadingStrategyPtr parent;
+    mutable std::mutex cache_mutex; //!< Guards the cache.
+    mutable std::unordered_map<std::pair<coord_t, coord_t>, Beading, KeyHash> cache; //!< The computed beadings, by thickness and bead count.
+};
+
+} // namespace cura
+#endif // CACHED_BEADING_STRATEGY_H
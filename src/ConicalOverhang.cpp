@@ -19,15 +19,66 @@ void ConicalOverhang::apply(Slicer* slicer, const Mesh& mesh)
     const coord_t layer_thickness = mesh.settings.get<coord_t>("layer_height");
     coord_t max_dist_from_lower_layer = tan_angle * layer_thickness; // max dist which can be bridged
 
-    for(unsigned int layer_nr = slicer->layers.size() - 2; static_cast<int>(layer_nr) >= 0; layer_nr--)
+    if (slicer->layers.size() < 2)
+    {
+        return;
+    }
+    const bool is_tiny_distance = std::abs(max_dist_from_lower_layer) < 5;
+    constexpr coord_t safe_dist = 20;
+
+    // Each layer grows by the layer above it, so the layers have to be processed from the top down.
+    // But what only depends on the original shape of each layer can be done for all layers in parallel first.
+    const int last_layer_nr = static_cast<int>(slicer->layers.size()) - 2;
+    std::vector<Polygons> shrunk_layers; // For each layer, the original layer shrunk by the safe distance.
+    std::vector<std::vector<Polygons>> small_holes_per_layer; // For each layer, the holes of the original layer that are small enough to be cut out of the layer above.
+    if (is_tiny_distance)
+    {
+        shrunk_layers.resize(last_layer_nr + 1);
+    }
+    else
+    {
+        small_holes_per_layer.resize(last_layer_nr + 1);
+    }
+#pragma omp parallel for default(none) shared(slicer, shrunk_layers, small_holes_per_layer, is_tiny_distance, safe_dist, last_layer_nr, maxHoleArea) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr <= last_layer_nr; layer_nr++)
+    {
+        const SlicerLayer& layer = slicer->layers[layer_nr];
+        if (is_tiny_distance)
+        {
+            shrunk_layers[layer_nr] = layer.polygons.offset(-safe_dist);
+            continue;
+        }
+        if (maxHoleArea <= 0.0)
+        {
+            continue;
+        }
+        // Get the current layer and split it into parts
+        std::vector<PolygonsPart> layerParts = layer.polygons.splitIntoParts();
+        for(unsigned int part = 0; part < layerParts.size(); part++)
+        {
+            // first poly is the outer contour, 1..n are the holes
+            for(unsigned int hole_nr = 1; hole_nr < layerParts[part].size(); ++hole_nr)
+            {
+                Polygons holePoly;
+                holePoly.add(layerParts[part][hole_nr]);
+                if(INT2MM(INT2MM(fabs(holePoly.area()))) < maxHoleArea)
+                {
+                    small_holes_per_layer[layer_nr].push_back(std::move(holePoly));
+                }
+            }
+        }
+    }
+
+    for(int layer_nr = last_layer_nr; layer_nr >= 0; layer_nr--)
     {
         SlicerLayer& layer = slicer->layers[layer_nr];
         SlicerLayer& layer_above = slicer->layers[layer_nr + 1];
-        if (std::abs(max_dist_from_lower_layer) < 5)
+        layer.part_starts.clear();
+        if (is_tiny_distance)
         { // magically nothing happens when max_dist_from_lower_layer == 0
             // below magic code solves that
-            constexpr coord_t safe_dist = 20;
-            Polygons diff = layer_above.polygons.difference(layer.polygons.offset(-safe_dist));
+            Polygons diff = layer_above.polygons.difference(shrunk_layers[layer_nr]);
             layer.polygons = layer.polygons.unionPolygons(diff);
             layer.polygons = layer.polygons.smooth(safe_dist);
                             layer.polygons = Simplify(safe_dist, safe_dist / 2, 0).polygon(layer.polygons);
@@ -36,35 +87,22 @@ void ConicalOverhang::apply(Slicer* slicer, const Mesh& mesh)
         }
         else
         {
-            // Get the current layer and split it into parts
-            std::vector<PolygonsPart> layerParts = layer.polygons.splitIntoParts();
             // Get a copy of the layer above to prune away before we shrink it
             Polygons above = layer_above.polygons;
 
             // Now go through all the holes in the current layer and check if they intersect anything in the layer above
             // If not, then they're the top of a hole and should be cut from the layer above before the union
-            for(unsigned int part = 0; part < layerParts.size(); part++)
+            for (const Polygons& holePoly : small_holes_per_layer[layer_nr])
             {
-                if(layerParts[part].size() > 1) // first poly is the outer contour, 1..n are the holes
+                Polygons holeWithAbove = holePoly.intersection(above);
+                if(!holeWithAbove.empty())
                 {
-                    for(unsigned int hole_nr = 1; hole_nr < layerParts[part].size(); ++hole_nr)
+                    // The hole had some intersection with the above layer, check if it's a complete overlap
+                    Polygons holeDifference = holePoly.xorPolygons(holeWithAbove);
+                    if(holeDifference.empty())
                     {
-                        Polygons holePoly;
-                        holePoly.add(layerParts[part][hole_nr]);
-                        if(maxHoleArea > 0.0 && INT2MM(INT2MM(fabs(holePoly.area()))) < maxHoleArea)
-                        {
-                            Polygons holeWithAbove = holePoly.intersection(above);
-                            if(!holeWithAbove.empty())
-                            {
-                                // The hole had some intersection with the above layer, check if it's a complete overlap
-                                Polygons holeDifference = holePoly.xorPolygons(holeWithAbove);
-                                if(holeDifference.empty())
-                                {
-                                    // The hole was returned unchanged, so the layer above must completely cover it.  Remove the hole from the layer above.
-                                    above = above.difference(holePoly);
-                                }
-                            }
-                        }
+                        // The hole was returned unchanged, so the layer above must completely cover it.  Remove the hole from the layer above.
+                        above = above.difference(holePoly);
                     }
                 }
             }
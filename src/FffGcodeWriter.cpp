@@ -5,6 +5,7 @@
 #include <limits> // numeric_limits
 #include <algorithm>
 #include <optional>
+#include <random> //For the random start locations of infill.
 
 #include "Application.h"
 #include "bridge.h"
@@ -19,13 +20,16 @@
 #include "progress/Progress.h"
 #include "raft.h"
 #include "Slice.h"
+#include "utils/Cancellation.h"
 #include "utils/linearAlg2D.h"
 #include "utils/math.h"
 #include "utils/orderOptimizer.h"
 #include "utils/Simplify.h" //Removing micro-segments created by offsetting.
+#include "utils/SlowestParts.h"
+#include "utils/Trace.h"
 #include "WallToolPaths.h"
 
-#define OMP_MAX_ACTIVE_LAYERS_PROCESSED 30 // TODO: hardcoded-value for the max number of layers being in the pipeline while writing away and destroying layers in a multi-threaded context
+#define OMP_MAX_ACTIVE_LAYERS_PROCESSED 30 // The most layers being in the pipeline while writing away and destroying layers in a multi-threaded context. Fewer are used if that's enough to keep the threads busy.
 
 namespace cura
 {
@@ -33,6 +37,7 @@ namespace cura
 FffGcodeWriter::FffGcodeWriter()
 : max_object_height(0)
 , layer_plan_buffer(gcode)
+, header_size(0)
 {
     for (unsigned int extruder_nr = 0; extruder_nr < MAX_EXTRUDERS; extruder_nr++)
     { // initialize all as max layer_nr, so that they get updated to the lowest layer on which they are used.
@@ -57,10 +62,32 @@ std::vector<Duration> FffGcodeWriter::getTotalPrintTimePerFeature()
 
 bool FffGcodeWriter::setTargetFile(const char* filename)
 {
-    output_file.open(filename);
+    std::string name(filename);
+    const auto strip_extension = [&name](const std::string& extension)
+    {
+        const bool has_extension = name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0;
+        if (has_extension)
+        {
+            name.resize(name.size() - extension.size());
+        }
+        return has_extension;
+    };
+    const bool compress = strip_extension(".gz");
+    const bool pack_moves = strip_extension(".gpack");
+
+    packed_output_file.reset();
+    output_file.open(filename, compress);
     if (output_file.is_open())
     {
-        gcode.setOutputStream(&output_file);
+        if (pack_moves)
+        {
+            packed_output_file = std::make_unique<PackedMoveStream>(&output_file);
+            gcode.setOutputStream(packed_output_file.get());
+        }
+        else
+        {
+            gcode.setOutputStream(&output_file);
+        }
         return true;
     }
     return false;
@@ -68,6 +95,7 @@ bool FffGcodeWriter::setTargetFile(const char* filename)
 
 void FffGcodeWriter::writeGCode(SliceDataStorage& storage, TimeKeeper& time_keeper)
 {
+    TraceZone zone("g-code");
     const size_t start_extruder_nr = getStartExtruder(storage);
     gcode.preSetup(start_extruder_nr);
 
@@ -94,6 +122,9 @@ void FffGcodeWriter::writeGCode(SliceDataStorage& storage, TimeKeeper& time_keep
     {
         processNextMeshGroupCode(storage);
     }
+    //Send the start code on right away, so that the printer may already heat up while the layers are being planned.
+    gcode.flushOutputStream();
+    Application::getInstance().communication->flushGCode();
 
     size_t total_layers = 0;
     for (SliceMeshStorage& mesh : storage.meshes)
@@ -148,7 +179,12 @@ void FffGcodeWriter::writeGCode(SliceDataStorage& storage, TimeKeeper& time_keep
     const std::function<LayerPlan* (int)>& produce_item =
         [&storage, total_layers, this](int layer_nr)
         {
+            storage.loadSpilledWallToolpaths(layer_nr); //If the walls were moved out of memory, this layer needs them back now.
             LayerPlan& gcode_layer = processLayer(storage, layer_nr, total_layers);
+            gcode_layer.resolveTravels(); //Comb the travels here, while other threads may still be planning, rather than in the ordered output.
+            gcode_layer.computeNaiveTimeEstimates(); //Also the time estimates for the fan speed and minimal layer time.
+            storage.releaseLayerPlanningData(layer_nr); //Nothing needs the walls and fill of this layer any more, so free them while the rest of the layers are written.
+            storage.releaseLayerOutlines(layer_nr); //The travels of this layer are combed, so its outlines aren't needed any more either.
             return &gcode_layer;
         };
     const std::function<void (LayerPlan*)>& consume_item =
@@ -157,19 +193,31 @@ void FffGcodeWriter::writeGCode(SliceDataStorage& storage, TimeKeeper& time_keep
             Progress::messageProgress(Progress::Stage::EXPORT, std::max(0, gcode_layer->getLayerNr()) + 1, total_layers);
             layer_plan_buffer.handle(*gcode_layer, gcode);
         };
+    const std::function<size_t (const LayerPlan*)>& item_memory =
+        [](const LayerPlan* gcode_layer)
+        {
+            return gcode_layer->getMemoryUsage();
+        };
     const unsigned int max_task_count = OMP_MAX_ACTIVE_LAYERS_PROCESSED;
+    const size_t max_memory = scene.current_mesh_group->settings.getOrDefault<size_t>("layer_plan_memory_limit", 0) * 1024 * 1024; //The setting is in MiB.
     GcodeLayerThreader<LayerPlan> threader(
         process_layer_starting_layer_nr
         , static_cast<int>(total_layers)
         , produce_item
         , consume_item
         , max_task_count
+        , item_memory
+        , max_memory
     );
 
     // process all layers, process buffer for preheating and minimal layer time etc, write layers to gcode:
     threader.run();
 
     layer_plan_buffer.flush();
+    if (Cancellation::isRequested())
+    {
+        return; //Fewer layers were planned. The g-code is thrown away.
+    }
 
     Progress::messageProgressStage(Progress::Stage::FINISH, &time_keeper);
 
@@ -606,6 +654,13 @@ void FffGcodeWriter::processStartingCode(const SliceDataStorage& storage, const
     if (Application::getInstance().communication->isSequential()) //If we must output the g-code sequentially, we must already place the g-code header here even if we don't know the exact time/material usages yet.
     {
         std::string prefix = gcode.getFileHeader(extruder_is_used);
+        header_position.reset();
+        if (output_file.is_open() && !output_file.isCompressed() && !packed_output_file) //Written directly to the file, so it can be replaced there once the print time and material usage are known.
+        {
+            header_position = output_file.getPosition();
+            header_size = prefix.size() + header_reserve;
+            prefix = gcode.padFileHeader(prefix, header_size);
+        }
         gcode.writeCode(prefix.c_str());
     }
 
@@ -915,16 +970,36 @@ void FffGcodeWriter::processRaft(const SliceDataStorage& storage)
 
 LayerPlan& FffGcodeWriter::processLayer(const SliceDataStorage& storage, LayerIndex layer_nr, const size_t total_layers) const
 {
+    TraceZone zone("plan layer", layer_nr);
+    PartZone part_zone("plan layer", layer_nr);
+    static const SettingKey<coord_t> layer_height_key("layer_height");
+    static const SettingKey<EPlatformAdhesion> adhesion_type_key("adhesion_type");
+    static const SettingKey<bool> support_mesh_key("support_mesh");
+    static const SettingKey<bool> anti_overhang_mesh_key("anti_overhang_mesh");
+    static const SettingKey<bool> cutting_mesh_key("cutting_mesh");
+    static const SettingKey<bool> infill_mesh_key("infill_mesh");
+    static const SettingKey<bool> travel_avoid_other_parts_key("travel_avoid_other_parts");
+    static const SettingKey<coord_t> travel_avoid_distance_key("travel_avoid_distance");
+    static const SettingKey<size_t> wall_line_count_key("wall_line_count");
+    static const SettingKey<Ratio> initial_layer_line_width_factor_key("initial_layer_line_width_factor");
+    static const SettingKey<coord_t> wall_line_width_0_key("wall_line_width_0");
+    static const SettingKey<ExtruderTrain&> support_roof_extruder_nr_key("support_roof_extruder_nr");
+    static const SettingKey<ExtruderTrain&> support_bottom_extruder_nr_key("support_bottom_extruder_nr");
+    static const SettingKey<ExtruderTrain&> support_extruder_nr_layer_0_key("support_extruder_nr_layer_0");
+    static const SettingKey<ExtruderTrain&> support_infill_extruder_nr_key("support_infill_extruder_nr");
+    static const SettingKey<ESurfaceMode> magic_mesh_surface_mode_key("magic_mesh_surface_mode");
+    static const SettingKey<ExtruderTrain&> wall_0_extruder_nr_key("wall_0_extruder_nr");
+
     logDebug("GcodeWriter processing layer %i of %i\n", layer_nr, total_layers);
 
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
-    coord_t layer_thickness = mesh_group_settings.get<coord_t>("layer_height");
+    coord_t layer_thickness = mesh_group_settings.get(layer_height_key);
     coord_t z;
     bool include_helper_parts = true;
     if (layer_nr < 0)
     {
 #ifdef DEBUG
-        assert(mesh_group_settings.get<EPlatformAdhesion>("adhesion_type") == EPlatformAdhesion::RAFT && "negative layer_number means post-raft, pre-model layer!");
+        assert(mesh_group_settings.get(adhesion_type_key) == EPlatformAdhesion::RAFT && "negative layer_number means post-raft, pre-model layer!");
 #endif // DEBUG
         const int filler_layer_count = Raft::getFillerLayerCount();
         layer_thickness = Raft::getFillerLayerHeight();
@@ -937,10 +1012,10 @@ LayerPlan& FffGcodeWriter::processLayer(const SliceDataStorage& storage, LayerIn
         for (const SliceMeshStorage& mesh : storage.meshes)
         {
             if (layer_nr >= static_cast<int>(mesh.layers.size())
-                || mesh.settings.get<bool>("support_mesh")
-                || mesh.settings.get<bool>("anti_overhang_mesh")
-                || mesh.settings.get<bool>("cutting_mesh")
-                || mesh.settings.get<bool>("infill_mesh"))
+                || mesh.settings.get(support_mesh_key)
+                || mesh.settings.get(anti_overhang_mesh_key)
+                || mesh.settings.get(cutting_mesh_key)
+                || mesh.settings.get(infill_mesh_key))
             {
                 continue;
             }
@@ -951,7 +1026,7 @@ LayerPlan& FffGcodeWriter::processLayer(const SliceDataStorage& storage, LayerIn
 
         if (layer_nr == 0)
         {
-            if (mesh_group_settings.get<EPlatformAdhesion>("adhesion_type") == EPlatformAdhesion::RAFT)
+            if (mesh_group_settings.get(adhesion_type_key) == EPlatformAdhesion::RAFT)
             {
                 include_helper_parts = false;
             }
@@ -970,9 +1045,9 @@ LayerPlan& FffGcodeWriter::processLayer(const SliceDataStorage& storage, LayerIn
         {
             const ExtruderTrain& extruder = scene.extruders[extruder_nr];
 
-            if (extruder.settings.get<bool>("travel_avoid_other_parts"))
+            if (extruder.settings.get(travel_avoid_other_parts_key))
             {
-                avoid_distance = std::max(avoid_distance, extruder.settings.get<coord_t>("travel_avoid_distance"));
+                avoid_distance = std::max(avoid_distance, extruder.settings.get(travel_avoid_distance_key));
             }
         }
     }
@@ -980,11 +1055,11 @@ LayerPlan& FffGcodeWriter::processLayer(const SliceDataStorage& storage, LayerIn
     coord_t max_inner_wall_width = 0;
     for (const SliceMeshStorage& mesh : storage.meshes)
     {
-        coord_t mesh_inner_wall_width = mesh.settings.get<coord_t>((mesh.settings.get<size_t>("wall_line_count") > 1) ? "wall_line_width_x" : "wall_line_width_0");
+        coord_t mesh_inner_wall_width = mesh.settings.get<coord_t>((mesh.settings.get(wall_line_count_key) > 1) ? "wall_line_width_x" : "wall_line_width_0");
         if(layer_nr == 0)
         {
-            const ExtruderTrain& train = mesh.settings.get<ExtruderTrain&>((mesh.settings.get<size_t>("wall_line_count") > 1) ? "wall_0_extruder_nr" : "wall_x_extruder_nr");
-            mesh_inner_wall_width *= train.settings.get<Ratio>("initial_layer_line_width_factor");
+            const ExtruderTrain& train = mesh.settings.get<ExtruderTrain&>((mesh.settings.get(wall_line_count_key) > 1) ? "wall_0_extruder_nr" : "wall_x_extruder_nr");
+            mesh_inner_wall_width *= train.settings.get(initial_layer_line_width_factor_key);
         }
         max_inner_wall_width = std::max(max_inner_wall_width, mesh_inner_wall_width);
     }
@@ -997,7 +1072,7 @@ LayerPlan& FffGcodeWriter::processLayer(const SliceDataStorage& storage, LayerIn
         :
         extruder_order_per_layer[layer_nr];
 
-    const coord_t first_outer_wall_line_width = scene.extruders[extruder_order.front()].settings.get<coord_t>("wall_line_width_0");
+    const coord_t first_outer_wall_line_width = scene.extruders[extruder_order.front()].settings.get(wall_line_width_0_key);
     LayerPlan& gcode_layer = *new LayerPlan(storage, layer_nr, z, layer_thickness, extruder_order.front(), fan_speed_layer_time_settings_per_extruder, comb_offset_from_outlines, first_outer_wall_line_width, avoid_distance);
 
     if (include_helper_parts && layer_nr == 0)
@@ -1015,9 +1090,9 @@ LayerPlan& FffGcodeWriter::processLayer(const SliceDataStorage& storage, LayerIn
         processDraftShield(storage, gcode_layer);
     }
 
-    const size_t support_roof_extruder_nr = mesh_group_settings.get<ExtruderTrain&>("support_roof_extruder_nr").extruder_nr;
-    const size_t support_bottom_extruder_nr = mesh_group_settings.get<ExtruderTrain&>("support_bottom_extruder_nr").extruder_nr;
-    const size_t support_infill_extruder_nr = (layer_nr <= 0) ? mesh_group_settings.get<ExtruderTrain&>("support_extruder_nr_layer_0").extruder_nr : mesh_group_settings.get<ExtruderTrain&>("support_infill_extruder_nr").extruder_nr;
+    const size_t support_roof_extruder_nr = mesh_group_settings.get(support_roof_extruder_nr_key).extruder_nr;
+    const size_t support_bottom_extruder_nr = mesh_group_settings.get(support_bottom_extruder_nr_key).extruder_nr;
+    const size_t support_infill_extruder_nr = (layer_nr <= 0) ? mesh_group_settings.get(support_extruder_nr_layer_0_key).extruder_nr : mesh_group_settings.get(support_infill_extruder_nr_key).extruder_nr;
 
     for (const size_t& extruder_nr : extruder_order)
     {
@@ -1034,8 +1109,8 @@ LayerPlan& FffGcodeWriter::processLayer(const SliceDataStorage& storage, LayerIn
             {
                 const SliceMeshStorage& mesh = storage.meshes[mesh_idx];
                 const PathConfigStorage::MeshPathConfigs& mesh_config = gcode_layer.configs_storage.mesh_configs[mesh_idx];
-                if (mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") == ESurfaceMode::SURFACE
-                    && extruder_nr == mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr // mesh surface mode should always only be printed with the outer wall extruder!
+                if (mesh.settings.get(magic_mesh_surface_mode_key) == ESurfaceMode::SURFACE
+                    && extruder_nr == mesh.settings.get(wall_0_extruder_nr_key).extruder_nr // mesh surface mode should always only be printed with the outer wall extruder!
                 )
                 {
                     addMeshLayerToGCode_meshSurfaceMode(storage, mesh, mesh_config, gcode_layer);
@@ -1379,13 +1454,22 @@ void FffGcodeWriter::addMeshOpenPolyLinesToGCode(const SliceMeshStorage& mesh, c
 
 void FffGcodeWriter::addMeshLayerToGCode(const SliceDataStorage& storage, const SliceMeshStorage& mesh, const size_t extruder_nr, const PathConfigStorage::MeshPathConfigs& mesh_config, LayerPlan& gcode_layer) const
 {
+    static const SettingKey<bool> anti_overhang_mesh_key("anti_overhang_mesh");
+    static const SettingKey<bool> support_mesh_key("support_mesh");
+    static const SettingKey<EZSeamType> z_seam_type_key("z_seam_type");
+    static const SettingKey<EZSeamCornerPrefType> z_seam_corner_key("z_seam_corner");
+    static const SettingKey<coord_t> wall_line_width_0_key("wall_line_width_0");
+    static const SettingKey<size_t> roofing_layer_count_key("roofing_layer_count");
+    static const SettingKey<ESurfaceMode> magic_mesh_surface_mode_key("magic_mesh_surface_mode");
+    static const SettingKey<ExtruderTrain&> wall_0_extruder_nr_key("wall_0_extruder_nr");
+
     if (gcode_layer.getLayerNr() > mesh.layer_nr_max_filled_layer)
     {
         return;
     }
 
-    if (mesh.settings.get<bool>("anti_overhang_mesh")
-        || mesh.settings.get<bool>("support_mesh")
+    if (mesh.settings.get(anti_overhang_mesh_key)
+        || mesh.settings.get(support_mesh_key)
     )
     {
         return;
@@ -1403,9 +1487,10 @@ void FffGcodeWriter::addMeshLayerToGCode(const SliceDataStorage& storage, const
     ZSeamConfig z_seam_config;
     if(mesh.isPrinted()) //"normal" meshes with walls, skin, infill, etc. get the traditional part ordering based on the z-seam settings.
     {
-        z_seam_config = ZSeamConfig(mesh.settings.get<EZSeamType>("z_seam_type"), mesh.getZSeamHint(), mesh.settings.get<EZSeamCornerPrefType>("z_seam_corner"), mesh.settings.get<coord_t>("wall_line_width_0") * 2);
+        z_seam_config = ZSeamConfig(mesh.settings.get(z_seam_type_key), mesh.getZSeamHint(), mesh.settings.get(z_seam_corner_key), mesh.settings.get(wall_line_width_0_key) * 2);
     }
     PathOrderOptimizer<const SliceLayerPart*> part_order_optimizer(gcode_layer.getLastPlannedPositionOrStartingPosition(), z_seam_config);
+    part_order_optimizer.layer_nr = gcode_layer.getLayerNr();
     for(const SliceLayerPart& part : layer.parts)
     {
         part_order_optimizer.addPolygon(&part);
@@ -1416,12 +1501,12 @@ void FffGcodeWriter::addMeshLayerToGCode(const SliceDataStorage& storage, const
         addMeshPartToGCode(storage, mesh, extruder_nr, mesh_config, *path.vertices, gcode_layer);
     }
 
-    const std::string extruder_identifier = (mesh.settings.get<size_t>("roofing_layer_count") > 0)? "roofing_extruder_nr" : "top_bottom_extruder_nr";
+    const std::string extruder_identifier = (mesh.settings.get(roofing_layer_count_key) > 0)? "roofing_extruder_nr" : "top_bottom_extruder_nr";
     if (extruder_nr == mesh.settings.get<ExtruderTrain&>(extruder_identifier).extruder_nr)
     {
         processIroning(storage, mesh, layer, mesh_config.ironing_config, gcode_layer);
     }
-    if (mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") != ESurfaceMode::NORMAL && extruder_nr == mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr)
+    if (mesh.settings.get(magic_mesh_surface_mode_key) != ESurfaceMode::NORMAL && extruder_nr == mesh.settings.get(wall_0_extruder_nr_key).extruder_nr)
     {
         addMeshOpenPolyLinesToGCode(mesh, mesh_config, gcode_layer);
     }
@@ -1430,18 +1515,24 @@ void FffGcodeWriter::addMeshLayerToGCode(const SliceDataStorage& storage, const
 
 void FffGcodeWriter::addMeshPartToGCode(const SliceDataStorage& storage, const SliceMeshStorage& mesh, const size_t extruder_nr, const PathConfigStorage::MeshPathConfigs& mesh_config, const SliceLayerPart& part, LayerPlan& gcode_layer) const
 {
+    static const SettingKey<bool> infill_before_walls_key("infill_before_walls");
+    static const SettingKey<bool> magic_spiralize_key("magic_spiralize");
+    static const SettingKey<size_t> initial_bottom_layers_key("initial_bottom_layers");
+    static const SettingKey<size_t> wall_line_count_key("wall_line_count");
+    static const SettingKey<Ratio> initial_layer_line_width_factor_key("initial_layer_line_width_factor");
+
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
 
     bool added_something = false;
 
-    if (mesh.settings.get<bool>("infill_before_walls"))
+    if (mesh.settings.get(infill_before_walls_key))
     {
         added_something = added_something | processInfill(storage, gcode_layer, mesh, extruder_nr, mesh_config, part);
     }
 
     added_something = added_something | processInsets(storage, gcode_layer, mesh, extruder_nr, mesh_config, part);
 
-    if (!mesh.settings.get<bool>("infill_before_walls"))
+    if (!mesh.settings.get(infill_before_walls_key))
     {
         added_something = added_something | processInfill(storage, gcode_layer, mesh, extruder_nr, mesh_config, part);
     }
@@ -1449,12 +1540,12 @@ void FffGcodeWriter::addMeshPartToGCode(const SliceDataStorage& storage, const S
     added_something = added_something | processSkin(storage, gcode_layer, mesh, extruder_nr, mesh_config, part);
 
     //After a layer part, make sure the nozzle is inside the comb boundary, so we do not retract on the perimeter.
-    if (added_something && (!mesh_group_settings.get<bool>("magic_spiralize") || gcode_layer.getLayerNr() < static_cast<LayerIndex>(mesh.settings.get<size_t>("initial_bottom_layers"))))
+    if (added_something && (!mesh_group_settings.get(magic_spiralize_key) || gcode_layer.getLayerNr() < static_cast<LayerIndex>(mesh.settings.get(initial_bottom_layers_key))))
     {
-        coord_t innermost_wall_line_width = mesh.settings.get<coord_t>((mesh.settings.get<size_t>("wall_line_count") > 1) ? "wall_line_width_x" : "wall_line_width_0");
+        coord_t innermost_wall_line_width = mesh.settings.get<coord_t>((mesh.settings.get(wall_line_count_key) > 1) ? "wall_line_width_x" : "wall_line_width_0");
         if (gcode_layer.getLayerNr() == 0)
         {
-            innermost_wall_line_width *= mesh.settings.get<Ratio>("initial_layer_line_width_factor");
+            innermost_wall_line_width *= mesh.settings.get(initial_layer_line_width_factor_key);
         }
         gcode_layer.moveInsideCombBoundary(innermost_wall_line_width, part);
     }
@@ -1475,35 +1566,52 @@ bool FffGcodeWriter::processInfill(const SliceDataStorage& storage, LayerPlan& g
 
 bool FffGcodeWriter::processMultiLayerInfill(const SliceDataStorage& storage, LayerPlan& gcode_layer, const SliceMeshStorage& mesh, const size_t extruder_nr, const PathConfigStorage::MeshPathConfigs& mesh_config, const SliceLayerPart& part) const
 {
-    if (extruder_nr != mesh.settings.get<ExtruderTrain&>("infill_extruder_nr").extruder_nr)
+    static const SettingKey<ExtruderTrain&> infill_extruder_nr_key("infill_extruder_nr");
+    static const SettingKey<coord_t> infill_line_distance_key("infill_line_distance");
+    static const SettingKey<coord_t> meshfix_maximum_resolution_key("meshfix_maximum_resolution");
+    static const SettingKey<coord_t> meshfix_maximum_deviation_key("meshfix_maximum_deviation");
+    static const SettingKey<coord_t> infill_sparse_thickness_key("infill_sparse_thickness");
+    static const SettingKey<coord_t> layer_height_key("layer_height");
+    static const SettingKey<coord_t> infill_offset_x_key("infill_offset_x");
+    static const SettingKey<coord_t> infill_offset_y_key("infill_offset_y");
+    static const SettingKey<EFillMethod> infill_pattern_key("infill_pattern");
+    static const SettingKey<bool> zig_zaggify_infill_key("zig_zaggify_infill");
+    static const SettingKey<bool> connect_infill_polygons_key("connect_infill_polygons");
+    static const SettingKey<size_t> infill_multiplier_key("infill_multiplier");
+    static const SettingKey<coord_t> cross_infill_pocket_size_key("cross_infill_pocket_size");
+    static const SettingKey<coord_t> infill_parallel_tile_size_key("infill_parallel_tile_size");
+    static const SettingKey<bool> infill_randomize_start_location_key("infill_randomize_start_location");
+    static const SettingKey<bool> infill_enable_travel_optimization_key("infill_enable_travel_optimization");
+
+    if (extruder_nr != mesh.settings.get(infill_extruder_nr_key).extruder_nr)
     {
         return false;
     }
-    const coord_t infill_line_distance = mesh.settings.get<coord_t>("infill_line_distance");
+    const coord_t infill_line_distance = mesh.settings.get(infill_line_distance_key);
     if (infill_line_distance <= 0)
     {
         return false;
     }
-    coord_t max_resolution = mesh.settings.get<coord_t>("meshfix_maximum_resolution");
-    coord_t max_deviation = mesh.settings.get<coord_t>("meshfix_maximum_deviation");
+    coord_t max_resolution = mesh.settings.get(meshfix_maximum_resolution_key);
+    coord_t max_deviation = mesh.settings.get(meshfix_maximum_deviation_key);
     AngleDegrees infill_angle = 45; //Original default. This will get updated to an element from mesh->infill_angles.
     if (!mesh.infill_angles.empty())
     {
-        const size_t combined_infill_layers = std::max(uint64_t(1), round_divide(mesh.settings.get<coord_t>("infill_sparse_thickness"), std::max(mesh.settings.get<coord_t>("layer_height"), coord_t(1))));
+        const size_t combined_infill_layers = std::max(uint64_t(1), round_divide(mesh.settings.get(infill_sparse_thickness_key), std::max(mesh.settings.get(layer_height_key), coord_t(1))));
         infill_angle = mesh.infill_angles.at((gcode_layer.getLayerNr() / combined_infill_layers) % mesh.infill_angles.size());
     }
     const Point3 mesh_middle = mesh.bounding_box.getMiddle();
-    const Point infill_origin(mesh_middle.x + mesh.settings.get<coord_t>("infill_offset_x"), mesh_middle.y + mesh.settings.get<coord_t>("infill_offset_y"));
+    const Point infill_origin(mesh_middle.x + mesh.settings.get(infill_offset_x_key), mesh_middle.y + mesh.settings.get(infill_offset_y_key));
 
     //Print the thicker infill lines first. (double or more layer thickness, infill combined with previous layers)
     bool added_something = false;
     for(unsigned int combine_idx = 1; combine_idx < part.infill_area_per_combine_per_density[0].size(); combine_idx++)
     {
         const coord_t infill_line_width = mesh_config.infill_config[combine_idx].getLineWidth();
-        const EFillMethod infill_pattern = mesh.settings.get<EFillMethod>("infill_pattern");
-        const bool zig_zaggify_infill = mesh.settings.get<bool>("zig_zaggify_infill") || infill_pattern == EFillMethod::ZIG_ZAG;
-        const bool connect_polygons = mesh.settings.get<bool>("connect_infill_polygons");
-        const size_t infill_multiplier = mesh.settings.get<size_t>("infill_multiplier");
+        const EFillMethod infill_pattern = mesh.settings.get(infill_pattern_key);
+        const bool zig_zaggify_infill = mesh.settings.get(zig_zaggify_infill_key) || infill_pattern == EFillMethod::ZIG_ZAG;
+        const bool connect_polygons = mesh.settings.get(connect_infill_polygons_key);
+        const size_t infill_multiplier = mesh.settings.get(infill_multiplier_key);
         Polygons infill_polygons;
         Polygons infill_lines;
         std::vector<VariableWidthLines> infill_paths = part.infill_wall_toolpaths;
@@ -1535,8 +1643,8 @@ bool FffGcodeWriter::processMultiLayerInfill(const SliceDataStorage& storage, La
                                infill_line_distance_here, infill_overlap, infill_multiplier, infill_angle,
                                gcode_layer.z, infill_shift, max_resolution, max_deviation, wall_line_count,
                                infill_origin, skip_stitching, connected_zigzags, use_endpieces, skip_some_zags, zag_skip_count,
-                               mesh.settings.get<coord_t>("cross_infill_pocket_size"));
-            infill_comp.generate(infill_paths, infill_polygons, infill_lines, mesh.settings, mesh.cross_fill_provider, lightning_layer, &mesh);
+                               mesh.settings.get(cross_infill_pocket_size_key), mesh.settings.getOrDefault(infill_parallel_tile_size_key, coord_t(0)));
+            infill_comp.generate(infill_paths, infill_polygons, infill_lines, mesh.settings, mesh.cross_fill_provider.get(), lightning_layer, &mesh);
         }
         if (!infill_lines.empty() || !infill_polygons.empty())
         {
@@ -1554,13 +1662,13 @@ bool FffGcodeWriter::processMultiLayerInfill(const SliceDataStorage& storage, La
             if (!infill_lines.empty())
             {
                 std::optional<Point> near_start_location;
-                if (mesh.settings.get<bool>("infill_randomize_start_location"))
+                if (mesh.settings.get(infill_randomize_start_location_key))
                 {
-                    srand(gcode_layer.getLayerNr());
-                    near_start_location = infill_lines[rand() % infill_lines.size()][0];
+                    std::minstd_rand random_generator(gcode_layer.getLayerNr()); //Seeded per layer, so the result doesn't depend on the order in which layers are processed.
+                    near_start_location = infill_lines[random_generator() % infill_lines.size()][0];
                 }
 
-                const bool enable_travel_optimization = mesh.settings.get<bool>("infill_enable_travel_optimization");
+                const bool enable_travel_optimization = mesh.settings.get(infill_enable_travel_optimization_key);
                 gcode_layer.addLinesByOptimizer(infill_lines,
                                                 mesh_config.infill_config[combine_idx],
                                                 zig_zaggify_infill ? SpaceFillType::PolyLines : SpaceFillType::Lines,
@@ -1576,11 +1684,33 @@ bool FffGcodeWriter::processMultiLayerInfill(const SliceDataStorage& storage, La
 
 bool FffGcodeWriter::processSingleLayerInfill(const SliceDataStorage& storage, LayerPlan& gcode_layer, const SliceMeshStorage& mesh, const size_t extruder_nr, const PathConfigStorage::MeshPathConfigs& mesh_config, const SliceLayerPart& part) const
 {
-    if (extruder_nr != mesh.settings.get<ExtruderTrain&>("infill_extruder_nr").extruder_nr)
+    static const SettingKey<ExtruderTrain&> infill_extruder_nr_key("infill_extruder_nr");
+    static const SettingKey<coord_t> infill_line_distance_key("infill_line_distance");
+    static const SettingKey<EFillMethod> infill_pattern_key("infill_pattern");
+    static const SettingKey<bool> zig_zaggify_infill_key("zig_zaggify_infill");
+    static const SettingKey<bool> connect_infill_polygons_key("connect_infill_polygons");
+    static const SettingKey<coord_t> infill_overlap_mm_key("infill_overlap_mm");
+    static const SettingKey<size_t> infill_multiplier_key("infill_multiplier");
+    static const SettingKey<size_t> infill_wall_line_count_key("infill_wall_line_count");
+    static const SettingKey<coord_t> meshfix_maximum_resolution_key("meshfix_maximum_resolution");
+    static const SettingKey<coord_t> meshfix_maximum_deviation_key("meshfix_maximum_deviation");
+    static const SettingKey<coord_t> infill_sparse_thickness_key("infill_sparse_thickness");
+    static const SettingKey<coord_t> layer_height_key("layer_height");
+    static const SettingKey<coord_t> infill_offset_x_key("infill_offset_x");
+    static const SettingKey<coord_t> infill_offset_y_key("infill_offset_y");
+    static const SettingKey<coord_t> cross_infill_pocket_size_key("cross_infill_pocket_size");
+    static const SettingKey<coord_t> infill_parallel_tile_size_key("infill_parallel_tile_size");
+    static const SettingKey<bool> infill_randomize_start_location_key("infill_randomize_start_location");
+    static const SettingKey<EZSeamType> z_seam_type_key("z_seam_type");
+    static const SettingKey<EZSeamCornerPrefType> z_seam_corner_key("z_seam_corner");
+    static const SettingKey<bool> infill_enable_travel_optimization_key("infill_enable_travel_optimization");
+    static const SettingKey<coord_t> infill_wipe_dist_key("infill_wipe_dist");
+
+    if (extruder_nr != mesh.settings.get(infill_extruder_nr_key).extruder_nr)
     {
         return false;
     }
-    const auto infill_line_distance = mesh.settings.get<coord_t>("infill_line_distance");
+    const auto infill_line_distance = mesh.settings.get(infill_line_distance_key);
     if (infill_line_distance == 0 || part.infill_area_per_combine_per_density[0].empty())
     {
         return false;
@@ -1593,23 +1723,23 @@ bool FffGcodeWriter::processSingleLayerInfill(const SliceDataStorage& storage, L
     std::vector<std::vector<VariableWidthLines>> wall_tool_paths; // All wall toolpaths binned by inset_idx (inner) and by density_idx (outer)
     Polygons infill_lines;
 
-    const auto pattern = mesh.settings.get<EFillMethod>("infill_pattern");
-    const bool zig_zaggify_infill = mesh.settings.get<bool>("zig_zaggify_infill") || pattern == EFillMethod::ZIG_ZAG;
-    const bool connect_polygons = mesh.settings.get<bool>("connect_infill_polygons");
-    const auto infill_overlap = mesh.settings.get<coord_t>("infill_overlap_mm");
-    const auto infill_multiplier = mesh.settings.get<size_t>("infill_multiplier");
-    const auto wall_line_count = mesh.settings.get<size_t>("infill_wall_line_count");
+    const auto pattern = mesh.settings.get(infill_pattern_key);
+    const bool zig_zaggify_infill = mesh.settings.get(zig_zaggify_infill_key) || pattern == EFillMethod::ZIG_ZAG;
+    const bool connect_polygons = mesh.settings.get(connect_infill_polygons_key);
+    const auto infill_overlap = mesh.settings.get(infill_overlap_mm_key);
+    const auto infill_multiplier = mesh.settings.get(infill_multiplier_key);
+    const auto wall_line_count = mesh.settings.get(infill_wall_line_count_key);
     const size_t last_idx = part.infill_area_per_combine_per_density.size() - 1;
-    const auto max_resolution = mesh.settings.get<coord_t>("meshfix_maximum_resolution");
-    const auto max_deviation = mesh.settings.get<coord_t>("meshfix_maximum_deviation");
+    const auto max_resolution = mesh.settings.get(meshfix_maximum_resolution_key);
+    const auto max_deviation = mesh.settings.get(meshfix_maximum_deviation_key);
     AngleDegrees infill_angle = 45; //Original default. This will get updated to an element from mesh->infill_angles.
     if (!mesh.infill_angles.empty())
     {
-        const size_t combined_infill_layers = std::max(uint64_t(1), round_divide(mesh.settings.get<coord_t>("infill_sparse_thickness"), std::max(mesh.settings.get<coord_t>("layer_height"), coord_t(1))));
+        const size_t combined_infill_layers = std::max(uint64_t(1), round_divide(mesh.settings.get(infill_sparse_thickness_key), std::max(mesh.settings.get(layer_height_key), coord_t(1))));
         infill_angle = mesh.infill_angles.at((static_cast<size_t>(gcode_layer.getLayerNr()) / combined_infill_layers) % mesh.infill_angles.size());
     }
     const Point3 mesh_middle = mesh.bounding_box.getMiddle();
-    const Point infill_origin(mesh_middle.x + mesh.settings.get<coord_t>("infill_offset_x"), mesh_middle.y + mesh.settings.get<coord_t>("infill_offset_y"));
+    const Point infill_origin(mesh_middle.x + mesh.settings.get(infill_offset_x_key), mesh_middle.y + mesh.settings.get(infill_offset_y_key));
 
     auto get_cut_offset = [](const bool zig_zaggify, const coord_t line_width, const size_t line_count)
     {
@@ -1628,7 +1758,8 @@ bool FffGcodeWriter::processSingleLayerInfill(const SliceDataStorage& storage, L
     Polygons infill_not_below_skin;
     const bool hasSkinEdgeSupport = partitionInfillBySkinAbove(infill_below_skin, infill_not_below_skin, gcode_layer, mesh, part, infill_line_width);
 
-    const auto pocket_size = mesh.settings.get<coord_t>("cross_infill_pocket_size");
+    const auto pocket_size = mesh.settings.get(cross_infill_pocket_size_key);
+    const auto parallel_tile_size = mesh.settings.getOrDefault(infill_parallel_tile_size_key, coord_t(0));
     constexpr bool skip_stitching = false;
     constexpr bool connected_zigzags = false;
     const bool use_endpieces = part.infill_area_per_combine_per_density.size() == 1; //Only use endpieces when not using gradual infill, since they will then overlap.
@@ -1703,8 +1834,8 @@ bool FffGcodeWriter::processSingleLayerInfill(const SliceDataStorage& storage, L
             Infill infill_comp(pattern, zig_zaggify_infill, connect_polygons, infill_below_skin, infill_line_width,
                                infill_line_distance_here, overlap, infill_multiplier, infill_angle, gcode_layer.z,
                                infill_shift, max_resolution, max_deviation, skin_below_wall_count, infill_origin,
-                               skip_stitching, connected_zigzags, use_endpieces, skip_some_zags, zag_skip_count, pocket_size);
-            infill_comp.generate(wall_tool_paths.back(), infill_polygons, infill_lines, mesh.settings, mesh.cross_fill_provider, lightning_layer, &mesh);
+                               skip_stitching, connected_zigzags, use_endpieces, skip_some_zags, zag_skip_count, pocket_size, parallel_tile_size);
+            infill_comp.generate(wall_tool_paths.back(), infill_polygons, infill_lines, mesh.settings, mesh.cross_fill_provider.get(), lightning_layer, &mesh, mesh.infill_cache.get());
 
             // Fixme: CURA-7848 for libArachne.
             if (density_idx < last_idx)
@@ -1741,8 +1872,8 @@ bool FffGcodeWriter::processSingleLayerInfill(const SliceDataStorage& storage, L
         Infill infill_comp(pattern, zig_zaggify_infill, connect_polygons, in_outline, infill_line_width,
                            infill_line_distance_here, overlap, infill_multiplier, infill_angle, gcode_layer.z,
                            infill_shift, max_resolution, max_deviation, wall_line_count_here, infill_origin,
-                           skip_stitching, connected_zigzags, use_endpieces, skip_some_zags, zag_skip_count, pocket_size);
-        infill_comp.generate(wall_tool_paths.back(), infill_polygons, infill_lines, mesh.settings, mesh.cross_fill_provider, lightning_layer, &mesh);
+                           skip_stitching, connected_zigzags, use_endpieces, skip_some_zags, zag_skip_count, pocket_size, parallel_tile_size);
+        infill_comp.generate(wall_tool_paths.back(), infill_polygons, infill_lines, mesh.settings, mesh.cross_fill_provider.get(), lightning_layer, &mesh, mesh.infill_cache.get());
 
         // Fixme: CURA-7848 for libArachne.
         if (density_idx < last_idx)
@@ -1763,24 +1894,24 @@ bool FffGcodeWriter::processSingleLayerInfill(const SliceDataStorage& storage, L
         setExtruder_addPrime(storage, gcode_layer, extruder_nr);
         gcode_layer.setIsInside(true); // going to print stuff inside print object
         std::optional<Point> near_start_location;
-        if(mesh.settings.get<bool>("infill_randomize_start_location"))
+        if(mesh.settings.get(infill_randomize_start_location_key))
         {
-            srand(gcode_layer.getLayerNr());
+            std::minstd_rand random_generator(gcode_layer.getLayerNr()); //Seeded per layer, so the result doesn't depend on the order in which layers are processed.
             if(!infill_lines.empty())
             {
-                near_start_location = infill_lines[rand() % infill_lines.size()][0];
+                near_start_location = infill_lines[random_generator() % infill_lines.size()][0];
             }
             else if(!infill_polygons.empty())
             {
-                PolygonRef start_poly = infill_polygons[rand() % infill_polygons.size()];
-                near_start_location = start_poly[rand() % start_poly.size()];
+                PolygonRef start_poly = infill_polygons[random_generator() % infill_polygons.size()];
+                near_start_location = start_poly[random_generator() % start_poly.size()];
             }
             else //So walls_generated must be true.
             {
-                std::vector<VariableWidthLines>* start_paths = &wall_tool_paths[rand() % wall_tool_paths.size()];
+                std::vector<VariableWidthLines>* start_paths = &wall_tool_paths[random_generator() % wall_tool_paths.size()];
                 while(start_paths->empty()) //We know for sure (because walls_generated) that one of them is not empty. So randomise until we hit it. Should almost always be very quick.
                 {
-                    start_paths = &wall_tool_paths[rand() % wall_tool_paths.size()];
+                    start_paths = &wall_tool_paths[random_generator() % wall_tool_paths.size()];
                 }
                 near_start_location = (*start_paths)[0][0].junctions[0].p;
             }
@@ -1791,7 +1922,7 @@ bool FffGcodeWriter::processSingleLayerInfill(const SliceDataStorage& storage, L
             {
                 constexpr bool retract_before_outer_wall = false;
                 constexpr coord_t wipe_dist = 0;
-                const ZSeamConfig z_seam_config(mesh.settings.get<EZSeamType>("z_seam_type"), mesh.getZSeamHint(), mesh.settings.get<EZSeamCornerPrefType>("z_seam_corner"), mesh_config.infill_config[0].getLineWidth() * 2);
+                const ZSeamConfig z_seam_config(mesh.settings.get(z_seam_type_key), mesh.getZSeamHint(), mesh.settings.get(z_seam_corner_key), mesh_config.infill_config[0].getLineWidth() * 2);
                 InsetOrderOptimizer wall_orderer(*this, storage, gcode_layer, mesh.settings, extruder_nr,
                                                  mesh_config.infill_config[0], mesh_config.infill_config[0], mesh_config.infill_config[0], mesh_config.infill_config[0],
                                                  retract_before_outer_wall, wipe_dist, wipe_dist, extruder_nr, extruder_nr, z_seam_config, tool_paths);
@@ -1805,7 +1936,7 @@ bool FffGcodeWriter::processSingleLayerInfill(const SliceDataStorage& storage, L
             gcode_layer.addTravel(PolygonUtils::findNearestVert(gcode_layer.getLastPlannedPositionOrStartingPosition(), infill_polygons).p(), force_comb_retract);
             gcode_layer.addPolygonsByOptimizer(infill_polygons, mesh_config.infill_config[0], ZSeamConfig(), 0, false, 1.0_r, false, false, near_start_location);
         }
-        const bool enable_travel_optimization = mesh.settings.get<bool>("infill_enable_travel_optimization");
+        const bool enable_travel_optimization = mesh.settings.get(infill_enable_travel_optimization_key);
         if (pattern == EFillMethod::GRID
                 || pattern == EFillMethod::LINES
                 || pattern == EFillMethod::TRIANGLES
@@ -1816,7 +1947,7 @@ bool FffGcodeWriter::processSingleLayerInfill(const SliceDataStorage& storage, L
                 || pattern == EFillMethod::LIGHTNING)
         {
             gcode_layer.addLinesByOptimizer(infill_lines, mesh_config.infill_config[0], SpaceFillType::Lines, enable_travel_optimization
-                , mesh.settings.get<coord_t>("infill_wipe_dist"), /*float_ratio = */ 1.0, near_start_location);
+                , mesh.settings.get(infill_wipe_dist_key), /*float_ratio = */ 1.0, near_start_location);
         }
         else
         {
@@ -1923,7 +2054,7 @@ bool FffGcodeWriter::partitionInfillBySkinAbove(Polygons& infill_below_skin, Pol
     }
 
     // need to take skin/infill overlap that was added in SkinInfillAreaComputation::generateInfill() into account
-    const coord_t infill_skin_overlap = mesh.settings.get<coord_t>((part.wall_toolpaths.size() > 1) ? "wall_line_width_x" : "wall_line_width_0") / 2;
+    const coord_t infill_skin_overlap = mesh.settings.get<coord_t>((part.getWallToolpathInsetCount() > 1) ? "wall_line_width_x" : "wall_line_width_0") / 2;
     const Polygons infill_below_skin_overlap = infill_below_skin.offset(-(infill_skin_overlap + tiny_infill_offset));
 
     return !infill_below_skin_overlap.empty() && !infill_not_below_skin.empty();
@@ -1961,22 +2092,37 @@ void FffGcodeWriter::processSpiralizedWall(const SliceDataStorage& storage, Laye
 
 bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& gcode_layer, const SliceMeshStorage& mesh, const size_t extruder_nr, const PathConfigStorage::MeshPathConfigs& mesh_config, const SliceLayerPart& part) const
 {
+    static const SettingKey<ExtruderTrain&> wall_0_extruder_nr_key("wall_0_extruder_nr");
+    static const SettingKey<ExtruderTrain&> wall_x_extruder_nr_key("wall_x_extruder_nr");
+    static const SettingKey<size_t> wall_line_count_key("wall_line_count");
+    static const SettingKey<bool> magic_spiralize_key("magic_spiralize");
+    static const SettingKey<size_t> initial_bottom_layers_key("initial_bottom_layers");
+    static const SettingKey<bool> support_enable_key("support_enable");
+    static const SettingKey<coord_t> support_top_distance_key("support_top_distance");
+    static const SettingKey<bool> bridge_settings_enabled_key("bridge_settings_enabled");
+    static const SettingKey<AngleDegrees> wall_overhang_angle_key("wall_overhang_angle");
+    static const SettingKey<EZSeamType> z_seam_type_key("z_seam_type");
+    static const SettingKey<EZSeamCornerPrefType> z_seam_corner_key("z_seam_corner");
+    static const SettingKey<coord_t> wall_line_width_0_key("wall_line_width_0");
+    static const SettingKey<bool> travel_retract_before_outer_wall_key("travel_retract_before_outer_wall");
+    static const SettingKey<coord_t> wall_0_wipe_dist_key("wall_0_wipe_dist");
+
     bool added_something = false;
-    if (extruder_nr != mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr && extruder_nr != mesh.settings.get<ExtruderTrain&>("wall_x_extruder_nr").extruder_nr)
+    if (extruder_nr != mesh.settings.get(wall_0_extruder_nr_key).extruder_nr && extruder_nr != mesh.settings.get(wall_x_extruder_nr_key).extruder_nr)
     {
         return added_something;
     }
-    if (mesh.settings.get<size_t>("wall_line_count") <= 0)
+    if (mesh.settings.get(wall_line_count_key) <= 0)
     {
         return added_something;
     }
 
     bool spiralize = false;
-    if(Application::getInstance().current_slice->scene.current_mesh_group->settings.get<bool>("magic_spiralize"))
+    if(Application::getInstance().current_slice->scene.current_mesh_group->settings.get(magic_spiralize_key))
     {
-        const size_t initial_bottom_layers = mesh.settings.get<size_t>("initial_bottom_layers");
+        const size_t initial_bottom_layers = mesh.settings.get(initial_bottom_layers_key);
         const int layer_nr = gcode_layer.getLayerNr();
-        if ((layer_nr < static_cast<LayerIndex>(initial_bottom_layers) && part.wall_toolpaths.empty()) // The bottom layers in spiralize mode are generated using the variable width paths
+        if ((layer_nr < static_cast<LayerIndex>(initial_bottom_layers) && part.getWallToolpathInsetCount() == 0) // The bottom layers in spiralize mode are generated using the variable width paths
             || (layer_nr >= static_cast<LayerIndex>(initial_bottom_layers) && part.spiral_wall.empty())) // The rest of the layers in spiralize mode are using the spiral wall
         {
             // nothing to do
@@ -1986,7 +2132,7 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
         {
             spiralize = true;
         }
-        if (spiralize && gcode_layer.getLayerNr() == static_cast<LayerIndex>(initial_bottom_layers) && extruder_nr == mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr)
+        if (spiralize && gcode_layer.getLayerNr() == static_cast<LayerIndex>(initial_bottom_layers) && extruder_nr == mesh.settings.get(wall_0_extruder_nr_key).extruder_nr)
         { // on the last normal layer first make the outer wall normally and then start a second outer wall from the same hight, but gradually moving upward
             added_something = true;
             setExtruder_addPrime(storage, gcode_layer, extruder_nr);
@@ -2013,12 +2159,10 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
         {
             if (m.isPrinted())
             {
-                for (const SliceLayerPart& prevLayerPart : m.layers[gcode_layer.getLayerNr() - 1].parts)
+                const SliceLayer& prev_layer = m.layers[gcode_layer.getLayerNr() - 1];
+                for (const size_t prev_part_idx : prev_layer.getPartsOverlapping(boundaryBox))
                 {
-                    if (boundaryBox.hit(prevLayerPart.boundaryBox))
-                    {
-                        outlines_below.add(prevLayerPart.outline);
-                    }
+                    outlines_below.add(prev_layer.parts[prev_part_idx].outline);
                 }
             }
         }
@@ -2028,9 +2172,9 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
         // if support is enabled, add the support outlines also so we don't generate bridges over support
 
         const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
-        if (mesh_group_settings.get<bool>("support_enable"))
+        if (mesh_group_settings.get(support_enable_key))
         {
-            const coord_t z_distance_top = mesh.settings.get<coord_t>("support_top_distance");
+            const coord_t z_distance_top = mesh.settings.get(support_top_distance_key);
             const size_t z_distance_top_layers = round_up_divide(z_distance_top, layer_height) + 1;
             const int support_layer_nr = gcode_layer.getLayerNr() - z_distance_top_layers;
 
@@ -2066,7 +2210,7 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
 
         outlines_below = outlines_below.offset(-half_outer_wall_width).offset(half_outer_wall_width);
 
-        if (mesh.settings.get<bool>("bridge_settings_enabled"))
+        if (mesh.settings.get(bridge_settings_enabled_key))
         {
             // max_air_gap is the max allowed width of the unsupported region below the wall line
             // if the unsupported region is wider than max_air_gap, the wall line will be printed using bridge settings
@@ -2090,7 +2234,7 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
             gcode_layer.setBridgeWallMask(Polygons());
         }
 
-        const AngleDegrees overhang_angle = mesh.settings.get<AngleDegrees>("wall_overhang_angle");
+        const AngleDegrees overhang_angle = mesh.settings.get(wall_overhang_angle_key);
         if (overhang_angle >= 90)
         {
             // clear to disable overhang detection
@@ -2115,7 +2259,7 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
         gcode_layer.setOverhangMask(Polygons());
     }
 
-    if(spiralize && extruder_nr == mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr && !part.spiral_wall.empty())
+    if(spiralize && extruder_nr == mesh.settings.get(wall_0_extruder_nr_key).extruder_nr && !part.spiral_wall.empty())
     {
         added_something = true;
         setExtruder_addPrime(storage, gcode_layer, extruder_nr);
@@ -2137,13 +2281,19 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
     else
     {
         //Main case: Optimize the insets with the InsetOrderOptimizer.
+        std::vector<VariableWidthLines> expanded_wall_toolpaths;
+        if (part.wall_toolpaths.empty() && !part.compact_wall_toolpaths.empty())
+        {
+            expanded_wall_toolpaths = part.compact_wall_toolpaths.expand();
+        }
+        const std::vector<VariableWidthLines>& wall_toolpaths = expanded_wall_toolpaths.empty() ? part.wall_toolpaths : expanded_wall_toolpaths;
         const coord_t wall_x_wipe_dist = 0;
-        const ZSeamConfig z_seam_config(mesh.settings.get<EZSeamType>("z_seam_type"), mesh.getZSeamHint(), mesh.settings.get<EZSeamCornerPrefType>("z_seam_corner"), mesh.settings.get<coord_t>("wall_line_width_0") * 2);
+        const ZSeamConfig z_seam_config(mesh.settings.get(z_seam_type_key), mesh.getZSeamHint(), mesh.settings.get(z_seam_corner_key), mesh.settings.get(wall_line_width_0_key) * 2);
         InsetOrderOptimizer wall_orderer(*this, storage, gcode_layer, mesh.settings, extruder_nr,
                                          mesh_config.inset0_config, mesh_config.insetX_config, mesh_config.bridge_inset0_config, mesh_config.bridge_insetX_config,
-                                         mesh.settings.get<bool>("travel_retract_before_outer_wall"), mesh.settings.get<coord_t>("wall_0_wipe_dist"), wall_x_wipe_dist,
-                                         mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr, mesh.settings.get<ExtruderTrain&>("wall_x_extruder_nr").extruder_nr,
-                                         z_seam_config, part.wall_toolpaths);
+                                         mesh.settings.get(travel_retract_before_outer_wall_key), mesh.settings.get(wall_0_wipe_dist_key), wall_x_wipe_dist,
+                                         mesh.settings.get(wall_0_extruder_nr_key).extruder_nr, mesh.settings.get(wall_x_extruder_nr_key).extruder_nr,
+                                         z_seam_config, wall_toolpaths);
         added_something |= wall_orderer.addToLayer();
     }
     return added_something;
@@ -2184,10 +2334,16 @@ std::optional<Point> FffGcodeWriter::getSeamAvoidingLocation(const Polygons& fil
 
 bool FffGcodeWriter::processSkin(const SliceDataStorage& storage, LayerPlan& gcode_layer, const SliceMeshStorage& mesh, const size_t extruder_nr, const PathConfigStorage::MeshPathConfigs& mesh_config, const SliceLayerPart& part) const
 {
-    const size_t top_bottom_extruder_nr = mesh.settings.get<ExtruderTrain&>("top_bottom_extruder_nr").extruder_nr;
-    const size_t roofing_extruder_nr = mesh.settings.get<ExtruderTrain&>("roofing_extruder_nr").extruder_nr;
-    const size_t wall_0_extruder_nr = mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr;
-    const size_t roofing_layer_count = std::min(mesh.settings.get<size_t>("roofing_layer_count"), mesh.settings.get<size_t>("top_layers"));
+    static const SettingKey<ExtruderTrain&> top_bottom_extruder_nr_key("top_bottom_extruder_nr");
+    static const SettingKey<ExtruderTrain&> roofing_extruder_nr_key("roofing_extruder_nr");
+    static const SettingKey<ExtruderTrain&> wall_0_extruder_nr_key("wall_0_extruder_nr");
+    static const SettingKey<size_t> roofing_layer_count_key("roofing_layer_count");
+    static const SettingKey<size_t> top_layers_key("top_layers");
+
+    const size_t top_bottom_extruder_nr = mesh.settings.get(top_bottom_extruder_nr_key).extruder_nr;
+    const size_t roofing_extruder_nr = mesh.settings.get(roofing_extruder_nr_key).extruder_nr;
+    const size_t wall_0_extruder_nr = mesh.settings.get(wall_0_extruder_nr_key).extruder_nr;
+    const size_t roofing_layer_count = std::min(mesh.settings.get(roofing_layer_count_key), mesh.settings.get(top_layers_key));
     if (extruder_nr != top_bottom_extruder_nr && extruder_nr != wall_0_extruder_nr
         && (extruder_nr != roofing_extruder_nr || roofing_layer_count <= 0))
     {
@@ -2228,13 +2384,17 @@ bool FffGcodeWriter::processSkinPart(const SliceDataStorage& storage, LayerPlan&
 
 void FffGcodeWriter::processRoofing(const SliceDataStorage& storage, LayerPlan& gcode_layer, const SliceMeshStorage& mesh, const size_t extruder_nr, const PathConfigStorage::MeshPathConfigs& mesh_config, const SkinPart& skin_part, bool& added_something) const
 {
-    const size_t roofing_extruder_nr = mesh.settings.get<ExtruderTrain&>("roofing_extruder_nr").extruder_nr;
+    static const SettingKey<ExtruderTrain&> roofing_extruder_nr_key("roofing_extruder_nr");
+    static const SettingKey<EFillMethod> roofing_pattern_key("roofing_pattern");
+    static const SettingKey<bool> roofing_monotonic_key("roofing_monotonic");
+
+    const size_t roofing_extruder_nr = mesh.settings.get(roofing_extruder_nr_key).extruder_nr;
     if (extruder_nr != roofing_extruder_nr)
     {
         return;
     }
 
-    const EFillMethod pattern = mesh.settings.get<EFillMethod>("roofing_pattern");
+    const EFillMethod pattern = mesh.settings.get(roofing_pattern_key);
     AngleDegrees roofing_angle = 45;
     if (mesh.roofing_angles.size() > 0)
     {
@@ -2243,17 +2403,34 @@ void FffGcodeWriter::processRoofing(const SliceDataStorage& storage, LayerPlan&
 
     const Ratio skin_density = 1.0;
     const coord_t skin_overlap = 0; // skinfill already expanded over the roofing areas; don't overlap with perimeters
-    const bool monotonic = mesh.settings.get<bool>("roofing_monotonic");
+    const bool monotonic = mesh.settings.get(roofing_monotonic_key);
     processSkinPrintFeature(storage, gcode_layer, mesh, mesh_config, extruder_nr, skin_part.roofing_fill, mesh_config.roofing_config, pattern, roofing_angle, skin_overlap, skin_density, monotonic, added_something);
 }
 
 void FffGcodeWriter::processTopBottom(const SliceDataStorage& storage, LayerPlan& gcode_layer, const SliceMeshStorage& mesh, const size_t extruder_nr, const PathConfigStorage::MeshPathConfigs& mesh_config, const SkinPart& skin_part, bool& added_something) const
 {
+    static const SettingKey<ExtruderTrain&> top_bottom_extruder_nr_key("top_bottom_extruder_nr");
+    static const SettingKey<EFillMethod> top_bottom_pattern_0_key("top_bottom_pattern_0");
+    static const SettingKey<EFillMethod> top_bottom_pattern_key("top_bottom_pattern");
+    static const SettingKey<coord_t> skin_overlap_mm_key("skin_overlap_mm");
+    static const SettingKey<bool> bridge_settings_enabled_key("bridge_settings_enabled");
+    static const SettingKey<bool> bridge_enable_more_layers_key("bridge_enable_more_layers");
+    static const SettingKey<Ratio> bridge_skin_support_threshold_key("bridge_skin_support_threshold");
+    static const SettingKey<size_t> bottom_layers_key("bottom_layers");
+    static const SettingKey<bool> support_enable_key("support_enable");
+    static const SettingKey<coord_t> support_top_distance_key("support_top_distance");
+    static const SettingKey<Ratio> bridge_skin_density_key("bridge_skin_density");
+    static const SettingKey<Ratio> bridge_skin_density_2_key("bridge_skin_density_2");
+    static const SettingKey<Ratio> bridge_skin_density_3_key("bridge_skin_density_3");
+    static const SettingKey<bool> support_fan_enable_key("support_fan_enable");
+    static const SettingKey<Ratio> support_supported_skin_fan_speed_key("support_supported_skin_fan_speed");
+    static const SettingKey<bool> skin_monotonic_key("skin_monotonic");
+
     if (skin_part.skin_fill.empty())
     {
         return; // bridgeAngle requires a non-empty skin_fill.
     }
-    const size_t top_bottom_extruder_nr = mesh.settings.get<ExtruderTrain&>("top_bottom_extruder_nr").extruder_nr;
+    const size_t top_bottom_extruder_nr = mesh.settings.get(top_bottom_extruder_nr_key).extruder_nr;
     if (extruder_nr != top_bottom_extruder_nr)
     {
         return;
@@ -2263,8 +2440,8 @@ void FffGcodeWriter::processTopBottom(const SliceDataStorage& storage, LayerPlan
     const size_t layer_nr = gcode_layer.getLayerNr();
 
     EFillMethod pattern = (layer_nr == 0) ?
-        mesh.settings.get<EFillMethod>("top_bottom_pattern_0") :
-        mesh.settings.get<EFillMethod>("top_bottom_pattern");
+        mesh.settings.get(top_bottom_pattern_0_key) :
+        mesh.settings.get(top_bottom_pattern_key);
 
     AngleDegrees skin_angle = 45;
     if (mesh.skin_angles.size() > 0)
@@ -2275,22 +2452,22 @@ void FffGcodeWriter::processTopBottom(const SliceDataStorage& storage, LayerPlan
     // generate skin_polygons and skin_lines
     const GCodePathConfig* skin_config = &mesh_config.skin_config;
     Ratio skin_density = 1.0;
-    coord_t skin_overlap = mesh.settings.get<coord_t>("skin_overlap_mm");
+    coord_t skin_overlap = mesh.settings.get(skin_overlap_mm_key);
     const coord_t more_skin_overlap = std::max(skin_overlap, (coord_t)(mesh_config.insetX_config.getLineWidth() / 2)); // force a minimum amount of skin_overlap
-    const bool bridge_settings_enabled = mesh.settings.get<bool>("bridge_settings_enabled");
-    const bool bridge_enable_more_layers = bridge_settings_enabled && mesh.settings.get<bool>("bridge_enable_more_layers");
-    const Ratio support_threshold = bridge_settings_enabled ? mesh.settings.get<Ratio>("bridge_skin_support_threshold") : 0.0_r;
-    const size_t bottom_layers = mesh.settings.get<size_t>("bottom_layers");
+    const bool bridge_settings_enabled = mesh.settings.get(bridge_settings_enabled_key);
+    const bool bridge_enable_more_layers = bridge_settings_enabled && mesh.settings.get(bridge_enable_more_layers_key);
+    const Ratio support_threshold = bridge_settings_enabled ? mesh.settings.get(bridge_skin_support_threshold_key) : 0.0_r;
+    const size_t bottom_layers = mesh.settings.get(bottom_layers_key);
 
     // if support is enabled, consider the support outlines so we don't generate bridges over support
 
     int support_layer_nr = -1;
     const SupportLayer* support_layer = nullptr;
 
-    if (mesh_group_settings.get<bool>("support_enable"))
+    if (mesh_group_settings.get(support_enable_key))
     {
         const coord_t layer_height = mesh_config.inset0_config.getLayerThickness();
-        const coord_t z_distance_top = mesh.settings.get<coord_t>("support_top_distance");
+        const coord_t z_distance_top = mesh.settings.get(support_top_distance_key);
         const size_t z_distance_top_layers = round_up_divide(z_distance_top, layer_height) + 1;
         support_layer_nr = layer_nr - z_distance_top_layers;
     }
@@ -2354,21 +2531,21 @@ void FffGcodeWriter::processTopBottom(const SliceDataStorage& storage, LayerPlan
     bool is_bridge_skin = false;
     if (layer_nr > 0)
     {
-        is_bridge_skin = handle_bridge_skin(1, &mesh_config.bridge_skin_config, mesh.settings.get<Ratio>("bridge_skin_density"));
+        is_bridge_skin = handle_bridge_skin(1, &mesh_config.bridge_skin_config, mesh.settings.get(bridge_skin_density_key));
     }
     if (bridge_enable_more_layers && !is_bridge_skin && layer_nr > 1 && bottom_layers > 1)
     {
-        is_bridge_skin = handle_bridge_skin(2, &mesh_config.bridge_skin_config2, mesh.settings.get<Ratio>("bridge_skin_density_2"));
+        is_bridge_skin = handle_bridge_skin(2, &mesh_config.bridge_skin_config2, mesh.settings.get(bridge_skin_density_2_key));
 
         if (!is_bridge_skin && layer_nr > 2 && bottom_layers > 2)
         {
-            is_bridge_skin = handle_bridge_skin(3, &mesh_config.bridge_skin_config3, mesh.settings.get<Ratio>("bridge_skin_density_3"));
+            is_bridge_skin = handle_bridge_skin(3, &mesh_config.bridge_skin_config3, mesh.settings.get(bridge_skin_density_3_key));
         }
     }
 
     double fan_speed = GCodePathConfig::FAN_SPEED_DEFAULT;
 
-    if (layer_nr > 0 && skin_config == &mesh_config.skin_config && support_layer_nr >= 0 && mesh.settings.get<bool>("support_fan_enable"))
+    if (layer_nr > 0 && skin_config == &mesh_config.skin_config && support_layer_nr >= 0 && mesh.settings.get(support_fan_enable_key))
     {
         // skin isn't a bridge but is it above support and we need to modify the fan speed?
 
@@ -2405,26 +2582,37 @@ void FffGcodeWriter::processTopBottom(const SliceDataStorage& storage, LayerPlan
 
         if (supported)
         {
-            fan_speed = mesh.settings.get<Ratio>("support_supported_skin_fan_speed") * 100.0;
+            fan_speed = mesh.settings.get(support_supported_skin_fan_speed_key) * 100.0;
         }
     }
-    const bool monotonic = mesh.settings.get<bool>("skin_monotonic");
+    const bool monotonic = mesh.settings.get(skin_monotonic_key);
     processSkinPrintFeature(storage, gcode_layer, mesh, mesh_config, extruder_nr, skin_part.skin_fill, *skin_config, pattern, skin_angle, skin_overlap, skin_density, monotonic, added_something, fan_speed);
 }
 
 void FffGcodeWriter::processSkinPrintFeature(const SliceDataStorage& storage, LayerPlan& gcode_layer, const SliceMeshStorage& mesh, const PathConfigStorage::MeshPathConfigs& mesh_config, const size_t extruder_nr, const Polygons& area, const GCodePathConfig& config, EFillMethod pattern, const AngleDegrees skin_angle, const coord_t skin_overlap, const Ratio skin_density, const bool monotonic, bool& added_something, double fan_speed) const
 {
+    static const SettingKey<size_t> skin_outline_count_key("skin_outline_count");
+    static const SettingKey<bool> connect_skin_polygons_key("connect_skin_polygons");
+    static const SettingKey<coord_t> meshfix_maximum_resolution_key("meshfix_maximum_resolution");
+    static const SettingKey<coord_t> meshfix_maximum_deviation_key("meshfix_maximum_deviation");
+    static const SettingKey<ExtruderTrain&> top_bottom_extruder_nr_key("top_bottom_extruder_nr");
+    static const SettingKey<EZSeamType> z_seam_type_key("z_seam_type");
+    static const SettingKey<EZSeamCornerPrefType> z_seam_corner_key("z_seam_corner");
+    static const SettingKey<coord_t> infill_wipe_dist_key("infill_wipe_dist");
+    static const SettingKey<EFillMethod> top_bottom_pattern_0_key("top_bottom_pattern_0");
+    static const SettingKey<EFillMethod> top_bottom_pattern_key("top_bottom_pattern");
+
     Polygons skin_polygons;
     Polygons skin_lines;
     std::vector<VariableWidthLines> skin_paths;
 
     constexpr int infill_multiplier = 1;
     constexpr int extra_infill_shift = 0;
-    const size_t wall_line_count = mesh.settings.get<size_t>("skin_outline_count");
+    const size_t wall_line_count = mesh.settings.get(skin_outline_count_key);
     const bool zig_zaggify_infill = pattern == EFillMethod::ZIG_ZAG;
-    const bool connect_polygons = mesh.settings.get<bool>("connect_skin_polygons");
-    coord_t max_resolution = mesh.settings.get<coord_t>("meshfix_maximum_resolution");
-    coord_t max_deviation = mesh.settings.get<coord_t>("meshfix_maximum_deviation");
+    const bool connect_polygons = mesh.settings.get(connect_skin_polygons_key);
+    coord_t max_resolution = mesh.settings.get(meshfix_maximum_resolution_key);
+    coord_t max_deviation = mesh.settings.get(meshfix_maximum_deviation_key);
     const Point infill_origin;
     const bool skip_line_stitching = monotonic;
     constexpr bool connected_zigzags = false;
@@ -2440,7 +2628,7 @@ void FffGcodeWriter::processSkinPrintFeature(const SliceDataStorage& storage, La
         skip_line_stitching,
         connected_zigzags, use_endpieces, skip_some_zags, zag_skip_count, pocket_size
         );
-    infill_comp.generate(skin_paths, skin_polygons, skin_lines, mesh.settings);
+    infill_comp.generate(skin_paths, skin_polygons, skin_lines, mesh.settings, nullptr, nullptr, nullptr, mesh.infill_cache.get());
 
     // add paths
     if(!skin_polygons.empty() || !skin_lines.empty() || !skin_paths.empty())
@@ -2451,12 +2639,12 @@ void FffGcodeWriter::processSkinPrintFeature(const SliceDataStorage& storage, La
         if(!skin_paths.empty())
         {
             // Add skin-walls a.k.a. skin-perimeters, skin-insets.
-            const size_t skin_extruder_nr = mesh.settings.get<ExtruderTrain&>("top_bottom_extruder_nr").extruder_nr;
+            const size_t skin_extruder_nr = mesh.settings.get(top_bottom_extruder_nr_key).extruder_nr;
             if (extruder_nr == skin_extruder_nr)
             {
                 constexpr bool retract_before_outer_wall = false;
                 constexpr coord_t wipe_dist = 0;
-                const ZSeamConfig z_seam_config(mesh.settings.get<EZSeamType>("z_seam_type"), mesh.getZSeamHint(), mesh.settings.get<EZSeamCornerPrefType>("z_seam_corner"), config.getLineWidth() * 2);
+                const ZSeamConfig z_seam_config(mesh.settings.get(z_seam_type_key), mesh.getZSeamHint(), mesh.settings.get(z_seam_corner_key), config.getLineWidth() * 2);
                 InsetOrderOptimizer wall_orderer(*this, storage, gcode_layer, mesh.settings, extruder_nr,
                                                  mesh_config.skin_config, mesh_config.skin_config, mesh_config.skin_config, mesh_config.skin_config,
                                                  retract_before_outer_wall, wipe_dist, wipe_dist, skin_extruder_nr, skin_extruder_nr, z_seam_config, skin_paths);
@@ -2486,7 +2674,7 @@ void FffGcodeWriter::processSkinPrintFeature(const SliceDataStorage& storage, La
                     || pattern == EFillMethod::CUBICSUBDIV
                     || pattern == EFillMethod::LIGHTNING)
             {
-                gcode_layer.addLinesMonotonic(area, skin_lines, config, SpaceFillType::Lines, monotonic_direction, max_adjacent_distance, exclude_distance, mesh.settings.get<coord_t>("infill_wipe_dist"), flow, fan_speed);
+                gcode_layer.addLinesMonotonic(area, skin_lines, config, SpaceFillType::Lines, monotonic_direction, max_adjacent_distance, exclude_distance, mesh.settings.get(infill_wipe_dist_key), flow, fan_speed);
             }
             else
             {
@@ -2499,8 +2687,8 @@ void FffGcodeWriter::processSkinPrintFeature(const SliceDataStorage& storage, La
         {
             std::optional<Point> near_start_location;
             const EFillMethod pattern = (gcode_layer.getLayerNr() == 0) ?
-                mesh.settings.get<EFillMethod>("top_bottom_pattern_0") :
-                mesh.settings.get<EFillMethod>("top_bottom_pattern");
+                mesh.settings.get(top_bottom_pattern_0_key) :
+                mesh.settings.get(top_bottom_pattern_key);
             if (pattern == EFillMethod::LINES || pattern == EFillMethod::ZIG_ZAG)
             { // update near_start_location to a location which tries to avoid seams in skin
                 near_start_location = getSeamAvoidingLocation(area, skin_angle, gcode_layer.getLastPlannedPositionOrStartingPosition());
@@ -2517,7 +2705,7 @@ void FffGcodeWriter::processSkinPrintFeature(const SliceDataStorage& storage, La
                     || pattern == EFillMethod::CUBICSUBDIV
                     || pattern == EFillMethod::LIGHTNING)
             {
-                gcode_layer.addLinesByOptimizer(skin_lines, config, SpaceFillType::Lines, enable_travel_optimization, mesh.settings.get<coord_t>("infill_wipe_dist"), flow, near_start_location, fan_speed);
+                gcode_layer.addLinesByOptimizer(skin_lines, config, SpaceFillType::Lines, enable_travel_optimization, mesh.settings.get(infill_wipe_dist_key), flow, near_start_location, fan_speed);
             }
             else
             {
@@ -2584,6 +2772,26 @@ bool FffGcodeWriter::addSupportToGCode(const SliceDataStorage& storage, LayerPla
 
 bool FffGcodeWriter::processSupportInfill(const SliceDataStorage& storage, LayerPlan& gcode_layer) const
 {
+    static const SettingKey<ExtruderTrain&> support_extruder_nr_layer_0_key("support_extruder_nr_layer_0");
+    static const SettingKey<ExtruderTrain&> support_infill_extruder_nr_key("support_infill_extruder_nr");
+    static const SettingKey<coord_t> support_line_distance_key("support_line_distance");
+    static const SettingKey<coord_t> support_initial_layer_line_distance_key("support_initial_layer_line_distance");
+    static const SettingKey<coord_t> infill_overlap_mm_key("infill_overlap_mm");
+    static const SettingKey<size_t> support_wall_count_key("support_wall_count");
+    static const SettingKey<coord_t> meshfix_maximum_resolution_key("meshfix_maximum_resolution");
+    static const SettingKey<coord_t> meshfix_maximum_deviation_key("meshfix_maximum_deviation");
+    static const SettingKey<coord_t> support_line_width_key("support_line_width");
+    static const SettingKey<EPlatformAdhesion> adhesion_type_key("adhesion_type");
+    static const SettingKey<Ratio> initial_layer_line_width_factor_key("initial_layer_line_width_factor");
+    static const SettingKey<EFillMethod> support_pattern_key("support_pattern");
+    static const SettingKey<bool> zig_zaggify_support_key("zig_zaggify_support");
+    static const SettingKey<bool> support_skip_some_zags_key("support_skip_some_zags");
+    static const SettingKey<size_t> support_zag_skip_count_key("support_zag_skip_count");
+    static const SettingKey<coord_t> support_brim_line_count_key("support_brim_line_count");
+    static const SettingKey<bool> support_connect_zigzags_key("support_connect_zigzags");
+    static const SettingKey<ESupportStructure> support_structure_key("support_structure");
+    static const SettingKey<bool> material_alternate_walls_key("material_alternate_walls");
+
     bool added_something = false;
     const SupportLayer& support_layer = storage.support.supportLayers[std::max(0, gcode_layer.getLayerNr())]; // account for negative layer numbers for raft filler layers
 
@@ -2593,18 +2801,18 @@ bool FffGcodeWriter::processSupportInfill(const SliceDataStorage& storage, Layer
     }
 
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
-    const size_t extruder_nr = (gcode_layer.getLayerNr() <= 0) ? mesh_group_settings.get<ExtruderTrain&>("support_extruder_nr_layer_0").extruder_nr : mesh_group_settings.get<ExtruderTrain&>("support_infill_extruder_nr").extruder_nr;
+    const size_t extruder_nr = (gcode_layer.getLayerNr() <= 0) ? mesh_group_settings.get(support_extruder_nr_layer_0_key).extruder_nr : mesh_group_settings.get(support_infill_extruder_nr_key).extruder_nr;
     const ExtruderTrain& infill_extruder = Application::getInstance().current_slice->scene.extruders[extruder_nr];
 
-    coord_t default_support_line_distance = infill_extruder.settings.get<coord_t>("support_line_distance");
+    coord_t default_support_line_distance = infill_extruder.settings.get(support_line_distance_key);
     
     // To improve adhesion for the "support initial layer" the first layer might have different properties
     if(gcode_layer.getLayerNr() == 0)
     {
-        default_support_line_distance = infill_extruder.settings.get<coord_t>("support_initial_layer_line_distance"); 
+        default_support_line_distance = infill_extruder.settings.get(support_initial_layer_line_distance_key); 
     }
 
-    const coord_t default_support_infill_overlap = infill_extruder.settings.get<coord_t>("infill_overlap_mm");
+    const coord_t default_support_infill_overlap = infill_extruder.settings.get(infill_overlap_mm_key);
 
     // Helper to get the support infill angle
     const auto get_support_infill_angle = [](const SupportStorage& support_storage, const int layer_nr)
@@ -2621,13 +2829,13 @@ bool FffGcodeWriter::processSupportInfill(const SliceDataStorage& storage, Layer
     const AngleDegrees support_infill_angle = get_support_infill_angle(storage.support, gcode_layer.getLayerNr());
 
     constexpr size_t infill_multiplier = 1; // there is no frontend setting for this (yet)
-    const size_t wall_line_count = infill_extruder.settings.get<size_t>("support_wall_count");
-    const coord_t max_resolution = infill_extruder.settings.get<coord_t>("meshfix_maximum_resolution");
-    const coord_t max_deviation = infill_extruder.settings.get<coord_t>("meshfix_maximum_deviation");
-    coord_t default_support_line_width = infill_extruder.settings.get<coord_t>("support_line_width");
-    if (gcode_layer.getLayerNr() == 0 && mesh_group_settings.get<EPlatformAdhesion>("adhesion_type") != EPlatformAdhesion::RAFT)
+    const size_t wall_line_count = infill_extruder.settings.get(support_wall_count_key);
+    const coord_t max_resolution = infill_extruder.settings.get(meshfix_maximum_resolution_key);
+    const coord_t max_deviation = infill_extruder.settings.get(meshfix_maximum_deviation_key);
+    coord_t default_support_line_width = infill_extruder.settings.get(support_line_width_key);
+    if (gcode_layer.getLayerNr() == 0 && mesh_group_settings.get(adhesion_type_key) != EPlatformAdhesion::RAFT)
     {
-        default_support_line_width *= infill_extruder.settings.get<Ratio>("initial_layer_line_width_factor");
+        default_support_line_width *= infill_extruder.settings.get(initial_layer_line_width_factor_key);
     }
 
     // Helper to get the support pattern
@@ -2639,11 +2847,11 @@ bool FffGcodeWriter::processSupportInfill(const SliceDataStorage& storage, Layer
       }
       return pattern;
     };
-    const EFillMethod support_pattern = get_support_pattern(infill_extruder.settings.get<EFillMethod>("support_pattern"), gcode_layer.getLayerNr());
+    const EFillMethod support_pattern = get_support_pattern(infill_extruder.settings.get(support_pattern_key), gcode_layer.getLayerNr());
 
-    const auto zig_zaggify_infill = infill_extruder.settings.get<bool>("zig_zaggify_support");
-    const auto skip_some_zags = infill_extruder.settings.get<bool>("support_skip_some_zags");
-    const auto zag_skip_count = infill_extruder.settings.get<size_t>("support_zag_skip_count");
+    const auto zig_zaggify_infill = infill_extruder.settings.get(zig_zaggify_support_key);
+    const auto skip_some_zags = infill_extruder.settings.get(support_skip_some_zags_key);
+    const auto zag_skip_count = infill_extruder.settings.get(support_zag_skip_count_key);
 
     // create a list of outlines and use PathOrderOptimizer to optimize the travel move
     PathOrderOptimizer<const SupportInfillPart*> island_order_optimizer(gcode_layer.getLastPlannedPositionOrStartingPosition());
@@ -2663,9 +2871,9 @@ bool FffGcodeWriter::processSupportInfill(const SliceDataStorage& storage, Layer
       }
       return area;
     };
-    const auto support_brim_line_count = infill_extruder.settings.get<coord_t>("support_brim_line_count");
-    const auto support_connect_zigzags = infill_extruder.settings.get<bool>("support_connect_zigzags");
-    const auto support_structure = infill_extruder.settings.get<ESupportStructure>("support_structure");
+    const auto support_brim_line_count = infill_extruder.settings.get(support_brim_line_count_key);
+    const auto support_connect_zigzags = infill_extruder.settings.get(support_connect_zigzags_key);
+    const auto support_structure = infill_extruder.settings.get(support_structure_key);
     const Point infill_origin;
 
     constexpr bool use_endpieces = true;
@@ -2735,13 +2943,13 @@ bool FffGcodeWriter::processSupportInfill(const SliceDataStorage& storage, Layer
                                    max_resolution, max_deviation,
                                    wall_count, infill_origin, skip_stitching, support_connect_zigzags,
                                    use_endpieces, skip_some_zags, zag_skip_count, pocket_size);
-                infill_comp.generate(wall_toolpaths_here, support_polygons, support_lines, infill_extruder.settings, storage.support.cross_fill_provider);
+                infill_comp.generate(wall_toolpaths_here, support_polygons, support_lines, infill_extruder.settings, storage.support.cross_fill_provider.get(), nullptr, nullptr, storage.support.infill_cache.get());
             }
 
             setExtruder_addPrime(storage, gcode_layer, extruder_nr); // only switch extruder if we're sure we're going to switch
             gcode_layer.setIsInside(false); // going to print stuff outside print object, i.e. support
 
-            const bool alternate_inset_direction = infill_extruder.settings.get<bool>("material_alternate_walls");
+            const bool alternate_inset_direction = infill_extruder.settings.get(material_alternate_walls_key);
             const bool alternate_layer_print_direction = alternate_inset_direction && gcode_layer.getLayerNr() % 2 == 1;
 
             if(!support_polygons.empty())
@@ -2880,7 +3088,7 @@ bool FffGcodeWriter::addSupportRoofsToGCode(const SliceDataStorage& storage, Lay
     Polygons roof_polygons;
     std::vector<VariableWidthLines> roof_paths;
     Polygons roof_lines;
-    roof_computation.generate(roof_paths, roof_polygons, roof_lines, roof_extruder.settings);
+    roof_computation.generate(roof_paths, roof_polygons, roof_lines, roof_extruder.settings, nullptr, nullptr, nullptr, storage.support.infill_cache.get());
     if ((gcode_layer.getLayerNr() == 0 && wall.empty()) || (gcode_layer.getLayerNr() > 0 && roof_paths.empty() && roof_polygons.empty() && roof_lines.empty()))
     {
         return false; //We didn't create any support roof.
@@ -2962,7 +3170,7 @@ bool FffGcodeWriter::addSupportBottomsToGCode(const SliceDataStorage& storage, L
     Polygons bottom_polygons;
     std::vector<VariableWidthLines> bottom_paths;
     Polygons bottom_lines;
-    bottom_computation.generate(bottom_paths, bottom_polygons, bottom_lines, bottom_extruder.settings);
+    bottom_computation.generate(bottom_paths, bottom_polygons, bottom_lines, bottom_extruder.settings, nullptr, nullptr, nullptr, storage.support.infill_cache.get());
     if (bottom_paths.empty() && bottom_polygons.empty() && bottom_lines.empty())
     {
         return false;
@@ -3076,10 +3284,15 @@ void FffGcodeWriter::finalize()
         extruder_is_used.push_back(gcode.getExtruderIsUsed(extruder_nr));
     }
     std::string prefix = gcode.getFileHeader(extruder_is_used, &print_time, filament_used, material_ids);
+    const std::string padded_prefix = header_position ? gcode.padFileHeader(prefix, header_size) : ""; //Empty if it doesn't fit in the room left for it.
     if (!Application::getInstance().communication->isSequential())
     {
         Application::getInstance().communication->sendGCodePrefix(prefix);
     }
+    else if (!padded_prefix.empty() && output_file.overwrite(*header_position, padded_prefix))
+    {
+        log("Replaced the gcode header with the final one.\n");
+    }
     else
     {
         log("Gcode header after slicing:\n");
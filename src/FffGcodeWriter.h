@@ -4,13 +4,15 @@
 #ifndef GCODE_WRITER_H
 #define GCODE_WRITER_H
 
-#include <fstream>
+#include <memory> //For unique_ptr.
 #include <optional>
 
 #include "FanSpeedLayerTime.h"
 #include "gcodeExport.h"
 #include "LayerPlanBuffer.h"
+#include "PackedMoveStream.h" //To store the moves in binary form.
 #include "settings/PathConfigStorage.h" //For the MeshPathConfigs subclass.
+#include "utils/AsyncOutputFile.h" //To write the g-code file on a separate thread.
 #include "utils/ExtrusionLine.h" //Processing variable-width paths.
 #include "utils/NoCopy.h"
 
@@ -57,8 +59,35 @@ private:
 
     /*!
      * The gcode file to write to when using CuraEngine as command line tool.
+     *
+     * It's written on a separate thread, so that writing the layers doesn't
+     * have to wait for the disk.
+     */
+    AsyncOutputFile output_file;
+
+    /*!
+     * If the moves are stored in binary form, the stream that packs them
+     * before they go to \ref output_file.
+     */
+    std::unique_ptr<PackedMoveStream> packed_output_file;
+
+    /*!
+     * Where the stub header was written in \ref output_file, if it may be
+     * replaced by the final header when the g-code is finalized.
      */
-    std::ofstream output_file;
+    std::optional<size_t> header_position;
+
+    /*!
+     * The size of the region reserved for the header in \ref output_file .
+     * The final header is padded to this size.
+     */
+    size_t header_size;
+
+    /*!
+     * How many bytes to reserve for the final header on top of the stub
+     * header, for the print time, material usage and such.
+     */
+    static constexpr size_t header_reserve = 2048;
 
     /*!
      * For each raft/filler layer, the extruders to be used in that layer in the order in which they are going to be used.
@@ -95,6 +124,10 @@ public:
      * Set the target to write gcode to: to a file.
      * 
      * Used when CuraEngine is used as command line tool.
+     *
+     * If the filename ends in ".gz", the g-code is compressed with gzip while
+     * it's being written. If it ends in ".gpack" (or ".gpack.gz"), the moves
+     * are stored in the binary format of \ref PackedMoveStream.
      * 
      * \param filename The filename of the file to which to write the gcode.
      */
@@ -208,6 +241,8 @@ private:
      * Set temperatures and perform initial priming.
      * 
      * Write a stub header if CuraEngine is in command line tool mode. (Cause writing the header afterwards would entail moving all gcode down.)
+     * If the g-code is written directly to a file, the stub header is padded
+     * to leave room to replace it with the final header in \ref finalize .
      * 
      * \param[in] storage where the slice data is stored.
      * \param[in] start_extruder_nr The extruder with which to start the print.
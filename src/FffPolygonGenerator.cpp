@@ -2,8 +2,11 @@
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
 #include <algorithm>
+#include <cstdlib> //For getenv.
 #include <map> // multimap (ordered map allowing duplicate keys)
 #include <numeric>
+#include <random> //For the fuzzy skin.
+#include <unordered_map> //To find meshes that are copies of each other.
 #include <fstream> // ifstream.good()
 
 #ifdef _OPENMP
@@ -30,10 +33,12 @@
 #include "TopSurface.h"
 #include "TreeSupport.h"
 #include "WallsComputation.h"
+#include "WallToolPathsCache.h"
 #include "infill/DensityProvider.h"
 #include "infill/ImageBasedDensityProvider.h"
 #include "infill/LightningGenerator.h"
 #include "infill/SierpinskiFillProvider.h"
+#include "infill/SierpinskiFillProviderCache.h"
 #include "infill/SubDivCube.h"
 #include "infill/UniformDensityProvider.h"
 #include "progress/Progress.h"
@@ -44,10 +49,16 @@
 #include "settings/types/Angle.h"
 #include "settings/types/LayerIndex.h"
 #include "utils/algorithm.h"
+#include "utils/Cancellation.h"
 #include "utils/gettime.h"
+#include "utils/LayerCompletionTracker.h"
+#include "utils/LayerStatistics.h"
 #include "utils/logoutput.h"
 #include "utils/math.h"
+#include "utils/ParallelSchedule.h"
 #include "utils/Simplify.h"
+#include "utils/SlowestParts.h"
+#include "utils/Trace.h"
 
 
 namespace cura
@@ -60,10 +71,11 @@ bool FffPolygonGenerator::generateAreas(SliceDataStorage& storage, MeshGroup* me
     {
         return false;
     }
+    storage.logMemoryUsage("layer parts");
 
     slices2polygons(storage, timeKeeper);
 
-    return true;
+    return !Cancellation::isRequested();
 }
 
 size_t FffPolygonGenerator::getDraftShieldLayerCount(const size_t total_layers) const
@@ -191,6 +203,29 @@ bool FffPolygonGenerator::sliceModel(MeshGroup* meshgroup, TimeKeeper& timeKeepe
         return true; // This is NOT an error state!
     }
 
+    // The cross fractals of the previous slice may be needed again, but older ones are forgotten.
+    cross_fill_provider_cache.startMeshGroup(Application::getInstance().current_slice->scene.mesh_groups.size());
+
+    // In a long-running session, meshes that were sliced the same way in the previous slice don't need to be sliced again.
+    // With a cache directory, neither do meshes that were sliced the same way in an earlier run.
+    const bool use_slicer_cache = mesh_group_settings.getOrDefault<bool>("cache_mesh_slices", false);
+    if (use_slicer_cache)
+    {
+        slicer_cache.startMeshGroup(Application::getInstance().current_slice->scene.mesh_groups.size());
+        const char* cache_directory = getenv("CURA_ENGINE_CACHE_PATH");
+        slicer_cache.setDirectory((cache_directory && *cache_directory) ? cache_directory : "");
+    }
+    else
+    {
+        slicer_cache.clear();
+    }
+
+    //Plates with many copies of the same part only need to slice one of them. The others get the same layers, moved.
+    const bool use_instancing = mesh_group_settings.getOrDefault<bool>("mesh_instancing", false);
+    std::unordered_map<std::string, std::vector<size_t>> instance_originals; //For each instance key, the meshes that were really sliced.
+    std::vector<std::optional<size_t>> instance_of(meshgroup->meshes.size()); //For each mesh, the mesh that it is a moved copy of, if any.
+    std::vector<Point> instance_offsets(meshgroup->meshes.size(), Point(0, 0));
+
     std::vector<Slicer*> slicerList;
     for(unsigned int mesh_idx = 0; mesh_idx < meshgroup->meshes.size(); mesh_idx++)
     {
@@ -202,7 +237,47 @@ bool FffPolygonGenerator::sliceModel(MeshGroup* meshgroup, TimeKeeper& timeKeepe
         }
 
         Mesh& mesh = meshgroup->meshes[mesh_idx];
-        Slicer* slicer = new Slicer(&mesh, layer_thickness, slice_layer_count, use_variable_layer_heights, adaptive_layer_height_values);
+        Slicer* slicer = nullptr;
+        if (use_instancing)
+        {
+            std::vector<size_t>& originals = instance_originals[SlicerCache::getInstanceKey(mesh)];
+            for (const size_t original_idx : originals)
+            {
+                if (SlicerCache::isTranslatedCopy(mesh, meshgroup->meshes[original_idx], instance_offsets[mesh_idx]))
+                {
+                    logDebug("Mesh %s is a moved copy of mesh %s, so it gets the same layers.\n", mesh.mesh_name.c_str(), meshgroup->meshes[original_idx].mesh_name.c_str());
+                    slicer = new Slicer(&mesh, SlicerCache::getTranslatedLayers(slicerList[original_idx]->layers, instance_offsets[mesh_idx]));
+                    instance_of[mesh_idx] = original_idx;
+                    break;
+                }
+            }
+            if (!slicer)
+            {
+                originals.push_back(mesh_idx);
+            }
+        }
+        if (!slicer && use_slicer_cache)
+        {
+            const std::string cache_key = SlicerCache::getKey(mesh, layer_thickness, slice_layer_count, use_variable_layer_heights ? adaptive_layer_height_values : nullptr);
+            const std::vector<SlicerLayer>* cached_layers = slicer_cache.find(cache_key);
+            if (cached_layers)
+            {
+                log("Reusing the layers of mesh %s from an earlier slice.\n", mesh.mesh_name.c_str());
+                slicer = new Slicer(&mesh, *cached_layers);
+            }
+            else
+            {
+                slicer = new Slicer(&mesh, layer_thickness, slice_layer_count, use_variable_layer_heights, adaptive_layer_height_values);
+                if (!Cancellation::isRequested()) //Otherwise some layers were skipped.
+                {
+                    slicer_cache.insert(cache_key, slicer->layers);
+                }
+            }
+        }
+        else if (!slicer)
+        {
+            slicer = new Slicer(&mesh, layer_thickness, slice_layer_count, use_variable_layer_heights, adaptive_layer_height_values);
+        }
 
         slicerList.push_back(slicer);
 
@@ -216,6 +291,19 @@ bool FffPolygonGenerator::sliceModel(MeshGroup* meshgroup, TimeKeeper& timeKeepe
         */
 
         Progress::messageProgress(Progress::Stage::SLICING, mesh_idx + 1, meshgroup->meshes.size());
+        if (Cancellation::isRequested())
+        {
+            break;
+        }
+    }
+    if (Cancellation::isRequested())
+    {
+        for (Slicer* slicer : slicerList)
+        {
+            delete slicer;
+        }
+        delete adaptive_layer_heights;
+        return false;
     }
 
     // Clear the mesh face and vertex data, it is no longer needed after this point, and it saves a lot of memory.
@@ -257,6 +345,7 @@ bool FffPolygonGenerator::sliceModel(MeshGroup* meshgroup, TimeKeeper& timeKeepe
     storage.support.supportLayers.resize(storage.print_layer_count);
 
     storage.meshes.reserve(slicerList.size()); // causes there to be no resize in meshes so that the pointers in sliceMeshStorage._config to retraction_config don't get invalidated.
+    std::vector<std::optional<size_t>> storage_mesh_indices(slicerList.size()); // The index in the storage of each mesh of the mesh group, if it got one.
     for (unsigned int meshIdx = 0; meshIdx < slicerList.size(); meshIdx++)
     {
         Slicer* slicer = slicerList[meshIdx];
@@ -281,6 +370,12 @@ bool FffPolygonGenerator::sliceModel(MeshGroup* meshgroup, TimeKeeper& timeKeepe
             storage.meshes.pop_back();
             continue;
         }
+        storage_mesh_indices[meshIdx] = storage.meshes.size() - 1;
+        if (instance_of[meshIdx] && storage_mesh_indices[*instance_of[meshIdx]])
+        {
+            meshStorage.instance_of = storage_mesh_indices[*instance_of[meshIdx]];
+            meshStorage.instance_offset = instance_offsets[meshIdx];
+        }
 
         // check one if raft offset is needed
         const bool has_raft = mesh_group_settings.get<EPlatformAdhesion>("adhesion_type") == EPlatformAdhesion::RAFT;
@@ -346,13 +441,6 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
     }
 
     // handle meshes
-    std::vector<double> mesh_timings;
-    for (unsigned int mesh_idx = 0; mesh_idx < storage.meshes.size(); mesh_idx++)
-    {
-        mesh_timings.push_back(1.0); // TODO: have a more accurate estimate of the relative time it takes per mesh, based on the height and number of polygons
-    }
-    ProgressStageEstimator inset_skin_progress_estimate(mesh_timings);
-
     Progress::messageProgressStage(Progress::Stage::INSET_SKIN, &time_keeper);
     std::vector<size_t> mesh_order;
     { // compute mesh order
@@ -366,10 +454,31 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
             mesh_order.push_back(order_and_mesh_idx.second);
         }
     }
+    // Process consecutive meshes in batches, so that plates with many small meshes keep all threads busy.
+    // An infill mesh is limited to the infill of the meshes before it in the order, so it has to wait for those to be finished and starts a new batch.
+    std::vector<size_t> batch_starts; // The index in mesh_order where each batch starts, followed by the end of the last batch.
     for (size_t mesh_order_idx = 0; mesh_order_idx < mesh_order.size(); ++mesh_order_idx)
     {
-        processBasicWallsSkinInfill(storage, mesh_order_idx, mesh_order, inset_skin_progress_estimate);
-        Progress::messageProgress(Progress::Stage::INSET_SKIN, mesh_order_idx + 1, storage.meshes.size());
+        if (mesh_order_idx == 0 || storage.meshes[mesh_order[mesh_order_idx]].settings.get<bool>("infill_mesh"))
+        {
+            batch_starts.push_back(mesh_order_idx);
+        }
+    }
+    batch_starts.push_back(mesh_order.size());
+    std::vector<double> batch_timings;
+    for (size_t batch_idx = 0; batch_idx + 1 < batch_starts.size(); batch_idx++)
+    {
+        batch_timings.push_back(batch_starts[batch_idx + 1] - batch_starts[batch_idx]); // TODO: have a more accurate estimate of the relative time it takes per mesh, based on the height and number of polygons
+    }
+    ProgressStageEstimator inset_skin_progress_estimate(batch_timings);
+    for (size_t batch_idx = 0; batch_idx + 1 < batch_starts.size(); batch_idx++)
+    {
+        processBasicWallsSkinInfill(storage, batch_starts[batch_idx], batch_starts[batch_idx + 1], mesh_order, inset_skin_progress_estimate);
+        Progress::messageProgress(Progress::Stage::INSET_SKIN, batch_starts[batch_idx + 1], storage.meshes.size());
+    }
+    if (Cancellation::isRequested())
+    {
+        return;
     }
 
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
@@ -380,17 +489,28 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
 
         removeEmptyFirstLayers(storage, storage.print_layer_count); // changes storage.print_layer_count!
     }
+    storage.invalidateLayerOutlines(); // The walls changed the print outlines of the parts.
 
     log("Layer count: %i\n", storage.print_layer_count);
+    storage.logMemoryUsage("walls and skin");
 
     //layerparts2HTML(storage, "output/output.html");
 
     Progress::messageProgressStage(Progress::Stage::SUPPORT, &time_keeper);
 
-    AreaSupport::generateOverhangAreas(storage);
-    AreaSupport::generateSupportAreas(storage);
+    {
+        TraceZone zone("support");
+        AreaSupport::generateOverhangAreas(storage);
+        AreaSupport::generateSupportAreas(storage, cross_fill_provider_cache);
+    }
     TreeSupport tree_support_generator(storage);
     tree_support_generator.generateSupportAreas(storage);
+    storage.invalidateLayerOutlines(); // Outlines including support are different now.
+    storage.logMemoryUsage("support");
+    if (Cancellation::isRequested())
+    {
+        return;
+    }
 
     // we need to remove empty layers after we have processed the insets
     // processInsets might throw away parts if they have no wall at all (cause it doesn't fit)
@@ -400,6 +520,7 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
     if (mesh_group_settings.get<bool>("remove_empty_first_layers"))
     {
         removeEmptyFirstLayers(storage, storage.print_layer_count); // changes storage.print_layer_count!
+        storage.invalidateLayerOutlines(); // The layer numbers shifted.
     }
     if (storage.print_layer_count == 0)
     {
@@ -413,6 +534,7 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
     storage.primeTower.generateGroundpoly();
     storage.primeTower.generatePaths(storage);
     storage.primeTower.subtractFromSupport(storage);
+    storage.invalidateLayerOutlines(); // The prime tower is there now, and the support has been cut away around it.
 
     logDebug("Processing ooze shield\n");
     processOozeShield(storage);
@@ -426,6 +548,7 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
     {
         log("Processing platform adhesion\n");
         processPlatformAdhesion(storage);
+        storage.invalidateLayerOutlines(); // The raft outline has been generated.
     }
 
     logDebug("Meshes post-processing\n");
@@ -438,115 +561,400 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
     logDebug("Processing gradual support\n");
     // generate gradual support
     AreaSupport::generateSupportInfillFeatures(storage);
+
+    if (mesh_group_settings.getOrDefault<bool>("compact_wall_toolpaths", false))
+    {
+        logDebug("Compacting wall toolpaths\n");
+        for (SliceMeshStorage& mesh : storage.meshes)
+        {
+            std::vector<size_t> line_counts(mesh.layers.size(), 0);
+            for (size_t layer_nr = 0; layer_nr < mesh.layers.size(); layer_nr++)
+            {
+                for (const SliceLayerPart& part : mesh.layers[layer_nr].parts)
+                {
+                    for (const VariableWidthLines& lines : part.wall_toolpaths)
+                    {
+                        line_counts[layer_nr] += lines.size();
+                    }
+                }
+            }
+            ParallelSchedule("compact wall toolpaths", line_counts).run([&](const size_t layer_nr)
+            {
+                for (SliceLayerPart& part : mesh.layers[layer_nr].parts)
+                {
+                    part.compactWallToolpaths();
+                }
+            });
+        }
+    }
+    recordLayerStatistics(storage);
+    const std::string spill_directory = mesh_group_settings.getOrDefault<std::string>("slice_data_spill_directory", "");
+    if (!spill_directory.empty())
+    {
+        logDebug("Moving wall toolpaths to a scratch file\n");
+        storage.spillWallToolpaths(spill_directory);
+    }
+    storage.logMemoryUsage("slicing");
 }
 
-void FffPolygonGenerator::processBasicWallsSkinInfill(SliceDataStorage& storage, const size_t mesh_order_idx, const std::vector<size_t>& mesh_order, ProgressStageEstimator& inset_skin_progress_estimate)
+namespace
 {
-    size_t mesh_idx = mesh_order[mesh_order_idx];
-    SliceMeshStorage& mesh = storage.meshes[mesh_idx];
-    size_t mesh_layer_count = mesh.layers.size();
-    if (mesh.settings.get<bool>("infill_mesh"))
+
+/*!
+ * What the skin and infill of the layers of one mesh wait for.
+ *
+ * The skin of a layer reads the outlines of the layers up to a few layers
+ * above and below it. Those outlines are final once the walls of those layers
+ * are generated, so the skin can start then, while the walls of other layers
+ * are still being generated.
+ */
+struct MeshWallsSkinSchedule
+{
+    SliceMeshStorage* mesh;
+    bool process_infill; //!< Whether to generate the infill areas of this mesh.
+    size_t max_initial_bottom_layer_count; //!< With spiralize, only the skin of this many layers is generated.
+    size_t layers_below; //!< How many layers below a layer its skin reads the outlines of.
+    size_t layers_above; //!< How many layers above a layer its skin reads the outlines of.
+    std::unique_ptr<WallToolPathsCache> wall_toolpaths_cache; //!< Prismatic models have the same outline on many layers. Generate the walls for those only once.
+    std::unique_ptr<LayerCompletionTracker> walls; //!< Which layers have all of their walls, with the parts without walls removed.
+    std::unique_ptr<LayerOutlineIntersections> intersections_above; //!< Intersections of the outlines above, if they are precomputed for this mesh.
+    std::unique_ptr<LayerOutlineIntersections> intersections_below; //!< Intersections of the outlines below, if they are precomputed for this mesh.
+    std::unique_ptr<LayerCompletionTracker> blocks_above; //!< Which blocks of \ref intersections_above are computed.
+    std::unique_ptr<LayerCompletionTracker> blocks_below; //!< Which blocks of \ref intersections_below are computed.
+    const MeshWallsSkinSchedule* original; //!< If the mesh is a moved copy of an earlier mesh in the same batch, the schedule of that mesh. Its walls are copied from there.
+};
+
+/*!
+ * Whether two outlines are the same, except that one is moved.
+ */
+bool isTranslated(const Polygons& original, const Point offset, const Polygons& moved)
+{
+    if (original.size() != moved.size())
     {
-        processInfillMesh(storage, mesh_order_idx, mesh_order);
+        return false;
+    }
+    for (size_t poly_idx = 0; poly_idx < original.size(); poly_idx++)
+    {
+        ConstPolygonRef original_polygon = original[poly_idx];
+        ConstPolygonRef moved_polygon = moved[poly_idx];
+        if (original_polygon.size() != moved_polygon.size())
+        {
+            return false;
+        }
+        for (size_t point_idx = 0; point_idx < original_polygon.size(); point_idx++)
+        {
+            if (original_polygon[point_idx] + offset != moved_polygon[point_idx])
+            {
+                return false;
+            }
+        }
     }
+    return true;
+}
 
-    // TODO: make progress more accurate!!
-    // note: estimated time for     insets : skins = 22.953 : 48.858
-    std::vector<double> walls_vs_skin_timing({22.953, 48.858});
-    ProgressStageEstimator* mesh_inset_skin_progress_estimator = new ProgressStageEstimator(walls_vs_skin_timing);
+/*!
+ * Copy the walls of a part of a mesh that is a moved copy of another mesh, from
+ * the part with the same outline in the same layer of that mesh.
+ *
+ * The walls of that layer must be finished.
+ * \param original_layer The layer of the mesh that this mesh is a copy of.
+ * \param offset How far this mesh is moved from that mesh.
+ * \param part The part to get the walls for.
+ * \return Whether there was a part with the same outline to copy from. If
+ * not, the walls need to be generated.
+ */
+bool copyInstanceWalls(const SliceLayer& original_layer, const Point offset, SliceLayerPart& part)
+{
+    for (const SliceLayerPart& original_part : original_layer.parts)
+    {
+        if (!isTranslated(original_part.outline, offset, part.outline))
+        {
+            continue;
+        }
+        part.wall_toolpaths = original_part.wall_toolpaths;
+        for (VariableWidthLines& inset : part.wall_toolpaths)
+        {
+            for (ExtrusionLine& line : inset)
+            {
+                for (ExtrusionJunction& junction : line.junctions)
+                {
+                    junction.p += offset;
+                }
+            }
+        }
+        part.inner_area = original_part.inner_area;
+        part.inner_area.translate(offset);
+        part.print_outline = part.outline;
+        return true;
+    }
+    return false; //Parts without walls were removed there, or the outline changed after slicing, e.g. by carving.
+}
+
+/*!
+ * Prepare to compute blocks of outline intersections once their layers have
+ * their walls. Blocks that only consist of empty layers are computed now.
+ */
+std::unique_ptr<LayerCompletionTracker> trackIntersectionBlocks(LayerOutlineIntersections& intersections, const LayerCompletionTracker& walls, const size_t layer_count)
+{
+    const size_t block_size = intersections.getBlockSize();
+    std::vector<size_t> incomplete_layer_counts(intersections.getBlockCount(), 0);
+    for (size_t layer_nr = 0; layer_nr < layer_count; layer_nr++)
+    {
+        if (!walls.isComplete(layer_nr, layer_nr))
+        {
+            incomplete_layer_counts[layer_nr / block_size]++;
+        }
+    }
+    for (size_t block_idx = 0; block_idx < incomplete_layer_counts.size(); block_idx++)
+    {
+        if (incomplete_layer_counts[block_idx] == 0)
+        {
+            intersections.computeBlock(block_idx);
+        }
+    }
+    return std::make_unique<LayerCompletionTracker>(incomplete_layer_counts);
+}
+
+/*!
+ * Called by the thread that generated the last walls of a layer, to make the
+ * outline of the layer final and let the skins that depend on it start.
+ */
+void finishWallsOfLayer(MeshWallsSkinSchedule& schedule, const size_t layer_nr)
+{
+    WallsComputation walls_computation(schedule.mesh->settings, layer_nr);
+    walls_computation.removePartsWithoutWalls(&schedule.mesh->layers[layer_nr]);
+    schedule.walls->complete(layer_nr);
+
+    const std::pair<LayerOutlineIntersections*, LayerCompletionTracker*> intersection_blocks[2] = {
+        { schedule.intersections_above.get(), schedule.blocks_above.get() },
+        { schedule.intersections_below.get(), schedule.blocks_below.get() }
+    };
+    for (const std::pair<LayerOutlineIntersections*, LayerCompletionTracker*>& intersections_and_blocks : intersection_blocks)
+    {
+        if (!intersections_and_blocks.first)
+        {
+            continue;
+        }
+        const size_t block_idx = layer_nr / intersections_and_blocks.first->getBlockSize();
+        if (intersections_and_blocks.second->finishItem(block_idx)) //That was the last layer of the block.
+        {
+            if (!Cancellation::isRequested())
+            {
+                intersections_and_blocks.first->computeBlock(block_idx);
+            }
+            intersections_and_blocks.second->complete(block_idx);
+        }
+    }
+}
 
-    inset_skin_progress_estimate.nextStage(mesh_inset_skin_progress_estimator); // the stage of this function call
+/*!
+ * Wait until the skin of a layer can be generated.
+ */
+void waitForSkinInputs(const MeshWallsSkinSchedule& schedule, const size_t layer_nr)
+{
+    const size_t first_layer_nr = layer_nr - std::min(layer_nr, schedule.layers_below);
+    const size_t last_layer_nr = layer_nr + schedule.layers_above;
+    schedule.walls->waitUntilComplete(first_layer_nr, last_layer_nr);
+    if (schedule.intersections_above)
+    {
+        const size_t block_size = schedule.intersections_above->getBlockSize();
+        schedule.blocks_above->waitUntilComplete(first_layer_nr / block_size, last_layer_nr / block_size);
+    }
+    if (schedule.intersections_below)
+    {
+        const size_t block_size = schedule.intersections_below->getBlockSize();
+        schedule.blocks_below->waitUntilComplete(first_layer_nr / block_size, last_layer_nr / block_size);
+    }
+}
 
-    ProgressEstimatorLinear* inset_estimator = new ProgressEstimatorLinear(mesh_layer_count);
-    mesh_inset_skin_progress_estimator->nextStage(inset_estimator);
+} //Anonymous namespace.
 
+void FffPolygonGenerator::processBasicWallsSkinInfill(SliceDataStorage& storage, const size_t first_mesh_order_idx, const size_t end_mesh_order_idx, const std::vector<size_t>& mesh_order, ProgressStageEstimator& inset_skin_progress_estimate)
+{
+    if (storage.meshes[mesh_order[first_mesh_order_idx]].settings.get<bool>("infill_mesh"))
+    {
+        processInfillMesh(storage, first_mesh_order_idx, mesh_order);
+    }
 
-    // walls
-    size_t processed_layer_count = 0;
-#pragma omp parallel for default(none) shared(mesh_layer_count, storage, mesh, inset_skin_progress_estimate, processed_layer_count) schedule(dynamic)
-    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
-    for (int layer_number = 0; layer_number < static_cast<int>(mesh.layers.size()); layer_number++)
+    const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
+    const Scene& scene = Application::getInstance().current_slice->scene;
+    const size_t batch_size = end_mesh_order_idx - first_mesh_order_idx;
+
+    // The walls of all parts of all layers are independent of each other, so process them in one loop. Otherwise a layer with many small parts, or a mesh with few layers, runs on few cores.
+    // The skin and infill of layers are processed in the same loop, after all walls, as soon as the walls they depend on are done.
+    struct WallPart
     {
-        logDebug("Processing insets for layer %i of %i\n", layer_number, mesh_layer_count);
-        processWalls(mesh, layer_number);
-#ifdef _OPENMP
-        if (omp_get_thread_num() == 0)
-#endif
-        { // progress estimation is done only in one thread so that no two threads message progress at the same time
-            int _processed_layer_count;
-#if _OPENMP < 201107
-#pragma omp critical
-#else
-#pragma omp atomic read
-#endif
-                _processed_layer_count = processed_layer_count;
-            double progress = inset_skin_progress_estimate.progress(_processed_layer_count);
-            Progress::messageProgress(Progress::Stage::INSET_SKIN, progress * 100, 100);
+        size_t batch_idx;
+        size_t layer_nr;
+        size_t part_idx;
+    };
+    std::vector<WallPart> wall_parts;
+    std::vector<std::pair<size_t, size_t>> skin_layers; // The index in the batch and layer number of each layer of each mesh.
+    std::vector<MeshWallsSkinSchedule> schedules(batch_size);
+    for (size_t batch_idx = 0; batch_idx < batch_size; batch_idx++)
+    {
+        const size_t mesh_order_idx = first_mesh_order_idx + batch_idx;
+        const size_t mesh_idx = mesh_order[mesh_order_idx];
+        SliceMeshStorage& mesh = storage.meshes[mesh_idx];
+        MeshWallsSkinSchedule& schedule = schedules[batch_idx];
+        schedule.mesh = &mesh;
+
+        std::vector<size_t> part_counts(mesh.layers.size());
+        for (size_t layer_nr = 0; layer_nr < mesh.layers.size(); layer_nr++)
+        {
+            part_counts[layer_nr] = mesh.layers[layer_nr].parts.size();
+            for (size_t part_idx = 0; part_idx < mesh.layers[layer_nr].parts.size(); part_idx++)
+            {
+                wall_parts.push_back(WallPart{ batch_idx, layer_nr, part_idx });
+            }
         }
-#pragma omp atomic
-        processed_layer_count++;
-    }
+        schedule.wall_toolpaths_cache = std::make_unique<WallToolPathsCache>();
+        schedule.walls = std::make_unique<LayerCompletionTracker>(part_counts);
 
-    ProgressEstimatorLinear* skin_estimator = new ProgressEstimatorLinear(mesh_layer_count);
-    mesh_inset_skin_progress_estimator->nextStage(skin_estimator);
+        schedule.process_infill = mesh.settings.get<coord_t>("infill_line_distance") > 0;
+        if (!schedule.process_infill)
+        { // do process infill anyway if it's modified by modifier meshes
+            for (size_t other_mesh_order_idx = mesh_order_idx + 1; other_mesh_order_idx < mesh_order.size(); ++other_mesh_order_idx)
+            {
+                const size_t other_mesh_idx = mesh_order[other_mesh_order_idx];
+                const SliceMeshStorage& other_mesh = storage.meshes[other_mesh_idx];
+                if (other_mesh.settings.get<bool>("infill_mesh"))
+                {
+                    AABB3D aabb = scene.current_mesh_group->meshes[mesh_idx].getAABB();
+                    AABB3D other_aabb = scene.current_mesh_group->meshes[other_mesh_idx].getAABB();
+                    if (aabb.hit(other_aabb))
+                    {
+                        schedule.process_infill = true;
+                    }
+                }
+            }
+        }
 
-    bool process_infill = mesh.settings.get<coord_t>("infill_line_distance") > 0;
-    if (!process_infill)
-    { // do process infill anyway if it's modified by modifier meshes
-        const Scene& scene = Application::getInstance().current_slice->scene;
-        for (size_t other_mesh_order_idx = mesh_order_idx + 1; other_mesh_order_idx < mesh_order.size(); ++other_mesh_order_idx)
+        schedule.max_initial_bottom_layer_count = 0;
+        if (mesh_group_settings.get<bool>("magic_spiralize"))
         {
-            const size_t other_mesh_idx = mesh_order[other_mesh_order_idx];
-            SliceMeshStorage& other_mesh = storage.meshes[other_mesh_idx];
-            if (other_mesh.settings.get<bool>("infill_mesh"))
+            schedule.max_initial_bottom_layer_count = mesh.settings.get<size_t>("initial_bottom_layers");
+        }
+
+        // The bottom skin looks down to the bottom layers, the top skin and roofing up to the top layers, and the flooring and top surface one layer further.
+        const size_t top_layer_count = mesh.settings.get<size_t>("top_layers");
+        const size_t bottom_layer_count = mesh.settings.get<size_t>("bottom_layers");
+        schedule.layers_above = std::max(top_layer_count, size_t(1));
+        schedule.layers_below = std::max(bottom_layer_count, size_t(1));
+
+        //With many top/bottom layers, intersect the outlines of the layers above and below in one go instead of separately for every layer.
+        if (!mesh_group_settings.get<bool>("magic_spiralize") && !mesh.settings.get<bool>("skin_no_small_gaps_heuristic") && mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") != ESurfaceMode::SURFACE)
+        {
+            constexpr size_t min_window_size = 4; //For fewer layers it's not faster than intersecting them for every layer.
+            constexpr bool compute_now = false; //Each block is computed once its layers have their walls.
+            if (top_layer_count >= min_window_size)
+            {
+                schedule.intersections_above = std::make_unique<LayerOutlineIntersections>(mesh, top_layer_count, compute_now);
+                schedule.blocks_above = trackIntersectionBlocks(*schedule.intersections_above, *schedule.walls, mesh.layers.size());
+            }
+            if (bottom_layer_count >= min_window_size)
+            {
+                schedule.intersections_below = std::make_unique<LayerOutlineIntersections>(mesh, bottom_layer_count, compute_now);
+                schedule.blocks_below = trackIntersectionBlocks(*schedule.intersections_below, *schedule.walls, mesh.layers.size());
+            }
+        }
+
+        for (size_t layer_nr = 0; layer_nr < mesh.layers.size(); layer_nr++)
+        {
+            skin_layers.emplace_back(batch_idx, layer_nr);
+        }
+
+        //The walls of the mesh it's a copy of are handed out earlier, so they are always being generated by the time this mesh waits for them.
+        schedule.original = nullptr;
+        if (mesh.instance_of && !mesh_group_settings.get<bool>("magic_spiralize"))
+        {
+            for (size_t original_batch_idx = 0; original_batch_idx < batch_idx; original_batch_idx++)
             {
-                AABB3D aabb = scene.current_mesh_group->meshes[mesh_idx].getAABB();
-                AABB3D other_aabb = scene.current_mesh_group->meshes[other_mesh_idx].getAABB();
-                if (aabb.hit(other_aabb))
+                if (schedules[original_batch_idx].mesh == &storage.meshes[*mesh.instance_of])
                 {
-                    process_infill = true;
+                    schedule.original = &schedules[original_batch_idx];
+                    break;
                 }
             }
         }
     }
-    // skin & infill
 
-    const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
-    size_t mesh_max_initial_bottom_layer_count = 0;
-    if (mesh_group_settings.get<bool>("magic_spiralize"))
-    {
-        mesh_max_initial_bottom_layer_count = std::max(mesh_max_initial_bottom_layer_count, mesh.settings.get<size_t>("initial_bottom_layers"));
-    }
+    // TODO: make progress more accurate!!
+    const size_t item_count = wall_parts.size() + skin_layers.size();
+    inset_skin_progress_estimate.nextStage(new ProgressEstimatorLinear(item_count)); // the stage of this function call
 
-    processed_layer_count = 0;
-#pragma omp parallel default(none) shared(mesh_layer_count, mesh, mesh_max_initial_bottom_layer_count, process_infill, inset_skin_progress_estimate, processed_layer_count, mesh_group_settings)
+    // The items are handed out in order, so all walls are being generated by some thread before any skin waits for them.
+    size_t next_item_idx = 0;
+    size_t processed_item_count = 0;
+#pragma omp parallel default(none) shared(mesh_group_settings, inset_skin_progress_estimate, wall_parts, skin_layers, schedules, item_count, next_item_idx, processed_item_count)
     {
-
-#pragma omp for schedule(dynamic)
-        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
-        for (int layer_number = 0; layer_number < static_cast<int>(mesh.layers.size()); layer_number++)
+        while (true)
         {
-            logDebug("Processing skins and infill layer %i of %i\n", layer_number, mesh_layer_count);
-            if (!mesh_group_settings.get<bool>("magic_spiralize") || layer_number < static_cast<int>(mesh_max_initial_bottom_layer_count))    //Only generate up/downskin and infill for the first X layers when spiralize is choosen.
+            size_t item_idx;
+#if _OPENMP < 201107
+#pragma omp critical
+#else
+#pragma omp atomic capture
+#endif
+            item_idx = next_item_idx++;
+            if (item_idx >= item_count)
             {
-                processSkinsAndInfill(mesh, layer_number, process_infill);
+                break;
+            }
+
+            if (item_idx < wall_parts.size())
+            {
+                const WallPart& wall_part = wall_parts[item_idx];
+                MeshWallsSkinSchedule& schedule = schedules[wall_part.batch_idx];
+                logDebug("Processing insets for part %i of layer %i of %i of mesh %s\n", int(wall_part.part_idx), int(wall_part.layer_nr), int(schedule.mesh->layers.size()), schedule.mesh->mesh_name.c_str());
+                SliceLayerPart& part = schedule.mesh->layers[wall_part.layer_nr].parts[wall_part.part_idx];
+                bool is_copied = false;
+                if (schedule.original && wall_part.layer_nr < schedule.original->mesh->layers.size())
+                {
+                    schedule.original->walls->waitUntilComplete(wall_part.layer_nr, wall_part.layer_nr);
+                    is_copied = copyInstanceWalls(schedule.original->mesh->layers[wall_part.layer_nr], schedule.mesh->instance_offset, part);
+                }
+                if (!is_copied && !Cancellation::isRequested()) // When cancelled, the layers are still finished, so that no skin waits for them forever.
+                {
+                    processWalls(*schedule.mesh, wall_part.layer_nr, wall_part.part_idx, *schedule.wall_toolpaths_cache);
+                }
+                if (schedule.walls->finishItem(wall_part.layer_nr))
+                {
+                    finishWallsOfLayer(schedule, wall_part.layer_nr);
+                }
+            }
+            else
+            {
+                const size_t batch_idx = skin_layers[item_idx - wall_parts.size()].first;
+                const int layer_number = skin_layers[item_idx - wall_parts.size()].second;
+                const MeshWallsSkinSchedule& schedule = schedules[batch_idx];
+                logDebug("Processing skins and infill layer %i of %i of mesh %s\n", layer_number, int(schedule.mesh->layers.size()), schedule.mesh->mesh_name.c_str());
+                if (Cancellation::isRequested())
+                {
+                    continue;
+                }
+                if (!mesh_group_settings.get<bool>("magic_spiralize") || layer_number < static_cast<int>(schedule.max_initial_bottom_layer_count))    //Only generate up/downskin and infill for the first X layers when spiralize is choosen.
+                {
+                    waitForSkinInputs(schedule, layer_number);
+                    processSkinsAndInfill(*schedule.mesh, layer_number, schedule.process_infill, schedule.intersections_above.get(), schedule.intersections_below.get());
+                }
             }
 #ifdef _OPENMP
             if (omp_get_thread_num() == 0)
 #endif
             { // progress estimation is done only in one thread so that no two threads message progress at the same time
-                int _processed_layer_count;
+                size_t _processed_item_count;
 #if _OPENMP < 201107
 #pragma omp critical
 #else
 #pragma omp atomic read
 #endif
-                    _processed_layer_count = processed_layer_count;
-                double progress = inset_skin_progress_estimate.progress(_processed_layer_count);
+                    _processed_item_count = processed_item_count;
+                double progress = inset_skin_progress_estimate.progress(_processed_item_count);
                 Progress::messageProgress(Progress::Stage::INSET_SKIN, progress * 100, 100);
             }
 #pragma omp atomic
-                processed_layer_count++;
+            processed_item_count++;
         }
     }
 }
@@ -598,12 +1006,9 @@ void FffPolygonGenerator::processInfillMesh(SliceDataStorage& storage, const siz
             {
                 if (mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") != ESurfaceMode::SURFACE)
                 {
-                    for (SliceLayerPart& part : layer.parts)
+                    for (const size_t part_idx : layer.getPartsOverlapping(other_part.boundaryBox))
                     { // limit the outline of each part of this infill mesh to the infill of parts of the other mesh with lower infill mesh order
-                        if (!part.boundaryBox.hit(other_part.boundaryBox))
-                        { // early out
-                            continue;
-                        }
+                        const SliceLayerPart& part = layer.parts[part_idx];
                         Polygons new_outline = part.outline.intersection(other_part.getOwnInfillArea());
                         if (new_outline.size() == 1)
                         { // we don't have to call splitIntoParts, because a single polygon can only be a single part
@@ -642,10 +1047,11 @@ void FffPolygonGenerator::processInfillMesh(SliceDataStorage& storage, const siz
         layer.parts.clear();
         for (PolygonsPart& part : new_parts)
         {
-            layer.parts.emplace_back();
+            layer.parts.emplace_back(layer.getMemoryResource());
             layer.parts.back().outline = part;
             layer.parts.back().boundaryBox.calculate(part);
         }
+        layer.indexParts();
 
         if (mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") != ESurfaceMode::NORMAL)
         {
@@ -689,7 +1095,7 @@ void FffPolygonGenerator::processDerivedWallsSkinInfill(SliceMeshStorage& mesh)
         std::ifstream cross_fs(cross_subdivision_spec_image_file.c_str());
         if (!cross_subdivision_spec_image_file.empty() && cross_fs.good())
         {
-            mesh.cross_fill_provider = new SierpinskiFillProvider(mesh.bounding_box, mesh.settings.get<coord_t>("infill_line_distance"), mesh.settings.get<coord_t>("infill_line_width"), cross_subdivision_spec_image_file);
+            mesh.cross_fill_provider = cross_fill_provider_cache.get(mesh.bounding_box, mesh.settings.get<coord_t>("infill_line_distance"), mesh.settings.get<coord_t>("infill_line_width"), cross_subdivision_spec_image_file);
         }
         else
         {
@@ -697,7 +1103,7 @@ void FffPolygonGenerator::processDerivedWallsSkinInfill(SliceMeshStorage& mesh)
             {
                 logError("Cannot find density image \'%s\'.", cross_subdivision_spec_image_file.c_str());
             }
-            mesh.cross_fill_provider = new SierpinskiFillProvider(mesh.bounding_box, mesh.settings.get<coord_t>("infill_line_distance"), mesh.settings.get<coord_t>("infill_line_width"));
+            mesh.cross_fill_provider = cross_fill_provider_cache.get(mesh.bounding_box, mesh.settings.get<coord_t>("infill_line_distance"), mesh.settings.get<coord_t>("infill_line_width"), "");
         }
     }
 
@@ -719,23 +1125,26 @@ void FffPolygonGenerator::processDerivedWallsSkinInfill(SliceMeshStorage& mesh)
 }
 
 /*
- * This function is executed in a parallel region based on layer_nr.
+ * This function is executed in a parallel region over the parts of all layers.
  * When modifying make sure any changes does not introduce data races.
  *
- * processInsets only reads and writes data for the current layer
+ * processWalls only reads and writes data for the current part
  */
-void FffPolygonGenerator::processWalls(SliceMeshStorage& mesh, size_t layer_nr)
+void FffPolygonGenerator::processWalls(SliceMeshStorage& mesh, size_t layer_nr, size_t part_idx, WallToolPathsCache& cache)
 {
-    SliceLayer* layer = &mesh.layers[layer_nr];
-    WallsComputation walls_computation(mesh.settings, layer_nr);
-    walls_computation.generateWalls(layer);
+    TraceZone zone("walls", layer_nr);
+    SliceLayerPart& part = mesh.layers[layer_nr].parts[part_idx];
+    PartZone part_zone("walls", layer_nr, mesh.mesh_name.c_str(), part_idx, &part.outline);
+    WallsComputation walls_computation(mesh.settings, layer_nr, &cache);
+    walls_computation.generateWalls(&part);
 }
 
 bool FffPolygonGenerator::isEmptyLayer(SliceDataStorage& storage, const unsigned int layer_idx)
 {
     if (storage.support.generated && layer_idx < storage.support.supportLayers.size())
     {
-        SupportLayer& support_layer = storage.support.supportLayers[layer_idx];
+        const SparseLayerVector<SupportLayer>& support_layers = storage.support.supportLayers; //Only reading, so that empty layers aren't allocated.
+        const SupportLayer& support_layer = support_layers[layer_idx];
         if (!support_layer.support_infill_parts.empty() || !support_layer.support_bottom.empty() || !support_layer.support_roof.empty())
         {
             return false;
@@ -798,8 +1207,7 @@ void FffPolygonGenerator::removeEmptyFirstLayers(SliceDataStorage& storage, size
         }
         total_layers -= n_empty_first_layers;
         storage.support.layer_nr_max_filled_layer -= n_empty_first_layers;
-        std::vector<SupportLayer>& support_layers = storage.support.supportLayers;
-        support_layers.erase(support_layers.begin(), support_layers.begin() + n_empty_first_layers);
+        storage.support.supportLayers.eraseFront(n_empty_first_layers);
     }
 }
 
@@ -813,14 +1221,16 @@ void FffPolygonGenerator::removeEmptyFirstLayers(SliceDataStorage& storage, size
  * processSkinsAndInfill read (depend on) mesh.layers[*].parts[*].{insets,boundingBox}.
  *                       write mesh.layers[n].parts[*].{skin_parts,infill_area}.
  */
-void FffPolygonGenerator::processSkinsAndInfill(SliceMeshStorage& mesh, const LayerIndex layer_nr, bool process_infill)
+void FffPolygonGenerator::processSkinsAndInfill(SliceMeshStorage& mesh, const LayerIndex layer_nr, bool process_infill, const LayerOutlineIntersections* layers_above, const LayerOutlineIntersections* layers_below)
 {
     if (mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") == ESurfaceMode::SURFACE)
     {
         return;
     }
 
-    SkinInfillAreaComputation skin_infill_area_computation(layer_nr, mesh, process_infill);
+    TraceZone zone("skin and infill areas", layer_nr);
+    PartZone part_zone("skin and infill areas", layer_nr, mesh.mesh_name.c_str());
+    SkinInfillAreaComputation skin_infill_area_computation(layer_nr, mesh, process_infill, layers_above, layers_below);
     skin_infill_area_computation.generateSkinsAndInfill();
 
     if (mesh.settings.get<bool>("ironing_enabled") && (!mesh.settings.get<bool>("ironing_only_highest_layer") || mesh.layer_nr_max_filled_layer == layer_nr))
@@ -914,6 +1324,60 @@ void FffPolygonGenerator::computePrintHeightStatistics(SliceDataStorage& storage
 }
 
 
+void FffPolygonGenerator::recordLayerStatistics(const SliceDataStorage& storage)
+{
+    if (!LayerStatistics::isEnabled())
+    {
+        return;
+    }
+    for (const SliceMeshStorage& mesh : storage.meshes)
+    {
+        for (size_t layer_nr = 0; layer_nr < mesh.layers.size(); layer_nr++)
+        {
+            const SliceLayer& layer = mesh.layers[layer_nr];
+            size_t polygon_count = 0;
+            for (const SliceLayerPart& part : layer.parts)
+            {
+                polygon_count += part.outline.size();
+            }
+            LayerStatistics::add("polygons", layer_nr, polygon_count);
+            LayerStatistics::add("slice data bytes", layer_nr, layer.getMemoryUsage().total());
+        }
+    }
+    for (size_t layer_nr = 0; layer_nr < storage.support.supportLayers.size(); layer_nr++)
+    {
+        if (storage.support.supportLayers.isAllocated(layer_nr))
+        {
+            LayerStatistics::add("slice data bytes", layer_nr, storage.support.supportLayers[layer_nr].getMemoryUsage());
+        }
+    }
+}
+
+namespace
+{
+
+/*!
+ * Count the parts of all meshes on each layer, as a quick estimate of how long
+ * it takes to get the outlines of the layers.
+ * \param storage The slice data with the layer parts of the meshes.
+ * \param layer_count The number of layers to count the parts of.
+ * \return For each layer, the number of parts of all meshes together.
+ */
+std::vector<size_t> getPartCounts(const SliceDataStorage& storage, const int layer_count)
+{
+    std::vector<size_t> part_counts(std::max(0, layer_count), 0);
+    for (const SliceMeshStorage& mesh : storage.meshes)
+    {
+        for (size_t layer_nr = 0; layer_nr < std::min(part_counts.size(), mesh.layers.size()); layer_nr++)
+        {
+            part_counts[layer_nr] += mesh.layers[layer_nr].parts.size();
+        }
+    }
+    return part_counts;
+}
+
+} //Anonymous namespace.
+
 void FffPolygonGenerator::processOozeShield(SliceDataStorage& storage)
 {
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
@@ -924,17 +1388,22 @@ void FffPolygonGenerator::processOozeShield(SliceDataStorage& storage)
 
     const coord_t ooze_shield_dist = mesh_group_settings.get<coord_t>("ooze_shield_dist");
 
-    for (int layer_nr = 0; layer_nr <= storage.max_print_height_second_to_last_extruder; layer_nr++)
+    const int layer_count = storage.max_print_height_second_to_last_extruder + 1;
+    storage.oozeShield.resize(std::max(layer_count, 0));
+    const std::vector<size_t> part_counts = getPartCounts(storage, layer_count);
+    ParallelSchedule("ooze shield", part_counts).run([&](const size_t layer_nr)
     {
         constexpr bool around_support = true;
         constexpr bool around_prime_tower = false;
-        storage.oozeShield.push_back(storage.getLayerOutlines(layer_nr, around_support, around_prime_tower).offset(ooze_shield_dist, ClipperLib::jtRound).getOutsidePolygons());
-    }
+        storage.oozeShield[layer_nr] = storage.getLayerOutlines(layer_nr, around_support, around_prime_tower).offset(ooze_shield_dist, ClipperLib::jtRound).getOutsidePolygons();
+    });
 
     const AngleDegrees angle = mesh_group_settings.get<AngleDegrees>("ooze_shield_angle");
     if (angle <= 89)
     {
         const coord_t allowed_angle_offset = tan(mesh_group_settings.get<AngleRadians>("ooze_shield_angle")) * mesh_group_settings.get<coord_t>("layer_height"); // Allow for a 60deg angle in the oozeShield.
+        // Each layer is widened by the layer next to it after that one was widened itself, so these sweeps are inherently serial.
+        // Shrinking a union isn't the same as the union of the shrunk parts, so this can't be split up into a parallel scan either.
         for (LayerIndex layer_nr = 1; layer_nr <= storage.max_print_height_second_to_last_extruder; layer_nr++)
         {
             storage.oozeShield[layer_nr] = storage.oozeShield[layer_nr].unionPolygons(storage.oozeShield[layer_nr - 1].offset(-allowed_angle_offset));
@@ -946,10 +1415,15 @@ void FffPolygonGenerator::processOozeShield(SliceDataStorage& storage)
     }
 
     const float largest_printed_area = 1.0; // TODO: make var a parameter, and perhaps even a setting?
-    for (LayerIndex layer_nr = 0; layer_nr <= storage.max_print_height_second_to_last_extruder; layer_nr++)
+    std::vector<size_t> shield_vertex_counts(storage.oozeShield.size());
+    for (size_t layer_nr = 0; layer_nr < storage.oozeShield.size(); layer_nr++)
     {
-        storage.oozeShield[layer_nr].removeSmallAreas(largest_printed_area);
+        shield_vertex_counts[layer_nr] = storage.oozeShield[layer_nr].pointCount();
     }
+    ParallelSchedule("ooze shield small areas", shield_vertex_counts).run([&](const size_t layer_nr)
+    {
+        storage.oozeShield[layer_nr].removeSmallAreas(largest_printed_area);
+    });
 }
 
 void FffPolygonGenerator::processDraftShield(SliceDataStorage& storage)
@@ -964,13 +1438,27 @@ void FffPolygonGenerator::processDraftShield(SliceDataStorage& storage)
 
     const unsigned int layer_skip = 500 / layer_height + 1;
 
-    Polygons& draft_shield = storage.draft_protection_shield;
-    for (unsigned int layer_nr = 0; layer_nr < storage.print_layer_count && layer_nr < draft_shield_layers; layer_nr += layer_skip)
+    // Get the outlines of the sampled layers in parallel, and then union them all at once.
+    const int sample_count = (std::min(static_cast<size_t>(storage.print_layer_count), draft_shield_layers) + layer_skip - 1) / layer_skip;
+    std::vector<Polygons> sampled_outlines(sample_count);
+    std::vector<size_t> sample_part_counts(sample_count);
+    const std::vector<size_t> part_counts = getPartCounts(storage, static_cast<int>(storage.print_layer_count));
+    for (int sample_idx = 0; sample_idx < sample_count; sample_idx++)
+    {
+        sample_part_counts[sample_idx] = part_counts[sample_idx * layer_skip];
+    }
+    ParallelSchedule("draft shield", sample_part_counts).run([&](const size_t sample_idx)
     {
         constexpr bool around_support = true;
         constexpr bool around_prime_tower = false;
-        draft_shield = draft_shield.unionPolygons(storage.getLayerOutlines(layer_nr, around_support, around_prime_tower));
+        sampled_outlines[sample_idx] = storage.getLayerOutlines(sample_idx * layer_skip, around_support, around_prime_tower);
+    });
+    Polygons draft_shield = storage.draft_protection_shield;
+    for (const Polygons& outlines : sampled_outlines)
+    {
+        draft_shield.add(outlines);
     }
+    draft_shield = draft_shield.unionPolygons();
 
     const coord_t draft_shield_dist = mesh_group_settings.get<coord_t>("draft_shield_dist");
     storage.draft_protection_shield = draft_shield.approxConvexHull(draft_shield_dist);
@@ -1053,48 +1541,62 @@ void FffPolygonGenerator::processFuzzyWalls(SliceMeshStorage& mesh)
     const coord_t avg_dist_between_points = mesh.settings.get<coord_t>("magic_fuzzy_skin_point_dist");
     const coord_t min_dist_between_points = avg_dist_between_points * 3 / 4; // hardcoded: the point distance may vary between 3/4 and 5/4 the supplied value
     const coord_t range_random_point_dist = avg_dist_between_points / 2;
-    unsigned int start_layer_nr = (mesh.settings.get<EPlatformAdhesion>("adhesion_type") == EPlatformAdhesion::BRIM)? 1 : 0; // don't make fuzzy skin on first layer if there's a brim    
-
-    auto hole_area = Polygons();
-    std::function<bool(const bool&, const ExtrusionJunction&)> accumulate_is_in_hole = [](const bool& prev_result, const ExtrusionJunction& junction) { return false; };
+    const int start_layer_nr = (mesh.settings.get<EPlatformAdhesion>("adhesion_type") == EPlatformAdhesion::BRIM)? 1 : 0; // don't make fuzzy skin on first layer if there's a brim
+    const int layer_count = mesh.layers.size();
 
-    for (unsigned int layer_nr = start_layer_nr; layer_nr < mesh.layers.size(); layer_nr++)
+    // The walls are fuzzed along their length, so a layer costs about as much as the length of its outline, for which its vertices are a quick proxy.
+    std::vector<size_t> vertex_counts(std::max(0, layer_count - start_layer_nr), 0);
+    for (int layer_nr = start_layer_nr; layer_nr < layer_count; layer_nr++)
+    {
+        for (const SliceLayerPart& part : mesh.layers[layer_nr].parts)
+        {
+            vertex_counts[layer_nr - start_layer_nr] += part.print_outline.pointCount();
+        }
+    }
+    ParallelSchedule("fuzzy skin", vertex_counts).run([&](const size_t item_idx)
     {
+        const int layer_nr = start_layer_nr + item_idx;
+        // Every layer has its own random generator, so the result doesn't depend on the order in which the layers are processed.
+        std::minstd_rand random_generator(layer_nr + 1);
         SliceLayer& layer = mesh.layers[layer_nr];
         for (SliceLayerPart& part : layer.parts)
         {
+            Polygons hole_area;
+            if (apply_outside_only)
+            {
+                hole_area = part.print_outline.getOutsidePolygons().offset(-line_width);
+            }
+
             std::vector<VariableWidthLines> result_paths;
+            result_paths.reserve(part.wall_toolpaths.size());
             for (auto& toolpath : part.wall_toolpaths)
             {
                 if (toolpath.front().inset_idx != 0)
                 {
-                    result_paths.push_back(toolpath);
+                    result_paths.push_back(std::move(toolpath));
                     continue;
                 }
 
                 result_paths.emplace_back();
                 auto& result_lines = result_paths.back();
+                result_lines.reserve(toolpath.size());
 
-                if (apply_outside_only)
-                {
-                    hole_area = part.print_outline.getOutsidePolygons().offset(-line_width);
-                    accumulate_is_in_hole =
-                        [&hole_area](const bool& prev_result, const ExtrusionJunction& junction) { return prev_result || hole_area.inside(junction.p); };
-                }
                 for (auto& line : toolpath)
                 {
-                    if (apply_outside_only && std::accumulate(line.begin(), line.end(), false, accumulate_is_in_hole))
+                    if (apply_outside_only && std::any_of(line.begin(), line.end(), [&hole_area](const ExtrusionJunction& junction) { return hole_area.inside(junction.p); }))
                     {
-                        result_lines.push_back(line);
+                        result_lines.push_back(std::move(line));
                         continue;
                     }
 
                     result_lines.emplace_back();
                     auto& result = result_lines.back();
                     result.inset_idx = line.inset_idx;
+                    // Reserve enough for the new points with the smallest distance between them, plus one point for each segment that is shorter than that.
+                    result.junctions.reserve(line.getLength() / std::max(coord_t(1), min_dist_between_points) + line.size() + 1);
 
                     // generate points in between p0 and p1
-                    int64_t dist_left_over = (min_dist_between_points / 4) + rand() % (min_dist_between_points / 4); // the distance to be traversed on the line before making the first new point
+                    int64_t dist_left_over = (min_dist_between_points / 4) + random_generator() % (min_dist_between_points / 4); // the distance to be traversed on the line before making the first new point
                     auto* p0 = &line.front();
                     for (auto& p1 : line)
                     {
@@ -1114,10 +1616,10 @@ void FffPolygonGenerator::processFuzzyWalls(SliceMeshStorage& mesh)
                             const double width = (p1.w * vSize(p1.p - p) + p0->w * vSize(p0->p - p)) / p0p1_size;
                             result.emplace_back(p, width, p1.perimeter_index);
                         }
-                        for (; p0pa_dist < p0p1_size; p0pa_dist += min_dist_between_points + rand() % range_random_point_dist)
+                        const Point perp_to_p0p1 = turn90CCW(p0p1);
+                        for (; p0pa_dist < p0p1_size; p0pa_dist += min_dist_between_points + random_generator() % range_random_point_dist)
                         {
-                            const int r = rand() % (fuzziness * 2) - fuzziness;
-                            const Point perp_to_p0p1 = turn90CCW(p0p1);
+                            const coord_t r = static_cast<coord_t>(random_generator() % (fuzziness * 2)) - fuzziness;
                             const Point fuzz = normal(perp_to_p0p1, r);
                             const Point pa = p0->p + normal(p0p1, p0pa_dist);
                             const double width = (p1.w * vSize(p1.p - pa) + p0->w * vSize(p0->p - pa)) / p0p1_size;
@@ -1152,9 +1654,9 @@ void FffPolygonGenerator::processFuzzyWalls(SliceMeshStorage& mesh)
                     }
                 }
             }
-            part.wall_toolpaths = result_paths;
+            part.wall_toolpaths = std::move(result_paths);
         }
-    }
+    });
 }
 
 
@@ -4,17 +4,21 @@
 #ifndef FFF_POLYGON_GENERATOR_H
 #define FFF_POLYGON_GENERATOR_H
 
+#include "SlicerCache.h"
+#include "infill/SierpinskiFillProviderCache.h"
 #include "utils/NoCopy.h"
 
 namespace cura
 {
 
 struct LayerIndex;
+class LayerOutlineIntersections;
 class MeshGroup;
 class ProgressStageEstimator;
 class SliceDataStorage;
 class SliceMeshStorage;
 class TimeKeeper;
+class WallToolPathsCache;
 
 /*!
  * Primary stage in Fused Filament Fabrication processing: Polygons are generated.
@@ -72,13 +76,18 @@ private:
     
     /*!
      * Processes the outline information as stored in the \p storage: generates inset perimeter polygons, skin and infill
+     *
+     * A batch of consecutive meshes in \p mesh_order is processed at once, so that the layers of all of them are spread over the threads together.
+     * The skin and infill of a layer are generated as soon as the walls of the layers around it are done, rather than after all walls.
+     * Only the first mesh of the batch may be an infill mesh, since an infill mesh needs the infill of all meshes before it.
      * 
      * \param storage Input and Output parameter: fetches the outline information (see SliceLayerPart::outline) and generates the other reachable field of the \p storage
-     * \param mesh_order_idx The index of the mesh_idx in \p mesh_order to process in the vector of meshes in \p storage
+     * \param first_mesh_order_idx The index in \p mesh_order of the first mesh of the batch
+     * \param end_mesh_order_idx The index in \p mesh_order after the last mesh of the batch
      * \param mesh_order The order in which the meshes are processed (used for infill meshes)
      * \param inset_skin_progress_estimate The progress stage estimate calculator
      */
-    void processBasicWallsSkinInfill(SliceDataStorage& storage, const size_t mesh_order_idx, const std::vector<size_t>& mesh_order, ProgressStageEstimator& inset_skin_progress_estimate);
+    void processBasicWallsSkinInfill(SliceDataStorage& storage, const size_t first_mesh_order_idx, const size_t end_mesh_order_idx, const std::vector<size_t>& mesh_order, ProgressStageEstimator& inset_skin_progress_estimate);
 
     /*!
      * Process the mesh to be an infill mesh: limit all outlines to within the infill of normal meshes and subtract their volume from the infill of those meshes
@@ -125,10 +134,20 @@ private:
     void computePrintHeightStatistics(SliceDataStorage& storage);
 
     /*!
-     * \brief Generate the inset polygons which form the walls.
-     * \param layer_nr The layer for which to generate the insets.
+     * Add the number of polygons and the memory of the slice data of each
+     * layer to the \ref LayerStatistics, if those are recorded.
+     *
+     * \param storage The slice data of all layers.
+     */
+    void recordLayerStatistics(const SliceDataStorage& storage);
+
+    /*!
+     * \brief Generate the inset polygons which form the walls of one part.
+     * \param layer_nr The layer of the part.
+     * \param part_idx The index of the part in its layer.
+     * \param cache The walls generated for earlier outlines of this mesh.
      */
-    void processWalls(SliceMeshStorage& mesh, size_t layer_nr);
+    void processWalls(SliceMeshStorage& mesh, size_t layer_nr, size_t part_idx, WallToolPathsCache& cache);
 
     /*!
      * Generate the outline of the ooze shield.
@@ -141,8 +160,12 @@ private:
      * \param mesh Input and Output parameter: fetches the outline information (see SliceLayerPart::outline) and generates the other reachable field of the \p storage
      * \param layer_nr The layer for which to generate the skin areas.
      * \param process_infill Generate infill areas
+     * \param layers_above Precomputed intersections of the outlines of the
+     * layers above, if any.
+     * \param layers_below Precomputed intersections of the outlines of the
+     * layers below, if any.
      */
-    void processSkinsAndInfill(SliceMeshStorage& mesh, const LayerIndex layer_nr, bool process_infill);
+    void processSkinsAndInfill(SliceMeshStorage& mesh, const LayerIndex layer_nr, bool process_infill, const LayerOutlineIntersections* layers_above = nullptr, const LayerOutlineIntersections* layers_below = nullptr);
 
     /*!
      * Generate the polygons where the draft screen should be.
@@ -167,6 +190,18 @@ private:
      * \param[in,out] mesh where the outer wall is retrieved and stored in.
      */
     void processFuzzyWalls(SliceMeshStorage& mesh);
+
+    /*!
+     * The layers that the meshes were sliced into during the previous slice,
+     * reused when the same meshes are sliced the same way again.
+     */
+    SlicerCache slicer_cache;
+
+    /*!
+     * The cross fractals made during the previous slice, reused when the
+     * same fractal is needed again.
+     */
+    SierpinskiFillProviderCache cross_fill_provider_cache;
 };
 
 }//namespace cura
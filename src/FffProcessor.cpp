@@ -8,29 +8,39 @@ namespace cura
 
 FffProcessor FffProcessor::instance; // definition must be in cpp
 
+FffProcessor::FffProcessor()
+: gcode_writer(std::make_unique<FffGcodeWriter>())
+{
+}
+
 bool FffProcessor::setTargetFile(const char* filename)
 {
-    return gcode_writer.setTargetFile(filename);
+    return gcode_writer->setTargetFile(filename);
 }
 
 void FffProcessor::setTargetStream(std::ostream* stream)
 {
-    return gcode_writer.setTargetStream(stream);
+    return gcode_writer->setTargetStream(stream);
 }
 
 double FffProcessor::getTotalFilamentUsed(int extruder_nr)
 {
-    return gcode_writer.getTotalFilamentUsed(extruder_nr);
+    return gcode_writer->getTotalFilamentUsed(extruder_nr);
 }
 
 std::vector<Duration> FffProcessor::getTotalPrintTimePerFeature()
 {
-    return gcode_writer.getTotalPrintTimePerFeature();
+    return gcode_writer->getTotalPrintTimePerFeature();
 }
 
 void FffProcessor::finalize()
 {
-    gcode_writer.finalize();
+    gcode_writer->finalize();
+}
+
+void FffProcessor::reset()
+{
+    gcode_writer = std::make_unique<FffGcodeWriter>(); //The old writer flushes and closes its output file when it's destroyed.
 }
 
-} // namespace cura 
+} // namespace cura
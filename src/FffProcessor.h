@@ -4,6 +4,8 @@
 #ifndef FFF_PROCESSOR_H
 #define FFF_PROCESSOR_H
 
+#include <memory> //For unique_ptr.
+
 #include "FffGcodeWriter.h"
 #include "FffPolygonGenerator.h"
 #include "utils/gettime.h"
@@ -31,10 +33,12 @@ public:
         return &instance;
     }
 
+    FffProcessor();
+
     /*!
      * The gcode writer, which generates paths in layer plans in a buffer, which converts these paths into gcode commands.
      */
-    FffGcodeWriter gcode_writer;
+    std::unique_ptr<FffGcodeWriter> gcode_writer;
 
     /*!
      * The polygon generator, which slices the models and generates all polygons to be printed and areas to be filled.
@@ -85,6 +89,15 @@ public:
      * Add the end gcode and set all temperatures to zero.
      */
     void finalize();
+
+    /*!
+     * Forget the state of the printer and the output of the previous slice, so
+     * that the next slice starts in the same way as the first one.
+     *
+     * This closes the output file, if any. The output goes to stdout again
+     * until another target is set.
+     */
+    void reset();
 };
 
 }//namespace cura
@@ -4,14 +4,21 @@
 #ifndef GCODE_LAYER_THREADER_H
 #define GCODE_LAYER_THREADER_H
 
-#include <queue> // priority_queue
+#include <algorithm> // max
+#include <cassert>
+#include <chrono> // measuring how long producing and consuming takes
+#include <cmath> // ceil
+#include <condition_variable> // waking threads when the pipeline has room again
 #include <functional> // function
-#include <thread> // sleep
-#include <chrono> // milliseconds
-#include <optional>
+#include <mutex>
+#include <vector>
 
+#ifdef _OPENMP
+    #include <omp.h>
+#endif // _OPENMP
+
+#include "utils/Cancellation.h"
 #include "utils/logoutput.h"
-#include "utils/Lock.h"
 
 namespace cura
 {
@@ -24,8 +31,17 @@ namespace cura
  * A layer_nr index is passed to the item producer in order to produce the different items.
  * 
  * Each thread does production and consumption, giving priority to consumption if some is available.
+ * Threads claim the next item to produce from a shared counter, so idle threads always pick up the next layer.
+ * Whichever thread finds the next item in order ready becomes the consumer and keeps consuming while the following items are ready.
+ * Threads that can't produce because too many items are in the pipeline wait on a condition variable until an item is consumed.
+ *
+ * How many items may be in the pipeline adapts to what is measured while running, see \ref GcodeLayerThreader::computeTaskLimit .
+ * It is at least the number of threads, so that they all have work, and at most the given maximum.
+ * If the memory of the items is measured, no more items are produced than fit in the memory limit, except the next one to consume.
  * 
  * If there is only one thread, it consumes every time it has produced one item.
+ *
+ * Once the slice is cancelled, no new items are claimed. The items that were claimed already are still produced and consumed, so none of them leak.
  * 
  * \warning This class is only adequate when the expected production time of an item is more than (n_threads - 1) times as much as the expected consumption time of an item
  */
@@ -39,68 +55,119 @@ public:
      * \param produce_item The function with which to produce an item
      * \param consume_item The function with which to consume an item
      * \param max_task_count The maximum number of items (being) produced without having been consumed
+     * \param item_memory The function to measure how many bytes a produced item holds, if the memory is to be limited
+     * \param max_memory The number of bytes that the produced items that weren't consumed yet may hold together, or 0 for no limit
      */
     GcodeLayerThreader(
         int start_item_argument_index,
         int end_item_argument_index,
         const std::function<T* (int)>& produce_item,
         const std::function<void (T*)>& consume_item,
-        const unsigned int max_task_count
+        const unsigned int max_task_count,
+        const std::function<size_t (const T*)>& item_memory = nullptr,
+        const size_t max_memory = 0
     );
 
     /*!
      * Produce all items and consume them.
      */
     void run();
+
+    /*!
+     * Compute how many items may be in the pipeline, given how long it takes to produce and consume them.
+     *
+     * If consuming is what limits the throughput, more than one item per thread ahead only holds on to memory, without the items being consumed any sooner.
+     * Otherwise the other threads need to be able to keep producing while the next item to consume is taking long to produce.
+     * How much longer than usual that takes is estimated from the deviation of the production times.
+     *
+     * \param thread_count The number of threads that produce items
+     * \param produce_average The average time it takes one thread to produce an item, in seconds
+     * \param produce_deviation The average deviation from \p produce_average, in seconds
+     * \param consume_average The average time it takes to consume an item, in seconds
+     * \param max_task_count The most items that may be in the pipeline
+     * \return The number of items that may be in the pipeline, between the number of threads and \p max_task_count
+     */
+    static int computeTaskLimit(const int thread_count, const double produce_average, const double produce_deviation, const double consume_average, const int max_task_count);
 private:
     /*!
-     * Produce an item and put it in \ref GcodeLayerThreader::produced
+     * Claim the next item, produce it and put it in \ref GcodeLayerThreader::produced
      * 
-     * \param item_argument_index The parameter with which to call \ref GcodeLayerThreader::produce_item
+     * The lock is released while the item is being produced.
+     * 
+     * \param lock The lock on \ref GcodeLayerThreader::mutex, held by the calling thread
      */
-    void produce(int item_argument_index);
+    void produce(std::unique_lock<std::mutex>& lock);
 
     /*!
-     * Consume an item from \ref GcodeLayerThreader::produced
+     * Consume items from \ref GcodeLayerThreader::produced in order for as long as the next one is ready
+     * 
+     * The lock is released while an item is being consumed.
      * 
-     * \param item_idx The index into \ref GcodeLayerThreader::produced
+     * \param lock The lock on \ref GcodeLayerThreader::mutex, held by the calling thread
      */
-    void consume(int item_idx);
+    void consume(std::unique_lock<std::mutex>& lock);
 
     /*!
+     * Until all items are claimed:
      * Consume if possible, otherwise
      * Produce if possible, otherwise
-     * wait half a second
+     * wait until an item has been consumed
      */
     void act();
 
     /*!
-     * Check whether no tasks are left for a thread to pick up
+     * Whether another item may be produced without the items holding more memory than allowed.
+     *
+     * The items that are still being produced are expected to be as large as the average item.
+     */
+    bool hasMemoryForItem() const;
+
+    /*!
+     * Update the average of how long items take to produce or consume.
+     *
+     * Recent items count most, so that the averages follow the changes between the parts of a print.
+     *
+     * \param[in,out] average The average to update
+     * \param[in,out] deviation The average deviation from \p average to update, if any
+     * \param duration The duration of the last item, in seconds
+     * \param is_first Whether this is the first item measured, so that there is no average yet
      */
-    bool finished();
+    static void updateAverage(double& average, double* deviation, const double duration, const bool is_first);
 
 private:
     // algorithm parameters
     const int start_item_argument_index; //!< The first index with which \ref GcodeLayerThreader::produce_item will be called
     const int end_item_argument_index; //!< The end index with which \ref GcodeLayerThreader::produce_item will not be called any more
-    const unsigned int item_count; //!< The number of items to produce and consume
+    const int item_count; //!< The number of items to produce and consume
 
     const int max_task_count; //!< The maximum amount of items active in the system
 
     const std::function<T* (int)>& produce_item; //!< The function to produce an item
     const std::function<void (T*)>& consume_item; //!< The function to consume an item
+    const std::function<size_t (const T*)> item_memory; //!< The function to measure the bytes of an item, if the memory is limited
+    const size_t max_memory; //!< The most bytes the items in the pipeline may hold together, or 0 for no limit
 
-    // variables which change throughout the computation of the algorithm
+    // variables which change throughout the computation of the algorithm, all guarded by \ref GcodeLayerThreader::mutex
     std::vector<T*> produced; //!< ordered list for every item to be produced; contains pointers to produced items which aren't consumed yet; rest is nullptr
-    int last_produced_argument_index; //!< Counter to see which item next to produce
-
-    std::optional<int> to_be_consumed_item_idx; //!< The index into \ref GcodeLayerThreader::produced where to find the next item ready to be consumed (if any)
-    Lock consume_lock; //!< Lock to make sure no two threads consume at the same time
-    int last_consumed_idx = -1; //!< The index into \ref GcodeLayerThreader::produced for the last item consumed
-
-    // statistics
+    int next_produce_idx = 0; //!< The index into \ref GcodeLayerThreader::produced of the next item to be produced
+    int next_consume_idx = 0; //!< The index into \ref GcodeLayerThreader::produced of the next item to be consumed
+    bool consuming = false; //!< Whether some thread is consuming, to make sure no two threads consume at the same time
     int active_task_count = 0; //!< Number of items active in this system.
+    int producing_count = 0; //!< Number of items which are being produced right now.
+    int produced_count = 0; //!< Number of items which were produced so far.
+    std::vector<size_t> produced_memory; //!< For every produced item that isn't consumed yet, how many bytes it holds
+    size_t held_memory = 0; //!< The number of bytes held by the produced items which aren't consumed yet
+    size_t item_memory_average = 0; //!< The average number of bytes of the produced items so far
+
+    int thread_count = 1; //!< The number of threads running \ref GcodeLayerThreader::act
+    int task_limit; //!< How many items may currently be active in this system, adapted to the measured timings
+    int measured_count = 0; //!< How many items were consumed and measured so far
+    double produce_average = 0.0; //!< The average time in seconds that producing an item took
+    double produce_deviation = 0.0; //!< The average deviation from \ref GcodeLayerThreader::produce_average
+    double consume_average = 0.0; //!< The average time in seconds that consuming an item took
 
+    std::mutex mutex; //!< Guards the state of the pipeline
+    std::condition_variable item_consumed; //!< Signalled whenever an item is consumed, so that there is room to produce another one
 };
 
 template <typename T>
@@ -109,127 +176,176 @@ GcodeLayerThreader<T>::GcodeLayerThreader(
     int end_item_argument_index,
     const std::function<T* (int)>& produce_item,
     const std::function<void (T*)>& consume_item,
-    const unsigned int max_task_count
+    const unsigned int max_task_count,
+    const std::function<size_t (const T*)>& item_memory,
+    const size_t max_memory
 )
 : start_item_argument_index(start_item_argument_index)
 , end_item_argument_index(end_item_argument_index)
-, item_count(end_item_argument_index - start_item_argument_index)
-, max_task_count(max_task_count)
+, item_count(std::max(0, end_item_argument_index - start_item_argument_index))
+, max_task_count(std::max(1u, max_task_count))
 , produce_item(produce_item)
 , consume_item(consume_item)
-, last_produced_argument_index(start_item_argument_index - 1)
+, item_memory(item_memory)
+, max_memory(item_memory ? max_memory : 0)
+, task_limit(this->max_task_count) // Until the timings are measured.
 {
     produced.resize(item_count, nullptr);
+    if (this->max_memory > 0)
+    {
+        produced_memory.resize(item_count, 0);
+    }
+}
+
+template <typename T>
+int GcodeLayerThreader<T>::computeTaskLimit(const int thread_count, const double produce_average, const double produce_deviation, const double consume_average, const int max_task_count)
+{
+    int task_limit;
+    if (consume_average * thread_count >= produce_average)
+    {
+        // The consumer can't keep up with the producers anyway.
+        task_limit = thread_count + 1;
+    }
+    else
+    {
+        // While the next item takes as long as a slow item to produce, the other threads produce the usual number of items each.
+        const double slow_produce_time = produce_average + 2.0 * produce_deviation;
+        const double items_per_slow_item = (produce_average > 0.0) ? slow_produce_time / produce_average : 1.0;
+        task_limit = thread_count + static_cast<int>(std::ceil((thread_count - 1) * items_per_slow_item));
+    }
+    return std::max(1, std::min(max_task_count, std::max(thread_count, task_limit)));
 }
 
 template <typename T>
 void GcodeLayerThreader<T>::run()
 {
+#ifdef _OPENMP
+    thread_count = std::max(1, omp_get_max_threads());
+#endif // _OPENMP
     #pragma omp parallel
     {
 #ifdef _OPENMP
         #pragma omp master
         log("Multithreading GcodeLayerThreader with %i threads.\n", omp_get_num_threads());
 #endif // _OPENMP
-        while (true)
-        {
-            if (finished())
-            {
-                break;
-            }
-            act();
-        }
+        act();
     }
+    assert(next_consume_idx == next_produce_idx && "All claimed items should have been consumed by the time all threads are done.");
+    logDebug("GcodeLayerThreader ended with at most %i items in the pipeline. Producing took %.3fs and consuming %.3fs per item on average.\n", task_limit, produce_average, consume_average);
 }
 
 template <typename T>
-void GcodeLayerThreader<T>::produce(int item_argument_index)
+void GcodeLayerThreader<T>::produce(std::unique_lock<std::mutex>& lock)
 {
-    T* produced_item = produce_item(item_argument_index);
-    int item_idx = item_argument_index - start_item_argument_index;
-    #pragma omp critical
+    const int item_idx = next_produce_idx++;
+    active_task_count++;
+    producing_count++;
+    lock.unlock();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    T* produced_item = produce_item(start_item_argument_index + item_idx);
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    const size_t memory = (max_memory > 0) ? item_memory(produced_item) : 0;
+    lock.lock();
+    produced[item_idx] = produced_item;
+    producing_count--;
+    updateAverage(produce_average, &produce_deviation, duration.count(), produced_count == 0);
+    if (max_memory > 0)
     {
-        produced[item_idx] = produced_item;
-        if (item_idx == last_consumed_idx + 1 && item_idx < end_item_argument_index - start_item_argument_index)
-        {
-            assert(!to_be_consumed_item_idx && "the just produced item shouldn't be consumable already!");
-            to_be_consumed_item_idx = item_idx;
-        }
+        produced_memory[item_idx] = memory;
+        held_memory += memory;
+        item_memory_average = (item_memory_average * produced_count + memory) / (produced_count + 1);
     }
+    produced_count++;
 }
 
 template <typename T>
-void GcodeLayerThreader<T>::consume(int item_idx)
+void GcodeLayerThreader<T>::consume(std::unique_lock<std::mutex>& lock)
 {
-    consume_item(produced[item_idx]);
-    produced[item_idx] = nullptr;
-    #pragma omp critical
+    consuming = true;
+    while (next_consume_idx < item_count && produced[next_consume_idx])
     {
-        assert(item_idx == last_consumed_idx + 1);
-        last_consumed_idx = item_idx;
-        if (last_consumed_idx + 1 < end_item_argument_index - start_item_argument_index && produced[last_consumed_idx + 1])
+        T* item = produced[next_consume_idx];
+        produced[next_consume_idx] = nullptr;
+        lock.unlock();
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        consume_item(item);
+        const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        lock.lock();
+        if (max_memory > 0)
         {
-            assert(!to_be_consumed_item_idx && "The next produced item shouldn't already be noted as being consumable because of the lock!");
-            to_be_consumed_item_idx = last_consumed_idx + 1;
+            held_memory -= produced_memory[next_consume_idx];
         }
+        next_consume_idx++;
         active_task_count--;
         assert(active_task_count >= 0);
+        updateAverage(consume_average, nullptr, duration.count(), measured_count == 0);
+        measured_count++;
+        if (measured_count >= thread_count) // Only once every thread has produced something, to have some idea of the timings.
+        {
+            task_limit = computeTaskLimit(thread_count, produce_average, produce_deviation, consume_average, max_task_count);
+        }
+        item_consumed.notify_all();
     }
+    consuming = false;
 }
 
 template <typename T>
 void GcodeLayerThreader<T>::act()
 {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
     {
-        int item_idx = -1;
-        #pragma omp critical
+        if (! consuming && next_consume_idx < item_count && produced[next_consume_idx])
         {
-            if (to_be_consumed_item_idx && consume_lock.test_lock())
-            {
-                item_idx = *to_be_consumed_item_idx;
-                to_be_consumed_item_idx = std::nullopt;
-            }
+            consume(lock);
         }
-        if (item_idx >= 0)
+        else if (next_produce_idx >= item_count || Cancellation::isRequested())
         {
-            consume(item_idx);
-            consume_lock.unlock();
+            // All items are claimed. The remaining ones are consumed either by the thread that is consuming already or by the thread that produces the next one.
             return;
         }
-    }
-
-    {
-        std::optional<int> item_argument_index;
-        #pragma omp critical
+        else if (active_task_count < task_limit && hasMemoryForItem())
         {
-            if (active_task_count < max_task_count)
-            {
-                item_argument_index = ++last_produced_argument_index;
-                active_task_count++;
-            }
+            produce(lock);
         }
-        if (item_argument_index && *item_argument_index < end_item_argument_index)
+        else
         {
-            produce(*item_argument_index);
-            return;
+            // Blocked by too many items being processed. The next item to consume is being produced or consumed by another thread.
+            // Without any items active, there's always room for the next one, so this never waits forever.
+            item_consumed.wait(lock);
         }
     }
-#ifdef _OPENMP
-    // thread is blocked by too many items being processed
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-#endif
 }
 
 template <typename T>
-bool GcodeLayerThreader<T>::finished()
+bool GcodeLayerThreader<T>::hasMemoryForItem() const
 {
-    bool finished;
-    #pragma omp critical
+    if (max_memory == 0 || active_task_count == 0)
+    {
+        return true;
+    }
+    if (produced_count == 0)
+    {
+        return false; // Until the first item is done, there's no telling how large they are.
+    }
+    const size_t expected_memory = held_memory + (producing_count + 1) * item_memory_average;
+    return expected_memory <= max_memory;
+}
+
+template <typename T>
+void GcodeLayerThreader<T>::updateAverage(double& average, double* deviation, const double duration, const bool is_first)
+{
+    if (is_first)
+    {
+        average = duration;
+        return;
+    }
+    constexpr double weight = 0.2; // How much the last item counts. The rest is the history of the previous items.
+    if (deviation)
     {
-        finished = last_produced_argument_index >= end_item_argument_index - 1
-            && !to_be_consumed_item_idx;
+        *deviation += weight * (std::abs(duration - average) - *deviation);
     }
-    return finished;
+    average += weight * (duration - average);
 }
 
 } // namespace cura
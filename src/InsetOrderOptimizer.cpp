@@ -101,7 +101,7 @@ bool InsetOrderOptimizer::addToLayer()
     };
     const auto walls_to_be_added = get_walls_to_be_added(reverse, paths);
 
-    const auto order = pack_by_inset ? getInsetOrder(walls_to_be_added, outer_to_inner) : getRegionOrder(walls_to_be_added, outer_to_inner);
+    const auto order = pack_by_inset ? std::unordered_set<std::pair<const ExtrusionLine*, const ExtrusionLine*>>() : getRegionOrder(walls_to_be_added, outer_to_inner);
     
     constexpr Ratio flow = 1.0_r;
     
@@ -113,6 +113,7 @@ bool InsetOrderOptimizer::addToLayer()
     //On even layers we start with normal direction, on odd layers with inverted direction.
     constexpr bool reverse_all_paths = false;
     PathOrderOptimizer<const ExtrusionLine*> order_optimizer(gcode_layer.getLastPlannedPositionOrStartingPosition(), z_seam_config, detect_loops, combing_boundary, reverse_all_paths, order);
+    order_optimizer.layer_nr = gcode_layer.getLayerNr();
     
     for (const ExtrusionLine* line : walls_to_be_added)
     {
@@ -125,6 +126,13 @@ bool InsetOrderOptimizer::addToLayer()
             order_optimizer.addPolyline(line);
         }
     }
+    if (pack_by_inset)
+    {
+        for (auto& [before, after] : getInsetOrder(walls_to_be_added, outer_to_inner))
+        {
+            order_optimizer.addGroupOrderRequirement(std::move(before), std::move(after));
+        }
+    }
     
     
     order_optimizer.optimize();
@@ -218,14 +226,15 @@ std::unordered_set<std::pair<const ExtrusionLine*, const ExtrusionLine*>> InsetO
     using GridT = SparsePointGrid<LineLoc, Locator>;
     GridT grid(searching_radius);
 
-    
+    std::vector<LineLoc> junctions;
     for (const ExtrusionLine* line : input)
     {
         for (const ExtrusionJunction& junction : *line)
         {
-            grid.insert(LineLoc{junction, line});
+            junctions.push_back(LineLoc{junction, line});
         }
     }
+    grid.insertAll(junctions);
     for (const std::pair<SquareGrid::GridPoint, LineLoc>& pair : grid)
     {
         const LineLoc& lineloc_here = pair.second;
@@ -265,9 +274,9 @@ std::unordered_set<std::pair<const ExtrusionLine*, const ExtrusionLine*>> InsetO
     return order_requirements;
 }
 
-std::unordered_set<std::pair<const ExtrusionLine*, const ExtrusionLine*>> InsetOrderOptimizer::getInsetOrder(const std::vector<const ExtrusionLine*>& input, const bool outer_to_inner)
+std::vector<std::pair<std::vector<const ExtrusionLine*>, std::vector<const ExtrusionLine*>>> InsetOrderOptimizer::getInsetOrder(const std::vector<const ExtrusionLine*>& input, const bool outer_to_inner)
 {
-    std::unordered_set<std::pair<const ExtrusionLine*, const ExtrusionLine*>> order;
+    std::vector<std::pair<std::vector<const ExtrusionLine*>, std::vector<const ExtrusionLine*>>> order;
     
     std::vector<std::vector<const ExtrusionLine*>> walls_by_inset;
     std::vector<std::vector<const ExtrusionLine*>> fillers_by_inset;
@@ -293,31 +302,26 @@ std::unordered_set<std::pair<const ExtrusionLine*, const ExtrusionLine*>> InsetO
     }
     for (size_t inset_idx = 0; inset_idx + 1 < walls_by_inset.size(); inset_idx++)
     {
-        for (const ExtrusionLine* line : walls_by_inset[inset_idx])
+        if (walls_by_inset[inset_idx].empty() || walls_by_inset[inset_idx + 1].empty())
         {
-            for (const ExtrusionLine* inner_line : walls_by_inset[inset_idx + 1])
-            {
-                const ExtrusionLine* before = inner_line;
-                const ExtrusionLine* after = line;
-                if (outer_to_inner)
-                {
-                    std::swap(before, after);
-                }
-                order.emplace(before, after);
-            }
+            continue;
+        }
+        if (outer_to_inner)
+        {
+            order.emplace_back(walls_by_inset[inset_idx], walls_by_inset[inset_idx + 1]);
+        }
+        else
+        {
+            order.emplace_back(walls_by_inset[inset_idx + 1], walls_by_inset[inset_idx]);
         }
     }
     for (size_t inset_idx = 1; inset_idx < fillers_by_inset.size(); inset_idx++)
     {
-        for (const ExtrusionLine* line : fillers_by_inset[inset_idx])
+        if (inset_idx - 1 >= walls_by_inset.size() || walls_by_inset[inset_idx - 1].empty() || fillers_by_inset[inset_idx].empty())
         {
-            if (inset_idx - 1 >= walls_by_inset.size()) continue;
-            for (const ExtrusionLine* enclosing_wall : walls_by_inset[inset_idx - 1])
-            {
-                order.emplace(enclosing_wall, line);
-            }
+            continue;
         }
-        
+        order.emplace_back(walls_by_inset[inset_idx - 1], fillers_by_inset[inset_idx]);
     }
     
     return order;
@@ -74,20 +74,18 @@ public:
 
     /*!
      * Get the order constraints of the insets when printing walls per inset.
-     * Each returned pair consists of adjacent wall lines where the left has an inset_idx one lower than the right.
-     * 
+     * Each returned pair consists of two groups of wall lines, where all lines
+     * of the first group must go before all lines of the second. The groups
+     * are the walls of consecutive insets.
+     *
      * Odd walls should always go after their enclosing wall polygons.
-     * 
+     *
+     * Requiring the order of every pair of walls would take quadratic time and
+     * memory in parts with many holes, so the requirements are kept per group.
+     * See PathOrderOptimizer::addGroupOrderRequirement.
      * \param outer_to_inner Whether the wall polygons with a lower inset_idx should go before those with a higher one.
      */
-    static std::unordered_set<std::pair<const ExtrusionLine*, const ExtrusionLine*>> getInsetOrder(const std::vector<const ExtrusionLine*>& input, const bool outer_to_inner);
-
-    /*!
-     * Make order requirements transitive.
-     * If the input contains A,B and B,C then after this call it will also include A,C.
-     */
-    template<typename PathType>
-    static std::unordered_set<std::pair<PathType, PathType>> makeOrderIncludeTransitive(const std::unordered_set<std::pair<PathType, PathType>>& order_requirements);
+    static std::vector<std::pair<std::vector<const ExtrusionLine*>, std::vector<const ExtrusionLine*>>> getInsetOrder(const std::vector<const ExtrusionLine*>& input, const bool outer_to_inner);
 private:
     const FffGcodeWriter& gcode_writer;
     const SliceDataStorage& storage;
@@ -146,37 +144,6 @@ private:
 };
 
 
-template<typename PathType>
-std::unordered_set<std::pair<PathType, PathType>> InsetOrderOptimizer::makeOrderIncludeTransitive(const std::unordered_set<std::pair<PathType, PathType>>& order_requirements)
-{
-    if (order_requirements.empty()) return order_requirements;
-
-    std::unordered_multimap<PathType, PathType> order_mapping;
-    for (auto [from, to] : order_requirements)
-    {
-        order_mapping.emplace(from, to);
-    }
-    std::unordered_set<std::pair<PathType, PathType>> transitive_order = order_requirements;
-    for (auto [from, to] : order_requirements)
-    {
-        std::queue<PathType> starts_of_next_relation;
-        starts_of_next_relation.emplace(to);
-        while ( ! starts_of_next_relation.empty())
-        {
-            PathType start_of_next_relation = starts_of_next_relation.front();
-            starts_of_next_relation.pop();
-            auto range = order_mapping.equal_range(start_of_next_relation);
-            for (auto it = range.first; it != range.second; ++it)
-            {
-                auto [ next_from, next_to ] = *it;
-                starts_of_next_relation.emplace(next_to);
-                transitive_order.emplace(from, next_to);
-            }
-        }
-    }
-    return transitive_order;    
-}
-
 } //namespace cura
 
 #endif // INSET_ORDER_OPTIMIZER_H
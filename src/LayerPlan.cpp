@@ -15,10 +15,14 @@
 #include "pathPlanning/Comb.h"
 #include "pathPlanning/CombPaths.h"
 #include "settings/types/Ratio.h"
+#include "utils/ArcFitting.h" //To write curves as arc moves.
 #include "utils/logoutput.h"
 #include "utils/linearAlg2D.h"
 #include "utils/polygonUtils.h"
+#include "utils/LayerStatistics.h"
+#include "utils/MemoryUsage.h" //To record the memory use per layer.
 #include "utils/Simplify.h"
+#include "utils/Trace.h"
 #include "WipeScriptConfig.h"
 
 namespace cura {
@@ -103,7 +107,7 @@ GCodePath* LayerPlan::getLatestPathWithConfig(const GCodePathConfig& config, Spa
     {
         return &paths.back();
     }
-    paths.emplace_back(config, current_mesh, space_fill_type, flow, width_factor, spiralize, speed_factor);
+    paths.emplace_back(config, current_mesh, space_fill_type, flow, width_factor, spiralize, speed_factor, point_arena);
     GCodePath* ret = &paths.back();
     ret->skip_agressive_merge_hint = mode_skip_agressive_merge;
     return ret;
@@ -122,7 +126,8 @@ void LayerPlan::forceNewPathStart()
 }
 
 LayerPlan::LayerPlan(const SliceDataStorage& storage, LayerIndex layer_nr, coord_t z, coord_t layer_thickness, size_t start_extruder, const std::vector<FanSpeedLayerTimeSettings>& fan_speed_layer_time_settings_per_extruder, coord_t comb_boundary_offset, coord_t comb_move_inside_distance, coord_t travel_avoid_distance)
-: configs_storage(storage, layer_nr, layer_thickness)
+: shared_configs_storage(storage.getPathConfigs(layer_nr, layer_thickness))
+, configs_storage(*shared_configs_storage)
 , z(z)
 , final_travel_z(z)
 , mode_skip_agressive_merge(false)
@@ -133,20 +138,27 @@ LayerPlan::LayerPlan(const SliceDataStorage& storage, LayerIndex layer_nr, coord
 , layer_thickness(layer_thickness)
 , has_prime_tower_planned_per_extruder(Application::getInstance().current_slice->scene.extruders.size(), false)
 , current_mesh("NONMESH")
+, point_arena(std::make_shared<PathPointArena>())
 , last_extruder_previous_layer(start_extruder)
 , last_planned_extruder(&Application::getInstance().current_slice->scene.extruders[start_extruder])
+, has_naive_time_estimates(false)
 , first_travel_destination_is_inside(false) // set properly when addTravel is called for the first time (otherwise not set properly)
-, comb_boundary_minimum(computeCombBoundary(CombBoundary::MINIMUM))
-, comb_boundary_preferred(computeCombBoundary(CombBoundary::PREFERRED))
+, comb_boundary_preferred_index(comb_boundary_preferred)
 , comb_move_inside_distance(comb_move_inside_distance)
+, travel_order_refinement_budget(Application::getInstance().current_slice->scene.current_mesh_group->settings.getOrDefault<Duration>("travel_order_refinement_time", Duration(0)))
 , fan_speed_layer_time_settings_per_extruder(fan_speed_layer_time_settings_per_extruder)
 {
     size_t current_extruder = start_extruder;
     was_inside = true; // not used, because the first travel move is bogus
     is_inside = false; // assumes the next move will not be to inside a layer part (overwritten just before going into a layer part)
+    computeCombBoundaries();
     if (Application::getInstance().current_slice->scene.current_mesh_group->settings.get<CombingMode>("retraction_combing") != CombingMode::OFF)
     {
         comb = new Comb(storage, layer_nr, comb_boundary_minimum, comb_boundary_preferred, comb_boundary_offset, travel_avoid_distance, comb_move_inside_distance);
+        if (storage.comb_path_cache)
+        {
+            comb_travels = storage.comb_path_cache->getTravels(comb_boundary_minimum, comb_boundary_preferred, CombPathCache::Parameters{comb_boundary_offset, travel_avoid_distance, comb_move_inside_distance});
+        }
     }
     else
     {
@@ -176,15 +188,15 @@ ExtruderTrain* LayerPlan::getLastPlannedExtruderTrain()
     return last_planned_extruder;
 }
 
-Polygons LayerPlan::computeCombBoundary(const CombBoundary boundary_type)
+void LayerPlan::computeCombBoundaries()
 {
-    Polygons comb_boundary;
     const CombingMode mesh_combing_mode = Application::getInstance().current_slice->scene.current_mesh_group->settings.get<CombingMode>("retraction_combing");
     if (mesh_combing_mode != CombingMode::OFF && (layer_nr >=0 || mesh_combing_mode != CombingMode::NO_SKIN))
     {
         if (layer_nr < 0)
         {
-            comb_boundary = storage.raftOutline.offset(MM2INT(0.1));
+            comb_boundary_minimum = storage.raftOutline.offset(MM2INT(0.1));
+            comb_boundary_preferred = comb_boundary_minimum;
         }
         else
         {
@@ -196,54 +208,55 @@ Polygons LayerPlan::computeCombBoundary(const CombBoundary boundary_type)
                 {
                     continue;
                 }
-                coord_t offset;
-                switch(boundary_type)
-                {
-                    case CombBoundary::MINIMUM:
-                        offset = -mesh.settings.get<coord_t>("machine_nozzle_size") / 2 - 0.1 - mesh.settings.get<coord_t>("wall_line_width_0") / 2;
-                        break;
-                    case CombBoundary::PREFERRED:
-                        offset = -mesh.settings.get<coord_t>("machine_nozzle_size") * 3 / 2 - mesh.settings.get<coord_t>("wall_line_width_0") / 2;
-                        break;
-                    default:
-                        offset = 0;
-                        logWarning("Unknown combing boundary type. Did you forget to configure the comb offset for a new boundary type?");
-                        break;
-                }
+                const coord_t offset_minimum = -mesh.settings.get<coord_t>("machine_nozzle_size") / 2 - 0.1 - mesh.settings.get<coord_t>("wall_line_width_0") / 2;
+                const coord_t offset_preferred = -mesh.settings.get<coord_t>("machine_nozzle_size") * 3 / 2 - mesh.settings.get<coord_t>("wall_line_width_0") / 2;
 
                 const CombingMode combing_mode = mesh.settings.get<CombingMode>("retraction_combing");
+                if (combing_mode == CombingMode::OFF)
+                {
+                    continue;
+                }
+                Polygons top_and_bottom_most_fill; //Only needed for CombingMode::NO_OUTER_SURFACES. The same for every part.
+                if (combing_mode == CombingMode::NO_OUTER_SURFACES)
+                {
+                    for (const SliceLayerPart& part : layer.parts)
+                    {
+                        for (const SkinPart& skin_part : part.skin_parts)
+                        {
+                            top_and_bottom_most_fill.add(skin_part.top_most_surface_fill);
+                            top_and_bottom_most_fill.add(skin_part.bottom_most_surface_fill);
+                        }
+                    }
+                }
                 for (const SliceLayerPart& part : layer.parts)
                 {
+                    if (combing_mode == CombingMode::INFILL) // Add the infill (infill only)
+                    {
+                        comb_boundary_minimum.add(part.infill_area);
+                        comb_boundary_preferred.add(part.infill_area);
+                        continue;
+                    }
+                    std::vector<Polygons> offsets = part.outline.offsetMulti({ offset_minimum, offset_preferred });
                     if (combing_mode == CombingMode::ALL) // Add the increased outline offset (skin, infill and part of the inner walls)
                     {
-                        comb_boundary.add(part.outline.offset(offset));
+                        comb_boundary_minimum.add(std::move(offsets[0]));
+                        comb_boundary_preferred.add(std::move(offsets[1]));
                     }
                     else if (combing_mode == CombingMode::NO_SKIN) // Add the increased outline offset, subtract skin (infill and part of the inner walls)
                     {
-                        comb_boundary.add(part.outline.offset(offset).difference(part.inner_area.difference(part.infill_area)));
+                        const Polygons skin = part.inner_area.difference(part.infill_area);
+                        comb_boundary_minimum.add(std::move(offsets[0]).difference(skin));
+                        comb_boundary_preferred.add(std::move(offsets[1]).difference(skin));
                     }
                     else if (combing_mode == CombingMode::NO_OUTER_SURFACES)
                     {
-                        Polygons top_and_bottom_most_fill;
-                        for (const SliceLayerPart& part : layer.parts)
-                        {
-                            for (const SkinPart& skin_part : part.skin_parts)
-                            {
-                                top_and_bottom_most_fill.add(skin_part.top_most_surface_fill);
-                                top_and_bottom_most_fill.add(skin_part.bottom_most_surface_fill);
-                            }
-                        }
-                        comb_boundary.add(part.outline.offset(offset).difference(top_and_bottom_most_fill));
-                    }
-                    else if (combing_mode == CombingMode::INFILL) // Add the infill (infill only)
-                    {
-                        comb_boundary.add(part.infill_area);
+                        comb_boundary_minimum.add(std::move(offsets[0]).difference(top_and_bottom_most_fill));
+                        comb_boundary_preferred.add(std::move(offsets[1]).difference(top_and_bottom_most_fill));
                     }
                 }
             }
         }
     }
-    return comb_boundary;
 }
 
 void LayerPlan::setIsInside(bool _is_inside)
@@ -310,22 +323,31 @@ void LayerPlan::setMesh(const std::string mesh_id)
 }
 
 void LayerPlan::moveInsideCombBoundary(const coord_t distance, const std::optional<SliceLayerPart>& part)
+{
+    const std::optional<Point> p = getMoveInsideCombBoundaryPoint(getLastPlannedPositionOrStartingPosition(), distance, part);
+    if (p)
+    {
+        addTravel_simple(*p);
+        //Make sure the that any retraction happens after this move, not before it by starting a new move path.
+        forceNewPathStart();
+    }
+}
+
+std::optional<Point> LayerPlan::getMoveInsideCombBoundaryPoint(Point p, const coord_t distance, const std::optional<SliceLayerPart>& part) const
 {
     constexpr coord_t max_dist2 = MM2INT(2.0) * MM2INT(2.0); // if we are further than this distance, we conclude we are not inside even though we thought we were.
     // this function is to be used to move from the boundary of a part to inside the part
-    Point p = getLastPlannedPositionOrStartingPosition(); // copy, since we are going to move p
-    if (PolygonUtils::moveInside(comb_boundary_preferred, p, distance, max_dist2) != NO_INDEX)
+    if (comb_boundary_preferred_index.moveInside(p, distance, max_dist2) != NO_INDEX)
     {
         //Move inside again, so we move out of tight 90deg corners
-        PolygonUtils::moveInside(comb_boundary_preferred, p, distance, max_dist2);
+        comb_boundary_preferred_index.moveInside(p, distance, max_dist2);
         if (comb_boundary_preferred.inside(p) &&
             (part == std::nullopt || part->outline.inside(p)))
         {
-            addTravel_simple(p);
-            //Make sure the that any retraction happens after this move, not before it by starting a new move path.
-            forceNewPathStart();
+            return p;
         }
     }
+    return std::nullopt;
 }
 
 bool LayerPlan::getPrimeTowerIsPlanned(unsigned int extruder_nr) const
@@ -350,26 +372,28 @@ std::optional<std::pair<Point, bool>> LayerPlan::getFirstTravelDestinationState(
 
 GCodePath& LayerPlan::addTravel(const Point p, const bool force_retract)
 {
+    static const SettingKey<bool> retraction_hop_after_extruder_switch_key("retraction_hop_after_extruder_switch");
+    static const SettingKey<bool> retraction_enable_key("retraction_enable");
+    static const SettingKey<bool> retraction_hop_enabled_key("retraction_hop_enabled");
+
     const GCodePathConfig& travel_config = configs_storage.travel_config_per_extruder[getExtruder()];
     const RetractionConfig& retraction_config = storage.retraction_config_per_extruder[getExtruder()];
 
     GCodePath* path = getLatestPathWithConfig(travel_config, SpaceFillType::None);
 
-    bool combed = false;
-
     const ExtruderTrain* extruder = getLastPlannedExtruderTrain();
 
     const bool is_first_travel_of_extruder_after_switch = extruder_plans.back().paths.size() == 1 && (extruder_plans.size() > 1 || last_extruder_previous_layer != getExtruder());
-    bool bypass_combing = is_first_travel_of_extruder_after_switch && extruder->settings.get<bool>("retraction_hop_after_extruder_switch");
+    bool bypass_combing = is_first_travel_of_extruder_after_switch && extruder->settings.get(retraction_hop_after_extruder_switch_key);
 
     const bool is_first_travel_of_layer = !static_cast<bool>(last_planned_position);
-    const bool retraction_enable = extruder->settings.get<bool>("retraction_enable");
+    const bool retraction_enable = extruder->settings.get(retraction_enable_key);
     if (is_first_travel_of_layer)
     {
         bypass_combing = true; // first travel move is bogus; it is added after this and the previous layer have been planned in LayerPlanBuffer::addConnectingTravelMove
         first_travel_destination = p;
         first_travel_destination_is_inside = is_inside;
-        if (layer_nr == 0 && retraction_enable && extruder->settings.get<bool>("retraction_hop_enabled"))
+        if (layer_nr == 0 && retraction_enable && extruder->settings.get(retraction_hop_enabled_key))
         {
             path->retract = true;
             path->perform_z_hop = true;
@@ -382,114 +406,203 @@ GCodePath& LayerPlan::addTravel(const Point p, const bool force_retract)
         path->retract = true;
         if (comb == nullptr)
         {
-            path->perform_z_hop = extruder->settings.get<bool>("retraction_hop_enabled");
+            path->perform_z_hop = extruder->settings.get(retraction_hop_enabled_key);
         }
     }
 
     if (comb != nullptr && !bypass_combing)
     {
-        CombPaths combPaths;
+        //The combing is computed later for all travels of the layer at once, see resolveTravels.
+        assert(path == &extruder_plans.back().paths.back() && "The travel path must be the latest path of the layer.");
+        pending_travels.push_back(PendingTravel{ extruder_plans.size() - 1, extruder_plans.back().paths.size() - 1, path->points.size(), extruder, *last_planned_position, p, was_inside, is_inside });
+    }
+    else
+    {
+        constexpr bool combed = false;
+        finishTravel(*path, *extruder, retraction_config, last_planned_position, p, is_first_travel_of_layer, combed, was_inside, path->points.size());
+    }
 
-        // Divide by 2 to get the radius
-        // Multiply by 2 because if two lines start and end points places very close then will be applied combing with retractions. (Ex: for brim)
-        const coord_t max_distance_ignored = extruder->settings.get<coord_t>("machine_nozzle_tip_outer_diameter") / 2 * 2;
+    // must start new travel path as retraction can be enabled or not depending on path length, etc.
+    forceNewPathStart();
 
-        bool unretract_before_last_travel_move = false; // Decided when calculating the combing
-        combed = comb->calc(*extruder, *last_planned_position, p, combPaths, was_inside, is_inside, max_distance_ignored, unretract_before_last_travel_move);
-        if (combed)
-        {
-            bool retract = path->retract || (combPaths.size() > 1 && retraction_enable);
-            if (!retract)
-            { // check whether we want to retract
-                if (combPaths.throughAir)
-                {
-                    retract = retraction_enable;
-                }
-                else
-                {
-                    for (CombPath& combPath : combPaths)
-                    { // retract when path moves through a boundary
-                        if (combPath.cross_boundary)
-                        {
-                            retract = retraction_enable;
-                            break;
-                        }
+    GCodePath& ret = addTravel_simple(p, path);
+    was_inside = is_inside;
+    return ret;
+}
+
+void LayerPlan::resolveTravels()
+{
+    for (const PendingTravel& travel : pending_travels)
+    {
+        resolveTravel(travel);
+    }
+    pending_travels.clear();
+}
+
+bool LayerPlan::combTravel(const PendingTravel& travel, const coord_t max_distance_ignored, CombPaths& comb_paths, bool& unretract_before_last_travel_move)
+{
+    const ExtruderTrain& extruder = *travel.extruder;
+    if (!comb_travels)
+    {
+        return comb->calc(extruder, travel.start, travel.destination, comb_paths, travel.start_inside, travel.destination_inside, max_distance_ignored, unretract_before_last_travel_move);
+    }
+
+    const CombPathCache::Travel key{extruder.extruder_nr, travel.start, travel.destination, travel.start_inside, travel.destination_inside, max_distance_ignored};
+    const std::shared_ptr<const CombPathCache::Result> cached = comb_travels->find(key);
+    if (cached && (!cached->uses_outside_boundary || comb->isSameLayerOutlines(extruder, cached->layer_outlines_hash, cached->layer_outlines))) //The hash only finds candidates, the outlines are compared exactly.
+    {
+        comb_paths = cached->comb_paths;
+        unretract_before_last_travel_move = cached->unretract_before_last_travel_move;
+        return cached->combed;
+    }
+
+    comb->resetOutsideBoundaryUsed();
+    const bool combed = comb->calc(extruder, travel.start, travel.destination, comb_paths, travel.start_inside, travel.destination_inside, max_distance_ignored, unretract_before_last_travel_move);
+    const bool uses_outside_boundary = comb->isOutsideBoundaryUsed();
+    std::shared_ptr<const CompactPolygons> layer_outlines = uses_outside_boundary ? comb->getCompactLayerOutlines(extruder) : nullptr;
+    if (uses_outside_boundary && !layer_outlines)
+    {
+        return combed; //The outlines are too large to compare with later, so this can't be reused.
+    }
+    const size_t layer_outlines_hash = uses_outside_boundary ? comb->getLayerOutlinesHash(extruder) : 0;
+    comb_travels->insert(key, std::make_shared<const CombPathCache::Result>(CombPathCache::Result{combed, comb_paths, unretract_before_last_travel_move, uses_outside_boundary, layer_outlines_hash, std::move(layer_outlines)}));
+    return combed;
+}
+
+void LayerPlan::resolveTravel(const PendingTravel& travel)
+{
+    static const SettingKey<bool> retraction_enable_key("retraction_enable");
+    static const SettingKey<coord_t> machine_nozzle_tip_outer_diameter_key("machine_nozzle_tip_outer_diameter");
+    static const SettingKey<bool> limit_support_retractions_key("limit_support_retractions");
+    static const SettingKey<coord_t> meshfix_maximum_travel_resolution_key("meshfix_maximum_travel_resolution");
+    static const SettingKey<coord_t> retraction_combing_max_distance_key("retraction_combing_max_distance");
+
+    GCodePath* path = &extruder_plans[travel.extruder_plan_idx].paths[travel.path_idx];
+    const ExtruderTrain* extruder = travel.extruder;
+    const bool retraction_enable = extruder->settings.get(retraction_enable_key);
+    const Point p = travel.destination;
+
+    CombPaths combPaths;
+
+    // Divide by 2 to get the radius
+    // Multiply by 2 because if two lines start and end points places very close then will be applied combing with retractions. (Ex: for brim)
+    const coord_t max_distance_ignored = extruder->settings.get(machine_nozzle_tip_outer_diameter_key) / 2 * 2;
+
+    bool unretract_before_last_travel_move = false; // Decided when calculating the combing
+    const bool combed = combTravel(travel, max_distance_ignored, combPaths, unretract_before_last_travel_move);
+    if (!combed)
+    {
+        LayerStatistics::add("combing fallbacks", layer_nr, 1);
+    }
+    if (combed)
+    {
+        bool retract = path->retract || (combPaths.size() > 1 && retraction_enable);
+        if (!retract)
+        { // check whether we want to retract
+            if (combPaths.throughAir)
+            {
+                retract = retraction_enable;
+            }
+            else
+            {
+                for (CombPath& combPath : combPaths)
+                { // retract when path moves through a boundary
+                    if (combPath.cross_boundary)
+                    {
+                        retract = retraction_enable;
+                        break;
                     }
                 }
-                if (combPaths.size() == 1)
-                {
-                    CombPath comb_path = combPaths[0];
-                    if (extruder->settings.get<bool>("limit_support_retractions") &&
-                        combPaths.throughAir && !comb_path.cross_boundary && comb_path.size() == 2 && comb_path[0] == *last_planned_position && comb_path[1] == p)
-                    { // limit the retractions from support to support, which didn't cross anything
-                        retract = false;
-                    }
+            }
+            if (combPaths.size() == 1)
+            {
+                CombPath comb_path = combPaths[0];
+                if (extruder->settings.get(limit_support_retractions_key) &&
+                    combPaths.throughAir && !comb_path.cross_boundary && comb_path.size() == 2 && comb_path[0] == travel.start && comb_path[1] == p)
+                { // limit the retractions from support to support, which didn't cross anything
+                    retract = false;
                 }
             }
+        }
 
-            const coord_t maximum_travel_resolution = extruder->settings.get<coord_t>("meshfix_maximum_travel_resolution");
-            coord_t distance = 0;
-            Point last_point((last_planned_position) ? *last_planned_position : Point(0, 0));
-            for (CombPath& combPath : combPaths)
-            { // add all comb paths (don't do anything special for paths which are moving through air)
-                if (combPath.empty())
-                {
-                    continue;
-                }
-                for (Point& comb_point : combPath)
+        const coord_t maximum_travel_resolution = extruder->settings.get(meshfix_maximum_travel_resolution_key);
+        coord_t distance = 0;
+        Point last_point = travel.start;
+        std::vector<Point> comb_points; //Inserted before the destination of the travel, which is already in the path.
+        for (CombPath& combPath : combPaths)
+        { // add all comb paths (don't do anything special for paths which are moving through air)
+            if (combPath.empty())
+            {
+                continue;
+            }
+            for (Point& comb_point : combPath)
+            {
+                const bool has_previous_point = !comb_points.empty() || travel.first_point_idx > 0;
+                const Point previous_point = !comb_points.empty() ? comb_points.back() : (has_previous_point ? path->points[travel.first_point_idx - 1] : Point());
+                if (!has_previous_point || vSize2(previous_point - comb_point) > maximum_travel_resolution * maximum_travel_resolution)
                 {
-                    if (path->points.empty() || vSize2(path->points.back() - comb_point) > maximum_travel_resolution * maximum_travel_resolution)
-                    {
-                        path->points.push_back(comb_point);
-                        distance += vSize(last_point - comb_point);
-                        last_point = comb_point;
-                    }
+                    comb_points.push_back(comb_point);
+                    distance += vSize(last_point - comb_point);
+                    last_point = comb_point;
                 }
-                distance += vSize(last_point - p);
-                const coord_t retract_threshold = extruder->settings.get<coord_t>("retraction_combing_max_distance");
-                path->retract = retract || (retract_threshold > 0 && distance > retract_threshold && retraction_enable);
-                // don't perform a z-hop
             }
-            // Whether to unretract before the last travel move of the travel path, which comes before the wall to be printed.
-            // This should be true when traveling towards an outer wall to make sure that the unretraction will happen before the
-            // last travel move BEFORE going to that wall. This way, the nozzle doesn't sit still on top of the outer wall's
-            // path while it is unretracting, avoiding possible blips.
-            path->unretract_before_last_travel_move = path->retract && unretract_before_last_travel_move;
+            distance += vSize(last_point - p);
+            const coord_t retract_threshold = extruder->settings.get(retraction_combing_max_distance_key);
+            path->retract = retract || (retract_threshold > 0 && distance > retract_threshold && retraction_enable);
+            // don't perform a z-hop
         }
+        path->points.insert(travel.first_point_idx, comb_points);
+        // Whether to unretract before the last travel move of the travel path, which comes before the wall to be printed.
+        // This should be true when traveling towards an outer wall to make sure that the unretraction will happen before the
+        // last travel move BEFORE going to that wall. This way, the nozzle doesn't sit still on top of the outer wall's
+        // path while it is unretracting, avoiding possible blips.
+        path->unretract_before_last_travel_move = path->retract && unretract_before_last_travel_move;
     }
 
+    constexpr bool is_first_travel_of_layer = false; //The first travel is never combed.
+    const RetractionConfig& retraction_config = storage.retraction_config_per_extruder[extruder_plans[travel.extruder_plan_idx].extruder_nr];
+    finishTravel(*path, *extruder, retraction_config, travel.start, p, is_first_travel_of_layer, combed, travel.start_inside, travel.first_point_idx);
+}
+
+void LayerPlan::finishTravel(GCodePath& path, const ExtruderTrain& extruder, const RetractionConfig& retraction_config, const std::optional<Point> start, const Point destination, const bool is_first_travel_of_layer, const bool combed, const bool start_inside, const size_t first_point_idx)
+{
+    static const SettingKey<bool> retraction_enable_key("retraction_enable");
+    static const SettingKey<bool> retraction_hop_enabled_key("retraction_hop_enabled");
+    static const SettingKey<size_t> wall_line_count_key("wall_line_count");
+    static const SettingKey<coord_t> wall_line_width_0_key("wall_line_width_0");
+    static const SettingKey<coord_t> wall_line_width_x_key("wall_line_width_x");
+    static const SettingKey<Ratio> initial_layer_line_width_factor_key("initial_layer_line_width_factor");
+
+    const bool retraction_enable = extruder.settings.get(retraction_enable_key);
+
     // CURA-6675:
     // Retraction Minimal Travel Distance should work for all travel moves. If the travel move is shorter than the
     // Retraction Minimal Travel Distance, retraction should be disabled.
-    if (!is_first_travel_of_layer && last_planned_position && shorterThen(*last_planned_position - p, retraction_config.retraction_min_travel_distance))
+    if (!is_first_travel_of_layer && start && shorterThen(*start - destination, retraction_config.retraction_min_travel_distance))
     {
-        path->retract = false;
-        path->perform_z_hop = false;
+        path.retract = false;
+        path.perform_z_hop = false;
     }
 
     // no combing? retract only when path is not shorter than minimum travel distance
-    if (!combed && !is_first_travel_of_layer && last_planned_position && !shorterThen(*last_planned_position - p, retraction_config.retraction_min_travel_distance))
+    if (!combed && !is_first_travel_of_layer && start && !shorterThen(*start - destination, retraction_config.retraction_min_travel_distance))
     {
-        if (was_inside) // when the previous location was from printing something which is considered inside (not support or prime tower etc)
+        if (start_inside) // when the previous location was from printing something which is considered inside (not support or prime tower etc)
         {               // then move inside the printed part, so that we don't ooze on the outer wall while retraction, but on the inside of the print.
-            assert (extruder != nullptr);
-            coord_t innermost_wall_line_width = extruder->settings.get<coord_t>((extruder->settings.get<size_t>("wall_line_count") > 1) ? "wall_line_width_x" : "wall_line_width_0");
+            coord_t innermost_wall_line_width = extruder.settings.get((extruder.settings.get(wall_line_count_key) > 1) ? wall_line_width_x_key : wall_line_width_0_key);
             if (layer_nr == 0)
             {
-                innermost_wall_line_width *= extruder->settings.get<Ratio>("initial_layer_line_width_factor");
+                innermost_wall_line_width *= extruder.settings.get(initial_layer_line_width_factor_key);
+            }
+            const std::optional<Point> inside = getMoveInsideCombBoundaryPoint(*start, innermost_wall_line_width);
+            if (inside)
+            {
+                path.points.insert(first_point_idx, { *inside });
             }
-            moveInsideCombBoundary(innermost_wall_line_width);
         }
-        path->retract = retraction_enable;
-        path->perform_z_hop = retraction_enable && extruder->settings.get<bool>("retraction_hop_enabled");
+        path.retract = retraction_enable;
+        path.perform_z_hop = retraction_enable && extruder.settings.get(retraction_hop_enabled_key);
     }
-
-    // must start new travel path as retraction can be enabled or not depending on path length, etc.
-    forceNewPathStart();
-
-    GCodePath& ret = addTravel_simple(p, path);
-    was_inside = is_inside;
-    return ret;
 }
 
 GCodePath& LayerPlan::addTravel_simple(Point p, GCodePath* path)
@@ -586,6 +699,7 @@ void LayerPlan::addPolygonsByOptimizer(const Polygons& polygons, const GCodePath
         return;
     }
     PathOrderOptimizer<ConstPolygonPointer> orderOptimizer(start_near_location ? start_near_location.value() : getLastPlannedPositionOrStartingPosition(), z_seam_config);
+    orderOptimizer.layer_nr = layer_nr;
     for(size_t poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
     {
         orderOptimizer.addPolygon(polygons[poly_idx]);
@@ -613,14 +727,18 @@ static constexpr float max_non_bridge_line_volume = MM2INT(100); // limit to acc
 
 void LayerPlan::addWallLine(const Point& p0, const Point& p1, const Settings& settings, const GCodePathConfig& non_bridge_config, const GCodePathConfig& bridge_config, float flow, const Ratio width_factor, float& non_bridge_line_volume, Ratio speed_factor, double distance_to_bridge_start)
 {
+    static const SettingKey<coord_t> bridge_wall_min_length_key("bridge_wall_min_length");
+    static const SettingKey<Ratio> bridge_wall_coast_key("bridge_wall_coast");
+    static const SettingKey<Ratio> wall_overhang_speed_factor_key("wall_overhang_speed_factor");
+
     const coord_t min_line_len = 5; // we ignore lines less than 5um long
     const double acceleration_segment_len = MM2INT(1); // accelerate using segments of this length
     const double acceleration_factor = 0.75; // must be < 1, the larger the value, the slower the acceleration
     const bool spiralize = false;
 
-    const coord_t min_bridge_line_len = settings.get<coord_t>("bridge_wall_min_length");
-    const Ratio bridge_wall_coast = settings.get<Ratio>("bridge_wall_coast");
-    const Ratio overhang_speed_factor = settings.get<Ratio>("wall_overhang_speed_factor");
+    const coord_t min_bridge_line_len = settings.get(bridge_wall_min_length_key);
+    const Ratio bridge_wall_coast = settings.get(bridge_wall_coast_key);
+    const Ratio overhang_speed_factor = settings.get(wall_overhang_speed_factor_key);
 
     Point cur_point = p0;
 
@@ -676,7 +794,7 @@ void LayerPlan::addWallLine(const Point& p0, const Point& p1, const Settings& se
                 {
                     // no coasting required, just normal segment using non-bridge config
                     addExtrusionMove(segment_end, non_bridge_config, SpaceFillType::Polygons, segment_flow, width_factor, spiralize,
-                        (overhang_mask.empty() || (!overhang_mask.inside(p0, true) && !overhang_mask.inside(p1, true))) ? speed_factor : overhang_speed_factor);
+                        (overhang_mask.empty() || (!overhang_mask_prepared.inside(p0, true) && !overhang_mask_prepared.inside(p1, true))) ? speed_factor : overhang_speed_factor);
                 }
 
                 distance_to_bridge_start -= len;
@@ -685,7 +803,7 @@ void LayerPlan::addWallLine(const Point& p0, const Point& p1, const Settings& se
             {
                 // no coasting required, just normal segment using non-bridge config
                 addExtrusionMove(segment_end, non_bridge_config, SpaceFillType::Polygons, segment_flow, width_factor, spiralize,
-                    (overhang_mask.empty() || (!overhang_mask.inside(p0, true) && !overhang_mask.inside(p1, true))) ? speed_factor : overhang_speed_factor);
+                    (overhang_mask.empty() || (!overhang_mask_prepared.inside(p0, true) && !overhang_mask_prepared.inside(p1, true))) ? speed_factor : overhang_speed_factor);
             }
             non_bridge_line_volume += vSize(cur_point - segment_end) * segment_flow * width_factor * speed_factor * non_bridge_config.getSpeed();
             cur_point = segment_end;
@@ -702,12 +820,12 @@ void LayerPlan::addWallLine(const Point& p0, const Point& p1, const Settings& se
     {
         // no bridges required
         addExtrusionMove(p1, non_bridge_config, SpaceFillType::Polygons, flow, width_factor, spiralize,
-            (overhang_mask.empty() || (!overhang_mask.inside(p0, true) && !overhang_mask.inside(p1, true))) ? 1.0_r : overhang_speed_factor);
+            (overhang_mask.empty() || (!overhang_mask_prepared.inside(p0, true) && !overhang_mask_prepared.inside(p1, true))) ? 1.0_r : overhang_speed_factor);
     }
     else
     {
         // bridges may be required
-        if (PolygonUtils::polygonCollidesWithLineSegment(bridge_wall_mask, p0, p1))
+        if (collidesWithBridgeWallMask(p0, p1))
         {
             // the line crosses the boundary between supported and non-supported regions so one or more bridges are required
 
@@ -780,7 +898,7 @@ void LayerPlan::addWallLine(const Point& p0, const Point& p1, const Settings& se
             // if we haven't yet reached p1, fill the gap with non_bridge_config line
             addNonBridgeLine(p1);
         }
-        else if (bridge_wall_mask.inside(p0, true) && vSize(p0 - p1) >= min_bridge_line_len)
+        else if (bridge_wall_mask_prepared.inside(p0, true) && vSize(p0 - p1) >= min_bridge_line_len)
         {
             // both p0 and p1 must be above air (the result will be ugly!)
             addExtrusionMove(p1, bridge_config, SpaceFillType::Polygons, flow, width_factor);
@@ -819,6 +937,14 @@ void LayerPlan::addWall(ConstPolygonRef wall, int start_idx, const Settings& set
 
 void LayerPlan::addWall(const ExtrusionLine& wall, int start_idx, const Settings& settings, const GCodePathConfig& non_bridge_config, const GCodePathConfig& bridge_config, coord_t wall_0_wipe_dist, float flow_ratio, bool always_retract, const bool is_closed, const bool is_reversed, const bool is_linked_path)
 {
+    static const SettingKey<coord_t> bridge_wall_min_length_key("bridge_wall_min_length");
+    static const SettingKey<coord_t> small_feature_max_length_key("small_feature_max_length");
+    static const SettingKey<int> meshfix_maximum_extrusion_area_deviation_key("meshfix_maximum_extrusion_area_deviation");
+    static const SettingKey<coord_t> meshfix_maximum_resolution_key("meshfix_maximum_resolution");
+    static const SettingKey<coord_t> meshfix_extrusion_width_resolution_key("meshfix_extrusion_width_resolution");
+    static const SettingKey<Ratio> small_feature_speed_factor_key("small_feature_speed_factor");
+    static const SettingKey<Ratio> small_feature_speed_factor_0_key("small_feature_speed_factor_0");
+
     if (wall.empty())
     {
         return;
@@ -833,99 +959,116 @@ void LayerPlan::addWall(const ExtrusionLine& wall, int start_idx, const Settings
     double speed_factor = 1.0; // start first line at normal speed
     coord_t distance_to_bridge_start = 0; // will be updated before each line is processed
 
-    const coord_t min_bridge_line_len = settings.get<coord_t>("bridge_wall_min_length");
+    const coord_t min_bridge_line_len = settings.get(bridge_wall_min_length_key);
 
     const Ratio nominal_line_width_multiplier = 1.0 / Ratio(non_bridge_config.getLineWidth()); // we multiply the flow with the actual wanted line width (for that junction), and then multiply with this
 
-    // helper function to calculate the distance from the start of the current wall line to the first bridge segment
+    // helper function to calculate the distance from the start of a wall line to the first bridge segment on that line
+    // returns whether there is a bridge segment on that line, otherwise the distance is the length of the line that is not over air
 
-    auto computeDistanceToBridgeStart = [&](unsigned current_index)
+    auto getDistanceToBridgeStartOnLine = [&](const size_t point_idx, coord_t& distance_on_line) -> bool
     {
-        distance_to_bridge_start = 0;
+        distance_on_line = 0;
+        const ExtrusionJunction& p0 = wall[point_idx];
+        const ExtrusionJunction& p1 = wall[(point_idx + 1) % wall.size()];
 
-        if (!bridge_wall_mask.empty())
+        if (collidesWithBridgeWallMask(p0.p, p1.p))
         {
-            // there is air below the part so iterate through the lines that have not yet been output accumulating the total distance to the first bridge segment
-            for (unsigned point_idx = current_index; point_idx < wall.size(); ++point_idx)
-            {
-                const ExtrusionJunction& p0 = wall[point_idx];
-                const ExtrusionJunction& p1 = wall[(point_idx + 1) % wall.size()];
+            // the line crosses the boundary between supported and non-supported regions so it will contain one or more bridge segments
 
-                if (PolygonUtils::polygonCollidesWithLineSegment(bridge_wall_mask, p0.p, p1.p))
-                {
-                    // the line crosses the boundary between supported and non-supported regions so it will contain one or more bridge segments
-
-                    // determine which segments of the line are bridges
+            // determine which segments of the line are bridges
 
-                    Polygons line_polys;
-                    line_polys.addLine(p0.p, p1.p);
-                    constexpr bool restitch = false; // only a single line doesn't need stitching
-                    line_polys = bridge_wall_mask.intersectionPolyLines(line_polys, restitch);
+            Polygons line_polys;
+            line_polys.addLine(p0.p, p1.p);
+            constexpr bool restitch = false; // only a single line doesn't need stitching
+            line_polys = bridge_wall_mask.intersectionPolyLines(line_polys, restitch);
 
-                    while (line_polys.size() > 0)
+            while (line_polys.size() > 0)
+            {
+                // find the bridge line segment that's nearest to p0
+                int nearest = 0;
+                float smallest_dist2 = vSize2f(p0.p - line_polys[0][0]);
+                for(unsigned i = 1; i < line_polys.size(); ++i)
+                {
+                    float dist2 = vSize2f(p0.p - line_polys[i][0]);
+                    if (dist2 < smallest_dist2)
                     {
-                        // find the bridge line segment that's nearest to p0
-                        int nearest = 0;
-                        float smallest_dist2 = vSize2f(p0.p - line_polys[0][0]);
-                        for(unsigned i = 1; i < line_polys.size(); ++i)
-                        {
-                            float dist2 = vSize2f(p0.p - line_polys[i][0]);
-                            if (dist2 < smallest_dist2)
-                            {
-                                nearest = i;
-                                smallest_dist2 = dist2;
-                            }
-                        }
-                        ConstPolygonRef bridge = line_polys[nearest];
-
-                        // set b0 to the nearest vertex and b1 the furthest
-                        Point b0 = bridge[0];
-                        Point b1 = bridge[1];
-
-                        if (vSize2f(p0.p - b1) < vSize2f(p0.p - b0))
-                        {
-                            // swap vertex order
-                            b0 = bridge[1];
-                            b1 = bridge[0];
-                        }
+                        nearest = i;
+                        smallest_dist2 = dist2;
+                    }
+                }
+                ConstPolygonRef bridge = line_polys[nearest];
 
-                        distance_to_bridge_start += vSize(b0 - p0.p);
+                // set b0 to the nearest vertex and b1 the furthest
+                Point b0 = bridge[0];
+                Point b1 = bridge[1];
 
-                        const double bridge_line_len = vSize(b1 - b0);
+                if (vSize2f(p0.p - b1) < vSize2f(p0.p - b0))
+                {
+                    // swap vertex order
+                    b0 = bridge[1];
+                    b1 = bridge[0];
+                }
 
-                        if (bridge_line_len >= min_bridge_line_len)
-                        {
-                            // job done, we have found the first bridge line
-                            return;
-                        }
+                distance_on_line += vSize(b0 - p0.p);
 
-                        distance_to_bridge_start += bridge_line_len;
+                const double bridge_line_len = vSize(b1 - b0);
 
-                        // finished with this segment
-                        line_polys.remove(nearest);
-                    }
-                }
-                else if (!bridge_wall_mask.inside(p0.p, true))
+                if (bridge_line_len >= min_bridge_line_len)
                 {
-                    // none of the line is over air
-                    distance_to_bridge_start += vSize(p1.p - p0.p);
+                    // job done, we have found the first bridge line
+                    return true;
                 }
-            }
 
-            // we have got all the way to the end of the wall without finding a bridge segment so disable coasting by setting distance_to_bridge_start back to 0
+                distance_on_line += bridge_line_len;
 
-            distance_to_bridge_start = 0;
+                // finished with this segment
+                line_polys.remove(nearest);
+            }
+        }
+        else if (!bridge_wall_mask_prepared.inside(p0.p, true))
+        {
+            // none of the line is over air
+            distance_on_line += vSize(p1.p - p0.p);
         }
+        return false;
     };
 
+    // for each line of the wall, the distance from its start to the first bridge segment when following the lines that have not yet been output
+    // if the end of the wall is reached without finding a bridge segment, the distance is 0 to disable coasting
+    // this is computed for all lines in one pass from the end of the wall, so that each line is only checked against the bridge_wall_mask once
+
+    std::vector<coord_t> distances_to_bridge_start;
+    if (!bridge_wall_mask.empty())
+    {
+        distances_to_bridge_start.resize(wall.size(), 0);
+        bool bridge_ahead = false;
+        coord_t distance_ahead = 0;
+        for (size_t point_idx = wall.size(); point_idx-- > 0; )
+        {
+            coord_t distance_on_line;
+            if (getDistanceToBridgeStartOnLine(point_idx, distance_on_line))
+            {
+                bridge_ahead = true;
+                distance_ahead = distance_on_line;
+            }
+            else
+            {
+                distance_ahead += distance_on_line;
+            }
+            distances_to_bridge_start[point_idx] = bridge_ahead ? distance_ahead : 0;
+        }
+    }
+
     bool first_line = true;
-    const coord_t small_feature_max_length = settings.get<coord_t>("small_feature_max_length");
+    const coord_t small_feature_max_length = settings.get(small_feature_max_length_key);
     const bool is_small_feature = (small_feature_max_length > 0) && cura::shorterThan(wall, small_feature_max_length);
-    Ratio small_feature_speed_factor = settings.get<Ratio>((layer_nr == 0) ? "small_feature_speed_factor_0" : "small_feature_speed_factor");
+    Ratio small_feature_speed_factor = settings.get((layer_nr == 0) ? small_feature_speed_factor_0_key : small_feature_speed_factor_key);
     const Velocity min_speed = fan_speed_layer_time_settings_per_extruder[getLastPlannedExtruderTrain()->extruder_nr].cool_min_speed;
     small_feature_speed_factor = std::max((double)small_feature_speed_factor, (double)(min_speed / non_bridge_config.getSpeed()));
-    const coord_t max_area_deviation = std::max(settings.get<int>("meshfix_maximum_extrusion_area_deviation"), 1); //Square micrometres!
-    const coord_t max_resolution = std::max(settings.get<coord_t>("meshfix_maximum_resolution"), coord_t(1));
+    const coord_t max_area_deviation = std::max(settings.get(meshfix_maximum_extrusion_area_deviation_key), 1); //Square micrometres!
+    const coord_t max_resolution = std::max(settings.get(meshfix_maximum_resolution_key), coord_t(1));
+    const coord_t width_resolution = settings.getOrDefault(meshfix_extrusion_width_resolution_key, coord_t(0)); //0 to print the exact widths.
 
     ExtrusionJunction p0 = wall[start_idx];
 
@@ -937,7 +1080,7 @@ void LayerPlan::addWall(const ExtrusionLine& wall, int start_idx, const Settings
 
         if(!bridge_wall_mask.empty())
         {
-            computeDistanceToBridgeStart((wall.size() + start_idx + point_idx * direction - 1) % wall.size());
+            distance_to_bridge_start = distances_to_bridge_start[(wall.size() + start_idx + point_idx * direction - 1) % wall.size()];
         }
 
         if(first_line)
@@ -975,11 +1118,30 @@ void LayerPlan::addWall(const ExtrusionLine& wall, int start_idx, const Settings
         const size_t pieces = std::max(size_t(1), std::min(pieces_limit_deviation, pieces_limit_resolution)); //Resolution overrides deviation, if resolution is a constraint.
         const coord_t piece_length = round_divide(line_length, pieces);
 
-        for(size_t piece = 0; piece < pieces; ++piece)
+        const auto get_piece_width = [&](const size_t piece)
         {
             const float average_progress = (float(piece) + 0.5) / pieces; //How far along this line to sample the line width in the middle of this piece.
             const coord_t line_width = p0.w + average_progress * delta_line_width;
-            const Point destination = p0.p + normal(line_vector, piece_length * (piece + 1));
+            if (width_resolution <= 0)
+            {
+                return line_width;
+            }
+            return std::max(width_resolution, round_divide_signed(line_width, width_resolution) * width_resolution);
+        };
+
+        for(size_t piece = 0; piece < pieces; )
+        {
+            const coord_t line_width = get_piece_width(piece);
+            size_t piece_end = piece + 1;
+            if (width_resolution > 0)
+            {
+                //The pieces are on one straight line, so the following pieces that got rounded to the same width are printed as one.
+                while (piece_end < pieces && get_piece_width(piece_end) == line_width)
+                {
+                    piece_end++;
+                }
+            }
+            const Point destination = p0.p + normal(line_vector, piece_length * piece_end);
             if(is_small_feature)
             {
                 constexpr bool spiralize = false;
@@ -990,6 +1152,7 @@ void LayerPlan::addWall(const ExtrusionLine& wall, int start_idx, const Settings
                 const Point origin = p0.p + normal(line_vector, piece_length * piece);
                 addWallLine(origin, destination, settings, non_bridge_config, bridge_config, flow_ratio, line_width * nominal_line_width_multiplier, non_bridge_line_volume, speed_factor, distance_to_bridge_start);
             }
+            piece = piece_end;
         }
 
         p0 = p1;
@@ -999,7 +1162,7 @@ void LayerPlan::addWall(const ExtrusionLine& wall, int start_idx, const Settings
     {
         if (!bridge_wall_mask.empty())
         {
-            computeDistanceToBridgeStart((start_idx + wall.size() - 1) % wall.size());
+            distance_to_bridge_start = distances_to_bridge_start[(start_idx + wall.size() - 1) % wall.size()];
         }
 
         if (wall_0_wipe_dist > 0 && !is_linked_path)
@@ -1068,6 +1231,7 @@ void LayerPlan::addWalls
 {
     //TODO: Deprecated in favor of ExtrusionJunction version below.
     PathOrderOptimizer<ConstPolygonPointer> orderOptimizer(getLastPlannedPositionOrStartingPosition(), z_seam_config);
+    orderOptimizer.layer_nr = layer_nr;
     for(size_t poly_idx = 0; poly_idx < walls.size(); poly_idx++)
     {
         orderOptimizer.addPolygon(walls[poly_idx]);
@@ -1117,12 +1281,15 @@ void LayerPlan::addLinesByOptimizer
     }
     constexpr bool detect_loops = true;
     PathOrderOptimizer<ConstPolygonPointer> order_optimizer(near_start_location.value_or(getLastPlannedPositionOrStartingPosition()), ZSeamConfig(), detect_loops, &boundary, reverse_print_direction);
+    order_optimizer.refinement_time_budget = travel_order_refinement_budget;
+    order_optimizer.refine_until_converged = Application::getInstance().current_slice->scene.current_mesh_group->settings.getOrDefault<bool>("deterministic_output", false);
     for(size_t line_idx = 0; line_idx < polygons.size(); line_idx++)
     {
         order_optimizer.addPolyline(polygons[line_idx]);
     }
     order_optimizer.optimize();
-    
+    travel_order_refinement_budget = order_optimizer.refinement_time_budget;
+
     addLinesInGivenOrder(order_optimizer.paths, config, space_fill_type, wipe_dist, flow_ratio, fan_speed);
 }
 
@@ -1318,6 +1485,12 @@ void LayerPlan::spiralizeWallSlice(const GCodePathConfig& config, ConstPolygonRe
     Polygons last_wall_polygons;
     last_wall_polygons.add(last_wall);
     const int max_dist2 = config.getLineWidth() * config.getLineWidth() * 4; // (2 * lineWidth)^2;
+    // Only points on the last wall closer than sqrt(max_dist2) are used, so a grid with that cell size finds all of them without going through the whole wall for each point.
+    std::unique_ptr<LocToLineGrid> last_wall_grid;
+    if (smooth_contours && !is_bottom_layer)
+    {
+        last_wall_grid = PolygonUtils::createLocToLineGrid(last_wall_polygons, config.getLineWidth() * 2);
+    }
 
     double total_length = 0.0; // determine the length of the complete wall
     Point p0 = origin;
@@ -1387,13 +1560,13 @@ void LayerPlan::spiralizeWallSlice(const GCodePathConfig& config, ConstPolygonRe
         if (smooth_contours && !is_bottom_layer && wall_point_idx < n_points)
         {
             // now find the point on the last wall that is closest to p
-            ClosestPolygonPoint cpp = PolygonUtils::findClosest(p, last_wall_polygons);
+            std::optional<ClosestPolygonPoint> cpp = PolygonUtils::findClose(p, last_wall_polygons, *last_wall_grid);
 
             // if we found a point and it's not further away than max_dist2, use it
-            if (cpp.isValid() && vSize2(cpp.location - p) <= max_dist2)
+            if (cpp && cpp->isValid() && vSize2(cpp->location - p) <= max_dist2)
             {
                 // interpolate between cpp.location and p depending on how far we have progressed along wall
-                addExtrusionMove(cpp.location + (p - cpp.location) * (wall_length / total_length), config, SpaceFillType::Polygons, flow, width_factor, spiralize, speed_factor);
+                addExtrusionMove(cpp->location + (p - cpp->location) * (wall_length / total_length), config, SpaceFillType::Polygons, flow, width_factor, spiralize, speed_factor);
             }
             else
             {
@@ -1480,66 +1653,107 @@ void ExtruderPlan::forceMinimalLayerTime(double minTime, double minimalSpeed, do
     }
 }
 
-TimeMaterialEstimates ExtruderPlan::computeNaiveTimeEstimates(Point starting_position)
+void ExtruderPlan::computeNaiveTimeEstimates(const std::optional<Point> starting_position)
+{
+    path_from_starting_position.reset();
+    time_until_end.clear();
+    std::optional<Point> p0 = starting_position;
+    for (size_t path_idx = 0; path_idx < paths.size(); path_idx++)
+    {
+        GCodePath& path = paths[path_idx];
+        if (!p0 && !path.points.empty())
+        {
+            //Only the travel to the first point depends on where the head was. Estimate it once that is known.
+            path_from_starting_position = path_idx;
+            p0 = path.points.front();
+        }
+        p0 = computeNaiveTimeEstimates(path, p0 ? *p0 : Point(0, 0));
+    }
+}
+
+Point ExtruderPlan::computeNaiveTimeEstimates(GCodePath& path, Point starting_position) const
 {
-    TimeMaterialEstimates ret;
+    // Start from scratch, so that the estimates are never counted twice if they need to be computed again.
+    path.estimates.reset();
     Point p0 = starting_position;
 
-    bool was_retracted = false; // wrong assumption; won't matter that much. (TODO)
-    for (GCodePath& path : paths)
+    constexpr bool was_retracted = false; // wrong assumption; won't matter that much. (TODO)
+    bool is_extrusion_path = false;
+    double* path_time_estimate;
+    double& material_estimate = path.estimates.material;
+    if (!path.isTravelPath())
     {
-        bool is_extrusion_path = false;
-        double* path_time_estimate;
-        double& material_estimate = path.estimates.material;
-        if (!path.isTravelPath())
+        is_extrusion_path = true;
+        path_time_estimate = &path.estimates.extrude_time;
+    }
+    else 
+    {
+        if (path.retract)
         {
-            is_extrusion_path = true;
-            path_time_estimate = &path.estimates.extrude_time;
+            path_time_estimate = &path.estimates.retracted_travel_time;
         }
         else 
         {
+            path_time_estimate = &path.estimates.unretracted_travel_time;
+        }
+        if (path.retract != was_retracted)
+        { // handle retraction times
+            double retract_unretract_time;
             if (path.retract)
             {
-                path_time_estimate = &path.estimates.retracted_travel_time;
+                retract_unretract_time = retraction_config.distance / retraction_config.speed;
             }
             else 
             {
-                path_time_estimate = &path.estimates.unretracted_travel_time;
-            }
-            if (path.retract != was_retracted)
-            { // handle retraction times
-                double retract_unretract_time;
-                if (path.retract)
-                {
-                    retract_unretract_time = retraction_config.distance / retraction_config.speed;
-                }
-                else 
-                {
-                    retract_unretract_time = retraction_config.distance / retraction_config.primeSpeed;
-                }
-                path.estimates.retracted_travel_time += 0.5 * retract_unretract_time;
-                path.estimates.unretracted_travel_time += 0.5 * retract_unretract_time;
+                retract_unretract_time = retraction_config.distance / retraction_config.primeSpeed;
             }
+            path.estimates.retracted_travel_time += 0.5 * retract_unretract_time;
+            path.estimates.unretracted_travel_time += 0.5 * retract_unretract_time;
         }
-        for(Point& p1 : path.points)
+    }
+    // The whole path has the same speed and line width, so only its length needs to be computed per point.
+    double path_length = 0.0;
+    for (const Point& p1 : path.points)
+    {
+        path_length += vSizeMM(p0 - p1);
+        p0 = p1;
+    }
+    if (is_extrusion_path)
+    {
+        material_estimate += path_length * INT2MM(layer_thickness) * INT2MM(path.config->getLineWidth());
+    }
+    *path_time_estimate += path_length / (path.config->getSpeed() * path.speed_factor);
+    return p0;
+}
+
+const std::vector<double>& ExtruderPlan::getTimeUntilEnd()
+{
+    if (time_until_end.size() != paths.size() + 1)
+    {
+        time_until_end.resize(paths.size() + 1);
+        time_until_end.back() = 0.0;
+        // Add up from the end, in the same order as walking back through the paths would.
+        for (size_t path_idx = paths.size(); path_idx-- > 0;)
         {
-            double length = vSizeMM(p0 - p1);
-            if (is_extrusion_path)
-            {
-                material_estimate += length * INT2MM(layer_thickness) * INT2MM(path.config->getLineWidth());
-            }
-            double thisTime = length / (path.config->getSpeed() * path.speed_factor);
-            *path_time_estimate += thisTime;
-            p0 = p1;
+            time_until_end[path_idx] = time_until_end[path_idx + 1] + paths[path_idx].estimates.getTotalTime();
         }
-        estimates += path.estimates;
     }
-    return estimates;
+    return time_until_end;
 }
 
 void ExtruderPlan::processFanSpeedAndMinimalLayerTime(bool force_minimal_layer_time, Point starting_position)
 {
-    TimeMaterialEstimates estimates = computeNaiveTimeEstimates(starting_position);
+    if (path_from_starting_position)
+    {
+        computeNaiveTimeEstimates(paths[*path_from_starting_position], starting_position);
+    }
+    this->estimates.reset();
+    for (const GCodePath& path : paths)
+    {
+        this->estimates += path.estimates;
+    }
+    TimeMaterialEstimates estimates = this->estimates; //Copy, because the minimal layer time adjusts the stored estimates.
+    time_until_end.clear();
     totalPrintTime = estimates.getTotalTime();
     if (force_minimal_layer_time)
     {
@@ -1605,8 +1819,44 @@ void ExtruderPlan::processFanSpeedAndMinimalLayerTime(bool force_minimal_layer_t
     }
 }
 
+void LayerPlan::computeNaiveTimeEstimates()
+{
+    if (has_naive_time_estimates)
+    {
+        return;
+    }
+    std::optional<Point> starting_position; //Where the previous layer ends may not be planned yet.
+    for (ExtruderPlan& extruder_plan : extruder_plans)
+    {
+        extruder_plan.computeNaiveTimeEstimates(starting_position);
+        if (!extruder_plan.paths.empty() && !extruder_plan.paths.back().points.empty())
+        {
+            starting_position = extruder_plan.paths.back().points.back();
+        }
+    }
+    has_naive_time_estimates = true;
+}
+
+size_t LayerPlan::getMemoryUsage() const
+{
+    size_t bytes = point_arena->capacity() * sizeof(Point);
+    for (const ExtruderPlan& extruder_plan : extruder_plans)
+    {
+        bytes += extruder_plan.paths.capacity() * sizeof(GCodePath);
+    }
+    for (const Polygons* polygons : {&comb_boundary_minimum, &comb_boundary_preferred, &bridge_wall_mask, &overhang_mask})
+    {
+        for (const ClipperLib::Path& path : *polygons)
+        {
+            bytes += path.capacity() * sizeof(Point);
+        }
+    }
+    return bytes;
+}
+
 void LayerPlan::processFanSpeedAndMinimalLayerTime(Point starting_position)
 {
+    computeNaiveTimeEstimates(); //In case it wasn't done yet by whoever planned the layer.
     for (unsigned int extr_plan_idx = 0; extr_plan_idx < extruder_plans.size(); extr_plan_idx++)
     {
         ExtruderPlan& extruder_plan = extruder_plans[extr_plan_idx];
@@ -1623,10 +1873,22 @@ void LayerPlan::processFanSpeedAndMinimalLayerTime(Point starting_position)
 
 void LayerPlan::writeGCode(GCodeExport& gcode)
 {
+    TraceZone zone("write layer", layer_nr);
+    resolveTravels();
     Communication* communication = Application::getInstance().communication;
     communication->setLayerForSend(layer_nr);
     communication->sendCurrentPosition(gcode.getPositionXY());
     gcode.setLayerNr(layer_nr);
+    if (LayerStatistics::isEnabled())
+    {
+        size_t path_count = 0;
+        for (const ExtruderPlan& extruder_plan : extruder_plans)
+        {
+            path_count += extruder_plan.paths.size();
+        }
+        LayerStatistics::add("paths", layer_nr, path_count);
+        LayerStatistics::add("peak memory bytes", layer_nr, getPeakMemoryUsage());
+    }
     
     gcode.writeLayerComment(layer_nr);
 
@@ -1892,10 +2154,28 @@ void LayerPlan::writeGCode(GCodeExport& gcode)
                 }
                 if (!coasting) // not same as 'else', cause we might have changed [coasting] in the line above...
                 { // normal path to gcode algorithm
+                    //Replace runs of line segments that lie on a circle by arc moves. The whole path has the same flow, so the arcs extrude as much per mm as the line segments.
+                    //An arc extrudes for its own length though, which is slightly longer than that of the line segments it replaces (at most by the fitting tolerance).
+                    std::vector<ArcFitting::Arc> arcs;
+                    if (path.points.size() >= ArcFitting::min_segments && gcode.supportsArcs() && extruder.settings.getOrDefault<bool>("arc_fitting_enable", false))
+                    {
+                        constexpr coord_t max_arc_radius = MM2INT(1000); //Larger arcs are practically straight.
+                        arcs = ArcFitting::fit(gcode.getPositionXY(), path.points.begin(), path.points.size(), extruder.settings.get<coord_t>("arc_fitting_tolerance"), max_arc_radius);
+                    }
+                    std::vector<ArcFitting::Arc>::const_iterator next_arc = arcs.begin();
                     for(unsigned int point_idx = 0; point_idx < path.points.size(); point_idx++)
                     {
                         const double extrude_speed = speed * path.speed_back_pressure_factor;
                         communication->sendLineTo(path.config->type, path.points[point_idx], path.getLineWidthForLayerView(), path.config->getLayerThickness(), extrude_speed);
+                        if (next_arc != arcs.end() && point_idx >= next_arc->first_idx)
+                        {
+                            if (point_idx == next_arc->last_idx) //The arc replaces the moves to all of its vertices, so it's written once it ends.
+                            {
+                                gcode.writeExtrusionArc(path.points[point_idx], next_arc->center, next_arc->counter_clockwise, extrude_speed, path.getExtrusionMM3perMM(), path.config->type, update_extrusion_offset);
+                                next_arc++;
+                            }
+                            continue;
+                        }
                         gcode.writeExtrusion(path.points[point_idx], extrude_speed, path.getExtrusionMM3perMM(), path.config->type, update_extrusion_offset);
                     }
                 }
@@ -1971,6 +2251,13 @@ void LayerPlan::writeGCode(GCodeExport& gcode)
     } // extruder plans /\  .
     
     gcode.updateTotalPrintTime();
+
+    //The paths are written, so release all of their points at once.
+    for (ExtruderPlan& extruder_plan : extruder_plans)
+    {
+        extruder_plan.paths.clear();
+    }
+    PathPointArena().swap(*point_arena);
 }
 
 void LayerPlan::overrideFanSpeeds(double speed)
@@ -2168,11 +2455,31 @@ size_t LayerPlan::getExtruder() const
 void LayerPlan::setBridgeWallMask(const Polygons& polys)
 {
     bridge_wall_mask = polys;
+    bridge_wall_mask_prepared = PreparedPolygons(bridge_wall_mask);
+    bridge_wall_mask_grid.reset();
+    if (!bridge_wall_mask.empty())
+    {
+        //Aim for a few line segments per cell.
+        const AABB bounding_box(bridge_wall_mask);
+        const coord_t size = std::max(bounding_box.max.X - bounding_box.min.X, bounding_box.max.Y - bounding_box.min.Y);
+        const coord_t cell_size = std::max(coord_t(100), static_cast<coord_t>(size / (std::sqrt(bridge_wall_mask.pointCount()) + 1)));
+        bridge_wall_mask_grid = PolygonUtils::createLocToLineGrid(bridge_wall_mask, cell_size);
+    }
+}
+
+bool LayerPlan::collidesWithBridgeWallMask(const Point& p0, const Point& p1) const
+{
+    if (vSize2(p1 - p0) < 2 || !bridge_wall_mask_grid) //The grid doesn't handle line segments this short.
+    {
+        return PolygonUtils::polygonCollidesWithLineSegment(bridge_wall_mask, p0, p1);
+    }
+    return PolygonUtils::polygonCollidesWithLineSegment(p0, p1, *bridge_wall_mask_grid);
 }
 
 void LayerPlan::setOverhangMask(const Polygons& polys)
 {
     overhang_mask = polys;
+    overhang_mask_prepared = PreparedPolygons(overhang_mask);
 }
 
 }//namespace cura
@@ -4,6 +4,7 @@
 #ifndef LAYER_PLAN_H
 #define LAYER_PLAN_H
 
+#include <memory> //For shared_ptr.
 #include <optional>
 #include <vector>
 #ifdef BUILD_TESTS
@@ -14,12 +15,16 @@
 #include "gcodeExport.h"
 #include "PathOrderOptimizer.h"
 #include "SpaceFillType.h"
+#include "pathPlanning/CombPathCache.h" //To reuse the combing of earlier layers.
 #include "pathPlanning/GCodePath.h"
 #include "pathPlanning/NozzleTempInsert.h"
 #include "pathPlanning/TimeMaterialEstimates.h"
 #include "settings/PathConfigStorage.h"
 #include "settings/types/LayerIndex.h"
 #include "utils/polygon.h"
+#include "utils/polygonUtils.h" //For LocToLineGrid.
+#include "utils/IndexedPolygons.h"
+#include "utils/PreparedPolygons.h"
 
 #include "InsetOrderOptimizer.h"
 #include "utils/ExtrusionJunction.h"
@@ -46,7 +51,10 @@ class ExtruderPlan
     FRIEND_TEST(ExtruderPlanPathsParameterizedTest, BackPressureCompensationZeroIsUncompensated);
     FRIEND_TEST(ExtruderPlanPathsParameterizedTest, BackPressureCompensationFull);
     FRIEND_TEST(ExtruderPlanPathsParameterizedTest, BackPressureCompensationHalf);
+    FRIEND_TEST(ExtruderPlanPathsParameterizedTest, NaiveTimeEstimatesWithoutStartingPosition);
+    FRIEND_TEST(ExtruderPlanPathsParameterizedTest, TimeUntilEnd);
     FRIEND_TEST(ExtruderPlanTest, BackPressureCompensationEmptyPlan);
+    FRIEND_TEST(ExtruderPlanTest, PathsSharingPointArena);
 #endif
 protected:
     std::vector<GCodePath> paths; //!< The paths planned for this extruder
@@ -123,8 +131,11 @@ public:
     /*!
      * Applying speed corrections for minimal layer times and determine the fanSpeed. 
      * 
+     * The naive time estimates must have been computed with
+     * \ref computeNaiveTimeEstimates already.
+     * 
      * \param force_minimal_layer_time Whether we should apply speed changes and perhaps a head lift in order to meet the minimal layer time
-     * \param starting_position The position the head was before starting this extruder plan
+     * \param starting_position The position the head was before starting this extruder plan, if that wasn't known when the estimates were computed
      */
     void processFanSpeedAndMinimalLayerTime(bool force_minimal_layer_time, Point starting_position);
 
@@ -197,12 +208,49 @@ protected:
 
     /*!
      * Compute naive time estimates (without accounting for slow down at corners etc.) and naive material estimates.
-     * and store them in each ExtruderPlan and each GCodePath.
+     * and store them in each GCodePath.
+     *
+     * These per-path timings are computed once per extruder plan, and are then
+     * used for the fan speed, the minimal layer time and the placement of the
+     * preheat commands. Any previously stored estimates are replaced.
+     *
+     * Where the head was before this extruder plan may not be known yet, if
+     * the previous layer is still being planned. Then the travel to the first
+     * point is left out, and that path is estimated again in
+     * \ref processFanSpeedAndMinimalLayerTime .
      * 
-     * \param starting_position The position the head was in before starting this layer
-     * \return the total estimates of this layer
+     * \param starting_position The position the head was in before starting this extruder plan, if known
+     */
+    void computeNaiveTimeEstimates(const std::optional<Point> starting_position);
+
+    /*!
+     * Compute the naive time and material estimates of a single path.
+     * \param path The path to store the estimates in.
+     * \param starting_position The position of the head before the path.
+     * \return The position of the head after the path.
+     */
+    Point computeNaiveTimeEstimates(GCodePath& path, Point starting_position) const;
+
+    /*!
+     * The path of which the estimates depend on where the head was before this
+     * extruder plan, if that wasn't known when the estimates were computed.
+     */
+    std::optional<size_t> path_from_starting_position;
+
+    /*!
+     * For each path, the naive estimate of the time from the start of that path
+     * until the end of this extruder plan, followed by 0 for the end itself.
+     *
+     * This is non-increasing, so the path at a certain time before the end can
+     * be found with a binary search, such as to insert temperature commands.
      */
-    TimeMaterialEstimates computeNaiveTimeEstimates(Point starting_position);
+    std::vector<double> time_until_end;
+
+    /*!
+     * Get \ref time_until_end , computing it if that wasn't done yet or paths
+     * were added since. It must be cleared if the estimates change.
+     */
+    const std::vector<double>& getTimeUntilEnd();
 };
 
 class LayerPlanBuffer; // forward declaration to prevent circular dependency
@@ -223,7 +271,8 @@ class LayerPlan : public NoCopy
     friend class AddTravelTest;
 
 public:
-    const PathConfigStorage configs_storage; //!< The line configs for this layer for each feature type
+    const std::shared_ptr<const PathConfigStorage> shared_configs_storage; //!< The line configs for this layer, which may be shared with other layers.
+    const PathConfigStorage& configs_storage; //!< The line configs for this layer for each feature type
     coord_t z;
     coord_t final_travel_z;
     bool mode_skip_agressive_merge; //!< Whether to give every new path the 'skip_agressive_merge_hint' property (see GCodePath); default is false.
@@ -249,10 +298,12 @@ private:
     bool skirt_brim_is_processed[MAX_EXTRUDERS];
 
     std::vector<ExtruderPlan> extruder_plans; //!< should always contain at least one ExtruderPlan
+    std::shared_ptr<PathPointArena> point_arena; //!< The points of all paths in the extruder plans. Released once the layer is written.
 
     size_t last_extruder_previous_layer; //!< The last id of the extruder with which was printed in the previous layer
     ExtruderTrain* last_planned_extruder; //!< The extruder for which a move has most recently been planned.
 
+    bool has_naive_time_estimates; //!< Whether \ref computeNaiveTimeEstimates was done.
     std::optional<Point> first_travel_destination; //!< The destination of the first (travel) move (if this layer is not empty)
     bool first_travel_destination_is_inside; //!< Whether the destination of the first planned travel move is inside a layer part
     std::optional<std::pair<Acceleration, Velocity>> first_extrusion_acc_jerk; //!< The acceleration and jerk rates of the first extruded move (if this layer is not empty).
@@ -261,18 +312,89 @@ private:
     bool is_inside; //!< Whether the destination of the next planned travel move is inside a layer part
     Polygons comb_boundary_minimum; //!< The minimum boundary within which to comb, or to move into when performing a retraction.
     Polygons comb_boundary_preferred; //!< The boundary preferably within which to comb, or to move into when performing a retraction.
+    IndexedPolygons comb_boundary_preferred_index; //!< To move points inside the \ref comb_boundary_preferred once it's computed.
     Comb* comb;
+    std::shared_ptr<CombPathCache::Travels> comb_travels; //!< The travels combed on earlier layers with the same comb boundaries, if they are remembered.
     coord_t comb_move_inside_distance;  //!< Whenever using the minimum boundary for combing it tries to move the coordinates inside by this distance after calculating the combing.
+    Duration travel_order_refinement_budget; //!< How much time may still be spent on refining the order of paths in this layer, to reduce travel moves.
     Polygons bridge_wall_mask; //!< The regions of a layer part that are not supported, used for bridging
+    PreparedPolygons bridge_wall_mask_prepared; //!< The bridge_wall_mask, to check for many points of the walls whether they're in it
+    std::unique_ptr<LocToLineGrid> bridge_wall_mask_grid; //!< The line segments of the bridge_wall_mask, to check for many lines of the walls whether they cross it
     Polygons overhang_mask; //!< The regions of a layer part where the walls overhang
+    PreparedPolygons overhang_mask_prepared; //!< The overhang_mask, to check for many points of the walls whether they're in it
 
     const std::vector<FanSpeedLayerTimeSettings> fan_speed_layer_time_settings_per_extruder;
 
-    enum CombBoundary
+    /*!
+     * A travel move of which the combing is not computed yet.
+     *
+     * The destination is already in the travel path. The comb path is
+     * inserted before it when the travel is resolved.
+     */
+    struct PendingTravel
     {
-        MINIMUM,
-        PREFERRED
+        size_t extruder_plan_idx; //!< The extruder plan that contains the travel path.
+        size_t path_idx; //!< The index of the travel path in its extruder plan.
+        size_t first_point_idx; //!< Where in the travel path to insert the comb path.
+        const ExtruderTrain* extruder; //!< The extruder that travels.
+        Point start; //!< Where the travel starts.
+        Point destination; //!< Where the travel ends.
+        bool start_inside; //!< Whether the travel starts inside a layer part.
+        bool destination_inside; //!< Whether the travel ends inside a layer part.
     };
+    std::vector<PendingTravel> pending_travels; //!< The travels that still need to be combed, in the order they were planned.
+
+    /*!
+     * Compute the combing for a travel move, and decide whether to retract for
+     * it.
+     * \param travel The travel to comb.
+     */
+    void resolveTravel(const PendingTravel& travel);
+
+    /*!
+     * Comb a travel, or reuse the combing of the same travel on an earlier
+     * layer with the same comb boundaries.
+     *
+     * A travel that went around other parts is only reused if the outlines of
+     * the layer are the same as well.
+     * \param travel The travel to comb.
+     * \param max_distance_ignored Travels shorter than this are not combed.
+     * \param[out] comb_paths The comb paths of the travel.
+     * \param[out] unretract_before_last_travel_move Whether to unretract
+     * before the last travel move, see \ref Comb::calc .
+     * \return Whether combing succeeded.
+     */
+    bool combTravel(const PendingTravel& travel, const coord_t max_distance_ignored, CombPaths& comb_paths, bool& unretract_before_last_travel_move);
+
+    /*!
+     * Decide whether to retract for a travel, after its combing is known.
+     *
+     * If the travel is not combed and starts inside, the nozzle first moves
+     * further inside, so it doesn't ooze on the outer wall while retracting.
+     * \param path The travel path.
+     * \param extruder The extruder that travels.
+     * \param retraction_config The retraction settings of that extruder.
+     * \param start Where the travel starts, if known.
+     * \param destination Where the travel ends.
+     * \param is_first_travel_of_layer Whether this is the first travel of the
+     * layer, which is fixed up later.
+     * \param combed Whether a comb path was found.
+     * \param start_inside Whether the travel starts inside a layer part.
+     * \param first_point_idx Where in the travel path the travel from
+     * \p start begins.
+     */
+    void finishTravel(GCodePath& path, const ExtruderTrain& extruder, const RetractionConfig& retraction_config, const std::optional<Point> start, const Point destination, const bool is_first_travel_of_layer, const bool combed, const bool start_inside, const size_t first_point_idx);
+
+    /*!
+     * Find where to move to from a position near the boundary of a layer part,
+     * to be a certain distance inside of it.
+     * \param p The position to move from.
+     * \param distance The distance to the comb boundary after moving inside.
+     * \param part If given, stay within the boundary of this part.
+     * \return The position to move to, or nothing if there's no such place
+     * nearby.
+     */
+    std::optional<Point> getMoveInsideCombBoundaryPoint(Point p, const coord_t distance, const std::optional<SliceLayerPart>& part = std::nullopt) const;
 
     /*!
      * Either create a new path with the given config or return the last path if it already had that config.
@@ -287,6 +409,17 @@ private:
      */
     GCodePath* getLatestPathWithConfig(const GCodePathConfig& config, SpaceFillType space_fill_type, const Ratio flow = 1.0_r, const Ratio width_factor = 1.0_r, bool spiralize = false, const Ratio speed_factor = 1.0_r);
 
+    /*!
+     * Whether a line segment crosses the border of the \ref bridge_wall_mask.
+     *
+     * Gives the same result as \ref PolygonUtils::polygonCollidesWithLineSegment
+     * on the whole mask, but only tests the line segments of the mask that are
+     * near the line segment.
+     * \param p0 The start of the line segment.
+     * \param p1 The end of the line segment.
+     */
+    bool collidesWithBridgeWallMask(const Point& p0, const Point& p1) const;
+
 public:
     /*!
      * Force LayerPlan::getLatestPathWithConfig to return a new path.
@@ -433,11 +566,25 @@ public:
      * The first travel move in a layer will result in a bogus travel move with
      * no combing and no retraction. This travel move needs to be fixed
      * afterwards.
+     *
+     * The combing itself is done later, by \ref resolveTravels . Until then,
+     * the returned path only contains the destination.
      * \param p The point to travel to.
      * \param force_retract Whether to force a retraction to occur.
      */
     GCodePath& addTravel(const Point p, const bool force_retract = false);
 
+    /*!
+     * Compute the combing of all travel moves that were planned with
+     * \ref addTravel since the last time this was called.
+     *
+     * To keep planning the layer fast, \ref addTravel only records where a
+     * combed travel goes. Its comb path, and whether it retracts, are only
+     * known after this has been called. This must be done before the layer
+     * plan is used for anything but planning more moves.
+     */
+    void resolveTravels();
+
     /*!
      * Add a travel path to a certain point and retract if needed.
      * 
@@ -766,6 +913,26 @@ public:
      */
     bool writePathWithCoasting(GCodeExport& gcode, const size_t extruder_plan_idx, const size_t path_idx, const coord_t layer_thickness);
 
+    /*!
+     * Compute the naive time and material estimates of all paths in this
+     * layer, if that wasn't done yet.
+     *
+     * This is the bulk of the work of \ref processFanSpeedAndMinimalLayerTime
+     * that doesn't depend on the previous layer, so that it can be done while
+     * the layers are planned in parallel. It must only be called when the
+     * layer is completely planned, and the travels are resolved.
+     */
+    void computeNaiveTimeEstimates();
+
+    /*!
+     * Get the number of bytes that this layer plan holds in its paths and in
+     * the boundaries it has computed.
+     *
+     * This counts the memory allocated for the coordinates and the paths,
+     * which is the bulk of it.
+     */
+    size_t getMemoryUsage() const;
+
     /*!
      * Applying speed corrections for minimal layer times and determine the fanSpeed. 
      * 
@@ -798,7 +965,7 @@ public:
 private:
 
     /*!
-     * \brief Compute the preferred or minimum combing boundary
+     * \brief Compute the preferred and minimum combing boundaries
      *
      * Minimum combing boundary:
      *  - If CombingMode::ALL: Add the outline offset (skin, infill and inner walls).
@@ -810,10 +977,13 @@ private:
      *  - If CombingMode::NO_SKIN: Add the increased outline offset, subtract skin (infill and part of the inner walls).
      *  - If CombingMode::INFILL: Add the infill (infill only).
      *
-     * \param boundary_type The boundary type to compute.
-     * \return the combing boundary or an empty Polygons if no combing is required
+     * Both boundaries are computed together, so that the outlines only need to
+     * be unioned once for both offsets. They are stored in
+     * \ref LayerPlan::comb_boundary_minimum and
+     * \ref LayerPlan::comb_boundary_preferred, which remain empty if no combing
+     * is required.
      */
-    Polygons computeCombBoundary(const CombBoundary boundary_type);
+    void computeCombBoundaries();
 };
 
 }//namespace cura
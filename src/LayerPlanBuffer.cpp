@@ -1,6 +1,8 @@
 //Copyright (c) 2021 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For std::partition_point.
+
 #include "Application.h" //To flush g-code through the communication channel.
 #include "ExtruderTrain.h"
 #include "FffProcessor.h"
@@ -23,16 +25,30 @@ void LayerPlanBuffer::push(LayerPlan& layer_plan)
 
 void LayerPlanBuffer::handle(LayerPlan& layer_plan, GCodeExport& gcode)
 {
+    layer_plan.resolveTravels(); //In case it wasn't done yet by whoever planned the layer.
     push(layer_plan);
 
     LayerPlan* to_be_written = processBuffer();
     if (to_be_written)
     {
-        to_be_written->writeGCode(gcode);
+        writeLayer(*to_be_written);
         delete to_be_written;
+
+        //Let a few layers format in parallel. Each layer is sent on as soon as its text is written.
+        while (gcode.writeFormattedLayer(max_formatting_layers))
+        {
+            Application::getInstance().communication->flushGCode();
+        }
     }
 }
 
+void LayerPlanBuffer::writeLayer(LayerPlan& layer_plan)
+{
+    gcode.startLayerBuffer();
+    layer_plan.writeGCode(gcode);
+    gcode.finishLayerBuffer();
+}
+
 LayerPlan* LayerPlanBuffer::processBuffer()
 {
     if (buffer.empty())
@@ -67,11 +83,18 @@ void LayerPlanBuffer::flush()
     }
     while (!buffer.empty())
     {
-        buffer.front()->writeGCode(gcode);
-        Application::getInstance().communication->flushGCode();
+        writeLayer(*buffer.front());
+        while (gcode.writeFormattedLayer(max_formatting_layers))
+        {
+            Application::getInstance().communication->flushGCode();
+        }
         delete buffer.front();
         buffer.pop_front();
     }
+    while (gcode.writeFormattedLayer()) //All layers need to be in the output before anything else is written to it.
+    {
+        Application::getInstance().communication->flushGCode();
+    }
 }
 
 void LayerPlanBuffer::addConnectingTravelMove(LayerPlan* prev_layer, const LayerPlan* newest_layer)
@@ -99,6 +122,7 @@ void LayerPlanBuffer::addConnectingTravelMove(LayerPlan* prev_layer, const Layer
           (mesh_group_settings.get<bool>("travel_retract_before_outer_wall") && (mesh_group_settings.get<InsetDirection>("inset_direction") == InsetDirection::OUTSIDE_IN || mesh_group_settings.get<size_t>("wall_line_count") == 1)); //Moving towards an outer wall.
         prev_layer->final_travel_z = newest_layer->z;
         GCodePath &path = prev_layer->addTravel(first_location_new_layer, force_retract);
+        prev_layer->resolveTravels();
         if (force_retract && !path.retract)
         {
             // addTravel() won't use retraction if the travel distance is less than retraction minimum travel setting
@@ -134,19 +158,18 @@ void LayerPlanBuffer::processFanSpeedLayerTime()
 
 void LayerPlanBuffer::insertPreheatCommand(ExtruderPlan& extruder_plan_before, const Duration time_after_extruder_plan_start, const size_t extruder_nr, const Temperature temp)
 {
-    Duration acc_time = 0.0;
-    for (unsigned int path_idx = extruder_plan_before.paths.size() - 1; int(path_idx) != -1 ; path_idx--)
+    // Find the last path that starts longer than that before the end.
+    const std::vector<double>& time_until_end = extruder_plan_before.getTimeUntilEnd();
+    const size_t paths_before_count = std::partition_point(time_until_end.begin(), time_until_end.end() - 1, [time_after_extruder_plan_start](const double time) { return time > time_after_extruder_plan_start; }) - time_until_end.begin();
+    if (paths_before_count > 0)
     {
-        GCodePath& path = extruder_plan_before.paths[path_idx];
-        const Duration time_this_path = path.estimates.getTotalTime();
-        acc_time += time_this_path;
-        if (acc_time > time_after_extruder_plan_start)
-        {
-            const Duration time_before_path_end = acc_time - time_after_extruder_plan_start;
-            bool wait = false;
-            extruder_plan_before.insertCommand(path_idx, extruder_nr, temp, wait, time_this_path - time_before_path_end);
-            return;
-        }
+        const size_t path_idx = paths_before_count - 1;
+        const Duration time_this_path = extruder_plan_before.paths[path_idx].estimates.getTotalTime();
+        const Duration acc_time = time_until_end[path_idx];
+        const Duration time_before_path_end = acc_time - time_after_extruder_plan_start;
+        bool wait = false;
+        extruder_plan_before.insertCommand(path_idx, extruder_nr, temp, wait, time_this_path - time_before_path_end);
+        return;
     }
     bool wait = false;
     constexpr size_t path_idx = 0;
@@ -450,17 +473,11 @@ void LayerPlanBuffer::insertFinalPrintTempCommand(std::vector<ExtruderPlan*>& ex
     // at this point cool_down_time is what time is left if cool down time of extruder plans after precool_extruder_plan (up until last_extruder_plan) are already taken into account
 
     { // insert temp command in precool_extruder_plan
-        double extrusion_time_seen = 0;
-        unsigned int path_idx;
-        for (path_idx = precool_extruder_plan->paths.size() - 1; int(path_idx) >= 0; path_idx--)
-        {
-            GCodePath& path = precool_extruder_plan->paths[path_idx];
-            extrusion_time_seen += path.estimates.getTotalTime();
-            if (extrusion_time_seen >= cool_down_time)
-            {
-                break;
-            }
-        }
+        // Find the last path that starts at least the cool down time before the end, or the first path if there is none.
+        const std::vector<double>& time_until_end = precool_extruder_plan->getTimeUntilEnd();
+        const size_t paths_before_count = std::partition_point(time_until_end.begin(), time_until_end.end() - 1, [cool_down_time](const double time) { return time >= cool_down_time; }) - time_until_end.begin();
+        const unsigned int path_idx = paths_before_count - 1;
+        const double extrusion_time_seen = time_until_end[paths_before_count > 0 ? path_idx : 0];
         bool wait = false;
         double time_after_path_start = extrusion_time_seen - cool_down_time;
         precool_extruder_plan->insertCommand(path_idx, extruder, final_print_temp, wait, time_after_path_start);
@@ -37,6 +37,8 @@ class LayerPlanBuffer
     static constexpr size_t buffer_size = 5; // should be as low as possible while still allowing enough time in the buffer to heat up from standby temp to printing temp // TODO: hardcoded value
     // this value should be higher than 1, cause otherwise each layer is viewed as the first layer and no temp commands are inserted.
 
+    static constexpr size_t max_formatting_layers = 4; //!< How many written layers may be formatted as text in parallel before they go to the output.
+
     static constexpr Duration extra_preheat_time = 1.0_s; //!< Time to start heating earlier than computed to avoid accummulative discrepancy between actual heating times and computed ones.
 
     std::vector<bool> extruder_used_in_meshgroup; //!< For each extruder whether it has already been planned once in this meshgroup. This is used to see whether we should heat to the initial_print_temp or to the extrusion_temperature
@@ -87,6 +89,16 @@ private:
      */
     LayerPlan* processBuffer();
 
+    /*!
+     * Write a layer plan to g-code, with its moves formatted as text on
+     * another thread.
+     *
+     * The text isn't in the output yet when this returns. That is up to
+     * \ref GCodeExport::writeFormattedLayer .
+     * \param layer_plan The layer to write.
+     */
+    void writeLayer(LayerPlan& layer_plan);
+
     /*!
      * Add the travel move to properly travel from the end location of the previous layer to the starting location of the next
      * 
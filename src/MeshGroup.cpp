@@ -1,9 +1,15 @@
 //Copyright (C) 2020 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For std::find and std::search.
+#include <array>
+#include <ctype.h> //isspace.
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h> //strtof.
 #include <limits>
+#include <optional>
+#include <unordered_map>
 
 #include "MeshGroup.h"
 #include "settings/types/Ratio.h" //For the shrinkage percentage and scale factor.
@@ -11,29 +17,15 @@
 #include "utils/FMatrix4x3.h" //To transform the input meshes for shrinkage compensation and to align in command line mode.
 #include "utils/gettime.h"
 #include "utils/logoutput.h"
+#include "utils/MappedFile.h" //To parse STL files in place.
 #include "utils/string.h"
+#include "utils/ZipArchive.h" //To read 3MF files.
 
 namespace cura
 {
 
 FILE* binaryMeshBlob = nullptr;
 
-/* Custom fgets function to support Mac line-ends in Ascii STL files. OpenSCAD produces this when used on Mac */
-void* fgets_(char* ptr, size_t len, FILE* f)
-{
-    while(len && fread(ptr, 1, 1, f) > 0)
-    {
-        if (*ptr == '\n' || *ptr == '\r')
-        {
-            *ptr = '\0';
-            return ptr;
-        }
-        ptr++;
-        len--;
-    }
-    return nullptr;
-}
-
 Point3 MeshGroup::min() const
 {
     if (meshes.size() < 1)
@@ -122,63 +114,139 @@ void MeshGroup::scaleFromBottom(const Ratio factor_xy, const Ratio factor_z)
     }
 }
 
-bool loadMeshSTL_ascii(Mesh* mesh, const char* filename, const FMatrix4x3& matrix)
+/*!
+ * Parse a " vertex x y z" line of an ASCII STL file.
+ *
+ * Leading whitespace is skipped, like sscanf would.
+ * \param line The line, terminated by a null character.
+ * \param[out] vertex The coordinates of the vertex, if it's a vertex line.
+ * \return Whether the line is a vertex line with three coordinates.
+ */
+static bool parseVertexLine(const char* line, FPoint3& vertex)
+{
+    while (isspace(static_cast<unsigned char>(*line)))
+    {
+        line++;
+    }
+    if (strncmp(line, "vertex", 6) != 0)
+    {
+        return false;
+    }
+    line += 6;
+    float* coordinates[3] = { &vertex.x, &vertex.y, &vertex.z };
+    for (float* coordinate : coordinates)
+    {
+        char* parsed_end;
+        *coordinate = strtof(line, &parsed_end);
+        if (parsed_end == line)
+        {
+            return false;
+        }
+        line = parsed_end;
+    }
+    return true;
+}
+
+/*!
+ * Find all vertex lines in a part of an ASCII STL file.
+ *
+ * Lines are separated by either \\n or \\r, to support Mac line-ends. OpenSCAD
+ * produces this when used on Mac.
+ * \param begin The start of the part to parse. Must be at the start of a line.
+ * \param end The end of the part to parse. Must be at the end of a line.
+ * \param matrix The transformation to apply to the vertices.
+ * \param[out] vertices The transformed vertices, in file order.
+ */
+static void parseVertexLines(const char* begin, const char* end, const FMatrix4x3& matrix, std::vector<Point3>& vertices)
 {
-    FILE* f = fopen(filename, "rt");
-    char buffer[1024];
+    char line[1024];
     FPoint3 vertex;
-    int n = 0;
-    Point3 v0(0,0,0), v1(0,0,0), v2(0,0,0);
-    while(fgets_(buffer, sizeof(buffer), f))
+    while (begin < end)
     {
-        if (sscanf(buffer, " vertex %f %f %f", &vertex.x, &vertex.y, &vertex.z) == 3)
+        const char* line_end = begin;
+        while (line_end < end && *line_end != '\n' && *line_end != '\r')
         {
-            n++;
-            switch(n)
-            {
-            case 1:
-                v0 = matrix.apply(vertex);
-                break;
-            case 2:
-                v1 = matrix.apply(vertex);
-                break;
-            case 3:
-                v2 = matrix.apply(vertex);
-                mesh->addFace(v0, v1, v2);
-                n = 0;
-                break;
-            }
+            line_end++;
         }
+        // The mapped file isn't null-terminated, so copy the line to be able to parse it. Vertex lines are always short.
+        const size_t line_length = std::min(static_cast<size_t>(line_end - begin), sizeof(line) - 1);
+        memcpy(line, begin, line_length);
+        line[line_length] = '\0';
+        if (parseVertexLine(line, vertex))
+        {
+            vertices.push_back(matrix.apply(vertex));
+        }
+        begin = line_end + 1;
     }
-    fclose(f);
+}
+
+bool loadMeshSTL_ascii(Mesh* mesh, const char* filename, const FMatrix4x3& matrix)
+{
+    const MappedFile file(filename);
+    if (!file.isValid())
+    {
+        return false;
+    }
+    const char* file_end = file.data() + file.size();
+
+    // Split the file into chunks at line boundaries and find the vertices in each chunk in parallel.
+    constexpr size_t chunk_size = 1 << 22;
+    std::vector<const char*> chunk_starts;
+    for (const char* chunk_start = file.data(); chunk_start < file_end; )
+    {
+        chunk_starts.push_back(chunk_start);
+        chunk_start += std::min(chunk_size, static_cast<size_t>(file_end - chunk_start));
+        while (chunk_start < file_end && chunk_start[-1] != '\n' && chunk_start[-1] != '\r')
+        {
+            chunk_start++;
+        }
+    }
+    chunk_starts.push_back(file_end);
+
+    std::vector<std::vector<Point3>> chunk_vertices(chunk_starts.size() - 1);
+#pragma omp parallel for default(none) shared(chunk_starts, chunk_vertices, matrix) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int chunk_idx = 0; chunk_idx < static_cast<int>(chunk_vertices.size()); chunk_idx++)
+    {
+        parseVertexLines(chunk_starts[chunk_idx], chunk_starts[chunk_idx + 1], matrix, chunk_vertices[chunk_idx]);
+    }
+
+    // Every three consecutive vertices in the file form a face, also across chunk boundaries.
+    std::vector<Point3> corners;
+    size_t vertex_count = 0;
+    for (const std::vector<Point3>& vertices : chunk_vertices)
+    {
+        vertex_count += vertices.size();
+    }
+    corners.reserve(vertex_count);
+    for (std::vector<Point3>& vertices : chunk_vertices)
+    {
+        corners.insert(corners.end(), vertices.begin(), vertices.end());
+        std::vector<Point3>().swap(vertices);
+    }
+    corners.resize(corners.size() - corners.size() % 3);
+    mesh->faces.reserve(corners.size() / 3);
+    mesh->vertices.reserve(corners.size() / 6);
+    mesh->addFaces(corners);
     mesh->finish();
     return true;
 }
 
 bool loadMeshSTL_binary(Mesh* mesh, const char* filename, const FMatrix4x3& matrix)
 {
-    FILE* f = fopen(filename, "rb");
-
-    fseek(f, 0L, SEEK_END);
-    long long file_size = ftell(f); //The file size is the position of the cursor after seeking to the end.
-    rewind(f); //Seek back to start.
-    size_t face_count = (file_size - 80 - sizeof(uint32_t)) / 50; //Subtract the size of the header. Every face uses exactly 50 bytes.
-
-    char buffer[80];
-    //Skip the header
-    if (fread(buffer, 80, 1, f) != 1)
+    // Parse the face records straight from the mapped file instead of reading them one by one.
+    const MappedFile file(filename);
+    constexpr size_t header_size = 80 + sizeof(uint32_t); //80 bytes of header text, followed by the face count.
+    constexpr size_t face_size = 50;
+    if (!file.isValid() || file.size() < header_size)
     {
-        fclose(f);
         return false;
     }
+    const size_t face_count = (file.size() - header_size) / face_size; //Every face uses exactly 50 bytes.
 
     uint32_t reported_face_count;
     //Read the face count. We'll use it as a sort of redundancy code to check for file corruption.
-    if (fread(&reported_face_count, sizeof(uint32_t), 1, f) != 1)
-    {
-        fclose(f);
-        return false;
-    }
+    memcpy(&reported_face_count, file.data() + 80, sizeof(uint32_t));
     if (reported_face_count != face_count)
     {
         logWarning("Face count reported by file (%s) is not equal to actual face count (%s). File could be corrupt!\n", std::to_string(reported_face_count).c_str(), std::to_string(face_count).c_str());
@@ -189,21 +257,30 @@ bool loadMeshSTL_binary(Mesh* mesh, const char* filename, const FMatrix4x3& matr
     // Every Face is 50 Bytes: Normal(3*float), Vertices(9*float), 2 Bytes Spacer
     mesh->faces.reserve(face_count);
     mesh->vertices.reserve(face_count);
-    for (unsigned int i = 0; i < face_count; i++)
+
+    // Decoding and transforming the vertices is independent per face, so do that in parallel a chunk of faces at a time.
+    // The faces are added to the mesh afterwards in file order, so that the vertex and face order doesn't depend on the threads.
+    constexpr size_t chunk_size = 1 << 16;
+    std::vector<Point3> corners(std::min(chunk_size, face_count) * 3);
+    for (size_t chunk_start = 0; chunk_start < face_count; chunk_start += chunk_size)
     {
-        if (fread(buffer, 50, 1, f) != 1)
+        const int chunk_face_count = std::min(chunk_size, face_count - chunk_start);
+        const char* chunk_data = file.data() + header_size + chunk_start * face_size;
+
+#pragma omp parallel for default(none) shared(chunk_face_count, chunk_data, corners, matrix, face_size)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int face_idx = 0; face_idx < chunk_face_count; face_idx++)
         {
-            fclose(f);
-            return false;
+            float v[9];
+            memcpy(v, chunk_data + face_idx * face_size + 3 * sizeof(float), sizeof(v)); //Skip the normal. The records aren't aligned, so copy.
+            corners[face_idx * 3 + 0] = matrix.apply(FPoint3(v[0], v[1], v[2]));
+            corners[face_idx * 3 + 1] = matrix.apply(FPoint3(v[3], v[4], v[5]));
+            corners[face_idx * 3 + 2] = matrix.apply(FPoint3(v[6], v[7], v[8]));
         }
-        float *v= ((float*)buffer)+3;
 
-        Point3 v0 = matrix.apply(FPoint3(v[0], v[1], v[2]));
-        Point3 v1 = matrix.apply(FPoint3(v[3], v[4], v[5]));
-        Point3 v2 = matrix.apply(FPoint3(v[6], v[7], v[8]));
-        mesh->addFace(v0, v1, v2);
+        corners.resize(chunk_face_count * 3);
+        mesh->addFaces(corners);
     }
-    fclose(f);
     mesh->finish();
     return true;
 }
@@ -265,12 +342,713 @@ bool loadMeshSTL(Mesh* mesh, const char* filename, const FMatrix4x3& matrix)
     return loadMeshSTL_binary(mesh, filename, matrix);
 }
 
+/*!
+ * Split a file into chunks of roughly equal size that each end just after a
+ * separator character, so that they can be parsed in parallel.
+ * \param begin The start of the data to split.
+ * \param end The end of the data to split.
+ * \param is_separator Whether a chunk may start after this character. When
+ * \p split_before is set, whether it may start at this character instead.
+ * \param split_before Whether the separator goes to the next chunk.
+ * \return The starts of the chunks, followed by \p end.
+ */
+template<typename IsSeparator>
+static std::vector<const char*> splitIntoChunks(const char* begin, const char* end, const IsSeparator& is_separator, const bool split_before = false)
+{
+    constexpr size_t chunk_size = 1 << 22;
+    std::vector<const char*> chunk_starts;
+    for (const char* chunk_start = begin; chunk_start < end; )
+    {
+        chunk_starts.push_back(chunk_start);
+        chunk_start += std::min(chunk_size, static_cast<size_t>(end - chunk_start));
+        while (chunk_start < end && !is_separator(split_before ? chunk_start[0] : chunk_start[-1]))
+        {
+            chunk_start++;
+        }
+    }
+    chunk_starts.push_back(end);
+    return chunk_starts;
+}
+
+/*!
+ * Parse a number from a part of a file that may not be null-terminated.
+ *
+ * Numbers in model files are short, so this copies the number to be able to
+ * use the standard parsing functions.
+ * \param[in,out] position Where to start parsing. Is moved past the number.
+ * \param end Where the data ends.
+ * \param[out] result The parsed number.
+ * \return Whether a number could be parsed.
+ */
+static bool parseDouble(const char*& position, const char* end, double& result)
+{
+    while (position < end && isspace(static_cast<unsigned char>(*position)))
+    {
+        position++;
+    }
+    char number[64];
+    size_t length = 0;
+    while (position + length < end && length < sizeof(number) - 1 && (isdigit(static_cast<unsigned char>(position[length])) || strchr("+-.eE", position[length]) != nullptr))
+    {
+        number[length] = position[length];
+        length++;
+    }
+    number[length] = '\0';
+    char* parsed_end;
+    result = strtod(number, &parsed_end);
+    if (parsed_end == number)
+    {
+        return false;
+    }
+    position += parsed_end - number;
+    return true;
+}
+
+/*!
+ * A reference to a vertex from a face of an OBJ file.
+ *
+ * Negative indices in OBJ files count back from the last vertex before the
+ * face. Since the chunks of the file are parsed separately, those can only be
+ * resolved once it's known how many vertices precede the chunk.
+ */
+struct ObjCorner
+{
+    int64_t index; //!< The 0-based vertex index in the file, or the negative index relative to the vertices of the chunk.
+    bool relative; //!< Whether the index is relative to the vertices preceding the face in the chunk.
+};
+
+/*!
+ * The vertices and faces found in one chunk of an OBJ file.
+ */
+struct ObjChunk
+{
+    std::vector<FPoint3> vertices;
+    std::vector<ObjCorner> corners; //!< The corners of all polygons in the chunk, one polygon after another.
+    std::vector<size_t> polygon_sizes; //!< How many corners each polygon has.
+};
+
+/*!
+ * Find the vertex and face lines in a part of an OBJ file.
+ *
+ * Everything else (normals, texture coordinates, groups, materials) is
+ * ignored since it can't be printed.
+ * \param begin The start of the part to parse. Must be at the start of a line.
+ * \param end The end of the part to parse. Must be at the end of a line.
+ * \param[out] chunk The vertices and polygons in this part.
+ */
+static void parseObjLines(const char* begin, const char* end, ObjChunk& chunk)
+{
+    while (begin < end)
+    {
+        const char* line_end = begin;
+        while (line_end < end && *line_end != '\n' && *line_end != '\r')
+        {
+            line_end++;
+        }
+        while (begin < line_end && isspace(static_cast<unsigned char>(*begin)))
+        {
+            begin++;
+        }
+        if (line_end - begin >= 2 && begin[0] == 'v' && isspace(static_cast<unsigned char>(begin[1])))
+        {
+            const char* position = begin + 1;
+            double x, y, z;
+            if (parseDouble(position, line_end, x) && parseDouble(position, line_end, y) && parseDouble(position, line_end, z))
+            {
+                chunk.vertices.emplace_back(x, y, z);
+            }
+        }
+        else if (line_end - begin >= 2 && begin[0] == 'f' && isspace(static_cast<unsigned char>(begin[1])))
+        {
+            const char* position = begin + 1;
+            size_t polygon_size = 0;
+            while (true)
+            {
+                double index;
+                if (!parseDouble(position, line_end, index) || index == 0)
+                {
+                    break;
+                }
+                while (position < line_end && !isspace(static_cast<unsigned char>(*position))) //Skip the texture coordinate and normal indices.
+                {
+                    position++;
+                }
+                const int64_t vertex_idx = static_cast<int64_t>(index);
+                if (vertex_idx < 0)
+                {
+                    chunk.corners.push_back(ObjCorner{ static_cast<int64_t>(chunk.vertices.size()) + vertex_idx, true });
+                }
+                else
+                {
+                    chunk.corners.push_back(ObjCorner{ vertex_idx - 1, false });
+                }
+                polygon_size++;
+            }
+            chunk.polygon_sizes.push_back(polygon_size);
+        }
+        begin = line_end + 1;
+    }
+}
+
+bool loadMeshOBJ(Mesh* mesh, const char* filename, const FMatrix4x3& matrix)
+{
+    const MappedFile file(filename);
+    if (!file.isValid())
+    {
+        return false;
+    }
+    mesh->mesh_name = filename;
+
+    const std::vector<const char*> chunk_starts = splitIntoChunks(file.data(), file.data() + file.size(), [](const char c) { return c == '\n' || c == '\r'; });
+    std::vector<ObjChunk> chunks(chunk_starts.size() - 1);
+#pragma omp parallel for default(none) shared(chunk_starts, chunks) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int chunk_idx = 0; chunk_idx < static_cast<int>(chunks.size()); chunk_idx++)
+    {
+        parseObjLines(chunk_starts[chunk_idx], chunk_starts[chunk_idx + 1], chunks[chunk_idx]);
+    }
+
+    // Now that the number of vertices in each chunk is known, the vertices can be transformed in parallel to their place in the file.
+    std::vector<size_t> vertex_offsets(chunks.size() + 1, 0);
+    for (size_t chunk_idx = 0; chunk_idx < chunks.size(); chunk_idx++)
+    {
+        vertex_offsets[chunk_idx + 1] = vertex_offsets[chunk_idx] + chunks[chunk_idx].vertices.size();
+    }
+    std::vector<Point3> vertices(vertex_offsets.back());
+#pragma omp parallel for default(none) shared(chunks, vertex_offsets, vertices, matrix) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int chunk_idx = 0; chunk_idx < static_cast<int>(chunks.size()); chunk_idx++)
+    {
+        const std::vector<FPoint3>& chunk_vertices = chunks[chunk_idx].vertices;
+        for (size_t vertex_idx = 0; vertex_idx < chunk_vertices.size(); vertex_idx++)
+        {
+            vertices[vertex_offsets[chunk_idx] + vertex_idx] = matrix.apply(chunk_vertices[vertex_idx]);
+        }
+    }
+
+    // Triangulate the polygons as fans, in file order.
+    std::vector<Point3> corners;
+    size_t skipped_polygons = 0;
+    for (size_t chunk_idx = 0; chunk_idx < chunks.size(); chunk_idx++)
+    {
+        const ObjChunk& chunk = chunks[chunk_idx];
+        size_t corner_idx = 0;
+        for (const size_t polygon_size : chunk.polygon_sizes)
+        {
+            const ObjCorner* polygon = chunk.corners.data() + corner_idx;
+            corner_idx += polygon_size;
+            std::vector<size_t> indices;
+            indices.reserve(polygon_size);
+            for (size_t i = 0; i < polygon_size; i++)
+            {
+                const int64_t index = polygon[i].index + (polygon[i].relative ? static_cast<int64_t>(vertex_offsets[chunk_idx]) : 0);
+                if (index < 0 || index >= static_cast<int64_t>(vertices.size()))
+                {
+                    break;
+                }
+                indices.push_back(index);
+            }
+            if (indices.size() != polygon_size || polygon_size < 3)
+            {
+                skipped_polygons++;
+                continue;
+            }
+            for (size_t i = 1; i + 1 < polygon_size; i++)
+            {
+                corners.push_back(vertices[indices[0]]);
+                corners.push_back(vertices[indices[i]]);
+                corners.push_back(vertices[indices[i + 1]]);
+            }
+        }
+    }
+    if (skipped_polygons > 0)
+    {
+        logWarning("Skipped %zu faces of %s that refer to vertices that don't exist.\n", skipped_polygons, filename);
+    }
+    mesh->faces.reserve(corners.size() / 3);
+    mesh->vertices.reserve(vertices.size());
+    mesh->addFaces(corners);
+    mesh->finish();
+    return true;
+}
+
+/*!
+ * An XML tag in a 3MF model file, without its namespace prefix.
+ */
+struct XmlTag
+{
+    std::string name;
+    const char* attributes_begin; //!< Where the attributes start, right after the name.
+    const char* attributes_end; //!< Where the attributes end, before the closing bracket.
+    bool is_end_tag; //!< Whether it's a closing tag like </object>.
+    bool is_self_closing; //!< Whether it's an empty element like <vertex/>.
+};
+
+/*!
+ * Find the next tag in an XML document, skipping the declaration, processing
+ * instructions and comments.
+ * \param[in,out] position Where to start looking. Is moved after the tag.
+ * \param end The end of the document.
+ * \param[out] tag The tag that was found.
+ * \return Whether a tag was found.
+ */
+static bool nextXmlTag(const char*& position, const char* end, XmlTag& tag)
+{
+    while (true)
+    {
+        position = std::find(position, end, '<');
+        if (end - position < 2)
+        {
+            return false;
+        }
+        if (end - position >= 4 && strncmp(position, "<!--", 4) == 0)
+        {
+            const char* comment_end = std::search(position, end, "-->", "-->" + 3);
+            position = std::min(end, comment_end + 3);
+            continue;
+        }
+        const char* tag_end = std::find(position, end, '>');
+        if (tag_end == end)
+        {
+            return false;
+        }
+        if (position[1] == '?' || position[1] == '!')
+        {
+            position = tag_end + 1;
+            continue;
+        }
+
+        const char* name_begin = position + 1;
+        tag.is_end_tag = *name_begin == '/';
+        if (tag.is_end_tag)
+        {
+            name_begin++;
+        }
+        const char* name_end = name_begin;
+        while (name_end < tag_end && !isspace(static_cast<unsigned char>(*name_end)) && *name_end != '/')
+        {
+            name_end++;
+        }
+        const char* prefix_end = std::find(name_begin, name_end, ':');
+        if (prefix_end != name_end)
+        {
+            name_begin = prefix_end + 1;
+        }
+        tag.name.assign(name_begin, name_end);
+        tag.is_self_closing = tag_end[-1] == '/';
+        tag.attributes_begin = name_end;
+        tag.attributes_end = tag.is_self_closing ? tag_end - 1 : tag_end;
+        position = tag_end + 1;
+        return true;
+    }
+}
+
+/*!
+ * Find the value of an attribute of an XML tag.
+ *
+ * Namespaced attributes (like p:UUID) are only found with their prefix, which
+ * keeps them from being confused with the core attributes that are used here.
+ * \param begin The start of the attributes of the tag.
+ * \param end The end of the attributes of the tag.
+ * \param name The name of the attribute to find.
+ * \param[out] value_begin The start of the value, if found.
+ * \param[out] value_end The end of the value, if found.
+ * \return Whether the attribute was found.
+ */
+static bool findXmlAttribute(const char* begin, const char* end, const char* name, const char*& value_begin, const char*& value_end)
+{
+    const size_t name_length = strlen(name);
+    while (begin < end)
+    {
+        while (begin < end && isspace(static_cast<unsigned char>(*begin)))
+        {
+            begin++;
+        }
+        const char* attribute_name_end = begin;
+        while (attribute_name_end < end && *attribute_name_end != '=' && !isspace(static_cast<unsigned char>(*attribute_name_end)))
+        {
+            attribute_name_end++;
+        }
+        const char* quote = attribute_name_end;
+        while (quote < end && *quote != '"' && *quote != '\'')
+        {
+            quote++;
+        }
+        if (quote == end)
+        {
+            return false;
+        }
+        const char* close_quote = std::find(quote + 1, end, *quote);
+        if (static_cast<size_t>(attribute_name_end - begin) == name_length && strncmp(begin, name, name_length) == 0)
+        {
+            value_begin = quote + 1;
+            value_end = close_quote;
+            return true;
+        }
+        begin = close_quote + 1;
+    }
+    return false;
+}
+
+/*!
+ * Find a numeric attribute of an XML tag.
+ * \param begin The start of the attributes of the tag.
+ * \param end The end of the attributes of the tag.
+ * \param name The name of the attribute to find.
+ * \param[out] result The value of the attribute, if found.
+ * \return Whether the attribute was found and is a number.
+ */
+static bool findXmlAttribute(const char* begin, const char* end, const char* name, double& result)
+{
+    const char* value_begin;
+    const char* value_end;
+    return findXmlAttribute(begin, end, name, value_begin, value_end) && parseDouble(value_begin, value_end, result);
+}
+
+/*!
+ * Parse the transform attribute of a 3MF component or build item.
+ *
+ * 3MF uses the same convention as FMatrix4x3: the points are row vectors that
+ * are multiplied with the matrix, so the twelve numbers fill the matrix in the
+ * same order.
+ * \param tag The tag to get the transform of.
+ * \return The transformation, or the identity if the tag doesn't have one.
+ */
+static FMatrix4x3 parse3MFTransform(const XmlTag& tag)
+{
+    FMatrix4x3 result;
+    const char* value_begin;
+    const char* value_end;
+    if (!findXmlAttribute(tag.attributes_begin, tag.attributes_end, "transform", value_begin, value_end))
+    {
+        return result;
+    }
+    FMatrix4x3 parsed;
+    for (size_t element = 0; element < 12; element++)
+    {
+        if (!parseDouble(value_begin, value_end, parsed.m[element / 3][element % 3]))
+        {
+            logWarning("Ignoring malformed transform in the 3MF file.\n");
+            return result;
+        }
+    }
+    return parsed;
+}
+
+/*!
+ * Combine two transformations into one.
+ * \param first The transformation to apply first.
+ * \param second The transformation to apply after that.
+ * \return A transformation that has the same effect as applying both.
+ */
+static FMatrix4x3 compose(const FMatrix4x3& first, const FMatrix4x3& second)
+{
+    FMatrix4x3 result;
+    for (size_t row = 0; row < 4; row++)
+    {
+        for (size_t column = 0; column < 3; column++)
+        {
+            double value = (row == 3) ? second.m[3][column] : 0.0;
+            for (size_t k = 0; k < 3; k++)
+            {
+                value += first.m[row][k] * second.m[k][column];
+            }
+            result.m[row][column] = value;
+        }
+    }
+    return result;
+}
+
+/*!
+ * Parse all elements with the given tag between two positions in a 3MF model
+ * file, in parallel.
+ *
+ * The <vertices> and <triangles> blocks are where nearly all of the data of a
+ * 3MF file is. They contain nothing but their elements, so they can be split
+ * at any '<' and each part can be parsed on its own.
+ * \param begin The start of the block, after its opening tag.
+ * \param end The end of the block, at its closing tag.
+ * \param tag_name The name of the elements to parse.
+ * \param parse_element Function that parses one element from its tag, or
+ * returns false if it's malformed.
+ * \return The parsed elements, in file order.
+ */
+template<typename Element, typename ParseElement>
+static std::vector<Element> parse3MFElements(const char* begin, const char* end, const char* tag_name, const ParseElement& parse_element)
+{
+    const std::vector<const char*> chunk_starts = splitIntoChunks(begin, end, [](const char c) { return c == '<'; }, true);
+    std::vector<std::vector<Element>> chunk_elements(chunk_starts.size() - 1);
+#pragma omp parallel for default(none) shared(chunk_starts, chunk_elements, tag_name, parse_element) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int chunk_idx = 0; chunk_idx < static_cast<int>(chunk_elements.size()); chunk_idx++)
+    {
+        const char* position = chunk_starts[chunk_idx];
+        XmlTag tag;
+        Element element;
+        while (nextXmlTag(position, chunk_starts[chunk_idx + 1], tag))
+        {
+            if (!tag.is_end_tag && tag.name == tag_name && parse_element(tag, element))
+            {
+                chunk_elements[chunk_idx].push_back(element);
+            }
+        }
+    }
+
+    std::vector<Element> result;
+    for (std::vector<Element>& elements : chunk_elements)
+    {
+        result.insert(result.end(), elements.begin(), elements.end());
+        std::vector<Element>().swap(elements);
+    }
+    return result;
+}
+
+/*!
+ * An object in a 3MF model file. It's either a mesh or a set of other objects.
+ */
+struct ThreeMFObject
+{
+    std::vector<FPoint3> vertices;
+    std::vector<std::array<size_t, 3>> triangles; //!< The vertex indices of each triangle.
+    std::vector<std::pair<int, FMatrix4x3>> components; //!< The IDs of the objects this object consists of, with their transformations.
+};
+
+/*!
+ * Collect the triangles of a 3MF object and the objects it's made of,
+ * transformed to their place on the build plate.
+ * \param objects All objects in the model file, by their ID.
+ * \param object_id The object to collect the triangles of.
+ * \param transformation The transformation from the object to the build plate.
+ * \param depth How deep the components are nested, to stop on cyclic files.
+ * \param[out] corners The transformed corners of the triangles.
+ */
+static void collect3MFTriangles(const std::unordered_map<int, ThreeMFObject>& objects, const int object_id, const FMatrix4x3& transformation, const size_t depth, std::vector<Point3>& corners)
+{
+    constexpr size_t max_depth = 32;
+    const auto found = objects.find(object_id);
+    if (found == objects.end() || depth > max_depth)
+    {
+        logWarning("Skipping the missing or too deeply nested object %i in the 3MF file.\n", object_id);
+        return;
+    }
+    const ThreeMFObject& object = found->second;
+
+    const size_t corners_start = corners.size();
+    corners.resize(corners_start + object.triangles.size() * 3);
+#pragma omp parallel for default(none) shared(object, transformation, corners, corners_start)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int triangle_idx = 0; triangle_idx < static_cast<int>(object.triangles.size()); triangle_idx++)
+    {
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            corners[corners_start + triangle_idx * 3 + corner] = transformation.apply(object.vertices[object.triangles[triangle_idx][corner]]);
+        }
+    }
+
+    for (const std::pair<int, FMatrix4x3>& component : object.components)
+    {
+        collect3MFTriangles(objects, component.first, compose(component.second, transformation), depth + 1, corners);
+    }
+}
+
+/*!
+ * Find the path of the model file in a 3MF archive from its relationships.
+ * \param archive The 3MF archive.
+ * \return The path of the model file in the archive, without leading slash.
+ */
+static std::string find3MFModelPath(const ZipArchive& archive)
+{
+    const std::string default_path = "3D/3dmodel.model";
+    const std::optional<std::string> relationships = archive.read("_rels/.rels");
+    if (!relationships)
+    {
+        return default_path;
+    }
+    const char* position = relationships->data();
+    const char* end = position + relationships->size();
+    XmlTag tag;
+    while (nextXmlTag(position, end, tag))
+    {
+        const char* type_begin;
+        const char* type_end;
+        const char* target_begin;
+        const char* target_end;
+        if (tag.is_end_tag || tag.name != "Relationship"
+            || !findXmlAttribute(tag.attributes_begin, tag.attributes_end, "Type", type_begin, type_end)
+            || !findXmlAttribute(tag.attributes_begin, tag.attributes_end, "Target", target_begin, target_end))
+        {
+            continue;
+        }
+        const std::string type(type_begin, type_end);
+        const std::string model_type = "/3dmodel";
+        if (type.size() >= model_type.size() && type.compare(type.size() - model_type.size(), model_type.size(), model_type) == 0)
+        {
+            while (target_begin < target_end && *target_begin == '/')
+            {
+                target_begin++;
+            }
+            return std::string(target_begin, target_end);
+        }
+    }
+    return default_path;
+}
+
+bool loadMesh3MF(MeshGroup* meshgroup, const char* filename, const FMatrix4x3& transformation, Settings& object_parent_settings)
+{
+    const ZipArchive archive(filename);
+    if (!archive.isValid())
+    {
+        return false;
+    }
+    const std::optional<std::string> model = archive.read(find3MFModelPath(archive));
+    if (!model)
+    {
+        logError("Couldn't find the model in the 3MF file %s.\n", filename);
+        return false;
+    }
+
+    // The structure of the file is read serially, but the vertex and triangle lists are parsed in parallel.
+    const char* position = model->data();
+    const char* end = position + model->size();
+    std::unordered_map<int, ThreeMFObject> objects;
+    std::vector<std::pair<int, FMatrix4x3>> build_items;
+    double unit = 1.0; //Millimetres per unit of the model.
+    ThreeMFObject* current_object = nullptr;
+    XmlTag tag;
+    while (nextXmlTag(position, end, tag))
+    {
+        if (tag.is_end_tag)
+        {
+            if (tag.name == "object")
+            {
+                current_object = nullptr;
+            }
+            continue;
+        }
+        if (tag.name == "model")
+        {
+            const char* unit_begin;
+            const char* unit_end;
+            if (findXmlAttribute(tag.attributes_begin, tag.attributes_end, "unit", unit_begin, unit_end))
+            {
+                const std::string unit_name(unit_begin, unit_end);
+                const std::unordered_map<std::string, double> units = { { "micron", 0.001 }, { "millimeter", 1.0 }, { "centimeter", 10.0 }, { "inch", 25.4 }, { "foot", 304.8 }, { "meter", 1000.0 } };
+                const auto found = units.find(unit_name);
+                if (found != units.end())
+                {
+                    unit = found->second;
+                }
+                else
+                {
+                    logWarning("Unknown unit %s in the 3MF file. Assuming millimetres.\n", unit_name.c_str());
+                }
+            }
+        }
+        else if (tag.name == "object")
+        {
+            double id;
+            current_object = findXmlAttribute(tag.attributes_begin, tag.attributes_end, "id", id) ? &objects[static_cast<int>(id)] : nullptr;
+        }
+        else if ((tag.name == "vertices" || tag.name == "triangles") && current_object && !tag.is_self_closing)
+        {
+            // These blocks only contain their elements, so their end is the first closing tag.
+            const char* block_end = std::search(position, end, "</", "</" + 2);
+            if (tag.name == "vertices")
+            {
+                current_object->vertices = parse3MFElements<FPoint3>(position, block_end, "vertex", [](const XmlTag& vertex_tag, FPoint3& vertex)
+                {
+                    double x, y, z;
+                    if (!findXmlAttribute(vertex_tag.attributes_begin, vertex_tag.attributes_end, "x", x)
+                        || !findXmlAttribute(vertex_tag.attributes_begin, vertex_tag.attributes_end, "y", y)
+                        || !findXmlAttribute(vertex_tag.attributes_begin, vertex_tag.attributes_end, "z", z))
+                    {
+                        return false;
+                    }
+                    vertex = FPoint3(x, y, z);
+                    return true;
+                });
+            }
+            else
+            {
+                current_object->triangles = parse3MFElements<std::array<size_t, 3>>(position, block_end, "triangle", [](const XmlTag& triangle_tag, std::array<size_t, 3>& triangle)
+                {
+                    const char* names[3] = { "v1", "v2", "v3" };
+                    for (size_t corner = 0; corner < 3; corner++)
+                    {
+                        double index;
+                        if (!findXmlAttribute(triangle_tag.attributes_begin, triangle_tag.attributes_end, names[corner], index) || index < 0)
+                        {
+                            return false;
+                        }
+                        triangle[corner] = index;
+                    }
+                    return true;
+                });
+            }
+            position = block_end;
+        }
+        else if (tag.name == "component" && current_object)
+        {
+            double object_id;
+            if (findXmlAttribute(tag.attributes_begin, tag.attributes_end, "objectid", object_id))
+            {
+                current_object->components.emplace_back(static_cast<int>(object_id), parse3MFTransform(tag));
+            }
+        }
+        else if (tag.name == "item")
+        {
+            double object_id;
+            if (findXmlAttribute(tag.attributes_begin, tag.attributes_end, "objectid", object_id))
+            {
+                build_items.emplace_back(static_cast<int>(object_id), parse3MFTransform(tag));
+            }
+        }
+    }
+
+    for (std::pair<const int, ThreeMFObject>& object : objects)
+    {
+        const size_t vertex_count = object.second.vertices.size();
+        const size_t triangle_count = object.second.triangles.size();
+        std::vector<std::array<size_t, 3>>& triangles = object.second.triangles;
+        triangles.erase(std::remove_if(triangles.begin(), triangles.end(), [vertex_count](const std::array<size_t, 3>& triangle)
+            {
+                return triangle[0] >= vertex_count || triangle[1] >= vertex_count || triangle[2] >= vertex_count;
+            }), triangles.end());
+        if (triangles.size() != triangle_count)
+        {
+            logWarning("Skipped %zu triangles of object %i that refer to vertices that don't exist.\n", triangle_count - triangles.size(), object.first);
+        }
+    }
+
+    // Every build item becomes a mesh, in model units until the unit scale and the transformation from the command line are applied.
+    const FMatrix4x3 unit_transformation = compose(FMatrix4x3::scale(unit, Point3(0, 0, 0)), transformation);
+    size_t loaded_meshes = 0;
+    for (const std::pair<int, FMatrix4x3>& item : build_items)
+    {
+        std::vector<Point3> corners;
+        collect3MFTriangles(objects, item.first, compose(item.second, unit_transformation), 0, corners);
+        if (corners.empty())
+        {
+            continue;
+        }
+        Mesh mesh(object_parent_settings);
+        mesh.mesh_name = filename;
+        mesh.faces.reserve(corners.size() / 3);
+        mesh.vertices.reserve(corners.size() / 6);
+        mesh.addFaces(corners);
+        mesh.finish();
+        meshgroup->meshes.push_back(mesh);
+        loaded_meshes++;
+    }
+    return loaded_meshes > 0;
+}
+
 bool loadMeshIntoMeshGroup(MeshGroup* meshgroup, const char* filename, const FMatrix4x3& transformation, Settings& object_parent_settings)
 {
     TimeKeeper load_timer;
 
     const char* ext = strrchr(filename, '.');
-    if (ext && (strcmp(ext, ".stl") == 0 || strcmp(ext, ".STL") == 0))
+    if (ext && stringcasecompare(ext, ".stl") == 0)
     {
         Mesh mesh(object_parent_settings);
         if (loadMeshSTL(&mesh, filename, transformation)) //Load it! If successful...
@@ -280,7 +1058,25 @@ bool loadMeshIntoMeshGroup(MeshGroup* meshgroup, const char* filename, const FMa
             return true;
         }
     }
-    logWarning("Unable to recognize the extension of the file. Currently only .stl and .STL are supported.");
+    else if (ext && stringcasecompare(ext, ".obj") == 0)
+    {
+        Mesh mesh(object_parent_settings);
+        if (loadMeshOBJ(&mesh, filename, transformation))
+        {
+            meshgroup->meshes.push_back(mesh);
+            log("loading '%s' took %.3f seconds\n", filename, load_timer.restart());
+            return true;
+        }
+    }
+    else if (ext && stringcasecompare(ext, ".3mf") == 0)
+    {
+        if (loadMesh3MF(meshgroup, filename, transformation, object_parent_settings))
+        {
+            log("loading '%s' took %.3f seconds\n", filename, load_timer.restart());
+            return true;
+        }
+    }
+    logWarning("Unable to recognize the extension of the file. Currently only .stl, .obj and .3mf are supported.");
     return false;
 }
 
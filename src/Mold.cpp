@@ -45,78 +45,110 @@ void Mold::process(std::vector<Slicer*>& slicer_list)
     }
 
     const coord_t layer_height = scene.current_mesh_group->settings.get<coord_t>("layer_height");
-    std::vector<Polygons> mold_outline_above_per_mesh; // the outer outlines of the layer above without the original model(s) being cut out
-    mold_outline_above_per_mesh.resize(slicer_list.size());
-    for (int layer_nr = layer_count - 1; layer_nr >= 0; layer_nr--)
-    {
-        Polygons all_original_mold_outlines; // outlines of all models for which to generate a mold (insides of all molds)
 
-        // first generate outlines
-        for (unsigned int mesh_idx = 0; mesh_idx < slicer_list.size(); mesh_idx++)
+    // Only the outside of each mold depends on the layers above it. Everything else only depends on the layer itself, so that is computed for all layers in parallel.
+    std::vector<std::vector<Polygons>> model_outlines_per_mesh(slicer_list.size()); // for each mesh and layer, the outlines of the model (the inside of its mold)
+    std::vector<std::vector<Polygons>> mold_outlines_per_mesh(slicer_list.size()); // for each mesh and layer, the outside of the mold, without the mold of the layers above
+    for (unsigned int mesh_idx = 0; mesh_idx < slicer_list.size(); mesh_idx++)
+    {
+        const Mesh& mesh = scene.current_mesh_group->meshes[mesh_idx];
+        if (!mesh.settings.get<bool>("mold_enabled"))
+        {
+            continue;
+        }
+        Slicer& slicer = *slicer_list[mesh_idx];
+        const coord_t width = mesh.settings.get<coord_t>("mold_width");
+        const coord_t roof_height = mesh.settings.get<coord_t>("mold_roof_height");
+        const size_t roof_layer_count = roof_height / layer_height;
+        std::vector<Polygons>& model_outlines = model_outlines_per_mesh[mesh_idx];
+        std::vector<Polygons>& mold_outlines = mold_outlines_per_mesh[mesh_idx];
+        model_outlines.resize(slicer.layers.size());
+        mold_outlines.resize(slicer.layers.size());
+
+#pragma omp parallel for default(none) shared(mesh, slicer, model_outlines, mold_outlines) firstprivate(width, roof_layer_count) schedule(dynamic)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int layer_nr = 0; layer_nr < static_cast<int>(slicer.layers.size()); layer_nr++)
         {
-            const Mesh& mesh = scene.current_mesh_group->meshes[mesh_idx];
-            Slicer& slicer = *slicer_list[mesh_idx];
-            if (!mesh.settings.get<bool>("mold_enabled") || layer_nr >= static_cast<int>(slicer.layers.size()))
-            {
-                continue;
-            }
-            coord_t width = mesh.settings.get<coord_t>("mold_width");
             coord_t open_polyline_width = mesh.settings.get<coord_t>("wall_line_width_0");
             if (layer_nr == 0)
             {
                 const ExtruderTrain& train_wall_0 = mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr");
                 open_polyline_width *= train_wall_0.settings.get<Ratio>("initial_layer_line_width_factor");
             }
-            const AngleDegrees angle = mesh.settings.get<AngleDegrees>("mold_angle");
-            const coord_t roof_height = mesh.settings.get<coord_t>("mold_roof_height");
-
-            const coord_t inset = tan(angle / 180 * M_PI) * layer_height;
-            const size_t roof_layer_count = roof_height / layer_height;
+            const SlicerLayer& layer = slicer.layers[layer_nr];
+            model_outlines[layer_nr] = layer.polygons.unionPolygons(layer.openPolylines.offsetPolyLine(open_polyline_width / 2));
+            mold_outlines[layer_nr] = model_outlines[layer_nr].offset(width, ClipperLib::jtRound);
 
+            // add roofs
+            if (roof_layer_count > 0 && layer_nr > 0)
+            {
+                unsigned int layer_nr_below = std::max(0, static_cast<int>(layer_nr - roof_layer_count));
+                Polygons roofs = slicer.layers[layer_nr_below].polygons.offset(width, ClipperLib::jtRound); // TODO: don't compute offset twice!
+                mold_outlines[layer_nr] = mold_outlines[layer_nr].unionPolygons(roofs);
+            }
+        }
+    }
 
+    // Then each mold gets the mold of the layer above it added, from the top down. The molds of different meshes are independent of each other.
+#pragma omp parallel for default(none) shared(slicer_list, scene, mold_outlines_per_mesh, layer_height) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int mesh_idx = 0; mesh_idx < static_cast<int>(slicer_list.size()); mesh_idx++)
+    {
+        const Mesh& mesh = scene.current_mesh_group->meshes[mesh_idx];
+        if (!mesh.settings.get<bool>("mold_enabled"))
+        {
+            continue;
+        }
+        Slicer& slicer = *slicer_list[mesh_idx];
+        const AngleDegrees angle = mesh.settings.get<AngleDegrees>("mold_angle");
+        const coord_t inset = tan(angle / 180 * M_PI) * layer_height;
+        const Polygons* mold_outline_above = nullptr; // the outside of the mold on the layer above
+        for (int layer_nr = static_cast<int>(slicer.layers.size()) - 1; layer_nr >= 0; layer_nr--)
+        {
             SlicerLayer& layer = slicer.layers[layer_nr];
-            Polygons model_outlines = layer.polygons.unionPolygons(layer.openPolylines.offsetPolyLine(open_polyline_width / 2));
             layer.openPolylines.clear();
-            all_original_mold_outlines.add(model_outlines);
-
-            if (angle >= 90)
+            layer.part_starts.clear();
+            if (angle >= 90 || !mold_outline_above)
             {
-                layer.polygons = model_outlines.offset(width, ClipperLib::jtRound);
+                layer.polygons = std::move(mold_outlines_per_mesh[mesh_idx][layer_nr]);
             }
             else
             {
-                Polygons& mold_outline_above = mold_outline_above_per_mesh[mesh_idx]; // the outside of the mold on the layer above
-                layer.polygons = mold_outline_above.offset(-inset).unionPolygons(model_outlines.offset(width, ClipperLib::jtRound));
+                layer.polygons = mold_outline_above->offset(-inset).unionPolygons(mold_outlines_per_mesh[mesh_idx][layer_nr]);
             }
+            mold_outline_above = &layer.polygons;
+        }
+    }
 
-            // add roofs
-            if (roof_layer_count > 0 && layer_nr > 0)
+    // cut out molds from all objects after generating mold outlines for all objects so that molds won't overlap into the casting cutout of another mold
+#pragma omp parallel for default(none) shared(slicer_list, scene, model_outlines_per_mesh, layer_count) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(layer_count); layer_nr++)
+    {
+        Polygons all_original_mold_outlines; // outlines of all models for which to generate a mold (insides of all molds)
+        for (unsigned int mesh_idx = 0; mesh_idx < slicer_list.size(); mesh_idx++)
+        {
+            if (layer_nr < static_cast<int>(model_outlines_per_mesh[mesh_idx].size()))
             {
-                unsigned int layer_nr_below = std::max(0, static_cast<int>(layer_nr - roof_layer_count));
-                Polygons roofs = slicer.layers[layer_nr_below].polygons.offset(width, ClipperLib::jtRound); // TODO: don't compute offset twice!
-                layer.polygons = layer.polygons.unionPolygons(roofs);
+                all_original_mold_outlines.add(model_outlines_per_mesh[mesh_idx][layer_nr]);
             }
-
-            mold_outline_above_per_mesh[mesh_idx] = layer.polygons;
         }
         all_original_mold_outlines = all_original_mold_outlines.unionPolygons();
 
-        // cut out molds from all objects after generating mold outlines for all objects so that molds won't overlap into the casting cutout of another mold
-
         // carve molds out of all other models
         for (unsigned int mesh_idx = 0; mesh_idx < slicer_list.size(); mesh_idx++)
         {
             const Mesh& mesh = scene.current_mesh_group->meshes[mesh_idx];
-            if (!mesh.settings.get<bool>("mold_enabled"))
+            Slicer& slicer = *slicer_list[mesh_idx];
+            if (!mesh.settings.get<bool>("mold_enabled") || layer_nr >= static_cast<int>(slicer.layers.size()))
             {
                 continue; // only cut original models out of all molds
             }
-            Slicer& slicer = *slicer_list[mesh_idx];
             SlicerLayer& layer = slicer.layers[layer_nr];
             layer.polygons = layer.polygons.difference(all_original_mold_outlines);
+            layer.part_starts.clear();
         }
     }
-
 }
 
 
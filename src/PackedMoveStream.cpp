@@ -0,0 +1,270 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cmath> //For std::llround.
+#include <cstring> //For memcpy.
+
+#include "PackedMoveStream.h"
+#include "utils/string.h" //To write the moves back as g-code in the same way as GCodeExport does.
+
+namespace cura
+{
+
+namespace
+{
+
+constexpr char header[] = { 'C', 'U', 'R', 'A', 'P', 'M', 'S', 1 }; //The magic and the version of the format.
+
+}
+
+PackedMoveStream::PackedMoveStream(std::ostream* target)
+: std::ostream(nullptr)
+, target(target)
+, text_buffer(*this)
+, last_x(0)
+, last_y(0)
+, last_z(0)
+, last_e(0)
+, last_extruder_axis('E')
+, last_feature(PrintFeatureType::NoneType)
+{
+    rdbuf(&text_buffer); //The buffer is only constructed after the base class, so it can't be passed to the constructor of std::ostream.
+    target->write(header, sizeof(header));
+}
+
+PackedMoveStream::~PackedMoveStream()
+{
+    flushText();
+    target->flush();
+}
+
+void PackedMoveStream::writeMove(const bool is_extrusion, const double feedrate, const coord_t x, const coord_t y, const coord_t z, const bool z_changes, const char extruder_axis, const double e, const bool e_changes, const PrintFeatureType feature, const std::string& new_line)
+{
+    flushText();
+    if (e_changes && extruder_axis != last_extruder_axis)
+    {
+        target->put(tag_extruder_axis);
+        target->put(extruder_axis);
+        last_extruder_axis = extruder_axis;
+    }
+
+    unsigned char tag = tag_move;
+    tag |= is_extrusion ? flag_extrusion : 0;
+    tag |= feedrate >= 0 ? flag_feedrate : 0;
+    tag |= z_changes ? flag_z : 0;
+    tag |= e_changes ? flag_e : 0;
+    tag |= feature != last_feature ? flag_feature : 0;
+    tag |= new_line == "\r\n" ? flag_crlf : 0;
+    record.clear();
+    record.push_back(tag);
+    if (feedrate >= 0)
+    {
+        char bytes[sizeof(double)];
+        std::memcpy(bytes, &feedrate, sizeof(double)); //All platforms that Cura supports are little-endian.
+        record.append(bytes, sizeof(double));
+    }
+    if (feature != last_feature)
+    {
+        record.push_back(static_cast<char>(feature));
+        last_feature = feature;
+    }
+    writeSignedVarint(x - last_x);
+    writeSignedVarint(y - last_y);
+    last_x = x;
+    last_y = y;
+    if (z_changes)
+    {
+        writeSignedVarint(z - last_z);
+        last_z = z;
+    }
+    if (e_changes)
+    {
+        const int64_t e_units = std::llround(e * e_resolution);
+        writeSignedVarint(e_units - last_e);
+        last_e = e_units;
+    }
+    target->write(record.data(), record.size());
+}
+
+bool PackedMoveStream::decode(std::istream& packed, std::ostream& gcode)
+{
+    char file_header[sizeof(header)];
+    if (!packed.read(file_header, sizeof(header)) || std::memcmp(file_header, header, sizeof(header)) != 0)
+    {
+        return false;
+    }
+
+    coord_t x = 0;
+    coord_t y = 0;
+    coord_t z = 0;
+    int64_t e = 0;
+    char extruder_axis = 'E';
+    std::string text;
+    int tag;
+    while ((tag = packed.get()) != std::istream::traits_type::eof())
+    {
+        if (tag == tag_text)
+        {
+            uint64_t length;
+            if (!readVarint(packed, length))
+            {
+                return false;
+            }
+            text.resize(length);
+            if (!packed.read(&text[0], length))
+            {
+                return false;
+            }
+            gcode << text;
+        }
+        else if (tag == tag_extruder_axis)
+        {
+            const int axis = packed.get();
+            if (axis == std::istream::traits_type::eof())
+            {
+                return false;
+            }
+            extruder_axis = static_cast<char>(axis);
+        }
+        else if (tag & tag_move)
+        {
+            double feedrate = 0;
+            if (tag & flag_feedrate)
+            {
+                char bytes[sizeof(double)];
+                if (!packed.read(bytes, sizeof(double)))
+                {
+                    return false;
+                }
+                std::memcpy(&feedrate, bytes, sizeof(double));
+            }
+            if ((tag & flag_feature) && packed.get() == std::istream::traits_type::eof()) //The feature type isn't part of the g-code.
+            {
+                return false;
+            }
+            int64_t delta_x;
+            int64_t delta_y;
+            int64_t delta_z = 0;
+            int64_t delta_e = 0;
+            if (!readSignedVarint(packed, delta_x) || !readSignedVarint(packed, delta_y)
+                || ((tag & flag_z) && !readSignedVarint(packed, delta_z))
+                || ((tag & flag_e) && !readSignedVarint(packed, delta_e)))
+            {
+                return false;
+            }
+            x += delta_x;
+            y += delta_y;
+            z += delta_z;
+            e += delta_e;
+
+            //Same format as GCodeExport::writeFXYZE.
+            gcode << ((tag & flag_extrusion) ? "G1" : "G0");
+            if (tag & flag_feedrate)
+            {
+                gcode << " F" << PrecisionedDouble{1, feedrate};
+            }
+            gcode << " X" << MMtoStream{x} << " Y" << MMtoStream{y};
+            if (tag & flag_z)
+            {
+                gcode << " Z" << MMtoStream{z};
+            }
+            if (tag & flag_e)
+            {
+                gcode << " " << extruder_axis << PrecisionedDouble{5, e / e_resolution};
+            }
+            gcode << ((tag & flag_crlf) ? "\r\n" : "\n");
+        }
+        else
+        {
+            return false; //Unknown record.
+        }
+    }
+    return true;
+}
+
+void PackedMoveStream::flushText()
+{
+    if (pending_text.empty())
+    {
+        return;
+    }
+    record.clear();
+    record.push_back(tag_text);
+    writeVarint(pending_text.size());
+    target->write(record.data(), record.size());
+    target->write(pending_text.data(), pending_text.size());
+    pending_text.clear();
+}
+
+void PackedMoveStream::writeVarint(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        record.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    record.push_back(static_cast<char>(value));
+}
+
+void PackedMoveStream::writeSignedVarint(const int64_t value)
+{
+    writeVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63)); //Zigzag encoding.
+}
+
+bool PackedMoveStream::readVarint(std::istream& packed, uint64_t& value)
+{
+    value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7)
+    {
+        const int byte = packed.get();
+        if (byte == std::istream::traits_type::eof())
+        {
+            return false;
+        }
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false; //Too long.
+}
+
+bool PackedMoveStream::readSignedVarint(std::istream& packed, int64_t& value)
+{
+    uint64_t zigzag;
+    if (!readVarint(packed, zigzag))
+    {
+        return false;
+    }
+    value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+    return true;
+}
+
+PackedMoveStream::TextBuffer::TextBuffer(PackedMoveStream& stream)
+: stream(stream)
+{
+}
+
+PackedMoveStream::TextBuffer::int_type PackedMoveStream::TextBuffer::overflow(int_type character)
+{
+    if (!traits_type::eq_int_type(character, traits_type::eof()))
+    {
+        stream.pending_text.push_back(traits_type::to_char_type(character));
+    }
+    return traits_type::not_eof(character);
+}
+
+std::streamsize PackedMoveStream::TextBuffer::xsputn(const char* data, std::streamsize count)
+{
+    stream.pending_text.append(data, count);
+    return count;
+}
+
+int PackedMoveStream::TextBuffer::sync()
+{
+    stream.flushText();
+    return stream.target->flush() ? 0 : -1;
+}
+
+} //namespace cura
@@ -0,0 +1,152 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef PACKED_MOVE_STREAM_H
+#define PACKED_MOVE_STREAM_H
+
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include "PrintFeature.h"
+#include "utils/Coord_t.h"
+#include "utils/NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Output stream that stores the moves of the g-code in a compact binary
+ * form, and all other g-code as text.
+ *
+ * \ref GCodeExport writes its moves to this with \ref writeMove instead of
+ * formatting them as text. Everything written to it as a stream (temperature
+ * commands, comments, and so on) is stored verbatim. The original g-code can
+ * be restored with \ref decode.
+ *
+ * The format is a sequence of records, after an 8-byte header "CURAPMS" plus a
+ * version byte (currently 1). All integers are little-endian. Variable-length
+ * integers (varints) are LEB128: 7 bits per byte, lowest first, with the high
+ * bit set on all but the last byte. Signed varints are zigzag-encoded first,
+ * so small negative numbers stay small. Each record starts with a tag byte:
+ * - 0x01: Text. A varint with the length, followed by that many bytes of
+ *   g-code.
+ * - 0x02: Extruder axis. One byte with the letter of the axis used for the
+ *   extrusion values in subsequent moves, normally 'E'.
+ * - 0x80 and up: A G0 or G1 move. The lower bits of the tag are flags:
+ *   - 0x01: G1 if set, G0 if not.
+ *   - 0x02: The feedrate changes. An 8-byte double with the new F value
+ *     (mm/min) follows.
+ *   - 0x04: The Z coordinate changes.
+ *   - 0x08: The move has an extrusion value.
+ *   - 0x10: The feature type changes. One byte with the new PrintFeatureType
+ *     follows.
+ *   - 0x20: The line ends with "\r\n" rather than "\n".
+ *   After that, signed varints follow with the difference in X and Y, then
+ *   in Z if it changes, then in the extrusion value if present. X, Y and Z
+ *   are in microns and start at 0. The extrusion value is in units of
+ *   0.00001, the resolution at which g-code writes it, and starts at 0.
+ */
+class PackedMoveStream : public std::ostream, public NoCopy
+{
+public:
+    /*!
+     * Start a packed stream. This writes the header to the target stream.
+     * \param target Where to write the packed data to. It must outlive this
+     * stream.
+     */
+    PackedMoveStream(std::ostream* target);
+
+    /*!
+     * Writes any remaining text to the target stream.
+     */
+    ~PackedMoveStream();
+
+    /*!
+     * Store a G0 or G1 move.
+     *
+     * Any text written to this stream before is stored first, so that the
+     * order is preserved.
+     * \param is_extrusion Whether this is a G1 move rather than a G0 move.
+     * \param feedrate The new F value of the move in mm/min, or a negative
+     * number if it doesn't change.
+     * \param x The X coordinate of the destination, in microns.
+     * \param y The Y coordinate of the destination, in microns.
+     * \param z The Z coordinate of the destination, in microns.
+     * \param z_changes Whether the Z coordinate is written for this move.
+     * \param extruder_axis The letter of the axis for the extrusion value.
+     * \param e The extrusion value that would be written in the g-code.
+     * \param e_changes Whether the extrusion value is written for this move.
+     * \param feature The type of feature the move belongs to.
+     * \param new_line The line ending to use.
+     */
+    void writeMove(const bool is_extrusion, const double feedrate, const coord_t x, const coord_t y, const coord_t z, const bool z_changes, const char extruder_axis, const double e, const bool e_changes, const PrintFeatureType feature, const std::string& new_line);
+
+    /*!
+     * Convert a packed stream back into g-code.
+     * \param packed The packed data, starting at the header.
+     * \param gcode The stream to write the g-code to.
+     * \return Whether the packed data was valid and complete.
+     */
+    static bool decode(std::istream& packed, std::ostream& gcode);
+
+private:
+    /*!
+     * Collects the text written to the stream until the next move.
+     */
+    class TextBuffer : public std::streambuf
+    {
+    public:
+        TextBuffer(PackedMoveStream& stream);
+
+    protected:
+        int_type overflow(int_type character) override;
+
+        std::streamsize xsputn(const char* data, std::streamsize count) override;
+
+        int sync() override;
+
+    private:
+        PackedMoveStream& stream; //!< The stream to which this buffer belongs.
+    };
+
+    static constexpr unsigned char tag_text = 0x01;
+    static constexpr unsigned char tag_extruder_axis = 0x02;
+    static constexpr unsigned char tag_move = 0x80;
+    static constexpr unsigned char flag_extrusion = 0x01;
+    static constexpr unsigned char flag_feedrate = 0x02;
+    static constexpr unsigned char flag_z = 0x04;
+    static constexpr unsigned char flag_e = 0x08;
+    static constexpr unsigned char flag_feature = 0x10;
+    static constexpr unsigned char flag_crlf = 0x20;
+    static constexpr double e_resolution = 100000.0; //!< The number of extrusion units per unit of E.
+
+    /*!
+     * Store the text that was written since the last move as a text record.
+     */
+    void flushText();
+
+    void writeVarint(uint64_t value);
+
+    void writeSignedVarint(const int64_t value);
+
+    static bool readVarint(std::istream& packed, uint64_t& value);
+
+    static bool readSignedVarint(std::istream& packed, int64_t& value);
+
+    std::ostream* target; //!< Where the packed data goes.
+    TextBuffer text_buffer; //!< What the text is written into.
+    std::string pending_text; //!< Text that was written since the last move.
+    std::string record; //!< Reused to compose each move record in.
+    coord_t last_x; //!< The X coordinate of the previous move.
+    coord_t last_y; //!< The Y coordinate of the previous move.
+    coord_t last_z; //!< The Z coordinate of the last move that changed it.
+    int64_t last_e; //!< The extrusion value of the last move that had one, in extrusion units.
+    char last_extruder_axis; //!< The axis letter that was stored last.
+    PrintFeatureType last_feature; //!< The feature type that was stored last.
+};
+
+} //namespace cura
+
+#endif //PACKED_MOVE_STREAM_H
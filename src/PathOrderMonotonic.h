@@ -5,6 +5,7 @@
 #define PATHORDERMONOTONIC_H
 
 #include <cmath> //For std::sin() and std::cos().
+#include <limits> //For the range of the overlap buckets.
 #include <unordered_set> //To track starting points of monotonic sequences.
 #include <unordered_map> //To track monotonic sequences.
 
@@ -96,8 +97,18 @@ public:
 
             return a_projection < b_projection;
         });
+        const Point perpendicular = turn90CCW(monotonic_vector); //To project on to detect adjacent lines.
+        const OverlapBuckets overlap_buckets = createOverlapBuckets(polylines, perpendicular);
+        std::unordered_map<Path*, size_t> sorted_index; //For each polyline, where it is in the sorted order.
+        sorted_index.reserve(polylines.size());
+        for(size_t line_idx = 0; line_idx < polylines.size(); line_idx++)
+        {
+            sorted_index.emplace(polylines[line_idx], line_idx);
+        }
         //Create a bucket grid to be able to find adjacent lines quickly.
         SparsePointGridInclusive<Path*> line_bucket_grid(MM2INT(2)); //Grid size of 2mm.
+        std::vector<typename SparsePointGridInclusive<Path*>::Elem> endpoints;
+        endpoints.reserve(polylines.size() * 2);
         for(Path* polyline : polylines)
         {
             if(polyline->converted->empty())
@@ -106,10 +117,11 @@ public:
             }
             else
             {
-                line_bucket_grid.insert(polyline->converted->front(), polyline);
-                line_bucket_grid.insert(polyline->converted->back(), polyline);
+                endpoints.emplace_back(polyline->converted->front(), polyline);
+                endpoints.emplace_back(polyline->converted->back(), polyline);
             }
         }
+        line_bucket_grid.insertAll(endpoints); //The grid is only queried after this.
 
         //Create sequences of line segments that get printed together in a monotonic direction.
         //There are several constraints we impose here:
@@ -122,7 +134,6 @@ public:
         //The ``starting_lines`` set indicates possible locations to start from. Each starting line represents one "sequence", which is either a set of adjacent line segments or a string of polylines.
         //The ``connections`` map indicates, starting from each starting segment, the sequence of line segments to print in order.
         //Note that for performance reasons, the ``connections`` map will sometimes link the end of one segment to the start of the next segment. This link should be ignored.
-        const Point perpendicular = turn90CCW(monotonic_vector); //To project on to detect adjacent lines.
 
         std::unordered_set<Path*> connected_lines; //Lines that are reachable from one of the starting lines through its connections.
         std::unordered_set<Path*> starting_lines; //Starting points of a linearly connected segment.
@@ -150,7 +161,7 @@ public:
                     //The strings of polylines may still have weird shapes which interweave with other strings of polylines or loose lines.
                     //So when a polyline string comes into contact with other lines, we still want to guarantee their order.
                     //So here we will look for which lines they come into contact with, and thus mark those as possible starting points, so that they function as a new junction.
-                    const std::vector<Path*> overlapping_lines = getOverlappingLines(std::find(polylines.begin(), polylines.end(), polystring[i]), perpendicular, polylines);
+                    const std::vector<Path*> overlapping_lines = getOverlappingLines(sorted_index[polystring[i]], overlap_buckets, polylines);
                     for(Path* overlapping_line : overlapping_lines)
                     {
                         if(std::find(polystring.begin(), polystring.end(), overlapping_line) == polystring.end()) //Mark all overlapping lines not part of the string as possible starting points.
@@ -167,7 +178,7 @@ public:
                 {
                     starting_lines.insert(*polyline_it); //This is a starting point then.
                 }
-                const std::vector<Path*> overlapping_lines = getOverlappingLines(polyline_it, perpendicular, polylines);
+                const std::vector<Path*> overlapping_lines = getOverlappingLines(polyline_it - polylines.begin(), overlap_buckets, polylines);
                 if(overlapping_lines.size() == 1) //If we're not a string of polylines, but adjacent to only one other polyline, create a sequence of polylines.
                 {
                     connections[*polyline_it] = overlapping_lines[0];
@@ -390,65 +401,128 @@ protected:
     }
 
     /*!
-     * Find which lines are overlapping with a certain line.
-     * \param polyline_it The line with which to find overlaps. Given as an
-     * iterator into the sorted polylines list, to cut down on the search space.
-     * If the lines don't have too much overlap, this should result in only a
-     * handful of lines being searched at all.
+     * How far a polyline extends in the monotonic direction and perpendicular
+     * to it, as projections on the monotonic vector and the perpendicular
+     * vector.
+     */
+    struct LineExtents
+    {
+        coord_t closest_projection; //!< The endpoint furthest back in the monotonic direction.
+        coord_t farthest_projection; //!< The endpoint furthest ahead in the monotonic direction.
+        coord_t perpendicular_start; //!< The lowest endpoint in the perpendicular direction.
+        coord_t perpendicular_end; //!< The highest endpoint in the perpendicular direction.
+    };
+
+    /*!
+     * Buckets to find the lines that overlap in the perpendicular direction.
+     *
+     * The perpendicular range of all lines is divided into buckets of equal
+     * size. Each bucket holds the lines that reach into it, in the sorted
+     * order of the lines. The buckets are about as large as the average line,
+     * so that most lines are in one or two buckets.
+     */
+    struct OverlapBuckets
+    {
+        std::vector<LineExtents> extents; //!< The extents of each line, in the sorted order.
+        coord_t min_perpendicular; //!< Where the first bucket starts.
+        coord_t bucket_size;
+        std::vector<std::vector<size_t>> buckets; //!< For each bucket, the indices of the lines that reach into it, in ascending order.
+
+        size_t getBucket(const coord_t perpendicular_projection) const
+        {
+            return (perpendicular_projection - min_perpendicular) / bucket_size;
+        }
+    };
+
+    /*!
+     * Put the lines in buckets by their perpendicular extent.
+     * \param polylines The polylines, sorted by their projection on the
+     * monotonic vector.
      * \param perpendicular A vector perpendicular to the monotonic vector, pre-
      * calculated.
-     * \param polylines The sorted list of polylines.
      */
-    std::vector<Path*> getOverlappingLines(const typename std::vector<Path*>::iterator polyline_it, const Point perpendicular, const std::vector<Path*>& polylines)
+    OverlapBuckets createOverlapBuckets(const std::vector<Path*>& polylines, const Point perpendicular) const
     {
-        //How far this extends in the monotonic direction, to make sure we only go up to max_adjacent_distance in that direction.
-        const coord_t start_projection = dot((*polyline_it)->converted->front(), monotonic_vector);
-        const coord_t end_projection = dot((*polyline_it)->converted->back(), monotonic_vector);
-        const coord_t my_farthest_projection = std::max(start_projection, end_projection);
-        const coord_t my_closest_projection = std::min(start_projection, end_projection);
-        //How far this line reaches in the perpendicular direction -- the range at which the line overlaps other lines.
-        coord_t my_start = dot((*polyline_it)->converted->front(), perpendicular);
-        coord_t my_end = dot((*polyline_it)->converted->back(), perpendicular);
-        if(my_start > my_end)
+        OverlapBuckets result;
+        result.extents.reserve(polylines.size());
+        coord_t max_perpendicular = std::numeric_limits<coord_t>::min();
+        result.min_perpendicular = std::numeric_limits<coord_t>::max();
+        coord_t total_length = 0;
+        for(const Path* polyline : polylines)
         {
-            std::swap(my_start, my_end);
+            const coord_t start_projection = dot(polyline->converted->front(), monotonic_vector);
+            const coord_t end_projection = dot(polyline->converted->back(), monotonic_vector);
+            const coord_t start_perpendicular = dot(polyline->converted->front(), perpendicular);
+            const coord_t end_perpendicular = dot(polyline->converted->back(), perpendicular);
+            result.extents.push_back({ std::min(start_projection, end_projection), std::max(start_projection, end_projection), std::min(start_perpendicular, end_perpendicular), std::max(start_perpendicular, end_perpendicular) });
+            result.min_perpendicular = std::min(result.min_perpendicular, result.extents.back().perpendicular_start);
+            max_perpendicular = std::max(max_perpendicular, result.extents.back().perpendicular_end);
+            total_length += result.extents.back().perpendicular_end - result.extents.back().perpendicular_start;
+        }
+        if(polylines.empty())
+        {
+            return result;
         }
 
-        std::vector<Path*> overlapping_lines;
-        for(auto overlapping_line = polyline_it + 1; overlapping_line != polylines.end(); overlapping_line++)
+        //Not more buckets than lines, so that lines that are much longer than the average don't take too much memory.
+        const coord_t num_lines = polylines.size();
+        result.bucket_size = std::max({ coord_t(1), total_length / num_lines, (max_perpendicular - result.min_perpendicular) / num_lines + 1 });
+        result.buckets.resize(result.getBucket(max_perpendicular) + 1);
+        for(size_t line_idx = 0; line_idx < polylines.size(); line_idx++)
         {
-            //Don't go beyond the maximum adjacent distance.
-            const coord_t start_their_projection = dot((*overlapping_line)->converted->front(), monotonic_vector);
-            const coord_t end_their_projection = dot((*overlapping_line)->converted->back(), monotonic_vector);
-            const coord_t their_farthest_projection = std::max(start_their_projection, end_their_projection);
-            const coord_t their_closest_projection = std::min(start_their_projection, end_their_projection);
-            if(their_closest_projection - my_farthest_projection > max_adjacent_distance * monotonic_vector_resolution
-                    || my_closest_projection - their_farthest_projection > max_adjacent_distance * monotonic_vector_resolution) //Multiply by the length of the vector since we need to compare actual distances here.
+            const LineExtents& extents = result.extents[line_idx];
+            for(size_t bucket = result.getBucket(extents.perpendicular_start); bucket <= result.getBucket(extents.perpendicular_end); bucket++)
             {
-                break; //Too far. This line and all subsequent lines are not adjacent any more, even though they might be side-by-side.
+                result.buckets[bucket].push_back(line_idx);
             }
+        }
+        return result;
+    }
 
-            //Does this one overlap?
-            coord_t their_start = dot((*overlapping_line)->converted->front(), perpendicular);
-            coord_t their_end = dot((*overlapping_line)->converted->back(), perpendicular);
-            if(their_start > their_end)
-            {
-                std::swap(their_start, their_end);
-            }
-            /*There are 5 possible cases of overlapping:
-            - We are behind them, partially overlapping. my_start is between their_start and their_end.
-            - We are in front of them, partially overlapping. my_end is between their_start and their_end.
-            - We are a smaller line, they completely overlap us. Both my_start and my_end are between their_start and their_end. (Caught with the first 2 conditions already.)
-            - We are a bigger line, and completely overlap them. Both their_start and their_end are between my_start and my_end.
-            - Lines are exactly equal. Start and end are the same. (Caught with the previous condition too.)*/
-            if(    (my_start >= their_start && my_start <= their_end)
-                || (my_end >= their_start   && my_end <= their_end)
-                || (their_start >= my_start && their_end <= my_end))
+    /*!
+     * Find which lines are overlapping with a certain line.
+     *
+     * Only lines later in the sorted order, up to max_adjacent_distance ahead
+     * in the monotonic direction, are considered. Of those, only the lines in
+     * the same buckets in the perpendicular direction are checked.
+     * \param line_idx The index of the line with which to find overlaps, in
+     * the sorted polylines list.
+     * \param overlap_buckets The lines by their perpendicular extents.
+     * \param polylines The sorted list of polylines.
+     * \return The overlapping lines, in the sorted order.
+     */
+    std::vector<Path*> getOverlappingLines(const size_t line_idx, const OverlapBuckets& overlap_buckets, const std::vector<Path*>& polylines)
+    {
+        const LineExtents& mine = overlap_buckets.extents[line_idx];
+        //Don't go beyond the maximum adjacent distance. Multiply by the length of the vector since we need to compare actual distances here.
+        const coord_t max_projection = mine.farthest_projection + max_adjacent_distance * monotonic_vector_resolution;
+
+        const size_t first_bucket = overlap_buckets.getBucket(mine.perpendicular_start);
+        const size_t last_bucket = overlap_buckets.getBucket(mine.perpendicular_end);
+        std::vector<size_t> overlapping_indices;
+        for(size_t bucket_idx = first_bucket; bucket_idx <= last_bucket; bucket_idx++)
+        {
+            const std::vector<size_t>& bucket = overlap_buckets.buckets[bucket_idx];
+            //The buckets are sorted like the lines, so the lines that are too far ahead come after all of the candidates.
+            for(auto other = std::upper_bound(bucket.begin(), bucket.end(), line_idx); other != bucket.end() && overlap_buckets.extents[*other].closest_projection <= max_projection; other++)
             {
-                overlapping_lines.push_back(*overlapping_line);
+                const LineExtents& theirs = overlap_buckets.extents[*other];
+                //Does this one overlap? Report lines that are in multiple buckets only from the first bucket that both lines reach into.
+                if(theirs.perpendicular_start <= mine.perpendicular_end && mine.perpendicular_start <= theirs.perpendicular_end
+                    && std::max(first_bucket, overlap_buckets.getBucket(theirs.perpendicular_start)) == bucket_idx)
+                {
+                    overlapping_indices.push_back(*other);
+                }
             }
         }
+        std::sort(overlapping_indices.begin(), overlapping_indices.end());
 
+        std::vector<Path*> overlapping_lines;
+        overlapping_lines.reserve(overlapping_indices.size());
+        for(const size_t overlapping_idx : overlapping_indices)
+        {
+            overlapping_lines.push_back(polylines[overlapping_idx]);
+        }
         return overlapping_lines;
     }
 
@@ -5,15 +5,23 @@
 #define PATHORDEROPTIMIZER_H
 
 
+#include <algorithm> //For std::all_of, std::reverse and std::rotate.
+#include <chrono> //To limit the time spent on refining the order.
+#include <cmath> //For std::sqrt.
+#include <memory> //For unique_ptr.
+#include <random> //To choose random seams.
 #include <unordered_set>
 
-#include "InsetOrderOptimizer.h" // for makeOrderIncludeTransitive
 #include "PathOrderPath.h"
 #include "pathPlanning/CombPath.h" //To calculate the combing distance if we want to use combing.
 #include "pathPlanning/LinePolygonsCrossings.h" //To prevent calculating combing distances if we don't cross the combing borders.
 #include "settings/EnumSettings.h" //To get the seam settings.
 #include "settings/ZSeamConfig.h" //To read the seam configuration.
+#include "settings/types/Duration.h" //For the time budget of refining the order.
+#include "settings/types/LayerIndex.h" //To vary the random seams between layers.
+#include "utils/AABB.h" //To size the grid to find the nearest path.
 #include "utils/linearAlg2D.h" //To find the angle of corners to hide seams.
+#include "utils/NearestPointGrid.h" //To find the nearest path quickly.
 #include "utils/polygonUtils.h"
 #include "utils/Simplify.h"
 
@@ -73,6 +81,39 @@ public:
      */
     ZSeamConfig seam_config;
 
+    /*!
+     * How much time may be spent on improving the order after the greedy
+     * nearest-neighbour ordering.
+     *
+     * The order is improved by local search: reversing a stretch of paths
+     * (2-opt) and moving a few consecutive paths elsewhere (Or-opt), as long
+     * as that makes the travel moves shorter. After optimizing, this holds the
+     * part of the budget that wasn't used, so that it can be passed on to the
+     * next optimizer in the same layer. If it's zero, only the greedy order is
+     * computed.
+     */
+    Duration refinement_time_budget;
+
+    /*!
+     * Whether to keep refining the order until no improvement can be found,
+     * regardless of how long that takes.
+     *
+     * How far the refinement gets in its time budget depends on the speed of
+     * the computer and how busy it is, so the result isn't reproducible. With
+     * this, the \ref refinement_time_budget only determines whether to refine
+     * the order at all, and is not used up.
+     */
+    bool refine_until_converged;
+
+    /*!
+     * The layer that the paths are printed on.
+     *
+     * Random seams are chosen with the layer number as well as the start
+     * point, so that layers that start from the same point don't all get the
+     * same seams.
+     */
+    LayerIndex layer_nr;
+
     /*!
      * Construct a new optimizer.
      *
@@ -90,6 +131,9 @@ public:
     PathOrderOptimizer(const Point start_point, const ZSeamConfig seam_config = ZSeamConfig(), const bool detect_loops = false, const Polygons* combing_boundary = nullptr, const bool reverse_direction = false, const std::unordered_set<std::pair<PathType, PathType>>& order_requirements = no_order_requirements)
     : start_point(start_point)
     , seam_config(seam_config)
+    , refinement_time_budget(0)
+    , refine_until_converged(false)
+    , layer_nr(0)
     , combing_boundary((combing_boundary != nullptr && !combing_boundary->empty()) ? combing_boundary : nullptr)
     , detect_loops(detect_loops)
     , reverse_direction(reverse_direction)
@@ -117,6 +161,29 @@ public:
         paths.emplace_back(polyline, is_closed);
     }
 
+    /*!
+     * Require all paths of one group to be printed before all paths of
+     * another group.
+     *
+     * This has the same effect as an order requirement for every pair of a
+     * path in \p before and a path in \p after, but the requirement is kept
+     * as a single node in the graph of requirements, with an edge from each
+     * path before it and to each path after it. That takes time and memory
+     * linear in the number of paths rather than in the number of pairs.
+     * \param before The paths that must be printed first. They must be added
+     * to this optimizer.
+     * \param after The paths that must be printed after all of \p before .
+     * They must be added to this optimizer.
+     */
+    void addGroupOrderRequirement(std::vector<PathType> before, std::vector<PathType> after)
+    {
+        if(before.empty() || after.empty())
+        {
+            return; //Nothing is required.
+        }
+        group_order_requirements.emplace_back(std::move(before), std::move(after));
+    }
+
     /*!
      * Perform the calculations to optimize the order of the parts.
      *
@@ -129,6 +196,7 @@ public:
         {
             return;
         }
+        random_generator.seed(static_cast<std::minstd_rand::result_type>(start_point.X * 73856093 ^ start_point.Y * 19349663 ^ static_cast<coord_t>(layer_nr.value) * 83492791));
 
         //Get the vertex data and store it in the paths.
         for(PathOrderPath<PathType>& path : paths)
@@ -152,6 +220,7 @@ public:
         //Add all vertices to a bucket grid so that we can find nearby endpoints quickly.
         const coord_t snap_radius = 10_mu; // 0.01mm grid cells. Chaining only needs to consider polylines which are next to each other.
         SparsePointGridInclusive<size_t> line_bucket_grid(snap_radius);
+        std::vector<typename SparsePointGridInclusive<size_t>::Elem> bucket_vertices;
         for(size_t i = 0; i < paths.size(); ++i)
         {
             const PathOrderPath<PathType>& path = paths[i];
@@ -163,23 +232,27 @@ public:
             {
                 for(const Point& point : *path.converted)
                 {
-                    line_bucket_grid.insert(point, i); //Store by index so that we can also mark them down in the `picked` vector.
+                    bucket_vertices.emplace_back(point, i); //Store by index so that we can also mark them down in the `picked` vector.
                 }
             }
             else //For polylines, only insert the endpoints. Those are the only places we can start from so the only relevant vertices to be near to.
             {
-                line_bucket_grid.insert(path.converted->front(), i);
-                line_bucket_grid.insert(path.converted->back(), i);
+                bucket_vertices.emplace_back(path.converted->front(), i);
+                bucket_vertices.emplace_back(path.converted->back(), i);
             }
         }
+        line_bucket_grid.insertAll(bucket_vertices); //The grid is only queried after this.
 
         //For some Z seam types the start position can be pre-computed.
         //This is faster since we don't need to re-compute the start position at each step then.
         const bool precompute_start = seam_config.type == EZSeamType::RANDOM || seam_config.type == EZSeamType::USER_SPECIFIED || seam_config.type == EZSeamType::SHARPEST_CORNER;
+        seam_candidates.clear();
+        seam_candidates.resize(paths.size());
         if(precompute_start)
         {
-            for(PathOrderPath<PathType>& path : paths)
+            for(size_t path_idx = 0; path_idx < paths.size(); path_idx++)
             {
+                PathOrderPath<PathType>& path = paths[path_idx];
                 if(!path.is_closed)
                 {
                     continue; //Can't pre-compute the seam for open polylines since they're at the endpoint nearest to the current position.
@@ -188,12 +261,23 @@ public:
                 {
                     continue;
                 }
-                path.start_vertex = findStartLocation(path, seam_config.pos);
+                path.start_vertex = findStartLocation(path_idx, seam_config.pos);
             }
         }
         
-        std::vector<size_t> blocked(paths.size(), 0); // Flag for seeing whether a path is blocked by a preceding toolpath to be printed first (and how many such blocking toolpaths there are)
-        std::vector<std::vector<size_t>> is_blocking(paths.size()); // For each path all paths that it is blocking, i.e. each path that it should precede
+        //If the start location of each path doesn't depend on where we come from, or is one of the endpoints of a polyline, the nearest path can be found through a grid of those locations.
+        //Otherwise every remaining path needs to be checked for every step.
+        std::unique_ptr<NearestPointGrid<size_t>> nearest_grid;
+        if(combing_boundary == nullptr && paths.size() >= min_paths_for_nearest_grid
+            && std::all_of(paths.begin(), paths.end(), [precompute_start](const PathOrderPath<PathType>& path) { return !path.is_closed || precompute_start; }))
+        {
+            nearest_grid = createNearestGrid(paths);
+        }
+
+        //The group order requirements are nodes in the graph of requirements after the paths.
+        const size_t num_nodes = paths.size() + group_order_requirements.size();
+        std::vector<size_t> blocked(num_nodes, 0); // Flag for seeing whether a path is blocked by a preceding toolpath to be printed first (and how many such blocking toolpaths there are)
+        std::vector<std::vector<size_t>> is_blocking(num_nodes); // For each path all paths that it is blocking, i.e. each path that it should precede
         std::unordered_map<PathType, size_t> path_to_index;
         for (size_t idx = 0; idx < paths.size(); idx++)
         {
@@ -209,12 +293,32 @@ public:
             assert(before_it != path_to_index.end());
             is_blocking[before_it->second].emplace_back(after_it->second);
         }
+        for (size_t group_idx = 0; group_idx < group_order_requirements.size(); group_idx++)
+        {
+            const size_t node = paths.size() + group_idx;
+            for (const PathType& before : group_order_requirements[group_idx].first)
+            {
+                auto before_it = path_to_index.find(before);
+                assert(before_it != path_to_index.end());
+                is_blocking[before_it->second].emplace_back(node);
+                blocked[node]++;
+            }
+            for (const PathType& after : group_order_requirements[group_idx].second)
+            {
+                auto after_it = path_to_index.find(after);
+                assert(after_it != path_to_index.end());
+                is_blocking[node].emplace_back(after_it->second);
+                blocked[after_it->second]++;
+            }
+        }
 
 
         std::vector<bool> picked(paths.size(), false); //Fixed size boolean flag for whether each path is already in the optimized vector.
         Point current_position = start_point;
         std::vector<PathOrderPath<PathType>> optimized_order; //To store our result in. At the end we'll std::swap.
         optimized_order.reserve(paths.size());
+        std::vector<size_t> optimized_indices; //For each path in the optimized order, its index in the paths field.
+        optimized_indices.reserve(paths.size());
         while(optimized_order.size() < paths.size())
         {
             size_t best_candidate = 0;
@@ -232,6 +336,14 @@ public:
                 }
                 available_candidates.push_back(candidate);
             }
+            if(available_candidates.empty() && nearest_grid) //Find the nearest of all candidates through the grid.
+            {
+                size_t nearest_candidate;
+                if(nearest_grid->findNearest(current_position, [&picked, &blocked](const size_t candidate) { return !picked[candidate] && !blocked[candidate]; }, nearest_candidate))
+                {
+                    available_candidates.push_back(nearest_candidate);
+                }
+            }
             if(available_candidates.empty()) //We may need to broaden our search through all candidates then.
             {
                 for(size_t candidate = 0; candidate < paths.size(); ++candidate)
@@ -258,7 +370,7 @@ public:
 
                 if(!path.is_closed || !precompute_start) //Find the start location unless we've already precomputed it.
                 {
-                    path.start_vertex = findStartLocation(path, current_position);
+                    path.start_vertex = findStartLocation(candidate_path_index, current_position);
                     if(!path.is_closed) //Open polylines start at vertex 0 or vertex N-1. Indicate that they should be reversed if they start at N-1.
                     {
                         path.backwards = path.start_vertex > 0;
@@ -279,10 +391,25 @@ public:
 
             PathOrderPath<PathType>& best_path = paths[best_candidate];
             optimized_order.push_back(best_path);
+            optimized_indices.push_back(best_candidate);
             picked[best_candidate] = true;
+            if(nearest_grid && !best_path.converted->empty())
+            {
+                for(const Point& location : getStartCandidates(best_path))
+                {
+                    nearest_grid->remove(location, best_candidate);
+                }
+            }
             for (size_t unlocked_idx : is_blocking[best_candidate])
             {
                 blocked[unlocked_idx]--;
+                if (unlocked_idx >= paths.size() && blocked[unlocked_idx] == 0) //All paths before a group order requirement are printed, so it no longer blocks the paths after it.
+                {
+                    for (size_t unlocked_after_group_idx : is_blocking[unlocked_idx])
+                    {
+                        blocked[unlocked_after_group_idx]--;
+                    }
+                }
             }
 
             if(!best_path.converted->empty()) //If all paths were empty, the best path is still empty. We don't upate the current position then.
@@ -299,6 +426,11 @@ public:
             }
         }
 
+        if(refinement_time_budget > 0)
+        {
+            refineOrder(optimized_order, optimized_indices, is_blocking);
+        }
+
         //Apply the optimized order to the output field. Reverse if ordered to reverse.
         if(reverse_direction)
         {
@@ -323,8 +455,16 @@ public:
         }
         
         combing_grid.reset();
+        seam_candidates.clear();
     }
 protected:
+    /*!
+     * The minimum number of paths for which the nearest path is found through
+     * a \ref NearestPointGrid. For fewer paths, checking all of them is
+     * quicker than building the grid.
+     */
+    constexpr static size_t min_paths_for_nearest_grid = 32;
+
     /*!
      * If \ref detect_loops is enabled, endpoints of polylines that are closer
      * than this distance together will be considered to be coincident, closing
@@ -373,6 +513,157 @@ protected:
      */
     const std::unordered_set<std::pair<PathType, PathType>>* order_requirements;
 
+    /*!
+     * Order requirements between groups of paths, see
+     * \ref addGroupOrderRequirement . For each pair all paths of the first
+     * group need to be printed before all paths of the second.
+     */
+    std::vector<std::pair<std::vector<PathType>, std::vector<PathType>>> group_order_requirements;
+
+    /*!
+     * Chooses the seams of polygons with random seams.
+     *
+     * It's seeded with the start point and the layer number, rather than using
+     * a shared generator, so that the seams don't depend on the order in which
+     * the layers are processed by different threads.
+     */
+    mutable std::minstd_rand random_generator;
+
+    /*!
+     * The vertices of a polygon where its seam may be placed, with everything
+     * about them that doesn't depend on where the nozzle comes from.
+     */
+    struct SeamCandidates
+    {
+        Polygon simple_poly; //!< The polygon, simplified to find its corners.
+        std::vector<float> corner_angles; //!< For each vertex of \ref simple_poly the angle of its corner, between -1 and 1. Positive for concave corners.
+        size_t start_from_pos; //!< The vertex of \ref simple_poly closest to the focus point of the seam, where the search for the seam starts.
+    };
+
+    /*!
+     * For each path the seam candidates, once they were needed.
+     *
+     * If the seam depends on where the nozzle comes from, the start location
+     * of a path is found again every time that it's considered. The corners
+     * stay the same, so they're only computed once.
+     */
+    std::vector<std::unique_ptr<SeamCandidates>> seam_candidates;
+
+    /*!
+     * Get the seam candidates of a polygon, computing them if that wasn't done
+     * yet.
+     * \param path_idx The index of the polygon in \ref paths.
+     */
+    const SeamCandidates& getSeamCandidates(const size_t path_idx)
+    {
+        std::unique_ptr<SeamCandidates>& candidates = seam_candidates[path_idx];
+        if(candidates)
+        {
+            return *candidates;
+        }
+        const PathOrderPath<PathType>& path = paths[path_idx];
+
+        // Don't know the path-type here, or whether it has a simplify. Also, simplification occurs in-place, which is not wanted here: Copy the polygon.
+        // A course simplification is needed, since Arachne has a tendency to 'smear' corners out over multiple line segments.
+        // Which in itself is a good thing, but will mess up the detection of sharp corners and such.
+        Polygon simple_poly(*path.converted);
+        if (seam_config.simplify_curvature > 0 && simple_poly.size() > 2)
+        {
+            const coord_t max_simplify_dist = seam_config.simplify_curvature;
+            simple_poly = Simplify(max_simplify_dist, max_simplify_dist / 2, 0).polygon(simple_poly);
+        }
+        if(simple_poly.empty()) //Simplify removed everything because it's all too small.
+        {
+            simple_poly = Polygon(*path.converted); //Restore the original. We have to output a vertex as the seam position, so there needs to be a vertex.
+        }
+
+        // Paths, other than polygons, can be either clockwise or counterclockwise. Make sure this is detected.
+        const bool clockwise = simple_poly.orientation();
+
+        const Point focus_fixed_point = (seam_config.type == EZSeamType::USER_SPECIFIED)
+            ? seam_config.pos
+            : Point(0, std::sqrt(std::numeric_limits<coord_t>::max())); //Use sqrt, so the squared size can be used when comparing distances.
+        const size_t start_from_pos = std::min_element(simple_poly.begin(), simple_poly.end(), [focus_fixed_point](const Point& a, const Point& b) {
+            return vSize2(a - focus_fixed_point) < vSize2(b - focus_fixed_point);
+        }) - simple_poly.begin();
+
+        std::vector<float> corner_angles(simple_poly.size());
+        for(size_t i = 0; i < simple_poly.size(); ++i)
+        {
+            const Point& previous = simple_poly[(i + simple_poly.size() - 1) % simple_poly.size()];
+            const Point& here = simple_poly[i];
+            const Point& next = simple_poly[(i + 1) % simple_poly.size()];
+            corner_angles[i] = (clockwise ? LinearAlg2D::getAngleLeft(previous, here, next) : LinearAlg2D::getAngleLeft(next, here, previous)) / M_PI - 1; //Between -1 and 1.
+        }
+
+        candidates = std::make_unique<SeamCandidates>(SeamCandidates{std::move(simple_poly), std::move(corner_angles), start_from_pos});
+        return *candidates;
+    }
+
+    /*!
+     * Get the locations where a path could start printing, if those don't
+     * depend on where the nozzle comes from.
+     *
+     * For polygons this is the pre-computed seam location. For polylines these
+     * are both endpoints.
+     * \param path The path to get the start locations of. It must not be
+     * empty.
+     * \return The candidate start locations.
+     */
+    std::vector<Point> getStartCandidates(const PathOrderPath<PathType>& path) const
+    {
+        if(path.is_closed)
+        {
+            return { (*path.converted)[path.start_vertex] };
+        }
+        return { path.converted->front(), path.converted->back() };
+    }
+
+    /*!
+     * Create a grid of the start locations of all paths, to look up the
+     * nearest path quickly.
+     *
+     * The start locations of the polygons must have been pre-computed.
+     * \param grid_paths The paths to put in the grid.
+     * \return A grid with the start candidates of all non-empty paths, by the
+     * index of the path in \p grid_paths.
+     */
+    std::unique_ptr<NearestPointGrid<size_t>> createNearestGrid(const std::vector<PathOrderPath<PathType>>& grid_paths) const
+    {
+        AABB bounding_box;
+        size_t num_locations = 0;
+        for(const PathOrderPath<PathType>& path : grid_paths)
+        {
+            if(path.converted->empty())
+            {
+                continue;
+            }
+            for(const Point& location : getStartCandidates(path))
+            {
+                bounding_box.include(location);
+                num_locations++;
+            }
+        }
+        //Aim for about one location per cell.
+        const double area = std::max(1.0, static_cast<double>(bounding_box.max.X - bounding_box.min.X) * static_cast<double>(bounding_box.max.Y - bounding_box.min.Y));
+        const coord_t cell_size = std::max(coord_t(MM2INT(0.1)), static_cast<coord_t>(std::sqrt(area / std::max(size_t(1), num_locations))));
+
+        std::unique_ptr<NearestPointGrid<size_t>> grid = std::make_unique<NearestPointGrid<size_t>>(cell_size);
+        for(size_t path_idx = 0; path_idx < grid_paths.size(); path_idx++)
+        {
+            const PathOrderPath<PathType>& path = grid_paths[path_idx];
+            if(path.converted->empty())
+            {
+                continue;
+            }
+            for(const Point& location : getStartCandidates(path))
+            {
+                grid->insert(location, path_idx);
+            }
+        }
+        return grid;
+    }
+
     /*!
      * Find the vertex which will be the starting point of printing a polygon or
      * polyline.
@@ -380,8 +671,8 @@ protected:
      * This will be the seam location (for polygons) or the closest endpoint
      * (for polylines). Usually the seam location is some combination of being
      * the closest point and/or being a sharp inner or outer corner.
-     * \param vertices The vertex data of a path. This will never be empty (so
-     * no need to check again) but might have size 1.
+     * \param path_idx The index of the path in \ref paths. Its vertex data
+     * will never be empty (so no need to check again) but might have size 1.
      * \param target_pos The point that the starting vertex must be close to, if
      * applicable.
      * \param is_closed Whether the polygon is closed (a polygon) or not
@@ -389,8 +680,9 @@ protected:
      * endpoints rather than 
      * \return An index to a vertex in that path where printing must start.
      */
-    size_t findStartLocation(const PathOrderPath<PathType>& path, const Point& target_pos)
+    size_t findStartLocation(const size_t path_idx, const Point& target_pos)
     {
+        const PathOrderPath<PathType>& path = paths[path_idx];
         if(!path.is_closed)
         {
             //For polylines, the seam settings are not applicable. Simply choose the position closest to target_pos then.
@@ -415,47 +707,17 @@ protected:
             return vert;
         }
 
-        // Don't know the path-type here, or whether it has a simplify. Also, simplification occurs in-place, which is not wanted here: Copy the polygon.
-        // A course simplification is needed, since Arachne has a tendency to 'smear' corners out over multiple line segments.
-        // Which in itself is a good thing, but will mess up the detection of sharp corners and such.
-        Polygon simple_poly(*path.converted);
-        if (seam_config.simplify_curvature > 0 && simple_poly.size() > 2)
-        {
-            const coord_t max_simplify_dist = seam_config.simplify_curvature;
-            simple_poly = Simplify(max_simplify_dist, max_simplify_dist / 2, 0).polygon(simple_poly);
-        }
-        if(simple_poly.empty()) //Simplify removed everything because it's all too small.
-        {
-            simple_poly = Polygon(*path.converted); //Restore the original. We have to output a vertex as the seam position, so there needs to be a vertex.
-        }
-
-        // Paths, other than polygons, can be either clockwise or counterclockwise. Make sure this is detected.
-        const bool clockwise = simple_poly.orientation();
-
-        const Point focus_fixed_point = (seam_config.type == EZSeamType::USER_SPECIFIED)
-            ? seam_config.pos
-            : Point(0, std::sqrt(std::numeric_limits<coord_t>::max())); //Use sqrt, so the squared size can be used when comparing distances.
-        const size_t start_from_pos = std::min_element(simple_poly.begin(), simple_poly.end(), [focus_fixed_point](const Point& a, const Point& b) {
-            return vSize2(a - focus_fixed_point) < vSize2(b - focus_fixed_point);
-        }) - simple_poly.begin();
+        const SeamCandidates& candidates = getSeamCandidates(path_idx);
+        const Polygon& simple_poly = candidates.simple_poly;
+        const size_t start_from_pos = candidates.start_from_pos;
         const size_t end_before_pos = simple_poly.size() + start_from_pos;
 
-        // Find a seam position in the simple polygon:
-        Point best_point;
-        float best_score = std::numeric_limits<float>::infinity();
-        Point previous = simple_poly[(start_from_pos - 1 + simple_poly.size()) % simple_poly.size()];
-        for(size_t i = start_from_pos; i < end_before_pos; ++i)
+        //For most seam types, the shortest distance matters. Not for SHARPEST_CORNER though.
+        //For SHARPEST_CORNER, use a fixed starting score of 0.
+        const bool score_uses_distance = !(seam_config.type == EZSeamType::SHARPEST_CORNER && seam_config.corner_pref != EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_NONE);
+        const auto get_score = [this, score_uses_distance](const coord_t distance, const float corner_angle)
         {
-            const Point& here = simple_poly[i % simple_poly.size()];
-            const Point& next = simple_poly[(i + 1) % simple_poly.size()];
-
-            //For most seam types, the shortest distance matters. Not for SHARPEST_CORNER though.
-            //For SHARPEST_CORNER, use a fixed starting score of 0.
-            const coord_t distance = (combing_boundary == nullptr)
-                ? getDirectDistance(here, target_pos)
-                : getCombingDistance(here, target_pos);
-            const float score_distance = (seam_config.type == EZSeamType::SHARPEST_CORNER && seam_config.corner_pref != EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_NONE) ? 0 : static_cast<float>(distance) / 1000000;
-            const float corner_angle = (clockwise ? LinearAlg2D::getAngleLeft(previous, here, next) : LinearAlg2D::getAngleLeft(next, here, previous)) / M_PI - 1; //Between -1 and 1.
+            const float score_distance = score_uses_distance ? static_cast<float>(distance) / 1000000 : 0;
 
             float score;
             const float corner_shift = seam_config.type != EZSeamType::USER_SPECIFIED ? 10000 : 0; //Allow up to 20mm shifting of the seam to find a good location. For SHARPEST_CORNER, this shift is the only factor. For USER_SPECIFIED, don't allow shifting.
@@ -502,8 +764,38 @@ protected:
                     score += 1000; //1 meter penalty.
                 }
             }
+            return score;
+        };
+
+        // Find a seam position in the simple polygon:
+        Point best_point;
+        float best_score = std::numeric_limits<float>::infinity();
+        constexpr float EPSILON = 25.0;
+        for(size_t i = start_from_pos; i < end_before_pos; ++i)
+        {
+            const Point& here = simple_poly[i % simple_poly.size()];
+            const float corner_angle = candidates.corner_angles[i % simple_poly.size()];
+
+            float score;
+            if(!score_uses_distance)
+            {
+                score = get_score(0, corner_angle);
+            }
+            else if(combing_boundary == nullptr)
+            {
+                score = get_score(getDirectDistance(here, target_pos), corner_angle);
+            }
+            else
+            {
+                //Combing is never shorter than moving directly (apart from rounding the length of each piece of the comb path, which is far within the extra margin).
+                //If this vertex can't even come close to the best score when moving directly, it doesn't need the costly combing distance.
+                if(get_score(getDirectDistance(here, target_pos), corner_angle) > best_score + 2 * EPSILON)
+                {
+                    continue;
+                }
+                score = get_score(getCombingDistance(here, target_pos), corner_angle);
+            }
 
-            constexpr float EPSILON = 25.0;
             if (fabs(best_score - score) <= EPSILON)
             {
                 // add breaker for two candidate starting location with similar score
@@ -522,7 +814,6 @@ protected:
                 best_point = here;
                 best_score = score;
             }
-            previous = here;
         }
 
         // Which point in the real deal is closest to the simple polygon version?
@@ -554,6 +845,23 @@ protected:
         return vSize2(a - b);
     }
 
+    /*!
+     * Get the grid of the line segments of the combing boundary. Create it
+     * when it hasn't been created yet.
+     *
+     * This method assumes that there is a combing boundary. So
+     * \ref combing_boundary should not be ``nullptr``.
+     */
+    LocToLineGrid& getCombingGrid()
+    {
+        if(combing_grid == nullptr)
+        {
+            constexpr coord_t grid_size = 2000; //2mm grid cells. Smaller will use more memory, but reduce chance of unnecessary collision checks.
+            combing_grid = PolygonUtils::createLocToLineGrid(*combing_boundary, grid_size);
+        }
+        return *combing_grid;
+    }
+
     /*!
      * Calculate the distance that one would have to travel to move from A to B
      * while avoiding collisions with the combing boundary.
@@ -566,7 +874,10 @@ protected:
      */
     coord_t getCombingDistance(const Point& a, const Point& b)
     {
-        if(!PolygonUtils::polygonCollidesWithLineSegment(*combing_boundary, a, b))
+        const bool collides = (vSize2(b - a) < 2) //The grid doesn't handle line segments this short.
+            ? PolygonUtils::polygonCollidesWithLineSegment(*combing_boundary, a, b)
+            : PolygonUtils::polygonCollidesWithLineSegment(a, b, getCombingGrid());
+        if(!collides)
         {
             return getDirectDistance(a, b); //No collision with any line. Just compute the direct distance then.
         }
@@ -578,17 +889,11 @@ protected:
             return getDirectDistance(a, b) * 5;
         }
 
-        if(combing_grid == nullptr)
-        {
-            constexpr coord_t grid_size = 2000; //2mm grid cells. Smaller will use more memory, but reduce chance of unnecessary collision checks.
-            combing_grid = PolygonUtils::createLocToLineGrid(*combing_boundary, grid_size);
-        }
-
         CombPath comb_path; //Output variable.
         constexpr coord_t rounding_error = -25;
         constexpr coord_t tiny_travel_threshold = 0;
         constexpr bool fail_on_unavoidable_obstacles = false;
-        LinePolygonsCrossings::comb(*combing_boundary, *combing_grid, a, b, comb_path, rounding_error, tiny_travel_threshold, fail_on_unavoidable_obstacles);
+        LinePolygonsCrossings::comb(*combing_boundary, getCombingGrid(), a, b, comb_path, rounding_error, tiny_travel_threshold, fail_on_unavoidable_obstacles);
 
         coord_t sum = 0;
         Point last_point = a;
@@ -607,7 +912,297 @@ protected:
      */
     size_t getRandomPointInPolygon(ConstPolygonRef const& polygon) const
     {
-        return rand() % polygon.size();
+        return random_generator() % polygon.size();
+    }
+
+    /*!
+     * Improve the order of the paths with local search, until no improvement
+     * can be found or the \ref refinement_time_budget runs out.
+     *
+     * Two kinds of moves are tried. A 2-opt move reverses a stretch of the
+     * order, printing each polyline in it in the opposite direction. An Or-opt
+     * move takes up to three consecutive paths and puts them elsewhere in the
+     * order, possibly reversed. Only moves to locations near the paths are
+     * tried, using a list of the nearest paths for every path. Moves that
+     * would violate the \ref order_requirements are skipped.
+     *
+     * The travel moves are measured as straight lines. If there is a combing
+     * boundary, moves are only made if none of the new travel moves cross it.
+     * The seams of polygons are kept where they are.
+     * \param order[in, out] The order of the paths to improve.
+     * \param order_indices[in, out] For each path in the order, its index in
+     * \ref paths. These are reordered along with the paths.
+     * \param is_blocking For each path index, the indices of the paths that
+     * must be printed after it. Indices from the number of paths on are the
+     * group order requirements, which block the paths after the group.
+     */
+    void refineOrder(std::vector<PathOrderPath<PathType>>& order, std::vector<size_t>& order_indices, const std::vector<std::vector<size_t>>& is_blocking)
+    {
+        const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        const std::chrono::steady_clock::time_point deadline = start_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(refinement_time_budget));
+        const size_t num_paths = order.size();
+        if(num_paths < 2
+            || std::any_of(order.begin(), order.end(), [](const PathOrderPath<PathType>& path) { return path.converted->empty(); })) //Empty paths have no location to travel to.
+        {
+            return;
+        }
+
+        const bool has_requirements = std::any_of(is_blocking.begin(), is_blocking.end(), [](const std::vector<size_t>& blocking) { return !blocking.empty(); });
+        std::vector<size_t> position(paths.size()); //For each path index, where it is in the order.
+        std::vector<std::vector<size_t>> group_after_positions(is_blocking.size() - paths.size()); //For each group order requirement, the sorted positions of the paths after it.
+        const auto update_positions = [this, &position, &group_after_positions, &order_indices, &is_blocking]()
+        {
+            for(size_t pos = 0; pos < order_indices.size(); pos++)
+            {
+                position[order_indices[pos]] = pos;
+            }
+            for(size_t group_idx = 0; group_idx < group_after_positions.size(); group_idx++)
+            {
+                std::vector<size_t>& after_positions = group_after_positions[group_idx];
+                after_positions.clear();
+                for(const size_t after : is_blocking[paths.size() + group_idx])
+                {
+                    after_positions.push_back(position[after]);
+                }
+                std::sort(after_positions.begin(), after_positions.end());
+            }
+        };
+        update_positions();
+
+        //Where the nozzle arrives at and leaves from each path in the order.
+        const auto entry = [&order](const size_t pos) -> Point
+        {
+            return (*order[pos].converted)[order[pos].start_vertex];
+        };
+        const auto exit = [&order](const size_t pos) -> Point
+        {
+            const PathOrderPath<PathType>& path = order[pos];
+            if(path.is_closed)
+            {
+                return (*path.converted)[path.start_vertex];
+            }
+            return path.start_vertex == 0 ? path.converted->back() : path.converted->front();
+        };
+        //Where the nozzle is before the path at a position, or the start point before the first path.
+        const auto exit_before = [this, &exit](const size_t pos) -> Point
+        {
+            return pos == 0 ? start_point : exit(pos - 1);
+        };
+        const auto distance = [](const Point& a, const Point& b) -> double
+        {
+            return std::sqrt(static_cast<double>(vSize2(a - b)));
+        };
+        const auto collides = [this](const Point& a, const Point& b) -> bool
+        {
+            return combing_boundary && PolygonUtils::polygonCollidesWithLineSegment(a, b, getCombingGrid());
+        };
+        const auto flip = [&order](const size_t first, const size_t last) //Reverse the printing direction of the polylines in a range.
+        {
+            for(size_t pos = first; pos <= last; pos++)
+            {
+                PathOrderPath<PathType>& path = order[pos];
+                if(!path.is_closed)
+                {
+                    path.start_vertex = path.converted->size() - 1 - path.start_vertex;
+                    path.backwards = path.start_vertex > 0;
+                }
+            }
+        };
+        //Whether any path in the range [first, last] must be printed before another path in the range [other_first, other_last].
+        const auto must_precede = [&](const size_t first, const size_t last, const size_t other_first, const size_t other_last) -> bool
+        {
+            for(size_t pos = first; pos <= last; pos++)
+            {
+                for(const size_t after : is_blocking[order_indices[pos]])
+                {
+                    if(after >= paths.size()) //A group order requirement. Check whether any of the paths after it are in the other range.
+                    {
+                        const std::vector<size_t>& after_positions = group_after_positions[after - paths.size()];
+                        const auto first_after = std::lower_bound(after_positions.begin(), after_positions.end(), other_first);
+                        if(first_after != after_positions.end() && *first_after <= other_last)
+                        {
+                            return true;
+                        }
+                    }
+                    else if(position[after] >= other_first && position[after] <= other_last)
+                    {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+
+        //For each path index, the nearest other paths.
+        constexpr size_t num_neighbours = 8;
+        std::vector<std::vector<size_t>> neighbours(paths.size());
+        {
+            const std::unique_ptr<NearestPointGrid<size_t>> grid = createNearestGrid(order); //By position in the order.
+            for(size_t pos = 0; pos < num_paths; pos++)
+            {
+                std::vector<size_t> nearest; //Positions of the nearest paths.
+                for(const Point& location : { entry(pos), exit(pos) })
+                {
+                    for(size_t neighbour_idx = 0; neighbour_idx < num_neighbours / 2; neighbour_idx++)
+                    {
+                        size_t neighbour_pos;
+                        const bool found = grid->findNearest(location, [pos, &nearest](const size_t candidate)
+                            {
+                                return candidate != pos && std::find(nearest.begin(), nearest.end(), candidate) == nearest.end();
+                            }, neighbour_pos);
+                        if(!found)
+                        {
+                            break;
+                        }
+                        nearest.push_back(neighbour_pos);
+                    }
+                }
+                for(const size_t neighbour_pos : nearest)
+                {
+                    neighbours[order_indices[pos]].push_back(order_indices[neighbour_pos]);
+                }
+            }
+        }
+
+        constexpr double min_gain = 10.0; //Ignore improvements smaller than 10 micron, to prevent going back and forth due to rounding.
+        constexpr size_t max_chain_length = 3;
+
+        //2-opt: Reverse the range [first, last], so that the path before it connects to the end of the range and the start of the range to the path after it.
+        const auto try_reverse = [&](const size_t first, const size_t last) -> bool
+        {
+            if(first > last)
+            {
+                return false;
+            }
+            const Point before = exit_before(first);
+            const bool has_after = last + 1 < num_paths;
+            const double old_length = distance(before, entry(first)) + (has_after ? distance(exit(last), entry(last + 1)) : 0.0);
+            const double new_length = distance(before, exit(last)) + (has_after ? distance(entry(first), entry(last + 1)) : 0.0);
+            if(old_length - new_length < min_gain
+                || (has_requirements && must_precede(first, last, first, last))
+                || collides(before, exit(last)) || (has_after && collides(entry(first), entry(last + 1))))
+            {
+                return false;
+            }
+            std::reverse(order.begin() + first, order.begin() + last + 1);
+            std::reverse(order_indices.begin() + first, order_indices.begin() + last + 1);
+            flip(first, last);
+            update_positions();
+            return true;
+        };
+
+        //Or-opt: Move the range [first, last] to just before the path at the position insert_before, possibly reversed.
+        const auto try_move = [&](const size_t first, const size_t last, const size_t insert_before) -> bool
+        {
+            if(insert_before >= first && insert_before <= last + 1) //That's where it already is.
+            {
+                return false;
+            }
+            //Travel saved by taking the chain out of where it is.
+            const Point before_chain = exit_before(first);
+            const bool has_after_chain = last + 1 < num_paths;
+            const double removed_length = distance(before_chain, entry(first))
+                + (has_after_chain ? distance(exit(last), entry(last + 1)) - distance(before_chain, entry(last + 1)) : 0.0);
+            //Travel added by putting the chain in between two other paths.
+            const Point before = exit_before(insert_before);
+            const bool has_after = insert_before < num_paths;
+            const double bridged_length = has_after ? distance(before, entry(insert_before)) : 0.0;
+            for(const bool reversed : { false, true })
+            {
+                const Point chain_entry = reversed ? exit(last) : entry(first);
+                const Point chain_exit = reversed ? entry(first) : exit(last);
+                const double added_length = distance(before, chain_entry) + (has_after ? distance(chain_exit, entry(insert_before)) : 0.0) - bridged_length;
+                if(removed_length - added_length < min_gain)
+                {
+                    continue;
+                }
+                if(has_requirements)
+                {
+                    const bool violates = insert_before > last
+                        ? must_precede(first, last, last + 1, insert_before - 1) //The paths that the chain jumps over must not need to come after the chain.
+                        : must_precede(insert_before, first - 1, first, last); //The paths that the chain jumps over must not need to come before the chain.
+                    if(violates || (reversed && must_precede(first, last, first, last)))
+                    {
+                        continue;
+                    }
+                }
+                if((has_after_chain && collides(before_chain, entry(last + 1)))
+                    || collides(before, chain_entry) || (has_after && collides(chain_exit, entry(insert_before))))
+                {
+                    continue;
+                }
+
+                size_t new_first;
+                if(insert_before > last)
+                {
+                    std::rotate(order.begin() + first, order.begin() + last + 1, order.begin() + insert_before);
+                    std::rotate(order_indices.begin() + first, order_indices.begin() + last + 1, order_indices.begin() + insert_before);
+                    new_first = insert_before - (last + 1 - first);
+                }
+                else
+                {
+                    std::rotate(order.begin() + insert_before, order.begin() + first, order.begin() + last + 1);
+                    std::rotate(order_indices.begin() + insert_before, order_indices.begin() + first, order_indices.begin() + last + 1);
+                    new_first = insert_before;
+                }
+                if(reversed)
+                {
+                    const size_t new_last = new_first + last - first;
+                    std::reverse(order.begin() + new_first, order.begin() + new_last + 1);
+                    std::reverse(order_indices.begin() + new_first, order_indices.begin() + new_last + 1);
+                    flip(new_first, new_last);
+                }
+                update_positions();
+                return true;
+            }
+            return false;
+        };
+
+        //Try the moves that bring the path at a position close to one of its neighbours.
+        const auto improve_at = [&](const size_t pos) -> bool
+        {
+            for(const size_t neighbour : neighbours[order_indices[pos]])
+            {
+                const size_t neighbour_pos = position[neighbour];
+                //Connect the exits of both paths to each other, or their entries.
+                const size_t lower = std::min(pos, neighbour_pos);
+                const size_t upper = std::max(pos, neighbour_pos);
+                if(try_reverse(lower + 1, upper) || try_reverse(lower, upper - 1))
+                {
+                    return true;
+                }
+                //Put a chain of paths starting at this position just before or after the neighbour.
+                for(size_t last = pos; last < std::min(num_paths, pos + max_chain_length); last++)
+                {
+                    if(neighbour_pos >= pos && neighbour_pos <= last)
+                    {
+                        break;
+                    }
+                    if(try_move(pos, last, neighbour_pos) || try_move(pos, last, neighbour_pos + 1))
+                    {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+
+        bool improved = true;
+        const auto in_time = [this, &deadline]() { return refine_until_converged || std::chrono::steady_clock::now() < deadline; };
+        while(improved && in_time())
+        {
+            improved = false;
+            for(size_t pos = 0; pos < num_paths && in_time(); pos++)
+            {
+                improved |= improve_at(pos);
+            }
+        }
+
+        if(!refine_until_converged)
+        {
+            const std::chrono::duration<double> time_spent = std::chrono::steady_clock::now() - start_time;
+            refinement_time_budget = refinement_time_budget - Duration(time_spent.count());
+        }
     }
 
     bool isLoopingPolyline(const PathOrderPath<PathType>& path)
@@ -9,6 +9,7 @@
 #include "gcodeExport.h"
 #include "infill.h"
 #include "LayerPlan.h"
+#include "PathOrderOptimizer.h"
 #include "PrimeTower.h"
 #include "PrintFeature.h"
 #include "raft.h"
@@ -97,6 +98,7 @@ void PrimeTower::generatePaths(const SliceDataStorage& storage)
     {
         generatePaths_denseInfill();
         generateStartLocations();
+        generatePolygonOrders();
     }
 }
 
@@ -166,6 +168,46 @@ void PrimeTower::generateStartLocations()
     PolygonUtils::spreadDots(segment_start, segment_end, number_of_prime_tower_start_locations, prime_tower_start_locations);
 }
 
+void PrimeTower::generatePolygonOrders()
+{
+    polygon_order_per_extruder.assign(extruder_count, std::vector<PolygonOrder>(number_of_prime_tower_start_locations));
+    polygon_order_per_extruder_layer0.assign(extruder_count, std::vector<PolygonOrder>(number_of_prime_tower_start_locations));
+#pragma omp parallel for default(none) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int order_idx = 0; order_idx < static_cast<int>(extruder_count * number_of_prime_tower_start_locations); order_idx++)
+    {
+        const size_t extruder_nr = order_idx / number_of_prime_tower_start_locations;
+        const size_t start_location_idx = order_idx % number_of_prime_tower_start_locations;
+        const Point prime_start = getPrimeStart(start_location_idx, extruder_nr);
+        polygon_order_per_extruder[extruder_nr][start_location_idx] = getPolygonOrder(pattern_per_extruder[extruder_nr].polygons, prime_start);
+        polygon_order_per_extruder_layer0[extruder_nr][start_location_idx] = getPolygonOrder(pattern_per_extruder_layer0[extruder_nr].polygons, prime_start);
+    }
+}
+
+PrimeTower::PolygonOrder PrimeTower::getPolygonOrder(const Polygons& polygons, const Point& start_location)
+{
+    //Plan them the same way as LayerPlan::addPolygonsByOptimizer would.
+    PathOrderOptimizer<ConstPolygonPointer> order_optimizer(start_location, ZSeamConfig());
+    for (size_t poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+    {
+        order_optimizer.addPolygon(polygons[poly_idx]);
+    }
+    order_optimizer.optimize();
+
+    PolygonOrder order;
+    order.reserve(order_optimizer.paths.size());
+    for (const PathOrderPath<ConstPolygonPointer>& path : order_optimizer.paths)
+    {
+        size_t poly_idx = 0;
+        while (!(ConstPolygonPointer(polygons[poly_idx]) == path.vertices))
+        {
+            poly_idx++;
+        }
+        order.push_back(PlannedPolygon{ poly_idx, path.start_vertex, path.backwards });
+    }
+    return order;
+}
+
 void PrimeTower::addToGcode(const SliceDataStorage& storage, LayerPlan& gcode_layer, const size_t prev_extruder, const size_t new_extruder) const
 {
     if (!enabled)
@@ -215,13 +257,30 @@ void PrimeTower::addToGcode(const SliceDataStorage& storage, LayerPlan& gcode_la
 
 void PrimeTower::addToGcode_denseInfill(LayerPlan& gcode_layer, const size_t extruder_nr) const
 {
-    const ExtrusionMoves& pattern = (gcode_layer.getLayerNr() == -static_cast<LayerIndex>(Raft::getFillerLayerCount()))
+    const LayerIndex layer_nr = gcode_layer.getLayerNr();
+    const bool is_first_layer = layer_nr == -static_cast<LayerIndex>(Raft::getFillerLayerCount());
+    const ExtrusionMoves& pattern = is_first_layer
         ? pattern_per_extruder_layer0[extruder_nr]
         : pattern_per_extruder[extruder_nr];
 
     const GCodePathConfig& config = gcode_layer.configs_storage.prime_tower_config_per_extruder[extruder_nr];
 
-    gcode_layer.addPolygonsByOptimizer(pattern.polygons, config);
+    if (layer_nr != 0)
+    {
+        //We just went to one of the start locations, so the order of the polygons from there is known.
+        const size_t start_location_idx = getStartLocationIdx(layer_nr, extruder_nr);
+        const PolygonOrder& order = is_first_layer
+            ? polygon_order_per_extruder_layer0[extruder_nr][start_location_idx]
+            : polygon_order_per_extruder[extruder_nr][start_location_idx];
+        for (const PlannedPolygon& planned : order)
+        {
+            gcode_layer.addPolygon(pattern.polygons[planned.polygon_idx], planned.start_vertex, planned.backwards, config);
+        }
+    }
+    else
+    {
+        gcode_layer.addPolygonsByOptimizer(pattern.polygons, config);
+    }
     gcode_layer.addLinesByOptimizer(pattern.lines, config, SpaceFillType::Lines);
 }
 
@@ -231,6 +290,10 @@ void PrimeTower::subtractFromSupport(SliceDataStorage& storage)
     AABB outside_polygon_boundary_box(outside_polygon);
     for(size_t layer = 0; layer <= (size_t)storage.max_print_height_second_to_last_extruder + 1 && layer < storage.support.supportLayers.size(); layer++)
     {
+        if (!storage.support.supportLayers.isAllocated(layer))
+        {
+            continue; //No support to subtract from.
+        }
         SupportLayer& support_layer = storage.support.supportLayers[layer];
         // take the differences of the support infill parts and the prime tower area
         support_layer.excludeAreasFromSupportInfillAreas(outside_polygon, outside_polygon_boundary_box);
@@ -239,19 +302,25 @@ void PrimeTower::subtractFromSupport(SliceDataStorage& storage)
 
 void PrimeTower::gotoStartLocation(LayerPlan& gcode_layer, const int extruder_nr) const
 {
-    int current_start_location_idx = ((((extruder_nr + 1) * gcode_layer.getLayerNr()) % number_of_prime_tower_start_locations)
+    gcode_layer.addTravel(getPrimeStart(getStartLocationIdx(gcode_layer.getLayerNr(), extruder_nr), extruder_nr));
+}
+
+size_t PrimeTower::getStartLocationIdx(const LayerIndex layer_nr, const size_t extruder_nr) const
+{
+    return ((((static_cast<int>(extruder_nr) + 1) * layer_nr) % number_of_prime_tower_start_locations)
             + number_of_prime_tower_start_locations) % number_of_prime_tower_start_locations;
+}
 
-    const ClosestPolygonPoint wipe_location = prime_tower_start_locations[current_start_location_idx];
+Point PrimeTower::getPrimeStart(const size_t start_location_idx, const size_t extruder_nr) const
+{
+    const ClosestPolygonPoint wipe_location = prime_tower_start_locations[start_location_idx];
 
     const ExtruderTrain& train = Application::getInstance().current_slice->scene.extruders[extruder_nr];
     const coord_t inward_dist = train.settings.get<coord_t>("machine_nozzle_size") * 3 / 2 ;
     const coord_t start_dist = train.settings.get<coord_t>("machine_nozzle_size") * 2;
     const Point prime_end = PolygonUtils::moveInsideDiagonally(wipe_location, inward_dist);
     const Point outward_dir = wipe_location.location - prime_end;
-    const Point prime_start = wipe_location.location + normal(outward_dir, start_dist);
-
-    gcode_layer.addTravel(prime_start);
+    return wipe_location.location + normal(outward_dir, start_dist);
 }
 
 }//namespace cura
@@ -6,6 +6,7 @@
 
 #include <vector>
 
+#include "settings/types/LayerIndex.h"
 #include "utils/polygon.h" // Polygons
 #include "utils/polygonUtils.h"
 
@@ -29,6 +30,17 @@ private:
         Polygons polygons;
         Polygons lines;
     };
+
+    /*!
+     * A polygon of a pattern, in the order it gets printed.
+     */
+    struct PlannedPolygon
+    {
+        size_t polygon_idx; //!< Which polygon of the pattern to print.
+        size_t start_vertex; //!< Which vertex to start printing the polygon at.
+        bool backwards; //!< Whether to print the polygon in reverse direction.
+    };
+    using PolygonOrder = std::vector<PlannedPolygon>;
     unsigned int extruder_count; //!< Number of extruders
 
     bool wipe_from_middle; //!< Whether to wipe on the inside of the hollow prime tower
@@ -42,6 +54,23 @@ private:
     std::vector<ExtrusionMoves> pattern_per_extruder; //!< For each extruder the pattern to print on all layers of the prime tower.
     std::vector<ExtrusionMoves> pattern_per_extruder_layer0; //!< For each extruder the pattern to print on the first layer
 
+    /*!
+     * For each extruder and each start location, the order to print the
+     * polygons of \ref pattern_per_extruder in after going to that start
+     * location.
+     *
+     * Where the polygons start only depends on where the nozzle comes from, so
+     * this is the same on every layer.
+     */
+    std::vector<std::vector<PolygonOrder>> polygon_order_per_extruder;
+
+    /*!
+     * For each extruder and each start location, the order to print the
+     * polygons of \ref pattern_per_extruder_layer0 in after going to that
+     * start location.
+     */
+    std::vector<std::vector<PolygonOrder>> polygon_order_per_extruder_layer0;
+
 public:
     bool enabled; //!< Whether the prime tower is enabled.
     bool multiple_extruders_on_first_layer; //!< Whether multiple extruders are allowed on the first layer of the prime tower (e.g. when a raft is there)
@@ -112,6 +141,23 @@ private:
      */
     void generateStartLocations();
 
+    /*!
+     * Find the order in which to print the polygons of the patterns of each
+     * extruder, starting from each of the start locations. These are stored
+     * in \ref polygon_order_per_extruder and
+     * \ref polygon_order_per_extruder_layer0 .
+     */
+    void generatePolygonOrders();
+
+    /*!
+     * Find the order in which to print polygons, starting at a certain
+     * location.
+     * \param polygons The polygons to print.
+     * \param start_location Where the nozzle is before printing them.
+     * \return The order to print the polygons in.
+     */
+    static PolygonOrder getPolygonOrder(const Polygons& polygons, const Point& start_location);
+
     /*!
      * \see PrimeTower::addToGcode
      *
@@ -130,6 +176,25 @@ private:
      * starting at the location everytime which can result in z-seam blobs.
      */
     void gotoStartLocation(LayerPlan& gcode_layer, const int extruder) const;
+
+    /*!
+     * Get which of the start locations an extruder uses on a certain layer.
+     * \param layer_nr The layer to get the start location of.
+     * \param extruder_nr The extruder to get the start location of.
+     * \return The index of the start location in
+     * \ref prime_tower_start_locations .
+     */
+    size_t getStartLocationIdx(const LayerIndex layer_nr, const size_t extruder_nr) const;
+
+    /*!
+     * Get where the nozzle of an extruder goes to before priming at a start
+     * location.
+     * \param start_location_idx The index of the start location in
+     * \ref prime_tower_start_locations .
+     * \param extruder_nr The extruder that is going to prime.
+     * \return The position to travel to.
+     */
+    Point getPrimeStart(const size_t start_location_idx, const size_t extruder_nr) const;
 };
 
 
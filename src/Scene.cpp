@@ -8,8 +8,13 @@
 #include "Weaver.h"
 #include "Wireframe2gcode.h"
 #include "communication/Communication.h" //To flush g-code and layer view when we're done.
+#include "settings/SlicingPreview.h" //To slice at a lower fidelity if asked for.
 #include "progress/Progress.h"
+#include "utils/AllocationTracker.h" //To log the allocations of each stage at the end of the slice.
+#include "utils/Cancellation.h"
 #include "utils/logoutput.h"
+#include "utils/SlowestParts.h" //To report the slowest layers and parts at the end of the slice.
+#include "utils/Trace.h"
 
 namespace cura
 {
@@ -64,6 +69,7 @@ const std::string Scene::getAllSettingsString() const
 
 void Scene::processMeshGroup(MeshGroup& mesh_group)
 {
+    TraceZone zone("mesh group");
     FffProcessor* fff_processor = FffProcessor::getInstance();
     fff_processor->time_keeper.restart();
 
@@ -84,6 +90,7 @@ void Scene::processMeshGroup(MeshGroup& mesh_group)
         log("Total time elapsed %5.2fs.\n", time_keeper_total.restart());
         return;
     }
+    SlicingPreview::apply(*this, mesh_group); //The meshes were already decimated for it when they were loaded.
 
     if (mesh_group.settings.get<bool>("wireframe_enabled"))
     {
@@ -93,7 +100,7 @@ void Scene::processMeshGroup(MeshGroup& mesh_group)
         weaver.weave(&mesh_group);
         
         log("Starting Neith Gcode generation...\n");
-        Wireframe2gcode gcoder(weaver, fff_processor->gcode_writer.gcode);
+        Wireframe2gcode gcoder(weaver, fff_processor->gcode_writer->gcode);
         gcoder.writeGCode();
         log("Finished Neith Gcode generation...\n");
     }
@@ -107,13 +114,25 @@ void Scene::processMeshGroup(MeshGroup& mesh_group)
         }
         
         Progress::messageProgressStage(Progress::Stage::EXPORT, &fff_processor->time_keeper);
-        fff_processor->gcode_writer.writeGCode(storage, fff_processor->time_keeper);
+        fff_processor->gcode_writer->writeGCode(storage, fff_processor->time_keeper);
+    }
+    if (Cancellation::isRequested())
+    {
+        log("Stopped slicing the mesh group after %5.2fs, because the slice was cancelled.\n", time_keeper_total.restart());
+        AllocationTracker::logSummary();
+        SlowestParts::report();
+        return; //The g-code is incomplete, so don't send it.
     }
 
     Progress::messageProgress(Progress::Stage::FINISH, 1, 1); // 100% on this meshgroup
-    Application::getInstance().communication->flushGCode();
-    Application::getInstance().communication->sendOptimizedLayerData();
+    {
+        TraceZone communication_zone("communication");
+        Application::getInstance().communication->flushGCode();
+        Application::getInstance().communication->sendOptimizedLayerData();
+    }
     log("Total time elapsed %5.2fs.\n", time_keeper_total.restart());
+    AllocationTracker::logSummary();
+    SlowestParts::report();
 }
 
 } //namespace cura
\ No newline at end of file
@@ -13,6 +13,8 @@
 
 #include "BoostInterface.hpp"
 
+#include "utils/Cancellation.h"
+
 #include "utils/VoronoiUtils.h"
 
 #include "utils/linearAlg2D.h"
@@ -24,32 +26,50 @@
 namespace cura
 {
 
+namespace
+{
+
+/*!
+ * The Voronoi builder and diagram to construct the skeletal trapezoidations
+ * with.
+ *
+ * Each thread keeps one, which it reuses for all the shapes that it generates
+ * walls for. Clearing them keeps their buffers allocated, so that the threads
+ * don't need to allocate them again for every shape, which they would have to
+ * wait on each other for.
+ */
+struct VoronoiScratch
+{
+    boost::polygon::default_voronoi_builder builder;
+    boost::polygon::voronoi_diagram<double> diagram; //The same as SkeletalTrapezoidation::vd_t.
+};
+
+VoronoiScratch& getVoronoiScratch()
+{
+    static thread_local VoronoiScratch scratch;
+    return scratch;
+}
+
+} //Anonymous namespace.
+
 SkeletalTrapezoidation::node_t& SkeletalTrapezoidation::makeNode(vd_t::vertex_type& vd_node, Point p)
 {
-    auto he_node_it = vd_node_to_he_node.find(&vd_node);
-    if (he_node_it == vd_node_to_he_node.end())
+    node_t*& he_node = vd_node_to_he_node[vd_node.color()];
+    if (! he_node)
     {
         graph.nodes.emplace_front(SkeletalTrapezoidationJoint(), p);
-        node_t& node = graph.nodes.front();
-        vd_node_to_he_node.emplace(&vd_node, &node);
-        return node;
-    }
-    else
-    {
-        return *he_node_it->second;
+        he_node = &graph.nodes.front();
     }
+    return *he_node;
 }
 
 void SkeletalTrapezoidation::transferEdge(Point from, Point to, vd_t::edge_type& vd_edge, edge_t*& prev_edge, Point& start_source_point, Point& end_source_point, const std::vector<Point>& points, const std::vector<Segment>& segments)
 {
-    auto he_edge_it = vd_edge_to_he_edge.find(vd_edge.twin());
-    if (he_edge_it != vd_edge_to_he_edge.end())
+    edge_t* source_twin = vd_edge_to_he_edge[vd_edge.twin()->color()];
+    if (source_twin)
     { // Twin segment(s) have already been made
-        edge_t* source_twin = he_edge_it->second;
-        assert(source_twin);
-        auto end_node_it = vd_node_to_he_node.find(vd_edge.vertex1());
-        assert(end_node_it != vd_node_to_he_node.end());
-        node_t* end_node = end_node_it->second;
+        node_t* end_node = vd_node_to_he_node[vd_edge.vertex1()->color()];
+        assert(end_node);
         for (edge_t* twin = source_twin; ;twin = twin->prev->twin->prev)
         {
             if(!twin)
@@ -96,7 +116,8 @@ void SkeletalTrapezoidation::transferEdge(Point from, Point to, vd_t::edge_type&
     }
     else
     {
-        std::vector<Point> discretized = discretize(vd_edge, points, segments);
+        std::vector<Point>& discretized = discretization_buffer;
+        discretize(vd_edge, points, segments, discretized);
         assert(discretized.size() >= 2);
         if(discretized.size() < 2)
         {
@@ -147,12 +168,14 @@ void SkeletalTrapezoidation::transferEdge(Point from, Point to, vd_t::edge_type&
             }
         }
         assert(prev_edge);
-        vd_edge_to_he_edge.emplace(&vd_edge, prev_edge);
+        vd_edge_to_he_edge[vd_edge.color()] = prev_edge;
     }
 }
 
-std::vector<Point> SkeletalTrapezoidation::discretize(const vd_t::edge_type& vd_edge, const std::vector<Point>& points, const std::vector<Segment>& segments)
+void SkeletalTrapezoidation::discretize(const vd_t::edge_type& vd_edge, const std::vector<Point>& points, const std::vector<Segment>& segments, std::vector<Point>& discretized)
 {
+    discretized.clear();
+
     /*Terminology in this function assumes that the edge moves horizontally from
     left to right. This is not necessarily the case; the edge can go in any
     direction, but it helps to picture it in a certain direction in your head.*/
@@ -166,13 +189,16 @@ std::vector<Point> SkeletalTrapezoidation::discretize(const vd_t::edge_type& vd_
     bool point_right = right_cell->contains_point();
     if ((!point_left && !point_right) || vd_edge.is_secondary()) // Source vert is directly connected to source segment
     {
-        return std::vector<Point>({ start, end });
+        discretized.emplace_back(start);
+        discretized.emplace_back(end);
+        return;
     }
     else if (point_left != point_right) //This is a parabolic edge between a point and a line.
     {
         Point p = VoronoiUtils::getSourcePoint(*(point_left ? left_cell : right_cell), points, segments);
         const Segment& s = VoronoiUtils::getSourceSegment(*(point_left ? right_cell : left_cell), points, segments);
-        return VoronoiUtils::discretizeParabola(p, s, start, end, discretization_step_size, transitioning_angle);
+        VoronoiUtils::discretizeParabola(p, s, start, end, discretization_step_size, parabola_marking_bound, discretized);
+        return;
     }
     else //This is a straight edge between two points.
     {
@@ -197,7 +223,7 @@ std::vector<Point> SkeletalTrapezoidation::discretize(const vd_t::edge_type& vd_
         coord_t end_x = projected_x(end);
 
         //Part of the edge will be bound to the markings on the endpoints of the edge. Calculate how far that is.
-        float bound = 0.5 / tan((M_PI - transitioning_angle) * 0.5);
+        const float bound = straight_marking_bound;
         coord_t marking_start_x = - d * bound;
         coord_t marking_end_x = d * bound;
         Point marking_start = middle + x_axis_dir * marking_start_x / x_axis_length;
@@ -214,7 +240,7 @@ std::vector<Point> SkeletalTrapezoidation::discretize(const vd_t::edge_type& vd_
         //Start generating points along the edge.
         Point a = start;
         Point b = end;
-        std::vector<Point> ret;
+        std::vector<Point>& ret = discretized;
         ret.emplace_back(a);
 
         //Introduce an extra edge at the borders of the markings?
@@ -250,7 +276,6 @@ std::vector<Point> SkeletalTrapezoidation::discretize(const vd_t::edge_type& vd_
             ret.emplace_back(marking_end);
         }
         ret.emplace_back(b);
-        return ret;
     }
 }
 
@@ -356,6 +381,8 @@ SkeletalTrapezoidation::SkeletalTrapezoidation(const Polygons& polys, const Bead
     transition_filter_dist(transition_filter_dist),
     allowed_filter_deviation(allowed_filter_deviation),
     beading_propagation_transition_dist(beading_propagation_transition_dist),
+    parabola_marking_bound(VoronoiUtils::getParabolaMarkingBound(transitioning_angle)),
+    straight_marking_bound(0.5 / tan((M_PI - transitioning_angle) * 0.5)),
     beading_strategy(beading_strategy)
 {
     constructFromPolygons(polys);
@@ -363,9 +390,6 @@ SkeletalTrapezoidation::SkeletalTrapezoidation(const Polygons& polys, const Bead
 
 void SkeletalTrapezoidation::constructFromPolygons(const Polygons& polys)
 {
-    vd_edge_to_he_edge.clear();
-    vd_node_to_he_node.clear();
-
     std::vector<Point> points; // Remains empty
 
     std::vector<Segment> segments;
@@ -378,8 +402,24 @@ void SkeletalTrapezoidation::constructFromPolygons(const Polygons& polys)
         }
     }
 
-    vd_t vonoroi_diagram;
-    construct_voronoi(segments.begin(), segments.end(), &vonoroi_diagram);
+    VoronoiScratch& scratch = getVoronoiScratch();
+    vd_t& vonoroi_diagram = scratch.diagram;
+    vonoroi_diagram.clear();
+    scratch.builder.clear();
+    boost::polygon::insert(segments.begin(), segments.end(), &scratch.builder);
+    scratch.builder.construct(&vonoroi_diagram);
+
+    //Number the edges and nodes of the VD, to map them to the HE edges and nodes by their index.
+    for (size_t edge_idx = 0; edge_idx < vonoroi_diagram.edges().size(); edge_idx++)
+    {
+        vonoroi_diagram.edges()[edge_idx].color(edge_idx);
+    }
+    for (size_t vertex_idx = 0; vertex_idx < vonoroi_diagram.vertices().size(); vertex_idx++)
+    {
+        vonoroi_diagram.vertices()[vertex_idx].color(vertex_idx);
+    }
+    vd_edge_to_he_edge.assign(vonoroi_diagram.edges().size(), nullptr);
+    vd_node_to_he_node.assign(vonoroi_diagram.vertices().size(), nullptr);
 
     for (vd_t::cell_type cell : vonoroi_diagram.cells())
     {
@@ -415,7 +455,7 @@ void SkeletalTrapezoidation::constructFromPolygons(const Polygons& polys)
         // Copy start to end edge to graph
         edge_t* prev_edge = nullptr;
         transferEdge(start_source_point, VoronoiUtils::p(starting_vonoroi_edge->vertex1()), *starting_vonoroi_edge, prev_edge, start_source_point, end_source_point, points, segments);
-        node_t* starting_node = vd_node_to_he_node[starting_vonoroi_edge->vertex0()];
+        node_t* starting_node = vd_node_to_he_node[starting_vonoroi_edge->vertex0()->color()];
         starting_node->data.distance_to_boundary = 0;
 
         constexpr bool is_next_to_start_or_end = true;
@@ -501,10 +541,21 @@ void SkeletalTrapezoidation::generateToolpaths(std::vector<VariableWidthLines>&
 
     filterNoncentralRegions();
 
+    //Large parts take long to get through the rest. If the slice was cancelled, the walls aren't needed any more.
+    if (Cancellation::isRequested())
+    {
+        return;
+    }
+
     generateTransitioningRibs();
 
     generateExtraRibs();
 
+    if (Cancellation::isRequested())
+    {
+        return;
+    }
+
     generateSegments();
 }
 
@@ -1654,6 +1705,10 @@ SkeletalTrapezoidation::Beading SkeletalTrapezoidation::interpolate(const Beadin
 
 void SkeletalTrapezoidation::generateJunctions(ptr_vector_t<BeadingPropagation>& node_beadings, ptr_vector_t<LineJunctions>& edge_junctions)
 {
+    //Beadings are taken from nearby nodes that already have one, so they must be created in the order of the edges.
+    std::vector<edge_t*> upward_edges;
+    std::vector<const Beading*> upward_beadings;
+    const size_t first_junctions_idx = edge_junctions.size();
     for (edge_t& edge_ : graph.edges)
     {
         edge_t* edge = &edge_;
@@ -1671,58 +1726,72 @@ void SkeletalTrapezoidation::generateJunctions(ptr_vector_t<BeadingPropagation>&
             continue;
         }
 
-        Beading* beading = &getOrCreateBeading(edge->to, node_beadings)->beading;
+        upward_beadings.push_back(&getOrCreateBeading(edge->to, node_beadings)->beading);
         edge_junctions.emplace_back(std::make_shared<LineJunctions>());
         edge_.data.setExtrusionJunctions(edge_junctions.back());  // initialization
-        LineJunctions& ret = *edge_junctions.back();
+        upward_edges.push_back(edge);
+    }
 
-        assert(beading->total_thickness >= edge->to->data.distance_to_boundary * 2);
-        if(beading->total_thickness < edge->to->data.distance_to_boundary * 2)
-        {
-            RUN_ONCE(logWarning("Generated junction is beyond the center of total width."))
-        }
+    //The junctions of each edge only depend on its own beading, so they can be generated in parallel.
+#pragma omp parallel for default(none) shared(upward_edges, upward_beadings, edge_junctions, first_junctions_idx) schedule(dynamic, 64)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int edge_idx = 0; edge_idx < static_cast<int>(upward_edges.size()); edge_idx++)
+    {
+        generateEdgeJunctions(*upward_edges[edge_idx], *upward_beadings[edge_idx], *edge_junctions[first_junctions_idx + edge_idx]);
+    }
+}
 
-        Point a = edge->to->p;
-        Point b = edge->from->p;
-        Point ab = b - a;
+void SkeletalTrapezoidation::generateEdgeJunctions(const edge_t& edge, const Beading& beading, LineJunctions& ret)
+{
+    coord_t start_R = edge.to->data.distance_to_boundary; // higher R
+    coord_t end_R = edge.from->data.distance_to_boundary; // lower R
 
-        const size_t num_junctions = beading->toolpath_locations.size();
-        size_t junction_idx;
-        // Compute starting junction_idx for this segment
-        for (junction_idx = (std::max(size_t(1), beading->toolpath_locations.size()) - 1) / 2; junction_idx < num_junctions; junction_idx--)
-        {
-            coord_t bead_R = beading->toolpath_locations[junction_idx];
-            if (bead_R <= start_R)
-            { // Junction coinciding with start node is used in this function call
-                break;
-            }
-        }
+    assert(beading.total_thickness >= edge.to->data.distance_to_boundary * 2);
+    if(beading.total_thickness < edge.to->data.distance_to_boundary * 2)
+    {
+        RUN_ONCE(logWarning("Generated junction is beyond the center of total width."))
+    }
 
-        // Robustness against odd segments which might lie just slightly outside of the range due to rounding errors
-        // not sure if this is really needed (TODO)
-        if (junction_idx + 1 < num_junctions
-            && beading->toolpath_locations[junction_idx + 1] <= start_R + 5
-            && beading->total_thickness < start_R + 5
-        )
-        {
-            junction_idx++;
+    Point a = edge.to->p;
+    Point b = edge.from->p;
+    Point ab = b - a;
+
+    const size_t num_junctions = beading.toolpath_locations.size();
+    size_t junction_idx;
+    // Compute starting junction_idx for this segment
+    for (junction_idx = (std::max(size_t(1), beading.toolpath_locations.size()) - 1) / 2; junction_idx < num_junctions; junction_idx--)
+    {
+        coord_t bead_R = beading.toolpath_locations[junction_idx];
+        if (bead_R <= start_R)
+        { // Junction coinciding with start node is used in this function call
+            break;
         }
+    }
 
-        for (; junction_idx < num_junctions; junction_idx--) //When junction_idx underflows, it'll be more than num_junctions too.
-        {
-            coord_t bead_R = beading->toolpath_locations[junction_idx];
-            assert(bead_R >= 0);
-            if (bead_R < end_R)
-            { // Junction coinciding with a node is handled by the next segment
-                break;
-            }
-            Point junction(a + ab * (bead_R - start_R) / (end_R - start_R));
-            if (bead_R > start_R - 5)
-            { // Snap to start node if it is really close, in order to be able to see 3-way intersection later on more robustly
-                junction = a;
-            }
-            ret.emplace_back(junction, beading->bead_widths[junction_idx], junction_idx);
+    // Robustness against odd segments which might lie just slightly outside of the range due to rounding errors
+    // not sure if this is really needed (TODO)
+    if (junction_idx + 1 < num_junctions
+        && beading.toolpath_locations[junction_idx + 1] <= start_R + 5
+        && beading.total_thickness < start_R + 5
+    )
+    {
+        junction_idx++;
+    }
+
+    for (; junction_idx < num_junctions; junction_idx--) //When junction_idx underflows, it'll be more than num_junctions too.
+    {
+        coord_t bead_R = beading.toolpath_locations[junction_idx];
+        assert(bead_R >= 0);
+        if (bead_R < end_R)
+        { // Junction coinciding with a node is handled by the next segment
+            break;
+        }
+        Point junction(a + ab * (bead_R - start_R) / (end_R - start_R));
+        if (bead_R > start_R - 5)
+        { // Snap to start node if it is really close, in order to be able to see 3-way intersection later on more robustly
+            junction = a;
         }
+        ret.emplace_back(junction, beading.bead_widths[junction_idx], junction_idx);
     }
 }
 
@@ -1904,7 +1973,7 @@ void SkeletalTrapezoidation::connectJunctions(ptr_vector_t<LineJunctions>& edge_
             LineJunctions to_junctions = *edge_from_peak->twin->data.getExtrusionJunctions();
             if (edge_to_peak->prev)
             {
-                LineJunctions from_prev_junctions = *edge_to_peak->prev->data.getExtrusionJunctions();
+                const LineJunctions& from_prev_junctions = *edge_to_peak->prev->data.getExtrusionJunctions();
                 while (!from_junctions.empty() && !from_prev_junctions.empty() && from_junctions.back().perimeter_index <= from_prev_junctions.front().perimeter_index)
                 {
                     from_junctions.pop_back();
@@ -1919,7 +1988,7 @@ void SkeletalTrapezoidation::connectJunctions(ptr_vector_t<LineJunctions>& edge_
             }
             if (edge_from_peak->next)
             {
-                LineJunctions to_next_junctions = *edge_from_peak->next->twin->data.getExtrusionJunctions();
+                const LineJunctions& to_next_junctions = *edge_from_peak->next->twin->data.getExtrusionJunctions();
                 while (!to_junctions.empty() && !to_next_junctions.empty() && to_junctions.back().perimeter_index <= to_next_junctions.front().perimeter_index)
                 {
                     to_junctions.pop_back();
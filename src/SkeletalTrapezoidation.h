@@ -63,6 +63,9 @@ class SkeletalTrapezoidation
     coord_t transition_filter_dist; //!< Filter transition mids (i.e. anchors) closer together than this
     coord_t allowed_filter_deviation; //!< The allowed line width deviation induced by filtering
     coord_t beading_propagation_transition_dist; //!< When there are different beadings propagated from below and from above, use this transitioning distance
+    float parabola_marking_bound; //!< The bound of the markings on parabolic edges, relative to the distance of their source point to their source segment.
+    float straight_marking_bound; //!< The bound of the markings on straight edges between two points, relative to the distance between the points.
+    std::vector<Point> discretization_buffer; //!< The points of the last discretized edge, kept to reuse the memory for the next edge.
     static constexpr coord_t central_filter_dist = 20; //!< Filter areas marked as 'central' smaller than this
     static constexpr coord_t snap_dist = 20; //!< Generic arithmatic inaccuracy. Only used to determine whether a transition really needs to insert an extra edge.
 
@@ -156,9 +159,12 @@ protected:
     /*!
      * mapping each voronoi VD edge to the corresponding halfedge HE edge
      * In case the result segment is discretized, we map the VD edge to the *last* HE edge
+     *
+     * Indexed by the color of the VD edge, which is set to its index in the
+     * VD. Edges that weren't transferred yet map to nullptr.
      */
-    std::unordered_map<vd_t::edge_type*, edge_t*> vd_edge_to_he_edge;
-    std::unordered_map<vd_t::vertex_type*, node_t*> vd_node_to_he_node;
+    std::vector<edge_t*> vd_edge_to_he_edge;
+    std::vector<node_t*> vd_node_to_he_node; //!< Mapping each VD node to the corresponding HE node, indexed by the color of the VD node like \ref vd_edge_to_he_edge.
     node_t& makeNode(vd_t::vertex_type& vd_node, Point p); //!< Get the node which the VD node maps to, or create a new mapping if there wasn't any yet.
 
     /*!
@@ -196,10 +202,11 @@ protected:
      * \param points All vertices of the original Polygons to fill with beads.
      * \param segments All line segments of the original Polygons to fill with
      * beads.
-     * \return A number of coordinates along the edge where the edge is broken
-     * up into discrete pieces.
+     * \param[out] discretized A number of coordinates along the edge where the
+     * edge is broken up into discrete pieces. Anything that was in it before
+     * is removed.
      */
-    std::vector<Point> discretize(const vd_t::edge_type& segment, const std::vector<Point>& points, const std::vector<Segment>& segments);
+    void discretize(const vd_t::edge_type& segment, const std::vector<Point>& points, const std::vector<Segment>& segments, std::vector<Point>& discretized);
 
     /*!
      * Compute the range of line segments that surround a cell of the skeletal
@@ -572,6 +579,14 @@ protected:
      */
     void generateJunctions(ptr_vector_t<BeadingPropagation>& node_beadings, ptr_vector_t<LineJunctions>& edge_junctions);
 
+    /*!
+     * Generate the junctions on a single upward edge.
+     * \param edge The upward half-edge to generate the junctions on.
+     * \param beading The beading of the upper node of the edge.
+     * \param[out] junctions The junctions on the edge, ordered high R to low R.
+     */
+    void generateEdgeJunctions(const edge_t& edge, const Beading& beading, LineJunctions& junctions);
+
     /*!
      * Add a new toolpath segment, defined between two extrusion-juntions.
      * 
@@ -1,19 +1,122 @@
 //Copyright (C) 2022 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For std::sort.
+
 #include "Application.h"
 #include "ExtruderTrain.h"
 #include "SkirtBrim.h"
 #include "Slice.h"
 #include "sliceDataStorage.h"
+#include "utils/AABB.h"
 #include "utils/logoutput.h"
 #include "utils/Simplify.h" //Simplifying the brim/skirt at every inset.
+#include "utils/UnionFind.h"
 #include "support.h"
 #include "settings/types/Ratio.h"
 
 namespace cura 
 {
 
+namespace
+{
+
+/*!
+ * Split the outline into clusters of parts that can be offset separately.
+ *
+ * Offsetting the parts of a cluster by at most \p max_offset can't touch the
+ * offsets of the parts of any other cluster, so offsetting each cluster and
+ * combining the results gives the same polygons as offsetting the whole
+ * outline. Offsetting inwards never joins parts, so then every part is its
+ * own cluster.
+ * \param outline The outline to split.
+ * \param max_offset The largest distance that the clusters will be offset by.
+ * \return The clusters, each with the parts that belong to it.
+ */
+std::vector<Polygons> getOffsetClusters(const Polygons& outline, const coord_t max_offset)
+{
+    const std::vector<PolygonsPart> parts = outline.splitIntoParts();
+    std::vector<AABB> part_boxes;
+    part_boxes.reserve(parts.size());
+    for (const PolygonsPart& part : parts)
+    {
+        part_boxes.emplace_back(part);
+        part_boxes.back().expand(std::max(max_offset, coord_t(0)) + 1); //One extra so that offsets that would exactly touch are in the same cluster too.
+    }
+
+    //Sweep over the parts from left to right, joining the parts whose boxes overlap.
+    IndexUnionFind part_clusters(parts.size());
+    std::vector<size_t> by_min_x(parts.size());
+    for (size_t part_idx = 0; part_idx < parts.size(); part_idx++)
+    {
+        by_min_x[part_idx] = part_idx;
+    }
+    if (max_offset > 0)
+    {
+        std::sort(by_min_x.begin(), by_min_x.end(), [&part_boxes](const size_t a, const size_t b) { return part_boxes[a].min.X < part_boxes[b].min.X; });
+        for (size_t i = 0; i < by_min_x.size(); i++)
+        {
+            const AABB& box = part_boxes[by_min_x[i]];
+            for (size_t j = i + 1; j < by_min_x.size() && part_boxes[by_min_x[j]].min.X < box.max.X; j++)
+            {
+                const size_t cluster_a = part_clusters.find(by_min_x[i]);
+                const size_t cluster_b = part_clusters.find(by_min_x[j]);
+                if (cluster_a != cluster_b && box.hit(part_boxes[by_min_x[j]]))
+                {
+                    part_clusters.unite(cluster_a, cluster_b);
+                }
+            }
+        }
+    }
+
+    std::vector<Polygons> clusters;
+    std::vector<size_t> cluster_of_root(parts.size(), parts.size());
+    for (size_t part_idx = 0; part_idx < parts.size(); part_idx++)
+    {
+        const size_t root = part_clusters.find(part_idx);
+        if (cluster_of_root[root] == parts.size())
+        {
+            cluster_of_root[root] = clusters.size();
+            clusters.emplace_back();
+        }
+        clusters[cluster_of_root[root]].add(parts[part_idx]);
+    }
+    return clusters;
+}
+
+/*!
+ * Offset an outline that was split into clusters by several distances.
+ *
+ * All combinations of clusters and distances are offset in parallel. Each
+ * cluster is much smaller than the whole outline, so this also spreads the
+ * work when only a few lines are needed.
+ * \param clusters The clusters of the outline, from \ref getOffsetClusters .
+ * None of the distances may be more than the maximum offset they were made
+ * for.
+ * \param distances The distances to offset by.
+ * \return For each distance, the offset outline.
+ */
+std::vector<Polygons> offsetClusters(const std::vector<Polygons>& clusters, const std::vector<coord_t>& distances)
+{
+    std::vector<Polygons> cluster_results(clusters.size() * distances.size());
+#pragma omp parallel for default(none) shared(clusters, distances, cluster_results) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int result_idx = 0; result_idx < static_cast<int>(cluster_results.size()); result_idx++)
+    {
+        const Polygons& cluster = clusters[result_idx % clusters.size()];
+        cluster_results[result_idx] = cluster.offset(distances[result_idx / clusters.size()], ClipperLib::jtRound);
+    }
+
+    std::vector<Polygons> result(distances.size());
+    for (size_t result_idx = 0; result_idx < cluster_results.size(); result_idx++)
+    {
+        result[result_idx / clusters.size()].add(cluster_results[result_idx]);
+    }
+    return result;
+}
+
+} //Anonymous namespace.
+
 void SkirtBrim::getFirstLayerOutline(SliceDataStorage& storage, const size_t primary_line_count, const bool is_skirt, Polygons& first_layer_outline)
 {
     const ExtruderTrain& train = Application::getInstance().current_slice->scene.current_mesh_group->settings.get<ExtruderTrain&>("skirt_brim_extruder_nr");
@@ -93,11 +196,21 @@ coord_t SkirtBrim::generatePrimarySkirtBrimLines(const coord_t start_distance, s
     const Settings& adhesion_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings.get<ExtruderTrain&>("skirt_brim_extruder_nr").settings;
     const coord_t primary_extruder_skirt_brim_line_width = adhesion_settings.get<coord_t>("skirt_brim_line_width") * adhesion_settings.get<Ratio>("initial_layer_line_width_factor");
     coord_t offset_distance = start_distance - primary_extruder_skirt_brim_line_width / 2;
+
+    //Compute the lines that we know we'll need all at once. If more are needed to reach the minimal length, those are added one by one.
+    std::vector<coord_t> offset_distances;
+    for (unsigned int skirt_brim_number = 0; skirt_brim_number < primary_line_count; skirt_brim_number++)
+    {
+        offset_distances.push_back(offset_distance + (skirt_brim_number + 1) * primary_extruder_skirt_brim_line_width);
+    }
+    const std::vector<Polygons> clusters = getOffsetClusters(first_layer_outline, offset_distances.empty() ? 0 : offset_distances.back());
+    std::vector<Polygons> outer_skirt_brim_lines = offsetClusters(clusters, offset_distances);
+
     for (unsigned int skirt_brim_number = 0; skirt_brim_number < primary_line_count; skirt_brim_number++)
     {
         offset_distance += primary_extruder_skirt_brim_line_width;
 
-        Polygons outer_skirt_brim_line = first_layer_outline.offset(offset_distance, ClipperLib::jtRound);
+        Polygons outer_skirt_brim_line = (skirt_brim_number < outer_skirt_brim_lines.size()) ? std::move(outer_skirt_brim_lines[skirt_brim_number]) : first_layer_outline.offset(offset_distance, ClipperLib::jtRound);
 
         //Remove small inner skirt and brim holes. Holes have a negative area, remove anything smaller then 100x extrusion "area"
         for (unsigned int n = 0; n < outer_skirt_brim_line.size(); n++)
@@ -265,11 +378,21 @@ void SkirtBrim::generateSupportBrim(SliceDataStorage& storage, const bool merge_
     Polygons support_brim;
 
     coord_t offset_distance = brim_line_width / 2;
+
+    //Compute the lines that we know we'll need all at once. If more are needed to reach the minimal length, those are added one by one.
+    std::vector<coord_t> offset_distances;
+    for (size_t skirt_brim_number = 0; skirt_brim_number < line_count; skirt_brim_number++)
+    {
+        offset_distances.push_back(offset_distance - static_cast<coord_t>(skirt_brim_number + 1) * brim_line_width);
+    }
+    const std::vector<Polygons> clusters = getOffsetClusters(support_outline, offset_distances.empty() ? 0 : offset_distances.front());
+    std::vector<Polygons> brim_lines = offsetClusters(clusters, offset_distances);
+
     for (size_t skirt_brim_number = 0; skirt_brim_number < line_count; skirt_brim_number++)
     {
         offset_distance -= brim_line_width;
 
-        Polygons brim_line = support_outline.offset(offset_distance, ClipperLib::jtRound);
+        Polygons brim_line = (skirt_brim_number < brim_lines.size()) ? std::move(brim_lines[skirt_brim_number]) : support_outline.offset(offset_distance, ClipperLib::jtRound);
 
         //Remove small inner skirt and brim holes. Holes have a negative area, remove anything smaller then multiplier x extrusion "area"
         for (size_t n = 0; n < brim_line.size(); n++)
@@ -3,6 +3,7 @@
 
 #include "ExtruderTrain.h"
 #include "Slice.h"
+#include "utils/Cancellation.h"
 #include "utils/logoutput.h"
 
 namespace cura
@@ -23,6 +24,10 @@ void Slice::compute()
             extruder.settings.setParent(&scene.current_mesh_group->settings);
         }
         scene.processMeshGroup(*mesh_group);
+        if (Cancellation::isRequested())
+        {
+            break;
+        }
     }
 }
 
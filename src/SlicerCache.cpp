@@ -0,0 +1,368 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cinttypes> //For PRIx64.
+#include <cstdio> //For snprintf, std::remove and std::rename.
+#include <cstring> //For memcpy and memcmp.
+#include <fstream>
+#include <random> //For a unique temporary file name.
+
+#include "Application.h" //To get the mesh group settings.
+#include "mesh.h"
+#include "Scene.h"
+#include "Slice.h"
+#include "SlicerCache.h"
+#include "settings/AdaptiveLayerHeights.h"
+#include "utils/logoutput.h"
+
+namespace cura
+{
+
+namespace
+{
+
+constexpr uint64_t fnv_offset_basis = 14695981039346656037ULL; //!< Start value of the 64-bit FNV-1a hash.
+
+/*!
+ * Continue a 64-bit FNV-1a hash with some more bytes.
+ * \param data The bytes to hash.
+ * \param size The number of bytes.
+ * \param hash The hash of the bytes before this.
+ * \return The hash including these bytes.
+ */
+uint64_t hashBytes(const void* data, const size_t size, uint64_t hash)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL; //The 64-bit FNV prime.
+    }
+    return hash;
+}
+
+/*!
+ * The settings of a mesh that the slicer uses, see Slicer and SlicerLayer::makePolygons.
+ */
+constexpr const char* slicer_settings[] = {
+    "slicing_tolerance",
+    "magic_mesh_surface_mode",
+    "meshfix_extensive_stitching",
+    "meshfix_keep_open_polygons",
+    "minimum_polygon_circumference",
+    "meshfix_maximum_resolution",
+    "meshfix_maximum_deviation",
+    "meshfix_maximum_extrusion_area_deviation",
+    "xy_offset",
+    "xy_offset_layer_0",
+    "support_mesh",
+    "anti_overhang_mesh",
+    "cutting_mesh",
+    "infill_mesh"
+};
+
+} //Anonymous namespace.
+
+SlicerCache::SlicerCache()
+: mesh_group_nr(0)
+{
+}
+
+std::string SlicerCache::getKey(const Mesh& mesh, const coord_t thickness, const size_t slice_layer_count, const std::vector<AdaptiveLayer>* adaptive_layers)
+{
+    uint64_t hash = fnv_offset_basis;
+    for (const MeshVertex& vertex : mesh.vertices)
+    {
+        const coord_t coordinates[3] = { vertex.p.x, vertex.p.y, vertex.p.z };
+        hash = hashBytes(coordinates, sizeof(coordinates), hash);
+    }
+    for (const MeshFace& face : mesh.faces)
+    {
+        hash = hashBytes(face.vertex_index, sizeof(face.vertex_index), hash);
+    }
+    if (adaptive_layers)
+    {
+        for (const AdaptiveLayer& layer : *adaptive_layers)
+        {
+            const coord_t height_and_z[2] = { layer.layer_height, layer.z_position };
+            hash = hashBytes(height_and_z, sizeof(height_and_z), hash);
+        }
+    }
+    char geometry[96];
+    snprintf(geometry, sizeof(geometry), "%016" PRIx64 " %zu %zu %lld %zu %d\n", hash, mesh.vertices.size(), mesh.faces.size(), static_cast<long long>(thickness), slice_layer_count, adaptive_layers ? 1 : 0);
+
+    std::string key = geometry;
+    key += "layer_height_0=" + Application::getInstance().current_slice->scene.current_mesh_group->settings.get<std::string>("layer_height_0") + "\n";
+    for (const char* setting : slicer_settings)
+    {
+        key += setting;
+        key += "=" + mesh.settings.get<std::string>(setting) + "\n";
+    }
+    return key;
+}
+
+std::string SlicerCache::getInstanceKey(const Mesh& mesh)
+{
+    //Hash the vertices relative to the first one in X and Y, so that the hash doesn't change when the mesh is moved over the build plate.
+    const Point3 origin = mesh.vertices.empty() ? Point3(0, 0, 0) : mesh.vertices[0].p;
+    uint64_t hash = fnv_offset_basis;
+    for (const MeshVertex& vertex : mesh.vertices)
+    {
+        const coord_t coordinates[3] = { vertex.p.x - origin.x, vertex.p.y - origin.y, vertex.p.z };
+        hash = hashBytes(coordinates, sizeof(coordinates), hash);
+    }
+    for (const MeshFace& face : mesh.faces)
+    {
+        hash = hashBytes(face.vertex_index, sizeof(face.vertex_index), hash);
+    }
+    char geometry[64];
+    snprintf(geometry, sizeof(geometry), "%016" PRIx64 " %zu %zu\n", hash, mesh.vertices.size(), mesh.faces.size());
+    return geometry + mesh.settings.getAllSettingsString();
+}
+
+bool SlicerCache::isTranslatedCopy(const Mesh& mesh, const Mesh& original, Point& offset)
+{
+    if (mesh.vertices.empty() || mesh.vertices.size() != original.vertices.size() || mesh.faces.size() != original.faces.size())
+    {
+        return false;
+    }
+    const Point3 offset3 = mesh.vertices[0].p - original.vertices[0].p;
+    if (offset3.z != 0)
+    {
+        return false; //Moved up or down, so it's cut at different heights.
+    }
+    for (size_t vertex_idx = 0; vertex_idx < mesh.vertices.size(); vertex_idx++)
+    {
+        if (mesh.vertices[vertex_idx].p != original.vertices[vertex_idx].p + offset3)
+        {
+            return false;
+        }
+    }
+    for (size_t face_idx = 0; face_idx < mesh.faces.size(); face_idx++)
+    {
+        if (std::memcmp(mesh.faces[face_idx].vertex_index, original.faces[face_idx].vertex_index, sizeof(mesh.faces[face_idx].vertex_index)) != 0)
+        {
+            return false;
+        }
+    }
+    offset = Point(offset3.x, offset3.y);
+    return true;
+}
+
+std::vector<SlicerLayer> SlicerCache::getTranslatedLayers(const std::vector<SlicerLayer>& layers, const Point offset)
+{
+    std::vector<SlicerLayer> result(layers.size());
+    for (size_t layer_nr = 0; layer_nr < layers.size(); layer_nr++)
+    {
+        result[layer_nr].z = layers[layer_nr].z;
+        result[layer_nr].polygons = layers[layer_nr].polygons;
+        result[layer_nr].polygons.translate(offset);
+        result[layer_nr].openPolylines = layers[layer_nr].openPolylines;
+        result[layer_nr].openPolylines.translate(offset);
+        result[layer_nr].part_starts = layers[layer_nr].part_starts;
+    }
+    return result;
+}
+
+void SlicerCache::startMeshGroup(const size_t mesh_group_count)
+{
+    mesh_group_nr++;
+    for (auto entry = entries.begin(); entry != entries.end();)
+    {
+        if (entry->second.last_used_mesh_group + mesh_group_count < mesh_group_nr) //Not used in the previous slice.
+        {
+            entry = entries.erase(entry);
+        }
+        else
+        {
+            entry++;
+        }
+    }
+}
+
+const std::vector<SlicerLayer>* SlicerCache::find(const std::string& key)
+{
+    auto entry = entries.find(key);
+    if (entry == entries.end())
+    {
+        std::vector<SlicerLayer> layers;
+        if (directory.empty() || !readFile(getFilename(key), key, layers))
+        {
+            return nullptr;
+        }
+        entry = entries.emplace(key, Entry{ std::move(layers), mesh_group_nr }).first;
+    }
+    entry->second.last_used_mesh_group = mesh_group_nr;
+    return &entry->second.layers;
+}
+
+void SlicerCache::insert(const std::string& key, const std::vector<SlicerLayer>& layers)
+{
+    Entry& entry = entries[key];
+    entry.last_used_mesh_group = mesh_group_nr;
+    entry.layers.clear();
+    entry.layers.resize(layers.size());
+    for (size_t layer_nr = 0; layer_nr < layers.size(); layer_nr++)
+    {
+        entry.layers[layer_nr].z = layers[layer_nr].z;
+        entry.layers[layer_nr].polygons = layers[layer_nr].polygons;
+        entry.layers[layer_nr].openPolylines = layers[layer_nr].openPolylines;
+        entry.layers[layer_nr].part_starts = layers[layer_nr].part_starts;
+    }
+    if (!directory.empty())
+    {
+        writeFile(getFilename(key), key, entry.layers);
+    }
+}
+
+void SlicerCache::clear()
+{
+    entries.clear();
+}
+
+void SlicerCache::setDirectory(const std::string& directory)
+{
+    this->directory = directory;
+}
+
+constexpr char SlicerCache::file_header[];
+
+std::string SlicerCache::getFilename(const std::string& key) const
+{
+    char hash_string[17];
+    snprintf(hash_string, sizeof(hash_string), "%016" PRIx64, hashBytes(key.data(), key.size(), fnv_offset_basis));
+    return directory + "/" + hash_string + ".slicecache";
+}
+
+bool SlicerCache::readFile(const std::string& filename, const std::string& key, std::vector<SlicerLayer>& layers)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return false; //Not in the cache.
+    }
+    const std::streamoff file_size = file.tellg();
+    file.seekg(0);
+    char header[sizeof(file_header)];
+    if (file_size < static_cast<std::streamoff>(sizeof(file_header)) || !file.read(header, sizeof(file_header)) || std::memcmp(header, file_header, sizeof(file_header)) != 0)
+    {
+        return false;
+    }
+    size_t remaining = file_size - sizeof(file_header); //Counts larger than what's left of the file are damaged, so they may not be allocated.
+
+    //All platforms that Cura supports are little-endian, so the numbers are stored as they are in memory.
+    const auto read_number = [&file, &remaining](auto& number)
+    {
+        if (remaining < sizeof(number))
+        {
+            return false;
+        }
+        char bytes[sizeof(number)];
+        file.read(bytes, sizeof(number));
+        std::memcpy(&number, bytes, sizeof(number));
+        remaining -= sizeof(number);
+        return static_cast<bool>(file);
+    };
+    const auto read_polygons = [&file, &remaining, &read_number](Polygons& polygons)
+    {
+        uint32_t polygon_count;
+        if (!read_number(polygon_count) || polygon_count > remaining / sizeof(uint32_t)) //Each polygon has at least its point count.
+        {
+            return false;
+        }
+        for (uint32_t poly_idx = 0; poly_idx < polygon_count; poly_idx++)
+        {
+            uint32_t point_count;
+            if (!read_number(point_count) || point_count > remaining / sizeof(Point))
+            {
+                return false;
+            }
+            remaining -= point_count * sizeof(Point);
+            ClipperLib::Path& path = *polygons.newPoly();
+            path.resize(point_count);
+            if (point_count > 0 && !file.read(reinterpret_cast<char*>(path.data()), point_count * sizeof(Point)))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    uint32_t key_length;
+    if (!read_number(key_length) || key_length != key.size() || key_length > remaining)
+    {
+        return false;
+    }
+    std::string stored_key(key_length, '\0');
+    if (!file.read(&stored_key[0], key_length) || stored_key != key)
+    {
+        return false; //A different key with the same hash.
+    }
+    remaining -= key_length;
+    uint32_t layer_count;
+    constexpr size_t min_layer_size = sizeof(int64_t) + 2 * sizeof(uint32_t); //The height and the counts of the polygons and polylines.
+    if (!read_number(layer_count) || layer_count > remaining / min_layer_size)
+    {
+        return false;
+    }
+    layers.resize(layer_count);
+    for (SlicerLayer& layer : layers)
+    {
+        int64_t z;
+        if (!read_number(z) || !read_polygons(layer.polygons) || !read_polygons(layer.openPolylines))
+        {
+            return false;
+        }
+        layer.z = z;
+    }
+    return remaining == 0 && file.peek() == std::ifstream::traits_type::eof(); //Nothing may be left, or the file is damaged.
+}
+
+void SlicerCache::writeFile(const std::string& filename, const std::string& key, const std::vector<SlicerLayer>& layers)
+{
+    std::string data(file_header, sizeof(file_header));
+    const auto write_number = [&data](const auto number)
+    {
+        char bytes[sizeof(number)];
+        std::memcpy(bytes, &number, sizeof(number));
+        data.append(bytes, sizeof(number));
+    };
+    const auto write_polygons = [&data, &write_number](const Polygons& polygons)
+    {
+        write_number(static_cast<uint32_t>(polygons.size()));
+        for (ConstPolygonRef polygon : polygons)
+        {
+            write_number(static_cast<uint32_t>(polygon.size()));
+            data.append(reinterpret_cast<const char*>((*polygon).data()), polygon.size() * sizeof(Point));
+        }
+    };
+
+    write_number(static_cast<uint32_t>(key.size()));
+    data.append(key);
+    write_number(static_cast<uint32_t>(layers.size()));
+    for (const SlicerLayer& layer : layers)
+    {
+        write_number(static_cast<int64_t>(layer.z));
+        write_polygons(layer.polygons);
+        write_polygons(layer.openPolylines);
+    }
+
+    //Write to a temporary file first, so that other processes never read a half-written cache file.
+    const std::string temporary_file = filename + "." + std::to_string(std::random_device()()) + ".tmp";
+    {
+        std::ofstream file(temporary_file, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(data.data(), data.size()))
+        {
+            logWarning("Couldn't write slice cache file: %s\n", temporary_file.c_str());
+            file.close();
+            std::remove(temporary_file.c_str());
+            return;
+        }
+    }
+    if (std::rename(temporary_file.c_str(), filename.c_str()) != 0)
+    {
+        std::remove(temporary_file.c_str()); //Probably another process stored the same file in the meantime.
+    }
+}
+
+} //namespace cura
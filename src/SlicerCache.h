@@ -0,0 +1,176 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef SLICER_CACHE_H
+#define SLICER_CACHE_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "slicer.h"
+
+namespace cura
+{
+
+class AdaptiveLayer;
+class Mesh;
+
+/*!
+ * \brief The layers of the meshes sliced in the previous slice, to reuse them
+ * if the next slice cuts the same meshes in the same way.
+ *
+ * When an interactive session changes a setting that is only used after
+ * slicing, for instance the infill density or a print speed, the slicer would
+ * produce exactly the same layers again. The layers are stored under a key
+ * that consists of a hash of the mesh geometry and the values of all settings
+ * that the slicer uses.
+ *
+ * Only the layers used in the previous slice are kept, so that the cache
+ * doesn't keep growing in a long-running session.
+ *
+ * Optionally, the layers are also stored in files in a directory, named
+ * after a hash of their key. Other runs of CuraEngine that slice the same mesh
+ * in the same way read the layers from there.
+ */
+class SlicerCache
+{
+public:
+    SlicerCache();
+
+    /*!
+     * \brief Get the key under which the layers of a mesh are stored.
+     *
+     * This must be computed before the mesh data is cleared after slicing.
+     * \param mesh The mesh to slice.
+     * \param thickness The layer height the mesh is sliced with.
+     * \param slice_layer_count The number of layers the mesh is sliced into.
+     * \param adaptive_layers The heights of the layers if adaptive layer
+     * heights are used, or ``nullptr`` otherwise.
+     * \return A key that is the same for every slice that would produce the
+     * same layers for this mesh.
+     */
+    static std::string getKey(const Mesh& mesh, const coord_t thickness, const size_t slice_layer_count, const std::vector<AdaptiveLayer>* adaptive_layers);
+
+    /*!
+     * \brief Get a key that is the same for meshes that are copies of each
+     * other, only moved in X and Y, with the same settings.
+     *
+     * Plates with many copies of the same part can slice those copies once.
+     * Meshes with the same key may still differ, if their hashes collide, so
+     * they need to be compared with \ref isTranslatedCopy .
+     * \param mesh The mesh to slice.
+     * \return The key of the mesh.
+     */
+    static std::string getInstanceKey(const Mesh& mesh);
+
+    /*!
+     * \brief Check whether a mesh is a copy of another, only moved in X and Y.
+     *
+     * The vertices and faces must be the same and in the same order.
+     * \param mesh The mesh that may be a copy.
+     * \param original The mesh that it may be a copy of.
+     * \param[out] offset How far \p mesh is moved from \p original .
+     * \return Whether \p mesh is a moved copy of \p original .
+     */
+    static bool isTranslatedCopy(const Mesh& mesh, const Mesh& original, Point& offset);
+
+    /*!
+     * \brief Copy the layers of a mesh, moved in X and Y.
+     *
+     * Only the polygons and heights are copied, like with \ref insert .
+     * \param layers The layers to copy, straight from the slicer.
+     * \param offset How far to move the copy.
+     * \return The moved layers.
+     */
+    static std::vector<SlicerLayer> getTranslatedLayers(const std::vector<SlicerLayer>& layers, const Point offset);
+
+    /*!
+     * \brief Start slicing the next mesh group.
+     *
+     * This forgets the layers that weren't used during the previous slice.
+     * \param mesh_group_count The number of mesh groups in each slice.
+     */
+    void startMeshGroup(const size_t mesh_group_count);
+
+    /*!
+     * \brief Find the layers of a mesh that was sliced before.
+     * \param key The key of the mesh, from \ref getKey.
+     * \return The layers, or ``nullptr`` if the mesh wasn't sliced in this
+     * way in the previous slice.
+     */
+    const std::vector<SlicerLayer>* find(const std::string& key);
+
+    /*!
+     * \brief Store the layers that a mesh was sliced into.
+     *
+     * Only the polygons and heights are stored, not the intermediate segments.
+     * \param key The key of the mesh, from \ref getKey.
+     * \param layers The layers of the mesh, straight from the slicer.
+     */
+    void insert(const std::string& key, const std::vector<SlicerLayer>& layers);
+
+    /*!
+     * Forget all stored layers.
+     *
+     * This doesn't remove the files in the cache directory.
+     */
+    void clear();
+
+    /*!
+     * \brief Set the directory to store the layers in for other runs.
+     * \param directory An existing directory, or an empty string to only keep
+     * the layers in memory.
+     */
+    void setDirectory(const std::string& directory);
+
+    /*!
+     * Get the file in the cache directory that the layers of a key are stored
+     * in.
+     */
+    std::string getFilename(const std::string& key) const;
+
+private:
+    /*!
+     * The layers of one mesh, and when they were last used.
+     */
+    struct Entry
+    {
+        std::vector<SlicerLayer> layers;
+        size_t last_used_mesh_group; //!< The mesh group number that the layers were last used in.
+    };
+
+    /*!
+     * The first bytes of a cache file, to recognise the file format and its
+     * version.
+     */
+    static constexpr char file_header[] = { 'C', 'U', 'R', 'A', 'S', 'L', 'C', 1 };
+
+    std::unordered_map<std::string, Entry> entries; //!< The stored layers, by their key.
+    size_t mesh_group_nr; //!< How many mesh groups have been sliced so far, across all slices.
+    std::string directory; //!< Where to store the layers for other runs, if anywhere.
+
+    /*!
+     * \brief Read layers from a cache file.
+     * \param filename The file to read.
+     * \param key The key that the layers must be stored under. Files with a
+     * different key are ignored, in case two keys have the same hash.
+     * \param[out] layers The layers that were read.
+     * \return Whether the file exists and contains the layers of this key.
+     */
+    static bool readFile(const std::string& filename, const std::string& key, std::vector<SlicerLayer>& layers);
+
+    /*!
+     * \brief Write layers to a cache file.
+     *
+     * If the file can't be written, the layers are only kept in memory.
+     * \param filename The file to write.
+     * \param key The key that the layers are stored under.
+     * \param layers The layers to write.
+     */
+    static void writeFile(const std::string& filename, const std::string& key, const std::vector<SlicerLayer>& layers);
+};
+
+} //namespace cura
+
+#endif //SLICER_CACHE_H
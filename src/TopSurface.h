@@ -42,6 +42,12 @@ public:
      * strike the surface smooth by melting it with the hot nozzle and filling
      * crevices with a minute amount of material.
      *
+     * The pattern is generated separately from the skin of the same layer. Its
+     * lines are perpendicular to the skin lines and have their own spacing, and
+     * they cover the whole top surface rather than only the skin inside the
+     * walls. So none of the scanlines of the skin coincide with the ironing
+     * lines, and there is nothing to share between the two.
+     *
      * \param storage The slice data storage in the highly unlikely case that printing the ironing requires printing a brim just before it
      * \param mesh The settings base to get our ironing settings and skin angles
      * from.
@@ -1,8 +1,18 @@
 //Copyright (c) 2021 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For std::sort.
+#include <map>
+#include <tuple>
+
+#ifdef _OPENMP
+    #include <omp.h>
+#endif // _OPENMP
+
 #include "sliceDataStorage.h"
 #include "TreeModelVolumes.h"
+#include "utils/Cancellation.h"
+#include "utils/Simplify.h" //To reduce the resolution of the volumes if the memory of the cache is limited.
 
 namespace cura
 {
@@ -24,50 +34,134 @@ TreeModelVolumes::TreeModelVolumes(const SliceDataStorage& storage, const Settin
         constexpr bool include_prime_tower = true;
         layer_outlines_.push_back(storage.getLayerOutlines(layer_idx, include_support, include_prime_tower));
     }
+
+    const size_t cache_limit = settings.getOrDefault<size_t>("support_tree_cache_limit", 0) * 1024 * 1024; //The setting is in MiB. 0 means unlimited.
+    if (cache_limit > 0)
+    {
+        memory_budget_ = std::make_unique<MemoryBudget>();
+        memory_budget_->limit = cache_limit;
+        collision_cache_ = Cache(memory_budget_.get());
+        avoidance_cache_ = Cache(memory_budget_.get());
+        internal_model_cache_ = Cache(memory_budget_.get());
+    }
+}
+
+std::shared_ptr<const Polygons> TreeModelVolumes::getCollision(coord_t radius, LayerIndex layer_idx) const
+{
+    radius = ceilRadius(radius);
+    const RadiusLayerPair key{radius, layer_idx};
+    std::shared_ptr<const Polygons> collision = collision_cache_.get(key, [this, &key]() { return simplifyForCache(calculateCollision(key), key.first); });
+    enforceMemoryBudget();
+    return collision;
+}
+
+std::shared_ptr<const Polygons> TreeModelVolumes::getAvoidance(coord_t radius, LayerIndex layer_idx) const
+{
+    radius = ceilRadius(radius);
+    const RadiusLayerPair key{radius, layer_idx};
+    std::shared_ptr<const Polygons> avoidance = avoidance_cache_.get(key, [this, &key]() { return simplifyForCache(calculateAvoidance(key), key.first); });
+    enforceMemoryBudget();
+    return avoidance;
 }
 
-const Polygons& TreeModelVolumes::getCollision(coord_t radius, LayerIndex layer_idx) const
+std::shared_ptr<const Polygons> TreeModelVolumes::getInternalModel(coord_t radius, LayerIndex layer_idx) const
 {
     radius = ceilRadius(radius);
-    RadiusLayerPair key{radius, layer_idx};
-    const auto it = collision_cache_.find(key);
-    if (it != collision_cache_.end())
+    const RadiusLayerPair key{radius, layer_idx};
+    std::shared_ptr<const Polygons> internal_model = internal_model_cache_.get(key, [this, &key]() { return calculateInternalModel(key); }); //Made of the simplified volumes already.
+    enforceMemoryBudget();
+    return internal_model;
+}
+
+void TreeModelVolumes::precalculate(const std::vector<coord_t>& radii, const bool include_avoidance) const
+{
+    if (memory_budget_)
     {
-        return it->second;
+        return;
     }
-    else
+    const size_t layer_count = layer_outlines_.size();
+
+    //The collision areas of all radii and layers are independent.
+#pragma omp parallel for default(none) shared(radii, layer_count) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int sample_idx = 0; sample_idx < static_cast<int>(radii.size() * layer_count); sample_idx++)
     {
-        return calculateCollision(key);
+        if (Cancellation::isRequested())
+        {
+            continue;
+        }
+        getCollision(radii[sample_idx / layer_count], sample_idx % layer_count);
     }
-}
 
-const Polygons& TreeModelVolumes::getAvoidance(coord_t radius, LayerIndex layer_idx) const
-{
-    radius = ceilRadius(radius);
-    RadiusLayerPair key{radius, layer_idx};
-    const auto it = avoidance_cache_.find(key);
-    if (it != avoidance_cache_.end())
+    if (! include_avoidance)
     {
-        return it->second;
+        return;
     }
-    else
+    //The avoidance of each layer depends on the one below it, but different radii are independent.
+#pragma omp parallel for default(none) shared(radii, layer_count) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int radius_idx = 0; radius_idx < static_cast<int>(radii.size()); radius_idx++)
     {
-        return calculateAvoidance(key);
+        for (size_t layer_idx = 0; layer_idx < layer_count && !Cancellation::isRequested(); layer_idx++)
+        {
+            getAvoidance(radii[radius_idx], layer_idx);
+        }
     }
 }
 
-const Polygons& TreeModelVolumes::getInternalModel(coord_t radius, LayerIndex layer_idx) const
+void TreeModelVolumes::precalculateAvoidance(const std::vector<std::pair<coord_t, LayerIndex>>& radius_layers) const
 {
-    radius = ceilRadius(radius);
-    RadiusLayerPair key{radius, layer_idx};
-    const auto it = internal_model_cache_.find(key);
-    if (it != internal_model_cache_.end())
+    if (memory_budget_)
     {
-        return it->second;
+        return;
     }
-    else
+    const LayerIndex max_layer_idx = static_cast<LayerIndex>(layer_outlines_.size()) - 1;
+    std::map<coord_t, LayerIndex> top_per_sample; //Ordered, so that the chains are computed in the same order every time.
+    for (const std::pair<coord_t, LayerIndex>& radius_layer : radius_layers)
     {
-        return calculateInternalModel(key);
+        const LayerIndex top_layer_idx = std::min(radius_layer.second, max_layer_idx);
+        if (top_layer_idx < 0)
+        {
+            continue;
+        }
+        const auto [sample, is_new] = top_per_sample.emplace(ceilRadius(radius_layer.first), top_layer_idx);
+        if (! is_new)
+        {
+            sample->second = std::max(sample->second, top_layer_idx);
+        }
+    }
+    std::vector<RadiusLayerPair> chains(top_per_sample.begin(), top_per_sample.end());
+
+    //The collision areas don't depend on each other.
+    std::vector<RadiusLayerPair> collisions;
+    for (const RadiusLayerPair& chain : chains)
+    {
+        for (LayerIndex layer_idx = 0; layer_idx <= chain.second; layer_idx++)
+        {
+            collisions.emplace_back(chain.first, layer_idx);
+        }
+    }
+#pragma omp parallel for default(none) shared(collisions) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int collision_idx = 0; collision_idx < static_cast<int>(collisions.size()); collision_idx++)
+    {
+        if (Cancellation::isRequested())
+        {
+            continue;
+        }
+        getCollision(collisions[collision_idx].first, collisions[collision_idx].second);
+    }
+
+    //Start with the longest chains, so that no thread is left with a long chain at the end.
+    std::stable_sort(chains.begin(), chains.end(), [](const RadiusLayerPair& a, const RadiusLayerPair& b) { return a.second > b.second; });
+#pragma omp parallel for default(none) shared(chains) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int chain_idx = 0; chain_idx < static_cast<int>(chains.size()); chain_idx++)
+    {
+        for (LayerIndex layer_idx = 0; layer_idx <= chains[chain_idx].second && !Cancellation::isRequested(); layer_idx++)
+        {
+            getAvoidance(chains[chain_idx].first, layer_idx);
+        }
     }
 }
 
@@ -78,7 +172,7 @@ coord_t TreeModelVolumes::ceilRadius(coord_t radius) const
     return radius + delta;
 }
 
-const Polygons& TreeModelVolumes::calculateCollision(const RadiusLayerPair& key) const
+Polygons TreeModelVolumes::calculateCollision(const RadiusLayerPair& key) const
 {
     const coord_t radius = key.first;
     const LayerIndex layer_idx = key.second;
@@ -104,20 +198,17 @@ const Polygons& TreeModelVolumes::calculateCollision(const RadiusLayerPair& key)
             collision_areas = collision_areas.unionPolygons(collision_model.offset(radius));
         }
     }
-    const auto ret = collision_cache_.insert({key, std::move(collision_areas)});
-    assert(ret.second);
-    return ret.first->second;
+    return collision_areas;
 }
 
-const Polygons& TreeModelVolumes::calculateAvoidance(const RadiusLayerPair& key) const
+Polygons TreeModelVolumes::calculateAvoidance(const RadiusLayerPair& key) const
 {
     const auto& radius = key.first;
     const auto& layer_idx = key.second;
 
     if (layer_idx == 0)
     {
-        avoidance_cache_[key] = getCollision(radius, 0);
-        return avoidance_cache_[key];
+        return *getCollision(radius, 0);
     }
 
     // Avoidance for a given layer depends on all layers beneath it so could have very deep recursion depths if
@@ -127,28 +218,138 @@ const Polygons& TreeModelVolumes::calculateAvoidance(const RadiusLayerPair& key)
     // below our current one.
     constexpr auto max_recursion_depth = 100;
     // Check if we would exceed the recursion limit by trying to process this layer
-    if (layer_idx >= max_recursion_depth
-        && avoidance_cache_.find({radius, layer_idx - max_recursion_depth}) == avoidance_cache_.end())
+    if (layer_idx >= max_recursion_depth)
     {
-        // Force the calculation of the layer `max_recursion_depth` below our current one, ignoring the result.
+        // Force the calculation of the layer `max_recursion_depth` below our current one, ignoring the result. If it's already cached, this is just a lookup.
         getAvoidance(radius, layer_idx - max_recursion_depth);
     }
-    auto avoidance_areas = getAvoidance(radius, layer_idx - 1).offset(-max_move_).smooth(5);
-    avoidance_areas = avoidance_areas.unionPolygons(getCollision(radius, layer_idx));
-    const auto ret = avoidance_cache_.insert({key, std::move(avoidance_areas)});
-    assert(ret.second);
-    return ret.first->second;
+    auto avoidance_areas = getAvoidance(radius, layer_idx - 1)->offset(-max_move_).smooth(5);
+    avoidance_areas = avoidance_areas.unionPolygons(*getCollision(radius, layer_idx));
+    return avoidance_areas;
 }
 
-const Polygons& TreeModelVolumes::calculateInternalModel(const RadiusLayerPair& key) const
+Polygons TreeModelVolumes::calculateInternalModel(const RadiusLayerPair& key) const
 {
     const auto& radius = key.first;
     const auto& layer_idx = key.second;
 
-    const auto& internal_areas = getAvoidance(radius, layer_idx).difference(getCollision(radius, layer_idx));
-    const auto ret = internal_model_cache_.insert({key, internal_areas});
-    assert(ret.second);
-    return ret.first->second;
+    return getAvoidance(radius, layer_idx)->difference(*getCollision(radius, layer_idx));
+}
+
+TreeModelVolumes::Cache::Cache(MemoryBudget* budget)
+: budget(budget)
+{
+    shards.reserve(shard_count);
+    for (size_t shard_idx = 0; shard_idx < shard_count; shard_idx++)
+    {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+std::shared_ptr<TreeModelVolumes::Cache::Entry> TreeModelVolumes::Cache::getEntry(const RadiusLayerPair& key)
+{
+    Shard& shard = *shards[RadiusLayerPairHash()(key) % shard_count];
+    const std::lock_guard<std::mutex> lock(shard.mutex);
+    std::shared_ptr<Entry>& entry = shard.entries[key];
+    if (! entry)
+    {
+        entry = std::make_shared<Entry>();
+    }
+    if (budget)
+    {
+        entry->last_use.store(++budget->clock, std::memory_order_relaxed);
+    }
+    return entry;
+}
+
+void TreeModelVolumes::Cache::addToBudget(Entry& entry)
+{
+    size_t bytes = 0;
+    for (const ClipperLib::Path& path : *entry.volume)
+    {
+        bytes += path.capacity() * sizeof(Point);
+    }
+    budget->used += bytes; //Before the entry may be removed, which subtracts them again.
+    entry.bytes.store(bytes);
+}
+
+void TreeModelVolumes::Cache::getLastUses(std::vector<std::pair<uint64_t, RadiusLayerPair>>& last_uses) const
+{
+    for (const std::unique_ptr<Shard>& shard : shards)
+    {
+        const std::lock_guard<std::mutex> lock(shard->mutex);
+        for (const std::pair<const RadiusLayerPair, std::shared_ptr<Entry>>& key_and_entry : shard->entries)
+        {
+            if (key_and_entry.second->bytes.load() > 0) //Volumes that are still being computed or are empty don't free anything.
+            {
+                last_uses.emplace_back(key_and_entry.second->last_use.load(std::memory_order_relaxed), key_and_entry.first);
+            }
+        }
+    }
+}
+
+void TreeModelVolumes::Cache::remove(const RadiusLayerPair& key)
+{
+    Shard& shard = *shards[RadiusLayerPairHash()(key) % shard_count];
+    const std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto entry = shard.entries.find(key);
+    if (entry == shard.entries.end())
+    {
+        return;
+    }
+    budget->used -= entry->second->bytes.load();
+    shard.entries.erase(entry);
+}
+
+Polygons TreeModelVolumes::simplifyForCache(Polygons volume, const coord_t radius) const
+{
+    if (! memory_budget_)
+    {
+        return volume;
+    }
+    const coord_t tolerance = std::min({ radius, radius_sample_resolution_, max_move_ }) / 2;
+    if (tolerance <= 0)
+    {
+        return volume; //The collision of the model itself stays exact.
+    }
+    const Simplify simplifier(radius_sample_resolution_, tolerance, tolerance * radius_sample_resolution_);
+    return simplifier.polygon(volume.offset(tolerance));
+}
+
+void TreeModelVolumes::enforceMemoryBudget() const
+{
+    if (! memory_budget_ || memory_budget_->used.load() <= memory_budget_->limit)
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> eviction_lock(memory_budget_->eviction_mutex, std::try_to_lock);
+    if (! eviction_lock.owns_lock())
+    {
+        return;
+    }
+
+    Cache* const caches[3] = { &collision_cache_, &avoidance_cache_, &internal_model_cache_ };
+    std::vector<std::tuple<uint64_t, size_t, RadiusLayerPair>> last_uses; //The time of the last request, cache and key of each volume.
+    for (size_t cache_idx = 0; cache_idx < 3; cache_idx++)
+    {
+        std::vector<std::pair<uint64_t, RadiusLayerPair>> cache_last_uses;
+        caches[cache_idx]->getLastUses(cache_last_uses);
+        for (const std::pair<uint64_t, RadiusLayerPair>& last_use : cache_last_uses)
+        {
+            last_uses.emplace_back(last_use.first, cache_idx, last_use.second);
+        }
+    }
+    std::sort(last_uses.begin(), last_uses.end());
+
+    const size_t target = memory_budget_->limit / 4 * 3;
+    for (const std::tuple<uint64_t, size_t, RadiusLayerPair>& last_use : last_uses)
+    {
+        if (memory_budget_->used.load() <= target)
+        {
+            break;
+        }
+        caches[std::get<1>(last_use)]->remove(std::get<2>(last_use));
+    }
 }
 
 Polygons TreeModelVolumes::calculateMachineBorderCollision(Polygon machine_border)
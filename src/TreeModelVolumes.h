@@ -4,6 +4,9 @@
 #ifndef TREEMODELVOLUMES_H
 #define TREEMODELVOLUMES_H
 
+#include <atomic>
+#include <memory> //For unique_ptr and shared_ptr.
+#include <mutex>
 #include <unordered_map>
 
 #include "settings/EnumSettings.h" //To store whether X/Y or Z distance gets priority.
@@ -20,7 +23,13 @@ class Settings;
 /*!
  * \brief Lazily generates tree guidance volumes.
  *
- * \warning This class is not currently thread-safe and should not be accessed in OpenMP blocks
+ * The volumes are computed once for each radius and layer and then cached. It
+ * is safe to request volumes from multiple threads at once.
+ *
+ * With a limit on the memory of the cache, the volumes are simplified to a
+ * tolerance that depends on the radius, and the ones that weren't used for the
+ * longest time are removed when the limit is exceeded. They are computed again
+ * if they are requested again.
  */
 class TreeModelVolumes
 {
@@ -54,9 +63,10 @@ public:
      *
      * \param radius The radius of the node of interest
      * \param layer The layer of interest
-     * \return Polygons object
+     * \return Polygons object. It is shared with the cache, which may forget
+     * it while it's still being used.
      */
-    const Polygons& getCollision(coord_t radius, LayerIndex layer_idx) const;
+    std::shared_ptr<const Polygons> getCollision(coord_t radius, LayerIndex layer_idx) const;
 
     /*!
      * \brief Creates the areas that have to be avoided by the tree's branches
@@ -70,9 +80,10 @@ public:
      *
      * \param radius The radius of the node of interest
      * \param layer The layer of interest
-     * \return Polygons object
+     * \return Polygons object. It is shared with the cache, which may forget
+     * it while it's still being used.
      */
-    const Polygons& getAvoidance(coord_t radius, LayerIndex layer_idx) const;
+    std::shared_ptr<const Polygons> getAvoidance(coord_t radius, LayerIndex layer_idx) const;
 
     /*!
      * \brief Generates the area of a given layer that must be avoided if the
@@ -83,9 +94,43 @@ public:
      *
      * \param radius The radius of the node of interest
      * \param layer The layer of interest
-     * \return Polygons object
+     * \return Polygons object. It is shared with the cache, which may forget
+     * it while it's still being used.
+     */
+    std::shared_ptr<const Polygons> getInternalModel(coord_t radius, LayerIndex layer_idx) const;
+
+    /*!
+     * \brief Compute the volumes for a number of radii on all layers in
+     * parallel, so that requesting them later is just a lookup.
+     *
+     * This does nothing if the memory of the cache is limited, since the
+     * volumes would only be removed again before they are used.
+     *
+     * \param radii The radii of the nodes that will be requested.
+     * \param include_avoidance Whether to compute the avoidance areas as well,
+     * or only the collision areas.
      */
-    const Polygons& getInternalModel(coord_t radius, LayerIndex layer_idx) const;
+    void precalculate(const std::vector<coord_t>& radii, const bool include_avoidance) const;
+
+    /*!
+     * \brief Compute the avoidance areas of many radii in parallel, each up to
+     * its own layer.
+     *
+     * The avoidance of a layer depends on the one below it with the same
+     * radius, so every radius is a chain from the bottom up. Otherwise the
+     * whole chain is computed by the thread that first asks for the top of
+     * it, while the others wait. This computes the collision areas of all
+     * chains in parallel first, then lets each thread walk up a different
+     * chain.
+     *
+     * Like \ref precalculate, this does nothing if the memory of the cache is
+     * limited.
+     *
+     * \param radius_layers For each radius that will be requested, the
+     * highest layer it will be requested on. Radii that round to the same
+     * sample get the highest of their layers.
+     */
+    void precalculateAvoidance(const std::vector<std::pair<coord_t, LayerIndex>>& radius_layers) const;
 
 private:
     /*!
@@ -93,6 +138,127 @@ private:
      */
     using RadiusLayerPair = std::pair<coord_t, LayerIndex>;
 
+    /*!
+     * \brief Hashes the keys to the caches.
+     */
+    struct RadiusLayerPairHash
+    {
+        size_t operator()(const RadiusLayerPair& key) const
+        {
+            return std::hash<coord_t>()(key.first) * 31 + std::hash<LayerIndex>()(key.second);
+        }
+    };
+
+    /*!
+     * \brief How much memory the caches may use together, and how much they
+     * use.
+     */
+    struct MemoryBudget
+    {
+        size_t limit; //!< How many bytes the volumes of all caches may take.
+        std::atomic<size_t> used { 0 }; //!< How many bytes the volumes of all caches take now.
+        std::atomic<uint64_t> clock { 0 }; //!< Counts the requests, to find the entries that weren't used for the longest time.
+        std::mutex eviction_mutex; //!< Makes sure that only one thread removes entries at a time.
+    };
+
+    /*!
+     * \brief A cache of volumes that can be used from multiple threads at
+     * once.
+     *
+     * The cache is divided into shards, each with its own lock, so that threads
+     * requesting different volumes rarely wait for each other. The lock is only
+     * held to find the entry of a key. Each volume is computed exactly once, by
+     * the first thread that requests it. Other threads requesting the same
+     * volume in the meanwhile wait for that computation to finish.
+     *
+     * Without a memory budget, entries are never removed. With one, each
+     * computed volume is counted in it, and \ref enforceMemoryBudget removes
+     * entries from all caches. The volumes are shared, so they stay valid for
+     * whoever still uses them.
+     */
+    class Cache
+    {
+    public:
+        /*!
+         * \param budget The memory that this cache shares with the other
+         * caches, or nullptr to keep all volumes.
+         */
+        Cache(MemoryBudget* budget = nullptr);
+
+        /*!
+         * \brief Get the volume for a key, computing it if it wasn't computed
+         * yet.
+         * \param key The radius and layer of the volume.
+         * \param compute A function that computes the volume for this key.
+         * \return The volume.
+         */
+        template<typename F>
+        std::shared_ptr<const Polygons> get(const RadiusLayerPair& key, const F& compute)
+        {
+            const std::shared_ptr<Entry> entry = getEntry(key);
+            bool is_computed_here = false;
+            std::call_once(entry->computed, [&entry, &compute, &is_computed_here]()
+            {
+                entry->volume = std::make_shared<const Polygons>(compute());
+                is_computed_here = true;
+            });
+            if (is_computed_here && budget)
+            {
+                addToBudget(*entry);
+            }
+            return entry->volume;
+        }
+
+        /*!
+         * \brief For each entry with a volume that is counted in the budget,
+         * when it was last requested.
+         * \param[out] last_uses The clock time of the last request and the
+         * key of each entry, added to the end.
+         */
+        void getLastUses(std::vector<std::pair<uint64_t, RadiusLayerPair>>& last_uses) const;
+
+        /*!
+         * \brief Forget the volume of a key, freeing its memory in the budget.
+         * \param key The radius and layer of the volume.
+         */
+        void remove(const RadiusLayerPair& key);
+
+    private:
+        /*!
+         * \brief The volume of one key and whether it has been computed yet.
+         */
+        struct Entry
+        {
+            std::once_flag computed;
+            std::shared_ptr<const Polygons> volume;
+            std::atomic<size_t> bytes { 0 }; //!< How much memory the volume takes, once it's computed and counted in the budget.
+            std::atomic<uint64_t> last_use { 0 }; //!< The time on the clock of the budget when the entry was last requested.
+        };
+
+        /*!
+         * \brief A part of the cache, guarded by its own lock.
+         */
+        struct Shard
+        {
+            std::mutex mutex;
+            std::unordered_map<RadiusLayerPair, std::shared_ptr<Entry>, RadiusLayerPairHash> entries;
+        };
+
+        static constexpr size_t shard_count = 64;
+        std::vector<std::unique_ptr<Shard>> shards;
+        MemoryBudget* budget; //!< The memory budget, or nullptr if the memory isn't limited.
+
+        /*!
+         * \brief Find the entry of a key, creating it if it doesn't exist yet.
+         */
+        std::shared_ptr<Entry> getEntry(const RadiusLayerPair& key);
+
+        /*!
+         * \brief Count a volume that was just computed in the budget.
+         */
+        void addToBudget(Entry& entry);
+    };
+
     /*!
      * \brief Round \p radius upwards to a multiple of radius_sample_resolution_
      *
@@ -106,7 +272,7 @@ private:
      *
      * \param key The radius and layer of the node of interest
      */
-    const Polygons& calculateCollision(const RadiusLayerPair& key) const;
+    Polygons calculateCollision(const RadiusLayerPair& key) const;
 
     /*!
      * \brief Calculate the avoidance areas at the radius and layer indicated
@@ -114,7 +280,7 @@ private:
      *
      * \param key The radius and layer of the node of interest
      */
-    const Polygons& calculateAvoidance(const RadiusLayerPair& key) const;
+    Polygons calculateAvoidance(const RadiusLayerPair& key) const;
 
     /*!
      * \brief Calculate the internal model areas at the radius and layer
@@ -122,7 +288,7 @@ private:
      *
      * \param key The radius and layer of the node of interest
      */
-    const Polygons& calculateInternalModel(const RadiusLayerPair& key) const;
+    Polygons calculateInternalModel(const RadiusLayerPair& key) const;
 
     /*!
      * \brief Calculate the collision area around the printable area of the machine.
@@ -131,6 +297,31 @@ private:
      */
     static Polygons calculateMachineBorderCollision(Polygon machine_border);
 
+    /*!
+     * \brief Reduce the resolution of a volume before it's cached, if the
+     * memory of the cache is limited.
+     *
+     * The volume is grown by the tolerance first, so that the simplified
+     * volume still covers all of it. The tolerance is at most half of the
+     * radius, the radius sample resolution and the maximum move, so that it
+     * stays smaller than the errors that the sampling already makes, and the
+     * avoidance doesn't keep growing from layer to layer.
+     * \param volume The volume to simplify.
+     * \param radius The radius of the volume.
+     * \return The simplified volume.
+     */
+    Polygons simplifyForCache(Polygons volume, const coord_t radius) const;
+
+    /*!
+     * \brief If the caches use more memory than the budget allows, remove
+     * the volumes that weren't requested for the longest time from them.
+     *
+     * A bit more is removed than needed, so that this doesn't happen for
+     * every new volume. If another thread is removing volumes already, this
+     * returns right away.
+     */
+    void enforceMemoryBudget() const;
+
     /*!
      * \brief Polygons representing the limits of the printable area of the
      * machine
@@ -183,6 +374,12 @@ private:
      */
     std::vector<Polygons> layer_outlines_;
 
+    /*!
+     * \brief The memory that the caches may use together, or nullptr if it's
+     * not limited.
+     */
+    std::unique_ptr<MemoryBudget> memory_budget_;
+
     /*!
      * \brief Caches for the collision, avoidance and internal model polygons
      * at given radius and layer indices.
@@ -192,9 +389,9 @@ private:
      * (ie there is no difference in behaviour for the user betweeen
      * calculating the values each time vs caching the results).
      */
-    mutable std::unordered_map<RadiusLayerPair, Polygons> collision_cache_;
-    mutable std::unordered_map<RadiusLayerPair, Polygons> avoidance_cache_;
-    mutable std::unordered_map<RadiusLayerPair, Polygons> internal_model_cache_;
+    mutable Cache collision_cache_;
+    mutable Cache avoidance_cache_;
+    mutable Cache internal_model_cache_;
 };
 
 }
@@ -11,15 +11,19 @@
 #include "settings/types/Angle.h" //Creating the correct branch angles.
 #include "settings/types/Ratio.h"
 #include "utils/algorithm.h"
+#include "utils/Cancellation.h"
 #include "utils/IntPoint.h" //To normalize vectors.
 #include "utils/logoutput.h"
 #include "utils/math.h" //For round_up_divide and PI.
 #include "utils/MinimumSpanningTree.h" //For connecting the correct nodes together to form an efficient tree.
 #include "utils/polygon.h" //For splitting polygons into parts.
 #include "utils/polygonUtils.h" //For moveInside.
+#include "utils/PreparedPolygons.h" //To check many candidates for collisions.
 #include "utils/Simplify.h" //Reduce the resolution of small branches.
+#include "utils/Trace.h"
 
 #include <mutex>
+#include <unordered_map>
 
 #define SQRT_2 1.4142135623730950488 //Square root of 2.
 #define CIRCLE_RESOLUTION 10 //The number of vertices in each circle.
@@ -40,6 +44,7 @@ TreeSupport::TreeSupport(const SliceDataStorage& storage)
 
 void TreeSupport::generateSupportAreas(SliceDataStorage& storage)
 {
+    TraceZone zone("tree support");
     const Settings& group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
     const bool global_use_tree_support =
         group_settings.get<bool>("support_enable")&&
@@ -65,21 +70,21 @@ void TreeSupport::generateSupportAreas(SliceDataStorage& storage)
         }
     }
 
+    //The collision without radius and the avoidance of the X/Y distance are needed on every layer, so compute them in parallel up front.
+    volumes_.precalculate({0}, false);
+    volumes_.precalculate({group_settings.get<coord_t>("support_xy_distance")}, true);
+
     //Drop nodes to lower layers.
     dropNodes(contact_nodes);
 
     //Generate support areas.
-    drawCircles(storage, contact_nodes);
-
-    for (auto& layer : contact_nodes)
+    if (!Cancellation::isRequested())
     {
-        for (Node* p_node : layer)
-        {
-            delete p_node;
-        }
-        layer.clear();
+        drawCircles(storage, contact_nodes);
     }
+
     contact_nodes.clear();
+    nodes_.clear(); //Release all nodes at once.
 
     storage.support.generated = true;
 }
@@ -101,26 +106,33 @@ void TreeSupport::drawCircles(SliceDataStorage& storage, const std::vector<std::
     const coord_t resolution = mesh_group_settings.get<coord_t>("support_tree_collision_resolution");
 
     size_t completed = 0; //To track progress, should be locked when altered.
-    std::mutex critical_section_volumes;
     std::mutex critical_section_progress;
+    constexpr coord_t branch_diameters_per_cell = 8; //Size of the cells in which the circles are unioned first, so that Clipper gets pre-merged circles.
+    const coord_t union_cell_size = 2 * branch_radius * branch_diameters_per_cell;
     cura::parallel_for<size_t>(0, contact_nodes.size(), 1, [&](const size_t layer_nr)
     {
         Polygons support_layer;
         Polygons& roof_layer = storage.support.supportLayers[layer_nr].support_roof;
 
-        //Draw the support areas and add the roofs appropriately to the support roof instead of normal areas.
-        for (const Node* p_node : contact_nodes[layer_nr])
+        //The shape of a circle only depends on the distance to the top and, in the tip, the skin direction. Many nodes share those, so compute each shape once.
+        std::unordered_map<size_t, Polygon> circle_per_shape;
+        const auto getCircleShape = [&](const Node& node) -> const Polygon&
         {
-            const Node& node = *p_node;
-
-            Polygon circle;
+            const bool in_tip = node.distance_to_top < tip_layers;
+            const size_t shape_key = node.distance_to_top * 2 + (in_tip && node.skin_direction ? 1 : 0);
+            auto [shape_it, is_new] = circle_per_shape.emplace(shape_key, Polygon());
+            if (!is_new)
+            {
+                return shape_it->second;
+            }
+            Polygon& shape = shape_it->second;
             //Scale linearly between branch radius and 1 line width.
             //At the tip we want to end up at 1 line width diameter so that the tip still prints if you have 1 support wall.
             const double ratio_to_tip = static_cast<double>(node.distance_to_top) / tip_layers;
             const double scale = (minimum_tip_radius + ratio_to_tip * (branch_radius - minimum_tip_radius)) / branch_radius;
             for (Point corner : branch_circle)
             {
-                if (node.distance_to_top < tip_layers) //We're in the tip.
+                if (in_tip) //We're in the tip.
                 {
                     const int mul = node.skin_direction ? 1 : -1;
                     corner = Point(corner.X * (0.5 + scale / 2) + mul * corner.Y * (0.5 - scale / 2),
@@ -130,26 +142,32 @@ void TreeSupport::drawCircles(SliceDataStorage& storage, const std::vector<std::
                 {
                     corner = corner * (1 + static_cast<double>(node.distance_to_top - tip_layers) * diameter_angle_scale_factor);
                 }
-                circle.add(node.position + corner);
+                shape.add(corner);
             }
+            return shape;
+        };
+
+        //Draw the support areas and add the roofs appropriately to the support roof instead of normal areas.
+        for (const Node* p_node : contact_nodes[layer_nr])
+        {
+            const Node& node = *p_node;
+
+            Polygon circle = getCircleShape(node);
+            circle.translate(node.position);
             if (node.support_roof_layers_below > 0)
             {
-                roof_layer.add(circle);
+                roof_layer.add(std::move(circle));
             }
             else
             {
-                support_layer.add(circle);
+                support_layer.add(std::move(circle));
             }
         }
-        support_layer = support_layer.unionPolygons();
-        roof_layer = roof_layer.unionPolygons();
+        support_layer = PolygonUtils::unionByCell(support_layer, union_cell_size);
+        roof_layer = PolygonUtils::unionByCell(roof_layer, union_cell_size);
         const size_t z_collision_layer = static_cast<size_t>(std::max(0, static_cast<int>(layer_nr) - static_cast<int>(z_distance_bottom_layers) + 1)); //Layer to test against to create a Z-distance.
-        {
-            const std::lock_guard<std::mutex> lock(critical_section_volumes);
-
-            support_layer = support_layer.difference(volumes_.getCollision(0, z_collision_layer)); //Subtract the model itself (sample 0 is with 0 diameter but proper X/Y offset).
-            roof_layer = roof_layer.difference(volumes_.getCollision(0, z_collision_layer));
-        }
+        support_layer = support_layer.difference(*volumes_.getCollision(0, z_collision_layer)); //Subtract the model itself (sample 0 is with 0 diameter but proper X/Y offset).
+        roof_layer = roof_layer.difference(*volumes_.getCollision(0, z_collision_layer));
         support_layer = support_layer.difference(roof_layer);
         //We smooth this support as much as possible without altering single circles. So we remove any line less than the side length of those circles.
         const double diameter_angle_scale_factor_this_layer = static_cast<double>(storage.support.supportLayers.size() - layer_nr - tip_layers) * diameter_angle_scale_factor; //Maximum scale factor.
@@ -190,7 +208,8 @@ void TreeSupport::drawCircles(SliceDataStorage& storage, const std::vector<std::
         {
             const std::lock_guard<std::mutex> lock(critical_section_progress);
 
-            if (!storage.support.supportLayers[layer_nr].support_infill_parts.empty() || !storage.support.supportLayers[layer_nr].support_roof.empty())
+            const SparseLayerVector<SupportLayer>& const_support_layers = storage.support.supportLayers; //Only reading, so that empty layers aren't allocated.
+            if (!const_support_layers[layer_nr].support_infill_parts.empty() || !const_support_layers[layer_nr].support_roof.empty())
             {
                 storage.support.layer_nr_max_filled_layer = std::max(storage.support.layer_nr_max_filled_layer, static_cast<int>(layer_nr));
             }
@@ -217,34 +236,73 @@ void TreeSupport::dropNodes(std::vector<std::vector<Node*>>& contact_nodes)
     const double diameter_angle_scale_factor = sin(mesh_group_settings.get<AngleRadians>("support_tree_branch_diameter_angle")) * layer_height / branch_radius; //Scale factor per layer to produce the desired angle.
     const coord_t radius_sample_resolution = mesh_group_settings.get<coord_t>("support_tree_collision_resolution");
     const bool support_rests_on_model = mesh_group_settings.get<ESupportType>("support_type") == ESupportType::EVERYWHERE;
+    //The radius of a branch on the layer below a node, which is used to avoid collisions there.
+    const std::function<coord_t (size_t)> getBranchRadiusBelow = [&](const size_t distance_to_top) -> coord_t
+    {
+        if ((distance_to_top + 1) > tip_layers)
+        {
+            return branch_radius + branch_radius * (distance_to_top + 1) * diameter_angle_scale_factor;
+        }
+        else
+        {
+            return branch_radius * (distance_to_top + 1) / tip_layers;
+        }
+    };
 
-    std::unordered_set<Node*> to_free_node_set;
+    //No node is further from the top than the highest contact point is above it, so that limits the radius of the avoidance on each layer.
+    size_t top_contact_layer_nr = 0;
+    for (size_t layer_nr = 0; layer_nr < contact_nodes.size(); layer_nr++)
+    {
+        if (! contact_nodes[layer_nr].empty())
+        {
+            top_contact_layer_nr = layer_nr;
+        }
+    }
+    std::vector<std::pair<coord_t, LayerIndex>> avoidance_radius_layers;
+    for (size_t layer_nr = 1; layer_nr <= top_contact_layer_nr; layer_nr++)
+    {
+        avoidance_radius_layers.emplace_back(getBranchRadiusBelow(top_contact_layer_nr - layer_nr), layer_nr - 1);
+    }
+    volumes_.precalculateAvoidance(avoidance_radius_layers);
 
     for (size_t layer_nr = contact_nodes.size() - 1; layer_nr > 0; layer_nr--) //Skip layer 0, since we can't drop down the vertices there.
     {
+        if (Cancellation::isRequested())
+        {
+            return; //The nodes are all released together, dropped or not.
+        }
         auto& layer_contact_nodes = contact_nodes[layer_nr];
         std::deque<std::pair<size_t, Node*>> unsupported_branch_leaves; // All nodes that are leaves on this layer that would result in unsupported ('mid-air') branches.
 
         //Group together all nodes for each part.
-        std::vector<PolygonsPart> parts = volumes_.getAvoidance(support_xy_distance, layer_nr).splitIntoParts();
+        std::vector<PolygonsPart> parts = volumes_.getAvoidance(support_xy_distance, layer_nr)->splitIntoParts();
         std::vector<std::unordered_map<Point, Node*>> nodes_per_part;
         nodes_per_part.emplace_back(); //All nodes that aren't inside a part get grouped together in the 0th part.
         for (size_t part_index = 0; part_index < parts.size(); part_index++)
         {
             nodes_per_part.emplace_back();
         }
-        for (Node* p_node : layer_contact_nodes)
+
+        /* Find which part each node is located in, in parallel. The nodes are
+         * grouped afterwards in their original order, so that the groups are
+         * the same as if this was done one node at a time.
+         */
+        constexpr size_t unsupported = -2; //Marks nodes that can't be supported at all.
+        std::vector<size_t> group_per_node(layer_contact_nodes.size());
+#pragma omp parallel for default(none) shared(layer_contact_nodes, group_per_node, parts, support_rests_on_model) schedule(dynamic)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int node_idx = 0; node_idx < static_cast<int>(layer_contact_nodes.size()); node_idx++)
         {
-            const Node& node = *p_node;
+            const Node& node = *layer_contact_nodes[node_idx];
 
             if (!support_rests_on_model && !node.to_buildplate) //Can't rest on model and unable to reach the build plate. Then we must drop the node and leave parts unsupported.
             {
-                unsupported_branch_leaves.push_front({ layer_nr, p_node });
+                group_per_node[node_idx] = unsupported;
                 continue;
             }
             if (node.to_buildplate || parts.empty()) //It's outside, so make it go towards the build plate.
             {
-                nodes_per_part[0][node.position] = p_node;
+                group_per_node[node_idx] = 0;
                 continue;
             }
             /* Find which part this node is located in and group the nodes in
@@ -276,27 +334,46 @@ void TreeSupport::dropNodes(std::vector<std::vector<Node*>>& contact_nodes)
                 }
             }
             //Put it in the best one.
-            nodes_per_part[closest_part + 1][node.position] = p_node; //Index + 1 because the 0th index is the outside part.
-
+            group_per_node[node_idx] = closest_part + 1; //Index + 1 because the 0th index is the outside part.
+        }
+        for (size_t node_idx = 0; node_idx < layer_contact_nodes.size(); node_idx++)
+        {
+            Node* p_node = layer_contact_nodes[node_idx];
+            if (group_per_node[node_idx] == unsupported)
+            {
+                unsupported_branch_leaves.push_front({ layer_nr, p_node });
+                continue;
+            }
+            nodes_per_part[group_per_node[node_idx]][p_node->position] = p_node;
         }
-        //Create a MST for every part.
-        std::vector<MinimumSpanningTree> spanning_trees;
-        for (const std::unordered_map<Point, Node*>& group : nodes_per_part)
+
+        /* Drop the nodes of every part in parallel. The parts don't share any
+         * nodes. The new nodes and unsupported leaves of each part are
+         * collected separately and then applied in the order of the parts, so
+         * that the result doesn't depend on the order in which the parts are
+         * processed.
+         */
+        std::vector<std::vector<Node>> dropped_per_part(nodes_per_part.size());
+        std::vector<std::vector<Node*>> unsupported_per_part(nodes_per_part.size());
+#pragma omp parallel for default(none) shared(nodes_per_part, dropped_per_part, unsupported_per_part, layer_nr, maximum_move_distance, tip_layers, branch_radius, diameter_angle_scale_factor, getBranchRadiusBelow, radius_sample_resolution, support_rests_on_model) schedule(dynamic)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int group_index = 0; group_index < static_cast<int>(nodes_per_part.size()); group_index++)
         {
+            std::unordered_map<Point, Node*>& group = nodes_per_part[group_index];
+            std::vector<Node>& dropped = dropped_per_part[group_index];
+            std::vector<Node*>& unsupported_leaves = unsupported_per_part[group_index];
+
+            //Create a MST for the part.
             std::vector<Point> points_to_buildplate;
             for (const std::pair<const Point, Node*>& entry : group)
             {
                 points_to_buildplate.emplace_back(entry.first); //Just the position of the node.
             }
-            spanning_trees.emplace_back(points_to_buildplate);
-        }
+            const MinimumSpanningTree mst(points_to_buildplate);
 
-        for (size_t group_index = 0; group_index < nodes_per_part.size(); group_index++)
-        {
-            const MinimumSpanningTree& mst = spanning_trees[group_index];
             //In the first pass, merge all nodes that are close together.
             std::unordered_set<Node*> to_delete;
-            for (const std::pair<const Point, Node*>& entry : nodes_per_part[group_index])
+            for (const std::pair<const Point, Node*>& entry : group)
             {
                 Node* p_node = entry.second;
                 Node& node = *p_node;
@@ -310,31 +387,20 @@ void TreeSupport::dropNodes(std::vector<std::vector<Node*>>& contact_nodes)
                     //Insert a completely new node and let both original nodes fade.
                     Point next_position = (node.position + neighbours[0]) / 2; //Average position of the two nodes.
 
-                    const coord_t branch_radius_node = [&]() -> coord_t
-                    {
-                        if ((node.distance_to_top + 1) > tip_layers)
-                        {
-                             return branch_radius + branch_radius * (node.distance_to_top + 1) * diameter_angle_scale_factor;
-                        }
-                        else
-                        {
-                             return branch_radius * (node.distance_to_top + 1) / tip_layers;
-                        }
-                    }();
+                    const coord_t branch_radius_node = getBranchRadiusBelow(node.distance_to_top);
 
                     //Avoid collisions.
                     constexpr size_t rounding_compensation = 100;
                     const coord_t maximum_move_between_samples = maximum_move_distance + radius_sample_resolution + rounding_compensation;
-                    const Polygons avoidance = group_index == 0 ? volumes_.getAvoidance(branch_radius_node, layer_nr - 1) : volumes_.getCollision(branch_radius_node, layer_nr - 1);
-                    PolygonUtils::moveOutside(avoidance, next_position, radius_sample_resolution + rounding_compensation, maximum_move_between_samples * maximum_move_between_samples);
+                    const std::shared_ptr<const Polygons> avoidance = group_index == 0 ? volumes_.getAvoidance(branch_radius_node, layer_nr - 1) : volumes_.getCollision(branch_radius_node, layer_nr - 1);
+                    PolygonUtils::moveOutside(*avoidance, next_position, radius_sample_resolution + rounding_compensation, maximum_move_between_samples * maximum_move_between_samples);
 
-                    Node* neighbour = nodes_per_part[group_index][neighbours[0]];
+                    Node* neighbour = group[neighbours[0]];
                     size_t new_distance_to_top = std::max(node.distance_to_top, neighbour->distance_to_top) + 1;
                     size_t new_support_roof_layers_below = std::max(node.support_roof_layers_below, neighbour->support_roof_layers_below) - 1;
 
-                    const bool to_buildplate = !volumes_.getAvoidance(branch_radius_node, layer_nr - 1).inside(next_position);
-                    Node* next_node = new Node(next_position, new_distance_to_top, node.skin_direction, new_support_roof_layers_below, to_buildplate, p_node);
-                    insertDroppedNode(contact_nodes[layer_nr - 1], next_node); //Insert the node, resolving conflicts of the two colliding nodes.
+                    const bool to_buildplate = !volumes_.getAvoidance(branch_radius_node, layer_nr - 1)->inside(next_position);
+                    dropped.emplace_back(next_position, new_distance_to_top, node.skin_direction, new_support_roof_layers_below, to_buildplate, p_node);
 
                     // Make sure the next pass doesn't drop down either of these (since that already happened).
                     node.merged_neighbours.push_front(neighbour);
@@ -348,7 +414,7 @@ void TreeSupport::dropNodes(std::vector<std::vector<Node*>>& contact_nodes)
                     {
                         if (vSize2(neighbour - node.position) < maximum_move_distance * maximum_move_distance)
                         {
-                            Node* neighbour_node = nodes_per_part[group_index][neighbour];
+                            Node* neighbour_node = group[neighbour];
                             node.distance_to_top = std::max(node.distance_to_top, neighbour_node->distance_to_top);
                             node.support_roof_layers_below = std::max(node.support_roof_layers_below, neighbour_node->support_roof_layers_below);
                             node.merged_neighbours.push_front(neighbour_node);
@@ -359,7 +425,7 @@ void TreeSupport::dropNodes(std::vector<std::vector<Node*>>& contact_nodes)
                 }
             }
             //In the second pass, move all middle nodes.
-            for (const std::pair<const Point, Node*>& entry : nodes_per_part[group_index])
+            for (const std::pair<const Point, Node*>& entry : group)
             {
                 Node* p_node = entry.second;
                 const Node& node = *p_node;
@@ -369,8 +435,8 @@ void TreeSupport::dropNodes(std::vector<std::vector<Node*>>& contact_nodes)
                 }
                 //If the branch falls completely inside a collision area (the entire branch would be removed by the X/Y offset), delete it.
 
-                const Polygons collision = volumes_.getCollision(0, layer_nr);
-                if (group_index > 0 && collision.inside(node.position))
+                const std::shared_ptr<const Polygons> collision = volumes_.getCollision(0, layer_nr);
+                if (group_index > 0 && collision->inside(node.position))
                 {
                     const coord_t branch_radius_node = [&]() -> coord_t
                     {
@@ -384,7 +450,7 @@ void TreeSupport::dropNodes(std::vector<std::vector<Node*>>& contact_nodes)
                         }
                     }();
 
-                    const ClosestPolygonPoint to_outside = PolygonUtils::findClosest(node.position, collision);
+                    const ClosestPolygonPoint to_outside = PolygonUtils::findClosest(node.position, *collision);
                     const bool node_is_tip = node.distance_to_top <= tip_layers;
                     coord_t max_inside_dist = branch_radius_node;
                     if (node_is_tip) {
@@ -395,7 +461,7 @@ void TreeSupport::dropNodes(std::vector<std::vector<Node*>>& contact_nodes)
                     {
                         if (! support_rests_on_model)
                         {
-                            unsupported_branch_leaves.push_front({ layer_nr, p_node });
+                            unsupported_leaves.push_back(p_node);
                         }
                         continue;
                     }
@@ -420,27 +486,29 @@ void TreeSupport::dropNodes(std::vector<std::vector<Node*>>& contact_nodes)
                     }
                 }
 
-                const coord_t branch_radius_node = [&]() -> coord_t
-                {
-                    if ((node.distance_to_top + 1) > tip_layers)
-                    {
-                        return branch_radius + branch_radius * (node.distance_to_top + 1) * diameter_angle_scale_factor;
-                    }
-                    else
-                    {
-                        return branch_radius * (node.distance_to_top + 1) / tip_layers;
-                    }
-                }();
+                const coord_t branch_radius_node = getBranchRadiusBelow(node.distance_to_top);
 
                 //Avoid collisions.
                 constexpr size_t rounding_compensation = 100;
                 const coord_t maximum_move_between_samples = maximum_move_distance + radius_sample_resolution + rounding_compensation;
-                const Polygons avoidance = group_index == 0 ? volumes_.getAvoidance(branch_radius_node, layer_nr - 1) : volumes_.getCollision(branch_radius_node, layer_nr - 1);
-                PolygonUtils::moveOutside(avoidance, next_layer_vertex, radius_sample_resolution + rounding_compensation, maximum_move_between_samples * maximum_move_between_samples);
+                const std::shared_ptr<const Polygons> avoidance = group_index == 0 ? volumes_.getAvoidance(branch_radius_node, layer_nr - 1) : volumes_.getCollision(branch_radius_node, layer_nr - 1);
+                PolygonUtils::moveOutside(*avoidance, next_layer_vertex, radius_sample_resolution + rounding_compensation, maximum_move_between_samples * maximum_move_between_samples);
+
+                const bool to_buildplate = !volumes_.getAvoidance(branch_radius_node, layer_nr - 1)->inside(next_layer_vertex);
+                dropped.emplace_back(next_layer_vertex, node.distance_to_top + 1, node.skin_direction, node.support_roof_layers_below - 1, to_buildplate, p_node);
+            }
+        }
 
-                const bool to_buildplate = !volumes_.getAvoidance(branch_radius_node, layer_nr - 1).inside(next_layer_vertex);
-                Node* next_node = new Node(next_layer_vertex, node.distance_to_top + 1, node.skin_direction, node.support_roof_layers_below - 1, to_buildplate, p_node);
-                insertDroppedNode(contact_nodes[layer_nr - 1], next_node);
+        //Apply the results of all parts in order.
+        for (size_t group_index = 0; group_index < nodes_per_part.size(); group_index++)
+        {
+            for (Node& dropped_node : dropped_per_part[group_index])
+            {
+                contact_nodes[layer_nr - 1].push_back(createNode(std::move(dropped_node))); //Every dropped node is new, so it can't already be in the layer.
+            }
+            for (Node* unsupported_leaf : unsupported_per_part[group_index])
+            {
+                unsupported_branch_leaves.push_front({ layer_nr, unsupported_leaf });
             }
         }
 
@@ -454,9 +522,7 @@ void TreeSupport::dropNodes(std::vector<std::vector<Node*>>& contact_nodes)
                 std::vector<Node*>::iterator to_erase = std::find(contact_nodes[i_layer].begin(), contact_nodes[i_layer].end(), i_node);
                 if (to_erase != contact_nodes[i_layer].end())
                 {
-                    to_free_node_set.insert(*to_erase);
-                    contact_nodes[i_layer].erase(to_erase);
-                    to_free_node_set.insert(i_node);
+                    contact_nodes[i_layer].erase(to_erase); //The node itself is released along with the node pool.
 
                     for (Node* neighbour : i_node->merged_neighbours)
                     {
@@ -470,12 +536,6 @@ void TreeSupport::dropNodes(std::vector<std::vector<Node*>>& contact_nodes)
         const double progress_total = contact_nodes.size() * PROGRESS_WEIGHT_DROPDOWN + contact_nodes.size() * PROGRESS_WEIGHT_AREAS;
         Progress::messageProgress(Progress::Stage::SUPPORT, progress_current, progress_total);
     }
-
-    for (Node *node : to_free_node_set)
-    {
-        delete node;
-    }
-    to_free_node_set.clear();
 }
 
 void TreeSupport::generateContactPoints(const SliceMeshStorage& mesh, std::vector<std::vector<TreeSupport::Node*>>& contact_nodes)
@@ -544,24 +604,53 @@ void TreeSupport::generateContactPoints(const SliceMeshStorage& mesh, std::vecto
         {
             continue;
         }
+        const PreparedPolygons collision(*volumes_.getCollision(0, layer_nr)); //Checked for many candidates.
 
         for (const ConstPolygonRef overhang_part : overhang)
         {
             AABB overhang_bounds(overhang_part); //Pre-generate the AABB for a quick pre-filter.
             overhang_bounds.expand(half_overhang_distance); //Allow for points to be within half an overhang step of the overhang area.
-            bool added = false; //Did we add a point this way?
-            for (Point candidate : grid_points)
+            std::vector<Point> candidates;
+            for (const Point& candidate : grid_points)
             {
                 if (overhang_bounds.contains(candidate))
                 {
-                    constexpr coord_t distance_inside = 1; //Move point towards the border of the polygon if it is closer than half the overhang distance: Catch points that fall between overhang areas on constant surfaces.
-                    PolygonUtils::moveInside(overhang_part, candidate, distance_inside, half_overhang_distance * half_overhang_distance);
-                    constexpr bool border_is_inside = true;
-                    if (overhang_part.inside(candidate, border_is_inside) && !volumes_.getCollision(0, layer_nr).inside(candidate, border_is_inside))
+                    candidates.push_back(candidate);
+                }
+            }
+            bool added = false; //Did we add a point this way?
+            if (! candidates.empty())
+            {
+                Polygons part;
+                part.add(overhang_part);
+                //Move point towards the border of the polygon if it is closer than half the overhang distance: Catch points that fall between overhang areas on constant surfaces.
+                //Only points near the border can be moved, so the grid of line segments finds the few that need the full search over the polygon.
+                constexpr coord_t distance_inside = 1;
+                constexpr coord_t rounding_margin = 2; //moveInside rounds the projections on the line segments.
+                const coord_t move_distance = std::max(half_overhang_distance, distance_inside) + rounding_margin;
+                const std::unique_ptr<LocToLineGrid> border = PolygonUtils::createLocToLineGrid(part, std::max(move_distance, point_spread));
+                for (Point& candidate : candidates)
+                {
+                    const bool near_border = ! border->processNearby(candidate, move_distance, [&candidate, move_distance](const PolygonsPointIndex& segment)
+                        {
+                            return LinearAlg2D::getDist2FromLineSegment(segment.p(), candidate, segment.next().p()) >= move_distance * move_distance;
+                        });
+                    if (near_border)
+                    {
+                        PolygonUtils::moveInside(overhang_part, candidate, distance_inside, half_overhang_distance * half_overhang_distance);
+                    }
+                }
+
+                constexpr bool border_is_inside = true;
+                const std::vector<bool> inside_overhang = PreparedPolygons(part).inside(candidates, border_is_inside);
+                const std::vector<bool> inside_collision = collision.inside(candidates, border_is_inside);
+                for (size_t candidate_idx = 0; candidate_idx < candidates.size(); candidate_idx++)
+                {
+                    if (inside_overhang[candidate_idx] && ! inside_collision[candidate_idx])
                     {
                         constexpr size_t distance_to_top = 0;
                         constexpr bool to_buildplate = true;
-                        Node* contact_node = new Node(candidate, distance_to_top, (layer_nr + z_distance_top_layers) % 2, support_roof_layers, to_buildplate, Node::NO_PARENT);
+                        Node* contact_node = createNode(Node(candidates[candidate_idx], distance_to_top, (layer_nr + z_distance_top_layers) % 2, support_roof_layers, to_buildplate, Node::NO_PARENT));
                         contact_nodes[layer_nr].emplace_back(contact_node);
                         added = true;
                     }
@@ -573,7 +662,7 @@ void TreeSupport::generateContactPoints(const SliceMeshStorage& mesh, std::vecto
                 PolygonUtils::moveInside(overhang_part, candidate);
                 constexpr size_t distance_to_top = 0;
                 constexpr bool to_buildplate = true;
-                Node* contact_node = new Node(candidate, distance_to_top, layer_nr % 2, support_roof_layers, to_buildplate, Node::NO_PARENT);
+                Node* contact_node = createNode(Node(candidate, distance_to_top, layer_nr % 2, support_roof_layers, to_buildplate, Node::NO_PARENT));
                 contact_nodes[layer_nr].emplace_back(contact_node);
             }
         }
@@ -581,34 +670,34 @@ void TreeSupport::generateContactPoints(const SliceMeshStorage& mesh, std::vecto
         {
             if (overhang_part.area() < 0)
             {
-                for (auto iter = contact_nodes[layer_nr].begin(); iter != contact_nodes[layer_nr].end(); )
+                std::vector<Node*>& layer_nodes = contact_nodes[layer_nr];
+                std::vector<Point> positions;
+                positions.reserve(layer_nodes.size());
+                for (const Node* node : layer_nodes)
                 {
-                    if (overhang_part.inside((*iter)->position))
-                    {
-                        iter = contact_nodes[layer_nr].erase(iter);
-                    }
-                    else
+                    positions.push_back(node->position);
+                }
+                Polygons hole;
+                hole.add(overhang_part);
+                const std::vector<bool> in_hole = PreparedPolygons(hole).inside(positions, false);
+                size_t kept_count = 0;
+                for (size_t node_idx = 0; node_idx < layer_nodes.size(); node_idx++)
+                {
+                    if (! in_hole[node_idx])
                     {
-                        ++iter;
+                        layer_nodes[kept_count++] = layer_nodes[node_idx];
                     }
                 }
+                layer_nodes.resize(kept_count);
             }
         }
     }
 }
 
-void TreeSupport::insertDroppedNode(std::vector<Node*>& nodes_layer, Node* p_node)
+TreeSupport::Node* TreeSupport::createNode(Node&& node)
 {
-    std::vector<Node*>::iterator conflicting_node_it = std::find(nodes_layer.begin(), nodes_layer.end(), p_node);
-    if (conflicting_node_it == nodes_layer.end()) //No conflict.
-    {
-        nodes_layer.emplace_back(p_node);
-        return;
-    }
-
-    Node* conflicting_node = *conflicting_node_it;
-    conflicting_node->distance_to_top = std::max(conflicting_node->distance_to_top, p_node->distance_to_top);
-    conflicting_node->support_roof_layers_below = std::max(conflicting_node->support_roof_layers_below, p_node->support_roof_layers_below);
+    nodes_.push_back(std::move(node));
+    return &nodes_.back();
 }
 
 } //namespace cura
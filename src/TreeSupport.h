@@ -4,6 +4,7 @@
 #ifndef TREESUPPORT_H
 #define TREESUPPORT_H
 
+#include <deque>
 #include <forward_list>
 #include <unordered_set>
 
@@ -135,11 +136,20 @@ private:
     /*!
      * \brief Generator for model collision, avoidance and internal guide volumes
      *
-     * Lazily computes volumes as needed.
-     *  \warning This class is NOT currently thread-safe and should not be accessed in OpenMP blocks
+     * Lazily computes volumes as needed. It is safe to use from multiple
+     * threads at once.
      */
     TreeModelVolumes volumes_;
 
+    /*!
+     * \brief All nodes of the tree.
+     *
+     * The nodes are allocated in bulk instead of one by one, and all released
+     * at once when the support areas are generated. A deque never moves its
+     * elements when it grows, so pointers to the nodes stay valid.
+     */
+    std::deque<Node> nodes_;
+
     /*!
      * \brief Draws circles around each node of the tree into the final support.
      *
@@ -182,11 +192,14 @@ private:
     void generateContactPoints(const SliceMeshStorage& mesh, std::vector<std::vector<Node*>>& contact_nodes);
 
     /*!
-     * \brief Add a node to the next layer.
+     * \brief Store a new node in the node pool.
      *
-     * If a node is already at that position in the layer, the nodes are merged.
+     * This must not be called from multiple threads at once.
+     * \param node The node to store.
+     * \return A pointer to the stored node. It stays valid until all nodes
+     * are released at the end of \ref generateSupportAreas.
      */
-    void insertDroppedNode(std::vector<Node*>& nodes_layer, Node* node);
+    Node* createNode(Node&& node);
 };
 
 }
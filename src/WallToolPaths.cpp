@@ -64,8 +64,7 @@ const std::vector<VariableWidthLines>& WallToolPaths::generate()
     prepared_outline.removeColinearEdges(AngleRadians(0.005));
     // Removing collinear edges may introduce self intersections, so we need to fix them again
     PolygonUtils::fixSelfIntersections(epsilon_offset, prepared_outline);
-    prepared_outline.removeDegenerateVerts();
-    prepared_outline.removeSmallAreas(small_area_length * small_area_length, false);
+    prepared_outline.removeDegenerateVertsAndSmallAreas(small_area_length * small_area_length, false);
 
     if (prepared_outline.area() <= 0)
     {
@@ -130,14 +129,17 @@ void WallToolPaths::stitchToolPaths(std::vector<VariableWidthLines>& toolpaths,
 {
     const coord_t stitch_distance = settings.get<coord_t>("wall_line_width_x") - 1; //In 0-width contours, junctions can cause up to 1-line-width gaps. Don't stitch more than 1 line width.
 
-    for (unsigned int wall_idx = 0; wall_idx < toolpaths.size(); wall_idx++)
+    //Each inset is stitched separately, so they can be stitched in parallel.
+#pragma omp parallel for default(none) shared(toolpaths, stitch_distance) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int wall_idx = 0; wall_idx < static_cast<int>(toolpaths.size()); wall_idx++)
     {
         VariableWidthLines& wall_lines = toolpaths[wall_idx];
         
         VariableWidthLines stitched_polylines;
         VariableWidthLines closed_polygons;
         PolylineStitcher<VariableWidthLines, ExtrusionLine, ExtrusionJunction>::stitch(wall_lines, stitched_polylines, closed_polygons, stitch_distance);
-        wall_lines = stitched_polylines; // replace input toolpaths with stitched polylines
+        wall_lines = std::move(stitched_polylines); // replace input toolpaths with stitched polylines
 
         for (ExtrusionLine& wall_polygon : closed_polygons)
         {
@@ -151,7 +153,7 @@ void WallToolPaths::stitchToolPaths(std::vector<VariableWidthLines>& toolpaths,
 #ifdef DEBUG
         for (ExtrusionLine& line : wall_lines)
         {
-            assert(line.inset_idx == wall_idx);
+            assert(line.inset_idx == static_cast<size_t>(wall_idx));
         }
 #endif // DEBUG
     }
@@ -159,17 +161,24 @@ void WallToolPaths::stitchToolPaths(std::vector<VariableWidthLines>& toolpaths,
 
 void WallToolPaths::removeSmallLines(std::vector<VariableWidthLines>& toolpaths)
 {
-    for (VariableWidthLines& inset : toolpaths)
+#pragma omp parallel for default(none) shared(toolpaths) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int inset_idx = 0; inset_idx < static_cast<int>(toolpaths.size()); inset_idx++)
     {
+        VariableWidthLines& inset = toolpaths[inset_idx];
         for (size_t line_idx = 0; line_idx < inset.size(); line_idx++)
         {
             ExtrusionLine& line = inset[line_idx];
+            if (! line.is_odd || line.is_closed)
+            {
+                continue; //Only open odd lines are removed, so don't look at the widths of the rest.
+            }
             coord_t min_width = std::numeric_limits<coord_t>::max();
             for (const ExtrusionJunction& j : line)
             {
                 min_width = std::min(min_width, j.w);
             }
-            if (line.is_odd && ! line.is_closed && shorterThan(line, min_width / 2))
+            if (shorterThan(line, min_width / 2))
             { // remove line
                 line = std::move(inset.back());
                 inset.erase(--inset.end());
@@ -182,12 +191,11 @@ void WallToolPaths::removeSmallLines(std::vector<VariableWidthLines>& toolpaths)
 void WallToolPaths::simplifyToolPaths(std::vector<VariableWidthLines>& toolpaths, const Settings& settings)
 {
     const Simplify simplifier(settings);
-    for(size_t toolpaths_idx = 0; toolpaths_idx < toolpaths.size(); ++toolpaths_idx)
+#pragma omp parallel for default(none) shared(toolpaths, simplifier) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int toolpaths_idx = 0; toolpaths_idx < static_cast<int>(toolpaths.size()); ++toolpaths_idx)
     {
-        for(ExtrusionLine& line : toolpaths[toolpaths_idx])
-        {
-            line = simplifier.polyline(line);
-        }
+        toolpaths[toolpaths_idx] = simplifier.polyline(toolpaths[toolpaths_idx]);
     }
 }
 
@@ -0,0 +1,62 @@
+// Copyright (c) 2022 Ultimaker B.V.
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "WallToolPathsCache.h"
+
+namespace cura
+{
+
+bool WallToolPathsCache::Parameters::operator==(const Parameters& other) const
+{
+    return bead_width_0 == other.bead_width_0
+        && bead_width_x == other.bead_width_x
+        && inset_count == other.inset_count
+        && wall_0_inset == other.wall_0_inset;
+}
+
+WallToolPathsCache::WallToolPathsCache(const size_t capacity)
+: entries(capacity)
+{
+}
+
+std::shared_ptr<const WallToolPathsCache::Result> WallToolPathsCache::find(const Polygons& outline, const Parameters& parameters) const
+{
+    return entries.find(hash(outline, parameters), [&outline, &parameters](const Key& key)
+    {
+        return key.parameters == parameters && key.outline.isSame(outline);
+    });
+}
+
+void WallToolPathsCache::insert(const Polygons& outline, const Parameters& parameters, std::shared_ptr<const Result> result)
+{
+    CompactPolygons compact_outline;
+    if (!compact_outline.compact(outline))
+    {
+        return;
+    }
+    entries.insert(hash(outline, parameters), Key{std::move(compact_outline), parameters}, std::move(result));
+}
+
+size_t WallToolPathsCache::hash(const Polygons& outline, const Parameters& parameters)
+{
+    size_t result = std::hash<coord_t>()(parameters.bead_width_0);
+    const auto combine = [&result](const size_t value)
+    {
+        result ^= value + 0x9e3779b97f4a7c15ull + (result << 6) + (result >> 2);
+    };
+    combine(std::hash<coord_t>()(parameters.bead_width_x));
+    combine(std::hash<size_t>()(parameters.inset_count));
+    combine(std::hash<coord_t>()(parameters.wall_0_inset));
+    for (ConstPolygonRef polygon : outline)
+    {
+        combine(polygon.size());
+        for (const Point& point : polygon)
+        {
+            combine(std::hash<coord_t>()(point.X));
+            combine(std::hash<coord_t>()(point.Y));
+        }
+    }
+    return result;
+}
+
+} // namespace cura
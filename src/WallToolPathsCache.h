@@ -0,0 +1,101 @@
+// Copyright (c) 2022 Ultimaker B.V.
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef CURAENGINE_WALLTOOLPATHSCACHE_H
+#define CURAENGINE_WALLTOOLPATHSCACHE_H
+
+#include <memory>
+
+#include "utils/BoundedCache.h"
+#include "utils/CompactPolygons.h"
+#include "utils/ExtrusionLine.h"
+#include "utils/polygon.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Remembers the wall toolpaths generated for part outlines, so that
+ * identical outlines don't need to go through the whole skeletal
+ * trapezoidation again.
+ *
+ * Prismatic models produce exactly the same outline on many layers. If the
+ * walls are generated with the same parameters, the toolpaths are the same
+ * too. The toolpaths are two-dimensional, so they can be reused on any layer.
+ *
+ * The cache is only valid for a single settings container, since the settings
+ * of the mesh influence the toolpaths as well. It is safe to use from multiple
+ * threads at once.
+ */
+class WallToolPathsCache
+{
+public:
+    /*!
+     * \brief The parameters of the wall generation that can differ per layer.
+     */
+    struct Parameters
+    {
+        coord_t bead_width_0;
+        coord_t bead_width_x;
+        size_t inset_count;
+        coord_t wall_0_inset;
+
+        bool operator==(const Parameters& other) const;
+    };
+
+    /*!
+     * \brief The walls that were generated for an outline.
+     */
+    struct Result
+    {
+        std::vector<VariableWidthLines> toolpaths;
+        Polygons inner_contour;
+    };
+
+    /*!
+     * \param capacity The maximum number of outlines to remember. When more
+     * are added, the ones that were added first are forgotten.
+     */
+    WallToolPathsCache(const size_t capacity = 256);
+
+    /*!
+     * \brief Find the walls that were generated earlier for an outline.
+     * \param outline The outline of the part.
+     * \param parameters The parameters with which the walls are generated.
+     * \return The walls, or ``nullptr`` if this outline is not known with this
+     * set of parameters.
+     */
+    std::shared_ptr<const Result> find(const Polygons& outline, const Parameters& parameters) const;
+
+    /*!
+     * \brief Remember the walls generated for an outline.
+     *
+     * Outlines that are too large to store in compact form are not remembered.
+     * \param outline The outline of the part.
+     * \param parameters The parameters with which the walls were generated.
+     * \param result The generated walls.
+     */
+    void insert(const Polygons& outline, const Parameters& parameters, std::shared_ptr<const Result> result);
+
+private:
+    /*!
+     * \brief What the walls were generated for, to compare with the outlines
+     * that are looked up.
+     */
+    struct Key
+    {
+        CompactPolygons outline;
+        Parameters parameters;
+    };
+
+    /*!
+     * Hash the content of an outline along with the parameters.
+     */
+    static size_t hash(const Polygons& outline, const Parameters& parameters);
+
+    BoundedCache<Key, std::shared_ptr<const Result>> entries; //!< The known outlines.
+};
+
+} // namespace cura
+
+#endif // CURAENGINE_WALLTOOLPATHSCACHE_H
@@ -6,6 +6,7 @@
 #include "WallsComputation.h"
 #include "settings/types/Ratio.h"
 #include "WallToolPaths.h"
+#include "WallToolPathsCache.h"
 #include "utils/polygonUtils.h"
 #include "utils/Simplify.h" //We're simplifying the spiralized insets.
 #include "Application.h"
@@ -13,9 +14,10 @@
 
 namespace cura {
 
-WallsComputation::WallsComputation(const Settings& settings, const LayerIndex layer_nr)
+WallsComputation::WallsComputation(const Settings& settings, const LayerIndex layer_nr, WallToolPathsCache* cache)
 : settings(settings)
 , layer_nr(layer_nr)
+, cache(cache)
 {
 }
 
@@ -70,9 +72,23 @@ void WallsComputation::generateWalls(SliceLayerPart* part)
     }
     else
     {
-        WallToolPaths wall_tool_paths(part->outline, line_width_0, line_width_x, wall_count, wall_0_inset, settings);
-        part->wall_toolpaths = wall_tool_paths.getToolPaths();
-        part->inner_area = wall_tool_paths.getInnerContour();
+        const WallToolPathsCache::Parameters parameters { line_width_0, line_width_x, wall_count, wall_0_inset };
+        std::shared_ptr<const WallToolPathsCache::Result> cached = cache ? cache->find(part->outline, parameters) : nullptr;
+        if (cached)
+        {
+            part->wall_toolpaths = cached->toolpaths;
+            part->inner_area = cached->inner_contour;
+        }
+        else
+        {
+            WallToolPaths wall_tool_paths(part->outline, line_width_0, line_width_x, wall_count, wall_0_inset, settings);
+            part->wall_toolpaths = wall_tool_paths.getToolPaths();
+            part->inner_area = wall_tool_paths.getInnerContour();
+            if (cache)
+            {
+                cache->insert(part->outline, parameters, std::make_shared<const WallToolPathsCache::Result>(WallToolPathsCache::Result{part->wall_toolpaths, part->inner_area}));
+            }
+        }
     }
     part->print_outline = part->outline;
 }
@@ -89,7 +105,11 @@ void WallsComputation::generateWalls(SliceLayer* layer)
     {
         generateWalls(&part);
     }
+    removePartsWithoutWalls(layer);
+}
 
+void WallsComputation::removePartsWithoutWalls(SliceLayer* layer)
+{
     //Remove the parts which did not generate a wall. As these parts are too small to print,
     // and later code can now assume that there is always minimal 1 wall line.
     if(settings.get<size_t>("wall_line_count") >= 1 && !settings.get<bool>("fill_outline_gaps"))
@@ -12,6 +12,7 @@ namespace cura
 
 class SliceLayer;
 class SliceLayerPart;
+class WallToolPathsCache;
 
 /*!
  * Function container for computing the outer walls / insets / perimeters polygons of a layer
@@ -25,8 +26,10 @@ public:
      *
      * \param settings The per-mesh settings object to get setting values from.
      * \param layer_nr The layer index that these walls are generated for.
+     * \param cache Optionally, the walls generated for earlier outlines with
+     * the same settings, to reuse for identical outlines.
      */
-    WallsComputation(const Settings& settings, const LayerIndex layer_nr);
+    WallsComputation(const Settings& settings, const LayerIndex layer_nr, WallToolPathsCache* cache = nullptr);
 
     /*!
      * \brief Generates the walls / inner area for all parts in a layer.
@@ -37,6 +40,26 @@ public:
      */ 
     void generateWalls(SliceLayer* layer);
 
+    /*!
+     * Generates the walls / inner area for a single layer part.
+     *
+     * Parts are independent of each other, so the parts of a layer may be
+     * processed concurrently. Call \ref removePartsWithoutWalls afterwards.
+     *
+     * \param part The part for which to generate the insets.
+     */
+    void generateWalls(SliceLayerPart* part);
+
+    /*!
+     * \brief Remove the parts of a layer that did not get any walls.
+     *
+     * These parts are too small to print, and later code can assume that there
+     * is always at least one wall line.
+     *
+     * \param layer The layer of which the walls have been generated.
+     */
+    void removePartsWithoutWalls(SliceLayer* layer);
+
 private:
     /*!
      * \brief Settings container to get my settings from.
@@ -51,11 +74,9 @@ private:
     const LayerIndex layer_nr;
 
     /*!
-     * Generates the walls / inner area for a single layer part.
-     *
-     * \param part The part for which to generate the insets.
+     * \brief The walls generated for earlier outlines, if any.
      */
-    void generateWalls(SliceLayerPart* part);
+    WallToolPathsCache* cache;
 
     /*!
      * Generates the outer inset / perimeter used in spiralize mode for a single layer part. The spiral inset is
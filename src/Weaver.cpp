@@ -4,6 +4,10 @@
 #include <cmath> // sqrt
 #include <fstream> // debug IO
 
+#ifdef _OPENMP
+    #include <omp.h>
+#endif // _OPENMP
+
 #include "Application.h" //To get the communication channel.
 #include "PrintFeature.h"
 #include "Slice.h"
@@ -11,6 +15,7 @@
 #include "Weaver.h"
 #include "communication/Communication.h" //To send layer view data.
 #include "progress/Progress.h"
+#include "utils/IndexedPolygons.h" //To find the closest points on the layer below quickly.
 #include "utils/logoutput.h"
 #include "settings/AdaptiveLayerHeights.h"
 #include "settings/types/Angle.h"
@@ -120,16 +125,35 @@ void Weaver::weave(MeshGroup* meshgroup)
     log("Finding horizontal parts...\n");
     {
         Progress::messageProgressStage(Progress::Stage::SUPPORT, nullptr);
-        for (unsigned int layer_idx = 0; layer_idx < wireFrame.layers.size(); layer_idx++)
+        // The horizontal parts of each layer only depend on the chainified polygons of this layer and the one above, so all layers can be filled at once.
+        std::vector<WeaveLayer>& layers = wireFrame.layers;
+        size_t processed_layer_count = 0;
+#pragma omp parallel for default(none) shared(layers, processed_layer_count) schedule(dynamic)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int layer_idx = 0; layer_idx < static_cast<int>(layers.size()); layer_idx++)
         {
-            Progress::messageProgress(Progress::Stage::SUPPORT, layer_idx+1, wireFrame.layers.size()); // abuse the progress system of the normal mode of CuraEngine
-            
-            WeaveLayer& layer = wireFrame.layers[layer_idx];
+            WeaveLayer& layer = layers[layer_idx];
             
             Polygons empty;
-            Polygons& layer_above = (layer_idx+1 < wireFrame.layers.size())? wireFrame.layers[layer_idx+1].supported : empty;
+            Polygons& layer_above = (layer_idx + 1 < static_cast<int>(layers.size()))? layers[layer_idx + 1].supported : empty;
             
             createHorizontalFill(layer, layer_above);
+
+#ifdef _OPENMP
+            if (omp_get_thread_num() == 0)
+#endif
+            { // progress is only sent from one thread so that no two threads message progress at the same time
+                size_t _processed_layer_count;
+#if _OPENMP < 201107
+#pragma omp critical
+#else
+#pragma omp atomic read
+#endif
+                _processed_layer_count = processed_layer_count;
+                Progress::messageProgress(Progress::Stage::SUPPORT, _processed_layer_count + 1, layers.size()); // abuse the progress system of the normal mode of CuraEngine
+            }
+#pragma omp atomic
+            processed_layer_count++;
         }
     }
     // at this point layer.supported still only contains the polygons to be connected
@@ -137,17 +161,30 @@ void Weaver::weave(MeshGroup* meshgroup)
 
     log("Connecting layers...\n");
     {
-        Polygons* lower_top_parts = &wireFrame.bottom_outline;
-        int last_z = wireFrame.z_bottom;
-        for (unsigned int layer_idx = 0; layer_idx < wireFrame.layers.size(); layer_idx++) // use top of every layer but the last
+        // Each layer is connected to the polygons of the layer below and the roofs of that layer, which are only read here. So all layers can be connected at once, before the roofs are added to the polygons that each layer supports.
+        std::vector<WeaveLayer>& layers = wireFrame.layers;
+        const Polygons& bottom_outline = wireFrame.bottom_outline;
+        const int z_bottom = wireFrame.z_bottom;
+#pragma omp parallel for default(none) shared(layers, bottom_outline, z_bottom) schedule(dynamic)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int layer_idx = 0; layer_idx < static_cast<int>(layers.size()); layer_idx++) // use top of every layer but the last
+        {
+            WeaveLayer& layer = layers[layer_idx];
+            if (layer_idx == 0)
+            {
+                connect_polygons(bottom_outline, z_bottom, layer.supported, layer.z1, layer);
+            }
+            else
+            {
+                const WeaveLayer& layer_below = layers[layer_idx - 1];
+                Polygons lower_top_parts = layer_below.supported;
+                lower_top_parts.add(layer_below.roofs.roof_outlines);
+                connect_polygons(lower_top_parts, layer_below.z1, layer.supported, layer.z1, layer);
+            }
+        }
+        for (WeaveLayer& layer : layers)
         {
-            WeaveLayer& layer = wireFrame.layers[layer_idx];
-            
-            connect_polygons(*lower_top_parts, last_z, layer.supported, layer.z1, layer);
             layer.supported.add(layer.roofs.roof_outlines);
-            lower_top_parts = &layer.supported;
-            
-            last_z = layer.z1;
         }
     }
 
@@ -442,7 +479,7 @@ void Weaver::chainify_polygons(Polygons& parts1, Point start_close_to, Polygons&
 }
 
 
-void Weaver::connect_polygons(Polygons& supporting, int z0, Polygons& supported, int z1, WeaveConnection& result)
+void Weaver::connect_polygons(const Polygons& supporting, int z0, const Polygons& supported, int z1, WeaveConnection& result)
 {
  
     if (supporting.size() < 1)
@@ -455,6 +492,7 @@ void Weaver::connect_polygons(Polygons& supporting, int z0, Polygons& supported,
     result.z1 = z1;
     
     std::vector<WeaveConnectionPart>& parts = result.connections;
+    const IndexedPolygons supporting_index(supporting); // every point of the supported polygons is connected to its closest point on the supporting polygons
         
     for (unsigned int prt = 0 ; prt < supported.size(); prt++)
     {
@@ -472,7 +510,7 @@ void Weaver::connect_polygons(Polygons& supporting, int z0, Polygons& supported,
         for (const Point& upper_point : upperPart)
         {
             
-            ClosestPolygonPoint lowerPolyPoint = PolygonUtils::findClosest(upper_point, supporting);
+            ClosestPolygonPoint lowerPolyPoint = supporting_index.findClosest(upper_point);
             Point& lower = lowerPolyPoint.location;
             
             Point3 lower3 = Point3(lower.X, lower.Y, z0);
@@ -68,7 +68,7 @@ private:
  * \param z1 the height of \p supported
  * \param result The resulting connection
  */
-    void connect_polygons(Polygons& supporting, int z0, Polygons& supported, int z1, WeaveConnection& result);
+    void connect_polygons(const Polygons& supporting, int z0, const Polygons& supported, int z1, WeaveConnection& result);
 
 /*!
  * Creates the roofs and floors which are laid down horizontally.
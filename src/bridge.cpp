@@ -19,34 +19,19 @@ int bridgeAngle(const Settings& settings, const Polygons& skin_outline, const Sl
     // This gives us the islands that the layer rests on.
     Polygons islands;
 
-    Polygons prev_layer_outline; // we also want the complete outline of the previous layer
+    Polygons prev_layer_support; // the support on the previous layer, not intersected with the skin
 
     const Ratio sparse_infill_max_density = settings.get<Ratio>("bridge_sparse_infill_max_density");
 
     // include parts from all meshes
-    for (const SliceMeshStorage& mesh : storage.meshes)
+    const bool exclude_sparse_infill = bridge_layer == 1;
+    const std::vector<SliceDataStorage::BridgeRestingArea>& prev_layer_areas = storage.getBridgeRestingAreas(layer_nr - bridge_layer, exclude_sparse_infill, sparse_infill_max_density);
+    for (const SliceDataStorage::BridgeRestingArea& prev_layer_area : prev_layer_areas)
     {
-        if (mesh.isPrinted())
-        {
-            const coord_t infill_line_distance = mesh.settings.get<coord_t>("infill_line_distance");
-            const coord_t infill_line_width = mesh.settings.get<coord_t>("infill_line_width");
-            const bool part_has_sparse_infill = (infill_line_distance == 0) || ((float)infill_line_width / infill_line_distance) <= sparse_infill_max_density;
-
-            for (const SliceLayerPart& prev_layer_part : mesh.layers[layer_nr - bridge_layer].parts)
-            {
-                Polygons solid_below(prev_layer_part.outline);
-                if (bridge_layer == 1 && part_has_sparse_infill)
-                {
-                    solid_below = solid_below.difference(prev_layer_part.getOwnInfillArea());
-                }
-                prev_layer_outline.add(solid_below); // not intersected with skin
-
-                if (!boundary_box.hit(prev_layer_part.boundaryBox))
-                    continue;
+        if (!boundary_box.hit(prev_layer_area.part->boundaryBox))
+            continue;
 
-                islands.add(skin_outline.intersection(solid_below));
-            }
-        }
+        islands.add(skin_outline.intersection(prev_layer_area.getArea()));
     }
     supported_regions = islands;
 
@@ -63,7 +48,7 @@ int bridgeAngle(const Settings& settings, const Polygons& skin_outline, const Sl
             AABB support_roof_bb(support_layer->support_roof);
             if (boundary_box.hit(support_roof_bb))
             {
-                prev_layer_outline.add(support_layer->support_roof); // not intersected with skin
+                prev_layer_support.add(support_layer->support_roof);
 
                 Polygons supported_skin(skin_outline.intersection(support_layer->support_roof));
                 if (!supported_skin.empty())
@@ -79,7 +64,7 @@ int bridgeAngle(const Settings& settings, const Polygons& skin_outline, const Sl
                 AABB support_part_bb(support_part.getInfillArea());
                 if (boundary_box.hit(support_part_bb))
                 {
-                    prev_layer_outline.add(support_part.getInfillArea()); // not intersected with skin
+                    prev_layer_support.add(support_part.getInfillArea());
 
                     Polygons supported_skin(skin_outline.intersection(support_part.getInfillArea()));
                     if (!supported_skin.empty())
@@ -109,6 +94,19 @@ int bridgeAngle(const Settings& settings, const Polygons& skin_outline, const Sl
         // the air boundary do appear to be supported
 
         const int bb_max_dim = std::max(boundary_box.max.X - boundary_box.min.X, boundary_box.max.Y - boundary_box.min.Y);
+
+        // the parts of the previous layer that are entirely outside of that region don't change it
+        AABB air_below_bb(boundary_box);
+        air_below_bb.expand(bb_max_dim + 10);
+        Polygons prev_layer_outline;
+        for (const SliceDataStorage::BridgeRestingArea& prev_layer_area : prev_layer_areas)
+        {
+            if (air_below_bb.hit(prev_layer_area.part->boundaryBox))
+            {
+                prev_layer_outline.add(prev_layer_area.getArea());
+            }
+        }
+        prev_layer_outline.add(prev_layer_support);
         const Polygons air_below(bb_poly.offset(bb_max_dim).difference(prev_layer_outline).offset(-10));
 
         Polygons skin_perimeter_lines;
@@ -3,8 +3,9 @@
 
 #ifdef ARCUS
 
+#include <algorithm> //For std::transform.
 #include <Arcus/Socket.h> //The socket to communicate to.
-#include <thread> //To sleep while waiting for the connection.
+#include <cmath> //For std::round.
 #include <unordered_map> //To map settings to their extruder numbers for limit_to_extruder.
 
 #include "ArcusCommunication.h"
@@ -16,9 +17,13 @@
 #include "../FffProcessor.h" //To start a slice.
 #include "../PrintFeature.h"
 #include "../Slice.h" //To process slices.
+#include "../progress/Progress.h" //To get the statistics of the stages.
 #include "../settings/types/LayerIndex.h" //To point to layers.
 #include "../settings/types/Velocity.h" //To send to layer view how fast stuff is printing.
+#include "../utils/Cancellation.h" //To stop slicing when a newer slice arrives.
+#include "../utils/gettime.h" //To send the statistics at most once per second.
 #include "../utils/logoutput.h"
+#include "../utils/MemoryUsage.h" //To send the peak memory use.
 #include "../utils/polygon.h"
 
 namespace cura
@@ -43,13 +48,19 @@ class ArcusCommunication::PathCompiler
     PointType data_point_type;
 
     std::vector<PrintFeatureType> line_types; //!< Line types for the line segments stored, the size of this vector is N.
-    std::vector<float> line_widths; //!< Line widths for the line segments stored, the size of this vector is N.
-    std::vector<float> line_thicknesses; //!< Line thicknesses for the line segments stored, the size of this vector is N.
-    std::vector<float> line_velocities; //!< Line feedrates for the line segments stored, the size of this vector is N.
-    std::vector<float> points; //!< The points used to define the line segments, the size of this vector is D*(N+1) as each line segment is defined from one point to the next. D is the dimensionality of the point.
+    std::vector<coord_t> line_widths; //!< Line widths for the line segments stored, the size of this vector is N.
+    std::vector<coord_t> line_thicknesses; //!< Line thicknesses for the line segments stored, the size of this vector is N.
+    std::vector<Velocity> line_velocities; //!< Line feedrates for the line segments stored, the size of this vector is N.
+    std::vector<Point> points; //!< The points used to define the line segments, the size of this vector is N+1 as each line segment is defined from one point to the next.
+    size_t unsent_layer_bytes; //!< How much layer data was flushed to the message of the current layer since that message was last sent.
+
+    std::vector<float> float_buffer; //!< Reused to convert the buffers to the float arrays of the message.
+    std::string encode_buffer; //!< Reused to encode the buffers in the compact encoding of the message.
 
     Point last_point;
 
+    static constexpr size_t bytes_per_line_segment = sizeof(PrintFeatureType) + 3 * sizeof(float) + 2 * sizeof(float); //!< Type, width, thickness and feedrate, plus a 2D point.
+
     PathCompiler(const PathCompiler&) = delete;
     PathCompiler& operator=(const PathCompiler&) = delete;
 public:
@@ -66,6 +77,9 @@ public:
         line_thicknesses(),
         line_velocities(),
         points(),
+        unsent_layer_bytes(0),
+        float_buffer(),
+        encode_buffer(),
         last_point{0,0}
     {}
 
@@ -91,6 +105,7 @@ public:
         {
             flushPathSegments();
             _layer_nr = new_layer_nr;
+            unsent_layer_bytes = 0;
         }
     }
 
@@ -151,30 +166,29 @@ public:
         path_segment->set_extruder(extruder);
         path_segment->set_point_type(data_point_type);
 
-        std::string line_type_data;
-        line_type_data.append(reinterpret_cast<const char*>(line_types.data()), line_types.size() * sizeof(PrintFeatureType));
+        //Copy the buffers straight into the message, without an intermediate string.
+        path_segment->set_line_type(reinterpret_cast<const char*>(line_types.data()), line_types.size() * sizeof(PrintFeatureType));
+        if (_cs_private_data.compact_layer_view)
+        {
+            unsent_layer_bytes += line_types.size() * sizeof(PrintFeatureType) + setCompactFields(*path_segment);
+        }
+        else
+        {
+            setFloatFields(*path_segment);
+            unsent_layer_bytes += line_types.size() * bytes_per_line_segment;
+        }
         line_types.clear();
-        path_segment->set_line_type(line_type_data);
-
-        std::string polygon_data;
-        polygon_data.append(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(float));
         points.clear();
-        path_segment->set_points(polygon_data);
-
-        std::string line_width_data;
-        line_width_data.append(reinterpret_cast<const char*>(line_widths.data()), line_widths.size() * sizeof(float));
         line_widths.clear();
-        path_segment->set_line_width(line_width_data);
-
-        std::string line_thickness_data;
-        line_thickness_data.append(reinterpret_cast<const char*>(line_thicknesses.data()), line_thicknesses.size() * sizeof(float));
         line_thicknesses.clear();
-        path_segment->set_line_thickness(line_thickness_data);
-
-        std::string line_velocity_data;
-        line_velocity_data.append(reinterpret_cast<const char*>(line_velocities.data()), line_velocities.size() * sizeof(float));
         line_velocities.clear();
-        path_segment->set_line_feedrate(line_velocity_data);
+
+        //Send large layers in parts, so that the front-end can start showing them and the data doesn't pile up in memory here.
+        if (unsent_layer_bytes >= _cs_private_data.layer_view_chunk_size)
+        {
+            _cs_private_data.sendOptimizedLayerPart(_layer_nr);
+            unsent_layer_bytes = 0;
+        }
     }
 
     /*!
@@ -244,18 +258,123 @@ public:
 
 private:
     /*!
-     * \brief Convert and add a point to the points buffer.
+     * \brief Add a point to the points buffer.
      *
-     * Each point is represented as two consecutive floats. All members adding a
-     * 2D point to the data should use this function.
+     * All members adding a 2D point to the data should use this function.
      */
     void addPoint2D(const Point& point)
     {
-        points.push_back(INT2MM(point.X));
-        points.push_back(INT2MM(point.Y));
+        points.push_back(point);
         last_point = point;
     }
 
+    /*!
+     * \brief Fill in the points, widths, thicknesses and feedrates of a path
+     * segment as float arrays, in millimetres and millimetres per second.
+     */
+    void setFloatFields(proto::PathSegment& path_segment)
+    {
+        float_buffer.clear();
+        for (const Point& point : points)
+        {
+            float_buffer.push_back(INT2MM(point.X));
+            float_buffer.push_back(INT2MM(point.Y));
+        }
+        path_segment.set_points(reinterpret_cast<const char*>(float_buffer.data()), float_buffer.size() * sizeof(float));
+        float_buffer.assign(line_widths.size(), 0.0f);
+        std::transform(line_widths.begin(), line_widths.end(), float_buffer.begin(), [](const coord_t width) { return INT2MM(width); });
+        path_segment.set_line_width(reinterpret_cast<const char*>(float_buffer.data()), float_buffer.size() * sizeof(float));
+        std::transform(line_thicknesses.begin(), line_thicknesses.end(), float_buffer.begin(), [](const coord_t thickness) { return INT2MM(thickness); });
+        path_segment.set_line_thickness(reinterpret_cast<const char*>(float_buffer.data()), float_buffer.size() * sizeof(float));
+        std::transform(line_velocities.begin(), line_velocities.end(), float_buffer.begin(), [](const Velocity& velocity) { return velocity; });
+        path_segment.set_line_feedrate(reinterpret_cast<const char*>(float_buffer.data()), float_buffer.size() * sizeof(float));
+    }
+
+    /*!
+     * \brief Fill in the points, widths, thicknesses and feedrates of a path
+     * segment in the compact encoding.
+     *
+     * Points are sent as the differences between consecutive points in microns,
+     * which mostly fit in one or two bytes. Widths, thicknesses and feedrates
+     * mostly stay the same for many line segments, so only the runs of equal
+     * values are sent.
+     * \return The number of bytes of the encoded fields.
+     */
+    size_t setCompactFields(proto::PathSegment& path_segment)
+    {
+        size_t byte_count = 0;
+        encode_buffer.clear();
+        Point previous_point(0, 0);
+        for (const Point& point : points)
+        {
+            appendVarint(zigzag(point.X - previous_point.X));
+            appendVarint(zigzag(point.Y - previous_point.Y));
+            previous_point = point;
+        }
+        byte_count += encode_buffer.size();
+        path_segment.set_points_delta(encode_buffer);
+
+        encodeRuns(line_widths, [](const coord_t width) { return static_cast<uint64_t>(std::max(coord_t(0), width)); });
+        byte_count += encode_buffer.size();
+        path_segment.set_line_width_runs(encode_buffer);
+        encodeRuns(line_thicknesses, [](const coord_t thickness) { return static_cast<uint64_t>(std::max(coord_t(0), thickness)); });
+        byte_count += encode_buffer.size();
+        path_segment.set_line_thickness_runs(encode_buffer);
+        encodeRuns(line_velocities, [](const Velocity& velocity) { return static_cast<uint64_t>(std::max(0.0, std::round(static_cast<double>(velocity) * 1000.0))); }); //In microns per second.
+        byte_count += encode_buffer.size();
+        path_segment.set_line_feedrate_runs(encode_buffer);
+        return byte_count;
+    }
+
+    /*!
+     * \brief Replace the contents of the encode buffer with the runs of equal
+     * values in a buffer, each as the length of the run followed by the value.
+     * \param values The values to encode.
+     * \param quantize Converts a value to the unsigned integer that is sent.
+     */
+    template<typename T, typename Quantize>
+    void encodeRuns(const std::vector<T>& values, const Quantize& quantize)
+    {
+        encode_buffer.clear();
+        size_t run_start = 0;
+        while (run_start < values.size())
+        {
+            const uint64_t value = quantize(values[run_start]);
+            size_t run_end = run_start + 1;
+            while (run_end < values.size() && quantize(values[run_end]) == value)
+            {
+                run_end++;
+            }
+            appendVarint(run_end - run_start);
+            appendVarint(value);
+            run_start = run_end;
+        }
+    }
+
+    /*!
+     * \brief Append a number to the encode buffer as a Protobuf varint: seven
+     * bits per byte, least significant first, with the high bit set on all but
+     * the last byte.
+     */
+    void appendVarint(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            encode_buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        encode_buffer.push_back(static_cast<char>(value));
+    }
+
+    /*!
+     * \brief Map a signed number to an unsigned one such that numbers close to
+     * zero stay small, the same as Protobuf's sint64.
+     */
+    static uint64_t zigzag(const int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
     /*!
      * \brief Implements the functionality of adding a single 2D line segment to
      * the path data.
@@ -272,9 +391,15 @@ private:
     {
         addPoint2D(point);
         line_types.push_back(print_feature_type);
-        line_widths.push_back(INT2MM(width));
-        line_thicknesses.push_back(INT2MM(thickness));
+        line_widths.push_back(width);
+        line_thicknesses.push_back(thickness);
         line_velocities.push_back(velocity);
+
+        if (line_types.size() * bytes_per_line_segment >= _cs_private_data.layer_view_chunk_size)
+        {
+            flushPathSegments();
+            addPoint2D(point); //The next line segment starts where this one ended.
+        }
     }
 };
 
@@ -293,9 +418,10 @@ ArcusCommunication::~ArcusCommunication()
 void ArcusCommunication::connect(const std::string& ip, const uint16_t port)
 {
     private_data->socket = new Arcus::Socket;
-    private_data->socket->addListener(new Listener);
+    private_data->socket->addListener(new Listener([this]() { private_data->notifySocketEvent(); }, []() { Cancellation::request(); })); //The front-end only sends a message during a slice if it wants a new one instead.
 
     private_data->socket->registerMessageType(&cura::proto::Slice::default_instance());
+    private_data->socket->registerMessageType(&cura::proto::SliceObject::default_instance());
     private_data->socket->registerMessageType(&cura::proto::Layer::default_instance());
     private_data->socket->registerMessageType(&cura::proto::LayerOptimized::default_instance());
     private_data->socket->registerMessageType(&cura::proto::Progress::default_instance());
@@ -305,12 +431,13 @@ void ArcusCommunication::connect(const std::string& ip, const uint16_t port)
     private_data->socket->registerMessageType(&cura::proto::GCodePrefix::default_instance());
     private_data->socket->registerMessageType(&cura::proto::SlicingFinished::default_instance());
     private_data->socket->registerMessageType(&cura::proto::SettingExtruder::default_instance());
+    private_data->socket->registerMessageType(&cura::proto::SliceStatistics::default_instance());
 
     log("Connecting to %s:%i\n", ip.c_str(), port);
     private_data->socket->connect(ip, port);
     while (private_data->socket->getState() != Arcus::SocketState::Connected && private_data->socket->getState() != Arcus::SocketState::Error)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(private_data->millisecUntilNextTry)); //Wait until we're connected. Check every XXXms.
+        private_data->waitForSocketEvent(); //Wait until the state of the socket changes.
     }
     log("Connected to %s:%i\n", ip.c_str(), port);
 }
@@ -321,6 +448,11 @@ void ArcusCommunication::setSocketMock(Arcus::Socket* socket)
     private_data->socket = socket;
 }
 
+void ArcusCommunication::enableSliceStatistics()
+{
+    private_data->send_slice_statistics = true;
+}
+
 void ArcusCommunication::beginGCode()
 {
     FffProcessor::getInstance()->setTargetStream(&private_data->gcode_output_stream);
@@ -467,6 +599,38 @@ void ArcusCommunication::sendProgress(const float& progress) const
     private_data->socket->sendMessage(message);
 
     private_data->last_sent_progress = rounded_amount;
+
+    if (private_data->send_slice_statistics)
+    {
+        const double now = getTime();
+        if (now - private_data->last_sent_statistics_time >= 1.0 || progress >= 1.0) //Always send the final statistics of a mesh group.
+        {
+            sendSliceStatistics();
+            private_data->last_sent_statistics_time = now;
+        }
+    }
+}
+
+void ArcusCommunication::sendSliceStatistics() const
+{
+    std::shared_ptr<proto::SliceStatistics> message = std::make_shared<proto::SliceStatistics>();
+    for (int stage = static_cast<int>(Progress::Stage::SLICING); stage < static_cast<int>(Progress::Stage::FINISH); stage++) //Start and finish aren't real stages.
+    {
+        const Progress::StageStatistics statistics = Progress::getStageStatistics(static_cast<Progress::Stage>(stage));
+        if (!statistics.started)
+        {
+            continue;
+        }
+        proto::StageStatistics* stage_message = message->add_stages();
+        stage_message->set_name(Progress::getStageName(static_cast<Progress::Stage>(stage)));
+        stage_message->set_time(statistics.time);
+        stage_message->set_done(statistics.done);
+        stage_message->set_total(statistics.total);
+        stage_message->set_throughput(statistics.time > 0.0 ? statistics.done / statistics.time : 0.0);
+    }
+    message->set_thread_utilisation(Progress::getThreadUtilisation());
+    message->set_peak_memory(getPeakMemoryUsage());
+    private_data->socket->sendMessage(message);
 }
 
 void ArcusCommunication::setLayerForSend(const LayerIndex& layer_nr)
@@ -481,7 +645,13 @@ void ArcusCommunication::setExtruderForSend(const ExtruderTrain& extruder)
 
 void ArcusCommunication::sliceNext()
 {
-    const Arcus::MessagePtr message = private_data->socket->takeNextMessage();
+    const Arcus::MessagePtr message = private_data->next_message ? std::move(private_data->next_message) : private_data->socket->takeNextMessage();
+    if (!message)
+    {
+        private_data->waitForSocketEvent(); //Wait until a message arrives or the socket closes, then get called again.
+        return;
+    }
+    Cancellation::reset(); //Only messages that arrive from now on replace this one.
 
     //Handle the main Slice message.
     const cura::proto::Slice* slice_message = dynamic_cast<cura::proto::Slice*>(message.get()); //See if the message is of the message type Slice. Returns nullptr otherwise.
@@ -493,6 +663,7 @@ void ArcusCommunication::sliceNext()
 
     Slice slice(slice_message->object_lists().size());
     Application::getInstance().current_slice = &slice;
+    private_data->compact_layer_view = slice_message->compact_layer_view();
 
     private_data->readGlobalSettingsMessage(slice_message->global_settings());
     private_data->readExtruderSettingsMessage(slice_message->extruders());
@@ -510,18 +681,39 @@ void ArcusCommunication::sliceNext()
         ExtruderTrain& extruder = slice.scene.extruders[setting_extruder.extruder()];
         slice.scene.limit_to_extruder.emplace(setting_extruder.name(), &extruder);
     }
+    Settings::invalidateCaches(); //Settings may now resolve to a different extruder.
 
     //Load all mesh groups, meshes and their settings.
     private_data->object_count = 0;
-    for (const cura::proto::ObjectList& mesh_group_message : slice_message->object_lists())
+    if (slice_message->streamed_object_count() > 0)
     {
-        private_data->readMeshGroupMessage(mesh_group_message);
+        if (!private_data->readStreamedObjects(*slice_message))
+        {
+            slice.reset();
+            return;
+        }
+    }
+    else
+    {
+        for (const cura::proto::ObjectList& mesh_group_message : slice_message->object_lists())
+        {
+            private_data->readMeshGroupMessage(mesh_group_message);
+        }
     }
     logDebug("Done reading Slice message.\n");
 
     if (!slice.scene.mesh_groups.empty())
     {
         slice.compute();
+        if (Cancellation::isRequested())
+        {
+            //A newer slice is waiting. Its g-code replaces this one's, so throw away what was written and don't count this slice.
+            log("Slice cancelled, because a new slice arrived.\n");
+            FffProcessor::getInstance()->reset();
+            private_data->gcode_output_stream.str("");
+            slice.reset();
+            return;
+        }
         FffProcessor::getInstance()->finalize();
         flushGCode();
         sendPrintTimeMaterialEstimates();
@@ -529,8 +721,6 @@ void ArcusCommunication::sliceNext()
         slice.reset();
         private_data->slice_count++;
     }
-
-    std::this_thread::sleep_for(std::chrono::milliseconds(250)); //Pause before checking again for a slice message.
 }
 
 } //namespace cura
@@ -31,8 +31,11 @@ class ArcusCommunication : public Communication
     friend class ArcusCommunicationTest;
     FRIEND_TEST(ArcusCommunicationTest, FlushGCodeTest);
     FRIEND_TEST(ArcusCommunicationTest, HasSlice);
+    FRIEND_TEST(ArcusCommunicationTest, SendCompactLayer);
+    FRIEND_TEST(ArcusCommunicationTest, SendLargeLayerInParts);
     FRIEND_TEST(ArcusCommunicationTest, SendLayerComplete);
     FRIEND_TEST(ArcusCommunicationTest, SendProgress);
+    FRIEND_TEST(ArcusCommunicationTest, SendSliceStatistics);
     friend class ArcusCommunicationPrivateTest;
 #endif
 public:
@@ -54,6 +57,15 @@ public:
      */
     void connect(const std::string& ip, const uint16_t port);
 
+    /*
+     * \brief Also send statistics about the stages of the slice along with the
+     * progress, at most once per second.
+     *
+     * These are sent as separate SliceStatistics messages, which front-ends
+     * that don't know about them would reject. So they're only sent on request.
+     */
+    void enableSliceStatistics();
+
     /*
      * \brief Indicate that we're beginning to send g-code.
      */
@@ -199,6 +211,12 @@ private:
      */
     void setSocketMock(Arcus::Socket* socket);
 
+    /*
+     * \brief Send the timings, throughput and memory use of the stages of the
+     * current mesh group.
+     */
+    void sendSliceStatistics() const;
+
     /*
      * \brief PIMPL pattern subclass that contains the private implementation.
      */
@@ -3,11 +3,18 @@
 
 #ifdef ARCUS
 
+#include <algorithm> //For std::min.
+#include <Arcus/Socket.h> //To send the parts of large layers.
+#include <chrono> //To limit how long to wait for socket events.
+#include <cstring> //For memcpy.
+#include <google/protobuf/arena.h> //To allocate the layer messages in one go.
+
 #include "ArcusCommunicationPrivate.h"
 #include "../Application.h"
 #include "../ExtruderTrain.h"
 #include "../Slice.h"
 #include "../settings/types/LayerIndex.h"
+#include "../utils/Cancellation.h" //Objects of a streamed slice arriving don't cancel it.
 #include "../utils/floatpoint.h" //To accept vertices (which are provided in floating point).
 #include "../utils/FMatrix4x3.h" //To convert vertices to integer-points.
 #include "../utils/logoutput.h"
@@ -18,9 +25,14 @@ namespace cura
 ArcusCommunication::Private::Private()
     : socket(nullptr)
     , object_count(0)
+    , layer_view_chunk_size(4 << 20) //4MB.
+    , compact_layer_view(false)
     , last_sent_progress(-1)
+    , send_slice_statistics(false)
+    , last_sent_statistics_time(0.0)
     , slice_count(0)
     , millisecUntilNextTry(100)
+    , socket_event_pending(false)
 {}
 
 std::shared_ptr<proto::LayerOptimized> ArcusCommunication::Private::getOptimizedLayerById(LayerIndex layer_nr)
@@ -34,14 +46,53 @@ std::shared_ptr<proto::LayerOptimized> ArcusCommunication::Private::getOptimized
     }
     else //Not in the cache yet. Create an empty layer.
     {
-        std::shared_ptr<proto::LayerOptimized> layer = std::make_shared<proto::LayerOptimized>();
-        layer->set_id(layer_nr);
+        std::shared_ptr<proto::LayerOptimized> layer = createOptimizedLayer(layer_nr);
         optimized_layers.current_layer_count++;
         optimized_layers.slice_data[layer_nr] = layer;
         return layer;
     }
 }
 
+void ArcusCommunication::Private::sendOptimizedLayerPart(LayerIndex layer_nr)
+{
+    layer_nr += optimized_layers.current_layer_offset;
+    std::unordered_map<int, std::shared_ptr<proto::LayerOptimized>>::iterator find_result = optimized_layers.slice_data.find(layer_nr);
+    if (find_result == optimized_layers.slice_data.end()) //Nothing collected for this layer.
+    {
+        return;
+    }
+
+    std::shared_ptr<proto::LayerOptimized> remainder = createOptimizedLayer(layer_nr);
+    remainder->set_height(find_result->second->height());
+    remainder->set_thickness(find_result->second->thickness());
+    socket->sendMessage(find_result->second); //The socket releases the message once it's sent.
+    find_result->second = remainder; //Still counts as the same layer for current_layer_count.
+}
+
+std::shared_ptr<proto::LayerOptimized> ArcusCommunication::Private::createOptimizedLayer(const int layer_nr) const
+{
+    std::shared_ptr<google::protobuf::Arena> arena = std::make_shared<google::protobuf::Arena>();
+    proto::LayerOptimized* layer = google::protobuf::Arena::CreateMessage<proto::LayerOptimized>(arena.get());
+    layer->set_id(layer_nr);
+    return std::shared_ptr<proto::LayerOptimized>(arena, layer); //Shares the ownership of the arena, which owns the message.
+}
+
+void ArcusCommunication::Private::notifySocketEvent()
+{
+    {
+        std::lock_guard<std::mutex> lock(socket_event_mutex);
+        socket_event_pending = true;
+    }
+    socket_event.notify_all();
+}
+
+void ArcusCommunication::Private::waitForSocketEvent()
+{
+    std::unique_lock<std::mutex> lock(socket_event_mutex);
+    socket_event.wait_for(lock, std::chrono::milliseconds(millisecUntilNextTry), [this]() { return socket_event_pending; });
+    socket_event_pending = false;
+}
+
 void ArcusCommunication::Private::readGlobalSettingsMessage(const proto::SettingList& global_settings_message)
 {
     Slice* slice = Application::getInstance().current_slice;
@@ -94,46 +145,126 @@ void ArcusCommunication::Private::readMeshGroupMessage(const proto::ObjectList&
         mesh_group.settings.add(setting.name(), setting.value());
     }
 
-    FMatrix4x3 matrix;
     for (const cura::proto::Object& object : mesh_group_message.objects())
     {
-        const size_t bytes_per_face = sizeof(FPoint3) * 3; //3 vectors per face.
-        const size_t face_count = object.vertices().size() / bytes_per_face;
+        readObjectMessage(object, mesh_group.meshes);
+    }
+    object_count++;
+    mesh_group.finalize();
+}
 
-        if (face_count <= 0)
+bool ArcusCommunication::Private::readStreamedObjects(const proto::Slice& slice_message)
+{
+    //Collect the meshes per mesh group of the message first, since empty mesh groups don't get a mesh group in the scene.
+    std::vector<std::vector<Mesh>> received_meshes(slice_message.object_lists_size());
+    for (int received_count = 0; received_count < slice_message.streamed_object_count(); )
+    {
+        const Arcus::MessagePtr message = socket->takeNextMessage();
+        if (!message)
         {
-            logWarning("Got an empty mesh. Ignoring it!");
+            if (socket->getState() == Arcus::SocketState::Closed || socket->getState() == Arcus::SocketState::Error)
+            {
+                logError("The socket closed while receiving the objects of the slice.\n");
+                return false;
+            }
+            waitForSocketEvent(); //Wait until the next object arrives.
             continue;
         }
+        Cancellation::reset(); //Objects of this slice don't replace it.
 
-        mesh_group.meshes.emplace_back();
-        Mesh& mesh = mesh_group.meshes.back();
+        if (dynamic_cast<const proto::Slice*>(message.get()))
+        {
+            log("Slice cancelled while receiving its objects, because a new slice arrived.\n");
+            next_message = message;
+            return false;
+        }
+        const proto::SliceObject* object_message = dynamic_cast<const proto::SliceObject*>(message.get());
+        if (!object_message)
+        {
+            continue;
+        }
+        received_count++;
+        if (object_message->mesh_group() < 0 || object_message->mesh_group() >= slice_message.object_lists_size())
+        {
+            logWarning("Got an object for mesh group %d, which doesn't exist. Ignoring it!\n", object_message->mesh_group());
+            continue;
+        }
+        readObjectMessage(object_message->object(), received_meshes[object_message->mesh_group()]);
+    }
 
-        //Load the settings for the mesh.
-        for (const cura::proto::Setting& setting : object.settings())
+    Scene& scene = Application::getInstance().current_slice->scene;
+    for (int mesh_group_idx = 0; mesh_group_idx < slice_message.object_lists_size(); mesh_group_idx++)
+    {
+        if (received_meshes[mesh_group_idx].empty())
+        {
+            continue; //Don't slice empty mesh groups.
+        }
+        MeshGroup& mesh_group = scene.mesh_groups.at(object_count);
+        for (const cura::proto::Setting& setting : slice_message.object_lists(mesh_group_idx).settings())
         {
-            mesh.settings.add(setting.name(), setting.value());
+            mesh_group.settings.add(setting.name(), setting.value());
         }
-        ExtruderTrain& extruder = mesh.settings.get<ExtruderTrain&>("extruder_nr"); //Set the parent setting to the correct extruder.
-        mesh.settings.setParent(&extruder.settings);
+        mesh_group.meshes = std::move(received_meshes[mesh_group_idx]);
+        object_count++;
+        mesh_group.finalize();
+    }
+    return true;
+}
+
+void ArcusCommunication::Private::readObjectMessage(const proto::Object& object, std::vector<Mesh>& meshes)
+{
+    const size_t bytes_per_face = sizeof(FPoint3) * 3; //3 vectors per face.
+    const size_t face_count = object.vertices().size() / bytes_per_face;
 
-        for (size_t face = 0; face < face_count; face++)
+    if (face_count <= 0)
+    {
+        logWarning("Got an empty mesh. Ignoring it!");
+        return;
+    }
+
+    meshes.emplace_back();
+    Mesh& mesh = meshes.back();
+
+    //Load the settings for the mesh.
+    for (const cura::proto::Setting& setting : object.settings())
+    {
+        mesh.settings.add(setting.name(), setting.value());
+    }
+    ExtruderTrain& extruder = mesh.settings.get<ExtruderTrain&>("extruder_nr"); //Set the parent setting to the correct extruder.
+    mesh.settings.setParent(&extruder.settings);
+
+    mesh.faces.reserve(face_count);
+    mesh.vertices.reserve(face_count);
+
+    // Read the vertices straight from the message instead of copying each face out of it.
+    // Transforming them is independent per face, so do that in parallel a chunk of faces at a time.
+    // The faces are added to the mesh afterwards in message order, so that the vertex and face order doesn't depend on the threads.
+    FMatrix4x3 matrix;
+    const char* vertex_data = object.vertices().data();
+    constexpr size_t chunk_size = 1 << 16;
+    std::vector<Point3> corners(std::min(chunk_size, face_count) * 3);
+    for (size_t chunk_start = 0; chunk_start < face_count; chunk_start += chunk_size)
+    {
+        const int chunk_face_count = std::min(chunk_size, face_count - chunk_start);
+        const char* chunk_data = vertex_data + chunk_start * bytes_per_face;
+
+#pragma omp parallel for default(none) shared(chunk_face_count, chunk_data, corners, matrix, bytes_per_face)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int face_idx = 0; face_idx < chunk_face_count; face_idx++)
         {
-            const std::string data = object.vertices().substr(face * bytes_per_face, bytes_per_face);
-            const FPoint3* float_vertices = reinterpret_cast<const FPoint3*>(data.data());
-
-            Point3 verts[3];
-            verts[0] = matrix.apply(float_vertices[0]);
-            verts[1] = matrix.apply(float_vertices[1]);
-            verts[2] = matrix.apply(float_vertices[2]);
-            mesh.addFace(verts[0], verts[1], verts[2]);
+            FPoint3 float_vertices[3];
+            memcpy(float_vertices, chunk_data + face_idx * bytes_per_face, bytes_per_face); //The message data isn't necessarily aligned, so copy.
+            corners[face_idx * 3 + 0] = matrix.apply(float_vertices[0]);
+            corners[face_idx * 3 + 1] = matrix.apply(float_vertices[1]);
+            corners[face_idx * 3 + 2] = matrix.apply(float_vertices[2]);
         }
 
-        mesh.mesh_name = object.name();
-        mesh.finish();
+        corners.resize(chunk_face_count * 3);
+        mesh.addFaces(corners);
     }
-    object_count++;
-    mesh_group.finalize();
+
+    mesh.mesh_name = object.name();
+    mesh.finish();
 }
 
 } //namespace cura
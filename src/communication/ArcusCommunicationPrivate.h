@@ -5,6 +5,9 @@
 #define ARCUSCOMMUNICATIONPRIVATE_H
 #ifdef ARCUS
 
+#include <Arcus/Types.h> //For MessagePtr.
+#include <condition_variable> //To wait for events on the socket.
+#include <mutex>
 #include <sstream> //For ostringstream.
 
 #include "ArcusCommunication.h" //We're adding a subclass to this.
@@ -14,6 +17,7 @@ namespace cura
 {
 
 struct LayerIndex;
+class Mesh;
 
 class ArcusCommunication::Private
 {
@@ -28,6 +32,29 @@ public:
      */
     std::shared_ptr<proto::LayerOptimized> getOptimizedLayerById(LayerIndex layer_nr);
 
+    /*
+     * \brief Send the optimised layer data collected so far for a layer, and
+     * continue collecting in a new message for the same layer.
+     *
+     * The front-end combines all messages with the same layer ID. This way
+     * large layers are sent in parts while they are being generated.
+     * \param layer_nr The layer number to send the optimised layer data of.
+     */
+    void sendOptimizedLayerPart(LayerIndex layer_nr);
+
+    /*
+     * \brief Create an empty message for the optimised layer data of a layer.
+     *
+     * The message and all path segments added to it are allocated in an arena
+     * of their own. The arena is freed at once when the last reference to the
+     * message is released, which is usually by the socket after sending it,
+     * instead of freeing each path segment separately.
+     * \param layer_nr The layer number to give the message, including the
+     * offset of the current object.
+     * \return The empty message.
+     */
+    std::shared_ptr<proto::LayerOptimized> createOptimizedLayer(const int layer_nr) const;
+
     /*
      * Reads the global settings from a Protobuf message.
      *
@@ -45,6 +72,46 @@ public:
      */
     void readMeshGroupMessage(const proto::ObjectList& mesh_group_message);
 
+    /*
+     * \brief Receives the objects of a Slice message that has them sent
+     * separately, and reads them into the mesh groups of the current scene.
+     *
+     * Each object is loaded as soon as it arrives, while the front-end is
+     * still sending the rest. This returns once all objects are read.
+     * \param slice_message The Slice message with the settings of the mesh
+     * groups and the number of objects that follow.
+     * \return Whether all objects were received. If not, the socket closed or
+     * a new Slice message replaced this one. That one is then stored in
+     * \ref next_message.
+     */
+    bool readStreamedObjects(const proto::Slice& slice_message);
+
+    /*
+     * \brief Reads a Protobuf message describing one mesh.
+     *
+     * This gets the vertex data from the message as well as the settings, and
+     * adds the mesh to a list of meshes. Empty meshes are ignored.
+     * \param object_message The message with the mesh.
+     * \param meshes The meshes to add the mesh to.
+     */
+    void readObjectMessage(const proto::Object& object_message, std::vector<Mesh>& meshes);
+
+    /*
+     * \brief Signal that something happened on the socket.
+     *
+     * This is called from the thread of the socket, by the listener.
+     */
+    void notifySocketEvent();
+
+    /*
+     * \brief Wait until something happens on the socket: a message arrives,
+     * its state changes or an error occurs.
+     *
+     * Returns immediately if something happened since the previous wait. As a
+     * safety net, it also returns after millisecUntilNextTry.
+     */
+    void waitForSocketEvent();
+
     Arcus::Socket* socket; //!< Socket to send data to.
     size_t object_count; //!< Number of objects that need to be sliced.
     std::string temp_gcode_file; //!< Temporary buffer for the g-code.
@@ -53,8 +120,24 @@ public:
     SliceDataStruct<cura::proto::Layer> sliced_layers;
     SliceDataStruct<cura::proto::LayerOptimized> optimized_layers;
 
+    /*
+     * \brief How much layer view data to collect for a layer before it's sent
+     * in parts, in bytes.
+     *
+     * Arcus sends the messages on its own thread, so the slicing doesn't wait
+     * for them.
+     */
+    size_t layer_view_chunk_size;
+
+    bool compact_layer_view; //!< Whether the front-end asked for the layer view in the compact encoding of PathSegment.
+
+    Arcus::MessagePtr next_message; //!< A message that was received while receiving streamed objects, to handle before the messages still on the socket.
+
     int last_sent_progress; //!< Last sent progress promille (1/1000th). Used to not send duplicate messages with the same promille.
 
+    bool send_slice_statistics; //!< Whether to send SliceStatistics messages along with the progress.
+    double last_sent_statistics_time; //!< When the statistics were last sent, to send them at most once per second.
+
     /*
      * \brief How often we've sliced so far during this run of CuraEngine.
      *
@@ -67,10 +150,18 @@ public:
      * depend on the order of iteration in unordered_map or unordered_set,
      * because those data structures will give a different order if more memory
      * has already been reserved for them.
+     *
+     * Slices that are cancelled because a new one arrived don't count. They
+     * stop before anything is written, and the new one is what the front-end
+     * waits for.
      */
     size_t slice_count; //!< How often we've sliced so far during this run of CuraEngine.
 
-    const size_t millisecUntilNextTry; // How long we wait until we try to connect again.
+    const size_t millisecUntilNextTry; // How long we wait at most for a socket event before checking the socket again.
+
+    std::mutex socket_event_mutex; //!< Guards socket_event_pending.
+    std::condition_variable socket_event; //!< Notified when something happens on the socket.
+    bool socket_event_pending; //!< Whether something happened on the socket that wasn't waited for yet.
 };
 
 } //namespace cura
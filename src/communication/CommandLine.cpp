@@ -1,16 +1,21 @@
 //Copyright (c) 2020 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For std::sort.
+#include <cstdint> //For the fixed-size numbers in the definition cache.
+#include <cstdio> //For std::rename and std::remove.
 #include <cstring> //For strtok and strcopy.
+#include <deque> //To collect the model files to load, which keeps their settings in place.
 #include <fstream> //To check if files exist.
 #include <errno.h> // error number when trying to read file
 #include <numeric> //For std::accumulate.
+#include <sys/stat.h> //To check whether definition files were modified.
 #ifdef _OPENMP
     #include <omp.h> //To change the number of threads to slice with.
 #endif //_OPENMP
 #include <rapidjson/rapidjson.h>
 #include <rapidjson/error/en.h> //Loading JSON documents to get settings from them.
-#include <rapidjson/filereadstream.h>
+#include <random> //To give temporary cache files a unique name.
 #include <unordered_set>
 
 #include "CommandLine.h"
@@ -19,12 +24,104 @@
 #include "../FffProcessor.h" //To start a slice and get time estimates.
 #include "../Slice.h"
 #include "../utils/getpath.h"
+#include "../utils/LayerStatistics.h" //To write the counters per layer when requested.
 #include "../utils/FMatrix4x3.h" //For the mesh_rotation_matrix setting.
 #include "../utils/logoutput.h"
+#include "../utils/Trace.h" //To record where the time goes when requested.
 
 namespace cura
 {
 
+namespace
+{
+
+constexpr uint64_t fnv_offset_basis = 14695981039346656037ULL; //!< Start value of the 64-bit FNV-1a hash.
+
+/*!
+ * Continue a 64-bit FNV-1a hash with some more bytes.
+ * \param data The bytes to hash.
+ * \param size The number of bytes.
+ * \param hash The hash of the bytes before this.
+ * \return The hash including these bytes.
+ */
+uint64_t hashBytes(const char* data, const size_t size, uint64_t hash)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL; //The 64-bit FNV prime.
+    }
+    return hash;
+}
+
+/*!
+ * A model file given with -l, to be loaded together with the other files of
+ * its mesh group.
+ */
+struct MeshFile
+{
+    MeshFile(const std::string& filename, const FMatrix4x3& transformation, const Settings& extruder_settings)
+    : filename(filename)
+    , transformation(transformation)
+    , load_settings(extruder_settings)
+    , settings(extruder_settings)
+    , loaded(false)
+    , error_number(0)
+    {
+    }
+
+    std::string filename; //!< The file to load.
+    FMatrix4x3 transformation; //!< The transformation applied to the model when loaded.
+    Settings load_settings; //!< The settings of the extruder when the file was given, which the mesh is loaded with.
+    Settings settings; //!< The settings that the (last) mesh loaded from the file ends up with, including those given after the file.
+    bool loaded; //!< Whether loading succeeded.
+    int error_number; //!< The errno after loading, to report if loading failed.
+};
+
+/*!
+ * Load the model files of a mesh group, all at the same time.
+ *
+ * Each file is loaded into a mesh group of its own, including finishing its
+ * meshes, so that files don't wait for each other. The meshes are then added to
+ * the mesh group in the order in which the files were given. If a file can't
+ * be loaded, the application exits.
+ * \param files The files to load. They are removed once loaded.
+ * \param mesh_group The mesh group to add the meshes to.
+ */
+void loadMeshFiles(std::deque<MeshFile>& files, MeshGroup& mesh_group)
+{
+    std::vector<MeshGroup> loaded_groups(files.size());
+    const int file_count = files.size();
+#pragma omp parallel for default(none) shared(files, loaded_groups, file_count) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int file_idx = 0; file_idx < file_count; file_idx++)
+    {
+        MeshFile& file = files[file_idx];
+        errno = 0;
+        file.loaded = loadMeshIntoMeshGroup(&loaded_groups[file_idx], file.filename.c_str(), file.transformation, file.load_settings);
+        file.error_number = errno;
+    }
+
+    for (int file_idx = 0; file_idx < file_count; file_idx++)
+    {
+        MeshFile& file = files[file_idx];
+        if (!file.loaded)
+        {
+            logError("Failed to load model: %s. (error number %d)\n", file.filename.c_str(), file.error_number);
+            exit(1);
+        }
+        std::vector<Mesh>& meshes = loaded_groups[file_idx].meshes;
+        meshes.back().settings = std::move(file.settings);
+        for (Mesh& mesh : meshes)
+        {
+            mesh_group.meshes.push_back(std::move(mesh));
+        }
+    }
+    files.clear();
+}
+
+}
+
 CommandLine::CommandLine(const std::vector<std::string>& arguments)
 : arguments(arguments)
 , last_shown_progress(0)
@@ -44,6 +141,11 @@ void CommandLine::sendPolygons(const PrintFeatureType&, const Polygons&, const c
 void CommandLine::setExtruderForSend(const ExtruderTrain&) { }
 void CommandLine::setLayerForSend(const LayerIndex&) { }
 
+void CommandLine::setArguments(const std::vector<std::string>& arguments)
+{
+    this->arguments = arguments;
+}
+
 bool CommandLine::hasSlice() const
 {
     return !arguments.empty();
@@ -85,6 +187,7 @@ void CommandLine::sendProgress(const float& progress) const
 void CommandLine::sliceNext()
 {
     FffProcessor::getInstance()->time_keeper.restart();
+    Trace::stop(); //In serve mode, an earlier slice may have been traced. Only trace this one if it has the --trace argument.
 
     //Count the number of mesh groups to slice for.
     size_t num_mesh_groups = 1;
@@ -101,10 +204,13 @@ void CommandLine::sliceNext()
 
     size_t mesh_group_index = 0;
     Settings* last_settings = &slice.scene.settings;
+    std::string trace_file; //Where to write the trace to, if any.
+    std::string layer_statistics_file; //Where to write the statistics per layer to, if any.
 
     slice.scene.extruders.reserve(arguments.size() >> 1); //Allocate enough memory to prevent moves.
     slice.scene.extruders.emplace_back(0, &slice.scene.settings); //Always have one extruder.
     ExtruderTrain* last_extruder = &slice.scene.extruders[0];
+    std::deque<MeshFile> mesh_files; //The model files of the current mesh group, loaded at once when the mesh group is complete.
 
     for (size_t argument_index = 2; argument_index < arguments.size(); argument_index++)
     {
@@ -117,6 +223,7 @@ void CommandLine::sliceNext()
                 {
                     try
                     {
+                        loadMeshFiles(mesh_files, slice.scene.mesh_groups[mesh_group_index]);
                         log("Loaded from disk in %5.3fs\n", FffProcessor::getInstance()->time_keeper.restart());
 
                         mesh_group_index++;
@@ -132,6 +239,28 @@ void CommandLine::sliceNext()
                         exit(1);
                     }
                 }
+                else if (argument == "--trace")
+                {
+                    argument_index++;
+                    if (argument_index >= arguments.size())
+                    {
+                        logError("Missing trace file with --trace argument.");
+                        exit(1);
+                    }
+                    trace_file = arguments[argument_index];
+                    Trace::start();
+                }
+                else if (argument == "--layer-statistics")
+                {
+                    argument_index++;
+                    if (argument_index >= arguments.size())
+                    {
+                        logError("Missing statistics file with --layer-statistics argument.");
+                        exit(1);
+                    }
+                    layer_statistics_file = arguments[argument_index];
+                    LayerStatistics::start();
+                }
                 else
                 {
                     logError("Unknown option: %s\n", argument.c_str());
@@ -216,15 +345,9 @@ void CommandLine::sliceNext()
 
                         const FMatrix4x3 transformation = last_settings->get<FMatrix4x3>("mesh_rotation_matrix"); //The transformation applied to the model when loaded.
 
-                        if (!loadMeshIntoMeshGroup(&slice.scene.mesh_groups[mesh_group_index], argument.c_str(), transformation, last_extruder->settings))
-                        {
-                            logError("Failed to load model: %s. (error number %d)\n", argument.c_str(), errno);
-                            exit(1);
-                        }
-                        else
-                        {
-                            last_settings = &slice.scene.mesh_groups[mesh_group_index].meshes.back().settings;
-                        }
+                        //Only load the file once all files of the mesh group are known, to load them in parallel. The settings that follow are for this mesh.
+                        mesh_files.emplace_back(argument, transformation, last_extruder->settings);
+                        last_settings = &mesh_files.back().settings;
                         break;
                     }
                     case 'o':
@@ -296,6 +419,7 @@ void CommandLine::sliceNext()
     try
     {
 #endif //DEBUG
+        loadMeshFiles(mesh_files, slice.scene.mesh_groups[mesh_group_index]);
         slice.scene.mesh_groups[mesh_group_index].finalize();
         log("Loaded from disk in %5.3fs\n", FffProcessor::getInstance()->time_keeper.restart());
 
@@ -315,33 +439,265 @@ void CommandLine::sliceNext()
 
     //Finalize the processor. This adds the end g-code and reports statistics.
     FffProcessor::getInstance()->finalize();
+
+    if (!trace_file.empty() && !Trace::write(trace_file))
+    {
+        logError("Failed to write trace to %s.\n", trace_file.c_str());
+    }
+    if (!layer_statistics_file.empty() && !LayerStatistics::write(layer_statistics_file))
+    {
+        logError("Failed to write layer statistics to %s.\n", layer_statistics_file.c_str());
+    }
 }
 
 int CommandLine::loadJSON(const std::string& json_filename, Settings& settings)
 {
-    FILE* file = fopen(json_filename.c_str(), "rb");
+    int error_code = 0;
+    const Definition* definition = getDefinition(json_filename, error_code);
+    if (!definition)
+    {
+        return error_code;
+    }
+
+    //Inheritance from other JSON documents.
+    if (!definition->parent_id.empty())
+    {
+        if (definition->parent_file.empty())
+        {
+            logError("Inherited JSON file \"%s\" not found.\n", definition->parent_id.c_str());
+            return 1;
+        }
+        error_code = loadJSON(definition->parent_file, settings); //Head-recursively load the settings file that we inherit from.
+        if (error_code)
+        {
+            return error_code;
+        }
+    }
+
+    //Extruders defined from here, if any.
+    //Note that this always puts the extruder settings in the slice of the current extruder. It doesn't keep the nested structure of the JSON files, if extruders would have their own sub-extruders.
+    Scene& scene = Application::getInstance().current_slice->scene;
+    for (const std::pair<size_t, std::string>& extruder_train : definition->extruder_trains)
+    {
+        while (scene.extruders.size() <= extruder_train.first)
+        {
+            scene.extruders.emplace_back(scene.extruders.size(), &scene.settings);
+        }
+        if (!extruder_train.second.empty())
+        {
+            loadJSON(extruder_train.second, scene.extruders[extruder_train.first].settings);
+        }
+    }
+
+    for (const std::pair<std::string, std::string>& setting : definition->settings)
+    {
+        settings.add(setting.first, setting.second);
+    }
+    return 0;
+}
+
+const CommandLine::Definition* CommandLine::getDefinition(const std::string& json_filename, int& error_code)
+{
+    struct stat file_status;
+    if (stat(json_filename.c_str(), &file_status) != 0)
+    {
+        logError("Couldn't open JSON file: %s\n", json_filename.c_str());
+        error_code = 1;
+        return nullptr;
+    }
+    const std::unordered_map<std::string, Definition>::const_iterator cached = definitions.find(json_filename);
+    if (cached != definitions.end() && cached->second.modification_time == file_status.st_mtime)
+    {
+        return &cached->second;
+    }
+
+    std::ifstream file(json_filename, std::ios::binary);
     if (!file)
     {
         logError("Couldn't open JSON file: %s\n", json_filename.c_str());
-        return 1;
+        error_code = 1;
+        return nullptr;
+    }
+    std::string contents(static_cast<size_t>(file_status.st_size), '\0');
+    file.read(&contents[0], contents.size());
+    contents.resize(file.gcount());
+
+    std::unordered_set<std::string> search_directories = defaultSearchDirectories(); //For finding the inheriting JSON files.
+    std::string directory = getPathName(json_filename);
+    search_directories.emplace(directory);
+
+    Definition definition;
+    definition.modification_time = file_status.st_mtime;
+
+    //The parsed file may be in the on-disk cache from an earlier run.
+    std::string cache_file;
+    const char* cache_directory = getenv("CURA_ENGINE_CACHE_PATH");
+    if (cache_directory && *cache_directory)
+    {
+        //The files that the definition refers to are found in the search directories, so those are part of the key too.
+        std::vector<std::string> sorted_directories(search_directories.begin(), search_directories.end());
+        std::sort(sorted_directories.begin(), sorted_directories.end());
+        uint64_t hash = hashBytes(contents.data(), contents.size(), fnv_offset_basis);
+        for (const std::string& search_directory : sorted_directories)
+        {
+            hash = hashBytes(search_directory.c_str(), search_directory.size() + 1, hash); //Include the terminating 0 as separator.
+        }
+        char hash_string[17];
+        snprintf(hash_string, sizeof(hash_string), "%016llx", static_cast<unsigned long long>(hash));
+        cache_file = std::string(cache_directory) + "/" + hash_string + ".defcache";
+
+        if (readCachedDefinition(cache_file, definition))
+        {
+            Definition& stored = definitions[json_filename];
+            stored = std::move(definition);
+            return &stored;
+        }
     }
 
     rapidjson::Document json_document;
-    char read_buffer[4096];
-    rapidjson::FileReadStream reader_stream(file, read_buffer, sizeof(read_buffer));
-    json_document.ParseStream(reader_stream);
-    fclose(file);
+    json_document.Parse(contents.data(), contents.size());
     if (json_document.HasParseError())
     {
         logError("Error parsing JSON (offset %u): %s\n", static_cast<unsigned int>(json_document.GetErrorOffset()), GetParseError_En(json_document.GetParseError()));
-        return 2;
+        error_code = 2;
+        return nullptr;
     }
 
-    std::unordered_set<std::string> search_directories = defaultSearchDirectories(); //For finding the inheriting JSON files.
-    std::string directory = getPathName(json_filename);
-    search_directories.emplace(directory);
+    parseDefinition(json_document, search_directories, definition);
+    if (!cache_file.empty())
+    {
+        writeCachedDefinition(cache_file, definition);
+    }
+    Definition& stored = definitions[json_filename];
+    stored = std::move(definition);
+    return &stored;
+}
+
+bool CommandLine::readCachedDefinition(const std::string& cache_file, Definition& definition)
+{
+    std::ifstream file(cache_file, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return false; //Not in the cache.
+    }
+    const std::streamoff file_size = file.tellg();
+    file.seekg(0);
+    char file_header[sizeof(cache_header)];
+    if (file_size < static_cast<std::streamoff>(sizeof(cache_header)) || !file.read(file_header, sizeof(cache_header)) || std::memcmp(file_header, cache_header, sizeof(cache_header)) != 0)
+    {
+        return false;
+    }
+    size_t remaining = file_size - sizeof(cache_header); //Lengths and counts larger than what's left of the file are damaged, so they may not be allocated.
+
+    const auto read_number = [&file, &remaining](uint32_t& number)
+    {
+        if (remaining < sizeof(uint32_t))
+        {
+            return false;
+        }
+        char bytes[sizeof(uint32_t)];
+        file.read(bytes, sizeof(uint32_t));
+        std::memcpy(&number, bytes, sizeof(uint32_t)); //All platforms that Cura supports are little-endian.
+        remaining -= sizeof(uint32_t);
+        return static_cast<bool>(file);
+    };
+    const auto read_string = [&file, &remaining, &read_number](std::string& string)
+    {
+        uint32_t length;
+        if (!read_number(length) || length > remaining)
+        {
+            return false;
+        }
+        string.resize(length);
+        remaining -= length;
+        return length == 0 || static_cast<bool>(file.read(&string[0], length));
+    };
+    constexpr size_t min_entry_size = 2 * sizeof(uint32_t); //Each extruder train and setting is at least two numbers long.
+
+    //Read into a separate definition, so that a damaged file doesn't leave the given one half filled.
+    Definition cached;
+    uint32_t count;
+    if (!read_string(cached.parent_id) || !read_string(cached.parent_file) || !read_number(count) || count > remaining / min_entry_size)
+    {
+        return false;
+    }
+    cached.extruder_trains.resize(count);
+    for (std::pair<size_t, std::string>& extruder_train : cached.extruder_trains)
+    {
+        uint32_t extruder_nr;
+        if (!read_number(extruder_nr) || !read_string(extruder_train.second))
+        {
+            return false;
+        }
+        extruder_train.first = extruder_nr;
+    }
+    if (!read_number(count) || count > remaining / min_entry_size)
+    {
+        return false;
+    }
+    cached.settings.resize(count);
+    for (std::pair<std::string, std::string>& setting : cached.settings)
+    {
+        if (!read_string(setting.first) || !read_string(setting.second))
+        {
+            return false;
+        }
+    }
+    if (remaining != 0 || file.peek() != std::ifstream::traits_type::eof()) //Nothing may be left, or the file is damaged.
+    {
+        return false;
+    }
+    cached.modification_time = definition.modification_time;
+    definition = std::move(cached);
+    return true;
+}
+
+void CommandLine::writeCachedDefinition(const std::string& cache_file, const Definition& definition)
+{
+    std::string data(cache_header, sizeof(cache_header));
+    const auto write_number = [&data](const uint32_t number)
+    {
+        char bytes[sizeof(uint32_t)];
+        std::memcpy(bytes, &number, sizeof(uint32_t));
+        data.append(bytes, sizeof(uint32_t));
+    };
+    const auto write_string = [&data, &write_number](const std::string& string)
+    {
+        write_number(static_cast<uint32_t>(string.size()));
+        data.append(string);
+    };
+
+    write_string(definition.parent_id);
+    write_string(definition.parent_file);
+    write_number(static_cast<uint32_t>(definition.extruder_trains.size()));
+    for (const std::pair<size_t, std::string>& extruder_train : definition.extruder_trains)
+    {
+        write_number(static_cast<uint32_t>(extruder_train.first));
+        write_string(extruder_train.second);
+    }
+    write_number(static_cast<uint32_t>(definition.settings.size()));
+    for (const std::pair<std::string, std::string>& setting : definition.settings)
+    {
+        write_string(setting.first);
+        write_string(setting.second);
+    }
 
-    return loadJSON(json_document, search_directories, settings);
+    //Write to a temporary file first, so that other processes never read a half-written cache file.
+    const std::string temporary_file = cache_file + "." + std::to_string(std::random_device()()) + ".tmp";
+    {
+        std::ofstream file(temporary_file, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(data.data(), data.size()))
+        {
+            logWarning("Couldn't write definition cache file: %s\n", temporary_file.c_str());
+            file.close();
+            std::remove(temporary_file.c_str());
+            return;
+        }
+    }
+    if (std::rename(temporary_file.c_str(), cache_file.c_str()) != 0)
+    {
+        std::remove(temporary_file.c_str()); //Probably another process stored the same file in the meantime.
+    }
 }
 
 std::unordered_set<std::string> CommandLine::defaultSearchDirectories()
@@ -369,27 +725,16 @@ std::unordered_set<std::string> CommandLine::defaultSearchDirectories()
     return result;
 }
 
-int CommandLine::loadJSON(const rapidjson::Document& document, const std::unordered_set<std::string>& search_directories, Settings& settings)
+void CommandLine::parseDefinition(const rapidjson::Document& document, const std::unordered_set<std::string>& search_directories, Definition& definition)
 {
     //Inheritance from other JSON documents.
     if (document.HasMember("inherits") && document["inherits"].IsString())
     {
-        std::string parent_file = findDefinitionFile(document["inherits"].GetString(), search_directories);
-        if (parent_file == "")
-        {
-            logError("Inherited JSON file \"%s\" not found.\n", document["inherits"].GetString());
-            return 1;
-        }
-        int error_code = loadJSON(parent_file, settings); //Head-recursively load the settings file that we inherit from.
-        if (error_code)
-        {
-            return error_code;
-        }
+        definition.parent_id = document["inherits"].GetString();
+        definition.parent_file = findDefinitionFile(definition.parent_id, search_directories);
     }
 
     //Extruders defined from here, if any.
-    //Note that this always puts the extruder settings in the slice of the current extruder. It doesn't keep the nested structure of the JSON files, if extruders would have their own sub-extruders.
-    Scene& scene = Application::getInstance().current_slice->scene;
     if (document.HasMember("metadata") && document["metadata"].IsObject())
     {
         const rapidjson::Value& metadata = document["metadata"];
@@ -403,34 +748,29 @@ int CommandLine::loadJSON(const rapidjson::Document& document, const std::unorde
                 {
                     continue;
                 }
-                while (scene.extruders.size() <= static_cast<size_t>(extruder_nr))
-                {
-                    scene.extruders.emplace_back(scene.extruders.size(), &scene.settings);
-                }
                 const rapidjson::Value& extruder_id = extruder_train->value;
-                if (!extruder_id.IsString())
+                std::string extruder_file;
+                if (extruder_id.IsString())
                 {
-                    continue;
+                    const std::string extruder_definition_id(extruder_id.GetString());
+                    extruder_file = findDefinitionFile(extruder_definition_id, search_directories);
                 }
-                const std::string extruder_definition_id(extruder_id.GetString());
-                const std::string extruder_file = findDefinitionFile(extruder_definition_id, search_directories);
-                loadJSON(extruder_file, scene.extruders[extruder_nr].settings);
+                definition.extruder_trains.emplace_back(extruder_nr, extruder_file);
             }
         }
     }
 
     if (document.HasMember("settings") && document["settings"].IsObject())
     {
-        loadJSONSettings(document["settings"], settings);
+        loadJSONSettings(document["settings"], definition.settings);
     }
     if (document.HasMember("overrides") && document["overrides"].IsObject())
     {
-        loadJSONSettings(document["overrides"], settings);
+        loadJSONSettings(document["overrides"], definition.settings);
     }
-    return 0;
 }
 
-void CommandLine::loadJSONSettings(const rapidjson::Value& element, Settings& settings)
+void CommandLine::loadJSONSettings(const rapidjson::Value& element, std::vector<std::pair<std::string, std::string>>& settings)
 {
     for (rapidjson::Value::ConstMemberIterator setting = element.MemberBegin(); setting != element.MemberEnd(); setting++)
     {
@@ -479,7 +819,7 @@ void CommandLine::loadJSONSettings(const rapidjson::Value& element, Settings& se
                 logWarning("Unrecognized data type in JSON setting %s\n", name.c_str());
                 continue;
             }
-            settings.add(name, value_string);
+            settings.emplace_back(name, value_string);
         }
     }
 }
@@ -4,9 +4,12 @@
 #ifndef COMMANDLINE_H
 #define COMMANDLINE_H
 
+#include <ctime> //For time_t.
 #include <rapidjson/document.h> //Loading JSON documents to get settings from them.
 #include <string> //To store the command line arguments.
+#include <unordered_map> //To cache the definition files.
 #include <unordered_set>
+#include <utility> //For std::pair.
 #include <vector> //To store the command line arguments.
 
 #include "Communication.h" //The class we're implementing.
@@ -144,7 +147,31 @@ public:
      */
     void sliceNext() override;
 
+    /*
+     * \brief Provide the arguments for another slice, after the previous one
+     * is done.
+     *
+     * This allows slicing several times with one instance. The definition
+     * files that were loaded before are not parsed again, unless they were
+     * modified in the meantime.
+     * \param arguments The arguments for the slice, in the same form as the
+     * command line arguments passed to the application.
+     */
+    void setArguments(const std::vector<std::string>& arguments);
+
 private:
+    /*
+     * \brief The contents of a definition file that are needed to load it.
+     */
+    struct Definition
+    {
+        time_t modification_time; //!< When the file was last modified when it was parsed.
+        std::string parent_id; //!< The ID of the definition that it inherits from, or an empty string if it doesn't inherit.
+        std::string parent_file; //!< The file that it inherits from, or an empty string if that wasn't found.
+        std::vector<std::pair<size_t, std::string>> extruder_trains; //!< For each extruder train in the metadata, its number and the file that defines it. The file is empty if no definition was given or it wasn't found.
+        std::vector<std::pair<std::string, std::string>> settings; //!< The keys and default values of all leaf settings, in order.
+    };
+
     /*
      * \brief The command line arguments that the application was called with.
      */
@@ -155,6 +182,23 @@ private:
      */
     unsigned int last_shown_progress;
 
+    /*
+     * \brief Start of the files of the on-disk definition cache: a magic
+     * string and a version number.
+     *
+     * After this, the cache file contains the parent ID, the parent file, the
+     * number of extruder trains followed by the number and file of each, and
+     * the number of settings followed by the key and value of each. Numbers
+     * are 32-bit little-endian. Strings are a number with their length,
+     * followed by their characters.
+     */
+    static constexpr char cache_header[] = { 'C', 'U', 'R', 'A', 'D', 'E', 'F', 1 };
+
+    /*
+     * \brief The definition files that were parsed so far, by file name.
+     */
+    std::unordered_map<std::string, Definition> definitions;
+
     /*
      * \brief Get the default search directories to search for definition files.
      * \return The default search directories to search for definition files.
@@ -172,21 +216,54 @@ private:
     int loadJSON(const std::string& json_filename, Settings& settings);
 
     /*
-     * \brief Load a JSON document and store the settings inside it.
-     * \param document The JSON document to load the settings from.
-     * \param settings The settings storage to store the settings in.
-     * \return Error code. If it's 0, the document was successfully loaded. If
-     * it's 1, some inheriting file could not be opened.
+     * \brief Get the parsed contents of a JSON file.
+     *
+     * The file is parsed only if it wasn't parsed before, or if it was
+     * modified since.
+     * \param json_filename The location of the JSON file.
+     * \param error_code Set to 1 if the file could not be opened, or to 2 if
+     * there was a syntax error in the file.
+     * \return The contents of the file, or ``nullptr`` if it couldn't be
+     * parsed.
+     */
+    const Definition* getDefinition(const std::string& json_filename, int& error_code);
+
+    /*
+     * \brief Read a definition from the on-disk cache.
+     * \param cache_file The file in the cache for the definition.
+     * \param definition The definition to fill with the cached contents. It's
+     * only changed if the whole cache file could be read.
+     * \return Whether the cache file exists and could be read completely.
+     */
+    static bool readCachedDefinition(const std::string& cache_file, Definition& definition);
+
+    /*
+     * \brief Store a definition in the on-disk cache.
+     *
+     * If that fails, a warning is logged but it's otherwise ignored. The
+     * definition just has to be parsed again the next time.
+     * \param cache_file The file in the cache for the definition.
+     * \param definition The definition to store.
+     */
+    static void writeCachedDefinition(const std::string& cache_file, const Definition& definition);
+
+    /*
+     * \brief Gather what is needed from a JSON document to load it.
+     * \param document The JSON document to gather the contents of.
+     * \param search_directories The directories to find the files that the
+     * document refers to in.
+     * \param definition The definition to store the contents in.
      */
-    int loadJSON(const rapidjson::Document& document, const std::unordered_set<std::string>& search_directories, Settings& settings);
+    void parseDefinition(const rapidjson::Document& document, const std::unordered_set<std::string>& search_directories, Definition& definition);
 
     /*
-     * \brief Load an element containing a list of settings.
+     * \brief Gather the settings of an element containing a list of settings.
      * \param element The JSON element "settings" or "overrides" that contains
      * settings.
-     * \param settings The settings storage to store the new settings in.
+     * \param settings The list to append the keys and values of the settings
+     * to.
      */
-    void loadJSONSettings(const rapidjson::Value& element, Settings& settings);
+    void loadJSONSettings(const rapidjson::Value& element, std::vector<std::pair<std::string, std::string>>& settings);
 
     /*
      * \brief Find a definition file in the search directories.
@@ -11,14 +11,21 @@
 namespace cura
 {
 
+Listener::Listener(const std::function<void ()>& on_event, const std::function<void ()>& on_message)
+: on_event(on_event)
+, on_message(on_message)
+{
+}
+
 void Listener::stateChanged(Arcus::SocketState)
 {
-    //Do nothing.
+    on_event();
 }
 
 void Listener::messageReceived()
 {
-    //Do nothing.
+    on_message();
+    on_event();
 }
 
 void Listener::error(const Arcus::Error& error)
@@ -31,6 +38,7 @@ void Listener::error(const Arcus::Error& error)
     {
         logError("%s\n", error.getErrorMessage().c_str());
     }
+    on_event();
 }
 
 } //namespace cura
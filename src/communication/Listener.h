@@ -6,6 +6,7 @@
 #ifdef ARCUS //Extends from Arcus::SocketListener, so only compile if we're using libArcus.
 
 #include <Arcus/SocketListener.h> //The class we're extending from.
+#include <functional> //For the callback of socket events.
 
 namespace cura
 {
@@ -18,19 +19,35 @@ class Listener : public Arcus::SocketListener
 {
 public:
     /*
-     * Changes the ``stateChanged`` signal to do nothing.
+     * Create a listener.
+     * \param on_event Called from the thread of the socket whenever a message
+     * is received, the state of the socket changes or an error occurs. This
+     * allows waiting for the socket without polling it.
+     * \param on_message Called from the thread of the socket whenever a
+     * message is received, before \p on_event. This allows reacting to new
+     * messages while the main thread is busy slicing.
+     */
+    Listener(const std::function<void ()>& on_event, const std::function<void ()>& on_message);
+
+    /*
+     * Changes the ``stateChanged`` signal to only report the event.
      */
     void stateChanged(Arcus::SocketState) override;
 
     /*
-     * Changes the ``messageReceived`` signal to do nothing.
+     * Changes the ``messageReceived`` signal to only report the message and
+     * the event.
      */
     void messageReceived() override;
 
     /*
-     * Log an error when we get one from libArcus.
+     * Log an error when we get one from libArcus, and report the event.
      */
     void error(const Arcus::Error& error) override;
+
+private:
+    std::function<void ()> on_event; //!< What to call when something happens on the socket.
+    std::function<void ()> on_message; //!< What to call when a message is received.
 };
 
 } //namespace cura
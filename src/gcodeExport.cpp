@@ -1,6 +1,7 @@
 //Copyright (c) 2021 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For std::min.
 #include <assert.h>
 #include <cmath>
 #include <iomanip>
@@ -15,6 +16,7 @@
 #include "communication/Communication.h" //To send layer view data.
 #include "settings/types/LayerIndex.h"
 #include "utils/Date.h"
+#include "utils/LayerStatistics.h"
 #include "utils/logoutput.h"
 #include "utils/string.h" // MMtoStream, PrecisionedDouble
 #include "WipeScriptConfig.h"
@@ -35,6 +37,8 @@ std::string transliterate(const std::string& text)
 
 GCodeExport::GCodeExport()
 : output_stream(&std::cout)
+, packed_output_stream(nullptr)
+, layer_target_stream(nullptr)
 , currentPosition(0,0,MM2INT(20))
 , layer_nr(0)
 , relative_extrusion(false)
@@ -278,6 +282,31 @@ std::string GCodeExport::getFileHeader(const std::vector<bool>& extruder_is_used
 }
 
 
+std::string GCodeExport::padFileHeader(const std::string& header, const size_t size) const
+{
+    constexpr size_t max_line_length = 80; //Keep the lines short, for firmware that reads a limited number of characters per line.
+    const size_t min_line_length = 1 + new_line.size(); //Just the semicolon.
+    if (header.size() > size || (header.size() < size && header.size() + min_line_length > size))
+    {
+        return "";
+    }
+    std::string result = header;
+    result.reserve(size);
+    while (result.size() < size)
+    {
+        const size_t remaining = size - result.size();
+        size_t line_length = std::min(max_line_length, remaining);
+        if (remaining - line_length > 0 && remaining - line_length < min_line_length) //Leave enough for the last line.
+        {
+            line_length = remaining - min_line_length;
+        }
+        result += ';';
+        result.append(line_length - min_line_length, ' ');
+        result += new_line;
+    }
+    return result;
+}
+
 void GCodeExport::setLayerNr(unsigned int layer_nr_) {
     layer_nr = layer_nr_;
 }
@@ -285,9 +314,62 @@ void GCodeExport::setLayerNr(unsigned int layer_nr_) {
 void GCodeExport::setOutputStream(std::ostream* stream)
 {
     output_stream = stream;
+    packed_output_stream = dynamic_cast<PackedMoveStream*>(stream);
     *output_stream << std::fixed;
 }
 
+void GCodeExport::flushOutputStream()
+{
+    output_stream->flush();
+}
+
+void GCodeExport::startLayerBuffer()
+{
+    assert(!layer_target_stream && "The previous layer buffer must be finished before starting a new one.");
+    if (packed_output_stream)
+    {
+        return;
+    }
+    layer_target_stream = output_stream;
+    layer_packed_data = std::make_unique<std::stringstream>();
+    layer_stream = std::make_unique<PackedMoveStream>(layer_packed_data.get());
+    setOutputStream(layer_stream.get());
+}
+
+void GCodeExport::finishLayerBuffer()
+{
+    if (!layer_target_stream)
+    {
+        return; //Wasn't buffering.
+    }
+    setOutputStream(layer_target_stream);
+    layer_target_stream = nullptr;
+    layer_stream.reset(); //Destroying the packed stream writes the remaining text.
+
+    formatting_layers.push_back(std::async(std::launch::async, [packed_data = std::move(layer_packed_data)]()
+        {
+            std::ostringstream text;
+            text << std::fixed;
+            if (!PackedMoveStream::decode(*packed_data, text))
+            {
+                logError("Couldn't format the g-code of a layer.\n");
+            }
+            return text.str();
+        }));
+}
+
+bool GCodeExport::writeFormattedLayer(const size_t max_formatting)
+{
+    if (formatting_layers.size() <= max_formatting)
+    {
+        return false;
+    }
+    const std::string text = formatting_layers.front().get();
+    formatting_layers.pop_front();
+    output_stream->write(text.data(), text.size());
+    return true;
+}
+
 bool GCodeExport::getExtruderIsUsed(const int extruder_nr) const
 {
     assert(extruder_nr >= 0);
@@ -724,9 +806,13 @@ void GCodeExport::writeTravel(const coord_t x, const coord_t y, const coord_t z,
     const int display_width = extruder_attr[current_extruder].retraction_e_amount_current ? MM2INT(0.2) : MM2INT(0.1);
     const double layer_height = Application::getInstance().current_slice->scene.current_mesh_group->settings.get<double>("layer_height");
     Application::getInstance().communication->sendLineTo(travel_move_type, Point(x, y), display_width, layer_height, speed);
+    if (LayerStatistics::isEnabled() && currentPosition != no_point3)
+    {
+        LayerStatistics::add("travel distance (mm)", static_cast<int>(layer_nr), INT2MM((Point3(x, y, z) - currentPosition).vSize()));
+    }
 
-    *output_stream << "G0";
-    writeFXYZE(speed, x, y, z, current_e_value, travel_move_type);
+    constexpr bool is_extrusion = false;
+    writeFXYZE(is_extrusion, speed, x, y, z, current_e_value, travel_move_type);
 }
 
 void GCodeExport::writeExtrusion(const coord_t x, const coord_t y, const coord_t z, const Velocity& speed, const double extrusion_mm3_per_mm, const PrintFeatureType& feature, const bool update_extrusion_offset)
@@ -796,33 +882,160 @@ void GCodeExport::writeExtrusion(const coord_t x, const coord_t y, const coord_t
     extruder_attr[current_extruder].last_e_value_after_wipe += extrusion_per_mm * diff_length;
     const double new_e_value = current_e_value + extrusion_per_mm * diff_length;
 
-    *output_stream << "G1";
-    writeFXYZE(speed, x, y, z, new_e_value, feature);
+    constexpr bool is_extrusion = true;
+    writeFXYZE(is_extrusion, speed, x, y, z, new_e_value, feature);
+}
+
+bool GCodeExport::supportsArcs() const
+{
+    return flavor != EGCodeFlavor::BFB && !packed_output_stream;
 }
 
-void GCodeExport::writeFXYZE(const Velocity& speed, const coord_t x, const coord_t y, const coord_t z, const double e, const PrintFeatureType& feature)
+void GCodeExport::writeExtrusionArc(const Point& p, const Point& center, const bool counter_clockwise, const Velocity& speed, const double extrusion_mm3_per_mm, const PrintFeatureType& feature, const bool update_extrusion_offset)
 {
-    if (currentSpeed != speed)
+    assert(supportsArcs());
+    const coord_t z = current_layer_z;
+    if (currentPosition.x == p.X && currentPosition.y == p.Y && currentPosition.z == z)
     {
-        *output_stream << " F" << PrecisionedDouble{1, speed * 60};
-        currentSpeed = speed;
+        return;
     }
 
+    const double extrusion_per_mm = mm3ToE(extrusion_mm3_per_mm);
+
+    if (is_z_hopped > 0)
+    {
+        writeZhopEnd();
+    }
+
+    //The angle that the arc sweeps around its center, positive if counter-clockwise.
+    const Point start(currentPosition.x, currentPosition.y);
+    const double start_angle = std::atan2(start.Y - center.Y, start.X - center.X);
+    double swept_angle = std::atan2(p.Y - center.Y, p.X - center.X) - start_angle;
+    if (counter_clockwise && swept_angle <= 0)
+    {
+        swept_angle += 2 * M_PI;
+    }
+    else if (!counter_clockwise && swept_angle >= 0)
+    {
+        swept_angle -= 2 * M_PI;
+    }
+    const double radius = vSizeMM(start - center);
+    const double arc_length = std::abs(swept_angle) * radius;
+
+    writeUnretractionAndPrime();
+
+    //flow rate compensation
+    double extrusion_offset = speed * extrusion_mm3_per_mm * extrusion_offset_factor;
+    if (extrusion_offset > max_extrusion_offset)
+    {
+        extrusion_offset = max_extrusion_offset;
+    }
+    // write new value of extrusion_offset, which will be remembered.
+    if (update_extrusion_offset && (extrusion_offset != current_e_offset))
+    {
+        current_e_offset = extrusion_offset;
+        *output_stream << ";FLOW_RATE_COMPENSATED_OFFSET = " << current_e_offset << new_line;
+    }
+
+    extruder_attr[current_extruder].last_e_value_after_wipe += extrusion_per_mm * arc_length;
+    const double new_e_value = current_e_value + extrusion_per_mm * arc_length;
+
+    const Point gcode_pos = getGcodePos(p.X, p.Y, current_extruder);
+    const bool speed_changes = currentSpeed != speed;
+    const bool z_changes = z != currentPosition.z;
+    const bool e_changes = new_e_value + current_e_offset != current_e_value;
+    const double output_e = (relative_extrusion) ? new_e_value + current_e_offset - current_e_value : new_e_value + current_e_offset;
+
+    move_buffer = counter_clockwise ? "G3" : "G2";
+    if (speed_changes)
+    {
+        move_buffer += " F";
+        writeDoubleToString(1, speed * 60, move_buffer);
+    }
+    move_buffer += " X";
+    writeInt2mm(gcode_pos.X, move_buffer);
+    move_buffer += " Y";
+    writeInt2mm(gcode_pos.Y, move_buffer);
+    if (z_changes)
+    {
+        move_buffer += " Z";
+        writeInt2mm(z, move_buffer);
+    }
+    //The center is relative to the start, so the extruder offset doesn't matter for it.
+    move_buffer += " I";
+    writeInt2mm(center.X - start.X, move_buffer);
+    move_buffer += " J";
+    writeInt2mm(center.Y - start.Y, move_buffer);
+    if (e_changes)
+    {
+        move_buffer += ' ';
+        move_buffer += extruder_attr[current_extruder].extruderCharacter;
+        writeDoubleToString(5, output_e, move_buffer);
+    }
+    move_buffer += new_line;
+    output_stream->write(move_buffer.data(), move_buffer.size());
+
+    //Estimate the time and the bounding box along the arc, in steps of at most 10 degrees.
+    const size_t step_count = std::max(size_t(1), static_cast<size_t>(std::ceil(std::abs(swept_angle) / (M_PI / 18))));
+    const double start_e = current_e_value;
+    for (size_t step = 1; step <= step_count; step++)
+    {
+        const double fraction = static_cast<double>(step) / step_count;
+        const double angle = start_angle + swept_angle * fraction;
+        const Point on_arc = (step == step_count) ? p : center + Point(std::llrint(std::cos(angle) * MM2INT(radius)), std::llrint(std::sin(angle) * MM2INT(radius)));
+        const Point on_arc_gcode = getGcodePos(on_arc.X, on_arc.Y, current_extruder);
+        total_bounding_box.include(Point3(on_arc_gcode.X, on_arc_gcode.Y, z));
+        estimateCalculator.plan(TimeEstimateCalculator::Position(INT2MM(on_arc.X), INT2MM(on_arc.Y), INT2MM(z), eToMm(start_e + (new_e_value - start_e) * fraction)), speed, feature);
+    }
+
+    currentSpeed = speed;
+    currentPosition = Point3(p.X, p.Y, z);
+    current_e_value = new_e_value;
+}
+
+void GCodeExport::writeFXYZE(const bool is_extrusion, const Velocity& speed, const coord_t x, const coord_t y, const coord_t z, const double e, const PrintFeatureType& feature)
+{
     Point gcode_pos = getGcodePos(x, y, current_extruder);
     total_bounding_box.include(Point3(gcode_pos.X, gcode_pos.Y, z));
+    const bool speed_changes = currentSpeed != speed;
+    const bool z_changes = z != currentPosition.z;
+    const bool e_changes = e + current_e_offset != current_e_value;
+    const double output_e = (relative_extrusion)? e + current_e_offset - current_e_value : e + current_e_offset;
 
-    *output_stream << " X" << MMtoStream{gcode_pos.X} << " Y" << MMtoStream{gcode_pos.Y};
-    if (z != currentPosition.z)
+    if (packed_output_stream)
     {
-        *output_stream << " Z" << MMtoStream{z};
+        const double feedrate = speed_changes ? static_cast<double>(speed * 60) : -1.0; //Negative if it doesn't change.
+        packed_output_stream->writeMove(is_extrusion, feedrate, gcode_pos.X, gcode_pos.Y, z, z_changes, extruder_attr[current_extruder].extruderCharacter, output_e, e_changes, feature, new_line);
     }
-    if (e + current_e_offset != current_e_value)
+    else
     {
-        const double output_e = (relative_extrusion)? e + current_e_offset - current_e_value : e + current_e_offset;
-        *output_stream << " " << extruder_attr[current_extruder].extruderCharacter << PrecisionedDouble{5, output_e};
+        //Compose the move in a buffer, since this is written for every move and streaming each part separately is slow.
+        move_buffer = is_extrusion ? "G1" : "G0";
+        if (speed_changes)
+        {
+            move_buffer += " F";
+            writeDoubleToString(1, speed * 60, move_buffer);
+        }
+        move_buffer += " X";
+        writeInt2mm(gcode_pos.X, move_buffer);
+        move_buffer += " Y";
+        writeInt2mm(gcode_pos.Y, move_buffer);
+        if (z_changes)
+        {
+            move_buffer += " Z";
+            writeInt2mm(z, move_buffer);
+        }
+        if (e_changes)
+        {
+            move_buffer += ' ';
+            move_buffer += extruder_attr[current_extruder].extruderCharacter;
+            writeDoubleToString(5, output_e, move_buffer);
+        }
+        move_buffer += new_line;
+        output_stream->write(move_buffer.data(), move_buffer.size());
     }
-    *output_stream << new_line;
-    
+
+    currentSpeed = speed;
     currentPosition = Point3(x, y, z);
     current_e_value = e;
     estimateCalculator.plan(TimeEstimateCalculator::Position(INT2MM(x), INT2MM(y), INT2MM(z), eToMm(e)), speed, feature);
@@ -1396,6 +1609,7 @@ void GCodeExport::writeJerk(const Velocity& jerk)
 
 void GCodeExport::finalize(const char* endCode)
 {
+    while (writeFormattedLayer()) { } //Layers that were still formatting come before the end code.
     writeFanCommand(0);
     writeCode(endCode);
     int64_t print_time = getSumTotalPrintTimes();
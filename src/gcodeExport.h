@@ -5,12 +5,15 @@
 #define GCODEEXPORT_H
 
 #include <deque> // for extrusionAmountAtPreviousRetractions
+#include <future> //To format layers on other threads.
+#include <memory> //For unique_ptr.
 #ifdef BUILD_TESTS
     #include <gtest/gtest_prod.h> //To allow tests to use protected members.
 #endif
 #include <sstream> // for stream.str()
 #include <stdio.h>
 
+#include "PackedMoveStream.h" //To write moves in binary form if requested.
 #include "utils/AABB3D.h" //To track the used build volume for the Griffin header.
 #include "timeEstimate.h"
 #include "settings/EnumSettings.h"
@@ -62,6 +65,9 @@ class GCodeExport : public NoCopy
     FRIEND_TEST(GCodeExportTest, insertWipeScriptOptionalDelay);
     FRIEND_TEST(GCodeExportTest, insertWipeScriptRetractionEnable);
     FRIEND_TEST(GCodeExportTest, insertWipeScriptHopEnable);
+    FRIEND_TEST(GCodeExportTest, PackedMovesDecodeToSameGCode);
+    FRIEND_TEST(GCodeExportTest, LayerBufferWritesSameGCode);
+    FRIEND_TEST(GCodeExportTest, WriteExtrusionArc);
 #endif
 private:
     struct ExtruderTrainAttributes
@@ -112,7 +118,14 @@ private:
     std::string machine_buildplate_type;
 
     std::ostream* output_stream;
+    PackedMoveStream* packed_output_stream; //!< If the output stream stores moves in binary form, the same stream as output_stream. Otherwise nullptr.
     std::string new_line;
+    std::string move_buffer; //!< Reused to compose each move in, so that it can be written to the output stream at once.
+
+    std::ostream* layer_target_stream; //!< While a layer is buffered, the stream that the g-code is eventually written to. Otherwise nullptr.
+    std::unique_ptr<std::stringstream> layer_packed_data; //!< While a layer is buffered, the packed moves and text of that layer.
+    std::unique_ptr<PackedMoveStream> layer_stream; //!< While a layer is buffered, the stream that packs the g-code into \ref layer_packed_data.
+    std::deque<std::future<std::string>> formatting_layers; //!< The text of the layers that were buffered but not yet written to the output stream, oldest first.
 
     double current_e_value; //!< The last E value written to gcode (in mm or mm^3)
 
@@ -227,10 +240,63 @@ public:
      */
     std::string getFileHeader(const std::vector<bool>& extruder_is_used, const Duration* print_time = nullptr, const std::vector<double>& filament_used = std::vector<double>(), const std::vector<std::string>& mat_ids = std::vector<std::string>());
 
+    /*!
+     * Pad a file header with empty comment lines to a fixed size.
+     *
+     * This allows writing a placeholder header before the print time and
+     * material usage are known, and replacing it with the final header in the
+     * file afterwards.
+     * \param header The file header, as given by \ref getFileHeader .
+     * \param size The number of bytes the result must have.
+     * \return The padded header, or an empty string if the header doesn't fit.
+     */
+    std::string padFileHeader(const std::string& header, const size_t size) const;
+
     void setLayerNr(unsigned int layer_nr);
 
     void setOutputStream(std::ostream* stream);
 
+    /*!
+     * Make sure that everything written so far reaches whatever the output
+     * stream writes to, such as a file or a pipe to a printer.
+     */
+    void flushOutputStream();
+
+    /*!
+     * Start buffering the g-code of a layer, so that its moves can be
+     * formatted as text on another thread.
+     *
+     * Until \ref finishLayerBuffer is called, everything is written to a
+     * buffer in the compact form of \ref PackedMoveStream instead of to the
+     * output stream. That keeps all of the state (E values, position, feedrate,
+     * retraction) on the thread that writes the layer, while the expensive
+     * conversion of the numbers to text is done in parallel.
+     *
+     * Does nothing if the output stream is packed already, since then the
+     * moves are never formatted as text.
+     */
+    void startLayerBuffer();
+
+    /*!
+     * Stop buffering the current layer, and start formatting it as text on
+     * another thread.
+     *
+     * Nothing else may be written to the output stream until the text of the
+     * layer is written there with \ref writeFormattedLayer .
+     */
+    void finishLayerBuffer();
+
+    /*!
+     * Write the text of the oldest buffered layer to the output stream, if
+     * more layers are being formatted than allowed.
+     *
+     * This waits for the layer to be formatted if it's not done yet.
+     * \param max_formatting How many layers may still be formatting
+     * afterwards.
+     * \return Whether a layer was written.
+     */
+    bool writeFormattedLayer(const size_t max_formatting = 0);
+
     bool getExtruderIsUsed(const int extruder_nr) const; //!< return whether the extruder has been used throughout printing all meshgroup up till now
 
     Point getGcodePos(const coord_t x, const coord_t y, const int extruder_train) const;
@@ -364,6 +430,33 @@ public:
      * \param update_extrusion_offset whether to update the extrusion offset to match the current flow rate
      */
     void writeExtrusion(const Point3& p, const Velocity& speed, double extrusion_mm3_per_mm, PrintFeatureType feature, bool update_extrusion_offset = false);
+
+    /*!
+     * Whether arc moves can be written with \ref writeExtrusionArc. The BFB
+     * flavor and the binary output of moves only have straight moves.
+     */
+    bool supportsArcs() const;
+
+    /*!
+     * Write an extrusion move along a circular arc (G2 or G3) at the height of
+     * the current layer.
+     * Perform un-z-hop
+     * Perform unretraction
+     *
+     * The extruded amount is for the length of the arc, not of the chord.
+     * Coordinates are build plate coordinates, which might be offsetted when extruder offsets are encoded in the gcode.
+     *
+     * \param p location to go to
+     * \param center The center of the circle that the arc is part of. It must
+     * be about as far from the current position as from \p p.
+     * \param counter_clockwise Whether the arc turns counter-clockwise (G3)
+     * rather than clockwise (G2).
+     * \param speed movement speed
+     * \param extrusion_mm3_per_mm flow
+     * \param feature the feature that's currently printing
+     * \param update_extrusion_offset whether to update the extrusion offset to match the current flow rate
+     */
+    void writeExtrusionArc(const Point& p, const Point& center, const bool counter_clockwise, const Velocity& speed, const double extrusion_mm3_per_mm, const PrintFeatureType& feature, const bool update_extrusion_offset = false);
 private:
     /*!
      * Coordinates are build plate coordinates, which might be offsetted when extruder offsets are encoded in the gcode.
@@ -400,8 +493,11 @@ private:
      * This function updates the \ref GCodeExport::total_bounding_box
      * It estimates the time in \ref GCodeExport::estimateCalculator for the correct feature
      * It updates \ref GCodeExport::currentPosition, \ref GCodeExport::current_e_value and \ref GCodeExport::currentSpeed
+     *
+     * \param is_extrusion Whether to write a G1 command rather than a G0
+     * command.
      */
-    void writeFXYZE(const Velocity& speed, const coord_t x, const coord_t y, const coord_t z, const double e, const PrintFeatureType& feature);
+    void writeFXYZE(const bool is_extrusion, const Velocity& speed, const coord_t x, const coord_t y, const coord_t z, const double e, const PrintFeatureType& feature);
 
     /*!
      * The writeTravel and/or writeExtrusion when flavor == BFB
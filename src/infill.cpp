@@ -3,12 +3,12 @@
 
 #include <algorithm> //For std::sort.
 #include <functional>
-#include <unordered_set>
 
 #include "WallToolPaths.h"
 #include "infill.h"
 #include "infill/GyroidInfill.h"
 #include "infill/ImageBasedDensityProvider.h"
+#include "infill/InfillCache.h"
 #include "infill/NoZigZagConnectorProcessor.h"
 #include "infill/LightningGenerator.h"
 #include "infill/SierpinskiFill.h"
@@ -21,6 +21,7 @@
 #include "utils/polygonUtils.h"
 #include "utils/PolylineStitcher.h"
 #include "utils/Simplify.h"
+#include "utils/Trace.h"
 #include "utils/UnionFind.h"
 
 /*!
@@ -66,13 +67,34 @@ Polygons Infill::generateWallToolPaths(std::vector<VariableWidthLines>& toolpath
     return inner_contour;
 }
 
-void Infill::generate(std::vector<VariableWidthLines>& toolpaths, Polygons& result_polygons, Polygons& result_lines, const Settings& settings, const SierpinskiFillProvider* cross_fill_provider, const LightningLayer* lightning_trees, const SliceMeshStorage* mesh)
+void Infill::generate(std::vector<VariableWidthLines>& toolpaths, Polygons& result_polygons, Polygons& result_lines, const Settings& settings, const SierpinskiFillProvider* cross_fill_provider, const LightningLayer* lightning_trees, const SliceMeshStorage* mesh, InfillCache* cache)
 {
+    TraceZone zone("infill");
     if (outer_contour.empty())
     {
         return;
     }
 
+    //Connecting the polygons also connects the ones that were in the output before, so then the result isn't only made from this area.
+    if (cache && isLayerIndependent() && (!connect_polygons || (toolpaths.empty() && result_polygons.empty())))
+    {
+        const InfillCache::Parameters parameters{pattern, zig_zaggify, connect_polygons, infill_line_width, line_distance, infill_overlap, infill_multiplier, fill_angle, shift, max_resolution, max_deviation,
+            wall_line_count, infill_origin, skip_line_stitching, connected_zigzags, use_endpieces, skip_some_zags, zag_skip_count, pocket_size, parallel_tile_size, &settings};
+        std::shared_ptr<const InfillCache::Result> cached = cache->find(outer_contour, parameters);
+        if (!cached)
+        {
+            const Polygons area = outer_contour; //Generating the infill offsets the contour.
+            std::shared_ptr<InfillCache::Result> generated = std::make_shared<InfillCache::Result>();
+            generate(generated->toolpaths, generated->polygons, generated->lines, settings, cross_fill_provider, lightning_trees, mesh);
+            cache->insert(area, parameters, generated);
+            cached = std::move(generated);
+        }
+        toolpaths.insert(toolpaths.end(), cached->toolpaths.begin(), cached->toolpaths.end());
+        result_polygons.add(cached->polygons);
+        result_lines.add(cached->lines);
+        return;
+    }
+
     inner_contour =
         generateWallToolPaths(toolpaths, outer_contour, wall_line_count, infill_line_width, infill_overlap, settings);
 
@@ -185,6 +207,134 @@ void Infill::_generate(std::vector<VariableWidthLines>& toolpaths, Polygons& res
     if (inner_contour.empty()) return;
     if (line_distance == 0) return;
 
+    const AABB boundary(inner_contour);
+    if (parallel_tile_size > 0 && canGenerateInTiles() && boundary.max.X - boundary.min.X > parallel_tile_size)
+    {
+        generateInTiles(result_polygons, result_lines, settings, cross_fill_provider, lightning_trees, mesh);
+    }
+    else
+    {
+        generatePattern(toolpaths, result_polygons, result_lines, settings, cross_fill_provider, lightning_trees, mesh);
+    }
+
+    if (connect_lines)
+    {
+        //The list should be empty because it will be again filled completely. Otherwise might have double lines.
+        assert(result_lines.empty());
+        result_lines.clear();
+        connectLines(result_lines);
+    }
+
+    Simplify simplifier(max_resolution, max_deviation, 0);
+    result_polygons = simplifier.polygon(result_polygons);
+
+    if(!skip_line_stitching && (zig_zaggify ||
+        pattern == EFillMethod::CROSS || pattern == EFillMethod::CROSS_3D || pattern == EFillMethod::CUBICSUBDIV || pattern == EFillMethod::GYROID || pattern == EFillMethod::ZIG_ZAG))
+    { // don't stich for non-zig-zagged line infill types
+        Polygons stitched_lines;
+        PolylineStitcher<Polygons, Polygon, Point>::stitch(result_lines, stitched_lines, result_polygons, infill_line_width);
+        result_lines = stitched_lines;
+    }
+    result_lines = simplifier.polyline(result_lines);
+}
+
+bool Infill::isLayerIndependent() const
+{
+    switch(pattern)
+    {
+    case EFillMethod::GRID:
+    case EFillMethod::LINES:
+    case EFillMethod::TRIANGLES:
+    case EFillMethod::TRIHEXAGON:
+    case EFillMethod::CONCENTRIC:
+    case EFillMethod::ZIG_ZAG:
+        return true;
+    default: //Cubic, tetrahedral, gyroid, cross etc. shift with the height, and Lightning and Cubic Subdivision depend on the layer.
+        return false;
+    }
+}
+
+bool Infill::canGenerateInTiles() const
+{
+    if (zig_zaggify || connect_lines)
+    {
+        return false;
+    }
+    switch(pattern)
+    {
+    case EFillMethod::GRID:
+    case EFillMethod::LINES:
+    case EFillMethod::CUBIC:
+    case EFillMethod::TETRAHEDRAL:
+    case EFillMethod::QUARTER_CUBIC:
+    case EFillMethod::TRIANGLES:
+    case EFillMethod::TRIHEXAGON:
+    case EFillMethod::GYROID:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void Infill::generateInTiles(Polygons& result_polygons, Polygons& result_lines, const Settings& settings, const SierpinskiFillProvider* cross_fill_provider, const LightningLayer* lightning_trees, const SliceMeshStorage* mesh)
+{
+    const AABB boundary(inner_contour);
+    const size_t tile_count = (boundary.max.X - boundary.min.X) / parallel_tile_size + 1;
+    std::vector<Polygons> polygons_per_tile(tile_count);
+    std::vector<Polygons> lines_per_tile(tile_count);
+    //This is called from the parallel loops over the layers too. OpenMP doesn't nest by default, so there the tiles are generated on the thread of the layer.
+    #pragma omp parallel for default(none) shared(boundary, tile_count, polygons_per_tile, lines_per_tile, settings, cross_fill_provider, lightning_trees, mesh) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int tile_idx = 0; tile_idx < static_cast<int>(tile_count); tile_idx++)
+    {
+        const coord_t min_x = boundary.min.X + static_cast<coord_t>(tile_idx) * parallel_tile_size;
+        const AABB tile(Point(min_x, boundary.min.Y - 1), Point(min_x + parallel_tile_size, boundary.max.Y + 1));
+
+        Infill tile_infill(*this); //The pattern is at the same positions in every tile, since it only depends on the settings and not on the area.
+        Polygons tile_area;
+        tile_area.add(tile.toPolygon());
+        tile_infill.inner_contour = inner_contour.intersection(tile_area);
+        if (tile_infill.inner_contour.empty())
+        {
+            continue;
+        }
+        std::vector<VariableWidthLines> tile_toolpaths; //Not used by any of the patterns that can be tiled.
+        tile_infill.generatePattern(tile_toolpaths, polygons_per_tile[tile_idx], lines_per_tile[tile_idx], settings, cross_fill_provider, lightning_trees, mesh);
+    }
+
+    //Lines that cross a border between tiles got cut there, so those ends need to be stitched back together.
+    constexpr coord_t border_snap_distance = 10; //Both halves of a cut line end on the border, save for rounding.
+    const auto is_on_tile_border = [&boundary, border_snap_distance, this](const Point& p)
+    {
+        const coord_t x_in_tile = (p.X - boundary.min.X) % parallel_tile_size;
+        return std::min(x_in_tile, parallel_tile_size - x_in_tile) <= border_snap_distance;
+    };
+    Polygons cut_lines;
+    for (size_t tile_idx = 0; tile_idx < tile_count; tile_idx++)
+    {
+        result_polygons.add(polygons_per_tile[tile_idx]);
+        for (PolygonRef line : lines_per_tile[tile_idx])
+        {
+            if (line.empty())
+            {
+                continue;
+            }
+            if (is_on_tile_border(line.front()) || is_on_tile_border(line.back()))
+            {
+                cut_lines.add(line);
+            }
+            else
+            {
+                result_lines.add(line);
+            }
+        }
+    }
+    PolylineStitcher<Polygons, Polygon, Point>::stitch(cut_lines, result_lines, result_polygons, border_snap_distance * 2, border_snap_distance);
+}
+
+void Infill::generatePattern(std::vector<VariableWidthLines>& toolpaths, Polygons& result_polygons, Polygons& result_lines, const Settings& settings, const SierpinskiFillProvider* cross_fill_provider, const LightningLayer * lightning_trees, const SliceMeshStorage* mesh)
+{
+    rotated_outlines.clear(); //The inner contour may have changed since the last pattern, such as in each tile.
     switch(pattern)
     {
     case EFillMethod::GRID:
@@ -242,26 +392,6 @@ void Infill::_generate(std::vector<VariableWidthLines>& toolpaths, Polygons& res
         logError("Fill pattern has unknown value.\n");
         break;
     }
-
-    if (connect_lines)
-    {
-        //The list should be empty because it will be again filled completely. Otherwise might have double lines.
-        assert(result_lines.empty());
-        result_lines.clear();
-        connectLines(result_lines);
-    }
-
-    Simplify simplifier(max_resolution, max_deviation, 0);
-    result_polygons = simplifier.polygon(result_polygons);
-
-    if(!skip_line_stitching && (zig_zaggify ||
-        pattern == EFillMethod::CROSS || pattern == EFillMethod::CROSS_3D || pattern == EFillMethod::CUBICSUBDIV || pattern == EFillMethod::GYROID || pattern == EFillMethod::ZIG_ZAG))
-    { // don't stich for non-zig-zagged line infill types
-        Polygons stitched_lines;
-        PolylineStitcher<Polygons, Polygon, Point>::stitch(result_lines, stitched_lines, result_polygons, infill_line_width);
-        result_lines = stitched_lines;
-    }
-    result_lines = simplifier.polyline(result_lines);
 }
 
 void Infill::multiplyInfill(Polygons& result_polygons, Polygons& result_lines)
@@ -463,20 +593,21 @@ void Infill::generateCrossInfill(const SierpinskiFillProvider& cross_fill_provid
     }
 }
 
-void Infill::addLineInfill(Polygons& result, const PointMatrix& rotation_matrix, const int scanline_min_idx, const int line_distance, const AABB boundary, std::vector<std::vector<coord_t>>& cut_list, coord_t shift)
+void Infill::addLineInfill(Polygons& result, const PointMatrix& rotation_matrix, const int scanline_min_idx, const int line_distance, const AABB boundary, ScanlineCrossings<coord_t>& cut_list, coord_t shift)
 {
     assert(!connect_lines && "connectLines() should add the infill lines, not addLineInfill");
 
     unsigned int scanline_idx = 0;
     for(coord_t x = scanline_min_idx * line_distance + shift; x < boundary.max.X; x += line_distance)
     {
-        if (scanline_idx >= cut_list.size())
+        if (scanline_idx >= cut_list.scanlineCount())
         {
             break;
         }
-        std::vector<coord_t>& crossings = cut_list[scanline_idx];
-        std::sort(crossings.begin(), crossings.end()); // sort by increasing Y coordinates
-        for(unsigned int crossing_idx = 0; crossing_idx + 1 < crossings.size(); crossing_idx += 2)
+        const ScanlineCrossings<coord_t>::iterator crossings = cut_list.begin(scanline_idx);
+        const size_t crossing_count = cut_list.crossingCount(scanline_idx);
+        std::sort(crossings, cut_list.end(scanline_idx)); // sort by increasing Y coordinates
+        for(unsigned int crossing_idx = 0; crossing_idx + 1 < crossing_count; crossing_idx += 2)
         {
             if (crossings[crossing_idx + 1] - crossings[crossing_idx] < infill_line_width / 5)
             { // segment is too short to create infill
@@ -488,6 +619,22 @@ void Infill::addLineInfill(Polygons& result, const PointMatrix& rotation_matrix,
     }
 }
 
+const Infill::RotatedOutline& Infill::getRotatedOutline(const PointMatrix& rotation_matrix)
+{
+    for (const RotatedOutline& rotated_outline : rotated_outlines)
+    {
+        if (rotated_outline.cos_angle == rotation_matrix.matrix[0] && rotated_outline.sin_angle == rotation_matrix.matrix[2])
+        {
+            return rotated_outline;
+        }
+    }
+    Polygons outline = inner_contour; //Make a copy. We'll be rotating this outline.
+    outline.applyMatrix(rotation_matrix);
+    const AABB boundary(outline);
+    rotated_outlines.push_back(RotatedOutline{rotation_matrix.matrix[0], rotation_matrix.matrix[2], std::move(outline), boundary});
+    return rotated_outlines.back();
+}
+
 coord_t Infill::getShiftOffsetFromInfillOriginAndRotation(const double& infill_rotation)
 {
     if (infill_origin.X != 0 || infill_origin.Y != 0)
@@ -547,8 +694,9 @@ void Infill::generateLinearBasedInfill(Polygons& result, const int line_distance
         return;
     }
 
-    Polygons outline = inner_contour; //Make a copy. We'll be rotating this outline to make intersections always horizontal, for better performance.
-    outline.applyMatrix(rotation_matrix);
+    //The outline is rotated to make intersections always horizontal, for better performance.
+    const RotatedOutline& rotated_outline = getRotatedOutline(rotation_matrix);
+    const Polygons& outline = rotated_outline.outline;
 
     coord_t shift = extra_shift + this->shift;
     if (shift < 0)
@@ -560,12 +708,13 @@ void Infill::generateLinearBasedInfill(Polygons& result, const int line_distance
         shift = shift % line_distance;
     }
 
-    AABB boundary(outline);
+    const AABB& boundary = rotated_outline.boundary;
 
     int scanline_min_idx = computeScanSegmentIdx(boundary.min.X - shift, line_distance);
     int line_count = computeScanSegmentIdx(boundary.max.X - shift, line_distance) + 1 - scanline_min_idx;
 
-    std::vector<std::vector<coord_t>> cut_list(line_count); // mapping from scanline to all intersections with polygon segments
+    // Only one of these is filled: the crossings for connectLines, or the Y coordinates for addLineInfill.
+    ScanlineCrossings<coord_t> cut_list(scanline_min_idx, connect_lines ? 0 : line_count); // mapping from scanline to all intersections with polygon segments
 
     //When we find crossings, keep track of which crossing belongs to which scanline and to which polygon line segment.
     //Then we can later join two crossings together to form lines and still know what polygon line segments that infill line connected to.
@@ -580,21 +729,13 @@ void Infill::generateLinearBasedInfill(Polygons& result, const int line_distance
             return coordinate.Y < other.coordinate.Y;
         }
     };
-    std::vector<std::vector<Crossing>> crossings_per_scanline; //For each scanline, a list of crossings.
     const int min_scanline_index = computeScanSegmentIdx(boundary.min.X - shift, line_distance) + 1;
     const int max_scanline_index = computeScanSegmentIdx(boundary.max.X - shift, line_distance) + 1;
-    crossings_per_scanline.resize(max_scanline_index - min_scanline_index);
-    if (connect_lines) {
-        crossings_on_line.resize(outline.size()); //One for each polygon.
-    }
+    ScanlineCrossings<Crossing> crossings_per_scanline(min_scanline_index, connect_lines ? max_scanline_index - min_scanline_index : 0); //For each scanline, a list of crossings.
 
     for(size_t poly_idx = 0; poly_idx < outline.size(); poly_idx++)
     {
-        PolygonRef poly = outline[poly_idx];
-        if (connect_lines)
-        {
-            crossings_on_line[poly_idx].resize(poly.size()); // One for each line in this polygon.
-        }
+        ConstPolygonRef poly = outline[poly_idx];
         Point p0 = poly.back();
         zigzag_connector_processor.registerVertex(p0); // always adds the first point to ZigzagConnectorProcessorEndPieces::first_zigzag_connector when using a zigzag infill type
 
@@ -632,11 +773,16 @@ void Infill::generateLinearBasedInfill(Polygons& result, const int line_distance
             {
                 int x = scanline_idx * line_distance + shift;
                 int y = p1.Y + (p0.Y - p1.Y) * (x - p1.X) / (p0.X - p1.X);
-                assert(scanline_idx - scanline_min_idx >= 0 && scanline_idx - scanline_min_idx < int(cut_list.size()) && "reading infill cutlist index out of bounds!");
-                cut_list[scanline_idx - scanline_min_idx].push_back(y);
                 Point scanline_linesegment_intersection(x, y);
                 zigzag_connector_processor.registerScanlineSegmentIntersection(scanline_linesegment_intersection, scanline_idx);
-                crossings_per_scanline[scanline_idx - min_scanline_index].emplace_back(scanline_linesegment_intersection, poly_idx, point_idx);
+                if (connect_lines)
+                {
+                    crossings_per_scanline.add(scanline_idx, Crossing(scanline_linesegment_intersection, poly_idx, point_idx));
+                }
+                else
+                {
+                    cut_list.add(scanline_idx, y);
+                }
             }
             zigzag_connector_processor.registerVertex(p1);
             p0 = p1;
@@ -645,14 +791,16 @@ void Infill::generateLinearBasedInfill(Polygons& result, const int line_distance
     }
     
     if (connect_lines) {
-        // Gather all crossings per scanline and find out which crossings belong together, then store them in crossings_on_line.
-        for (int scanline_index = min_scanline_index; scanline_index < max_scanline_index; scanline_index++)
+        crossings_per_scanline.groupPerScanline();
+        // Gather all crossings per scanline and find out which crossings belong together, then store them in line_segments.
+        for (size_t scanline = 0; scanline < crossings_per_scanline.scanlineCount(); scanline++)
         {
-            auto& crossings = crossings_per_scanline[scanline_index - min_scanline_index];
+            const ScanlineCrossings<Crossing>::iterator crossings = crossings_per_scanline.begin(scanline);
+            const long crossing_count = crossings_per_scanline.crossingCount(scanline);
             // Sorts them by Y coordinate.
-            std::sort(crossings.begin(), crossings.end());
+            std::sort(crossings, crossings_per_scanline.end(scanline));
             // Combine each 2 subsequent crossings together.
-            for (long crossing_index = 0; crossing_index < static_cast<long>(crossings.size()) - 1; crossing_index += 2)
+            for (long crossing_index = 0; crossing_index < crossing_count - 1; crossing_index += 2)
             {
                 const Crossing& first = crossings[crossing_index];
                 const Crossing& second = crossings[crossing_index + 1];
@@ -663,20 +811,19 @@ void Infill::generateLinearBasedInfill(Polygons& result, const int line_distance
                 {
                     continue;
                 }
-                InfillLineSegment* new_segment = new InfillLineSegment(unrotated_first, first.vertex_index, first.polygon_index, unrotated_second, second.vertex_index, second.polygon_index);
-                // Put the same line segment in the data structure twice: Once for each of the polygon line segment that it crosses.
-                crossings_on_line[first.polygon_index][first.vertex_index].push_back(new_segment);
-                crossings_on_line[second.polygon_index][second.vertex_index].push_back(new_segment);
+                // connectLines finds the polygon line segments that it crosses back from the start and end indices.
+                line_segments.emplace_back(unrotated_first, first.vertex_index, first.polygon_index, unrotated_second, second.vertex_index, second.polygon_index);
             }
         }
     }
     else
     {
-        if (cut_list.size() == 0)
+        if (cut_list.scanlineCount() == 0)
         {
             return;
         }
-        if (connected_zigzags && cut_list.size() == 1 && cut_list[0].size() <= 2)
+        cut_list.groupPerScanline();
+        if (connected_zigzags && cut_list.scanlineCount() == 1 && cut_list.crossingCount(0) <= 2)
         {
             return;  // don't add connection if boundary already contains whole outline!
         }
@@ -688,20 +835,53 @@ void Infill::generateLinearBasedInfill(Polygons& result, const int line_distance
 
 void Infill::connectLines(Polygons& result_lines)
 {
-    UnionFind<InfillLineSegment*> connected_lines; //Keeps track of which lines are connected to which.
-    for (const std::vector<std::vector<InfillLineSegment*>>& crossings_on_polygon : crossings_on_line)
+    constexpr size_t no_segment = InfillLineSegment::no_segment;
+
+    //All line segments so far are the infill lines that cross the outline. Gather them per polygon line segment that they cross, in one flat list.
+    //They are gathered in the order in which they were created, once for each polygon line segment that they cross.
+    const size_t crossing_line_count = line_segments.size();
+    std::vector<size_t> polygon_starts(inner_contour.size() + 1, 0); //For each polygon, the index of its first polygon line segment in the flat list.
+    for (size_t polygon_index = 0; polygon_index < inner_contour.size(); polygon_index++)
     {
-        for (const std::vector<InfillLineSegment*>& crossings_on_polygon_segment : crossings_on_polygon)
+        polygon_starts[polygon_index + 1] = polygon_starts[polygon_index] + inner_contour[polygon_index].size();
+    }
+    std::vector<size_t> crossing_starts(polygon_starts.back() + 1, 0); //For each polygon line segment, where its crossings start in crossings.
+    for (const InfillLineSegment& infill_line : line_segments)
+    {
+        assert(infill_line.start_polygon < inner_contour.size() && infill_line.end_polygon < inner_contour.size() && "crossings dimension should be bigger then polygon index");
+        crossing_starts[polygon_starts[infill_line.start_polygon] + infill_line.start_segment + 1]++;
+        crossing_starts[polygon_starts[infill_line.end_polygon] + infill_line.end_segment + 1]++;
+    }
+    for (size_t polygon_segment = 0; polygon_segment + 1 < crossing_starts.size(); polygon_segment++)
+    {
+        crossing_starts[polygon_segment + 1] += crossing_starts[polygon_segment];
+    }
+    std::vector<size_t> crossings(crossing_line_count * 2); //For each polygon line segment, the indices of the infill lines crossing it.
+    {
+        std::vector<size_t> crossing_fill(crossing_starts.begin(), crossing_starts.end() - 1);
+        for (size_t line_index = 0; line_index < crossing_line_count; line_index++)
         {
-            for (InfillLineSegment* infill_line : crossings_on_polygon_segment)
+            const InfillLineSegment& infill_line = line_segments[line_index];
+            crossings[crossing_fill[polygon_starts[infill_line.start_polygon] + infill_line.start_segment]++] = line_index;
+            crossings[crossing_fill[polygon_starts[infill_line.end_polygon] + infill_line.end_segment]++] = line_index;
+        }
+    }
+
+    IndexUnionFind connected_lines(crossing_line_count); //Keeps track of which lines are connected to which. Every crossing infill line starts in a separate set, with its index.
+    std::vector<size_t> line_order; //The crossing infill lines in the order that they are first crossed by the outline, which is the order in which they are output.
+    line_order.reserve(crossing_line_count);
+    {
+        std::vector<bool> is_ordered(crossing_line_count, false);
+        for (const size_t line_index : crossings)
+        {
+            if (!is_ordered[line_index])
             {
-                if (connected_lines.find(infill_line) == (size_t)-1)
-                {
-                    connected_lines.add(infill_line); //Put every line in there as a separate set.
-                }
+                is_ordered[line_index] = true;
+                line_order.push_back(line_index);
             }
         }
     }
+    line_segments.reserve(crossing_line_count * 3); //Roughly one connecting line and one extra vertex for each infill line.
 
     for (size_t polygon_index = 0; polygon_index < inner_contour.size(); polygon_index++)
     {
@@ -710,29 +890,34 @@ void Infill::connectLines(Polygons& result_lines)
         {
             continue;
         }
-        assert(crossings_on_line.size() > polygon_index && "crossings dimension should be bigger then polygon index");
-        std::vector<std::vector<InfillLineSegment*>>& crossings_on_polygon = crossings_on_line[polygon_index];
-        InfillLineSegment* previous_crossing = nullptr; //The crossing that we should connect to. If nullptr, we have been skipping until we find the next crossing.
-        InfillLineSegment* previous_segment = nullptr; //The last segment we were connecting while drawing a line along the border.
+        size_t previous_crossing = no_segment; //The crossing that we should connect to. If no_segment, we have been skipping until we find the next crossing.
+        size_t previous_segment = no_segment; //The last segment we were connecting while drawing a line along the border.
         Point vertex_before = inner_contour_polygon.back();
         for (size_t vertex_index = 0; vertex_index < inner_contour_polygon.size(); vertex_index++)
         {
-            assert(crossings_on_polygon.size() > vertex_index && "crossings on line for the current polygon should be bigger then vertex index");
-            std::vector<InfillLineSegment*>& crossings_on_polygon_segment = crossings_on_polygon[vertex_index];
+            const std::vector<size_t>::iterator crossings_on_polygon_segment_begin = crossings.begin() + crossing_starts[polygon_starts[polygon_index] + vertex_index];
+            const std::vector<size_t>::iterator crossings_on_polygon_segment_end = crossings.begin() + crossing_starts[polygon_starts[polygon_index] + vertex_index + 1];
             Point vertex_after = inner_contour_polygon[vertex_index];
+            //Whether the start of a line segment is on this polygon line segment, rather than its end.
+            const auto starts_here = [this, polygon_index, vertex_index](const size_t segment_index)
+            {
+                const InfillLineSegment& segment = line_segments[segment_index];
+                return segment.start_segment == vertex_index && segment.start_polygon == polygon_index;
+            };
 
             //Sort crossings on every line by how far they are from their initial point.
-            std::sort(crossings_on_polygon_segment.begin(), crossings_on_polygon_segment.end(),
-                        [&vertex_before, polygon_index, vertex_index](InfillLineSegment* left_hand_side, InfillLineSegment* right_hand_side) {
+            std::sort(crossings_on_polygon_segment_begin, crossings_on_polygon_segment_end,
+                        [this, &vertex_before, &starts_here](const size_t left_hand_side, const size_t right_hand_side) {
                 // Find the two endpoints that are relevant.
-                const Point left_hand_point = (left_hand_side->start_segment == vertex_index && left_hand_side->start_polygon == polygon_index) ? left_hand_side->start : left_hand_side->end;
-                const Point right_hand_point = (right_hand_side->start_segment == vertex_index && right_hand_side->start_polygon == polygon_index) ? right_hand_side->start : right_hand_side->end;
+                const Point left_hand_point = starts_here(left_hand_side) ? line_segments[left_hand_side].start : line_segments[left_hand_side].end;
+                const Point right_hand_point = starts_here(right_hand_side) ? line_segments[right_hand_side].start : line_segments[right_hand_side].end;
                 return vSize(left_hand_point - vertex_before) < vSize(right_hand_point - vertex_before);
             });
 
-            for (InfillLineSegment* crossing : crossings_on_polygon_segment)
+            for (std::vector<size_t>::iterator crossing_it = crossings_on_polygon_segment_begin; crossing_it != crossings_on_polygon_segment_end; crossing_it++)
             {
-                if (!previous_crossing) //If we're not yet drawing, then we have been trying to find the next vertex. We found it! Let's start drawing.
+                const size_t crossing = *crossing_it;
+                if (previous_crossing == no_segment) //If we're not yet drawing, then we have been trying to find the next vertex. We found it! Let's start drawing.
                 {
                     previous_crossing = crossing;
                     previous_segment = crossing;
@@ -740,9 +925,7 @@ void Infill::connectLines(Polygons& result_lines)
                 else
                 {
                     const size_t crossing_handle = connected_lines.find(crossing);
-                    assert (crossing_handle != (size_t)-1);
                     const size_t previous_crossing_handle = connected_lines.find(previous_crossing);
-                    assert (previous_crossing_handle != (size_t)-1);
                     if (crossing_handle == previous_crossing_handle) //These two infill lines are already connected. Don't create a loop now. Continue connecting with the next crossing.
                     {
                         continue;
@@ -750,136 +933,144 @@ void Infill::connectLines(Polygons& result_lines)
 
                     //Join two infill lines together with a connecting line.
                     //Here the InfillLineSegments function as a linked list, so that they can easily be joined.
-                    const Point previous_point = (previous_segment->start_segment == vertex_index && previous_segment->start_polygon == polygon_index) ? previous_segment->start : previous_segment->end;
-                    const Point next_point = (crossing->start_segment == vertex_index && crossing->start_polygon == polygon_index) ? crossing->start : crossing->end;
-                    InfillLineSegment* new_segment;
+                    const Point previous_point = starts_here(previous_segment) ? line_segments[previous_segment].start : line_segments[previous_segment].end;
+                    const Point next_point = starts_here(crossing) ? line_segments[crossing].start : line_segments[crossing].end;
+                    size_t new_segment;
                     // If the segment is zero length, we avoid creating it but still want to connect the crossing with the previous segment
                     if (previous_point == next_point)
                     {
-                        if (previous_segment->start_segment == vertex_index && previous_segment->start_polygon == polygon_index)
+                        if (starts_here(previous_segment))
                         {
-                            previous_segment->previous = crossing;
+                            line_segments[previous_segment].previous = crossing;
                         }
                         else
                         {
-                            previous_segment->next = crossing;
+                            line_segments[previous_segment].next = crossing;
                         }
                         new_segment = previous_segment;
                     }
                     else
                     {
-                        new_segment = new InfillLineSegment(previous_point, vertex_index, polygon_index, next_point, vertex_index, polygon_index); //A connecting line between them.
-                        new_segment->previous = previous_segment;
-                        if (previous_segment->start_segment == vertex_index && previous_segment->start_polygon == polygon_index)
+                        new_segment = line_segments.size();
+                        line_segments.emplace_back(previous_point, vertex_index, polygon_index, next_point, vertex_index, polygon_index); //A connecting line between them.
+                        line_segments[new_segment].previous = previous_segment;
+                        if (starts_here(previous_segment))
                         {
-                            previous_segment->previous = new_segment;
+                            line_segments[previous_segment].previous = new_segment;
                         }
                         else
                         {
-                            previous_segment->next = new_segment;
+                            line_segments[previous_segment].next = new_segment;
                         }
-                        new_segment->next = crossing;
+                        line_segments[new_segment].next = crossing;
                     }
 
-                    if (crossing->start_segment == vertex_index && crossing->start_polygon == polygon_index)
+                    if (starts_here(crossing))
                     {
-                        crossing->previous = new_segment;
+                        line_segments[crossing].previous = new_segment;
                     }
                     else
                     {
-                        crossing->next = new_segment;
+                        line_segments[crossing].next = new_segment;
                     }
                     connected_lines.unite(crossing_handle, previous_crossing_handle);
-                    previous_crossing = nullptr;
-                    previous_segment = nullptr;
+                    previous_crossing = no_segment;
+                    previous_segment = no_segment;
                 }
             }
 
             //Upon going to the next vertex, if we're drawing, put an extra vertex in our infill lines.
-            if (previous_crossing)
+            if (previous_crossing != no_segment)
             {
-                InfillLineSegment* new_segment;
-                if (vertex_index == previous_segment->start_segment && polygon_index == previous_segment->start_polygon)
+                const size_t new_segment = line_segments.size();
+                // The previous segment ends here on the side that was connected last, which is its start if it starts on this polygon line segment.
+                const bool extend_start = starts_here(previous_segment);
+                const Point extended_point = extend_start ? line_segments[previous_segment].start : line_segments[previous_segment].end;
+                if (extended_point == vertex_after)
                 {
-                    if (previous_segment->start == vertex_after)
-                    {
-                        //Edge case when an infill line ends directly on top of vertex_after: We skip the extra connecting line segment, as that would be 0-length.
-                        previous_segment = nullptr;
-                        previous_crossing = nullptr;
-                    }
-                    else
-                    {
-                        new_segment = new InfillLineSegment(previous_segment->start, vertex_index, polygon_index, vertex_after, (vertex_index + 1) % inner_contour[polygon_index].size(), polygon_index);
-                        previous_segment->previous = new_segment;
-                        new_segment->previous = previous_segment;
-                        previous_segment = new_segment;
-                    }
+                    //Edge case when an infill line ends directly on top of vertex_after: We skip the extra connecting line segment, as that would be 0-length.
+                    previous_segment = no_segment;
+                    previous_crossing = no_segment;
                 }
                 else
                 {
-                    if (previous_segment->end == vertex_after)
+                    line_segments.emplace_back(extended_point, vertex_index, polygon_index, vertex_after, (vertex_index + 1) % inner_contour_polygon.size(), polygon_index);
+                    if (extend_start)
                     {
-                        //Edge case when an infill line ends directly on top of vertex_after: We skip the extra connecting line segment, as that would be 0-length.
-                        previous_segment = nullptr;
-                        previous_crossing = nullptr;
+                        line_segments[previous_segment].previous = new_segment;
                     }
                     else
                     {
-                        new_segment = new InfillLineSegment(previous_segment->end, vertex_index, polygon_index, vertex_after, (vertex_index + 1) % inner_contour[polygon_index].size(), polygon_index);
-                        previous_segment->next = new_segment;
-                        new_segment->previous = previous_segment;
-                        previous_segment = new_segment;
+                        line_segments[previous_segment].next = new_segment;
                     }
+                    line_segments[new_segment].previous = previous_segment;
+                    previous_segment = new_segment;
                 }
             }
 
             vertex_before = vertex_after;
-            crossings_on_polygon_segment.clear();
         }
     }
 
     //Save all lines, now connected, to the output.
-    std::unordered_set<size_t> completed_groups;
-    for (InfillLineSegment* infill_line : connected_lines)
+    std::vector<bool> completed_groups(crossing_line_count, false);
+    for (const size_t infill_line : line_order)
     {
         const size_t group = connected_lines.find(infill_line);
-        if (completed_groups.find(group) != completed_groups.end()) //We already completed this group.
+        if (completed_groups[group]) //We already completed this group.
         {
             continue;
         }
 
         //Find where the polyline ends by searching through previous and next lines.
         //Note that the "previous" and "next" lines don't necessarily match up though, because the direction while connecting infill lines was not yet known.
-        Point previous_vertex = infill_line->start; //Take one side arbitrarily to start from. This variable indicates the vertex that connects to the previous line.
-        InfillLineSegment* current_infill_line = infill_line;
-        while (current_infill_line->next && current_infill_line->previous) //Until we reached an endpoint.
+        Point previous_vertex = line_segments[infill_line].start; //Take one side arbitrarily to start from. This variable indicates the vertex that connects to the previous line.
+        size_t current_infill_line = infill_line;
+        while (line_segments[current_infill_line].next != no_segment && line_segments[current_infill_line].previous != no_segment) //Until we reached an endpoint.
         {
-            const Point next_vertex = (previous_vertex == current_infill_line->start) ? current_infill_line->end : current_infill_line->start;
-            current_infill_line =     (previous_vertex == current_infill_line->start) ? current_infill_line->next : current_infill_line->previous;
+            const InfillLineSegment& current = line_segments[current_infill_line];
+            const Point next_vertex = (previous_vertex == current.start) ? current.end : current.start;
+            current_infill_line =     (previous_vertex == current.start) ? current.next : current.previous;
             previous_vertex = next_vertex;
         }
 
         //Now go along the linked list of infill lines and output the infill lines to the actual result.
-        InfillLineSegment* old_line = current_infill_line;
-        const Point first_vertex = (!current_infill_line->previous) ? current_infill_line->start : current_infill_line->end;
-        previous_vertex =          (!current_infill_line->previous) ? current_infill_line->end : current_infill_line->start;
-        current_infill_line = (first_vertex == current_infill_line->start) ? current_infill_line->next : current_infill_line->previous;
+        const InfillLineSegment& first_line = line_segments[current_infill_line];
+        const Point first_vertex =  (first_line.previous == no_segment) ? first_line.start : first_line.end;
+        const Point second_vertex = (first_line.previous == no_segment) ? first_line.end : first_line.start;
+        const size_t second_line = (first_vertex == first_line.start) ? first_line.next : first_line.previous;
+
+        //Count the vertices first, so that the polyline is allocated only once.
+        size_t vertex_count = 2;
+        previous_vertex = second_vertex;
+        current_infill_line = second_line;
+        while (current_infill_line != no_segment)
+        {
+            const InfillLineSegment& current = line_segments[current_infill_line];
+            const Point next_vertex = (previous_vertex == current.start) ? current.end : current.start; //Opposite side of the line.
+            current_infill_line =     (previous_vertex == current.start) ? current.next : current.previous;
+            previous_vertex = next_vertex;
+            vertex_count++;
+        }
+
         PolygonRef result_line = result_lines.newPoly();
+        result_line.reserve(vertex_count);
         result_line.add(first_vertex);
-        result_line.add(previous_vertex);
-        delete old_line;
-        while (current_infill_line)
+        result_line.add(second_vertex);
+        previous_vertex = second_vertex;
+        current_infill_line = second_line;
+        while (current_infill_line != no_segment)
         {
-            old_line = current_infill_line; //We'll delete this after we've traversed to the next line.
-            const Point next_vertex = (previous_vertex == current_infill_line->start) ? current_infill_line->end : current_infill_line->start; //Opposite side of the line.
-            current_infill_line =     (previous_vertex == current_infill_line->start) ? current_infill_line->next : current_infill_line->previous;
+            const InfillLineSegment& current = line_segments[current_infill_line];
+            const Point next_vertex = (previous_vertex == current.start) ? current.end : current.start; //Opposite side of the line.
+            current_infill_line =     (previous_vertex == current.start) ? current.next : current.previous;
             result_line.add(next_vertex);
             previous_vertex = next_vertex;
-            delete old_line;
         }
 
-        completed_groups.insert(group);
+        completed_groups[group] = true;
     }
+    line_segments.clear();
 }
 
 bool Infill::InfillLineSegment::operator ==(const InfillLineSegment& other) const
@@ -4,7 +4,10 @@
 #ifndef INFILL_H
 #define INFILL_H
 
+#include <limits> //For the index of no line segment.
+
 #include "infill/LightningGenerator.h"
+#include "infill/ScanlineCrossings.h"
 #include "infill/ZigzagConnectorProcessor.h"
 #include "settings/EnumSettings.h" //For infill types.
 #include "settings/types/Angle.h"
@@ -16,6 +19,7 @@ namespace cura
 {
 
 class AABB;
+class InfillCache;
 class SierpinskiFillProvider;
 class SliceMeshStorage;
 
@@ -47,6 +51,7 @@ class Infill
     size_t zag_skip_count;  //!< (ZigZag) To skip one zag in every N if skip some zags is enabled
     coord_t pocket_size; //!< The size of the pockets at the intersections of the fractal in the cross 3d pattern
     bool mirror_offset; //!< Indication in which offset direction the extra infill lines are made
+    coord_t parallel_tile_size; //!< If positive, wide areas are split in tiles of this width, of which the pattern is generated in parallel
 
     static constexpr double one_over_sqrt_2 = 0.7071067811865475244008443621048490392848359376884740; //!< 1.0 / sqrt(2.0)
 public:
@@ -71,6 +76,7 @@ public:
         , bool skip_some_zags = false
         , size_t zag_skip_count = 0
         , coord_t pocket_size = 0
+        , coord_t parallel_tile_size = 0
     )
     : pattern(pattern)
     , zig_zaggify(zig_zaggify)
@@ -94,6 +100,7 @@ public:
     , zag_skip_count(zag_skip_count)
     , pocket_size(pocket_size)
     , mirror_offset(zig_zaggify)
+    , parallel_tile_size(parallel_tile_size)
     {
         //TODO: The connected lines algorithm is only available for linear-based infill, for now.
         //We skip ZigZag, Cross and Cross3D because they have their own algorithms. Eventually we want to replace all that with the new algorithm.
@@ -111,8 +118,11 @@ public:
      * \param cross_fill_provider Any pre-computed cross infill pattern, if the Cross or Cross3D pattern is selected.
      * \param mesh A mesh for which to generate infill (should only be used for non-helper-mesh objects).
      * \param[in] cross_fill_provider The cross fractal subdivision decision functor
+     * \param cache If given, the infill of patterns that don't depend on the
+     * height is looked up in this cache, and stored in it if it wasn't there
+     * yet. The cache must only be used with the same \p settings.
      */
-    void generate(std::vector<VariableWidthLines>& toolpaths, Polygons& result_polygons, Polygons& result_lines, const Settings& settings, const SierpinskiFillProvider* cross_fill_provider = nullptr, const LightningLayer * lightning_layer = nullptr, const SliceMeshStorage* mesh = nullptr);
+    void generate(std::vector<VariableWidthLines>& toolpaths, Polygons& result_polygons, Polygons& result_lines, const Settings& settings, const SierpinskiFillProvider* cross_fill_provider = nullptr, const LightningLayer * lightning_layer = nullptr, const SliceMeshStorage* mesh = nullptr, InfillCache* cache = nullptr);
 
     /*!
      * Generate the wall toolpaths of an infill area. It will return the inner contour and set the inner-contour.
@@ -128,11 +138,50 @@ public:
      */
     static Polygons generateWallToolPaths(std::vector<VariableWidthLines>& toolpaths, Polygons& outer_contour, const size_t wall_line_count, const coord_t line_width, const coord_t infill_overlap, const Settings& settings);
 private:
+    /*!
+     * Whether the infill only depends on the area and the parameters, and not
+     * on the height of the layer or any per-layer precomputation, so that it
+     * may be reused for the same area on other layers.
+     */
+    bool isLayerIndependent() const;
+
     /*!
      * Generate the infill pattern without the infill_multiplier functionality
      */
     void _generate(std::vector<VariableWidthLines>& toolpaths, Polygons& result_polygons, Polygons& result_lines, const Settings& settings, const SierpinskiFillProvider* cross_fill_pattern = nullptr, const LightningLayer * lightning_layer = nullptr, const SliceMeshStorage* mesh = nullptr);
 
+    /*!
+     * Generate the lines and polygons of the infill pattern, without
+     * connecting, stitching or simplifying them.
+     */
+    void generatePattern(std::vector<VariableWidthLines>& toolpaths, Polygons& result_polygons, Polygons& result_lines, const Settings& settings, const SierpinskiFillProvider* cross_fill_pattern, const LightningLayer * lightning_layer, const SliceMeshStorage* mesh);
+
+    /*!
+     * Whether the pattern may be generated in tiles with \ref generateInTiles.
+     *
+     * This is only possible for the patterns that consist of lines at fixed
+     * positions, where each part of the pattern only depends on the part of
+     * the area that it is in. Patterns that connect lines along the border of
+     * the area can't be split up.
+     */
+    bool canGenerateInTiles() const;
+
+    /*!
+     * Generate the pattern in tiles, in parallel.
+     *
+     * The tiles are strips of \ref parallel_tile_size wide, spanning the whole
+     * height of the area. Since the tiles only have borders in one direction,
+     * a piece of a line that is cut off at both ends is as long as a tile is
+     * wide, so it isn't removed for being too short.
+     *
+     * The lines that were cut at the borders between the tiles are stitched
+     * back together afterwards. The tiles are combined in a fixed order, so
+     * the result doesn't depend on the order in which the tiles finish.
+     * \param[out] result_polygons The resulting polygons.
+     * \param[out] result_lines The resulting lines.
+     */
+    void generateInTiles(Polygons& result_polygons, Polygons& result_lines, const Settings& settings, const SierpinskiFillProvider* cross_fill_pattern, const LightningLayer * lightning_layer, const SliceMeshStorage* mesh);
+
     /*!
      * Multiply the infill lines, so that any single line becomes [infill_multiplier] lines next to each other.
      * 
@@ -163,8 +212,8 @@ private:
             , end(end)
             , end_segment(end_segment)
             , end_polygon(end_polygon)
-            , previous(nullptr)
-            , next(nullptr)
+            , previous(no_segment)
+            , next(no_segment)
         {
         };
 
@@ -213,15 +262,21 @@ private:
         size_t end_polygon;
 
         /*!
-         * The previous line segment that this line segment is connected to, if
-         * any.
+         * The index in \ref line_segments of the previous line segment that
+         * this line segment is connected to, or \ref no_segment if none.
          */
-        InfillLineSegment* previous;
+        size_t previous;
 
         /*!
-         * The next line segment that this line segment is connected to, if any.
+         * The index in \ref line_segments of the next line segment that this
+         * line segment is connected to, or \ref no_segment if none.
          */
-        InfillLineSegment* next;
+        size_t next;
+
+        /*!
+         * The index of a line segment that isn't connected to anything.
+         */
+        static constexpr size_t no_segment = std::numeric_limits<size_t>::max();
 
         /*!
          * Compares two infill line segments for equality.
@@ -233,11 +288,47 @@ private:
     };
 
     /*!
-     * Stores the infill lines (a vector) for each line of a polygon (a vector)
-     * for each polygon in a Polygons object that we create a zig-zaggified
-     * infill pattern for.
+     * The infill line segments that are connected by \ref connectLines.
+     *
+     * The infill lines that cross the outline come first. They are added by
+     * \ref generateLinearBasedInfill, and know which polygon line segments
+     * they cross through their start and end indices. The lines along the
+     * outline that connect them are added by \ref connectLines. The segments
+     * link to each other by their index in this vector, so that they are
+     * stored contiguously and the links stay valid when it grows.
+     */
+    std::vector<InfillLineSegment> line_segments;
+
+    /*!
+     * The inner contour, rotated by one of the angles that the pattern is
+     * generated at.
+     */
+    struct RotatedOutline
+    {
+        double cos_angle; //!< The first element of the rotation matrix, to recognise it by.
+        double sin_angle; //!< The third element of the rotation matrix, to recognise it by.
+        Polygons outline; //!< The rotated inner contour.
+        AABB boundary; //!< The bounding box of \ref outline.
+    };
+
+    /*!
+     * The rotated inner contours that the lines of the current pattern were
+     * generated in so far.
+     *
+     * Patterns like tetrahedral infill generate several sets of lines at the
+     * same angle, which can then share the rotated contour. This is cleared
+     * whenever a pattern is generated, since the inner contour may have
+     * changed since.
+     */
+    std::vector<RotatedOutline> rotated_outlines;
+
+    /*!
+     * Get the inner contour rotated by a matrix, rotating it only if it wasn't
+     * rotated by the same matrix before for the current pattern.
+     * \param rotation_matrix The rotation to apply.
+     * \return The rotated inner contour and its bounding box.
      */
-    std::vector<std::vector<std::vector<InfillLineSegment*>>> crossings_on_line;
+    const RotatedOutline& getRotatedOutline(const PointMatrix& rotation_matrix);
 
     /*!
      * Generate gyroid infill
@@ -329,7 +420,7 @@ private:
      * \param scanline_min_idx The lowest index of all scanlines crossing the polygon
      * \param line_distance The distance between two lines which are in the same direction
      * \param boundary The axis aligned boundary box within which the polygon is
-     * \param cut_list A mapping of each scanline to all y-coordinates (in the space transformed by rotation_matrix) where the polygons are crossing the scanline
+     * \param cut_list A mapping of each scanline to all y-coordinates (in the space transformed by rotation_matrix) where the polygons are crossing the scanline, grouped per scanline
      * \param total_shift total shift of the scanlines in the direction perpendicular to the fill_angle.
      */
     void addLineInfill( Polygons& result,
@@ -337,7 +428,7 @@ private:
                         const int scanline_min_idx,
                         const int line_distance,
                         const AABB boundary,
-                        std::vector<std::vector<coord_t>>& cut_list,
+                        ScanlineCrossings<coord_t>& cut_list,
                         coord_t total_shift);
 
     /*!
@@ -5,9 +5,43 @@
 #include "../utils/AABB.h"
 #include "../utils/linearAlg2D.h"
 #include "../utils/polygon.h"
+#include "../utils/polygonUtils.h"
 
 namespace cura {
 
+namespace
+{
+
+/*!
+ * Find out whether a point of the pattern is inside the outline.
+ *
+ * Testing a point against the whole outline is expensive, so this is only done
+ * if the line segment from the previous point might touch the outline. If no
+ * part of the outline is near that line segment, the point must be on the same
+ * side of the outline as the previous point.
+ * \param current The point to test.
+ * \param last The previous point of the pattern.
+ * \param last_inside Whether \p last is inside the outline.
+ * \param is_first_point Whether there is no previous point.
+ * \param in_outline The outline to test against.
+ * \param outline_locator The line segments of \p in_outline .
+ * \return Whether \p current is inside \p in_outline , or on its border.
+ */
+bool isInside(const Point& current, const Point& last, const bool last_inside, const bool is_first_point, const Polygons& in_outline, const LocToLineGrid& outline_locator)
+{
+    if (!is_first_point)
+    {
+        const bool is_far_from_outline = outline_locator.processLine(std::make_pair(last, current), [](const PolygonsPointIndex&) { return false; }); //Stops at the first line segment found.
+        if (is_far_from_outline)
+        {
+            return last_inside;
+        }
+    }
+    return in_outline.inside(current, true);
+}
+
+}
+
 GyroidInfill::GyroidInfill() {
 }
 
@@ -33,6 +67,7 @@ void GyroidInfill::generateTotalGyroidInfill(Polygons& result_lines, bool zig_za
     const double z_rads = 2 * M_PI * z / pitch;
     const double cos_z = std::cos(z_rads);
     const double sin_z = std::sin(z_rads);
+    const std::unique_ptr<LocToLineGrid> outline_locator = PolygonUtils::createLocToLineGrid(in_outline, step);
     std::vector<coord_t> odd_line_coords;
     std::vector<coord_t> even_line_coords;
     Polygons result;
@@ -70,7 +105,7 @@ void GyroidInfill::generateTotalGyroidInfill(Polygons& result_lines, bool zig_za
                 for (unsigned i = 0; i < num_coords; ++i)
                 {
                     Point current(x + ((num_columns & 1) ? odd_line_coords[i] : even_line_coords[i])/2 + pitch, y + (coord_t)(i * step));
-                    bool current_inside = in_outline.inside(current, true);
+                    bool current_inside = isInside(current, last, last_inside, is_first_point, in_outline, *outline_locator);
                     if (!is_first_point)
                     {
                         if (last_inside && current_inside)
@@ -162,7 +197,7 @@ void GyroidInfill::generateTotalGyroidInfill(Polygons& result_lines, bool zig_za
                 for (unsigned i = 0; i < num_coords; ++i)
                 {
                     Point current(x + (coord_t)(i * step), y + ((num_rows & 1) ? odd_line_coords[i] : even_line_coords[i])/2);
-                    bool current_inside = in_outline.inside(current, true);
+                    bool current_inside = isInside(current, last, last_inside, is_first_point, in_outline, *outline_locator);
                     if (!is_first_point)
                     {
                         if (last_inside && current_inside)
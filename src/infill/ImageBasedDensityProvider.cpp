@@ -20,7 +20,7 @@ ImageBasedDensityProvider::ImageBasedDensityProvider(const std::string filename,
 {
     int desired_channel_count = 0; // keep original amount of channels
     int img_x, img_y, img_z; // stbi requires pointer to int rather than to coord_t
-    image = stbi_load(filename.c_str(), &img_x, &img_y, &img_z, desired_channel_count);
+    unsigned char* image = stbi_load(filename.c_str(), &img_x, &img_y, &img_z, desired_channel_count); //Rows of channel data per pixel, from the top of the image.
     image_size = Point3(img_x, img_y, img_z);
     if (!image)
     {
@@ -32,6 +32,25 @@ ImageBasedDensityProvider::ImageBasedDensityProvider(const std::string filename,
         logError("Cannot load image %s: '%s'.\n", filename.c_str(), reason);
         std::exit(-1);
     }
+    { // compute summed-area table
+        const size_t row_length = image_size.x + 1;
+        summed_lightness.assign(row_length * (image_size.y + 1), 0);
+        for (coord_t y = 0; y < image_size.y; y++)
+        {
+            uint64_t row_lightness = 0;
+            const unsigned char* pixel = &image[(image_size.y - 1 - y) * image_size.x * image_size.z];
+            for (coord_t x = 0; x < image_size.x; x++)
+            {
+                for (coord_t z = 0; z < image_size.z; z++)
+                {
+                    row_lightness += *pixel;
+                    pixel++;
+                }
+                summed_lightness[(y + 1) * row_length + x + 1] = summed_lightness[y * row_length + x + 1] + row_lightness;
+            }
+        }
+        stbi_image_free(image);
+    }
     { // compute aabb
         Point middle = model_aabb.getMiddle();
         Point model_aabb_size = model_aabb.max - model_aabb.min;
@@ -53,12 +72,11 @@ ImageBasedDensityProvider::ImageBasedDensityProvider(const std::string filename,
 }
 
 
-ImageBasedDensityProvider::~ImageBasedDensityProvider()
+uint64_t ImageBasedDensityProvider::getTotalLightness(const coord_t min_x, const coord_t min_y, const coord_t max_x, const coord_t max_y) const
 {
-    if (image)
-    {
-        stbi_image_free(image);
-    }
+    const size_t row_length = image_size.x + 1;
+    return summed_lightness[(max_y + 1) * row_length + max_x + 1] - summed_lightness[min_y * row_length + max_x + 1]
+        - summed_lightness[(max_y + 1) * row_length + min_x] + summed_lightness[min_y * row_length + min_x];
 }
 
 float ImageBasedDensityProvider::operator()(const AABB3D& query_cube) const
@@ -66,30 +84,24 @@ float ImageBasedDensityProvider::operator()(const AABB3D& query_cube) const
     AABB query_box(Point(query_cube.min.x, query_cube.min.y), Point(query_cube.max.x, query_cube.max.y));
     Point img_min = (query_box.min - print_aabb.min - Point(1,1)) * image_size.x / (print_aabb.max.X - print_aabb.min.X);
     Point img_max = (query_box.max - print_aabb.min + Point(1,1)) * image_size.y / (print_aabb.max.Y - print_aabb.min.Y);
-    long total_lightness = 0;
+    uint64_t total_lightness = 0;
     int value_count = 0;
-    for (int x = std::max((coord_t)0, img_min.X); x <= std::min((coord_t)image_size.x - 1, img_max.X); x++)
+    const coord_t min_x = std::max((coord_t)0, img_min.X);
+    const coord_t max_x = std::min((coord_t)image_size.x - 1, img_max.X);
+    const coord_t min_y = std::max((coord_t)0, img_min.Y);
+    const coord_t max_y = std::min((coord_t)image_size.y - 1, img_max.Y);
+    if (min_x <= max_x && min_y <= max_y)
     {
-        for (int y = std::max((coord_t)0, img_min.Y); y <= std::min((coord_t)image_size.y - 1, img_max.Y); y++)
-        {
-            for (int z = 0; z < image_size.z; z++)
-            {
-                total_lightness += image[((image_size.y - 1 - y) * image_size.x + x) * image_size.z + z];
-                value_count++;
-            }
-        }
+        total_lightness = getTotalLightness(min_x, min_y, max_x, max_y);
+        value_count = (max_x - min_x + 1) * (max_y - min_y + 1) * image_size.z;
     }
     if (value_count == 0)
     { // triangle falls outside of image or in between pixels, so we return the closest pixel
         Point closest_pixel = (img_min + img_max) / 2;
         closest_pixel.X = std::max((coord_t)0, std::min((coord_t)image_size.x - 1, (coord_t)closest_pixel.X));
         closest_pixel.Y = std::max((coord_t)0, std::min((coord_t)image_size.y - 1, (coord_t)closest_pixel.Y));
-        assert(total_lightness == 0);
-        for (int z = 0; z < image_size.z; z++)
-        {
-            total_lightness += image[((image_size.y - 1 - closest_pixel.Y) * image_size.x + closest_pixel.X) * image_size.z + z];
-            value_count++;
-        }
+        total_lightness = getTotalLightness(closest_pixel.X, closest_pixel.Y, closest_pixel.X, closest_pixel.Y);
+        value_count = image_size.z;
     }
     return 1.0f - ((float)total_lightness) / value_count / 255.0f;
 }
@@ -5,6 +5,9 @@
 #ifndef INFILL_IMAGE_BASED_DENSITY_PROVIDER_H
 #define INFILL_IMAGE_BASED_DENSITY_PROVIDER_H
 
+#include <cstdint>
+#include <vector>
+
 #include "../utils/AABB.h"
 
 #include "DensityProvider.h"
@@ -19,13 +22,34 @@ class ImageBasedDensityProvider : public DensityProvider
 public:
     ImageBasedDensityProvider(const std::string filename, const AABB aabb);
 
-    virtual ~ImageBasedDensityProvider();
+    virtual ~ImageBasedDensityProvider() = default;
 
     virtual float operator()(const AABB3D& aabb) const;
 
 protected:
+    /*!
+     * Get the sum of all channels of all pixels in a rectangle of the image.
+     *
+     * The coordinates are from the bottom left of the image. The rectangle
+     * must be within the image.
+     * \param min_x The first column of the rectangle.
+     * \param min_y The first row of the rectangle.
+     * \param max_x The last column of the rectangle, inclusive.
+     * \param max_y The last row of the rectangle, inclusive.
+     */
+    uint64_t getTotalLightness(const coord_t min_x, const coord_t min_y, const coord_t max_x, const coord_t max_y) const;
+
     Point3 image_size; //!< dimensions of the image. Third dimension is the amount of channels.
-    unsigned char* image = nullptr; //!< image data: rows of channel data per pixel.
+
+    /*!
+     * Summed-area table of the image, so that the average lightness of any
+     * rectangle can be found with four lookups, regardless of its size.
+     *
+     * Has one row and column more than the image. Entry (x, y) holds the sum of
+     * all channels of the pixels left of column x and below row y, from the
+     * bottom left of the image. The image itself isn't kept.
+     */
+    std::vector<uint64_t> summed_lightness;
 
     AABB print_aabb; //!< bounding box of print coordinates in which to apply the image
 };
@@ -0,0 +1,80 @@
+// Copyright (c) 2022 Ultimaker B.V.
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "InfillCache.h"
+
+namespace cura
+{
+
+bool InfillCache::Parameters::operator==(const Parameters& other) const
+{
+    return pattern == other.pattern
+        && zig_zaggify == other.zig_zaggify
+        && connect_polygons == other.connect_polygons
+        && infill_line_width == other.infill_line_width
+        && line_distance == other.line_distance
+        && infill_overlap == other.infill_overlap
+        && infill_multiplier == other.infill_multiplier
+        && static_cast<double>(fill_angle) == static_cast<double>(other.fill_angle)
+        && shift == other.shift
+        && max_resolution == other.max_resolution
+        && max_deviation == other.max_deviation
+        && wall_line_count == other.wall_line_count
+        && infill_origin == other.infill_origin
+        && skip_line_stitching == other.skip_line_stitching
+        && connected_zigzags == other.connected_zigzags
+        && use_endpieces == other.use_endpieces
+        && skip_some_zags == other.skip_some_zags
+        && zag_skip_count == other.zag_skip_count
+        && pocket_size == other.pocket_size
+        && parallel_tile_size == other.parallel_tile_size
+        && settings == other.settings;
+}
+
+InfillCache::InfillCache(const size_t capacity)
+: entries(capacity)
+{
+}
+
+std::shared_ptr<const InfillCache::Result> InfillCache::find(const Polygons& area, const Parameters& parameters) const
+{
+    return entries.find(hash(area, parameters), [&area, &parameters](const Key& key)
+    {
+        return key.parameters == parameters && key.area.isSame(area);
+    });
+}
+
+void InfillCache::insert(const Polygons& area, const Parameters& parameters, std::shared_ptr<const Result> result)
+{
+    CompactPolygons compact_area;
+    if (!compact_area.compact(area))
+    {
+        return;
+    }
+    entries.insert(hash(area, parameters), Key{std::move(compact_area), parameters}, std::move(result));
+}
+
+size_t InfillCache::hash(const Polygons& area, const Parameters& parameters)
+{
+    size_t result = std::hash<int>()(static_cast<int>(parameters.pattern));
+    const auto combine = [&result](const size_t value)
+    {
+        result ^= value + 0x9e3779b97f4a7c15ull + (result << 6) + (result >> 2);
+    };
+    //The other parameters are mostly the same for all layers, so they are only compared.
+    combine(std::hash<coord_t>()(parameters.line_distance));
+    combine(std::hash<double>()(parameters.fill_angle));
+    combine(std::hash<coord_t>()(parameters.shift));
+    for (ConstPolygonRef polygon : area)
+    {
+        combine(polygon.size());
+        for (const Point& point : polygon)
+        {
+            combine(std::hash<coord_t>()(point.X));
+            combine(std::hash<coord_t>()(point.Y));
+        }
+    }
+    return result;
+}
+
+} //namespace cura
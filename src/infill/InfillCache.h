@@ -0,0 +1,124 @@
+// Copyright (c) 2022 Ultimaker B.V.
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef INFILL_INFILL_CACHE_H
+#define INFILL_INFILL_CACHE_H
+
+#include <memory>
+
+#include "../settings/EnumSettings.h" //For the infill patterns.
+#include "../settings/Settings.h"
+#include "../settings/types/Angle.h"
+#include "../utils/BoundedCache.h"
+#include "../utils/CompactPolygons.h"
+#include "../utils/ExtrusionLine.h"
+#include "../utils/polygon.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Remembers the infill generated for infill areas, so that the same
+ * area doesn't need to be filled again on a later layer.
+ *
+ * Patterns like lines, grid and zigzag don't depend on the height of the
+ * layer. For prismatic models the infill area is the same on many layers, so
+ * those layers get the same infill if it's generated with the same parameters.
+ * With alternating infill angles, that's the case for every other layer. The
+ * same goes for skin, ironing and support, which use the same patterns.
+ *
+ * Different kinds of fill can share one cache, since the settings that they
+ * are generated with are part of the parameters. It is safe to use from
+ * multiple threads at once.
+ */
+class InfillCache
+{
+public:
+    /*!
+     * \brief The parameters of the infill generation that can differ per
+     * layer, apart from the height itself.
+     */
+    struct Parameters
+    {
+        EFillMethod pattern;
+        bool zig_zaggify;
+        bool connect_polygons;
+        coord_t infill_line_width;
+        coord_t line_distance;
+        coord_t infill_overlap;
+        size_t infill_multiplier;
+        AngleDegrees fill_angle;
+        coord_t shift;
+        coord_t max_resolution;
+        coord_t max_deviation;
+        size_t wall_line_count;
+        Point infill_origin;
+        bool skip_line_stitching;
+        bool connected_zigzags;
+        bool use_endpieces;
+        bool skip_some_zags;
+        size_t zag_skip_count;
+        coord_t pocket_size;
+        coord_t parallel_tile_size;
+        const Settings* settings; //!< The settings that the infill walls are generated with. They must outlive the cache.
+
+        bool operator==(const Parameters& other) const;
+    };
+
+    /*!
+     * \brief The infill that was generated for an area.
+     */
+    struct Result
+    {
+        std::vector<VariableWidthLines> toolpaths;
+        Polygons polygons;
+        Polygons lines;
+    };
+
+    /*!
+     * \param capacity The maximum number of areas to remember. When more are
+     * added, the ones that were added first are forgotten.
+     */
+    InfillCache(const size_t capacity = 128);
+
+    /*!
+     * \brief Find the infill that was generated earlier for an area.
+     * \param area The area that was filled, before any offsets.
+     * \param parameters The parameters with which the infill is generated.
+     * \return The infill, or ``nullptr`` if this area is not known with this
+     * set of parameters.
+     */
+    std::shared_ptr<const Result> find(const Polygons& area, const Parameters& parameters) const;
+
+    /*!
+     * \brief Remember the infill generated for an area.
+     *
+     * Areas that are too large to store in compact form are not remembered.
+     * \param area The area that was filled, before any offsets.
+     * \param parameters The parameters with which the infill was generated.
+     * \param result The generated infill.
+     */
+    void insert(const Polygons& area, const Parameters& parameters, std::shared_ptr<const Result> result);
+
+private:
+    /*!
+     * \brief What the infill was generated for, to compare with the areas that
+     * are looked up.
+     */
+    struct Key
+    {
+        CompactPolygons area;
+        Parameters parameters;
+    };
+
+    /*!
+     * Hash the content of an area along with the parameters.
+     */
+    static size_t hash(const Polygons& area, const Parameters& parameters);
+
+    BoundedCache<Key, std::shared_ptr<const Result>> entries; //!< The known areas.
+};
+
+} //namespace cura
+
+#endif //INFILL_INFILL_CACHE_H
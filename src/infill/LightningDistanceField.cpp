@@ -1,7 +1,10 @@
 //Copyright (c) 2021 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For stable_sort.
+
 #include "LightningDistanceField.h" //Class we're implementing.
+#include "../utils/IndexedPolygons.h" //To find the distance to the boundary for all dots.
 #include "../utils/polygonUtils.h" //For spreadDotsArea helper function.
 
 namespace cura
@@ -20,16 +23,33 @@ LightningDistanceField::LightningDistanceField
 , supporting_radius(radius)
 , current_outline(current_outline)
 , current_overhang(current_overhang)
+, next_unsupported(0)
+, grid_min(0, 0)
+, grid_size(0, 0)
 {
     std::vector<Point> regular_dots = PolygonUtils::spreadDotsArea(current_overhang, cell_size);
+    if (regular_dots.empty())
+    {
+        return;
+    }
+    unsupported_points.reserve(regular_dots.size());
+    GridPoint grid_max = grid.toGridPoint(regular_dots.front());
+    grid_min = grid_max;
+    const IndexedPolygons outline_index(current_outline);
     for (const auto& p : regular_dots)
     {
-        const ClosestPolygonPoint cpp = PolygonUtils::findClosest(p, current_outline);
+        const ClosestPolygonPoint cpp = outline_index.findClosest(p);
         const coord_t dist_to_boundary = vSize(p - cpp.p());
         unsupported_points.emplace_back(p, dist_to_boundary);
+
+        const GridPoint grid_loc = grid.toGridPoint(p);
+        grid_min = GridPoint(std::min(grid_min.X, grid_loc.X), std::min(grid_min.Y, grid_loc.Y));
+        grid_max = GridPoint(std::max(grid_max.X, grid_loc.X), std::max(grid_max.Y, grid_loc.Y));
     }
-    unsupported_points.sort
+    std::stable_sort //Stable, so that points that compare equal keep the order in which they were spread.
     (
+        unsupported_points.begin(),
+        unsupported_points.end(),
         [&radius](const UnsupCell& a, const UnsupCell& b)
         {
             constexpr coord_t prime_for_hash = 191;
@@ -39,38 +59,53 @@ LightningDistanceField::LightningDistanceField
                 (std::hash<Point>{}(a.loc) % prime_for_hash) < (std::hash<Point>{}(b.loc) % prime_for_hash);
         }
     );
-    for (auto it = unsupported_points.begin(); it != unsupported_points.end(); ++it)
+
+    grid_size = grid_max - grid_min + GridPoint(1, 1);
+    cell_to_point.assign(grid_size.X * grid_size.Y, no_point);
+    size_t kept_points = 0;
+    for (const UnsupCell& cell : unsupported_points)
     {
-        UnsupCell& cell = *it;
-        unsupported_points_grid.emplace(grid.toGridPoint(cell.loc), it);
+        const GridPoint grid_loc = grid.toGridPoint(cell.loc) - grid_min;
+        size_t& cell_point = cell_to_point[grid_loc.Y * grid_size.X + grid_loc.X];
+        if (cell_point == no_point) //Only one point per cell. Any further ones could never be found to be removed.
+        {
+            cell_point = kept_points;
+            unsupported_points[kept_points++] = cell;
+        }
     }
+    unsupported_points.erase(unsupported_points.begin() + kept_points, unsupported_points.end());
+    is_supported.assign(kept_points, false);
 }
 
 bool LightningDistanceField::tryGetNextPoint(Point* p) const
 {
-    if (unsupported_points.empty())
+    if (next_unsupported >= unsupported_points.size())
     {
         return false;
     }
-    *p = unsupported_points.front().loc;
+    *p = unsupported_points[next_unsupported].loc;
     return true;
 }
 
+size_t LightningDistanceField::pointInCell(const GridPoint& grid_loc) const
+{
+    const GridPoint local = grid_loc - grid_min;
+    if (local.X < 0 || local.Y < 0 || local.X >= grid_size.X || local.Y >= grid_size.Y)
+    {
+        return no_point;
+    }
+    return cell_to_point[local.Y * grid_size.X + local.X];
+}
+
 void LightningDistanceField::update(const Point& to_node, const Point& added_leaf)
 {
     auto process_func = 
         [added_leaf, this](const SquareGrid::GridPoint& grid_loc)
         {
-            auto it = unsupported_points_grid.find(grid_loc);
-            if (it != unsupported_points_grid.end())
+            const size_t point_idx = pointInCell(grid_loc);
+            if (point_idx != no_point && !is_supported[point_idx] && shorterThen(unsupported_points[point_idx].loc - added_leaf, supporting_radius))
             {
-                std::list<UnsupCell>::iterator& list_it = it->second;
-                UnsupCell& cell = *list_it;
-                if (shorterThen(cell.loc - added_leaf, supporting_radius))
-                {
-                    unsupported_points.erase(list_it);
-                    unsupported_points_grid.erase(it);
-                }
+                is_supported[point_idx] = true;
             }
             return true;
         };
@@ -88,6 +123,11 @@ void LightningDistanceField::update(const Point& to_node, const Point& added_lea
                           }
     );
     grid.processNearby(added_leaf, supporting_radius, process_func);
+
+    while (next_unsupported < unsupported_points.size() && is_supported[next_unsupported])
+    {
+        next_unsupported++;
+    }
 }
 
 }
\ No newline at end of file
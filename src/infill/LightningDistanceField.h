@@ -4,6 +4,8 @@
 #ifndef LIGHTNING_DISTANCE_FIELD_H
 #define LIGHTNING_DISTANCE_FIELD_H
 
+#include <vector>
+
 #include "../utils/polygon.h" //Using outlines to fill and tracking overhang.
 #include "../utils/SquareGrid.h" //Tracking for each location the distance to overhang.
 
@@ -107,15 +109,51 @@ protected:
     };
 
     /*!
-     * Cells which still need to be supported at some point.
+     * Look up which of the \ref unsupported_points lies in a grid cell.
+     * \param grid_loc The grid cell to look in.
+     * \return The index of the point in that cell, or \ref no_point if there
+     * is none.
+     */
+    size_t pointInCell(const GridPoint& grid_loc) const;
+
+    /*!
+     * Marker in \ref cell_to_point for cells without a point.
+     */
+    static constexpr size_t no_point = static_cast<size_t>(-1);
+
+    /*!
+     * All cells that needed to be supported, in the order in which they get
+     * supported.
+     */
+    std::vector<UnsupCell> unsupported_points;
+
+    /*!
+     * For each of the \ref unsupported_points, whether it is supported by now.
+     */
+    std::vector<bool> is_supported;
+
+    /*!
+     * The first of the \ref unsupported_points that is not supported yet.
+     */
+    size_t next_unsupported;
+
+    /*!
+     * The lowest grid cell that contains any of the unsupported points.
+     */
+    GridPoint grid_min;
+
+    /*!
+     * The number of grid cells in the X and Y directions that the unsupported
+     * points span.
      */
-    std::list<UnsupCell> unsupported_points;
+    GridPoint grid_size;
 
     /*!
-     * Links the unsupported points to a grid point, so that we can quickly look
-     * up the cell belonging to a certain position in the grid.
+     * Dense grid over the bounding box of the unsupported points, row by row,
+     * with the index of the point in each cell, so that we can quickly look up
+     * the cell belonging to a certain position in the grid.
      */
-    std::unordered_map<SquareGrid::GridPoint, std::list<UnsupCell>::iterator> unsupported_points_grid;
+    std::vector<size_t> cell_to_point;
 };
 
 }
@@ -2,6 +2,7 @@
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
 #include "LightningGenerator.h"
+#include "LightningDistanceField.h"
 #include "LightningLayer.h"
 #include "LightningTreeNode.h"
 
@@ -42,27 +43,36 @@ LightningGenerator::LightningGenerator(const SliceMeshStorage& mesh)
 
 void LightningGenerator::generateInitialInternalOverhangs(const SliceMeshStorage& mesh)
 {
-    overhang_per_layer.resize(mesh.layers.size());
+    const size_t layer_count = mesh.layers.size();
+    infill_outlines.resize(layer_count);
+    overhang_per_layer.resize(layer_count);
     const auto infill_wall_line_count = static_cast<coord_t>(mesh.settings.get<size_t>("infill_wall_line_count"));
     const auto infill_line_width = mesh.settings.get<coord_t>("infill_line_width");
     const coord_t infill_wall_offset = - infill_wall_line_count *  infill_line_width;
 
-    Polygons infill_area_above;
-    //Iterate from top to bottom, to subtract the overhang areas above from the overhang areas on the layer below, to get only overhang in the top layer where it is overhanging.
-    for (int layer_nr = mesh.layers.size() - 1; layer_nr >= 0; layer_nr--)
+#pragma omp parallel for default(none) shared(mesh, layer_count, infill_wall_offset) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(layer_count); layer_nr++)
     {
-        const SliceLayer& current_layer = mesh.layers[layer_nr];
-        Polygons infill_area_here;
-        for (auto& part : current_layer.parts)
+        for (const SliceLayerPart& part : mesh.layers[layer_nr].parts)
         {
-            infill_area_here.add(part.getOwnInfillArea().offset(infill_wall_offset));
+            infill_outlines[layer_nr].add(part.getOwnInfillArea().offset(infill_wall_offset));
         }
+    }
 
+    //Subtract the infill area above from the overhang areas on the layer below, to get only overhang in the top layer where it is overhanging.
+    //The infill areas of all layers are known now, so the layers are independent.
+#pragma omp parallel for default(none) shared(layer_count) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(layer_count); layer_nr++)
+    {
         //Remove the part of the infill area that is already supported by the walls.
-        Polygons overhang = infill_area_here.offset(-wall_supporting_radius).difference(infill_area_above);
-
-        overhang_per_layer[layer_nr] = overhang;
-        infill_area_above = std::move(infill_area_here);
+        Polygons overhang = infill_outlines[layer_nr].offset(-wall_supporting_radius);
+        if (static_cast<size_t>(layer_nr) + 1 < layer_count)
+        {
+            overhang = overhang.difference(infill_outlines[layer_nr + 1]);
+        }
+        overhang_per_layer[layer_nr] = std::move(overhang);
     }
 }
 
@@ -74,40 +84,40 @@ const LightningLayer& LightningGenerator::getTreesForLayer(const size_t& layer_i
 
 void LightningGenerator::generateTrees(const SliceMeshStorage& mesh)
 {
-    lightning_layers.resize(mesh.layers.size());
-    const auto infill_wall_line_count = static_cast<coord_t>(mesh.settings.get<size_t>("infill_wall_line_count"));
-    const auto infill_line_width = mesh.settings.get<coord_t>("infill_line_width");
-    const coord_t infill_wall_offset = - infill_wall_line_count *  infill_line_width;
-
-    std::vector<Polygons> infill_outlines;
-    infill_outlines.insert(infill_outlines.end(), mesh.layers.size(), Polygons());
-
-    // For-each layer from top to bottom:
-    for (int layer_id = mesh.layers.size() - 1; layer_id >= 0; layer_id--)
+    const size_t layer_count = mesh.layers.size();
+    lightning_layers.resize(layer_count);
+    if (layer_count == 0)
     {
-        for (const auto& part : mesh.layers[layer_id].parts)
-        {
-            infill_outlines[layer_id].add(part.getOwnInfillArea().offset(infill_wall_offset));
-        }
+        return;
     }
 
+    // The outline locators and the points to support of each layer don't depend on the trees, so prepare them for all layers at once.
     // For various operations its beneficial to quickly locate nearby features on the polygon:
-    const size_t top_layer_id = mesh.layers.size() - 1;
-    auto outlines_locator_ptr = PolygonUtils::createLocToLineGrid(infill_outlines[top_layer_id], locator_cell_size);
+    std::vector<std::unique_ptr<LocToLineGrid>> outlines_locator_per_layer(layer_count);
+    std::vector<std::unique_ptr<LightningDistanceField>> distance_field_per_layer(layer_count);
+#pragma omp parallel for default(none) shared(layer_count, outlines_locator_per_layer, distance_field_per_layer) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_id = 0; layer_id < static_cast<int>(layer_count); layer_id++)
+    {
+        outlines_locator_per_layer[layer_id] = PolygonUtils::createLocToLineGrid(infill_outlines[layer_id], locator_cell_size);
+        distance_field_per_layer[layer_id] = std::make_unique<LightningDistanceField>(supporting_radius, infill_outlines[layer_id], overhang_per_layer[layer_id]);
+    }
 
-    // For-each layer from top to bottom:
-    for (int layer_id = top_layer_id; layer_id >= 0; layer_id--)
+    // Each layer continues the trees of the layer above it, so this has to go from top to bottom, one layer at a time:
+    for (int layer_id = layer_count - 1; layer_id >= 0; layer_id--)
     {
         LightningLayer& current_lightning_layer = lightning_layers[layer_id];
         Polygons& current_outlines = infill_outlines[layer_id];
-        const auto& outlines_locator = *outlines_locator_ptr;
+        const auto& outlines_locator = *outlines_locator_per_layer[layer_id];
 
         // register all trees propagated from the previous layer as to-be-reconnected
-        std::vector<LightningTreeNodeSPtr> to_be_reconnected_tree_roots = current_lightning_layer.tree_roots;
+        std::vector<LightningTreeNodeIdx> to_be_reconnected_tree_roots = current_lightning_layer.tree_roots;
 
-        current_lightning_layer.generateNewTrees(overhang_per_layer[layer_id], current_outlines, outlines_locator, supporting_radius, wall_supporting_radius);
+        current_lightning_layer.generateNewTrees(*distance_field_per_layer[layer_id], current_outlines, outlines_locator, supporting_radius, wall_supporting_radius);
+        distance_field_per_layer[layer_id].reset();
 
         current_lightning_layer.reconnectRoots(to_be_reconnected_tree_roots, current_outlines, outlines_locator, supporting_radius, wall_supporting_radius);
+        outlines_locator_per_layer[layer_id].reset();
 
         // Initialize trees for next lower layer from the current one.
         if (layer_id == 0)
@@ -115,13 +125,8 @@ void LightningGenerator::generateTrees(const SliceMeshStorage& mesh)
             return;
         }
         const Polygons& below_outlines = infill_outlines[layer_id - 1];
-        outlines_locator_ptr = PolygonUtils::createLocToLineGrid(below_outlines, locator_cell_size);
-        const auto& below_outlines_locator = *outlines_locator_ptr;
+        const auto& below_outlines_locator = *outlines_locator_per_layer[layer_id - 1];
 
-        std::vector<LightningTreeNodeSPtr>& lower_trees = lightning_layers[layer_id - 1].tree_roots;
-        for (auto& tree : current_lightning_layer.tree_roots)
-        {
-            tree->propagateToNextLayer(lower_trees, below_outlines, below_outlines_locator, prune_length, straightening_max_distance, locator_cell_size / 2);
-        }
+        current_lightning_layer.propagateToNextLayer(lightning_layers[layer_id - 1], below_outlines, below_outlines_locator, prune_length, straightening_max_distance, locator_cell_size / 2);
     }
 }
@@ -65,11 +65,18 @@ protected:
      * Normally, overhangs are only generated for the outside of the model and
      * only when support is generated. For this pattern, we also need to
      * generate overhang areas for the inside of the model.
+     *
+     * This also computes the \ref infill_outlines of each layer. The layers
+     * are processed in parallel.
      */
     void generateInitialInternalOverhangs(const SliceMeshStorage& mesh);
 
     /*!
      * Calculate the tree structure of all layers.
+     *
+     * The parts that only depend on the layer itself (the outline locators and
+     * the distance fields) are prepared for all layers in parallel. Only
+     * growing and propagating the trees goes layer by layer.
      */
     void generateTrees(const SliceMeshStorage& mesh);
 
@@ -106,6 +113,13 @@ protected:
      */
     coord_t straightening_max_distance;
 
+    /*!
+     * For each layer, the area to fill with the pattern.
+     *
+     * This is generated by \ref generateInitialInternalOverhangs.
+     */
+    std::vector<Polygons> infill_outlines;
+
     /*!
      * For each layer, the overhang that needs to be supported by the pattern.
      *
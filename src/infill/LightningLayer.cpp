@@ -3,6 +3,7 @@
 
 #include "LightningLayer.h" //The class we're implementing.
 
+#include <algorithm> // remove, remove_if
 #include <iterator> // advance
 
 #include "LightningDistanceField.h"
@@ -19,11 +20,11 @@ coord_t LightningLayer::getWeightedDistance(const Point& boundary_loc, const Poi
     return vSize(boundary_loc - unsupported_location);
 }
 
-Point GroundingLocation::p() const
+Point GroundingLocation::p(const std::vector<LightningTreeNode>& nodes) const
 {
-    if (tree_node != nullptr)
+    if (tree_node != no_lightning_tree_node)
     {
-        return tree_node->getLocation();
+        return nodes[tree_node].p;
     }
     else
     {
@@ -32,32 +33,31 @@ Point GroundingLocation::p() const
     }
 }
 
-void LightningLayer::fillLocator(SparseLightningTreeNodeGrid& tree_node_locator)
+void LightningLayer::fillLocator(SparseLightningTreeNodeGrid& tree_node_locator) const
 {
-    std::function<void(LightningTreeNodeSPtr)> add_node_to_locator_func =
-        [&tree_node_locator](LightningTreeNodeSPtr node)
+    std::function<void(LightningTreeNodeIdx)> add_node_to_locator_func =
+        [this, &tree_node_locator](LightningTreeNodeIdx node)
         {
-            tree_node_locator.insert(node->getLocation(), node);
+            tree_node_locator.insert(nodes[node].p, node);
         };
-    for (auto& tree : tree_roots)
+    for (const LightningTreeNodeIdx tree : tree_roots)
     {
-        tree->visitNodes(add_node_to_locator_func);
+        visitNodes(tree, add_node_to_locator_func);
     }
 }
 
 void LightningLayer::generateNewTrees
 (
-    const Polygons& current_overhang,
+    LightningDistanceField& distance_field,
     const Polygons& current_outlines,
     const LocToLineGrid& outlines_locator,
     const coord_t supporting_radius,
     const coord_t wall_supporting_radius
 )
 {
-    LightningDistanceField distance_field(supporting_radius, current_outlines, current_overhang);
-
     SparseLightningTreeNodeGrid tree_node_locator(locator_cell_size);
     fillLocator(tree_node_locator);
+    const IndexedPolygons outlines_index(current_outlines, outlines_locator);
 
     // Until no more points need to be added to support all:
     // Determine next point from tree/outline areas via distance-field
@@ -68,60 +68,59 @@ void LightningLayer::generateNewTrees
             getBestGroundingLocation
             (
                 unsupported_location,
-                current_outlines,
+                outlines_index,
                 outlines_locator,
                 supporting_radius,
                 wall_supporting_radius,
                 tree_node_locator
             );
 
-        LightningTreeNodeSPtr new_parent;
-        LightningTreeNodeSPtr new_child;
+        LightningTreeNodeIdx new_parent = no_lightning_tree_node;
+        LightningTreeNodeIdx new_child = no_lightning_tree_node;
         attach(unsupported_location, grounding_loc, new_child, new_parent);
-        tree_node_locator.insert(new_child->getLocation(), new_child);
-        if (new_parent)
+        tree_node_locator.insert(nodes[new_child].p, new_child);
+        if (new_parent != no_lightning_tree_node)
         {
-            tree_node_locator.insert(new_parent->getLocation(), new_parent);
+            tree_node_locator.insert(nodes[new_parent].p, new_parent);
         }
 
         // update distance field
-        distance_field.update(grounding_loc.p(), unsupported_location);
+        distance_field.update(grounding_loc.p(nodes), unsupported_location);
     }
 }
 
 GroundingLocation LightningLayer::getBestGroundingLocation
 (
     const Point& unsupported_location,
-    const Polygons& current_outlines,
+    const IndexedPolygons& current_outlines,
     const LocToLineGrid& outline_locator,
     const coord_t supporting_radius,
     const coord_t wall_supporting_radius,
     const SparseLightningTreeNodeGrid& tree_node_locator,
-    const LightningTreeNodeSPtr& exclude_tree
+    const LightningTreeNodeIdx exclude_tree
 )
 {
-    ClosestPolygonPoint cpp = PolygonUtils::findClosest(unsupported_location, current_outlines);
+    ClosestPolygonPoint cpp = current_outlines.findClosest(unsupported_location);
     Point node_location = cpp.p();
     const coord_t within_dist = vSize(node_location - unsupported_location);
 
     PolygonsPointIndex dummy;
 
-    LightningTreeNodeSPtr sub_tree{ nullptr };
+    LightningTreeNodeIdx sub_tree = no_lightning_tree_node;
     coord_t current_dist = getWeightedDistance(node_location, unsupported_location);
     if (current_dist >= wall_supporting_radius) // Only reconnect tree roots to other trees if they are not already close to the outlines.
     {
-        auto candidate_trees = tree_node_locator.getNearbyVals(unsupported_location, std::min(current_dist, within_dist));
-        for (auto& candidate_wptr : candidate_trees)
+        const std::vector<LightningTreeNodeIdx> candidate_trees = tree_node_locator.getNearbyVals(unsupported_location, std::min(current_dist, within_dist));
+        for (const LightningTreeNodeIdx candidate_sub_tree : candidate_trees)
         {
-            auto candidate_sub_tree = candidate_wptr.lock();
             if
             (
-                (candidate_sub_tree && candidate_sub_tree != exclude_tree) &&
-                ! (exclude_tree && exclude_tree->hasOffspring(candidate_sub_tree)) &&
-                ! PolygonUtils::polygonCollidesWithLineSegment(unsupported_location, candidate_sub_tree->getLocation(), outline_locator, &dummy)
+                candidate_sub_tree != exclude_tree &&
+                ! (exclude_tree != no_lightning_tree_node && hasOffspring(exclude_tree, candidate_sub_tree)) &&
+                ! PolygonUtils::polygonCollidesWithLineSegment(unsupported_location, nodes[candidate_sub_tree].p, outline_locator, &dummy)
             )
             {
-                const coord_t candidate_dist = candidate_sub_tree->getWeightedDistance(unsupported_location, supporting_radius);
+                const coord_t candidate_dist = getWeightedDistance(candidate_sub_tree, unsupported_location, supporting_radius);
                 if (candidate_dist < current_dist)
                 {
                     current_dist = candidate_dist;
@@ -131,9 +130,9 @@ GroundingLocation LightningLayer::getBestGroundingLocation
         }
     }
 
-    if (! sub_tree)
+    if (sub_tree == no_lightning_tree_node)
     {
-        return GroundingLocation{ nullptr, cpp };
+        return GroundingLocation{ no_lightning_tree_node, cpp };
     }
     else
     {
@@ -145,28 +144,29 @@ bool LightningLayer::attach
 (
     const Point& unsupported_location,
     const GroundingLocation& grounding_loc,
-    LightningTreeNodeSPtr& new_child,
-    LightningTreeNodeSPtr& new_root
+    LightningTreeNodeIdx& new_child,
+    LightningTreeNodeIdx& new_root
 )
 {
     // Update trees & distance fields.
     if (grounding_loc.boundary_location)
     {
-        new_root = LightningTreeNode::create(grounding_loc.p(), std::make_optional(grounding_loc.p()));
-        new_child = new_root->addChild(unsupported_location);
+        const Point ground = grounding_loc.p(nodes);
+        new_root = createNode(ground, std::make_optional(ground));
+        new_child = addChild(new_root, unsupported_location);
         tree_roots.push_back(new_root);
         return true;
     }
     else
     {
-        new_child = grounding_loc.tree_node->addChild(unsupported_location);
+        new_child = addChild(grounding_loc.tree_node, unsupported_location);
         return false;
     }
 }
 
 void LightningLayer::reconnectRoots
 (
-    std::vector<LightningTreeNodeSPtr>& to_be_reconnected_tree_roots,
+    std::vector<LightningTreeNodeIdx>& to_be_reconnected_tree_roots,
     const Polygons& current_outlines,
     const LocToLineGrid& outline_locator,
     const coord_t supporting_radius,
@@ -177,26 +177,27 @@ void LightningLayer::reconnectRoots
 
     SparseLightningTreeNodeGrid tree_node_locator(locator_cell_size);
     fillLocator(tree_node_locator);
+    const IndexedPolygons outline_index(current_outlines, outline_locator);
 
     const coord_t within_max_dist = outline_locator.getCellSize() * 2;
-    for (auto root_ptr : to_be_reconnected_tree_roots)
+    for (const LightningTreeNodeIdx root : to_be_reconnected_tree_roots)
     {
-        auto old_root_it = std::find(tree_roots.begin(), tree_roots.end(), root_ptr);
+        auto old_root_it = std::find(tree_roots.begin(), tree_roots.end(), root);
 
-        if (root_ptr->getLastGroundingLocation())
+        if (nodes[root].last_grounding_location)
         {
-            const Point& ground_loc = root_ptr->getLastGroundingLocation().value();
-            if (ground_loc != root_ptr->getLocation())
+            const Point ground_loc = nodes[root].last_grounding_location.value();
+            if (ground_loc != nodes[root].p)
             {
                 Point new_root_pt;
-                if (PolygonUtils::lineSegmentPolygonsIntersection(root_ptr->getLocation(), ground_loc, current_outlines, outline_locator, new_root_pt, within_max_dist))
+                if (PolygonUtils::lineSegmentPolygonsIntersection(nodes[root].p, ground_loc, current_outlines, outline_locator, new_root_pt, within_max_dist))
                 {
-                    auto new_root = LightningTreeNode::create(new_root_pt, new_root_pt);
-                    root_ptr->addChild(new_root);
-                    new_root->reroot();
+                    const LightningTreeNodeIdx new_root = createNode(new_root_pt, new_root_pt);
+                    addChild(root, new_root);
+                    reroot(new_root);
 
-                    tree_node_locator.insert(new_root->getLocation(), new_root);
-                    *old_root_it = std::move(new_root); // replace old root with new root
+                    tree_node_locator.insert(nodes[new_root].p, new_root);
+                    *old_root_it = new_root; // replace old root with new root
                     continue;
                 }
             }
@@ -206,49 +207,75 @@ void LightningLayer::reconnectRoots
         GroundingLocation ground =
             getBestGroundingLocation
             (
-                root_ptr->getLocation(),
-                current_outlines,
+                nodes[root].p,
+                outline_index,
                 outline_locator,
                 supporting_radius,
                 tree_connecting_ignore_width,
                 tree_node_locator,
-                root_ptr
+                root
             );
         if (ground.boundary_location)
         {
-            if (ground.boundary_location.value().p() == root_ptr->getLocation())
+            if (ground.boundary_location.value().p() == nodes[root].p)
             {
                 continue; // Already on the boundary.
             }
 
-            auto new_root = LightningTreeNode::create(ground.p(), ground.p());
-            auto attach_ptr = root_ptr->closestNode(new_root->getLocation());
-            attach_ptr->reroot();
+            const Point ground_loc = ground.p(nodes);
+            const LightningTreeNodeIdx new_root = createNode(ground_loc, ground_loc);
+            const LightningTreeNodeIdx attach_node = closestNode(root, ground_loc);
+            reroot(attach_node);
 
-            new_root->addChild(attach_ptr);
-            tree_node_locator.insert(new_root->getLocation(), new_root);
+            addChild(new_root, attach_node);
+            tree_node_locator.insert(nodes[new_root].p, new_root);
 
-            *old_root_it = std::move(new_root); // replace old root with new root
+            *old_root_it = new_root; // replace old root with new root
         }
         else
         {
-            assert(ground.tree_node);
-            assert(ground.tree_node != root_ptr);
-            assert(!root_ptr->hasOffspring(ground.tree_node));
-            assert(!ground.tree_node->hasOffspring(root_ptr));
+            assert(ground.tree_node != no_lightning_tree_node);
+            assert(ground.tree_node != root);
+            assert(!hasOffspring(root, ground.tree_node));
+            assert(!hasOffspring(ground.tree_node, root));
 
-            auto attach_ptr = root_ptr->closestNode(ground.tree_node->getLocation());
-            attach_ptr->reroot();
+            const LightningTreeNodeIdx attach_node = closestNode(root, nodes[ground.tree_node].p);
+            reroot(attach_node);
 
-            ground.tree_node->addChild(attach_ptr);
+            addChild(ground.tree_node, attach_node);
 
             // remove old root
-            *old_root_it = std::move(tree_roots.back());
+            *old_root_it = tree_roots.back();
             tree_roots.pop_back();
         }
     }
 }
 
+void LightningLayer::propagateToNextLayer
+(
+    LightningLayer& next_layer,
+    const Polygons& next_outlines,
+    const LocToLineGrid& outline_locator,
+    const coord_t prune_distance,
+    const coord_t smooth_magnitude,
+    const coord_t max_remove_colinear_dist
+) const
+{
+    for (const LightningTreeNodeIdx tree : tree_roots)
+    {
+        const LightningTreeNodeIdx tree_below = next_layer.copySubtree(*this, tree);
+
+        next_layer.prune(tree_below, prune_distance);
+        next_layer.straighten(tree_below, smooth_magnitude, max_remove_colinear_dist);
+        if (next_layer.realign(tree_below, next_outlines, outline_locator, next_layer.tree_roots))
+        {
+            next_layer.tree_roots.push_back(tree_below);
+        }
+    }
+    // Pruning, straightening and realigning leave nodes behind that are no longer in any tree.
+    next_layer.removeUnusedNodes();
+}
+
 // Returns 'added someting'.
 Polygons LightningLayer::convertToLines(const Polygons& limit_to_outline, const coord_t line_width) const
 {
@@ -258,11 +285,448 @@ Polygons LightningLayer::convertToLines(const Polygons& limit_to_outline, const
         return result_lines;
     }
 
-    for (const auto& tree : tree_roots)
+    for (const LightningTreeNodeIdx tree : tree_roots)
     {
-        tree->convertToPolylines(result_lines, line_width);
+        convertToPolylines(tree, result_lines, line_width);
     }
     result_lines = limit_to_outline.intersectionPolyLines(result_lines);
 
     return result_lines;
 }
+
+LightningTreeNodeIdx LightningLayer::createNode(const Point& p, const std::optional<Point>& last_grounding_location)
+{
+    nodes.emplace_back(p, last_grounding_location);
+    return nodes.size() - 1;
+}
+
+LightningTreeNodeIdx LightningLayer::addChild(const LightningTreeNodeIdx node, const Point& child_loc)
+{
+    assert(nodes[node].p != child_loc);
+    const LightningTreeNodeIdx child = createNode(child_loc);
+    return addChild(node, child);
+}
+
+LightningTreeNodeIdx LightningLayer::addChild(const LightningTreeNodeIdx node, const LightningTreeNodeIdx new_child)
+{
+    assert(new_child != node);
+    //assert(p != new_child->p); // NOTE: No problem for now. Issue to solve later. Maybe even afetr final. Low prio.
+    nodes[node].children.push_back(new_child);
+    nodes[new_child].parent = node;
+    return new_child;
+}
+
+LightningTreeNodeIdx LightningLayer::copySubtree(const LightningLayer& source, const LightningTreeNodeIdx source_node)
+{
+    assert(&source != this);
+    const LightningTreeNode& original = source.nodes[source_node];
+    const LightningTreeNodeIdx local_root = createNode(original.p);
+    if (original.isRoot())
+    {
+        nodes[local_root].last_grounding_location = original.last_grounding_location.value_or(original.p);
+    }
+    nodes[local_root].children.reserve(original.children.size());
+    for (const LightningTreeNodeIdx source_child : original.children)
+    {
+        const LightningTreeNodeIdx child = copySubtree(source, source_child);
+        nodes[child].parent = local_root;
+        nodes[local_root].children.push_back(child);
+    }
+    return local_root;
+}
+
+// NOTE: Depth-first, as currently implemented.
+void LightningLayer::visitNodes(const LightningTreeNodeIdx node, const std::function<void(LightningTreeNodeIdx)>& visitor) const
+{
+    visitor(node);
+    for (const LightningTreeNodeIdx child : nodes[node].children)
+    {
+        assert(nodes[child].parent == node);
+        visitNodes(child, visitor);
+    }
+}
+
+coord_t LightningLayer::getWeightedDistance(const LightningTreeNodeIdx node, const Point& unsupported_location, const coord_t& supporting_radius) const
+{
+    constexpr coord_t min_valence_for_boost = 0;
+    constexpr coord_t max_valence_for_boost = 4;
+    constexpr coord_t valence_boost_multiplier = 4;
+
+    const LightningTreeNode& tree_node = nodes[node];
+    const size_t valence = (!tree_node.isRoot()) + tree_node.children.size();
+    const coord_t valence_boost = (min_valence_for_boost < valence && valence < max_valence_for_boost) ? valence_boost_multiplier * supporting_radius : 0;
+    const coord_t dist_here = vSize(tree_node.p - unsupported_location);
+    return dist_here - valence_boost;
+}
+
+bool LightningLayer::hasOffspring(const LightningTreeNodeIdx node, const LightningTreeNodeIdx to_be_checked) const
+{
+    if (to_be_checked == node)
+    {
+        return true;
+    }
+    for (const LightningTreeNodeIdx child : nodes[node].children)
+    {
+        if (hasOffspring(child, to_be_checked)) return true;
+    }
+    return false;
+}
+
+void LightningLayer::reroot(const LightningTreeNodeIdx node, const LightningTreeNodeIdx new_parent /*= no_lightning_tree_node*/)
+{
+    if (! nodes[node].isRoot())
+    {
+        const LightningTreeNodeIdx old_parent = nodes[node].parent;
+        reroot(old_parent, node);
+        nodes[node].children.push_back(old_parent);
+    }
+
+    if (new_parent != no_lightning_tree_node)
+    {
+        std::vector<LightningTreeNodeIdx>& children = nodes[node].children;
+        children.erase(std::remove(children.begin(), children.end(), new_parent), children.end());
+    }
+    nodes[node].parent = new_parent;
+}
+
+LightningTreeNodeIdx LightningLayer::closestNode(const LightningTreeNodeIdx node, const Point& loc) const
+{
+    LightningTreeNodeIdx result = node;
+    coord_t closest_dist2 = vSize2(nodes[node].p - loc);
+
+    for (const LightningTreeNodeIdx child : nodes[node].children)
+    {
+        const LightningTreeNodeIdx candidate_node = closestNode(child, loc);
+        const coord_t child_dist2 = vSize2(nodes[candidate_node].p - loc);
+        if (child_dist2 < closest_dist2)
+        {
+            closest_dist2 = child_dist2;
+            result = candidate_node;
+        }
+    }
+
+    return result;
+}
+
+bool LightningLayer::realign
+(
+    const LightningTreeNodeIdx node,
+    const Polygons& outlines,
+    const LocToLineGrid& outline_locator,
+    std::vector<LightningTreeNodeIdx>& rerooted_parts
+)
+{
+    if (outlines.empty())
+    {
+        return false;
+    }
+
+    // No nodes are added while realigning, so references to the nodes stay valid.
+    LightningTreeNode& tree_node = nodes[node];
+    if (outlines.inside(tree_node.p, true))
+    {
+        // Only keep children that have an unbroken connection to here, realign will put the rest in rerooted parts due to recursion:
+        Point coll;
+        bool reground_me = false;
+        const auto remove_unconnected_func
+        {
+            [&](const LightningTreeNodeIdx child)
+            {
+                bool connect_branch = realign(child, outlines, outline_locator, rerooted_parts);
+                if (connect_branch && PolygonUtils::lineSegmentPolygonsIntersection(nodes[child].p, tree_node.p, outlines, outline_locator, coll, outline_locator.getCellSize() * 2))
+                {
+                    nodes[child].last_grounding_location.reset();
+                    nodes[child].parent = no_lightning_tree_node;
+                    rerooted_parts.push_back(child);
+
+                    reground_me = true;
+                    connect_branch = false;
+                }
+                return ! connect_branch;
+            }
+        };
+        tree_node.children.erase(std::remove_if(tree_node.children.begin(), tree_node.children.end(), remove_unconnected_func), tree_node.children.end());
+        if (reground_me)
+        {
+            tree_node.last_grounding_location.reset();
+        }
+        return true;
+    }
+
+    // 'Lift' any decendants out of this tree:
+    for (const LightningTreeNodeIdx child : tree_node.children)
+    {
+        if (realign(child, outlines, outline_locator, rerooted_parts))
+        {
+            nodes[child].last_grounding_location = tree_node.p;
+            nodes[child].parent = no_lightning_tree_node;
+            rerooted_parts.push_back(child);
+        }
+    }
+    tree_node.children.clear();
+
+    return false;
+}
+
+void LightningLayer::straighten(const LightningTreeNodeIdx node, const coord_t magnitude, const coord_t max_remove_colinear_dist)
+{
+    straighten(node, magnitude, nodes[node].p, 0, max_remove_colinear_dist * max_remove_colinear_dist);
+}
+
+LightningLayer::RectilinearJunction LightningLayer::straighten
+(
+    const LightningTreeNodeIdx node,
+    const coord_t magnitude,
+    const Point junction_above,
+    const coord_t accumulated_dist,
+    const coord_t max_remove_colinear_dist2
+)
+{
+    constexpr coord_t junction_magnitude_factor_numerator = 3;
+    constexpr coord_t junction_magnitude_factor_denominator = 4;
+
+    // No nodes are added while straightening, so references to the nodes stay valid.
+    LightningTreeNode& tree_node = nodes[node];
+    const coord_t junction_magnitude = magnitude * junction_magnitude_factor_numerator / junction_magnitude_factor_denominator;
+    if (tree_node.children.size() == 1)
+    {
+        LightningTreeNodeIdx child = tree_node.children.front();
+        coord_t child_dist = vSize(tree_node.p - nodes[child].p);
+        RectilinearJunction junction_below = straighten(child, magnitude, junction_above, accumulated_dist + child_dist, max_remove_colinear_dist2);
+        coord_t total_dist_to_junction_below = junction_below.total_recti_dist;
+        Point a = junction_above;
+        Point b = junction_below.junction_loc;
+        if (a != b) // should always be true!
+        {
+            Point ab = b - a;
+            Point destination = a + ab * accumulated_dist / std::max(coord_t(1), total_dist_to_junction_below);
+            if (shorterThen(destination - tree_node.p, magnitude))
+            {
+                tree_node.p = destination;
+            }
+            else
+            {
+                tree_node.p = tree_node.p + normal(destination - tree_node.p, magnitude);
+            }
+        }
+        { // remove nodes on linear segments
+            constexpr coord_t close_enough = 10;
+
+            child = tree_node.children.front(); //recursive call to straighten might have removed the child
+            const LightningTreeNodeIdx parent_node = tree_node.parent;
+            if
+            (
+                parent_node != no_lightning_tree_node &&
+                vSize2(nodes[child].p - nodes[parent_node].p) < max_remove_colinear_dist2 &&
+                LinearAlg2D::getDist2FromLineSegment(nodes[parent_node].p, tree_node.p, nodes[child].p) < close_enough
+            )
+            {
+                nodes[child].parent = parent_node;
+                for (LightningTreeNodeIdx& sibling : nodes[parent_node].children)
+                { // find this node among siblings
+                    if (sibling == node)
+                    {
+                        sibling = child; // replace this node by child
+                        break;
+                    }
+                }
+            }
+        }
+        return junction_below;
+    }
+    else
+    {
+        constexpr coord_t weight = 1000;
+        Point junction_moving_dir = normal(junction_above - tree_node.p, weight);
+        bool prevent_junction_moving = false;
+        for (size_t child_idx = 0; child_idx < tree_node.children.size(); child_idx++) // The recursive call may replace the child by its own child.
+        {
+            const LightningTreeNodeIdx child = tree_node.children[child_idx];
+            const coord_t child_dist = vSize(tree_node.p - nodes[child].p);
+            RectilinearJunction below = straighten(child, magnitude, tree_node.p, child_dist, max_remove_colinear_dist2);
+
+            junction_moving_dir += normal(below.junction_loc - tree_node.p, weight);
+            if (below.total_recti_dist < magnitude) // TODO: make configurable?
+            {
+                prevent_junction_moving = true; // prevent flipflopping in branches due to straightening and junctoin moving clashing
+            }
+        }
+        if (junction_moving_dir != Point(0, 0) && ! tree_node.children.empty() && ! tree_node.isRoot() && ! prevent_junction_moving)
+        {
+            coord_t junction_moving_dir_len = vSize(junction_moving_dir);
+            if (junction_moving_dir_len > junction_magnitude)
+            {
+                junction_moving_dir = junction_moving_dir * junction_magnitude / junction_moving_dir_len;
+            }
+            tree_node.p += junction_moving_dir;
+        }
+        return RectilinearJunction{ accumulated_dist, tree_node.p };
+    }
+}
+
+// Prune the tree from the extremeties (leaf-nodes) until the pruning distance is reached.
+coord_t LightningLayer::prune(const LightningTreeNodeIdx node, const coord_t& pruning_distance)
+{
+    if (pruning_distance <= 0)
+    {
+        return 0;
+    }
+
+    // No nodes are added while pruning, so references to the nodes stay valid.
+    LightningTreeNode& tree_node = nodes[node];
+    coord_t max_distance_pruned = 0;
+    for (auto child_it = tree_node.children.begin(); child_it != tree_node.children.end(); )
+    {
+        LightningTreeNode& child = nodes[*child_it];
+        coord_t dist_pruned_child = prune(*child_it, pruning_distance);
+        if (dist_pruned_child >= pruning_distance)
+        { // pruning is finished for child; dont modify further
+            max_distance_pruned = std::max(max_distance_pruned, dist_pruned_child);
+            ++child_it;
+        }
+        else
+        {
+            const Point a = tree_node.p;
+            const Point b = child.p;
+            const Point ba = a - b;
+            const coord_t ab_len = vSize(ba);
+            if (dist_pruned_child + ab_len <= pruning_distance)
+            { // we're still in the process of pruning
+                assert(child.children.empty() && "when pruning away a node all it's children must already have been pruned away");
+                max_distance_pruned = std::max(max_distance_pruned, dist_pruned_child + ab_len);
+                child_it = tree_node.children.erase(child_it);
+            }
+            else
+            { // pruning stops in between this node and the child
+                const Point n = b + normal(ba, pruning_distance - dist_pruned_child);
+                assert(std::abs(vSize(n - b) + dist_pruned_child - pruning_distance) < 10 && "total pruned distance must be equal to the pruning_distance");
+                max_distance_pruned = std::max(max_distance_pruned, pruning_distance);
+                child.p = n;
+                ++child_it;
+            }
+        }
+    }
+
+    return max_distance_pruned;
+}
+
+void LightningLayer::removeUnusedNodes()
+{
+    // Find the nodes that are still in a tree, in the order in which they are visited.
+    std::vector<LightningTreeNodeIdx> used_nodes;
+    used_nodes.reserve(nodes.size());
+    for (const LightningTreeNodeIdx tree : tree_roots)
+    {
+        visitNodes(tree, [&used_nodes](const LightningTreeNodeIdx node) { used_nodes.push_back(node); });
+    }
+    if (used_nodes.size() == nodes.size())
+    {
+        return;
+    }
+
+    std::vector<LightningTreeNodeIdx> new_index(nodes.size(), no_lightning_tree_node);
+    for (size_t new_idx = 0; new_idx < used_nodes.size(); new_idx++)
+    {
+        new_index[used_nodes[new_idx]] = new_idx;
+    }
+
+    std::vector<LightningTreeNode> compacted_nodes;
+    compacted_nodes.reserve(used_nodes.size());
+    for (const LightningTreeNodeIdx node : used_nodes)
+    {
+        compacted_nodes.push_back(std::move(nodes[node]));
+        LightningTreeNode& moved_node = compacted_nodes.back();
+        if (! moved_node.isRoot())
+        {
+            moved_node.parent = new_index[moved_node.parent];
+        }
+        for (LightningTreeNodeIdx& child : moved_node.children)
+        {
+            child = new_index[child];
+        }
+    }
+    nodes = std::move(compacted_nodes);
+    for (LightningTreeNodeIdx& tree : tree_roots)
+    {
+        tree = new_index[tree];
+    }
+}
+
+void LightningLayer::convertToPolylines(const LightningTreeNodeIdx node, Polygons& output, const coord_t line_width) const
+{
+    Polygons result;
+    result.newPoly();
+    //Seeded with the location of the root, so the result doesn't depend on the order in which layers are processed.
+    const Point& root = nodes[node].p;
+    std::minstd_rand random_generator(static_cast<std::minstd_rand::result_type>(root.X * 73856093 ^ root.Y * 19349663));
+    convertToPolylines(node, 0, result, random_generator);
+    removeJunctionOverlap(result, line_width);
+    output.add(result);
+}
+
+void LightningLayer::convertToPolylines(const LightningTreeNodeIdx node, size_t long_line_idx, Polygons& output, std::minstd_rand& random_generator) const
+{
+    const LightningTreeNode& tree_node = nodes[node];
+    if (tree_node.children.empty())
+    {
+        output[long_line_idx].add(tree_node.p);
+        return;
+    }
+    size_t first_child_idx = random_generator() % tree_node.children.size();
+    convertToPolylines(tree_node.children[first_child_idx], long_line_idx, output, random_generator);
+    output[long_line_idx].add(tree_node.p);
+
+    for (size_t idx_offset = 1; idx_offset < tree_node.children.size(); idx_offset++)
+    {
+        size_t child_idx = (first_child_idx + idx_offset) % tree_node.children.size();
+        output.newPoly();
+        size_t child_line_idx = output.size() - 1;
+        convertToPolylines(tree_node.children[child_idx], child_line_idx, output, random_generator);
+        output[child_line_idx].add(tree_node.p);
+    }
+}
+
+void LightningLayer::removeJunctionOverlap(Polygons& result_lines, const coord_t line_width)
+{
+    const coord_t reduction = line_width / 2; // TODO make configurable?
+    for (auto poly_it = result_lines.begin(); poly_it != result_lines.end(); )
+    {
+        PolygonRef polyline = *poly_it;
+        if (polyline.size() <= 1)
+        {
+            polyline = std::move(result_lines.back());
+            result_lines.pop_back();
+            continue;
+        }
+
+        coord_t to_be_reduced = reduction;
+        Point a = polyline.back();
+        for (int point_idx = polyline.size() - 2; point_idx >= 0; point_idx--)
+        {
+            const Point b = polyline[point_idx];
+            const Point ab = b - a;
+            const coord_t ab_len = vSize(ab);
+            if (ab_len >= to_be_reduced)
+            {
+                polyline.back() = a + ab * to_be_reduced / ab_len;
+                break;
+            }
+            else
+            {
+                to_be_reduced -= ab_len;
+                polyline.pop_back();
+            }
+            a = b;
+        }
+
+        if (polyline.size() <= 1)
+        {
+            polyline = std::move(result_lines.back());
+            result_lines.pop_back();
+        }
+        else
+        {
+            ++poly_it;
+        }
+    }
+}
@@ -4,41 +4,56 @@
 #ifndef LIGHTNING_LAYER_H
 #define LIGHTNING_LAYER_H
 
+#include "LightningTreeNode.h"
+#include "../utils/IndexedPolygons.h"
 #include "../utils/polygonUtils.h"
 #include "../utils/SquareGrid.h"
 
-#include <memory>
+#include <functional>
+#include <optional>
+#include <random>
 #include <vector>
-#include <list>
-#include <unordered_map>
 
 namespace cura
 {
-class LightningTreeNode;
+class LightningDistanceField;
 
-using LightningTreeNodeSPtr = std::shared_ptr<LightningTreeNode>;
-using SparseLightningTreeNodeGrid = SparsePointGridInclusive<std::weak_ptr<LightningTreeNode>>;
+using SparseLightningTreeNodeGrid = SparsePointGridInclusive<LightningTreeNodeIdx>;
 
 struct GroundingLocation
 {
-    LightningTreeNodeSPtr tree_node; //!< not null if the gounding location is on a tree
+    LightningTreeNodeIdx tree_node; //!< not no_lightning_tree_node if the gounding location is on a tree
     std::optional<ClosestPolygonPoint> boundary_location; //!< in case the gounding location is on the boundary
-    Point p() const;
+
+    /*!
+     * Get the position of the grounding location.
+     * \param nodes The nodes of the layer that \ref tree_node belongs to.
+     */
+    Point p(const std::vector<LightningTreeNode>& nodes) const;
 };
 
 /*!
  * A layer of the lightning fill.
  *
  * Contains the trees to be printed and propagated to the next layer below.
+ * All nodes of the trees of the layer are stored in a pool, and refer to each
+ * other by their index in it.
  */
 class LightningLayer
 {
 public:
-    std::vector<LightningTreeNodeSPtr> tree_roots;
+    std::vector<LightningTreeNodeIdx> tree_roots; //!< The roots of the trees, as indices in the \ref nodes.
+
+    std::vector<LightningTreeNode> nodes; //!< The pool with all nodes of the trees on this layer.
 
+    /*!
+     * Add branches until all points of the distance field are supported.
+     * \param distance_field The points of the overhang on this layer that
+     * still need to be supported. These are removed as they get supported.
+     */
     void generateNewTrees
     (
-        const Polygons& current_overhang,
+        LightningDistanceField& distance_field,
         const Polygons& current_outlines,
         const LocToLineGrid& outline_locator,
         const coord_t supporting_radius,
@@ -46,17 +61,18 @@ public:
     );
 
     /*! Determine & connect to connection point in tree/outline.
+     * \param current_outlines The outlines, indexed to find the closest point on them for many locations.
      * \param min_dist_from_boundary_for_tree If the unsupported point is closer to the boundary than this then don't consider connecting it to a tree
      */
     GroundingLocation getBestGroundingLocation
     (
         const Point& unsupported_location,
-        const Polygons& current_outlines,
+        const IndexedPolygons& current_outlines,
         const LocToLineGrid& outline_locator,
         const coord_t supporting_radius,
         const coord_t wall_supporting_radius,
         const SparseLightningTreeNodeGrid& tree_node_locator,
-        const LightningTreeNodeSPtr& exclude_tree = nullptr
+        const LightningTreeNodeIdx exclude_tree = no_lightning_tree_node
     );
 
     /*!
@@ -64,22 +80,204 @@ public:
      * \param[out] new_root The new root node if one had been made
      * \return Whether a new root was added
      */
-    bool attach(const Point& unsupported_location, const GroundingLocation& ground, LightningTreeNodeSPtr& new_child, LightningTreeNodeSPtr& new_root);
+    bool attach(const Point& unsupported_location, const GroundingLocation& ground, LightningTreeNodeIdx& new_child, LightningTreeNodeIdx& new_root);
 
     void reconnectRoots
     (
-        std::vector<LightningTreeNodeSPtr>& to_be_reconnected_tree_roots,
+        std::vector<LightningTreeNodeIdx>& to_be_reconnected_tree_roots,
         const Polygons& current_outlines,
         const LocToLineGrid& outline_locator,
         const coord_t supporting_radius,
         const coord_t wall_supporting_radius
     );
 
+    /*!
+     * Propagate the trees of this layer to the next layer.
+     *
+     * Creates a copy of each tree in \p next_layer, realigns it to the new
+     * layer boundaries \p next_outlines and reduces (i.e. prunes and
+     * straightens) it.
+     * \param next_layer The layer below, which gets the copies of the trees.
+     * \param next_outlines The shape of the layer below, to make sure that the
+     * trees stay within the bounds of the infill area.
+     * \param outline_locator Locator for the line segments of
+     * \p next_outlines .
+     * \param prune_distance The maximum distance that a leaf node may be moved
+     * such that it still supports the current node.
+     * \param smooth_magnitude The maximum distance that a line may be shifted
+     * to straighten the tree's paths, such that it still supports the current
+     * paths.
+     * \param max_remove_colinear_dist The maximum distance of a line-segment
+     * from which straightening may remove a colinear point.
+     */
+    void propagateToNextLayer
+    (
+        LightningLayer& next_layer,
+        const Polygons& next_outlines,
+        const LocToLineGrid& outline_locator,
+        const coord_t prune_distance,
+        const coord_t smooth_magnitude,
+        const coord_t max_remove_colinear_dist
+    ) const;
+
     Polygons convertToLines(const Polygons& limit_to_outline, const coord_t line_width) const;
 
     coord_t getWeightedDistance(const Point& boundary_loc, const Point& unsupported_location);
 
-    void fillLocator(SparseLightningTreeNodeGrid& tree_node_locator);
+    void fillLocator(SparseLightningTreeNodeGrid& tree_node_locator) const;
+
+protected:
+    struct RectilinearJunction
+    {
+        coord_t total_recti_dist; //!< rectilinear distance along the tree from the last junction above to the junction below
+        Point junction_loc; //!< junction location below
+    };
+
+    /*!
+     * Add a new node to the pool, which is not connected to any tree yet.
+     * \param p The location of the new node.
+     * \param last_grounding_location The last known grounding location of the
+     * new node, if any.
+     * \return The index of the new node.
+     */
+    LightningTreeNodeIdx createNode(const Point& p, const std::optional<Point>& last_grounding_location = std::nullopt);
+
+    /*!
+     * Construct a new node and add it as a child of a node.
+     * \param node The node to add the child to.
+     * \param child_loc The location of the new node.
+     * \return The index of the new node.
+     */
+    LightningTreeNodeIdx addChild(const LightningTreeNodeIdx node, const Point& child_loc);
+
+    /*!
+     * Add an existing node as a child of a node.
+     * \param node The node to add the child to.
+     * \param new_child The node that must be added as a child.
+     * \return Always returns \p new_child.
+     */
+    LightningTreeNodeIdx addChild(const LightningTreeNodeIdx node, const LightningTreeNodeIdx new_child);
+
+    /*!
+     * Copy a node of another layer and its entire sub-tree into this layer.
+     * \param source The layer that the node belongs to.
+     * \param source_node The node to copy.
+     * \return The equivalent of the node in the copy (the root of the new sub-
+     * tree).
+     */
+    LightningTreeNodeIdx copySubtree(const LightningLayer& source, const LightningTreeNodeIdx source_node);
+
+    /*!
+     * Execute a given function for every node in a node's sub-tree.
+     *
+     * Nodes are visited in depth-first order. The node itself is visited as
+     * well (pre-order).
+     * \param node The node of which to visit the sub-tree.
+     * \param visitor A function to execute for every node in the sub-tree.
+     */
+    void visitNodes(const LightningTreeNodeIdx node, const std::function<void(LightningTreeNodeIdx)>& visitor) const;
+
+    /*!
+     * Get a weighted distance from an unsupported point to a node (given the current supporting radius).
+     *
+     * When attaching a unsupported location to a node, not all nodes have the same priority.
+     * (Eucludian) closer nodes are prioritised, but that's not the whole story.
+     * For instance, we give some nodes a 'valence boost' depending on the nr. of branches.
+     * \param node The node to compute the distance to.
+     * \param unsupported_location The (unsuppported) location of which the weighted distance needs to be calculated.
+     * \param supporting_radius The maximum distance which can be bridged without (infill) supporting it.
+     * \return The weighted distance.
+     */
+    coord_t getWeightedDistance(const LightningTreeNodeIdx node, const Point& unsupported_location, const coord_t& supporting_radius) const;
+
+    /*!
+     * Returns whether the given tree node is a descendant of a node.
+     *
+     * If the node itself is given, it is also considered to be a descendant.
+     * \param node The node of which to search the sub-tree.
+     * \param to_be_checked A node to find out whether it is a descendant of
+     * \p node .
+     * \return ``true`` if the given node is a descendant or the node itself,
+     * or ``false`` if it is not in the sub-tree.
+     */
+    bool hasOffspring(const LightningTreeNodeIdx node, const LightningTreeNodeIdx to_be_checked) const;
+
+    /*!
+     * Reverse the parent-child relationship all the way to the root, from a node onward.
+     * This has the effect of 're-rooting' the tree at the node if no immediate parent is given as argument.
+     * That is, the node will become the root, it's (former) parent if any, will become one of it's children.
+     * This is then recursively bubbled up until it reaches the (former) root, which then will become a leaf.
+     * \param node The node that becomes the root.
+     * \param new_parent The (new) parent-node of the root, useful for recursing or immediately attaching the node to another tree.
+     */
+    void reroot(const LightningTreeNodeIdx node, const LightningTreeNodeIdx new_parent = no_lightning_tree_node);
+
+    /*!
+     * Retrieves the closest node to the specified location.
+     * \param node The root of the sub-tree to search in.
+     * \param loc The specified location.
+     * \result The branch that starts at the position closest to the location within this tree.
+     */
+    LightningTreeNodeIdx closestNode(const LightningTreeNodeIdx node, const Point& loc) const;
+
+    /*! Reconnect trees from the layer above to the new outlines of the lower layer.
+     * \return Wether or not the root is kept (false is no, true is yes).
+     */
+    bool realign(const LightningTreeNodeIdx node, const Polygons& outlines, const LocToLineGrid& outline_locator, std::vector<LightningTreeNodeIdx>& rerooted_parts);
+
+    /*!
+     * Smoothen the tree to make it a bit more printable, while still supporting
+     * the trees above.
+     * \param node The root of the tree to smoothen.
+     * \param magnitude The maximum allowed distance to move the node.
+     * \param max_remove_colinear_dist Maximum distance of the (compound) line-segment from which a co-linear point may be removed.
+     */
+    void straighten(const LightningTreeNodeIdx node, const coord_t magnitude, const coord_t max_remove_colinear_dist);
+
+    /*! Recursive part of \ref straighten(.)
+     * \param node The node to smoothen the sub-tree of.
+     * \param junction_above The last seen junction with multiple children above
+     * \param accumulated_dist The distance along the tree from the last seen junction to this node
+     * \param max_remove_colinear_dist2 Maximum distance _squared_ of the (compound) line-segment from which a co-linear point may be removed.
+     * \return the total distance along the tree from the last junction above to the first next junction below and the location of the next junction below
+     */
+    RectilinearJunction straighten(const LightningTreeNodeIdx node, const coord_t magnitude, const Point junction_above, const coord_t accumulated_dist, const coord_t max_remove_colinear_dist2);
+
+    /*! Prune the tree from the extremeties (leaf-nodes) until the pruning distance is reached.
+     * \return The distance that has been pruned. If less than \p distance, then the whole tree was puned away.
+     */
+    coord_t prune(const LightningTreeNodeIdx node, const coord_t& distance);
+
+    /*!
+     * Remove the nodes from the pool that are no longer part of any tree, e.g.
+     * because they were pruned.
+     *
+     * This changes the indices of the remaining nodes.
+     */
+    void removeUnusedNodes();
+
+    /*!
+     * Convert a tree into polylines
+     *
+     * At each junction one line is chosen at random to continue
+     *
+     * The lines start at a leaf and end in a junction
+     *
+     * \param node The root of the tree to convert.
+     * \param output all branches in this tree connected into polylines
+     */
+    void convertToPolylines(const LightningTreeNodeIdx node, Polygons& output, const coord_t line_width) const;
+
+    /*!
+     * Recursive part of \ref convertToPolylines(.)
+     * \param node The node of which to convert the sub-tree.
+     * \param long_line a reference to a polyline in \p output which to continue building on in the recursion
+     * \param output all branches in this tree connected into polylines
+     * \param random_generator Chooses which branch continues the long line at each junction.
+     */
+    void convertToPolylines(const LightningTreeNodeIdx node, size_t long_line_idx, Polygons& output, std::minstd_rand& random_generator) const;
+
+    static void removeJunctionOverlap(Polygons& polylines, const coord_t line_width);
 };
 
 } // namespace cura
@@ -0,0 +1,154 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef INFILL_SCANLINE_CROSSINGS_H
+#define INFILL_SCANLINE_CROSSINGS_H
+
+#include <cassert>
+#include <cstddef> //For size_t.
+#include <vector>
+
+namespace cura
+{
+
+/*!
+ * \brief The crossings of the outline with the scanlines of linear based
+ * infill, grouped per scanline.
+ *
+ * The crossings are collected in one flat buffer, in the order in which the
+ * polygon segments are visited, together with the scanline that each belongs
+ * to. Afterwards they are grouped per scanline with a counting sort, so that
+ * the crossings of each scanline are stored next to each other. This avoids a
+ * separate allocation for every scanline.
+ *
+ * Grouping is stable: the crossings of each scanline stay in the order in which
+ * they were added.
+ *
+ * \tparam T The data stored per crossing.
+ */
+template<typename T>
+class ScanlineCrossings
+{
+public:
+    using iterator = typename std::vector<T>::iterator;
+
+    /*!
+     * Create an empty set of crossings.
+     * \param min_scanline_idx The index of the first scanline.
+     * \param scanline_count How many scanlines there are.
+     */
+    ScanlineCrossings(const int min_scanline_idx, const size_t scanline_count)
+    : min_scanline_idx(min_scanline_idx)
+    , scanline_count(scanline_count)
+    , is_grouped(false)
+    {
+    }
+
+    /*!
+     * Add a crossing with a scanline.
+     *
+     * This may only be done before the crossings are grouped.
+     * \param scanline_idx The index of the scanline the crossing is on.
+     * \param crossing The crossing to add.
+     */
+    void add(const int scanline_idx, const T& crossing)
+    {
+        assert(!is_grouped && "Crossings can't be added after grouping them per scanline.");
+        assert(scanline_idx - min_scanline_idx >= 0 && scanline_idx - min_scanline_idx < static_cast<int>(scanline_count) && "Adding a crossing to a scanline out of bounds!");
+        scanline_per_crossing.push_back(scanline_idx - min_scanline_idx);
+        crossings.push_back(crossing);
+    }
+
+    /*!
+     * Group the crossings per scanline, so that they can be iterated over.
+     */
+    void groupPerScanline()
+    {
+        if (is_grouped)
+        {
+            return;
+        }
+        is_grouped = true;
+
+        scanline_start.assign(scanline_count + 1, 0);
+        for (const size_t scanline : scanline_per_crossing)
+        {
+            scanline_start[scanline + 1]++;
+        }
+        for (size_t scanline = 0; scanline < scanline_count; scanline++)
+        {
+            scanline_start[scanline + 1] += scanline_start[scanline];
+        }
+        std::vector<size_t> next_position(scanline_start.begin(), scanline_start.end() - 1);
+        std::vector<size_t> order(crossings.size());
+        for (size_t crossing_idx = 0; crossing_idx < crossings.size(); crossing_idx++)
+        {
+            order[next_position[scanline_per_crossing[crossing_idx]]++] = crossing_idx;
+        }
+        std::vector<T> grouped;
+        grouped.reserve(crossings.size());
+        for (const size_t crossing_idx : order)
+        {
+            grouped.push_back(crossings[crossing_idx]);
+        }
+        crossings.swap(grouped);
+        scanline_per_crossing.clear();
+        scanline_per_crossing.shrink_to_fit();
+    }
+
+    /*!
+     * How many scanlines there are.
+     */
+    size_t scanlineCount() const
+    {
+        return scanline_count;
+    }
+
+    /*!
+     * How many crossings there are on a scanline.
+     *
+     * The crossings must be grouped per scanline.
+     * \param scanline The scanline, counted from the first scanline.
+     */
+    size_t crossingCount(const size_t scanline) const
+    {
+        assert(is_grouped);
+        return scanline_start[scanline + 1] - scanline_start[scanline];
+    }
+
+    /*!
+     * The first crossing on a scanline.
+     *
+     * The crossings must be grouped per scanline.
+     * \param scanline The scanline, counted from the first scanline.
+     */
+    iterator begin(const size_t scanline)
+    {
+        assert(is_grouped);
+        return crossings.begin() + scanline_start[scanline];
+    }
+
+    /*!
+     * Past the last crossing on a scanline.
+     *
+     * The crossings must be grouped per scanline.
+     * \param scanline The scanline, counted from the first scanline.
+     */
+    iterator end(const size_t scanline)
+    {
+        assert(is_grouped);
+        return crossings.begin() + scanline_start[scanline + 1];
+    }
+
+private:
+    int min_scanline_idx; //!< The index of the first scanline.
+    size_t scanline_count; //!< How many scanlines there are.
+    bool is_grouped; //!< Whether the crossings are grouped per scanline yet.
+    std::vector<T> crossings; //!< All crossings. Once grouped, the crossings of each scanline are contiguous.
+    std::vector<size_t> scanline_per_crossing; //!< Before grouping, the scanline that each crossing is on, counted from the first scanline.
+    std::vector<size_t> scanline_start; //!< After grouping, where the crossings of each scanline start. Has one extra entry for the end.
+};
+
+} //namespace cura
+
+#endif //INFILL_SCANLINE_CROSSINGS_H
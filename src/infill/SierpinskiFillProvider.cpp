@@ -16,6 +16,7 @@ namespace cura
 
 constexpr bool SierpinskiFillProvider::get_constructor;
 constexpr bool SierpinskiFillProvider::use_dithering;
+constexpr size_t SierpinskiFillProvider::cross_3d_cache_size;
 
 SierpinskiFillProvider::SierpinskiFillProvider(const AABB3D aabb_3d, coord_t min_line_distance, const coord_t line_width)
 : fractal_config(getFractalConfig(aabb_3d, min_line_distance))
@@ -37,11 +38,29 @@ Polygon SierpinskiFillProvider::generate(EFillMethod pattern, coord_t z, coord_t
     {
         if (pattern == EFillMethod::CROSS_3D)
         {
-            return fill_pattern_for_all_layers->generateCross(z, line_width / 2, pocket_size);
+            {
+                std::lock_guard<std::mutex> cache_lock(cross_3d_cache_mutex);
+                for (const CachedCross3D& cached : cross_3d_cache)
+                {
+                    if (cached.z == z && cached.line_width == line_width && cached.pocket_size == pocket_size)
+                    {
+                        return cached.pattern;
+                    }
+                }
+            }
+            Polygon ret = fill_pattern_for_all_layers->generateCross(z, line_width / 2, pocket_size); //Generated without holding the lock, so other layers can be generated at the same time.
+            std::lock_guard<std::mutex> cache_lock(cross_3d_cache_mutex);
+            cross_3d_cache.push_back(CachedCross3D{z, line_width, pocket_size, ret});
+            if (cross_3d_cache.size() > cross_3d_cache_size)
+            {
+                cross_3d_cache.pop_front();
+            }
+            return ret;
         }
         else
         {
-            return fill_pattern_for_all_layers->generateCross();
+            std::call_once(cross_generated, [this]() { cross = fill_pattern_for_all_layers->generateCross(); });
+            return cross;
         }
     }
     else
@@ -5,10 +5,13 @@
 #ifndef INFILL_SIERPINSKI_FILL_PROVIDER_H
 #define INFILL_SIERPINSKI_FILL_PROVIDER_H
 
+#include <deque>
+#include <mutex>
 #include <optional>
 
 #include "SierpinskiFill.h"
 #include "../settings/EnumSettings.h" //For EFillMethod.
+#include "../utils/polygon.h" //To cache the generated patterns.
 
 namespace cura
 {
@@ -44,10 +47,45 @@ public:
 
     SierpinskiFillProvider(const AABB3D aabb_3d, coord_t min_line_distance, coord_t line_width, std::string cross_subdisivion_spec_image_file);
 
+    /*!
+     * Get the cross pattern of a layer.
+     *
+     * The generated patterns are cached. The flat cross pattern is the same on
+     * every layer, so it's generated only once. The 3D cross pattern is kept
+     * for the last few requested layers, since the infill of one layer is
+     * often generated in several parts.
+     *
+     * This may be called from multiple threads at the same time.
+     * \param pattern Either the cross or the cross 3D pattern.
+     * \param z The height of the layer.
+     * \param line_width The width of the infill lines.
+     * \param pocket_size The size of the pockets at the crossings of the 3D
+     * cross pattern.
+     * \return The cross pattern, as a polygon that covers the whole bounding
+     * box of the fractal.
+     */
     Polygon generate(EFillMethod pattern, coord_t z, coord_t line_width, coord_t pocket_size) const;
 
     ~SierpinskiFillProvider();
 protected:
+    /*!
+     * A 3D cross pattern that was generated for a layer.
+     */
+    struct CachedCross3D
+    {
+        coord_t z; //!< The height that the pattern was generated for.
+        coord_t line_width; //!< The line width that the pattern was generated for.
+        coord_t pocket_size; //!< The pocket size that the pattern was generated for.
+        Polygon pattern; //!< The generated pattern.
+    };
+
+    static constexpr size_t cross_3d_cache_size = 16; //!< How many layers of the 3D cross pattern to keep. Enough for the layers that are processed at the same time.
+
+    mutable std::once_flag cross_generated; //!< Whether \ref cross is generated yet.
+    mutable Polygon cross; //!< The flat cross pattern, which is the same on all layers.
+    mutable std::mutex cross_3d_cache_mutex; //!< Guards \ref cross_3d_cache.
+    mutable std::deque<CachedCross3D> cross_3d_cache; //!< The most recently generated 3D cross patterns, newest at the back.
+
     /*!
      * Get the parameters with which to generate a sierpinski fractal for this object
      */
@@ -0,0 +1,83 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cstdio> //For snprintf.
+#include <filesystem> //To recognise a changed density image.
+
+#include "SierpinskiFillProviderCache.h"
+#include "SierpinskiFillProvider.h"
+#include "../utils/AABB3D.h"
+
+namespace cura
+{
+
+SierpinskiFillProviderCache::SierpinskiFillProviderCache()
+: mesh_group_nr(0)
+{
+}
+
+void SierpinskiFillProviderCache::startMeshGroup(const size_t mesh_group_count)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    mesh_group_nr++;
+    for (auto entry = entries.begin(); entry != entries.end();)
+    {
+        if (entry->second.last_used_mesh_group + mesh_group_count < mesh_group_nr) //Not used in the previous slice.
+        {
+            entry = entries.erase(entry);
+        }
+        else
+        {
+            entry++;
+        }
+    }
+}
+
+std::shared_ptr<const SierpinskiFillProvider> SierpinskiFillProviderCache::get(const AABB3D& aabb, const coord_t min_line_distance, const coord_t line_width, const std::string& density_image)
+{
+    //The fractal only uses the flattened bounding box, so the height of the model doesn't matter.
+    char parameters[128];
+    snprintf(parameters, sizeof(parameters), "%lld %lld %lld %lld %lld %lld\n",
+        static_cast<long long>(aabb.min.x), static_cast<long long>(aabb.min.y), static_cast<long long>(aabb.max.x), static_cast<long long>(aabb.max.y),
+        static_cast<long long>(min_line_distance), static_cast<long long>(line_width));
+    std::string key = parameters;
+    if (!density_image.empty())
+    {
+        std::error_code error;
+        const std::filesystem::file_time_type modified = std::filesystem::last_write_time(density_image, error);
+        const uintmax_t file_size = std::filesystem::file_size(density_image, error);
+        snprintf(parameters, sizeof(parameters), "%lld %ju ", static_cast<long long>(modified.time_since_epoch().count()), file_size);
+        key += parameters + density_image;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = entries[key];
+    if (!entry.provider)
+    {
+        //Made while holding the lock, so that two meshes that need the same fractal don't both make it.
+        if (density_image.empty())
+        {
+            entry.provider = std::make_shared<const SierpinskiFillProvider>(aabb, min_line_distance, line_width);
+        }
+        else
+        {
+            entry.provider = std::make_shared<const SierpinskiFillProvider>(aabb, min_line_distance, line_width, density_image);
+        }
+    }
+    entry.last_used_mesh_group = mesh_group_nr;
+    return entry.provider;
+}
+
+void SierpinskiFillProviderCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+}
+
+size_t SierpinskiFillProviderCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+} //namespace cura
@@ -0,0 +1,94 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef INFILL_SIERPINSKI_FILL_PROVIDER_CACHE_H
+#define INFILL_SIERPINSKI_FILL_PROVIDER_CACHE_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "../utils/Coord_t.h"
+
+namespace cura
+{
+
+struct AABB3D;
+class SierpinskiFillProvider;
+
+/*!
+ * \brief The cross fractals of the previous slice, to reuse them if the next
+ * slice needs the same fractal again.
+ *
+ * A \ref SierpinskiFillProvider only depends on the horizontal bounding box
+ * that it covers, the line distance and width, and the density image. In a
+ * long-running session, changing a setting that has nothing to do with the
+ * cross infill or support makes the same fractals again. So do mesh groups
+ * printed one at a time that are copies of each other. Building the fractal
+ * is the expensive part, so those slices share one instead.
+ *
+ * The fractals are shared, and only generate patterns, which they may do from
+ * multiple threads at once. Only the fractals used in the previous slice are
+ * kept, so that the cache doesn't keep growing in a long-running session.
+ */
+class SierpinskiFillProviderCache
+{
+public:
+    SierpinskiFillProviderCache();
+
+    /*!
+     * \brief Start slicing the next mesh group.
+     *
+     * This forgets the fractals that weren't used during the previous slice.
+     * \param mesh_group_count The number of mesh groups in each slice.
+     */
+    void startMeshGroup(const size_t mesh_group_count);
+
+    /*!
+     * \brief Get the cross fractal for a bounding box, making it if it wasn't
+     * made before.
+     *
+     * It may be called from multiple threads at once.
+     * \param aabb The bounding box that the fractal must cover. Only its
+     * horizontal extent matters.
+     * \param min_line_distance The distance between the lines of the fractal
+     * at its densest.
+     * \param line_width The width of the lines of the fractal.
+     * \param density_image An image with the density of the fractal at each
+     * location, or an empty string for a uniform density. A changed image is
+     * recognised by its modification time and size.
+     * \return The fractal.
+     */
+    std::shared_ptr<const SierpinskiFillProvider> get(const AABB3D& aabb, const coord_t min_line_distance, const coord_t line_width, const std::string& density_image);
+
+    /*!
+     * Forget all stored fractals.
+     *
+     * Slices that still use them keep theirs until they're done.
+     */
+    void clear();
+
+    /*!
+     * How many fractals are stored.
+     */
+    size_t size() const;
+
+private:
+    /*!
+     * A fractal, and when it was last used.
+     */
+    struct Entry
+    {
+        std::shared_ptr<const SierpinskiFillProvider> provider;
+        size_t last_used_mesh_group; //!< The mesh group number that the fractal was last used in.
+    };
+
+    std::unordered_map<std::string, Entry> entries; //!< The stored fractals, by the parameters they were made with.
+    size_t mesh_group_nr; //!< How many mesh groups have been sliced so far, across all slices.
+    mutable std::mutex mutex; //!< Guards \ref entries, since the meshes may be processed in parallel.
+};
+
+} //namespace cura
+
+#endif //INFILL_SIERPINSKI_FILL_PROVIDER_CACHE_H
@@ -93,21 +93,24 @@ void SubDivCube::generateSubdivisionLines(const coord_t z, Polygons& result)
     {
         return;
     }
-    Polygons directional_line_groups[3];
+    DirectionalLineGroup directional_line_groups[3];
 
     generateSubdivisionLines(z, directional_line_groups);
 
     for (int dir_idx = 0; dir_idx < 3; dir_idx++)
     {
-        Polygons& line_group = directional_line_groups[dir_idx];
-        for (unsigned int line_idx = 0; line_idx < line_group.size(); line_idx++)
+        const DirectionalLineGroup& line_group = directional_line_groups[dir_idx];
+        for (size_t line_idx = 0; line_idx < line_group.lines.size(); line_idx++)
         {
-            result.addLine(line_group[line_idx][0], line_group[line_idx][1]);
+            if (!line_group.is_combined[line_idx])
+            {
+                result.addLine(line_group.lines[line_idx].first, line_group.lines[line_idx].second);
+            }
         }
     }
 }
 
-void SubDivCube::generateSubdivisionLines(const coord_t z, Polygons (&directional_line_groups)[3])
+void SubDivCube::generateSubdivisionLines(const coord_t z, DirectionalLineGroup (&directional_line_groups)[3])
 {
     CubeProperties cube_properties = cube_properties_per_recursion_step[depth];
 
@@ -266,27 +269,62 @@ void SubDivCube::rotatePoint120(Point& target)
     target.X = x;
 }
 
-void SubDivCube::addLineAndCombine(Polygons& group, Point from, Point to)
+namespace
+{
+constexpr coord_t epsilon = 10; // the smallest distance of two points which are viewed as coincident (dist > 0 due to rounding errors)
+
+/*!
+ * The cell of a point in the hash maps of a \ref SubDivCube::DirectionalLineGroup.
+ *
+ * Points that are closer than epsilon to each other are in the same or in
+ * adjacent cells.
+ */
+Point toCell(const Point& p)
 {
-    int epsilon = 10; // the smallest distance of two points which are viewed as coincident (dist > 0 due to rounding errors)
-    for (unsigned int idx = 0; idx < group.size(); idx++)
+    return Point((p.X < 0) ? (p.X + 1) / epsilon - 1 : p.X / epsilon, (p.Y < 0) ? (p.Y + 1) / epsilon - 1 : p.Y / epsilon);
+}
+}
+
+size_t SubDivCube::findTouchingLine(const DirectionalLineGroup& group, const std::unordered_multimap<Point, size_t>& lines_by_cell, const bool use_end, const Point& point)
+{
+    size_t first_line = group.lines.size();
+    const Point cell = toCell(point);
+    for (coord_t cell_x = cell.X - 1; cell_x <= cell.X + 1; cell_x++)
     {
-        if (std::abs(from.X - group[idx][1].X) < epsilon && std::abs(from.Y - group[idx][1].Y) < epsilon)
-        {
-            from = group[idx][0];
-            group.remove(idx);
-            idx--;
-            continue;
-        }
-        if (std::abs(to.X - group[idx][0].X) < epsilon && std::abs(to.Y - group[idx][0].Y) < epsilon)
+        for (coord_t cell_y = cell.Y - 1; cell_y <= cell.Y + 1; cell_y++)
         {
-            to = group[idx][1];
-            group.remove(idx);
-            idx--;
-            continue;
+            const auto lines_in_cell = lines_by_cell.equal_range(Point(cell_x, cell_y));
+            for (auto line_iter = lines_in_cell.first; line_iter != lines_in_cell.second; ++line_iter)
+            {
+                const size_t line_idx = line_iter->second;
+                const Point& end = use_end ? group.lines[line_idx].second : group.lines[line_idx].first;
+                if (line_idx < first_line && !group.is_combined[line_idx] && std::abs(point.X - end.X) < epsilon && std::abs(point.Y - end.Y) < epsilon)
+                {
+                    first_line = line_idx;
+                }
+            }
         }
     }
-    group.addLine(from, to);
+    return first_line;
+}
+
+void SubDivCube::addLineAndCombine(DirectionalLineGroup& group, Point from, Point to)
+{
+    for (size_t line_idx = findTouchingLine(group, group.lines_by_end_cell, true, from); line_idx < group.lines.size(); line_idx = findTouchingLine(group, group.lines_by_end_cell, true, from))
+    {
+        from = group.lines[line_idx].first;
+        group.is_combined[line_idx] = true;
+    }
+    for (size_t line_idx = findTouchingLine(group, group.lines_by_start_cell, false, to); line_idx < group.lines.size(); line_idx = findTouchingLine(group, group.lines_by_start_cell, false, to))
+    {
+        to = group.lines[line_idx].second;
+        group.is_combined[line_idx] = true;
+    }
+    const size_t new_line_idx = group.lines.size();
+    group.lines.emplace_back(from, to);
+    group.is_combined.push_back(false);
+    group.lines_by_start_cell.emplace(toCell(from), new_line_idx);
+    group.lines_by_end_cell.emplace(toCell(to), new_line_idx);
 }
 
 }//namespace cura
@@ -4,6 +4,10 @@
 #ifndef INFILL_SUBDIVCUBE_H
 #define INFILL_SUBDIVCUBE_H
 
+#include <unordered_map>
+#include <utility> //For std::pair.
+#include <vector>
+
 #include "../settings/types/Ratio.h"
 #include "../utils/IntPoint.h"
 #include "../utils/Point3.h"
@@ -41,13 +45,30 @@ public:
      */
     void generateSubdivisionLines(const coord_t z, Polygons& result);
 private:
+    /*!
+     * Line segments that all point in the same direction, of which the ones
+     * with touching ends are combined.
+     *
+     * The ends of the line segments are kept in hash maps, by the cell of the
+     * combining distance wide that they are in. Finding the line segments to
+     * combine with then doesn't need to go past all line segments that were
+     * added before.
+     */
+    struct DirectionalLineGroup
+    {
+        std::vector<std::pair<Point, Point>> lines; //!< All line segments that were added, in order, including the ones that were combined into a longer one since.
+        std::vector<bool> is_combined; //!< For each line segment, whether it was combined into a longer one.
+        std::unordered_multimap<Point, size_t> lines_by_start_cell; //!< The line segments, by the cell that their start is in.
+        std::unordered_multimap<Point, size_t> lines_by_end_cell; //!< The line segments, by the cell that their end is in.
+    };
+
     /*!
      * Generates the lines of subdivision of the specific cube at the specific layer. It recursively calls itself, so it ends up drawing all the subdivision lines of sub-cubes too.
      * \param z the specified layer height
      * \param result (output) The resulting lines
-     * \param directional_line_groups Array of 3 times a polylines. Used to keep track of line segments that are all pointing the same direction for line segment combining
+     * \param directional_line_groups Array of 3 groups of line segments that are all pointing the same direction for line segment combining
      */
-    void generateSubdivisionLines(const coord_t z, Polygons (&directional_line_groups)[3]);
+    void generateSubdivisionLines(const coord_t z, DirectionalLineGroup (&directional_line_groups)[3]);
 
     struct CubeProperties
     {
@@ -90,12 +111,26 @@ private:
     static coord_t distanceFromPointToMesh(SliceMeshStorage& mesh, const LayerIndex layer_nr, Point& location, coord_t* distance2);
 
     /*!
-     * Adds the defined line to the specified polygons. It assumes that the specified polygons are all parallel lines. Combines line segments with touching ends closer than epsilon.
-     * \param[out] group the polygons to add the line to
+     * Adds the defined line to the specified group. It assumes that the lines in the group are all parallel. Combines line segments with touching ends closer than epsilon.
+     * \param[out] group the group to add the line to
      * \param from the first endpoint of the line
      * \param to the second endpoint of the line
      */
-    void addLineAndCombine(Polygons& group, Point from, Point to);
+    void addLineAndCombine(DirectionalLineGroup& group, Point from, Point to);
+
+    /*!
+     * Find the first line segment in a group that has an end closer than
+     * epsilon to a point, and that wasn't combined into another one yet.
+     * \param group The group to search in.
+     * \param lines_by_cell The ends of the line segments to search, either
+     * the starts or the ends of the line segments in the group.
+     * \param use_end Whether \p lines_by_cell holds the ends of the line
+     * segments rather than their starts.
+     * \param point The point to search near.
+     * \return The index of the line segment in the group, or the number of
+     * line segments if there is no such line segment.
+     */
+    static size_t findTouchingLine(const DirectionalLineGroup& group, const std::unordered_multimap<Point, size_t>& lines_by_cell, const bool use_end, const Point& point);
 
     size_t depth; //!< the recursion depth of the cube (0 is most recursed)
     Point3 center; //!< center location of the cube in absolute coordinates
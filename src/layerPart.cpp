@@ -8,8 +8,13 @@
 #include "settings/Settings.h"
 #include "progress/Progress.h"
 
+#include "utils/AABB.h"
+#include "utils/linearAlg2D.h"
+#include "utils/ParallelSchedule.h"
+#include "utils/polygonUtils.h" //To find crossing line segments with a LocToLineGrid.
 #include "utils/PolylineStitcher.h"
 #include "utils/Simplify.h" //Simplifying the layers after creating them.
+#include "utils/Trace.h"
 
 /*
 The layer-part creation step is the first step in creating actual useful data for 3D printing.
@@ -25,8 +30,221 @@ It's also the first step that stores the result in the "data storage" so all oth
 
 namespace cura {
 
+namespace
+{
+
+/*!
+ * Layers with more polygons than this are always split into parts by Clipper.
+ *
+ * Finding which polygons are inside each other takes quadratic time in the
+ * number of polygons, so for many polygons a Clipper union is faster.
+ */
+constexpr size_t max_polygons_without_union = 64;
+
+/*!
+ * Whether a point lies on a line segment, given that it is collinear with it.
+ */
+bool collinearPointOnSegment(const Point& point, const Point& a, const Point& b)
+{
+    return point.X >= std::min(a.X, b.X) && point.X <= std::max(a.X, b.X) && point.Y >= std::min(a.Y, b.Y) && point.Y <= std::max(a.Y, b.Y);
+}
+
+/*!
+ * Whether two line segments touch or cross each other.
+ */
+bool segmentsTouch(const Point& a, const Point& b, const Point& c, const Point& d)
+{
+    const coord_t c_side = LinearAlg2D::pointIsLeftOfLine(c, a, b);
+    const coord_t d_side = LinearAlg2D::pointIsLeftOfLine(d, a, b);
+    const coord_t a_side = LinearAlg2D::pointIsLeftOfLine(a, c, d);
+    const coord_t b_side = LinearAlg2D::pointIsLeftOfLine(b, c, d);
+    if (((c_side > 0 && d_side < 0) || (c_side < 0 && d_side > 0)) && ((a_side > 0 && b_side < 0) || (a_side < 0 && b_side > 0)))
+    {
+        return true; //Proper crossing.
+    }
+    return (c_side == 0 && collinearPointOnSegment(c, a, b))
+        || (d_side == 0 && collinearPointOnSegment(d, a, b))
+        || (a_side == 0 && collinearPointOnSegment(a, c, d))
+        || (b_side == 0 && collinearPointOnSegment(b, c, d));
+}
+
+/*!
+ * Whether any line segments of the polygons touch or cross each other, apart
+ * from consecutive line segments of the same polygon sharing their vertex.
+ */
+bool hasTouchingSegments(const Polygons& polygons, const AABB& bounding_box, const size_t segment_count)
+{
+    //Aim for a few line segments per cell.
+    const coord_t size = std::max(bounding_box.max.X - bounding_box.min.X, bounding_box.max.Y - bounding_box.min.Y);
+    const coord_t cell_size = std::max(coord_t(100), static_cast<coord_t>(size / (std::sqrt(segment_count) + 1)));
+    const std::unique_ptr<LocToLineGrid> grid = PolygonUtils::createLocToLineGrid(polygons, cell_size);
+
+    for (size_t poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+    {
+        ConstPolygonRef polygon = polygons[poly_idx];
+        for (size_t point_idx = 0; point_idx < polygon.size(); point_idx++)
+        {
+            const Point a = polygon[point_idx];
+            const Point b = polygon[(point_idx + 1) % polygon.size()];
+            const bool touches = ! grid->processLine(std::make_pair(a, b), [&](const PolygonsPointIndex& other)
+                {
+                    if (other.poly_idx < poly_idx || (other.poly_idx == poly_idx && other.point_idx <= point_idx))
+                    {
+                        return true; //Each pair only needs to be checked once.
+                    }
+                    const Point c = other.p();
+                    const Point d = other.next().p();
+                    if (other.poly_idx == poly_idx)
+                    {
+                        if (other.point_idx == (point_idx + 1) % polygon.size()) //Next segment, sharing vertex b.
+                        {
+                            return ! (LinearAlg2D::pointIsLeftOfLine(d, a, b) == 0 && (collinearPointOnSegment(d, a, b) || collinearPointOnSegment(a, c, d))); //Only touches if it folds back.
+                        }
+                        if ((other.point_idx + 1) % polygon.size() == point_idx) //Previous segment, sharing vertex a (for the last segment of the polygon).
+                        {
+                            return ! (LinearAlg2D::pointIsLeftOfLine(c, a, b) == 0 && (collinearPointOnSegment(c, a, b) || collinearPointOnSegment(b, c, d)));
+                        }
+                    }
+                    return ! segmentsTouch(a, b, c, d);
+                });
+            if (touches)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*!
+ * Split the polygons of a layer into parts without a Clipper union, if the
+ * polygons are disjoint and simple.
+ *
+ * The slicer mostly produces polygons that don't touch each other or
+ * themselves. Then the parts follow directly from which polygons are inside
+ * which other polygons: Polygons inside an even number of others are the
+ * outlines of parts, and those inside an odd number of others are the holes of
+ * the smallest outline around them. This gives the same parts as a union with
+ * the even-odd fill rule, except that Clipper would also remove vertices on
+ * straight lines.
+ * \param polygons The polygons to split into parts.
+ * \param[out] result The parts, if the polygons could be split this way.
+ * \return Whether the polygons could be split this way. If not, a Clipper
+ * union is needed.
+ */
+bool splitIntoPartsWithoutUnion(const Polygons& polygons, std::vector<PolygonsPart>& result)
+{
+    if (polygons.size() > max_polygons_without_union)
+    {
+        return false;
+    }
+
+    std::vector<AABB> boxes;
+    boxes.reserve(polygons.size());
+    AABB total_box;
+    size_t segment_count = 0;
+    for (ConstPolygonRef polygon : polygons)
+    {
+        if (polygon.size() < 3 || polygon.area() == 0) //Degenerate. Clipper would remove these.
+        {
+            return false;
+        }
+        for (size_t point_idx = 0; point_idx < polygon.size(); point_idx++)
+        {
+            if (polygon[point_idx] == polygon[(point_idx + 1) % polygon.size()]) //Duplicate vertex. Clipper would remove this.
+            {
+                return false;
+            }
+        }
+        boxes.emplace_back();
+        for (const Point& point : polygon)
+        {
+            boxes.back().include(point);
+        }
+        total_box.include(boxes.back());
+        segment_count += polygon.size();
+    }
+
+    if (hasTouchingSegments(polygons, total_box, segment_count))
+    {
+        return false;
+    }
+
+    //Since no line segments touch, every polygon is either completely inside or completely outside of each other polygon.
+    std::vector<std::vector<size_t>> containers(polygons.size()); //For each polygon, the polygons it's inside of.
+    for (size_t inner_idx = 0; inner_idx < polygons.size(); inner_idx++)
+    {
+        for (size_t outer_idx = 0; outer_idx < polygons.size(); outer_idx++)
+        {
+            if (inner_idx != outer_idx && boxes[outer_idx].contains(boxes[inner_idx]) && polygons[outer_idx].inside(polygons[inner_idx][0]))
+            {
+                containers[inner_idx].push_back(outer_idx);
+            }
+        }
+    }
+
+    std::vector<size_t> part_of_outline(polygons.size(), NO_INDEX);
+    for (size_t poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+    {
+        if (containers[poly_idx].size() % 2 == 0) //This is the outline of a part.
+        {
+            part_of_outline[poly_idx] = result.size();
+            result.emplace_back();
+            Polygon outline = polygons[poly_idx];
+            if (! outline.orientation())
+            {
+                outline.reverse();
+            }
+            result.back().add(std::move(outline));
+        }
+    }
+    for (size_t poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+    {
+        if (containers[poly_idx].size() % 2 == 1) //This is a hole. Its outline is the container that is inside all of the other containers.
+        {
+            const size_t depth = containers[poly_idx].size();
+            for (const size_t container_idx : containers[poly_idx])
+            {
+                if (containers[container_idx].size() == depth - 1)
+                {
+                    Polygon hole = polygons[poly_idx];
+                    if (hole.orientation())
+                    {
+                        hole.reverse();
+                    }
+                    result[part_of_outline[container_idx]].add(std::move(hole));
+                    break;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/*!
+ * Split the polygons of a layer into parts as the slicer ordered them.
+ * \param polygons The polygons, ordered by part.
+ * \param part_starts The index of the outline of each part in \p polygons .
+ * \param[out] result The parts.
+ */
+void splitIntoSlicedParts(const Polygons& polygons, const std::vector<size_t>& part_starts, std::vector<PolygonsPart>& result)
+{
+    result.resize(part_starts.size());
+    for (size_t part_idx = 0; part_idx < part_starts.size(); part_idx++)
+    {
+        const size_t part_end = (part_idx + 1 < part_starts.size()) ? part_starts[part_idx + 1] : polygons.size();
+        for (size_t poly_idx = part_starts[part_idx]; poly_idx < part_end; poly_idx++)
+        {
+            result[part_idx].add(polygons[poly_idx]);
+        }
+    }
+}
+
+} //Anonymous namespace.
+
 void createLayerWithParts(const Settings& settings, SliceLayer& storageLayer, SlicerLayer* layer)
 {
+    const size_t sliced_polygon_count = layer->polygons.size();
     PolylineStitcher<Polygons, Polygon, Point>::stitch(layer->openPolylines, storageLayer.openPolyLines, layer->polygons, settings.get<coord_t>("wall_line_width_0"));
 
     storageLayer.openPolyLines = Simplify(settings).polyline(storageLayer.openPolyLines);
@@ -53,14 +271,22 @@ void createLayerWithParts(const Settings& settings, SliceLayer& storageLayer, Sl
             result.back().add(poly);
         }
     }
-    else
+    else if (union_layers || union_all_remove_holes)
     {
-        result = layer->polygons.splitIntoParts(union_layers || union_all_remove_holes);
+        result = layer->polygons.splitIntoParts(true);
+    }
+    else if (! layer->part_starts.empty() && layer->polygons.size() == sliced_polygon_count) //The slicer already found the parts, and stitching didn't add any polygons.
+    {
+        splitIntoSlicedParts(layer->polygons, layer->part_starts, result);
+    }
+    else if (!splitIntoPartsWithoutUnion(layer->polygons, result))
+    {
+        result = layer->polygons.splitIntoParts();
     }
     const coord_t hole_offset = settings.get<coord_t>("hole_xy_offset");
     for(auto & part : result)
     {
-        storageLayer.parts.emplace_back();
+        storageLayer.parts.emplace_back(storageLayer.getMemoryResource());
         if (hole_offset != 0)
         {
             // holes are to be expanded or shrunk
@@ -92,23 +318,23 @@ void createLayerWithParts(const Settings& settings, SliceLayer& storageLayer, Sl
 }
 void createLayerParts(SliceMeshStorage& mesh, Slicer* slicer)
 {
+    TraceZone zone("layer parts");
     const auto total_layers = slicer->layers.size();
     assert(mesh.layers.size() == total_layers);
 
-    // OpenMP compatibility fix for GCC <= 8 and GCC >= 9
-    // See https://www.gnu.org/software/gcc/gcc-9/porting_to.html, section "OpenMP data sharing"
-#if defined(__GNUC__) && __GNUC__ <= 8 && !defined(__clang__)
-    #pragma omp parallel for default(none) shared(mesh, slicer) schedule(dynamic)
-#else
-    #pragma omp parallel for default(none) shared(mesh, slicer, total_layers) schedule(dynamic)
-#endif // defined(__GNUC__) && __GNUC__ <= 8
-    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
-    for (int layer_nr = 0; layer_nr < static_cast<int>(total_layers); layer_nr++)
+    // Simple meshes have cheap layers, for which handing out single layers costs more than it saves, so the layers are scheduled by their number of vertices.
+    std::vector<size_t> vertex_counts(total_layers);
+    for (size_t layer_nr = 0; layer_nr < total_layers; layer_nr++)
+    {
+        vertex_counts[layer_nr] = slicer->layers[layer_nr].polygons.pointCount() + slicer->layers[layer_nr].openPolylines.pointCount();
+    }
+    ParallelSchedule("create layer parts", vertex_counts).run([&](const size_t layer_nr)
     {
         SliceLayer& layer_storage = mesh.layers[layer_nr];
         SlicerLayer& slice_layer = slicer->layers[layer_nr];
         createLayerWithParts(mesh.settings, layer_storage, &slice_layer);
-    }
+        layer_storage.indexParts();
+    });
 
     for (LayerIndex layer_nr = total_layers - 1; layer_nr >= 0; layer_nr--)
     {
@@ -1,21 +1,103 @@
 //Copyright (c) 2018 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For std::stable_sort.
+#include <cassert>
+#include <cmath> //For std::sqrt.
+#include <numeric> //For std::iota.
+
 #include "mesh.h"
+#include "settings/SlicingPreview.h" //To decimate more coarsely for a preview.
 #include "utils/floatpoint.h"
 #include "utils/logoutput.h"
 
 namespace cura
 {
 
-const int vertex_meld_distance = MM2INT(0.03);
-/*!
- * returns a hash for the location, but first divides by the vertex_meld_distance,
- * so that any point within a box of vertex_meld_distance by vertex_meld_distance would get mapped to the same hash.
- */
-static inline uint32_t pointHash(const Point3& p)
+MeshVertexHashTable::Cell MeshVertexHashTable::toCell(const Point3& p)
+{
+    return Cell
+    {
+        static_cast<int32_t>((p.x + meld_distance / 2) / meld_distance),
+        static_cast<int32_t>((p.y + meld_distance / 2) / meld_distance),
+        static_cast<int32_t>((p.z + meld_distance / 2) / meld_distance)
+    };
+}
+
+uint64_t MeshVertexHashTable::hash(const Cell& cell)
+{
+    uint64_t result = static_cast<uint64_t>(static_cast<uint32_t>(cell.x)) * 0x9E3779B97F4A7C15ULL;
+    result ^= static_cast<uint64_t>(static_cast<uint32_t>(cell.y)) * 0xC2B2AE3D27D4EB4FULL;
+    result ^= static_cast<uint64_t>(static_cast<uint32_t>(cell.z)) * 0x165667B19E3779F9ULL;
+    return result ^ (result >> 29);
+}
+
+size_t MeshVertexHashTable::getPartition(const Cell& cell)
 {
-    return ((p.x + vertex_meld_distance/2) / vertex_meld_distance) ^ (((p.y + vertex_meld_distance/2) / vertex_meld_distance) << 10) ^ (((p.z + vertex_meld_distance/2) / vertex_meld_distance) << 20);
+    return hash(cell) % partition_count;
+}
+
+void MeshVertexHashTable::reserve(const size_t partition_idx, const size_t additional_vertex_count)
+{
+    Partition& partition = partitions[partition_idx];
+    const size_t required_size = partition.size + additional_vertex_count;
+    size_t capacity = std::max(partition.slots.size(), static_cast<size_t>(16));
+    while (capacity < required_size * 2) // Keep the load factor at most 0.5, so that probe sequences stay short.
+    {
+        capacity *= 2;
+    }
+    if (capacity == partition.slots.size())
+    {
+        return;
+    }
+
+    // Rehash. The order of the entries doesn't matter, since find() looks for the lowest id.
+    std::vector<Entry> old_slots(capacity);
+    std::swap(old_slots, partition.slots);
+    const size_t mask = capacity - 1;
+    for (const Entry& entry : old_slots)
+    {
+        if (entry.vertex_id == no_vertex)
+        {
+            continue;
+        }
+        size_t slot = (hash(entry.cell) / partition_count) & mask;
+        while (partition.slots[slot].vertex_id != no_vertex)
+        {
+            slot = (slot + 1) & mask;
+        }
+        partition.slots[slot] = entry;
+    }
+}
+
+void MeshVertexHashTable::clear()
+{
+    for (Partition& partition : partitions)
+    {
+        std::vector<Entry>().swap(partition.slots);
+        partition.size = 0;
+    }
+}
+
+size_t MeshVertexHashTable::insert(const Cell& cell, const uint32_t vertex_id)
+{
+    Partition& partition = partitions[getPartition(cell)];
+    assert(partition.size * 2 < partition.slots.size() && "Should have reserved space before inserting.");
+    const size_t mask = partition.slots.size() - 1;
+    size_t slot = (hash(cell) / partition_count) & mask;
+    while (partition.slots[slot].vertex_id != no_vertex)
+    {
+        slot = (slot + 1) & mask;
+    }
+    partition.slots[slot].cell = cell;
+    partition.slots[slot].vertex_id = vertex_id;
+    partition.size++;
+    return slot;
+}
+
+void MeshVertexHashTable::setId(const size_t partition, const size_t slot, const uint32_t vertex_id)
+{
+    partitions[partition].slots[slot].vertex_id = vertex_id;
 }
 
 Mesh::Mesh(Settings& parent)
@@ -45,9 +127,127 @@ void Mesh::addFace(Point3& v0, Point3& v1, Point3& v2)
     face.vertex_index[0] = vi0;
     face.vertex_index[1] = vi1;
     face.vertex_index[2] = vi2;
-    vertices[face.vertex_index[0]].connected_faces.push_back(idx);
-    vertices[face.vertex_index[1]].connected_faces.push_back(idx);
-    vertices[face.vertex_index[2]].connected_faces.push_back(idx);
+}
+
+void Mesh::addFaces(const std::vector<Point3>& corners)
+{
+    const size_t face_count = corners.size() / 3;
+    const size_t corner_count = face_count * 3;
+    constexpr size_t min_parallel_corner_count = 3 * 4096; // Below this, the parallel bookkeeping costs more than it saves.
+    if (corner_count < min_parallel_corner_count)
+    {
+        for (size_t face_idx = 0; face_idx < face_count; face_idx++)
+        {
+            Point3 v0 = corners[face_idx * 3 + 0];
+            Point3 v1 = corners[face_idx * 3 + 1];
+            Point3 v2 = corners[face_idx * 3 + 2];
+            addFace(v0, v1, v2);
+        }
+        return;
+    }
+
+    // Vertices can only be melded with vertices in the same cell, and all vertices of one cell are in the same partition of the
+    // hash table. So the partitions can be processed in parallel. Sort the corners per partition, keeping them in order.
+    std::vector<MeshVertexHashTable::Cell> corner_cells(corner_count);
+    std::vector<uint8_t> corner_partitions(corner_count);
+#pragma omp parallel for default(none) shared(corners, corner_cells, corner_partitions, corner_count)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int corner_idx = 0; corner_idx < static_cast<int>(corner_count); corner_idx++)
+    {
+        corner_cells[corner_idx] = MeshVertexHashTable::toCell(corners[corner_idx]);
+        corner_partitions[corner_idx] = MeshVertexHashTable::getPartition(corner_cells[corner_idx]);
+    }
+    std::vector<size_t> partition_start(MeshVertexHashTable::partition_count + 1, 0);
+    for (const uint8_t partition : corner_partitions)
+    {
+        partition_start[partition + 1]++;
+    }
+    for (size_t partition = 0; partition < MeshVertexHashTable::partition_count; partition++)
+    {
+        partition_start[partition + 1] += partition_start[partition];
+    }
+    std::vector<uint32_t> partition_corners(corner_count);
+    {
+        std::vector<size_t> insert_pos(partition_start.begin(), partition_start.end() - 1);
+        for (size_t corner_idx = 0; corner_idx < corner_count; corner_idx++)
+        {
+            partition_corners[insert_pos[corner_partitions[corner_idx]]++] = corner_idx;
+        }
+    }
+
+    // Meld the corners per partition. Vertices which are new in this batch get a provisional id which refers to the first corner
+    // at their location, marked with the highest bit. That way they still sort after all existing vertices and in corner order.
+    constexpr uint32_t provisional = 1U << 31;
+    std::vector<uint32_t> corner_vertex(corner_count);
+    std::vector<std::vector<std::pair<size_t, uint32_t>>> provisional_slots(MeshVertexHashTable::partition_count); // Per partition the slots with a provisional id and their corner.
+#pragma omp parallel for default(none) shared(corners, corner_cells, partition_start, partition_corners, corner_vertex, provisional_slots, provisional) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int partition = 0; partition < static_cast<int>(MeshVertexHashTable::partition_count); partition++)
+    {
+        vertex_hash_map.reserve(partition, partition_start[partition + 1] - partition_start[partition]);
+        const auto get_location = [this, &corners, provisional](const uint32_t vertex_id)
+        {
+            return (vertex_id & provisional) ? corners[vertex_id & ~provisional] : vertices[vertex_id].p;
+        };
+        for (size_t partition_corner_idx = partition_start[partition]; partition_corner_idx < partition_start[partition + 1]; partition_corner_idx++)
+        {
+            const uint32_t corner_idx = partition_corners[partition_corner_idx];
+            const uint32_t vertex_id = vertex_hash_map.find(corner_cells[corner_idx], corners[corner_idx], get_location);
+            if (vertex_id != MeshVertexHashTable::no_vertex)
+            {
+                corner_vertex[corner_idx] = vertex_id;
+                continue;
+            }
+            corner_vertex[corner_idx] = provisional | corner_idx;
+            provisional_slots[partition].emplace_back(vertex_hash_map.insert(corner_cells[corner_idx], provisional | corner_idx), corner_idx);
+        }
+    }
+
+    // Number the new vertices in the order in which they first occur, like addFace would.
+    for (size_t corner_idx = 0; corner_idx < corner_count; corner_idx++)
+    {
+        const uint32_t vertex_id = corner_vertex[corner_idx];
+        if ((vertex_id & provisional) == 0)
+        {
+            continue;
+        }
+        const uint32_t first_corner_idx = vertex_id & ~provisional;
+        if (first_corner_idx == corner_idx)
+        {
+            corner_vertex[corner_idx] = vertices.size();
+            vertices.emplace_back(corners[corner_idx]);
+            aabb.include(corners[corner_idx]);
+        }
+        else
+        {
+            corner_vertex[corner_idx] = corner_vertex[first_corner_idx]; // Already numbered, since it comes earlier.
+        }
+    }
+#pragma omp parallel for default(none) shared(provisional_slots, corner_vertex)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int partition = 0; partition < static_cast<int>(MeshVertexHashTable::partition_count); partition++)
+    {
+        for (const std::pair<size_t, uint32_t>& slot_and_corner : provisional_slots[partition])
+        {
+            vertex_hash_map.setId(partition, slot_and_corner.first, corner_vertex[slot_and_corner.second]);
+        }
+    }
+
+    faces.reserve(faces.size() + face_count);
+    for (size_t face_idx = 0; face_idx < face_count; face_idx++)
+    {
+        const int vi0 = corner_vertex[face_idx * 3 + 0];
+        const int vi1 = corner_vertex[face_idx * 3 + 1];
+        const int vi2 = corner_vertex[face_idx * 3 + 2];
+        if (vi0 == vi1 || vi1 == vi2 || vi0 == vi2) continue; // the face has two vertices which get assigned the same location. Don't add the face.
+
+        const int idx = faces.size(); // index of face to be added
+        faces.emplace_back();
+        MeshFace& face = faces[idx];
+        face.vertex_index[0] = vi0;
+        face.vertex_index[1] = vi1;
+        face.vertex_index[2] = vi2;
+    }
 }
 
 void Mesh::clear()
@@ -55,6 +255,8 @@ void Mesh::clear()
     faces.clear();
     vertices.clear();
     vertex_hash_map.clear();
+    vertex_faces_start.clear();
+    vertex_faces.clear();
 }
 
 void Mesh::finish()
@@ -62,8 +264,22 @@ void Mesh::finish()
     // Finish up the mesh, clear the vertex_hash_map, as it's no longer needed from this point on and uses quite a bit of memory.
     vertex_hash_map.clear();
 
+    if (settings.getOrDefault<bool>("meshfix_decimate_mesh", false) || SlicingPreview::isEnabled(settings))
+    {
+        decimate(SlicingPreview::getMaximumDeviation(settings), SlicingPreview::getMaximumResolution(settings));
+    }
+    if (settings.getOrDefault<bool>("mesh_sort_by_height", false))
+    {
+        sortByHeight();
+    }
+    buildConnectedFaces();
+
     // For each face, store which other face is connected with it.
-    for(unsigned int i=0; i<faces.size(); i++)
+    // Every face only reads the connected faces of its own vertices, so the faces can be connected in parallel.
+    const int face_count = faces.size();
+#pragma omp parallel for default(none) shared(face_count) schedule(dynamic, 1024)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for(int i=0; i<face_count; i++)
     {
         MeshFace& face = faces[i];
         // faces are connected via the outside
@@ -73,6 +289,564 @@ void Mesh::finish()
     }
 }
 
+void Mesh::sortByHeight()
+{
+    std::vector<uint32_t> vertex_order(vertices.size());
+    std::iota(vertex_order.begin(), vertex_order.end(), 0);
+    std::stable_sort(vertex_order.begin(), vertex_order.end(), [this](const uint32_t a, const uint32_t b) { return vertices[a].p.z < vertices[b].p.z; });
+    std::vector<int> new_vertex_index(vertices.size());
+    std::vector<MeshVertex> sorted_vertices;
+    sorted_vertices.reserve(vertices.size());
+    for (const uint32_t vertex_idx : vertex_order)
+    {
+        new_vertex_index[vertex_idx] = sorted_vertices.size();
+        sorted_vertices.emplace_back(vertices[vertex_idx].p);
+    }
+    vertices = std::move(sorted_vertices);
+
+    std::vector<coord_t> min_z(faces.size());
+    for (size_t face_idx = 0; face_idx < faces.size(); face_idx++)
+    {
+        MeshFace& face = faces[face_idx];
+        for (int& vertex_idx : face.vertex_index)
+        {
+            vertex_idx = new_vertex_index[vertex_idx];
+        }
+        min_z[face_idx] = std::min({ vertices[face.vertex_index[0]].p.z, vertices[face.vertex_index[1]].p.z, vertices[face.vertex_index[2]].p.z });
+    }
+    std::vector<uint32_t> face_order(faces.size());
+    std::iota(face_order.begin(), face_order.end(), 0);
+    std::stable_sort(face_order.begin(), face_order.end(), [&min_z](const uint32_t a, const uint32_t b) { return min_z[a] < min_z[b]; });
+    std::vector<MeshFace> sorted_faces;
+    sorted_faces.reserve(faces.size());
+    for (const uint32_t face_idx : face_order)
+    {
+        sorted_faces.push_back(faces[face_idx]);
+    }
+    faces = std::move(sorted_faces);
+}
+
+namespace
+{
+
+/*!
+ * The sum of the squared distances from a point to a set of planes, as a
+ * symmetric 4x4 matrix of which only the upper triangle is stored.
+ */
+struct Quadric
+{
+    double aa = 0, ab = 0, ac = 0, ad = 0, bb = 0, bc = 0, bd = 0, cc = 0, cd = 0, dd = 0;
+
+    /*!
+     * Add the plane ax + by + cz + d = 0, with (a, b, c) normalized.
+     */
+    void addPlane(const double a, const double b, const double c, const double d)
+    {
+        aa += a * a; ab += a * b; ac += a * c; ad += a * d;
+        bb += b * b; bc += b * c; bd += b * d;
+        cc += c * c; cd += c * d;
+        dd += d * d;
+    }
+
+    Quadric operator+(const Quadric& other) const
+    {
+        Quadric result = *this;
+        result.aa += other.aa; result.ab += other.ab; result.ac += other.ac; result.ad += other.ad;
+        result.bb += other.bb; result.bc += other.bc; result.bd += other.bd;
+        result.cc += other.cc; result.cd += other.cd;
+        result.dd += other.dd;
+        return result;
+    }
+
+    /*!
+     * The sum of the squared distances from a point to all planes.
+     */
+    double error(const double x, const double y, const double z) const
+    {
+        return aa * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+            + bb * y * y + 2 * bc * y * z + 2 * bd * y
+            + cc * z * z + 2 * cd * z
+            + dd;
+    }
+};
+
+/*!
+ * Collapses the edges of a mesh for Mesh::decimate.
+ *
+ * While collapsing, the faces around each vertex are kept in a list per
+ * vertex, since those change with every collapse.
+ */
+class EdgeCollapser
+{
+public:
+    //! The number of slabs in which the mesh is decimated in parallel. Fixed, so that the result doesn't depend on the number of threads.
+    static constexpr size_t region_count = 64;
+
+    //! The region of the faces that are collapsed serially, across all regions.
+    static constexpr int any_region = -1;
+
+    EdgeCollapser(std::vector<MeshVertex>& vertices, std::vector<MeshFace>& faces, const AABB3D& aabb, const coord_t max_deviation, const coord_t max_edge_length)
+    : vertices(vertices)
+    , faces(faces)
+    , origin((aabb.min + aabb.max) / 2)
+    , max_error(static_cast<double>(max_deviation) * max_deviation)
+    , max_edge_length(max_edge_length)
+    , vertex_faces(vertices.size())
+    , quadrics(vertices.size())
+    , is_locked(vertices.size(), false)
+    , is_removed(vertices.size(), false)
+    , face_is_removed(faces.size(), false)
+    , vertex_region(vertices.size())
+    , region_faces(region_count)
+    {
+        for (size_t face_idx = 0; face_idx < faces.size(); face_idx++)
+        {
+            for (const int vertex_idx : faces[face_idx].vertex_index)
+            {
+                vertex_faces[vertex_idx].push_back(face_idx);
+            }
+        }
+
+        // Split the mesh into slabs along its longest side.
+        const Point3 size = aabb.max - aabb.min;
+        const size_t axis = (size.x >= size.y && size.x >= size.z) ? 0 : (size.y >= size.z ? 1 : 2);
+        const coord_t axis_min = axis == 0 ? aabb.min.x : (axis == 1 ? aabb.min.y : aabb.min.z);
+        const coord_t axis_size = std::max(coord_t(1), axis == 0 ? size.x : (axis == 1 ? size.y : size.z));
+
+        const int vertex_count = vertices.size();
+#pragma omp parallel for default(none) shared(vertices, faces, vertex_count, axis, axis_min, axis_size)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int vertex_idx = 0; vertex_idx < vertex_count; vertex_idx++)
+        {
+            const Point3& p = vertices[vertex_idx].p;
+            const coord_t along_axis = (axis == 0 ? p.x : (axis == 1 ? p.y : p.z)) - axis_min;
+            vertex_region[vertex_idx] = std::min(region_count - 1, static_cast<size_t>(along_axis * region_count / (axis_size + 1)));
+
+            // Each neighbour of a vertex in the middle of a closed surface is in exactly two of its faces. Keep the others, to keep holes and non-manifold edges the same.
+            std::vector<int> neighbours;
+            for (const uint32_t face_idx : vertex_faces[vertex_idx])
+            {
+                for (const int neighbour : faces[face_idx].vertex_index)
+                {
+                    if (neighbour != vertex_idx)
+                    {
+                        neighbours.push_back(neighbour);
+                    }
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end());
+            for (size_t i = 0; i < neighbours.size(); i += 2)
+            {
+                if (i + 1 >= neighbours.size() || neighbours[i] != neighbours[i + 1] || (i + 2 < neighbours.size() && neighbours[i + 2] == neighbours[i]))
+                {
+                    is_locked[vertex_idx] = true;
+                    break;
+                }
+            }
+
+            for (const uint32_t face_idx : vertex_faces[vertex_idx])
+            {
+                double normal[3];
+                if (!getNormal(faces[face_idx], -1, Point3(), normal))
+                {
+                    continue;
+                }
+                const Point3 a = vertices[faces[face_idx].vertex_index[0]].p - origin;
+                quadrics[vertex_idx].addPlane(normal[0], normal[1], normal[2], -(normal[0] * a.x + normal[1] * a.y + normal[2] * a.z));
+            }
+        }
+    }
+
+    /*!
+     * Sort the remaining faces into their regions, before collapsing the
+     * regions in parallel.
+     *
+     * A face is only changed by the region of its vertices if they are all in
+     * that region, so a face stays in the region it was assigned to.
+     */
+    void assignFacesToRegions()
+    {
+        for (std::vector<uint32_t>& faces_in_region : region_faces)
+        {
+            faces_in_region.clear();
+        }
+        for (size_t face_idx = 0; face_idx < faces.size(); face_idx++)
+        {
+            if (!face_is_removed[face_idx])
+            {
+                region_faces[vertex_region[faces[face_idx].vertex_index[0]]].push_back(face_idx);
+            }
+        }
+    }
+
+    /*!
+     * Collapse the edges of which all surrounding faces are in one region, or
+     * all remaining edges that cross between regions.
+     *
+     * Different regions may be collapsed at the same time, after
+     * \ref assignFacesToRegions . The edges between regions may only be
+     * collapsed when no region is being collapsed.
+     * \param region The region to collapse, or \ref any_region for the edges
+     * between regions.
+     * \return The number of collapsed edges.
+     */
+    size_t collapseRegion(const int region)
+    {
+        std::vector<uint32_t> all_faces;
+        if (region == any_region)
+        {
+            all_faces.resize(faces.size());
+            std::iota(all_faces.begin(), all_faces.end(), 0);
+        }
+
+        // Every edge in the middle of a consistent surface is in two faces, in opposite directions. Take it from the face where it goes up in index.
+        std::vector<std::pair<double, std::pair<uint32_t, uint32_t>>> edges;
+        for (const uint32_t face_idx : (region == any_region) ? all_faces : region_faces[region])
+        {
+            if (face_is_removed[face_idx])
+            {
+                continue;
+            }
+            const MeshFace& face = faces[face_idx];
+            for (size_t corner = 0; corner < 3; corner++)
+            {
+                const uint32_t v0 = face.vertex_index[corner];
+                const uint32_t v1 = face.vertex_index[(corner + 1) % 3];
+                if (v0 > v1 || is_locked[v0] || is_locked[v1])
+                {
+                    continue;
+                }
+                if (region != any_region && (vertex_region[v0] != static_cast<size_t>(region) || vertex_region[v1] != static_cast<size_t>(region)))
+                {
+                    continue;
+                }
+                if (region == any_region && vertex_region[v0] == vertex_region[v1] && isInRegion(v0, vertex_region[v0]) && isInRegion(v1, vertex_region[v0]))
+                {
+                    continue; //Was already tried in parallel.
+                }
+                if (!(vertices[v0].p - vertices[v1].p).testLength(max_edge_length))
+                {
+                    continue;
+                }
+                Point3 target;
+                edges.emplace_back(findTarget(v0, v1, target), std::make_pair(v0, v1));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        size_t collapsed = 0;
+        for (const std::pair<double, std::pair<uint32_t, uint32_t>>& edge : edges)
+        {
+            if (edge.first > max_error)
+            {
+                break;
+            }
+            if (tryCollapse(edge.second.first, edge.second.second, region))
+            {
+                collapsed++;
+            }
+        }
+        return collapsed;
+    }
+
+    /*!
+     * Remove the collapsed vertices and faces from the mesh, keeping the rest in
+     * their order.
+     */
+    void compact()
+    {
+        std::vector<int> new_vertex_index(vertices.size(), -1);
+        std::vector<MeshVertex> kept_vertices;
+        for (size_t vertex_idx = 0; vertex_idx < vertices.size(); vertex_idx++)
+        {
+            if (!is_removed[vertex_idx])
+            {
+                new_vertex_index[vertex_idx] = kept_vertices.size();
+                kept_vertices.push_back(vertices[vertex_idx]);
+            }
+        }
+        vertices = std::move(kept_vertices);
+
+        std::vector<MeshFace> kept_faces;
+        for (size_t face_idx = 0; face_idx < faces.size(); face_idx++)
+        {
+            if (face_is_removed[face_idx])
+            {
+                continue;
+            }
+            MeshFace face = faces[face_idx];
+            for (int& vertex_idx : face.vertex_index)
+            {
+                vertex_idx = new_vertex_index[vertex_idx];
+            }
+            kept_faces.push_back(face);
+        }
+        faces = std::move(kept_faces);
+    }
+
+private:
+    std::vector<MeshVertex>& vertices;
+    std::vector<MeshFace>& faces;
+    const Point3 origin; //!< The errors are computed relative to the middle of the mesh, to keep the numbers small.
+    const double max_error; //!< The maximum sum of squared distances to the original planes.
+    const coord_t max_edge_length;
+    std::vector<std::vector<uint32_t>> vertex_faces; //!< The faces around each vertex.
+    std::vector<Quadric> quadrics; //!< The planes of the original faces around each vertex.
+    // Flags are stored as bytes rather than in a std::vector<bool>, so that different threads can change the flags of different elements.
+    std::vector<uint8_t> is_locked; //!< Vertices on holes or non-manifold edges, which are never moved.
+    std::vector<uint8_t> is_removed; //!< Vertices that were collapsed into another vertex.
+    std::vector<uint8_t> face_is_removed;
+    std::vector<size_t> vertex_region; //!< The slab of each vertex.
+    std::vector<std::vector<uint32_t>> region_faces; //!< The faces of each region, by the region of their first vertex.
+
+    /*!
+     * Get the normal of a face, optionally with one of its vertices moved.
+     * \param face The face.
+     * \param moved_vertex The vertex to move, or -1 to move none.
+     * \param moved_to Where to move it to.
+     * \param[out] normal The normalized normal.
+     * \return Whether the face has an area.
+     */
+    bool getNormal(const MeshFace& face, const int moved_vertex, const Point3& moved_to, double* normal) const
+    {
+        Point3 corners[3];
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            corners[corner] = (face.vertex_index[corner] == moved_vertex) ? moved_to : vertices[face.vertex_index[corner]].p;
+        }
+        const double u[3] = { double(corners[1].x - corners[0].x), double(corners[1].y - corners[0].y), double(corners[1].z - corners[0].z) };
+        const double v[3] = { double(corners[2].x - corners[0].x), double(corners[2].y - corners[0].y), double(corners[2].z - corners[0].z) };
+        normal[0] = u[1] * v[2] - u[2] * v[1];
+        normal[1] = u[2] * v[0] - u[0] * v[2];
+        normal[2] = u[0] * v[1] - u[1] * v[0];
+        const double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length <= 0)
+        {
+            return false;
+        }
+        normal[0] /= length;
+        normal[1] /= length;
+        normal[2] /= length;
+        return true;
+    }
+
+    /*!
+     * Find where the vertices of an edge should be merged: at either end or in
+     * the middle, whichever stays closest to the original surface.
+     * \param[out] target The position of the merged vertex.
+     * \return The error of merging the vertices there.
+     */
+    double findTarget(const uint32_t v0, const uint32_t v1, Point3& target) const
+    {
+        const Quadric quadric = quadrics[v0] + quadrics[v1];
+        const Point3 candidates[3] = { vertices[v0].p, vertices[v1].p, (vertices[v0].p + vertices[v1].p) / 2 };
+        double best_error = std::numeric_limits<double>::max();
+        for (const Point3& candidate : candidates)
+        {
+            const Point3 relative = candidate - origin;
+            const double error = quadric.error(relative.x, relative.y, relative.z);
+            if (error < best_error)
+            {
+                best_error = error;
+                target = candidate;
+            }
+        }
+        return best_error;
+    }
+
+    /*!
+     * Whether all faces around a vertex only have vertices in a region.
+     */
+    bool isInRegion(const uint32_t vertex_idx, const size_t region) const
+    {
+        for (const uint32_t face_idx : vertex_faces[vertex_idx])
+        {
+            for (const int corner : faces[face_idx].vertex_index)
+            {
+                if (vertex_region[corner] != region)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /*!
+     * Merge the second vertex of an edge into the first, if that keeps the
+     * surface close to the original and doesn't change its topology.
+     * \param region The region that may be changed, or \ref any_region.
+     * \return Whether the edge was collapsed.
+     */
+    bool tryCollapse(const uint32_t v0, const uint32_t v1, const int region)
+    {
+        if (is_removed[v0] || is_removed[v1])
+        {
+            return false;
+        }
+        if (region != any_region && (!isInRegion(v0, region) || !isInRegion(v1, region)))
+        {
+            return false;
+        }
+        if (!(vertices[v0].p - vertices[v1].p).testLength(max_edge_length))
+        {
+            return false;
+        }
+
+        // The edge must still exist with a face on either side, and those must be the only vertices next to both ends. Otherwise the collapse would pinch the surface.
+        std::vector<uint32_t> shared_faces;
+        std::vector<int> neighbours0;
+        std::vector<int> neighbours1;
+        for (const uint32_t face_idx : vertex_faces[v0])
+        {
+            const int* corners = faces[face_idx].vertex_index;
+            if (corners[0] == static_cast<int>(v1) || corners[1] == static_cast<int>(v1) || corners[2] == static_cast<int>(v1))
+            {
+                shared_faces.push_back(face_idx);
+            }
+            neighbours0.insert(neighbours0.end(), corners, corners + 3);
+        }
+        if (shared_faces.size() != 2)
+        {
+            return false;
+        }
+        for (const uint32_t face_idx : vertex_faces[v1])
+        {
+            neighbours1.insert(neighbours1.end(), faces[face_idx].vertex_index, faces[face_idx].vertex_index + 3);
+        }
+        std::sort(neighbours0.begin(), neighbours0.end());
+        neighbours0.erase(std::unique(neighbours0.begin(), neighbours0.end()), neighbours0.end());
+        std::sort(neighbours1.begin(), neighbours1.end());
+        neighbours1.erase(std::unique(neighbours1.begin(), neighbours1.end()), neighbours1.end());
+        std::vector<int> common;
+        std::set_intersection(neighbours0.begin(), neighbours0.end(), neighbours1.begin(), neighbours1.end(), std::back_inserter(common));
+        if (common.size() != 4) //The two ends themselves and the two opposite vertices.
+        {
+            return false;
+        }
+
+        Point3 target;
+        const double error = findTarget(v0, v1, target);
+        if (error > max_error)
+        {
+            return false;
+        }
+
+        // None of the remaining faces may fold over.
+        for (const uint32_t moved_vertex : { v0, v1 })
+        {
+            for (const uint32_t face_idx : vertex_faces[moved_vertex])
+            {
+                if (face_idx == shared_faces[0] || face_idx == shared_faces[1])
+                {
+                    continue;
+                }
+                double normal_before[3];
+                double normal_after[3];
+                if (!getNormal(faces[face_idx], -1, Point3(), normal_before) || !getNormal(faces[face_idx], moved_vertex, target, normal_after))
+                {
+                    return false;
+                }
+                constexpr double min_cos_angle = 0.2; //Also prevents making slivers that are almost folded over.
+                if (normal_before[0] * normal_after[0] + normal_before[1] * normal_after[1] + normal_before[2] * normal_after[2] < min_cos_angle)
+                {
+                    return false;
+                }
+            }
+        }
+
+        for (const uint32_t face_idx : shared_faces)
+        {
+            face_is_removed[face_idx] = true;
+            for (const int corner : faces[face_idx].vertex_index)
+            {
+                std::vector<uint32_t>& corner_faces = vertex_faces[corner];
+                corner_faces.erase(std::find(corner_faces.begin(), corner_faces.end(), face_idx));
+            }
+        }
+        for (const uint32_t face_idx : vertex_faces[v1])
+        {
+            for (int& corner : faces[face_idx].vertex_index)
+            {
+                if (corner == static_cast<int>(v1))
+                {
+                    corner = v0;
+                }
+            }
+            vertex_faces[v0].push_back(face_idx);
+        }
+        std::vector<uint32_t>().swap(vertex_faces[v1]);
+        is_removed[v1] = true;
+        quadrics[v0] = quadrics[v0] + quadrics[v1];
+        vertices[v0].p = target;
+        return true;
+    }
+};
+
+} //Anonymous namespace.
+
+void Mesh::decimate(const coord_t max_deviation, const coord_t max_edge_length)
+{
+    if (faces.empty())
+    {
+        return;
+    }
+    const size_t original_face_count = faces.size();
+    EdgeCollapser collapser(vertices, faces, aabb, max_deviation, max_edge_length);
+
+    // Collapsing an edge changes the cost of the edges around it, so repeat until little is left to gain.
+    constexpr size_t max_rounds = 10;
+    for (size_t round = 0; round < max_rounds; round++)
+    {
+        size_t collapsed = 0;
+        collapser.assignFacesToRegions();
+#pragma omp parallel for default(none) shared(collapser) reduction(+:collapsed) schedule(dynamic)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int region = 0; region < static_cast<int>(EdgeCollapser::region_count); region++)
+        {
+            collapsed += collapser.collapseRegion(region);
+        }
+        collapsed += collapser.collapseRegion(EdgeCollapser::any_region);
+        if (collapsed * 100 < original_face_count) //Less than a percent of the faces were removed.
+        {
+            break;
+        }
+    }
+    collapser.compact();
+
+    aabb = AABB3D();
+    for (const MeshVertex& vertex : vertices)
+    {
+        aabb.include(vertex.p);
+    }
+    log("Decimated mesh %s from %zu to %zu faces.\n", mesh_name.c_str(), original_face_count, faces.size());
+}
+
+void Mesh::buildConnectedFaces()
+{
+    vertex_faces_start.assign(vertices.size() + 1, 0);
+    for (const MeshFace& face : faces)
+    {
+        for (const int vertex_idx : face.vertex_index)
+        {
+            vertex_faces_start[vertex_idx + 1]++;
+        }
+    }
+    for (size_t vertex_idx = 0; vertex_idx < vertices.size(); vertex_idx++)
+    {
+        vertex_faces_start[vertex_idx + 1] += vertex_faces_start[vertex_idx];
+    }
+    vertex_faces.resize(faces.size() * 3);
+    std::vector<uint32_t> insert_pos(vertex_faces_start.begin(), vertex_faces_start.end() - 1);
+    for (size_t face_idx = 0; face_idx < faces.size(); face_idx++)
+    {
+        for (const int vertex_idx : faces[face_idx].vertex_index)
+        {
+            vertex_faces[insert_pos[vertex_idx]++] = face_idx; //In face order, like the faces were added.
+        }
+    }
+}
+
 Point3 Mesh::min() const
 {
     return aabb.min;
@@ -111,16 +885,14 @@ bool Mesh::isPrinted() const
     
 int Mesh::findIndexOfVertex(const Point3& v)
 {
-    uint32_t hash = pointHash(v);
-
-    for(unsigned int idx = 0; idx < vertex_hash_map[hash].size(); idx++)
+    const MeshVertexHashTable::Cell cell = MeshVertexHashTable::toCell(v);
+    const uint32_t vertex_idx = vertex_hash_map.find(cell, v, [this](const uint32_t idx) { return vertices[idx].p; });
+    if (vertex_idx != MeshVertexHashTable::no_vertex)
     {
-        if ((vertices[vertex_hash_map[hash][idx]].p - v).testLength(vertex_meld_distance))
-        {
-            return vertex_hash_map[hash][idx];
-        }
+        return vertex_idx;
     }
-    vertex_hash_map[hash].push_back(vertices.size());
+    vertex_hash_map.reserve(MeshVertexHashTable::getPartition(cell), 1);
+    vertex_hash_map.insert(cell, vertices.size());
     vertices.emplace_back(v);
     
     aabb.include(v);
@@ -152,10 +924,35 @@ See <a href="http://stackoverflow.com/questions/14066933/direct-way-of-computing
 
 
 */
+void Mesh::warnDisconnectedFaces() const
+{
+    // Named, so that it doesn't wait for unrelated unnamed critical sections. The logging itself takes no OpenMP lock.
+#pragma omp critical(mesh_warnings)
+    {
+        if (!has_disconnected_faces)
+        {
+            cura::logWarning("Mesh has disconnected faces!\n");
+        }
+        has_disconnected_faces = true;
+    }
+}
+
+void Mesh::warnOverlappingFaces() const
+{
+#pragma omp critical(mesh_warnings)
+    {
+        if (!has_overlapping_faces)
+        {
+            cura::logWarning("Mesh has overlapping faces!\n");
+        }
+        has_overlapping_faces = true;
+    }
+}
+
 int Mesh::getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVertexIdx) const
 {
     std::vector<int> candidateFaces; // in case more than two faces meet at an edge, multiple candidates are generated
-    for(int f : vertices[idx0].connected_faces) // search through all faces connected to the first vertex and find those that are also connected to the second
+    for(int f : getConnectedFaces(idx0)) // search through all faces connected to the first vertex and find those that are also connected to the second
     {
         if (f == notFaceIdx)
         {
@@ -171,11 +968,7 @@ int Mesh::getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVe
     if (candidateFaces.size() == 0)
     {
         cura::logDebug("Couldn't find face connected to face %i.\n", notFaceIdx);
-        if (!has_disconnected_faces)
-        {
-            cura::logWarning("Mesh has disconnected faces!\n");
-        }
-        has_disconnected_faces = true;
+        warnDisconnectedFaces();
         return -1;
     }
     if (candidateFaces.size() == 1) { return candidateFaces[0]; }
@@ -184,11 +977,7 @@ int Mesh::getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVe
     if (candidateFaces.size() % 2 == 0)
     {
         cura::logDebug("Warning! Edge with uneven number of faces connecting it!(%i)\n", candidateFaces.size()+1);
-        if (!has_disconnected_faces)
-        {
-            cura::logWarning("Mesh has disconnected faces!\n");
-        }
-        has_disconnected_faces = true;
+        warnDisconnectedFaces();
     }
 
     FPoint3 vn = vertices[idx1].p - vertices[idx0].p;
@@ -226,11 +1015,7 @@ int Mesh::getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVe
         if (angle == 0)
         {
             cura::logDebug("Overlapping faces: face %i and face %i.\n", notFaceIdx, candidateFace);
-            if (!has_overlapping_faces)
-            {
-                cura::logWarning("Mesh has overlapping faces!\n");
-            }
-            has_overlapping_faces = true;
+            warnOverlappingFaces();
         }
         if (angle < smallestAngle)
         {
@@ -241,11 +1026,7 @@ int Mesh::getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVe
     if (bestIdx < 0)
     {
         cura::logDebug("Couldn't find face connected to face %i.\n", notFaceIdx);
-        if (!has_disconnected_faces)
-        {
-            cura::logWarning("Mesh has disconnected faces!\n");
-        }
-        has_disconnected_faces = true;
+        warnDisconnectedFaces();
     }
     return bestIdx;
 }
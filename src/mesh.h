@@ -4,6 +4,9 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include <array>
+#include <limits>
+
 #include "settings/Settings.h"
 #include "utils/AABB3D.h"
 #include "utils/floatpoint.h"
@@ -14,15 +17,14 @@ namespace cura
 /*!
 Vertex type to be used in a Mesh.
 
-Keeps track of which faces connect to it.
+The faces which connect to it are stored in the mesh, see Mesh::getConnectedFaces.
 */
 class MeshVertex
 {
 public:
     Point3 p; //!< location of the vertex
-    std::vector<uint32_t> connected_faces; //!< list of the indices of connected faces
 
-    MeshVertex(Point3 p) : p(p) {connected_faces.reserve(8);} //!< doesn't set connected_faces
+    MeshVertex(Point3 p) : p(p) {}
 };
 
 /*! A MeshFace is a 3 dimensional model triangle with 3 points. These points are already converted to integers
@@ -54,6 +56,121 @@ public:
 };
 
 
+/*!
+ * Hash table to find the vertices of a mesh near a location, in order to meld
+ * vertices of adjacent faces together.
+ *
+ * Vertices are keyed on the cell of a grid which they fall in, with the melding
+ * distance as cell size. The table uses open addressing in flat arrays, so that
+ * lookups don't chase pointers and no allocation is needed per vertex. It is
+ * split into a number of partitions by cell so that different threads can
+ * work on different partitions at once.
+ */
+class MeshVertexHashTable
+{
+public:
+    //! The number of independent partitions of the table.
+    static constexpr size_t partition_count = 64;
+
+    //! Id which is returned if no vertex was found.
+    static constexpr uint32_t no_vertex = std::numeric_limits<uint32_t>::max();
+
+    //! Vertices closer together than this distance are melded into one. Also the size of the grid cells.
+    static constexpr coord_t meld_distance = MM2INT(0.03);
+
+    //! The grid cell of a location.
+    struct Cell
+    {
+        int32_t x, y, z;
+        bool operator==(const Cell& other) const
+        {
+            return x == other.x && y == other.y && z == other.z;
+        }
+    };
+
+    /*!
+     * Get the grid cell of a location.
+     */
+    static Cell toCell(const Point3& p);
+
+    /*!
+     * Get the partition in which the vertices of a cell are stored.
+     */
+    static size_t getPartition(const Cell& cell);
+
+    /*!
+     * Make room for the given number of additional vertices in a partition, so
+     * that inserting them won't need to grow the table.
+     */
+    void reserve(const size_t partition, const size_t additional_vertex_count);
+
+    /*!
+     * Remove all vertices and free the memory.
+     */
+    void clear();
+
+    /*!
+     * Find the vertex with the lowest id in a cell which is within melding
+     * distance of a location.
+     * \param cell The cell of \p p.
+     * \param p The location to find a vertex for.
+     * \param get_location Function giving the location of a vertex by its id.
+     * \return The id of the vertex, or \ref no_vertex if there is none.
+     */
+    template<typename LocationFunc>
+    uint32_t find(const Cell& cell, const Point3& p, const LocationFunc& get_location) const;
+
+    /*!
+     * Add a vertex. The table must have room for it in its partition.
+     * \return The index of the slot in the partition where it was stored.
+     */
+    size_t insert(const Cell& cell, const uint32_t vertex_id);
+
+    /*!
+     * Change the id of a vertex stored in the given slot.
+     */
+    void setId(const size_t partition, const size_t slot, const uint32_t vertex_id);
+
+private:
+    struct Entry
+    {
+        Cell cell;
+        uint32_t vertex_id = no_vertex; //!< no_vertex marks an empty slot.
+    };
+
+    struct Partition
+    {
+        std::vector<Entry> slots; //!< Power of two sized.
+        size_t size = 0; //!< Number of filled slots.
+    };
+
+    static uint64_t hash(const Cell& cell);
+
+    std::array<Partition, partition_count> partitions;
+};
+
+template<typename LocationFunc>
+uint32_t MeshVertexHashTable::find(const Cell& cell, const Point3& p, const LocationFunc& get_location) const
+{
+    const Partition& partition = partitions[getPartition(cell)];
+    if (partition.slots.empty())
+    {
+        return no_vertex;
+    }
+    // Vertex ids increase in the order in which vertices were added, so the lowest id is the vertex that was added first.
+    uint32_t best_vertex_id = no_vertex;
+    const size_t mask = partition.slots.size() - 1;
+    for (size_t slot = (hash(cell) / partition_count) & mask; partition.slots[slot].vertex_id != no_vertex; slot = (slot + 1) & mask)
+    {
+        const Entry& entry = partition.slots[slot];
+        if (entry.vertex_id < best_vertex_id && entry.cell == cell && (get_location(entry.vertex_id) - p).testLength(meld_distance))
+        {
+            best_vertex_id = entry.vertex_id;
+        }
+    }
+    return best_vertex_id;
+}
+
 /*!
 A Mesh is the most basic representation of a 3D model. It contains all the faces as MeshFaces.
 
@@ -62,7 +179,7 @@ See MeshFace for the specifics of how/when faces are connected.
 class Mesh
 {
     //! The vertex_hash_map stores a index reference of each vertex for the hash of that location. Allows for quick retrieval of points with the same location.
-    std::unordered_map<uint32_t, std::vector<uint32_t> > vertex_hash_map;
+    MeshVertexHashTable vertex_hash_map;
     AABB3D aabb;
 public:
     std::vector<MeshVertex> vertices;//!< list of all vertices in the mesh
@@ -74,8 +191,75 @@ public:
     Mesh();
 
     void addFace(Point3& v0, Point3& v1, Point3& v2); //!< add a face to the mesh without settings it's connected_faces.
+
+    /*!
+     * Add many faces to the mesh at once, without setting their
+     * connected_faces.
+     *
+     * This gives the same result as calling \ref addFace for each face in
+     * order, but for large batches the vertices are melded in parallel.
+     * \param corners The corners of all faces, three per face.
+     */
+    void addFaces(const std::vector<Point3>& corners);
     void clear(); //!< clears all data
-    void finish(); //!< complete the model : set the connected_face_index fields of the faces.
+    void finish(); //!< complete the model : find the faces connected to each vertex and set the connected_face_index fields of the faces.
+
+    /*!
+     * The indices of the faces connected to a vertex.
+     */
+    struct FaceRange
+    {
+        const uint32_t* first;
+        const uint32_t* last;
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return last; }
+        size_t size() const { return last - first; }
+    };
+
+    /*!
+     * Get the faces connected to a vertex, in the order of the faces.
+     *
+     * These are only known after \ref finish .
+     * \param vertex_idx The vertex to get the connected faces of.
+     */
+    FaceRange getConnectedFaces(const size_t vertex_idx) const
+    {
+        return FaceRange{ vertex_faces.data() + vertex_faces_start[vertex_idx], vertex_faces.data() + vertex_faces_start[vertex_idx + 1] };
+    }
+
+    /*!
+     * Reorder the vertices and faces from bottom to top.
+     *
+     * The faces are sorted by their lowest vertex and the vertices by their
+     * height, so the faces that cross a layer are close together in memory,
+     * and so are their vertices. Slicing then goes through memory in order.
+     *
+     * This must be done before the faces are connected by \ref finish ,
+     * which does so itself if the setting mesh_sort_by_height is enabled.
+     */
+    void sortByHeight();
+
+    /*!
+     * Reduce the number of faces by collapsing short edges, as long as the
+     * surface doesn't move by more than the given deviation.
+     *
+     * This uses quadric error metrics: each vertex keeps the planes of the
+     * original faces around it, and an edge is only collapsed if the merged
+     * vertex stays within \p max_deviation of all of those planes. Edges on
+     * the boundary of the mesh or where more than two faces meet are kept, as
+     * are collapses that would fold faces over or change the topology.
+     *
+     * The mesh is split into slabs that are decimated in parallel. The edges
+     * near the borders of the slabs are collapsed afterwards. The result
+     * doesn't depend on the number of threads.
+     *
+     * This must be done before the faces are connected by \ref finish ,
+     * which does so itself if the setting meshfix_decimate_mesh is enabled or
+     * when slicing a preview.
+     * \param max_deviation How far the surface may move, in microns.
+     * \param max_edge_length Only edges shorter than this are collapsed.
+     */
+    void decimate(const coord_t max_deviation, const coord_t max_edge_length);
 
     Point3 min() const; //!< min (in x,y and z) vertex of the bounding box
     Point3 max() const; //!< max (in x,y and z) vertex of the bounding box
@@ -109,8 +293,36 @@ public:
 private:
     mutable bool has_disconnected_faces; //!< Whether it has been logged that this mesh contains disconnected faces
     mutable bool has_overlapping_faces; //!< Whether it has been logged that this mesh contains overlapping faces
+
+    /*!
+     * Log that this mesh has disconnected faces, if that wasn't logged yet.
+     *
+     * This may be called from multiple threads at once.
+     */
+    void warnDisconnectedFaces() const;
+
+    /*!
+     * Log that this mesh has overlapping faces, if that wasn't logged yet.
+     *
+     * This may be called from multiple threads at once.
+     */
+    void warnOverlappingFaces() const;
     int findIndexOfVertex(const Point3& v); //!< find index of vertex close to the given point, or create a new vertex and return its index.
 
+    /*!
+     * The faces connected to the vertices, in compressed sparse row form: the
+     * faces of vertex i are the elements from vertex_faces_start[i] up to
+     * vertex_faces_start[i + 1] in \ref vertex_faces . Storing these for all
+     * vertices in two arrays is much smaller than a vector per vertex.
+     */
+    std::vector<uint32_t> vertex_faces_start;
+    std::vector<uint32_t> vertex_faces; //!< The faces connected to each vertex, for all vertices one after another. See \ref vertex_faces_start .
+
+    /*!
+     * Fill \ref vertex_faces_start and \ref vertex_faces from the faces.
+     */
+    void buildConnectedFaces();
+
     /*!
      * Get the index of the face connected to the face with index \p notFaceIdx, via vertices \p idx0 and \p idx1.
      * 
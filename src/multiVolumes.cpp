@@ -24,6 +24,10 @@ void carveMultipleVolumes(std::vector<Slicer*> &volumes)
                 {
                     return volume_1->mesh->settings.get<int>("infill_mesh_order") < volume_2->mesh->settings.get<int>("infill_mesh_order");
                 } );
+
+    //Find which volumes carve each other first. The layers can then be carved independently of each other.
+    std::vector<std::pair<Slicer*, Slicer*>> carve_pairs; //Carve the second volume out of the first, in this order.
+    size_t layer_count = 0;
     for (unsigned int volume_1_idx = 1; volume_1_idx < volumes.size(); volume_1_idx++)
     {
         Slicer& volume_1 = *ranked_volumes[volume_1_idx];
@@ -50,18 +54,45 @@ void carveMultipleVolumes(std::vector<Slicer*> &volumes)
             {
                 continue;
             }
-            for (unsigned int layerNr = 0; layerNr < volume_1.layers.size(); layerNr++)
+            carve_pairs.emplace_back(&volume_1, &volume_2);
+            layer_count = std::max(layer_count, volume_1.layers.size());
+        }
+    }
+    std::vector<bool> alternate_per_pair; //Whether the carve order may alternate for each pair, because they have the same infill mesh order.
+    for (const std::pair<Slicer*, Slicer*>& carve_pair : carve_pairs)
+    {
+        alternate_per_pair.push_back(alternate_carve_order && carve_pair.first->mesh->settings.get<int>("infill_mesh_order") == carve_pair.second->mesh->settings.get<int>("infill_mesh_order"));
+    }
+
+    // OpenMP compatibility fix for GCC <= 8 and GCC >= 9
+    // See https://www.gnu.org/software/gcc/gcc-9/porting_to.html, section "OpenMP data sharing"
+#if defined(__GNUC__) && __GNUC__ <= 8 && !defined(__clang__)
+    #pragma omp parallel for default(none) shared(carve_pairs, alternate_per_pair) schedule(dynamic)
+#else
+    #pragma omp parallel for default(none) shared(carve_pairs, alternate_per_pair, layer_count) schedule(dynamic)
+#endif // defined(__GNUC__) && __GNUC__ <= 8
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(layer_count); layer_nr++)
+    {
+        for (size_t pair_idx = 0; pair_idx < carve_pairs.size(); pair_idx++)
+        {
+            Slicer& volume_1 = *carve_pairs[pair_idx].first;
+            Slicer& volume_2 = *carve_pairs[pair_idx].second;
+            if (layer_nr >= static_cast<int>(volume_1.layers.size()))
             {
-                SlicerLayer& layer1 = volume_1.layers[layerNr];
-                SlicerLayer& layer2 = volume_2.layers[layerNr];
-                if (alternate_carve_order && layerNr % 2 == 0 && volume_1.mesh->settings.get<int>("infill_mesh_order") == volume_2.mesh->settings.get<int>("infill_mesh_order"))
-                {
-                    layer2.polygons = layer2.polygons.difference(layer1.polygons);
-                }
-                else
-                {
-                    layer1.polygons = layer1.polygons.difference(layer2.polygons);
-                }
+                continue;
+            }
+            SlicerLayer& layer1 = volume_1.layers[layer_nr];
+            SlicerLayer& layer2 = volume_2.layers[layer_nr];
+            if (alternate_per_pair[pair_idx] && layer_nr % 2 == 0)
+            {
+                layer2.polygons = layer2.polygons.difference(layer1.polygons);
+                layer2.part_starts.clear();
+            }
+            else
+            {
+                layer1.polygons = layer1.polygons.difference(layer2.polygons);
+                layer1.part_starts.clear();
             }
         }
     }
@@ -76,11 +107,12 @@ void generateMultipleVolumesOverlap(std::vector<Slicer*> &volumes)
         return;
     }
 
-    int offset_to_merge_other_merged_volumes = 20;
+    //Find which volumes get an overlap with which other volumes first. The layers can then be processed independently of each other.
+    std::vector<Slicer*> overlapping_volumes;
+    std::vector<std::vector<Slicer*>> other_volumes_per_volume; //For each overlapping volume, the volumes that its bounding box hits.
+    size_t layer_count = 0;
     for (Slicer* volume : volumes)
     {
-        ClipperLib::PolyFillType fill_type = volume->mesh->settings.get<bool>("meshfix_union_all") ? ClipperLib::pftNonZero : ClipperLib::pftEvenOdd;
-
         coord_t overlap = volume->mesh->settings.get<coord_t>("multiple_mesh_overlap");
         if (volume->mesh->settings.get<bool>("infill_mesh")
             || volume->mesh->settings.get<bool>("anti_overhang_mesh")
@@ -91,26 +123,58 @@ void generateMultipleVolumesOverlap(std::vector<Slicer*> &volumes)
         }
         AABB3D aabb(volume->mesh->getAABB());
         aabb.expandXY(overlap); // expand to account for the case where two models and their bounding boxes are adjacent along the X or Y-direction
-        for (unsigned int layer_nr = 0; layer_nr < volume->layers.size(); layer_nr++)
+        std::vector<Slicer*> other_volumes;
+        for (Slicer* other_volume : volumes)
+        {
+            if (other_volume->mesh->settings.get<bool>("infill_mesh")
+                || other_volume->mesh->settings.get<bool>("anti_overhang_mesh")
+                || other_volume->mesh->settings.get<bool>("support_mesh")
+                || !other_volume->mesh->getAABB().hit(aabb)
+                || other_volume == volume
+            )
+            {
+                continue;
+            }
+            other_volumes.push_back(other_volume);
+        }
+        overlapping_volumes.push_back(volume);
+        other_volumes_per_volume.push_back(other_volumes);
+        layer_count = std::max(layer_count, volume->layers.size());
+    }
+
+    // OpenMP compatibility fix for GCC <= 8 and GCC >= 9
+    // See https://www.gnu.org/software/gcc/gcc-9/porting_to.html, section "OpenMP data sharing"
+#if defined(__GNUC__) && __GNUC__ <= 8 && !defined(__clang__)
+    #pragma omp parallel for default(none) shared(overlapping_volumes, other_volumes_per_volume) schedule(dynamic)
+#else
+    #pragma omp parallel for default(none) shared(overlapping_volumes, other_volumes_per_volume, layer_count) schedule(dynamic)
+#endif // defined(__GNUC__) && __GNUC__ <= 8
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(layer_count); layer_nr++)
+    {
+        constexpr coord_t offset_to_merge_other_merged_volumes = 20;
+        for (size_t volume_idx = 0; volume_idx < overlapping_volumes.size(); volume_idx++)
         {
+            Slicer* volume = overlapping_volumes[volume_idx];
+            if (layer_nr >= static_cast<int>(volume->layers.size()))
+            {
+                continue;
+            }
+            const ClipperLib::PolyFillType fill_type = volume->mesh->settings.get<bool>("meshfix_union_all") ? ClipperLib::pftNonZero : ClipperLib::pftEvenOdd;
+            const coord_t overlap = volume->mesh->settings.get<coord_t>("multiple_mesh_overlap");
+
+            //Union all other volumes at once. Since each offset result is clean, this gives the same area as adding them one by one with the same fill type.
             Polygons all_other_volumes;
-            for (Slicer* other_volume : volumes)
+            for (Slicer* other_volume : other_volumes_per_volume[volume_idx])
             {
-                if (other_volume->mesh->settings.get<bool>("infill_mesh")
-                    || other_volume->mesh->settings.get<bool>("anti_overhang_mesh")
-                    || other_volume->mesh->settings.get<bool>("support_mesh")
-                    || !other_volume->mesh->getAABB().hit(aabb)
-                    || other_volume == volume
-                )
-                {
-                    continue;
-                }
                 SlicerLayer& other_volume_layer = other_volume->layers[layer_nr];
-                all_other_volumes = all_other_volumes.unionPolygons(other_volume_layer.polygons.offset(offset_to_merge_other_merged_volumes), fill_type);
+                all_other_volumes.add(other_volume_layer.polygons.offset(offset_to_merge_other_merged_volumes));
             }
+            all_other_volumes = all_other_volumes.unionPolygons(Polygons(), fill_type);
 
             SlicerLayer& volume_layer = volume->layers[layer_nr];
             volume_layer.polygons = volume_layer.polygons.unionPolygons(all_other_volumes.intersection(volume_layer.polygons.offset(overlap / 2)), fill_type);
+            volume_layer.part_starts.clear();
         }
     }
 }
@@ -128,6 +192,7 @@ void MultiVolumes::carveCuttingMeshes(std::vector<Slicer*>& volumes, const std::
         for (unsigned int layer_nr = 0; layer_nr < cutting_mesh_volume.layers.size(); layer_nr++)
         {
             Polygons& cutting_mesh_polygons = cutting_mesh_volume.layers[layer_nr].polygons;
+            cutting_mesh_volume.layers[layer_nr].part_starts.clear();
             Polygons& cutting_mesh_polylines = cutting_mesh_volume.layers[layer_nr].openPolylines;
             Polygons cutting_mesh_area_recomputed;
             Polygons* cutting_mesh_area;
@@ -170,6 +235,7 @@ void MultiVolumes::carveCuttingMeshes(std::vector<Slicer*>& volumes, const std::
                 }
                 Slicer& carved_volume = *volumes[carved_mesh_idx];
                 Polygons& carved_mesh_layer = carved_volume.layers[layer_nr].polygons;
+                carved_volume.layers[layer_nr].part_starts.clear();
 
                 Polygons intersection = cutting_mesh_polygons.intersection(carved_mesh_layer);
                 new_outlines.add(intersection);
@@ -4,9 +4,11 @@
 #include "Comb.h"
 
 #include <algorithm>
+#include <cassert>
 #include <functional> // function
 #include <unordered_set>
 
+#include "CombPathCache.h" //To hash the outside boundary.
 #include "CombPaths.h"
 #include "LinePolygonsCrossings.h"
 #include "../Application.h"
@@ -19,46 +21,69 @@
 
 namespace cura {
 
+const Comb::InsidePart& Comb::getInsidePart(const PartsView& parts_view, std::vector<std::unique_ptr<InsidePart>>& parts, const size_t part_idx)
+{
+    assert(part_idx < parts.size() && "The part to comb in must be one of the parts of the boundary.");
+    if (parts[part_idx] == nullptr)
+    {
+        parts[part_idx] = std::make_unique<InsidePart>();
+        parts[part_idx]->polygons = parts_view.assemblePart(part_idx);
+        parts[part_idx]->loc_to_line = PolygonUtils::createLocToLineGrid(parts[part_idx]->polygons, offset_from_outlines);
+    }
+    return *parts[part_idx];
+}
+
+size_t Comb::getOutsideBoundaryKey(const ExtruderTrain& train)
+{
+    return train.settings.get<bool>("travel_avoid_supports") ? 1 : 0;
+}
+
 LocToLineGrid& Comb::getOutsideLocToLine(const ExtruderTrain& train)
 {
-    if (outside_loc_to_line[train.extruder_nr] == nullptr)
+    const size_t key = getOutsideBoundaryKey(train);
+    if (outside_loc_to_line[key] == nullptr)
     {
-        outside_loc_to_line[train.extruder_nr] =
+        outside_loc_to_line[key] =
             PolygonUtils::createLocToLineGrid(getBoundaryOutside(train), offset_from_inside_to_outside * 3 / 2);
     }
-    return *outside_loc_to_line[train.extruder_nr];
+    return *outside_loc_to_line[key];
 }
 
 Polygons& Comb::getBoundaryOutside(const ExtruderTrain& train)
 {
-    if (boundary_outside[train.extruder_nr].empty())
+    outside_boundary_used = true;
+    const size_t key = getOutsideBoundaryKey(train);
+    if (boundary_outside[key].empty())
     {
         bool travel_avoid_supports = train.settings.get<bool>("travel_avoid_supports");
-        boundary_outside[train.extruder_nr] =
+        boundary_outside[key] =
             storage.getLayerOutlines(layer_nr, travel_avoid_supports, travel_avoid_supports).offset(travel_avoid_distance);
     }
-    return boundary_outside[train.extruder_nr];
+    return boundary_outside[key];
 }
 
 Polygons& Comb::getModelBoundary(const ExtruderTrain& train)
 {
-    if (model_boundary[train.extruder_nr].empty())
+    outside_boundary_used = true;
+    const size_t key = getOutsideBoundaryKey(train);
+    if (model_boundary[key].empty())
     {
         bool travel_avoid_supports = train.settings.get<bool>("travel_avoid_supports");
-        model_boundary[train.extruder_nr] =
+        model_boundary[key] =
             storage.getLayerOutlines(layer_nr, travel_avoid_supports, travel_avoid_supports);
     }
-    return boundary_outside[train.extruder_nr];
+    return model_boundary[key];
 }
 
 LocToLineGrid& Comb::getModelBoundaryLocToLine(const ExtruderTrain& train)
 {
-    if (model_boundary_loc_to_line[train.extruder_nr] == nullptr)
+    const size_t key = getOutsideBoundaryKey(train);
+    if (model_boundary_loc_to_line[key] == nullptr)
     {
-        model_boundary_loc_to_line[train.extruder_nr] =
+        model_boundary_loc_to_line[key] =
             PolygonUtils::createLocToLineGrid(getModelBoundary(train), offset_from_inside_to_outside * 3 / 2);
     }
-    return *model_boundary_loc_to_line[train.extruder_nr];
+    return *model_boundary_loc_to_line[key];
 }
 
 Comb::Comb(const SliceDataStorage& storage, const LayerIndex layer_nr, const Polygons& comb_boundary_inside_minimum, const Polygons& comb_boundary_inside_optimal, coord_t comb_boundary_offset, coord_t travel_avoid_distance, coord_t move_inside_distance)
@@ -74,11 +99,73 @@ Comb::Comb(const SliceDataStorage& storage, const LayerIndex layer_nr, const Pol
 , partsView_inside_optimal( boundary_inside_optimal.splitIntoPartsView() ) // WARNING !! changes the order of boundary_inside !!
 , inside_loc_to_line_minimum(PolygonUtils::createLocToLineGrid(boundary_inside_minimum, comb_boundary_offset))
 , inside_loc_to_line_optimal(PolygonUtils::createLocToLineGrid(boundary_inside_optimal, comb_boundary_offset))
+, inside_index_minimum(boundary_inside_minimum, *inside_loc_to_line_minimum)
+, parts_inside_minimum(partsView_inside_minimum.size())
+, parts_inside_optimal(partsView_inside_optimal.size())
 , move_inside_distance(move_inside_distance)
+, outside_boundary_used(false)
 , travel_avoid_distance(travel_avoid_distance)
 {
 }
 
+void Comb::resetOutsideBoundaryUsed()
+{
+    outside_boundary_used = false;
+}
+
+bool Comb::isOutsideBoundaryUsed() const
+{
+    return outside_boundary_used;
+}
+
+Comb::LayerOutlines& Comb::getLayerOutlines(const ExtruderTrain& train)
+{
+    const size_t key = getOutsideBoundaryKey(train);
+    auto found = layer_outlines.find(key);
+    if (found == layer_outlines.end())
+    {
+        const bool travel_avoid_supports = train.settings.get<bool>("travel_avoid_supports");
+        LayerOutlines outlines{storage.getLayerOutlines(layer_nr, travel_avoid_supports, travel_avoid_supports), 0, nullptr, {}};
+        outlines.hash = CombPathCache::hash(outlines.outlines);
+        std::shared_ptr<CompactPolygons> compact = std::make_shared<CompactPolygons>();
+        if (compact->compact(outlines.outlines))
+        {
+            outlines.compact = std::move(compact);
+        }
+        found = layer_outlines.emplace(key, std::move(outlines)).first;
+    }
+    return found->second;
+}
+
+size_t Comb::getLayerOutlinesHash(const ExtruderTrain& train)
+{
+    return getLayerOutlines(train).hash;
+}
+
+std::shared_ptr<const CompactPolygons> Comb::getCompactLayerOutlines(const ExtruderTrain& train)
+{
+    return getLayerOutlines(train).compact;
+}
+
+bool Comb::isSameLayerOutlines(const ExtruderTrain& train, const size_t hash, const std::shared_ptr<const CompactPolygons>& other)
+{
+    LayerOutlines& outlines = getLayerOutlines(train);
+    if (!other || hash != outlines.hash)
+    {
+        return false;
+    }
+    if (other == outlines.compact || std::find(outlines.same.begin(), outlines.same.end(), other) != outlines.same.end())
+    {
+        return true;
+    }
+    if (!other->isSame(outlines.outlines))
+    {
+        return false;
+    }
+    outlines.same.push_back(other);
+    return true;
+}
+
 bool Comb::calc(const ExtruderTrain& train, Point start_point, Point end_point, CombPaths& comb_paths, bool _start_inside, bool _end_inside, coord_t max_comb_distance_ignored, bool &unretract_before_last_travel_move)
 {
     if(shorterThen(end_point - start_point, max_comb_distance_ignored))
@@ -105,9 +192,9 @@ bool Comb::calc(const ExtruderTrain& train, Point start_point, Point end_point,
     // normal combing within part using optimal comb boundary
     if (start_inside && end_inside && start_part_idx == end_part_idx)
     {
-        PolygonsPart part = partsView_inside_optimal.assemblePart(start_part_idx);
+        const InsidePart& part = getInsidePart(partsView_inside_optimal, parts_inside_optimal, start_part_idx);
         comb_paths.emplace_back();
-        const bool combing_succeeded = LinePolygonsCrossings::comb(part, *inside_loc_to_line_optimal, start_point, end_point, comb_paths.back(), -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
+        const bool combing_succeeded = LinePolygonsCrossings::comb(part.polygons, *part.loc_to_line, start_point, end_point, comb_paths.back(), -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
         // If the endpoint of the travel path changes with combing, then it means that we are moving to an outer wall
         // and we should unretract before the last travel move when travelling to that outer wall
         unretract_before_last_travel_move = combing_succeeded && end_point != travel_end_point_before_combing;
@@ -132,11 +219,11 @@ bool Comb::calc(const ExtruderTrain& train, Point start_point, Point end_point,
     // normal combing within part using minimum comb boundary
     if (start_inside_min && end_inside_min && start_part_idx_min == end_part_idx_min)
     {
-        PolygonsPart part = partsView_inside_minimum.assemblePart(start_part_idx_min);
+        const InsidePart& part = getInsidePart(partsView_inside_minimum, parts_inside_minimum, start_part_idx_min);
         comb_paths.emplace_back();
 
-        comb_result = LinePolygonsCrossings::comb(part, *inside_loc_to_line_minimum, start_point, end_point, result_path, -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
-        Comb::moveCombPathInside(boundary_inside_minimum, boundary_inside_optimal, result_path, comb_paths.back());  // add altered result_path to combPaths.back()
+        comb_result = LinePolygonsCrossings::comb(part.polygons, *part.loc_to_line, start_point, end_point, result_path, -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
+        Comb::moveCombPathInside(inside_index_minimum, boundary_inside_optimal, result_path, comb_paths.back());  // add altered result_path to combPaths.back()
         // If the endpoint of the travel path changes with combing, then it means that we are moving to an outer wall
         // and we should unretract before the last travel move when travelling to that outer wall
         unretract_before_last_travel_move = comb_result && end_point != travel_end_point_before_combing;
@@ -199,7 +286,8 @@ bool Comb::calc(const ExtruderTrain& train, Point start_point, Point end_point,
         bool combing_succeeded = start_inside && LinePolygonsCrossings::comb(boundary_inside_optimal, *inside_loc_to_line_optimal, start_point, start_crossing.in_or_mid, comb_paths.back(), -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_for_optimum_bound);
         if(!combing_succeeded)
         {
-            combing_succeeded = LinePolygonsCrossings::comb(start_crossing.dest_part, *inside_loc_to_line_minimum, start_point, start_crossing.in_or_mid, comb_paths.back(), -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
+            const InsidePart& start_part = getInsidePart(partsView_inside_minimum, parts_inside_minimum, start_part_idx_min);
+            combing_succeeded = LinePolygonsCrossings::comb(start_part.polygons, *start_part.loc_to_line, start_point, start_crossing.in_or_mid, comb_paths.back(), -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
         }
         if (!combing_succeeded)
         { // Couldn't comb between start point and computed crossing from the start part! Happens for very thin parts when the offset_to_get_off_boundary moves points to outside the polygon
@@ -282,7 +370,8 @@ bool Comb::calc(const ExtruderTrain& train, Point start_point, Point end_point,
         bool combing_succeeded = end_inside && LinePolygonsCrossings::comb(boundary_inside_optimal, *inside_loc_to_line_optimal, end_crossing.in_or_mid, end_point, comb_paths.back(), -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_for_optimum_bound);
         if(!combing_succeeded)
         {
-            combing_succeeded = LinePolygonsCrossings::comb(end_crossing.dest_part, *inside_loc_to_line_minimum, end_crossing.in_or_mid, end_point, comb_paths.back(), -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
+            const InsidePart& end_part = getInsidePart(partsView_inside_minimum, parts_inside_minimum, end_part_idx_min);
+            combing_succeeded = LinePolygonsCrossings::comb(end_part.polygons, *end_part.loc_to_line, end_crossing.in_or_mid, end_point, comb_paths.back(), -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
         }
         // If the endpoint of the travel path changes with combing, then it means that we are moving to an outer wall
         // and we should unretract before the last travel move when traveling to that outer wall
@@ -297,7 +386,7 @@ bool Comb::calc(const ExtruderTrain& train, Point start_point, Point end_point,
 }
 
 // Try to move comb_path_input points inside by the amount of `move_inside_distance` and see if the points are still in boundary_inside_optimal, add result in comb_path_output
-void Comb::moveCombPathInside(Polygons& boundary_inside, Polygons& boundary_inside_optimal, CombPath& comb_path_input, CombPath& comb_path_output)
+void Comb::moveCombPathInside(const IndexedPolygons& boundary_inside, Polygons& boundary_inside_optimal, CombPath& comb_path_input, CombPath& comb_path_output)
 {
     const coord_t dist = move_inside_distance;
     const coord_t dist2 = dist * dist;
@@ -310,7 +399,7 @@ void Comb::moveCombPathInside(Polygons& boundary_inside, Polygons& boundary_insi
     for(unsigned int point_idx = 1; point_idx<comb_path_input.size()-1; point_idx++)
     {
         Point new_point = Point(comb_path_input[point_idx]);
-        PolygonUtils::moveInside(boundary_inside, new_point, dist, dist2);
+        boundary_inside.moveInside(new_point, dist, dist2);
 
         if (boundary_inside_optimal.inside(new_point))
         {
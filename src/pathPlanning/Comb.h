@@ -8,6 +8,8 @@
 #include <limits> // To find the maximum for coord_t.
 
 #include "../settings/types/LayerIndex.h" // To store the layer on which we comb.
+#include "../utils/CompactPolygons.h" // To compare the outlines of layers.
+#include "../utils/IndexedPolygons.h" // To move many points of a comb path inside.
 #include "../utils/polygon.h"
 #include "../utils/polygonUtils.h"
 
@@ -131,17 +133,71 @@ private:
     const PartsView partsView_inside_optimal; //!< Structured indices onto boundary_inside_optimal which shows which polygons belong to which part.
     std::unique_ptr<LocToLineGrid> inside_loc_to_line_minimum; //!< The SparsePointGridInclusive mapping locations to line segments of the inner boundary.
     std::unique_ptr<LocToLineGrid> inside_loc_to_line_optimal; //!< The SparsePointGridInclusive mapping locations to line segments of the inner boundary.
-    std::unordered_map<size_t, Polygons> boundary_outside; //!< The boundary outside of which to stay to avoid collision with other layer parts. This is a pointer cause we only compute it when we move outside the boundary (so not when there is only a single part in the layer)
-    std::unordered_map<size_t, Polygons> model_boundary; //!< The boundary of the model itself
-    std::unordered_map<size_t, std::unique_ptr<LocToLineGrid>> outside_loc_to_line; //!< The SparsePointGridInclusive mapping locations to line segments of the outside boundary.
-    std::unordered_map<size_t, std::unique_ptr<LocToLineGrid>> model_boundary_loc_to_line; //!< The SparsePointGridInclusive mapping locations to line segments of the model boundary
+    const IndexedPolygons inside_index_minimum; //!< Queries on boundary_inside_minimum that look up the line segments in inside_loc_to_line_minimum.
+
+    /*!
+     * A single part of the inside boundary, with a grid over its own line
+     * segments, so that combing within the part only needs to look at the
+     * line segments close to the travel move.
+     */
+    struct InsidePart
+    {
+        PolygonsPart polygons; //!< The assembled part.
+        std::unique_ptr<LocToLineGrid> loc_to_line; //!< The SparsePointGridInclusive mapping locations to line segments of this part.
+    };
+    std::vector<std::unique_ptr<InsidePart>> parts_inside_minimum; //!< The parts of boundary_inside_minimum, by their index in partsView_inside_minimum. Only computed when needed.
+    std::vector<std::unique_ptr<InsidePart>> parts_inside_optimal; //!< The parts of boundary_inside_optimal, by their index in partsView_inside_optimal. Only computed when needed.
+    std::unordered_map<size_t, Polygons> boundary_outside; //!< The boundary outside of which to stay to avoid collision with other layer parts, by \ref Comb::getOutsideBoundaryKey. We only compute it when we move outside the boundary (so not when there is only a single part in the layer)
+    std::unordered_map<size_t, Polygons> model_boundary; //!< The boundary of the model itself, by \ref Comb::getOutsideBoundaryKey
+    std::unordered_map<size_t, std::unique_ptr<LocToLineGrid>> outside_loc_to_line; //!< The SparsePointGridInclusive mapping locations to line segments of the outside boundary, by \ref Comb::getOutsideBoundaryKey.
+    std::unordered_map<size_t, std::unique_ptr<LocToLineGrid>> model_boundary_loc_to_line; //!< The SparsePointGridInclusive mapping locations to line segments of the model boundary, by \ref Comb::getOutsideBoundaryKey
     coord_t move_inside_distance; //!< When using comb_boundary_inside_minimum for combing it tries to move points inside by this amount after calculating the path to move it from the border a bit.
 
+    /*!
+     * \brief The outlines of the layer that the outside boundary and the
+     * model boundary are made from, to recognise layers where combing around
+     * the other parts has the same result.
+     */
+    struct LayerOutlines
+    {
+        Polygons outlines; //!< The outlines of the layer.
+        size_t hash; //!< The hash of the outlines.
+        std::shared_ptr<const CompactPolygons> compact; //!< The outlines in compact form, or ``nullptr`` if they are too large for that.
+        std::vector<std::shared_ptr<const CompactPolygons>> same; //!< Compact outlines of other layers that were found to be the same, so that they are compared only once.
+    };
+    std::unordered_map<size_t, LayerOutlines> layer_outlines; //!< The outlines of the layer, by \ref Comb::getOutsideBoundaryKey. Only computed when a travel is looked up in the comb path cache.
+    bool outside_boundary_used; //!< Whether the outside boundary or the model boundary was used since \ref resetOutsideBoundaryUsed.
+
+    /*!
+     * Get a part of the inside boundary along with the grid over its line segments. Assemble it when it hasn't been assembled yet.
+     * \param parts_view The parts view of the inside boundary.
+     * \param parts The parts which have been assembled so far, either \ref Comb::parts_inside_minimum or \ref Comb::parts_inside_optimal.
+     * \param part_idx The index of the part in \p parts_view.
+     */
+    const InsidePart& getInsidePart(const PartsView& parts_view, std::vector<std::unique_ptr<InsidePart>>& parts, const size_t part_idx);
+
+    /*!
+     * Get the key under which the outside boundaries for an extruder are
+     * stored.
+     *
+     * The outside boundaries only depend on whether the extruder avoids the
+     * support while travelling, so extruders with the same setting share their
+     * boundaries instead of computing the same offsets again.
+     */
+    static size_t getOutsideBoundaryKey(const ExtruderTrain& train);
+
     /*!
      * Get the SparsePointGridInclusive mapping locations to line segments of the outside boundary. Calculate it when it hasn't been calculated yet.
      */
     LocToLineGrid& getOutsideLocToLine(const ExtruderTrain& train);
 
+    /*!
+     * Get the outlines of the layer that the boundaries outside of which to
+     * stay when travelling with an extruder are made from. Calculate them when
+     * they haven't been calculated yet.
+     */
+    LayerOutlines& getLayerOutlines(const ExtruderTrain& train);
+
      /*!
       * Get the boundary_outside, which is an offset from the outlines of all meshes in the layer. Calculate it when it hasn't been calculated yet.
       */
@@ -167,7 +223,7 @@ private:
      */
     bool moveInside(Polygons& boundary_inside, bool is_inside, LocToLineGrid* inside_loc_to_line, Point& dest_point, unsigned int& start_inside_poly);
 
-    void moveCombPathInside(Polygons& boundary_inside, Polygons& boundary_inside_optimal, CombPath& comb_path_input, CombPath& comb_path_output);
+    void moveCombPathInside(const IndexedPolygons& boundary_inside, Polygons& boundary_inside_optimal, CombPath& comb_path_input, CombPath& comb_path_output);
 
 public:
     /*!
@@ -212,6 +268,48 @@ public:
      * \return Whether combing has succeeded; otherwise a retraction is needed.
      */
     bool calc(const ExtruderTrain& train, Point startPoint, Point endPoint, CombPaths& combPaths, bool startInside, bool endInside, coord_t max_comb_distance_ignored, bool &unretract_before_last_travel_move);
+
+    /*!
+     * Start checking whether the next combing depends on the outlines of the
+     * layer, rather than only on the inside boundaries.
+     */
+    void resetOutsideBoundaryUsed();
+
+    /*!
+     * Whether the outside boundary or the model boundary was needed for the
+     * combing since \ref resetOutsideBoundaryUsed was called.
+     */
+    bool isOutsideBoundaryUsed() const;
+
+    /*!
+     * Get a hash of the outlines of the layer that the boundaries outside of
+     * which to stay when travelling with an extruder are made from, to
+     * recognise layers where combing around the other parts has the same
+     * result.
+     */
+    size_t getLayerOutlinesHash(const ExtruderTrain& train);
+
+    /*!
+     * Get the outlines of the layer that the boundaries outside of which to
+     * stay when travelling with an extruder are made from, in compact form, to
+     * store with combing that depends on them.
+     * \return The compact outlines, or ``nullptr`` if they are too large to
+     * store.
+     */
+    std::shared_ptr<const CompactPolygons> getCompactLayerOutlines(const ExtruderTrain& train);
+
+    /*!
+     * Whether outlines stored with the combing of another layer are exactly
+     * the same as the outlines of this layer, so that combing around the other
+     * parts has the same result.
+     * \param train The extruder that travels.
+     * \param hash The hash of the other outlines, as given by
+     * \ref getLayerOutlinesHash . Only if it's the same are the outlines
+     * compared.
+     * \param other The other outlines, as given by
+     * \ref getCompactLayerOutlines .
+     */
+    bool isSameLayerOutlines(const ExtruderTrain& train, const size_t hash, const std::shared_ptr<const CompactPolygons>& other);
 };
 
 }//namespace cura
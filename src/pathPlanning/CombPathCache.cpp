@@ -0,0 +1,122 @@
+// Copyright (c) 2022 Ultimaker B.V.
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "CombPathCache.h"
+
+namespace cura
+{
+
+namespace
+{
+
+void combine(size_t& result, const size_t value)
+{
+    result ^= value + 0x9e3779b97f4a7c15ull + (result << 6) + (result >> 2);
+}
+
+}
+
+bool CombPathCache::Parameters::operator==(const Parameters& other) const
+{
+    return comb_boundary_offset == other.comb_boundary_offset
+        && travel_avoid_distance == other.travel_avoid_distance
+        && move_inside_distance == other.move_inside_distance;
+}
+
+bool CombPathCache::Travel::operator==(const Travel& other) const
+{
+    return extruder_nr == other.extruder_nr
+        && start == other.start
+        && end == other.end
+        && start_inside == other.start_inside
+        && end_inside == other.end_inside
+        && max_comb_distance_ignored == other.max_comb_distance_ignored;
+}
+
+size_t CombPathCache::Travels::TravelHash::operator()(const Travel& travel) const
+{
+    size_t result = std::hash<size_t>()(travel.extruder_nr);
+    combine(result, std::hash<coord_t>()(travel.start.X));
+    combine(result, std::hash<coord_t>()(travel.start.Y));
+    combine(result, std::hash<coord_t>()(travel.end.X));
+    combine(result, std::hash<coord_t>()(travel.end.Y));
+    combine(result, (travel.start_inside ? 1 : 0) + (travel.end_inside ? 2 : 0));
+    combine(result, std::hash<coord_t>()(travel.max_comb_distance_ignored));
+    return result;
+}
+
+CombPathCache::Travels::Travels(const size_t capacity)
+: capacity(capacity)
+{
+}
+
+std::shared_ptr<const CombPathCache::Result> CombPathCache::Travels::find(const Travel& travel) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto found = travels.find(travel);
+    return found == travels.end() ? nullptr : found->second;
+}
+
+void CombPathCache::Travels::insert(const Travel& travel, std::shared_ptr<const Result> result)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto found = travels.find(travel);
+    if (found != travels.end())
+    {
+        found->second = std::move(result);
+    }
+    else if (travels.size() < capacity)
+    {
+        travels.emplace(travel, std::move(result));
+    }
+}
+
+CombPathCache::CombPathCache(const size_t capacity, const size_t travel_capacity)
+: travel_capacity(travel_capacity)
+, entries(capacity)
+{
+}
+
+std::shared_ptr<CombPathCache::Travels> CombPathCache::getTravels(const Polygons& boundary_minimum, const Polygons& boundary_preferred, const Parameters& parameters)
+{
+    size_t key = hash(boundary_minimum);
+    combine(key, hash(boundary_preferred));
+    combine(key, std::hash<coord_t>()(parameters.comb_boundary_offset));
+    combine(key, std::hash<coord_t>()(parameters.travel_avoid_distance));
+    combine(key, std::hash<coord_t>()(parameters.move_inside_distance));
+    std::shared_ptr<Travels> travels = entries.find(key, [&boundary_minimum, &boundary_preferred, &parameters](const Key& entry_key)
+    {
+        return entry_key.parameters == parameters && entry_key.boundary_minimum.isSame(boundary_minimum) && entry_key.boundary_preferred.isSame(boundary_preferred);
+    });
+    if (travels)
+    {
+        return travels;
+    }
+
+    //If another thread adds the same boundaries meanwhile, both are kept until they are forgotten. Layers that still use forgotten boundaries keep their travels.
+    Key new_key{CompactPolygons(), CompactPolygons(), parameters};
+    if (!new_key.boundary_minimum.compact(boundary_minimum) || !new_key.boundary_preferred.compact(boundary_preferred))
+    {
+        return nullptr;
+    }
+    travels = std::make_shared<Travels>(travel_capacity);
+    entries.insert(key, std::move(new_key), travels);
+    return travels;
+}
+
+size_t CombPathCache::hash(const Polygons& polygons)
+{
+    size_t result = std::hash<size_t>()(polygons.size());
+    for (ConstPolygonRef polygon : polygons)
+    {
+        combine(result, polygon.size());
+        for (const Point& point : polygon)
+        {
+            combine(result, std::hash<coord_t>()(point.X));
+            combine(result, std::hash<coord_t>()(point.Y));
+        }
+    }
+    return result;
+}
+
+} // namespace cura
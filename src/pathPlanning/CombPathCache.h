@@ -0,0 +1,166 @@
+// Copyright (c) 2022 Ultimaker B.V.
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef PATH_PLANNING_COMB_PATH_CACHE_H
+#define PATH_PLANNING_COMB_PATH_CACHE_H
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "CombPaths.h"
+#include "../utils/BoundedCache.h"
+#include "../utils/CompactPolygons.h"
+#include "../utils/polygon.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Remembers the combing of the travels planned so far, so that layers
+ * with the same comb boundaries don't need to comb the same travels again.
+ *
+ * Prismatic models have the same comb boundaries on many layers, and the
+ * travels between their parts start and end at the same places, such as the
+ * seams of the walls. The combing of such a travel only depends on the comb
+ * boundaries and, if it goes around other parts, on the outlines of the layer.
+ * So it can be reused on any layer where those are the same.
+ *
+ * The travels are remembered per set of comb boundaries, see
+ * \ref getTravels . It is safe to use from multiple threads at once.
+ */
+class CombPathCache
+{
+public:
+    /*!
+     * \brief The parameters of the combing that can differ per layer, apart
+     * from the boundaries themselves.
+     */
+    struct Parameters
+    {
+        coord_t comb_boundary_offset;
+        coord_t travel_avoid_distance;
+        coord_t move_inside_distance;
+
+        bool operator==(const Parameters& other) const;
+    };
+
+    /*!
+     * \brief A travel to comb, with everything that the combing depends on
+     * apart from the layer.
+     */
+    struct Travel
+    {
+        size_t extruder_nr;
+        Point start;
+        Point end;
+        bool start_inside;
+        bool end_inside;
+        coord_t max_comb_distance_ignored;
+
+        bool operator==(const Travel& other) const;
+    };
+
+    /*!
+     * \brief The combing that was computed for a travel.
+     */
+    struct Result
+    {
+        bool combed; //!< Whether a comb path was found.
+        CombPaths comb_paths; //!< The comb paths that were found.
+        bool unretract_before_last_travel_move; //!< Whether to unretract before the last move, as decided by the combing.
+        bool uses_outside_boundary; //!< Whether the combing depended on the outlines of the layer, to go around other parts.
+        size_t layer_outlines_hash; //!< The hash of the outlines of the layer, if the combing depended on them.
+        std::shared_ptr<const CompactPolygons> layer_outlines; //!< The outlines of the layer, to compare exactly, if the combing depended on them.
+    };
+
+    /*!
+     * \brief The travels that were combed within one set of comb boundaries.
+     */
+    class Travels
+    {
+    public:
+        /*!
+         * \param capacity The maximum number of travels to remember. When
+         * there are that many, no more are added.
+         */
+        Travels(const size_t capacity);
+
+        /*!
+         * Find the combing that was computed earlier for a travel.
+         * \param travel The travel to comb.
+         * \return The combing, or ``nullptr`` if this travel wasn't combed
+         * before within these boundaries.
+         */
+        std::shared_ptr<const Result> find(const Travel& travel) const;
+
+        /*!
+         * Remember the combing computed for a travel, replacing what was
+         * remembered for it before.
+         * \param travel The travel that was combed.
+         * \param result The combing of the travel.
+         */
+        void insert(const Travel& travel, std::shared_ptr<const Result> result);
+
+    private:
+        /*!
+         * Hash the endpoints and parameters of a travel.
+         */
+        struct TravelHash
+        {
+            size_t operator()(const Travel& travel) const;
+        };
+
+        const size_t capacity; //!< The maximum number of travels.
+        mutable std::mutex mutex; //!< Guards the travels, since several layers with the same boundaries may be planned at once.
+        std::unordered_map<Travel, std::shared_ptr<const Result>, TravelHash> travels; //!< The combing of each travel.
+    };
+
+    /*!
+     * \param capacity The maximum number of sets of comb boundaries to
+     * remember travels for. When more are added, the ones that were added
+     * first are forgotten.
+     * \param travel_capacity The maximum number of travels to remember for
+     * each set of comb boundaries.
+     */
+    CombPathCache(const size_t capacity = 16, const size_t travel_capacity = 4096);
+
+    /*!
+     * \brief Get the travels that were combed within a set of comb
+     * boundaries, to look up and add the travels of a layer with those
+     * boundaries.
+     *
+     * The boundaries are compared exactly, so this is checked only once for
+     * each layer rather than for each travel.
+     * \param boundary_minimum The minimum boundary within which to comb.
+     * \param boundary_preferred The boundary preferably within which to comb.
+     * \param parameters The other parameters that the combing depends on.
+     * \return The travels combed within these boundaries, or ``nullptr`` if
+     * the boundaries are too large to remember.
+     */
+    std::shared_ptr<Travels> getTravels(const Polygons& boundary_minimum, const Polygons& boundary_preferred, const Parameters& parameters);
+
+    /*!
+     * Hash the content of a set of polygons.
+     */
+    static size_t hash(const Polygons& polygons);
+
+private:
+    /*!
+     * \brief The comb boundaries that travels were combed within, to compare
+     * with the boundaries that are looked up.
+     */
+    struct Key
+    {
+        CompactPolygons boundary_minimum;
+        CompactPolygons boundary_preferred;
+        Parameters parameters;
+    };
+
+    const size_t travel_capacity; //!< The maximum number of travels per entry.
+    BoundedCache<Key, std::shared_ptr<Travels>> entries; //!< The known comb boundaries.
+};
+
+} // namespace cura
+
+#endif // PATH_PLANNING_COMB_PATH_CACHE_H
@@ -6,7 +6,7 @@
 
 namespace cura
 {
-GCodePath::GCodePath(const GCodePathConfig& config, std::string mesh_id, const SpaceFillType space_fill_type, const Ratio flow, const Ratio width_factor, const bool spiralize, const Ratio speed_factor) :
+GCodePath::GCodePath(const GCodePathConfig& config, std::string mesh_id, const SpaceFillType space_fill_type, const Ratio flow, const Ratio width_factor, const bool spiralize, const Ratio speed_factor, std::shared_ptr<PathPointArena> point_arena) :
 config(&config),
 mesh_id(mesh_id),
 space_fill_type(space_fill_type),
@@ -19,7 +19,7 @@ unretract_before_last_travel_move(false),
 perform_z_hop(false),
 perform_prime(false),
 skip_agressive_merge_hint(false),
-points(std::vector<Point>()),
+points(std::move(point_arena)),
 done(false),
 spiralize(spiralize),
 fan_speed(GCodePathConfig::FAN_SPEED_DEFAULT),
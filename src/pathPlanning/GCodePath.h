@@ -8,6 +8,7 @@
 #include "../settings/types/Ratio.h"
 #include "../utils/IntPoint.h"
 
+#include "GCodePathPoints.h"
 #include "TimeMaterialEstimates.h"
 
 namespace cura 
@@ -40,7 +41,7 @@ public:
     bool perform_z_hop; //!< Whether to perform a z_hop in this path, which is assumed to be a travel path.
     bool perform_prime; //!< Whether this path is preceded by a prime (blob)
     bool skip_agressive_merge_hint; //!< Wheter this path needs to skip merging if any travel paths are in between the extrusions.
-    std::vector<Point> points; //!< The points constituting this path.
+    GCodePathPoints points; //!< The points constituting this path.
     bool done; //!< Path is finished, no more moves should be added, and a new path should be started instead of any appending done to this one.
 
     bool spiralize; //!< Whether to gradually increment the z position during the printing of this path. A sequence of spiralized paths should start at the given layer height and end in one layer higher.
@@ -61,8 +62,10 @@ public:
      * \param spiralize Gradually increment the z-coordinate while traversing
      * \param speed_factor The factor that the travel speed will be multiplied with
      * this path.
+     * \param point_arena Where to store the points of the path. If not given,
+     * the path gets storage of its own.
      */
-    GCodePath(const GCodePathConfig& config, std::string mesh_id, const SpaceFillType space_fill_type, const Ratio flow, const Ratio width_factor, const bool spiralize, const Ratio speed_factor = 1.0);
+    GCodePath(const GCodePathConfig& config, std::string mesh_id, const SpaceFillType space_fill_type, const Ratio flow, const Ratio width_factor, const bool spiralize, const Ratio speed_factor = 1.0, std::shared_ptr<PathPointArena> point_arena = nullptr);
 
     /*!
      * Whether this config is the config of a travel path.
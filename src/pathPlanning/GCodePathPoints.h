@@ -0,0 +1,179 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef PATH_PLANNING_G_CODE_PATH_POINTS_H
+#define PATH_PLANNING_G_CODE_PATH_POINTS_H
+
+#include <algorithm> //For std::copy.
+#include <initializer_list>
+#include <memory> //For shared_ptr.
+#include <vector>
+
+#include "../utils/IntPoint.h"
+
+namespace cura
+{
+
+/*!
+ * The points of all paths of a layer plan, stored contiguously.
+ *
+ * Every path refers to a range in this buffer, so that planning a layer
+ * doesn't need a separate allocation for each path.
+ */
+using PathPointArena = std::vector<Point>;
+
+/*!
+ * \brief The points of a \ref GCodePath, stored as a range in a
+ * \ref PathPointArena.
+ *
+ * This has the interface of a vector of points, as far as paths use it.
+ *
+ * Normally only the most recently created path of a layer plan gets extended,
+ * so its points are appended to the end of the arena. If a path gets extended
+ * while other paths were extended after it, its points are moved to the end of
+ * the arena first. The space they took stays unused until the arena is
+ * released.
+ *
+ * Adding points to any path that shares the arena invalidates references to
+ * the points of all those paths, not just of this path.
+ *
+ * Copies of a path refer to the same points. Adding points to one of the
+ * copies doesn't change the other, but changing an existing point does.
+ */
+class GCodePathPoints
+{
+public:
+    using iterator = Point*;
+    using const_iterator = const Point*;
+
+    /*!
+     * Create an empty range of points.
+     * \param arena The arena to store the points in. If it's not given, the
+     * points get an arena of their own.
+     */
+    GCodePathPoints(std::shared_ptr<PathPointArena> arena = nullptr)
+    : arena(arena ? std::move(arena) : std::make_shared<PathPointArena>())
+    , start(this->arena->size())
+    , count(0)
+    {
+    }
+
+    /*!
+     * Replace the points with a list of new points.
+     */
+    GCodePathPoints& operator=(std::initializer_list<Point> new_points)
+    {
+        start = arena->size();
+        arena->insert(arena->end(), new_points.begin(), new_points.end());
+        count = new_points.size();
+        return *this;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    Point& operator[](const size_t index)
+    {
+        return (*arena)[start + index];
+    }
+
+    const Point& operator[](const size_t index) const
+    {
+        return (*arena)[start + index];
+    }
+
+    Point& front()
+    {
+        return (*this)[0];
+    }
+
+    const Point& front() const
+    {
+        return (*this)[0];
+    }
+
+    Point& back()
+    {
+        return (*this)[count - 1];
+    }
+
+    const Point& back() const
+    {
+        return (*this)[count - 1];
+    }
+
+    iterator begin()
+    {
+        return arena->data() + start;
+    }
+
+    iterator end()
+    {
+        return begin() + count;
+    }
+
+    const_iterator begin() const
+    {
+        return arena->data() + start;
+    }
+
+    const_iterator end() const
+    {
+        return begin() + count;
+    }
+
+    /*!
+     * Add a point at the end.
+     */
+    void push_back(const Point& point)
+    {
+        if (start + count != arena->size()) //Another range was extended after this one. Move ours to the end so that it can grow.
+        {
+            const size_t new_start = arena->size();
+            arena->resize(new_start + count);
+            std::copy(arena->begin() + start, arena->begin() + start + count, arena->begin() + new_start);
+            start = new_start;
+        }
+        arena->push_back(point);
+        count++;
+    }
+
+    /*!
+     * Insert points in front of the point at a certain index.
+     *
+     * The range is moved to the end of the arena with the new points in it.
+     * \param index Where to insert the points. This may be the size of the
+     * range, to add the points at the end.
+     * \param new_points The points to insert.
+     */
+    void insert(const size_t index, const std::vector<Point>& new_points)
+    {
+        if (new_points.empty())
+        {
+            return;
+        }
+        const size_t new_start = arena->size();
+        arena->resize(new_start + count + new_points.size());
+        std::vector<Point>::iterator inserted = std::copy(arena->begin() + start, arena->begin() + start + index, arena->begin() + new_start);
+        inserted = std::copy(new_points.begin(), new_points.end(), inserted);
+        std::copy(arena->begin() + start + index, arena->begin() + start + count, inserted);
+        start = new_start;
+        count += new_points.size();
+    }
+
+private:
+    std::shared_ptr<PathPointArena> arena; //!< Where the points are stored.
+    size_t start; //!< Where in the arena the first point is.
+    size_t count; //!< How many points there are.
+};
+
+} //namespace cura
+
+#endif //PATH_PLANNING_G_CODE_PATH_POINTS_H
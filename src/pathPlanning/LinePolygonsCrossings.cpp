@@ -4,6 +4,7 @@
 #include "LinePolygonsCrossings.h"
 
 #include <algorithm>
+#include <cassert>
 
 #include "../sliceDataStorage.h"
 #include "../utils/SVG.h"
@@ -19,7 +20,7 @@ LinePolygonsCrossings::Crossing::Crossing(const size_t poly_idx, const coord_t x
 
 bool LinePolygonsCrossings::calcScanlineCrossings(bool fail_on_unavoidable_obstacles)
 {
-    for(unsigned int poly_idx = 0; poly_idx < boundary.size(); poly_idx++)
+    for (const size_t poly_idx : nearby_poly_indices)
     {
         ConstPolygonRef poly = boundary[poly_idx];
         Point p0 = transformation_matrix.apply(poly[poly.size() - 1]);
@@ -58,6 +59,19 @@ bool LinePolygonsCrossings::calcScanlineCrossings(bool fail_on_unavoidable_obsta
 }
 
 
+void LinePolygonsCrossings::findPolygonsNearScanline()
+{
+    nearby_poly_indices.clear();
+    loc_to_line_grid.processLine(std::make_pair(startPoint, endPoint), [this](const PolygonsPointIndex& line_start)
+    {
+        assert(line_start.polygons == &boundary && "The grid must be made from the boundary itself, or the polygon indices don't match.");
+        nearby_poly_indices.push_back(line_start.poly_idx);
+        return true;
+    });
+    std::sort(nearby_poly_indices.begin(), nearby_poly_indices.end()); //Keep the original order of the polygons, so that the crossings are found in the same order too.
+    nearby_poly_indices.erase(std::unique(nearby_poly_indices.begin(), nearby_poly_indices.end()), nearby_poly_indices.end());
+}
+
 bool LinePolygonsCrossings::lineSegmentCollidesWithBoundary()
 {
     Point diff = endPoint - startPoint;
@@ -66,8 +80,10 @@ bool LinePolygonsCrossings::lineSegmentCollidesWithBoundary()
     transformed_startPoint = transformation_matrix.apply(startPoint);
     transformed_endPoint = transformation_matrix.apply(endPoint);
 
-    for(ConstPolygonRef poly : boundary)
+    findPolygonsNearScanline();
+    for (const size_t poly_idx : nearby_poly_indices)
     {
+        ConstPolygonRef poly = boundary[poly_idx];
         Point p0 = transformation_matrix.apply(poly.back());
         for(Point p1_ : poly)
         {
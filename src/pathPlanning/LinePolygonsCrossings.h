@@ -47,6 +47,7 @@ private:
     };
     
     std::vector<Crossing> crossings; //!< All crossings of polygons in the LinePolygonsCrossings::boundary with the scanline.
+    std::vector<size_t> nearby_poly_indices; //!< The indices of the polygons in LinePolygonsCrossings::boundary which have line segments in grid cells along the scanline, in increasing order.
     
     const Polygons& boundary; //!< The boundary not to cross during combing.
     LocToLineGrid& loc_to_line_grid; //!< Mapping from locations to line segments of \ref LinePolygonsCrossings::boundary
@@ -60,10 +61,19 @@ private:
     Point transformed_endPoint; //!< The LinePolygonsCrossings::endPoint as transformed by Comb::transformation_matrix such that it has (roughly) the same Y as transformed_startPoint
 
     
+    /*!
+     * Find the polygons which may cross the scanline, using the
+     * LinePolygonsCrossings::loc_to_line_grid. Other polygons can't cross it,
+     * so they don't need to be checked.
+     *
+     * Sets LinePolygonsCrossings::nearby_poly_indices.
+     */
+    void findPolygonsNearScanline();
+
     /*!
      * Check if we are crossing the boundaries, and pre-calculate some values.
      * 
-     * Sets Comb::transformation_matrix, Comb::transformed_startPoint and Comb::transformed_endPoint
+     * Sets Comb::transformation_matrix, Comb::transformed_startPoint, Comb::transformed_endPoint and LinePolygonsCrossings::nearby_poly_indices
      * \return Whether the line segment from LinePolygonsCrossings::startPoint to LinePolygonsCrossings::endPoint collides with the boundary
      */
     bool lineSegmentCollidesWithBoundary();
@@ -136,7 +146,7 @@ public:
     /*!
      * The main function of this class: calculate one combing path within the boundary.
      * \param boundary The polygons to follow when calculating the basic combing path
-     * \param loc_to_line_grid A sparse grid mapping cells to all line segments of (at least) \p boundary in those cells
+     * \param loc_to_line_grid A sparse grid mapping cells to all line segments of \p boundary in those cells. It must be made from the same \p boundary instance.
      * \param startPoint From where to start the combing move.
      * \param endPoint Where to end the combing move.
      * \param combPath Output parameter: the combing path generated.
@@ -1,13 +1,18 @@
 //Copyright (c) 2018 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For std::min and std::fill.
 #include <cassert>
+#ifdef _OPENMP
+    #include <omp.h> //To get the number of threads for the utilisation.
+#endif // _OPENMP
 
 #include "Progress.h"
 #include "../Application.h" //To get the communication channel to send progress through.
 #include "../communication/Communication.h" //To send progress through the communication channel.
 #include "../utils/gettime.h"
 #include "../utils/logoutput.h"
+#include "../utils/MemoryUsage.h" //To log the peak memory use after each stage.
 
 namespace cura {
     
@@ -34,6 +39,11 @@ std::string Progress::names [] =
 
 double Progress::accumulated_times [N_PROGRESS_STAGES] = {-1};
 double Progress::total_timing = -1;
+Progress::StageStatistics Progress::stage_statistics[N_PROGRESS_STAGES];
+Progress::Stage Progress::current_stage = Progress::Stage::START;
+double Progress::current_stage_start_time = 0.0;
+double Progress::mesh_group_start_time = 0.0;
+double Progress::mesh_group_start_processor_time = 0.0;
 
 float Progress::calcOverallProgress(Stage stage, float stage_progress)
 {
@@ -56,6 +66,10 @@ void Progress::init()
 
 void Progress::messageProgress(Progress::Stage stage, int progress_in_stage, int progress_in_stage_max)
 {
+    StageStatistics& statistics = stage_statistics[(int)stage];
+    statistics.done = progress_in_stage;
+    statistics.total = progress_in_stage_max;
+
     float percentage = calcOverallProgress(stage, float(progress_in_stage) / float(progress_in_stage_max));
     Application::getInstance().communication->sendProgress(percentage);
 
@@ -64,11 +78,26 @@ void Progress::messageProgress(Progress::Stage stage, int progress_in_stage, int
 
 void Progress::messageProgressStage(Progress::Stage stage, TimeKeeper* time_keeper)
 {
+    const double now = getTime();
+    if (stage == Stage::SLICING) //A new mesh group starts.
+    {
+        std::fill(stage_statistics, stage_statistics + N_PROGRESS_STAGES, StageStatistics());
+        mesh_group_start_time = now;
+        mesh_group_start_processor_time = getProcessorTime();
+    }
+    else if (stage_statistics[(int)current_stage].started)
+    {
+        stage_statistics[(int)current_stage].time += now - current_stage_start_time;
+    }
+    current_stage = stage;
+    current_stage_start_time = now;
+    stage_statistics[(int)stage].started = true;
+
     if (time_keeper)
     {
         if ((int)stage > 0)
         {
-            log("Progress: %s accomplished in %5.3fs\n", names[(int)stage - 1].c_str(), time_keeper->restart());
+            log("Progress: %s accomplished in %5.3fs, peak memory use %.1fMB\n", names[(int)stage - 1].c_str(), time_keeper->restart(), getPeakMemoryUsage() / (1024.0 * 1024.0));
         }
         else
         {
@@ -82,4 +111,35 @@ void Progress::messageProgressStage(Progress::Stage stage, TimeKeeper* time_keep
     }
 }
 
+const std::string& Progress::getStageName(Progress::Stage stage)
+{
+    return names[(int)stage];
+}
+
+Progress::StageStatistics Progress::getStageStatistics(Progress::Stage stage)
+{
+    StageStatistics statistics = stage_statistics[(int)stage];
+    if (stage == current_stage && statistics.started)
+    {
+        statistics.time += getTime() - current_stage_start_time;
+    }
+    return statistics;
+}
+
+double Progress::getThreadUtilisation()
+{
+    const double wall_time = getTime() - mesh_group_start_time;
+    if (wall_time <= 0.0 || mesh_group_start_time == 0.0)
+    {
+        return 0.0;
+    }
+#ifdef _OPENMP
+    const int thread_count = omp_get_max_threads();
+#else
+    constexpr int thread_count = 1;
+#endif // _OPENMP
+    const double processor_time = getProcessorTime() - mesh_group_start_processor_time;
+    return std::min(1.0, processor_time / (wall_time * thread_count));
+}
+
 }// namespace cura
\ No newline at end of file
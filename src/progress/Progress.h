@@ -35,11 +35,28 @@ public:
         EXPORT  = 5, 
         FINISH  = 6
     };
+
+    /*!
+     * How far a stage of the current mesh group has come, to report it to the
+     * front-end.
+     */
+    struct StageStatistics
+    {
+        double time = 0.0; //!< Seconds spent in the stage so far.
+        int done = 0; //!< How many layers (or meshes, depending on the stage) are done.
+        int total = 0; //!< How many layers (or meshes) the stage has to do.
+        bool started = false; //!< Whether the stage has started yet.
+    };
 private:
     static double times [N_PROGRESS_STAGES]; //!< Time estimates per stage
     static std::string names[N_PROGRESS_STAGES]; //!< name of each stage
     static double accumulated_times [N_PROGRESS_STAGES]; //!< Time past before each stage
     static double total_timing; //!< An estimate of the total time
+    static StageStatistics stage_statistics[N_PROGRESS_STAGES]; //!< How far each stage of the current mesh group has come.
+    static Stage current_stage; //!< The stage that is running now.
+    static double current_stage_start_time; //!< When the current stage started, as given by \ref getTime.
+    static double mesh_group_start_time; //!< When the current mesh group started slicing.
+    static double mesh_group_start_processor_time; //!< The processor time used by then, as given by \ref getProcessorTime.
     /*!
      * Give an estimate between 0 and 1 of how far the process is.
      * 
@@ -65,6 +82,27 @@ public:
      * \param timeKeeper The stapwatch keeping track of the timings for each stage (optional)
      */
     static void messageProgressStage(Stage stage, TimeKeeper* timeKeeper);
+
+    /*!
+     * Get the name of a stage, as it's shown in the log.
+     */
+    static const std::string& getStageName(Stage stage);
+
+    /*!
+     * Get how far a stage of the current mesh group has come.
+     *
+     * The time of the running stage includes the time spent in it up to now.
+     * \param stage The stage to get the statistics of.
+     */
+    static StageStatistics getStageStatistics(Stage stage);
+
+    /*!
+     * Estimate how well the threads were kept busy since the current mesh group
+     * started slicing: the processor time used per second, divided by the
+     * number of threads.
+     * \return A ratio between 0 and 1, or 0 if nothing was timed yet.
+     */
+    static double getThreadUtilisation();
 };
 
 
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <numeric> //For std::iota.
 
 #include "AdaptiveLayerHeights.h"
 #include "EnumSettings.h"
@@ -62,7 +63,6 @@ void AdaptiveLayerHeights::calculateLayers()
     const coord_t minimum_layer_height = *std::min_element(allowed_layer_heights.begin(), allowed_layer_heights.end());
     Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
     SlicingTolerance slicing_tolerance = mesh_group_settings.get<SlicingTolerance>("slicing_tolerance");
-    std::vector<size_t> triangles_of_interest;
     coord_t z_level = 0;
     coord_t previous_layer_height = 0;
 
@@ -75,9 +75,37 @@ void AdaptiveLayerHeights::calculateLayers()
     previous_layer_height = adaptive_layer.layer_height;
     layers.push_back(adaptive_layer);
 
+    // The triangles that intersect with a potential layer are those that reach above the bottom of the layer and start below its top.
+    // Go through the triangles from low to high once, keeping track of those that may still intersect the next layer (sorted by their bottom).
+    // For a thinner layer, the triangles of interest are then the part of those that start below its top.
+    std::vector<size_t> faces_by_min_z(face_min_z_values.size());
+    std::iota(faces_by_min_z.begin(), faces_by_min_z.end(), 0);
+    std::stable_sort(faces_by_min_z.begin(), faces_by_min_z.end(), [this](const size_t a, const size_t b) { return face_min_z_values[a] < face_min_z_values[b]; });
+    size_t next_face = 0; // The first face in faces_by_min_z that wasn't considered yet.
+    std::vector<size_t> candidate_faces; // The faces that start below the top of the thickest potential layer and end above its bottom, sorted by their bottom.
+    std::vector<double> candidate_min_slopes; // For each candidate face, the minimum slope of it and all candidates before it.
+    size_t triangles_of_interest_count = 0;
+
     // loop while triangles are found
-    while (!triangles_of_interest.empty() || layers.size() < 2)
+    while (triangles_of_interest_count > 0 || layers.size() < 2)
     {
+        // find the triangles that a layer of the maximum thickness intersects with
+        const coord_t lower_bound = z_level;
+        const coord_t max_upper_bound = z_level + ((slicing_tolerance == SlicingTolerance::MIDDLE) ? (allowed_layer_heights[0] / 2) : allowed_layer_heights[0]);
+        candidate_faces.erase(std::remove_if(candidate_faces.begin(), candidate_faces.end(), [this, lower_bound](const size_t face) { return face_max_z_values[face] < lower_bound; }), candidate_faces.end());
+        for (; next_face < faces_by_min_z.size() && face_min_z_values[faces_by_min_z[next_face]] <= max_upper_bound; next_face++)
+        {
+            if (face_max_z_values[faces_by_min_z[next_face]] >= lower_bound)
+            {
+                candidate_faces.push_back(faces_by_min_z[next_face]);
+            }
+        }
+        candidate_min_slopes.resize(candidate_faces.size());
+        for (size_t i = 0; i < candidate_faces.size(); i++)
+        {
+            candidate_min_slopes[i] = std::min(face_slopes[candidate_faces[i]], (i > 0) ? candidate_min_slopes[i - 1] : std::numeric_limits<double>::max());
+        }
+
         double global_min_slope = std::numeric_limits<double>::max();
         int layer_height_for_global_min_slope = 0;
         // loop over all allowed layer heights starting with the largest
@@ -85,57 +113,18 @@ void AdaptiveLayerHeights::calculateLayers()
         for (auto & layer_height : allowed_layer_heights)
         {
             // use lower and upper bounds to filter on triangles that are interesting for this potential layer
-            const coord_t lower_bound = z_level;
             // if slicing tolerance "middle" is used, a layer is interpreted as the middle of the upper and lower bounds.
             const coord_t upper_bound = z_level + ((slicing_tolerance == SlicingTolerance::MIDDLE) ? (layer_height / 2) : layer_height);
-
-            if (layer_height == allowed_layer_heights[0])
-            {
-                // this is the max layer thickness, search through all of the triangles in the mesh to find those
-                // that intersect with a layer this thick
-                triangles_of_interest.clear();
-
-                for (size_t i = 0; i < face_min_z_values.size(); ++i)
-                {
-                    if (face_min_z_values[i] <= upper_bound && face_max_z_values[i] >= lower_bound)
-                    {
-                        triangles_of_interest.push_back(i);
-                    }
-                }
-            }
-            else
-            {
-                // this is a reduced thickness layer, just search those triangles that intersected with the layer
-                // in the previous iteration
-                std::vector<size_t> last_triangles_of_interest = triangles_of_interest;
-
-                triangles_of_interest.clear();
-
-                for (size_t i : last_triangles_of_interest)
-                {
-                    if (face_min_z_values[i] <= upper_bound)
-                    {
-                        triangles_of_interest.push_back(i);
-                    }
-                }
-            }
+            triangles_of_interest_count = std::upper_bound(candidate_faces.begin(), candidate_faces.end(), upper_bound, [this](const coord_t z, const size_t face) { return z < face_min_z_values[face]; }) - candidate_faces.begin();
 
             // when there not interesting triangles in this potential layer go to the next one
-            if (triangles_of_interest.empty())
+            if (triangles_of_interest_count == 0)
             {
                 break;
             }
 
             // find the minimum slope of all the interesting triangles
-            double minimum_slope = std::numeric_limits<double>::max();
-            for (const size_t& triangle_index : triangles_of_interest)
-            {
-                const double slope = face_slopes.at(triangle_index);
-                if (minimum_slope > slope)
-                {
-                    minimum_slope = slope;
-                }
-            }
+            const double minimum_slope = candidate_min_slopes[triangles_of_interest_count - 1];
             if (global_min_slope > minimum_slope)
             {
                 global_min_slope = minimum_slope;
@@ -174,7 +163,7 @@ void AdaptiveLayerHeights::calculateLayers()
         }
 
         // stop calculating when we're out of triangles (e.g. above the mesh)
-        if (triangles_of_interest.empty())
+        if (triangles_of_interest_count == 0)
         {
             break;
         }
@@ -193,7 +182,10 @@ void AdaptiveLayerHeights::calculateLayers()
 
 void AdaptiveLayerHeights::calculateMeshTriangleSlopes()
 {
-    // loop over all mesh faces (triangles) and find their slopes
+    // find out where the faces of each printable mesh go, so that the faces can be processed in parallel
+    std::vector<const Mesh*> printable_meshes;
+    std::vector<size_t> mesh_face_starts;
+    size_t face_count = 0;
     for (const Mesh& mesh : Application::getInstance().current_slice->scene.current_mesh_group->meshes)
     {
         // Skip meshes that are not printable
@@ -201,9 +193,24 @@ void AdaptiveLayerHeights::calculateMeshTriangleSlopes()
         {
             continue;
         }
+        printable_meshes.push_back(&mesh);
+        mesh_face_starts.push_back(face_count);
+        face_count += mesh.faces.size();
+    }
+    face_min_z_values.resize(face_count);
+    face_max_z_values.resize(face_count);
+    face_slopes.resize(face_count);
 
-        for (const MeshFace& face : mesh.faces)
+    // loop over all mesh faces (triangles) and find their slopes
+    for (size_t mesh_idx = 0; mesh_idx < printable_meshes.size(); mesh_idx++)
+    {
+        const Mesh& mesh = *printable_meshes[mesh_idx];
+        const size_t face_start = mesh_face_starts[mesh_idx];
+#pragma omp parallel for default(none) shared(mesh) firstprivate(face_start) schedule(static)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int face_idx = 0; face_idx < static_cast<int>(mesh.faces.size()); face_idx++)
         {
+            const MeshFace& face = mesh.faces[face_idx];
             const MeshVertex& v0 = mesh.vertices[face.vertex_index[0]];
             const MeshVertex& v1 = mesh.vertices[face.vertex_index[1]];
             const MeshVertex& v2 = mesh.vertices[face.vertex_index[2]];
@@ -230,9 +237,9 @@ void AdaptiveLayerHeights::calculateMeshTriangleSlopes()
                 z_angle = M_PI;
             }
 
-            face_min_z_values.push_back(MM2INT(min_z));
-            face_max_z_values.push_back(MM2INT(max_z));
-            face_slopes.push_back(z_angle);
+            face_min_z_values[face_start + face_idx] = MM2INT(min_z);
+            face_max_z_values[face_start + face_idx] = MM2INT(max_z);
+            face_slopes[face_start + face_idx] = z_angle;
         }
     }
 }
@@ -31,86 +31,192 @@ std::vector<Ratio> PathConfigStorage::getLineWidthFactorPerExtruder(const LayerI
     return ret;
 }
 
+//Handles for the settings used to create the path configs, which happens for every layer.
+static const SettingKey<coord_t> wall_line_width_0_key("wall_line_width_0");
+static const SettingKey<ExtruderTrain&> wall_0_extruder_nr_key("wall_0_extruder_nr");
+static const SettingKey<Ratio> wall_0_material_flow_key("wall_0_material_flow");
+static const SettingKey<Ratio> material_flow_layer_0_key("material_flow_layer_0");
+static const SettingKey<Velocity> speed_wall_0_key("speed_wall_0");
+static const SettingKey<Acceleration> acceleration_wall_0_key("acceleration_wall_0");
+static const SettingKey<Velocity> jerk_wall_0_key("jerk_wall_0");
+static const SettingKey<coord_t> wall_line_width_x_key("wall_line_width_x");
+static const SettingKey<ExtruderTrain&> wall_x_extruder_nr_key("wall_x_extruder_nr");
+static const SettingKey<Ratio> wall_x_material_flow_key("wall_x_material_flow");
+static const SettingKey<Velocity> speed_wall_x_key("speed_wall_x");
+static const SettingKey<Acceleration> acceleration_wall_x_key("acceleration_wall_x");
+static const SettingKey<Velocity> jerk_wall_x_key("jerk_wall_x");
+static const SettingKey<Ratio> bridge_wall_material_flow_key("bridge_wall_material_flow");
+static const SettingKey<Velocity> bridge_wall_speed_key("bridge_wall_speed");
+static const SettingKey<Ratio> bridge_fan_speed_key("bridge_fan_speed");
+static const SettingKey<coord_t> skin_line_width_key("skin_line_width");
+static const SettingKey<ExtruderTrain&> top_bottom_extruder_nr_key("top_bottom_extruder_nr");
+static const SettingKey<Ratio> skin_material_flow_key("skin_material_flow");
+static const SettingKey<Velocity> speed_topbottom_key("speed_topbottom");
+static const SettingKey<Acceleration> acceleration_topbottom_key("acceleration_topbottom");
+static const SettingKey<Velocity> jerk_topbottom_key("jerk_topbottom");
+static const SettingKey<Ratio> bridge_skin_material_flow_key("bridge_skin_material_flow");
+static const SettingKey<Velocity> bridge_skin_speed_key("bridge_skin_speed");
+static const SettingKey<Ratio> bridge_skin_material_flow_2_key("bridge_skin_material_flow_2");
+static const SettingKey<Velocity> bridge_skin_speed_2_key("bridge_skin_speed_2");
+static const SettingKey<Ratio> bridge_fan_speed_2_key("bridge_fan_speed_2");
+static const SettingKey<Ratio> bridge_skin_material_flow_3_key("bridge_skin_material_flow_3");
+static const SettingKey<Velocity> bridge_skin_speed_3_key("bridge_skin_speed_3");
+static const SettingKey<Ratio> bridge_fan_speed_3_key("bridge_fan_speed_3");
+static const SettingKey<coord_t> roofing_line_width_key("roofing_line_width");
+static const SettingKey<Ratio> roofing_material_flow_key("roofing_material_flow");
+static const SettingKey<Velocity> speed_roofing_key("speed_roofing");
+static const SettingKey<Acceleration> acceleration_roofing_key("acceleration_roofing");
+static const SettingKey<Velocity> jerk_roofing_key("jerk_roofing");
+static const SettingKey<coord_t> ironing_line_spacing_key("ironing_line_spacing");
+static const SettingKey<Ratio> ironing_flow_key("ironing_flow");
+static const SettingKey<Velocity> speed_ironing_key("speed_ironing");
+static const SettingKey<Acceleration> acceleration_ironing_key("acceleration_ironing");
+static const SettingKey<Velocity> jerk_ironing_key("jerk_ironing");
+static const SettingKey<coord_t> infill_line_width_key("infill_line_width");
+static const SettingKey<ExtruderTrain&> infill_extruder_nr_key("infill_extruder_nr");
+static const SettingKey<Ratio> infill_material_flow_key("infill_material_flow");
+static const SettingKey<Velocity> speed_infill_key("speed_infill");
+static const SettingKey<Acceleration> acceleration_infill_key("acceleration_infill");
+static const SettingKey<Velocity> jerk_infill_key("jerk_infill");
+static const SettingKey<ExtruderTrain&> support_infill_extruder_nr_key("support_infill_extruder_nr");
+static const SettingKey<ExtruderTrain&> support_roof_extruder_nr_key("support_roof_extruder_nr");
+static const SettingKey<ExtruderTrain&> support_bottom_extruder_nr_key("support_bottom_extruder_nr");
+static const SettingKey<ExtruderTrain&> skirt_brim_extruder_nr_key("skirt_brim_extruder_nr");
+static const SettingKey<ExtruderTrain&> raft_base_extruder_nr_key("raft_base_extruder_nr");
+static const SettingKey<ExtruderTrain&> raft_interface_extruder_nr_key("raft_interface_extruder_nr");
+static const SettingKey<ExtruderTrain&> raft_surface_extruder_nr_key("raft_surface_extruder_nr");
+static const SettingKey<coord_t> raft_base_line_width_key("raft_base_line_width");
+static const SettingKey<coord_t> raft_base_thickness_key("raft_base_thickness");
+static const SettingKey<Velocity> raft_base_speed_key("raft_base_speed");
+static const SettingKey<Acceleration> raft_base_acceleration_key("raft_base_acceleration");
+static const SettingKey<Velocity> raft_base_jerk_key("raft_base_jerk");
+static const SettingKey<coord_t> raft_interface_line_width_key("raft_interface_line_width");
+static const SettingKey<coord_t> raft_interface_thickness_key("raft_interface_thickness");
+static const SettingKey<Velocity> raft_interface_speed_key("raft_interface_speed");
+static const SettingKey<Acceleration> raft_interface_acceleration_key("raft_interface_acceleration");
+static const SettingKey<Velocity> raft_interface_jerk_key("raft_interface_jerk");
+static const SettingKey<coord_t> raft_surface_line_width_key("raft_surface_line_width");
+static const SettingKey<coord_t> raft_surface_thickness_key("raft_surface_thickness");
+static const SettingKey<Velocity> raft_surface_speed_key("raft_surface_speed");
+static const SettingKey<Acceleration> raft_surface_acceleration_key("raft_surface_acceleration");
+static const SettingKey<Velocity> raft_surface_jerk_key("raft_surface_jerk");
+static const SettingKey<coord_t> support_roof_line_width_key("support_roof_line_width");
+static const SettingKey<Ratio> support_roof_material_flow_key("support_roof_material_flow");
+static const SettingKey<Velocity> speed_support_roof_key("speed_support_roof");
+static const SettingKey<Acceleration> acceleration_support_roof_key("acceleration_support_roof");
+static const SettingKey<Velocity> jerk_support_roof_key("jerk_support_roof");
+static const SettingKey<coord_t> support_bottom_line_width_key("support_bottom_line_width");
+static const SettingKey<Ratio> support_bottom_material_flow_key("support_bottom_material_flow");
+static const SettingKey<Velocity> speed_support_bottom_key("speed_support_bottom");
+static const SettingKey<Acceleration> acceleration_support_bottom_key("acceleration_support_bottom");
+static const SettingKey<Velocity> jerk_support_bottom_key("jerk_support_bottom");
+static const SettingKey<Velocity> speed_travel_key("speed_travel");
+static const SettingKey<Acceleration> acceleration_travel_key("acceleration_travel");
+static const SettingKey<Velocity> jerk_travel_key("jerk_travel");
+static const SettingKey<coord_t> skirt_brim_line_width_key("skirt_brim_line_width");
+static const SettingKey<EPlatformAdhesion> adhesion_type_key("adhesion_type");
+static const SettingKey<Ratio> skirt_brim_material_flow_key("skirt_brim_material_flow");
+static const SettingKey<Velocity> skirt_brim_speed_key("skirt_brim_speed");
+static const SettingKey<Acceleration> acceleration_skirt_brim_key("acceleration_skirt_brim");
+static const SettingKey<Velocity> jerk_skirt_brim_key("jerk_skirt_brim");
+static const SettingKey<coord_t> prime_tower_line_width_key("prime_tower_line_width");
+static const SettingKey<Ratio> prime_tower_flow_key("prime_tower_flow");
+static const SettingKey<Velocity> speed_prime_tower_key("speed_prime_tower");
+static const SettingKey<Acceleration> acceleration_prime_tower_key("acceleration_prime_tower");
+static const SettingKey<Velocity> jerk_prime_tower_key("jerk_prime_tower");
+static const SettingKey<coord_t> support_line_width_key("support_line_width");
+static const SettingKey<Ratio> support_material_flow_key("support_material_flow");
+static const SettingKey<Velocity> speed_support_infill_key("speed_support_infill");
+static const SettingKey<Acceleration> acceleration_support_infill_key("acceleration_support_infill");
+static const SettingKey<Velocity> jerk_support_infill_key("jerk_support_infill");
+static const SettingKey<size_t> speed_slowdown_layers_key("speed_slowdown_layers");
+static const SettingKey<Velocity> speed_print_layer_0_key("speed_print_layer_0");
+static const SettingKey<Acceleration> acceleration_print_layer_0_key("acceleration_print_layer_0");
+static const SettingKey<Velocity> jerk_print_layer_0_key("jerk_print_layer_0");
+static const SettingKey<Velocity> speed_travel_layer_0_key("speed_travel_layer_0");
+static const SettingKey<Acceleration> acceleration_travel_layer_0_key("acceleration_travel_layer_0");
+static const SettingKey<Velocity> jerk_travel_layer_0_key("jerk_travel_layer_0");
+
 PathConfigStorage::MeshPathConfigs::MeshPathConfigs(const SliceMeshStorage& mesh, const coord_t layer_thickness, const LayerIndex& layer_nr, const std::vector<Ratio>& line_width_factor_per_extruder)
 : inset0_config(
     PrintFeatureType::OuterWall
-    , mesh.settings.get<coord_t>("wall_line_width_0") * line_width_factor_per_extruder[mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr]
+    , mesh.settings.get(wall_line_width_0_key) * line_width_factor_per_extruder[mesh.settings.get(wall_0_extruder_nr_key).extruder_nr]
     , layer_thickness
-    , mesh.settings.get<Ratio>("wall_0_material_flow") * ((layer_nr == 0) ? mesh.settings.get<Ratio>("material_flow_layer_0") : Ratio(1.0))
-    , GCodePathConfig::SpeedDerivatives{mesh.settings.get<Velocity>("speed_wall_0"), mesh.settings.get<Acceleration>("acceleration_wall_0"), mesh.settings.get<Velocity>("jerk_wall_0")}
+    , mesh.settings.get(wall_0_material_flow_key) * ((layer_nr == 0) ? mesh.settings.get(material_flow_layer_0_key) : Ratio(1.0))
+    , GCodePathConfig::SpeedDerivatives{mesh.settings.get(speed_wall_0_key), mesh.settings.get(acceleration_wall_0_key), mesh.settings.get(jerk_wall_0_key)}
 )
 , insetX_config(
     PrintFeatureType::InnerWall
-    , mesh.settings.get<coord_t>("wall_line_width_x") * line_width_factor_per_extruder[mesh.settings.get<ExtruderTrain&>("wall_x_extruder_nr").extruder_nr]
+    , mesh.settings.get(wall_line_width_x_key) * line_width_factor_per_extruder[mesh.settings.get(wall_x_extruder_nr_key).extruder_nr]
     , layer_thickness
-    , mesh.settings.get<Ratio>("wall_x_material_flow") * ((layer_nr == 0) ? mesh.settings.get<Ratio>("material_flow_layer_0") : Ratio(1.0))
-    , GCodePathConfig::SpeedDerivatives{mesh.settings.get<Velocity>("speed_wall_x"), mesh.settings.get<Acceleration>("acceleration_wall_x"), mesh.settings.get<Velocity>("jerk_wall_x")}
+    , mesh.settings.get(wall_x_material_flow_key) * ((layer_nr == 0) ? mesh.settings.get(material_flow_layer_0_key) : Ratio(1.0))
+    , GCodePathConfig::SpeedDerivatives{mesh.settings.get(speed_wall_x_key), mesh.settings.get(acceleration_wall_x_key), mesh.settings.get(jerk_wall_x_key)}
 )
 , bridge_inset0_config(
     PrintFeatureType::OuterWall
-    , mesh.settings.get<coord_t>("wall_line_width_0") * line_width_factor_per_extruder[mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr]
+    , mesh.settings.get(wall_line_width_0_key) * line_width_factor_per_extruder[mesh.settings.get(wall_0_extruder_nr_key).extruder_nr]
     , layer_thickness
-    , mesh.settings.get<Ratio>("bridge_wall_material_flow")
-    , GCodePathConfig::SpeedDerivatives{mesh.settings.get<Velocity>("bridge_wall_speed"), mesh.settings.get<Acceleration>("acceleration_wall_0"), mesh.settings.get<Velocity>("jerk_wall_0")}
+    , mesh.settings.get(bridge_wall_material_flow_key)
+    , GCodePathConfig::SpeedDerivatives{mesh.settings.get(bridge_wall_speed_key), mesh.settings.get(acceleration_wall_0_key), mesh.settings.get(jerk_wall_0_key)}
     , true // is_bridge_path
-    , mesh.settings.get<Ratio>("bridge_fan_speed") * 100.0
+    , mesh.settings.get(bridge_fan_speed_key) * 100.0
 )
 , bridge_insetX_config(
     PrintFeatureType::InnerWall
-    , mesh.settings.get<coord_t>("wall_line_width_x") * line_width_factor_per_extruder[mesh.settings.get<ExtruderTrain&>("wall_x_extruder_nr").extruder_nr]
+    , mesh.settings.get(wall_line_width_x_key) * line_width_factor_per_extruder[mesh.settings.get(wall_x_extruder_nr_key).extruder_nr]
     , layer_thickness
-    , mesh.settings.get<Ratio>("bridge_wall_material_flow")
-    , GCodePathConfig::SpeedDerivatives{mesh.settings.get<Velocity>("bridge_wall_speed"), mesh.settings.get<Acceleration>("acceleration_wall_x"), mesh.settings.get<Velocity>("jerk_wall_x")}
+    , mesh.settings.get(bridge_wall_material_flow_key)
+    , GCodePathConfig::SpeedDerivatives{mesh.settings.get(bridge_wall_speed_key), mesh.settings.get(acceleration_wall_x_key), mesh.settings.get(jerk_wall_x_key)}
     , true // is_bridge_path
-    , mesh.settings.get<Ratio>("bridge_fan_speed") * 100.0
+    , mesh.settings.get(bridge_fan_speed_key) * 100.0
 )
 , skin_config(
     PrintFeatureType::Skin
-    , mesh.settings.get<coord_t>("skin_line_width") * line_width_factor_per_extruder[mesh.settings.get<ExtruderTrain&>("top_bottom_extruder_nr").extruder_nr]
+    , mesh.settings.get(skin_line_width_key) * line_width_factor_per_extruder[mesh.settings.get(top_bottom_extruder_nr_key).extruder_nr]
     , layer_thickness
-    , mesh.settings.get<Ratio>("skin_material_flow") * ((layer_nr == 0) ? mesh.settings.get<Ratio>("material_flow_layer_0") : Ratio(1.0))
-    , GCodePathConfig::SpeedDerivatives{mesh.settings.get<Velocity>("speed_topbottom"), mesh.settings.get<Acceleration>("acceleration_topbottom"), mesh.settings.get<Velocity>("jerk_topbottom")}
+    , mesh.settings.get(skin_material_flow_key) * ((layer_nr == 0) ? mesh.settings.get(material_flow_layer_0_key) : Ratio(1.0))
+    , GCodePathConfig::SpeedDerivatives{mesh.settings.get(speed_topbottom_key), mesh.settings.get(acceleration_topbottom_key), mesh.settings.get(jerk_topbottom_key)}
 )
 , bridge_skin_config( // use bridge skin flow, speed and fan
     PrintFeatureType::Skin
-    , mesh.settings.get<coord_t>("skin_line_width") * line_width_factor_per_extruder[mesh.settings.get<ExtruderTrain&>("top_bottom_extruder_nr").extruder_nr]
+    , mesh.settings.get(skin_line_width_key) * line_width_factor_per_extruder[mesh.settings.get(top_bottom_extruder_nr_key).extruder_nr]
     , layer_thickness
-    , mesh.settings.get<Ratio>("bridge_skin_material_flow")
-    , GCodePathConfig::SpeedDerivatives{mesh.settings.get<Velocity>("bridge_skin_speed"), mesh.settings.get<Acceleration>("acceleration_topbottom"), mesh.settings.get<Velocity>("jerk_topbottom")}
+    , mesh.settings.get(bridge_skin_material_flow_key)
+    , GCodePathConfig::SpeedDerivatives{mesh.settings.get(bridge_skin_speed_key), mesh.settings.get(acceleration_topbottom_key), mesh.settings.get(jerk_topbottom_key)}
     , true // is_bridge_path
-    , mesh.settings.get<Ratio>("bridge_fan_speed") * 100.0
+    , mesh.settings.get(bridge_fan_speed_key) * 100.0
 )
 , bridge_skin_config2( // use bridge skin 2 flow, speed and fan
     PrintFeatureType::Skin
-    , mesh.settings.get<coord_t>("skin_line_width") * line_width_factor_per_extruder[mesh.settings.get<ExtruderTrain&>("top_bottom_extruder_nr").extruder_nr]
+    , mesh.settings.get(skin_line_width_key) * line_width_factor_per_extruder[mesh.settings.get(top_bottom_extruder_nr_key).extruder_nr]
     , layer_thickness
-    , mesh.settings.get<Ratio>("bridge_skin_material_flow_2")
-    , GCodePathConfig::SpeedDerivatives{mesh.settings.get<Velocity>("bridge_skin_speed_2"), mesh.settings.get<Acceleration>("acceleration_topbottom"), mesh.settings.get<Velocity>("jerk_topbottom")}
+    , mesh.settings.get(bridge_skin_material_flow_2_key)
+    , GCodePathConfig::SpeedDerivatives{mesh.settings.get(bridge_skin_speed_2_key), mesh.settings.get(acceleration_topbottom_key), mesh.settings.get(jerk_topbottom_key)}
     , true // is_bridge_path
-    , mesh.settings.get<Ratio>("bridge_fan_speed_2") * 100.0
+    , mesh.settings.get(bridge_fan_speed_2_key) * 100.0
 )
 , bridge_skin_config3( // use bridge skin 3 flow, speed and fan
     PrintFeatureType::Skin
-    , mesh.settings.get<coord_t>("skin_line_width") * line_width_factor_per_extruder[mesh.settings.get<ExtruderTrain&>("top_bottom_extruder_nr").extruder_nr]
+    , mesh.settings.get(skin_line_width_key) * line_width_factor_per_extruder[mesh.settings.get(top_bottom_extruder_nr_key).extruder_nr]
     , layer_thickness
-    , mesh.settings.get<Ratio>("bridge_skin_material_flow_3")
-    , GCodePathConfig::SpeedDerivatives{mesh.settings.get<Velocity>("bridge_skin_speed_3"), mesh.settings.get<Acceleration>("acceleration_topbottom"), mesh.settings.get<Velocity>("jerk_topbottom")}
+    , mesh.settings.get(bridge_skin_material_flow_3_key)
+    , GCodePathConfig::SpeedDerivatives{mesh.settings.get(bridge_skin_speed_3_key), mesh.settings.get(acceleration_topbottom_key), mesh.settings.get(jerk_topbottom_key)}
     , true // is_bridge_path
-    , mesh.settings.get<Ratio>("bridge_fan_speed_3") * 100.0
+    , mesh.settings.get(bridge_fan_speed_3_key) * 100.0
 )
 , roofing_config(
     PrintFeatureType::Skin
-    , mesh.settings.get<coord_t>("roofing_line_width")
+    , mesh.settings.get(roofing_line_width_key)
     , layer_thickness
-    , mesh.settings.get<Ratio>("roofing_material_flow") * ((layer_nr == 0) ? mesh.settings.get<Ratio>("material_flow_layer_0") : Ratio(1.0))
-    , GCodePathConfig::SpeedDerivatives{mesh.settings.get<Velocity>("speed_roofing"), mesh.settings.get<Acceleration>("acceleration_roofing"), mesh.settings.get<Velocity>("jerk_roofing")}
+    , mesh.settings.get(roofing_material_flow_key) * ((layer_nr == 0) ? mesh.settings.get(material_flow_layer_0_key) : Ratio(1.0))
+    , GCodePathConfig::SpeedDerivatives{mesh.settings.get(speed_roofing_key), mesh.settings.get(acceleration_roofing_key), mesh.settings.get(jerk_roofing_key)}
 )
 , ironing_config(
     PrintFeatureType::Skin
-    , mesh.settings.get<coord_t>("ironing_line_spacing")
+    , mesh.settings.get(ironing_line_spacing_key)
     , layer_thickness
-    , mesh.settings.get<Ratio>("ironing_flow")
-    , GCodePathConfig::SpeedDerivatives{mesh.settings.get<Velocity>("speed_ironing"), mesh.settings.get<Acceleration>("acceleration_ironing"), mesh.settings.get<Velocity>("jerk_ironing")}
+    , mesh.settings.get(ironing_flow_key)
+    , GCodePathConfig::SpeedDerivatives{mesh.settings.get(speed_ironing_key), mesh.settings.get(acceleration_ironing_key), mesh.settings.get(jerk_ironing_key)}
 )
 
 {
@@ -120,60 +226,60 @@ PathConfigStorage::MeshPathConfigs::MeshPathConfigs(const SliceMeshStorage& mesh
     {
         infill_config.emplace_back(
                 PrintFeatureType::Infill
-                , mesh.settings.get<coord_t>("infill_line_width") * line_width_factor_per_extruder[mesh.settings.get<ExtruderTrain&>("infill_extruder_nr").extruder_nr]
+                , mesh.settings.get(infill_line_width_key) * line_width_factor_per_extruder[mesh.settings.get(infill_extruder_nr_key).extruder_nr]
                 , layer_thickness
-                , mesh.settings.get<Ratio>("infill_material_flow") * ((layer_nr == 0) ? mesh.settings.get<Ratio>("material_flow_layer_0") : Ratio(1.0)) * (combine_idx + 1)
-                , GCodePathConfig::SpeedDerivatives{mesh.settings.get<Velocity>("speed_infill"), mesh.settings.get<Acceleration>("acceleration_infill"), mesh.settings.get<Velocity>("jerk_infill")}
+                , mesh.settings.get(infill_material_flow_key) * ((layer_nr == 0) ? mesh.settings.get(material_flow_layer_0_key) : Ratio(1.0)) * (combine_idx + 1)
+                , GCodePathConfig::SpeedDerivatives{mesh.settings.get(speed_infill_key), mesh.settings.get(acceleration_infill_key), mesh.settings.get(jerk_infill_key)}
             );
     }
 }
 
 PathConfigStorage::PathConfigStorage(const SliceDataStorage& storage, const LayerIndex& layer_nr, const coord_t layer_thickness)
-: support_infill_extruder_nr(Application::getInstance().current_slice->scene.current_mesh_group->settings.get<ExtruderTrain&>("support_infill_extruder_nr").extruder_nr)
-, support_roof_extruder_nr(Application::getInstance().current_slice->scene.current_mesh_group->settings.get<ExtruderTrain&>("support_roof_extruder_nr").extruder_nr)
-, support_bottom_extruder_nr(Application::getInstance().current_slice->scene.current_mesh_group->settings.get<ExtruderTrain&>("support_bottom_extruder_nr").extruder_nr)
-, skirt_brim_train(Application::getInstance().current_slice->scene.current_mesh_group->settings.get<ExtruderTrain&>("skirt_brim_extruder_nr"))
-, raft_base_train(Application::getInstance().current_slice->scene.current_mesh_group->settings.get<ExtruderTrain&>("raft_base_extruder_nr"))
-, raft_interface_train(Application::getInstance().current_slice->scene.current_mesh_group->settings.get<ExtruderTrain&>("raft_interface_extruder_nr"))
-, raft_surface_train(Application::getInstance().current_slice->scene.current_mesh_group->settings.get<ExtruderTrain&>("raft_surface_extruder_nr"))
+: support_infill_extruder_nr(Application::getInstance().current_slice->scene.current_mesh_group->settings.get(support_infill_extruder_nr_key).extruder_nr)
+, support_roof_extruder_nr(Application::getInstance().current_slice->scene.current_mesh_group->settings.get(support_roof_extruder_nr_key).extruder_nr)
+, support_bottom_extruder_nr(Application::getInstance().current_slice->scene.current_mesh_group->settings.get(support_bottom_extruder_nr_key).extruder_nr)
+, skirt_brim_train(Application::getInstance().current_slice->scene.current_mesh_group->settings.get(skirt_brim_extruder_nr_key))
+, raft_base_train(Application::getInstance().current_slice->scene.current_mesh_group->settings.get(raft_base_extruder_nr_key))
+, raft_interface_train(Application::getInstance().current_slice->scene.current_mesh_group->settings.get(raft_interface_extruder_nr_key))
+, raft_surface_train(Application::getInstance().current_slice->scene.current_mesh_group->settings.get(raft_surface_extruder_nr_key))
 , support_infill_train(Application::getInstance().current_slice->scene.extruders[support_infill_extruder_nr])
 , support_roof_train(Application::getInstance().current_slice->scene.extruders[support_roof_extruder_nr])
 , support_bottom_train(Application::getInstance().current_slice->scene.extruders[support_bottom_extruder_nr])
 , line_width_factor_per_extruder(PathConfigStorage::getLineWidthFactorPerExtruder(layer_nr))
 , raft_base_config(
             PrintFeatureType::SupportInterface
-            , raft_base_train.settings.get<coord_t>("raft_base_line_width")
-            , raft_base_train.settings.get<coord_t>("raft_base_thickness")
+            , raft_base_train.settings.get(raft_base_line_width_key)
+            , raft_base_train.settings.get(raft_base_thickness_key)
             , Ratio(1.0)
-            , GCodePathConfig::SpeedDerivatives{raft_base_train.settings.get<Velocity>("raft_base_speed"), raft_base_train.settings.get<Acceleration>("raft_base_acceleration"), raft_base_train.settings.get<Velocity>("raft_base_jerk")}
+            , GCodePathConfig::SpeedDerivatives{raft_base_train.settings.get(raft_base_speed_key), raft_base_train.settings.get(raft_base_acceleration_key), raft_base_train.settings.get(raft_base_jerk_key)}
         )
 , raft_interface_config(
             PrintFeatureType::Support
-            , raft_interface_train.settings.get<coord_t>("raft_interface_line_width")
-            , raft_interface_train.settings.get<coord_t>("raft_interface_thickness")
+            , raft_interface_train.settings.get(raft_interface_line_width_key)
+            , raft_interface_train.settings.get(raft_interface_thickness_key)
             , Ratio(1.0)
-            , GCodePathConfig::SpeedDerivatives{raft_interface_train.settings.get<Velocity>("raft_interface_speed"), raft_interface_train.settings.get<Acceleration>("raft_interface_acceleration"), raft_interface_train.settings.get<Velocity>("raft_interface_jerk")}
+            , GCodePathConfig::SpeedDerivatives{raft_interface_train.settings.get(raft_interface_speed_key), raft_interface_train.settings.get(raft_interface_acceleration_key), raft_interface_train.settings.get(raft_interface_jerk_key)}
         )
 , raft_surface_config(
             PrintFeatureType::SupportInterface
-            , raft_surface_train.settings.get<coord_t>("raft_surface_line_width")
-            , raft_surface_train.settings.get<coord_t>("raft_surface_thickness")
+            , raft_surface_train.settings.get(raft_surface_line_width_key)
+            , raft_surface_train.settings.get(raft_surface_thickness_key)
             , Ratio(1.0)
-            , GCodePathConfig::SpeedDerivatives{raft_surface_train.settings.get<Velocity>("raft_surface_speed"), raft_surface_train.settings.get<Acceleration>("raft_surface_acceleration"), raft_surface_train.settings.get<Velocity>("raft_surface_jerk")}
+            , GCodePathConfig::SpeedDerivatives{raft_surface_train.settings.get(raft_surface_speed_key), raft_surface_train.settings.get(raft_surface_acceleration_key), raft_surface_train.settings.get(raft_surface_jerk_key)}
         )
 , support_roof_config(
             PrintFeatureType::SupportInterface
-            , support_roof_train.settings.get<coord_t>("support_roof_line_width") * line_width_factor_per_extruder[support_roof_extruder_nr]
+            , support_roof_train.settings.get(support_roof_line_width_key) * line_width_factor_per_extruder[support_roof_extruder_nr]
             , layer_thickness
-            , support_roof_train.settings.get<Ratio>("support_roof_material_flow") * ((layer_nr == 0) ? support_roof_train.settings.get<Ratio>("material_flow_layer_0") : Ratio(1.0))
-            , GCodePathConfig::SpeedDerivatives{support_roof_train.settings.get<Velocity>("speed_support_roof"), support_roof_train.settings.get<Acceleration>("acceleration_support_roof"), support_roof_train.settings.get<Velocity>("jerk_support_roof")}
+            , support_roof_train.settings.get(support_roof_material_flow_key) * ((layer_nr == 0) ? support_roof_train.settings.get(material_flow_layer_0_key) : Ratio(1.0))
+            , GCodePathConfig::SpeedDerivatives{support_roof_train.settings.get(speed_support_roof_key), support_roof_train.settings.get(acceleration_support_roof_key), support_roof_train.settings.get(jerk_support_roof_key)}
         )
 , support_bottom_config(
             PrintFeatureType::SupportInterface
-            , support_bottom_train.settings.get<coord_t>("support_bottom_line_width") * line_width_factor_per_extruder[support_bottom_extruder_nr]
+            , support_bottom_train.settings.get(support_bottom_line_width_key) * line_width_factor_per_extruder[support_bottom_extruder_nr]
             , layer_thickness
-            , support_roof_train.settings.get<Ratio>("support_bottom_material_flow") * ((layer_nr == 0) ? support_roof_train.settings.get<Ratio>("material_flow_layer_0") : Ratio(1.0))
-            , GCodePathConfig::SpeedDerivatives{support_bottom_train.settings.get<Velocity>("speed_support_bottom"), support_bottom_train.settings.get<Acceleration>("acceleration_support_bottom"), support_bottom_train.settings.get<Velocity>("jerk_support_bottom")}
+            , support_roof_train.settings.get(support_bottom_material_flow_key) * ((layer_nr == 0) ? support_roof_train.settings.get(material_flow_layer_0_key) : Ratio(1.0))
+            , GCodePathConfig::SpeedDerivatives{support_bottom_train.settings.get(speed_support_bottom_key), support_bottom_train.settings.get(acceleration_support_bottom_key), support_bottom_train.settings.get(jerk_support_bottom_key)}
         )
 {
     const size_t extruder_count = Application::getInstance().current_slice->scene.extruders.size();
@@ -189,23 +295,23 @@ PathConfigStorage::PathConfigStorage(const SliceDataStorage& storage, const Laye
                 , 0
                 , 0
                 , 0.0
-                , GCodePathConfig::SpeedDerivatives{train.settings.get<Velocity>("speed_travel"), train.settings.get<Acceleration>("acceleration_travel"), train.settings.get<Velocity>("jerk_travel")}
+                , GCodePathConfig::SpeedDerivatives{train.settings.get(speed_travel_key), train.settings.get(acceleration_travel_key), train.settings.get(jerk_travel_key)}
             );
         skirt_brim_config_per_extruder.emplace_back(
                 PrintFeatureType::SkirtBrim
-                , train.settings.get<coord_t>("skirt_brim_line_width")
-                    * ((mesh_group_settings.get<EPlatformAdhesion>("adhesion_type") == EPlatformAdhesion::RAFT) ? 1.0_r : line_width_factor_per_extruder[extruder_nr]) // cause it's also used for the draft/ooze shield
+                , train.settings.get(skirt_brim_line_width_key)
+                    * ((mesh_group_settings.get(adhesion_type_key) == EPlatformAdhesion::RAFT) ? 1.0_r : line_width_factor_per_extruder[extruder_nr]) // cause it's also used for the draft/ooze shield
                 , layer_thickness
-                , train.settings.get<Ratio>("skirt_brim_material_flow") * ((layer_nr == 0) ? train.settings.get<Ratio>("material_flow_layer_0") : Ratio(1.0))
-                , GCodePathConfig::SpeedDerivatives{train.settings.get<Velocity>("skirt_brim_speed"), train.settings.get<Acceleration>("acceleration_skirt_brim"), train.settings.get<Velocity>("jerk_skirt_brim")}
+                , train.settings.get(skirt_brim_material_flow_key) * ((layer_nr == 0) ? train.settings.get(material_flow_layer_0_key) : Ratio(1.0))
+                , GCodePathConfig::SpeedDerivatives{train.settings.get(skirt_brim_speed_key), train.settings.get(acceleration_skirt_brim_key), train.settings.get(jerk_skirt_brim_key)}
             );
         prime_tower_config_per_extruder.emplace_back(
                 PrintFeatureType::PrimeTower
-                , train.settings.get<coord_t>("prime_tower_line_width")
-                    * ((mesh_group_settings.get<EPlatformAdhesion>("adhesion_type") == EPlatformAdhesion::RAFT) ? 1.0_r : line_width_factor_per_extruder[extruder_nr])
+                , train.settings.get(prime_tower_line_width_key)
+                    * ((mesh_group_settings.get(adhesion_type_key) == EPlatformAdhesion::RAFT) ? 1.0_r : line_width_factor_per_extruder[extruder_nr])
                 , layer_thickness
-                , train.settings.get<Ratio>("prime_tower_flow") * ((layer_nr == 0) ? train.settings.get<Ratio>("material_flow_layer_0") : Ratio(1.0))
-                , GCodePathConfig::SpeedDerivatives{train.settings.get<Velocity>("speed_prime_tower"), train.settings.get<Acceleration>("acceleration_prime_tower"), train.settings.get<Velocity>("jerk_prime_tower")}
+                , train.settings.get(prime_tower_flow_key) * ((layer_nr == 0) ? train.settings.get(material_flow_layer_0_key) : Ratio(1.0))
+                , GCodePathConfig::SpeedDerivatives{train.settings.get(speed_prime_tower_key), train.settings.get(acceleration_prime_tower_key), train.settings.get(jerk_prime_tower_key)}
             );
     }
 
@@ -216,19 +322,19 @@ PathConfigStorage::PathConfigStorage(const SliceDataStorage& storage, const Laye
     }
 
     support_infill_config.reserve(MAX_INFILL_COMBINE);
-    const float support_infill_line_width_factor = (mesh_group_settings.get<EPlatformAdhesion>("adhesion_type") == EPlatformAdhesion::RAFT) ? 1.0_r : line_width_factor_per_extruder[support_infill_extruder_nr];
+    const float support_infill_line_width_factor = (mesh_group_settings.get(adhesion_type_key) == EPlatformAdhesion::RAFT) ? 1.0_r : line_width_factor_per_extruder[support_infill_extruder_nr];
     for (int combine_idx = 0; combine_idx < MAX_INFILL_COMBINE; combine_idx++)
     {
         support_infill_config.emplace_back(
             PrintFeatureType::Support
-            , support_infill_train.settings.get<coord_t>("support_line_width") * support_infill_line_width_factor
+            , support_infill_train.settings.get(support_line_width_key) * support_infill_line_width_factor
             , layer_thickness
-            , support_infill_train.settings.get<Ratio>("support_material_flow") * ((layer_nr == 0) ? support_infill_train.settings.get<Ratio>("material_flow_layer_0") : Ratio(1.0)) * (combine_idx + 1)
-            , GCodePathConfig::SpeedDerivatives{support_infill_train.settings.get<Velocity>("speed_support_infill"), support_infill_train.settings.get<Acceleration>("acceleration_support_infill"), support_infill_train.settings.get<Velocity>("jerk_support_infill")}
+            , support_infill_train.settings.get(support_material_flow_key) * ((layer_nr == 0) ? support_infill_train.settings.get(material_flow_layer_0_key) : Ratio(1.0)) * (combine_idx + 1)
+            , GCodePathConfig::SpeedDerivatives{support_infill_train.settings.get(speed_support_infill_key), support_infill_train.settings.get(acceleration_support_infill_key), support_infill_train.settings.get(jerk_support_infill_key)}
         );
     }
 
-    const size_t initial_speedup_layer_count = mesh_group_settings.get<size_t>("speed_slowdown_layers");
+    const size_t initial_speedup_layer_count = mesh_group_settings.get(speed_slowdown_layers_key);
     if (layer_nr >= 0 && static_cast<size_t>(layer_nr) < initial_speedup_layer_count)
     {
         handleInitialLayerSpeedup(storage, layer_nr, initial_speedup_layer_count);
@@ -256,9 +362,9 @@ void cura::PathConfigStorage::handleInitialLayerSpeedup(const SliceDataStorage&
     {
         global_first_layer_config_per_extruder.emplace_back(
             GCodePathConfig::SpeedDerivatives{
-                extruder.settings.get<Velocity>("speed_print_layer_0")
-                , extruder.settings.get<Acceleration>("acceleration_print_layer_0")
-                , extruder.settings.get<Velocity>("jerk_print_layer_0")
+                extruder.settings.get(speed_print_layer_0_key)
+                , extruder.settings.get(acceleration_print_layer_0_key)
+                , extruder.settings.get(jerk_print_layer_0_key)
             });
     }
 
@@ -273,10 +379,10 @@ void cura::PathConfigStorage::handleInitialLayerSpeedup(const SliceDataStorage&
                 support_infill_config[idx].smoothSpeed(first_layer_config_infill, std::max(LayerIndex(0), layer_nr), initial_speedup_layer_count);
             }
 
-            const size_t extruder_nr_support_roof = mesh_group_settings.get<ExtruderTrain&>("support_roof_extruder_nr").extruder_nr;
+            const size_t extruder_nr_support_roof = mesh_group_settings.get(support_roof_extruder_nr_key).extruder_nr;
             GCodePathConfig::SpeedDerivatives& first_layer_config_roof = global_first_layer_config_per_extruder[extruder_nr_support_roof];
             support_roof_config.smoothSpeed(first_layer_config_roof, std::max(LayerIndex(0), layer_nr), initial_speedup_layer_count);
-            const size_t extruder_nr_support_bottom = mesh_group_settings.get<ExtruderTrain&>("support_bottom_extruder_nr").extruder_nr;
+            const size_t extruder_nr_support_bottom = mesh_group_settings.get(support_bottom_extruder_nr_key).extruder_nr;
             GCodePathConfig::SpeedDerivatives& first_layer_config_bottom = global_first_layer_config_per_extruder[extruder_nr_support_bottom];
             support_bottom_config.smoothSpeed(first_layer_config_bottom, std::max(LayerIndex(0), layer_nr), initial_speedup_layer_count);
         }
@@ -287,9 +393,9 @@ void cura::PathConfigStorage::handleInitialLayerSpeedup(const SliceDataStorage&
         {
             const ExtruderTrain& train = Application::getInstance().current_slice->scene.extruders[extruder_nr];
             GCodePathConfig::SpeedDerivatives initial_layer_travel_speed_config{
-                    train.settings.get<Velocity>("speed_travel_layer_0")
-                    , train.settings.get<Acceleration>("acceleration_travel_layer_0")
-                    , train.settings.get<Velocity>("jerk_travel_layer_0")
+                    train.settings.get(speed_travel_layer_0_key)
+                    , train.settings.get(acceleration_travel_layer_0_key)
+                    , train.settings.get(jerk_travel_layer_0_key)
             };
             GCodePathConfig& travel = travel_config_per_extruder[extruder_nr];
 
@@ -312,9 +418,9 @@ void cura::PathConfigStorage::handleInitialLayerSpeedup(const SliceDataStorage&
             const SliceMeshStorage& mesh = storage.meshes[mesh_idx];
 
             GCodePathConfig::SpeedDerivatives initial_layer_speed_config{
-                    mesh.settings.get<Velocity>("speed_print_layer_0")
-                    , mesh.settings.get<Acceleration>("acceleration_print_layer_0")
-                    , mesh.settings.get<Velocity>("jerk_print_layer_0")
+                    mesh.settings.get(speed_print_layer_0_key)
+                    , mesh.settings.get(acceleration_print_layer_0_key)
+                    , mesh.settings.get(jerk_print_layer_0_key)
             };
 
             mesh_configs[mesh_idx].smoothAllSpeeds(initial_layer_speed_config, layer_nr, initial_speedup_layer_count);
@@ -3,6 +3,7 @@
 
 #include <cctype>
 #include <fstream>
+#include <mutex> //To guard the interned keys.
 #include <stdio.h>
 #include <sstream> // ostringstream
 #include <regex> // regex parsing for temp flow graph
@@ -28,11 +29,37 @@
 namespace cura
 {
 
+std::atomic<uint64_t> Settings::generation(1);
+
 Settings::Settings()
 {
     parent = nullptr; //Needs to be properly initialised because we check against this if the parent is not set.
 }
 
+Settings& Settings::operator=(const Settings& other)
+{
+    parent = other.parent;
+    settings = other.settings;
+    invalidateCaches(); //The values that others cached from our old settings are gone.
+    return *this;
+}
+
+Settings& Settings::operator=(Settings&& other)
+{
+    parent = other.parent;
+    settings = std::move(other.settings);
+    invalidateCaches();
+    return *this;
+}
+
+Settings::~Settings()
+{
+    if (! settings.empty()) //If there are no settings, nobody can have cached a value from this container.
+    {
+        invalidateCaches();
+    }
+}
+
 void Settings::add(const std::string& key, const std::string value)
 {
     if (settings.find(key) != settings.end()) //Already exists.
@@ -43,49 +70,33 @@ void Settings::add(const std::string& key, const std::string value)
     {
         settings.emplace(key, value);
     }
+    internKey(key); //Intern all known keys while loading, so that slicing hardly ever needs to wait for the lock.
+    invalidateCaches();
 }
 
-template<> std::string Settings::get<std::string>(const std::string& key) const
+template<> std::string Settings::get<std::string>(const std::string& key, const size_t key_id) const
 {
-    //If this settings base has a setting value for it, look that up.
-    if (settings.find(key) != settings.end())
-    {
-        return settings.at(key);
-    }
-
-    const std::unordered_map<std::string, ExtruderTrain*>& limit_to_extruder = Application::getInstance().current_slice->scene.limit_to_extruder;
-    if (limit_to_extruder.find(key) != limit_to_extruder.end())
-    {
-        return limit_to_extruder.at(key)->settings.getWithoutLimiting(key);
-    }
-
-    if (parent)
-    {
-        return parent->get<std::string>(key);
-    }
-
-    logError("Trying to retrieve setting with no value given: '%s'\n", key.c_str());
-    std::exit(2);
+    return *getCached(key, key_id).value;
 }
 
-template<> double Settings::get<double>(const std::string& key) const
+template<> double Settings::get<double>(const std::string& key, const size_t key_id) const
 {
-    return atof(get<std::string>(key).c_str());
+    return getCached(key, key_id).number;
 }
 
-template<> size_t Settings::get<size_t>(const std::string& key) const
+template<> size_t Settings::get<size_t>(const std::string& key, const size_t key_id) const
 {
-    return std::stoul(get<std::string>(key).c_str());
+    return std::stoul(getCached(key, key_id).value->c_str());
 }
 
-template<> int Settings::get<int>(const std::string& key) const
+template<> int Settings::get<int>(const std::string& key, const size_t key_id) const
 {
-    return atoi(get<std::string>(key).c_str());
+    return atoi(getCached(key, key_id).value->c_str());
 }
 
-template<> bool Settings::get<bool>(const std::string& key) const
+template<> bool Settings::get<bool>(const std::string& key, const size_t key_id) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = *getCached(key, key_id).value;
     if (value == "on" || value == "yes" || value == "true" || value == "True")
     {
         return true;
@@ -94,9 +105,9 @@ template<> bool Settings::get<bool>(const std::string& key) const
     return num != 0;
 }
 
-template<> ExtruderTrain& Settings::get<ExtruderTrain&>(const std::string& key) const
+template<> ExtruderTrain& Settings::get<ExtruderTrain&>(const std::string& key, const size_t key_id) const
 {
-    int extruder_nr = std::atoi(get<std::string>(key).c_str());
+    int extruder_nr = std::atoi(getCached(key, key_id).value->c_str());
     if (extruder_nr < 0)
     {
         extruder_nr = get<size_t>("extruder_nr");
@@ -104,49 +115,49 @@ template<> ExtruderTrain& Settings::get<ExtruderTrain&>(const std::string& key)
     return Application::getInstance().current_slice->scene.extruders[extruder_nr];
 }
 
-template<> LayerIndex Settings::get<LayerIndex>(const std::string& key) const
+template<> LayerIndex Settings::get<LayerIndex>(const std::string& key, const size_t key_id) const
 {
-    return std::atoi(get<std::string>(key).c_str()) - 1; //For the user we display layer numbers starting from 1, but we start counting from 0. Still it may be negative for Raft layers.
+    return std::atoi(getCached(key, key_id).value->c_str()) - 1; //For the user we display layer numbers starting from 1, but we start counting from 0. Still it may be negative for Raft layers.
 }
 
-template<> coord_t Settings::get<coord_t>(const std::string& key) const
+template<> coord_t Settings::get<coord_t>(const std::string& key, const size_t key_id) const
 {
-    return MM2INT(get<double>(key)); //The settings are all in millimetres, but we need to interpret them as microns.
+    return MM2INT(get<double>(key, key_id)); //The settings are all in millimetres, but we need to interpret them as microns.
 }
 
-template<> AngleRadians Settings::get<AngleRadians>(const std::string& key) const
+template<> AngleRadians Settings::get<AngleRadians>(const std::string& key, const size_t key_id) const
 {
-    return get<double>(key) * M_PI / 180; //The settings are all in degrees, but we need to interpret them as radians.
+    return get<double>(key, key_id) * M_PI / 180; //The settings are all in degrees, but we need to interpret them as radians.
 }
 
-template<> AngleDegrees Settings::get<AngleDegrees>(const std::string& key) const
+template<> AngleDegrees Settings::get<AngleDegrees>(const std::string& key, const size_t key_id) const
 {
-    return get<double>(key);
+    return get<double>(key, key_id);
 }
 
-template<> Temperature Settings::get<Temperature>(const std::string& key) const
+template<> Temperature Settings::get<Temperature>(const std::string& key, const size_t key_id) const
 {
-    return get<double>(key);
+    return get<double>(key, key_id);
 }
 
-template<> Velocity Settings::get<Velocity>(const std::string& key) const
+template<> Velocity Settings::get<Velocity>(const std::string& key, const size_t key_id) const
 {
-    return get<double>(key);
+    return get<double>(key, key_id);
 }
 
-template<> Ratio Settings::get<Ratio>(const std::string& key) const
+template<> Ratio Settings::get<Ratio>(const std::string& key, const size_t key_id) const
 {
-    return get<double>(key) / 100.0; //The settings are all in percentages, but we need to interpret them as radians.
+    return get<double>(key, key_id) / 100.0; //The settings are all in percentages, but we need to interpret them as radians.
 }
 
-template<> Duration Settings::get<Duration>(const std::string& key) const
+template<> Duration Settings::get<Duration>(const std::string& key, const size_t key_id) const
 {
-    return get<double>(key);
+    return get<double>(key, key_id);
 }
 
-template<> DraftShieldHeightLimitation Settings::get<DraftShieldHeightLimitation>(const std::string& key) const
+template<> DraftShieldHeightLimitation Settings::get<DraftShieldHeightLimitation>(const std::string& key, const size_t key_id) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = *getCached(key, key_id).value;
     if (value == "limited")
     {
         return DraftShieldHeightLimitation::LIMITED;
@@ -157,9 +168,9 @@ template<> DraftShieldHeightLimitation Settings::get<DraftShieldHeightLimitation
     }
 }
 
-template<> FlowTempGraph Settings::get<FlowTempGraph>(const std::string& key) const
+template<> FlowTempGraph Settings::get<FlowTempGraph>(const std::string& key, const size_t key_id) const
 {
-    std::string value_string = get<std::string>(key);
+    std::string value_string = get<std::string>(key, key_id);
 
     FlowTempGraph result;
     if (value_string.empty())
@@ -204,9 +215,9 @@ template<> FlowTempGraph Settings::get<FlowTempGraph>(const std::string& key) co
     return result;
 }
 
-template<> FMatrix4x3 Settings::get<FMatrix4x3>(const std::string& key) const
+template<> FMatrix4x3 Settings::get<FMatrix4x3>(const std::string& key, const size_t key_id) const
 {
-    const std::string value_string = get<std::string>(key);
+    const std::string value_string = get<std::string>(key, key_id);
 
     FMatrix4x3 result;
     if (value_string.empty())
@@ -243,9 +254,9 @@ template<> FMatrix4x3 Settings::get<FMatrix4x3>(const std::string& key) const
     return result;
 }
 
-template<> EGCodeFlavor Settings::get<EGCodeFlavor>(const std::string& key) const
+template<> EGCodeFlavor Settings::get<EGCodeFlavor>(const std::string& key, const size_t key_id) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = *getCached(key, key_id).value;
     //I wish that switch statements worked for std::string...
     if (value == "Griffin")
     {
@@ -283,9 +294,9 @@ template<> EGCodeFlavor Settings::get<EGCodeFlavor>(const std::string& key) cons
     return EGCodeFlavor::MARLIN;
 }
 
-template<> EFillMethod Settings::get<EFillMethod>(const std::string& key) const
+template<> EFillMethod Settings::get<EFillMethod>(const std::string& key, const size_t key_id) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = *getCached(key, key_id).value;
     if (value == "lines")
     {
         return EFillMethod::LINES;
@@ -348,9 +359,9 @@ template<> EFillMethod Settings::get<EFillMethod>(const std::string& key) const
     }
 }
 
-template<> EPlatformAdhesion Settings::get<EPlatformAdhesion>(const std::string& key) const
+template<> EPlatformAdhesion Settings::get<EPlatformAdhesion>(const std::string& key, const size_t key_id) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = *getCached(key, key_id).value;
     if (value == "brim")
     {
         return EPlatformAdhesion::BRIM;
@@ -369,9 +380,9 @@ template<> EPlatformAdhesion Settings::get<EPlatformAdhesion>(const std::string&
     }
 }
 
-template<> ESupportType Settings::get<ESupportType>(const std::string& key) const
+template<> ESupportType Settings::get<ESupportType>(const std::string& key, const size_t key_id) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = *getCached(key, key_id).value;
     if (value == "everywhere")
     {
         return ESupportType::EVERYWHERE;
@@ -386,9 +397,9 @@ template<> ESupportType Settings::get<ESupportType>(const std::string& key) cons
     }
 }
 
-template<> ESupportStructure Settings::get<ESupportStructure>(const std::string& key) const
+template<> ESupportStructure Settings::get<ESupportStructure>(const std::string& key, const size_t key_id) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = *getCached(key, key_id).value;
     if (value == "normal")
     {
         return ESupportStructure::NORMAL;
@@ -404,9 +415,9 @@ template<> ESupportStructure Settings::get<ESupportStructure>(const std::string&
 }
 
 
-template<> EZSeamType Settings::get<EZSeamType>(const std::string& key) const
+template<> EZSeamType Settings::get<EZSeamType>(const std::string& key, const size_t key_id) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = *getCached(key, key_id).value;
     if (value == "random")
     {
         return EZSeamType::RANDOM;
@@ -425,9 +436,9 @@ template<> EZSeamType Settings::get<EZSeamType>(const std::string& key) const
     }
 }
 
-template<> EZSeamCornerPrefType Settings::get<EZSeamCornerPrefType>(const std::string& key) const
+template<> EZSeamCornerPrefType Settings::get<EZSeamCornerPrefType>(const std::string& key, const size_t key_id) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = *getCached(key, key_id).value;
     if (value == "z_seam_corner_inner")
     {
         return EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_INNER;
@@ -450,9 +461,9 @@ template<> EZSeamCornerPrefType Settings::get<EZSeamCornerPrefType>(const std::s
     }
 }
 
-template<> ESurfaceMode Settings::get<ESurfaceMode>(const std::string& key) const
+template<> ESurfaceMode Settings::get<ESurfaceMode>(const std::string& key, const size_t key_id) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = *getCached(key, key_id).value;
     if (value == "surface")
     {
         return ESurfaceMode::SURFACE;
@@ -467,9 +478,9 @@ template<> ESurfaceMode Settings::get<ESurfaceMode>(const std::string& key) cons
     }
 }
 
-template<> FillPerimeterGapMode Settings::get<FillPerimeterGapMode>(const std::string& key) const
+template<> FillPerimeterGapMode Settings::get<FillPerimeterGapMode>(const std::string& key, const size_t key_id) const
 {
-    if (get<std::string>(key) == "everywhere")
+    if (*getCached(key, key_id).value == "everywhere")
     {
         return FillPerimeterGapMode::EVERYWHERE;
     }
@@ -479,9 +490,9 @@ template<> FillPerimeterGapMode Settings::get<FillPerimeterGapMode>(const std::s
     }
 }
 
-template<> BuildPlateShape Settings::get<BuildPlateShape>(const std::string& key) const
+template<> BuildPlateShape Settings::get<BuildPlateShape>(const std::string& key, const size_t key_id) const
 {
-    if (get<std::string>(key) == "elliptic")
+    if (*getCached(key, key_id).value == "elliptic")
     {
         return BuildPlateShape::ELLIPTIC;
     }
@@ -491,9 +502,9 @@ template<> BuildPlateShape Settings::get<BuildPlateShape>(const std::string& key
     }
 }
 
-template<> CombingMode Settings::get<CombingMode>(const std::string& key) const
+template<> CombingMode Settings::get<CombingMode>(const std::string& key, const size_t key_id) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = *getCached(key, key_id).value;
     if (value == "off")
     {
         return CombingMode::OFF;
@@ -516,9 +527,9 @@ template<> CombingMode Settings::get<CombingMode>(const std::string& key) const
     }
 }
 
-template<> SupportDistPriority Settings::get<SupportDistPriority>(const std::string& key) const
+template<> SupportDistPriority Settings::get<SupportDistPriority>(const std::string& key, const size_t key_id) const
 {
-    if (get<std::string>(key) == "z_overrides_xy")
+    if (*getCached(key, key_id).value == "z_overrides_xy")
     {
         return SupportDistPriority::Z_OVERRIDES_XY;
     }
@@ -528,9 +539,9 @@ template<> SupportDistPriority Settings::get<SupportDistPriority>(const std::str
     }
 }
 
-template<> SlicingTolerance Settings::get<SlicingTolerance>(const std::string& key) const
+template<> SlicingTolerance Settings::get<SlicingTolerance>(const std::string& key, const size_t key_id) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = *getCached(key, key_id).value;
     if (value == "inclusive")
     {
         return SlicingTolerance::INCLUSIVE;
@@ -545,9 +556,9 @@ template<> SlicingTolerance Settings::get<SlicingTolerance>(const std::string& k
     }
 }
 
-template<> InsetDirection Settings::get<InsetDirection>(const std::string& key) const
+template<> InsetDirection Settings::get<InsetDirection>(const std::string& key, const size_t key_id) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = *getCached(key, key_id).value;
     if(value == "outside_in")
     {
         return InsetDirection::OUTSIDE_IN;
@@ -558,9 +569,9 @@ template<> InsetDirection Settings::get<InsetDirection>(const std::string& key)
     }
 }
 
-template<> std::vector<double> Settings::get<std::vector<double>>(const std::string& key) const
+template<> std::vector<double> Settings::get<std::vector<double>>(const std::string& key, const size_t key_id) const
 {
-    const std::string& value_string = get<std::string>(key);
+    const std::string& value_string = *getCached(key, key_id).value;
 
     std::vector<double> result;
     if (value_string.empty())
@@ -599,9 +610,9 @@ template<> std::vector<double> Settings::get<std::vector<double>>(const std::str
     return result;
 }
 
-template<> std::vector<int> Settings::get<std::vector<int>>(const std::string& key) const
+template<> std::vector<int> Settings::get<std::vector<int>>(const std::string& key, const size_t key_id) const
 {
-    std::vector<double> values_doubles = get<std::vector<double>>(key);
+    std::vector<double> values_doubles = get<std::vector<double>>(key, key_id);
     std::vector<int> values_ints;
     values_ints.reserve(values_doubles.size());
     for (double value : values_doubles)
@@ -611,9 +622,9 @@ template<> std::vector<int> Settings::get<std::vector<int>>(const std::string& k
     return values_ints;
 }
 
-template<> std::vector<AngleDegrees> Settings::get<std::vector<AngleDegrees>>(const std::string& key) const
+template<> std::vector<AngleDegrees> Settings::get<std::vector<AngleDegrees>>(const std::string& key, const size_t key_id) const
 {
-    std::vector<double> values_doubles = get<std::vector<double>>(key);
+    std::vector<double> values_doubles = get<std::vector<double>>(key, key_id);
     return std::vector<AngleDegrees>(values_doubles.begin(), values_doubles.end()); //Cast them to AngleDegrees.
 }
 
@@ -637,23 +648,197 @@ bool Settings::has(const std::string& key) const
 void Settings::setParent(Settings* new_parent)
 {
     parent = new_parent;
+    invalidateCaches();
 }
 
-std::string Settings::getWithoutLimiting(const std::string& key) const
+void Settings::invalidateCaches()
 {
-    if (settings.find(key) != settings.end())
+    generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+size_t Settings::internKey(const std::string& key)
+{
+    //Each thread keeps its own copy of the IDs it has seen, so that looking up an ID doesn't need to lock.
+    thread_local std::unordered_map<std::string, size_t> local_ids;
+    const std::unordered_map<std::string, size_t>::const_iterator local_id = local_ids.find(key);
+    if (local_id != local_ids.end())
     {
-        return settings.at(key);
+        return local_id->second;
     }
-    else if (parent)
+
+    static std::mutex ids_mutex;
+    static std::unordered_map<std::string, size_t> ids;
+    size_t id;
     {
-        return parent->get<std::string>(key);
+        std::lock_guard<std::mutex> lock(ids_mutex);
+        id = ids.emplace(key, ids.size()).first->second;
     }
-    else
+    local_ids.emplace(key, id);
+    return id;
+}
+
+Settings::CachedValue Settings::getCached(const std::string& key, const size_t key_id) const
+{
+    const uint64_t current_generation = generation.load(std::memory_order_acquire);
+    CachedValue result;
+    if (cache.find(key_id, current_generation, result) && result.value) //A cached value without a string means that the setting has no value, which is an error here.
+    {
+        return result;
+    }
+
+    result.value = resolve(key);
+    if (! result.value)
     {
         logError("Trying to retrieve setting with no value given: '%s'\n", key.c_str());
         std::exit(2);
     }
+    result.number = atof(result.value->c_str());
+    cache.store(key_id, current_generation, result);
+    return result;
+}
+
+bool Settings::isResolvable(const std::string& key, const size_t key_id) const
+{
+    const uint64_t current_generation = generation.load(std::memory_order_acquire);
+    CachedValue result;
+    if (cache.find(key_id, current_generation, result))
+    {
+        return result.value != nullptr;
+    }
+
+    result.value = resolve(key);
+    result.number = result.value ? atof(result.value->c_str()) : 0.0;
+    cache.store(key_id, current_generation, result);
+    return result.value != nullptr;
+}
+
+const std::string* Settings::resolve(const std::string& key) const
+{
+    //If this settings base has a setting value for it, look that up.
+    const std::unordered_map<std::string, std::string>::const_iterator local = settings.find(key);
+    if (local != settings.end())
+    {
+        return &local->second;
+    }
+
+    const std::unordered_map<std::string, ExtruderTrain*>& limit_to_extruder = Application::getInstance().current_slice->scene.limit_to_extruder;
+    const std::unordered_map<std::string, ExtruderTrain*>::const_iterator limited = limit_to_extruder.find(key);
+    if (limited != limit_to_extruder.end())
+    {
+        return limited->second->settings.resolveWithoutLimiting(key);
+    }
+
+    if (parent)
+    {
+        return parent->resolve(key);
+    }
+    return nullptr;
+}
+
+const std::string* Settings::resolveWithoutLimiting(const std::string& key) const
+{
+    const std::unordered_map<std::string, std::string>::const_iterator local = settings.find(key);
+    if (local != settings.end())
+    {
+        return &local->second;
+    }
+    else if (parent)
+    {
+        return parent->resolve(key);
+    }
+    else
+    {
+        return nullptr;
+    }
+}
+
+Settings::ValueCache::ValueCache()
+{
+    for (std::atomic<Page*>& page : pages)
+    {
+        page.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+Settings::ValueCache::ValueCache(const ValueCache&) : ValueCache()
+{
+}
+
+Settings::ValueCache& Settings::ValueCache::operator=(const ValueCache&)
+{
+    clear();
+    return *this;
+}
+
+Settings::ValueCache::~ValueCache()
+{
+    clear();
+}
+
+void Settings::ValueCache::clear()
+{
+    for (std::atomic<Page*>& page : pages)
+    {
+        delete page.exchange(nullptr, std::memory_order_acq_rel);
+    }
+}
+
+bool Settings::ValueCache::find(const size_t key_id, const uint64_t generation, CachedValue& result) const
+{
+    if (key_id >= max_pages * page_size)
+    {
+        return false;
+    }
+    const Page* page = pages[key_id / page_size].load(std::memory_order_acquire);
+    if (! page)
+    {
+        return false;
+    }
+    const Entry& entry = page->entries[key_id % page_size];
+    if (entry.generation.load(std::memory_order_acquire) != generation)
+    {
+        return false;
+    }
+    result.value = entry.value.load(std::memory_order_relaxed);
+    result.number = entry.number.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return entry.generation.load(std::memory_order_relaxed) == generation; //Check that nobody started overwriting the entry while we read it.
+}
+
+void Settings::ValueCache::store(const size_t key_id, const uint64_t generation, const CachedValue& value)
+{
+    if (key_id >= max_pages * page_size)
+    {
+        return;
+    }
+    std::atomic<Page*>& page_slot = pages[key_id / page_size];
+    Page* page = page_slot.load(std::memory_order_acquire);
+    if (! page)
+    {
+        Page* new_page = new Page();
+        if (page_slot.compare_exchange_strong(page, new_page, std::memory_order_acq_rel))
+        {
+            page = new_page;
+        }
+        else //Another thread allocated the page first. Now page holds that one.
+        {
+            delete new_page;
+        }
+    }
+    Entry& entry = page->entries[key_id % page_size];
+    uint64_t previous = entry.generation.load(std::memory_order_relaxed);
+    if (previous == busy || previous >= generation) //Being written, or there's already an up-to-date value.
+    {
+        return;
+    }
+    if (! entry.generation.compare_exchange_strong(previous, busy, std::memory_order_acquire))
+    {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.value.store(value.value, std::memory_order_relaxed);
+    entry.number.store(value.number, std::memory_order_relaxed);
+    entry.generation.store(generation, std::memory_order_release);
 }
 
 }//namespace cura
@@ -13,14 +13,19 @@
 //Maximum number of infill layers that can be combined into a single infill extrusion area.
 #define MAX_INFILL_COMBINE 8
 
+#include <array>
+#include <atomic>
 #include <vector>
 #include <map>
 #include <unordered_map>
 #include <sstream>
+#include <string>
 
 namespace cura
 {
 
+template<typename T> class SettingKey;
+
 /*!
  * \brief Container for a set of settings.
  *
@@ -38,6 +43,19 @@ public:
      */
     Settings();
 
+    Settings(const Settings& other) = default;
+    Settings(Settings&& other) = default;
+
+    /*!
+     * \brief Replaces all settings with those of another container.
+     *
+     * Any values that were cached from the old settings are invalidated.
+     */
+    Settings& operator=(const Settings& other);
+    Settings& operator=(Settings&& other);
+
+    ~Settings();
+
     /*!
      * \brief Adds a new setting.
      * \param key The name by which the setting is identified.
@@ -64,7 +82,53 @@ public:
      * \param key The key of the setting to get.
      * \return The setting's value, cast to the desired type.
      */
-    template<typename A> A get(const std::string& key) const;
+    template<typename A> A get(const std::string& key) const
+    {
+        return get<A>(key, internKey(key));
+    }
+
+    /*!
+     * \brief Get the value of a setting through a pre-resolved handle.
+     *
+     * This is the same as the ``get`` function with a string key, but it
+     * doesn't need to construct or hash a string to find the setting. Use this
+     * in code that gets the same setting often.
+     * \param key The handle of the setting to get.
+     * \return The setting's value, cast to the type of the handle.
+     */
+    template<typename A> A get(const SettingKey<A>& key) const
+    {
+        return get<A>(key.name, key.id);
+    }
+
+    /*!
+     * \brief Get the value of a setting, or a default if no container in the
+     * inheritance structure has a value for it.
+     *
+     * This is meant for settings of the engine that the front-end may not know
+     * about. Unlike ``get``, a missing setting doesn't close the application.
+     * \param key The key of the setting to get.
+     * \param default_value The value to use if the setting has no value.
+     * \return The setting's value, cast to the desired type, or the default.
+     */
+    template<typename A> A getOrDefault(const std::string& key, const A& default_value) const
+    {
+        const size_t key_id = internKey(key);
+        return isResolvable(key, key_id) ? get<A>(key, key_id) : default_value;
+    }
+
+    /*!
+     * \brief Get the value of a setting through a pre-resolved handle, or a
+     * default if no container in the inheritance structure has a value for it.
+     * \param key The handle of the setting to get.
+     * \param default_value The value to use if the setting has no value.
+     * \return The setting's value, cast to the type of the handle, or the
+     * default.
+     */
+    template<typename A> A getOrDefault(const SettingKey<A>& key, const A& default_value) const
+    {
+        return isResolvable(key.name, key.id) ? get<A>(key.name, key.id) : default_value;
+    }
 
     /*!
      * \brief Get a string containing all settings in this container.
@@ -95,7 +159,114 @@ public:
      */
     void setParent(Settings* new_parent);
 
+    /*!
+     * \brief Invalidate the cached setting values of all settings containers.
+     *
+     * This must be called whenever the way settings are resolved changes
+     * without going through a settings container, such as when the
+     * limit_to_extruder map of the scene is changed.
+     */
+    static void invalidateCaches();
+
 private:
+    template<typename T> friend class SettingKey; //To intern the key of the handle.
+
+    /*!
+     * \brief Get the value of a setting whose key has been interned already.
+     * \param key The key of the setting to get.
+     * \param key_id The interned ID of the key.
+     * \return The setting's value, cast to the desired type.
+     */
+    template<typename A> A get(const std::string& key, const size_t key_id) const;
+
+    /*!
+     * \brief A setting value as it was resolved through the inheritance
+     * structure, along with the value parsed as number.
+     *
+     * The string is owned by the settings container in which the value was
+     * found.
+     */
+    struct CachedValue
+    {
+        const std::string* value;
+        double number;
+    };
+
+    /*!
+     * \brief Cache of the resolved setting values of a container, indexed by
+     * interned key.
+     *
+     * Lookups are lock-free so that the cache can be used from any thread. The
+     * entries are stamped with the generation of the settings in which they
+     * were resolved. Any change to any settings container starts a new
+     * generation, which invalidates all entries. Copies of a cache start out
+     * empty, since the entries of the original are only valid for the original
+     * container.
+     */
+    class ValueCache
+    {
+    public:
+        ValueCache();
+        ValueCache(const ValueCache&);
+        ValueCache& operator=(const ValueCache&);
+        ~ValueCache();
+
+        /*!
+         * \brief Get a cached value if it's valid in the given generation.
+         * \param key_id The interned key of the setting.
+         * \param generation The current generation of the settings.
+         * \param[out] result The cached value, if it was found.
+         * \return Whether a valid value was found.
+         */
+        bool find(const size_t key_id, const uint64_t generation, CachedValue& result) const;
+
+        /*!
+         * \brief Store a value that was resolved in the given generation.
+         *
+         * If another thread is storing the same entry at the same time, the
+         * value is simply not stored.
+         */
+        void store(const size_t key_id, const uint64_t generation, const CachedValue& value);
+
+    private:
+        static constexpr size_t page_size = 64;
+        static constexpr size_t max_pages = 256; //Keys beyond max_pages * page_size are not cached but still work.
+        static constexpr uint64_t busy = UINT64_MAX; //Generation marker of an entry that is being written.
+
+        struct Entry
+        {
+            std::atomic<uint64_t> generation { 0 }; //0 means never written.
+            std::atomic<const std::string*> value { nullptr };
+            std::atomic<double> number { 0.0 };
+        };
+
+        struct Page
+        {
+            std::array<Entry, page_size> entries;
+        };
+
+        /*!
+         * Pages of entries, allocated when the first value on them is stored.
+         */
+        std::array<std::atomic<Page*>, max_pages> pages;
+
+        void clear();
+    };
+
+    /*!
+     * \brief The generation of all settings. It increments whenever any
+     * setting changes, which invalidates the caches.
+     */
+    static std::atomic<uint64_t> generation;
+
+    /*!
+     * \brief Get the integer ID of a setting key.
+     *
+     * IDs are handed out in order of first use and stay the same for the
+     * lifetime of the application.
+     */
+    static size_t internKey(const std::string& key);
+
     /*!
      * Optionally, a parent setting container to ask for the value of a setting
      * if this container has no value for it.
@@ -108,15 +279,83 @@ private:
     std::unordered_map<std::string, std::string> settings;
 
     /*!
-     * \brief Get the value of a setting, but without looking at the limiting to
-     * extruder.
+     * \brief The values that were looked up through this container.
+     */
+    mutable ValueCache cache;
+
+    /*!
+     * \brief Get the resolved value of a setting, from the cache if possible.
      *
-     * This is the same as the normal ``get`` function, but skipping step 2 and
-     * only for strings.
+     * This goes through the same process as the ``get`` function. The value
+     * is parsed only once, when it is first resolved.
      * \param key The key of the setting to get.
+     * \param key_id The interned ID of the key.
      * \return The setting's value.
      */
-    std::string getWithoutLimiting(const std::string& key) const;
+    CachedValue getCached(const std::string& key, const size_t key_id) const;
+
+    /*!
+     * \brief Whether a setting has a value anywhere in the inheritance
+     * structure. That a setting has no value is cached as well.
+     * \param key The key of the setting to find.
+     * \param key_id The interned ID of the key.
+     * \return Whether ``get`` would find a value for the setting.
+     */
+    bool isResolvable(const std::string& key, const size_t key_id) const;
+
+    /*!
+     * \brief Find the value of a setting through the inheritance structure,
+     * without caching.
+     * \param key The key of the setting to find.
+     * \return The setting's value, or ``nullptr`` if it has no value.
+     */
+    const std::string* resolve(const std::string& key) const;
+
+    /*!
+     * \brief Find the value of a setting, but without looking at the limiting
+     * to extruder.
+     *
+     * This is the same as the normal ``resolve`` function, but skipping step 2.
+     * \param key The key of the setting to find.
+     * \return The setting's value, or ``nullptr`` if it has no value.
+     */
+    const std::string* resolveWithoutLimiting(const std::string& key) const;
+};
+
+/*!
+ * \brief A handle to get a setting without looking up its key every time.
+ *
+ * The key is interned once, when the handle is constructed. Declare handles as
+ * static so that this happens only once, e.g.:
+ *
+ *     static const SettingKey<coord_t> wall_line_width_0("wall_line_width_0");
+ *     const coord_t line_width = settings.get(wall_line_width_0);
+ *
+ * \tparam T The type to get the setting value as.
+ */
+template<typename T>
+class SettingKey
+{
+public:
+    /*!
+     * \brief Create a handle for a setting.
+     * \param name The key of the setting.
+     */
+    explicit SettingKey(const char* name)
+    : name(name)
+    , id(Settings::internKey(this->name))
+    {
+    }
+
+    /*!
+     * The key of the setting.
+     */
+    const std::string name;
+
+    /*!
+     * The interned ID of the key.
+     */
+    const size_t id;
 };
 
 } //namespace cura
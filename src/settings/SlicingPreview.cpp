@@ -0,0 +1,88 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For std::max.
+#include <string>
+
+#include "SlicingPreview.h"
+#include "../MeshGroup.h"
+#include "../Scene.h"
+#include "../utils/logoutput.h"
+
+namespace cura
+{
+
+namespace
+{
+
+/*!
+ * Make a length setting at least as coarse as a minimum, in one container.
+ * \param settings The container to change.
+ * \param key The setting to change.
+ * \param minimum The least value in microns.
+ * \param always Whether to add the setting to the container even if it
+ * doesn't have its own value, such as for the global settings.
+ */
+void coarsen(Settings& settings, const std::string& key, const coord_t minimum, const bool always)
+{
+    if (!always && !settings.has(key))
+    {
+        return; //Inherits the value from the parent, which is changed too.
+    }
+    const coord_t value = std::max(settings.get<coord_t>(key), minimum);
+    settings.add(key, std::to_string(INT2MM(value)));
+}
+
+/*!
+ * Change the settings of one container for a preview slice.
+ */
+void applyTo(Settings& settings, const bool always)
+{
+    coarsen(settings, "meshfix_maximum_deviation", SlicingPreview::preview_maximum_deviation, always);
+    coarsen(settings, "meshfix_maximum_resolution", SlicingPreview::preview_maximum_resolution, always);
+    coarsen(settings, "meshfix_maximum_travel_resolution", SlicingPreview::preview_maximum_travel_resolution, always);
+    if (always || settings.has("retraction_combing"))
+    {
+        settings.add("retraction_combing", "off");
+    }
+}
+
+}
+
+bool SlicingPreview::isEnabled(const Settings& settings)
+{
+    return settings.getOrDefault<bool>("slicing_preview", false);
+}
+
+coord_t SlicingPreview::getMaximumDeviation(const Settings& settings)
+{
+    const coord_t deviation = settings.get<coord_t>("meshfix_maximum_deviation");
+    return isEnabled(settings) ? std::max(deviation, preview_maximum_deviation) : deviation;
+}
+
+coord_t SlicingPreview::getMaximumResolution(const Settings& settings)
+{
+    const coord_t resolution = settings.get<coord_t>("meshfix_maximum_resolution");
+    return isEnabled(settings) ? std::max(resolution, preview_maximum_resolution) : resolution;
+}
+
+void SlicingPreview::apply(Scene& scene, MeshGroup& mesh_group)
+{
+    if (!isEnabled(mesh_group.settings))
+    {
+        return;
+    }
+    log("Slicing a preview with coarser outlines and no combing.\n");
+    applyTo(scene.settings, true);
+    for (ExtruderTrain& extruder : scene.extruders)
+    {
+        applyTo(extruder.settings, false);
+    }
+    applyTo(mesh_group.settings, false);
+    for (Mesh& mesh : mesh_group.meshes)
+    {
+        applyTo(mesh.settings, false);
+    }
+}
+
+} //namespace cura
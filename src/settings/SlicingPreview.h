@@ -0,0 +1,86 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef SETTINGS_SLICING_PREVIEW_H
+#define SETTINGS_SLICING_PREVIEW_H
+
+#include "../utils/Coord_t.h"
+
+namespace cura
+{
+
+class MeshGroup;
+class Scene;
+class Settings;
+
+/*!
+ * \brief Slicing at a lower fidelity, to quickly get estimates of the print
+ * time and material.
+ *
+ * With the setting slicing_preview, the meshes are decimated, all outlines are
+ * simplified more coarsely and travel moves don't comb. Less detailed outlines
+ * make every later stage faster, most of all the skeletal trapezoidation of the
+ * walls, whose cost grows with the number of vertices.
+ *
+ * The error of the estimates follows from what is changed:
+ * - The outlines move by at most \ref preview_maximum_deviation, so the
+ *   extruded area of a layer changes by at most that times the length of its
+ *   outlines, for every wall and the infill next to it.
+ * - Travel moves go straight instead of around the walls, so they are shorter
+ *   and retract more often. The travel time is usually a small part of the
+ *   total, but for prints with many small parts it can be off by the detours.
+ * - Details smaller than \ref preview_maximum_resolution may vanish, such as
+ *   thin pins that only get walls in the full slice.
+ */
+class SlicingPreview
+{
+public:
+    /*!
+     * The least deviation that outlines and meshes may be simplified by.
+     */
+    static constexpr coord_t preview_maximum_deviation = MM2INT(0.1);
+
+    /*!
+     * The least length below which line segments may be removed.
+     */
+    static constexpr coord_t preview_maximum_resolution = MM2INT(1.0);
+
+    /*!
+     * The least length below which travel moves may be simplified.
+     */
+    static constexpr coord_t preview_maximum_travel_resolution = MM2INT(2.0);
+
+    /*!
+     * Whether these settings ask for a preview slice.
+     */
+    static bool isEnabled(const Settings& settings);
+
+    /*!
+     * Get the deviation that a mesh may be decimated by.
+     * \param settings The settings of the mesh.
+     * \return The maximum deviation, which is coarser in a preview slice.
+     */
+    static coord_t getMaximumDeviation(const Settings& settings);
+
+    /*!
+     * Get the length of the edges that a mesh may collapse.
+     * \param settings The settings of the mesh.
+     * \return The maximum resolution, which is coarser in a preview slice.
+     */
+    static coord_t getMaximumResolution(const Settings& settings);
+
+    /*!
+     * Change the settings of the scene, its extruders, a mesh group and its
+     * meshes for a preview slice, if the mesh group asks for one.
+     *
+     * Settings are only made coarser, so applying this again for the next
+     * mesh group changes nothing more.
+     * \param scene The scene with the global and extruder settings.
+     * \param mesh_group The mesh group that is about to be sliced.
+     */
+    static void apply(Scene& scene, MeshGroup& mesh_group);
+};
+
+} //namespace cura
+
+#endif //SETTINGS_SLICING_PREVIEW_H
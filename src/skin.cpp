@@ -1,7 +1,11 @@
 //Copyright (c) 2021 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <cassert>
 #include <cmath> // std::ceil
+#ifdef _OPENMP
+    #include <omp.h>
+#endif // _OPENMP
 
 #include "Application.h" //To get settings.
 #include "Slice.h"
@@ -32,7 +36,100 @@ coord_t SkinInfillAreaComputation::getSkinLineWidth(const SliceMeshStorage& mesh
     return skin_line_width;
 }
 
-SkinInfillAreaComputation::SkinInfillAreaComputation(const LayerIndex& layer_nr, SliceMeshStorage& mesh, bool process_infill)
+LayerOutlineIntersections::LayerOutlineIntersections(const SliceMeshStorage& mesh, const size_t window_size, const bool compute_now)
+: mesh(mesh)
+, window_size(std::max(window_size, size_t(1)))
+, from_block_start(mesh.layers.size())
+, to_block_end(mesh.layers.size())
+{
+    if (!compute_now)
+    {
+        return;
+    }
+    const size_t block_count = getBlockCount();
+#pragma omp parallel for default(none) shared(block_count) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int block_idx = 0; block_idx < static_cast<int>(block_count); block_idx++)
+    {
+        computeBlock(block_idx);
+    }
+}
+
+void LayerOutlineIntersections::computeBlock(const size_t block_idx)
+{
+    const size_t block_start = block_idx * window_size;
+    const size_t block_end = std::min(block_start + window_size, mesh.layers.size()); //Exclusive.
+    std::vector<Polygons> outlines;
+    outlines.reserve(block_end - block_start);
+    for (size_t layer_nr = block_start; layer_nr < block_end; layer_nr++)
+    {
+        outlines.push_back(getLayerOutline(layer_nr));
+    }
+
+    from_block_start[block_start] = outlines.front();
+    for (size_t layer_nr = block_start + 1; layer_nr < block_end; layer_nr++)
+    {
+        from_block_start[layer_nr] = from_block_start[layer_nr - 1].intersection(outlines[layer_nr - block_start]);
+    }
+    to_block_end[block_end - 1] = std::move(outlines.back());
+    for (size_t layer_nr = block_end - 1; layer_nr > block_start; layer_nr--)
+    {
+        to_block_end[layer_nr - 1] = outlines[layer_nr - 1 - block_start].intersection(to_block_end[layer_nr]);
+    }
+}
+
+size_t LayerOutlineIntersections::getBlockSize() const
+{
+    return window_size;
+}
+
+size_t LayerOutlineIntersections::getBlockCount() const
+{
+    return (mesh.layers.size() + window_size - 1) / window_size;
+}
+
+Polygons LayerOutlineIntersections::get(const LayerIndex first_layer_nr, const LayerIndex last_layer_nr) const
+{
+    assert(first_layer_nr >= 0 && first_layer_nr <= last_layer_nr);
+    assert(static_cast<size_t>(last_layer_nr - first_layer_nr) < window_size);
+    if (last_layer_nr >= LayerIndex(mesh.layers.size()))
+    {
+        return Polygons(); //The layers above the mesh have no outline.
+    }
+    const size_t first_block = first_layer_nr / window_size;
+    const size_t last_block = last_layer_nr / window_size;
+    if (first_block != last_block)
+    {
+        return to_block_end[first_layer_nr].intersection(from_block_start[last_layer_nr]);
+    }
+    if (first_layer_nr % window_size == 0)
+    {
+        return from_block_start[last_layer_nr];
+    }
+    if (last_layer_nr % window_size == window_size - 1 || last_layer_nr == LayerIndex(mesh.layers.size()) - 1)
+    {
+        return to_block_end[first_layer_nr];
+    }
+    //The range lies in the middle of a block. Intersect the outlines one by one.
+    Polygons result = getLayerOutline(first_layer_nr);
+    for (LayerIndex layer_nr = first_layer_nr + 1; layer_nr <= last_layer_nr; layer_nr++)
+    {
+        result.intersectionInPlace(getLayerOutline(layer_nr));
+    }
+    return result;
+}
+
+Polygons LayerOutlineIntersections::getLayerOutline(const LayerIndex layer_nr) const
+{
+    Polygons result;
+    for (const SliceLayerPart& part : mesh.layers[layer_nr].parts)
+    {
+        result.add(part.outline);
+    }
+    return result;
+}
+
+SkinInfillAreaComputation::SkinInfillAreaComputation(const LayerIndex& layer_nr, SliceMeshStorage& mesh, bool process_infill, const LayerOutlineIntersections* layers_above, const LayerOutlineIntersections* layers_below)
 : layer_nr(layer_nr)
 , mesh(mesh)
 , bottom_layer_count(mesh.settings.get<size_t>("bottom_layers"))
@@ -45,6 +142,8 @@ SkinInfillAreaComputation::SkinInfillAreaComputation(const LayerIndex& layer_nr,
 , bottom_skin_preshrink(mesh.settings.get<coord_t>("bottom_skin_preshrink"))
 , top_skin_expand_distance(mesh.settings.get<coord_t>("top_skin_expand_distance"))
 , bottom_skin_expand_distance(mesh.settings.get<coord_t>("bottom_skin_expand_distance"))
+, layers_above(layers_above)
+, layers_below(layers_below)
 {
 }
 
@@ -62,12 +161,9 @@ Polygons SkinInfillAreaComputation::getOutlineOnLayer(const SliceLayerPart& part
         return result;
     }
     const SliceLayer& layer2 = mesh.layers[layer2_nr];
-    for (const SliceLayerPart& part2 : layer2.parts)
+    for (const size_t part2_idx : layer2.getPartsOverlapping(part_here.boundaryBox))
     {
-        if (part_here.boundaryBox.hit(part2.boundaryBox))
-        {
-            result.add(part2.outline);
-        }
+        result.add(layer2.parts[part2_idx].outline);
     }
     return result;
 }
@@ -86,13 +182,27 @@ void SkinInfillAreaComputation::generateSkinsAndInfill()
     generateSkinAndInfillAreas();
 
     SliceLayer* layer = &mesh.layers[layer_nr];
+    const size_t roofing_layer_count = std::min(mesh.settings.get<size_t>("roofing_layer_count"), mesh.settings.get<size_t>("top_layers"));
     for (unsigned int part_nr = 0; part_nr < layer->parts.size(); part_nr++)
     {
         SliceLayerPart& part = layer->parts[part_nr];
+        if (part.skin_parts.empty())
+        {
+            continue; //Both only change the skin parts.
+        }
 
-        generateRoofing(part);
+        //The areas without air above only depend on the part, so they are computed once for all of its skin parts.
+        const Polygons no_air_above_roofing = generateNoAirAbove(part, roofing_layer_count);
+        generateRoofing(part, no_air_above_roofing);
 
-        generateTopAndBottomMostSkinSurfaces(part);
+        if (roofing_layer_count == 1)
+        {
+            generateTopAndBottomMostSkinSurfaces(part, no_air_above_roofing);
+        }
+        else
+        {
+            generateTopAndBottomMostSkinSurfaces(part, generateNoAirAbove(part, 1));
+        }
     }
 }
 
@@ -177,12 +287,21 @@ void SkinInfillAreaComputation::calculateBottomSkin(const SliceLayerPart& part,
         return; // don't subtract anything form the downskin
     }
     LayerIndex bottom_check_start_layer_idx = std::max(LayerIndex(0), layer_nr - bottom_layer_count);
-    Polygons not_air = getOutlineOnLayer(part, bottom_check_start_layer_idx);
-    if (!no_small_gaps_heuristic)
+    Polygons not_air;
+    if (layers_below && !no_small_gaps_heuristic && bottom_check_start_layer_idx < layer_nr)
     {
-        for (int downskin_layer_nr = bottom_check_start_layer_idx + 1; downskin_layer_nr < layer_nr; downskin_layer_nr++)
+        //Includes the parts that don't overlap with this part, but those only add area outside of this part.
+        not_air = layers_below->get(bottom_check_start_layer_idx, layer_nr - 1);
+    }
+    else
+    {
+        not_air = getOutlineOnLayer(part, bottom_check_start_layer_idx);
+        if (!no_small_gaps_heuristic)
         {
-            not_air = not_air.intersection(getOutlineOnLayer(part, downskin_layer_nr));
+            for (int downskin_layer_nr = bottom_check_start_layer_idx + 1; downskin_layer_nr < layer_nr; downskin_layer_nr++)
+            {
+                not_air.intersectionInPlace(getOutlineOnLayer(part, downskin_layer_nr));
+            }
         }
     }
     const double min_infill_area = mesh.settings.get<double>("min_infill_area");
@@ -190,7 +309,7 @@ void SkinInfillAreaComputation::calculateBottomSkin(const SliceLayerPart& part,
     {
         not_air.removeSmallAreas(min_infill_area);
     }
-    downskin = downskin.difference(not_air); // skin overlaps with the walls
+    downskin = downskin.differenceBounded(not_air); // skin overlaps with the walls
 }
 
 void SkinInfillAreaComputation::calculateTopSkin(const SliceLayerPart& part, Polygons& upskin)
@@ -202,12 +321,21 @@ void SkinInfillAreaComputation::calculateTopSkin(const SliceLayerPart& part, Pol
         return;
     }
 
-    Polygons not_air = getOutlineOnLayer(part, layer_nr + top_layer_count);
-    if (!no_small_gaps_heuristic)
+    Polygons not_air;
+    if (layers_above && !no_small_gaps_heuristic)
+    {
+        //Includes the parts that don't overlap with this part, but those only add area outside of this part.
+        not_air = layers_above->get(layer_nr + 1, layer_nr + top_layer_count);
+    }
+    else
     {
-        for (int upskin_layer_nr = layer_nr + 1; upskin_layer_nr < layer_nr + top_layer_count; upskin_layer_nr++)
+        not_air = getOutlineOnLayer(part, layer_nr + top_layer_count);
+        if (!no_small_gaps_heuristic)
         {
-            not_air = not_air.intersection(getOutlineOnLayer(part, upskin_layer_nr));
+            for (int upskin_layer_nr = layer_nr + 1; upskin_layer_nr < layer_nr + top_layer_count; upskin_layer_nr++)
+            {
+                not_air.intersectionInPlace(getOutlineOnLayer(part, upskin_layer_nr));
+            }
         }
     }
 
@@ -217,7 +345,7 @@ void SkinInfillAreaComputation::calculateTopSkin(const SliceLayerPart& part, Pol
         not_air.removeSmallAreas(min_infill_area);
     }
 
-    upskin = upskin.difference(not_air); // skin overlaps with the walls
+    upskin = upskin.differenceBounded(not_air); // skin overlaps with the walls
 }
 
 /*
@@ -239,23 +367,23 @@ void SkinInfillAreaComputation::applySkinExpansion(const Polygons& original_outl
         {
             const Polygons expanded = downskin.offset(-min_width).offset(min_width + bottom_skin_expand_distance);
             // And then re-joined with the original part that was not offset, to retain parts smaller than min_width.
-            downskin = downskin.unionPolygons(expanded);
+            downskin.unionPolygonsInPlace(expanded);
         }
         if(top_skin_expand_distance != 0)
         {
             const Polygons expanded = upskin.offset(-min_width).offset(min_width + top_skin_expand_distance);
-            upskin = upskin.unionPolygons(expanded);
+            upskin.unionPolygonsInPlace(expanded);
         }
     }
     else // No need to pay attention to minimum width. Just expand.
     {
         if(bottom_skin_expand_distance != 0)
         {
-            downskin = downskin.offset(bottom_skin_expand_distance);
+            downskin.offsetInPlace(bottom_skin_expand_distance);
         }
         if(top_skin_expand_distance != 0)
         {
-            upskin = upskin.offset(top_skin_expand_distance);
+            upskin.offsetInPlace(top_skin_expand_distance);
         }
     }
 
@@ -265,22 +393,22 @@ void SkinInfillAreaComputation::applySkinExpansion(const Polygons& original_outl
     // Remove thin pieces of support for Skin Removal Width.
     if(bottom_skin_preshrink > 0 || (min_width == 0 && bottom_skin_expand_distance != 0))
     {
-        downskin = downskin.offset(-bottom_skin_preshrink / 2, ClipperLib::jtRound).offset(bottom_skin_preshrink / 2, ClipperLib::jtRound);
+        downskin.offsetInPlace(-bottom_skin_preshrink / 2, ClipperLib::jtRound).offsetInPlace(bottom_skin_preshrink / 2, ClipperLib::jtRound);
         should_bottom_be_clipped = true;  // Rounding errors can lead to propagation of errors. This could mean that skin goes beyond the original outline
     }
     if(top_skin_preshrink > 0 || (min_width == 0 && top_skin_expand_distance != 0))
     {
-        upskin = upskin.offset(-top_skin_preshrink / 2, ClipperLib::jtRound).offset(top_skin_preshrink / 2, ClipperLib::jtRound);
+        upskin.offsetInPlace(-top_skin_preshrink / 2, ClipperLib::jtRound).offsetInPlace(top_skin_preshrink / 2, ClipperLib::jtRound);
         should_top_be_clipped = true;  // Rounding errors can lead to propagation of errors. This could mean that skin goes beyond the original outline
     }
 
     if(should_bottom_be_clipped)
     {
-        downskin = downskin.intersection(original_outline);
+        downskin.intersectionInPlace(original_outline);
     }
     if(should_top_be_clipped)
     {
-        upskin = upskin.intersection(original_outline);
+        upskin.intersectionInPlace(original_outline);
     }
 }
 
@@ -302,16 +430,14 @@ void SkinInfillAreaComputation::generateInfill(SliceLayerPart& part, const Polyg
  *
  * this function may only read/write the skin and infill from the *current* layer.
  */
-void SkinInfillAreaComputation::generateRoofing(SliceLayerPart& part)
+void SkinInfillAreaComputation::generateRoofing(SliceLayerPart& part, const Polygons& no_air_above)
 {
-    const size_t roofing_layer_count = std::min(mesh.settings.get<size_t>("roofing_layer_count"), mesh.settings.get<size_t>("top_layers"));
-
+    const PolygonsBounds no_air_above_bounds(no_air_above);
     for(SkinPart& skin_part : part.skin_parts)
     {
-        Polygons no_air_above = generateNoAirAbove(part, roofing_layer_count);
-
-        skin_part.roofing_fill = skin_part.outline.difference(no_air_above);
-        skin_part.skin_fill = skin_part.outline.intersection(no_air_above);
+        const PolygonsBounds outline_bounds(skin_part.outline);
+        skin_part.roofing_fill = Polygons::differenceBounded(outline_bounds, no_air_above_bounds);
+        skin_part.skin_fill = Polygons::intersectionBounded(outline_bounds, no_air_above_bounds);
         // Insets are NOT generated for any layer if the top/bottom pattern is concentric.
         // In this case, we still want to generate insets for the roofing layers based on the extra skin wall count,
         // if the roofing pattern is not concentric.
@@ -320,9 +446,6 @@ void SkinInfillAreaComputation::generateRoofing(SliceLayerPart& part)
             && mesh.settings.get<EFillMethod>("roofing_pattern") != EFillMethod::CONCENTRIC
             && mesh.settings.get<EFillMethod>("top_bottom_pattern") == EFillMethod::CONCENTRIC)
         {
-            Polygons no_air_above = generateNoAirAbove(part, roofing_layer_count);
-            skin_part.roofing_fill = skin_part.outline.difference(no_air_above);
-            skin_part.skin_fill = skin_part.outline.intersection(no_air_above);
             const bool concentric_skinfill_pattern =
                    mesh.settings.get<EFillMethod>("roofing_pattern") == EFillMethod::CONCENTRIC
                 && mesh.settings.get<EFillMethod>("top_bottom_pattern") != EFillMethod::CONCENTRIC;
@@ -332,11 +455,11 @@ void SkinInfillAreaComputation::generateRoofing(SliceLayerPart& part)
             // but only if the roofing pattern is not concentric.
             if(!skin_part.roofing_fill.empty() && layer_nr > 0)
             {
-                // Regenerate the no_air_above, and recalculate the inner and roofing infills,
+                // Recalculate the inner and roofing infills,
                 // taking into account the extra skin wall count (only for the roofing layers).
                 if(!concentric_skinfill_pattern)
                 {
-                    regenerateRoofingFillAndInnerInfill(part, skin_part);
+                    regenerateRoofingFillAndInnerInfill(skin_part, no_air_above_bounds);
                 }
             }
             // On the contrary, unwanted insets are generated for roofing layers because of the non-concentric top/bottom pattern.
@@ -347,7 +470,7 @@ void SkinInfillAreaComputation::generateRoofing(SliceLayerPart& part)
                 // Clear the skin insets for the roofing layers and regenerate the roofing fill and inner infill without taking into
                 // account the Extra Skin Wall Count.
                 skin_part.inset_paths.clear();
-                regenerateRoofingFillAndInnerInfill(part, skin_part);
+                regenerateRoofingFillAndInnerInfill(skin_part, no_air_above_bounds);
             }
         }
     }
@@ -369,7 +492,7 @@ Polygons SkinInfillAreaComputation::generateNoAirAbove(SliceLayerPart& part, siz
         for (int layer_nr_above = layer_nr + 1; layer_nr_above < layer_nr + roofing_layer_count; layer_nr_above++)
         {
             Polygons outlines_above = getOutlineOnLayer(part, layer_nr_above);
-            no_air_above = no_air_above.intersection(outlines_above);
+            no_air_above.intersectionInPlace(outlines_above);
         }
     }
     if (layer_nr > 0)
@@ -385,7 +508,7 @@ Polygons SkinInfillAreaComputation::generateNoAirAbove(SliceLayerPart& part, siz
         if (!air_below.empty())
         {
             // add the polygons that have air below to the no air above polygons
-            no_air_above = no_air_above.unionPolygons(air_below);
+            no_air_above.unionPolygonsInPlace(air_below);
         }
     }
     return no_air_above;
@@ -413,7 +536,7 @@ Polygons SkinInfillAreaComputation::generateNoAirAbove(SliceLayerPart& part, siz
             for (int layer_nr_below = next_lowest_flooring_layer; layer_nr_below < layer_nr; layer_nr_below++)
             {
                 Polygons outlines_below = getOutlineOnLayer(part, layer_nr_below);
-                no_air_below = no_air_below.intersection(outlines_below);
+                no_air_below.intersectionInPlace(outlines_below);
             }
         }
         return no_air_below;
@@ -425,13 +548,11 @@ Polygons SkinInfillAreaComputation::generateNoAirAbove(SliceLayerPart& part, siz
  *
  * this function may only read/write the skin and infill from the *current* layer.
  */
-void SkinInfillAreaComputation::regenerateRoofingFillAndInnerInfill(SliceLayerPart& part, SkinPart& skin_part)
+void SkinInfillAreaComputation::regenerateRoofingFillAndInnerInfill(SkinPart& skin_part, const PolygonsBounds& no_air_above_bounds)
 {
-    const size_t roofing_layer_count = std::min(mesh.settings.get<size_t>("roofing_layer_count"), mesh.settings.get<size_t>("top_layers"));
-
-    Polygons no_air_above = generateNoAirAbove(part, roofing_layer_count);
-    skin_part.roofing_fill = skin_part.outline.difference(no_air_above);
-    skin_part.skin_fill = skin_part.outline.intersection(no_air_above);
+    const PolygonsBounds outline_bounds(skin_part.outline);
+    skin_part.roofing_fill = Polygons::differenceBounded(outline_bounds, no_air_above_bounds);
+    skin_part.skin_fill = Polygons::intersectionBounded(outline_bounds, no_air_above_bounds);
 }
 
 void SkinInfillAreaComputation::generateInfillSupport(SliceMeshStorage& mesh)
@@ -487,6 +608,7 @@ void SkinInfillAreaComputation::generateGradualInfill(SliceMeshStorage& mesh)
     // make gradual_infill_step_height divisible by layer_skip_count
     float n_skip_steps_per_gradual_step = std::max(1.0f, std::ceil(gradual_infill_step_layer_count / layer_skip_count)); // only decrease layer_skip_count to make it a divisor of gradual_infill_step_layer_count
     layer_skip_count = gradual_infill_step_layer_count / n_skip_steps_per_gradual_step;
+    const float upper_layer_skip_count = layer_skip_count;
     const size_t max_infill_steps = mesh.settings.get<size_t>("gradual_infill_steps");
 
     const LayerIndex min_layer = mesh.settings.get<size_t>("initial_bottom_layers");
@@ -495,7 +617,10 @@ void SkinInfillAreaComputation::generateGradualInfill(SliceMeshStorage& mesh)
     const auto infill_wall_count = mesh.settings.get<size_t>("infill_wall_line_count");
     const auto infill_wall_width = mesh.settings.get<coord_t>("infill_line_width");
     const auto infill_overlap = mesh.settings.get<coord_t>("infill_overlap_mm");
-    for (LayerIndex layer_idx = 0; layer_idx < static_cast<LayerIndex>(mesh.layers.size()); layer_idx++)
+    //Each layer only writes its own parts and reads the own infill areas of the layers above, so the layers can be processed in parallel.
+#pragma omp parallel for default(none) shared(mesh, upper_layer_skip_count, gradual_infill_step_layer_count, max_infill_steps, min_layer, max_layer, infill_wall_count, infill_wall_width, infill_overlap) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_idx = 0; layer_idx < static_cast<int>(mesh.layers.size()); layer_idx++)
     { // loop also over layers which don't contain infill cause of bottom_ and top_layer to initialize their infill_area_per_combine_per_density
         SliceLayer& layer = mesh.layers[layer_idx];
 
@@ -515,10 +640,10 @@ void SkinInfillAreaComputation::generateGradualInfill(SliceMeshStorage& mesh)
             Polygons less_dense_infill = infill_area; // one step less dense with each infill_step
             for (size_t infill_step = 0; infill_step < max_infill_steps; infill_step++)
             {
-                LayerIndex min_layer = layer_idx + infill_step * gradual_infill_step_layer_count + static_cast<size_t>(layer_skip_count);
+                LayerIndex min_layer = layer_idx + infill_step * gradual_infill_step_layer_count + static_cast<size_t>(upper_layer_skip_count);
                 LayerIndex max_layer = layer_idx + (infill_step + 1) * gradual_infill_step_layer_count;
 
-                for (float upper_layer_idx = min_layer; upper_layer_idx <= max_layer; upper_layer_idx += layer_skip_count)
+                for (float upper_layer_idx = min_layer; upper_layer_idx <= max_layer; upper_layer_idx += upper_layer_skip_count)
                 {
                     if (upper_layer_idx >= mesh.layers.size())
                     {
@@ -527,15 +652,11 @@ void SkinInfillAreaComputation::generateGradualInfill(SliceMeshStorage& mesh)
                     }
                     const SliceLayer& upper_layer = mesh.layers[static_cast<size_t>(upper_layer_idx)];
                     Polygons relevent_upper_polygons;
-                    for (const SliceLayerPart& upper_layer_part : upper_layer.parts)
+                    for (const size_t upper_part_idx : upper_layer.getPartsOverlapping(part.boundaryBox))
                     {
-                        if (!upper_layer_part.boundaryBox.hit(part.boundaryBox))
-                        {
-                            continue;
-                        }
-                        relevent_upper_polygons.add(upper_layer_part.getOwnInfillArea());
+                        relevent_upper_polygons.add(upper_layer.parts[upper_part_idx].getOwnInfillArea());
                     }
-                    less_dense_infill = less_dense_infill.intersection(relevent_upper_polygons);
+                    less_dense_infill.intersectionInPlace(relevent_upper_polygons);
                 }
                 if (less_dense_infill.empty())
                 {
@@ -550,10 +671,21 @@ void SkinInfillAreaComputation::generateGradualInfill(SliceMeshStorage& mesh)
             part.infill_area_per_combine_per_density.emplace_back();
             std::vector<Polygons>& infill_area_per_combine_current_density = part.infill_area_per_combine_per_density.back();
             infill_area_per_combine_current_density.push_back(infill_area);
-            part.infill_area_own = std::nullopt; // clear infill_area_own, it's not needed any more.
             assert(!part.infill_area_per_combine_per_density.empty() && "infill_area_per_combine_per_density is now initialized");
         }
     }
+
+    //Only clear the own infill areas once all layers are done, since the layers below still read them.
+    for (SliceLayer& layer : mesh.layers)
+    {
+        for (SliceLayerPart& part : layer.parts)
+        {
+            if (! part.infill_area_per_combine_per_density.back().back().empty()) //Only the parts that got gradual infill, whose sparsest area is their infill area.
+            {
+                part.infill_area_own = std::nullopt; // clear infill_area_own, it's not needed any more.
+            }
+        }
+    }
 }
 
 void SkinInfillAreaComputation::combineInfillLayers(SliceMeshStorage& mesh)
@@ -579,8 +711,13 @@ void SkinInfillAreaComputation::combineInfillLayers(SliceMeshStorage& mesh)
     min_layer -= min_layer % amount; //Round upwards to the nearest layer divisible by infill_sparse_combine.
     LayerIndex max_layer = static_cast<LayerIndex>(mesh.layers.size()) - 1 - mesh.settings.get<size_t>("top_layers");
     max_layer -= max_layer % amount; //Round downwards to the nearest layer divisible by infill_sparse_combine.
-    for(LayerIndex layer_idx = min_layer; layer_idx <= max_layer; layer_idx += amount) //Skip every few layers, but extrude more.
+    const int group_count = (max_layer >= min_layer) ? (max_layer - min_layer) / amount + 1 : 0;
+    //Each layer combines the infill of the layers below it up to the previous combined layer, so each changes a separate group of layers and they can be processed in parallel.
+#pragma omp parallel for default(none) shared(mesh, amount, min_layer, group_count) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for(int group_idx = 0; group_idx < group_count; group_idx++) //Skip every few layers, but extrude more.
     {
+        const LayerIndex layer_idx = min_layer + group_idx * amount;
         SliceLayer* layer = &mesh.layers[layer_idx];
         for(size_t combine_count_here = 1; combine_count_here < amount; combine_count_here++)
         {
@@ -597,36 +734,34 @@ void SkinInfillAreaComputation::combineInfillLayers(SliceMeshStorage& mesh)
             SliceLayer* lower_layer = &mesh.layers[lower_layer_idx];
             for (SliceLayerPart& part : layer->parts)
             {
+                const std::vector<size_t> lower_part_indices = lower_layer->getPartsOverlapping(part.boundaryBox);
                 for (unsigned int density_idx = 0; density_idx < part.infill_area_per_combine_per_density.size(); density_idx++)
                 { // go over each density of gradual infill (these density areas overlap!)
                     std::vector<Polygons>& infill_area_per_combine = part.infill_area_per_combine_per_density[density_idx];
                     Polygons result;
-                    for (SliceLayerPart& lower_layer_part : lower_layer->parts)
+                    for (const size_t lower_part_idx : lower_part_indices)
                     {
-                        if (part.boundaryBox.hit(lower_layer_part.boundaryBox))
+                        SliceLayerPart& lower_layer_part = lower_layer->parts[lower_part_idx];
+                        Polygons intersection = infill_area_per_combine[combine_count_here - 1].intersection(lower_layer_part.infill_area).offset(-200).offset(200);
+                        result.add(intersection); // add area to be thickened
+                        infill_area_per_combine[combine_count_here - 1] = infill_area_per_combine[combine_count_here - 1].difference(intersection); // remove thickened area from less thick layer here
+                        unsigned int max_lower_density_idx = density_idx;
+                        // Generally: remove only from *same density* areas on layer below
+                        // If there are no same density areas, then it's ok to print them anyway
+                        // Don't remove other density areas
+                        if (density_idx == part.infill_area_per_combine_per_density.size() - 1)
                         {
-
-                            Polygons intersection = infill_area_per_combine[combine_count_here - 1].intersection(lower_layer_part.infill_area).offset(-200).offset(200);
-                            result.add(intersection); // add area to be thickened
-                            infill_area_per_combine[combine_count_here - 1] = infill_area_per_combine[combine_count_here - 1].difference(intersection); // remove thickened area from less thick layer here
-                            unsigned int max_lower_density_idx = density_idx;
-                            // Generally: remove only from *same density* areas on layer below
-                            // If there are no same density areas, then it's ok to print them anyway
-                            // Don't remove other density areas
-                            if (density_idx == part.infill_area_per_combine_per_density.size() - 1)
-                            {
-                                // For the most dense areas on a given layer the density of that area is doubled.
-                                // This means that - if the lower layer has more densities -
-                                // all those lower density lines are included in the most dense of this layer.
-                                // We therefore compare the most dense are on this layer with all densities
-                                // of the lower layer with the same or higher density index
-                                max_lower_density_idx = lower_layer_part.infill_area_per_combine_per_density.size() - 1;
-                            }
-                            for (size_t lower_density_idx = density_idx; lower_density_idx <= max_lower_density_idx && lower_density_idx < lower_layer_part.infill_area_per_combine_per_density.size(); lower_density_idx++)
-                            {
-                                std::vector<Polygons>& lower_infill_area_per_combine = lower_layer_part.infill_area_per_combine_per_density[lower_density_idx];
-                                lower_infill_area_per_combine[0] = lower_infill_area_per_combine[0].difference(intersection); // remove thickened area from lower (single thickness) layer
-                            }
+                            // For the most dense areas on a given layer the density of that area is doubled.
+                            // This means that - if the lower layer has more densities -
+                            // all those lower density lines are included in the most dense of this layer.
+                            // We therefore compare the most dense are on this layer with all densities
+                            // of the lower layer with the same or higher density index
+                            max_lower_density_idx = lower_layer_part.infill_area_per_combine_per_density.size() - 1;
+                        }
+                        for (size_t lower_density_idx = density_idx; lower_density_idx <= max_lower_density_idx && lower_density_idx < lower_layer_part.infill_area_per_combine_per_density.size(); lower_density_idx++)
+                        {
+                            std::vector<Polygons>& lower_infill_area_per_combine = lower_layer_part.infill_area_per_combine_per_density[lower_density_idx];
+                            lower_infill_area_per_combine[0].differenceInPlace(intersection); // remove thickened area from lower (single thickness) layer
                         }
                     }
 
@@ -644,13 +779,12 @@ void SkinInfillAreaComputation::combineInfillLayers(SliceMeshStorage& mesh)
  * this function may only read/write the skin and infill from the *current* layer.
  */
 
-void SkinInfillAreaComputation::generateTopAndBottomMostSkinSurfaces(SliceLayerPart &part) {
+void SkinInfillAreaComputation::generateTopAndBottomMostSkinSurfaces(SliceLayerPart &part, const Polygons& no_air_above) {
 
+    const Polygons no_air_below = generateNoAirBelow(part, 1);
     for (SkinPart& skin_part : part.skin_parts) {
-        Polygons no_air_above = generateNoAirAbove(part, 1);
         skin_part.top_most_surface_fill = skin_part.outline.difference(no_air_above);
 
-        Polygons no_air_below = generateNoAirBelow(part, 1);
         skin_part.bottom_most_surface_fill = skin_part.skin_fill.difference(no_air_below);
     }
 }
@@ -4,17 +4,91 @@
 #ifndef SKIN_H
 #define SKIN_H
 
+#include <vector>
+
 #include "settings/types/LayerIndex.h"
 #include "utils/Coord_t.h"
+#include "utils/polygon.h"
 
 namespace cura 
 {
 
-class Polygons;
 class SkinPart;
 class SliceLayerPart;
 class SliceMeshStorage;
 
+/*!
+ * \brief The intersections of the outlines of a range of consecutive layers of
+ * a mesh, for ranges up to a fixed number of layers.
+ *
+ * Computing the skin needs the intersection of the outlines of the next or
+ * previous N layers. Doing that for every layer separately intersects each
+ * outline N times. Instead, the layers are divided into blocks of N layers.
+ * For every layer, this stores the intersection from the start of its block
+ * up to that layer, and from that layer up to the end of its block. Any range
+ * of N layers spans at most two blocks, so its intersection is a single
+ * intersection of two stored areas. Computing all of them takes about two
+ * intersections per layer, regardless of N.
+ */
+class LayerOutlineIntersections
+{
+public:
+    /*!
+     * \brief Compute the intersections for a mesh.
+     * \param mesh The mesh of which to intersect the layer outlines.
+     * \param window_size The maximum number of layers in a range that will be
+     * requested.
+     * \param compute_now Whether to compute the intersections of all blocks
+     * right away. If not, each block has to be computed with
+     * \ref computeBlock before ranges in it can be requested.
+     */
+    LayerOutlineIntersections(const SliceMeshStorage& mesh, const size_t window_size, const bool compute_now = true);
+
+    /*!
+     * \brief Compute the intersections of one block of layers.
+     *
+     * This only reads the outlines of the layers in the block, so it can be
+     * done as soon as those are final. Different blocks may be computed at
+     * the same time.
+     * \param block_idx The block to compute. Block \p i contains the layers
+     * from ``i * window_size`` up to ``(i + 1) * window_size``.
+     */
+    void computeBlock(const size_t block_idx);
+
+    /*!
+     * The number of layers in each block.
+     */
+    size_t getBlockSize() const;
+
+    /*!
+     * The number of blocks that the layers are divided into.
+     */
+    size_t getBlockCount() const;
+
+    /*!
+     * \brief Get the intersection of the outlines of a range of layers.
+     *
+     * Layers above the top of the mesh have no outline, so if the range
+     * extends past the top the intersection is empty.
+     * \param first_layer_nr The first layer of the range.
+     * \param last_layer_nr The last layer of the range, inclusive. The range
+     * may not contain more than the window size of layers.
+     * \return The area that is inside the outline on every layer of the range.
+     */
+    Polygons get(const LayerIndex first_layer_nr, const LayerIndex last_layer_nr) const;
+
+private:
+    const SliceMeshStorage& mesh; //!< The mesh of which to intersect the outlines.
+    const size_t window_size; //!< The number of layers in each block.
+    std::vector<Polygons> from_block_start; //!< For each layer, the intersection of the outlines from the start of its block up to and including that layer.
+    std::vector<Polygons> to_block_end; //!< For each layer, the intersection of the outlines from that layer up to and including the end of its block.
+
+    /*!
+     * Get the outline of all parts on a layer.
+     */
+    Polygons getLayerOutline(const LayerIndex layer_nr) const;
+};
+
 /*!
  * Class containing all skin and infill area computation functions
  */
@@ -31,8 +105,14 @@ public:
      * stored and where the skin insets and fill areas (output) are stored.
      * \param process_infill Whether to process infill, i.e. whether there's a
      * positive infill density or there are infill meshes modifying this mesh.
+     * \param layers_above Precomputed intersections of the outlines of the
+     * layers above, to compute the top skin with. If not given, they are
+     * computed for this layer only.
+     * \param layers_below Precomputed intersections of the outlines of the
+     * layers below, to compute the bottom skin with. If not given, they are
+     * computed for this layer only.
      */
-    SkinInfillAreaComputation(const LayerIndex& layer_nr, SliceMeshStorage& mesh, bool process_infill);
+    SkinInfillAreaComputation(const LayerIndex& layer_nr, SliceMeshStorage& mesh, bool process_infill, const LayerOutlineIntersections* layers_above = nullptr, const LayerOutlineIntersections* layers_below = nullptr);
 
     /*!
      * Generate the skin areas and its insets.
@@ -132,8 +212,10 @@ protected:
      * save them in the \ref SkinPart::roofing_fill of the \p part.
      * 
      * \param[in,out] part Where to get the SkinParts to get the outline info from and to store the roofing areas
+     * \param no_air_above The areas that are not under air within the roofing layers, as given by
+     * \ref generateNoAirAbove for the \p part.
      */
-    void generateRoofing(SliceLayerPart& part);
+    void generateRoofing(SliceLayerPart& part, const Polygons& no_air_above);
 
     /*!
      * Remove the areas which are directly under air in the top-most surface and directly above air in bottom-most
@@ -142,8 +224,10 @@ protected:
      *
      * \param[in,out] part Where to get the SkinParts to get the outline info from and to store the top and bottom-most
      * infill areas
+     * \param no_air_above The areas that are not directly under air, as given by \ref generateNoAirAbove for the
+     * \p part with a single layer.
      */
-    void generateTopAndBottomMostSkinSurfaces(SliceLayerPart& part);
+    void generateTopAndBottomMostSkinSurfaces(SliceLayerPart& part, const Polygons& no_air_above);
 
     /*!
      * Helper function to calculate and return the areas which are 'directly' under air.
@@ -165,11 +249,11 @@ protected:
      * Helper function to recalculate the roofing fill and inner infill in roofing layers where the 
      * insets have to be changed.
      *
-     * \param part Where to get the SkinParts to get the outline info from
      * \param skin_part The part where the skin outline information (input) is stored and
      * where the inner infill and roofing infill areas (output) is stored.
+     * \param no_air_above_bounds The areas that are not under air within the roofing layers.
      */
-    void regenerateRoofingFillAndInnerInfill(SliceLayerPart& part, SkinPart& skin_part);
+    void regenerateRoofingFillAndInnerInfill(SkinPart& skin_part, const PolygonsBounds& no_air_above_bounds);
 
 protected:
     LayerIndex layer_nr; //!< The index of the layer for which to generate the skins and infill.
@@ -187,6 +271,8 @@ protected:
     coord_t bottom_skin_preshrink; //!< The bottom skin removal width, to remove thin strips of skin along nearly-vertical walls.
     coord_t top_skin_expand_distance; //!< The distance by which the top skins should be larger than the original top skins.
     coord_t bottom_skin_expand_distance; //!< The distance by which the bottom skins should be larger than the original bottom skins.
+    const LayerOutlineIntersections* layers_above; //!< Precomputed intersections of the outlines above this layer, if any.
+    const LayerOutlineIntersections* layers_below; //!< Precomputed intersections of the outlines below this layer, if any.
 private:
     static coord_t getSkinLineWidth(const SliceMeshStorage& mesh, const LayerIndex& layer_nr); //!< Compute the skin line width, which might be different for the first layer.
 
@@ -1,6 +1,9 @@
 //Copyright (c) 2022 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For std::max and std::all_of.
+#include <cassert>
+
 #include "Application.h" //To get settings.
 #include "ExtruderTrain.h"
 #include "FffProcessor.h" //To create a mesh group with if none is provided.
@@ -11,27 +14,83 @@
 #include "infill/SierpinskiFillProvider.h"
 #include "infill/SubDivCube.h" // For the destructor
 #include "infill/DensityProvider.h" // for destructor
+#include "infill/InfillCache.h"
+#include "pathPlanning/CombPathCache.h"
+#include "settings/PathConfigStorage.h"
 #include "utils/math.h" //For PI.
 #include "utils/logoutput.h"
+#include "utils/MemoryUsage.h"
 
 
 namespace cura
 {
 
+namespace
+{
+
+size_t getMemoryUsage(const Polygons& polygons)
+{
+    size_t bytes = 0;
+    for (const ClipperLib::Path& path : polygons)
+    {
+        bytes += path.capacity() * sizeof(Point);
+    }
+    return bytes;
+}
+
+size_t getMemoryUsage(const std::vector<VariableWidthLines>& toolpaths)
+{
+    size_t bytes = 0;
+    for (const VariableWidthLines& inset : toolpaths)
+    {
+        for (const ExtrusionLine& line : inset)
+        {
+            bytes += line.junctions.capacity() * sizeof(ExtrusionJunction);
+        }
+    }
+    return bytes;
+}
+
+size_t getMemoryUsage(const std::vector<std::vector<Polygons>>& areas_per_combine_per_density)
+{
+    size_t bytes = 0;
+    for (const std::vector<Polygons>& areas_per_combine : areas_per_combine_per_density)
+    {
+        for (const Polygons& areas : areas_per_combine)
+        {
+            bytes += getMemoryUsage(areas);
+        }
+    }
+    return bytes;
+}
+
+} //Anonymous namespace.
+
+size_t StorageMemoryUsage::total() const
+{
+    return parts + wall_toolpaths + skin_parts + infill_areas + support_layers;
+}
+
+StorageMemoryUsage& StorageMemoryUsage::operator+=(const StorageMemoryUsage& other)
+{
+    parts += other.parts;
+    wall_toolpaths += other.wall_toolpaths;
+    skin_parts += other.skin_parts;
+    infill_areas += other.infill_areas;
+    support_layers += other.support_layers;
+    return *this;
+}
+
 SupportStorage::SupportStorage()
 : generated(false)
 , layer_nr_max_filled_layer(-1)
-, cross_fill_provider(nullptr)
+, infill_cache(std::make_shared<InfillCache>())
 {
 }
 
 SupportStorage::~SupportStorage()
 {
     supportLayers.clear(); 
-    if (cross_fill_provider)
-    {
-        delete cross_fill_provider;
-    }
 }
 
 Polygons& SliceLayerPart::getOwnInfillArea()
@@ -66,8 +125,76 @@ bool SliceLayerPart::hasWallAtInsetIndex(size_t inset_idx) const
     return false;
 }
 
+SliceLayerPart::SliceLayerPart(std::pmr::memory_resource* memory)
+: compact_wall_toolpaths(memory)
+{
+}
+
+void SliceLayerPart::compactWallToolpaths()
+{
+    if (compact_wall_toolpaths.compact(wall_toolpaths))
+    {
+        wall_toolpaths = std::vector<VariableWidthLines>();
+    }
+}
+
+size_t SliceLayerPart::getWallToolpathInsetCount() const
+{
+    return wall_toolpaths.empty() ? compact_wall_toolpaths.size() : wall_toolpaths.size();
+}
+
 SliceLayer::~SliceLayer()
 {
+    parts.clear(); //The parts give their memory back to the pool, so they must go first.
+}
+
+std::pmr::memory_resource* SliceLayer::getMemoryResource()
+{
+    return memory.resource.get();
+}
+
+void SliceLayer::releaseMemory()
+{
+    assert(std::all_of(parts.begin(), parts.end(), [](const SliceLayerPart& part) { return part.compact_wall_toolpaths.empty(); }));
+    memory.resource->release();
+}
+
+SliceLayer::MemoryPool::MemoryPool()
+: resource(std::make_unique<std::pmr::unsynchronized_pool_resource>())
+{
+}
+
+SliceLayer::MemoryPool::MemoryPool(const MemoryPool&)
+: MemoryPool()
+{
+}
+
+SliceLayer::MemoryPool& SliceLayer::MemoryPool::operator=(const MemoryPool&)
+{
+    return *this; //Keep our own pool, since the parts that were already allocated from it still need it.
+}
+
+StorageMemoryUsage SliceLayer::getMemoryUsage() const
+{
+    StorageMemoryUsage usage;
+    for (const SliceLayerPart& part : parts)
+    {
+        usage.parts += cura::getMemoryUsage(part.outline) + cura::getMemoryUsage(part.print_outline) + cura::getMemoryUsage(part.spiral_wall) + cura::getMemoryUsage(part.inner_area);
+        usage.wall_toolpaths += cura::getMemoryUsage(part.wall_toolpaths) + part.compact_wall_toolpaths.getMemoryUsage() + cura::getMemoryUsage(part.infill_wall_toolpaths);
+        for (const SkinPart& skin_part : part.skin_parts)
+        {
+            usage.skin_parts += cura::getMemoryUsage(skin_part.outline) + cura::getMemoryUsage(skin_part.inset_paths)
+                + cura::getMemoryUsage(skin_part.skin_fill) + cura::getMemoryUsage(skin_part.roofing_fill)
+                + cura::getMemoryUsage(skin_part.top_most_surface_fill) + cura::getMemoryUsage(skin_part.bottom_most_surface_fill);
+        }
+        usage.infill_areas += cura::getMemoryUsage(part.infill_area) + cura::getMemoryUsage(part.infill_area_per_combine_per_density);
+        if (part.infill_area_own)
+        {
+            usage.infill_areas += cura::getMemoryUsage(*part.infill_area_own);
+        }
+    }
+    usage.parts += cura::getMemoryUsage(top_surface.areas);
+    return usage;
 }
 
 Polygons SliceLayer::getOutlines(bool external_polys_only) const
@@ -92,14 +219,43 @@ void SliceLayer::getOutlines(Polygons& result, bool external_polys_only) const
     }
 }
 
+void SliceLayer::indexParts()
+{
+    std::vector<AABB> part_boxes;
+    part_boxes.reserve(parts.size());
+    for (const SliceLayerPart& part : parts)
+    {
+        part_boxes.push_back(part.boundaryBox);
+    }
+    part_grid = BoxGrid(part_boxes);
+}
+
+std::vector<size_t> SliceLayer::getPartsOverlapping(const AABB& box) const
+{
+    if (part_grid.size() == parts.size())
+    {
+        return part_grid.getOverlapping(box);
+    }
+    std::vector<size_t> result;
+    for (size_t part_idx = 0; part_idx < parts.size(); part_idx++)
+    {
+        if (parts[part_idx].boundaryBox.hit(box))
+        {
+            result.push_back(part_idx);
+        }
+    }
+    return result;
+}
+
 SliceMeshStorage::SliceMeshStorage(Mesh* mesh, const size_t slice_layer_count)
 : settings(mesh->settings)
 , mesh_name(mesh->mesh_name)
 , layer_nr_max_filled_layer(0)
 , bounding_box(mesh->getAABB())
 , base_subdiv_cube(nullptr)
-, cross_fill_provider(nullptr)
 , lightning_generator(nullptr)
+, infill_cache(std::make_shared<InfillCache>())
+, instance_offset(0, 0)
 {
     layers.resize(slice_layer_count);
 }
@@ -110,10 +266,6 @@ SliceMeshStorage::~SliceMeshStorage()
     {
         delete base_subdiv_cube;
     }
-    if (cross_fill_provider)
-    {
-        delete cross_fill_provider;
-    }
     if (lightning_generator)
     {
         delete lightning_generator;
@@ -289,6 +441,7 @@ SliceDataStorage::SliceDataStorage()
 , retraction_config_per_extruder(initializeRetractionConfigs())
 , extruder_switch_retraction_config_per_extruder(initializeRetractionConfigs())
 , max_print_height_second_to_last_extruder(-1)
+, comb_path_cache(std::make_shared<CombPathCache>())
 {
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
     Point3 machine_max(mesh_group_settings.get<coord_t>("machine_width"), mesh_group_settings.get<coord_t>("machine_depth"), mesh_group_settings.get<coord_t>("machine_height"));
@@ -304,7 +457,234 @@ SliceDataStorage::SliceDataStorage()
     std::fill(skirt_brim_max_locked_part_order, skirt_brim_max_locked_part_order + MAX_EXTRUDERS, 0);
 }
 
+void SliceDataStorage::releaseLayerPlanningData(const LayerIndex layer_nr)
+{
+    if (layer_nr < 0)
+    {
+        return; //Raft layers don't have any mesh or support data.
+    }
+    for (SliceMeshStorage& mesh : meshes)
+    {
+        if (layer_nr >= static_cast<int>(mesh.layers.size()))
+        {
+            continue;
+        }
+        SliceLayer& layer = mesh.layers[layer_nr];
+        for (SliceLayerPart& part : layer.parts)
+        {
+            part.wall_toolpaths.clear();
+            part.compact_wall_toolpaths.clear();
+            part.infill_wall_toolpaths.clear();
+            part.infill_area_per_combine_per_density.clear();
+            for (SkinPart& skin_part : part.skin_parts)
+            {
+                skin_part.inset_paths.clear();
+                skin_part.skin_fill.clear();
+                skin_part.roofing_fill.clear();
+                skin_part.top_most_surface_fill.clear();
+                skin_part.bottom_most_surface_fill.clear();
+            }
+        }
+        layer.top_surface.areas.clear();
+        layer.releaseMemory();
+    }
+    if (layer_nr < static_cast<int>(support.supportLayers.size()) && support.supportLayers.isAllocated(layer_nr))
+    {
+        for (SupportInfillPart& support_infill_part : support.supportLayers[layer_nr].support_infill_parts)
+        {
+            support_infill_part.wall_toolpaths.clear();
+            support_infill_part.infill_area_per_combine_per_density.clear();
+        }
+    }
+}
+
+void SliceDataStorage::spillWallToolpaths(const std::string& directory)
+{
+    spill_file = std::make_unique<SpillFile>(directory);
+    std::vector<char> buffer;
+    for (SliceMeshStorage& mesh : meshes)
+    {
+        for (SliceLayer& layer : mesh.layers)
+        {
+            for (SliceLayerPart& part : layer.parts)
+            {
+                if (part.wall_toolpaths.empty() && part.compact_wall_toolpaths.empty())
+                {
+                    continue;
+                }
+                CompactVariableWidthLines compact_toolpaths;
+                const CompactVariableWidthLines* to_spill = &part.compact_wall_toolpaths;
+                if (!part.wall_toolpaths.empty())
+                {
+                    if (!compact_toolpaths.compact(part.wall_toolpaths))
+                    {
+                        continue; //Doesn't fit in the compact form, so keep it in memory.
+                    }
+                    to_spill = &compact_toolpaths;
+                }
+                buffer.clear();
+                to_spill->serialize(buffer);
+                const std::optional<SpillFile::Block> block = spill_file->write(buffer);
+                if (block)
+                {
+                    part.spilled_wall_toolpaths = block;
+                    part.wall_toolpaths = std::vector<VariableWidthLines>();
+                    part.compact_wall_toolpaths.clear();
+                }
+            }
+            if (std::all_of(layer.parts.begin(), layer.parts.end(), [](const SliceLayerPart& part) { return part.compact_wall_toolpaths.empty(); }))
+            {
+                layer.releaseMemory(); //Everything was spilled, so the pool of the layer can be given back.
+            }
+        }
+    }
+    spill_file->finishWriting();
+}
+
+void SliceDataStorage::loadSpilledWallToolpaths(const LayerIndex layer_nr)
+{
+    if (!spill_file || !spill_file->canRead() || layer_nr < 0)
+    {
+        return;
+    }
+    for (SliceMeshStorage& mesh : meshes)
+    {
+        if (layer_nr >= static_cast<int>(mesh.layers.size()))
+        {
+            continue;
+        }
+        for (SliceLayerPart& part : mesh.layers[layer_nr].parts)
+        {
+            if (part.spilled_wall_toolpaths)
+            {
+                part.compact_wall_toolpaths.deserialize(spill_file->read(*part.spilled_wall_toolpaths), part.spilled_wall_toolpaths->size);
+                part.spilled_wall_toolpaths.reset();
+            }
+        }
+    }
+}
+
+void SliceDataStorage::logMemoryUsage(const char* stage) const
+{
+    if (getVerboseLevel() < 1) //It's logged with log(). Don't go through all of the geometry for nothing.
+    {
+        return;
+    }
+
+    size_t layer_count = support.supportLayers.size();
+    for (const SliceMeshStorage& mesh : meshes)
+    {
+        layer_count = std::max(layer_count, mesh.layers.size());
+    }
+
+    StorageMemoryUsage total;
+    size_t largest_layer_bytes = 0;
+    LayerIndex largest_layer_nr = 0;
+    for (LayerIndex layer_nr = 0; layer_nr < static_cast<LayerIndex>(layer_count); layer_nr++)
+    {
+        StorageMemoryUsage layer_usage;
+        for (const SliceMeshStorage& mesh : meshes)
+        {
+            if (layer_nr < static_cast<LayerIndex>(mesh.layers.size()))
+            {
+                layer_usage += mesh.layers[layer_nr].getMemoryUsage();
+            }
+        }
+        if (layer_nr < static_cast<LayerIndex>(support.supportLayers.size()))
+        {
+            layer_usage.support_layers += support.supportLayers[layer_nr].getMemoryUsage();
+        }
+        if (layer_usage.total() > largest_layer_bytes)
+        {
+            largest_layer_bytes = layer_usage.total();
+            largest_layer_nr = layer_nr;
+        }
+        total += layer_usage;
+    }
+
+    constexpr double bytes_per_megabyte = 1024.0 * 1024.0;
+    log("Memory after %s: %.1fMB in slice data (parts %.1fMB, walls %.1fMB, skin %.1fMB, infill %.1fMB, support %.1fMB), most in layer %d with %.1fMB. Peak memory use %.1fMB.\n",
+        stage, total.total() / bytes_per_megabyte, total.parts / bytes_per_megabyte, total.wall_toolpaths / bytes_per_megabyte, total.skin_parts / bytes_per_megabyte,
+        total.infill_areas / bytes_per_megabyte, total.support_layers / bytes_per_megabyte, static_cast<int>(largest_layer_nr), largest_layer_bytes / bytes_per_megabyte,
+        getPeakMemoryUsage() / bytes_per_megabyte);
+}
+
 Polygons SliceDataStorage::getLayerOutlines(const LayerIndex layer_nr, const bool include_support, const bool include_prime_tower, const bool external_polys_only, const bool for_brim) const
+{
+    const LayerOutlinesKey key(layer_nr, include_support, include_prime_tower, external_polys_only, for_brim);
+    const CompactPolygons* cached_outlines = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(layer_outlines_cache_mutex);
+        const auto cached = layer_outlines_cache.find(key);
+        if (cached != layer_outlines_cache.end())
+        {
+            cached_outlines = &cached->second;
+        }
+    }
+    if (cached_outlines)
+    {
+        return cached_outlines->expand(); //Decode outside of the lock. The element stays in place while other threads add more.
+    }
+
+    Polygons outlines = computeLayerOutlines(layer_nr, include_support, include_prime_tower, external_polys_only, for_brim);
+    CompactPolygons compact_outlines;
+    if (compact_outlines.compact(outlines))
+    {
+        std::lock_guard<std::mutex> lock(layer_outlines_cache_mutex);
+        layer_outlines_cache.emplace(key, std::move(compact_outlines)); //If another thread computed the same outlines meanwhile, they are equal, so just keep theirs.
+    }
+    return outlines;
+}
+
+void SliceDataStorage::invalidateLayerOutlines()
+{
+    std::lock_guard<std::mutex> lock(layer_outlines_cache_mutex);
+    layer_outlines_cache.clear();
+    bridge_resting_areas_cache.clear();
+}
+
+void SliceDataStorage::releaseLayerOutlines(const LayerIndex layer_nr)
+{
+    std::lock_guard<std::mutex> lock(layer_outlines_cache_mutex);
+    //The keys are ordered by the layer number first, so all outlines of the layer are together.
+    const auto first = layer_outlines_cache.lower_bound(LayerOutlinesKey(layer_nr, false, false, false, false));
+    const auto last = layer_outlines_cache.upper_bound(LayerOutlinesKey(layer_nr, true, true, true, true));
+    layer_outlines_cache.erase(first, last);
+}
+
+const std::vector<SliceDataStorage::BridgeRestingArea>& SliceDataStorage::getBridgeRestingAreas(const LayerIndex layer_nr, const bool exclude_sparse_infill, const Ratio sparse_infill_max_density) const
+{
+    const BridgeRestingAreasKey key(layer_nr, exclude_sparse_infill, sparse_infill_max_density);
+    {
+        std::lock_guard<std::mutex> lock(layer_outlines_cache_mutex);
+        const auto cached = bridge_resting_areas_cache.find(key);
+        if (cached != bridge_resting_areas_cache.end())
+        {
+            return cached->second;
+        }
+    }
+
+    std::vector<BridgeRestingArea> areas;
+    for (const SliceMeshStorage& mesh : meshes)
+    {
+        if (! mesh.isPrinted())
+        {
+            continue;
+        }
+        const coord_t infill_line_distance = mesh.settings.get<coord_t>("infill_line_distance");
+        const coord_t infill_line_width = mesh.settings.get<coord_t>("infill_line_width");
+        const bool part_has_sparse_infill = (infill_line_distance == 0) || ((float)infill_line_width / infill_line_distance) <= sparse_infill_max_density;
+        const bool excludes_infill = exclude_sparse_infill && part_has_sparse_infill;
+        for (const SliceLayerPart& part : mesh.layers[layer_nr].parts)
+        {
+            areas.push_back(BridgeRestingArea{ &part, excludes_infill, excludes_infill ? part.outline.difference(part.getOwnInfillArea()) : Polygons() });
+        }
+    }
+    std::lock_guard<std::mutex> lock(layer_outlines_cache_mutex);
+    return bridge_resting_areas_cache.emplace(key, std::move(areas)).first->second; //If another thread computed the same areas meanwhile, they are equal, so just keep theirs.
+}
+
+Polygons SliceDataStorage::computeLayerOutlines(const LayerIndex layer_nr, const bool include_support, const bool include_prime_tower, const bool external_polys_only, const bool for_brim) const
 {
     if (layer_nr < 0 && layer_nr < -static_cast<LayerIndex>(Raft::getFillerLayerCount()))
     { // when processing raft
@@ -380,6 +760,29 @@ Polygons SliceDataStorage::getLayerOutlines(const LayerIndex layer_nr, const boo
     }
 }
 
+std::shared_ptr<const PathConfigStorage> SliceDataStorage::getPathConfigs(const LayerIndex layer_nr, const coord_t layer_thickness) const
+{
+    //The first layer has its own line widths and flows, and the slowed down layers have their own speeds.
+    const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
+    const LayerIndex first_shared_layer = std::max(LayerIndex(1), LayerIndex(mesh_group_settings.get<size_t>("speed_slowdown_layers")));
+    if (layer_nr < first_shared_layer)
+    {
+        return std::make_shared<const PathConfigStorage>(*this, layer_nr, layer_thickness);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(path_configs_cache_mutex);
+        const auto cached = path_configs_cache.find(layer_thickness);
+        if (cached != path_configs_cache.end())
+        {
+            return cached->second;
+        }
+    }
+    std::shared_ptr<const PathConfigStorage> configs = std::make_shared<const PathConfigStorage>(*this, first_shared_layer, layer_thickness); //Make them outside of the lock.
+    std::lock_guard<std::mutex> lock(path_configs_cache_mutex);
+    return path_configs_cache.emplace(layer_thickness, std::move(configs)).first->second; //If another thread made the same configs meanwhile, they are equal, so just use theirs.
+}
+
 std::vector<bool> SliceDataStorage::getExtrudersUsed() const
 {
     std::vector<bool> ret;
@@ -629,6 +1032,17 @@ Polygon SliceDataStorage::getMachineBorder(bool adhesion_offset) const
 }
 
 
+size_t SupportLayer::getMemoryUsage() const
+{
+    size_t bytes = cura::getMemoryUsage(support_bottom) + cura::getMemoryUsage(support_roof) + cura::getMemoryUsage(support_mesh_drop_down)
+        + cura::getMemoryUsage(support_mesh) + cura::getMemoryUsage(anti_overhang);
+    for (const SupportInfillPart& part : support_infill_parts)
+    {
+        bytes += cura::getMemoryUsage(part.outline) + cura::getMemoryUsage(part.infill_area_per_combine_per_density) + cura::getMemoryUsage(part.wall_toolpaths);
+    }
+    return bytes;
+}
+
 void SupportLayer::excludeAreasFromSupportInfillAreas(const Polygons& exclude_polygons, const AABB& exclude_polygons_boundary_box)
 {
     // record the indexes that need to be removed and do that after
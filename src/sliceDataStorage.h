@@ -5,7 +5,11 @@
 #define SLICE_DATA_STORAGE_H
 
 #include <map>
+#include <memory> //For shared_ptr.
+#include <memory_resource> //For the memory of the compact parts of a layer.
+#include <mutex>
 #include <optional>
+#include <tuple>
 
 #include "PrimeTower.h"
 #include "RetractionConfig.h"
@@ -14,11 +18,17 @@
 #include "settings/Settings.h" //For MAX_EXTRUDERS.
 #include "settings/types/Angle.h" //Infill angles.
 #include "settings/types/LayerIndex.h"
+#include "settings/types/Ratio.h"
 #include "utils/AABB.h"
 #include "utils/AABB3D.h"
+#include "utils/BoxGrid.h"
+#include "utils/CompactPolygons.h"
+#include "utils/CompactVariableWidthLines.h"
 #include "utils/IntPoint.h"
 #include "utils/NoCopy.h"
 #include "utils/polygon.h"
+#include "utils/SparseLayerVector.h"
+#include "utils/SpillFile.h"
 #include "WipeScriptConfig.h"
 
 // libArachne
@@ -27,10 +37,36 @@
 namespace cura
 {
 
+class CombPathCache;
+class InfillCache;
 class Mesh;
+class PathConfigStorage;
 class SierpinskiFillProvider;
 class LightningGenerator;
 
+/*!
+ * The number of bytes that the slice data holds in each of its larger
+ * collections of geometry.
+ *
+ * This counts the memory allocated for the coordinates, which is the bulk of
+ * it. The bookkeeping of the containers themselves is left out.
+ */
+struct StorageMemoryUsage
+{
+    size_t parts = 0; //!< The outlines, print outlines, spiral walls and inner areas of the layer parts, and the top surface.
+    size_t wall_toolpaths = 0; //!< The walls of the layer parts and of their infill areas.
+    size_t skin_parts = 0; //!< The outlines, walls and fill areas of the skin.
+    size_t infill_areas = 0; //!< The infill areas of the layer parts, including those per density and combined thickness.
+    size_t support_layers = 0; //!< All areas and walls of the support.
+
+    /*!
+     * The number of bytes in all categories together.
+     */
+    size_t total() const;
+
+    StorageMemoryUsage& operator+=(const StorageMemoryUsage& other);
+};
+
 /*!
  * A SkinPart is a connected area designated as top and/or bottom skin. 
  * Surrounding each non-bridged skin area with an outline may result in better top skins.
@@ -67,6 +103,8 @@ public:
     Polygons inner_area; //!< The area of the outline, minus the walls. This will be filled with either skin or infill.
     std::vector<SkinPart> skin_parts;  //!< The skin parts which are filled for 100% with lines and/or insets.
     std::vector<VariableWidthLines> wall_toolpaths; //!< toolpaths for walls, will replace(?) the insets. Binned by inset_idx.
+    CompactVariableWidthLines compact_wall_toolpaths; //!< The wall toolpaths, if they were compacted to save memory until the g-code is written. Then wall_toolpaths is empty.
+    std::optional<SpillFile::Block> spilled_wall_toolpaths; //!< Where the wall toolpaths are in the scratch file of the storage, if they were moved out of memory until the g-code is written.
     std::vector<VariableWidthLines> infill_wall_toolpaths; //!< toolpaths for the walls of the infill areas. Binned by inset_idx.
 
     /*!
@@ -134,6 +172,14 @@ public:
      */
     std::vector<std::vector<Polygons>> infill_area_per_combine_per_density;
 
+    /*!
+     * Create an empty part.
+     * \param memory Where to allocate the compact wall toolpaths. For the
+     * parts of a layer, this is the memory resource of that layer. It must
+     * outlive the part.
+     */
+    SliceLayerPart(std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
     /*!
      * Get the infill_area_own (or when it's not instantiated: the normal infill_area)
      * \see SliceLayerPart::infill_area_own
@@ -154,6 +200,21 @@ public:
      * \return true if there is at least one ExtrusionLine at the specified wall index, false otherwise
      */
     bool hasWallAtInsetIndex(size_t inset_idx) const;
+
+    /*!
+     * Store the wall toolpaths in compact form, to save memory until the
+     * g-code is written.
+     *
+     * If the toolpaths don't fit in the compact form, they are kept as they
+     * are.
+     */
+    void compactWallToolpaths();
+
+    /*!
+     * The number of insets of wall toolpaths, whether they are compacted or
+     * not.
+     */
+    size_t getWallToolpathInsetCount() const;
 };
 
 /*!
@@ -175,6 +236,11 @@ public:
      */
     TopSurface top_surface;
 
+    /*!
+     * The bounding boxes of \ref parts, as indexed by \ref indexParts.
+     */
+    BoxGrid part_grid;
+
     /*!
      * Get the all outlines of all layer parts in this layer.
      * 
@@ -192,7 +258,81 @@ public:
      */
     void getOutlines(Polygons& result, bool external_polys_only = false) const;
 
+    /*!
+     * Index the bounding boxes of the parts of this layer, so that
+     * \ref getPartsOverlapping doesn't need to check all parts.
+     *
+     * This needs to be done again whenever parts are added or removed.
+     */
+    void indexParts();
+
+    /*!
+     * Find the parts of which the bounding box overlaps with a given bounding
+     * box.
+     *
+     * If the parts were changed since they were last indexed, all parts are
+     * checked instead.
+     * \param box The bounding box to find the overlapping parts of.
+     * \return The indices of those parts, in increasing order.
+     */
+    std::vector<size_t> getPartsOverlapping(const AABB& box) const;
+
+    /*!
+     * Count how much memory the parts of this layer hold.
+     * \return The number of bytes per category. The support is not part of a
+     * mesh layer, so that category is left empty.
+     */
+    StorageMemoryUsage getMemoryUsage() const;
+
+    /*!
+     * Where the parts of this layer allocate their compact wall toolpaths.
+     *
+     * Each layer has its own pool, so the threads that process different
+     * layers don't contend for the heap, and the memory of a layer isn't
+     * scattered between that of others.
+     * \return The memory resource, which lives as long as this layer.
+     */
+    std::pmr::memory_resource* getMemoryResource();
+
+    /*!
+     * Give all memory of the compact wall toolpaths of this layer back at
+     * once. None of the parts may still hold compact wall toolpaths.
+     */
+    void releaseMemory();
+
+    SliceLayer() = default;
+    SliceLayer(const SliceLayer& other) = default;
+    SliceLayer(SliceLayer&& other) = default;
+    SliceLayer& operator=(const SliceLayer& other) = default;
+    SliceLayer& operator=(SliceLayer&& other) = default;
     ~SliceLayer();
+
+private:
+    /*!
+     * Owns the pool of a layer.
+     *
+     * The pool is behind a pointer so that its address doesn't change when
+     * the layer is moved. A copy of a layer gets a new, empty pool, since the
+     * memory of the original can't be shared.
+     */
+    class MemoryPool
+    {
+    public:
+        MemoryPool();
+        MemoryPool(const MemoryPool& other);
+        MemoryPool(MemoryPool&& other) = default;
+        MemoryPool& operator=(const MemoryPool& other);
+        MemoryPool& operator=(MemoryPool&& other) = default;
+
+        std::unique_ptr<std::pmr::unsynchronized_pool_resource> resource;
+    };
+
+    /*!
+     * The pool that the compact wall toolpaths of the parts are allocated
+     * from. It's declared last so that the parts are assigned before it when
+     * the layer is assigned to.
+     */
+    MemoryPool memory;
 };
 
 /******************/
@@ -217,6 +357,12 @@ public:
      * \param exclude_polygons_boundary_box The boundary box for the polygons to exclude
      */
     void excludeAreasFromSupportInfillAreas(const Polygons& exclude_polygons, const AABB& exclude_polygons_boundary_box);
+
+    /*!
+     * Count how much memory the areas and walls of this support layer hold.
+     * \return The number of bytes.
+     */
+    size_t getMemoryUsage() const;
 };
 
 class SupportStorage
@@ -231,8 +377,9 @@ public:
     std::vector<AngleDegrees> support_roof_angles; //!< a list of angle values which is cycled through to determine the infill angle of each layer
     std::vector<AngleDegrees> support_bottom_angles; //!< a list of angle values which is cycled through to determine the infill angle of each layer
 
-    std::vector<SupportLayer> supportLayers;
-    SierpinskiFillProvider* cross_fill_provider; //!< the fractal pattern for the cross (3d) filling pattern
+    SparseLayerVector<SupportLayer> supportLayers; //!< The support of each layer. Only the layers that have any support are allocated.
+    std::shared_ptr<const SierpinskiFillProvider> cross_fill_provider; //!< the fractal pattern for the cross (3d) filling pattern, which may be shared with other slices
+    std::shared_ptr<InfillCache> infill_cache; //!< The support infill, roofs and bottoms generated so far, to reuse on layers with the same areas.
 
     SupportStorage();
     ~SupportStorage();
@@ -259,10 +406,15 @@ public:
     AABB3D bounding_box; //!< the mesh's bounding box
 
     SubDivCube* base_subdiv_cube;
-    SierpinskiFillProvider* cross_fill_provider; //!< the fractal pattern for the cross (3d) filling pattern
+    std::shared_ptr<const SierpinskiFillProvider> cross_fill_provider; //!< the fractal pattern for the cross (3d) filling pattern, which may be shared with other slices
 
     LightningGenerator* lightning_generator; //!< Pre-computed structure for Lightning type infill
 
+    std::shared_ptr<InfillCache> infill_cache; //!< The infill, skin and ironing generated so far, to reuse on layers with the same areas.
+
+    std::optional<size_t> instance_of; //!< If this mesh is a copy of an earlier mesh that is only moved in X and Y, the index of that mesh in the storage. Its walls are copied from there where the outlines are the same.
+    Point instance_offset; //!< If this mesh is a copy of an earlier mesh, how far it is moved from that mesh.
+
     /*!
      * \brief Creates a storage space for slice results of a mesh.
      * \param mesh The mesh that the storage space belongs to.
@@ -332,6 +484,8 @@ public:
     std::vector<Polygons> oozeShield;        //oozeShield per layer
     Polygons draft_protection_shield; //!< The polygons for a heightened skirt which protects from warping by gusts of wind and acts as a heated chamber.
 
+    std::shared_ptr<CombPathCache> comb_path_cache; //!< The combing of the travels planned so far, to reuse on layers with the same comb boundaries.
+
     /*!
      * \brief Creates a new slice data storage that stores the slice data of the
      * current mesh group.
@@ -352,9 +506,87 @@ public:
      * outline.
      * \param external_polys_only Whether to disregard all hole polygons.
      * \param for_brim Whether the outline is to be used to construct the brim.
+     *
+     * The outlines are remembered, so asking for the same outlines again is
+     * cheap. When the layer parts, support, prime tower or raft change, the
+     * remembered outlines must be forgotten with
+     * \ref invalidateLayerOutlines .
      */
     Polygons getLayerOutlines(const LayerIndex layer_nr, const bool include_support, const bool include_prime_tower, const bool external_polys_only = false, const bool for_brim = false) const;
 
+    /*!
+     * Forget the outlines remembered by \ref getLayerOutlines and the areas
+     * remembered by \ref getBridgeRestingAreas .
+     *
+     * This must be called after each stage that changes the outlines of the
+     * layer parts, the support, the prime tower or the raft. It may not be
+     * called while other threads are getting layer outlines.
+     */
+    void invalidateLayerOutlines();
+
+    /*!
+     * Forget the outlines of one layer that were remembered by
+     * \ref getLayerOutlines .
+     *
+     * This is called once the layer plan of a layer has been produced, since
+     * writing the g-code doesn't look at the outlines of a layer any more after
+     * that. If they are asked for again anyway, they are computed again. It may
+     * not be called while other threads are getting the outlines of the same
+     * layer.
+     * \param layer_nr The layer of which to forget the outlines.
+     */
+    void releaseLayerOutlines(const LayerIndex layer_nr);
+
+    /*!
+     * The area of a layer part that a bridge on a layer above can rest on.
+     */
+    struct BridgeRestingArea
+    {
+        const SliceLayerPart* part; //!< The part that the area belongs to.
+        bool excludes_infill; //!< Whether the sparse infill of the part is left out of the area.
+        Polygons solid_area; //!< If the infill is left out, the rest of the part.
+
+        /*!
+         * Get the area that a bridge can rest on.
+         */
+        const Polygons& getArea() const
+        {
+            return excludes_infill ? solid_area : part->outline;
+        }
+    };
+
+    /*!
+     * Get the areas of all parts of the printed meshes on a layer that a
+     * bridge above them can rest on.
+     *
+     * All skin parts of a layer look at the same layers below to see whether
+     * they are bridges, so the areas are remembered. Like
+     * \ref getLayerOutlines , they are forgotten by
+     * \ref invalidateLayerOutlines .
+     * \param layer_nr The layer to get the areas of.
+     * \param exclude_sparse_infill Whether to leave sparse infill out of the
+     * areas, since it doesn't support a bridge right above it.
+     * \param sparse_infill_max_density Up to which density the infill is
+     * considered sparse.
+     * \return The areas of the parts, in the order of the meshes and their
+     * parts.
+     */
+    const std::vector<BridgeRestingArea>& getBridgeRestingAreas(const LayerIndex layer_nr, const bool exclude_sparse_infill, const Ratio sparse_infill_max_density) const;
+
+    /*!
+     * Get the line configs for all feature types of a layer.
+     *
+     * After the first layer and the layers that are slowed down, the configs
+     * only depend on the layer thickness. Those are made once for each layer
+     * thickness and shared by all layers with that thickness.
+     * \param layer_nr The layer to get the configs for. This may be negative
+     * for raft layers.
+     * \param layer_thickness The thickness of that layer.
+     * \return The configs. They must not be changed, since other layers may
+     * use the same ones.
+     */
+    std::shared_ptr<const PathConfigStorage> getPathConfigs(const LayerIndex layer_nr, const coord_t layer_thickness) const;
+
     /*!
      * Get the extruders used.
      * 
@@ -388,7 +620,129 @@ public:
      */
     Polygon getMachineBorder(bool adhesion_offset = false) const;
 
+    /*!
+     * Free the data of a layer that is only needed to plan the gcode of that
+     * same layer.
+     *
+     * This releases the walls, skin fill and infill areas of the layer once
+     * its layer plan has been produced, so that the memory used while writing
+     * gcode doesn't grow with the height of the print. Everything that the
+     * planning of other layers or the travel moves of buffered layer plans
+     * might still look at is kept: the outlines, bounding boxes, skin outlines,
+     * the own infill area, the spiralized walls and all support areas.
+     *
+     * \param layer_nr The layer of which to free the data.
+     */
+    void releaseLayerPlanningData(const LayerIndex layer_nr);
+
+    /*!
+     * Move the wall toolpaths of all layers out of memory, into a scratch
+     * file, until the g-code is written.
+     *
+     * All other layer data stays in memory, since the planning of a layer
+     * also looks at the layers around it. The wall toolpaths are only needed
+     * when the walls of their own layer are added to the layer plan, and they
+     * are what takes most memory for large prints.
+     *
+     * If the scratch file can't be created or written, the toolpaths that
+     * weren't written yet stay in memory.
+     * \param directory The directory to create the scratch file in.
+     */
+    void spillWallToolpaths(const std::string& directory);
+
+    /*!
+     * Bring the wall toolpaths of a layer that were moved out of memory by
+     * \ref spillWallToolpaths back in, so that the layer can be planned.
+     *
+     * Different layers may be loaded from multiple threads at once.
+     * \param layer_nr The layer to load the wall toolpaths of.
+     */
+    void loadSpilledWallToolpaths(const LayerIndex layer_nr);
+
+    /*!
+     * Log how much memory the slice data holds at this point, both in total
+     * and for the layer that holds the most, along with the peak memory use of
+     * the process so far.
+     *
+     * This helps to find which stage of the slicing blows up the memory use,
+     * for instance for tall prints with complex geometry.
+     *
+     * This goes through all of the geometry, so it's skipped if the verbosity
+     * level is too low to log it.
+     * \param stage A description of the stage that was completed, to include
+     * in the log.
+     */
+    void logMemoryUsage(const char* stage) const;
+
 private:
+    /*!
+     * The parameters of \ref getLayerOutlines : The layer number, whether to
+     * include support, whether to include the prime tower, whether to only
+     * include the external polygons and whether it's for the brim.
+     */
+    using LayerOutlinesKey = std::tuple<LayerIndex, bool, bool, bool, bool>;
+
+    /*!
+     * The outlines that were computed by \ref getLayerOutlines so far.
+     *
+     * They are kept in compact form, since the outlines of every layer may be
+     * remembered until the layer plan of that layer is produced. Outlines that
+     * don't fit in the compact form are not remembered.
+     *
+     * Elements are only removed by \ref invalidateLayerOutlines and
+     * \ref releaseLayerOutlines , so references to them remain valid while
+     * other threads add more.
+     */
+    mutable std::map<LayerOutlinesKey, CompactPolygons> layer_outlines_cache;
+
+    /*!
+     * Guards the \ref layer_outlines_cache and the
+     * \ref bridge_resting_areas_cache , since outlines may be requested by
+     * multiple threads at the same time.
+     */
+    mutable std::mutex layer_outlines_cache_mutex;
+
+    /*!
+     * The parameters of \ref getBridgeRestingAreas : The layer number,
+     * whether to exclude sparse infill and the maximum density of sparse
+     * infill.
+     */
+    using BridgeRestingAreasKey = std::tuple<LayerIndex, bool, double>;
+
+    /*!
+     * The areas that were computed by \ref getBridgeRestingAreas so far.
+     *
+     * Elements are only removed by \ref invalidateLayerOutlines , so
+     * references to them remain valid while other threads add more.
+     */
+    mutable std::map<BridgeRestingAreasKey, std::vector<BridgeRestingArea>> bridge_resting_areas_cache;
+
+    /*!
+     * The line configs that are shared by the layers after the first ones, for
+     * each layer thickness, as made by \ref getPathConfigs .
+     */
+    mutable std::map<coord_t, std::shared_ptr<const PathConfigStorage>> path_configs_cache;
+
+    /*!
+     * Guards the \ref path_configs_cache , since the layers are planned by
+     * multiple threads at the same time.
+     */
+    mutable std::mutex path_configs_cache_mutex;
+
+    /*!
+     * The scratch file that the wall toolpaths were moved to by
+     * \ref spillWallToolpaths , if they were.
+     */
+    std::unique_ptr<SpillFile> spill_file;
+
+    /*!
+     * Compute all outlines within a given layer, without looking in the
+     * \ref layer_outlines_cache .
+     *
+     * See \ref getLayerOutlines for the parameters.
+     */
+    Polygons computeLayerOutlines(const LayerIndex layer_nr, const bool include_support, const bool include_prime_tower, const bool external_polys_only, const bool for_brim) const;
+
     /*!
      * Construct the retraction_config_per_extruder
      */
@@ -3,6 +3,8 @@
 
 #include <stdio.h>
 #include <algorithm> // remove_if
+#include <array>
+#include <numeric> // iota
 
 #include "settings/AdaptiveLayerHeights.h"
 #include "Application.h"
@@ -10,10 +12,13 @@
 #include "slicer.h"
 #include "settings/EnumSettings.h"
 #include "settings/types/LayerIndex.h"
+#include "utils/Cancellation.h"
 #include "utils/gettime.h"
 #include "utils/logoutput.h"
+#include "utils/ParallelSchedule.h"
 #include "utils/Simplify.h"
 #include "utils/SparsePointGridInclusive.h"
+#include "utils/Trace.h"
 
 
 namespace cura
@@ -23,20 +28,20 @@ constexpr int largest_neglected_gap_first_phase = MM2INT(0.01); //!< distance be
 constexpr int largest_neglected_gap_second_phase = MM2INT(0.02); //!< distance between two line segments regarded as connected
 constexpr int max_stitch1 = MM2INT(10.0); //!< maximal distance stitched between open polylines to form polygons
 
-void SlicerLayer::makeBasicPolygonLoops(Polygons& open_polylines)
+void SlicerLayer::makeBasicPolygonLoops(const Mesh& mesh, Polygons& open_polylines)
 {
     for(size_t start_segment_idx = 0; start_segment_idx < segments.size(); start_segment_idx++)
     {
         if (!segments[start_segment_idx].addedToPolygon)
         {
-            makeBasicPolygonLoop(open_polylines, start_segment_idx);
+            makeBasicPolygonLoop(mesh, open_polylines, start_segment_idx);
         }
     }
     //Clear the segmentList to save memory, it is no longer needed after this point.
     segments.clear();
 }
 
-void SlicerLayer::makeBasicPolygonLoop(Polygons& open_polylines, const size_t start_segment_idx)
+void SlicerLayer::makeBasicPolygonLoop(const Mesh& mesh, Polygons& open_polylines, const size_t start_segment_idx)
 {
 
     Polygon poly;
@@ -47,25 +52,23 @@ void SlicerLayer::makeBasicPolygonLoop(Polygons& open_polylines, const size_t st
         SlicerSegment& segment = segments[segment_idx];
         poly.add(segment.end);
         segment.addedToPolygon = true;
-        segment_idx = getNextSegmentIdx(segment, start_segment_idx);
+        segment_idx = getNextSegmentIdx(mesh, segment, start_segment_idx);
         if (segment_idx == static_cast<int>(start_segment_idx))
         { // polyon is closed
-            polygons.add(poly);
+            polygons.add(std::move(poly));
             return;
         }
     }
     // polygon couldn't be closed
-    open_polylines.add(poly);
+    open_polylines.add(std::move(poly));
 }
 
 int SlicerLayer::tryFaceNextSegmentIdx(const SlicerSegment& segment, const int face_idx, const size_t start_segment_idx) const
 {
-    decltype(face_idx_to_segment_idx.begin()) it;
-    auto it_end = face_idx_to_segment_idx.end();
-    it = face_idx_to_segment_idx.find(face_idx);
-    if (it != it_end)
+    const auto it = std::lower_bound(segments.begin(), segments.end(), face_idx, [](const SlicerSegment& candidate, const int face_idx) { return candidate.faceIndex < face_idx; });
+    if (it != segments.end() && it->faceIndex == face_idx)
     {
-        const int segment_idx = (*it).second;
+        const int segment_idx = it - segments.begin();
         Point p1 = segments[segment_idx].start;
         Point diff = segment.end - p1;
         if (shorterThen(diff, largest_neglected_gap_first_phase))
@@ -85,11 +88,11 @@ int SlicerLayer::tryFaceNextSegmentIdx(const SlicerSegment& segment, const int f
     return -1;
 }
 
-int SlicerLayer::getNextSegmentIdx(const SlicerSegment& segment, const size_t start_segment_idx) const
+int SlicerLayer::getNextSegmentIdx(const Mesh& mesh, const SlicerSegment& segment, const size_t start_segment_idx) const
 {
     int next_segment_idx = -1;
 
-    const bool segment_ended_at_edge = segment.endVertex == nullptr;
+    const bool segment_ended_at_edge = segment.endVertexIdx < 0;
     if (segment_ended_at_edge)
     {
         const int face_to_try = segment.endOtherFaceIdx;
@@ -103,8 +106,7 @@ int SlicerLayer::getNextSegmentIdx(const SlicerSegment& segment, const size_t st
     {
         // segment ended at vertex
 
-        const std::vector<uint32_t> &faces_to_try = segment.endVertex->connected_faces;
-        for (int face_to_try : faces_to_try)
+        for (int face_to_try : mesh.getConnectedFaces(segment.endVertexIdx))
         {
             const int result_segment_idx =
                 tryFaceNextSegmentIdx(segment, face_to_try, start_segment_idx);
@@ -218,9 +220,12 @@ SlicerLayer::findPossibleStitches(
     SparsePointGrid<StitchGridVal,StitchGridValLocator> grid_starts(cell_size);
 
     // populate grids
+    // The grids are only queried after this, so they're filled all at once.
 
     // Inserts the ends of all polylines into the grid (does not
     //   insert the starts of the polylines).
+    std::vector<StitchGridVal> grid_vals;
+    grid_vals.reserve(open_polylines.size());
     for(unsigned int polyline_0_idx = 0; polyline_0_idx < open_polylines.size(); polyline_0_idx++)
     {
         ConstPolygonRef polyline_0 = open_polylines[polyline_0_idx];
@@ -230,12 +235,14 @@ SlicerLayer::findPossibleStitches(
         StitchGridVal grid_val;
         grid_val.polyline_idx = polyline_0_idx;
         grid_val.polyline_term_pt = polyline_0.back();
-        grid_ends.insert(grid_val);
+        grid_vals.push_back(grid_val);
     }
+    grid_ends.insertAll(grid_vals);
 
     // Inserts the start of all polylines into the grid.
     if (allow_reverse)
     {
+        grid_vals.clear();
         for(unsigned int polyline_0_idx = 0; polyline_0_idx < open_polylines.size(); polyline_0_idx++)
         {
             ConstPolygonRef polyline_0 = open_polylines[polyline_0_idx];
@@ -245,23 +252,33 @@ SlicerLayer::findPossibleStitches(
             StitchGridVal grid_val;
             grid_val.polyline_idx = polyline_0_idx;
             grid_val.polyline_term_pt = polyline_0[0];
-            grid_starts.insert(grid_val);
+            grid_vals.push_back(grid_val);
         }
+        grid_starts.insertAll(grid_vals);
     }
 
-    // search for nearby end points
+    // search for nearby end points, reusing the same buffers for all queries
+    std::vector<StitchGridVal> nearby_ends;
+    std::vector<StitchGridVal> nearby_starts;
+    const auto find_nearby = [max_dist](const SparsePointGrid<StitchGridVal, StitchGridValLocator>& grid, const Point query_pt, std::vector<StitchGridVal>& nearby)
+    {
+        nearby.clear();
+        grid.processNearby(query_pt, max_dist, [&nearby](const StitchGridVal& val)
+            {
+                nearby.push_back(val);
+                return true;
+            });
+    };
     for(unsigned int polyline_1_idx = 0; polyline_1_idx < open_polylines.size(); polyline_1_idx++)
     {
         ConstPolygonRef polyline_1 = open_polylines[polyline_1_idx];
 
         if (polyline_1.size() < 1) continue;
 
-        std::vector<StitchGridVal> nearby_ends;
-
         // Check for stitches that append polyline_1 onto polyline_0
         // in natural order.  These are stitches that use the end of
         // polyline_0 and the start of polyline_1.
-        nearby_ends = grid_ends.getNearby(polyline_1[0], max_dist);
+        find_nearby(grid_ends, polyline_1[0], nearby_ends);
         for (const auto& nearby_end : nearby_ends)
         {
             Point diff = nearby_end.polyline_term_pt - polyline_1[0];
@@ -281,7 +298,7 @@ SlicerLayer::findPossibleStitches(
             // Check for stitches that append polyline_1 onto polyline_0
             // by reversing order of polyline_1.  These are stitches that
             // use the end of polyline_0 and the end of polyline_1.
-            nearby_ends = grid_ends.getNearby(polyline_1.back(), max_dist);
+            find_nearby(grid_ends, polyline_1.back(), nearby_ends);
             for (const auto& nearby_end : nearby_ends)
             {
                 // Disallow stitching with self with same end point
@@ -305,8 +322,7 @@ SlicerLayer::findPossibleStitches(
             // Check for stitches that append polyline_1 onto polyline_0
             // by reversing order of polyline_0.  These are stitches that
             // use the start of polyline_0 and the start of polyline_1.
-            std::vector<StitchGridVal> nearby_starts =
-                grid_starts.getNearby(polyline_1[0], max_dist);
+            find_nearby(grid_starts, polyline_1[0], nearby_starts);
             for (const auto& nearby_start : nearby_starts)
             {
                 // Disallow stitching with self with same end point
@@ -426,8 +442,9 @@ void SlicerLayer::TerminusTrackingMap::updateMap(
     size_t num_removed_terms,
     const Terminus *removed_cur_terms)
 {
-    // save old locations
-    std::vector<Terminus> old_terms(num_terms);
+    // save old locations. At most the four ends of two polylines change at once, so don't allocate for them.
+    assert(num_terms <= 4 && "Only the ends of two polylines can change at once.");
+    Terminus old_terms[4];
     for (size_t idx = 0U; idx != num_terms; ++idx)
     {
         old_terms[idx] = getOldFromCur(cur_terms[idx]);
@@ -549,8 +566,34 @@ void SlicerLayer::stitch_extensive(Polygons& open_polylines)
     // And generate a path over this shortest bit to link up the 2 open polygons.
     // (If these 2 open polygons are the same polygon, then the final result is a closed polyon)
 
+    // Only the segments of the closed polygons near an end point of an open polyline need to be checked, so index them.
+    // Polygons are only ever added by this function, so the grid can be kept up to date incrementally.
+    PolygonSegmentGrid polygon_segment_grid(MM2INT(1.0));
+    size_t indexed_polygon_count = 0;
+
     while(1)
     {
+        addPolygonSegmentsToGrid(polygon_segment_grid, indexed_polygon_count);
+        indexed_polygon_count = polygons.size();
+
+        // Find the closest positions on the closed polygons for the end points of all polylines once.
+        // Two end points can only be connected via a polygon if they're both close to that same polygon.
+        std::vector<ClosePolygonResult> start_closest(open_polylines.size());
+        std::vector<ClosePolygonResult> end_closest(open_polylines.size());
+        std::unordered_map<int, std::vector<unsigned int>> polyline_ends_per_polygon;
+        for(unsigned int polyline_idx = 0; polyline_idx < open_polylines.size(); polyline_idx++)
+        {
+            ConstPolygonRef polyline = open_polylines[polyline_idx];
+            if (polyline.size() < 1) continue;
+
+            start_closest[polyline_idx] = findPolygonPointClosestTo(polyline[0], polygon_segment_grid);
+            end_closest[polyline_idx] = findPolygonPointClosestTo(polyline.back(), polygon_segment_grid);
+            if (end_closest[polyline_idx].polygonIdx >= 0)
+            {
+                polyline_ends_per_polygon[end_closest[polyline_idx].polygonIdx].push_back(polyline_idx);
+            }
+        }
+
         unsigned int best_polyline_1_idx = -1;
         unsigned int best_polyline_2_idx = -1;
         GapCloserResult best_result;
@@ -562,10 +605,10 @@ void SlicerLayer::stitch_extensive(Polygons& open_polylines)
         for(unsigned int polyline_1_idx = 0; polyline_1_idx < open_polylines.size(); polyline_1_idx++)
         {
             PolygonRef polyline_1 = open_polylines[polyline_1_idx];
-            if (polyline_1.size() < 1) continue;
+            if (polyline_1.size() < 1 || start_closest[polyline_1_idx].polygonIdx < 0) continue;
 
             {
-                GapCloserResult res = findPolygonGapCloser(polyline_1[0], polyline_1.back());
+                GapCloserResult res = findPolygonGapCloser(polyline_1[0], polyline_1.back(), start_closest[polyline_1_idx], end_closest[polyline_1_idx]);
                 if (res.len > 0 && res.len < best_result.len)
                 {
                     best_polyline_1_idx = polyline_1_idx;
@@ -574,12 +617,12 @@ void SlicerLayer::stitch_extensive(Polygons& open_polylines)
                 }
             }
 
-            for(unsigned int polyline_2_idx = 0; polyline_2_idx < open_polylines.size(); polyline_2_idx++)
+            for(unsigned int polyline_2_idx : polyline_ends_per_polygon[start_closest[polyline_1_idx].polygonIdx])
             {
                 PolygonRef polyline_2 = open_polylines[polyline_2_idx];
-                if (polyline_2.size() < 1 || polyline_1_idx == polyline_2_idx) continue;
+                if (polyline_1_idx == polyline_2_idx) continue;
 
-                GapCloserResult res = findPolygonGapCloser(polyline_1[0], polyline_2.back());
+                GapCloserResult res = findPolygonGapCloser(polyline_1[0], polyline_2.back(), start_closest[polyline_1_idx], end_closest[polyline_2_idx]);
                 if (res.len > 0 && res.len < best_result.len)
                 {
                     best_polyline_1_idx = polyline_1_idx;
@@ -653,10 +696,13 @@ void SlicerLayer::stitch_extensive(Polygons& open_polylines)
 }
 
 GapCloserResult SlicerLayer::findPolygonGapCloser(Point ip0, Point ip1)
+{
+    return findPolygonGapCloser(ip0, ip1, findPolygonPointClosestTo(ip0), findPolygonPointClosestTo(ip1));
+}
+
+GapCloserResult SlicerLayer::findPolygonGapCloser(Point ip0, Point ip1, const ClosePolygonResult& c1, const ClosePolygonResult& c2) const
 {
     GapCloserResult ret;
-    ClosePolygonResult c1 = findPolygonPointClosestTo(ip0);
-    ClosePolygonResult c2 = findPolygonPointClosestTo(ip1);
     if (c1.polygonIdx < 0 || c1.polygonIdx != c2.polygonIdx)
     {
         ret.len = -1;
@@ -705,6 +751,27 @@ GapCloserResult SlicerLayer::findPolygonGapCloser(Point ip0, Point ip1)
     return ret;
 }
 
+/*!
+ * Whether \p input is within 0.1mm of the line segment from \p p0 to \p p1,
+ * measured perpendicular to the segment.
+ */
+static bool isNearPolygonSegment(const Point input, const Point p0, const Point p1)
+{
+    //Q = A + Normal( B - A ) * ((( B - A ) dot ( P - A )) / VSize( A - B ));
+    Point pDiff = p1 - p0;
+    int64_t lineLength = vSize(pDiff);
+    if (lineLength > 1)
+    {
+        int64_t distOnLine = dot(pDiff, input - p0) / lineLength;
+        if (distOnLine >= 0 && distOnLine <= lineLength)
+        {
+            Point q = p0 + pDiff * distOnLine / lineLength;
+            return shorterThen(q - input, MM2INT(0.1));
+        }
+    }
+    return false;
+}
+
 ClosePolygonResult SlicerLayer::findPolygonPointClosestTo(Point input)
 {
     ClosePolygonResult ret;
@@ -714,23 +781,11 @@ ClosePolygonResult SlicerLayer::findPolygonPointClosestTo(Point input)
         for(unsigned int i=0; i<polygons[n].size(); i++)
         {
             Point p1 = polygons[n][i];
-
-            //Q = A + Normal( B - A ) * ((( B - A ) dot ( P - A )) / VSize( A - B ));
-            Point pDiff = p1 - p0;
-            int64_t lineLength = vSize(pDiff);
-            if (lineLength > 1)
+            if (isNearPolygonSegment(input, p0, p1))
             {
-                int64_t distOnLine = dot(pDiff, input - p0) / lineLength;
-                if (distOnLine >= 0 && distOnLine <= lineLength)
-                {
-                    Point q = p0 + pDiff * distOnLine / lineLength;
-                    if (shorterThen(q - input, MM2INT(0.1)))
-                    {
-                        ret.polygonIdx = n;
-                        ret.pointIdx = i;
-                        return ret;
-                    }
-                }
+                ret.polygonIdx = n;
+                ret.pointIdx = i;
+                return ret;
             }
             p0 = p1;
         }
@@ -739,11 +794,81 @@ ClosePolygonResult SlicerLayer::findPolygonPointClosestTo(Point input)
     return ret;
 }
 
+void SlicerLayer::addPolygonSegmentsToGrid(PolygonSegmentGrid& grid, const size_t first_polygon_idx) const
+{
+    for (size_t polygon_idx = first_polygon_idx; polygon_idx < polygons.size(); polygon_idx++)
+    {
+        ConstPolygonRef polygon = polygons[polygon_idx];
+        if (polygon.empty())
+        {
+            continue;
+        }
+        Point p0 = polygon.back();
+        for (size_t point_idx = 0; point_idx < polygon.size(); point_idx++)
+        {
+            const Point p1 = polygon[point_idx];
+            grid.insert(PolygonSegment{ p0, p1, static_cast<unsigned int>(polygon_idx), static_cast<unsigned int>(point_idx) });
+            p0 = p1;
+        }
+    }
+}
+
+ClosePolygonResult SlicerLayer::findPolygonPointClosestTo(Point input, const PolygonSegmentGrid& grid) const
+{
+    // The unindexed version returns the first segment in polygon order which is close enough, so do the same here.
+    ClosePolygonResult ret;
+    unsigned int best_point_idx = 0;
+    // Search a bit further than the acceptance distance to be robust against rounding in isNearPolygonSegment.
+    grid.processNearby(input, MM2INT(0.2), [&](const PolygonSegment& segment)
+        {
+            const bool is_earlier = ret.polygonIdx < 0
+                || segment.polygon_idx < static_cast<unsigned int>(ret.polygonIdx)
+                || (segment.polygon_idx == static_cast<unsigned int>(ret.polygonIdx) && segment.point_idx < best_point_idx);
+            if (is_earlier && isNearPolygonSegment(input, segment.from, segment.to))
+            {
+                ret.polygonIdx = segment.polygon_idx;
+                best_point_idx = segment.point_idx;
+            }
+            return true;
+        });
+    if (ret.polygonIdx >= 0)
+    {
+        ret.pointIdx = best_point_idx;
+    }
+    return ret;
+}
+
+namespace
+{
+
+/*!
+ * Buffers to make the polygons of a layer with.
+ *
+ * Each thread keeps one, which it reuses for all layers it makes the polygons
+ * of. That way the threads don't need to allocate the buffers for every layer,
+ * which they would have to wait on each other for.
+ */
+struct MakePolygonsScratch
+{
+    Polygons open_polylines; //!< The polylines that couldn't be closed yet.
+    Simplify::Scratch simplify; //!< The buffers to simplify the polygons with.
+};
+
+MakePolygonsScratch& getMakePolygonsScratch()
+{
+    static thread_local MakePolygonsScratch scratch;
+    return scratch;
+}
+
+} //Anonymous namespace.
+
 void SlicerLayer::makePolygons(const Mesh* mesh)
 {
-    Polygons open_polylines;
+    MakePolygonsScratch& scratch = getMakePolygonsScratch();
+    Polygons& open_polylines = scratch.open_polylines;
+    open_polylines.clear();
 
-    makeBasicPolygonLoops(open_polylines);
+    makeBasicPolygonLoops(*mesh, open_polylines);
 
     connectOpenPolylines(open_polylines);
 
@@ -777,17 +902,37 @@ void SlicerLayer::makePolygons(const Mesh* mesh)
     }
 
     //Remove all the tiny polygons, or polygons that are not closed. As they do not contribute to the actual print.
-    const coord_t snap_distance = std::max(mesh->settings.get<coord_t>("minimum_polygon_circumference"), static_cast<coord_t>(1));
-    auto it = std::remove_if(polygons.begin(), polygons.end(), [snap_distance](PolygonRef poly) { return poly.shorterThan(snap_distance); });
-    polygons.erase(it, polygons.end());
-
     //Finally optimize all the polygons. Every point removed saves time in the long run.
-    polygons = Simplify(mesh->settings).polygon(polygons);
-
-    polygons.removeDegenerateVerts(); // remove verts connected to overlapping line segments
+    //Both are done in the same pass, simplifying the polygons in place, so that they aren't copied to a new set in between.
+    //The vertices connected to overlapping line segments are removed in that same pass.
+    const coord_t snap_distance = std::max(mesh->settings.get<coord_t>("minimum_polygon_circumference"), static_cast<coord_t>(1));
+    const Simplify simplifier(mesh->settings);
+    size_t kept_polygon_count = 0;
+    for (size_t polygon_idx = 0; polygon_idx < polygons.size(); polygon_idx++)
+    {
+        PolygonRef polygon = polygons[polygon_idx];
+        if (polygon.shorterThan(snap_distance))
+        {
+            continue;
+        }
+        Polygon working;
+        std::swap(*working, *polygon);
+        Polygon simplified = simplifier.polygon(std::move(working), scratch.simplify);
+        if (simplified.empty())
+        {
+            continue; //Degenerate.
+        }
+        if (simplified.removeDegenerateVerts() && simplified.size() <= 2) //Remove verts connected to overlapping line segments.
+        {
+            continue; //Nothing left but a line.
+        }
+        std::swap(*polygons[kept_polygon_count], *simplified);
+        kept_polygon_count++;
+    }
+    polygons.erase(polygons.begin() + kept_polygon_count, polygons.end());
 
     // Clean up polylines for Surface Mode printing
-    it = std::remove_if(openPolylines.begin(), openPolylines.end(), [snap_distance](PolygonRef poly) { return poly.shorterThan(snap_distance); });
+    auto it = std::remove_if(openPolylines.begin(), openPolylines.end(), [snap_distance](PolygonRef poly) { return poly.shorterThan(snap_distance); });
     openPolylines.erase(it, openPolylines.end());
 
     openPolylines.removeDegenerateVertsPolyline();
@@ -797,6 +942,7 @@ Slicer::Slicer(Mesh* i_mesh, const coord_t thickness, const size_t slice_layer_c
                bool use_variable_layer_heights, std::vector<AdaptiveLayer>* adaptive_layers)
     : mesh(i_mesh)
 {
+    TraceZone zone("slicer");
     const SlicingTolerance slicing_tolerance = mesh->settings.get<SlicingTolerance>("slicing_tolerance");
     const coord_t initial_layer_thickness =
         Application::getInstance().current_slice->scene.current_mesh_group->settings.get<coord_t>("layer_height_0");
@@ -820,6 +966,13 @@ Slicer::Slicer(Mesh* i_mesh, const coord_t thickness, const size_t slice_layer_c
     log("slice make polygons took %.3f seconds\n", slice_timer.restart());
 }
 
+Slicer::Slicer(Mesh* i_mesh, const std::vector<SlicerLayer>& sliced_layers)
+    : layers(sliced_layers)
+    , mesh(i_mesh)
+{
+    i_mesh->expandXY(i_mesh->settings.get<coord_t>("xy_offset")); //The AABB is expanded when slicing as well.
+}
+
 void Slicer::buildSegments
 (
     const Mesh& mesh,
@@ -828,132 +981,240 @@ void Slicer::buildSegments
     std::vector<SlicerLayer>& layers
 )
 {
-    // OpenMP
-#pragma omp parallel for default(none) shared(mesh, zbbox, slicing_tolerance, layers)
-    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
-    for (int layer_nr = 0; layer_nr < static_cast<int>(layers.size()); layer_nr++)
+    std::vector<size_t> layer_face_start;
+    std::vector<uint32_t> layer_faces;
+    buildFacesPerLayer(zbbox, layers, layer_face_start, layer_faces);
+
+    // The number of faces per layer varies a lot, e.g. between the widest part of a model and its top, so the layers are balanced by their number of faces.
+    std::vector<size_t> face_counts(layers.size());
+    for (size_t layer_nr = 0; layer_nr < layers.size(); layer_nr++)
+    {
+        face_counts[layer_nr] = layer_face_start[layer_nr + 1] - layer_face_start[layer_nr];
+    }
+    ParallelSchedule("slice segments", face_counts).run([&](const size_t layer_nr)
     {
-        const int32_t& z = layers[layer_nr].z;
-        layers[layer_nr].segments.reserve(100);
+        if (Cancellation::isRequested())
+        {
+            return; //The slicer is thrown away, so the rest of the layers don't matter.
+        }
+        SlicerLayer& layer = layers[layer_nr];
+        layer.segments.reserve(face_counts[layer_nr]);
+
+        // loop over the mesh faces which span this layer, a block at a time
+        for (size_t face_nr = layer_face_start[layer_nr]; face_nr < layer_face_start[layer_nr + 1]; face_nr += face_block_size)
+        {
+            const size_t block_size = std::min(face_block_size, layer_face_start[layer_nr + 1] - face_nr);
+            projectFaceBlock(mesh, &layer_faces[face_nr], block_size, slicing_tolerance, layer);
+        }
+    });
+}
 
-        // loop over all mesh faces
-        for (unsigned int mesh_idx = 0; mesh_idx < mesh.faces.size(); mesh_idx++)
+/*!
+ * \brief How a face crosses a layer, for each combination of its vertices
+ * being below, on or above the layer.
+ *
+ * See Slicer::projectFaceBlock for the edge cases this encodes.
+ */
+struct FaceCrossing
+{
+    bool sliced = false; //!< Whether the face creates a segment on the layer at all.
+    uint8_t corner[3] = {0, 0, 0}; //!< The order in which to pass the vertices to Slicer::project2D.
+    uint8_t end_edge_idx = 0; //!< The edge of the face through which the segment leaves it.
+    int8_t end_vertex_idx = -1; //!< The vertex on which the segment ends, if it ends on a vertex exactly.
+};
+
+/*!
+ * \brief Lookup table of face crossings, indexed by
+ * <tt>side(p0) + 3 * side(p1) + 9 * side(p2)</tt> where side is 0 below, 1
+ * on and 2 above the layer.
+ */
+static constexpr std::array<FaceCrossing, 27> buildFaceCrossingTable()
+{
+    std::array<FaceCrossing, 27> table{};
+    for (size_t idx = 0; idx < table.size(); idx++)
+    {
+        const uint8_t side[3] = { static_cast<uint8_t>(idx % 3), static_cast<uint8_t>(idx / 3 % 3), static_cast<uint8_t>(idx / 9) };
+        constexpr uint8_t below = 0;
+        constexpr uint8_t on = 1;
+        constexpr uint8_t above = 2;
+        FaceCrossing& crossing = table[idx];
+        // Each case is named after the vertex which is alone on its side of the layer.
+        for (uint8_t lone = 0; lone < 3; lone++)
         {
-            if ((z < zbbox[mesh_idx].first) || (z > zbbox[mesh_idx].second))
+            const uint8_t next = (lone + 1) % 3;
+            const uint8_t prev = (lone + 2) % 3;
+            if (side[lone] == below && side[next] == above && side[prev] == above)
+            {
+                crossing.sliced = true;
+                crossing.corner[0] = lone;
+                crossing.corner[1] = prev;
+                crossing.corner[2] = next;
+                crossing.end_edge_idx = lone;
+            }
+            else if (side[lone] == above && side[next] != above && side[prev] != above)
             {
-                continue;
+                crossing.sliced = true;
+                crossing.corner[0] = lone;
+                crossing.corner[1] = next;
+                crossing.corner[2] = prev;
+                crossing.end_edge_idx = prev;
+                crossing.end_vertex_idx = side[prev] == on ? prev : -1;
             }
+        }
+    }
+    return table;
+}
 
-            // get all vertices per face
-            const MeshFace& face = mesh.faces[mesh_idx];
-            const MeshVertex& v0 = mesh.vertices[face.vertex_index[0]];
-            const MeshVertex& v1 = mesh.vertices[face.vertex_index[1]];
-            const MeshVertex& v2 = mesh.vertices[face.vertex_index[2]];
+static constexpr std::array<FaceCrossing, 27> face_crossing_table = buildFaceCrossingTable();
 
-            // get all vertices represented as 3D point
-            Point3 p0 = v0.p;
-            Point3 p1 = v1.p;
-            Point3 p2 = v2.p;
+void Slicer::projectFaceBlock(const Mesh& mesh, const uint32_t* face_indices, const size_t block_size, const SlicingTolerance slicing_tolerance, SlicerLayer& layer)
+{
+    assert(block_size <= face_block_size);
+    const coord_t z = layer.z;
 
-            // Compensate for points exactly on the slice-boundary, except for 'inclusive', which already handles this correctly.
-            if (slicing_tolerance != SlicingTolerance::INCLUSIVE)
+    // Gather the corners of all faces in the block, so that the classification below runs over contiguous memory.
+    coord_t corner_z[3][face_block_size];
+    for (size_t i = 0; i < block_size; i++)
+    {
+        const MeshFace& face = mesh.faces[face_indices[i]];
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            corner_z[corner][i] = mesh.vertices[face.vertex_index[corner]].p.z;
+        }
+    }
+
+    // Compensate for points exactly on the slice-boundary, except for 'inclusive', which already handles this correctly.
+    if (slicing_tolerance != SlicingTolerance::INCLUSIVE)
+    {
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            for (size_t i = 0; i < block_size; i++)
             {
-                p0.z += static_cast<int>(p0.z == z);
-                p1.z += static_cast<int>(p1.z == z);
-                p2.z += static_cast<int>(p2.z == z);
+                corner_z[corner][i] += static_cast<coord_t>(corner_z[corner][i] == z);
             }
+        }
+    }
 
-            SlicerSegment s;
-            s.endVertex = nullptr;
-            int end_edge_idx = -1;
-
-            /*
-            Now see if the triangle intersects the layer, and if so, where.
-
-            Edge cases are important here:
-            - If all three vertices of the triangle are exactly on the layer,
-              don't count the triangle at all, because if the model is
-              watertight, there will be adjacent triangles on all 3 sides that
-              are not flat on the layer.
-            - If two of the vertices are exactly on the layer, only count the
-              triangle if the last vertex is going up. We can't count both
-              upwards and downwards triangles here, because if the model is
-              manifold there will always be an adjacent triangle that is going
-              the other way and you'd get double edges. You would also get one
-              layer too many if the total model height is an exact multiple of
-              the layer thickness. Between going up and going down, we need to
-              choose the triangles going up, because otherwise the first layer
-              of where the model starts will be empty and the model will float
-              in mid-air. We'd much rather let the last layer be empty in that
-              case.
-            - If only one of the vertices is exactly on the layer, the
-              intersection between the triangle and the plane would be a point.
-              We can't print points and with a manifold model there would be
-              line segments adjacent to the point on both sides anyway, so we
-              need to discard this 0-length line segment then.
-            - Vertices in ccw order if look from outside.
-            */
-
-            if (p0.z < z && p1.z > z && p2.z > z)              //  1_______2
-            {                                                  //   \     /
-                s = project2D(p0, p2, p1, z);                  //------------- z
-                end_edge_idx = 0;                              //     \ /
-            }                                                  //      0
-
-            else if (p0.z > z && p1.z <= z && p2.z <= z)       //      0
-            {                                                  //     / \      .
-                s = project2D(p0, p1, p2, z);                  //------------- z
-                end_edge_idx = 2;                              //   /     \    .
-                if (p2.z == z)                                 //  1_______2
-                {
-                     s.endVertex = &v2;
-                }
-            }
+    // Classify all faces at once, without branches.
+    uint8_t crossing_idx[face_block_size];
+    for (size_t i = 0; i < block_size; i++)
+    {
+        uint8_t idx = 0;
+        for (size_t corner = 3; corner-- > 0; )
+        {
+            idx = idx * 3 + static_cast<uint8_t>(corner_z[corner][i] >= z) + static_cast<uint8_t>(corner_z[corner][i] > z);
+        }
+        crossing_idx[i] = idx;
+    }
 
-            else if (p1.z < z && p0.z > z && p2.z > z)         //  0_______2
-            {                                                  //   \     /
-                s = project2D(p1, p0, p2, z);                  //------------- z
-                end_edge_idx = 1;                              //     \ /
-            }                                                  //      1
-
-            else if (p1.z > z && p0.z <= z && p2.z <= z)       //      1
-            {                                                  //     / \      .
-                s = project2D(p1, p2, p0, z);                  //------------- z
-                end_edge_idx = 0;                              //   /     \    .
-                if (p0.z == z)                                 //  0_______2
-                {
-                     s.endVertex = &v0;
-                }
-            }
+    /*
+    Project the faces which intersect the layer.
+
+    Edge cases are important here, and are encoded in face_crossing_table:
+    - If all three vertices of the triangle are exactly on the layer,
+      don't count the triangle at all, because if the model is
+      watertight, there will be adjacent triangles on all 3 sides that
+      are not flat on the layer.
+    - If two of the vertices are exactly on the layer, only count the
+      triangle if the last vertex is going up. We can't count both
+      upwards and downwards triangles here, because if the model is
+      manifold there will always be an adjacent triangle that is going
+      the other way and you'd get double edges. You would also get one
+      layer too many if the total model height is an exact multiple of
+      the layer thickness. Between going up and going down, we need to
+      choose the triangles going up, because otherwise the first layer
+      of where the model starts will be empty and the model will float
+      in mid-air. We'd much rather let the last layer be empty in that
+      case.
+    - If only one of the vertices is exactly on the layer, the
+      intersection between the triangle and the plane would be a point.
+      We can't print points and with a manifold model there would be
+      line segments adjacent to the point on both sides anyway, so we
+      need to discard this 0-length line segment then.
+    - Vertices in ccw order if look from outside.
+    */
+    for (size_t i = 0; i < block_size; i++)
+    {
+        const FaceCrossing& crossing = face_crossing_table[crossing_idx[i]];
+        if (!crossing.sliced)
+        {
+            //Not all cases create a segment, because a point of a face could create just a dot, and two touching faces
+            //  on the slice would create two segments
+            continue;
+        }
 
-            else if (p2.z < z && p1.z > z && p0.z > z)         //  0_______1
-            {                                                  //   \     /
-                s = project2D(p2, p1, p0, z);                  //------------- z
-                end_edge_idx = 2;                              //     \ /
-            }                                                  //      2
-
-            else if (p2.z > z && p1.z <= z && p0.z <= z)       //      2
-            {                                                  //     / \      .
-                s = project2D(p2, p0, p1, z);                  //------------- z
-                end_edge_idx = 1;                              //   /     \    .
-                if (p1.z == z)                                 //  0_______1
-                {
-                    s.endVertex = &v1;
-                }
-            }
-            else
-            {
-                //Not all cases create a segment, because a point of a face could create just a dot, and two touching faces
-                //  on the slice would create two segments
-                continue;
-            }
+        const int face_idx = face_indices[i];
+        const MeshFace& face = mesh.faces[face_idx];
+        Point3 p[3];
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            p[corner] = mesh.vertices[face.vertex_index[crossing.corner[corner]]].p;
+            p[corner].z = corner_z[crossing.corner[corner]][i];
+        }
+
+        SlicerSegment s = project2D(p[0], p[1], p[2], z);
+        s.endVertexIdx = crossing.end_vertex_idx < 0 ? -1 : face.vertex_index[crossing.end_vertex_idx];
 
-            // store the segments per layer
-            layers[layer_nr].face_idx_to_segment_idx.insert(std::make_pair(mesh_idx, layers[layer_nr].segments.size()));
-            s.faceIndex = mesh_idx;
-            s.endOtherFaceIdx = face.connected_face_index[end_edge_idx];
-            s.addedToPolygon = false;
-            layers[layer_nr].segments.push_back(s);
+        // store the segments per layer. The faces of a layer are visited in increasing order, so the segments stay sorted by face.
+        assert((layer.segments.empty() || layer.segments.back().faceIndex < face_idx) && "The segments must be sorted by face for tryFaceNextSegmentIdx.");
+        s.faceIndex = face_idx;
+        s.endOtherFaceIdx = face.connected_face_index[crossing.end_edge_idx];
+        s.addedToPolygon = false;
+        layer.segments.push_back(s);
+    }
+}
+
+void Slicer::buildFacesPerLayer
+(
+    const std::vector<std::pair<int32_t, int32_t>>& zbbox,
+    const std::vector<SlicerLayer>& layers,
+    std::vector<size_t>& layer_face_start,
+    std::vector<uint32_t>& layer_faces
+)
+{
+    // Layers are normally already in increasing z order, but sort them anyway so that the binary search is always valid.
+    std::vector<size_t> layer_order(layers.size());
+    std::iota(layer_order.begin(), layer_order.end(), 0);
+    std::stable_sort(layer_order.begin(), layer_order.end(), [&layers](const size_t a, const size_t b) { return layers[a].z < layers[b].z; });
+    std::vector<int32_t> sorted_z;
+    sorted_z.reserve(layers.size());
+    for (const size_t layer_idx : layer_order)
+    {
+        sorted_z.push_back(layers[layer_idx].z);
+    }
+
+    // A face spans all layers with zbbox.first <= z <= zbbox.second, which is a contiguous range of the sorted layers.
+    const auto getLayerRange = [&sorted_z](const std::pair<int32_t, int32_t>& face_zbbox)
+    {
+        const size_t first = std::lower_bound(sorted_z.begin(), sorted_z.end(), face_zbbox.first) - sorted_z.begin();
+        const size_t last = std::upper_bound(sorted_z.begin(), sorted_z.end(), face_zbbox.second) - sorted_z.begin();
+        return std::make_pair(first, std::max(first, last));
+    };
+
+    // First count the faces per layer, then fill them in. Faces are visited in increasing order so each layer's list stays sorted.
+    std::vector<size_t> face_count(layers.size() + 1, 0);
+    for (const std::pair<int32_t, int32_t>& face_zbbox : zbbox)
+    {
+        const std::pair<size_t, size_t> range = getLayerRange(face_zbbox);
+        for (size_t sorted_idx = range.first; sorted_idx < range.second; sorted_idx++)
+        {
+            face_count[layer_order[sorted_idx]]++;
+        }
+    }
+    layer_face_start.assign(layers.size() + 1, 0);
+    for (size_t layer_idx = 0; layer_idx < layers.size(); layer_idx++)
+    {
+        layer_face_start[layer_idx + 1] = layer_face_start[layer_idx] + face_count[layer_idx];
+    }
+
+    layer_faces.resize(layer_face_start.back());
+    std::vector<size_t> insert_pos(layer_face_start.begin(), layer_face_start.end() - 1);
+    for (uint32_t face_idx = 0; face_idx < zbbox.size(); face_idx++)
+    {
+        const std::pair<size_t, size_t> range = getLayerRange(zbbox[face_idx]);
+        for (size_t sorted_idx = range.first; sorted_idx < range.second; sorted_idx++)
+        {
+            layer_faces[insert_pos[layer_order[sorted_idx]]++] = face_idx;
         }
     }
 }
@@ -995,40 +1256,61 @@ std::vector<SlicerLayer> Slicer::buildLayersWithHeight(size_t slice_layer_count,
     return layers_res;
 }
 
-void Slicer::makePolygons(Mesh& mesh, SlicingTolerance slicing_tolerance, std::vector<SlicerLayer>& layers)
+namespace
 {
-    std::vector<SlicerLayer>& layers_ref = layers; // force layers not to be copied into the threads
 
-#pragma omp parallel for default(none) shared(mesh, layers_ref)
-    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
-    for (int layer_nr = 0; layer_nr < static_cast<int>(layers_ref.size()); layer_nr++)
+/*!
+ * Get the polygons of a layer with the slicing tolerance applied, which
+ * combines them with the layer above.
+ * \param layers The layers as they were sliced.
+ * \param layer_nr The layer to get the polygons of.
+ * \param slicing_tolerance How to combine the layer with the layer above,
+ * either inclusive or exclusive.
+ */
+Polygons combineWithLayerAbove(const std::vector<SlicerLayer>& layers, const size_t layer_nr, const SlicingTolerance slicing_tolerance)
+{
+    const Polygons& polygons = layers[layer_nr].polygons;
+    if (layer_nr + 1 >= layers.size())
     {
-        layers_ref[layer_nr].makePolygons(&mesh);
+        //Nothing is printed above the last layer, so exclusively there's nothing.
+        return slicing_tolerance == SlicingTolerance::EXCLUSIVE ? Polygons() : polygons;
     }
+    const Polygons& polygons_above = layers[layer_nr + 1].polygons;
+    return slicing_tolerance == SlicingTolerance::EXCLUSIVE ? polygons.intersection(polygons_above) : polygons.unionPolygons(polygons_above);
+}
 
-    switch(slicing_tolerance)
+} //Anonymous namespace.
+
+void Slicer::makePolygons(Mesh& mesh, SlicingTolerance slicing_tolerance, std::vector<SlicerLayer>& layers)
+{
+    std::vector<size_t> segment_counts(layers.size());
+    for (size_t layer_nr = 0; layer_nr < layers.size(); layer_nr++)
     {
-    case SlicingTolerance::INCLUSIVE:
-        for (unsigned int layer_nr = 0; layer_nr + 1 < layers_ref.size(); layer_nr++)
-        {
-            layers[layer_nr].polygons = layers[layer_nr].polygons.unionPolygons(layers[layer_nr + 1].polygons);
-        }
-        break;
-    case SlicingTolerance::EXCLUSIVE:
-        for (unsigned int layer_nr = 0; layer_nr + 1 < layers_ref.size(); layer_nr++)
+        segment_counts[layer_nr] = layers[layer_nr].segments.size();
+    }
+    ParallelSchedule("make polygons", segment_counts).run([&](const size_t layer_nr)
+    {
+        if (Cancellation::isRequested())
         {
-            layers[layer_nr].polygons = layers[layer_nr].polygons.intersection(layers[layer_nr + 1].polygons);
+            return;
         }
-        layers.back().polygons.clear();
-        break;
-    case SlicingTolerance::MIDDLE:
-    default:
-        // do nothing
-        ;
+        layers[layer_nr].makePolygons(&mesh);
+    });
+
+    //The slicing tolerance combines each layer with the layer above it as it was sliced, so the new polygons are kept apart until all layers are done.
+    std::vector<Polygons> combined_layers;
+    if (slicing_tolerance == SlicingTolerance::INCLUSIVE || slicing_tolerance == SlicingTolerance::EXCLUSIVE)
+    {
+        combined_layers.resize(layers.size());
+    }
+    if (! combined_layers.empty())
+    {
+        //The first layer is needed to know which layers get the initial layer horizontal expansion.
+        combined_layers[0] = combineWithLayerAbove(layers, 0, slicing_tolerance);
     }
 
-   LayerIndex layer_apply_initial_xy_offset = 0;
-    if (layers.size() > 0 && layers[0].polygons.size() == 0
+    LayerIndex layer_apply_initial_xy_offset = 0;
+    if (layers.size() > 0 && (combined_layers.empty() ? layers[0].polygons : combined_layers[0]).size() == 0
         && !mesh.settings.get<bool>("support_mesh")
         && !mesh.settings.get<bool>("anti_overhang_mesh")
         && !mesh.settings.get<bool>("cutting_mesh")
@@ -1037,16 +1319,35 @@ void Slicer::makePolygons(Mesh& mesh, SlicingTolerance slicing_tolerance, std::v
         layer_apply_initial_xy_offset = 1;
     }
 
-#pragma omp parallel for default(none) shared(mesh, layers_ref, layer_apply_initial_xy_offset)
-    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
-    for (int layer_nr = 0; layer_nr < static_cast<int>(layers_ref.size()); layer_nr++)
+    std::vector<size_t> vertex_counts(layers.size());
+    for (size_t layer_nr = 0; layer_nr < layers.size(); layer_nr++)
     {
-        const coord_t xy_offset = mesh.settings.get<coord_t>((layer_nr <= layer_apply_initial_xy_offset) ? "xy_offset_layer_0" : "xy_offset");
+        vertex_counts[layer_nr] = layers[layer_nr].polygons.pointCount();
+    }
+    ParallelSchedule("offset layers", vertex_counts).run([&](const size_t layer_nr)
+    {
+        if (Cancellation::isRequested())
+        {
+            return;
+        }
+        if (! combined_layers.empty() && layer_nr > 0)
+        {
+            combined_layers[layer_nr] = combineWithLayerAbove(layers, layer_nr, slicing_tolerance);
+        }
+        Polygons& polygons = combined_layers.empty() ? layers[layer_nr].polygons : combined_layers[layer_nr];
+
+        const coord_t xy_offset = mesh.settings.get<coord_t>((static_cast<LayerIndex>(layer_nr) <= layer_apply_initial_xy_offset) ? "xy_offset_layer_0" : "xy_offset");
 
         if (xy_offset != 0)
         {
-            layers_ref[layer_nr].polygons = layers_ref[layer_nr].polygons.offset(xy_offset, ClipperLib::JoinType::jtRound);
+            //The offset finds the parts of the layer anyway, so they're kept for when the layer parts are created.
+            polygons = polygons.offsetIntoParts(xy_offset, layers[layer_nr].part_starts, ClipperLib::JoinType::jtRound);
         }
+    });
+
+    for (size_t layer_nr = 0; layer_nr < combined_layers.size(); layer_nr++)
+    {
+        layers[layer_nr].polygons = std::move(combined_layers[layer_nr]);
     }
 
     mesh.expandXY(mesh.settings.get<coord_t>("xy_offset"));
@@ -7,6 +7,7 @@
 #include <queue>
 #include <unordered_map>
 #include "utils/polygon.h"
+#include "utils/SparseLineGrid.h"
 #include "settings/EnumSettings.h"
 
 /*
@@ -18,7 +19,6 @@ namespace cura
 
 class AdaptiveLayer;
 class Mesh;
-class MeshVertex;
 
 class SlicerSegment
 {
@@ -28,8 +28,8 @@ public:
     // The index of the other face connected via the edge that created end
     int endOtherFaceIdx = -1;
     // If end corresponds to a vertex of the mesh, then this is populated
-    // with the vertex that it ended on.
-    const MeshVertex* endVertex = nullptr;
+    // with the index of the vertex that it ended on.
+    int endVertexIdx = -1;
     bool addedToPolygon = false;
 };
 
@@ -53,13 +53,31 @@ public:
 class SlicerLayer
 {
 public:
+    /*!
+     * The segments of this layer, sorted by the face they were made from.
+     *
+     * A face makes at most one segment per layer, so the segment of a face is
+     * found with a binary search rather than a map from faces to segments,
+     * which would need an allocation for each segment.
+     */
     std::vector<SlicerSegment> segments;
-    std::unordered_map<int, int> face_idx_to_segment_idx; // topology
 
     int z = -1;
     Polygons polygons;
     Polygons openPolylines;
 
+    /*!
+     * Where each part starts in \ref polygons , if the slicer already split
+     * them into parts. The outline of each part is followed by its holes, up
+     * to the outline of the next part.
+     *
+     * The slicer knows the parts when it offsets the layer, which saves the
+     * union when the layer parts are created. This is empty if the polygons
+     * aren't ordered by part. Anything that changes the polygons after
+     * slicing must clear it.
+     */
+    std::vector<size_t> part_starts;
+
     /*!
      * \brief Connect the segments into polygons for this layer of this \p mesh.
      * \param[in] mesh The mesh data for which we are connecting sliced
@@ -71,27 +89,30 @@ protected:
     /*!
      * Connect the segments into loops which correctly form polygons (don't perform stitching here)
      *
+     * \param[in] mesh The mesh to which the segments belong.
      * \param[in,out] open_polylines The polylines which are stiched, but couldn't be closed into a loop
      */
-    void makeBasicPolygonLoops(Polygons& open_polylines);
+    void makeBasicPolygonLoops(const Mesh& mesh, Polygons& open_polylines);
 
     /*!
      * Connect the segments into a loop, starting from the segment with index \p start_segment_idx
      *
+     * \param[in] mesh The mesh to which the segments belong.
      * \param[in,out] open_polylines The polylines which are stiched, but couldn't be closed into a loop
      * \param[in] start_segment_idx The index into SlicerLayer::segments for the first segment from which to start the polygon loop
      */
-    void makeBasicPolygonLoop(Polygons& open_polylines, const size_t start_segment_idx);
+    void makeBasicPolygonLoop(const Mesh& mesh, Polygons& open_polylines, const size_t start_segment_idx);
 
     /*!
      * Get the next segment connected to the end of \p segment.
      * Used to make closed polygon loops.
      * Return ASAP if segment is (also) connected to SlicerLayer::segments[\p start_segment_idx]
      *
+     * \param[in] mesh The mesh to which the segments belong.
      * \param[in] segment The segment from which to start looking for the next
      * \param[in] start_segment_idx The index to the segment which when conected to \p segment will immediately stop looking for further candidates.
      */
-    int getNextSegmentIdx(const SlicerSegment& segment, const size_t start_segment_idx) const;
+    int getNextSegmentIdx(const Mesh& mesh, const SlicerSegment& segment, const size_t start_segment_idx) const;
 
     /*!
      * Connecting polygons that are not closed yet, as models are not always perfect manifold we need to join some stuff up to get proper polygons.
@@ -116,6 +137,48 @@ protected:
 
     ClosePolygonResult findPolygonPointClosestTo(Point input);
 
+    /*!
+     * \brief A line segment of one of the closed \ref polygons, as stored in
+     * the grid used to speed up extensive stitching.
+     */
+    struct PolygonSegment
+    {
+        Point from; //!< The vertex before \ref point_idx.
+        Point to; //!< The vertex at \ref point_idx.
+        unsigned int polygon_idx; //!< The index of the polygon in \ref polygons.
+        unsigned int point_idx; //!< The index of the end vertex of the segment in the polygon.
+    };
+
+    struct PolygonSegmentLocator
+    {
+        std::pair<Point, Point> operator()(const PolygonSegment& segment) const
+        {
+            return std::make_pair(segment.from, segment.to);
+        }
+    };
+
+    using PolygonSegmentGrid = SparseLineGrid<PolygonSegment, PolygonSegmentLocator>;
+
+    /*!
+     * Add the segments of the polygons with index \p first_polygon_idx and
+     * higher to \p grid.
+     */
+    void addPolygonSegmentsToGrid(PolygonSegmentGrid& grid, const size_t first_polygon_idx) const;
+
+    /*!
+     * Same as \ref findPolygonGapCloser(Point, Point), with the closest
+     * positions on the polygons for both end points already known.
+     */
+    GapCloserResult findPolygonGapCloser(Point ip0, Point ip1, const ClosePolygonResult& c1, const ClosePolygonResult& c2) const;
+
+    /*!
+     * Same as \ref findPolygonPointClosestTo(Point), using a grid of all the
+     * segments of \ref polygons to only check the segments near the point.
+     *
+     * This gives the same result as testing all segments in order.
+     */
+    ClosePolygonResult findPolygonPointClosestTo(Point input, const PolygonSegmentGrid& grid) const;
+
     /*!
      * Try to close up polylines into polygons while they have large gaps in them.
      *
@@ -493,6 +556,15 @@ public:
 
     Slicer(Mesh* mesh, const coord_t thickness, const size_t slice_layer_count, bool use_variable_layer_heights, std::vector<AdaptiveLayer> *adaptive_layers);
 
+    /*!
+     * \brief Use the layers that the same mesh was sliced into before, instead
+     * of slicing it again.
+     * \param mesh The sliced mesh.
+     * \param sliced_layers The layers that the slicer produced for this mesh
+     * with the same settings, see SlicerCache.
+     */
+    Slicer(Mesh* mesh, const std::vector<SlicerLayer>& sliced_layers);
+
 
 private:
 
@@ -524,12 +596,56 @@ private:
      */
     static SlicerSegment project2D(const Point3& p0, const Point3& p1, const Point3& p2, const coord_t z);
 
+    /*!
+     * \brief The number of faces which \ref projectFaceBlock processes at once.
+     */
+    static constexpr size_t face_block_size = 64;
+
+    /*!
+     * \brief Slice a block of faces at the height of one layer.
+     *
+     * The vertex heights of all faces in the block are gathered first, then
+     * all faces are classified by a table lookup and finally the faces which
+     * cross the layer are projected with \ref project2D. This gives the same
+     * segments as projecting the faces one by one, but keeps the per-face
+     * classification free of branches and pointer chasing.
+     * \param mesh The mesh to which the faces belong.
+     * \param face_indices The indices of the faces to slice.
+     * \param block_size The number of faces in \p face_indices, at most
+     * \ref face_block_size.
+     * \param slicing_tolerance How to handle vertices exactly on the layer.
+     * \param[in,out] layer The layer to slice. The segments are added to it.
+     */
+    static void projectFaceBlock(const Mesh& mesh, const uint32_t* face_indices, const size_t block_size, const SlicingTolerance slicing_tolerance, SlicerLayer& layer);
+
     /*! Creates an array of "z bounding boxes" for each face.
     * \param[in] mesh The mesh which is analyzed.
     * \return z heights aka z bounding boxes of the faces.
     */
     static std::vector<std::pair<int32_t, int32_t>> buildZHeightsForFaces(const Mesh &mesh);
 
+    /*!
+     * \brief Index the faces by the layers they span.
+     *
+     * Instead of testing every face against every layer, the layer heights are
+     * sorted once and the range of layers intersecting each face is found with
+     * a binary search. The result is stored in a compressed form: the faces of
+     * layer \p i are <tt>layer_faces[layer_face_start[i] ...
+     * layer_face_start[i + 1]]</tt>, in increasing face index order.
+     * \param[in] zbboxes The z part of the bounding boxes of the faces.
+     * \param[in] layers The layers, with their z value set.
+     * \param[out] layer_face_start Per layer, the start of its faces in
+     * \p layer_faces. Has one more element than \p layers.
+     * \param[out] layer_faces The face indices of all layers, concatenated.
+     */
+    static void buildFacesPerLayer
+    (
+        const std::vector<std::pair<int32_t, int32_t>>& zbboxes,
+        const std::vector<SlicerLayer>& layers,
+        std::vector<size_t>& layer_face_start,
+        std::vector<uint32_t>& layer_faces
+    );
+
     /*! Creates the polygons in layers.
     * \param[in] mesh The mesh which is analyzed.
     * \param[in] slicing_tolerance The way the slicing tolerance should be applied (MIDDLE/INCLUSIVE/EXCLUSIVE).
@@ -1,10 +1,12 @@
 //Copyright (c) 2022 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> // max
 #include <cmath> // sqrt, round
 #include <utility> // pair
 #include <deque>
 #include <fstream> // ifstream.good()
+#include <optional>
 
 #ifdef _OPENMP
     #include <omp.h>
@@ -19,14 +21,18 @@
 #include "infill.h"
 #include "infill/ImageBasedDensityProvider.h"
 #include "infill/SierpinskiFillProvider.h"
+#include "infill/SierpinskiFillProviderCache.h"
 #include "infill/UniformDensityProvider.h"
 #include "progress/Progress.h"
 #include "settings/EnumSettings.h" //For EFillMethod.
 #include "settings/types/Angle.h" //To compute overhang distance from the angle.
 #include "settings/types/Ratio.h"
 #include "utils/algorithm.h"
+#include "utils/BoxGrid.h" //To find the parts on other layers that are close to a part.
 #include "utils/logoutput.h"
 #include "utils/math.h"
+#include "utils/PreparedPolygons.h" //To check where to place towers.
+#include "utils/SlowestParts.h"
 
 namespace cura
 {
@@ -41,8 +47,12 @@ bool AreaSupport::handleSupportModifierMesh(SliceDataStorage& storage, const Set
     ModifierType modifier_type = (mesh_settings.get<bool>("anti_overhang_mesh")) ? ANTI_OVERHANG : ((mesh_settings.get<bool>("support_mesh_drop_down")) ? SUPPORT_DROP_DOWN : SUPPORT_VANILLA);
     for (unsigned int layer_nr = 0; layer_nr < slicer->layers.size(); layer_nr++)
     {
-        SupportLayer& support_layer = storage.support.supportLayers[layer_nr];
         const SlicerLayer& slicer_layer = slicer->layers[layer_nr];
+        if (slicer_layer.polygons.empty())
+        {
+            continue; //Don't allocate support layers that this mesh doesn't reach.
+        }
+        SupportLayer& support_layer = storage.support.supportLayers[layer_nr];
         switch (modifier_type)
         {
         case ANTI_OVERHANG:
@@ -77,38 +87,47 @@ void AreaSupport::splitGlobalSupportAreasIntoSupportInfillParts(SliceDataStorage
 
     // The wall line count is used for calculating insets, and we generate support infill patterns within the insets
     const size_t wall_line_count = infill_extruder.settings.get<size_t>("support_wall_count");
+    const bool is_raft = mesh_group_settings.get<EPlatformAdhesion>("adhesion_type") == EPlatformAdhesion::RAFT;
+    const Ratio initial_layer_line_width_factor = infill_extruder.settings.get<Ratio>("initial_layer_line_width_factor");
 
-    // Generate separate support islands
-    for (unsigned int layer_nr = 0; layer_nr < total_layer_count - 1; ++layer_nr)
+    // Generate separate support islands. Each layer is split on its own.
+#pragma omp parallel for default(none) shared(storage, global_support_areas_per_layer, total_layer_count, min_layer, max_layer, support_pattern, support_line_width, wall_line_count, is_raft, initial_layer_line_width_factor) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_idx = 0; layer_idx < static_cast<int>(total_layer_count) - 1; layer_idx++)
     {
+        const size_t layer_nr = layer_idx;
         unsigned int wall_line_count_this_layer = wall_line_count;
         if (layer_nr == 0 && (support_pattern == EFillMethod::LINES || support_pattern == EFillMethod::ZIG_ZAG))
         { // The first layer will be printed with a grid pattern
             wall_line_count_this_layer++;
         }
-        assert(storage.support.supportLayers[layer_nr].support_infill_parts.empty() && "support infill part list is supposed to be uninitialized");
+        const SparseLayerVector<SupportLayer>& const_support_layers = storage.support.supportLayers; //Only reading, so that empty layers aren't allocated.
+        assert(const_support_layers[layer_nr].support_infill_parts.empty() && "support infill part list is supposed to be uninitialized");
 
         const Polygons& global_support_areas = global_support_areas_per_layer[layer_nr];
         if (global_support_areas.size() == 0 || layer_nr < min_layer || layer_nr > max_layer)
         {
-            // Initialize support_infill_parts empty
-            storage.support.supportLayers[layer_nr].support_infill_parts.clear();
-            continue;
+            continue; //The support infill parts are still empty.
         }
 
         std::vector<PolygonsPart> support_islands = global_support_areas.splitIntoParts();
+        if (support_islands.empty())
+        {
+            continue;
+        }
+        std::vector<SupportInfillPart>& support_infill_parts = storage.support.supportLayers[layer_nr].support_infill_parts; //Only now allocate the layer.
         for (const PolygonsPart& island_outline : support_islands)
         {
             coord_t support_line_width_here = support_line_width;
-            if (layer_nr == 0 && mesh_group_settings.get<EPlatformAdhesion>("adhesion_type") != EPlatformAdhesion::RAFT)
+            if (layer_nr == 0 && !is_raft)
             {
-                support_line_width_here *= infill_extruder.settings.get<Ratio>("initial_layer_line_width_factor");
+                support_line_width_here *= initial_layer_line_width_factor;
             }
             // We don't generate insets and infill area for the parts yet because later the skirt/brim and prime
             // tower will remove themselves from the support, so the outlines of the parts can be changed.
             SupportInfillPart support_infill_part(island_outline, support_line_width_here, wall_line_count_this_layer);
 
-            storage.support.supportLayers[layer_nr].support_infill_parts.push_back(support_infill_part);
+            support_infill_parts.push_back(support_infill_part);
         }
     }
 }
@@ -188,13 +207,34 @@ void AreaSupport::generateGradualSupport(SliceDataStorage& storage)
     LayerIndex min_layer = 0;
     LayerIndex max_layer = total_layer_count - 1;
 
+    // Index the parts, so that only the upper parts close to each part have to be looked at.
+    // This only uses the outlines, which aren't changed below.
+    std::vector<BoxGrid> part_grid_per_layer(total_layer_count);
+#pragma omp parallel for default(none) shared(storage, total_layer_count, part_grid_per_layer) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(total_layer_count); layer_nr++)
+    {
+        const SparseLayerVector<SupportLayer>& support_layers = storage.support.supportLayers; //Only reading, so that empty layers aren't allocated.
+        std::vector<AABB> part_boxes;
+        for (const SupportInfillPart& part : support_layers[layer_nr].support_infill_parts)
+        {
+            part_boxes.push_back(part.outline_boundary_box);
+        }
+        part_grid_per_layer[layer_nr] = BoxGrid(part_boxes);
+    }
+
     // compute different density areas for each support island
-    for (LayerIndex layer_nr = 0; layer_nr < static_cast<LayerIndex>(total_layer_count) - 1; layer_nr++)
+    // Each layer only reads the outlines of the layers above and only writes to its own parts, so the layers are processed in parallel.
+#pragma omp parallel for default(none) shared(storage, total_layer_count, min_layer, max_layer, part_grid_per_layer, max_density_steps, gradual_support_step_layer_count, layer_skip_count, wall_count, wall_width, overlap, infill_extruder) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_idx = 0; layer_idx < static_cast<int>(total_layer_count) - 1; layer_idx++)
     {
-        if (layer_nr < min_layer || layer_nr > max_layer)
+        const LayerIndex layer_nr = layer_idx;
+        if (layer_nr < min_layer || layer_nr > max_layer || !storage.support.supportLayers.isAllocated(layer_nr)) //Layers that were never allocated have no parts.
         {
             continue;
         }
+        const SparseLayerVector<SupportLayer>& support_layers = storage.support.supportLayers; //Only reading the layers above, so that empty layers aren't allocated.
 
         // generate separate support islands and calculate density areas for each island
         std::vector<SupportInfillPart>& support_infill_parts = storage.support.supportLayers[layer_nr].support_infill_parts;
@@ -227,17 +267,11 @@ void AreaSupport::generateGradualSupport(SliceDataStorage& storage)
                     }
 
                     // compute intersections with relevant upper parts
-                    const std::vector<SupportInfillPart> upper_infill_parts = storage.support.supportLayers[upper_layer_idx].support_infill_parts;
+                    const std::vector<SupportInfillPart>& upper_infill_parts = support_layers[upper_layer_idx].support_infill_parts;
                     Polygons relevant_upper_polygons;
-                    for (unsigned int upper_part_idx = 0; upper_part_idx < upper_infill_parts.size(); ++upper_part_idx)
+                    if (!support_infill_part.outline.empty())
                     {
-                        if (support_infill_part.outline.empty())
-                        {
-                            continue;
-                        }
-
                         // we compute intersection based on support infill areas
-                        const AABB& upper_part_boundary_box = upper_infill_parts[upper_part_idx].outline_boundary_box;
                         //
                         // Here we are comparing the **outlines** of the infill areas
                         //
@@ -254,13 +288,13 @@ void AreaSupport::generateGradualSupport(SliceDataStorage& storage)
                         //    ++++####||    ++++##||^         ++++++##||        ++++++||^
                         //    ++++++####    +++++##||         ++++++++##        +++++++||
                         //
-                        if (upper_part_boundary_box.hit(this_part_boundary_box))
+                        for (const size_t upper_part_idx : part_grid_per_layer[upper_layer_idx].getOverlapping(this_part_boundary_box))
                         {
                             relevant_upper_polygons.add(upper_infill_parts[upper_part_idx].outline);
                         }
                     }
 
-                    less_dense_support = less_dense_support.intersection(relevant_upper_polygons);
+                    less_dense_support.intersectionInPlace(relevant_upper_polygons);
                 }
                 if (less_dense_support.size() == 0)
                 {
@@ -319,6 +353,10 @@ void AreaSupport::combineSupportInfillLayers(SliceDataStorage& storage)
         {
             break;
         }
+        if (!storage.support.supportLayers.isAllocated(layer_idx))
+        {
+            continue; //No parts to combine, and don't allocate the layer for that.
+        }
 
         SupportLayer& layer = storage.support.supportLayers[layer_idx];
         for (unsigned int combine_count_here = 1; combine_count_here < combine_layers_amount; ++combine_count_here)
@@ -333,6 +371,10 @@ void AreaSupport::combineSupportInfillLayers(SliceDataStorage& storage)
             {
                 break;
             }
+            if (!storage.support.supportLayers.isAllocated(lower_layer_idx))
+            {
+                continue; //No parts to combine with.
+            }
             SupportLayer& lower_layer = storage.support.supportLayers[lower_layer_idx];
 
             for (SupportInfillPart& part : layer.support_infill_parts)
@@ -377,7 +419,7 @@ void AreaSupport::combineSupportInfillLayers(SliceDataStorage& storage)
                         for (unsigned int lower_density_idx = density_idx; lower_density_idx <= max_lower_density_idx && lower_density_idx < lower_layer_part.infill_area_per_combine_per_density.size(); lower_density_idx++)
                         {
                             std::vector<Polygons>& lower_infill_area_per_combine = lower_layer_part.infill_area_per_combine_per_density[lower_density_idx];
-                            lower_infill_area_per_combine[0] = lower_infill_area_per_combine[0].difference(intersection); // remove thickened area from lower (single thickness) layer
+                            lower_infill_area_per_combine[0].differenceInPlace(intersection); // remove thickened area from lower (single thickness) layer
                         }
                     }
 
@@ -393,6 +435,10 @@ void AreaSupport::cleanup(SliceDataStorage& storage)
     const coord_t support_line_width = Application::getInstance().current_slice->scene.current_mesh_group->settings.get<coord_t>("support_line_width");
     for (unsigned int layer_nr = 0; layer_nr < storage.support.supportLayers.size(); layer_nr++)
     {
+        if (!storage.support.supportLayers.isAllocated(layer_nr))
+        {
+            continue; //No parts to clean up.
+        }
         SupportLayer& layer = storage.support.supportLayers[layer_nr];
         for (unsigned int part_idx = 0; part_idx < layer.support_infill_parts.size(); part_idx++)
         {
@@ -432,7 +478,7 @@ void AreaSupport::cleanup(SliceDataStorage& storage)
     }
 }
 
-Polygons AreaSupport::join(const SliceDataStorage& storage, const Polygons& supportLayer_up, Polygons& supportLayer_this, const coord_t smoothing_distance)
+Polygons AreaSupport::join(const Polygons& supportLayer_up, Polygons& supportLayer_this, const coord_t smoothing_distance, const Polygons& conical_support_border)
 {
     Polygons joined;
 
@@ -451,81 +497,12 @@ Polygons AreaSupport::join(const SliceDataStorage& storage, const Polygons& supp
     const bool conical_support = infill_settings.get<bool>("support_conical_enabled") && conical_support_angle != 0;
     if (conical_support)
     {
-        const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
-        //Don't go outside the build volume.
-        Polygons machine_volume_border;
-        switch (mesh_group_settings.get<BuildPlateShape>("machine_shape"))
-        {
-            case BuildPlateShape::ELLIPTIC:
-            {
-                //Construct an ellipse to approximate the build volume.
-                const coord_t width = storage.machine_size.max.x - storage.machine_size.min.x;
-                const coord_t depth = storage.machine_size.max.y - storage.machine_size.min.y;
-                Polygon border_circle;
-                constexpr unsigned int circle_resolution = 50;
-                for (unsigned int i = 0; i < circle_resolution; i++)
-                {
-                    const AngleRadians angle = TAU * i / circle_resolution;
-                    const Point3 machine_middle = storage.machine_size.getMiddle();
-                    const coord_t x = machine_middle.x + cos(angle) * width / 2;
-                    const coord_t y = machine_middle.y + sin(angle) * depth / 2;
-                    border_circle.emplace_back(x, y);
-                }
-                machine_volume_border.add(border_circle);
-                break;
-            }
-            case BuildPlateShape::RECTANGULAR:
-            default:
-                machine_volume_border.add(storage.machine_size.flatten().toPolygon());
-                break;
-        }
-        coord_t adhesion_size = 0; //Make sure there is enough room for the platform adhesion around support.
-        const ExtruderTrain& skirt_brim_extruder = mesh_group_settings.get<ExtruderTrain&>("skirt_brim_extruder_nr");
-        coord_t extra_skirt_line_width = 0;
-        const std::vector<bool> is_extruder_used = storage.getExtrudersUsed();
-        for (size_t extruder_nr = 0; extruder_nr < Application::getInstance().current_slice->scene.extruders.size(); extruder_nr++)
-        {
-            if (extruder_nr == skirt_brim_extruder.extruder_nr || !is_extruder_used[extruder_nr]) //Unused extruders and the primary adhesion extruder don't generate an extra skirt line.
-            {
-                continue;
-            }
-            const ExtruderTrain& other_extruder = Application::getInstance().current_slice->scene.extruders[extruder_nr];
-            extra_skirt_line_width += other_extruder.settings.get<coord_t>("skirt_brim_line_width") * other_extruder.settings.get<Ratio>("initial_layer_line_width_factor");
-        }
-        switch (mesh_group_settings.get<EPlatformAdhesion>("adhesion_type"))
-        {
-            case EPlatformAdhesion::BRIM:
-                adhesion_size = 
-                    skirt_brim_extruder.settings.get<coord_t>("brim_width")
-                    + skirt_brim_extruder.settings.get<coord_t>("skirt_brim_line_width")
-                    * skirt_brim_extruder.settings.get<size_t>("brim_line_count")
-                    * skirt_brim_extruder.settings.get<Ratio>("initial_layer_line_width_factor")
-                    + extra_skirt_line_width;
-                break;
-            case EPlatformAdhesion::RAFT:
-            {
-                const ExtruderTrain& raft_extruder = mesh_group_settings.get<ExtruderTrain&>("adhesion_extruder_nr");
-                adhesion_size = raft_extruder.settings.get<coord_t>("raft_margin");
-                break;
-            }
-            case EPlatformAdhesion::SKIRT:
-                adhesion_size = skirt_brim_extruder.settings.get<coord_t>("skirt_gap") + skirt_brim_extruder.settings.get<coord_t>("skirt_brim_line_width") * skirt_brim_extruder.settings.get<Ratio>("initial_layer_line_width_factor") * skirt_brim_extruder.settings.get<size_t>("skirt_line_count") + extra_skirt_line_width;
-                break;
-            case EPlatformAdhesion::NONE:
-                adhesion_size = 0;
-                break;
-            default: //Also use 0.
-                log("Unknown platform adhesion type! Please implement the width of the platform adhesion here.");
-                break;
-        }
-        machine_volume_border = machine_volume_border.offset(-adhesion_size);
-
         const coord_t conical_smallest_breadth = infill_settings.get<coord_t>("support_conical_min_width");
         Polygons insetted = supportLayer_up.offset(-conical_smallest_breadth / 2);
         Polygons small_parts = supportLayer_up.difference(insetted.offset(conical_smallest_breadth / 2 + 20));
         joined = supportLayer_this.unionPolygons(supportLayer_up.offset(conical_support_offset))
                                   .unionPolygons(small_parts)
-                                  .intersection(machine_volume_border);
+                                  .intersection(conical_support_border);
     }
     else
     {
@@ -535,8 +512,8 @@ Polygons AreaSupport::join(const SliceDataStorage& storage, const Polygons& supp
     const coord_t join_distance = infill_settings.get<coord_t>("support_join_distance");
     if (join_distance > 0)
     {
-        joined = joined.offset(join_distance)
-                        .offset(-join_distance);
+        joined.offsetInPlace(join_distance)
+              .offsetInPlace(-join_distance);
     }
 
     // remove jagged line pieces introduced by unioning separate overhang areas for consectuive layers
@@ -569,8 +546,98 @@ Polygons AreaSupport::join(const SliceDataStorage& storage, const Polygons& supp
     return joined;
 }
 
+Polygons AreaSupport::getConicalSupportBorder(const SliceDataStorage& storage)
+{
+    const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
+    //Don't go outside the build volume.
+    Polygons machine_volume_border;
+    switch (mesh_group_settings.get<BuildPlateShape>("machine_shape"))
+    {
+        case BuildPlateShape::ELLIPTIC:
+        {
+            //Construct an ellipse to approximate the build volume.
+            const coord_t width = storage.machine_size.max.x - storage.machine_size.min.x;
+            const coord_t depth = storage.machine_size.max.y - storage.machine_size.min.y;
+            Polygon border_circle;
+            constexpr unsigned int circle_resolution = 50;
+            for (unsigned int i = 0; i < circle_resolution; i++)
+            {
+                const AngleRadians angle = TAU * i / circle_resolution;
+                const Point3 machine_middle = storage.machine_size.getMiddle();
+                const coord_t x = machine_middle.x + cos(angle) * width / 2;
+                const coord_t y = machine_middle.y + sin(angle) * depth / 2;
+                border_circle.emplace_back(x, y);
+            }
+            machine_volume_border.add(border_circle);
+            break;
+        }
+        case BuildPlateShape::RECTANGULAR:
+        default:
+            machine_volume_border.add(storage.machine_size.flatten().toPolygon());
+            break;
+    }
+    coord_t adhesion_size = 0; //Make sure there is enough room for the platform adhesion around support.
+    const ExtruderTrain& skirt_brim_extruder = mesh_group_settings.get<ExtruderTrain&>("skirt_brim_extruder_nr");
+    coord_t extra_skirt_line_width = 0;
+    const std::vector<bool> is_extruder_used = storage.getExtrudersUsed();
+    for (size_t extruder_nr = 0; extruder_nr < Application::getInstance().current_slice->scene.extruders.size(); extruder_nr++)
+    {
+        if (extruder_nr == skirt_brim_extruder.extruder_nr || !is_extruder_used[extruder_nr]) //Unused extruders and the primary adhesion extruder don't generate an extra skirt line.
+        {
+            continue;
+        }
+        const ExtruderTrain& other_extruder = Application::getInstance().current_slice->scene.extruders[extruder_nr];
+        extra_skirt_line_width += other_extruder.settings.get<coord_t>("skirt_brim_line_width") * other_extruder.settings.get<Ratio>("initial_layer_line_width_factor");
+    }
+    switch (mesh_group_settings.get<EPlatformAdhesion>("adhesion_type"))
+    {
+        case EPlatformAdhesion::BRIM:
+            adhesion_size = 
+                skirt_brim_extruder.settings.get<coord_t>("brim_width")
+                + skirt_brim_extruder.settings.get<coord_t>("skirt_brim_line_width")
+                * skirt_brim_extruder.settings.get<size_t>("brim_line_count")
+                * skirt_brim_extruder.settings.get<Ratio>("initial_layer_line_width_factor")
+                + extra_skirt_line_width;
+            break;
+        case EPlatformAdhesion::RAFT:
+        {
+            const ExtruderTrain& raft_extruder = mesh_group_settings.get<ExtruderTrain&>("adhesion_extruder_nr");
+            adhesion_size = raft_extruder.settings.get<coord_t>("raft_margin");
+            break;
+        }
+        case EPlatformAdhesion::SKIRT:
+            adhesion_size = skirt_brim_extruder.settings.get<coord_t>("skirt_gap") + skirt_brim_extruder.settings.get<coord_t>("skirt_brim_line_width") * skirt_brim_extruder.settings.get<Ratio>("initial_layer_line_width_factor") * skirt_brim_extruder.settings.get<size_t>("skirt_line_count") + extra_skirt_line_width;
+            break;
+        case EPlatformAdhesion::NONE:
+            adhesion_size = 0;
+            break;
+        default: //Also use 0.
+            log("Unknown platform adhesion type! Please implement the width of the platform adhesion here.");
+            break;
+    }
+    return machine_volume_border.offset(-adhesion_size);
+}
+
 void AreaSupport::generateOverhangAreas(SliceDataStorage& storage)
 {
+    // The overhang of each mesh is supported by the outlines of all meshes together.
+    // Those are the same for every mesh, so compute them only once, and only if any mesh needs overhang areas.
+    std::vector<Polygons> model_outlines_per_layer;
+    for (const SliceMeshStorage& mesh : storage.meshes)
+    {
+        if (mesh.settings.get<bool>("support_enable") && !mesh.settings.get<bool>("support_mesh") && !mesh.settings.get<bool>("infill_mesh") && !mesh.settings.get<bool>("anti_overhang_mesh"))
+        {
+            model_outlines_per_layer.resize(storage.print_layer_count);
+            cura::parallel_for<size_t>(0, storage.print_layer_count, 1, [&](const size_t layer_idx)
+            {
+                constexpr bool no_support = false;
+                constexpr bool no_prime_tower = false;
+                model_outlines_per_layer[layer_idx] = storage.getLayerOutlines(layer_idx, no_support, no_prime_tower);
+            });
+            break;
+        }
+    }
+
     for (SliceMeshStorage& mesh : storage.meshes)
     {
         if (mesh.settings.get<bool>("infill_mesh") || mesh.settings.get<bool>("anti_overhang_mesh"))
@@ -578,31 +645,38 @@ void AreaSupport::generateOverhangAreas(SliceDataStorage& storage)
             continue;
         }
         // it actually also initializes some buffers that are needed in generateSupport
-        generateOverhangAreasForMesh(storage, mesh);
+        generateOverhangAreasForMesh(storage, mesh, model_outlines_per_layer);
     }
 }
 
-void AreaSupport::generateSupportAreas(SliceDataStorage& storage)
+void AreaSupport::generateSupportAreas(SliceDataStorage& storage, SierpinskiFillProviderCache& cross_fill_provider_cache)
 {
     std::vector<Polygons> global_support_areas_per_layer;
     global_support_areas_per_layer.resize(storage.print_layer_count);
 
     int max_layer_nr_support_mesh_filled;
+    const SparseLayerVector<SupportLayer>& const_support_layers = storage.support.supportLayers; //To read the layers without allocating them.
     for (max_layer_nr_support_mesh_filled = storage.support.supportLayers.size() - 1; max_layer_nr_support_mesh_filled >= 0; max_layer_nr_support_mesh_filled--)
     {
-        const SupportLayer& support_layer = storage.support.supportLayers[max_layer_nr_support_mesh_filled];
+        const SupportLayer& support_layer = const_support_layers[max_layer_nr_support_mesh_filled];
         if (support_layer.support_mesh.size() > 0 || support_layer.support_mesh_drop_down.size() > 0)
         {
             break;
         }
     }
     storage.support.layer_nr_max_filled_layer = max_layer_nr_support_mesh_filled;
+#pragma omp parallel for default(none) shared(storage, max_layer_nr_support_mesh_filled) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
     for (int layer_nr = 0; layer_nr < max_layer_nr_support_mesh_filled; layer_nr++)
     {
+        if (!storage.support.supportLayers.isAllocated(layer_nr))
+        {
+            continue; //Nothing to union.
+        }
         SupportLayer& support_layer = storage.support.supportLayers[layer_nr];
-        support_layer.anti_overhang = support_layer.anti_overhang.unionPolygons();
-        support_layer.support_mesh_drop_down = support_layer.support_mesh_drop_down.unionPolygons();
-        support_layer.support_mesh = support_layer.support_mesh.unionPolygons();
+        support_layer.anti_overhang.unionPolygonsInPlace();
+        support_layer.support_mesh_drop_down.unionPolygonsInPlace();
+        support_layer.support_mesh.unionPolygonsInPlace();
     }
 
     // initialization of supportAreasPerLayer
@@ -652,20 +726,24 @@ void AreaSupport::generateSupportAreas(SliceDataStorage& storage)
 
         generateSupportAreasForMesh(storage, *infill_settings, *roof_settings, *bottom_settings, mesh_idx, storage.print_layer_count, mesh_support_areas_per_layer);
         const double minimum_support_area = mesh.settings.get<double>("minimum_support_area");
-        for (size_t layer_idx = 0; layer_idx < storage.print_layer_count; layer_idx++)
+#pragma omp parallel for default(none) shared(storage, minimum_support_area, mesh_support_areas_per_layer, global_support_areas_per_layer) schedule(dynamic)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int layer_idx = 0; layer_idx < static_cast<int>(storage.print_layer_count); layer_idx++)
         {
             if (minimum_support_area > 0.0)
             {
                 mesh_support_areas_per_layer[layer_idx].removeSmallAreas(minimum_support_area);
             }
-            global_support_areas_per_layer[layer_idx].add(mesh_support_areas_per_layer[layer_idx]);
+            global_support_areas_per_layer[layer_idx].add(std::move(mesh_support_areas_per_layer[layer_idx]));
         }
     }
 
-    for (unsigned int layer_idx = 0; layer_idx < storage.print_layer_count ; layer_idx++)
+#pragma omp parallel for default(none) shared(storage, global_support_areas_per_layer) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_idx = 0; layer_idx < static_cast<int>(storage.print_layer_count); layer_idx++)
     {
         Polygons& support_areas = global_support_areas_per_layer[layer_idx];
-        support_areas = support_areas.unionPolygons();
+        support_areas.unionPolygonsInPlace();
     }
 
     // handle support interface
@@ -689,10 +767,10 @@ void AreaSupport::generateSupportAreas(SliceDataStorage& storage)
 
     // split the global support areas into parts for later gradual support infill generation
     AreaSupport::splitGlobalSupportAreasIntoSupportInfillParts(storage, global_support_areas_per_layer, storage.print_layer_count);
-    precomputeCrossInfillTree(storage);
+    precomputeCrossInfillTree(storage, cross_fill_provider_cache);
 }
 
-void AreaSupport::precomputeCrossInfillTree(SliceDataStorage& storage)
+void AreaSupport::precomputeCrossInfillTree(SliceDataStorage& storage, SierpinskiFillProviderCache& cross_fill_provider_cache)
 {
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
     const ExtruderTrain& infill_extruder = mesh_group_settings.get<ExtruderTrain&>("support_infill_extruder_nr");
@@ -726,7 +804,7 @@ void AreaSupport::precomputeCrossInfillTree(SliceDataStorage& storage)
         std::ifstream cross_fs(cross_subdisivion_spec_image_file.c_str());
         if (cross_subdisivion_spec_image_file != "" && cross_fs.good())
         {
-            storage.support.cross_fill_provider = new SierpinskiFillProvider(aabb, infill_extruder.settings.get<coord_t>("support_line_distance"), infill_extruder.settings.get<coord_t>("support_line_width"), cross_subdisivion_spec_image_file);
+            storage.support.cross_fill_provider = cross_fill_provider_cache.get(aabb, infill_extruder.settings.get<coord_t>("support_line_distance"), infill_extruder.settings.get<coord_t>("support_line_width"), cross_subdisivion_spec_image_file);
         }
         else
         {
@@ -734,12 +812,12 @@ void AreaSupport::precomputeCrossInfillTree(SliceDataStorage& storage)
             {
                 logError("Cannot find density image \'%s\'.", cross_subdisivion_spec_image_file.c_str());
             }
-            storage.support.cross_fill_provider = new SierpinskiFillProvider(aabb, infill_extruder.settings.get<coord_t>("support_line_distance"), infill_extruder.settings.get<coord_t>("support_line_width"));
+            storage.support.cross_fill_provider = cross_fill_provider_cache.get(aabb, infill_extruder.settings.get<coord_t>("support_line_distance"), infill_extruder.settings.get<coord_t>("support_line_width"), "");
         }
     }
 }
 
-void AreaSupport::generateOverhangAreasForMesh(SliceDataStorage& storage, SliceMeshStorage& mesh)
+void AreaSupport::generateOverhangAreasForMesh(SliceDataStorage& storage, SliceMeshStorage& mesh, const std::vector<Polygons>& model_outlines_per_layer)
 {
     if (!mesh.settings.get<bool>("support_enable") && !mesh.settings.get<bool>("support_mesh"))
     {
@@ -769,20 +847,26 @@ void AreaSupport::generateOverhangAreasForMesh(SliceDataStorage& storage, SliceM
         return;
     }
 
-    //Generate points and lines of overhang (for corners pointing downwards, since they don't have an area to support but still need supporting).
     const coord_t max_supported_diameter = mesh.settings.get<coord_t>("support_tower_maximum_supported_diameter");
     const bool use_towers = mesh.settings.get<bool>("support_use_towers") && max_supported_diameter > 0;
     if (use_towers)
     {
-        AreaSupport::detectOverhangPoints(storage, mesh);
+        mesh.overhang_points.resize(storage.print_layer_count);
     }
 
-    //Generate the actual areas and store them in the mesh.
+    //Generate the actual areas and store them in the mesh, in a single pass over the layers.
     cura::parallel_for<size_t>(1, storage.print_layer_count, 1, [&](const size_t layer_idx)
     {
-        std::pair<Polygons, Polygons> basic_and_full_overhang = computeBasicAndFullOverhang(storage, mesh, layer_idx);
-        mesh.overhang_areas[layer_idx] = basic_and_full_overhang.first; //Store the results.
-        mesh.full_overhang_areas[layer_idx] = basic_and_full_overhang.second;
+        PartZone zone("support overhang", layer_idx, mesh.mesh_name.c_str(), SlowestParts::no_part, &mesh.full_overhang_areas[layer_idx]);
+        std::pair<Polygons, Polygons> basic_and_full_overhang = computeBasicAndFullOverhang(storage, mesh, layer_idx, model_outlines_per_layer[layer_idx - 1]);
+        mesh.overhang_areas[layer_idx] = std::move(basic_and_full_overhang.first); //Store the results.
+        mesh.full_overhang_areas[layer_idx] = std::move(basic_and_full_overhang.second);
+
+        //Generate points and lines of overhang (for corners pointing downwards, since they don't have an area to support but still need supporting).
+        if (use_towers)
+        {
+            AreaSupport::detectOverhangPoints(storage, mesh, layer_idx);
+        }
     });
 }
 
@@ -800,6 +884,7 @@ void AreaSupport::generateOverhangAreasForMesh(SliceDataStorage& storage, SliceM
 void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const Settings& infill_settings, const Settings& roof_settings, const Settings& bottom_settings, const size_t mesh_idx, const size_t layer_count, std::vector<Polygons>& support_areas)
 {
     SliceMeshStorage& mesh = storage.meshes[mesh_idx];
+    const SparseLayerVector<SupportLayer>& const_support_layers = storage.support.supportLayers; //To read the support meshes without allocating empty layers.
 
     const ESupportStructure support_structure = mesh.settings.get<ESupportStructure>("support_structure");
     const bool is_support_mesh_place_holder = mesh.settings.get<bool>("support_mesh"); // whether this mesh has empty SliceMeshStorage and this function is now called to only generate support for all support meshes
@@ -840,18 +925,27 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
     const coord_t support_line_width = mesh_group_settings.get<ExtruderTrain&>("support_infill_extruder_nr").settings.get<coord_t>("support_line_width");
     const double sloped_areas_angle = mesh.settings.get<AngleRadians>("support_bottom_stair_step_min_slope");
     const coord_t sloped_area_detection_width = 10 + static_cast<coord_t>(layer_thickness / std::tan(sloped_areas_angle)) / 2;
-    xy_disallowed_per_layer[0] = storage.getLayerOutlines(0, no_support, no_prime_tower).offset(xy_distance);
+
+    // The outlines of the model are needed several times per layer below, also while propagating the support downwards.
+    // Computing them requires a union of all meshes, so do that only once per layer.
+    std::vector<Polygons> model_outlines_per_layer(layer_count);
+    cura::parallel_for<size_t>(0, layer_count, 1, [&](const size_t layer_idx)
+    {
+        model_outlines_per_layer[layer_idx] = storage.getLayerOutlines(layer_idx, no_support, no_prime_tower);
+    });
+
+    xy_disallowed_per_layer[0] = model_outlines_per_layer[0].offset(xy_distance);
 
     cura::parallel_for<size_t>(1, layer_count, 1, [&](const size_t layer_idx)
     {
-        const Polygons outlines = storage.getLayerOutlines(layer_idx, no_support, no_prime_tower);
+        const Polygons& outlines = model_outlines_per_layer[layer_idx];
 
         // Build sloped areas. We need this for the stair-stepping later on.
         // Specifically, sloped areass are used in 'moveUpFromModel' to prevent a stair step happening over an area where there isn't a slope.
         // This part here only concerns the slope between two layers. This will be post-processed later on (see the other parallel loop below).
         sloped_areas_per_layer[layer_idx] =
             // Take the outer areas of the previous layer, where the outer areas are (mostly) just _inside_ the shape.
-            storage.getLayerOutlines(layer_idx - 1, no_support, no_prime_tower).tubeShape(sloped_area_detection_width, 10)
+            model_outlines_per_layer[layer_idx - 1].tubeShape(sloped_area_detection_width, 10)
             // Intersect those with the outer areas of the current layer, where the outer areas are (mostly) _outside_ the shape.
             // This will detect every slope (and some/most vertical walls) between those two layers.
             .intersection(outlines.tubeShape(10, sloped_area_detection_width))
@@ -890,7 +984,7 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
                             // expand area_beyond_limit so that the inner hole fills in all the way back to the current layer's outline
                             // and use that to remove the regions in larger_area_below that should not use min XY because the regions are
                             // wide enough for a normal support to be placed there
-                            larger_area_below = larger_area_below.difference(area_beyond_limit.offset(limit_distance + 10));
+                            larger_area_below.differenceInPlace(area_beyond_limit.offset(limit_distance + 10));
                         }
                     }
                 }
@@ -918,6 +1012,10 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
 
     const coord_t max_tower_supported_diameter = infill_settings.get<coord_t>("support_tower_maximum_supported_diameter");
     const bool use_towers = infill_settings.get<bool>("support_use_towers") && max_tower_supported_diameter > 0;
+    //Only conical support has to stay within the border, as decided by join with the settings of the support extruder. The border is the same for every layer.
+    const Settings& support_infill_settings = mesh_group_settings.get<ExtruderTrain&>("support_infill_extruder_nr").settings;
+    const bool conical_support_enabled = support_infill_settings.get<bool>("support_conical_enabled") && support_infill_settings.get<AngleRadians>("support_conical_angle") != 0;
+    const Polygons conical_support_border = conical_support_enabled ? getConicalSupportBorder(storage) : Polygons();
 
     coord_t smoothing_distance;
     { // compute best smoothing_distance
@@ -962,25 +1060,42 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
                 // Start a new stair every modulo bottom_stair_step_layer_count steps.
                 if (layer_idx % bottom_stair_step_layer_count != 1)
                 {
-                    sloped_areas_per_layer[layer_idx] = sloped_areas_per_layer[layer_idx].unionPolygons(sloped_areas_per_layer[layer_idx - 1]);
+                    sloped_areas_per_layer[layer_idx].unionPolygonsInPlace(sloped_areas_per_layer[layer_idx - 1]);
                 }
             }
         });
     }
 
-    for (size_t layer_idx = layer_count - 1 - layer_z_distance_top; layer_idx != static_cast<size_t>(-1); layer_idx--)
+    // The overhang that each layer needs to support doesn't depend on the other layers, so compute that in parallel first.
+    // Only propagating the support downwards from the layers above has to be done one layer after another.
+    const size_t top_support_layer_idx = layer_count - 1 - layer_z_distance_top;
+    std::vector<Polygons> overhang_per_layer(top_support_layer_idx + 1);
+#pragma omp parallel for default(none) shared(overhang_per_layer, mesh, layer_z_distance_top, top_support_layer_idx, extension_offset, is_support_mesh_place_holder, use_towers, infill_settings) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_idx = 0; layer_idx < static_cast<int>(top_support_layer_idx) + 1; layer_idx++)
     {
-        Polygons layer_this = mesh.full_overhang_areas[layer_idx + layer_z_distance_top];
+        Polygons& layer_this = overhang_per_layer[layer_idx];
+        layer_this = mesh.full_overhang_areas[layer_idx + layer_z_distance_top];
 
         if (extension_offset && !is_support_mesh_place_holder)
         {
-            layer_this = layer_this.offset(extension_offset);
+            layer_this.offsetInPlace(extension_offset);
         }
 
         if (use_towers && !is_support_mesh_place_holder)
         {
             // handle straight walls
             AreaSupport::handleWallStruts(infill_settings, layer_this);
+        }
+    }
+
+    for (size_t layer_idx = top_support_layer_idx; layer_idx != static_cast<size_t>(-1); layer_idx--)
+    {
+        Polygons layer_this = std::move(overhang_per_layer[layer_idx]);
+        PartZone zone("support areas", layer_idx, mesh.mesh_name.c_str(), SlowestParts::no_part, &support_areas[layer_idx]);
+
+        if (use_towers && !is_support_mesh_place_holder)
+        {
             // handle towers
             AreaSupport::handleTowers(infill_settings, layer_this, tower_roofs, mesh.overhang_points, layer_idx, layer_count);
         }
@@ -989,65 +1104,71 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
         { // join with support from layer up
             const Polygons empty;
             const Polygons* layer_above = (layer_idx < support_areas.size()) ? &support_areas[layer_idx + 1] : &empty;
-            const Polygons model_mesh_on_layer = (layer_idx > 0) && !is_support_mesh_nondrop_place_holder ? storage.getLayerOutlines(layer_idx, no_support, no_prime_tower) : empty;
+            const Polygons& model_mesh_on_layer = (layer_idx > 0) && !is_support_mesh_nondrop_place_holder ? model_outlines_per_layer[layer_idx] : empty;
             if (is_support_mesh_nondrop_place_holder)
             {
                 layer_above = &empty;
-                layer_this = layer_this.unionPolygons(storage.support.supportLayers[layer_idx].support_mesh);
+                layer_this.unionPolygonsInPlace(const_support_layers[layer_idx].support_mesh);
             }
-            layer_this = AreaSupport::join(storage, *layer_above, layer_this, smoothing_distance).difference(model_mesh_on_layer);
+            layer_this = AreaSupport::join(*layer_above, layer_this, smoothing_distance, conical_support_border).difference(model_mesh_on_layer);
         }
 
         // make towers for small support
-        if (use_towers)
+        constexpr size_t tower_top_layer_count = 6; // number of layers after which to conclude that a tiny support area needs a tower
+        if (use_towers && layer_idx < layer_count - tower_top_layer_count && layer_idx >= tower_top_layer_count + bottom_empty_layer_count)
         {
-            for (PolygonsPart poly : layer_this.splitIntoParts())
+            std::vector<PolygonsPart> tiny_parts;
+            std::vector<Point> middles;
+            for (PolygonsPart& poly : layer_this.splitIntoParts())
             {
                 const int64_t part_area = poly.area();
                 if (part_area > 0 && part_area < max_tower_supported_diameter * max_tower_supported_diameter)
                 {
-                    constexpr size_t tower_top_layer_count = 6; // number of layers after which to conclude that a tiny support area needs a tower
-                    if (layer_idx < layer_count - tower_top_layer_count && layer_idx >= tower_top_layer_count + bottom_empty_layer_count)
+                    middles.push_back(AABB(poly).getMiddle());
+                    tiny_parts.push_back(std::move(poly));
+                }
+            }
+            if (!tiny_parts.empty())
+            {
+                // check the middles of all tiny parts at once
+                const std::vector<bool> has_support_above = PreparedPolygons(support_areas[layer_idx + tower_top_layer_count]).inside(middles);
+                const std::vector<bool> has_model_below = PreparedPolygons(model_outlines_per_layer[layer_idx - tower_top_layer_count - bottom_empty_layer_count]).inside(middles);
+                for (size_t part_idx = 0; part_idx < tiny_parts.size(); part_idx++)
+                {
+                    if (has_support_above[part_idx] && !has_model_below[part_idx])
                     {
-                        const Polygons& layer_above = support_areas[layer_idx + tower_top_layer_count];
-                        const Point middle = AABB(poly).getMiddle();
-                        const bool has_support_above = layer_above.inside(middle);
-                        constexpr bool no_support = false;
-                        constexpr bool no_prime_tower = false;
-                        const bool has_model_below = storage.getLayerOutlines(layer_idx - tower_top_layer_count - bottom_empty_layer_count, no_support, no_prime_tower).inside(middle);
-                        if (has_support_above && !has_model_below)
-                        {
-                            Polygons tiny_tower_here;
-                            tiny_tower_here.add(poly);
-                            tower_roofs.emplace_back(tiny_tower_here);
-                        }
+                        Polygons tiny_tower_here;
+                        tiny_tower_here.add(tiny_parts[part_idx]);
+                        tower_roofs.emplace_back(tiny_tower_here);
                     }
                 }
             }
         }
 
-        if (is_support_mesh_drop_down_place_holder && storage.support.supportLayers[layer_idx].support_mesh_drop_down.size() > 0)
+        if (is_support_mesh_drop_down_place_holder && const_support_layers[layer_idx].support_mesh_drop_down.size() > 0)
         { // handle support mesh which should be supported by more support
-            layer_this = layer_this.unionPolygons(storage.support.supportLayers[layer_idx].support_mesh_drop_down);
+            layer_this.unionPolygonsInPlace(const_support_layers[layer_idx].support_mesh_drop_down);
         }
 
         // Move up from model, handle stair-stepping.
         moveUpFromModel(storage, stair_removal, sloped_areas_per_layer[layer_idx], layer_this, layer_idx, bottom_empty_layer_count, bottom_stair_step_layer_count, bottom_stair_step_width);
 
-        support_areas[layer_idx] = layer_this;
+        support_areas[layer_idx] = std::move(layer_this);
         Progress::messageProgress(Progress::Stage::SUPPORT, layer_count * (mesh_idx + 1) - layer_idx, layer_count * storage.meshes.size());
     }
 
     // Substract x/y-disallowed area from the support.
     // This is done after the main loop, because at least one of the calculations there rely on other layers _without_ the x/y-disallowed area.
-    for (size_t layer_idx = layer_count - 1 - layer_z_distance_top; layer_idx != static_cast<size_t>(-1); layer_idx--)
+#pragma omp parallel for default(none) shared(support_areas, xy_disallowed_per_layer, top_support_layer_idx) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_idx = 0; layer_idx < static_cast<int>(top_support_layer_idx) + 1; layer_idx++)
     {
         Polygons& layer_this = support_areas[layer_idx];
 
         // inset using X/Y distance
         if (layer_this.size() > 0)
         {
-            layer_this = layer_this.difference(xy_disallowed_per_layer[layer_idx]);
+            layer_this.differenceInPlace(xy_disallowed_per_layer[layer_idx]);
         }
     }
 
@@ -1073,7 +1194,7 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
 
             if (conical_support)
             { // with conical support the next layer is allowed to be larger than the previous
-                touching_buildplate = touching_buildplate.offset(std::abs(conical_support_offset) + 10, ClipperLib::jtMiter, 10);
+                touching_buildplate.offsetInPlace(std::abs(conical_support_offset) + 10, ClipperLib::jtMiter, 10);
                 // + 10 and larger miter limit cause performing an outward offset after an inward offset can disregard sharp corners
                 //
                 // conical support can make
@@ -1109,9 +1230,7 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
 
         cura::parallel_for<size_t>(0, max_checking_layer_idx, 1, [&](const size_t layer_idx)
         {
-            constexpr bool no_support = false;
-            constexpr bool no_prime_tower = false;
-            support_areas[layer_idx] = support_areas[layer_idx].difference(storage.getLayerOutlines(layer_idx + layer_z_distance_top - 1, no_support, no_prime_tower));
+            support_areas[layer_idx].differenceInPlace(model_outlines_per_layer[layer_idx + layer_z_distance_top - 1]);
         });
     }
 
@@ -1212,7 +1331,7 @@ void AreaSupport::moveUpFromModel(const SliceDataStorage& storage, Polygons& sta
             }
         }
     }
-    support_areas = support_areas.difference(to_be_removed);
+    support_areas.differenceInPlace(to_be_removed);
 }
 
 
@@ -1227,12 +1346,9 @@ void AreaSupport::moveUpFromModel(const SliceDataStorage& storage, Polygons& sta
  *         ^^^^^^^^^      overhang extensions
  *         ^^^^^^^^^^^^^^ overhang
  */
-std::pair<Polygons, Polygons> AreaSupport::computeBasicAndFullOverhang(const SliceDataStorage& storage, const SliceMeshStorage& mesh, const unsigned int layer_idx)
+std::pair<Polygons, Polygons> AreaSupport::computeBasicAndFullOverhang(const SliceDataStorage& storage, const SliceMeshStorage& mesh, const unsigned int layer_idx, const Polygons& supportLayer_supporter)
 {
     Polygons supportLayer_supportee = mesh.layers[layer_idx].getOutlines();
-    constexpr bool no_support = false;
-    constexpr bool no_prime_tower = false;
-    Polygons supportLayer_supporter = storage.getLayerOutlines(layer_idx-1, no_support, no_prime_tower);
 
     const coord_t layer_height = mesh.settings.get<coord_t>("layer_height");
     const AngleRadians support_angle = mesh.settings.get<AngleRadians>("support_angle");
@@ -1248,7 +1364,7 @@ std::pair<Polygons, Polygons> AreaSupport::computeBasicAndFullOverhang(const Sli
         // will create opposite effect.
         Polygons merged_polygons = support_layer.anti_overhang.unionPolygons();
 
-        basic_overhang = basic_overhang.difference(merged_polygons);
+        basic_overhang.differenceInPlace(merged_polygons);
     }
 
 //     Polygons support_extension = basic_overhang.offset(max_dist_from_lower_layer);
@@ -1264,33 +1380,32 @@ std::pair<Polygons, Polygons> AreaSupport::computeBasicAndFullOverhang(const Sli
 }
 
 
-void AreaSupport::detectOverhangPoints(const SliceDataStorage& storage, SliceMeshStorage& mesh)
+void AreaSupport::detectOverhangPoints(const SliceDataStorage& storage, SliceMeshStorage& mesh, const size_t layer_idx)
 {
     const ExtruderTrain& infill_extruder = mesh.settings.get<ExtruderTrain&>("support_infill_extruder_nr");
     const coord_t offset = - infill_extruder.settings.get<coord_t>("support_line_width") / 2;
     const coord_t max_tower_supported_diameter = mesh.settings.get<coord_t>("support_tower_maximum_supported_diameter");
     const coord_t max_tower_supported_area = max_tower_supported_diameter * max_tower_supported_diameter;
 
-    mesh.overhang_points.resize(storage.print_layer_count);
-
-    for (size_t layer_idx = 1; layer_idx < storage.print_layer_count; layer_idx++)
+    const SliceLayer& layer = mesh.layers[layer_idx];
+    std::optional<Polygons> outlines_below; //Only computed if there are small parts on this layer.
+    for (const SliceLayerPart& part : layer.parts)
     {
-        const SliceLayer& layer = mesh.layers[layer_idx];
-        for (const SliceLayerPart& part : layer.parts)
+        if (part.outline.outerPolygon().area() < max_tower_supported_area)
         {
-            if (part.outline.outerPolygon().area() < max_tower_supported_area)
+            if (!outlines_below)
             {
-                const SliceLayer& layer_below = mesh.layers[layer_idx - 1];
-                if (!layer_below.getOutlines().intersection(part.outline).empty())
-                {
-                    continue;
-                }
+                outlines_below = mesh.layers[layer_idx - 1].getOutlines();
+            }
+            if (!outlines_below->intersection(part.outline).empty())
+            {
+                continue;
+            }
 
-                const Polygons overhang = part.outline.offset(offset).difference(storage.support.supportLayers[layer_idx].anti_overhang);
-                if (!overhang.empty())
-                {
-                    mesh.overhang_points[layer_idx].push_back(overhang);
-                }
+            const Polygons overhang = part.outline.offset(offset).difference(storage.support.supportLayers[layer_idx].anti_overhang);
+            if (!overhang.empty())
+            {
+                mesh.overhang_points[layer_idx].push_back(overhang);
             }
         }
     }
@@ -1320,12 +1435,32 @@ void AreaSupport::handleTowers(
             if (layer_overhang_point < static_cast<LayerIndex>(layer_count) && !overhang_points[layer_overhang_point - 1].empty())
             {
                 const coord_t max_tower_supported_diameter = settings.get<coord_t>("support_tower_maximum_supported_diameter");
-                std::vector<Polygons>& overhang_points_below = overhang_points[layer_overhang_point - 1];
+                const std::vector<Polygons>& overhang_points_below = overhang_points[layer_overhang_point - 1];
+                // Offset each point below only once, and index them so that each point here only looks at the points below that are close to it.
+                std::vector<Polygons> offset_below;
+                offset_below.reserve(overhang_points_below.size());
+                std::vector<AABB> offset_below_boxes;
+                offset_below_boxes.reserve(overhang_points_below.size());
+                for (const Polygons& poly_below : overhang_points_below)
+                {
+                    offset_below.push_back(poly_below.offset(max_tower_supported_diameter * 2));
+                    offset_below_boxes.emplace_back(offset_below.back());
+                }
+                const BoxGrid below_grid(offset_below_boxes);
                 for (Polygons& poly_here : overhang_points_here)
                 {
-                    for (const Polygons& poly_below : overhang_points_below)
+                    if (poly_here.empty())
+                    {
+                        continue;
+                    }
+                    Polygons close_below;
+                    for (const size_t below_idx : below_grid.getOverlapping(AABB(poly_here)))
+                    {
+                        close_below.add(offset_below[below_idx]);
+                    }
+                    if (!close_below.empty())
                     {
-                        poly_here = poly_here.difference(poly_below.offset(max_tower_supported_diameter * 2));
+                        poly_here.differenceInPlace(close_below.unionPolygons());
                     }
                 }
             }
@@ -1345,23 +1480,29 @@ void AreaSupport::handleTowers(
     const double tan_tower_roof_angle = tan(tower_roof_angle);
     const coord_t tower_roof_expansion_distance = layer_thickness / tan_tower_roof_angle;
     const coord_t tower_diameter = settings.get<coord_t>("support_tower_diameter");
-    for (size_t roof_idx = 0; roof_idx < towerRoofs.size(); roof_idx++)
+    // Add all roofs to the support in one union, rather than one union with the whole layer per tower.
+    Polygons all_roofs;
+    for (const Polygons& tower_roof : towerRoofs)
     {
-        Polygons& tower_roof = towerRoofs[roof_idx];
-        if (tower_roof.size() > 0)
+        all_roofs.add(tower_roof);
+    }
+    if (!all_roofs.empty())
+    {
+        supportLayer_this = supportLayer_this.unionPolygons(all_roofs);
+    }
+    for (Polygons& tower_roof : towerRoofs)
+    {
+        if (tower_roof[0].area() < tower_diameter * tower_diameter)
         {
-            supportLayer_this = supportLayer_this.unionPolygons(tower_roof);
-
-            if (tower_roof[0].area() < tower_diameter * tower_diameter)
-            {
-                tower_roof = tower_roof.offset(tower_roof_expansion_distance);
-            }
-            else
-            {
-                tower_roof.clear();
-            }
+            tower_roof.offsetInPlace(tower_roof_expansion_distance);
+        }
+        else
+        {
+            tower_roof.clear();
         }
     }
+    // Finished towers are forgotten, so that each layer only goes over the towers that are still growing.
+    towerRoofs.erase(std::remove_if(towerRoofs.begin(), towerRoofs.end(), [](const Polygons& tower_roof) { return tower_roof.empty(); }), towerRoofs.end());
 }
 
 void AreaSupport::handleWallStruts(const Settings& settings, Polygons& supportLayer_this)
@@ -1404,7 +1545,7 @@ void AreaSupport::handleWallStruts(const Settings& settings, Polygons& supportLa
                 strut.add(mid + Point(-tower_diameter / 2,  tower_diameter / 2));
                 strut.add(mid + Point(-tower_diameter / 2, -tower_diameter / 2));
                 strut.add(mid + Point( tower_diameter / 2, -tower_diameter / 2));
-                supportLayer_this = supportLayer_this.unionPolygons(struts);
+                supportLayer_this.unionPolygonsInPlace(struts);
             }
         }
     }
@@ -1428,8 +1569,11 @@ void AreaSupport::generateSupportBottom(SliceDataStorage& storage, const SliceMe
     const float z_skip = std::max(1.0f, float(bottom_layer_count - 1) / float(scan_count)); //How many layers to skip between measurements. Using float for better spread, but this is later rounded.
     const double minimum_bottom_area = mesh.settings.get<double>("minimum_bottom_area");
 
-    std::vector<SupportLayer>& support_layers = storage.support.supportLayers;
-    for (unsigned int layer_idx = support_layers.size() - 1; static_cast<int>(layer_idx) >= static_cast<int>(z_distance_bottom); layer_idx--)
+    SparseLayerVector<SupportLayer>& support_layers = storage.support.supportLayers;
+    //Each layer only looks at the model below it, so the layers can be processed in any order.
+#pragma omp parallel for default(none) shared(support_layers, mesh, global_support_areas_per_layer, bottom_layer_count, z_distance_bottom, z_skip, bottom_line_width, bottom_outline_offset, minimum_bottom_area) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_idx = z_distance_bottom; layer_idx < static_cast<int>(support_layers.size()); layer_idx++)
     {
         const unsigned int bottom_layer_idx_below = std::max(0, int(layer_idx) - int(bottom_layer_count) - int(z_distance_bottom));
         Polygons mesh_outlines;
@@ -1439,7 +1583,10 @@ void AreaSupport::generateSupportBottom(SliceDataStorage& storage, const SliceMe
         }
         Polygons bottoms;
         generateSupportInterfaceLayer(global_support_areas_per_layer[layer_idx], mesh_outlines, bottom_line_width, bottom_outline_offset, minimum_bottom_area, bottoms);
-        support_layers[layer_idx].support_bottom.add(bottoms);
+        if (!bottoms.empty()) //Only allocate the layers that get any bottoms.
+        {
+            support_layers[layer_idx].support_bottom.add(bottoms);
+        }
     }
 }
 
@@ -1461,9 +1608,13 @@ void AreaSupport::generateSupportRoof(SliceDataStorage& storage, const SliceMesh
     const float z_skip = std::max(1.0f, float(roof_layer_count - 1) / float(scan_count)); //How many layers to skip between measurements. Using float for better spread, but this is later rounded.
     const double minimum_roof_area = mesh.settings.get<double>("minimum_roof_area");
 
-    std::vector<SupportLayer>& support_layers = storage.support.supportLayers;
-    for (LayerIndex layer_idx = 0; layer_idx < static_cast<int>(support_layers.size() - z_distance_top); layer_idx++)
+    SparseLayerVector<SupportLayer>& support_layers = storage.support.supportLayers;
+    //Each layer only looks at the model above it, so the layers can be processed in any order.
+#pragma omp parallel for default(none) shared(support_layers, mesh, global_support_areas_per_layer, roof_layer_count, z_distance_top, z_skip, roof_line_width, roof_outline_offset, minimum_roof_area) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(support_layers.size()) - z_distance_top; layer_nr++)
     {
+        const LayerIndex layer_idx = layer_nr;
         const LayerIndex top_layer_idx_above = std::min(static_cast<LayerIndex>(support_layers.size() - 1), layer_idx + roof_layer_count + z_distance_top); //Maximum layer of the model that generates support roof.
         Polygons mesh_outlines;
         for (float layer_idx_above = top_layer_idx_above; layer_idx_above > layer_idx + z_distance_top; layer_idx_above -= z_skip)
@@ -1472,7 +1623,10 @@ void AreaSupport::generateSupportRoof(SliceDataStorage& storage, const SliceMesh
         }
         Polygons roofs;
         generateSupportInterfaceLayer(global_support_areas_per_layer[layer_idx], mesh_outlines, roof_line_width, roof_outline_offset, minimum_roof_area, roofs);
-        support_layers[layer_idx].support_roof.add(roofs);
+        if (!roofs.empty()) //Only allocate the layers that get any roofs.
+        {
+            support_layers[layer_idx].support_roof.add(roofs);
+        }
     }
 }
 
@@ -1480,20 +1634,20 @@ void AreaSupport::generateSupportInterfaceLayer(Polygons& support_areas, const P
 {
     Polygons model = colliding_mesh_outlines.unionPolygons();
     interface_polygons = support_areas.intersection(model);
-    interface_polygons = interface_polygons.offset(safety_offset).intersection(support_areas); //Make sure we don't generate any models that are not printable.
+    interface_polygons.offsetInPlace(safety_offset).intersectionInPlace(support_areas); //Make sure we don't generate any models that are not printable.
     if (outline_offset != 0)
     {
-        interface_polygons = interface_polygons.offset(outline_offset);
+        interface_polygons.offsetInPlace(outline_offset);
         if (outline_offset > 0) //The interface might exceed the area of the normal support.
         {
-            interface_polygons = interface_polygons.intersection(support_areas);
+            interface_polygons.intersectionInPlace(support_areas);
         }
     }
     if (minimum_interface_area > 0.0)
     {
         interface_polygons.removeSmallAreas(minimum_interface_area);
     }
-    support_areas = support_areas.difference(interface_polygons);
+    support_areas.differenceInPlace(interface_polygons);
 }
 
 }//namespace cura
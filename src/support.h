@@ -9,6 +9,7 @@ namespace cura
 
 struct LayerIndex;
 class Settings;
+class SierpinskiFillProviderCache;
 class SliceDataStorage;
 class SliceMeshStorage;
 class Slicer;
@@ -40,15 +41,19 @@ public:
      * Generate the support areas and support skin areas for all models.
      * \param storage Data storage containing the input layer outline data and
      * containing the output support storage per layer.
+     * \param cross_fill_provider_cache Where to get the cross fractal from, if
+     * it was made for an earlier slice already.
      */
-    static void generateSupportAreas(SliceDataStorage& storage);
+    static void generateSupportAreas(SliceDataStorage& storage, SierpinskiFillProviderCache& cross_fill_provider_cache);
 
     /*!
      * \brief Computes the base tree for cross infill of support.
      * \param storage[in,out] Data storage containing the input support outlines
      * and where to store the output tree.
+     * \param cross_fill_provider_cache Where to get the tree from, if it was
+     * made for an earlier slice already.
      */
-    static void precomputeCrossInfillTree(SliceDataStorage& storage);
+    static void precomputeCrossInfillTree(SliceDataStorage& storage, SierpinskiFillProviderCache& cross_fill_provider_cache);
 
     /*!
      * Generates all gradual support infill features.
@@ -117,8 +122,11 @@ private:
      * account.
      * \param storage Data storage containing the input layer outlines.
      * \param mesh The object for which to generate overhang areas.
+     * \param model_outlines_per_layer The outlines of all meshes together on
+     * each layer, without support or prime tower. These are shared by all
+     * meshes. They may be left empty if the mesh doesn't need overhang areas.
      */
-    static void generateOverhangAreasForMesh(SliceDataStorage& storage, SliceMeshStorage& mesh);
+    static void generateOverhangAreasForMesh(SliceDataStorage& storage, SliceMeshStorage& mesh, const std::vector<Polygons>& model_outlines_per_layer);
 
     /*!
      * \brief Generate support polygons over all layers for one object.
@@ -197,14 +205,28 @@ private:
     /*!
      * \brief Join current support layer with the support of the layer above,
      * (make support conical) and perform smoothing etc. operations.
-     * \param storage Where to store the resulting support.
      * \param supportLayer_up The support areas the layer above.
      * \param supportLayer_this The overhang areas of the current layer at hand.
      * \param smoothing_distance Maximal distance in the X/Y directions of a
      * line segment which is to be smoothed out.
+     * \param conical_support_border The area that conical support has to stay
+     * within, as computed by \ref getConicalSupportBorder. This is the same for
+     * all layers, so it's computed only once. It's only used for conical
+     * support, so it may be empty otherwise.
      * \return The joined support areas for this layer.
      */
-    static Polygons join(const SliceDataStorage& storage, const Polygons& supportLayer_up, Polygons& supportLayer_this, const coord_t smoothing_distance);
+    static Polygons join(const Polygons& supportLayer_up, Polygons& supportLayer_this, const coord_t smoothing_distance, const Polygons& conical_support_border);
+
+    /*!
+     * \brief Get the area that conical support has to stay within.
+     *
+     * This is the build volume, minus the room needed for the platform
+     * adhesion around the support.
+     * \param storage The slice data, to find the build volume and the extruders
+     * that are used.
+     * \return The area that support may widen into.
+     */
+    static Polygons getConicalSupportBorder(const SliceDataStorage& storage);
 
     /*!
      * Move the support up from model (cut away polygons to ensure bottom z distance)
@@ -225,12 +247,16 @@ private:
     static void moveUpFromModel(const SliceDataStorage& storage, Polygons& stair_removal, Polygons& sloped_areas, Polygons& support_areas, const size_t layer_idx, const size_t bottom_empty_layer_count, const size_t bottom_stair_step_layer_count, const coord_t support_bottom_stair_step_width);
 
     /*!
-     * Joins the layer part outlines of all meshes and collects the overhang
-     * points (small areas).
+     * Collects the overhang points (small areas) of one layer of a mesh.
+     *
+     * The layers are independent, so this may be called for several layers at
+     * the same time.
      * \param storage Input layer outline information.
-     * \param mesh Output mesh to store the resulting overhang points in.
+     * \param mesh Output mesh to store the resulting overhang points in. Its
+     * overhang points must already have an entry for each layer.
+     * \param layer_idx The layer to collect the overhang points of.
      */
-    static void detectOverhangPoints(const SliceDataStorage& storage, SliceMeshStorage& mesh);
+    static void detectOverhangPoints(const SliceDataStorage& storage, SliceMeshStorage& mesh, const size_t layer_idx);
     
     /*!
      * \brief Compute the basic overhang and full overhang of a layer.
@@ -247,9 +273,11 @@ private:
      * \param storage The slice data storage.
      * \param mesh The mesh for which to compute the basic overhangs.
      * \param layer_idx The layer for which to compute the overhang.
+     * \param supportLayer_supporter The outlines of all meshes on the layer
+     * below, which support this layer.
      * \return A pair of basic overhang and full overhang.
      */
-    static std::pair<Polygons, Polygons> computeBasicAndFullOverhang(const SliceDataStorage& storage, const SliceMeshStorage& mesh, const unsigned int layer_idx);
+    static std::pair<Polygons, Polygons> computeBasicAndFullOverhang(const SliceDataStorage& storage, const SliceMeshStorage& mesh, const unsigned int layer_idx, const Polygons& supportLayer_supporter);
     
     /*!
      * \brief Adds tower pieces to the current support layer.
@@ -60,34 +60,39 @@ void TimeEstimateCalculator::reset()
     blocks.clear();
 }
 
+void TimeEstimateCalculator::Blocks::clear()
+{
+    feature.clear();
+    distance.clear();
+    acceleration.clear();
+    nominal_feedrate.clear();
+    max_entry_speed.clear();
+    entry_speed.clear();
+    speed_gain2.clear();
+    nominal_length_flag.clear();
+}
+
 // Calculates the maximum allowable speed at this point when you must be able to reach target_velocity using the 
-// acceleration within the allotted distance.
-static inline Velocity maxAllowableSpeed(const Acceleration& acceleration, const Velocity& target_velocity, double distance)
+// acceleration within the allotted distance. The speed_gain2 is 2 * acceleration * distance.
+static inline double maxAllowableSpeed(const double target_velocity, const double speed_gain2)
 {
-    return sqrt(target_velocity * target_velocity - 2 * acceleration * distance);
+    return sqrt(target_velocity * target_velocity + speed_gain2);
 }
 
 // Calculates the distance (not time) it takes to accelerate from initial_rate to target_rate using the given acceleration:
-static inline float estimateAccelerationDistance(const Velocity& initial_rate, const Velocity& target_rate, const Acceleration& acceleration)
+static inline float estimateAccelerationDistance(const double initial_rate, const double target_rate, const double acceleration)
 {
-    if (acceleration == 0)
-    {
-        return 0.0;
-    }
-    return (square(target_rate) - square(initial_rate)) / (2.0 * acceleration);
+    // Computed before checking the acceleration, so that there are no branches and the loop over all blocks vectorises.
+    const float distance = (square(target_rate) - square(initial_rate)) / (2.0 * acceleration);
+    return acceleration == 0 ? 0.0f : distance;
 }
 
 // This function gives you the point at which you must start braking (at the rate of -acceleration) if 
 // you started at speed initial_rate and accelerated until this point and want to end at the final_rate after
 // a total travel of distance. This can be used to compute the intersection point between acceleration and
 // deceleration in the cases where the trapezoid has no plateau (i.e. never reaches maximum speed)
-static inline double intersectionDistance(const Velocity& initial_rate, const Velocity& final_rate, const Acceleration& acceleration, double distance)
+static inline double intersectionDistance(const double initial_rate, const double final_rate, const double acceleration, const double distance)
 {
-    if (acceleration == 0.0)
-    {
-        return 0.0;
-    }
-
     /*
      * Calculate the intersection point of two time-velocity formulas: One for
      * accelerating and one for decelerating.
@@ -116,11 +121,12 @@ static inline double intersectionDistance(const Velocity& initial_rate, const Ve
      * 2d = (2aD + v_f² - v_i²) / 2a [+D on both sides, but on the right multiply it by 2a to put it in the brackets]
      * d = (2aD + v_f² - v_i²) / 4a [divide by 2 on both sides]
      */
-    return (2.0 * acceleration * distance - square(initial_rate) + square(final_rate)) / (4.0 * acceleration);
+    const double intersection = (2.0 * acceleration * distance - square(initial_rate) + square(final_rate)) / (4.0 * acceleration);
+    return acceleration == 0.0 ? 0.0 : intersection;
 }
 
 // This function gives the time it needs to accelerate from an initial speed to reach a final distance.
-static inline double accelerationTimeFromDistance(const Velocity& initial_feedrate, const Velocity& distance, const Acceleration& acceleration)
+static inline double accelerationTimeFromDistance(const double initial_feedrate, const double distance, const double acceleration)
 {
     double discriminant = square(initial_feedrate) - 2 * acceleration * -distance;
     //If discriminant is negative, we're moving in the wrong direction.
@@ -129,49 +135,18 @@ static inline double accelerationTimeFromDistance(const Velocity& initial_feedra
     return (-initial_feedrate + sqrt(discriminant)) / acceleration;
 }
 
-void TimeEstimateCalculator::calculateTrapezoidForBlock(Block *block, const Ratio entry_factor, const Ratio exit_factor)
-{
-    const Velocity initial_feedrate = block->nominal_feedrate * entry_factor;
-    const Velocity final_feedrate = block->nominal_feedrate * exit_factor;
-
-    double accelerate_distance = estimateAccelerationDistance(initial_feedrate, block->nominal_feedrate, block->acceleration);
-    const double decelerate_distance = estimateAccelerationDistance(block->nominal_feedrate, final_feedrate, -block->acceleration);
-
-    // Calculate the size of Plateau of Nominal Rate.
-    double plateau_distance = block->distance-accelerate_distance - decelerate_distance;
-
-    // Is the Plateau of Nominal Rate smaller than nothing? That means no cruising, and we will
-    // have to use intersection_distance() to calculate when to abort acceleration and start braking
-    // in order to reach the final_rate exactly at the end of this block.
-    if (plateau_distance < 0)
-    {
-        accelerate_distance = intersectionDistance(initial_feedrate, final_feedrate, block->acceleration, block->distance);
-        accelerate_distance = std::max(accelerate_distance, 0.0); // Check limits due to numerical round-off
-        accelerate_distance = std::min(accelerate_distance, block->distance);//(We can cast here to unsigned, because the above line ensures that we are above zero)
-        plateau_distance = 0;
-    }
-
-    block->accelerate_until = accelerate_distance;
-    block->decelerate_after = accelerate_distance + plateau_distance;
-    block->initial_feedrate = initial_feedrate;
-    block->final_feedrate = final_feedrate;
-}
-
 void TimeEstimateCalculator::plan(Position newPos, Velocity feedrate, PrintFeatureType feature)
 {
-    Block block;
-    memset(&block, 0, sizeof(block));
-
-    block.feature = feature;
-
-    //block.maxTravel = 0; //Done by memset.
+    Position delta;
+    Position abs_delta;
+    double max_travel = 0;
     for(size_t n = 0; n < NUM_AXIS; n++)
     {
-        block.delta[n] = newPos[n] - currentPosition[n];
-        block.absDelta[n] = fabs(block.delta[n]);
-        block.maxTravel = std::max(block.maxTravel, block.absDelta[n]);
+        delta[n] = newPos[n] - currentPosition[n];
+        abs_delta[n] = fabs(delta[n]);
+        max_travel = std::max(max_travel, abs_delta[n]);
     }
-    if (block.maxTravel <= 0)
+    if (max_travel <= 0)
     {
         return;
     }
@@ -179,19 +154,19 @@ void TimeEstimateCalculator::plan(Position newPos, Velocity feedrate, PrintFeatu
     {
         feedrate = minimumfeedrate;
     }
-    block.distance = sqrtf(square(block.absDelta[0]) + square(block.absDelta[1]) + square(block.absDelta[2]));
-    if (block.distance == 0.0)
+    double distance = sqrtf(square(abs_delta[0]) + square(abs_delta[1]) + square(abs_delta[2]));
+    if (distance == 0.0)
     {
-        block.distance = block.absDelta[3];
+        distance = abs_delta[3];
     }
-    block.nominal_feedrate = feedrate;
+    Velocity nominal_feedrate = feedrate;
     
     Position current_feedrate;
     Position current_abs_feedrate;
     Ratio feedrate_factor = 1.0;
     for(size_t n = 0; n < NUM_AXIS; n++)
     {
-        current_feedrate[n] = (block.delta[n] * feedrate) / block.distance;
+        current_feedrate[n] = (delta[n] * feedrate) / distance;
         current_abs_feedrate[n] = fabs(current_feedrate[n]);
         if (current_abs_feedrate[n] > max_feedrate[n])
         {
@@ -207,15 +182,15 @@ void TimeEstimateCalculator::plan(Position newPos, Velocity feedrate, PrintFeatu
             current_feedrate[n] *= feedrate_factor;
             current_abs_feedrate[n] *= feedrate_factor;
         }
-        block.nominal_feedrate *= feedrate_factor;
+        nominal_feedrate *= feedrate_factor;
     }
     
-    block.acceleration = acceleration;
+    Acceleration block_acceleration = acceleration;
     for(size_t n = 0; n < NUM_AXIS; n++)
     {
-        if (block.acceleration * (block.absDelta[n] / block.distance) > max_acceleration[n])
+        if (block_acceleration * (abs_delta[n] / distance) > max_acceleration[n])
         {
-            block.acceleration = max_acceleration[n];
+            block_acceleration = max_acceleration[n];
         }
     }
     
@@ -229,13 +204,12 @@ void TimeEstimateCalculator::plan(Position newPos, Velocity feedrate, PrintFeatu
     {
         vmax_junction = std::min(vmax_junction, max_e_jerk / 2);
     }
-    vmax_junction = std::min(vmax_junction, block.nominal_feedrate);
-    const Velocity safe_speed = vmax_junction;
+    vmax_junction = std::min(vmax_junction, nominal_feedrate);
     
     if ((blocks.size() > 0) && (previous_nominal_feedrate > 0.0001))
     {
         const Velocity xy_jerk = sqrt(square(current_feedrate[X_AXIS] - previous_feedrate[X_AXIS]) + square(current_feedrate[Y_AXIS] - previous_feedrate[Y_AXIS]));
-        vmax_junction = block.nominal_feedrate;
+        vmax_junction = nominal_feedrate;
         if (xy_jerk > max_xy_jerk)
         {
             vmax_junction_factor = Ratio(max_xy_jerk / xy_jerk);
@@ -251,21 +225,22 @@ void TimeEstimateCalculator::plan(Position newPos, Velocity feedrate, PrintFeatu
         vmax_junction = std::min(previous_nominal_feedrate, vmax_junction * vmax_junction_factor); // Limit speed to max previous speed
     }
 
-    block.max_entry_speed = vmax_junction;
+    const double speed_gain2 = 2 * block_acceleration * distance;
+    const Velocity v_allowable = maxAllowableSpeed(MINIMUM_PLANNER_SPEED, speed_gain2);
 
-    const Velocity v_allowable = maxAllowableSpeed(-block.acceleration, MINIMUM_PLANNER_SPEED, block.distance);
-    block.entry_speed = std::min(vmax_junction, v_allowable);
-    block.nominal_length_flag = block.nominal_feedrate <= v_allowable;
-    block.recalculate_flag = true; // Always calculate trapezoid for new block
+    blocks.feature.push_back(feature);
+    blocks.distance.push_back(distance);
+    blocks.acceleration.push_back(block_acceleration);
+    blocks.nominal_feedrate.push_back(nominal_feedrate);
+    blocks.max_entry_speed.push_back(vmax_junction);
+    blocks.entry_speed.push_back(std::min(vmax_junction, v_allowable));
+    blocks.speed_gain2.push_back(speed_gain2);
+    blocks.nominal_length_flag.push_back(nominal_feedrate <= v_allowable);
 
     previous_feedrate = current_feedrate;
-    previous_nominal_feedrate = block.nominal_feedrate;
+    previous_nominal_feedrate = nominal_feedrate;
 
     currentPosition = newPos;
-
-    calculateTrapezoidForBlock(&block, Ratio(block.entry_speed / block.nominal_feedrate), Ratio(safe_speed / block.nominal_feedrate));
-
-    blocks.push_back(block);
 }
 
 std::vector<Duration> TimeEstimateCalculator::calculate()
@@ -276,80 +251,35 @@ std::vector<Duration> TimeEstimateCalculator::calculate()
     
     std::vector<Duration> totals(static_cast<unsigned char>(PrintFeatureType::NumPrintFeatureTypes), 0.0);
     totals[static_cast<unsigned char>(PrintFeatureType::NoneType)] = extra_time; // Extra time (pause for minimum layer time, etc) is marked as NoneType
-    for(unsigned int n = 0; n < blocks.size(); n++)
+    for(size_t n = 0; n < blocks.size(); n++)
     {
-        const Block& block = blocks[n];
-        const double plateau_distance = block.decelerate_after - block.accelerate_until;
-
-        totals[static_cast<unsigned char>(block.feature)] += accelerationTimeFromDistance(block.initial_feedrate, block.accelerate_until, block.acceleration);
-        totals[static_cast<unsigned char>(block.feature)] += plateau_distance / block.nominal_feedrate;
-        totals[static_cast<unsigned char>(block.feature)] += accelerationTimeFromDistance(block.final_feedrate, (block.distance - block.decelerate_after), block.acceleration);
+        totals[static_cast<unsigned char>(blocks.feature[n])] += blocks.duration[n];
     }
     return totals;
 }
 
-void TimeEstimateCalculator::plannerReversePassKernel(Block *previous, Block *current, Block *next)
-{
-    (void)previous;
-    if (!current || !next)
-    {
-        return;
-    }
-
-    // If entry speed is already at the maximum entry speed, no need to recheck. Block is cruising.
-    // If not, block in state of acceleration or deceleration. Reset entry speed to maximum and
-    // check for maximum allowable speed reductions to ensure maximum possible planned speed.
-    if (current->entry_speed != current->max_entry_speed)
-    {
-        // If nominal length true, max junction speed is guaranteed to be reached. Only compute
-        // for max allowable speed if block is decelerating and nominal length is false.
-        if ((!current->nominal_length_flag) && (current->max_entry_speed > next->entry_speed))
-        {
-            current->entry_speed = std::min(current->max_entry_speed, maxAllowableSpeed(-current->acceleration, next->entry_speed, current->distance));
-        }
-        else
-        {
-            current->entry_speed = current->max_entry_speed;
-        }
-        current->recalculate_flag = true;
-    }
-}
-
 void TimeEstimateCalculator::reversePass()
 {
-    Block* block[3] = {nullptr, nullptr, nullptr};
-    for(size_t n = blocks.size() - 1; int(n) >= 0; n--)
+    const double* max_entry_speed = blocks.max_entry_speed.data();
+    const double* speed_gain2 = blocks.speed_gain2.data();
+    const char* nominal_length_flag = blocks.nominal_length_flag.data();
+    double* entry_speed = blocks.entry_speed.data();
+    for(int64_t n = static_cast<int64_t>(blocks.size()) - 2; n >= 0; n--)
     {
-        block[2]= block[1];
-        block[1]= block[0];
-        block[0] = &blocks[n];
-        plannerReversePassKernel(block[0], block[1], block[2]);
-    }
-}
-
-void TimeEstimateCalculator::plannerForwardPassKernel(Block *previous, Block *current, Block *next)
-{
-    (void)next;
-    if (!previous)
-    {
-        return;
-    }
-
-    // If the previous block is an acceleration block, but it is not long enough to complete the
-    // full speed change within the block, we need to adjust the entry speed accordingly. Entry
-    // speeds have already been reset, maximized, and reverse planned by reverse planner.
-    // If nominal length is true, max junction speed is guaranteed to be reached. No need to recheck.
-    if (!previous->nominal_length_flag)
-    {
-        if (previous->entry_speed < current->entry_speed)
+        // If entry speed is already at the maximum entry speed, no need to recheck. Block is cruising.
+        // If not, block in state of acceleration or deceleration. Reset entry speed to maximum and
+        // check for maximum allowable speed reductions to ensure maximum possible planned speed.
+        if (entry_speed[n] != max_entry_speed[n])
         {
-            const Velocity entry_speed = std::min(current->entry_speed, maxAllowableSpeed(-previous->acceleration, previous->entry_speed, previous->distance));
-
-            // Check for junction speed change
-            if (current->entry_speed != entry_speed)
+            // If nominal length true, max junction speed is guaranteed to be reached. Only compute
+            // for max allowable speed if block is decelerating and nominal length is false.
+            if ((!nominal_length_flag[n]) && (max_entry_speed[n] > entry_speed[n + 1]))
+            {
+                entry_speed[n] = std::min(max_entry_speed[n], maxAllowableSpeed(entry_speed[n + 1], speed_gain2[n]));
+            }
+            else
             {
-                current->entry_speed = entry_speed;
-                current->recalculate_flag = true;
+                entry_speed[n] = max_entry_speed[n];
             }
         }
     }
@@ -357,43 +287,66 @@ void TimeEstimateCalculator::plannerForwardPassKernel(Block *previous, Block *cu
 
 void TimeEstimateCalculator::forwardPass()
 {
-    Block* block[3] = {nullptr, nullptr, nullptr};
-    for(size_t n = 0; n < blocks.size(); n++)
+    const double* speed_gain2 = blocks.speed_gain2.data();
+    const char* nominal_length_flag = blocks.nominal_length_flag.data();
+    double* entry_speed = blocks.entry_speed.data();
+    for(size_t n = 1; n < blocks.size(); n++)
     {
-        block[0]= block[1];
-        block[1]= block[2];
-        block[2] = &blocks[n];
-        plannerForwardPassKernel(block[0], block[1], block[2]);
+        // If the previous block is an acceleration block, but it is not long enough to complete the
+        // full speed change within the block, we need to adjust the entry speed accordingly. Entry
+        // speeds have already been reset, maximized, and reverse planned by reverse planner.
+        // If nominal length is true, max junction speed is guaranteed to be reached. No need to recheck.
+        if (!nominal_length_flag[n - 1] && entry_speed[n - 1] < entry_speed[n])
+        {
+            entry_speed[n] = std::min(entry_speed[n], maxAllowableSpeed(entry_speed[n - 1], speed_gain2[n - 1]));
+        }
     }
-    plannerForwardPassKernel(block[1], block[2], nullptr);
 }
 
 void TimeEstimateCalculator::recalculateTrapezoids()
 {
-    Block *current;
-    Block *next = nullptr;
-
-    for(unsigned int n=0; n<blocks.size(); n++)
-    {
-        current = next;
-        next = &blocks[n];
-        if (current)
-        {
-            // Recalculate if current block entry or exit junction speed has changed.
-            if (current->recalculate_flag || next->recalculate_flag)
-            {
-                // NOTE: Entry and exit factors always > 0 by all previous logic operations.
-                calculateTrapezoidForBlock(current, Ratio(current->entry_speed / current->nominal_feedrate), Ratio(next->entry_speed / current->nominal_feedrate));
-                current->recalculate_flag = false; // Reset current only to ensure next trapezoid is computed
-            }
-        }
-    }
-    // Last/newest block in buffer. Exit speed is set with MINIMUM_PLANNER_SPEED. Always recalculated.
-    if (next != nullptr)
+    const size_t num_blocks = blocks.size();
+    blocks.duration.resize(num_blocks);
+
+    // Every block exits at the entry speed of the next. The last/newest block in buffer exits at MINIMUM_PLANNER_SPEED.
+    // Temporarily add that as the entry speed of a next block, so that all blocks can be computed the same way.
+    blocks.entry_speed.push_back(MINIMUM_PLANNER_SPEED);
+    const double* entry_speed = blocks.entry_speed.data();
+    const double* nominal_feedrate = blocks.nominal_feedrate.data();
+    const double* acceleration = blocks.acceleration.data();
+    const double* distance = blocks.distance.data();
+    double* duration = blocks.duration.data(); // Only one output array, so that the compiler needs few checks whether the arrays overlap.
+    // Recalculating all of them is cheaper than keeping track of which changed, since this loop has no branches that can't be vectorised.
+    for(size_t n = 0; n < num_blocks; n++)
     {
-        calculateTrapezoidForBlock(next, Ratio(next->entry_speed / next->nominal_feedrate), Ratio(MINIMUM_PLANNER_SPEED / next->nominal_feedrate));
-        next->recalculate_flag = false;
+        const double initial_feedrate = nominal_feedrate[n] * (entry_speed[n] / nominal_feedrate[n]);
+        const double final_feedrate = nominal_feedrate[n] * (entry_speed[n + 1] / nominal_feedrate[n]);
+
+        double accelerate_distance = estimateAccelerationDistance(initial_feedrate, nominal_feedrate[n], acceleration[n]);
+        const double decelerate_distance = estimateAccelerationDistance(nominal_feedrate[n], final_feedrate, -acceleration[n]);
+
+        // Calculate the size of Plateau of Nominal Rate.
+        double plateau_distance = distance[n] - accelerate_distance - decelerate_distance;
+
+        // Is the Plateau of Nominal Rate smaller than nothing? That means no cruising, and we will
+        // have to use intersection_distance() to calculate when to abort acceleration and start braking
+        // in order to reach the final_rate exactly at the end of this block.
+        double intersection_distance = intersectionDistance(initial_feedrate, final_feedrate, acceleration[n], distance[n]);
+        intersection_distance = std::max(intersection_distance, 0.0); // Check limits due to numerical round-off
+        intersection_distance = std::min(intersection_distance, distance[n]);
+        const bool has_plateau = plateau_distance >= 0;
+        accelerate_distance = has_plateau ? accelerate_distance : intersection_distance;
+        plateau_distance = has_plateau ? plateau_distance : 0.0;
+        const double accelerate_until = accelerate_distance;
+        const double decelerate_after = accelerate_distance + plateau_distance;
+
+        // Rounding errors may make any phase slightly negative. Those count as taking no time.
+        const double acceleration_time = std::max(0.0, accelerationTimeFromDistance(initial_feedrate, accelerate_until, acceleration[n]));
+        const double plateau_time = std::max(0.0, (decelerate_after - accelerate_until) / nominal_feedrate[n]);
+        const double deceleration_time = std::max(0.0, accelerationTimeFromDistance(final_feedrate, distance[n] - decelerate_after, acceleration[n]));
+        duration[n] = acceleration_time + plateau_time + deceleration_time;
     }
+    blocks.entry_speed.pop_back();
 }
 
 }//namespace cura
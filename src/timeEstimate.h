@@ -43,30 +43,6 @@ public:
         double& operator[](const int n) { return axis[n]; }
     };
 
-    class Block
-    {
-    public:
-        bool recalculate_flag;
-        
-        double accelerate_until;
-        double decelerate_after;
-        Velocity initial_feedrate;
-        Velocity final_feedrate;
-
-        Velocity entry_speed;
-        Velocity max_entry_speed;
-        bool nominal_length_flag;
-        
-        Velocity nominal_feedrate;
-        double maxTravel;
-        double distance;
-        Acceleration acceleration;
-        Position delta;
-        Position absDelta;
-
-        PrintFeatureType feature;
-    };
-
 private:
     Velocity max_feedrate[NUM_AXIS] = {600, 600, 40, 25}; // mm/s
     Velocity minimumfeedrate = 0.01;
@@ -82,7 +58,36 @@ private:
 
     Position currentPosition;
 
-    std::vector<Block> blocks;
+    /*!
+     * The moves that were planned, in order.
+     *
+     * Each property of the moves is stored in its own array. The passes over
+     * all moves then read only the properties that they need, in long
+     * contiguous loops that the compiler can vectorise where the moves don't
+     * depend on each other.
+     */
+    struct Blocks
+    {
+        std::vector<PrintFeatureType> feature; //!< What the move is printing.
+        std::vector<double> distance; //!< Length of the move in mm.
+        std::vector<double> acceleration; //!< Acceleration in mm/s² allowed for the move.
+        std::vector<double> nominal_feedrate; //!< Speed in mm/s that the move tries to reach.
+        std::vector<double> max_entry_speed; //!< Highest speed in mm/s allowed at the start of the move, due to the jerk with the previous move.
+        std::vector<double> entry_speed; //!< The planned speed in mm/s at the start of the move.
+        std::vector<double> speed_gain2; //!< How much the squared speed can grow over the length of the move (2 * acceleration * distance).
+        std::vector<char> nominal_length_flag; //!< Whether the move is long enough to reach its nominal speed from any entry speed.
+
+        std::vector<double> duration; //!< The time in seconds that the move takes, as of the last calculation.
+
+        size_t size() const
+        {
+            return feature.size();
+        }
+
+        void clear();
+    };
+
+    Blocks blocks;
 public:
     /*!
      * \brief Set the movement configuration of the firmware.
@@ -99,22 +104,33 @@ public:
     
     std::vector<Duration> calculate();
 private:
+    /*!
+     * Lower the entry speed of each move, from the last to the first, so that
+     * it's possible to decelerate to the entry speed of the next move.
+     *
+     * This one is inherently sequential, since each move depends on the next.
+     */
     void reversePass();
+
+    /*!
+     * Lower the entry speed of each move, from the first to the last, so that
+     * it's possible to accelerate to it from the entry speed of the previous
+     * move.
+     *
+     * This one is inherently sequential, since each move depends on the
+     * previous.
+     */
     void forwardPass();
 
-    // Recalculates the trapezoid speed profiles for all blocks in the plan according to the
-    // entry_factor for each junction. Must be called by planner_recalculate() after
-    // updating the blocks.
+    /*!
+     * Compute the trapezoid speed profile of each move from its entry speed
+     * and the entry speed of the next move, and the time that the move takes
+     * according to that profile.
+     *
+     * Each move is computed independently and without branches, so this loop
+     * vectorises (if the compiler may ignore errno for sqrt, as with -Ofast).
+     */
     void recalculateTrapezoids();
-
-    // Calculates trapezoid parameters so that the entry- and exit-speed is compensated by the provided factors.
-    void calculateTrapezoidForBlock(Block *block, const Ratio entry_factor, const Ratio exit_factor);
-
-    // The kernel called by accelerationPlanner::calculate() when scanning the plan from last to first entry.
-    void plannerReversePassKernel(Block *previous, Block *current, Block *next);
-
-    // The kernel called by accelerationPlanner::calculate() when scanning the plan from first to last entry.
-    void plannerForwardPassKernel(Block *previous, Block *current, Block *next);
 };
 
 }//namespace cura
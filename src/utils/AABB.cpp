@@ -3,6 +3,7 @@
 
 #include <limits>
 #include "AABB.h"
+#include "BatchGeometry.h" //To compute the bounding box of many points at once.
 #include "polygon.h" //To create the AABB of a polygon.
 #include "linearAlg2D.h"
 
@@ -70,10 +71,7 @@ void AABB::calculate(const Polygons& polys)
     max = Point(POINT_MIN, POINT_MIN);
     for (unsigned int i = 0; i < polys.size(); i++)
     {
-        for (unsigned int j = 0; j < polys[i].size(); j++)
-        {
-            include(polys[i][j]);
-        }
+        BatchGeometry::includeInBoundingBox(*polys[i], min, max);
     }
 }
 
@@ -81,10 +79,7 @@ void AABB::calculate(ConstPolygonRef poly)
 {
     min = Point(POINT_MAX, POINT_MAX);
     max = Point(POINT_MIN, POINT_MIN);
-    for (const Point& p : poly)
-    {
-        include(p);
-    }
+    BatchGeometry::includeInBoundingBox(*poly, min, max);
 }
 
 bool AABB::contains(const Point& point) const
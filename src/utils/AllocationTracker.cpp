@@ -0,0 +1,276 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "AllocationTracker.h"
+
+#ifdef CURA_TRACK_ALLOCATIONS
+
+#include <algorithm> //For std::min and std::max.
+#include <atomic>
+#include <cstdint>
+#include <cstdlib> //For malloc and free.
+#include <cstring> //For strcmp.
+#include <mutex>
+#include <new>
+
+#include "logoutput.h"
+
+namespace cura
+{
+
+namespace
+{
+
+/*
+ * All bookkeeping is in fixed arrays, since it happens inside operator new
+ * and must not allocate itself. They are zero-initialised before any
+ * constructor runs, so allocations of static objects are counted too.
+ */
+constexpr int max_stages = 64; //!< Further stages are counted in the last one.
+constexpr int max_threads = 128; //!< Further threads are counted as the last one.
+constexpr int no_stage = 0; //!< The stage of allocations outside of any zone.
+
+/*!
+ * Stored in front of every allocation, to know what to subtract again when
+ * it's freed. Its size keeps the allocation aligned for any type.
+ */
+struct alignas(alignof(std::max_align_t)) Header
+{
+    size_t size;
+    int stage;
+};
+
+struct StageCounters
+{
+    std::atomic<size_t> allocations;
+    std::atomic<size_t> bytes;
+    std::atomic<int64_t> live_bytes; //!< May go below zero if memory is freed in another stage than where it was counted.
+    std::atomic<int64_t> peak_live_bytes;
+};
+
+struct ThreadCounters
+{
+    std::atomic<size_t> allocations;
+    std::atomic<size_t> bytes;
+};
+
+std::atomic<const char*> stage_names[max_stages]; //!< Index 0 is no_stage.
+std::atomic<int> stage_count(1);
+std::mutex stage_names_mutex; //!< Guards adding stages.
+StageCounters stage_counters[max_stages];
+ThreadCounters thread_counters[max_threads][max_stages];
+std::atomic<int> thread_count(0);
+
+thread_local int current_stage = no_stage;
+thread_local int thread_nr = -1;
+
+int getThreadNr()
+{
+    if (thread_nr < 0)
+    {
+        thread_nr = std::min(thread_count.fetch_add(1, std::memory_order_relaxed), max_threads - 1);
+    }
+    return thread_nr;
+}
+
+int findStage(const char* name)
+{
+    const int count = stage_count.load(std::memory_order_acquire);
+    for (int stage = 1; stage < count; stage++)
+    {
+        const char* stage_name = stage_names[stage].load(std::memory_order_relaxed);
+        if (stage_name == name || std::strcmp(stage_name, name) == 0) //The same literal may have different addresses in different files.
+        {
+            return stage;
+        }
+    }
+    return -1;
+}
+
+void countAllocation(const int stage, const size_t size)
+{
+    StageCounters& counters = stage_counters[stage];
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(size, std::memory_order_relaxed);
+    const int64_t live_bytes = counters.live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = counters.peak_live_bytes.load(std::memory_order_relaxed);
+    while (live_bytes > peak && !counters.peak_live_bytes.compare_exchange_weak(peak, live_bytes, std::memory_order_relaxed))
+    {
+    }
+    ThreadCounters& thread = thread_counters[getThreadNr()][stage];
+    thread.allocations.fetch_add(1, std::memory_order_relaxed);
+    thread.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void* allocate(const size_t size)
+{
+    void* block = std::malloc(sizeof(Header) + size);
+    if (!block)
+    {
+        return nullptr;
+    }
+    Header* header = static_cast<Header*>(block);
+    header->size = size;
+    header->stage = current_stage;
+    countAllocation(current_stage, size);
+    return header + 1;
+}
+
+void deallocate(void* pointer)
+{
+    if (!pointer)
+    {
+        return;
+    }
+    Header* header = static_cast<Header*>(pointer) - 1;
+    stage_counters[header->stage].live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+    std::free(header);
+}
+
+void* allocateOrThrow(const size_t size)
+{
+    void* result = allocate(size);
+    while (!result)
+    {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+        {
+            throw std::bad_alloc();
+        }
+        handler();
+        result = allocate(size);
+    }
+    return result;
+}
+
+} //Anonymous namespace.
+
+int AllocationTracker::enterStage(const char* name)
+{
+    const int previous_stage = current_stage;
+    int stage = findStage(name);
+    if (stage < 0)
+    {
+        std::lock_guard<std::mutex> lock(stage_names_mutex);
+        stage = findStage(name); //Another thread may have added it in the meanwhile.
+        if (stage < 0)
+        {
+            stage = stage_count.load(std::memory_order_relaxed);
+            if (stage < max_stages)
+            {
+                stage_names[stage].store(name, std::memory_order_relaxed);
+                stage_count.store(stage + 1, std::memory_order_release);
+            }
+            else
+            {
+                stage = max_stages - 1;
+            }
+        }
+    }
+    current_stage = stage;
+    return previous_stage;
+}
+
+void AllocationTracker::leaveStage(const int previous_stage)
+{
+    current_stage = previous_stage;
+}
+
+AllocationTracker::Counts AllocationTracker::getCounts(const char* name)
+{
+    Counts result;
+    const int stage = findStage(name);
+    if (stage >= 0)
+    {
+        const StageCounters& counters = stage_counters[stage];
+        result.allocations = counters.allocations.load(std::memory_order_relaxed);
+        result.bytes = counters.bytes.load(std::memory_order_relaxed);
+        result.peak_live_bytes = std::max(int64_t(0), counters.peak_live_bytes.load(std::memory_order_relaxed));
+    }
+    return result;
+}
+
+void AllocationTracker::logSummary()
+{
+    constexpr double megabyte = 1024.0 * 1024.0;
+    const int count = stage_count.load(std::memory_order_acquire);
+    const int threads = std::min(thread_count.load(std::memory_order_relaxed), max_threads);
+    log("Allocations per stage:\n");
+    for (int stage = 0; stage < count; stage++)
+    {
+        StageCounters& counters = stage_counters[stage];
+        const size_t allocations = counters.allocations.exchange(0, std::memory_order_relaxed);
+        const size_t bytes = counters.bytes.exchange(0, std::memory_order_relaxed);
+        const int64_t peak = counters.peak_live_bytes.exchange(std::max(int64_t(0), counters.live_bytes.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        if (allocations == 0)
+        {
+            continue;
+        }
+        const char* name = (stage == no_stage) ? "(outside of stages)" : stage_names[stage].load(std::memory_order_relaxed);
+        log("  %-24s %10zu allocations, %9.1fMB allocated, peak %8.1fMB live\n", name, allocations, bytes / megabyte, std::max(int64_t(0), peak) / megabyte);
+        for (int thread = 0; thread < threads; thread++)
+        {
+            ThreadCounters& thread_counts = thread_counters[thread][stage];
+            const size_t thread_allocations = thread_counts.allocations.exchange(0, std::memory_order_relaxed);
+            const size_t thread_bytes = thread_counts.bytes.exchange(0, std::memory_order_relaxed);
+            if (thread_allocations > 0)
+            {
+                logDebug("    thread %3d %10zu allocations, %9.1fMB allocated\n", thread, thread_allocations, thread_bytes / megabyte);
+            }
+        }
+    }
+}
+
+} //namespace cura
+
+void* operator new(std::size_t size)
+{
+    return cura::allocateOrThrow(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return cura::allocateOrThrow(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return cura::allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return cura::allocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    cura::deallocate(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    cura::deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    cura::deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    cura::deallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    cura::deallocate(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    cura::deallocate(pointer);
+}
+
+#endif //CURA_TRACK_ALLOCATIONS
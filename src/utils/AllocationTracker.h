@@ -0,0 +1,91 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_ALLOCATION_TRACKER_H
+#define UTILS_ALLOCATION_TRACKER_H
+
+#include <cstddef>
+
+namespace cura
+{
+
+/*!
+ * \brief Counts the heap allocations of each stage of the slicing, to see
+ * which stages allocate the most and on which threads.
+ *
+ * The stages are the zones of the trace (see \ref TraceZone). Allocations are
+ * attributed to the innermost zone on the thread that makes them.
+ *
+ * Tracking replaces the global operator new and delete, so it has to be
+ * chosen when compiling: configure with ENABLE_ALLOCATION_TRACKING, which
+ * defines CURA_TRACK_ALLOCATIONS. Otherwise all of this does nothing and costs
+ * nothing.
+ */
+class AllocationTracker
+{
+public:
+    /*!
+     * The allocations of a stage, summed over all threads.
+     */
+    struct Counts
+    {
+        size_t allocations = 0; //!< How many allocations were made.
+        size_t bytes = 0; //!< How many bytes were requested in total.
+        size_t peak_live_bytes = 0; //!< The most bytes that were allocated by the stage and not freed yet at any time.
+    };
+
+    /*!
+     * Whether allocations are counted in this build.
+     */
+    static constexpr bool isEnabled()
+    {
+#ifdef CURA_TRACK_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+#ifdef CURA_TRACK_ALLOCATIONS
+    /*!
+     * Attribute the allocations of this thread to a stage, until
+     * \ref leaveStage.
+     * \param name The name of the stage. It must stay valid until the summary
+     * is logged, so it's meant to be a string literal.
+     * \return The stage that the thread was in before, to give to
+     * \ref leaveStage.
+     */
+    static int enterStage(const char* name);
+
+    /*!
+     * Go back to attributing the allocations of this thread to the stage it
+     * was in before \ref enterStage.
+     * \param previous_stage What \ref enterStage returned.
+     */
+    static void leaveStage(const int previous_stage);
+
+    /*!
+     * Get the allocations of a stage so far.
+     * \param name The name of the stage.
+     * \return The counts, or zeroes if the stage didn't allocate anything.
+     */
+    static Counts getCounts(const char* name);
+
+    /*!
+     * Log the allocations of each stage since the last summary, and of each
+     * thread in that stage, then start counting from zero.
+     *
+     * The peak of live bytes restarts from what's still allocated.
+     */
+    static void logSummary();
+#else
+    static int enterStage(const char*) { return 0; }
+    static void leaveStage(const int) {}
+    static Counts getCounts(const char*) { return Counts(); }
+    static void logSummary() {}
+#endif
+};
+
+} //namespace cura
+
+#endif //UTILS_ALLOCATION_TRACKER_H
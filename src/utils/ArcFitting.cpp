@@ -0,0 +1,120 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cmath> //For std::hypot and std::atan2.
+
+#include "ArcFitting.h"
+
+namespace cura
+{
+
+/*!
+ * The most line segments to fit one arc through. Each attempt to extend an arc
+ * checks all of its line segments again, so this keeps long circles from
+ * taking quadratic time. They are written as multiple arcs instead.
+ */
+constexpr size_t max_segments = 256;
+
+std::vector<ArcFitting::Arc> ArcFitting::fit(const Point start, const Point* points, const size_t point_count, const coord_t tolerance, const coord_t max_radius)
+{
+    std::vector<Arc> result;
+    if (point_count < min_segments)
+    {
+        return result;
+    }
+    std::vector<Point> vertices;
+    vertices.reserve(point_count + 1);
+    vertices.push_back(start);
+    vertices.insert(vertices.end(), points, points + point_count);
+
+    size_t begin = 0;
+    while (begin + min_segments < vertices.size())
+    {
+        Arc arc;
+        size_t end = begin + min_segments;
+        if (!fitRun(vertices, begin, end, tolerance, max_radius, arc))
+        {
+            begin++;
+            continue;
+        }
+        Arc longer_arc;
+        while (end + 1 < vertices.size() && end + 1 - begin <= max_segments && fitRun(vertices, begin, end + 1, tolerance, max_radius, longer_arc))
+        {
+            end++;
+            arc = longer_arc;
+        }
+        //The polyline's vertices are one further along than the points that are moved to.
+        arc.first_idx = begin;
+        arc.last_idx = end - 1;
+        result.push_back(arc);
+        begin = end;
+    }
+    return result;
+}
+
+bool ArcFitting::fitRun(const std::vector<Point>& vertices, const size_t begin, const size_t end, const coord_t tolerance, const coord_t max_radius, Arc& arc)
+{
+    //The circle through the first, middle and last vertex.
+    const Point a = vertices[begin];
+    const double bx = vertices[(begin + end) / 2].X - a.X;
+    const double by = vertices[(begin + end) / 2].Y - a.Y;
+    const double cx = vertices[end].X - a.X;
+    const double cy = vertices[end].Y - a.Y;
+    const double determinant = 2.0 * (bx * cy - by * cx);
+    if (std::abs(determinant) < 1.0) //Collinear.
+    {
+        return false;
+    }
+    const double b2 = bx * bx + by * by;
+    const double c2 = cx * cx + cy * cy;
+    const double center_x = (cy * b2 - by * c2) / determinant;
+    const double center_y = (bx * c2 - cx * b2) / determinant;
+    const double radius = std::hypot(center_x, center_y);
+    if (radius > max_radius)
+    {
+        return false;
+    }
+    const auto off_circle = [center_x, center_y, radius](const double x, const double y)
+    {
+        return std::abs(std::hypot(x - center_x, y - center_y) - radius);
+    };
+
+    //All line segments must be close to the circle, and turn around it in the same direction.
+    const bool counter_clockwise = determinant > 0;
+    double swept_angle = 0.0;
+    for (size_t vertex_idx = begin; vertex_idx < end; vertex_idx++)
+    {
+        const double x0 = vertices[vertex_idx].X - a.X;
+        const double y0 = vertices[vertex_idx].Y - a.Y;
+        const double x1 = vertices[vertex_idx + 1].X - a.X;
+        const double y1 = vertices[vertex_idx + 1].Y - a.Y;
+        if (off_circle(x1, y1) > tolerance || off_circle((x0 + x1) / 2, (y0 + y1) / 2) > tolerance)
+        {
+            return false;
+        }
+        const double cross = (x0 - center_x) * (y1 - center_y) - (y0 - center_y) * (x1 - center_x);
+        const double dot = (x0 - center_x) * (x1 - center_x) + (y0 - center_y) * (y1 - center_y);
+        if ((cross > 0) != counter_clockwise || cross == 0)
+        {
+            return false;
+        }
+        if (vertex_idx > begin) //The corners must turn the same way too, or it's a zigzag along the circle.
+        {
+            const double turn = (x0 - (vertices[vertex_idx - 1].X - a.X)) * (y1 - y0) - (y0 - (vertices[vertex_idx - 1].Y - a.Y)) * (x1 - x0);
+            if ((turn > 0) != counter_clockwise)
+            {
+                return false;
+            }
+        }
+        swept_angle += std::abs(std::atan2(cross, dot));
+    }
+    if (swept_angle >= 2.0 * M_PI - 0.01) //A full circle has the same start and end, which is ambiguous as an arc.
+    {
+        return false;
+    }
+    arc.center = a + Point(std::llrint(center_x), std::llrint(center_y));
+    arc.counter_clockwise = counter_clockwise;
+    return true;
+}
+
+} //namespace cura
@@ -0,0 +1,75 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_ARC_FITTING_H
+#define UTILS_ARC_FITTING_H
+
+#include <vector>
+
+#include "IntPoint.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Finds the runs of line segments in a polyline that lie on a circular
+ * arc, so that they can be written as a single arc move (G2/G3) instead.
+ */
+class ArcFitting
+{
+public:
+    /*!
+     * A run of line segments that can be replaced by one arc.
+     *
+     * The arc replaces the moves to the vertices \ref first_idx up to and
+     * including \ref last_idx, so it starts at the vertex before
+     * \ref first_idx (or at the start of the polyline) and ends at
+     * \ref last_idx.
+     */
+    struct Arc
+    {
+        size_t first_idx; //!< The first vertex that the arc replaces the move to.
+        size_t last_idx; //!< The vertex where the arc ends.
+        Point center; //!< The center of the circle that the arc is part of.
+        bool counter_clockwise; //!< Whether the arc turns counter-clockwise (G3) rather than clockwise (G2).
+    };
+
+    /*!
+     * The fewest line segments to replace by an arc. Fewer can't be told apart
+     * from a corner well, and hardly save anything.
+     */
+    static constexpr size_t min_segments = 3;
+
+    /*!
+     * Find the arcs in a polyline.
+     *
+     * A run of line segments is replaced if all vertices and the middles of all
+     * line segments are within the tolerance of the arc, and the run turns in
+     * one direction for less than a full circle.
+     * \param start Where the polyline starts.
+     * \param points The vertices that the polyline moves to after the start.
+     * \param point_count How many vertices that are.
+     * \param tolerance How far the line segments may be from the arc.
+     * \param max_radius The largest radius of arcs to make. Runs that are
+     * almost straight stay line segments.
+     * \return The arcs, in the order of the polyline. They don't overlap.
+     */
+    static std::vector<Arc> fit(const Point start, const Point* points, const size_t point_count, const coord_t tolerance, const coord_t max_radius);
+
+private:
+    /*!
+     * Try to fit an arc through a run of vertices.
+     * \param vertices The polyline, including its start.
+     * \param begin The vertex where the arc would start.
+     * \param end The vertex where the arc would end.
+     * \param tolerance How far the line segments may be from the arc.
+     * \param max_radius The largest radius of arcs to make.
+     * \param[out] arc The center and direction of the arc, if it fits.
+     * \return Whether the run lies on an arc.
+     */
+    static bool fitRun(const std::vector<Point>& vertices, const size_t begin, const size_t end, const coord_t tolerance, const coord_t max_radius, Arc& arc);
+};
+
+} //namespace cura
+
+#endif //UTILS_ARC_FITTING_H
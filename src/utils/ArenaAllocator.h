@@ -0,0 +1,137 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_ARENA_ALLOCATOR_H
+#define UTILS_ARENA_ALLOCATOR_H
+
+#include <algorithm> //For std::max.
+#include <cstddef>
+#include <cstdint>
+#include <memory> //For unique_ptr.
+#include <vector>
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief A region of memory in which many small objects are allocated, to be
+ * freed all at once.
+ *
+ * Memory is handed out from contiguous slabs by bumping a pointer. Individual
+ * allocations are never freed. All memory is released when the arena is
+ * destroyed. This is intended for data structures with many small elements
+ * that all share the same lifetime, such as the nodes and edges of a graph
+ * that is built, processed and then thrown away.
+ */
+class MemoryArena : public NoCopy
+{
+public:
+    /*!
+     * \brief Create an empty arena.
+     * \param first_slab_size The size in bytes of the first slab to allocate.
+     * Subsequent slabs grow up to \ref max_slab_size.
+     */
+    MemoryArena(const size_t first_slab_size = 4096)
+    : cursor(nullptr)
+    , slab_end(nullptr)
+    , next_slab_size(first_slab_size)
+    {
+    }
+
+    /*!
+     * \brief Allocate a block of memory in this arena.
+     * \param size The number of bytes to allocate.
+     * \param alignment The alignment of the block. Must be a power of two and
+     * at most the alignment of std::max_align_t.
+     * \return A pointer to the allocated block. It stays valid until the arena
+     * is destroyed.
+     */
+    void* allocate(const size_t size, const size_t alignment)
+    {
+        uintptr_t start = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(alignment - 1);
+        if (! cursor || start + size > reinterpret_cast<uintptr_t>(slab_end))
+        {
+            addSlab(size);
+            start = reinterpret_cast<uintptr_t>(cursor); //New slabs are maximally aligned.
+        }
+        cursor = reinterpret_cast<char*>(start + size);
+        return reinterpret_cast<void*>(start);
+    }
+
+private:
+    static constexpr size_t max_slab_size = 1 << 20; //!< Slabs grow up to 1MB, unless a single allocation is bigger.
+
+    std::vector<std::unique_ptr<char[]>> slabs; //!< All memory owned by this arena.
+    char* cursor; //!< Where the next allocation in the current slab starts.
+    char* slab_end; //!< The end of the current slab.
+    size_t next_slab_size; //!< The size of the next slab to allocate.
+
+    /*!
+     * \brief Start a new slab that fits at least the given number of bytes.
+     */
+    void addSlab(const size_t min_size)
+    {
+        const size_t slab_size = std::max(next_slab_size, min_size);
+        slabs.emplace_back(new char[slab_size]);
+        cursor = slabs.back().get();
+        slab_end = cursor + slab_size;
+        next_slab_size = std::min(next_slab_size * 2, max_slab_size);
+    }
+};
+
+/*!
+ * \brief Standard allocator that allocates from a \ref MemoryArena.
+ *
+ * Deallocating does nothing; the memory is released along with the arena. The
+ * arena must outlive all containers that use this allocator.
+ * \tparam T The type of objects to allocate.
+ */
+template<typename T>
+class ArenaAllocator
+{
+    template<typename U> friend class ArenaAllocator;
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(MemoryArena& arena) noexcept
+    : arena(&arena)
+    {
+    }
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+    : arena(other.arena)
+    {
+    }
+
+    T* allocate(const size_t n)
+    {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, const size_t) noexcept
+    {
+        //Memory is only released when the arena is destroyed.
+    }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept
+    {
+        return arena == other.arena;
+    }
+
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept
+    {
+        return arena != other.arena;
+    }
+
+private:
+    MemoryArena* arena; //!< Where to allocate memory from.
+};
+
+} // namespace cura
+
+#endif // UTILS_ARENA_ALLOCATOR_H
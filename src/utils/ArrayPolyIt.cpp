@@ -0,0 +1,86 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "ArrayPolyIt.h"
+
+namespace cura
+{
+
+ArrayListPolygon::ArrayListPolygon(ConstPolygonRef poly)
+: first_idx(0)
+, vertex_count(poly.size())
+{
+    //Smoothing inserts at most two vertices per corner it cuts off, so this mostly avoids growing the arrays.
+    const size_t capacity = poly.size() * 2;
+    points.reserve(capacity);
+    next_idx.reserve(capacity);
+    prev_idx.reserve(capacity);
+    points.insert(points.end(), poly.begin(), poly.end());
+    for (size_t idx = 0; idx < poly.size(); idx++)
+    {
+        next_idx.push_back((idx + 1 == poly.size()) ? 0 : idx + 1);
+        prev_idx.push_back((idx == 0) ? poly.size() - 1 : idx - 1);
+    }
+}
+
+size_t ArrayListPolygon::insert(const size_t before_idx, const Point to_insert)
+{
+    const size_t new_idx = points.size();
+    const size_t prev = prev_idx[before_idx];
+    points.push_back(to_insert);
+    next_idx.push_back(before_idx);
+    prev_idx.push_back(prev);
+    next_idx[prev] = new_idx;
+    prev_idx[before_idx] = new_idx;
+    if (before_idx == first_idx)
+    {
+        first_idx = new_idx;
+    }
+    vertex_count++;
+    return new_idx;
+}
+
+void ArrayListPolygon::remove(const size_t idx)
+{
+    assert(next_idx[idx] != tombstone && "Can't remove a vertex twice.");
+    const size_t next = next_idx[idx];
+    const size_t prev = prev_idx[idx];
+    next_idx[prev] = next;
+    prev_idx[next] = prev;
+    if (idx == first_idx)
+    {
+        first_idx = next;
+    }
+    next_idx[idx] = tombstone;
+    prev_idx[idx] = tombstone;
+    vertex_count--;
+}
+
+void ArrayListPolygon::toPolygon(PolygonRef result) const
+{
+    result.reserve(result.size() + vertex_count);
+    size_t idx = first_idx;
+    for (size_t vertex_nr = 0; vertex_nr < vertex_count; vertex_nr++)
+    {
+        result.add(points[idx]);
+        idx = next_idx[idx];
+    }
+}
+
+ArrayPolyIt ArrayPolyIt::insertPointNonDuplicate(const ArrayPolyIt before, const ArrayPolyIt after, const Point to_insert)
+{
+    if (to_insert == before.p())
+    {
+        return before;
+    }
+    else if (to_insert == after.p())
+    {
+        return after;
+    }
+    else
+    {
+        return ArrayPolyIt(*after.poly, after.poly->insert(after.idx, to_insert));
+    }
+}
+
+}//namespace cura
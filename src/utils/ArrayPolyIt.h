@@ -0,0 +1,170 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_ARRAY_POLY_IT_H
+#define UTILS_ARRAY_POLY_IT_H
+
+#include <vector>
+
+#include "IntPoint.h"
+#include "polygon.h"
+
+namespace cura
+{
+
+/*!
+ * \brief A polygon in which vertices can be inserted and removed anywhere,
+ * like a \ref ListPolygon, but which keeps its vertices in arrays instead of
+ * allocating a list node for each of them.
+ *
+ * Each vertex knows the index of the vertex before and after it along the
+ * polygon. Inserted vertices are added at the end of the arrays. Removed
+ * vertices stay where they are as tombstones, and are left out when converting
+ * back to a polygon.
+ *
+ * The order and the first vertex are kept the same way as those of a
+ * \ref ListPolygon, so that algorithms written for \ref ListPolyIt give exactly
+ * the same result with \ref ArrayPolyIt.
+ */
+class ArrayListPolygon
+{
+public:
+    /*!
+     * Copy the vertices of a polygon.
+     * \param poly The polygon to copy.
+     */
+    ArrayListPolygon(ConstPolygonRef poly);
+
+    /*!
+     * The vertex that a \ref ListPolygon would have at its begin.
+     */
+    size_t first() const
+    {
+        return first_idx;
+    }
+
+    /*!
+     * How many vertices are left, not counting the removed ones.
+     */
+    size_t size() const
+    {
+        return vertex_count;
+    }
+
+    /*!
+     * Insert a vertex in front of another one.
+     *
+     * Like inserting into a \ref ListPolygon, inserting in front of the first
+     * vertex makes the new vertex the first one.
+     * \param before_idx The vertex to insert in front of.
+     * \param to_insert The location of the new vertex.
+     * \return The index of the new vertex.
+     */
+    size_t insert(const size_t before_idx, const Point to_insert);
+
+    /*!
+     * Remove a vertex, leaving a tombstone in its place.
+     *
+     * Like erasing from a \ref ListPolygon, removing the first vertex makes the
+     * vertex after it the first one.
+     * \param idx The vertex to remove.
+     */
+    void remove(const size_t idx);
+
+    /*!
+     * Add the remaining vertices to a polygon, starting from the first.
+     * \param result The polygon to add them to.
+     */
+    void toPolygon(PolygonRef result) const;
+
+private:
+    friend class ArrayPolyIt;
+
+    static constexpr size_t tombstone = static_cast<size_t>(-1); //!< The next and previous index of removed vertices.
+
+    std::vector<Point> points; //!< The location of each vertex, including removed ones.
+    std::vector<size_t> next_idx; //!< For each vertex, the vertex after it.
+    std::vector<size_t> prev_idx; //!< For each vertex, the vertex before it.
+    size_t first_idx;
+    size_t vertex_count;
+};
+
+/*!
+ * A drop-in replacement for \ref ListPolyIt over an \ref ArrayListPolygon.
+ */
+class ArrayPolyIt
+{
+public:
+    ArrayListPolygon* poly; //!< The polygon
+    size_t idx; //!< The index of the vertex in ArrayPolyIt::poly
+
+    ArrayPolyIt(ArrayListPolygon& poly, const size_t idx)
+    : poly(&poly)
+    , idx(idx)
+    {
+    }
+
+    /*!
+     * The location of the vertex.
+     *
+     * This is a copy, since inserting other vertices may move the vertices in
+     * memory.
+     */
+    Point p() const
+    {
+        assert(poly->next_idx[idx] != ArrayListPolygon::tombstone && "The vertex must not be removed.");
+        return poly->points[idx];
+    }
+
+    bool operator==(const ArrayPolyIt& other) const
+    {
+        return poly == other.poly && idx == other.idx;
+    }
+    bool operator!=(const ArrayPolyIt& other) const
+    {
+        return !(*this == other);
+    }
+    //! move the iterator forward (and wrap around at the end)
+    ArrayPolyIt& operator++()
+    {
+        idx = poly->next_idx[idx];
+        return *this;
+    }
+    //! move the iterator backward (and wrap around at the beginning)
+    ArrayPolyIt& operator--()
+    {
+        idx = poly->prev_idx[idx];
+        return *this;
+    }
+    //! move the iterator forward (and wrap around at the end)
+    ArrayPolyIt next() const
+    {
+        return ArrayPolyIt(*poly, poly->next_idx[idx]);
+    }
+    //! move the iterator backward (and wrap around at the beginning)
+    ArrayPolyIt prev() const
+    {
+        return ArrayPolyIt(*poly, poly->prev_idx[idx]);
+    }
+    //! Remove this point from the polygon
+    void remove() const
+    {
+        poly->remove(idx);
+    }
+
+    /*!
+     * Insert a point into the polygon if it's not a duplicate of the point
+     * before or the point after.
+     *
+     * \param before Iterator to the point before the point to insert
+     * \param after Iterator to the point after the point to insert
+     * \param to_insert The point to insert in between \p before and \p after
+     * \return Iterator to the newly inserted point, or \p before or \p after
+     * in case to_insert was already in the polygon
+     */
+    static ArrayPolyIt insertPointNonDuplicate(const ArrayPolyIt before, const ArrayPolyIt after, const Point to_insert);
+};
+
+}//namespace cura
+
+#endif//UTILS_ARRAY_POLY_IT_H
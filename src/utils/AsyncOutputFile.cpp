@@ -0,0 +1,342 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For std::min.
+#include <cstring> //For memcpy.
+#include <zlib.h> //To compress the output.
+
+#include "AsyncOutputFile.h"
+
+namespace cura
+{
+
+struct AsyncOutputFile::Buffer::Compressor
+{
+    z_stream stream; //!< The state of zlib.
+    std::vector<unsigned char> output; //!< Where zlib puts the compressed data before it's written to the file.
+    bool is_valid; //!< Whether zlib could be initialised.
+
+    Compressor()
+    : output(block_size)
+    {
+        std::memset(&stream, 0, sizeof(stream));
+        constexpr int window_bits = 15 + 16; //Add 16 to the largest window to get a gzip header rather than a zlib header.
+        constexpr int memory_level = 8; //The default.
+        is_valid = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, memory_level, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+
+    ~Compressor()
+    {
+        if (is_valid)
+        {
+            deflateEnd(&stream);
+        }
+    }
+
+    /*!
+     * Compress data and write the result to a file.
+     * \param data The data to compress.
+     * \param size The number of bytes to compress.
+     * \param flush_mode Z_NO_FLUSH to let zlib decide when to output data,
+     * Z_SYNC_FLUSH to output everything so far, or Z_FINISH to end the file.
+     * \param file The file to write the compressed data to.
+     * \return Whether compressing and writing succeeded.
+     */
+    bool write(const char* data, const size_t size, const int flush_mode, std::FILE* file)
+    {
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream.avail_in = static_cast<uInt>(size);
+        do
+        {
+            stream.next_out = output.data();
+            stream.avail_out = static_cast<uInt>(output.size());
+            if (deflate(&stream, flush_mode) == Z_STREAM_ERROR)
+            {
+                return false;
+            }
+            const size_t compressed_size = output.size() - stream.avail_out;
+            if (std::fwrite(output.data(), 1, compressed_size, file) != compressed_size)
+            {
+                return false;
+            }
+        }
+        while (stream.avail_out == 0); //Output buffer was full, so there may be more.
+        return true;
+    }
+};
+
+AsyncOutputFile::AsyncOutputFile()
+: std::ostream(nullptr)
+{
+    rdbuf(&buffer); //The buffer is only constructed after the base class, so it can't be passed to the constructor of std::ostream.
+}
+
+AsyncOutputFile::~AsyncOutputFile()
+{
+    close();
+}
+
+void AsyncOutputFile::open(const char* filename, const bool compress)
+{
+    close();
+    if (buffer.open(filename, compress))
+    {
+        clear();
+    }
+    else
+    {
+        setstate(std::ios_base::failbit);
+    }
+}
+
+bool AsyncOutputFile::is_open() const
+{
+    return buffer.isOpen();
+}
+
+void AsyncOutputFile::close()
+{
+    if (buffer.isOpen() && !buffer.close())
+    {
+        setstate(std::ios_base::badbit);
+    }
+}
+
+bool AsyncOutputFile::isCompressed() const
+{
+    return buffer.isCompressed();
+}
+
+size_t AsyncOutputFile::getPosition() const
+{
+    return buffer.getPosition();
+}
+
+bool AsyncOutputFile::overwrite(const size_t position, const std::string& data)
+{
+    return buffer.overwrite(position, data);
+}
+
+AsyncOutputFile::Buffer::Buffer()
+: file(nullptr)
+, current_block_position(0)
+, is_writing(false)
+, stop(false)
+, failed(false)
+{
+}
+
+AsyncOutputFile::Buffer::~Buffer()
+{
+    close();
+}
+
+bool AsyncOutputFile::Buffer::open(const char* filename, const bool compress)
+{
+    if (compress)
+    {
+        compressor = std::make_unique<Compressor>();
+        if (!compressor->is_valid)
+        {
+            compressor.reset();
+            return false;
+        }
+    }
+    file = std::fopen(filename, "wb");
+    if (!file)
+    {
+        compressor.reset();
+        return false;
+    }
+    std::setvbuf(file, nullptr, _IONBF, 0); //The blocks are large enough already. Don't copy them into yet another buffer.
+    current_block.resize(block_size);
+    setp(current_block.data(), current_block.data() + current_block.size());
+    current_block_position = 0;
+    stop = false;
+    failed = false;
+    writer = std::thread(&Buffer::writeBlocks, this);
+    return true;
+}
+
+bool AsyncOutputFile::Buffer::isOpen() const
+{
+    return file != nullptr;
+}
+
+bool AsyncOutputFile::Buffer::isCompressed() const
+{
+    return compressor != nullptr;
+}
+
+bool AsyncOutputFile::Buffer::close()
+{
+    if (!file)
+    {
+        return true;
+    }
+    queueBlock();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    queue_changed.notify_all();
+    writer.join();
+    if (compressor)
+    {
+        failed |= !compressor->write(nullptr, 0, Z_FINISH, file);
+        compressor.reset();
+    }
+    const bool success = std::fclose(file) == 0 && !failed;
+    file = nullptr;
+    setp(nullptr, nullptr);
+    current_block.clear();
+    current_block.shrink_to_fit();
+    spare_blocks.clear();
+    return success;
+}
+
+size_t AsyncOutputFile::Buffer::getPosition() const
+{
+    return current_block_position + (pptr() - pbase());
+}
+
+bool AsyncOutputFile::Buffer::overwrite(const size_t position, const std::string& data)
+{
+    if (!file || compressor || position + data.size() > getPosition())
+    {
+        return false;
+    }
+    queueBlock();
+    if (!waitUntilWritten())
+    {
+        return false;
+    }
+    //The writer thread is idle now, and stays so until more blocks are queued by this thread.
+    if (std::fseek(file, static_cast<long>(position), SEEK_SET) != 0)
+    {
+        return false; //Can't seek in this file, but nothing changed either.
+    }
+    const bool success = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    failed |= std::fseek(file, 0, SEEK_END) != 0; //Must continue writing at the end, or the rest of the file gets corrupted.
+    return success && !failed;
+}
+
+AsyncOutputFile::Buffer::int_type AsyncOutputFile::Buffer::overflow(int_type character)
+{
+    if (!file)
+    {
+        return traits_type::eof();
+    }
+    queueBlock();
+    if (!traits_type::eq_int_type(character, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(character);
+        pbump(1);
+    }
+    return traits_type::not_eof(character);
+}
+
+std::streamsize AsyncOutputFile::Buffer::xsputn(const char* data, std::streamsize count)
+{
+    if (!file)
+    {
+        return 0;
+    }
+    std::streamsize written = 0;
+    while (written < count)
+    {
+        if (pptr() == epptr())
+        {
+            queueBlock();
+        }
+        const std::streamsize chunk = std::min(count - written, static_cast<std::streamsize>(epptr() - pptr()));
+        std::memcpy(pptr(), data + written, chunk);
+        pbump(static_cast<int>(chunk));
+        written += chunk;
+    }
+    return written;
+}
+
+int AsyncOutputFile::Buffer::sync()
+{
+    if (!file)
+    {
+        return 0;
+    }
+    queueBlock();
+    if (!waitUntilWritten())
+    {
+        return -1;
+    }
+    //The writer thread is idle now, and stays so until more blocks are queued by this thread.
+    if (compressor && !compressor->write(nullptr, 0, Z_SYNC_FLUSH, file))
+    {
+        return -1;
+    }
+    return std::fflush(file) == 0 ? 0 : -1;
+}
+
+void AsyncOutputFile::Buffer::queueBlock()
+{
+    if (pptr() == pbase()) //Nothing to write.
+    {
+        return;
+    }
+    current_block.resize(pptr() - pbase());
+    current_block_position += current_block.size();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    queue_changed.wait(lock, [this]() { return queued_blocks.size() < max_queued_blocks; });
+    queued_blocks.push_back(std::move(current_block));
+    if (spare_blocks.empty())
+    {
+        current_block = std::vector<char>();
+    }
+    else
+    {
+        current_block = std::move(spare_blocks.back());
+        spare_blocks.pop_back();
+    }
+    lock.unlock();
+    queue_changed.notify_all();
+
+    current_block.resize(block_size);
+    setp(current_block.data(), current_block.data() + current_block.size());
+}
+
+bool AsyncOutputFile::Buffer::waitUntilWritten()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    queue_changed.wait(lock, [this]() { return queued_blocks.empty() && !is_writing; });
+    return !failed;
+}
+
+void AsyncOutputFile::Buffer::writeBlocks()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        queue_changed.wait(lock, [this]() { return !queued_blocks.empty() || stop; });
+        if (queued_blocks.empty()) //Stopping, and everything is written.
+        {
+            return;
+        }
+        std::vector<char> block = std::move(queued_blocks.front());
+        queued_blocks.pop_front();
+        is_writing = true;
+        lock.unlock();
+        queue_changed.notify_all(); //There is room in the queue again.
+
+        const bool success = compressor
+            ? compressor->write(block.data(), block.size(), Z_NO_FLUSH, file)
+            : std::fwrite(block.data(), 1, block.size(), file) == block.size();
+
+        lock.lock();
+        failed |= !success;
+        is_writing = false;
+        spare_blocks.push_back(std::move(block));
+        queue_changed.notify_all(); //For waitUntilWritten.
+    }
+}
+
+} //namespace cura
@@ -0,0 +1,182 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_ASYNC_OUTPUT_FILE_H
+#define UTILS_ASYNC_OUTPUT_FILE_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory> //For unique_ptr.
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Output stream to a file, which writes to the disk on a separate
+ * thread.
+ *
+ * The data is collected in large blocks. Full blocks are queued for a writer
+ * thread, so that the thread producing the data doesn't have to wait for a
+ * slow disk or network file system. Only a few blocks may be queued. If the
+ * disk can't keep up, the producing thread waits until a block has been
+ * written, so that the memory use stays bounded.
+ *
+ * Flushing the stream waits until everything written to it so far is in the
+ * file.
+ *
+ * Optionally, the data is compressed with gzip. This is done on the writer
+ * thread too, so the compression runs in parallel with producing the data.
+ */
+class AsyncOutputFile : public std::ostream, public NoCopy
+{
+public:
+    /*!
+     * Create a stream that is not connected to any file yet.
+     */
+    AsyncOutputFile();
+
+    /*!
+     * Writes all remaining data to the file before destroying the stream.
+     */
+    ~AsyncOutputFile();
+
+    /*!
+     * Open a file to write to, and start the writer thread.
+     *
+     * The file is truncated if it exists. If another file was open, it is
+     * closed first.
+     * \param filename The path to the file to write to.
+     * \param compress Whether to compress the data with gzip.
+     */
+    void open(const char* filename, const bool compress = false);
+
+    /*!
+     * Whether a file is opened to write to.
+     */
+    bool is_open() const;
+
+    /*!
+     * Write all remaining data to the file, stop the writer thread and close
+     * the file.
+     */
+    void close();
+
+    /*!
+     * Whether the data is compressed with gzip.
+     */
+    bool isCompressed() const;
+
+    /*!
+     * How many bytes were written to the stream since the file was opened.
+     *
+     * If the file is compressed, this counts the bytes before compression.
+     */
+    size_t getPosition() const;
+
+    /*!
+     * Replace data that was written to the file earlier.
+     *
+     * This waits until everything written so far is in the file, so it's only
+     * meant to be used a few times, such as to fill in a header when the rest
+     * of the file is known. Writing continues at the end of the file after.
+     *
+     * This is not possible if the file is compressed, or if it can't be
+     * seeked in, such as when writing to a pipe.
+     * \param position Where the data to replace starts, as given by
+     * \ref getPosition .
+     * \param data The data to write instead. It must not go past what was
+     * written to the file already.
+     * \return Whether the data was replaced.
+     */
+    bool overwrite(const size_t position, const std::string& data);
+
+private:
+    /*!
+     * The stream buffer that collects the data in blocks and hands those to
+     * the writer thread.
+     */
+    class Buffer : public std::streambuf
+    {
+    public:
+        Buffer();
+
+        ~Buffer();
+
+        bool open(const char* filename, const bool compress);
+
+        bool isOpen() const;
+
+        bool isCompressed() const;
+
+        /*!
+         * Write everything to the file and close it.
+         * \return Whether everything was written successfully.
+         */
+        bool close();
+
+        size_t getPosition() const;
+
+        bool overwrite(const size_t position, const std::string& data);
+
+    protected:
+        int_type overflow(int_type character) override;
+
+        std::streamsize xsputn(const char* data, std::streamsize count) override;
+
+        int sync() override;
+
+    private:
+        static constexpr size_t block_size = 1 << 20; //!< 1MB per block. Large enough that writing one is efficient.
+        static constexpr size_t max_queued_blocks = 4; //!< How many full blocks may wait for the writer thread.
+
+        /*!
+         * Queue the data in the current block for writing and start a new
+         * block. Waits if the queue is full.
+         */
+        void queueBlock();
+
+        /*!
+         * Wait until all queued blocks have been written.
+         * \return Whether all blocks were written successfully.
+         */
+        bool waitUntilWritten();
+
+        /*!
+         * The function that the writer thread runs until the file is closed.
+         */
+        void writeBlocks();
+
+        /*!
+         * Compresses the data before it's written to the file.
+         */
+        struct Compressor;
+
+        std::FILE* file; //!< The file to write to, or nullptr if no file is open.
+        std::unique_ptr<Compressor> compressor; //!< If the data is compressed, the state of the compression. Only used by the writer thread while it runs.
+        std::vector<char> current_block; //!< The block that is being filled by the producing thread.
+        size_t current_block_position; //!< How many bytes were written before the current block.
+        std::deque<std::vector<char>> queued_blocks; //!< Full blocks that need to be written, in order.
+        std::vector<std::vector<char>> spare_blocks; //!< Blocks that were written and can be filled again.
+        bool is_writing; //!< Whether the writer thread is busy writing a block that it took from the queue.
+        bool stop; //!< Whether the writer thread should stop once the queue is empty.
+        bool failed; //!< Whether writing any block failed.
+        std::mutex mutex; //!< Guards the queue, the spare blocks and the flags.
+        std::condition_variable queue_changed; //!< Notified whenever blocks are added to or taken from the queue.
+        std::thread writer; //!< The thread that writes the queued blocks to the file.
+    };
+
+    Buffer buffer; //!< Where everything written to this stream goes.
+};
+
+} //namespace cura
+
+#endif //UTILS_ASYNC_OUTPUT_FILE_H
@@ -0,0 +1,127 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For std::min and std::max.
+
+#include "BatchGeometry.h"
+#include "linearAlg2D.h"
+
+namespace cura
+{
+
+/*!
+ * How many line segments to compute the bounding box distances of at once in
+ * \ref BatchGeometry::findClosestOnPolygon. Small enough for the distances to
+ * stay on the stack, large enough to vectorise well.
+ */
+constexpr size_t closest_batch_size = 64;
+
+void BatchGeometry::applyMatrix(const PointMatrix& matrix, std::vector<Point>& points)
+{
+    const double m0 = matrix.matrix[0];
+    const double m1 = matrix.matrix[1];
+    const double m2 = matrix.matrix[2];
+    const double m3 = matrix.matrix[3];
+    Point* data = points.data();
+    const size_t size = points.size();
+    for (size_t point_idx = 0; point_idx < size; point_idx++)
+    {
+        //Both components are computed from the original point, and rounded towards zero, the same as PointMatrix::apply.
+        const double x = data[point_idx].X;
+        const double y = data[point_idx].Y;
+        data[point_idx].X = static_cast<coord_t>(x * m0 + y * m1);
+        data[point_idx].Y = static_cast<coord_t>(x * m2 + y * m3);
+    }
+}
+
+void BatchGeometry::includeInBoundingBox(const std::vector<Point>& points, Point& min, Point& max)
+{
+    //Separate variables for each component, so that the loop doesn't need to write the points back every iteration.
+    coord_t min_x = min.X;
+    coord_t min_y = min.Y;
+    coord_t max_x = max.X;
+    coord_t max_y = max.Y;
+    const Point* data = points.data();
+    const size_t size = points.size();
+    for (size_t point_idx = 0; point_idx < size; point_idx++)
+    {
+        min_x = std::min(min_x, data[point_idx].X);
+        min_y = std::min(min_y, data[point_idx].Y);
+        max_x = std::max(max_x, data[point_idx].X);
+        max_y = std::max(max_y, data[point_idx].Y);
+    }
+    min = Point(min_x, min_y);
+    max = Point(max_x, max_y);
+}
+
+void BatchGeometry::getDist2ToLineSegment(const std::vector<Point>& points, const Point a, const Point b, std::vector<coord_t>& dist2)
+{
+    dist2.resize(points.size());
+    const Point direction = b - a;
+    const coord_t length2 = vSize2(direction);
+    if (length2 == 0)
+    {
+        for (size_t point_idx = 0; point_idx < points.size(); point_idx++)
+        {
+            dist2[point_idx] = vSize2(points[point_idx] - a);
+        }
+        return;
+    }
+    for (size_t point_idx = 0; point_idx < points.size(); point_idx++)
+    {
+        //Clamping the projection to the line segment gives exactly the ends of the line segment at the extremes, so this needs no branches.
+        const coord_t projected = std::min(std::max(dot(points[point_idx] - a, direction), coord_t(0)), length2);
+        const Point closest = a + projected * direction / length2;
+        dist2[point_idx] = vSize2(points[point_idx] - closest);
+    }
+}
+
+size_t BatchGeometry::findClosestOnPolygon(const Point from, const std::vector<Point>& polygon, Point& closest)
+{
+    const size_t size = polygon.size();
+    closest = polygon[0];
+    coord_t best_dist2 = vSize2(from - closest);
+    size_t best_idx = 0;
+
+    coord_t box_dist2[closest_batch_size];
+    for (size_t batch_start = 0; batch_start < size; batch_start += closest_batch_size)
+    {
+        const size_t batch_end = std::min(batch_start + closest_batch_size, size);
+
+        //The closest point on a line segment is always within its bounding box, also after rounding, so the distance to the box is never more.
+        const auto get_box_dist2 = [&from](const Point& p0, const Point& p1)
+        {
+            const coord_t dx = std::max(std::max(std::min(p0.X, p1.X) - from.X, from.X - std::max(p0.X, p1.X)), coord_t(0));
+            const coord_t dy = std::max(std::max(std::min(p0.Y, p1.Y) - from.Y, from.Y - std::max(p0.Y, p1.Y)), coord_t(0));
+            return dx * dx + dy * dy;
+        };
+        const size_t unwrapped_end = std::min(batch_end, size - 1); //The last line segment goes back to the first vertex.
+        for (size_t point_idx = batch_start; point_idx < unwrapped_end; point_idx++)
+        {
+            box_dist2[point_idx - batch_start] = get_box_dist2(polygon[point_idx], polygon[point_idx + 1]);
+        }
+        if (unwrapped_end < batch_end)
+        {
+            box_dist2[unwrapped_end - batch_start] = get_box_dist2(polygon[size - 1], polygon[0]);
+        }
+
+        for (size_t point_idx = batch_start; point_idx < batch_end; point_idx++)
+        {
+            if (box_dist2[point_idx - batch_start] >= best_dist2)
+            {
+                continue; //Can't be strictly closer.
+            }
+            const Point closest_here = LinearAlg2D::getClosestOnLineSegment(from, polygon[point_idx], polygon[point_idx + 1 < size ? point_idx + 1 : 0]);
+            const coord_t dist2 = vSize2(from - closest_here);
+            if (dist2 < best_dist2)
+            {
+                closest = closest_here;
+                best_dist2 = dist2;
+                best_idx = point_idx;
+            }
+        }
+    }
+    return best_idx;
+}
+
+} //namespace cura
@@ -0,0 +1,70 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_BATCH_GEOMETRY_H
+#define UTILS_BATCH_GEOMETRY_H
+
+#include <vector>
+
+#include "IntPoint.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Geometry on many points at once.
+ *
+ * These give exactly the same results as applying the functions of
+ * \ref PointMatrix and \ref LinearAlg2D to each point, but run over contiguous
+ * arrays of points without branches in the inner loops, so that the compiler
+ * can vectorise them for the instruction set that it targets.
+ */
+class BatchGeometry
+{
+public:
+    /*!
+     * Apply a matrix to each point, like \ref PointMatrix::apply.
+     * \param matrix The matrix to apply.
+     * \param points The points to transform. They are changed in place.
+     */
+    static void applyMatrix(const PointMatrix& matrix, std::vector<Point>& points);
+
+    /*!
+     * Grow a bounding box to include all points.
+     * \param points The points to include.
+     * \param[in,out] min The minimum corner of the bounding box.
+     * \param[in,out] max The maximum corner of the bounding box.
+     */
+    static void includeInBoundingBox(const std::vector<Point>& points, Point& min, Point& max);
+
+    /*!
+     * Get the squared distance of each point to the closest point on a line
+     * segment, as given by \ref LinearAlg2D::getClosestOnLineSegment.
+     * \param points The points to get the distances of.
+     * \param a One end of the line segment.
+     * \param b The other end of the line segment.
+     * \param[out] dist2 The squared distances, one for each point.
+     */
+    static void getDist2ToLineSegment(const std::vector<Point>& points, const Point a, const Point b, std::vector<coord_t>& dist2);
+
+    /*!
+     * Find the closest point on the line segments of a closed polygon.
+     *
+     * Gives the same result as \ref PolygonUtils::findClosest without a
+     * penalty function: the first vertex, unless a line segment is strictly
+     * closer, in which case the first of the closest line segments.
+     *
+     * Line segments whose bounding box is further away than the closest point
+     * so far are skipped. The bounding boxes are computed in batches.
+     * \param from The point to find the closest point to.
+     * \param polygon The vertices of the polygon. It must not be empty.
+     * \param[out] closest The closest point on the polygon.
+     * \return The index of the vertex at the start of the line segment that
+     * the closest point is on.
+     */
+    static size_t findClosestOnPolygon(const Point from, const std::vector<Point>& polygon, Point& closest);
+};
+
+} //namespace cura
+
+#endif //UTILS_BATCH_GEOMETRY_H
@@ -0,0 +1,126 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_BOUNDED_CACHE_H
+#define UTILS_BOUNDED_CACHE_H
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <utility> //For pair.
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Remembers a limited number of values by their key. When it's full,
+ * the values that were added first are forgotten.
+ *
+ * The keys are looked up by a hash first, and then compared exactly by the
+ * user, since what is looked up is often in another form than what is stored,
+ * e.g. polygons that are stored in compact form. Several entries may have the
+ * same hash, or even the same key, if they were added at the same time by
+ * different threads.
+ *
+ * It is safe to use from multiple threads at once.
+ * \tparam Key What to store in each entry to compare with what is looked up.
+ * \tparam Value The value of each entry. It's copied out when it's found, so
+ * it should be cheap to copy, such as a shared pointer. A default constructed
+ * value means that nothing was found.
+ */
+template<typename Key, typename Value>
+class BoundedCache : public NoCopy
+{
+public:
+    /*!
+     * \param capacity The maximum number of entries to remember.
+     */
+    BoundedCache(const size_t capacity)
+    : capacity(capacity)
+    {
+    }
+
+    /*!
+     * \brief Find the value of an entry.
+     * \param hash The hash of the key to find.
+     * \param matches A function that tells whether the key of an entry with
+     * this hash is the one to find.
+     * \return The value of the first matching entry, or a default constructed
+     * value if none matches.
+     */
+    template<typename Matches>
+    Value find(const size_t hash, const Matches& matches) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto range = entries.equal_range(hash);
+        for (auto entry = range.first; entry != range.second; ++entry)
+        {
+            if (matches(entry->second.key))
+            {
+                return entry->second.value;
+            }
+        }
+        return Value();
+    }
+
+    /*!
+     * \brief Add an entry, forgetting the oldest entry if the cache is full.
+     * \param hash The hash of the key.
+     * \param key What to compare with later to find the entry.
+     * \param value The value of the entry.
+     */
+    void insert(const size_t hash, Key key, Value value)
+    {
+        if (capacity == 0)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (insertion_order.size() >= capacity)
+        {
+            const std::pair<size_t, size_t> oldest = insertion_order.front(); //Other entries may have the same hash, so find the exact one by its ID.
+            const auto range = entries.equal_range(oldest.first);
+            for (auto entry = range.first; entry != range.second; ++entry)
+            {
+                if (entry->second.id == oldest.second)
+                {
+                    entries.erase(entry);
+                    break;
+                }
+            }
+            insertion_order.pop_front();
+        }
+        entries.emplace(hash, Entry{std::move(key), std::move(value), next_id});
+        insertion_order.emplace_back(hash, next_id++);
+    }
+
+    /*!
+     * How many entries are remembered.
+     */
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+private:
+    struct Entry
+    {
+        Key key;
+        Value value;
+        size_t id; //!< Unique among the entries, to tell apart entries with the same hash.
+    };
+
+    const size_t capacity; //!< The maximum number of entries.
+    mutable std::mutex mutex; //!< Guards all entries.
+    std::unordered_multimap<size_t, Entry> entries; //!< The entries, by the hash of their key.
+    std::deque<std::pair<size_t, size_t>> insertion_order; //!< The hashes and IDs of the entries, in the order in which they were added.
+    size_t next_id = 0; //!< The ID of the next entry to add.
+};
+
+} //namespace cura
+
+#endif //UTILS_BOUNDED_CACHE_H
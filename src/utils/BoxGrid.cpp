@@ -0,0 +1,92 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For std::sort and std::unique.
+#include <cmath> //For std::sqrt.
+
+#include "BoxGrid.h"
+
+namespace cura
+{
+
+BoxGrid::BoxGrid()
+: SquareGrid(MM2INT(10)) //Doesn't matter, there is nothing to find.
+{
+}
+
+BoxGrid::BoxGrid(const std::vector<AABB>& boxes)
+: SquareGrid(getCellSize(boxes))
+, boxes(boxes)
+{
+    for (size_t box_idx = 0; box_idx < boxes.size(); box_idx++)
+    {
+        const AABB& box = boxes[box_idx];
+        total_box.include(box);
+        const GridPoint min_cell = toGridPoint(box.min);
+        const GridPoint max_cell = toGridPoint(box.max);
+        for (coord_t x = min_cell.X; x <= max_cell.X; x++)
+        {
+            for (coord_t y = min_cell.Y; y <= max_cell.Y; y++)
+            {
+                cells[GridPoint(x, y)].push_back(box_idx);
+            }
+        }
+    }
+}
+
+size_t BoxGrid::size() const
+{
+    return boxes.size();
+}
+
+std::vector<size_t> BoxGrid::getOverlapping(const AABB& box) const
+{
+    std::vector<size_t> result;
+    if (!total_box.hit(box))
+    {
+        return result;
+    }
+    //Only visit the cells that may contain any boxes, even if the area is much bigger.
+    const GridPoint min_cell = toGridPoint(Point(std::max(box.min.X, total_box.min.X), std::max(box.min.Y, total_box.min.Y)));
+    const GridPoint max_cell = toGridPoint(Point(std::min(box.max.X, total_box.max.X), std::min(box.max.Y, total_box.max.Y)));
+    for (coord_t x = min_cell.X; x <= max_cell.X; x++)
+    {
+        for (coord_t y = min_cell.Y; y <= max_cell.Y; y++)
+        {
+            const auto cell = cells.find(GridPoint(x, y));
+            if (cell == cells.end())
+            {
+                continue;
+            }
+            for (const size_t box_idx : cell->second)
+            {
+                if (boxes[box_idx].hit(box))
+                {
+                    result.push_back(box_idx);
+                }
+            }
+        }
+    }
+    //Boxes that span multiple cells are found multiple times.
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+coord_t BoxGrid::getCellSize(const std::vector<AABB>& boxes)
+{
+    if (boxes.empty())
+    {
+        return MM2INT(10); //Doesn't matter, there is nothing to find.
+    }
+    AABB total_box;
+    for (const AABB& box : boxes)
+    {
+        total_box.include(box);
+    }
+    const coord_t total_size = std::max(total_box.max.X - total_box.min.X, total_box.max.Y - total_box.min.Y);
+    constexpr coord_t minimum_cell_size = MM2INT(1); //Don't make tiny cells that large boxes would span a lot of.
+    return std::max(minimum_cell_size, total_size / static_cast<coord_t>(std::ceil(std::sqrt(boxes.size()))));
+}
+
+} //namespace cura
@@ -0,0 +1,68 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_BOX_GRID_H
+#define UTILS_BOX_GRID_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "AABB.h"
+#include "SquareGrid.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Grid over a list of bounding boxes, to find the boxes that may overlap
+ * with some area without checking all of them.
+ *
+ * The grid keeps a copy of the boxes, so it remains valid when the objects
+ * they belong to are moved, but not when those objects change.
+ */
+class BoxGrid : public SquareGrid
+{
+public:
+    /*!
+     * Create a grid without any boxes.
+     */
+    BoxGrid();
+
+    /*!
+     * Index a list of boxes.
+     *
+     * The cells are chosen such that the area around all boxes is divided in
+     * about as many cells as there are boxes.
+     * \param boxes The bounding boxes to index.
+     */
+    BoxGrid(const std::vector<AABB>& boxes);
+
+    /*!
+     * How many boxes are indexed.
+     */
+    size_t size() const;
+
+    /*!
+     * Find the boxes that overlap with a given bounding box, in the sense of
+     * \ref AABB::hit.
+     * \param box The bounding box to find the overlapping boxes of.
+     * \return The indices of those boxes in the list that the grid was created
+     * with, in increasing order.
+     */
+    std::vector<size_t> getOverlapping(const AABB& box) const;
+
+private:
+    /*!
+     * Choose a cell size such that the area around all boxes is divided in
+     * about as many cells as there are boxes.
+     */
+    static coord_t getCellSize(const std::vector<AABB>& boxes);
+
+    std::vector<AABB> boxes; //!< The boxes that are indexed.
+    AABB total_box; //!< The bounding box around all indexed boxes.
+    std::unordered_map<GridPoint, std::vector<size_t>> cells; //!< The boxes that overlap with each cell.
+};
+
+} //namespace cura
+
+#endif //UTILS_BOX_GRID_H
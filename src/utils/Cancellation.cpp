@@ -0,0 +1,16 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "Cancellation.h"
+
+namespace cura
+{
+
+std::atomic<bool> Cancellation::requested(false);
+
+void Cancellation::reset()
+{
+    requested.store(false, std::memory_order_relaxed);
+}
+
+} //namespace cura
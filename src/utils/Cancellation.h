@@ -0,0 +1,53 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_CANCELLATION_H
+#define UTILS_CANCELLATION_H
+
+#include <atomic>
+
+namespace cura
+{
+
+/*!
+ * \brief Lets the slice that is running stop early, because nobody is waiting
+ * for its result any more.
+ *
+ * The communication requests this from whatever thread it notices it on, for
+ * instance when the front-end sends a new slice while the old one is running.
+ * The stages check it once per layer or per part: parallel loops skip the
+ * remaining iterations, and the stages return as soon as their loops are done.
+ * What was generated up to then is incomplete, so it must not be written.
+ */
+class Cancellation
+{
+public:
+    /*!
+     * Ask the running slice to stop. May be called from any thread.
+     */
+    static void request()
+    {
+        requested.store(true, std::memory_order_relaxed);
+    }
+
+    /*!
+     * Whether the running slice should stop. This is cheap enough to check
+     * for every layer.
+     */
+    static bool isRequested()
+    {
+        return requested.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     * Forget earlier requests, before starting a new slice.
+     */
+    static void reset();
+
+private:
+    static std::atomic<bool> requested; //!< Whether the running slice should stop.
+};
+
+} //namespace cura
+
+#endif //UTILS_CANCELLATION_H
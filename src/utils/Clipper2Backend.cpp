@@ -0,0 +1,124 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <clipper2/clipper.h>
+
+#include "Clipper2Backend.h"
+
+namespace cura
+{
+
+namespace clipper2
+{
+
+namespace
+{
+
+Clipper2Lib::Paths64 toClipper2(const ClipperLib::Paths& paths)
+{
+    Clipper2Lib::Paths64 result;
+    result.reserve(paths.size());
+    for (const ClipperLib::Path& path : paths)
+    {
+        result.emplace_back();
+        Clipper2Lib::Path64& converted = result.back();
+        converted.reserve(path.size());
+        for (const ClipperLib::IntPoint& point : path)
+        {
+            converted.emplace_back(point.X, point.Y);
+        }
+    }
+    return result;
+}
+
+ClipperLib::Paths fromClipper2(const Clipper2Lib::Paths64& paths)
+{
+    ClipperLib::Paths result;
+    result.reserve(paths.size());
+    for (const Clipper2Lib::Path64& path : paths)
+    {
+        result.emplace_back();
+        ClipperLib::Path& converted = result.back();
+        converted.reserve(path.size());
+        for (const Clipper2Lib::Point64& point : path)
+        {
+            converted.emplace_back(point.x, point.y);
+        }
+    }
+    return result;
+}
+
+Clipper2Lib::FillRule toClipper2(const ClipperLib::PolyFillType fill_type)
+{
+    switch (fill_type)
+    {
+        case ClipperLib::pftEvenOdd:
+            return Clipper2Lib::FillRule::EvenOdd;
+        case ClipperLib::pftNonZero:
+            return Clipper2Lib::FillRule::NonZero;
+        case ClipperLib::pftPositive:
+            return Clipper2Lib::FillRule::Positive;
+        case ClipperLib::pftNegative:
+        default:
+            return Clipper2Lib::FillRule::Negative;
+    }
+}
+
+Clipper2Lib::JoinType toClipper2(const ClipperLib::JoinType join_type)
+{
+    switch (join_type)
+    {
+        case ClipperLib::jtSquare:
+            return Clipper2Lib::JoinType::Square;
+        case ClipperLib::jtRound:
+            return Clipper2Lib::JoinType::Round;
+        case ClipperLib::jtMiter:
+        default:
+            return Clipper2Lib::JoinType::Miter;
+    }
+}
+
+} //Anonymous namespace.
+
+ClipperLib::Paths difference(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip)
+{
+    return fromClipper2(Clipper2Lib::Difference(toClipper2(subject), toClipper2(clip), Clipper2Lib::FillRule::EvenOdd));
+}
+
+ClipperLib::Paths intersection(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip)
+{
+    return fromClipper2(Clipper2Lib::Intersect(toClipper2(subject), toClipper2(clip), Clipper2Lib::FillRule::EvenOdd));
+}
+
+ClipperLib::Paths unionPaths(const ClipperLib::Paths& subject, const ClipperLib::Paths& other, const ClipperLib::PolyFillType fill_type)
+{
+    //ClipperLib adds both areas as subject, so that they are filled with the same rule together.
+    Clipper2Lib::Paths64 all = toClipper2(subject);
+    Clipper2Lib::Paths64 converted_other = toClipper2(other);
+    all.insert(all.end(), converted_other.begin(), converted_other.end());
+    return fromClipper2(Clipper2Lib::Union(all, toClipper2(fill_type)));
+}
+
+ClipperLib::Paths offset(const ClipperLib::Paths& paths, const double distance, const ClipperLib::JoinType join_type, const double miter_limit, const double arc_tolerance)
+{
+    Clipper2Lib::ClipperOffset clipper(miter_limit, arc_tolerance);
+    clipper.AddPaths(toClipper2(paths), toClipper2(join_type), Clipper2Lib::EndType::Polygon);
+    Clipper2Lib::Paths64 result;
+    clipper.Execute(distance, result);
+    return fromClipper2(result);
+}
+
+ClipperLib::Paths intersectionOpenPaths(const ClipperLib::Paths& polylines, const ClipperLib::Paths& area)
+{
+    Clipper2Lib::Clipper64 clipper;
+    clipper.AddOpenSubject(toClipper2(polylines));
+    clipper.AddClip(toClipper2(area));
+    Clipper2Lib::Paths64 closed_result; //Stays empty, since there are no closed subjects.
+    Clipper2Lib::Paths64 open_result;
+    clipper.Execute(Clipper2Lib::ClipType::Intersection, Clipper2Lib::FillRule::EvenOdd, closed_result, open_result);
+    return fromClipper2(open_result);
+}
+
+} //namespace clipper2
+
+} //namespace cura
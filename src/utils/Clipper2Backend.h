@@ -0,0 +1,76 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_CLIPPER2_BACKEND_H
+#define UTILS_CLIPPER2_BACKEND_H
+
+#include <polyclipping/clipper.hpp>
+
+namespace cura
+{
+
+/*!
+ * \brief The polygon operations of Polygons, performed by Clipper2 instead of
+ * ClipperLib.
+ *
+ * This is only compiled if CuraEngine is built with the USE_CLIPPER2 option.
+ * The operations take and return the same ClipperLib paths that Polygons
+ * stores, and use the same fill rules as the ClipperLib operations they
+ * replace, so the results are interchangeable up to rounding and the order of
+ * the polygons.
+ */
+namespace clipper2
+{
+
+/*!
+ * Subtract one area from another, using the even-odd fill rule.
+ * \param subject The area to subtract from.
+ * \param clip The area to subtract.
+ * \return The area of \p subject that is not inside \p clip.
+ */
+ClipperLib::Paths difference(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip);
+
+/*!
+ * Intersect two areas, using the even-odd fill rule.
+ * \param subject One of the areas.
+ * \param clip The other area.
+ * \return The area that is inside both \p subject and \p clip.
+ */
+ClipperLib::Paths intersection(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip);
+
+/*!
+ * Unite two areas.
+ * \param subject One of the areas.
+ * \param other The other area.
+ * \param fill_type The fill rule to apply to both areas.
+ * \return The area that is inside either \p subject or \p other.
+ */
+ClipperLib::Paths unionPaths(const ClipperLib::Paths& subject, const ClipperLib::Paths& other, const ClipperLib::PolyFillType fill_type);
+
+/*!
+ * Offset closed polygons.
+ * \param paths The polygons to offset. These must not overlap.
+ * \param distance How far to offset. Negative values shrink the area.
+ * \param join_type How to join the offset edges at the corners.
+ * \param miter_limit How far a mitered corner may extend, as multiple of the
+ * offset distance.
+ * \param arc_tolerance The maximum deviation of rounded corners from a real
+ * arc.
+ * \return The offset polygons.
+ */
+ClipperLib::Paths offset(const ClipperLib::Paths& paths, const double distance, const ClipperLib::JoinType join_type, const double miter_limit, const double arc_tolerance);
+
+/*!
+ * Cut open polylines to the part that is inside an area, using the even-odd
+ * fill rule.
+ * \param polylines The polylines to cut.
+ * \param area The area to keep the polylines inside of.
+ * \return The pieces of \p polylines that are inside \p area.
+ */
+ClipperLib::Paths intersectionOpenPaths(const ClipperLib::Paths& polylines, const ClipperLib::Paths& area);
+
+} //namespace clipper2
+
+} //namespace cura
+
+#endif //UTILS_CLIPPER2_BACKEND_H
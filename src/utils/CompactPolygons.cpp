@@ -0,0 +1,114 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For std::min and std::max.
+#include <limits>
+
+#include "CompactPolygons.h"
+
+namespace cura
+{
+
+bool CompactPolygons::compact(const Polygons& polygons)
+{
+    clear();
+
+    //Check whether everything fits before storing anything.
+    size_t vertex_count = 0;
+    Point min(std::numeric_limits<coord_t>::max(), std::numeric_limits<coord_t>::max());
+    Point max(std::numeric_limits<coord_t>::min(), std::numeric_limits<coord_t>::min());
+    for (ConstPolygonRef polygon : polygons)
+    {
+        vertex_count += polygon.size();
+        for (const Point& point : polygon)
+        {
+            min.X = std::min(min.X, point.X);
+            min.Y = std::min(min.Y, point.Y);
+            max.X = std::max(max.X, point.X);
+            max.Y = std::max(max.Y, point.Y);
+        }
+    }
+    if (vertex_count > std::numeric_limits<uint32_t>::max()
+        || (vertex_count > 0 && (max.X - min.X > std::numeric_limits<uint32_t>::max() || max.Y - min.Y > std::numeric_limits<uint32_t>::max())))
+    {
+        return false;
+    }
+
+    origin = (vertex_count > 0) ? min : Point(0, 0);
+    polygon_ends.reserve(polygons.size());
+    vertices.reserve(vertex_count);
+    for (ConstPolygonRef polygon : polygons)
+    {
+        for (const Point& point : polygon)
+        {
+            vertices.push_back(Vertex{ static_cast<uint32_t>(point.X - origin.X), static_cast<uint32_t>(point.Y - origin.Y) });
+        }
+        polygon_ends.push_back(vertices.size());
+    }
+    return true;
+}
+
+Polygons CompactPolygons::expand() const
+{
+    Polygons result;
+    size_t vertex_idx = 0;
+    for (const uint32_t polygon_end : polygon_ends)
+    {
+        PolygonRef polygon = result.newPoly();
+        polygon.reserve(polygon_end - vertex_idx);
+        for (; vertex_idx < polygon_end; vertex_idx++)
+        {
+            polygon.emplace_back(origin.X + vertices[vertex_idx].x, origin.Y + vertices[vertex_idx].y);
+        }
+    }
+    return result;
+}
+
+bool CompactPolygons::isSame(const Polygons& polygons) const
+{
+    if (polygons.size() != polygon_ends.size())
+    {
+        return false;
+    }
+    size_t vertex_idx = 0;
+    for (size_t poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+    {
+        ConstPolygonRef polygon = polygons[poly_idx];
+        if (polygon.size() != polygon_ends[poly_idx] - vertex_idx)
+        {
+            return false;
+        }
+        for (const Point& point : polygon)
+        {
+            const Vertex& vertex = vertices[vertex_idx++];
+            if (point.X != origin.X + vertex.x || point.Y != origin.Y + vertex.y)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+size_t CompactPolygons::size() const
+{
+    return polygon_ends.size();
+}
+
+bool CompactPolygons::empty() const
+{
+    return polygon_ends.empty();
+}
+
+void CompactPolygons::clear()
+{
+    polygon_ends = std::vector<uint32_t>();
+    vertices = std::vector<Vertex>();
+}
+
+size_t CompactPolygons::getMemoryUsage() const
+{
+    return polygon_ends.capacity() * sizeof(uint32_t) + vertices.capacity() * sizeof(Vertex);
+}
+
+} //namespace cura
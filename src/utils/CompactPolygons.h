@@ -0,0 +1,90 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_COMPACT_POLYGONS_H
+#define UTILS_COMPACT_POLYGONS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "polygon.h"
+
+namespace cura
+{
+
+/*!
+ * \brief A compact copy of a set of polygons, for polygons that are stored for
+ * a long time.
+ *
+ * Polygons store their vertices as 64-bit coordinates, but the geometry of one
+ * layer spans no more than a few metres. This stores the vertices of all
+ * polygons in one flat array, as 32-bit offsets from the minimum corner of the
+ * polygons. That halves the memory and keeps the vertices together for scans
+ * over all of them.
+ *
+ * Compacting is lossless. Polygons that don't fit in 32 bits are not compacted
+ * at all.
+ */
+class CompactPolygons
+{
+public:
+    /*!
+     * Store a compact copy of a set of polygons. Anything that was stored
+     * before is replaced.
+     * \param polygons The polygons to store.
+     * \return Whether the polygons fit in the compact representation. If not,
+     * nothing is stored.
+     */
+    bool compact(const Polygons& polygons);
+
+    /*!
+     * Decode the stored polygons.
+     * \return The polygons, exactly as they were compacted.
+     */
+    Polygons expand() const;
+
+    /*!
+     * Whether the stored polygons have exactly the same vertices as a set of
+     * polygons, in the same order. This doesn't need to decode them.
+     * \param polygons The polygons to compare with.
+     */
+    bool isSame(const Polygons& polygons) const;
+
+    /*!
+     * The number of polygons that are stored.
+     */
+    size_t size() const;
+
+    /*!
+     * Whether there are no polygons stored.
+     */
+    bool empty() const;
+
+    /*!
+     * Remove all stored polygons and release their memory.
+     */
+    void clear();
+
+    /*!
+     * How much memory the stored polygons take, in bytes.
+     */
+    size_t getMemoryUsage() const;
+
+private:
+    /*!
+     * A vertex, relative to the origin.
+     */
+    struct Vertex
+    {
+        uint32_t x;
+        uint32_t y;
+    };
+
+    Point origin; //!< The minimum corner of all vertices, which their coordinates are relative to.
+    std::vector<uint32_t> polygon_ends; //!< For each polygon, one past the index of its last vertex.
+    std::vector<Vertex> vertices; //!< All vertices of all polygons.
+};
+
+} //namespace cura
+
+#endif //UTILS_COMPACT_POLYGONS_H
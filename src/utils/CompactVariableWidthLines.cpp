@@ -0,0 +1,186 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For std::min and std::max.
+#include <cstring> //For memcpy.
+#include <limits>
+
+#include "CompactVariableWidthLines.h"
+
+namespace cura
+{
+
+CompactVariableWidthLines::CompactVariableWidthLines(std::pmr::memory_resource* memory)
+: origin(0, 0)
+, inset_lines_end(memory)
+, lines(memory)
+, junctions(memory)
+{
+}
+
+bool CompactVariableWidthLines::compact(const std::vector<VariableWidthLines>& toolpaths)
+{
+    clear();
+
+    //Check whether everything fits before storing anything.
+    Point min(std::numeric_limits<coord_t>::max(), std::numeric_limits<coord_t>::max());
+    Point max(std::numeric_limits<coord_t>::min(), std::numeric_limits<coord_t>::min());
+    size_t line_count = 0;
+    size_t junction_count = 0;
+    for (const VariableWidthLines& inset : toolpaths)
+    {
+        line_count += inset.size();
+        for (const ExtrusionLine& line : inset)
+        {
+            junction_count += line.size();
+            for (const ExtrusionJunction& junction : line)
+            {
+                if (junction.w < 0 || junction.w > std::numeric_limits<uint16_t>::max() || junction.perimeter_index > std::numeric_limits<uint16_t>::max())
+                {
+                    return false;
+                }
+                min.X = std::min(min.X, junction.p.X);
+                min.Y = std::min(min.Y, junction.p.Y);
+                max.X = std::max(max.X, junction.p.X);
+                max.Y = std::max(max.Y, junction.p.Y);
+            }
+        }
+    }
+    if (junction_count > 0 && (max.X - min.X > std::numeric_limits<uint32_t>::max() || max.Y - min.Y > std::numeric_limits<uint32_t>::max()))
+    {
+        return false;
+    }
+
+    origin = (junction_count > 0) ? min : Point(0, 0);
+    inset_lines_end.reserve(toolpaths.size());
+    lines.reserve(line_count);
+    junctions.reserve(junction_count);
+    for (const VariableWidthLines& inset : toolpaths)
+    {
+        for (const ExtrusionLine& line : inset)
+        {
+            for (const ExtrusionJunction& junction : line)
+            {
+                junctions.push_back(Junction{ static_cast<uint32_t>(junction.p.X - origin.X), static_cast<uint32_t>(junction.p.Y - origin.Y),
+                    static_cast<uint16_t>(junction.w), static_cast<uint16_t>(junction.perimeter_index) });
+            }
+            lines.push_back(Line{ line.inset_idx, junctions.size(), line.is_odd, line.is_closed });
+        }
+        inset_lines_end.push_back(lines.size());
+    }
+    return true;
+}
+
+std::vector<VariableWidthLines> CompactVariableWidthLines::expand() const
+{
+    std::vector<VariableWidthLines> toolpaths;
+    toolpaths.reserve(inset_lines_end.size());
+    size_t line_idx = 0;
+    size_t junction_idx = 0;
+    for (const size_t lines_end : inset_lines_end)
+    {
+        toolpaths.emplace_back();
+        VariableWidthLines& inset = toolpaths.back();
+        inset.reserve(lines_end - line_idx);
+        for (; line_idx < lines_end; line_idx++)
+        {
+            const Line& line = lines[line_idx];
+            inset.emplace_back(line.inset_idx, line.is_odd);
+            ExtrusionLine& result = inset.back();
+            result.is_closed = line.is_closed;
+            result.junctions.reserve(line.junctions_end - junction_idx);
+            for (; junction_idx < line.junctions_end; junction_idx++)
+            {
+                const Junction& junction = junctions[junction_idx];
+                result.junctions.emplace_back(origin + Point(junction.x, junction.y), junction.w, junction.perimeter_index);
+            }
+        }
+    }
+    return toolpaths;
+}
+
+size_t CompactVariableWidthLines::size() const
+{
+    return inset_lines_end.size();
+}
+
+bool CompactVariableWidthLines::empty() const
+{
+    return inset_lines_end.empty();
+}
+
+void CompactVariableWidthLines::clear()
+{
+    //Replace by empty arrays from the same memory resource, so that the memory is actually given back to it.
+    inset_lines_end = std::pmr::vector<size_t>(inset_lines_end.get_allocator());
+    lines = std::pmr::vector<Line>(lines.get_allocator());
+    junctions = std::pmr::vector<Junction>(junctions.get_allocator());
+}
+
+size_t CompactVariableWidthLines::getMemoryUsage() const
+{
+    return inset_lines_end.capacity() * sizeof(size_t) + lines.capacity() * sizeof(Line) + junctions.capacity() * sizeof(Junction);
+}
+
+namespace
+{
+
+/*!
+ * Append the raw bytes of an array to a buffer.
+ */
+template<typename T>
+void appendBytes(std::vector<char>& buffer, const T* elements, const size_t count)
+{
+    const char* bytes = reinterpret_cast<const char*>(elements);
+    buffer.insert(buffer.end(), bytes, bytes + count * sizeof(T));
+}
+
+/*!
+ * Copy the raw bytes of an array out of a buffer, and advance past them.
+ */
+template<typename T>
+void readBytes(const char*& data, T* elements, const size_t count)
+{
+    std::memcpy(elements, data, count * sizeof(T));
+    data += count * sizeof(T);
+}
+
+} //Anonymous namespace.
+
+void CompactVariableWidthLines::serialize(std::vector<char>& buffer) const
+{
+    const uint64_t counts[3] = { inset_lines_end.size(), lines.size(), junctions.size() };
+    buffer.reserve(buffer.size() + sizeof(origin) + sizeof(counts) + getMemoryUsage());
+    appendBytes(buffer, &origin, 1);
+    appendBytes(buffer, counts, 3);
+    appendBytes(buffer, inset_lines_end.data(), inset_lines_end.size());
+    appendBytes(buffer, lines.data(), lines.size());
+    appendBytes(buffer, junctions.data(), junctions.size());
+}
+
+bool CompactVariableWidthLines::deserialize(const char* data, const size_t size)
+{
+    clear();
+    uint64_t counts[3];
+    constexpr size_t header_size = sizeof(origin) + sizeof(counts);
+    if (size < header_size)
+    {
+        return false;
+    }
+    std::memcpy(counts, data + sizeof(origin), sizeof(counts));
+    if (size != header_size + counts[0] * sizeof(size_t) + counts[1] * sizeof(Line) + counts[2] * sizeof(Junction))
+    {
+        return false;
+    }
+    readBytes(data, &origin, 1);
+    data += sizeof(counts);
+    inset_lines_end.resize(counts[0]);
+    readBytes(data, inset_lines_end.data(), inset_lines_end.size());
+    lines.resize(counts[1]);
+    readBytes(data, lines.data(), lines.size());
+    junctions.resize(counts[2]);
+    readBytes(data, junctions.data(), junctions.size());
+    return true;
+}
+
+} //namespace cura
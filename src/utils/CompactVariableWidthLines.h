@@ -0,0 +1,122 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_COMPACT_VARIABLE_WIDTH_LINES_H
+#define UTILS_COMPACT_VARIABLE_WIDTH_LINES_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "ExtrusionLine.h"
+
+namespace cura
+{
+
+/*!
+ * \brief A compact copy of the toolpaths of a set of walls, binned by inset.
+ *
+ * The toolpaths of the walls are kept for every layer until the g-code is
+ * written, which takes a lot of memory for large prints. This stores them in a
+ * few flat arrays. The coordinates of the junctions are stored as 32-bit
+ * offsets from the minimum corner of the toolpaths, and the widths and
+ * perimeter indices as 16-bit numbers.
+ *
+ * Compacting is lossless. Toolpaths that don't fit in that range are not
+ * compacted at all.
+ *
+ * The arrays are allocated from a memory resource, so that the toolpaths of a
+ * whole layer can be freed at once.
+ */
+class CompactVariableWidthLines
+{
+public:
+    /*!
+     * Create an empty set of toolpaths.
+     * \param memory Where to allocate the arrays. It must outlive this object.
+     */
+    explicit CompactVariableWidthLines(std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+    /*!
+     * Store a compact copy of a set of toolpaths. Anything that was stored
+     * before is replaced.
+     * \param toolpaths The toolpaths to store, binned by inset.
+     * \return Whether the toolpaths fit in the compact representation. If
+     * not, nothing is stored.
+     */
+    bool compact(const std::vector<VariableWidthLines>& toolpaths);
+
+    /*!
+     * Decode the stored toolpaths.
+     * \return The toolpaths, exactly as they were compacted.
+     */
+    std::vector<VariableWidthLines> expand() const;
+
+    /*!
+     * The number of insets that are stored.
+     */
+    size_t size() const;
+
+    /*!
+     * Whether there are no insets stored.
+     */
+    bool empty() const;
+
+    /*!
+     * Remove all stored toolpaths and release their memory.
+     */
+    void clear();
+
+    /*!
+     * How much memory the stored toolpaths take, in bytes.
+     */
+    size_t getMemoryUsage() const;
+
+    /*!
+     * Append the stored toolpaths to a buffer in binary form, to be restored
+     * with \ref deserialize in the same process.
+     * \param buffer The buffer to append to.
+     */
+    void serialize(std::vector<char>& buffer) const;
+
+    /*!
+     * Replace the stored toolpaths with ones that were serialized before.
+     * \param data The start of the binary form.
+     * \param size The length of the binary form, in bytes.
+     * \return Whether the data had the right length. If not, nothing is
+     * stored.
+     */
+    bool deserialize(const char* data, const size_t size);
+
+private:
+    /*!
+     * A junction, relative to the origin.
+     */
+    struct Junction
+    {
+        uint32_t x;
+        uint32_t y;
+        uint16_t w;
+        uint16_t perimeter_index;
+    };
+
+    /*!
+     * The properties of an ExtrusionLine, and where its junctions end.
+     */
+    struct Line
+    {
+        size_t inset_idx;
+        size_t junctions_end; //!< One past the index of the last junction of this line.
+        bool is_odd;
+        bool is_closed;
+    };
+
+    Point origin; //!< The minimum corner of all junctions, which their coordinates are relative to.
+    std::pmr::vector<size_t> inset_lines_end; //!< For each inset, one past the index of its last line.
+    std::pmr::vector<Line> lines; //!< All lines of all insets.
+    std::pmr::vector<Junction> junctions; //!< All junctions of all lines.
+};
+
+} //namespace cura
+
+#endif //UTILS_COMPACT_VARIABLE_WIDTH_LINES_H
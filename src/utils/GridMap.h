@@ -0,0 +1,391 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_GRID_MAP_H
+#define UTILS_GRID_MAP_H
+
+#include <algorithm> //For std::min.
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <utility> //For std::pair.
+#include <vector>
+
+#include "SquareGrid.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Storage for the elements of a \ref SparseGrid, in flat arrays.
+ *
+ * The elements are stored in one vector, in the order in which they were
+ * inserted. The cells are in a hash table with open addressing (linear
+ * probing), which holds for each cell the first and last element in it. The
+ * elements of a cell are chained by their index. Looking up a cell and walking
+ * through its elements therefore only touches a few contiguous arrays, instead
+ * of following pointers between nodes that were allocated separately.
+ *
+ * The elements of a cell are visited in the order in which they were
+ * inserted.
+ *
+ * \tparam ElemT The element type to store.
+ */
+template<class ElemT>
+class FlatGridMap
+{
+public:
+    using GridPoint = SquareGrid::GridPoint;
+    using value_type = std::pair<GridPoint, ElemT>;
+    using iterator = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    FlatGridMap()
+    : cell_count(0)
+    , max_load(max_allowed_load)
+    {
+    }
+
+    iterator begin()
+    {
+        return entries.begin();
+    }
+
+    iterator end()
+    {
+        return entries.end();
+    }
+
+    const_iterator begin() const
+    {
+        return entries.begin();
+    }
+
+    const_iterator end() const
+    {
+        return entries.end();
+    }
+
+    /*!
+     * The number of elements, counting an element once for each cell that it
+     * was inserted in.
+     */
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+    /*!
+     * Set the maximum fraction of the hash table that may be occupied by
+     * cells before it grows.
+     *
+     * Open addressing needs free slots to stay fast, so this is capped to 3/4.
+     */
+    void max_load_factor(const float load_factor)
+    {
+        max_load = std::min(load_factor, max_allowed_load);
+    }
+
+    /*!
+     * Reserve space for a number of elements, and for as many cells.
+     */
+    void reserve(const size_t elem_count)
+    {
+        entries.reserve(elem_count);
+        next_in_cell.reserve(elem_count);
+        if (elem_count > slots.size() * max_load)
+        {
+            rehash(static_cast<size_t>(elem_count / max_load) + 1);
+        }
+    }
+
+    /*!
+     * Add an element to a cell.
+     * \param cell The cell to add the element to.
+     * \param elem The element to add.
+     */
+    void emplace(const GridPoint& cell, const ElemT& elem)
+    {
+        if (cell_count + 1 > slots.size() * max_load)
+        {
+            rehash(std::max(min_slot_count, slots.size() * 2));
+        }
+        const size_t entry_idx = entries.size();
+        entries.emplace_back(cell, elem);
+        next_in_cell.push_back(no_entry);
+
+        Slot& slot = slots[findSlot(cell)];
+        if (slot.first == no_entry)
+        {
+            slot.cell = cell;
+            slot.first = entry_idx;
+            cell_count++;
+        }
+        else
+        {
+            next_in_cell[slot.last] = entry_idx;
+        }
+        slot.last = entry_idx;
+    }
+
+    /*!
+     * Add many elements at once.
+     *
+     * If the map is still empty, the elements are grouped by cell with a
+     * counting sort, so that the elements of each cell are stored next to each
+     * other. Afterwards, more elements can still be added one by one.
+     * \param cell_elems The elements to add, with the cell to add each to.
+     */
+    void emplaceAll(const std::vector<value_type>& cell_elems)
+    {
+        if (!entries.empty())
+        {
+            for (const value_type& cell_elem : cell_elems)
+            {
+                emplace(cell_elem.first, cell_elem.second);
+            }
+            return;
+        }
+
+        //Count the elements per cell. Until the elements are placed, Slot::last holds that count.
+        rehash(static_cast<size_t>(cell_elems.size() / max_load) + 1); //At most one cell per element.
+        std::vector<size_t> slot_per_elem;
+        slot_per_elem.reserve(cell_elems.size());
+        std::vector<size_t> slots_in_order; //In the order in which their cells first appear.
+        for (const value_type& cell_elem : cell_elems)
+        {
+            const size_t slot_idx = findSlot(cell_elem.first);
+            Slot& slot = slots[slot_idx];
+            if (slot.first == no_entry)
+            {
+                slot.cell = cell_elem.first;
+                slot.first = 0;
+                slot.last = 0;
+                slots_in_order.push_back(slot_idx);
+            }
+            slot.last++;
+            slot_per_elem.push_back(slot_idx);
+        }
+        cell_count = slots_in_order.size();
+
+        //Give each cell a contiguous range. Slot::last becomes the position to place the next element of the cell at.
+        size_t range_start = 0;
+        for (const size_t slot_idx : slots_in_order)
+        {
+            Slot& slot = slots[slot_idx];
+            const size_t count = slot.last;
+            slot.first = range_start;
+            slot.last = range_start;
+            range_start += count;
+        }
+        std::vector<size_t> order(cell_elems.size());
+        for (size_t elem_idx = 0; elem_idx < cell_elems.size(); elem_idx++)
+        {
+            order[slots[slot_per_elem[elem_idx]].last++] = elem_idx; //Stable, so each cell keeps the order of the input.
+        }
+
+        entries.reserve(cell_elems.size());
+        for (const size_t elem_idx : order)
+        {
+            entries.push_back(cell_elems[elem_idx]);
+        }
+        next_in_cell.resize(cell_elems.size());
+        for (size_t entry_idx = 0; entry_idx < next_in_cell.size(); entry_idx++)
+        {
+            next_in_cell[entry_idx] = entry_idx + 1;
+        }
+        for (const size_t slot_idx : slots_in_order)
+        {
+            Slot& slot = slots[slot_idx];
+            slot.last--; //Was one past the end of the range.
+            next_in_cell[slot.last] = no_entry;
+        }
+    }
+
+    /*!
+     * Process the elements in a cell, in the order in which they were
+     * inserted.
+     * \param cell The cell to process the elements of.
+     * \param process_func Processes each element. Processing stops if this
+     * returns false.
+     * \return Whether processing may continue, i.e. false if the processing
+     * function returned false for any element.
+     */
+    bool processCell(const GridPoint& cell, const std::function<bool (const ElemT&)>& process_func) const
+    {
+        if (slots.empty())
+        {
+            return true;
+        }
+        for (size_t entry_idx = slots[findSlot(cell)].first; entry_idx != no_entry; entry_idx = next_in_cell[entry_idx])
+        {
+            if (!process_func(entries[entry_idx].second))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t no_entry = std::numeric_limits<size_t>::max(); //!< Marks the end of a chain, or an empty slot.
+    static constexpr size_t min_slot_count = 16;
+    static constexpr float max_allowed_load = 0.75f;
+
+    /*!
+     * A cell in the hash table.
+     */
+    struct Slot
+    {
+        GridPoint cell; //!< The coordinates of the cell, if the slot is in use.
+        size_t first; //!< The first element in the cell, or no_entry if the slot is free.
+        size_t last; //!< The last element in the cell, where new elements are chained to.
+    };
+
+    /*!
+     * Find the slot of a cell, or the free slot where it would go.
+     *
+     * There must be at least one free slot.
+     */
+    size_t findSlot(const GridPoint& cell) const
+    {
+        const size_t mask = slots.size() - 1; //The number of slots is a power of two.
+        for (size_t slot_idx = hashCell(cell) & mask; ; slot_idx = (slot_idx + 1) & mask)
+        {
+            const Slot& slot = slots[slot_idx];
+            if (slot.first == no_entry || slot.cell == cell)
+            {
+                return slot_idx;
+            }
+        }
+    }
+
+    /*!
+     * Rebuild the hash table with at least a certain number of slots.
+     */
+    void rehash(const size_t min_slots)
+    {
+        size_t slot_count = min_slot_count;
+        while (slot_count < min_slots)
+        {
+            slot_count *= 2;
+        }
+        std::vector<Slot> old_slots(slot_count, Slot{ GridPoint(0, 0), no_entry, no_entry });
+        std::swap(slots, old_slots);
+        for (const Slot& slot : old_slots)
+        {
+            if (slot.first != no_entry)
+            {
+                slots[findSlot(slot.cell)] = slot;
+            }
+        }
+    }
+
+    /*!
+     * Mix both coordinates of a cell into a hash, of which the lowest bits are
+     * used to select the slot.
+     */
+    static size_t hashCell(const GridPoint& cell)
+    {
+        uint64_t hash = static_cast<uint64_t>(cell.X) * 0x9E3779B97F4A7C15ull;
+        hash ^= static_cast<uint64_t>(cell.Y) * 0xC2B2AE3D27D4EB4Full;
+        hash ^= hash >> 32;
+        return static_cast<size_t>(hash);
+    }
+
+    std::vector<value_type> entries; //!< All elements with their cells, in the order in which they were inserted.
+    std::vector<size_t> next_in_cell; //!< For each element, the next element in the same cell, or no_entry.
+    std::vector<Slot> slots; //!< The hash table with the cells.
+    size_t cell_count; //!< How many slots are in use.
+    float max_load; //!< How many of the slots may be in use before the table grows.
+};
+
+/*!
+ * \brief Storage for the elements of a \ref SparseGrid in an
+ * ``std::unordered_multimap``.
+ *
+ * Unlike with \ref FlatGridMap, references to the elements stay valid when
+ * more elements are added.
+ *
+ * \tparam ElemT The element type to store.
+ */
+template<class ElemT>
+class UnorderedGridMap
+{
+public:
+    using GridPoint = SquareGrid::GridPoint;
+    using Map = std::unordered_multimap<GridPoint, ElemT>;
+    using value_type = typename Map::value_type;
+    using iterator = typename Map::iterator;
+    using const_iterator = typename Map::const_iterator;
+
+    iterator begin()
+    {
+        return map.begin();
+    }
+
+    iterator end()
+    {
+        return map.end();
+    }
+
+    const_iterator begin() const
+    {
+        return map.begin();
+    }
+
+    const_iterator end() const
+    {
+        return map.end();
+    }
+
+    size_t size() const
+    {
+        return map.size();
+    }
+
+    void max_load_factor(const float load_factor)
+    {
+        map.max_load_factor(load_factor);
+    }
+
+    void reserve(const size_t elem_count)
+    {
+        map.reserve(elem_count);
+    }
+
+    void emplace(const GridPoint& cell, const ElemT& elem)
+    {
+        map.emplace(cell, elem);
+    }
+
+    void emplaceAll(const std::vector<std::pair<GridPoint, ElemT>>& cell_elems)
+    {
+        map.reserve(map.size() + cell_elems.size());
+        for (const std::pair<GridPoint, ElemT>& cell_elem : cell_elems)
+        {
+            map.emplace(cell_elem.first, cell_elem.second);
+        }
+    }
+
+    bool processCell(const GridPoint& cell, const std::function<bool (const ElemT&)>& process_func) const
+    {
+        const auto range = map.equal_range(cell);
+        for (auto iter = range.first; iter != range.second; ++iter)
+        {
+            if (!process_func(iter->second))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    Map map; //!< The elements, by cell.
+};
+
+} //namespace cura
+
+#endif //UTILS_GRID_MAP_H
@@ -10,6 +10,7 @@
 
 
 
+#include "ArenaAllocator.h"
 #include "HalfEdge.h"
 #include "HalfEdgeNode.h"
 #include "SVG.h"
@@ -24,8 +25,29 @@ class HalfEdgeGraph
 public:
     using edge_t = derived_edge_t;
     using node_t = derived_node_t;
-    std::list<edge_t> edges;
-    std::list<node_t> nodes;
+    using edges_t = std::list<edge_t, ArenaAllocator<edge_t>>;
+    using nodes_t = std::list<node_t, ArenaAllocator<node_t>>;
+
+    HalfEdgeGraph()
+    : edges(ArenaAllocator<edge_t>(arena))
+    , nodes(ArenaAllocator<node_t>(arena))
+    {
+    }
+
+    HalfEdgeGraph(const HalfEdgeGraph&) = delete;
+    HalfEdgeGraph& operator=(const HalfEdgeGraph&) = delete;
+
+private:
+    /*!
+     * All edges and nodes are allocated in contiguous slabs of this arena, and
+     * freed at once when the graph is destroyed. Declared before the lists so
+     * that it outlives them.
+     */
+    MemoryArena arena;
+
+public:
+    edges_t edges;
+    nodes_t nodes;
 };
 
 } // namespace cura
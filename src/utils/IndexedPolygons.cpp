@@ -0,0 +1,302 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For std::max.
+#include <cmath> //For std::sqrt.
+#include <optional>
+#include <tuple> //For std::tie.
+
+#include "IndexedPolygons.h"
+#include "linearAlg2D.h" //To find the closest point on a line segment.
+
+namespace cura
+{
+
+namespace
+{
+
+/*!
+ * The closest point on one line segment.
+ */
+struct ClosestCandidate
+{
+    coord_t dist2;
+    unsigned int poly_idx;
+    unsigned int order; //!< 0 for the first vertex of the polygon, which PolygonUtils::findClosest starts with, or one more than the start of the line segment.
+    Point location;
+
+    /*!
+     * Whether this wins over \p other in PolygonUtils::findClosest, which
+     * keeps the first of equally close points.
+     */
+    bool isBetterThan(const ClosestCandidate& other) const
+    {
+        return std::tie(dist2, poly_idx, order) < std::tie(other.dist2, other.poly_idx, other.order);
+    }
+
+    /*!
+     * The start of the line segment that the closest point is on.
+     */
+    unsigned int getPointIdx() const
+    {
+        return order == 0 ? 0 : order - 1;
+    }
+};
+
+/*!
+ * Where one line segment would move a point to in PolygonUtils::moveInside.
+ */
+struct MoveInsideCandidate
+{
+    coord_t dist2;
+    unsigned int poly_idx;
+    unsigned int iteration; //!< The order in which PolygonUtils::moveInside goes through the line segments, which is the index of their end.
+    Point result;
+    bool is_already_on_correct_side_of_boundary;
+
+    bool isBetterThan(const MoveInsideCandidate& other) const
+    {
+        return std::tie(dist2, poly_idx, iteration) < std::tie(other.dist2, other.poly_idx, other.iteration);
+    }
+};
+
+/*!
+ * Find the best candidate of the line segments in a grid, looking at squares
+ * of growing size around \p from until the best candidate is certainly closer
+ * than any line segment outside of the square.
+ *
+ * Each candidate lies on its line segment, so a line segment that is further
+ * away than the best candidate can't have a better one.
+ * \param grid The grid of line segments.
+ * \param bounding_box The extent of all line segments in the grid.
+ * \param from The point to search around.
+ * \param evaluate Get the candidate of a line segment, if any.
+ */
+template<typename Candidate, typename Evaluate>
+std::optional<Candidate> searchGrid(const LocToLineGrid& grid, const AABB& bounding_box, const Point from, const Evaluate& evaluate)
+{
+    const coord_t cell_size = grid.getCellSize();
+    for (coord_t radius = cell_size * 3; ; radius *= 2)
+    {
+        std::optional<Candidate> best;
+        grid.processNearby(from, radius, [&evaluate, &best](const PolygonsPointIndex& line)
+        {
+            const std::optional<Candidate> candidate = evaluate(line);
+            if (candidate && (!best || candidate->isBetterThan(*best)))
+            {
+                best = candidate;
+            }
+            return true;
+        });
+        //The grid draws fat lines, but to be safe against rounding, don't rely on line segments being in more than one cell. Cells around 0 are twice as large.
+        const coord_t certain_radius = radius - 2 * cell_size;
+        if (best && best->dist2 < certain_radius * certain_radius)
+        {
+            return best;
+        }
+        if (from.X - radius <= bounding_box.min.X && from.Y - radius <= bounding_box.min.Y && from.X + radius >= bounding_box.max.X && from.Y + radius >= bounding_box.max.Y)
+        {
+            return best; //Visited all cells, so this is the best there is.
+        }
+    }
+}
+
+/*!
+ * Evaluate the iteration of PolygonUtils::moveInside that ends at a vertex of a
+ * polygon, in isolation.
+ *
+ * The loop in PolygonUtils::moveInside carries the previous vertex and whether
+ * the point projects beyond the previous line segment from one iteration to
+ * the next. These are reconstructed here from the line segments before it.
+ * \param poly The polygon, with at least two vertices.
+ * \param iteration The index of the end of the line segment.
+ */
+std::optional<MoveInsideCandidate> evaluateMoveInside(ConstPolygonRef poly, const unsigned int poly_idx, const unsigned int iteration, const Point& from, const int distance)
+{
+    const size_t size = poly.size();
+    const Point p1 = poly[(iteration + size - 1) % size];
+    const Point& p2 = poly[iteration];
+
+    //Find the state after the last iteration before this one that didn't skip a duplicate vertex.
+    Point p0 = poly[size - 2];
+    bool projected_p_beyond_prev_segment = dot(poly.back() - p0, from - p0) >= vSize2(poly.back() - p0);
+    for (unsigned int previous = iteration; previous > 0; previous--)
+    {
+        const Point& previous_start = poly[(previous + size - 2) % size];
+        const Point& previous_end = poly[previous - 1];
+        const Point previous_segment = previous_end - previous_start;
+        if (vSize2(previous_segment) > 0)
+        {
+            p0 = previous_start;
+            projected_p_beyond_prev_segment = dot(previous_segment, from - previous_start) >= vSize2(previous_segment);
+            break;
+        }
+    }
+
+    //The rest is the body of the loop in PolygonUtils::moveInside.
+    const Point& a = p1;
+    const Point& b = p2;
+    const Point& p = from;
+    const Point ab = b - a;
+    const Point ap = p - a;
+    const int64_t ab_length2 = vSize2(ab);
+    if (ab_length2 <= 0)
+    {
+        return std::nullopt;
+    }
+    const int64_t dot_prod = dot(ab, ap);
+    if (dot_prod <= 0)
+    {
+        if (!projected_p_beyond_prev_segment)
+        {
+            return std::nullopt;
+        }
+        const Point& x = p1;
+        MoveInsideCandidate candidate{vSize2(x - p), poly_idx, iteration, x, false};
+        if (distance != 0)
+        {
+            Point inward_dir = turn90CCW(normal(ab, MM2INT(10.0)) + normal(p1 - p0, MM2INT(10.0)));
+            candidate.result = x + normal(inward_dir, distance);
+            candidate.is_already_on_correct_side_of_boundary = dot(inward_dir, p - x) * distance >= 0;
+        }
+        return candidate;
+    }
+    else if (dot_prod >= ab_length2)
+    {
+        return std::nullopt;
+    }
+    const Point x = a + ab * dot_prod / ab_length2;
+    MoveInsideCandidate candidate{vSize2(p - x), poly_idx, iteration, x, false};
+    if (distance != 0)
+    {
+        Point inward_dir = turn90CCW(normal(ab, distance));
+        candidate.result = x + inward_dir;
+        candidate.is_already_on_correct_side_of_boundary = dot(inward_dir, p - x) >= 0;
+    }
+    return candidate;
+}
+
+}
+
+IndexedPolygons::IndexedPolygons(const Polygons& polygons)
+: polygons(polygons)
+, query_count(0)
+, loc_to_line(nullptr)
+{
+}
+
+IndexedPolygons::IndexedPolygons(const Polygons& polygons, const LocToLineGrid& loc_to_line)
+: polygons(polygons)
+, query_count(0)
+, loc_to_line(&loc_to_line)
+, bounding_box(polygons)
+{
+}
+
+const LocToLineGrid* IndexedPolygons::getGrid() const
+{
+    if (loc_to_line || query_count > queries_before_grid)
+    {
+        return loc_to_line;
+    }
+    query_count++;
+    if (query_count <= queries_before_grid)
+    {
+        return nullptr;
+    }
+
+    const size_t point_count = polygons.pointCount();
+    if (point_count < min_points_for_grid)
+    {
+        return nullptr; //Never worth it. The query count stays above the limit, so this isn't checked again.
+    }
+    bounding_box = AABB(polygons);
+    //About one line segment per cell if they were spread evenly over the bounding box.
+    const double area = static_cast<double>(bounding_box.max.X - bounding_box.min.X) * static_cast<double>(bounding_box.max.Y - bounding_box.min.Y);
+    const coord_t cell_size = std::max(static_cast<coord_t>(std::sqrt(area / point_count)), coord_t(MM2INT(0.1)));
+    own_loc_to_line = PolygonUtils::createLocToLineGrid(polygons, cell_size);
+    loc_to_line = own_loc_to_line.get();
+    return loc_to_line;
+}
+
+ClosestPolygonPoint IndexedPolygons::findClosest(const Point from) const
+{
+    const LocToLineGrid* grid = getGrid();
+    if (!grid)
+    {
+        return PolygonUtils::findClosest(from, polygons);
+    }
+    const std::optional<ClosestCandidate> best = searchGrid<ClosestCandidate>(*grid, bounding_box, from, [this, &from](const PolygonsPointIndex& line)
+    {
+        ConstPolygonRef poly = polygons[line.poly_idx];
+        const unsigned int next_point_idx = (line.point_idx + 1) % poly.size();
+        const Point closest_here = LinearAlg2D::getClosestOnLineSegment(from, poly[line.point_idx], poly[next_point_idx]);
+        ClosestCandidate candidate{vSize2(from - closest_here), line.poly_idx, line.point_idx + 1, closest_here};
+        if (line.point_idx == 0 || next_point_idx == 0) //PolygonUtils::findClosest only replaces the first vertex by points that are strictly closer.
+        {
+            const ClosestCandidate first_vertex{vSize2(from - poly[0]), line.poly_idx, 0, poly[0]};
+            if (first_vertex.isBetterThan(candidate))
+            {
+                candidate = first_vertex;
+            }
+        }
+        return std::optional<ClosestCandidate>(candidate);
+    });
+    if (!best)
+    {
+        return PolygonUtils::findClosest(from, polygons); //No line segments at all.
+    }
+    return ClosestPolygonPoint(best->location, best->getPointIdx(), polygons[best->poly_idx], best->poly_idx);
+}
+
+unsigned int IndexedPolygons::moveInside(Point& from, const int distance, const int64_t max_dist2) const
+{
+    const LocToLineGrid* grid = getGrid();
+    if (!grid)
+    {
+        return PolygonUtils::moveInside(polygons, from, distance, max_dist2);
+    }
+    const std::optional<MoveInsideCandidate> best = searchGrid<MoveInsideCandidate>(*grid, bounding_box, from, [this, &from, distance](const PolygonsPointIndex& line)
+    {
+        ConstPolygonRef poly = polygons[line.poly_idx];
+        if (poly.size() < 2)
+        {
+            return std::optional<MoveInsideCandidate>();
+        }
+        const unsigned int iteration = (line.point_idx + 1) % poly.size();
+        return evaluateMoveInside(poly, line.poly_idx, iteration, from, distance);
+    });
+
+    //The same decision as at the end of PolygonUtils::moveInside.
+    if (!best)
+    {
+        return NO_INDEX;
+    }
+    if (best->is_already_on_correct_side_of_boundary)
+    {
+        if (best->dist2 < distance * distance)
+        {
+            from = best->result;
+        }
+        return best->poly_idx;
+    }
+    else if (best->dist2 < max_dist2)
+    {
+        from = best->result;
+        return best->poly_idx;
+    }
+    return NO_INDEX;
+}
+
+ClosestPolygonPoint IndexedPolygons::moveInside2(Point& from, const int distance, const int64_t max_dist2) const
+{
+    return PolygonUtils::_moveInside2(findClosest(from), distance, from, max_dist2);
+}
+
+ClosestPolygonPoint IndexedPolygons::ensureInsideOrOutside(Point& from, const int preferred_dist_inside, const int64_t max_dist2) const
+{
+    const ClosestPolygonPoint closest_polygon_point = moveInside2(from, preferred_dist_inside, max_dist2);
+    return PolygonUtils::ensureInsideOrOutside(polygons, from, closest_polygon_point, preferred_dist_inside, &polygons);
+}
+
+} //namespace cura
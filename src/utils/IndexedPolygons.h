@@ -0,0 +1,128 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_INDEXED_POLYGONS_H
+#define UTILS_INDEXED_POLYGONS_H
+
+#include <limits>
+#include <memory> //For unique_ptr.
+
+#include "AABB.h"
+#include "polygonUtils.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Polygons that are queried many times for the closest point on their
+ * boundary, or to move points inside of them.
+ *
+ * The queries give exactly the same results as those of \ref PolygonUtils
+ * without a \ref LocToLineGrid. For large polygons that are queried more than a
+ * few times, a grid of their line segments is built on the side, so that the
+ * queries only look at the line segments around the query point.
+ *
+ * The polygons must not change after the first query. Since the grid is built
+ * lazily, this may not be queried from several threads at once.
+ */
+class IndexedPolygons
+{
+public:
+    /*!
+     * Index polygons, building a grid of line segments if they're queried
+     * often enough for that to pay off.
+     * \param polygons The polygons to query. They must outlive this index.
+     */
+    IndexedPolygons(const Polygons& polygons);
+
+    /*!
+     * Index polygons with a grid of their line segments that exists already.
+     * \param polygons The polygons to query. They must outlive this index.
+     * \param loc_to_line A grid of all line segments of \p polygons, as made
+     * by \ref PolygonUtils::createLocToLineGrid. It must outlive this index.
+     */
+    IndexedPolygons(const Polygons& polygons, const LocToLineGrid& loc_to_line);
+
+    /*!
+     * Find the closest point on the boundary of the polygons.
+     *
+     * Gives the same result as \ref PolygonUtils::findClosest without a
+     * penalty function.
+     * \param from The point to find the closest boundary point to.
+     */
+    ClosestPolygonPoint findClosest(const Point from) const;
+
+    /*!
+     * Move a point inside the polygons, if it isn't already by \p distance.
+     *
+     * Gives the same result as \ref PolygonUtils::moveInside.
+     * \param from The point to move. This is changed to the new position.
+     * \param distance How far to move inside. Negative to move outside.
+     * \param max_dist2 The squared distance from the boundary beyond which the
+     * point isn't moved.
+     * \return The index of the polygon that it was moved into, or
+     * \ref NO_INDEX if it wasn't close enough to the boundary.
+     */
+    unsigned int moveInside(Point& from, const int distance = 0, const int64_t max_dist2 = std::numeric_limits<int64_t>::max()) const;
+
+    /*!
+     * Move a point inside the polygons along the normal of the closest line
+     * segment.
+     *
+     * Gives the same result as \ref PolygonUtils::moveInside2 without a grid
+     * and penalty function.
+     * \param from The point to move. This is changed to the new position.
+     * \param distance How far to move inside. Negative to move outside.
+     * \param max_dist2 The squared distance from the boundary beyond which the
+     * point isn't moved.
+     * \return The closest point on the boundary, which is invalid if the point
+     * was too far away.
+     */
+    ClosestPolygonPoint moveInside2(Point& from, const int distance = 0, const int64_t max_dist2 = std::numeric_limits<int64_t>::max()) const;
+
+    /*!
+     * Move a point inside or outside of the polygons, and make sure that it
+     * ends up there.
+     *
+     * Gives the same result as \ref PolygonUtils::ensureInsideOrOutside
+     * without a grid and penalty function.
+     * \param from The point to move. This is changed to the new position.
+     * \param preferred_dist_inside How far to move inside. Negative to move
+     * outside.
+     * \param max_dist2 The squared distance from the boundary beyond which the
+     * point isn't moved.
+     * \return The closest point on the boundary, which is invalid if the point
+     * couldn't be moved.
+     */
+    ClosestPolygonPoint ensureInsideOrOutside(Point& from, const int preferred_dist_inside, const int64_t max_dist2 = std::numeric_limits<int64_t>::max()) const;
+
+private:
+    /*!
+     * Below this number of vertices, scanning all line segments is about as
+     * fast as looking them up in a grid, so no grid is built.
+     */
+    static constexpr size_t min_points_for_grid = 64;
+
+    /*!
+     * How many queries are done by scanning all line segments before the grid
+     * is built. Building the grid costs about as much as this many scans.
+     */
+    static constexpr size_t queries_before_grid = 8;
+
+    /*!
+     * Get the grid of line segments, building it if this query makes it pay
+     * off.
+     * \return The grid, or nullptr if all line segments should be scanned.
+     */
+    const LocToLineGrid* getGrid() const;
+
+    const Polygons& polygons; //!< The polygons that are queried.
+    mutable size_t query_count; //!< How many queries were done before the grid was built.
+    mutable std::unique_ptr<LocToLineGrid> own_loc_to_line; //!< The grid of line segments, if this index built it.
+    mutable const LocToLineGrid* loc_to_line; //!< The grid of line segments, if there is one yet.
+    mutable AABB bounding_box; //!< The extent of the polygons, known once there is a grid.
+};
+
+} //namespace cura
+
+#endif //UTILS_INDEXED_POLYGONS_H
@@ -0,0 +1,65 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For std::min.
+#include <cassert>
+
+#include "LayerCompletionTracker.h"
+
+namespace cura
+{
+
+LayerCompletionTracker::LayerCompletionTracker(const std::vector<size_t>& item_counts)
+: remaining_items(item_counts)
+, completed(item_counts.size())
+{
+    for (size_t layer_nr = 0; layer_nr < item_counts.size(); layer_nr++)
+    {
+        completed[layer_nr] = item_counts[layer_nr] == 0;
+    }
+}
+
+bool LayerCompletionTracker::finishItem(const size_t layer_nr)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    assert(layer_nr < remaining_items.size() && remaining_items[layer_nr] > 0 && "Only items that the layer has can be finished.");
+    remaining_items[layer_nr]--;
+    return remaining_items[layer_nr] == 0;
+}
+
+void LayerCompletionTracker::complete(const size_t layer_nr)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        assert(remaining_items[layer_nr] == 0 && "A layer can only be complete once all of its items are finished.");
+        completed[layer_nr] = true;
+    }
+    layer_completed.notify_all();
+}
+
+bool LayerCompletionTracker::isComplete(const size_t first_layer_nr, const size_t last_layer_nr) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return isCompleteLocked(first_layer_nr, last_layer_nr);
+}
+
+void LayerCompletionTracker::waitUntilComplete(const size_t first_layer_nr, const size_t last_layer_nr) const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    layer_completed.wait(lock, [this, first_layer_nr, last_layer_nr]() { return isCompleteLocked(first_layer_nr, last_layer_nr); });
+}
+
+bool LayerCompletionTracker::isCompleteLocked(const size_t first_layer_nr, const size_t last_layer_nr) const
+{
+    const size_t end = std::min(last_layer_nr + 1, completed.size());
+    for (size_t layer_nr = first_layer_nr; layer_nr < end; layer_nr++)
+    {
+        if (!completed[layer_nr])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} //namespace cura
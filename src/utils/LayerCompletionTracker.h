@@ -0,0 +1,87 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_LAYER_COMPLETION_TRACKER_H
+#define UTILS_LAYER_COMPLETION_TRACKER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Keeps track of which layers are finished with a processing stage.
+ *
+ * The next stage of a layer often only depends on a few layers around it. With
+ * this, a thread can start on the next stage of a layer as soon as those
+ * layers are done, instead of waiting for the whole stage to finish on all
+ * layers.
+ *
+ * Each layer consists of a number of work items. A layer is complete once all
+ * of its items are finished and \ref complete is called for it, so that the
+ * thread that finished the last item can do some work for the whole layer
+ * first. Layers without any items are complete from the start.
+ *
+ * All functions may be called from multiple threads at once.
+ */
+class LayerCompletionTracker : public NoCopy
+{
+public:
+    /*!
+     * \param item_counts For each layer, how many work items it has.
+     */
+    LayerCompletionTracker(const std::vector<size_t>& item_counts);
+
+    /*!
+     * Report that a work item of a layer is finished.
+     * \param layer_nr The layer that the item belongs to.
+     * \return Whether this was the last item of the layer. If so, the caller
+     * must call \ref complete for the layer.
+     */
+    bool finishItem(const size_t layer_nr);
+
+    /*!
+     * Mark a layer as complete, and wake the threads waiting for it.
+     * \param layer_nr The layer that is complete.
+     */
+    void complete(const size_t layer_nr);
+
+    /*!
+     * Whether all layers in a range are complete.
+     * \param first_layer_nr The first layer of the range.
+     * \param last_layer_nr The last layer of the range, inclusive. Layers past
+     * the end are ignored.
+     */
+    bool isComplete(const size_t first_layer_nr, const size_t last_layer_nr) const;
+
+    /*!
+     * Wait until all layers in a range are complete.
+     *
+     * This must only be called if the layers are being processed by other
+     * threads, or are already complete. Otherwise it waits forever.
+     * \param first_layer_nr The first layer of the range.
+     * \param last_layer_nr The last layer of the range, inclusive. Layers past
+     * the end are ignored.
+     */
+    void waitUntilComplete(const size_t first_layer_nr, const size_t last_layer_nr) const;
+
+private:
+    mutable std::mutex mutex; //!< Protects the counts and the completion of the layers.
+    mutable std::condition_variable layer_completed; //!< Signalled whenever a layer is complete.
+    std::vector<size_t> remaining_items; //!< For each layer, how many of its items are not finished yet.
+    std::vector<bool> completed; //!< For each layer, whether it is complete.
+
+    /*!
+     * Whether all layers in a range are complete, while the mutex is locked.
+     */
+    bool isCompleteLocked(const size_t first_layer_nr, const size_t last_layer_nr) const;
+};
+
+} //namespace cura
+
+#endif //UTILS_LAYER_COMPLETION_TRACKER_H
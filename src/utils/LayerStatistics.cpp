@@ -0,0 +1,204 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For std::sort and std::min.
+#include <atomic>
+#include <cstdio>
+#include <cstring> //For strcmp.
+#include <limits>
+#include <memory> //For shared_ptr.
+#include <mutex>
+#include <vector>
+
+#include "LayerStatistics.h"
+
+namespace cura
+{
+
+namespace
+{
+
+/*!
+ * One counter, for all layers that one thread added to.
+ */
+struct Column
+{
+    const char* name;
+    bool is_time; //!< Whether this is the time spent on a stage, rather than a counter.
+    std::vector<double> values; //!< Per layer, starting at the lowest layer of the thread.
+};
+
+/*!
+ * The counters that one thread added to.
+ */
+struct ThreadCounters
+{
+    int lowest_layer_nr = 0; //!< The layer of the first value of every column. Lower for raft layers.
+    std::vector<Column> columns;
+};
+
+std::atomic<bool> enabled(false);
+std::mutex threads_mutex; //!< Guards the list of threads.
+std::vector<std::shared_ptr<ThreadCounters>> threads; //!< The counters of all threads that recorded any. Kept alive after a thread ends, until they are written.
+
+ThreadCounters& getThreadCounters()
+{
+    thread_local std::shared_ptr<ThreadCounters> thread_counters;
+    if (!thread_counters)
+    {
+        thread_counters = std::make_shared<ThreadCounters>();
+        std::lock_guard<std::mutex> lock(threads_mutex);
+        threads.push_back(thread_counters);
+    }
+    return *thread_counters;
+}
+
+void addToColumn(const char* name, const bool is_time, const int layer_nr, const double value)
+{
+    ThreadCounters& counters = getThreadCounters();
+    if (layer_nr < counters.lowest_layer_nr) //Make room for the lower layers in front.
+    {
+        for (Column& column : counters.columns)
+        {
+            column.values.insert(column.values.begin(), counters.lowest_layer_nr - layer_nr, 0.0);
+        }
+        counters.lowest_layer_nr = layer_nr;
+    }
+
+    //There are only a few counters, and the names are literals, so comparing the pointers is fastest.
+    Column* column = nullptr;
+    for (Column& existing_column : counters.columns)
+    {
+        if (existing_column.name == name && existing_column.is_time == is_time)
+        {
+            column = &existing_column;
+            break;
+        }
+    }
+    if (!column)
+    {
+        counters.columns.push_back(Column{name, is_time, {}});
+        column = &counters.columns.back();
+    }
+
+    const size_t index = layer_nr - counters.lowest_layer_nr;
+    if (index >= column->values.size())
+    {
+        column->values.resize(index + 1, 0.0);
+    }
+    column->values[index] += value;
+}
+
+}
+
+void LayerStatistics::start()
+{
+    enabled.store(true, std::memory_order_release);
+}
+
+bool LayerStatistics::isEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void LayerStatistics::add(const char* name, const int layer_nr, const double value)
+{
+    if (isEnabled())
+    {
+        constexpr bool is_time = false;
+        addToColumn(name, is_time, layer_nr, value);
+    }
+}
+
+void LayerStatistics::addTime(const char* name, const int layer_nr, const double seconds)
+{
+    if (isEnabled())
+    {
+        constexpr bool is_time = true;
+        addToColumn(name, is_time, layer_nr, seconds);
+    }
+}
+
+bool LayerStatistics::write(const std::string& filename)
+{
+    std::FILE* file = std::fopen(filename.c_str(), "w");
+    if (!file)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(threads_mutex);
+
+    //Counters with the same name may have been recorded by different threads, with a different string literal.
+    std::vector<std::pair<const char*, bool>> headings;
+    int lowest_layer_nr = std::numeric_limits<int>::max();
+    int highest_layer_nr = std::numeric_limits<int>::min();
+    for (const std::shared_ptr<ThreadCounters>& thread_counters : threads)
+    {
+        for (const Column& column : thread_counters->columns)
+        {
+            const bool is_new = std::none_of(headings.begin(), headings.end(), [&column](const std::pair<const char*, bool>& heading)
+            {
+                return heading.second == column.is_time && std::strcmp(heading.first, column.name) == 0;
+            });
+            if (is_new)
+            {
+                headings.emplace_back(column.name, column.is_time);
+            }
+            if (!column.values.empty())
+            {
+                lowest_layer_nr = std::min(lowest_layer_nr, thread_counters->lowest_layer_nr);
+                highest_layer_nr = std::max(highest_layer_nr, thread_counters->lowest_layer_nr + static_cast<int>(column.values.size()) - 1);
+            }
+        }
+    }
+    std::sort(headings.begin(), headings.end(), [](const std::pair<const char*, bool>& a, const std::pair<const char*, bool>& b)
+    {
+        return a.second != b.second ? b.second : std::strcmp(a.first, b.first) < 0; //Times at the end.
+    });
+
+    //Add up the counters of all threads, in a table with a row per layer.
+    const size_t layer_count = highest_layer_nr >= lowest_layer_nr ? highest_layer_nr - lowest_layer_nr + 1 : 0;
+    std::vector<double> table(layer_count * headings.size(), 0.0);
+    std::vector<bool> layer_has_values(layer_count, false);
+    for (const std::shared_ptr<ThreadCounters>& thread_counters : threads)
+    {
+        for (const Column& column : thread_counters->columns)
+        {
+            const size_t heading_idx = std::find_if(headings.begin(), headings.end(), [&column](const std::pair<const char*, bool>& heading)
+            {
+                return heading.second == column.is_time && std::strcmp(heading.first, column.name) == 0;
+            }) - headings.begin();
+            for (size_t value_idx = 0; value_idx < column.values.size(); value_idx++)
+            {
+                const size_t row = thread_counters->lowest_layer_nr + value_idx - lowest_layer_nr;
+                table[row * headings.size() + heading_idx] += column.values[value_idx];
+                layer_has_values[row] = layer_has_values[row] || column.values[value_idx] != 0.0;
+            }
+        }
+        thread_counters->columns.clear();
+        thread_counters->lowest_layer_nr = 0;
+    }
+
+    std::fputs("layer", file);
+    for (const std::pair<const char*, bool>& heading : headings)
+    {
+        std::fprintf(file, heading.second ? ",%s time (s)" : ",%s", heading.first);
+    }
+    std::fputc('\n', file);
+    for (size_t row = 0; row < layer_count; row++)
+    {
+        if (!layer_has_values[row])
+        {
+            continue;
+        }
+        std::fprintf(file, "%d", lowest_layer_nr + static_cast<int>(row));
+        for (size_t heading_idx = 0; heading_idx < headings.size(); heading_idx++)
+        {
+            std::fprintf(file, ",%.10g", table[row * headings.size() + heading_idx]);
+        }
+        std::fputc('\n', file);
+    }
+    return std::fclose(file) == 0;
+}
+
+} //namespace cura
@@ -0,0 +1,76 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_LAYER_STATISTICS_H
+#define UTILS_LAYER_STATISTICS_H
+
+#include <string>
+
+namespace cura
+{
+
+/*!
+ * \brief Collects counters per layer, such as the number of polygons, paths
+ * and the travel distance, to export them as a table with a column per
+ * counter and a row per layer.
+ *
+ * Recording is off until \ref start is called. Until then, adding to a counter
+ * costs only a check of whether recording is enabled.
+ *
+ * Each thread adds to its own counters, so recording doesn't make the threads
+ * wait for each other. The counters of all threads are added together when
+ * they are written.
+ */
+class LayerStatistics
+{
+public:
+    /*!
+     * Start recording the counters.
+     */
+    static void start();
+
+    /*!
+     * Whether the counters are being recorded.
+     */
+    static bool isEnabled();
+
+    /*!
+     * Add to a counter of a layer, if recording is enabled.
+     * \param name The name of the counter, as the heading of its column. It
+     * must stay valid until the statistics are written, so it's meant to be a
+     * string literal without commas or quotes.
+     * \param layer_nr The layer to add to.
+     * \param value How much to add.
+     */
+    static void add(const char* name, const int layer_nr, const double value);
+
+    /*!
+     * Add to the time spent on a stage of a layer, if recording is enabled.
+     *
+     * This is recorded for each \ref TraceZone about a layer, so that the
+     * stages show up as columns too.
+     * \param name The name of the stage. The same rules as for \ref add apply.
+     * \param layer_nr The layer that the time was spent on.
+     * \param seconds The time that was spent.
+     */
+    static void addTime(const char* name, const int layer_nr, const double seconds);
+
+    /*!
+     * \brief Write all counters recorded so far to a CSV file, and forget them.
+     *
+     * The file has a column for the layer number, followed by a column for each
+     * counter in alphabetical order with the times at the end. There is a row
+     * for each layer with any counter. Counters that weren't recorded for a layer
+     * are 0 there.
+     *
+     * No counters may be recorded on any thread while this is being called.
+     * Call it after the slice has finished.
+     * \param filename The file to write the statistics to.
+     * \return Whether the file could be written.
+     */
+    static bool write(const std::string& filename);
+};
+
+} //namespace cura
+
+#endif //UTILS_LAYER_STATISTICS_H
@@ -0,0 +1,105 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+namespace cura
+{
+
+#ifdef _WIN32
+MappedFile::MappedFile(const char* filename)
+{
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    m_file = file;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        return;
+    }
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr)
+    {
+        return;
+    }
+    m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data != nullptr)
+    {
+        m_size = static_cast<size_t>(file_size.QuadPart);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping != nullptr)
+    {
+        CloseHandle(m_mapping);
+    }
+    if (m_file != nullptr)
+    {
+        CloseHandle(m_file);
+    }
+}
+#else // not _WIN32
+MappedFile::MappedFile(const char* filename)
+{
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+    {
+        void* mapped = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED)
+        {
+            m_data = static_cast<const char*>(mapped);
+            m_size = file_stat.st_size;
+            madvise(mapped, m_size, MADV_SEQUENTIAL); // We're going to read it front to back.
+        }
+    }
+    close(fd); // The mapping stays valid after closing the file.
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data != nullptr)
+    {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+}
+#endif // _WIN32
+
+bool MappedFile::isValid() const
+{
+    return m_data != nullptr;
+}
+
+const char* MappedFile::data() const
+{
+    return m_data;
+}
+
+size_t MappedFile::size() const
+{
+    return m_size;
+}
+
+} //namespace cura
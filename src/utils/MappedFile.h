@@ -0,0 +1,61 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_MAPPED_FILE_H
+#define UTILS_MAPPED_FILE_H
+
+#include <cstddef>
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * A read-only view of a whole file, mapped into memory.
+ *
+ * The file is mapped when this object is constructed and unmapped when it is
+ * destroyed. This allows large files (such as binary STL files) to be parsed
+ * in place, without copying them into intermediate buffers first.
+ */
+class MappedFile : public NoCopy
+{
+public:
+    /*!
+     * Map the file with the given name into memory.
+     *
+     * If the file could not be opened or mapped, \ref isValid will return
+     * false.
+     * \param filename The path to the file to map.
+     */
+    MappedFile(const char* filename);
+
+    ~MappedFile();
+
+    /*!
+     * Whether the file was successfully mapped.
+     */
+    bool isValid() const;
+
+    /*!
+     * The contents of the file. Only valid if \ref isValid is true.
+     */
+    const char* data() const;
+
+    /*!
+     * The size of the file, in bytes.
+     */
+    size_t size() const;
+
+private:
+    const char* m_data = nullptr; //!< Start of the mapped memory.
+    size_t m_size = 0; //!< Size of the mapped memory.
+#ifdef _WIN32
+    void* m_file = nullptr; //!< Windows HANDLE of the opened file.
+    void* m_mapping = nullptr; //!< Windows HANDLE of the file mapping.
+#endif
+};
+
+} //namespace cura
+
+#endif //UTILS_MAPPED_FILE_H
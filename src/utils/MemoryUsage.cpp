@@ -0,0 +1,40 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifdef _WIN32
+#define PSAPI_VERSION 2 //Use the version of GetProcessMemoryInfo in kernel32, so that we don't need to link to psapi.
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "MemoryUsage.h"
+
+namespace cura
+{
+
+size_t getPeakMemoryUsage()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+#if defined(__APPLE__) && defined(__MACH__)
+    return usage.ru_maxrss; //In bytes on macOS.
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024; //In kilobytes on Linux and BSD.
+#endif
+#endif
+}
+
+} //namespace cura
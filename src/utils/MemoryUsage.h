@@ -0,0 +1,22 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_MEMORY_USAGE_H
+#define UTILS_MEMORY_USAGE_H
+
+#include <cstddef>
+
+namespace cura
+{
+
+/*!
+ * Get the largest amount of physical memory that this process has used so
+ * far, its peak resident set size.
+ * \return The peak memory use in bytes, or 0 if it can't be determined on this
+ * platform.
+ */
+size_t getPeakMemoryUsage();
+
+} //namespace cura
+
+#endif //UTILS_MEMORY_USAGE_H
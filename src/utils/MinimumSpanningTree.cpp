@@ -5,11 +5,15 @@
 
 #include <iterator>
 #include <algorithm>
+#include <tuple> //For std::tie.
+
+#include "../BoostInterface.hpp" //To compute the Delaunay triangulation as the dual of the Voronoi diagram.
+#include "UnionFind.h"
 
 namespace cura
 {
 
-MinimumSpanningTree::MinimumSpanningTree(std::vector<Point> vertices) : adjacency_graph(prim(vertices))
+MinimumSpanningTree::MinimumSpanningTree(std::vector<Point> vertices) : adjacency_graph(kruskal(vertices))
 {
     //Just copy over the fields.
 }
@@ -88,6 +92,68 @@ auto MinimumSpanningTree::prim(std::vector<Point> vertices) const -> AdjacencyGr
     return result;
 }
 
+auto MinimumSpanningTree::kruskal(std::vector<Point> vertices) const -> AdjacencyGraph_t
+{
+    AdjacencyGraph_t result;
+    //Duplicate vertices would be the same node of the graph anyway.
+    std::sort(vertices.begin(), vertices.end(), [](const Point& a, const Point& b) { return std::tie(a.X, a.Y) < std::tie(b.X, b.Y); });
+    vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+    if (vertices.size() <= 1)
+    {
+        for (const Point& vertex : vertices)
+        {
+            result[vertex]; //No edges, but the vertex must still be in the tree.
+        }
+        return result;
+    }
+
+    //The edges between neighbouring cells of the Voronoi diagram are the edges of the Delaunay triangulation.
+    boost::polygon::voronoi_diagram<double> diagram;
+    boost::polygon::construct_voronoi(vertices.begin(), vertices.end(), &diagram);
+    struct Candidate
+    {
+        coord_t length2;
+        size_t a;
+        size_t b;
+    };
+    std::vector<Candidate> candidates;
+    candidates.reserve(diagram.num_edges() / 2);
+    for (const boost::polygon::voronoi_edge<double>& edge : diagram.edges())
+    {
+        const size_t a = edge.cell()->source_index();
+        const size_t b = edge.twin()->cell()->source_index();
+        if (a < b) //Each edge and its twin separate the same two cells.
+        {
+            candidates.push_back({ vSize2(vertices[a] - vertices[b]), a, b });
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& x, const Candidate& y) { return std::tie(x.length2, x.a, x.b) < std::tie(y.length2, y.a, y.b); });
+
+    //Kruskal's algorithm, with a union-find over the vertex indices.
+    IndexUnionFind trees(vertices.size());
+    result.reserve(vertices.size());
+    size_t edge_count = 0;
+    for (const Candidate& candidate : candidates)
+    {
+        const size_t root_a = trees.find(candidate.a);
+        const size_t root_b = trees.find(candidate.b);
+        if (root_a == root_b)
+        {
+            continue; //Would make a cycle.
+        }
+        trees.unite(root_a, root_b);
+        const Point& a = vertices[candidate.a];
+        const Point& b = vertices[candidate.b];
+        result[a].push_back({a, b});
+        result[b].push_back({b, a});
+        if (++edge_count == vertices.size() - 1)
+        {
+            break; //All vertices are connected.
+        }
+    }
+    return result;
+}
+
 std::vector<Point> MinimumSpanningTree::adjacentNodes(Point node) const
 {
     std::vector<Point> result;
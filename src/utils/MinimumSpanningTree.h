@@ -7,6 +7,9 @@
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
+#ifdef BUILD_TESTS
+    #include <gtest/gtest_prod.h> //To allow tests to compare the algorithms.
+#endif
 
 #include "IntPoint.h"
 
@@ -14,12 +17,18 @@ namespace cura
 {
 
 /*!
- * \brief Implements Prim's algorithm to compute Minimum Spanning Trees (MST).
+ * \brief Computes the Euclidean Minimum Spanning Tree (MST) of a set of
+ * vertices.
  *
  * The minimum spanning tree is always computed from a clique of vertices.
+ * Since the Euclidean MST is part of the Delaunay triangulation, only the
+ * edges of that triangulation are considered, which takes O(V*log(V)) time.
  */
 class MinimumSpanningTree
 {
+#ifdef BUILD_TESTS
+    FRIEND_TEST(SimpleMinimumSpanningTreeTest, SameLengthAsPrim);
+#endif
     /*!
      * \brief Represents an edge of the tree.
      *
@@ -74,6 +83,17 @@ private:
      * \return An adjacency graph with for each point one or more edges.
      */
     AdjacencyGraph_t prim(std::vector<Point> vertices) const;
+
+    /*!
+     * \brief Computes the edges of a minimum spanning tree using Kruskal's
+     * algorithm on the edges of the Delaunay triangulation of the vertices.
+     *
+     * The tree has the same total length as the one of \ref prim, but if
+     * multiple edges have the same length, it may use different ones.
+     * \param vertices The vertices to span.
+     * \return An adjacency graph with for each point one or more edges.
+     */
+    AdjacencyGraph_t kruskal(std::vector<Point> vertices) const;
 };
 
 }
@@ -0,0 +1,181 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_NEAREST_POINT_GRID_H
+#define UTILS_NEAREST_POINT_GRID_H
+
+#include <algorithm> //For std::min, std::max and std::remove_if.
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "IntPoint.h"
+#include "SquareGrid.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Grid of points which finds the point nearest to a query location, and
+ * from which points can be removed again.
+ *
+ * The search visits rings of cells around the query location, moving outwards
+ * until no closer point can exist in any ring further out. If the points are
+ * spread out over the grid, repeatedly taking the nearest remaining point then
+ * only looks at the points around the query location instead of all points.
+ *
+ * \tparam Val The type of values stored along with the points. Values must be
+ * comparable. Of several points at the same distance, the one with the smallest
+ * value is found.
+ */
+template<typename Val>
+class NearestPointGrid : public SquareGrid
+{
+public:
+    /*!
+     * \brief Constructs an empty grid.
+     * \param cell_size The size of the cells. For the best performance, make
+     * this about the average distance between neighbouring points.
+     */
+    NearestPointGrid(const coord_t cell_size)
+    : SquareGrid(cell_size)
+    , min_cell(std::numeric_limits<grid_coord_t>::max(), std::numeric_limits<grid_coord_t>::max())
+    , max_cell(std::numeric_limits<grid_coord_t>::lowest(), std::numeric_limits<grid_coord_t>::lowest())
+    {
+    }
+
+    /*!
+     * \brief Add a point to the grid.
+     * \param point The location of the point.
+     * \param value The value to store along with it.
+     */
+    void insert(const Point& point, const Val& value)
+    {
+        const GridPoint cell = toGridPoint(point);
+        cells[cell].push_back(Entry{point, value});
+        min_cell = GridPoint(std::min(min_cell.X, cell.X), std::min(min_cell.Y, cell.Y));
+        max_cell = GridPoint(std::max(max_cell.X, cell.X), std::max(max_cell.Y, cell.Y));
+    }
+
+    /*!
+     * \brief Remove a point from the grid.
+     *
+     * If the point was inserted several times with the same value, all of
+     * those are removed.
+     * \param point The location of the point that was inserted.
+     * \param value The value that was inserted along with it.
+     */
+    void remove(const Point& point, const Val& value)
+    {
+        const auto cell = cells.find(toGridPoint(point));
+        if (cell == cells.end())
+        {
+            return;
+        }
+        std::vector<Entry>& entries = cell->second;
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [&point, &value](const Entry& entry) { return entry.point == point && entry.value == value; }), entries.end());
+        if (entries.empty())
+        {
+            cells.erase(cell);
+        }
+    }
+
+    /*!
+     * \brief Find the point nearest to a location.
+     * \param query_pt The location to find the nearest point to.
+     * \param is_usable Filter on the values of the points. Points for which
+     * this returns ``false`` are skipped.
+     * \param[out] result The value of the nearest point, if any was found.
+     * \return Whether any point was found that passed the filter.
+     */
+    bool findNearest(const Point& query_pt, const std::function<bool (const Val&)>& is_usable, Val& result) const
+    {
+        if (cells.empty())
+        {
+            return false;
+        }
+        bool found = false;
+        coord_t best_distance2 = std::numeric_limits<coord_t>::max();
+        const auto process_cell = [this, &query_pt, &is_usable, &result, &found, &best_distance2](const GridPoint& grid_pt)
+        {
+            const auto cell = cells.find(grid_pt);
+            if (cell == cells.end())
+            {
+                return;
+            }
+            for (const Entry& entry : cell->second)
+            {
+                const coord_t distance2 = vSize2(entry.point - query_pt);
+                if ((distance2 < best_distance2 || (found && distance2 == best_distance2 && entry.value < result)) && is_usable(entry.value))
+                {
+                    best_distance2 = distance2;
+                    result = entry.value;
+                    found = true;
+                }
+            }
+        };
+
+        const GridPoint query_cell = toGridPoint(query_pt);
+        //Rings closer than this don't overlap with any cells that were ever filled.
+        const grid_coord_t first_ring = std::max({ grid_coord_t(0), min_cell.X - query_cell.X, query_cell.X - max_cell.X, min_cell.Y - query_cell.Y, query_cell.Y - max_cell.Y });
+        //Rings further than this don't overlap with any cells that were ever filled either.
+        const grid_coord_t last_ring = std::max({ query_cell.X - min_cell.X, max_cell.X - query_cell.X, query_cell.Y - min_cell.Y, max_cell.Y - query_cell.Y });
+        for (grid_coord_t ring = first_ring; ring <= last_ring; ring++)
+        {
+            //Only visit the part of the ring that overlaps with the filled cells.
+            const grid_coord_t min_x = std::max(query_cell.X - ring, min_cell.X);
+            const grid_coord_t max_x = std::min(query_cell.X + ring, max_cell.X);
+            const grid_coord_t min_y = std::max(query_cell.Y - ring, min_cell.Y);
+            const grid_coord_t max_y = std::min(query_cell.Y + ring, max_cell.Y);
+            for (grid_coord_t x = min_x; x <= max_x; x++)
+            {
+                if (query_cell.Y - ring >= min_cell.Y)
+                {
+                    process_cell(GridPoint(x, query_cell.Y - ring));
+                }
+                if (ring > 0 && query_cell.Y + ring <= max_cell.Y)
+                {
+                    process_cell(GridPoint(x, query_cell.Y + ring));
+                }
+            }
+            for (grid_coord_t y = std::max(query_cell.Y - ring + 1, min_y); y <= std::min(query_cell.Y + ring - 1, max_y); y++)
+            {
+                if (query_cell.X - ring >= min_cell.X)
+                {
+                    process_cell(GridPoint(query_cell.X - ring, y));
+                }
+                if (ring > 0 && query_cell.X + ring <= max_cell.X)
+                {
+                    process_cell(GridPoint(query_cell.X + ring, y));
+                }
+            }
+
+            //Every cell is at least one cell size wide, so points in the next rings are at least this far away.
+            const coord_t next_ring_distance = ring * cell_size;
+            if (found && best_distance2 < next_ring_distance * next_ring_distance)
+            {
+                break;
+            }
+        }
+        return found;
+    }
+
+private:
+    /*!
+     * A point stored in the grid.
+     */
+    struct Entry
+    {
+        Point point;
+        Val value;
+    };
+
+    std::unordered_map<GridPoint, std::vector<Entry>> cells; //!< The points in each cell.
+    GridPoint min_cell; //!< The lowest coordinates of any cell that points were inserted in.
+    GridPoint max_cell; //!< The highest coordinates of any cell that points were inserted in.
+};
+
+} //namespace cura
+
+#endif //UTILS_NEAREST_POINT_GRID_H
@@ -0,0 +1,151 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For stable_sort.
+#include <cstdio> //For snprintf.
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#ifdef _OPENMP
+    #include <omp.h>
+#endif // _OPENMP
+
+#include "logoutput.h"
+#include "ParallelSchedule.h"
+
+namespace cura
+{
+
+namespace
+{
+
+std::mutex rates_mutex; //!< Guards the rates.
+std::unordered_map<std::string, double> seconds_per_cost_by_stage; //!< How long a unit of cost took in each stage that ran so far.
+
+}
+
+ParallelSchedule::ParallelSchedule(const char* stage, const std::vector<size_t>& costs)
+: stage(stage)
+, item_count(costs.size())
+, total_cost(0.0)
+, seconds_per_cost(getSecondsPerCost(stage))
+{
+    for (const size_t cost : costs)
+    {
+        total_cost += cost + 1;
+    }
+    int max_thread_count = 1;
+#ifdef _OPENMP
+    max_thread_count = std::max(1, omp_get_max_threads());
+#endif // _OPENMP
+    plan = makePlan(costs, max_thread_count, seconds_per_cost);
+}
+
+const ParallelSchedule::Plan& ParallelSchedule::getPlan() const
+{
+    return plan;
+}
+
+ParallelSchedule::Plan ParallelSchedule::makePlan(const std::vector<size_t>& costs, const int max_thread_count, const double seconds_per_cost)
+{
+    Plan result{1, false, {}};
+    if (costs.empty())
+    {
+        return result;
+    }
+
+    double total_cost = 0.0;
+    double max_cost = 0.0;
+    for (const size_t cost : costs)
+    {
+        total_cost += cost + 1; //Every item takes some time, even if it's estimated to cost nothing.
+        max_cost = std::max(max_cost, static_cast<double>(cost + 1));
+    }
+
+    double thread_count = std::min(static_cast<double>(std::max(1, max_thread_count)), static_cast<double>(costs.size()));
+    if (seconds_per_cost > 0.0)
+    {
+        thread_count = std::max(1.0, std::min(thread_count, total_cost * seconds_per_cost / min_seconds_per_thread));
+    }
+    result.thread_count = static_cast<int>(thread_count);
+    if (result.thread_count == 1)
+    {
+        result.chunks.push_back(Chunk{0, costs.size(), total_cost});
+        return result;
+    }
+
+    const size_t chunk_count = result.thread_count * chunks_per_thread;
+    result.is_balanced = max_cost > 2.0 * total_cost / costs.size(); //Some items cost far more than the average.
+    if (!result.is_balanced)
+    {
+        const size_t items_per_chunk = (costs.size() + chunk_count - 1) / chunk_count;
+        for (size_t begin = 0; begin < costs.size(); begin += items_per_chunk)
+        {
+            Chunk chunk{begin, std::min(costs.size(), begin + items_per_chunk), 0.0};
+            for (size_t item_idx = chunk.begin; item_idx < chunk.end; item_idx++)
+            {
+                chunk.cost += costs[item_idx] + 1;
+            }
+            result.chunks.push_back(chunk);
+        }
+        return result;
+    }
+
+    const double chunk_cost = total_cost / chunk_count;
+    Chunk chunk{0, 0, 0.0};
+    for (size_t item_idx = 0; item_idx < costs.size(); item_idx++)
+    {
+        const double cost = costs[item_idx] + 1;
+        if (chunk.end > chunk.begin && chunk.cost + cost > chunk_cost)
+        {
+            result.chunks.push_back(chunk);
+            chunk = Chunk{item_idx, item_idx, 0.0};
+        }
+        chunk.end = item_idx + 1;
+        chunk.cost += cost;
+    }
+    result.chunks.push_back(chunk);
+    std::stable_sort(result.chunks.begin(), result.chunks.end(), [](const Chunk& a, const Chunk& b) { return a.cost > b.cost; });
+    return result;
+}
+
+double ParallelSchedule::getSecondsPerCost(const char* stage)
+{
+    std::lock_guard<std::mutex> lock(rates_mutex);
+    const auto found = seconds_per_cost_by_stage.find(stage);
+    return found == seconds_per_cost_by_stage.end() ? 0.0 : found->second;
+}
+
+void ParallelSchedule::finish(const std::chrono::steady_clock::time_point start, const double work_seconds)
+{
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (total_cost > 0.0 && work_seconds > 0.0)
+    {
+        const double measured = work_seconds / total_cost;
+        std::lock_guard<std::mutex> lock(rates_mutex);
+        const auto inserted = seconds_per_cost_by_stage.emplace(stage, measured);
+        if (!inserted.second)
+        {
+            inserted.first->second = (inserted.first->second + measured) / 2.0; //Follow changes, but don't let one odd mesh decide on its own.
+        }
+    }
+
+    logDebug("Stage %s: %zu chunks of %s on %d threads, %.3fs (%.3fs of work).\n", stage, plan.chunks.size(), plan.is_balanced ? "equal cost" : "equal items", plan.thread_count, seconds, work_seconds);
+    if (Trace::isEnabled())
+    {
+        char args[256];
+        std::snprintf(args, sizeof(args), "\"stage\":\"%s\",\"items\":%zu,\"cost\":%.0f,\"threads\":%d,\"chunks\":%zu,\"partitioning\":\"%s\",\"estimated_seconds\":%.6f,\"work_seconds\":%.6f",
+            stage, item_count, total_cost, plan.thread_count, plan.chunks.size(), plan.is_balanced ? "cost" : "items", total_cost * seconds_per_cost, work_seconds);
+        Trace::record(stage, TraceZone::no_layer, start, args);
+    }
+}
+
+void ParallelSchedule::recordChunk(const Chunk& chunk, const std::chrono::steady_clock::time_point start) const
+{
+    char args[128];
+    std::snprintf(args, sizeof(args), "\"stage\":\"%s\",\"first\":%zu,\"last\":%zu,\"cost\":%.0f", stage, chunk.begin, chunk.end - 1, chunk.cost);
+    Trace::record("chunk", TraceZone::no_layer, start, args);
+}
+
+} //namespace cura
@@ -0,0 +1,162 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_PARALLEL_SCHEDULE_H
+#define UTILS_PARALLEL_SCHEDULE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "NoCopy.h"
+#include "Trace.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Decides how to divide the items of a parallel stage, such as the
+ * layers of a mesh, over the threads, from an estimate of the cost of each
+ * item.
+ *
+ * The estimates are quick proxies, such as the number of vertices or faces of
+ * a layer. How long a unit of cost takes is measured each time a stage runs,
+ * and used the next time the same stage runs, e.g. for the next mesh:
+ * - If the whole stage takes so little time that waking up more threads costs
+ *   more than it saves, fewer threads are used.
+ * - If the costs are about equal, the items are handed out in chunks of equal
+ *   numbers of items, to reduce the scheduling overhead of cheap items.
+ * - If the costs are uneven, e.g. for a few giant layers, the items are
+ *   partitioned into chunks of about equal cost. Items that are more expensive
+ *   than a chunk get a chunk of their own. The most expensive chunks are
+ *   handed out first, so that no thread starts a giant layer at the end.
+ *
+ * The chunks are always handed out dynamically, so a wrong estimate only makes
+ * the balance worse, not the result.
+ *
+ * If tracing is enabled, the decisions and timings are recorded in the trace,
+ * see \ref Trace.
+ */
+class ParallelSchedule : public NoCopy
+{
+public:
+    /*!
+     * A range of consecutive items that is processed by one thread at once.
+     */
+    struct Chunk
+    {
+        size_t begin; //!< The first item of the chunk.
+        size_t end; //!< The item after the last item of the chunk.
+        double cost; //!< The estimated cost of all items in the chunk.
+    };
+
+    /*!
+     * How the items of a stage are divided over the threads.
+     */
+    struct Plan
+    {
+        int thread_count; //!< How many threads to use.
+        bool is_balanced; //!< Whether the chunks are partitioned by cost, rather than by number of items.
+        std::vector<Chunk> chunks; //!< The chunks, in the order in which to hand them out.
+    };
+
+    static constexpr double min_seconds_per_thread = 0.0005; //!< Each thread is given at least this much work, since starting threads and handing out chunks costs time too.
+    static constexpr size_t chunks_per_thread = 4; //!< How many chunks to make for each thread, so that threads that finish early can take over some of the work of others.
+
+    /*!
+     * Plan a stage.
+     * \param stage The name of the stage. It must stay valid for as long as
+     * the engine runs, so it's meant to be a string literal without any
+     * characters that need escaping in JSON.
+     * \param costs The estimated cost of each item. An item without any cost
+     * still costs a little, e.g. for an empty layer.
+     */
+    ParallelSchedule(const char* stage, const std::vector<size_t>& costs);
+
+    /*!
+     * Process all items, in parallel.
+     *
+     * This is a replacement for an OpenMP ``parallel for`` over the items, so
+     * the same restrictions apply to \p process.
+     * \param process The function to process one item, given its index.
+     */
+    template<typename Function>
+    void run(const Function& process);
+
+    /*!
+     * Get how the items are divided over the threads.
+     */
+    const Plan& getPlan() const;
+
+    /*!
+     * \brief Decide how to divide items over threads.
+     * \param costs The estimated cost of each item.
+     * \param max_thread_count How many threads are available.
+     * \param seconds_per_cost How long a unit of cost took the last time, or
+     * 0 if that's unknown. If it's unknown, all threads are used.
+     * \return How to divide the items over the threads.
+     */
+    static Plan makePlan(const std::vector<size_t>& costs, const int max_thread_count, const double seconds_per_cost);
+
+    /*!
+     * Get how long a unit of cost took in a stage the last times it ran.
+     * \param stage The name of the stage.
+     * \return The seconds per unit of cost, or 0 if the stage didn't run yet.
+     */
+    static double getSecondsPerCost(const char* stage);
+
+private:
+    /*!
+     * Remember how long the stage took, and record it in the trace.
+     * \param start When the stage started.
+     * \param work_seconds The time that all threads together spent on the
+     * items.
+     */
+    void finish(const std::chrono::steady_clock::time_point start, const double work_seconds);
+
+    /*!
+     * Record how long a chunk took in the trace.
+     */
+    void recordChunk(const Chunk& chunk, const std::chrono::steady_clock::time_point start) const;
+
+    const char* stage; //!< The name of the stage.
+    size_t item_count; //!< How many items the stage has.
+    double total_cost; //!< The estimated cost of all items together.
+    double seconds_per_cost; //!< How long a unit of cost took the last time, or 0 if unknown.
+    Plan plan; //!< How the items are divided over the threads.
+};
+
+template<typename Function>
+void ParallelSchedule::run(const Function& process)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const bool is_tracing = Trace::isEnabled();
+    std::atomic<size_t> next_chunk_idx(0);
+    double work_seconds = 0.0;
+    #pragma omp parallel num_threads(plan.thread_count)
+    {
+        double thread_work_seconds = 0.0;
+        for (size_t chunk_idx = next_chunk_idx++; chunk_idx < plan.chunks.size(); chunk_idx = next_chunk_idx++)
+        {
+            const Chunk& chunk = plan.chunks[chunk_idx];
+            const std::chrono::steady_clock::time_point chunk_start = std::chrono::steady_clock::now();
+            for (size_t item_idx = chunk.begin; item_idx < chunk.end; item_idx++)
+            {
+                process(item_idx);
+            }
+            thread_work_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - chunk_start).count();
+            if (is_tracing)
+            {
+                recordChunk(chunk, chunk_start);
+            }
+        }
+        #pragma omp atomic
+        work_seconds += thread_work_seconds;
+    }
+    finish(start, work_seconds);
+}
+
+} //namespace cura
+
+#endif //UTILS_PARALLEL_SCHEDULE_H
@@ -7,12 +7,15 @@
 #ifdef BUILD_TESTS
     #include <gtest/gtest_prod.h> //To allow tests to use protected members.
 #endif
+#include <algorithm> //For std::sort and std::unique.
+#include <tuple>
 #include <vector>
 
 #include "IntPoint.h"
 #include "polygon.h"
 #include "polygonUtils.h"
 #include "linearAlg2D.h"
+#include "SparseLineGrid.h"
 
 namespace cura 
 {
@@ -208,6 +211,125 @@ protected:
         {}
     };
 
+    /*!
+     * A line segment of one of the polygons that may be connected to, as it is
+     * stored in the grid of \ref CandidateSegments.
+     */
+    struct CandidateSegment
+    {
+        Point start; //!< The start of the line segment.
+        Point end; //!< The end of the line segment.
+        size_t poly_index; //!< The polygon that the line segment is part of.
+        size_t segment_index; //!< The index of the line segment in the polygon, which is the index of the vertex it starts at.
+        size_t version; //!< How often the polygon had been changed when the line segment was stored. If it changed since, the line segment is outdated.
+    };
+
+    /*!
+     * Gets the line segment that a \ref CandidateSegment refers to, for
+     * storing it in a \ref SparseLineGrid.
+     */
+    struct CandidateSegmentLocator
+    {
+        std::pair<Point, Point> operator()(const CandidateSegment& segment) const
+        {
+            return std::make_pair(segment.start, segment.end);
+        }
+    };
+
+    /*!
+     * The polygons that may be connected to, with a grid to look up which of
+     * their line segments are near a certain location.
+     *
+     * This prevents having to compare every line segment of a polygon with
+     * every line segment of all other polygons when looking for a bridge.
+     *
+     * When a polygon changes, its line segments in the grid are not removed,
+     * but its version is incremented, and the new line segments are added with
+     * the new version. The line segments with a different version are then
+     * ignored. The polygons that are taken from the back of the
+     * \ref polygons are ignored as well.
+     */
+    template<typename Polygonal>
+    struct CandidateSegments
+    {
+        std::vector<Polygonal>& polygons; //!< The polygons that may be connected to.
+        std::vector<size_t> versions; //!< For each polygon, how often it was changed.
+        coord_t search_radius; //!< No bridge can be longer than this, including the width of the lines on both sides.
+        SparseLineGrid<CandidateSegment, CandidateSegmentLocator> grid; //!< The line segments of the polygons, by their location.
+
+        CandidateSegments(std::vector<Polygonal>& polygons, const coord_t search_radius)
+        : polygons(polygons)
+        , versions(polygons.size(), 0)
+        , search_radius(search_radius)
+        , grid(search_radius)
+        {
+        }
+    };
+
+    /*!
+     * Create a grid with all line segments of a set of polygons that may be
+     * connected to.
+     * \param polygons The polygons that may be connected to.
+     * \param max_width The greatest line width of any polygon that these may
+     * get connected to, if it's greater than the width of these polygons
+     * themselves.
+     * \return The polygons with their line segments in a grid.
+     */
+    template<typename Polygonal>
+    CandidateSegments<Polygonal> createCandidateSegments(std::vector<Polygonal>& polygons, coord_t max_width)
+    {
+        for(const Polygonal& polygon : polygons)
+        {
+            max_width = std::max(max_width, getMaxWidth(polygon));
+        }
+        //The distance between the centrelines must be smaller than the maximum gap, plus half of the line widths on either side.
+        //Since the distance is compared with the full line widths, use those to be safe.
+        const coord_t search_radius = std::max(coord_t(1), coord_t(line_width * max_gap) + 2 * max_width);
+        CandidateSegments<Polygonal> candidates(polygons, search_radius);
+        for(size_t poly_index = 0; poly_index < polygons.size(); ++poly_index)
+        {
+            insertSegments(candidates, poly_index);
+        }
+        return candidates;
+    }
+
+    /*!
+     * Add the line segments of one of the candidate polygons to the grid.
+     * \param candidates The candidate polygons with the grid to add to.
+     * \param poly_index The index of the polygon to add the line segments of.
+     */
+    template<typename Polygonal>
+    void insertSegments(CandidateSegments<Polygonal>& candidates, const size_t poly_index)
+    {
+        Polygonal& polygon = candidates.polygons[poly_index];
+        if(!isClosed(polygon)) //Can't connect to open polylines anyway.
+        {
+            return;
+        }
+        for(size_t segment_index = 0; segment_index < polygon.size(); ++segment_index)
+        {
+            const Point start = getPosition(polygon[segment_index]);
+            const Point end = getPosition(polygon[(segment_index + 1) % polygon.size()]);
+            candidates.grid.insert(CandidateSegment{start, end, poly_index, segment_index, candidates.versions[poly_index]});
+        }
+    }
+
+    /*!
+     * Get the greatest line width in a polygonal object.
+     * \param polygonal The polygon to get the greatest line width of.
+     * \return The greatest line width of any of the vertices.
+     */
+    template<typename Polygonal>
+    coord_t getMaxWidth(const Polygonal& polygonal) const
+    {
+        coord_t max_width = 0;
+        for(size_t i = 0; i < polygonal.size(); ++i)
+        {
+            max_width = std::max(max_width, getWidth(polygonal[i]));
+        }
+        return max_width;
+    }
+
     /*!
      * Connect a group of polygonal objects - either polygons or paths.
      *
@@ -221,6 +343,7 @@ protected:
     template<typename Polygonal>
     std::vector<Polygonal> connectGroup(std::vector<Polygonal>& to_connect)
     {
+        CandidateSegments<Polygonal> candidates = createCandidateSegments(to_connect, 0);
         std::vector<Polygonal> result;
         while(!to_connect.empty())
         {
@@ -230,18 +353,24 @@ protected:
                 break;
             }
             Polygonal current = std::move(to_connect.back());
-            to_connect.pop_back();
+            to_connect.pop_back(); //The segments of it in the grid are ignored from now on, since its index is out of range.
 
             if(!isClosed(current)) //Only bridge closed contours.
             {
                 result.push_back(current);
                 continue;
             }
-            std::optional<PolygonBridge<Polygonal>> bridge = getBridge(current, to_connect);
+            std::optional<PolygonBridge<Polygonal>> bridge = getBridge(current, candidates);
             if(bridge)
             {
                 connectPolygonsAlongBridge(*bridge, *bridge->a.to_poly); //Connect the polygons, and store the result in the to_poly.
                 //Don't store the current polygon. It has just been merged into the other one.
+                const size_t merged_index = bridge->a.to_poly - to_connect.data();
+                candidates.versions[merged_index]++; //The segments of the polygon before merging are no longer valid.
+                if(merged_index + 1 < to_connect.size()) //If it's the last one, it gets connected next, so it's not a candidate anyway.
+                {
+                    insertSegments(candidates, merged_index);
+                }
             }
             else //Can't connect this to anything. Leave it as-is.
             {
@@ -398,91 +527,134 @@ protected:
         return round_divide(getWidth(b) * position_along_length, total_length) + round_divide(getWidth(a) * (total_length - position_along_length), total_length);
     }
 
+    /*!
+     * Find the smallest connection between two line segments of two polygons,
+     * if it is smaller than the best connection found so far.
+     *
+     * Only connections that start or end on a vertex are considered: either
+     * from the first vertex of the segment of the from_poly to the segment of
+     * the to_poly, or the other way around.
+     * \param from_poly The polygon at the source of the connection.
+     * \param from_index The line segment in the from_poly.
+     * \param to_poly The polygon at the destination of the connection.
+     * \param to_index The line segment in the to_poly.
+     * \param[in,out] best_distance The length of the best connection so far.
+     * \param[in,out] best_connection The best connection so far.
+     * \param[in,out] best_second_connection The second connection that goes
+     * with the best connection so far, to form a bridge.
+     */
+    template<typename Polygonal>
+    void findConnectionBetweenSegments(Polygonal& from_poly, const size_t from_index, Polygonal& to_poly, const size_t to_index, coord_t& best_distance, std::optional<PolygonConnection<Polygonal>>& best_connection, std::optional<PolygonConnection<Polygonal>>& best_second_connection)
+    {
+        const Point to_pos1 =  getPosition(to_poly[to_index]);
+        const coord_t to_width1 = getWidth(to_poly[to_index]);
+        const Point to_pos2 =  getPosition(to_poly[(to_index + 1) % to_poly.size()]);
+        const coord_t to_width2 = getWidth(to_poly[(to_index + 1) % to_poly.size()]);
+        const coord_t smallest_to_width = std::min(to_width1, to_width2);
+
+        const Point from_pos1 = getPosition(from_poly[from_index]);
+        const coord_t from_width1 = getWidth(from_poly[from_index]);
+        const Point from_pos2 = getPosition(from_poly[(from_index + 1) % from_poly.size()]);
+        const coord_t from_width2 = getWidth(from_poly[(from_index + 1) % from_poly.size()]);
+        const coord_t smallest_from_width = std::min(from_width1, from_width2);
+
+        //Try a naive distance first. Faster to compute, but it may estimate the distance too small.
+        coord_t naive_dist = LinearAlg2D::getDistFromLine(from_pos1, to_pos1, to_pos2);
+        if(naive_dist - from_width1 - smallest_to_width < line_width * max_gap)
+        {
+            const Point closest_point = LinearAlg2D::getClosestOnLineSegment(from_pos1, to_pos1, to_pos2);
+            if(closest_point == to_pos2) //The last endpoint of a vertex is considered to be part of the next segment. Let that one handle it.
+            {
+                return;
+            }
+            const coord_t width_at_closest = interpolateWidth(closest_point, to_poly[to_index], to_poly[(to_index + 1) % to_poly.size()]);
+            const coord_t distance = vSize(closest_point - from_pos1) - from_width1 - width_at_closest; //Actual, accurate distance to the other polygon.
+            if(distance < best_distance)
+            {
+                PolygonConnection<Polygonal> first_connection = PolygonConnection<Polygonal>(&from_poly, from_index, from_pos1, &to_poly, to_index, closest_point);
+                std::optional<PolygonConnection<Polygonal>> second_connection = getSecondConnection(first_connection, (width_at_closest + from_width1) / 2);
+                if(second_connection) //Second connection is also valid.
+                {
+                    best_distance = distance;
+                    best_connection = first_connection;
+                    best_second_connection = second_connection;
+                }
+            }
+        }
+
+        //Also try the other way around: From the line segment of the from_poly to a vertex in the to_polygons.
+        naive_dist = LinearAlg2D::getDistFromLine(to_pos1, from_pos1, from_pos2);
+        if(naive_dist - smallest_from_width - to_width1 < line_width * max_gap)
+        {
+            const Point closest_point = LinearAlg2D::getClosestOnLineSegment(to_pos1, from_pos1, from_pos2);
+            if(closest_point == from_pos2) //The last endpoint of a vertex is considered to be part of the next segment. Let that one handle it.
+            {
+                return;
+            }
+            const coord_t width_at_closest = interpolateWidth(closest_point, from_poly[from_index], from_poly[(from_index + 1) % from_poly.size()]);
+            const coord_t distance = vSize(closest_point - to_pos1) - width_at_closest - to_width1; //Actual, accurate distance.
+            if(distance < best_distance)
+            {
+                PolygonConnection<Polygonal> first_connection = PolygonConnection<Polygonal>(&from_poly, from_index, closest_point, &to_poly, to_index, to_pos1);
+                std::optional<PolygonConnection<Polygonal>> second_connection = getSecondConnection(first_connection, (to_width1 + width_at_closest) / 2);
+                if(second_connection) //Second connection is also valid.
+                {
+                    best_distance = distance;
+                    best_connection = first_connection;
+                    best_second_connection = second_connection;
+                }
+            }
+        }
+    }
+
     /*!
      * Find the smallest connection between a polygon and a set of other
      * candidate polygons to connect to.
+     *
+     * Only the line segments of the candidates that are near the polygon are
+     * considered. They are considered in the same order as if all line
+     * segments of all candidates were compared, so that ties between equally
+     * short connections are decided in the same way.
      */
     template<typename Polygonal>
-    std::optional<PolygonBridge<Polygonal>> findConnection(Polygonal& from_poly, std::vector<Polygonal>& to_polygons)
+    std::optional<PolygonBridge<Polygonal>> findConnection(Polygonal& from_poly, CandidateSegments<Polygonal>& candidates)
     {
         //Optimise for finding the best connection.
         coord_t best_distance = line_width * max_gap; //Allow up to the max_gap.
         std::optional<PolygonConnection<Polygonal>> best_connection;
         std::optional<PolygonConnection<Polygonal>> best_second_connection;
 
-        //The smallest connection will be from one of the vertices. So go through all of the vertices to find the closest place where they approach.
-        for(size_t poly_index = 0; poly_index < to_polygons.size(); ++poly_index)
+        //Find all pairs of line segments that are close enough to each other to bridge between.
+        //Sample each line segment of the from_poly at most one search radius apart, so that every position on it is within half a radius of a sample.
+        std::vector<std::tuple<size_t, size_t, size_t>> nearby_segments; //Polygon index and segment index of the candidate, and the segment index in the from_poly.
+        const coord_t sample_distance = candidates.search_radius;
+        const coord_t sample_radius = candidates.search_radius + sample_distance / 2 + 1;
+        for(size_t from_index = 0; from_index < from_poly.size(); ++from_index)
         {
-            if(!isClosed(to_polygons[poly_index]))
-            {
-                continue;
-            }
-            for(size_t to_index = 0; to_index < to_polygons[poly_index].size(); ++to_index)
+            const Point from_pos1 = getPosition(from_poly[from_index]);
+            const Point from_pos2 = getPosition(from_poly[(from_index + 1) % from_poly.size()]);
+            const coord_t sample_count = vSize(from_pos2 - from_pos1) / sample_distance + 1;
+            for(coord_t sample_index = 0; sample_index <= sample_count; ++sample_index)
             {
-                const Point to_pos1 =  getPosition(to_polygons[poly_index][to_index]);
-                const coord_t to_width1 = getWidth(to_polygons[poly_index][to_index]);
-                const Point to_pos2 =  getPosition(to_polygons[poly_index][(to_index + 1) % to_polygons[poly_index].size()]);
-                const coord_t to_width2 = getWidth(to_polygons[poly_index][(to_index + 1) % to_polygons[poly_index].size()]);
-                const coord_t smallest_to_width = std::min(to_width1, to_width2);
-
-                for(size_t from_index = 0; from_index < from_poly.size(); ++from_index)
+                const Point sample = from_pos1 + (from_pos2 - from_pos1) * sample_index / sample_count;
+                candidates.grid.processNearby(sample, sample_radius, [&candidates, &nearby_segments, from_index](const CandidateSegment& segment)
                 {
-                    const Point from_pos1 = getPosition(from_poly[from_index]);
-                    const coord_t from_width1 = getWidth(from_poly[from_index]);
-                    const Point from_pos2 = getPosition(from_poly[(from_index + 1) % from_poly.size()]);
-                    const coord_t from_width2 = getWidth(from_poly[(from_index + 1) % from_poly.size()]);
-                    const coord_t smallest_from_width = std::min(from_width1, from_width2);
-
-                    //Try a naive distance first. Faster to compute, but it may estimate the distance too small.
-                    coord_t naive_dist = LinearAlg2D::getDistFromLine(from_pos1, to_pos1, to_pos2);
-                    if(naive_dist - from_width1 - smallest_to_width < line_width * max_gap)
-                    {
-                        const Point closest_point = LinearAlg2D::getClosestOnLineSegment(from_pos1, to_pos1, to_pos2);
-                        if(closest_point == to_pos2) //The last endpoint of a vertex is considered to be part of the next segment. Let that one handle it.
-                        {
-                            continue;
-                        }
-                        const coord_t width_at_closest = interpolateWidth(closest_point, to_polygons[poly_index][to_index], to_polygons[poly_index][(to_index + 1) % to_polygons[poly_index].size()]);
-                        const coord_t distance = vSize(closest_point - from_pos1) - from_width1 - width_at_closest; //Actual, accurate distance to the other polygon.
-                        if(distance < best_distance)
-                        {
-                            PolygonConnection<Polygonal> first_connection = PolygonConnection<Polygonal>(&from_poly, from_index, from_pos1, &to_polygons[poly_index], to_index, closest_point);
-                            std::optional<PolygonConnection<Polygonal>> second_connection = getSecondConnection(first_connection, (width_at_closest + from_width1) / 2);
-                            if(second_connection) //Second connection is also valid.
-                            {
-                                best_distance = distance;
-                                best_connection = first_connection;
-                                best_second_connection = second_connection;
-                            }
-                        }
-                    }
-
-                    //Also try the other way around: From the line segment of the from_poly to a vertex in the to_polygons.
-                    naive_dist = LinearAlg2D::getDistFromLine(to_pos1, from_pos1, from_pos2);
-                    if(naive_dist - smallest_from_width - to_width1 < line_width * max_gap)
+                    if(segment.poly_index < candidates.polygons.size() && segment.version == candidates.versions[segment.poly_index])
                     {
-                        const Point closest_point = LinearAlg2D::getClosestOnLineSegment(to_pos1, from_pos1, from_pos2);
-                        if(closest_point == from_pos2) //The last endpoint of a vertex is considered to be part of the next segment. Let that one handle it.
-                        {
-                            continue;
-                        }
-                        const coord_t width_at_closest = interpolateWidth(closest_point, from_poly[from_index], from_poly[(from_index + 1) % from_poly.size()]);
-                        const coord_t distance = vSize(closest_point - to_pos1) - width_at_closest - to_width1; //Actual, accurate distance.
-                        if(distance < best_distance)
-                        {
-                            PolygonConnection<Polygonal> first_connection = PolygonConnection<Polygonal>(&from_poly, from_index, closest_point, &to_polygons[poly_index], to_index, to_pos1);
-                            std::optional<PolygonConnection<Polygonal>> second_connection = getSecondConnection(first_connection, (to_width1 + width_at_closest) / 2);
-                            if(second_connection) //Second connection is also valid.
-                            {
-                                best_distance = distance;
-                                best_connection = first_connection;
-                                best_second_connection = second_connection;
-                            }
-                        }
+                        nearby_segments.emplace_back(segment.poly_index, segment.segment_index, from_index);
                     }
-                }
+                    return true;
+                });
             }
         }
+        std::sort(nearby_segments.begin(), nearby_segments.end());
+        nearby_segments.erase(std::unique(nearby_segments.begin(), nearby_segments.end()), nearby_segments.end());
+
+        //The smallest connection will be from one of the vertices. So go through all of the vertices to find the closest place where they approach.
+        for(const std::tuple<size_t, size_t, size_t>& nearby_segment : nearby_segments)
+        {
+            findConnectionBetweenSegments(from_poly, std::get<2>(nearby_segment), candidates.polygons[std::get<0>(nearby_segment)], std::get<1>(nearby_segment), best_distance, best_connection, best_second_connection);
+        }
 
         if(best_connection)
         {
@@ -511,7 +683,24 @@ protected:
     template<typename Polygonal>
     std::optional<PolygonBridge<Polygonal>> getBridge(Polygonal& from_poly, std::vector<Polygonal>& to_polygons)
     {
-        std::optional<PolygonBridge<Polygonal>> connection = findConnection(from_poly, to_polygons);
+        CandidateSegments<Polygonal> candidates = createCandidateSegments(to_polygons, getMaxWidth(from_poly));
+        return getBridge(from_poly, candidates);
+    }
+
+    /*!
+     * Get the bridge to cross between a polygon and the candidate polygons to
+     * connect to.
+     *
+     * This is the same as the other overload, but reuses the grid of line
+     * segments of the candidates.
+     * \param from_poly The polygon to connect.
+     * \param candidates The polygons that it may connect to, with their line
+     * segments in a grid.
+     */
+    template<typename Polygonal>
+    std::optional<PolygonBridge<Polygonal>> getBridge(Polygonal& from_poly, CandidateSegments<Polygonal>& candidates)
+    {
+        std::optional<PolygonBridge<Polygonal>> connection = findConnection(from_poly, candidates);
         if(!connection) //We didn't find a connection. No bridge.
         {
             return std::nullopt;
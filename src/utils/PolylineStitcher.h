@@ -59,15 +59,18 @@ public:
             return;
         }
 
-        SparsePointGrid<PathsPointIndex<Paths>, PathsPointIndexLocator<Paths>> grid(max_stitch_distance, lines.size() * 2);
+        SparsePointGrid<PathsPointIndex<Paths>, PathsPointIndexLocator<Paths>> grid(max_stitch_distance);
         
         // populate grid
+        std::vector<PathsPointIndex<Paths>> endpoints;
+        endpoints.reserve(lines.size() * 2);
         for (size_t line_idx = 0; line_idx < lines.size(); line_idx++)
         {
-            const auto line = lines[line_idx];
-            grid.insert(PathsPointIndex<Paths>(&lines, line_idx, 0));
-            grid.insert(PathsPointIndex<Paths>(&lines, line_idx, line.size() - 1));
+            const auto& line = lines[line_idx];
+            endpoints.emplace_back(&lines, line_idx, 0);
+            endpoints.emplace_back(&lines, line_idx, line.size() - 1);
         }
+        grid.insertAll(endpoints);
         
         std::vector<bool> processed(lines.size(), false);
         
@@ -0,0 +1,209 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For std::min and std::max.
+#include <limits>
+
+#include "PreparedPolygons.h"
+
+namespace cura
+{
+
+/*!
+ * Edges that span many bands are stored in each of them. If the bands get so
+ * thin that the edges are stored this many times on average, fewer bands are
+ * used instead.
+ */
+constexpr size_t max_copies_per_edge = 4;
+
+PreparedPolygons::PreparedPolygons()
+: min_y(0)
+, band_height(1)
+, band_count(0)
+, band_starts(1, 0)
+{
+}
+
+PreparedPolygons::PreparedPolygons(const Polygons& polygons)
+: PreparedPolygons()
+{
+    //Collect the edges of all polygons that ClipperLib::PointInPolygon doesn't skip.
+    std::vector<Edge> edges;
+    coord_t max_y = std::numeric_limits<coord_t>::min();
+    min_y = std::numeric_limits<coord_t>::max();
+    for (ConstPolygonRef polygon : polygons)
+    {
+        if (polygon.size() < 3)
+        {
+            continue;
+        }
+        Point previous = polygon.back();
+        for (const Point& vertex : polygon)
+        {
+            edges.push_back(Edge{previous, vertex});
+            min_y = std::min(min_y, vertex.Y);
+            max_y = std::max(max_y, vertex.Y);
+            previous = vertex;
+        }
+    }
+    if (edges.empty())
+    {
+        min_y = 0;
+        return;
+    }
+
+    //Find the number of bands for which the edges are not copied too often.
+    std::vector<size_t> first_band(edges.size());
+    std::vector<size_t> last_band(edges.size());
+    for (band_count = edges.size(); ; band_count = (band_count + 1) / 2)
+    {
+        band_height = (max_y - min_y) / static_cast<coord_t>(band_count) + 1;
+        size_t copies = 0;
+        for (size_t edge_idx = 0; edge_idx < edges.size(); edge_idx++)
+        {
+            first_band[edge_idx] = getBand(std::min(edges[edge_idx].from.Y, edges[edge_idx].to.Y));
+            last_band[edge_idx] = getBand(std::max(edges[edge_idx].from.Y, edges[edge_idx].to.Y));
+            copies += last_band[edge_idx] - first_band[edge_idx] + 1;
+        }
+        if (copies <= edges.size() * max_copies_per_edge || band_count == 1)
+        {
+            band_edges.resize(copies);
+            break;
+        }
+    }
+
+    //Sort the edges into their bands, keeping them in the order of the polygons within each band.
+    band_starts.assign(band_count + 1, 0);
+    for (size_t edge_idx = 0; edge_idx < edges.size(); edge_idx++)
+    {
+        for (size_t band = first_band[edge_idx]; band <= last_band[edge_idx]; band++)
+        {
+            band_starts[band + 1]++;
+        }
+    }
+    for (size_t band = 0; band < band_count; band++)
+    {
+        band_starts[band + 1] += band_starts[band];
+    }
+    std::vector<size_t> band_fill(band_starts.begin(), band_starts.end() - 1);
+    for (size_t edge_idx = 0; edge_idx < edges.size(); edge_idx++)
+    {
+        for (size_t band = first_band[edge_idx]; band <= last_band[edge_idx]; band++)
+        {
+            band_edges[band_fill[band]++] = edges[edge_idx];
+        }
+    }
+}
+
+bool PreparedPolygons::empty() const
+{
+    return band_edges.empty();
+}
+
+size_t PreparedPolygons::getBand(const coord_t y) const
+{
+    if (y < min_y)
+    {
+        return band_count;
+    }
+    const size_t band = (y - min_y) / band_height;
+    return std::min(band, band_count); //All beyond the last band.
+}
+
+PreparedPolygons::Crossing PreparedPolygons::getCrossing(const Edge& edge, const Point p)
+{
+    //The body of the loop in ClipperLib::PointInPolygon, for a single edge.
+    const Point& ip = edge.from;
+    const Point& ip_next = edge.to;
+    if (ip_next.Y == p.Y)
+    {
+        if ((ip_next.X == p.X) || (ip.Y == p.Y && ((ip_next.X > p.X) == (ip.X < p.X))))
+        {
+            return Crossing::ON_BORDER;
+        }
+    }
+    if ((ip.Y < p.Y) == (ip_next.Y < p.Y))
+    {
+        return Crossing::NONE;
+    }
+    if (ip.X >= p.X && ip_next.X > p.X)
+    {
+        return Crossing::CROSSES;
+    }
+    if (ip.X < p.X && ip_next.X <= p.X)
+    {
+        return Crossing::NONE;
+    }
+    const double d = static_cast<double>(ip.X - p.X) * (ip_next.Y - p.Y) - static_cast<double>(ip_next.X - p.X) * (ip.Y - p.Y);
+    if (d == 0)
+    {
+        return Crossing::ON_BORDER;
+    }
+    return ((d > 0) == (ip_next.Y > ip.Y)) ? Crossing::CROSSES : Crossing::NONE;
+}
+
+bool PreparedPolygons::insideBand(const size_t band, const Point p, const bool border_result) const
+{
+    if (band >= band_count)
+    {
+        return false; //Above or below all edges.
+    }
+    bool is_inside = false;
+    for (size_t edge_idx = band_starts[band]; edge_idx < band_starts[band + 1]; edge_idx++)
+    {
+        switch (getCrossing(band_edges[edge_idx], p))
+        {
+            case Crossing::CROSSES:
+                is_inside = !is_inside;
+                break;
+            case Crossing::ON_BORDER:
+                return border_result;
+            case Crossing::NONE:
+                break;
+        }
+    }
+    return is_inside;
+}
+
+bool PreparedPolygons::inside(const Point p, const bool border_result) const
+{
+    return insideBand(getBand(p.Y), p, border_result);
+}
+
+std::vector<bool> PreparedPolygons::inside(const std::vector<Point>& points, const bool border_result) const
+{
+    std::vector<bool> result(points.size(), false);
+    if (empty())
+    {
+        return result;
+    }
+
+    //Sort the points by band, so that the edges of each band are visited together.
+    std::vector<size_t> point_bands(points.size());
+    std::vector<size_t> band_point_starts(band_count + 2, 0);
+    for (size_t point_idx = 0; point_idx < points.size(); point_idx++)
+    {
+        point_bands[point_idx] = getBand(points[point_idx].Y);
+        band_point_starts[point_bands[point_idx] + 1]++;
+    }
+    for (size_t band = 0; band < band_count; band++)
+    {
+        band_point_starts[band + 1] += band_point_starts[band];
+    }
+    std::vector<size_t> sorted_points(band_point_starts[band_count]); //Only the points in a band.
+    for (size_t point_idx = 0; point_idx < points.size(); point_idx++)
+    {
+        if (point_bands[point_idx] < band_count)
+        {
+            sorted_points[band_point_starts[point_bands[point_idx]]++] = point_idx;
+        }
+    }
+
+    for (const size_t point_idx : sorted_points)
+    {
+        result[point_idx] = insideBand(point_bands[point_idx], points[point_idx], border_result);
+    }
+    return result;
+}
+
+} //namespace cura
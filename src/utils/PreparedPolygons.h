@@ -0,0 +1,120 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_PREPARED_POLYGONS_H
+#define UTILS_PREPARED_POLYGONS_H
+
+#include <vector>
+
+#include "polygon.h"
+
+namespace cura
+{
+
+/*!
+ * \brief A copy of the edges of a set of polygons, prepared to check for many
+ * points whether they are inside.
+ *
+ * \ref Polygons::inside looks at every edge for each point. This sorts the
+ * edges into horizontal bands, so that a point only needs to look at the edges
+ * that span the height of its band. Each band holds about one edge on average,
+ * so a query takes about constant time, plus the edges that are long in Y.
+ *
+ * The results are exactly the same as those of \ref Polygons::inside,
+ * including for points on the border. Preparing costs about as much as a few
+ * queries with \ref Polygons::inside, so this pays off for repeated queries on
+ * the same polygons.
+ */
+class PreparedPolygons
+{
+public:
+    /*!
+     * Prepare no polygons. Nothing is inside.
+     */
+    PreparedPolygons();
+
+    /*!
+     * Prepare a set of polygons for inside queries.
+     *
+     * The polygons are copied, so they may change or go away afterwards.
+     * \param polygons The polygons to prepare.
+     */
+    PreparedPolygons(const Polygons& polygons);
+
+    /*!
+     * Check if a point is inside the polygons, with the even-odd rule.
+     *
+     * Gives the same result as \ref Polygons::inside.
+     * \param p The point to check.
+     * \param border_result What to return when the point is exactly on the
+     * border.
+     * \return Whether the point is inside, or \p border_result if it's on the
+     * border.
+     */
+    bool inside(const Point p, const bool border_result = false) const;
+
+    /*!
+     * Check for many points whether they are inside the polygons.
+     *
+     * The points are checked in the order of their bands, so that the edges of
+     * each band are loaded once for all points in it.
+     * \param points The points to check.
+     * \param border_result What to give for points that are exactly on the
+     * border.
+     * \return For each point, whether it is inside.
+     */
+    std::vector<bool> inside(const std::vector<Point>& points, const bool border_result = false) const;
+
+    /*!
+     * Whether there are no edges, so that no point is inside.
+     */
+    bool empty() const;
+
+private:
+    /*!
+     * An edge of a polygon, in the direction of the polygon.
+     */
+    struct Edge
+    {
+        Point from;
+        Point to;
+    };
+
+    /*!
+     * What an edge contributes to the crossing count of a point.
+     */
+    enum class Crossing
+    {
+        NONE,
+        CROSSES,
+        ON_BORDER
+    };
+
+    /*!
+     * Check what one edge contributes to the crossings of a ray from a point
+     * towards positive X, in the same way as ClipperLib::PointInPolygon.
+     */
+    static Crossing getCrossing(const Edge& edge, const Point p);
+
+    /*!
+     * Get the band that a Y coordinate falls in, or \ref band_count if it's
+     * outside of all of them.
+     */
+    size_t getBand(const coord_t y) const;
+
+    /*!
+     * Check a point against the edges of its band.
+     * \param band The band that the Y coordinate of the point falls in.
+     */
+    bool insideBand(const size_t band, const Point p, const bool border_result) const;
+
+    coord_t min_y; //!< The bottom of the lowest band.
+    coord_t band_height; //!< The height of each band.
+    size_t band_count; //!< How many bands there are.
+    std::vector<size_t> band_starts; //!< For each band, where its edges start in \ref band_edges. One more for the end of the last band.
+    std::vector<Edge> band_edges; //!< The edges that overlap each band, one band after the other. Edges that span several bands are in each of them.
+};
+
+} //namespace cura
+
+#endif //UTILS_PREPARED_POLYGONS_H
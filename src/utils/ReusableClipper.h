@@ -0,0 +1,106 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_REUSABLE_CLIPPER_H
+#define UTILS_REUSABLE_CLIPPER_H
+
+#include <memory> //For unique_ptr.
+#include <polyclipping/clipper.hpp>
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Grants the use of a Clipper or ClipperOffset object for a single
+ * polygon operation.
+ *
+ * Each thread keeps one object of each type, which is reused for all polygon
+ * operations on that thread. Clearing it afterwards keeps the internal buffers
+ * of Clipper allocated, so that the many small polygon operations don't need to
+ * allocate their working memory over and over. That reduces the contention on
+ * the allocator when many threads are slicing at the same time.
+ *
+ * If the object of this thread is already in use, for instance because an
+ * operation is started while another is in progress, a new object is created
+ * instead.
+ *
+ * The object is reset to the default settings when it is released, so don't
+ * keep references to it beyond the lifetime of this instance.
+ * \tparam T Either ClipperLib::Clipper or ClipperLib::ClipperOffset.
+ */
+template<typename T>
+class ReusableClipper : public NoCopy
+{
+public:
+    ReusableClipper()
+    {
+        Slot& slot = getSlot();
+        if (! slot.in_use)
+        {
+            slot.in_use = true;
+            instance = &slot.instance;
+        }
+        else
+        {
+            fallback = std::make_unique<T>();
+            instance = fallback.get();
+        }
+    }
+
+    ~ReusableClipper()
+    {
+        if (! fallback)
+        {
+            reset(*instance);
+            getSlot().in_use = false;
+        }
+    }
+
+    T* operator->()
+    {
+        return instance;
+    }
+
+    T& operator*()
+    {
+        return *instance;
+    }
+
+private:
+    /*!
+     * The object that is kept for each thread.
+     */
+    struct Slot
+    {
+        T instance;
+        bool in_use = false;
+    };
+
+    T* instance; //!< The object to perform the operation with.
+    std::unique_ptr<T> fallback; //!< A new object, if the object of this thread was already in use.
+
+    static Slot& getSlot()
+    {
+        static thread_local Slot slot;
+        return slot;
+    }
+
+    static void reset(ClipperLib::Clipper& clipper)
+    {
+        clipper.Clear();
+        clipper.ReverseSolution(false);
+        clipper.StrictlySimple(false);
+        clipper.PreserveCollinear(false);
+    }
+
+    static void reset(ClipperLib::ClipperOffset& offsetter)
+    {
+        offsetter.Clear();
+    }
+};
+
+} //namespace cura
+
+#endif //UTILS_REUSABLE_CLIPPER_H
@@ -2,6 +2,9 @@
 //Copyright (c) 2022 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <cstdlib> //For getenv.
+#include <cstring> //For strcmp.
+#include <limits>
 #include <sstream>
 
 #include "floatpoint.h"
@@ -63,46 +66,80 @@ SVG::SVG(std::string filename, AABB aabb, double scale, Point canvas_size, Color
 , background(background)
 {
     output_is_html = strcmp(filename.c_str() + strlen(filename.c_str()) - 4, "html") == 0;
-    out = fopen(filename.c_str(), "w");
-    if(!out)
+    out = std::make_unique<AsyncOutputFile>();
+    out->open(filename.c_str());
+    if(!out->is_open())
     {
         logError("The file %s could not be opened for writing.",filename.c_str());
+        out.reset();
+        return;
     }
     if (output_is_html)
     {
-        fprintf(out, "<!DOCTYPE html><html><body>\n");
+        printf("<!DOCTYPE html><html><body>\n");
     }
     else
     {
-        fprintf(out, "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n");
+        printf("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n");
     }
-    fprintf(out, "<svg \n");
-    fprintf(out,"   xmlns=\"http://www.w3.org/2000/svg\"\n");
-    fprintf(out,"   xmlns:inkscape=\"http://www.inkscape.org/namespaces/inkscape\"\n");
-    fprintf(out,"   height=\"%f\"\n", scale * (aabb.max.Y - aabb.min.Y));
-    fprintf(out,"   width=\"%f\"\n", scale * (aabb.max.X - aabb.min.X));
-    fprintf(out,"   version=\"1.1\">\n");
-    fprintf(out,"  <g\n");
-    fprintf(out,"    inkscape:groupmode=\"layer\"\n");
-    fprintf(out,"    inkscape:label=\"layer%zu\"\n", layer_nr );
-    fprintf(out,"    id=\"layer%zu\">\n", layer_nr );
+    printf("<svg \n");
+    printf("   xmlns=\"http://www.w3.org/2000/svg\"\n");
+    printf("   xmlns:inkscape=\"http://www.inkscape.org/namespaces/inkscape\"\n");
+    printf("   height=\"%f\"\n", scale * (aabb.max.Y - aabb.min.Y));
+    printf("   width=\"%f\"\n", scale * (aabb.max.X - aabb.min.X));
+    printf("   version=\"1.1\">\n");
+    printf("  <g\n");
+    printf("    inkscape:groupmode=\"layer\"\n");
+    printf("    inkscape:label=\"layer%zu\"\n", layer_nr );
+    printf("    id=\"layer%zu\">\n", layer_nr );
 
     if (!background.is_enum || background.color != Color::NONE)
     {
-        fprintf(out, "<rect width=\"100%%\" height=\"100%%\" fill=\"%s\"/>\n", toString(background).c_str());
+        printf("<rect width=\"100%%\" height=\"100%%\" fill=\"%s\"/>\n", toString(background).c_str());
     }
 
 }
 
 SVG::~SVG()
 {
-    fprintf(out, "  </g>\n");
-    fprintf(out, "</svg>\n");
+    printf("  </g>\n");
+    printf("</svg>\n");
     if (output_is_html)
     {
-        fprintf(out, "</body></html>");
+        printf("</body></html>");
     }
-    fclose(out);
+    //The output file writes everything that remains when it's destroyed.
+}
+
+bool SVG::isLayerEnabled(const LayerIndex layer_nr)
+{
+    //Parse the environment variable only once.
+    static const std::pair<LayerIndex, LayerIndex> enabled_range = []()
+    {
+        std::pair<LayerIndex, LayerIndex> range(std::numeric_limits<int>::lowest(), std::numeric_limits<int>::max());
+        const char* layers = getenv("CURA_ENGINE_SVG_LAYERS");
+        if (layers && *layers)
+        {
+            long first = 0;
+            long last = 0;
+            const int parsed = sscanf(layers, "%ld-%ld", &first, &last);
+            if (parsed >= 1)
+            {
+                range = std::make_pair(LayerIndex(first), LayerIndex(parsed == 2 ? last : first));
+            }
+            else
+            {
+                logWarning("Couldn't read the layers to draw from CURA_ENGINE_SVG_LAYERS=%s. Use a layer number or a range like 10-20.\n", layers);
+            }
+        }
+        return range;
+    }();
+    return layer_nr >= enabled_range.first && layer_nr <= enabled_range.second;
+}
+
+std::string SVG::getLayerFilename(const std::string& name, const LayerIndex layer_nr)
+{
+    return name + "_layer" + std::to_string(layer_nr.value) + ".svg";
 }
 
 double SVG::getScale() const
@@ -112,12 +149,12 @@ double SVG::getScale() const
 
 void SVG::nextLayer()
 {
-    fprintf(out, "  </g>\n");
+    printf("  </g>\n");
     layer_nr++;
-    fprintf(out,"  <g\n");
-    fprintf(out,"    inkscape:groupmode=\"layer\"\n");
-    fprintf(out,"    inkscape:label=\"layer%zu\"\n", layer_nr );
-    fprintf(out,"    id=\"layer%zu\">\n", layer_nr );
+    printf("  <g\n");
+    printf("    inkscape:groupmode=\"layer\"\n");
+    printf("    inkscape:label=\"layer%zu\"\n", layer_nr );
+    printf("    id=\"layer%zu\">\n", layer_nr );
 }
 
 Point SVG::transform(const Point& p) const
@@ -132,7 +169,7 @@ FPoint3 SVG::transformF(const Point& p) const
 
 void SVG::writeComment(const std::string& comment) const
 {
-    fprintf(out, "<!-- %s -->\n", comment.c_str());
+    printf("<!-- %s -->\n", comment.c_str());
 }
 
 void SVG::writeAreas(const Polygons& polygons, const ColorObject color, const ColorObject outline_color, const float stroke_width) const
@@ -143,39 +180,39 @@ void SVG::writeAreas(const Polygons& polygons, const ColorObject color, const Co
         PolygonsPart& parts = *part_it;
         for (unsigned int j = 0; j < parts.size(); j++)
         {
-            fprintf(out, "<polygon points=\"");
+            printf("<polygon points=\"");
             for (Point& p : parts[j])
             {
                 FPoint3 fp = transformF(p);
-                fprintf(out, "%f,%f ", fp.x, fp.y);
+                printf("%f,%f ", fp.x, fp.y);
             }
             if (j == 0)
-                fprintf(out, "\" style=\"fill:%s;stroke:%s;stroke-width:%f\" />\n", toString(color).c_str(), toString(outline_color).c_str(), stroke_width);
+                printf("\" style=\"fill:%s;stroke:%s;stroke-width:%f\" />\n", toString(color).c_str(), toString(outline_color).c_str(), stroke_width);
             else
-                fprintf(out, "\" style=\"fill:white;stroke:%s;stroke-width:%f\" />\n", toString(outline_color).c_str(), stroke_width);
+                printf("\" style=\"fill:white;stroke:%s;stroke-width:%f\" />\n", toString(outline_color).c_str(), stroke_width);
         }
     }
 }
 
 void SVG::writeAreas(ConstPolygonRef polygon, const ColorObject color, const ColorObject outline_color, const float stroke_width) const
 {
-    fprintf(out,"<polygon fill=\"%s\" stroke=\"%s\" stroke-width=\"%f\" points=\"",toString(color).c_str(),toString(outline_color).c_str(), stroke_width); //The beginning of the polygon tag.
+    printf("<polygon fill=\"%s\" stroke=\"%s\" stroke-width=\"%f\" points=\"",toString(color).c_str(),toString(outline_color).c_str(), stroke_width); //The beginning of the polygon tag.
     for (const Point& point : polygon) //Add every point to the list of points.
     {
         FPoint3 transformed = transformF(point);
-        fprintf(out,"%f,%f ",transformed.x,transformed.y);
+        printf("%f,%f ",transformed.x,transformed.y);
     }
-    fprintf(out,"\" />\n"); //The end of the polygon tag.
+    printf("\" />\n"); //The end of the polygon tag.
 }
 
 void SVG::writePoint(const Point& p, const bool write_coords, const float size, const ColorObject color) const
 {
     FPoint3 pf = transformF(p);
-    fprintf(out, "<circle cx=\"%f\" cy=\"%f\" r=\"%f\" stroke-width=\"0\" fill=\"%s\" />\n",pf.x, pf.y, size, toString(color).c_str());
+    printf("<circle cx=\"%f\" cy=\"%f\" r=\"%f\" stroke-width=\"0\" fill=\"%s\" />\n",pf.x, pf.y, size, toString(color).c_str());
     
     if (write_coords)
     {
-        fprintf(out, "<text x=\"%f\" y=\"%f\" style=\"font-size: 10px;\" fill=\"black\">%lli,%lli</text>\n",pf.x, pf.y, p.X, p.Y);
+        printf("<text x=\"%f\" y=\"%f\" style=\"font-size: 10px;\" fill=\"black\">%lli,%lli</text>\n",pf.x, pf.y, p.X, p.Y);
     }
 }
 
@@ -203,20 +240,20 @@ void SVG::writeLines(const std::vector<Point>& polyline, const ColorObject color
     }
     
     FPoint3 transformed = transformF(polyline[0]); //Element 0 must exist due to the check above.
-    fprintf(out,"<path fill=\"none\" stroke=\"%s\" stroke-width=\"1\" d=\"M%f,%f", toString(color).c_str(), transformed.x, transformed.y); //Write the start of the path tag and the first endpoint.
+    printf("<path fill=\"none\" stroke=\"%s\" stroke-width=\"1\" d=\"M%f,%f", toString(color).c_str(), transformed.x, transformed.y); //Write the start of the path tag and the first endpoint.
     for(size_t point = 1;point < polyline.size();point++)
     {
         transformed = transformF(polyline[point]);
-        fprintf(out,"L%f,%f", transformed.x, transformed.y); //Write a line segment to the next point.
+        printf("L%f,%f", transformed.x, transformed.y); //Write a line segment to the next point.
     }
-    fprintf(out,"\" />\n"); //Write the end of the tag.
+    printf("\" />\n"); //Write the end of the tag.
 }
 
 void SVG::writeLine(const Point& a, const Point& b, const ColorObject color, const float stroke_width) const
 {
     FPoint3 fa = transformF(a);
     FPoint3 fb = transformF(b);
-    fprintf(out, "<line x1=\"%f\" y1=\"%f\" x2=\"%f\" y2=\"%f\" style=\"stroke:%s;stroke-width:%f\" />\n", fa.x, fa.y, fb.x, fb.y, toString(color).c_str(), stroke_width);
+    printf("<line x1=\"%f\" y1=\"%f\" x2=\"%f\" y2=\"%f\" style=\"stroke:%s;stroke-width:%f\" />\n", fa.x, fa.y, fb.x, fb.y, toString(color).c_str(), stroke_width);
 }
 
 void SVG::writeArrow(const Point& a, const Point& b, const ColorObject color, const float stroke_width, const float head_size) const
@@ -230,27 +267,27 @@ void SVG::writeArrow(const Point& a, const Point& b, const ColorObject color, co
     FPoint3 tip = fb + normal * head_size - direction * head_size;
     FPoint3 b_base = fb + normal * stroke_width - direction * stroke_width * 2.41;
     FPoint3 a_base = fa + normal * stroke_width;
-    fprintf(out, "<polygon fill=\"%s\" points=\"%f,%f %f,%f %f,%f %f,%f %f,%f\" />", toString(color).c_str(), fa.x, fa.y, fb.x, fb.y, tip.x, tip.y, b_base.x, b_base.y, a_base.x, a_base.y);
+    printf("<polygon fill=\"%s\" points=\"%f,%f %f,%f %f,%f %f,%f %f,%f\" />", toString(color).c_str(), fa.x, fa.y, fb.x, fb.y, tip.x, tip.y, b_base.x, b_base.y, a_base.x, a_base.y);
 }
 
 void SVG::writeLineRGB(const Point& from, const Point& to, const int r, const int g, const int b, const float stroke_width) const
 {
     FPoint3 fa = transformF(from);
     FPoint3 fb = transformF(to);
-    fprintf(out, "<line x1=\"%f\" y1=\"%f\" x2=\"%f\" y2=\"%f\" style=\"stroke:rgb(%i,%i,%i);stroke-width:%f\" />\n", fa.x, fa.y, fb.x, fb.y, r, g, b, stroke_width);
+    printf("<line x1=\"%f\" y1=\"%f\" x2=\"%f\" y2=\"%f\" style=\"stroke:rgb(%i,%i,%i);stroke-width:%f\" />\n", fa.x, fa.y, fb.x, fb.y, r, g, b, stroke_width);
 }
 
 void SVG::writeDashedLine(const Point& a, const Point& b, ColorObject color) const
 {
     FPoint3 fa = transformF(a);
     FPoint3 fb = transformF(b);
-    fprintf(out,"<line x1=\"%f\" y1=\"%f\" x2=\"%f\" y2=\"%f\" stroke=\"%s\" stroke-width=\"1\" stroke-dasharray=\"5,5\" />\n",fa.x,fa.y,fb.x,fb.y,toString(color).c_str());
+    printf("<line x1=\"%f\" y1=\"%f\" x2=\"%f\" y2=\"%f\" stroke=\"%s\" stroke-width=\"1\" stroke-dasharray=\"5,5\" />\n",fa.x,fa.y,fb.x,fb.y,toString(color).c_str());
 }
 
 void SVG::writeText(const Point& p, const std::string& txt, const ColorObject color, const float font_size) const
 {
     FPoint3 pf = transformF(p);
-    fprintf(out, "<text x=\"%f\" y=\"%f\" style=\"font-size: %fpx;\" fill=\"%s\">%s</text>\n",pf.x, pf.y, font_size, toString(color).c_str(), txt.c_str());
+    printf("<text x=\"%f\" y=\"%f\" style=\"font-size: %fpx;\" fill=\"%s\">%s</text>\n",pf.x, pf.y, font_size, toString(color).c_str(), txt.c_str());
 }
 
 void SVG::writePolygons(const Polygons& polys, const ColorObject color, const float stroke_width) const
@@ -370,7 +407,7 @@ void SVG::writeLine(const ExtrusionLine& line, const ColorObject color, const fl
         const FPoint3 end_left = transformF(end_vertex.p + normal(direction_left, std::max(minimum_line_width, end_vertex.w * width_factor)));
         const FPoint3 end_right = transformF(end_vertex.p + normal(direction_right, std::max(minimum_line_width, end_vertex.w * width_factor)));
 
-        fprintf(out, "<polygon fill=\"%s\" points=\"%f,%f %f,%f %f,%f %f,%f\" />\n", toString(color).c_str(), start_left.x, start_left.y, start_right.x, start_right.y, end_right.x, end_right.y, end_left.x, end_left.y);
+        printf("<polygon fill=\"%s\" points=\"%f,%f %f,%f %f,%f %f,%f\" />\n", toString(color).c_str(), start_left.x, start_left.y, start_right.x, start_right.y, end_right.x, end_right.y, end_left.x, end_left.y);
 
         start_vertex = end_vertex; //For the next line segment.
     }
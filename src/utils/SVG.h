@@ -4,18 +4,34 @@
 #ifndef SVG_H
 #define SVG_H
 
-#include <stdio.h> // for file output
+#include <cstdio> //For snprintf.
+#include <memory> //For unique_ptr.
+#include <string>
 
 #include "AABB.h"
+#include "AsyncOutputFile.h" //To write on a separate thread.
 #include "ExtrusionLine.h" //To accept variable-width paths.
 #include "IntPoint.h"
 #include "NoCopy.h"
+#include "../settings/types/LayerIndex.h"
 
 namespace cura
 {
 
 class FPoint3;
 
+/*!
+ * \brief Debug output of geometry as an SVG image.
+ *
+ * The file is written on a separate thread, so that drawing doesn't wait on
+ * the disk. If the file can't be opened, nothing is drawn.
+ *
+ * To look at a few layers of a large print, draw into a file per layer with
+ * \ref SVG::getLayerFilename and only for the layers where
+ * \ref SVG::isLayerEnabled. The layers are chosen with the environment
+ * variable CURA_ENGINE_SVG_LAYERS, as a single layer number or a range such as
+ * "10-20".
+ */
 class SVG : NoCopy
 {
 public:
@@ -55,7 +71,7 @@ private:
     std::string toString(const Color color) const;
     std::string toString(const ColorObject& color) const;
 
-    FILE* out; // the output file
+    std::unique_ptr<AsyncOutputFile> out; // the output file, or nullptr if it couldn't be opened
     const AABB aabb; // the boundary box to display
     const Point aabb_size;
     const Point canvas_size;
@@ -72,6 +88,23 @@ public:
 
     ~SVG();
 
+    /*!
+     * Whether debug output should be drawn for a layer, as chosen with the
+     * environment variable CURA_ENGINE_SVG_LAYERS.
+     *
+     * If the variable is not set, all layers are drawn.
+     * \param layer_nr The layer to draw.
+     */
+    static bool isLayerEnabled(const LayerIndex layer_nr);
+
+    /*!
+     * Get the name of a file with the debug output of one layer.
+     * \param name What is drawn, such as "walls".
+     * \param layer_nr The layer that is drawn.
+     * \return The file name, such as "walls_layer12.svg".
+     */
+    static std::string getLayerFilename(const std::string& name, const LayerIndex layer_nr);
+
     /*!
      * get the scaling factor applied to convert real space to canvas space
      */
@@ -193,7 +226,26 @@ public:
 template<typename... Args>
 void SVG::printf(const char* txt, Args&&... args) const
 {
-    fprintf(out, txt, args...);
+    if (!out)
+    {
+        return;
+    }
+    char buffer[512]; //Enough for any element but long texts and comments.
+    const int length = std::snprintf(buffer, sizeof(buffer), txt, args...);
+    if (length < 0)
+    {
+        return;
+    }
+    if (static_cast<size_t>(length) < sizeof(buffer))
+    {
+        out->write(buffer, length);
+    }
+    else
+    {
+        std::string long_text(length + 1, '\0');
+        std::snprintf(&long_text[0], long_text.size(), txt, args...);
+        out->write(long_text.data(), length);
+    }
 }
 
 } // namespace cura
@@ -2,7 +2,6 @@
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
 #include <limits>
-#include <queue> //Priority queue to prioritise removing unimportant vertices.
 
 #include "Simplify.h"
 
@@ -23,12 +22,8 @@ Simplify::Simplify(const Settings& settings)
 
 Polygons Simplify::polygon(const Polygons& polygons) const
 {
-    Polygons result;
-    for(size_t i = 0; i < polygons.size(); ++i)
-    {
-        result.add(polygon(polygons[i]));
-    }
-    return result;
+    constexpr bool is_closed = true;
+    return simplifyBatch(polygons, is_closed);
 }
 
 Polygon Simplify::polygon(const Polygon& polygon) const
@@ -37,20 +32,28 @@ Polygon Simplify::polygon(const Polygon& polygon) const
     return simplify(polygon, is_closed);
 }
 
+Polygon Simplify::polygon(Polygon&& polygon, Scratch& scratch) const
+{
+    constexpr bool is_closed = true;
+    return simplify(polygon, is_closed, scratch);
+}
+
 ExtrusionLine Simplify::polygon(const ExtrusionLine& polygon) const
 {
     constexpr bool is_closed = true;
     return simplify(polygon, is_closed);
 }
 
+VariableWidthLines Simplify::polygon(const VariableWidthLines& polygons) const
+{
+    constexpr bool is_closed = true;
+    return simplifyBatch(polygons, is_closed);
+}
+
 Polygons Simplify::polyline(const Polygons& polylines) const
 {
-    Polygons result;
-    for(size_t i = 0; i < polylines.size(); ++i)
-    {
-        result.add(polyline(polylines[i]));
-    }
-    return result;
+    constexpr bool is_closed = false;
+    return simplifyBatch(polylines, is_closed);
 }
 
 Polygon Simplify::polyline(const Polygon& polyline) const
@@ -65,6 +68,108 @@ ExtrusionLine Simplify::polyline(const ExtrusionLine& polyline) const
     return simplify(polyline, is_closed);
 }
 
+VariableWidthLines Simplify::polyline(const VariableWidthLines& polylines) const
+{
+    constexpr bool is_closed = false;
+    return simplifyBatch(polylines, is_closed);
+}
+
+Polygons Simplify::simplifyBatch(const Polygons& polygons, const bool is_closed) const
+{
+    std::vector<size_t> vertex_counts;
+    vertex_counts.reserve(polygons.size());
+    for(ConstPolygonRef polygon : polygons)
+    {
+        vertex_counts.push_back(polygon.size());
+    }
+    const std::vector<size_t> batch_starts = divideInBatches(vertex_counts);
+
+    std::vector<Polygon> simplified(polygons.size());
+    const auto simplify_batch = [&](const size_t batch_idx)
+    {
+        Scratch scratch;
+        for(size_t i = batch_starts[batch_idx]; i < batch_starts[batch_idx + 1]; ++i)
+        {
+            Polygon working = polygons[i]; //Make a copy so that we can also shift vertices.
+            simplified[i] = simplify(working, is_closed, scratch);
+        }
+    };
+    if(batch_starts.size() <= 2) //Only one batch. Don't bother starting a thread for it.
+    {
+        simplify_batch(0);
+    }
+    else
+    {
+        //This is called from the parallel loops over the layers too. OpenMP doesn't nest by default, so there it runs on the thread of the layer.
+        #pragma omp parallel for default(none) shared(batch_starts, simplify_batch) schedule(dynamic)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int batch_idx = 0; batch_idx < static_cast<int>(batch_starts.size()) - 1; batch_idx++)
+        {
+            simplify_batch(batch_idx);
+        }
+    }
+
+    Polygons result;
+    for(Polygon& polygon : simplified)
+    {
+        result.add(std::move(polygon));
+    }
+    return result;
+}
+
+VariableWidthLines Simplify::simplifyBatch(const VariableWidthLines& polygons, const bool is_closed) const
+{
+    std::vector<size_t> vertex_counts;
+    vertex_counts.reserve(polygons.size());
+    for(const ExtrusionLine& polygon : polygons)
+    {
+        vertex_counts.push_back(polygon.size());
+    }
+    const std::vector<size_t> batch_starts = divideInBatches(vertex_counts);
+
+    VariableWidthLines result(polygons);  //Make a copy so that we can also shift vertices.
+    const auto simplify_batch = [&](const size_t batch_idx)
+    {
+        Scratch scratch;
+        for(size_t i = batch_starts[batch_idx]; i < batch_starts[batch_idx + 1]; ++i)
+        {
+            result[i] = simplify(result[i], is_closed, scratch);
+        }
+    };
+    if(batch_starts.size() <= 2) //Only one batch. Don't bother starting a thread for it.
+    {
+        simplify_batch(0);
+    }
+    else
+    {
+        //This is called from the parallel loops over the layers too. OpenMP doesn't nest by default, so there it runs on the thread of the layer.
+        #pragma omp parallel for default(none) shared(batch_starts, simplify_batch) schedule(dynamic)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int batch_idx = 0; batch_idx < static_cast<int>(batch_starts.size()) - 1; batch_idx++)
+        {
+            simplify_batch(batch_idx);
+        }
+    }
+    return result;
+}
+
+std::vector<size_t> Simplify::divideInBatches(const std::vector<size_t>& vertex_counts) const
+{
+    std::vector<size_t> batch_starts = { 0 };
+    size_t vertices_in_batch = 0;
+    for(size_t i = 0; i < vertex_counts.size(); ++i)
+    {
+        if(vertices_in_batch >= parallel_batch_vertex_count)
+        {
+            batch_starts.push_back(i);
+            vertices_in_batch = 0;
+        }
+        vertices_in_batch += vertex_counts[i];
+    }
+    batch_starts.push_back(vertex_counts.size());
+    return batch_starts;
+}
+
 size_t Simplify::nextNotDeleted(size_t index, const std::vector<bool>& to_delete) const
 {
     const size_t size = to_delete.size();
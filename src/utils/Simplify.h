@@ -4,6 +4,10 @@
 #ifndef UTILS_SIMPLIFY_H
 #define UTILS_SIMPLIFY_H
 
+#include <algorithm> //For the heap operations.
+#include <utility> //For std::pair.
+#include <vector>
+
 #include "polygon.h"
 #include "ExtrusionLine.h"
 #include "linearAlg2D.h" //To calculate line deviations and intersecting lines.
@@ -74,6 +78,30 @@ public:
      */
     Polygon polygon(const Polygon& polygon) const;
 
+    /*!
+     * Buffers used while simplifying a polygonal chain.
+     *
+     * When a batch of polygons is simplified, these are reused for each polygon
+     * so that they don't need to be allocated again every time.
+     */
+    struct Scratch
+    {
+        std::vector<bool> to_delete; //!< For each vertex, whether it is set to be deleted.
+        std::vector<std::pair<size_t, coord_t>> by_importance; //!< Heap of the vertices by their importance, with the least important on top.
+    };
+
+    /*!
+     * Simplify a polygon in-place, reusing buffers from earlier calls.
+     *
+     * This avoids allocating the working memory again for each polygon when
+     * many polygons are simplified one by one.
+     * \param polygon The polygon to simplify. Its vertices may get shifted, so
+     * the simplified polygon should be used instead afterwards.
+     * \param scratch Buffers to use during the simplification.
+     * \return The simplified polygon. If it's degenerate, it's empty.
+     */
+    Polygon polygon(Polygon&& polygon, Scratch& scratch) const;
+
     /*!
      * Simplify a variable-line-width polygon.
      * \param polygon The polygon to simplify.
@@ -81,6 +109,13 @@ public:
      */
     ExtrusionLine polygon(const ExtrusionLine& polygon) const;
 
+    /*!
+     * Simplify a batch of variable-line-width polygons.
+     * \param polygons The polygons to simplify.
+     * \return The simplified polygons.
+     */
+    VariableWidthLines polygon(const VariableWidthLines& polygons) const;
+
     /*!
      * Simplify a batch of polylines.
      *
@@ -108,6 +143,15 @@ public:
      */
     ExtrusionLine polyline(const ExtrusionLine& polyline) const;
 
+    /*!
+     * Simplify a batch of variable-line-width polylines.
+     *
+     * The endpoints of each polyline cannot be altered.
+     * \param polylines The polylines to simplify.
+     * \return The simplified polylines.
+     */
+    VariableWidthLines polyline(const VariableWidthLines& polylines) const;
+
     /*!
      * Line segments shorter than this size should be considered for removal.
      */
@@ -133,6 +177,12 @@ protected:
      */
     constexpr static coord_t min_resolution = 5; //5 units, regardless of how big those are, to allow for rounding errors.
 
+    /*!
+     * Polygons with more vertices than this are simplified in separate
+     * threads, in batches of about this many vertices.
+     */
+    constexpr static size_t parallel_batch_vertex_count = 100000;
+
     /*!
      * The main simplification algorithm starts here.
      * \tparam Polygonal A polygonal object, which is a list of vertices.
@@ -142,6 +192,23 @@ protected:
      */
     template<typename Polygonal>
     Polygonal simplify(const Polygonal& polygon, const bool is_closed) const
+    {
+        Scratch scratch;
+        Polygonal result = polygon; //Make a copy so that we can also shift vertices.
+        return simplify(result, is_closed, scratch);
+    }
+
+    /*!
+     * Simplify a polygonal chain in-place, using the given buffers.
+     * \tparam Polygonal A polygonal object, which is a list of vertices.
+     * \param polygon The polygonal chain to simplify. Its vertices may get
+     * shifted, so the simplified chain should be used instead afterwards.
+     * \param is_closed Whether this is a closed polygon or an open polyline.
+     * \param scratch Buffers to use during the simplification.
+     * \return A simplified polygonal chain.
+     */
+    template<typename Polygonal>
+    Polygonal simplify(Polygonal& polygon, const bool is_closed, Scratch& scratch) const
     {
         const size_t min_size = is_closed ? 3 : 2;
         if(polygon.size() < min_size) //For polygon, 2 or fewer vertices is degenerate. Delete it. For polyline, 1 vertex is degenerate.
@@ -150,58 +217,90 @@ protected:
         }
         if(polygon.size() == min_size) //For polygon, don't reduce below 3. For polyline, not below 2.
         {
-            return polygon;
+            return std::move(polygon);
         }
 
-        std::vector<bool> to_delete(polygon.size(), false);
+        std::vector<bool>& to_delete = scratch.to_delete;
+        to_delete.assign(polygon.size(), false);
         auto comparator = [](const std::pair<size_t, coord_t>& vertex_a, const std::pair<size_t, coord_t>& vertex_b)
         {
             return vertex_a.second > vertex_b.second || (vertex_a.second == vertex_b.second && vertex_a.first > vertex_b.first);
         };
-        std::priority_queue<std::pair<size_t, coord_t>, std::vector<std::pair<size_t, coord_t>>, decltype(comparator)> by_importance(comparator);
+        std::vector<std::pair<size_t, coord_t>>& by_importance = scratch.by_importance; //Used as a priority queue, but it keeps its memory between polygons.
+        by_importance.clear();
 
         //Add the initial points.
         for(size_t i = 0; i < polygon.size(); ++i)
         {
             const coord_t vertex_importance = importance(polygon, to_delete, i, is_closed);
-            by_importance.emplace(i, vertex_importance);
+            by_importance.emplace_back(i, vertex_importance);
+            std::push_heap(by_importance.begin(), by_importance.end(), comparator);
         }
 
         //Iteratively remove the least important point until a threshold.
-        Polygonal result = polygon; //Make a copy so that we can also shift vertices.
         coord_t vertex_importance = 0;
         while(by_importance.size() > min_size)
         {
-            std::pair<size_t, coord_t> vertex = by_importance.top();
-            by_importance.pop();
+            std::pop_heap(by_importance.begin(), by_importance.end(), comparator);
+            std::pair<size_t, coord_t> vertex = by_importance.back();
+            by_importance.pop_back();
             //The importance may have changed since this vertex was inserted. Re-compute it now.
             //If it doesn't change, it's safe to process.
-            vertex_importance = importance(result, to_delete, vertex.first, is_closed);
+            vertex_importance = importance(polygon, to_delete, vertex.first, is_closed);
             if(vertex_importance != vertex.second)
             {
-                by_importance.emplace(vertex.first, vertex_importance); //Re-insert with updated importance.
+                by_importance.emplace_back(vertex.first, vertex_importance); //Re-insert with updated importance.
+                std::push_heap(by_importance.begin(), by_importance.end(), comparator);
                 continue;
             }
 
             if(vertex_importance <= max_deviation * max_deviation)
             {
-                remove(result, to_delete, vertex.first, vertex_importance, is_closed);
+                remove(polygon, to_delete, vertex.first, vertex_importance, is_closed);
             }
         }
 
         //Now remove the marked vertices in one sweep.
         Polygonal filtered = createEmpty(polygon);
-        for(size_t i = 0; i < result.size(); ++i)
+        for(size_t i = 0; i < polygon.size(); ++i)
         {
             if(!to_delete[i])
             {
-                appendVertex(filtered, result[i]);
+                appendVertex(filtered, polygon[i]);
             }
         }
 
         return filtered;
     }
 
+    /*!
+     * Simplify a batch of polygons or polylines.
+     *
+     * The buffers for the simplification are reused for all polygons. If the
+     * batch is large, parts of it are simplified in parallel.
+     * \param polygons The polygons or polylines to simplify.
+     * \param is_closed Whether these are closed polygons or open polylines.
+     * \return The simplified polygons, in the same order.
+     */
+    Polygons simplifyBatch(const Polygons& polygons, const bool is_closed) const;
+
+    /*!
+     * Simplify a batch of variable-line-width polygons or polylines.
+     * \param polygons The polygons or polylines to simplify.
+     * \param is_closed Whether these are closed polygons or open polylines.
+     * \return The simplified polygons, in the same order.
+     */
+    VariableWidthLines simplifyBatch(const VariableWidthLines& polygons, const bool is_closed) const;
+
+    /*!
+     * Divide a batch of polygons in parts of about
+     * \ref parallel_batch_vertex_count vertices, to simplify in parallel.
+     * \param vertex_counts The number of vertices of each polygon.
+     * \return Where each part starts, as index in the polygons. The number of
+     * polygons is appended to mark the end of the last part.
+     */
+    std::vector<size_t> divideInBatches(const std::vector<size_t>& vertex_counts) const;
+
     /*!
      * A measure of the importance of a vertex.
      * \tparam Polygonal A polygonal object, which is a list of vertices.
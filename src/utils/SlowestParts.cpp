@@ -0,0 +1,153 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For the heap functions and std::sort.
+#include <atomic>
+#include <iterator> //For back_inserter.
+#include <memory> //For shared_ptr.
+#include <mutex>
+
+#include "logoutput.h"
+#include "SlowestParts.h"
+#include "SVG.h" //To draw the outlines of the slowest parts.
+
+namespace cura
+{
+
+namespace
+{
+
+/*!
+ * Orders the entries such that the fastest one is at the top of a heap, to be
+ * replaced first when a slower one comes along.
+ */
+bool isSlower(const SlowestParts::Entry& a, const SlowestParts::Entry& b)
+{
+    return a.seconds > b.seconds;
+}
+
+/*!
+ * The slowest parts that one thread recorded, as a heap with the fastest of
+ * them on top.
+ */
+struct ThreadEntries
+{
+    std::vector<SlowestParts::Entry> entries;
+};
+
+std::atomic<size_t> report_count(0); //!< How many parts to report. 0 if not recording.
+std::string svg_directory; //!< Where to draw the outlines of the reported parts, if anywhere.
+std::mutex threads_mutex; //!< Guards the list of threads.
+std::vector<std::shared_ptr<ThreadEntries>> threads; //!< The entries of all threads that recorded any. Kept alive after a thread ends, until they are reported.
+
+ThreadEntries& getThreadEntries()
+{
+    thread_local std::shared_ptr<ThreadEntries> thread_entries;
+    if (!thread_entries)
+    {
+        thread_entries = std::make_shared<ThreadEntries>();
+        std::lock_guard<std::mutex> lock(threads_mutex);
+        threads.push_back(thread_entries);
+    }
+    return *thread_entries;
+}
+
+}
+
+void SlowestParts::start(const size_t count, const std::string& directory)
+{
+    svg_directory = directory;
+    report_count.store(count, std::memory_order_release);
+}
+
+bool SlowestParts::isEnabled()
+{
+    return report_count.load(std::memory_order_relaxed) > 0;
+}
+
+void SlowestParts::record(const char* stage, const int layer_nr, const char* mesh_name, const int part_nr, const double seconds, const Polygons* outline)
+{
+    const size_t count = report_count.load(std::memory_order_relaxed);
+    std::vector<Entry>& entries = getThreadEntries().entries;
+    if (entries.size() >= count)
+    {
+        if (entries.empty() || entries.front().seconds >= seconds) //Not slower than any of the slowest so far.
+        {
+            return;
+        }
+        std::pop_heap(entries.begin(), entries.end(), isSlower);
+        entries.pop_back();
+    }
+    entries.push_back(Entry{stage, layer_nr, mesh_name, part_nr, seconds, outline ? *outline : Polygons()});
+    std::push_heap(entries.begin(), entries.end(), isSlower);
+}
+
+std::vector<SlowestParts::Entry> SlowestParts::report()
+{
+    std::vector<Entry> result;
+    {
+        std::lock_guard<std::mutex> lock(threads_mutex);
+        for (const std::shared_ptr<ThreadEntries>& thread_entries : threads)
+        {
+            std::move(thread_entries->entries.begin(), thread_entries->entries.end(), std::back_inserter(result));
+            thread_entries->entries.clear();
+        }
+    }
+    std::sort(result.begin(), result.end(), isSlower);
+    result.resize(std::min(result.size(), report_count.load(std::memory_order_relaxed)));
+    if (result.empty())
+    {
+        return result;
+    }
+
+    log("Slowest layers and parts:\n");
+    for (size_t rank = 0; rank < result.size(); rank++)
+    {
+        const Entry& entry = result[rank];
+        std::string where = "layer " + std::to_string(entry.layer_nr);
+        if (!entry.mesh_name.empty())
+        {
+            where += ", mesh " + entry.mesh_name;
+        }
+        if (entry.part_nr != no_part)
+        {
+            where += ", part " + std::to_string(entry.part_nr);
+        }
+        log("  %2zu. %8.3fs %-24s %s\n", rank + 1, entry.seconds, entry.stage, where.c_str());
+
+        if (!svg_directory.empty() && !entry.outline.empty() && SVG::isLayerEnabled(entry.layer_nr))
+        {
+            std::string stage = entry.stage;
+            std::replace(stage.begin(), stage.end(), ' ', '_');
+            const std::string filename = svg_directory + "/" + SVG::getLayerFilename("slowest_" + std::to_string(rank + 1) + "_" + stage, entry.layer_nr);
+            SVG svg(filename, AABB(entry.outline));
+            svg.writeComment(where);
+            svg.writeAreas(entry.outline);
+        }
+    }
+    return result;
+}
+
+PartZone::PartZone(const char* stage, const int layer_nr, const char* mesh_name, const int part_nr, const Polygons* outline)
+: stage(stage)
+, layer_nr(layer_nr)
+, mesh_name(mesh_name)
+, part_nr(part_nr)
+, outline(outline)
+, is_recording(SlowestParts::isEnabled())
+{
+    if (is_recording)
+    {
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+PartZone::~PartZone()
+{
+    if (is_recording)
+    {
+        SlowestParts::record(stage, layer_nr, mesh_name, part_nr, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), outline);
+    }
+}
+
+} //namespace cura
@@ -0,0 +1,129 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_SLOWEST_PARTS_H
+#define UTILS_SLOWEST_PARTS_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "NoCopy.h"
+#include "polygon.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Keeps the layers and parts that took the longest in each stage of the
+ * slicing, to report which of them make a slow slice slow without running it
+ * in a profiler.
+ *
+ * Recording is off until \ref start is called. Until then, a \ref PartZone
+ * costs only a check of whether recording is enabled.
+ *
+ * Each thread keeps its own slowest parts, so recording doesn't make the
+ * threads wait for each other. The outline of a part is only copied if it is
+ * among the slowest parts of its thread so far.
+ */
+class SlowestParts
+{
+public:
+    static constexpr int no_part = -1; //!< For zones about all parts of a layer or mesh.
+
+    /*!
+     * A stage of a layer or part that took long.
+     */
+    struct Entry
+    {
+        const char* stage; //!< The name of the stage.
+        int layer_nr; //!< The layer that the stage was about.
+        std::string mesh_name; //!< The mesh that the stage was about, or empty if it was about the whole layer.
+        int part_nr; //!< The part within the layer of the mesh, or \ref no_part.
+        double seconds; //!< How long the stage took.
+        Polygons outline; //!< The outline of the part, if it was given.
+    };
+
+    /*!
+     * Start recording the slowest parts.
+     * \param count How many of the slowest parts to report.
+     * \param svg_directory A directory to draw the outlines of the slowest
+     * parts in, as an SVG file for each, or an empty string to not draw them.
+     */
+    static void start(const size_t count, const std::string& svg_directory = "");
+
+    /*!
+     * Whether the slowest parts are being recorded.
+     */
+    static bool isEnabled();
+
+    /*!
+     * Record how long a stage of a layer or part took, if it is among the
+     * slowest so far on this thread.
+     * \param stage The name of the stage. It must stay valid until the parts
+     * are reported, so it's meant to be a string literal.
+     * \param layer_nr The layer that the stage was about.
+     * \param mesh_name The mesh that the stage was about. It's only copied if
+     * the stage is among the slowest.
+     * \param part_nr The part that the stage was about, or \ref no_part.
+     * \param seconds How long the stage took.
+     * \param outline The outline of the part, if any. It's only copied if the
+     * stage is among the slowest.
+     */
+    static void record(const char* stage, const int layer_nr, const char* mesh_name, const int part_nr, const double seconds, const Polygons* outline);
+
+    /*!
+     * \brief Log the slowest parts recorded so far on all threads, slowest
+     * first, and forget them.
+     *
+     * If an SVG directory was given, the outlines of the reported parts are
+     * drawn there as well, with their rank in the file name. Only the layers
+     * where \ref SVG::isLayerEnabled are drawn.
+     *
+     * No parts may be recorded on any thread while this is being called. Call
+     * it after the mesh group has finished.
+     * \return The reported parts, slowest first.
+     */
+    static std::vector<Entry> report();
+};
+
+/*!
+ * \brief Records the time from its construction to its destruction as a
+ * stage of a layer or part for the \ref SlowestParts, if those are recorded.
+ *
+ * Create it as a local variable at the start of the part to measure.
+ */
+class PartZone : public NoCopy
+{
+public:
+    /*!
+     * Start a zone.
+     * \param stage The name of the stage. Must be a string literal.
+     * \param layer_nr The layer that the zone is about.
+     * \param mesh_name The mesh that the zone is about, if any. It must stay
+     * valid until the zone ends.
+     * \param part_nr The part that the zone is about, if any.
+     * \param outline The outline of the part, to draw it if it is among the
+     * slowest. It must stay valid until the zone ends.
+     */
+    PartZone(const char* stage, const int layer_nr, const char* mesh_name = "", const int part_nr = SlowestParts::no_part, const Polygons* outline = nullptr);
+
+    /*!
+     * End the zone and record it.
+     */
+    ~PartZone();
+
+private:
+    const char* stage; //!< The name of the stage.
+    int layer_nr; //!< The layer that the zone is about.
+    const char* mesh_name; //!< The mesh that the zone is about.
+    int part_nr; //!< The part that the zone is about.
+    const Polygons* outline; //!< The outline of the part, if any.
+    bool is_recording; //!< Whether recording was enabled when the zone started.
+    std::chrono::steady_clock::time_point start; //!< When the zone started.
+};
+
+} //namespace cura
+
+#endif //UTILS_SLOWEST_PARTS_H
@@ -6,10 +6,10 @@
 #define UTILS_SPARSE_GRID_H
 
 #include <cassert>
-#include <unordered_map>
 #include <vector>
 #include <functional>
 
+#include "GridMap.h"
 #include "IntPoint.h"
 #include "SquareGrid.h"
 
@@ -21,8 +21,12 @@ namespace cura {
  * \see SparsePointGrid
  *
  * \tparam ElemT The element type to store.
+ * \tparam GridMapT How the elements are stored per cell. The default
+ *    \ref FlatGridMap is fastest, but pointers to elements become invalid when
+ *    more elements are inserted. Use \ref UnorderedGridMap if they must stay
+ *    valid.
  */
-template<class ElemT>
+template<class ElemT, class GridMapT = FlatGridMap<ElemT>>
 class SparseGrid : public SquareGrid
 {
 public:
@@ -30,7 +34,7 @@ public:
 
     using GridPoint = SquareGrid::GridPoint;
     using grid_coord_t = SquareGrid::grid_coord_t;
-    using GridMap = std::unordered_multimap<GridPoint, Elem>;
+    using GridMap = GridMapT;
     
     using iterator = typename GridMap::iterator;
     using const_iterator = typename GridMap::const_iterator;
@@ -142,8 +146,8 @@ protected:
 
 
 
-#define SGI_TEMPLATE template<class ElemT>
-#define SGI_THIS SparseGrid<ElemT>
+#define SGI_TEMPLATE template<class ElemT, class GridMapT>
+#define SGI_THIS SparseGrid<ElemT, GridMapT>
 
 SGI_TEMPLATE
 SGI_THIS::SparseGrid(coord_t cell_size, size_t elem_reserve, float max_load_factor)
@@ -161,15 +165,7 @@ bool SGI_THIS::processFromCell(
     const GridPoint &grid_pt,
     const std::function<bool (const Elem&)>& process_func) const
 {
-    auto grid_range = m_grid.equal_range(grid_pt);
-    for (auto iter = grid_range.first; iter != grid_range.second; ++iter)
-    {
-        if (!process_func(iter->second))
-        {
-            return false;
-        }
-    }
-    return true;
+    return m_grid.processCell(grid_pt, process_func);
 }
 
 SGI_TEMPLATE
@@ -0,0 +1,188 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_SPARSE_LAYER_VECTOR_H
+#define UTILS_SPARSE_LAYER_VECTOR_H
+
+#include <algorithm> //For std::min.
+#include <atomic>
+#include <cassert>
+#include <memory> //For unique_ptr.
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief A vector of per-layer data that only allocates the layers that are
+ * written to.
+ *
+ * Reading a layer through a const reference to this vector gives an empty
+ * layer if it was never written to, without allocating it. Getting a layer
+ * through a non-const reference allocates it, so code that only reads should
+ * use a const reference.
+ *
+ * Different threads may get the same or different layers at the same time,
+ * even when that allocates them. Resizing may not be done in parallel with
+ * anything else.
+ *
+ * \tparam T The data of one layer. It must be default-constructible. A default
+ * constructed layer is what unallocated layers read as.
+ */
+template<typename T>
+class SparseLayerVector : public NoCopy
+{
+public:
+    SparseLayerVector()
+    : layer_count(0)
+    {
+    }
+
+    ~SparseLayerVector()
+    {
+        clear();
+    }
+
+    /*!
+     * How many layers there are, whether they are allocated or not.
+     */
+    size_t size() const
+    {
+        return layer_count;
+    }
+
+    bool empty() const
+    {
+        return layer_count == 0;
+    }
+
+    /*!
+     * Change the number of layers. New layers are unallocated. Layers beyond
+     * the new size are deleted.
+     */
+    void resize(const size_t new_size)
+    {
+        std::unique_ptr<std::atomic<T*>[]> new_layers(new std::atomic<T*>[new_size]);
+        const size_t kept_count = std::min(new_size, layer_count);
+        for (size_t layer_nr = 0; layer_nr < kept_count; layer_nr++)
+        {
+            new_layers[layer_nr].store(layers[layer_nr].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        for (size_t layer_nr = kept_count; layer_nr < new_size; layer_nr++)
+        {
+            new_layers[layer_nr].store(nullptr, std::memory_order_relaxed);
+        }
+        for (size_t layer_nr = kept_count; layer_nr < layer_count; layer_nr++)
+        {
+            delete layers[layer_nr].load(std::memory_order_relaxed);
+        }
+        layers = std::move(new_layers);
+        layer_count = new_size;
+    }
+
+    /*!
+     * Delete all layers.
+     */
+    void clear()
+    {
+        resize(0);
+    }
+
+    /*!
+     * Delete the first layers, moving the rest down.
+     * \param count How many layers to delete from the bottom.
+     */
+    void eraseFront(const size_t count)
+    {
+        assert(count <= layer_count);
+        for (size_t layer_nr = 0; layer_nr < layer_count; layer_nr++)
+        {
+            T* layer = layers[layer_nr].load(std::memory_order_relaxed);
+            if (layer_nr < count)
+            {
+                delete layer;
+            }
+            else
+            {
+                layers[layer_nr - count].store(layer, std::memory_order_relaxed);
+            }
+        }
+        for (size_t layer_nr = layer_count - count; layer_nr < layer_count; layer_nr++)
+        {
+            layers[layer_nr].store(nullptr, std::memory_order_relaxed);
+        }
+        resize(layer_count - count);
+    }
+
+    /*!
+     * Whether a layer was allocated, so that it may hold any data.
+     */
+    bool isAllocated(const size_t layer_nr) const
+    {
+        assert(layer_nr < layer_count);
+        return layers[layer_nr].load(std::memory_order_acquire) != nullptr;
+    }
+
+    /*!
+     * How many of the layers are allocated.
+     */
+    size_t allocatedCount() const
+    {
+        size_t count = 0;
+        for (size_t layer_nr = 0; layer_nr < layer_count; layer_nr++)
+        {
+            count += isAllocated(layer_nr);
+        }
+        return count;
+    }
+
+    /*!
+     * Get a layer to change it, allocating it if it wasn't yet.
+     */
+    T& operator[](const size_t layer_nr)
+    {
+        assert(layer_nr < layer_count);
+        T* layer = layers[layer_nr].load(std::memory_order_acquire);
+        if (!layer)
+        {
+            T* created = new T();
+            if (layers[layer_nr].compare_exchange_strong(layer, created, std::memory_order_acq_rel))
+            {
+                layer = created;
+            }
+            else //Another thread allocated it at the same time. Then the layer holds that one.
+            {
+                delete created;
+            }
+        }
+        return *layer;
+    }
+
+    /*!
+     * Read a layer. Layers that were never allocated are empty.
+     */
+    const T& operator[](const size_t layer_nr) const
+    {
+        assert(layer_nr < layer_count);
+        const T* layer = layers[layer_nr].load(std::memory_order_acquire);
+        return layer ? *layer : getEmptyLayer();
+    }
+
+private:
+    /*!
+     * The layer that all unallocated layers read as.
+     */
+    static const T& getEmptyLayer()
+    {
+        static const T empty_layer;
+        return empty_layer;
+    }
+
+    std::unique_ptr<std::atomic<T*>[]> layers; //!< For each layer the data, or nullptr if it wasn't allocated.
+    size_t layer_count; //!< How many elements \ref layers has.
+};
+
+} //namespace cura
+
+#endif //UTILS_SPARSE_LAYER_VECTOR_H
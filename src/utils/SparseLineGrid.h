@@ -22,9 +22,10 @@ namespace cura {
  * \tparam Locator The functor to get the start and end locations from ElemT.
  *    must have: std::pair<Point, Point> operator()(const ElemT &elem) const
  *    which returns the location associated with val.
+ * \tparam GridMapT How the elements are stored per cell, see \ref SparseGrid.
  */
-template<class ElemT, class Locator>
-class SparseLineGrid : public SparseGrid<ElemT>
+template<class ElemT, class Locator, class GridMapT = FlatGridMap<ElemT>>
+class SparseLineGrid : public SparseGrid<ElemT, GridMapT>
 {
 public:
     using Elem = ElemT;
@@ -48,8 +49,8 @@ public:
 
     static void debugTest();
 protected:
-    using GridPoint = typename SparseGrid<ElemT>::GridPoint;
-    using grid_coord_t = typename SparseGrid<ElemT>::grid_coord_t;
+    using GridPoint = typename SparseGrid<ElemT, GridMapT>::GridPoint;
+    using grid_coord_t = typename SparseGrid<ElemT, GridMapT>::grid_coord_t;
 
     /*! \brief Accessor for getting locations from elements. */
     Locator m_locator;
@@ -57,12 +58,12 @@ protected:
 
 
 
-#define SGI_TEMPLATE template<class ElemT, class Locator>
-#define SGI_THIS SparseLineGrid<ElemT, Locator>
+#define SGI_TEMPLATE template<class ElemT, class Locator, class GridMapT>
+#define SGI_THIS SparseLineGrid<ElemT, Locator, GridMapT>
 
 SGI_TEMPLATE
 SGI_THIS::SparseLineGrid(coord_t cell_size, size_t elem_reserve, float max_load_factor)
- : SparseGrid<ElemT>(cell_size, elem_reserve, max_load_factor)
+ : SparseGrid<ElemT, GridMapT>(cell_size, elem_reserve, max_load_factor)
 {
 }
 
@@ -70,47 +71,41 @@ SGI_TEMPLATE
 void SGI_THIS::insert(const Elem &elem)
 {
     const std::pair<Point, Point> line = m_locator(elem);
-    using GridMap = std::unordered_multimap<GridPoint, Elem>;
-    // below is a workaround for the fact that lambda functions cannot access private or protected members
-    // first we define a lambda which works on any GridMap and then we bind it to the actual protected GridMap of the parent class
-    std::function<bool (GridMap*, const GridPoint)> process_cell_func_ = [&elem, this](GridMap* m_grid, const GridPoint grid_loc)
+    const std::function<bool (const GridPoint)> process_cell_func = [&elem, this](const GridPoint grid_loc)
         {
-            m_grid->emplace(grid_loc, elem);
+            this->m_grid.emplace(grid_loc, elem);
             return true;
         };
-    using namespace std::placeholders;  // for _1, _2, _3...
-    GridMap* m_grid = &(this->m_grid);
-    std::function<bool (const GridPoint)> process_cell_func(std::bind(process_cell_func_, m_grid, _1));
 
-    SparseGrid<ElemT>::processLineCells(line, process_cell_func);
+    SparseGrid<ElemT, GridMapT>::processLineCells(line, process_cell_func);
 }
 
 SGI_TEMPLATE
 void SGI_THIS::debugHTML(std::string filename)
 {
     AABB aabb;
-    for (std::pair<GridPoint, ElemT> cell:  SparseGrid<ElemT>::m_grid)
+    for (std::pair<GridPoint, ElemT> cell:  SparseGrid<ElemT, GridMapT>::m_grid)
     {
-        aabb.include(SparseGrid<ElemT>::toLowerCorner(cell.first));
-        aabb.include(SparseGrid<ElemT>::toLowerCorner(cell.first + GridPoint(SparseGrid<ElemT>::nonzero_sign(cell.first.X), SparseGrid<ElemT>::nonzero_sign(cell.first.Y))));
+        aabb.include(SparseGrid<ElemT, GridMapT>::toLowerCorner(cell.first));
+        aabb.include(SparseGrid<ElemT, GridMapT>::toLowerCorner(cell.first + GridPoint(SparseGrid<ElemT, GridMapT>::nonzero_sign(cell.first.X), SparseGrid<ElemT, GridMapT>::nonzero_sign(cell.first.Y))));
     }
     SVG svg(filename.c_str(), aabb);
-    for (std::pair<GridPoint, ElemT> cell:  SparseGrid<ElemT>::m_grid)
+    for (std::pair<GridPoint, ElemT> cell:  SparseGrid<ElemT, GridMapT>::m_grid)
     {
         // doesn't draw cells at x = 0 or y = 0 correctly (should be double size)
-        Point lb = SparseGrid<ElemT>::toLowerCorner(cell.first);
-        Point lt = SparseGrid<ElemT>::toLowerCorner(cell.first + GridPoint(0, SparseGrid<ElemT>::nonzero_sign(cell.first.Y)));
-        Point rt = SparseGrid<ElemT>::toLowerCorner(cell.first + GridPoint(SparseGrid<ElemT>::nonzero_sign(cell.first.X), SparseGrid<ElemT>::nonzero_sign(cell.first.Y)));
-        Point rb = SparseGrid<ElemT>::toLowerCorner(cell.first + GridPoint(SparseGrid<ElemT>::nonzero_sign(cell.first.X), 0));
+        Point lb = SparseGrid<ElemT, GridMapT>::toLowerCorner(cell.first);
+        Point lt = SparseGrid<ElemT, GridMapT>::toLowerCorner(cell.first + GridPoint(0, SparseGrid<ElemT, GridMapT>::nonzero_sign(cell.first.Y)));
+        Point rt = SparseGrid<ElemT, GridMapT>::toLowerCorner(cell.first + GridPoint(SparseGrid<ElemT, GridMapT>::nonzero_sign(cell.first.X), SparseGrid<ElemT, GridMapT>::nonzero_sign(cell.first.Y)));
+        Point rb = SparseGrid<ElemT, GridMapT>::toLowerCorner(cell.first + GridPoint(SparseGrid<ElemT, GridMapT>::nonzero_sign(cell.first.X), 0));
         if (lb.X == 0)
         {
-            lb.X = -SparseGrid<ElemT>::cell_size;
-            lt.X = -SparseGrid<ElemT>::cell_size;
+            lb.X = -SparseGrid<ElemT, GridMapT>::cell_size;
+            lt.X = -SparseGrid<ElemT, GridMapT>::cell_size;
         }
         if (lb.Y == 0)
         {
-            lb.Y = -SparseGrid<ElemT>::cell_size;
-            rb.Y = -SparseGrid<ElemT>::cell_size;
+            lb.Y = -SparseGrid<ElemT, GridMapT>::cell_size;
+            rb.Y = -SparseGrid<ElemT, GridMapT>::cell_size;
         }
 //         svg.writePoint(lb, true, 1);
         svg.writeLine(lb, lt, SVG::Color::GRAY);
@@ -20,9 +20,10 @@ namespace cura {
  * \tparam Locator The functor to get the location from ElemT.  Locator
  *    must have: Point operator()(const ElemT &elem) const
  *    which returns the location associated with val.
+ * \tparam GridMapT How the elements are stored per cell, see \ref SparseGrid.
  */
-template<class ElemT, class Locator>
-class SparsePointGrid : public SparseGrid<ElemT>
+template<class ElemT, class Locator, class GridMapT = FlatGridMap<ElemT>>
+class SparsePointGrid : public SparseGrid<ElemT, GridMapT>
 {
 public:
     using Elem = ElemT;
@@ -42,18 +43,30 @@ public:
      */
     void insert(const Elem &elem);
 
+    /*! \brief Inserts many elements into the sparse grid at once.
+     *
+     * For a grid that is still empty, this stores the elements of each cell
+     * next to each other, which makes the queries faster than inserting the
+     * elements one by one. Use this for grids that are built once and then
+     * only queried.
+     *
+     * \param[in] elems The elements to be inserted.
+     */
+    void insertAll(const std::vector<Elem>& elems);
+
     /*!
      * Get just any element that's within a certain radius of a point.
      *
      * Rather than giving a vector of nearby elements, this function just gives
-     * a single element, any element, in no particular order.
+     * a single element, any element, in no particular order. With a
+     * \ref FlatGridMap, the result is only valid until the next insertion.
      * \param query_pt The point to query for an object nearby.
      * \param radius The radius of what is considered "nearby".
      */
     const ElemT* getAnyNearby(const Point& query_pt, coord_t radius);
 
 protected:
-    using GridPoint = typename SparseGrid<ElemT>::GridPoint;
+    using GridPoint = typename SparseGrid<ElemT, GridMapT>::GridPoint;
 
     /*! \brief Accessor for getting locations from elements. */
     Locator m_locator;
@@ -61,12 +74,12 @@ protected:
 
 
 
-#define SGI_TEMPLATE template<class ElemT, class Locator>
-#define SGI_THIS SparsePointGrid<ElemT, Locator>
+#define SGI_TEMPLATE template<class ElemT, class Locator, class GridMapT>
+#define SGI_THIS SparsePointGrid<ElemT, Locator, GridMapT>
 
 SGI_TEMPLATE
 SGI_THIS::SparsePointGrid(coord_t cell_size, size_t elem_reserve, float max_load_factor)
- : SparseGrid<ElemT>(cell_size, elem_reserve, max_load_factor)
+ : SparseGrid<ElemT, GridMapT>(cell_size, elem_reserve, max_load_factor)
 {
 }
 
@@ -74,9 +87,21 @@ SGI_TEMPLATE
 void SGI_THIS::insert(const Elem &elem)
 {
     Point loc = m_locator(elem);
-    GridPoint grid_loc = SparseGrid<ElemT>::toGridPoint(loc);
+    GridPoint grid_loc = SparseGrid<ElemT, GridMapT>::toGridPoint(loc);
 
-    SparseGrid<ElemT>::m_grid.emplace(grid_loc,elem);
+    SparseGrid<ElemT, GridMapT>::m_grid.emplace(grid_loc,elem);
+}
+
+SGI_TEMPLATE
+void SGI_THIS::insertAll(const std::vector<Elem>& elems)
+{
+    std::vector<std::pair<GridPoint, Elem>> cell_elems;
+    cell_elems.reserve(elems.size());
+    for (const Elem& elem : elems)
+    {
+        cell_elems.emplace_back(SparseGrid<ElemT, GridMapT>::toGridPoint(m_locator(elem)), elem);
+    }
+    SparseGrid<ElemT, GridMapT>::m_grid.emplaceAll(cell_elems);
 }
 
 SGI_TEMPLATE
@@ -92,7 +117,7 @@ const ElemT* SGI_THIS::getAnyNearby(const Point& query_pt, coord_t radius)
             }
             return true;
         };
-    SparseGrid<ElemT>::processNearby(query_pt, radius, process_func);
+    SparseGrid<ElemT, GridMapT>::processNearby(query_pt, radius, process_func);
 
     return ret;
 }
@@ -48,14 +48,15 @@ struct Locatoror
 /*! \brief Sparse grid which can locate spatially nearby values efficiently.
  *
  * \tparam Val The value type to store.
+ * \tparam GridMapT How the elements are stored per cell, see \ref SparseGrid.
  */
-template<class Val>
+template<class Val, class GridMapT = FlatGridMap<SparsePointGridInclusiveImpl::SparsePointGridInclusiveElem<Val>>>
 class SparsePointGridInclusive : public SparsePointGrid<SparsePointGridInclusiveImpl::SparsePointGridInclusiveElem<Val>,
-                                             SparsePointGridInclusiveImpl::Locatoror<Val> >
+                                             SparsePointGridInclusiveImpl::Locatoror<Val>, GridMapT>
 {
 public:
     using Base = SparsePointGrid<SparsePointGridInclusiveImpl::SparsePointGridInclusiveElem<Val>,
-                                    SparsePointGridInclusiveImpl::Locatoror<Val> >;
+                                    SparsePointGridInclusiveImpl::Locatoror<Val>, GridMapT>;
 
     /*! \brief Constructs a sparse grid with the specified cell size.
      *
@@ -90,8 +91,8 @@ public:
 
 };
 
-#define SG_TEMPLATE template<class Val>
-#define SG_THIS SparsePointGridInclusive<Val>
+#define SG_TEMPLATE template<class Val, class GridMapT>
+#define SG_THIS SparsePointGridInclusive<Val, GridMapT>
 
 SG_TEMPLATE
 SG_THIS::SparsePointGridInclusive(coord_t cell_size, size_t elem_reserve, float max_load_factor) :
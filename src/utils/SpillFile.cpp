@@ -0,0 +1,100 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cassert>
+#include <chrono>
+#include <cstdio> //For std::remove.
+#include <cstdint>
+
+#include "logoutput.h"
+#include "SpillFile.h"
+
+namespace cura
+{
+
+SpillFile::SpillFile(const std::string& directory)
+: size(0)
+, write_failed(false)
+{
+    //Make the name unique for this object in this process, and unlikely to collide with other processes.
+    const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    filename = directory + "/curaengine_spill_" + std::to_string(reinterpret_cast<std::uintptr_t>(this)) + "_" + std::to_string(now) + ".bin";
+    output.open(filename, std::ios::binary | std::ios::trunc);
+    if (!output.is_open())
+    {
+        logWarning("Couldn't create the scratch file %s.\n", filename.c_str());
+    }
+}
+
+SpillFile::~SpillFile()
+{
+    if (output.is_open())
+    {
+        output.close();
+    }
+    mapped.reset(); //Unmap before removing, since some platforms can't remove a mapped file.
+    std::remove(filename.c_str());
+}
+
+bool SpillFile::canWrite() const
+{
+    return output.is_open() && !write_failed;
+}
+
+bool SpillFile::canRead() const
+{
+    return mapped || !fallback_data.empty();
+}
+
+std::optional<SpillFile::Block> SpillFile::write(const std::vector<char>& data)
+{
+    if (!canWrite())
+    {
+        return std::nullopt;
+    }
+    output.write(data.data(), data.size());
+    if (!output)
+    {
+        logWarning("Couldn't write to the scratch file %s.\n", filename.c_str());
+        write_failed = true;
+        return std::nullopt;
+    }
+    const Block block{ size, data.size() };
+    size += data.size();
+    return block;
+}
+
+void SpillFile::finishWriting()
+{
+    if (!output.is_open())
+    {
+        return;
+    }
+    output.close();
+    if (size == 0)
+    {
+        return; //Nothing to read back.
+    }
+    mapped = std::make_unique<MappedFile>(filename.c_str());
+    if (!mapped->isValid() || mapped->size() < size) //A failed write may have left part of its block behind.
+    {
+        logWarning("Couldn't map the scratch file %s. Reading it into memory instead.\n", filename.c_str());
+        mapped.reset();
+        std::ifstream input(filename, std::ios::binary);
+        fallback_data.resize(size);
+        if (!input.read(fallback_data.data(), size))
+        {
+            logError("Couldn't read the scratch file %s back.\n", filename.c_str());
+            fallback_data = std::vector<char>();
+        }
+    }
+}
+
+const char* SpillFile::read(const Block& block) const
+{
+    assert(canRead() && "Blocks can only be read from a file that was mapped.");
+    assert(block.offset + block.size <= size && "The block must be inside the file.");
+    return (mapped ? mapped->data() : fallback_data.data()) + block.offset;
+}
+
+} //namespace cura
@@ -0,0 +1,106 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_SPILL_FILE_H
+#define UTILS_SPILL_FILE_H
+
+#include <cstddef>
+#include <fstream>
+#include <memory> //For unique_ptr.
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief A scratch file to move data out of memory while it's not needed.
+ *
+ * The file is used in two phases. First, blocks of data are written to it.
+ * Then \ref finishWriting maps the file into memory, after which the blocks
+ * can be read back, from multiple threads at once. The operating system pages
+ * the blocks in when they are read, and can drop them from memory again
+ * whenever it needs to.
+ *
+ * The file is deleted when this object is destroyed.
+ */
+class SpillFile : public NoCopy
+{
+public:
+    /*!
+     * Where a block of data was written in the file.
+     */
+    struct Block
+    {
+        size_t offset; //!< Where the block starts, from the start of the file.
+        size_t size; //!< The length of the block, in bytes.
+    };
+
+    /*!
+     * Create a new scratch file.
+     *
+     * If the file could not be created, \ref canWrite will return false.
+     * \param directory The directory to create the file in.
+     */
+    SpillFile(const std::string& directory);
+
+    ~SpillFile();
+
+    /*!
+     * Whether blocks can be written to the file: it could be created, and no
+     * write failed yet.
+     */
+    bool canWrite() const;
+
+    /*!
+     * Whether the blocks that were written can be read.
+     *
+     * This is the case after \ref finishWriting , if anything was written. If
+     * the file can't be mapped, it is read into memory instead, so the blocks
+     * are not lost.
+     */
+    bool canRead() const;
+
+    /*!
+     * Add a block of data to the end of the file.
+     *
+     * This may only be done before \ref finishWriting . Once a write failed,
+     * no more blocks are accepted, but the blocks written before it can still
+     * be read.
+     * \param data The data to write.
+     * \return Where the data was written, or nothing if it couldn't be
+     * written.
+     */
+    std::optional<Block> write(const std::vector<char>& data);
+
+    /*!
+     * Close the file for writing, and map it into memory to read the blocks
+     * again.
+     */
+    void finishWriting();
+
+    /*!
+     * Get the data of a block that was written before.
+     *
+     * This may only be done if \ref canRead .
+     * \param block The block to get.
+     * \return The start of the data of the block.
+     */
+    const char* read(const Block& block) const;
+
+private:
+    std::string filename; //!< The path to the scratch file.
+    std::ofstream output; //!< The file, while writing to it.
+    size_t size; //!< How many bytes were written to the file, in complete blocks.
+    bool write_failed; //!< Whether a block could not be written.
+    std::unique_ptr<MappedFile> mapped; //!< The file, once it's mapped back in to be read.
+    std::vector<char> fallback_data; //!< The contents of the file, if it couldn't be mapped.
+};
+
+} //namespace cura
+
+#endif //UTILS_SPILL_FILE_H
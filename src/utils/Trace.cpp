@@ -0,0 +1,155 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <atomic>
+#include <cstdio>
+#include <memory> //For shared_ptr.
+#include <mutex>
+#include <vector>
+
+#include "AllocationTracker.h" //The zones are also the stages that allocations are attributed to.
+#include "LayerStatistics.h" //The time spent on each layer is also a statistic of that layer.
+#include "Trace.h"
+
+namespace cura
+{
+
+namespace
+{
+
+/*!
+ * A zone that was recorded.
+ */
+struct Event
+{
+    const char* name;
+    int layer_nr;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+    std::string args; //!< More details of the zone, as the members of a JSON object.
+};
+
+/*!
+ * The zones recorded by one thread.
+ */
+struct ThreadEvents
+{
+    size_t thread_nr; //!< Sequential number of the thread, in the order in which they recorded their first zone.
+    std::vector<Event> events;
+};
+
+std::atomic<bool> enabled(false);
+std::chrono::steady_clock::time_point origin; //!< When recording started.
+std::mutex threads_mutex; //!< Guards the list of threads.
+std::vector<std::shared_ptr<ThreadEvents>> threads; //!< The buffers of all threads that recorded zones. Kept alive after a thread ends, until they are written.
+
+ThreadEvents& getThreadEvents()
+{
+    thread_local std::shared_ptr<ThreadEvents> thread_events;
+    if (!thread_events)
+    {
+        thread_events = std::make_shared<ThreadEvents>();
+        std::lock_guard<std::mutex> lock(threads_mutex);
+        thread_events->thread_nr = threads.size();
+        threads.push_back(thread_events);
+    }
+    return *thread_events;
+}
+
+}
+
+void Trace::start()
+{
+    origin = std::chrono::steady_clock::now();
+    enabled.store(true, std::memory_order_release);
+}
+
+void Trace::stop()
+{
+    enabled.store(false, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    for (const std::shared_ptr<ThreadEvents>& thread_events : threads)
+    {
+        thread_events->events.clear();
+    }
+}
+
+bool Trace::isEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void Trace::record(const char* name, const int layer_nr, const std::chrono::steady_clock::time_point start)
+{
+    getThreadEvents().events.push_back(Event{name, layer_nr, start, std::chrono::steady_clock::now(), std::string()});
+}
+
+void Trace::record(const char* name, const int layer_nr, const std::chrono::steady_clock::time_point start, std::string args)
+{
+    getThreadEvents().events.push_back(Event{name, layer_nr, start, std::chrono::steady_clock::now(), std::move(args)});
+}
+
+bool Trace::write(const std::string& filename)
+{
+    std::FILE* file = std::fopen(filename.c_str(), "w");
+    if (!file)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    std::fputs("{\"traceEvents\":[\n", file);
+    bool first = true;
+    for (const std::shared_ptr<ThreadEvents>& thread_events : threads)
+    {
+        for (const Event& event : thread_events->events)
+        {
+            const long long start_us = std::chrono::duration_cast<std::chrono::microseconds>(event.start - origin).count();
+            const long long duration_us = std::chrono::duration_cast<std::chrono::microseconds>(event.end - event.start).count();
+            std::fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"cura\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%lld,\"dur\":%lld", first ? "" : ",\n", event.name, thread_events->thread_nr, start_us, duration_us);
+            if (event.layer_nr != TraceZone::no_layer)
+            {
+                std::fprintf(file, ",\"args\":{\"layer\":%d%s%s}", event.layer_nr, event.args.empty() ? "" : ",", event.args.c_str());
+            }
+            else if (!event.args.empty())
+            {
+                std::fprintf(file, ",\"args\":{%s}", event.args.c_str());
+            }
+            std::fputc('}', file);
+            first = false;
+        }
+        thread_events->events.clear();
+    }
+    std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+    return std::fclose(file) == 0;
+}
+
+TraceZone::TraceZone(const char* name, const int layer_nr)
+: name(name)
+, layer_nr(layer_nr)
+, is_recording(Trace::isEnabled() || (layer_nr != no_layer && LayerStatistics::isEnabled()))
+, previous_allocation_stage(AllocationTracker::enterStage(name))
+{
+    if (is_recording)
+    {
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+TraceZone::~TraceZone()
+{
+    AllocationTracker::leaveStage(previous_allocation_stage);
+    if (!is_recording)
+    {
+        return;
+    }
+    if (Trace::isEnabled())
+    {
+        Trace::record(name, layer_nr, start);
+    }
+    if (layer_nr != no_layer)
+    {
+        LayerStatistics::addTime(name, layer_nr, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+} //namespace cura
@@ -0,0 +1,124 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_TRACE_H
+#define UTILS_TRACE_H
+
+#include <chrono>
+#include <limits>
+#include <string>
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Records how long each part of the slicing takes, on which thread and
+ * for which layer, to export it as a trace that can be viewed in Chrome's
+ * about:tracing or in Perfetto.
+ *
+ * Recording is off until \ref start is called. Until then, a \ref TraceZone
+ * costs only a check of whether tracing is enabled.
+ *
+ * Each thread records its zones in its own buffer, so recording doesn't make
+ * the threads wait for each other.
+ */
+class Trace
+{
+public:
+    /*!
+     * Start recording zones. The times in the trace are relative to this
+     * moment.
+     */
+    static void start();
+
+    /*!
+     * \brief Stop recording zones, and forget the zones recorded so far.
+     *
+     * No zones may be recorded on any thread while this is being called. Call
+     * it before a slice starts, so that a slice that isn't traced doesn't
+     * record zones, and a slice that is traced doesn't get the zones of an
+     * earlier slice that wasn't written.
+     */
+    static void stop();
+
+    /*!
+     * Whether zones are being recorded.
+     */
+    static bool isEnabled();
+
+    /*!
+     * \brief Write all zones recorded so far to a file in the Chrome trace
+     * event format, and forget them.
+     *
+     * No zones may be recorded on any thread while this is being called. Call
+     * it after the slice has finished.
+     * \param filename The file to write the trace to.
+     * \return Whether the file could be written.
+     */
+    static bool write(const std::string& filename);
+
+    /*!
+     * Record a zone that ended just now.
+     * \param name The name of the zone. It must stay valid until the trace is
+     * written, so it's meant to be a string literal.
+     * \param layer_nr The layer that the zone was about, or
+     * \ref TraceZone::no_layer.
+     * \param start When the zone started.
+     */
+    static void record(const char* name, const int layer_nr, const std::chrono::steady_clock::time_point start);
+
+    /*!
+     * Record a zone that ended just now, with more details to show in the
+     * trace.
+     * \param name The name of the zone, see \ref record .
+     * \param layer_nr The layer that the zone was about, or
+     * \ref TraceZone::no_layer.
+     * \param start When the zone started.
+     * \param args The details of the zone, as the members of a JSON object,
+     * such as ``"items":12,"threads":4``.
+     */
+    static void record(const char* name, const int layer_nr, const std::chrono::steady_clock::time_point start, std::string args);
+};
+
+/*!
+ * \brief Records the time from its construction to its destruction as a zone
+ * in the trace, if tracing is enabled.
+ *
+ * If the zone is about a layer, the time is also added to the
+ * \ref LayerStatistics of that layer, if those are recorded. If allocations
+ * are tracked, the allocations during the zone are attributed to it, see
+ * \ref AllocationTracker.
+ *
+ * Create it as a local variable at the start of the part to measure.
+ */
+class TraceZone : public NoCopy
+{
+public:
+    static constexpr int no_layer = std::numeric_limits<int>::min(); //!< For zones that aren't about a single layer.
+
+    /*!
+     * Start a zone.
+     * \param name The name of the zone, as shown in the trace. Must be a
+     * string literal without any characters that need escaping in JSON.
+     * \param layer_nr The layer that the zone is about, if any.
+     */
+    TraceZone(const char* name, const int layer_nr = no_layer);
+
+    /*!
+     * End the zone and record it.
+     */
+    ~TraceZone();
+
+private:
+    const char* name; //!< The name of the zone.
+    int layer_nr; //!< The layer that the zone is about, or \ref no_layer.
+    bool is_recording; //!< Whether tracing was enabled when the zone started.
+    std::chrono::steady_clock::time_point start; //!< When the zone started.
+    int previous_allocation_stage; //!< The stage that allocations were attributed to before this zone.
+};
+
+} //namespace cura
+
+#endif //UTILS_TRACE_H
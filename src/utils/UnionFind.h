@@ -6,8 +6,10 @@
 #define UNIONFIND_H
 
 #include <assert.h>
+#include <cstdint> //For uint8_t.
 #include <limits> //To get the max size_t as invalid value for the result of find().
 #include <stddef.h> //For size_t.
+#include <utility> //For std::swap.
 #include <vector> //Holds the main data.
 #include <unordered_map> //To map the data type to indices for user's convenience.
 
@@ -211,6 +213,113 @@ private:
     std::vector<size_t> rank;
 };
 
+/*!
+ * A union-find data structure over dense indices.
+ *
+ * Unlike \ref UnionFind, the caller identifies items by the indices that
+ * they were given when they were added, counting from 0. That way no hash
+ * map is needed to find items, which makes this a lot faster when the caller
+ * has such indices anyway, such as positions in a vector.
+ *
+ * Sets are united by rank and paths are halved while finding, so both take
+ * amortised almost constant time.
+ *
+ * This data structure is not thread-safe, since finding changes the paths.
+ */
+class IndexUnionFind
+{
+public:
+    /*!
+     * Creates a union-find data structure with a number of items, each in a
+     * set of its own.
+     * \param item_count The number of items. They get the indices 0 to
+     * item_count - 1.
+     */
+    explicit IndexUnionFind(const size_t item_count = 0)
+    : parent_index(item_count)
+    , rank(item_count, 0)
+    {
+        for (size_t item = 0; item < item_count; item++)
+        {
+            parent_index[item] = item;
+        }
+    }
+
+    /*!
+     * Adds a new item, in a set of its own.
+     * \return The index of the new item, which is the number of items before.
+     */
+    size_t add()
+    {
+        const size_t item = parent_index.size();
+        parent_index.push_back(item);
+        rank.push_back(0);
+        return item;
+    }
+
+    /*!
+     * The number of items.
+     */
+    size_t size() const
+    {
+        return parent_index.size();
+    }
+
+    /*!
+     * Finds the set that an item is part of.
+     * \param item The index of the item.
+     * \return The index of the root item of the set. Two items are in the same
+     * set if they have the same root.
+     */
+    size_t find(size_t item)
+    {
+        assert(item < parent_index.size());
+        while (parent_index[item] != item)
+        {
+            parent_index[item] = parent_index[parent_index[item]]; //Path halving: Skip every other ancestor from now on.
+            item = parent_index[item];
+        }
+        return item;
+    }
+
+    /*!
+     * Unites the sets of two items.
+     * \param first An item of one of the sets. It doesn't need to be a root.
+     * \param second An item of the other set.
+     * \return The root of the united set.
+     */
+    size_t unite(const size_t first, const size_t second)
+    {
+        size_t first_root = find(first);
+        size_t second_root = find(second);
+        if (first_root == second_root)
+        {
+            return first_root;
+        }
+        if (rank[first_root] < rank[second_root]) //The tree with the greatest rank becomes the parent. This creates shallower trees.
+        {
+            std::swap(first_root, second_root);
+        }
+        parent_index[second_root] = first_root;
+        if (rank[first_root] == rank[second_root])
+        {
+            rank[first_root]++;
+        }
+        return first_root;
+    }
+
+private:
+    /*!
+     * For each item, the index of its parent. Roots are their own parent.
+     */
+    std::vector<size_t> parent_index;
+
+    /*!
+     * For each root, an upper bound on the height of its tree.
+     */
+    std::vector<uint8_t> rank;
+};
+
 }
 
 #endif /* UNIONFIND_H */
\ No newline at end of file
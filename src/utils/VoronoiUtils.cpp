@@ -117,6 +117,17 @@ const VoronoiUtils::Segment& VoronoiUtils::getSourceSegment(const vd_t::cell_typ
 std::vector<Point> VoronoiUtils::discretizeParabola(const Point& p, const Segment& segment, Point s, Point e, coord_t approximate_step_size, float transitioning_angle)
 {
     std::vector<Point> discretized;
+    discretizeParabola(p, segment, s, e, approximate_step_size, getParabolaMarkingBound(transitioning_angle), discretized);
+    return discretized;
+}
+
+float VoronoiUtils::getParabolaMarkingBound(float transitioning_angle)
+{
+    return atan(transitioning_angle * 0.5);
+}
+
+void VoronoiUtils::discretizeParabola(const Point& p, const Segment& segment, Point s, Point e, coord_t approximate_step_size, float marking_bound, std::vector<Point>& discretized)
+{
     // x is distance of point projected on the segment ab
     // xx is point projected on the segment ab
     const Point a = segment.from();
@@ -141,10 +152,9 @@ std::vector<Point> VoronoiUtils::discretizeParabola(const Point& p, const Segmen
     {
         discretized.emplace_back(s);
         discretized.emplace_back(e);
-        return discretized;
+        return;
     }
     
-    const float marking_bound = atan(transitioning_angle * 0.5);
     coord_t msx = - marking_bound * d; // projected marking_start
     coord_t mex = marking_bound * d; // projected marking_end
     const coord_t marking_start_end_h = msx * msx / (2 * d) + d / 2;
@@ -171,6 +181,7 @@ std::vector<Point> VoronoiUtils::discretizeParabola(const Point& p, const Segmen
     
     const coord_t step_count = static_cast<coord_t>(static_cast<float>(std::abs(ex - sx)) / approximate_step_size + 0.5);
     
+    discretized.reserve(discretized.size() + std::max(step_count, coord_t(1)) + 4); //All steps, the apex, both markings and the end.
     discretized.emplace_back(s);
     for (coord_t step = 1; step < step_count; step++)
     {
@@ -204,7 +215,6 @@ std::vector<Point> VoronoiUtils::discretizeParabola(const Point& p, const Segmen
         discretized.emplace_back(marking_end);
     }
     discretized.emplace_back(e);
-    return discretized;
 }
 
 /*
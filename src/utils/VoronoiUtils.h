@@ -42,6 +42,26 @@ public:
      */
     static std::vector<Point> discretizeParabola(const Point& source_point, const Segment& source_segment, Point start, Point end, coord_t approximate_step_size, float transitioning_angle);
 
+    /*!
+     * Discretize a parabola based on (approximate) step size, adding the
+     * points to the end of a buffer.
+     *
+     * This gives the same points as the other \ref discretizeParabola, but it
+     * lets the caller reuse the buffer for many parabolas and compute the
+     * marking bound once.
+     * \param marking_bound The bound of the markings, as given by
+     * \ref getParabolaMarkingBound for the transitioning angle.
+     * \param[out] discretized The buffer to add the points to.
+     */
+    static void discretizeParabola(const Point& source_point, const Segment& source_segment, Point start, Point end, coord_t approximate_step_size, float marking_bound, std::vector<Point>& discretized);
+
+    /*!
+     * Get the bound of the markings on a parabola, relative to the distance of
+     * the source point to the source segment.
+     * \param transitioning_angle The angle of the transitions.
+     */
+    static float getParabolaMarkingBound(float transitioning_angle);
+
 protected:
     /*!
      * Discretize parabola based on max absolute deviation from the parabola.
@@ -0,0 +1,169 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For std::min.
+#include <limits>
+#include <zlib.h> //To inflate the deflated files.
+
+#include "logoutput.h"
+#include "ZipArchive.h"
+
+namespace cura
+{
+
+namespace
+{
+
+constexpr uint32_t end_of_central_directory_signature = 0x06054b50;
+constexpr uint32_t central_directory_signature = 0x02014b50;
+constexpr uint32_t local_header_signature = 0x04034b50;
+constexpr size_t end_of_central_directory_size = 22;
+constexpr size_t central_directory_header_size = 46;
+constexpr size_t local_header_size = 30;
+
+/*!
+ * Read a little-endian integer from the archive, regardless of the byte order
+ * of this machine.
+ */
+template<typename T>
+T readLittleEndian(const char* data)
+{
+    T result = 0;
+    for (size_t byte = 0; byte < sizeof(T); byte++)
+    {
+        result |= static_cast<T>(static_cast<unsigned char>(data[byte])) << (byte * 8);
+    }
+    return result;
+}
+
+} //Anonymous namespace.
+
+ZipArchive::ZipArchive(const char* filename)
+: file(filename)
+, is_valid(false)
+{
+    if (!file.isValid() || file.size() < end_of_central_directory_size)
+    {
+        return;
+    }
+
+    //The end of central directory record is at the end, followed by a comment of at most 64kB.
+    const char* data = file.data();
+    const size_t search_start = file.size() - std::min(file.size(), end_of_central_directory_size + std::numeric_limits<uint16_t>::max());
+    size_t end_record = file.size() - end_of_central_directory_size;
+    while (readLittleEndian<uint32_t>(data + end_record) != end_of_central_directory_signature)
+    {
+        if (end_record == search_start)
+        {
+            return; //Not a zip archive.
+        }
+        end_record--;
+    }
+    const size_t entry_count = readLittleEndian<uint16_t>(data + end_record + 10);
+    const size_t directory_size = readLittleEndian<uint32_t>(data + end_record + 12);
+    const size_t directory_offset = readLittleEndian<uint32_t>(data + end_record + 16);
+    if (entry_count == std::numeric_limits<uint16_t>::max() || directory_offset == std::numeric_limits<uint32_t>::max())
+    {
+        logError("Zip64 archives are not supported.\n");
+        return;
+    }
+    if (directory_offset + directory_size > end_record)
+    {
+        return;
+    }
+
+    entries.reserve(entry_count);
+    size_t header = directory_offset;
+    for (size_t entry_idx = 0; entry_idx < entry_count; entry_idx++)
+    {
+        if (header + central_directory_header_size > end_record || readLittleEndian<uint32_t>(data + header) != central_directory_signature)
+        {
+            return;
+        }
+        Entry entry;
+        entry.compression_method = readLittleEndian<uint16_t>(data + header + 10);
+        entry.compressed_size = readLittleEndian<uint32_t>(data + header + 20);
+        entry.uncompressed_size = readLittleEndian<uint32_t>(data + header + 24);
+        const size_t name_length = readLittleEndian<uint16_t>(data + header + 28);
+        const size_t extra_length = readLittleEndian<uint16_t>(data + header + 30);
+        const size_t comment_length = readLittleEndian<uint16_t>(data + header + 32);
+        entry.local_header_offset = readLittleEndian<uint32_t>(data + header + 42);
+        if (header + central_directory_header_size + name_length > end_record)
+        {
+            return;
+        }
+        entries.emplace(std::string(data + header + central_directory_header_size, name_length), entry);
+        header += central_directory_header_size + name_length + extra_length + comment_length;
+    }
+    is_valid = true;
+}
+
+bool ZipArchive::isValid() const
+{
+    return is_valid;
+}
+
+bool ZipArchive::contains(const std::string& name) const
+{
+    return entries.find(name) != entries.end();
+}
+
+std::optional<std::string> ZipArchive::read(const std::string& name) const
+{
+    const auto found = entries.find(name);
+    if (found == entries.end())
+    {
+        return std::nullopt;
+    }
+    const Entry& entry = found->second;
+
+    //The local header may have a different extra field than the central directory, so the data starts after its own.
+    const char* data = file.data();
+    if (entry.local_header_offset + local_header_size > file.size() || readLittleEndian<uint32_t>(data + entry.local_header_offset) != local_header_signature)
+    {
+        return std::nullopt;
+    }
+    const size_t name_length = readLittleEndian<uint16_t>(data + entry.local_header_offset + 26);
+    const size_t extra_length = readLittleEndian<uint16_t>(data + entry.local_header_offset + 28);
+    const size_t data_offset = entry.local_header_offset + local_header_size + name_length + extra_length;
+    if (data_offset + entry.compressed_size > file.size())
+    {
+        return std::nullopt;
+    }
+    const char* compressed = data + data_offset;
+
+    if (entry.compression_method == 0) //Stored.
+    {
+        return std::string(compressed, entry.compressed_size);
+    }
+    if (entry.compression_method != 8) //Deflated.
+    {
+        logError("Unsupported compression method %i for %s in the zip archive.\n", int(entry.compression_method), name.c_str());
+        return std::nullopt;
+    }
+
+    std::string result(entry.uncompressed_size, '\0');
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed));
+    stream.avail_in = entry.compressed_size;
+    stream.next_out = reinterpret_cast<Bytef*>(&result[0]);
+    stream.avail_out = entry.uncompressed_size;
+    constexpr int raw_deflate = -MAX_WBITS; //Zip archives contain raw deflate data, without zlib header.
+    if (inflateInit2(&stream, raw_deflate) != Z_OK)
+    {
+        return std::nullopt;
+    }
+    const int status = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+    if (status != Z_STREAM_END || stream.total_out != entry.uncompressed_size)
+    {
+        logError("Couldn't decompress %s from the zip archive.\n", name.c_str());
+        return std::nullopt;
+    }
+    return result;
+}
+
+} //namespace cura
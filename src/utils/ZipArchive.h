@@ -0,0 +1,80 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_ZIP_ARCHIVE_H
+#define UTILS_ZIP_ARCHIVE_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "MappedFile.h"
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * Read access to the files in a zip archive, such as a 3MF file.
+ *
+ * The archive is mapped into memory and only its central directory is read
+ * when it's opened. Files are decompressed when they are read. Stored and
+ * deflated files are supported, which is what 3MF allows. Zip64 archives
+ * (larger than 4GB) are not.
+ */
+class ZipArchive : public NoCopy
+{
+public:
+    /*!
+     * Open a zip archive.
+     *
+     * If the file could not be opened or is not a zip archive, \ref isValid
+     * will return false.
+     * \param filename The path to the archive.
+     */
+    ZipArchive(const char* filename);
+
+    /*!
+     * Whether the archive could be opened and its directory read.
+     */
+    bool isValid() const;
+
+    /*!
+     * Whether the archive contains a file with the given name.
+     * \param name The path of the file in the archive, without a leading
+     * slash.
+     */
+    bool contains(const std::string& name) const;
+
+    /*!
+     * Decompress a file from the archive.
+     *
+     * This may be called from multiple threads at once.
+     * \param name The path of the file in the archive, without a leading
+     * slash.
+     * \return The contents of the file, or nothing if it isn't in the archive
+     * or couldn't be decompressed.
+     */
+    std::optional<std::string> read(const std::string& name) const;
+
+private:
+    /*!
+     * Where a file is in the archive and how it's stored.
+     */
+    struct Entry
+    {
+        uint16_t compression_method; //!< 0 for stored, 8 for deflated.
+        size_t compressed_size;
+        size_t uncompressed_size;
+        size_t local_header_offset; //!< Where the local header of the file starts, from the start of the archive.
+    };
+
+    MappedFile file; //!< The whole archive.
+    std::unordered_map<std::string, Entry> entries; //!< The files in the archive by their path.
+    bool is_valid; //!< Whether the central directory could be read.
+};
+
+} //namespace cura
+
+#endif //UTILS_ZIP_ARCHIVE_H
@@ -11,6 +11,8 @@
 #include <numeric>
 #include <vector>
 
+#include "Cancellation.h"
+
 // extensions to algorithm.h from the standard library
 
 namespace cura
@@ -49,6 +51,8 @@ std::vector<size_t> order(const std::vector<T> &in)
  * There are still a lot of compilers that claim to be fully C++17 compatible, but don't implement the Parallel Execution TS of the accompanying standard lybrary.
  * This means that we moslty have to fall back to the things that C++11/14 provide when it comes to threading/parallelism/etc.
  *
+ * Once the slice is cancelled (see \ref Cancellation), the body isn't called any more for the remaining indices.
+ *
  * \param from The index starts here (inclusive).
  * \param to The index ends here (not inclusive).
  * \param increment Add this to the index each time.
@@ -76,7 +80,10 @@ void parallel_for(T from, T to, T increment, const std::function<void(const T)>&
     const auto func =
         [&body, &tasks_pending, &all_tasks_done](const T index)
         {
-            body(index);
+            if (!Cancellation::isRequested())
+            {
+                body(index);
+            }
             if (--tasks_pending == 0)
             {
                 all_tasks_done.set_value();
@@ -7,9 +7,7 @@
 #ifdef _WIN32
     #include <windows.h>
 #else
-    #ifdef USE_CPU_TIME
-    #include <sys/resource.h>
-#endif
+#include <sys/resource.h>
 
 #include <sys/time.h>
 #include <stddef.h>
@@ -43,6 +41,34 @@ static inline double getTime()
 #endif // __WIN32
 }
 
+/*!
+ * Get the processor time that all threads of this process have used so far,
+ * in seconds.
+ */
+static inline double getProcessorTime()
+{
+#ifdef _WIN32
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time))
+    {
+        return 0.0;
+    }
+    const auto to_seconds = [](const FILETIME& time) //FILETIME is in units of 100 nanoseconds.
+    {
+        return (double(time.dwHighDateTime) * 4294967296.0 + double(time.dwLowDateTime)) / 10000000.0;
+    };
+    return to_seconds(kernel_time) + to_seconds(user_time);
+#else // not __WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0.0;
+    }
+    return double(usage.ru_utime.tv_sec) + double(usage.ru_utime.tv_usec) / 1000000.0
+        + double(usage.ru_stime.tv_sec) + double(usage.ru_stime.tv_usec) / 1000000.0;
+#endif // __WIN32
+}
+
 class TimeKeeper
 {
 private:
@@ -1,12 +1,21 @@
-//Copyright (c) 2020 Ultimaker B.V.
+//Copyright (c) 2022 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For std::min.
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib> //For atexit.
+#include <cstring> //For memcpy.
+#include <limits> //For the sequence number of threads that aren't logging.
+#include <memory> //For unique_ptr.
+#include <mutex>
 #include <stdio.h>
 #include <stdarg.h>
+#include <string>
+#include <thread>
+#include <vector>
 
-#ifdef _OPENMP
-    #include <omp.h>
-#endif // _OPENMP
 #include "logoutput.h"
 
 namespace cura {
@@ -14,26 +23,422 @@ namespace cura {
 static int verbose_level;
 static bool progressLogging;
 
+namespace
+{
+
+/*!
+ * The messages that one thread logged, until they're written.
+ *
+ * This is a ring buffer with a single producer, the thread that logs, and a
+ * single consumer, whoever holds the write mutex of the \ref LogWriter. The
+ * producer takes no lock to put a message in, so threads that log don't wait
+ * for the terminal or for each other.
+ *
+ * Each message is stored as a \ref MessageHeader followed by the text.
+ */
+struct ThreadLog
+{
+    static constexpr size_t capacity = 1 << 16; //!< 64kB per thread. Must be a power of two.
+
+    /*!
+     * Comes before the text of each message in the buffer.
+     */
+    struct MessageHeader
+    {
+        uint64_t sequence; //!< When the message was logged, compared to the messages of other threads.
+        uint32_t length; //!< The number of characters of the text.
+    };
+
+    std::unique_ptr<char[]> data = std::unique_ptr<char[]>(new char[capacity]);
+    std::atomic<size_t> head { 0 }; //!< How many bytes were ever written into the buffer. Only changed by the producer.
+    std::atomic<size_t> tail { 0 }; //!< How many bytes were ever read from the buffer. Only changed by the consumer.
+
+    static constexpr uint64_t not_publishing = std::numeric_limits<uint64_t>::max();
+    /*!
+     * While the producer numbers a message and puts it in the buffer, a
+     * sequence number that is at most that of the message. Otherwise
+     * \ref not_publishing . The consumer doesn't write messages of other
+     * threads that were numbered later, since they'd be written before this
+     * one.
+     */
+    std::atomic<uint64_t> publishing { not_publishing };
+    std::atomic<bool> in_use { true }; //!< Whether a thread logs to this buffer. The buffers of threads that ended are reused.
+
+    void copyIn(const size_t position, const void* source, const size_t size)
+    {
+        const size_t offset = position & (capacity - 1);
+        const size_t first_part = std::min(size, capacity - offset);
+        std::memcpy(data.get() + offset, source, first_part);
+        std::memcpy(data.get(), static_cast<const char*>(source) + first_part, size - first_part);
+    }
+
+    void copyOut(const size_t position, void* destination, const size_t size) const
+    {
+        const size_t offset = position & (capacity - 1);
+        const size_t first_part = std::min(size, capacity - offset);
+        std::memcpy(destination, data.get() + offset, first_part);
+        std::memcpy(static_cast<char*>(destination) + first_part, data.get(), size - first_part);
+    }
+};
+
+/*!
+ * Writes the logged messages to stderr on a separate thread.
+ *
+ * Formatting a message and putting it in the buffer of the thread is all that
+ * logging takes, so that threads that log a lot don't wait for the terminal.
+ * The writer thread collects the messages of all threads in the order in which
+ * they were logged, and writes them in batches.
+ *
+ * Errors are written right away, together with everything logged before them,
+ * and so is everything when the buffer of a thread is full. What's still in
+ * the buffers when the program exits is written then.
+ *
+ * Logging isn't entirely free of locks: a thread takes a lock the first time it
+ * logs, to get a buffer, and when it needs to wait until its messages are
+ * written. Writing to stderr itself happens under a lock too, to keep the
+ * messages whole.
+ */
+class LogWriter
+{
+public:
+    /*!
+     * Log a message.
+     * \param text The formatted message.
+     * \param length The number of characters in the message.
+     * \param write_now Whether to wait until the message is written, such as
+     * for errors.
+     */
+    void log(const char* text, size_t length, const bool write_now)
+    {
+        ThreadLog* thread_log = stopped ? nullptr : getThreadLog();
+        if (!thread_log) //Not logging asynchronously (any more).
+        {
+            std::lock_guard<std::mutex> lock(write_mutex);
+            writeBuffers();
+            fwrite(text, 1, length, stderr);
+            fflush(stderr);
+            return;
+        }
+        std::call_once(writer_started, [this]() { start(); });
+
+        length = std::min(length, ThreadLog::capacity - sizeof(ThreadLog::MessageHeader)); //Truncate messages that don't fit.
+        const size_t size = sizeof(ThreadLog::MessageHeader) + length;
+        const size_t head = thread_log->head.load(std::memory_order_relaxed);
+        if (ThreadLog::capacity - (head - thread_log->tail.load(std::memory_order_acquire)) < size) //Buffer is full. Only this thread fills it, so it stays free once it is.
+        {
+            writeUntil({ { thread_log, head + size - ThreadLog::capacity } });
+        }
+
+        //Tell the writer not to write later messages of other threads until this one is published.
+        thread_log->publishing = next_sequence.load();
+        const ThreadLog::MessageHeader header { next_sequence++, static_cast<uint32_t>(length) };
+        thread_log->copyIn(head, &header, sizeof(header));
+        thread_log->copyIn(head + sizeof(header), text, length);
+        thread_log->head = head + size;
+        thread_log->publishing = ThreadLog::not_publishing;
+
+        if (write_now || stopped) //If the writer stopped meanwhile, it may not have seen this message. Then write it here.
+        {
+            writeUntil({ { thread_log, head + size } });
+        }
+        else if (writer_idle.exchange(false)) //Only wake up the writer thread if it went to sleep, so that logging doesn't take a lock for every message.
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            wake_up.notify_one();
+        }
+    }
+
+    /*!
+     * Write everything logged so far.
+     */
+    void flush()
+    {
+        std::vector<std::pair<ThreadLog*, size_t>> logged;
+        {
+            std::lock_guard<std::mutex> lock(thread_logs_mutex);
+            for (const std::unique_ptr<ThreadLog>& thread_log : thread_logs)
+            {
+                logged.emplace_back(thread_log.get(), thread_log->head.load());
+            }
+        }
+        writeUntil(logged);
+    }
+
+    /*!
+     * Stop the writer thread after it wrote everything. After this,
+     * messages are written right away. Threads that were logging meanwhile
+     * write their message themselves.
+     */
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            stopped = true;
+            wake_up.notify_one();
+        }
+        if (writer.joinable())
+        {
+            writer.join();
+        }
+        flush();
+    }
+
+private:
+    std::vector<std::unique_ptr<ThreadLog>> thread_logs; //!< The buffers of all threads that logged.
+    std::mutex thread_logs_mutex; //!< Guards the list of buffers, not their contents.
+    std::atomic<uint64_t> next_sequence { 0 }; //!< To order the messages of different threads.
+    std::mutex write_mutex; //!< Only one thread reads from the buffers and writes to stderr at a time.
+    std::string output; //!< Collects the messages to write in one go. Guarded by write_mutex.
+    std::thread writer; //!< The thread that writes the messages.
+    std::once_flag writer_started;
+    std::atomic<bool> writer_idle { false }; //!< Whether the writer thread found nothing to write and is going to sleep.
+    std::atomic<bool> stopped { false }; //!< Whether the program is exiting, so the writer thread stopped.
+    std::mutex wake_mutex;
+    std::condition_variable wake_up; //!< Notified when there is something to write, or to stop the writer thread.
+
+    /*!
+     * Write messages until the buffers have been read up to the given
+     * positions. This waits for messages of other threads that were numbered
+     * earlier, if they're still being published.
+     * \param positions For some buffers, up to where they must be read.
+     */
+    void writeUntil(const std::vector<std::pair<ThreadLog*, size_t>>& positions)
+    {
+        while (true)
+        {
+            {
+                std::lock_guard<std::mutex> lock(write_mutex);
+                writeBuffers();
+            }
+            if (std::all_of(positions.begin(), positions.end(), [](const std::pair<ThreadLog*, size_t>& position) { return position.first->tail.load() >= position.second; }))
+            {
+                return;
+            }
+            std::this_thread::yield(); //Another thread is still publishing an earlier message. That only takes a copy.
+        }
+    }
+
+    /*!
+     * Whether any buffer has messages that weren't written yet.
+     */
+    bool hasUnwritten()
+    {
+        std::lock_guard<std::mutex> lock(thread_logs_mutex);
+        return std::any_of(thread_logs.begin(), thread_logs.end(), [](const std::unique_ptr<ThreadLog>& thread_log) { return thread_log->head.load() != thread_log->tail.load(); });
+    }
+
+    /*!
+     * Marks the buffer of a thread as unused when the thread ends.
+     */
+    struct ThreadLogRelease
+    {
+        ThreadLog*& thread_log;
+        bool& released;
+        ~ThreadLogRelease()
+        {
+            if (thread_log)
+            {
+                thread_log->in_use = false;
+                thread_log = nullptr;
+            }
+            released = true;
+        }
+    };
+
+    /*!
+     * Get the buffer of the current thread.
+     * \return The buffer, or nullptr if the thread is ending and the messages
+     * should be written right away.
+     */
+    ThreadLog* getThreadLog()
+    {
+        //Trivial thread-local variables, so that they can still be used while the thread is ending.
+        thread_local ThreadLog* thread_log = nullptr;
+        thread_local bool released = false;
+        if (thread_log || released)
+        {
+            return thread_log;
+        }
+        thread_local ThreadLogRelease release { thread_log, released };
+
+        std::lock_guard<std::mutex> lock(thread_logs_mutex);
+        for (const std::unique_ptr<ThreadLog>& unused_log : thread_logs)
+        {
+            bool expected = false;
+            if (unused_log->in_use.compare_exchange_strong(expected, true))
+            {
+                thread_log = unused_log.get();
+                return thread_log;
+            }
+        }
+        thread_logs.push_back(std::make_unique<ThreadLog>());
+        thread_log = thread_logs.back().get();
+        return thread_log;
+    }
+
+    /*!
+     * Write the messages in all buffers, in the order in which they were
+     * logged. The write mutex must be locked.
+     */
+    void writeBuffers()
+    {
+        std::vector<ThreadLog*> logs;
+        {
+            std::lock_guard<std::mutex> lock(thread_logs_mutex);
+            for (const std::unique_ptr<ThreadLog>& thread_log : thread_logs)
+            {
+                logs.push_back(thread_log.get());
+            }
+        }
+        //Only write the messages that were numbered before any message that is still being published, so that none is skipped.
+        //A thread that isn't publishing now will number its next message after this.
+        uint64_t limit = next_sequence.load();
+        std::vector<size_t> heads(logs.size());
+        for (size_t log_idx = 0; log_idx < logs.size(); log_idx++)
+        {
+            limit = std::min(limit, logs[log_idx]->publishing.load());
+            heads[log_idx] = logs[log_idx]->head.load(); //After reading whether it's publishing, so every message of this thread numbered before the limit is included.
+        }
+        while (true)
+        {
+            ThreadLog* earliest = nullptr;
+            ThreadLog::MessageHeader earliest_header;
+            for (size_t log_idx = 0; log_idx < logs.size(); log_idx++)
+            {
+                ThreadLog* thread_log = logs[log_idx];
+                const size_t tail = thread_log->tail.load(std::memory_order_relaxed);
+                if (heads[log_idx] == tail)
+                {
+                    continue; //Nothing in this buffer.
+                }
+                ThreadLog::MessageHeader header;
+                thread_log->copyOut(tail, &header, sizeof(header));
+                if (header.sequence >= limit)
+                {
+                    continue; //Wait until the earlier messages are published.
+                }
+                if (!earliest || header.sequence < earliest_header.sequence)
+                {
+                    earliest = thread_log;
+                    earliest_header = header;
+                }
+            }
+            if (!earliest)
+            {
+                break;
+            }
+            const size_t tail = earliest->tail.load(std::memory_order_relaxed);
+            const size_t output_size = output.size();
+            output.resize(output_size + earliest_header.length);
+            earliest->copyOut(tail + sizeof(earliest_header), &output[output_size], earliest_header.length);
+            earliest->tail.store(tail + sizeof(earliest_header) + earliest_header.length, std::memory_order_release);
+        }
+        if (!output.empty())
+        {
+            fwrite(output.data(), 1, output.size(), stderr);
+            fflush(stderr);
+            output.clear();
+        }
+    }
+
+    /*!
+     * Start the writer thread, and stop it when the program exits.
+     */
+    void start()
+    {
+        writer = std::thread([this]()
+        {
+            while (!stopped)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(write_mutex);
+                    writeBuffers();
+                }
+                writer_idle = true;
+                if (hasUnwritten()) //Logged after writing, but before the thread that logged could see that the writer is idle. Or still waiting for an earlier message.
+                {
+                    writer_idle = false;
+                    std::this_thread::yield();
+                    continue;
+                }
+                std::unique_lock<std::mutex> wake_lock(wake_mutex);
+                wake_up.wait(wake_lock, [this]() { return stopped || !writer_idle; });
+            }
+        });
+        std::atexit([]() { getLogWriter().stop(); });
+    }
+
+public:
+    /*!
+     * The log writer of the program. It's never destroyed, so that logging
+     * still works while the program exits.
+     */
+    static LogWriter& getLogWriter()
+    {
+        static LogWriter* log_writer = new LogWriter();
+        return *log_writer;
+    }
+};
+
+/*!
+ * Format a message and log it.
+ * \param prefix Text to put before the message.
+ * \param fmt The format of the message, as for printf.
+ * \param args The values to format.
+ * \param write_now Whether to wait until the message is written.
+ */
+void logFormatted(const char* prefix, const char* fmt, va_list args, const bool write_now)
+{
+    char stack_buffer[1024];
+    const int prefix_length = snprintf(stack_buffer, sizeof(stack_buffer), "%s", prefix);
+    va_list args_copy;
+    va_copy(args_copy, args);
+    const int message_length = vsnprintf(stack_buffer + prefix_length, sizeof(stack_buffer) - prefix_length, fmt, args_copy);
+    va_end(args_copy);
+    if (message_length < 0)
+    {
+        return;
+    }
+    const size_t length = prefix_length + message_length;
+    if (length < sizeof(stack_buffer))
+    {
+        LogWriter::getLogWriter().log(stack_buffer, length, write_now);
+        return;
+    }
+    std::vector<char> heap_buffer(length + 1); //Too long for the stack buffer.
+    std::memcpy(heap_buffer.data(), prefix, prefix_length);
+    vsnprintf(heap_buffer.data() + prefix_length, message_length + 1, fmt, args);
+    LogWriter::getLogWriter().log(heap_buffer.data(), length, write_now);
+}
+
+} //Anonymous namespace.
+
 void increaseVerboseLevel()
 {
     verbose_level++;
 }
 
+int getVerboseLevel()
+{
+    return verbose_level;
+}
+
 void enableProgressLogging()
 {
     progressLogging = true;
 }
 
+void flushLog()
+{
+    LogWriter::getLogWriter().flush();
+}
+
 void logError(const char* fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
-    #pragma omp critical
-    {
-        fprintf(stderr, "[ERROR] ");
-        vfprintf(stderr, fmt, args);
-        fflush(stderr);
-    }
+    constexpr bool write_now = true; //Errors may be followed by a crash. Don't lose them.
+    logFormatted("[ERROR] ", fmt, args, write_now);
     va_end(args);
 }
 
@@ -41,12 +446,7 @@ void logWarning(const char* fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
-    #pragma omp critical
-    {
-        fprintf(stderr, "[WARNING] ");
-        vfprintf(stderr, fmt, args);
-        fflush(stderr);
-    }
+    logFormatted("[WARNING] ", fmt, args, false);
     va_end(args);
 }
 
@@ -54,11 +454,7 @@ void logAlways(const char* fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
-    #pragma omp critical
-    {
-        vfprintf(stderr, fmt, args);
-        fflush(stderr);
-    }
+    logFormatted("", fmt, args, false);
     va_end(args);
 }
 
@@ -69,11 +465,7 @@ void log(const char* fmt, ...)
         return;
 
     va_start(args, fmt);
-    #pragma omp critical
-    {
-        vfprintf(stderr, fmt, args);
-        fflush(stderr);
-    }
+    logFormatted("", fmt, args, false);
     va_end(args);
 }
 
@@ -85,12 +477,7 @@ void logDebug(const char* fmt, ...)
         return;
     }
     va_start(args, fmt);
-    #pragma omp critical
-    {
-        fprintf(stderr, "[DEBUG] ");
-        vfprintf(stderr, fmt, args);
-        fflush(stderr);
-    }
+    logFormatted("[DEBUG] ", fmt, args, false);
     va_end(args);
 }
 
@@ -99,10 +486,11 @@ void logProgress(const char* type, int value, int maxValue, float percent)
     if (!progressLogging)
         return;
 
-    #pragma omp critical
+    char message[256];
+    const int length = snprintf(message, sizeof(message), "Progress:%s:%i:%i \t%f%%\n", type, value, maxValue, percent);
+    if (length > 0)
     {
-        fprintf(stderr, "Progress:%s:%i:%i \t%f%%\n", type, value, maxValue, percent);
-        fflush(stderr);
+        LogWriter::getLogWriter().log(message, std::min(static_cast<size_t>(length), sizeof(message) - 1), false);
     }
 }
 
@@ -11,6 +11,13 @@ namespace cura {
  */
 void increaseVerboseLevel();
 
+/*
+ * \brief Get the verbosity level.
+ *
+ * This allows skipping the work to compose messages that wouldn't be logged.
+ */
+int getVerboseLevel();
+
 /*
  * \brief Enable logging the current slicing progress to the log.
  */
@@ -54,6 +61,14 @@ void logDebug(const char* fmt, ...);
  */
 void logProgress(const char* type, int value, int maxValue, float percent);
 
+/*
+ * \brief Wait until everything that was logged so far is written.
+ *
+ * Messages are written to the log by a separate thread, so they may appear a
+ * bit later. Errors are always written right away.
+ */
+void flushLog();
+
 } //namespace cura
 
 #endif //LOGOUTPUT_H
\ No newline at end of file
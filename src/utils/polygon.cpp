@@ -9,7 +9,7 @@
 #include "linearAlg2D.h" // pointLiesOnTheRightOfLine
 #include "Simplify.h"
 
-#include "ListPolyIt.h"
+#include "ArrayPolyIt.h"
 
 #include "PolylineStitcher.h"
 
@@ -63,10 +63,10 @@ bool ConstPolygonRef::_inside(Point p, bool border_result) const
 Polygons ConstPolygonRef::intersection(const ConstPolygonRef& other) const
 {
     Polygons ret;
-    ClipperLib::Clipper clipper(clipper_init);
-    clipper.AddPath(*path, ClipperLib::ptSubject, true);
-    clipper.AddPath(*other.path, ClipperLib::ptClip, true);
-    clipper.Execute(ClipperLib::ctIntersection, ret.paths);
+    ReusableClipper<ClipperLib::Clipper> clipper;
+    clipper->AddPath(*path, ClipperLib::ptSubject, true);
+    clipper->AddPath(*other.path, ClipperLib::ptClip, true);
+    clipper->Execute(ClipperLib::ctIntersection, ret.paths);
     return ret;
 }
 
@@ -86,9 +86,11 @@ Polygons Polygons::approxConvexHull(int extra_outset)
     for (const ClipperLib::Path& path : paths)
     {
         Polygons offset_result;
-        ClipperLib::ClipperOffset offsetter(1.2, 10.0);
-        offsetter.AddPath(path, ClipperLib::jtRound, ClipperLib::etClosedPolygon);
-        offsetter.Execute(offset_result.paths, overshoot);
+        ReusableClipper<ClipperLib::ClipperOffset> offsetter;
+        offsetter->MiterLimit = 1.2;
+        offsetter->ArcTolerance = 10.0;
+        offsetter->AddPath(path, ClipperLib::jtRound, ClipperLib::etClosedPolygon);
+        offsetter->Execute(offset_result.paths, overshoot);
         convex_hull.add(offset_result);
     }
     return convex_hull.unionPolygons().offset(-overshoot + extra_outset, ClipperLib::jtRound);
@@ -263,17 +265,96 @@ unsigned int Polygons::findInside(Point p, bool border_result)
     return ret;
 }
 
+Polygons Polygons::differenceBounded(const Polygons& other) const
+{
+    return differenceBounded(PolygonsBounds(*this), PolygonsBounds(other));
+}
+
+Polygons Polygons::differenceBounded(const PolygonsBounds& subject, const PolygonsBounds& clip)
+{
+    AABB clip_box;
+    const Polygons relevant_clip = clip.getOverlapping(subject.total, clip_box);
+    if (relevant_clip.empty())
+    {
+        return subject.polygons; //Nothing to subtract.
+    }
+    AABB subject_box;
+    Polygons result;
+    const Polygons affected_subject = subject.getOverlapping(clip_box, subject_box, &result);
+    if (affected_subject.empty())
+    {
+        return subject.polygons;
+    }
+    result.add(affected_subject.difference(relevant_clip));
+    return result;
+}
+
+Polygons Polygons::intersectionBounded(const Polygons& other) const
+{
+    return intersectionBounded(PolygonsBounds(*this), PolygonsBounds(other));
+}
+
+Polygons Polygons::intersectionBounded(const PolygonsBounds& a, const PolygonsBounds& b)
+{
+    AABB b_box;
+    const Polygons relevant_b = b.getOverlapping(a.total, b_box);
+    if (relevant_b.empty())
+    {
+        return Polygons();
+    }
+    AABB a_box;
+    const Polygons relevant_a = a.getOverlapping(b_box, a_box);
+    if (relevant_a.empty())
+    {
+        return Polygons();
+    }
+    return relevant_a.intersection(relevant_b);
+}
+
+PolygonsBounds::PolygonsBounds(const Polygons& polygons)
+: polygons(polygons)
+{
+    boxes.reserve(polygons.size());
+    for (ConstPolygonRef polygon : polygons)
+    {
+        boxes.emplace_back(polygon);
+        total.include(boxes.back());
+    }
+}
+
+Polygons PolygonsBounds::getOverlapping(const AABB& box, AABB& overlapping_box, Polygons* rest) const
+{
+    Polygons result;
+    for (size_t poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+    {
+        if (boxes[poly_idx].hit(box))
+        {
+            result.add(polygons[poly_idx]);
+            overlapping_box.include(boxes[poly_idx]);
+        }
+        else if (rest)
+        {
+            rest->add(polygons[poly_idx]);
+        }
+    }
+    return result;
+}
+
 Polygons Polygons::intersectionPolyLines(const Polygons& polylines, bool restitch, const coord_t max_stitch_distance) const
 {
     Polygons split_polylines = polylines.splitPolylinesIntoSegments();
     
-    ClipperLib::PolyTree result;
-    ClipperLib::Clipper clipper(clipper_init);
-    clipper.AddPaths(split_polylines.paths, ClipperLib::ptSubject, false);
-    clipper.AddPaths(paths, ClipperLib::ptClip, true);
-    clipper.Execute(ClipperLib::ctIntersection, result);
     Polygons ret;
+#ifdef CURA_USE_CLIPPER2
+    ret.paths = clipper2::intersectionOpenPaths(split_polylines.paths, paths);
+#else
+    ClipperLib::PolyTree result;
+    ReusableClipper<ClipperLib::Clipper> clipper;
+    clipper->AddPaths(split_polylines.paths, ClipperLib::ptSubject, false);
+    clipper->AddPaths(paths, ClipperLib::ptClip, true);
+    clipper->Execute(ClipperLib::ctIntersection, result);
     ClipperLib::OpenPathsFromPolyTree(result, ret.paths);
+#endif
     
     if (restitch)
     {
@@ -334,20 +415,65 @@ coord_t Polygons::polyLineLength() const
     return length;
 }
 
-Polygons Polygons::offset(int distance, ClipperLib::JoinType join_type, double miter_limit) const
+Polygons Polygons::offset(int distance, ClipperLib::JoinType join_type, double miter_limit) const &
 {
     if (distance == 0)
     {
         return *this;
     }
-    Polygons ret;
-    ClipperLib::ClipperOffset clipper(miter_limit, 10.0);
-    clipper.AddPaths(unionPolygons().paths, join_type, ClipperLib::etClosedPolygon);
-    clipper.MiterLimit = miter_limit;
-    clipper.Execute(ret.paths, distance);
+    Polygons ret = unionPolygons();
+    offsetUnited(ret.paths, distance, join_type, miter_limit, ret.paths);
     return ret;
 }
 
+Polygons Polygons::offset(int distance, ClipperLib::JoinType join_type, double miter_limit) &&
+{
+    return std::move(offsetInPlace(distance, join_type, miter_limit));
+}
+
+Polygons& Polygons::offsetInPlace(int distance, ClipperLib::JoinType join_type, double miter_limit)
+{
+    if (distance == 0)
+    {
+        return *this;
+    }
+    unionPolygonsInPlace();
+    offsetUnited(paths, distance, join_type, miter_limit, paths);
+    return *this;
+}
+
+void Polygons::offsetUnited(const ClipperLib::Paths& united, int distance, ClipperLib::JoinType join_type, double miter_limit, ClipperLib::Paths& result)
+{
+#ifdef CURA_USE_CLIPPER2
+    result = clipper2::offset(united, distance, join_type, miter_limit, 10.0);
+#else
+    ReusableClipper<ClipperLib::ClipperOffset> clipper;
+    clipper->MiterLimit = miter_limit;
+    clipper->ArcTolerance = 10.0;
+    clipper->AddPaths(united, join_type, ClipperLib::etClosedPolygon);
+    clipper->Execute(result, distance);
+#endif
+}
+
+std::vector<Polygons> Polygons::offsetMulti(const std::vector<coord_t>& distances, ClipperLib::JoinType join_type, double miter_limit) const
+{
+    std::vector<Polygons> result(distances.size());
+    const Polygons unioned = unionPolygons();
+#pragma omp parallel for default(none) shared(distances, result, unioned, join_type, miter_limit) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int distance_idx = 0; distance_idx < static_cast<int>(distances.size()); distance_idx++)
+    {
+        const coord_t distance = distances[distance_idx];
+        if (distance == 0)
+        {
+            result[distance_idx] = *this;
+            continue;
+        }
+        offsetUnited(unioned.paths, distance, join_type, miter_limit, result[distance_idx].paths);
+    }
+    return result;
+}
+
 Polygons ConstPolygonRef::offset(int distance, ClipperLib::JoinType join_type, double miter_limit) const
 {
     if (distance == 0)
@@ -357,10 +483,15 @@ Polygons ConstPolygonRef::offset(int distance, ClipperLib::JoinType join_type, d
         return ret;
     }
     Polygons ret;
-    ClipperLib::ClipperOffset clipper(miter_limit, 10.0);
-    clipper.AddPath(*path, join_type, ClipperLib::etClosedPolygon);
-    clipper.MiterLimit = miter_limit;
-    clipper.Execute(ret.paths, distance);
+#ifdef CURA_USE_CLIPPER2
+    ret.paths = clipper2::offset(ClipperLib::Paths{ *path }, distance, join_type, miter_limit, 10.0);
+#else
+    ReusableClipper<ClipperLib::ClipperOffset> clipper;
+    clipper->MiterLimit = miter_limit;
+    clipper->ArcTolerance = 10.0;
+    clipper->AddPath(*path, join_type, ClipperLib::etClosedPolygon);
+    clipper->Execute(ret.paths, distance);
+#endif
     return ret;
 }
 
@@ -440,12 +571,69 @@ void PolygonRef::removeColinearEdges(const AngleRadians max_deviation_angle)
     while (num_removed_in_iteration > 0);
 }
 
-void PolygonRef::applyMatrix(const PointMatrix& matrix)
+bool PolygonRef::removeDegenerateVerts(const bool for_polyline)
 {
-    for (unsigned int path_idx = 0; path_idx < path->size(); path_idx++)
+    ClipperLib::Path& poly = *path;
+    auto isDegenerate = [](const Point& last, const Point& now, const Point& next)
     {
-        (*path)[path_idx] = matrix.apply((*path)[path_idx]);
+        Point last_line = now - last;
+        Point next_line = next - now;
+        return dot(last_line, next_line) == -1 * vSize(last_line) * vSize(next_line);
+    };
+
+    //The vertices that are kept are collected at the start of the path, as [0, kept_count).
+    //They never overtake the vertex being looked at, so the vertices after it are still the original ones.
+    //With polylines, the first and last vertex are kept.
+    if (for_polyline && poly.size() < 3)
+    {
+        return false;
+    }
+    const size_t start_vertex = for_polyline ? 1 : 0;
+    const size_t end_vertex = for_polyline ? poly.size() - 1 : poly.size();
+    size_t kept_count = start_vertex;
+
+    bool is_changed = false;
+    for (size_t idx = start_vertex; idx < end_vertex; idx++)
+    {
+        if (idx + 1 >= poly.size() && kept_count == 0)
+        {
+            break;
+        }
+        const Point last = (kept_count == 0) ? poly.back() : poly[kept_count - 1];
+        const Point now = poly[idx];
+        const Point next = (idx + 1 >= poly.size()) ? poly[0] : poly[idx + 1];
+        if (isDegenerate(last, now, next))
+        { // lines are in the opposite direction
+            // don't keep the vertex
+            is_changed = true;
+            while (kept_count > 1 && isDegenerate(poly[kept_count - 2], poly[kept_count - 1], next))
+            {
+                kept_count--;
+            }
+        }
+        else
+        {
+            poly[kept_count] = now;
+            kept_count++;
+        }
+    }
+
+    if (!is_changed)
+    {
+        return false;
+    }
+    for (size_t i = end_vertex; i < poly.size(); ++i)
+    {
+        poly[kept_count] = poly[i]; //Keep everything after the end vertex.
+        kept_count++;
     }
+    poly.resize(kept_count);
+    return true;
+}
+
+void PolygonRef::applyMatrix(const PointMatrix& matrix)
+{
+    BatchGeometry::applyMatrix(matrix, *path);
 }
 void PolygonRef::applyMatrix(const Point3Matrix& matrix)
 {
@@ -458,11 +646,11 @@ void PolygonRef::applyMatrix(const Point3Matrix& matrix)
 Polygons Polygons::getOutsidePolygons() const
 {
     Polygons ret;
-    ClipperLib::Clipper clipper(clipper_init);
+    ReusableClipper<ClipperLib::Clipper> clipper;
     ClipperLib::PolyTree poly_tree;
     constexpr bool paths_are_closed_polys = true;
-    clipper.AddPaths(paths, ClipperLib::ptSubject, paths_are_closed_polys);
-    clipper.Execute(ClipperLib::ctUnion, poly_tree);
+    clipper->AddPaths(paths, ClipperLib::ptSubject, paths_are_closed_polys);
+    clipper->Execute(ClipperLib::ctUnion, poly_tree);
 
     for (int outer_poly_idx = 0; outer_poly_idx < poly_tree.ChildCount(); outer_poly_idx++)
     {
@@ -475,11 +663,11 @@ Polygons Polygons::getOutsidePolygons() const
 Polygons Polygons::removeEmptyHoles() const
 {
     Polygons ret;
-    ClipperLib::Clipper clipper(clipper_init);
+    ReusableClipper<ClipperLib::Clipper> clipper;
     ClipperLib::PolyTree poly_tree;
     constexpr bool paths_are_closed_polys = true;
-    clipper.AddPaths(paths, ClipperLib::ptSubject, paths_are_closed_polys);
-    clipper.Execute(ClipperLib::ctUnion, poly_tree);
+    clipper->AddPaths(paths, ClipperLib::ptSubject, paths_are_closed_polys);
+    clipper->Execute(ClipperLib::ctUnion, poly_tree);
 
     bool remove_holes = true;
     removeEmptyHoles_processPolyTreeNode(poly_tree, remove_holes, ret);
@@ -489,11 +677,11 @@ Polygons Polygons::removeEmptyHoles() const
 Polygons Polygons::getEmptyHoles() const
 {
     Polygons ret;
-    ClipperLib::Clipper clipper(clipper_init);
+    ReusableClipper<ClipperLib::Clipper> clipper;
     ClipperLib::PolyTree poly_tree;
     constexpr bool paths_are_closed_polys = true;
-    clipper.AddPaths(paths, ClipperLib::ptSubject, paths_are_closed_polys);
-    clipper.Execute(ClipperLib::ctUnion, poly_tree);
+    clipper->AddPaths(paths, ClipperLib::ptSubject, paths_are_closed_polys);
+    clipper->Execute(ClipperLib::ctUnion, poly_tree);
 
     bool remove_holes = false;
     removeEmptyHoles_processPolyTreeNode(poly_tree, remove_holes, ret);
@@ -598,65 +786,64 @@ void Polygons::_removeDegenerateVerts(const bool for_polyline)
     for(size_t poly_idx = 0; poly_idx < size(); poly_idx++)
     {
         PolygonRef poly = thiss[poly_idx];
-        Polygon result;
-
-        auto isDegenerate = [](const Point& last, const Point& now, const Point& next)
-        {
-            Point last_line = now - last;
-            Point next_line = next - now;
-            return dot(last_line, next_line) == -1 * vSize(last_line) * vSize(next_line);
-        };
-
-        //With polylines, skip the first and last vertex.
-        const size_t start_vertex = for_polyline ? 1 : 0;
-        const size_t end_vertex = for_polyline ? poly.size() - 1 : poly.size();
-        for(size_t i = 0; i < start_vertex; ++i)
+        const bool is_changed = poly.removeDegenerateVerts(for_polyline); //In place, so that polygons without degenerate vertices aren't copied.
+        if(is_changed && !for_polyline && poly.size() <= 2)
         {
-            result.add(poly[i]); //Add everything before the start vertex.
+            thiss.remove(poly_idx);
+            poly_idx--; // effectively the next iteration has the same poly_idx (referring to a new poly which is not yet processed)
         }
+    }
+}
 
-        bool isChanged = false;
-        for(size_t idx = start_vertex; idx < end_vertex; idx++)
+void Polygons::removeDegenerateVertsAndSmallAreas(const double min_area_size, const bool remove_holes)
+{
+    //Like removeSmallAreas, but each polygon is cleaned up right before its area is computed.
+    //Polygons that become degenerate are removed like small outlines.
+    auto new_end = paths.end();
+    std::vector<PolygonRef> small_holes;
+    for (auto it = paths.begin(); it < new_end; it++)
+    {
+        const bool is_changed = PolygonRef(*it).removeDegenerateVerts();
+        const bool is_degenerate = is_changed && it->size() <= 2;
+        const double area = INT2MM2(ClipperLib::Area(*it));
+        if (is_degenerate || fabs(area) < min_area_size)
         {
-            const Point& last = (result.size() == 0) ? poly.back() : result.back();
-            if(idx + 1 >= poly.size() && result.size() == 0)
+            if (is_degenerate || remove_holes || area >= 0)
             {
-                break;
-            }
-            const Point& next = (idx + 1 >= poly.size()) ? result[0] : poly[idx + 1];
-            if(isDegenerate(last, poly[idx], next))
-            { // lines are in the opposite direction
-                // don't add vert to the result
-                isChanged = true;
-                while(result.size() > 1 && isDegenerate(result[result.size() - 2], result.back(), next))
+                new_end--;
+                if (it < new_end)
                 {
-                    result.pop_back();
+                    std::swap(*new_end, *it);
+                    it--; //Check the polygon that was just swapped in next.
+                }
+                else
+                { //Don't self-swap the last path.
+                    break;
                 }
             }
             else
             {
-                result.add(poly[idx]);
+                small_holes.push_back(*it);
             }
         }
+    }
 
-        for(size_t i = end_vertex; i < poly.size(); ++i)
-        {
-            result.add(poly[i]); //Add everything after the end vertex.
-        }
-
-        if(isChanged)
+    //Removes small holes that have their first point inside one of the removed outlines.
+    //Iterating in reverse ensures that unprocessed small holes won't be moved.
+    const auto removed_outlines_start = new_end;
+    for (auto hole_it = small_holes.rbegin(); hole_it < small_holes.rend(); hole_it++)
+    {
+        for (auto outline_it = removed_outlines_start; outline_it < paths.end(); outline_it++)
         {
-            if(for_polyline || result.size() > 2)
-            {
-                *poly = *result;
-            }
-            else
+            if (outline_it->size() > 2 && PolygonRef(*outline_it).inside(*hole_it->begin()))
             {
-                thiss.remove(poly_idx);
-                poly_idx--; // effectively the next iteration has the same poly_idx (referring to a new poly which is not yet processed)
+                new_end--;
+                **hole_it = std::move(*new_end);
+                break;
             }
         }
     }
+    paths.resize(new_end - paths.begin());
 }
 
 Polygons Polygons::toPolygons(ClipperLib::PolyTree& poly_tree)
@@ -666,7 +853,7 @@ Polygons Polygons::toPolygons(ClipperLib::PolyTree& poly_tree)
     return ret;
 }
 
-bool ConstPolygonRef::smooth_corner_complex(const Point p1, ListPolyIt& p0_it, ListPolyIt& p2_it, const int64_t shortcut_length)
+bool ConstPolygonRef::smooth_corner_complex(const Point p1, ArrayPolyIt& p0_it, ArrayPolyIt& p2_it, const int64_t shortcut_length)
 {
     // walk away from the corner until the shortcut > shortcut_length or it would smooth a piece inward
     // - walk in both directions untill shortcut > shortcut_length
@@ -756,8 +943,8 @@ bool ConstPolygonRef::smooth_corner_complex(const Point p1, ListPolyIt& p0_it, L
         //  0
         const int64_t v02_size = sqrt(v02_size2);
 
-        const ListPolyIt p0_2_it = p0_it.prev();
-        const ListPolyIt p2_2_it = p2_it.next();
+        const ArrayPolyIt p0_2_it = p0_it.prev();
+        const ArrayPolyIt p2_2_it = p2_it.next();
         const Point p2_2 = p2_2_it.p();
         const Point p0_2 = p0_2_it.p();
         const Point v02_2 = p0_2 - p2_2;
@@ -765,9 +952,9 @@ bool ConstPolygonRef::smooth_corner_complex(const Point p1, ListPolyIt& p0_it, L
         float progress = std::min(1.0, INT2MM(shortcut_length - v02_size) / INT2MM(v02_2_size - v02_size)); // account for rounding error when v02_2_size is approx equal to v02_size
         assert(progress >= 0.0f && progress <= 1.0f && "shortcut length must be between last length and new length");
         const Point new_p0 = p0_it.p() + (p0_2 - p0_it.p()) * progress;
-        p0_it = ListPolyIt::insertPointNonDuplicate(p0_2_it, p0_it, new_p0);
+        p0_it = ArrayPolyIt::insertPointNonDuplicate(p0_2_it, p0_it, new_p0);
         const Point new_p2 = p2_it.p() + (p2_2 - p2_it.p()) * progress;
-        p2_it = ListPolyIt::insertPointNonDuplicate(p2_it, p2_2_it, new_p2);
+        p2_it = ArrayPolyIt::insertPointNonDuplicate(p2_it, p2_2_it, new_p2);
     }
     else if (!backward_is_blocked)
     { // forward is blocked, back is open
@@ -780,7 +967,7 @@ bool ConstPolygonRef::smooth_corner_complex(const Point p1, ListPolyIt& p0_it, L
         //  |a
         //  |
         //  0_2
-        const ListPolyIt p0_2_it = p0_it.prev();
+        const ArrayPolyIt p0_2_it = p0_it.prev();
         const Point p0 = p0_it.p();
         const Point p0_2 = p0_2_it.p();
         const Point p2 = p2_it.p();
@@ -792,7 +979,7 @@ bool ConstPolygonRef::smooth_corner_complex(const Point p1, ListPolyIt& p0_it, L
 #ifdef ASSERT_INSANE_OUTPUT
             assert(new_p0.X < 400000 && new_p0.Y < 400000);
 #endif // #ifdef ASSERT_INSANE_OUTPUT
-            p0_it = ListPolyIt::insertPointNonDuplicate(p0_2_it, p0_it, new_p0);
+            p0_it = ArrayPolyIt::insertPointNonDuplicate(p0_2_it, p0_it, new_p0);
         }
         else
         { // if not then a rounding error occured
@@ -809,7 +996,7 @@ bool ConstPolygonRef::smooth_corner_complex(const Point p1, ListPolyIt& p0_it, L
         //  |   ,-'
         //--0.-'
         //  a
-        const ListPolyIt p2_2_it = p2_it.next();
+        const ArrayPolyIt p2_2_it = p2_it.next();
         const Point p0 = p0_it.p();
         const Point p2 = p2_it.p();
         const Point p2_2 = p2_2_it.p();
@@ -821,7 +1008,7 @@ bool ConstPolygonRef::smooth_corner_complex(const Point p1, ListPolyIt& p0_it, L
 #ifdef ASSERT_INSANE_OUTPUT
             assert(new_p2.X < 400000 && new_p2.Y < 400000);
 #endif // #ifdef ASSERT_INSANE_OUTPUT
-            p2_it = ListPolyIt::insertPointNonDuplicate(p2_it, p2_2_it, new_p2);
+            p2_it = ArrayPolyIt::insertPointNonDuplicate(p2_it, p2_2_it, new_p2);
         }
         else
         { // if not then a rounding error occured
@@ -848,7 +1035,7 @@ bool ConstPolygonRef::smooth_corner_complex(const Point p1, ListPolyIt& p0_it, L
     return false;
 }
 
-void ConstPolygonRef::smooth_outward_step(const Point p1, const int64_t shortcut_length2, ListPolyIt& p0_it, ListPolyIt& p2_it, bool& forward_is_blocked, bool& backward_is_blocked, bool& forward_is_too_far, bool& backward_is_too_far)
+void ConstPolygonRef::smooth_outward_step(const Point p1, const int64_t shortcut_length2, ArrayPolyIt& p0_it, ArrayPolyIt& p2_it, bool& forward_is_blocked, bool& backward_is_blocked, bool& forward_is_too_far, bool& backward_is_too_far)
 {
     const bool forward_has_converged = forward_is_blocked || forward_is_too_far;
     const bool backward_has_converged = backward_is_blocked || backward_is_too_far;
@@ -858,7 +1045,7 @@ void ConstPolygonRef::smooth_outward_step(const Point p1, const int64_t shortcut
 
     if (walk_forward)
     {
-        const ListPolyIt p2_2_it = p2_it.next();
+        const ArrayPolyIt p2_2_it = p2_it.next();
         const Point p2_2 = p2_2_it.p();
         bool p2_is_left = LinearAlg2D::pointIsLeftOfLine(p2, p0, p2_2) >= 0;
         if (!p2_is_left)
@@ -881,7 +1068,7 @@ void ConstPolygonRef::smooth_outward_step(const Point p1, const int64_t shortcut
     }
     else
     {
-        const ListPolyIt p0_2_it = p0_it.prev();
+        const ArrayPolyIt p0_2_it = p0_it.prev();
         const Point p0_2 = p0_2_it.p();
         bool p0_is_left = LinearAlg2D::pointIsLeftOfLine(p0, p0_2, p2) >= 0;
         if (!p0_is_left)
@@ -904,7 +1091,7 @@ void ConstPolygonRef::smooth_outward_step(const Point p1, const int64_t shortcut
     }
 }
 
-void ConstPolygonRef::smooth_corner_simple(const Point p0, const Point p1, const Point p2, const ListPolyIt p0_it, const ListPolyIt p1_it, const ListPolyIt p2_it, const Point v10, const Point v12, const Point v02, const int64_t shortcut_length, float cos_angle)
+void ConstPolygonRef::smooth_corner_simple(const Point p0, const Point p1, const Point p2, const ArrayPolyIt p0_it, const ArrayPolyIt p1_it, const ArrayPolyIt p2_it, const Point v10, const Point v12, const Point v02, const int64_t shortcut_length, float cos_angle)
 {
     //  1----b---->2
     //  ^   /
@@ -943,8 +1130,8 @@ void ConstPolygonRef::smooth_corner_simple(const Point p0, const Point p1, const
             assert(vSize(a) < 4000000);
             assert(vSize(b) < 4000000);
 #endif // #ifdef ASSERT_INSANE_OUTPUT
-            ListPolyIt::insertPointNonDuplicate(p0_it, p1_it, a);
-            ListPolyIt::insertPointNonDuplicate(p1_it, p2_it, b);
+            ArrayPolyIt::insertPointNonDuplicate(p0_it, p1_it, a);
+            ArrayPolyIt::insertPointNonDuplicate(p1_it, p2_it, b);
             p1_it.remove();
         }
         else if (vSize2(v12) < vSize2(v10))
@@ -958,7 +1145,7 @@ void ConstPolygonRef::smooth_corner_simple(const Point p0, const Point p1, const
             //  |a
             //  |
             //  0
-            const Point& b = p2_it.p();
+            const Point b = p2_it.p();
             Point a;
             bool success = LinearAlg2D::getPointOnLineWithDist(b, p1, p0, shortcut_length, a);
             // v02 has to be longer than ab!
@@ -967,7 +1154,7 @@ void ConstPolygonRef::smooth_corner_simple(const Point p0, const Point p1, const
 #ifdef ASSERT_INSANE_OUTPUT
                 assert(vSize(a) < 4000000);
 #endif // #ifdef ASSERT_INSANE_OUTPUT
-                ListPolyIt::insertPointNonDuplicate(p0_it, p1_it, a);
+                ArrayPolyIt::insertPointNonDuplicate(p0_it, p1_it, a);
             }
             p1_it.remove();
         }
@@ -978,7 +1165,7 @@ void ConstPolygonRef::smooth_corner_simple(const Point p0, const Point p1, const
             //  |   ,-'
             //  0.-'
             //  a
-            const Point& a = p0_it.p();
+            const Point a = p0_it.p();
             Point b;
             bool success = LinearAlg2D::getPointOnLineWithDist(a, p1, p2, shortcut_length, b);
             // v02 has to be longer than ab!
@@ -987,7 +1174,7 @@ void ConstPolygonRef::smooth_corner_simple(const Point p0, const Point p1, const
 #ifdef ASSERT_INSANE_OUTPUT
                 assert(vSize(b) < 4000000);
 #endif // #ifdef ASSERT_INSANE_OUTPUT
-                ListPolyIt::insertPointNonDuplicate(p1_it, p2_it, b);
+                ArrayPolyIt::insertPointNonDuplicate(p1_it, p2_it, b);
             }
             p1_it.remove();
         }
@@ -1015,28 +1202,27 @@ void ConstPolygonRef::smooth_outward(const AngleDegrees min_angle, int shortcut_
     int shortcut_length2 = shortcut_length * shortcut_length;
     float cos_min_angle = cos(min_angle / 180 * M_PI);
 
-    ListPolygon poly;
-    ListPolyIt::convertPolygonToList(*this, poly);
+    ArrayListPolygon poly(*this);
 
     { // remove duplicate vertices
-        ListPolyIt p1_it(poly, poly.begin());
+        ArrayPolyIt p1_it(poly, poly.first());
         do
         {
-            ListPolyIt next = p1_it.next();
+            ArrayPolyIt next = p1_it.next();
             if (vSize2(p1_it.p() - next.p()) < 10 * 10)
             {
                 p1_it.remove();
             }
             p1_it = next;
-        } while (p1_it != ListPolyIt(poly, poly.begin()));
+        } while (p1_it != ArrayPolyIt(poly, poly.first()));
     }
 
-    ListPolyIt p1_it(poly, poly.begin());
+    ArrayPolyIt p1_it(poly, poly.first());
     do
     {
         const Point p1 = p1_it.p();
-        ListPolyIt p0_it = p1_it.prev();
-        ListPolyIt p2_it = p1_it.next();
+        ArrayPolyIt p0_it = p1_it.prev();
+        ArrayPolyIt p2_it = p1_it.next();
         const Point p0 = p0_it.p();
         const Point p2 = p2_it.p();
 
@@ -1057,7 +1243,7 @@ void ConstPolygonRef::smooth_outward(const AngleDegrees min_angle, int shortcut_
                 bool remove_poly = smooth_corner_complex(p1, p0_it, p2_it, shortcut_length); // edits p0_it and p2_it!
                 if (remove_poly)
                 {
-                    // don't convert ListPolygon into result
+                    // don't convert the smoothed polygon into result
                     return;
                 }
             }
@@ -1068,9 +1254,9 @@ void ConstPolygonRef::smooth_outward(const AngleDegrees min_angle, int shortcut_
         {
             ++p1_it;
         }
-    } while (p1_it != ListPolyIt(poly, poly.begin()));
+    } while (p1_it != ArrayPolyIt(poly, poly.first()));
 
-    ListPolyIt::convertListPolygonToPolygon(poly, result);
+    poly.toPolygon(result);
 }
 
 Polygons Polygons::smooth_outward(const AngleDegrees max_angle, int shortcut_length)
@@ -1309,13 +1495,13 @@ double Polygons::area() const
 std::vector<PolygonsPart> Polygons::splitIntoParts(bool unionAll) const
 {
     std::vector<PolygonsPart> ret;
-    ClipperLib::Clipper clipper(clipper_init);
+    ReusableClipper<ClipperLib::Clipper> clipper;
     ClipperLib::PolyTree resultPolyTree;
-    clipper.AddPaths(paths, ClipperLib::ptSubject, true);
+    clipper->AddPaths(paths, ClipperLib::ptSubject, true);
     if (unionAll)
-        clipper.Execute(ClipperLib::ctUnion, resultPolyTree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+        clipper->Execute(ClipperLib::ctUnion, resultPolyTree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
     else
-        clipper.Execute(ClipperLib::ctUnion, resultPolyTree);
+        clipper->Execute(ClipperLib::ctUnion, resultPolyTree);
 
     splitIntoParts_processPolyTreeNode(&resultPolyTree, ret);
     return ret;
@@ -1337,6 +1523,48 @@ void Polygons::splitIntoParts_processPolyTreeNode(ClipperLib::PolyNode* node, st
     }
 }
 
+Polygons Polygons::offsetIntoParts(int distance, std::vector<size_t>& part_starts, ClipperLib::JoinType join_type, double miter_limit) const
+{
+    ClipperLib::PolyTree poly_tree;
+#ifdef CURA_USE_CLIPPER2
+    //Clipper2 doesn't offset into a tree, so the parts need a union of the offset area.
+    const Polygons offsetted = offset(distance, join_type, miter_limit);
+    ReusableClipper<ClipperLib::Clipper> clipper;
+    clipper->AddPaths(offsetted.paths, ClipperLib::ptSubject, true);
+    clipper->Execute(ClipperLib::ctUnion, poly_tree);
+#else
+    const Polygons united = unionPolygons();
+    ReusableClipper<ClipperLib::ClipperOffset> clipper;
+    clipper->MiterLimit = miter_limit;
+    clipper->ArcTolerance = 10.0;
+    clipper->AddPaths(united.paths, join_type, ClipperLib::etClosedPolygon);
+    clipper->Execute(poly_tree, distance);
+#endif
+
+    Polygons ret;
+    part_starts.clear();
+    offsetIntoParts_processPolyTreeNode(poly_tree, ret, part_starts);
+    return ret;
+}
+
+void Polygons::offsetIntoParts_processPolyTreeNode(ClipperLib::PolyNode& node, Polygons& ret, std::vector<size_t>& part_starts)
+{
+    for (ClipperLib::PolyNode* outline : node.Childs)
+    {
+        part_starts.push_back(ret.size());
+        ret.paths.push_back(std::move(outline->Contour));
+        for (ClipperLib::PolyNode* hole : outline->Childs)
+        {
+            ret.paths.push_back(std::move(hole->Contour));
+        }
+        //The parts inside the holes come after this part, so that the polygons of each part stay together.
+        for (ClipperLib::PolyNode* hole : outline->Childs)
+        {
+            offsetIntoParts_processPolyTreeNode(*hole, ret, part_starts);
+        }
+    }
+}
+
 Polygons Polygons::tubeShape(const coord_t inner_offset, const coord_t outer_offset) const
 {
     return this->offset(outer_offset).difference(this->offset(-inner_offset));
@@ -1388,13 +1616,13 @@ PartsView Polygons::splitIntoPartsView(bool unionAll)
 {
     Polygons reordered;
     PartsView partsView(*this);
-    ClipperLib::Clipper clipper(clipper_init);
+    ReusableClipper<ClipperLib::Clipper> clipper;
     ClipperLib::PolyTree resultPolyTree;
-    clipper.AddPaths(paths, ClipperLib::ptSubject, true);
+    clipper->AddPaths(paths, ClipperLib::ptSubject, true);
     if (unionAll)
-        clipper.Execute(ClipperLib::ctUnion, resultPolyTree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+        clipper->Execute(ClipperLib::ctUnion, resultPolyTree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
     else
-        clipper.Execute(ClipperLib::ctUnion, resultPolyTree);
+        clipper->Execute(ClipperLib::ctUnion, resultPolyTree);
 
     splitIntoPartsView_processPolyTreeNode(partsView, reordered, &resultPolyTree);
 
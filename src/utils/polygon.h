@@ -21,7 +21,13 @@
 
 #include "../settings/types/Angle.h" //For angles between vertices.
 #include "../settings/types/Ratio.h"
+#include "AABB.h"
+#include "BatchGeometry.h" //To transform all vertices at once.
 #include "IntPoint.h"
+#include "ReusableClipper.h"
+#ifdef CURA_USE_CLIPPER2
+#include "Clipper2Backend.h"
+#endif
 
 #define CHECK_POLY_ACCESS
 #ifdef CHECK_POLY_ACCESS
@@ -51,10 +57,11 @@ bool shorterThan(const T& shape, const coord_t check_length)
 
 class PartsView;
 class Polygons;
+class PolygonsBounds;
 class Polygon;
 class PolygonRef;
 
-class ListPolyIt;
+class ArrayPolyIt;
 
 typedef std::list<Point> ListPolygon; //!< A polygon represented by a linked list instead of a vector
 typedef std::vector<ListPolygon> ListPolygons; //!< Polygons represented by a vector of linked lists instead of a vector of vectors
@@ -359,7 +366,7 @@ private:
      * \param shortcut_length The desired length ofthe shortcutting line
      * \param cos_angle The cosine on the angle in L 012
      */
-    static void smooth_corner_simple(const Point p0, const Point p1, const Point p2, const ListPolyIt p0_it, const ListPolyIt p1_it, const ListPolyIt p2_it, const Point v10, const Point v12, const Point v02, const int64_t shortcut_length, float cos_angle);
+    static void smooth_corner_simple(const Point p0, const Point p1, const Point p2, const ArrayPolyIt p0_it, const ArrayPolyIt p1_it, const ArrayPolyIt p2_it, const Point v10, const Point v12, const Point v02, const int64_t shortcut_length, float cos_angle);
 
     /*!
      * Smooth out a complex corner where the shortcut bypasses more than two line segments
@@ -375,7 +382,7 @@ private:
      * \param shortcut_length The desired length ofthe shortcutting line
      * \return Whether this whole polygon whould be removed by the smoothing
      */
-    static bool smooth_corner_complex(const Point p1, ListPolyIt& p0_it, ListPolyIt& p2_it, const int64_t shortcut_length);
+    static bool smooth_corner_complex(const Point p1, ArrayPolyIt& p0_it, ArrayPolyIt& p2_it, const int64_t shortcut_length);
 
     /*!
      * Try to take a step away from the corner point in order to take a bigger shortcut.
@@ -393,7 +400,7 @@ private:
      * \param[in,out] forward_is_too_far Whether trying another step forward is blocked by the shortcut length condition. Updated for the next iteration.
      * \param[in,out] backward_is_too_far Whether trying another step backward is blocked by the shortcut length condition. Updated for the next iteration.
      */
-    static void smooth_outward_step(const Point p1, const int64_t shortcut_length2, ListPolyIt& p0_it, ListPolyIt& p2_it, bool& forward_is_blocked, bool& backward_is_blocked, bool& forward_is_too_far, bool& backward_is_too_far);
+    static void smooth_outward_step(const Point p1, const int64_t shortcut_length2, ArrayPolyIt& p0_it, ArrayPolyIt& p2_it, bool& forward_is_blocked, bool& backward_is_blocked, bool& forward_is_too_far, bool& backward_is_too_far);
 };
 
 
@@ -531,6 +538,18 @@ public:
 
     void removeColinearEdges(const AngleRadians max_deviation_angle);
 
+    /*!
+     * Removes overlapping consecutive line segments which don't delimit a
+     * positive area, in place.
+     *
+     * See \ref Polygons::removeDegenerateVerts for removing them from a set of
+     * polygons, which also removes the polygons that become degenerate.
+     * \param for_polyline Leave the endpoints untouched, as the polygon is an
+     * open polyline.
+     * \return Whether any vertices were removed.
+     */
+    bool removeDegenerateVerts(const bool for_polyline = false);
+
     /*!
      * Removes consecutive line segments with same orientation and changes this polygon.
      *
@@ -836,6 +855,22 @@ public:
     {
         std::copy(other.paths.begin(), other.paths.end(), std::back_inserter(paths));
     }
+    /*!
+     * Add all polygons of another set, taking over their storage instead of
+     * copying them.
+     */
+    void add(Polygons&& other)
+    {
+        if (paths.empty())
+        {
+            paths = std::move(other.paths);
+        }
+        else
+        {
+            paths.insert(paths.end(), std::make_move_iterator(other.paths.begin()), std::make_move_iterator(other.paths.end()));
+        }
+        other.paths.clear();
+    }
     /*!
      * Add a 'polygon' consisting of two points
      */
@@ -902,40 +937,145 @@ public:
      */
     static Polygons toPolygons(ClipperLib::PolyTree& poly_tree);
 
-    Polygons difference(const Polygons& other) const
+    Polygons difference(const Polygons& other) const &
     {
         Polygons ret;
-        ClipperLib::Clipper clipper(clipper_init);
-        clipper.AddPaths(paths, ClipperLib::ptSubject, true);
-        clipper.AddPaths(other.paths, ClipperLib::ptClip, true);
-        clipper.Execute(ClipperLib::ctDifference, ret.paths);
+        clipDifference(paths, other.paths, ret.paths);
         return ret;
     }
-    Polygons unionPolygons(const Polygons& other, ClipperLib::PolyFillType fill_type = ClipperLib::pftNonZero) const
+    /*!
+     * Subtract another area from this one, reusing the storage of this
+     * temporary for the result.
+     */
+    Polygons difference(const Polygons& other) &&
+    {
+        return std::move(differenceInPlace(other));
+    }
+    /*!
+     * Subtract another area from this one, replacing this area with the
+     * result.
+     * \param other The area to subtract.
+     * 
+eturn This area, for chaining.
+     */
+    Polygons& differenceInPlace(const Polygons& other)
+    {
+        clipDifference(paths, other.paths, paths);
+        return *this;
+    }
+    Polygons unionPolygons(const Polygons& other, ClipperLib::PolyFillType fill_type = ClipperLib::pftNonZero) const &
     {
         Polygons ret;
-        ClipperLib::Clipper clipper(clipper_init);
-        clipper.AddPaths(paths, ClipperLib::ptSubject, true);
-        clipper.AddPaths(other.paths, ClipperLib::ptSubject, true);
-        clipper.Execute(ClipperLib::ctUnion, ret.paths, fill_type, fill_type);
+        clipUnion(paths, other.paths, fill_type, ret.paths);
         return ret;
     }
+    /*!
+     * Unite this area with another, reusing the storage of this temporary for
+     * the result.
+     */
+    Polygons unionPolygons(const Polygons& other, ClipperLib::PolyFillType fill_type = ClipperLib::pftNonZero) &&
+    {
+        return std::move(unionPolygonsInPlace(other, fill_type));
+    }
     /*!
      * Union all polygons with each other (When polygons.add(polygon) has been called for overlapping polygons)
      */
-    Polygons unionPolygons() const
+    Polygons unionPolygons() const &
     {
         return unionPolygons(Polygons());
     }
-    Polygons intersection(const Polygons& other) const
+    Polygons unionPolygons() &&
+    {
+        return std::move(unionPolygonsInPlace());
+    }
+    /*!
+     * Unite this area with another, replacing this area with the result.
+     * \param other The area to add. When left out, the polygons of this area
+     * are united with each other.
+     * \param fill_type Which regions count as inside.
+     * 
+eturn This area, for chaining.
+     */
+    Polygons& unionPolygonsInPlace(const Polygons& other = Polygons(), ClipperLib::PolyFillType fill_type = ClipperLib::pftNonZero)
+    {
+        clipUnion(paths, other.paths, fill_type, paths);
+        return *this;
+    }
+    Polygons intersection(const Polygons& other) const &
     {
         Polygons ret;
-        ClipperLib::Clipper clipper(clipper_init);
-        clipper.AddPaths(paths, ClipperLib::ptSubject, true);
-        clipper.AddPaths(other.paths, ClipperLib::ptClip, true);
-        clipper.Execute(ClipperLib::ctIntersection, ret.paths);
+        clipIntersection(paths, other.paths, ret.paths);
         return ret;
     }
+    /*!
+     * Intersect this area with another, reusing the storage of this temporary
+     * for the result.
+     */
+    Polygons intersection(const Polygons& other) &&
+    {
+        return std::move(intersectionInPlace(other));
+    }
+    /*!
+     * Intersect this area with another, replacing this area with the result.
+     * \param other The area to intersect with.
+     * 
+eturn This area, for chaining.
+     */
+    Polygons& intersectionInPlace(const Polygons& other)
+    {
+        clipIntersection(paths, other.paths, paths);
+        return *this;
+    }
+
+    /*!
+     * \brief Subtract another area from this one, leaving out the polygons that
+     * can't overlap according to their bounding boxes.
+     *
+     * The polygons of \p other that are far away don't take part in the
+     * operation. Polygons of this area that are far away from \p other are
+     * kept as they are. If nothing overlaps, Clipper is not used at all.
+     *
+     * \note This area must not have overlapping or self-intersecting polygons,
+     * such as the result of an earlier polygon operation, because polygons
+     * that are not affected are returned as they are.
+     * \param other The area to subtract.
+     * \return The area of this that is not inside \p other.
+     */
+    Polygons differenceBounded(const Polygons& other) const;
+
+    /*!
+     * \brief Subtract an area from another, using previously computed bounding
+     * boxes.
+     *
+     * See \ref differenceBounded(const Polygons&) const.
+     * \param subject The area to subtract from.
+     * \param clip The area to subtract.
+     * \return The area of \p subject that is not inside \p clip.
+     */
+    static Polygons differenceBounded(const PolygonsBounds& subject, const PolygonsBounds& clip);
+
+    /*!
+     * \brief Intersect this area with another, leaving out the polygons that
+     * can't overlap according to their bounding boxes.
+     *
+     * Only the polygons of both areas that overlap with the bounding box of
+     * the other area take part in the operation. If there are none, Clipper
+     * is not used at all. The result is the same as that of
+     * \ref intersection.
+     * \param other The area to intersect with.
+     * \return The area that is inside both this and \p other.
+     */
+    Polygons intersectionBounded(const Polygons& other) const;
+
+    /*!
+     * \brief Intersect two areas, using previously computed bounding boxes.
+     *
+     * See \ref intersectionBounded(const Polygons&) const.
+     * \param a One of the areas to intersect.
+     * \param b The other area to intersect.
+     * \return The area that is inside both \p a and \p b.
+     */
+    static Polygons intersectionBounded(const PolygonsBounds& a, const PolygonsBounds& b);
 
     /*!
      * Intersect polylines with this area Polygons object.
@@ -966,33 +1106,64 @@ public:
     Polygons xorPolygons(const Polygons& other, ClipperLib::PolyFillType pft = ClipperLib::pftEvenOdd) const
     {
         Polygons ret;
-        ClipperLib::Clipper clipper(clipper_init);
-        clipper.AddPaths(paths, ClipperLib::ptSubject, true);
-        clipper.AddPaths(other.paths, ClipperLib::ptClip, true);
-        clipper.Execute(ClipperLib::ctXor, ret.paths, pft);
+        ReusableClipper<ClipperLib::Clipper> clipper;
+        clipper->AddPaths(paths, ClipperLib::ptSubject, true);
+        clipper->AddPaths(other.paths, ClipperLib::ptClip, true);
+        clipper->Execute(ClipperLib::ctXor, ret.paths, pft);
         return ret;
     }
 
     Polygons execute (ClipperLib::PolyFillType pft = ClipperLib::pftEvenOdd) const
     {
         Polygons ret;
-        ClipperLib::Clipper clipper(clipper_init);
-        clipper.AddPaths(paths, ClipperLib::ptSubject, true);
-        clipper.Execute(ClipperLib::ctXor, ret.paths, pft);
+        ReusableClipper<ClipperLib::Clipper> clipper;
+        clipper->AddPaths(paths, ClipperLib::ptSubject, true);
+        clipper->Execute(ClipperLib::ctXor, ret.paths, pft);
         return ret;
     }
 
-    Polygons offset(int distance, ClipperLib::JoinType joinType = ClipperLib::jtMiter, double miter_limit = 1.2) const;
+    Polygons offset(int distance, ClipperLib::JoinType joinType = ClipperLib::jtMiter, double miter_limit = 1.2) const &;
+
+    /*!
+     * Offset this area, reusing the storage of this temporary for the result.
+     */
+    Polygons offset(int distance, ClipperLib::JoinType joinType = ClipperLib::jtMiter, double miter_limit = 1.2) &&;
+
+    /*!
+     * Offset this area, replacing it with the result.
+     * \param distance How far to offset. Negative values shrink the area.
+     * \param joinType How to join the offset segments at the corners.
+     * \param miter_limit How far a mitered corner may extend, as a multiple
+     * of the offset distance.
+     * \return This area, for chaining.
+     */
+    Polygons& offsetInPlace(int distance, ClipperLib::JoinType joinType = ClipperLib::jtMiter, double miter_limit = 1.2);
+
+    /*!
+     * \brief Offset these polygons by several distances at once.
+     *
+     * This gives the same results as calling \ref offset for each distance,
+     * but the polygons are unioned only once for all distances, and the
+     * offsets are computed in parallel.
+     * \param distances The distances to offset by.
+     * \param join_type How to join the offset segments at the corners.
+     * \param miter_limit The maximum distance of mitered corners, as a
+     * multiple of the offset distance.
+     * \return The offset polygons, one for each distance, in the same order as
+     * the distances.
+     */
+    std::vector<Polygons> offsetMulti(const std::vector<coord_t>& distances, ClipperLib::JoinType join_type = ClipperLib::jtMiter, double miter_limit = 1.2) const;
 
     Polygons offsetPolyLine(int distance, ClipperLib::JoinType joinType = ClipperLib::jtMiter) const
     {
         Polygons ret;
         double miterLimit = 1.2;
         ClipperLib::EndType end_type = (joinType == ClipperLib::jtMiter)? ClipperLib::etOpenSquare : ClipperLib::etOpenRound;
-        ClipperLib::ClipperOffset clipper(miterLimit, 10.0);
-        clipper.AddPaths(paths, joinType, end_type);
-        clipper.MiterLimit = miterLimit;
-        clipper.Execute(ret.paths, distance);
+        ReusableClipper<ClipperLib::ClipperOffset> clipper;
+        clipper->MiterLimit = miterLimit;
+        clipper->ArcTolerance = 10.0;
+        clipper->AddPaths(paths, joinType, end_type);
+        clipper->Execute(ret.paths, distance);
         return ret;
     }
 
@@ -1158,6 +1329,22 @@ public:
      */
     std::vector<PolygonsPart> splitIntoParts(bool unionAll = false) const;
 
+    /*!
+     * Offset this area and order the result by part: the outline of each part
+     * is followed by its holes, up to the outline of the next part.
+     *
+     * Clipper finds the parts while offsetting, so this saves the union that
+     * splitting the offset area into parts afterwards would need.
+     * \param distance How far to offset. Negative values shrink the area.
+     * \param[out] part_starts The index of the outline of each part in the
+     * result.
+     * \param join_type How to join the offset segments at the corners.
+     * \param miter_limit How far a mitered corner may extend, as a multiple
+     * of the offset distance.
+     * \return The offset area.
+     */
+    Polygons offsetIntoParts(int distance, std::vector<size_t>& part_starts, ClipperLib::JoinType join_type = ClipperLib::jtMiter, double miter_limit = 1.2) const;
+
     /*!
      * Utility method for creating the tube (or 'donut') of a shape.
      * \param inner_offset Offset relative to the original shape-outline towards the inside of the shape. Sort-of like a negative normal offset, except it's the offset part that's kept, not the shape.
@@ -1167,6 +1354,51 @@ public:
     Polygons tubeShape(const coord_t inner_offset, const coord_t outer_offset) const;
 
 private:
+    /*!
+     * The boolean operations on the paths of polygons. The result may be one
+     * of the operands: the operands are copied into Clipper before the result
+     * is written.
+     */
+    static void clipDifference(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip, ClipperLib::Paths& result)
+    {
+#ifdef CURA_USE_CLIPPER2
+        result = clipper2::difference(subject, clip);
+#else
+        ReusableClipper<ClipperLib::Clipper> clipper;
+        clipper->AddPaths(subject, ClipperLib::ptSubject, true);
+        clipper->AddPaths(clip, ClipperLib::ptClip, true);
+        clipper->Execute(ClipperLib::ctDifference, result);
+#endif
+    }
+    static void clipUnion(const ClipperLib::Paths& subject, const ClipperLib::Paths& other, ClipperLib::PolyFillType fill_type, ClipperLib::Paths& result)
+    {
+#ifdef CURA_USE_CLIPPER2
+        result = clipper2::unionPaths(subject, other, fill_type);
+#else
+        ReusableClipper<ClipperLib::Clipper> clipper;
+        clipper->AddPaths(subject, ClipperLib::ptSubject, true);
+        clipper->AddPaths(other, ClipperLib::ptSubject, true);
+        clipper->Execute(ClipperLib::ctUnion, result, fill_type, fill_type);
+#endif
+    }
+    static void clipIntersection(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip, ClipperLib::Paths& result)
+    {
+#ifdef CURA_USE_CLIPPER2
+        result = clipper2::intersection(subject, clip);
+#else
+        ReusableClipper<ClipperLib::Clipper> clipper;
+        clipper->AddPaths(subject, ClipperLib::ptSubject, true);
+        clipper->AddPaths(clip, ClipperLib::ptClip, true);
+        clipper->Execute(ClipperLib::ctIntersection, result);
+#endif
+    }
+
+    /*!
+     * Offset polygons that don't overlap each other, such as the result of a
+     * union. The result may be the input.
+     */
+    static void offsetUnited(const ClipperLib::Paths& united, int distance, ClipperLib::JoinType join_type, double miter_limit, ClipperLib::Paths& result);
+
     /*!
      * recursive part of \ref Polygons::removeEmptyHoles and \ref Polygons::getEmptyHoles
      * \param node The node of the polygons part to process
@@ -1176,6 +1408,12 @@ private:
     void removeEmptyHoles_processPolyTreeNode(const ClipperLib::PolyNode& node, const bool remove_holes, Polygons& ret) const;
     void splitIntoParts_processPolyTreeNode(ClipperLib::PolyNode* node, std::vector<PolygonsPart>& ret) const;
 
+    /*!
+     * Move the polygons of a tree into \p ret ordered by part, for
+     * \ref offsetIntoParts .
+     */
+    static void offsetIntoParts_processPolyTreeNode(ClipperLib::PolyNode& node, Polygons& ret, std::vector<size_t>& part_starts);
+
 public:
     /*!
      * Split up the polygons into groups according to the even-odd rule.
@@ -1196,6 +1434,19 @@ public:
      */
     void removeSmallAreas(const double min_area_size, const bool remove_holes = false);
 
+    /*!
+     * \brief Removes degenerate vertices and small areas in a single pass over
+     * the polygons.
+     *
+     * The result is the same as \ref removeDegenerateVerts followed by
+     * \ref removeSmallAreas, except for the order of the polygons, but each
+     * polygon is only visited once and none are copied.
+     * \param min_area_size The smallest area to keep, in mm^2.
+     * \param remove_holes Whether to remove small holes too, see
+     * \ref removeSmallAreas.
+     */
+    void removeDegenerateVertsAndSmallAreas(const double min_area_size, const bool remove_holes = false);
+
     /*!
      * Removes overlapping consecutive line segments which don't delimit a
      * positive area.
@@ -1288,9 +1539,9 @@ public:
     Polygons processEvenOdd(ClipperLib::PolyFillType poly_fill_type = ClipperLib::PolyFillType::pftEvenOdd) const
     {
         Polygons ret;
-        ClipperLib::Clipper clipper(clipper_init);
-        clipper.AddPaths(paths, ClipperLib::ptSubject, true);
-        clipper.Execute(ClipperLib::ctUnion, ret.paths, poly_fill_type);
+        ReusableClipper<ClipperLib::Clipper> clipper;
+        clipper->AddPaths(paths, ClipperLib::ptSubject, true);
+        clipper->Execute(ClipperLib::ctUnion, ret.paths, poly_fill_type);
         return ret;
     }
 
@@ -1349,10 +1600,7 @@ public:
     {
         for(unsigned int i=0; i<paths.size(); i++)
         {
-            for(unsigned int j=0; j<paths[i].size(); j++)
-            {
-                paths[i][j] = matrix.apply(paths[i][j]);
-            }
+            BatchGeometry::applyMatrix(matrix, paths[i]);
         }
     }
 
@@ -1394,6 +1642,42 @@ public:
     bool inside(Point p, bool border_result = false) const;
 };
 
+/*!
+ * \brief The bounding boxes of the polygons in a Polygons object.
+ *
+ * Computing these once allows performing many bounded polygon operations (see
+ * \ref Polygons::differenceBounded and \ref Polygons::intersectionBounded)
+ * with the same polygons without recomputing the bounding boxes every time.
+ *
+ * The polygons are referred to, not copied. They must not change while the
+ * bounds are in use.
+ */
+class PolygonsBounds
+{
+public:
+    /*!
+     * Compute the bounding boxes of some polygons.
+     * \param polygons The polygons to compute the bounding boxes of.
+     */
+    PolygonsBounds(const Polygons& polygons);
+
+    const Polygons& polygons; //!< The polygons that the bounding boxes belong to.
+    std::vector<AABB> boxes; //!< The bounding box of each polygon, in the same order as the polygons.
+    AABB total; //!< The bounding box around all polygons.
+
+    /*!
+     * \brief Get the polygons of which the bounding box overlaps with a given
+     * box.
+     * \param box The box to check against.
+     * \param[out] overlapping_box The bounding box around all polygons that
+     * overlap.
+     * \param[out] rest If given, the polygons that don't overlap are added to
+     * this.
+     * \return The polygons that overlap with \p box.
+     */
+    Polygons getOverlapping(const AABB& box, AABB& overlapping_box, Polygons* rest = nullptr) const;
+};
+
 /*!
  * Extension of vector<vector<unsigned int>> which is similar to a vector of PolygonParts, except the base of the container is indices to polygons into the original Polygons, instead of the polygons themselves
  */
@@ -1,11 +1,15 @@
 //Copyright (c) 2021 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For std::sort.
 #include <array>
 #include <list>
 #include <sstream>
+#include <tuple> //For std::tie.
 #include <unordered_set>
 
+#include "AABB.h" //To find the scanlines for approximateRelativeHammingDistance.
+#include "BatchGeometry.h" //To find the closest point on a polygon.
 #include "linearAlg2D.h"
 #include "polygonUtils.h"
 #include "SparsePointGridInclusive.h"
@@ -13,7 +17,6 @@
 #include "../infill.h"
 
 #ifdef DEBUG
-#include "AABB.h"
 #include "SVG.h"
 #endif
 
@@ -854,6 +857,12 @@ ClosestPolygonPoint PolygonUtils::findClosest(Point from, ConstPolygonRef polygo
     {
         return ClosestPolygonPoint(polygon);
     }
+    if (&penalty_function == &no_penalty_function) //Only the distance counts, so line segments that are far away can be skipped.
+    {
+        Point best;
+        const size_t best_pos = BatchGeometry::findClosestOnPolygon(from, *polygon, best);
+        return ClosestPolygonPoint(best, best_pos, polygon);
+    }
     Point aPoint = polygon[0];
     Point best = aPoint;
 
@@ -1359,6 +1368,89 @@ double PolygonUtils::relativeHammingDistance(const Polygons& poly_a, const Polyg
     return hamming_distance / total_area;
 }
 
+double PolygonUtils::approximateRelativeHammingDistance(const Polygons& poly_a, const Polygons& poly_b, const coord_t resolution, const double threshold)
+{
+    const double total_area = std::abs(poly_a.area()) + std::abs(poly_b.area());
+    if (total_area == 0.0 || resolution <= 0)
+    {
+        return relativeHammingDistance(poly_a, poly_b); //Only exactly equal lines have a distance of 0, which scanlines can't see.
+    }
+
+    AABB bounding_box(poly_a);
+    bounding_box.include(AABB(poly_b));
+    const size_t scanline_count = (bounding_box.max.Y - bounding_box.min.Y) / resolution + 1;
+    //The scanlines are in the middle of their bands.
+    const auto scanlineY = [&bounding_box, resolution](const size_t scanline_idx)
+    {
+        return bounding_box.min.Y + (static_cast<double>(scanline_idx) + 0.5) * resolution;
+    };
+
+    //Find where the edges of both polygons cross each scanline.
+    //Along a scanline, the symmetric difference switches between inside and outside at every crossing of either polygon.
+    std::vector<size_t> scanline_starts(scanline_count + 1, 0);
+    std::vector<std::pair<size_t, double>> crossings;
+    for (const Polygons* polygons : {&poly_a, &poly_b})
+    {
+        for (ConstPolygonRef polygon : *polygons)
+        {
+            if (polygon.size() < 3)
+            {
+                continue; //No area.
+            }
+            Point previous = polygon.back();
+            for (const Point& vertex : polygon)
+            {
+                const Point& low = previous.Y < vertex.Y ? previous : vertex;
+                const Point& high = previous.Y < vertex.Y ? vertex : previous;
+                //First scanline at or above the low end, up to the last one below the high end.
+                for (size_t scanline_idx = std::max(0.0, std::ceil(static_cast<double>(low.Y - bounding_box.min.Y) / resolution - 0.5)); scanline_idx < scanline_count && scanlineY(scanline_idx) < high.Y; scanline_idx++)
+                {
+                    const double y = scanlineY(scanline_idx);
+                    if (y < low.Y)
+                    {
+                        continue;
+                    }
+                    const double x = low.X + (high.X - low.X) * (y - low.Y) / (high.Y - low.Y);
+                    crossings.emplace_back(scanline_idx, x);
+                    scanline_starts[scanline_idx + 1]++;
+                }
+                previous = vertex;
+            }
+        }
+    }
+
+    //Sort the crossings by scanline, then each scanline by X when it's processed, so that stopping early skips the rest.
+    for (size_t scanline_idx = 0; scanline_idx < scanline_count; scanline_idx++)
+    {
+        scanline_starts[scanline_idx + 1] += scanline_starts[scanline_idx];
+    }
+    std::vector<double> crossings_x(crossings.size());
+    std::vector<size_t> scanline_fill(scanline_starts.begin(), scanline_starts.end() - 1);
+    for (const std::pair<size_t, double>& crossing : crossings)
+    {
+        crossings_x[scanline_fill[crossing.first]++] = crossing.second;
+    }
+
+    const double max_error = static_cast<double>(resolution) * (poly_a.polygonLength() + poly_b.polygonLength());
+    const double stop_area = threshold * total_area + max_error;
+    double hamming_distance = 0.0;
+    for (size_t scanline_idx = 0; scanline_idx < scanline_count; scanline_idx++)
+    {
+        const std::vector<double>::iterator begin = crossings_x.begin() + scanline_starts[scanline_idx];
+        const std::vector<double>::iterator end = crossings_x.begin() + scanline_starts[scanline_idx + 1];
+        std::sort(begin, end);
+        for (std::vector<double>::iterator crossing = begin; crossing + 1 < end; crossing += 2)
+        {
+            hamming_distance += (*(crossing + 1) - *crossing) * resolution;
+        }
+        if (hamming_distance > stop_area)
+        {
+            break;
+        }
+    }
+    return std::min(1.0, hamming_distance / total_area);
+}
+
 Polygon PolygonUtils::makeCircle(const Point mid, const coord_t radius, const AngleRadians a_step)
 {
     Polygon circle;
@@ -1369,6 +1461,65 @@ Polygon PolygonUtils::makeCircle(const Point mid, const coord_t radius, const An
     return circle;
 }
 
+Polygons PolygonUtils::unionByCell(const Polygons& polygons, const coord_t cell_size)
+{
+    constexpr size_t min_polygons_per_cell = 4; //With fewer than this per cell on average, unioning per cell doesn't merge enough to pay off.
+    if (polygons.size() < 2 * min_polygons_per_cell || cell_size <= 0)
+    {
+        return polygons.unionPolygons();
+    }
+
+    //Sort the polygons by their cell, so that each group is consecutive.
+    std::vector<std::pair<Point, size_t>> cell_per_polygon;
+    cell_per_polygon.reserve(polygons.size());
+    for (size_t poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+    {
+        if (polygons[poly_idx].empty())
+        {
+            continue;
+        }
+        const Point& first = polygons[poly_idx][0];
+        const Point cell((first.X >= 0 ? first.X : first.X - cell_size + 1) / cell_size, (first.Y >= 0 ? first.Y : first.Y - cell_size + 1) / cell_size); //Round down, also for negative coordinates.
+        cell_per_polygon.emplace_back(cell, poly_idx);
+    }
+    std::sort(cell_per_polygon.begin(), cell_per_polygon.end(), [](const std::pair<Point, size_t>& a, const std::pair<Point, size_t>& b)
+    {
+        return std::tie(a.first.X, a.first.Y, a.second) < std::tie(b.first.X, b.first.Y, b.second);
+    });
+
+    size_t cell_count = 1;
+    for (size_t entry_idx = 1; entry_idx < cell_per_polygon.size(); entry_idx++)
+    {
+        cell_count += cell_per_polygon[entry_idx].first != cell_per_polygon[entry_idx - 1].first;
+    }
+    if (cell_count * min_polygons_per_cell > polygons.size())
+    {
+        return polygons.unionPolygons(); //Too spread out. The union per cell would hardly merge anything.
+    }
+
+    Polygons merged;
+    for (size_t group_start = 0; group_start < cell_per_polygon.size(); )
+    {
+        size_t group_end = group_start + 1;
+        while (group_end < cell_per_polygon.size() && cell_per_polygon[group_end].first == cell_per_polygon[group_start].first)
+        {
+            group_end++;
+        }
+        Polygons group;
+        for (size_t entry_idx = group_start; entry_idx < group_end; entry_idx++)
+        {
+            group.add(polygons[cell_per_polygon[entry_idx].second]);
+        }
+        if (group_end - group_start > 1)
+        {
+            group.unionPolygonsInPlace();
+        }
+        merged.add(std::move(group));
+        group_start = group_end;
+    }
+    return std::move(merged.unionPolygonsInPlace());
+}
+
 
 Polygons PolygonUtils::connect(const Polygons& input)
 {
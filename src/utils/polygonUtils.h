@@ -90,6 +90,7 @@ typedef SparseLineGrid<PolygonsPointIndex, PolygonsPointIndexSegmentLocator> Loc
 
 class PolygonUtils 
 {
+    friend class IndexedPolygons; //To reuse the second half of moveInside2.
 public:
     static const std::function<int(Point)> no_penalty_function; //!< Function always returning zero
 
@@ -588,6 +589,28 @@ public:
      */
     static double relativeHammingDistance(const Polygons& poly_a, const Polygons& poly_b);
 
+    /*!
+     * Estimate the Hamming Distance between two polygons relative to their
+     * own surface areas, without computing the symmetric difference.
+     *
+     * The polygons are intersected with horizontal scanlines, \p resolution
+     * apart. Along each scanline, the length that is inside exactly one of the
+     * polygons is exact, and each scanline stands for the area of its band. The
+     * error of the estimated area of the symmetric difference is at most about
+     * \p resolution times the total length of the outlines, relative to the
+     * total area.
+     * \param poly_a One of the polygons to compute the distance between.
+     * \param poly_b One of the polygons to compute the distance between.
+     * \param resolution The distance between the scanlines. Smaller is more
+     * accurate but slower.
+     * \param threshold Stop as soon as the distance is certainly greater than
+     * this, even with the error of the estimate. The result is then greater
+     * than the threshold, but not the full estimate.
+     * \return The estimated Hamming Distance relative to the total surface
+     * area of the two polygons, between 0.0 and 1.0.
+     */
+    static double approximateRelativeHammingDistance(const Polygons& poly_a, const Polygons& poly_b, const coord_t resolution, const double threshold = 1.0);
+
     /*!
      * Create an approximation of a circle.
      *
@@ -599,6 +622,21 @@ public:
      */
     static Polygon makeCircle(const Point mid, const coord_t radius, const AngleRadians a_step = M_PI / 8);
 
+    /*!
+     * Union many small polygons, such as the circles of tree support.
+     *
+     * The polygons are grouped by the grid cell that their first vertex is
+     * in. Each group is unioned on its own, which merges the overlapping
+     * polygons while Clipper only sweeps over a small area, and then the
+     * merged groups are unioned together. The result covers the same area as
+     * \ref Polygons::unionPolygons.
+     * \param polygons The polygons to union, which are expected to be small
+     * compared to the cell size.
+     * \param cell_size The size of the cells to group the polygons by.
+     * \return The union of all polygons.
+     */
+    static Polygons unionByCell(const Polygons& polygons, const coord_t cell_size);
+
     /*!
      * Connect all polygons to their holes using zero widths hole channels, so that the polygons and their outlines are connected together
      */
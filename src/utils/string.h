@@ -4,9 +4,15 @@
 #ifndef UTILS_STRING_H
 #define UTILS_STRING_H
 
+#include <algorithm> // std::min
+#include <cmath> // std::abs, std::floor, std::signbit
+#include <cstdint>
+#include <cstdio> // snprintf
+#include <cstdlib> // std::abs
+#include <cstring> // std::memmove
 #include <ctype.h>
-#include <cstdio> // sprintf
 #include <sstream> // ostringstream
+#include <string>
 
 #include "logoutput.h"
 
@@ -26,6 +32,37 @@ static inline int stringcasecompare(const char* a, const char* b)
     return *a - *b;
 }
 
+/*!
+ * Write the decimal digits of an unsigned integer to a character buffer.
+ *
+ * \param value The integer to write.
+ * \param min_digits Pad the number with leading zeros up to this many digits.
+ * \param buffer The buffer to write to. It must have room for at least 20
+ * characters, or \p min_digits if that is more.
+ * \return The position after the last written character.
+ */
+static inline char* writeDigits(uint64_t value, const unsigned int min_digits, char* buffer)
+{
+    char reversed[24];
+    unsigned int digit_count = 0;
+    do
+    {
+        reversed[digit_count++] = '0' + static_cast<char>(value % 10);
+        value /= 10;
+    }
+    while (value > 0 || digit_count < min_digits);
+    while (digit_count > 0)
+    {
+        *buffer++ = reversed[--digit_count];
+    }
+    return buffer;
+}
+
+/*!
+ * The number of characters that writeInt2mm may write to a character buffer.
+ */
+constexpr size_t int2mm_buffer_size = 16;
+
 /*!
  * Efficient conversion of micron integer type to millimeter string.
  * 
@@ -33,67 +70,69 @@ static inline int stringcasecompare(const char* a, const char* b)
  * However, half the integer type should suffice, because we made the basic coord_t twice as big as necessary
  * so as to support multiplication within the same integer type.
  * 
+ * Trailing zeros (and the decimal dot, if nothing remains after it) are left
+ * out. Negative numbers between -1mm and -0.1mm are written without a zero
+ * before the decimal dot, e.g. "-.5", which is what the g-code has always had.
+ *
  * \param coord The micron unit to convert
- * \param ss The output stream to write the string to
+ * \param buffer The buffer to write the string to. It must have room for at
+ * least \ref int2mm_buffer_size characters. No null character is written.
+ * \return The position after the last written character.
  */
-static inline void writeInt2mm(const int32_t coord, std::ostream& ss)
+static inline char* writeInt2mm(const int32_t coord, char* buffer)
 {
-    constexpr size_t buffer_size = 24;
-    char buffer[buffer_size];
-    int char_count = sprintf(buffer, "%d", coord); // we haven't found any way for the windows compiler to accept formatting of a coord_t, so it has to be int32_t instead
-#ifdef DEBUG
-    if (char_count + 1 >= int(buffer_size)) // + 1 for the null character
+    if (coord == 0)
     {
-        logError("Cannot write %ld to buffer of size %i", coord, buffer_size);
+        *buffer++ = '0';
+        return buffer;
     }
-    if (char_count < 0)
+    uint64_t magnitude = std::abs(static_cast<int64_t>(coord));
+    if (coord < 0)
     {
-        logError("Encoding error while writing %ld", coord);
+        *buffer++ = '-';
     }
-#endif // DEBUG
-    int end_pos = char_count; // the first character not to write any more
-    int trailing_zeros = 1;
-    while (trailing_zeros < 4 && buffer[char_count - trailing_zeros] == '0')
+    const uint64_t whole_mm = magnitude / 1000;
+    if (whole_mm > 0 || coord > -100) //Only -0.999 up to -0.1mm have no leading zero.
     {
-        trailing_zeros++;
+        buffer = writeDigits(whole_mm, 1, buffer);
     }
-    trailing_zeros--;
-    end_pos = char_count - trailing_zeros;
-    if (trailing_zeros == 3)
+    uint64_t fraction = magnitude % 1000;
+    if (fraction == 0)
     { // no need to write the decimal dot
-        buffer[char_count - trailing_zeros] = '\0';
-        ss << buffer;
-        return;
+        return buffer;
     }
-    if (char_count <= 3)
+    *buffer++ = '.';
+    unsigned int fraction_digits = 3;
+    while (fraction % 10 == 0)
     {
-        int start = 0; // where to start writing from the buffer
-        if (coord < 0)
-        {
-            ss << '-';
-            start = 1;
-        }
-        ss << "0.";
-        for (int nulls = char_count - start; nulls < 3; nulls++)
-        { // fill up to 3 decimals with zeros
-            ss << '0';
-        }
-        buffer[char_count - trailing_zeros] = '\0';
-        ss << (static_cast<char*>(buffer) + start);
-    }
-    else
-    {
-        char prev = '.';
-        int pos;
-        for (pos = char_count - 3; pos <= end_pos; pos++)
-        { // shift all characters and insert the decimal dot
-            char next_prev = buffer[pos];
-            buffer[pos] = prev;
-            prev = next_prev;
-        }
-        buffer[pos] = '\0';
-        ss << buffer;
+        fraction /= 10;
+        fraction_digits--;
     }
+    return writeDigits(fraction, fraction_digits, buffer);
+}
+
+/*!
+ * Efficient conversion of micron integer type to millimeter string.
+ *
+ * \param coord The micron unit to convert
+ * \param ss The output stream to write the string to
+ */
+static inline void writeInt2mm(const int32_t coord, std::ostream& ss)
+{
+    char buffer[int2mm_buffer_size];
+    ss.write(buffer, writeInt2mm(coord, buffer) - buffer);
+}
+
+/*!
+ * Efficient conversion of micron integer type to millimeter string.
+ *
+ * \param coord The micron unit to convert
+ * \param str The string to append the millimeters to
+ */
+static inline void writeInt2mm(const int32_t coord, std::string& str)
+{
+    char buffer[int2mm_buffer_size];
+    str.append(buffer, writeInt2mm(coord, buffer));
 }
 
 /*!
@@ -111,27 +150,74 @@ struct MMtoStream
 };
 
 /*!
- * Efficient writing of a double to a stringstream
- * 
+ * The number of characters that writeDoubleToBuffer may write to a character
+ * buffer.
+ */
+constexpr size_t double_buffer_size = 400;
+
+/*!
+ * Efficient writing of a double to a character buffer
+ *
  * writes with \p precision digits after the decimal dot, but removes trailing zeros
- * 
+ *
+ * The result is the same as that of sprintf with the "%.xF" format, with the
+ * trailing zeros removed. Most numbers are converted with integer arithmetic.
+ * Only numbers that are too big for that, or that lie so close to halfway
+ * between two rounded values that the rounding can't be determined reliably,
+ * go through sprintf.
+ *
  * \warning only works with precision up to 9 and input up to 10^14
- * 
+ *
  * \param precision The number of (non-zero) digits after the decimal dot
  * \param coord double to output
- * \param ss The output stream to write the string to
+ * \param buffer The buffer to write the string to. It must have room for at
+ * least \ref double_buffer_size characters. No null character is written.
+ * \return The position after the last written character.
  */
-static inline void writeDoubleToStream(const unsigned int precision, const double coord, std::ostream& ss)
+static inline char* writeDoubleToBuffer(const unsigned int precision, const double coord, char* buffer)
 {
+    constexpr double powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+    constexpr double max_scaled = 4e15; //Below 2^52, so that doubles can still represent half units.
+    constexpr double relative_error = 2.3e-16; //Twice the rounding error of a multiplication.
+    if (precision < sizeof(powers_of_ten) / sizeof(powers_of_ten[0]))
+    {
+        const double scaled = std::abs(coord) * powers_of_ten[precision];
+        if (scaled < max_scaled) //Also false for infinity and NaN.
+        {
+            const double whole = std::floor(scaled);
+            const double fraction = scaled - whole; //Exact.
+            if (std::abs(fraction - 0.5) > scaled * relative_error) //Rounding up or down is certain.
+            {
+                uint64_t rounded = static_cast<uint64_t>(whole) + (fraction > 0.5 ? 1 : 0);
+                if (std::signbit(coord))
+                {
+                    *buffer++ = '-';
+                }
+                unsigned int decimals = precision;
+                while (decimals > 0 && rounded % 10 == 0)
+                {
+                    rounded /= 10;
+                    decimals--;
+                }
+                buffer = writeDigits(rounded, decimals + 1, buffer);
+                if (decimals > 0)
+                { // shift the decimals and insert the decimal dot
+                    std::memmove(buffer - decimals + 1, buffer - decimals, decimals);
+                    *(buffer - decimals) = '.';
+                    buffer++;
+                }
+                return buffer;
+            }
+        }
+    }
+
     char format[5] = "%.xF"; // write a float with [x] digits after the dot
     format[2] = '0' + precision; // set [x]
-    constexpr size_t buffer_size = 400;
-    char buffer[buffer_size];
-    int char_count = sprintf(buffer, format, coord);
+    int char_count = snprintf(buffer, double_buffer_size, format, coord);
 #ifdef DEBUG
-    if (char_count + 1 >= int(buffer_size)) // + 1 for the null character
+    if (char_count + 1 >= int(double_buffer_size)) // + 1 for the null character
     {
-        logError("Cannot write %f to buffer of size %i", coord, buffer_size);
+        logError("Cannot write %f to buffer of size %i", coord, double_buffer_size);
     }
     if (char_count < 0)
     {
@@ -140,9 +226,10 @@ static inline void writeDoubleToStream(const unsigned int precision, const doubl
 #endif // DEBUG
     if (char_count <= 0)
     {
-        return;
+        return buffer;
     }
-    if (buffer[char_count - precision - 1] == '.')
+    char_count = std::min(char_count, static_cast<int>(double_buffer_size) - 1);
+    if (char_count > static_cast<int>(precision) && buffer[char_count - static_cast<int>(precision) - 1] == '.')
     {
         int non_nul_pos = char_count - 1;
         while (buffer[non_nul_pos] == '0')
@@ -151,14 +238,45 @@ static inline void writeDoubleToStream(const unsigned int precision, const doubl
         }
         if (buffer[non_nul_pos] == '.')
         {
-            buffer[non_nul_pos] = '\0';
-        }
-        else
-        {
-            buffer[non_nul_pos + 1] = '\0';
+            return buffer + non_nul_pos;
         }
+        return buffer + non_nul_pos + 1;
     }
-    ss << buffer;
+    return buffer + char_count;
+}
+
+/*!
+ * Efficient writing of a double to a stringstream
+ * 
+ * writes with \p precision digits after the decimal dot, but removes trailing zeros
+ * 
+ * \warning only works with precision up to 9 and input up to 10^14
+ * 
+ * \param precision The number of (non-zero) digits after the decimal dot
+ * \param coord double to output
+ * \param ss The output stream to write the string to
+ */
+static inline void writeDoubleToStream(const unsigned int precision, const double coord, std::ostream& ss)
+{
+    char buffer[double_buffer_size];
+    ss.write(buffer, writeDoubleToBuffer(precision, coord, buffer) - buffer);
+}
+
+/*!
+ * Efficient writing of a double to a string
+ *
+ * writes with \p precision digits after the decimal dot, but removes trailing zeros
+ *
+ * \warning only works with precision up to 9 and input up to 10^14
+ *
+ * \param precision The number of (non-zero) digits after the decimal dot
+ * \param coord double to output
+ * \param str The string to append the number to
+ */
+static inline void writeDoubleToString(const unsigned int precision, const double coord, std::string& str)
+{
+    char buffer[double_buffer_size];
+    str.append(buffer, writeDoubleToBuffer(precision, coord, buffer));
 }
 
 /*!
@@ -0,0 +1,88 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/pathPlanning/CombPathCache.h" //The class under test.
+
+namespace cura
+{
+
+class CombPathCacheTest : public testing::Test
+{
+public:
+    Polygons square;
+    Polygons smaller_square;
+    CombPathCache::Parameters parameters;
+
+    void SetUp() override
+    {
+        square.add(makeSquare(10000));
+        smaller_square.add(makeSquare(9000));
+        parameters = CombPathCache::Parameters{100, 625, 400};
+    }
+
+    Polygon makeSquare(const coord_t size)
+    {
+        Polygon result;
+        result.add(Point(0, 0));
+        result.add(Point(size, 0));
+        result.add(Point(size, size));
+        result.add(Point(0, size));
+        return result;
+    }
+};
+
+/*!
+ * Layers with the same boundaries share their travels, while layers with other
+ * boundaries or parameters don't.
+ */
+TEST_F(CombPathCacheTest, SameBoundariesShareTravels)
+{
+    CombPathCache cache;
+    const std::shared_ptr<CombPathCache::Travels> first = cache.getTravels(square, smaller_square, parameters);
+    ASSERT_NE(first, nullptr);
+
+    Polygons same_square;
+    same_square.add(makeSquare(10000));
+    EXPECT_EQ(cache.getTravels(same_square, smaller_square, parameters), first) << "Equal boundaries must give the same travels.";
+    EXPECT_NE(cache.getTravels(smaller_square, smaller_square, parameters), first) << "Other boundaries must give other travels.";
+
+    CombPathCache::Parameters other_parameters = parameters;
+    other_parameters.travel_avoid_distance++;
+    EXPECT_NE(cache.getTravels(square, smaller_square, other_parameters), first) << "Other parameters must give other travels.";
+}
+
+/*!
+ * The combing of a travel is found back only for exactly the same travel.
+ */
+TEST_F(CombPathCacheTest, FindInsertedTravel)
+{
+    CombPathCache cache;
+    const std::shared_ptr<CombPathCache::Travels> travels = cache.getTravels(square, smaller_square, parameters);
+    ASSERT_NE(travels, nullptr);
+
+    const CombPathCache::Travel travel{0, Point(1000, 1000), Point(8000, 8000), true, true, 200};
+    EXPECT_EQ(travels->find(travel), nullptr) << "Nothing was combed yet.";
+
+    CombPaths comb_paths;
+    comb_paths.emplace_back();
+    comb_paths.back().push_back(Point(1000, 1000));
+    comb_paths.back().push_back(Point(8000, 8000));
+    travels->insert(travel, std::make_shared<const CombPathCache::Result>(CombPathCache::Result{true, comb_paths, false, false, 0, nullptr}));
+
+    const std::shared_ptr<const CombPathCache::Result> found = travels->find(travel);
+    ASSERT_NE(found, nullptr);
+    EXPECT_TRUE(found->combed);
+    ASSERT_EQ(found->comb_paths.size(), 1);
+    EXPECT_EQ(found->comb_paths[0].size(), 2);
+
+    CombPathCache::Travel other_travel = travel;
+    other_travel.end.X++;
+    EXPECT_EQ(travels->find(other_travel), nullptr) << "A travel to another point must be combed again.";
+    other_travel = travel;
+    other_travel.extruder_nr = 1;
+    EXPECT_EQ(travels->find(other_travel), nullptr) << "A travel with another extruder must be combed again.";
+}
+
+} //namespace cura
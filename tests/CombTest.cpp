@@ -0,0 +1,110 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/Application.h" //To provide settings for the combing.
+#include "../src/ExtruderTrain.h" //The extruder that travels.
+#include "../src/mesh.h" //To create a mesh with a part on the layer.
+#include "../src/pathPlanning/Comb.h" //The class under test.
+#include "../src/pathPlanning/CombPaths.h" //To check the resulting travels.
+#include "../src/Slice.h" //To provide settings for the combing.
+#include "../src/sliceDataStorage.h" //To provide the outlines of the layer.
+
+namespace cura
+{
+
+/*!
+ * A fixture with a layer that has a single square part, to comb around.
+ */
+class CombTest : public testing::Test
+{
+public:
+    /*!
+     * Sliced layers with the square part on layer 0.
+     */
+    SliceDataStorage* storage;
+
+    void SetUp() override
+    {
+        constexpr size_t num_mesh_groups = 1;
+        Application::getInstance().current_slice = new Slice(num_mesh_groups);
+        Settings& settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
+        settings.add("anti_overhang_mesh", "false");
+        settings.add("infill_mesh", "false");
+        settings.add("machine_center_is_zero", "false");
+        settings.add("machine_depth", "1000");
+        settings.add("machine_height", "1000");
+        settings.add("machine_width", "1000");
+        settings.add("magic_mesh_surface_mode", "normal");
+        settings.add("retraction_hop_enabled", "false");
+        settings.add("retraction_hop_only_when_collides", "false");
+        settings.add("travel_avoid_other_parts", "true");
+        settings.add("travel_avoid_supports", "false");
+        Application::getInstance().current_slice->scene.extruders.emplace_back(0, &settings);
+
+        storage = new SliceDataStorage();
+        Mesh mesh(settings);
+        storage->meshes.emplace_back(&mesh, 1);
+
+        //A square of 2x2mm around 4,0mm.
+        SliceLayerPart part;
+        Polygon square;
+        square.add(Point(3000, -1000));
+        square.add(Point(5000, -1000));
+        square.add(Point(5000, 1000));
+        square.add(Point(3000, 1000));
+        part.outline.add(square);
+        part.print_outline = part.outline;
+        part.boundaryBox = AABB(part.outline);
+        storage->meshes.back().layers[0].parts.push_back(part);
+    }
+
+    void TearDown() override
+    {
+        delete storage;
+        delete Application::getInstance().current_slice;
+    }
+
+    /*!
+     * Travel on layer 0 between two points outside of the square. The comb
+     * boundaries are empty, so the travel is entirely through air.
+     * \param start The start of the travel.
+     * \param end The end of the travel.
+     * \return The resulting comb paths.
+     */
+    CombPaths travel(const Point start, const Point end)
+    {
+        const Polygons no_boundary;
+        Comb comb(*storage, /*layer_nr=*/0, no_boundary, no_boundary, /*comb_boundary_offset=*/20, /*travel_avoid_distance=*/5000, /*move_inside_distance=*/10);
+        CombPaths comb_paths;
+        bool unretract_before_last_travel_move = false;
+        const ExtruderTrain& train = Application::getInstance().current_slice->scene.extruders[0];
+        EXPECT_TRUE(comb.calc(train, start, end, comb_paths, /*start_inside=*/false, /*end_inside=*/false, /*max_comb_distance_ignored=*/0, unretract_before_last_travel_move));
+        return comb_paths;
+    }
+};
+
+/*!
+ * A short travel outside of the parts that goes straight through a part of the
+ * model crosses the boundary, so it must be marked as such to retract or hop.
+ */
+TEST_F(CombTest, ShortTravelThroughModelCrossesBoundary)
+{
+    const CombPaths comb_paths = travel(Point(0, 0), Point(8000, 0));
+    ASSERT_FALSE(comb_paths.empty());
+    EXPECT_TRUE(comb_paths.back().cross_boundary) << "The travel goes right through the square, so it crosses the model boundary.";
+}
+
+/*!
+ * A short travel outside of the parts that passes next to the model doesn't
+ * cross the boundary.
+ */
+TEST_F(CombTest, ShortTravelBesideModelDoesntCrossBoundary)
+{
+    const CombPaths comb_paths = travel(Point(0, 2000), Point(8000, 2000));
+    ASSERT_FALSE(comb_paths.empty());
+    EXPECT_FALSE(comb_paths.back().cross_boundary) << "The travel passes the square at 1mm distance, so it doesn't cross the model boundary.";
+}
+
+} //namespace cura
@@ -344,6 +344,59 @@ TEST_P(ExtruderPlanPathsParameterizedTest, BackPressureCompensationHalf)
     }
 }
 
+/*!
+ * Tests that the time estimates computed before the starting position is known
+ * are the same as when it's known from the start, once the path that depends
+ * on it is estimated again.
+ */
+TEST_P(ExtruderPlanPathsParameterizedTest, NaiveTimeEstimatesWithoutStartingPosition)
+{
+    extruder_plan.paths = GetParam();
+    const Point starting_position(-5000, 3000);
+    extruder_plan.computeNaiveTimeEstimates(starting_position);
+    std::vector<TimeMaterialEstimates> expected;
+    for (const GCodePath& path : extruder_plan.paths)
+    {
+        expected.push_back(path.estimates);
+    }
+    EXPECT_FALSE(extruder_plan.path_from_starting_position) << "The starting position was known, so no path needs to be estimated again.";
+
+    extruder_plan.computeNaiveTimeEstimates(std::nullopt);
+    ASSERT_TRUE(extruder_plan.path_from_starting_position);
+    EXPECT_EQ(*extruder_plan.path_from_starting_position, 0) << "The first path has points, so only that one depends on the starting position.";
+    extruder_plan.computeNaiveTimeEstimates(extruder_plan.paths[*extruder_plan.path_from_starting_position], starting_position);
+
+    for (size_t path_idx = 0; path_idx < extruder_plan.paths.size(); path_idx++)
+    {
+        EXPECT_EQ(extruder_plan.paths[path_idx].estimates.getTotalTime(), expected[path_idx].getTotalTime());
+        EXPECT_EQ(extruder_plan.paths[path_idx].estimates.getMaterial(), expected[path_idx].getMaterial());
+    }
+}
+
+/*!
+ * Tests that the time until the end of the extruder plan is the sum of the
+ * estimates of the paths from there on, and that it's updated when paths are
+ * added.
+ */
+TEST_P(ExtruderPlanPathsParameterizedTest, TimeUntilEnd)
+{
+    extruder_plan.paths = GetParam();
+    extruder_plan.computeNaiveTimeEstimates(Point(0, 0));
+
+    const std::vector<double>& time_until_end = extruder_plan.getTimeUntilEnd();
+    ASSERT_EQ(time_until_end.size(), extruder_plan.paths.size() + 1);
+    EXPECT_EQ(time_until_end.back(), 0.0) << "At the end of the plan, there is no time left.";
+    double expected_time = 0.0;
+    for (size_t path_idx = extruder_plan.paths.size(); path_idx-- > 0;)
+    {
+        expected_time += extruder_plan.paths[path_idx].estimates.getTotalTime();
+        EXPECT_EQ(time_until_end[path_idx], expected_time) << "Walking back through the paths must add up to the same time.";
+    }
+
+    extruder_plan.paths.push_back(extruder_plan.paths.back());
+    EXPECT_EQ(extruder_plan.getTimeUntilEnd().size(), extruder_plan.paths.size() + 1) << "The times must be computed again for the added path.";
+}
+
 /*!
  * Tests back pressure compensation on an extruder plan that is completely
  * empty.
@@ -356,4 +409,53 @@ TEST_F(ExtruderPlanTest, BackPressureCompensationEmptyPlan)
     EXPECT_TRUE(extruder_plan.paths.empty()) << "The paths in the extruder plan should remain empty. Also it shouldn't crash.";
 }
 
+
+/*!
+ * Tests that paths which store their points in the same arena keep their own
+ * points, even if they are extended alternately.
+ */
+TEST_F(ExtruderPlanTest, PathsSharingPointArena)
+{
+    const GCodePathConfig config(PrintFeatureType::OuterWall, /*line_width=*/400, /*layer_thickness=*/100, /*flow=*/1.0_r, GCodePathConfig::SpeedDerivatives(50, 1000, 10));
+    std::shared_ptr<PathPointArena> arena = std::make_shared<PathPointArena>();
+    extruder_plan.paths.emplace_back(config, "test_mesh", SpaceFillType::Lines, 1.0_r, 1.0_r, false, 1.0_r, arena);
+    extruder_plan.paths.emplace_back(config, "test_mesh", SpaceFillType::Lines, 1.0_r, 1.0_r, false, 1.0_r, arena);
+    GCodePath& first = extruder_plan.paths[0];
+    GCodePath& second = extruder_plan.paths[1];
+
+    first.points.push_back(Point(0, 0));
+    second.points.push_back(Point(5000, 0));
+    first.points.push_back(Point(1000, 0)); //First path has to move to the end of the arena.
+    second.points.push_back(Point(6000, 0));
+    first.points.push_back(Point(2000, 0));
+
+    ASSERT_EQ(first.points.size(), 3);
+    EXPECT_EQ(first.points[0], Point(0, 0));
+    EXPECT_EQ(first.points[1], Point(1000, 0));
+    EXPECT_EQ(first.points.back(), Point(2000, 0));
+    ASSERT_EQ(second.points.size(), 2);
+    EXPECT_EQ(second.points[0], Point(5000, 0));
+    EXPECT_EQ(second.points.back(), Point(6000, 0));
+}
+
+TEST_F(ExtruderPlanTest, InsertPathPoints)
+{
+    std::shared_ptr<PathPointArena> arena = std::make_shared<PathPointArena>();
+    GCodePathPoints first(arena);
+    GCodePathPoints second(arena);
+    first.push_back(Point(0, 0));
+    first.push_back(Point(3000, 0));
+    second.push_back(Point(5000, 0));
+
+    first.insert(1, { Point(1000, 0), Point(2000, 0) }); //Like a comb path inserted before the destination of a travel.
+
+    ASSERT_EQ(first.size(), 4);
+    EXPECT_EQ(first[0], Point(0, 0));
+    EXPECT_EQ(first[1], Point(1000, 0));
+    EXPECT_EQ(first[2], Point(2000, 0));
+    EXPECT_EQ(first[3], Point(3000, 0));
+    ASSERT_EQ(second.size(), 1) << "Other paths in the same arena must not change.";
+    EXPECT_EQ(second[0], Point(5000, 0));
+}
+
 }
@@ -7,6 +7,7 @@
 #include "../src/utils/Date.h" //To check the Griffin header.
 #include "../src/Application.h" //To set up a slice with settings.
 #include "../src/gcodeExport.h" //The unit under test.
+#include "../src/PackedMoveStream.h" //To test writing moves in packed form.
 #include "../src/Slice.h" //To set up a slice with settings.
 #include "../src/RetractionConfig.h" //For extruder switch tests.
 #include "../src/WipeScriptConfig.h" //For wipe sciprt tests.
@@ -375,6 +376,32 @@ TEST_F(GCodeExportTest, HeaderMarlinVolumetric)
     EXPECT_EQ(result, ";FLAVOR:Marlin(Volumetric)\n;TIME:1337\n;Filament used: 100mm3, 200mm3\n;Layer height: 0.123\n;MINX:0\n;MINY:0\n;MINZ:0\n;MAXX:1\n;MAXY:1\n;MAXZ:1\n");
 }
 
+/*
+ * Test padding the header to a fixed size with comment lines, so that it can be
+ * replaced afterwards.
+ */
+TEST_F(GCodeExportTest, PadFileHeader)
+{
+    const std::string header = ";FLAVOR:Marlin\n;TIME:6666\n";
+
+    EXPECT_EQ(gcode.padFileHeader(header, header.size()), header) << "If it fits exactly, no padding is needed.";
+    EXPECT_EQ(gcode.padFileHeader(header, header.size() + 1), "") << "There is no room for a padding line.";
+    EXPECT_EQ(gcode.padFileHeader(header, header.size() - 1), "") << "The header doesn't fit.";
+    EXPECT_EQ(gcode.padFileHeader(header, header.size() + 4), header + ";  \n");
+
+    const std::string result = gcode.padFileHeader(header, header.size() + 1000);
+    ASSERT_EQ(result.size(), header.size() + 1000);
+    EXPECT_EQ(result.substr(0, header.size()), header);
+    std::istringstream padding(result.substr(header.size()));
+    std::string line;
+    while (std::getline(padding, line))
+    {
+        EXPECT_EQ(line[0], ';') << "The padding must be comments.";
+        EXPECT_LE(line.size(), 80) << "The padding lines must not be too long for the firmware.";
+    }
+    EXPECT_EQ(result.back(), '\n');
+}
+
 /*
  * Test conversion from E values to millimetres and back in the case of a
  * volumetric printer.
@@ -693,4 +720,99 @@ TEST_F(GCodeExportTest, insertWipeScriptHopEnable)
     EXPECT_EQ(std::string(";WIPE_SCRIPT_END"), token) << "Wipe script should always end with tag.";
 }
 
+TEST_F(GCodeExportTest, PackedMovesDecodeToSameGCode)
+{
+    gcode.currentPosition = Point3(1000, 1000, 1000);
+    gcode.use_extruder_offset_to_offset_coords = false;
+    Application::getInstance().current_slice->scene.current_mesh_group->settings.add("layer_height", "0.2");
+
+    std::stringstream packed_data;
+    {
+        PackedMoveStream packed(&packed_data);
+        gcode.setOutputStream(&packed);
+
+        EXPECT_CALL(*mock_communication, sendLineTo(testing::_, testing::_, testing::_, testing::_, testing::_)).Times(3);
+        gcode.writeComment("Start");
+        gcode.writeTravel(Point3(2000, 1000, 1000), 10);
+        gcode.writeTravel(Point3(-2500, 1000, 1200), 10);
+        gcode.writeComment("Wipe");
+        gcode.writeTravel(Point3(-2500, 123456, 1200), 20);
+        packed.writeMove(true, -1, -2000, 123000, 1200, false, 'E', 2.34567, true, PrintFeatureType::OuterWall, "\n");
+        packed.writeMove(true, 1200, -2000, 122000, 1200, false, 'E', 1.5, true, PrintFeatureType::OuterWall, "\r\n");
+        gcode.writeComment("End");
+    } //Destroying the packed stream writes the remaining text.
+
+    std::stringstream decoded;
+    decoded << std::fixed;
+    EXPECT_TRUE(PackedMoveStream::decode(packed_data, decoded));
+    EXPECT_EQ(std::string(";Start\n"
+        "G0 F600 X2 Y1\n"
+        "G0 X-2.5 Y1 Z1.2\n"
+        ";Wipe\n"
+        "G0 F1200 X-2.5 Y123.456\n"
+        "G1 X-2 Y123 E2.34567\n"
+        "G1 F1200 X-2 Y122 E1.5\r\n"
+        ";End\n"), decoded.str()) << "The packed moves must be decoded to the same g-code as GCodeExport writes as text.";
+}
+
+TEST_F(GCodeExportTest, LayerBufferWritesSameGCode)
+{
+    gcode.currentPosition = Point3(1000, 1000, 1000);
+    gcode.use_extruder_offset_to_offset_coords = false;
+    Application::getInstance().current_slice->scene.current_mesh_group->settings.add("layer_height", "0.2");
+    EXPECT_CALL(*mock_communication, sendLineTo(testing::_, testing::_, testing::_, testing::_, testing::_)).Times(3);
+
+    gcode.startLayerBuffer();
+    gcode.writeComment("Layer 1");
+    gcode.writeTravel(Point3(2000, 1000, 1000), 10);
+    gcode.writeTravel(Point3(-2500, 1000, 1200), 10);
+    gcode.finishLayerBuffer();
+    gcode.startLayerBuffer();
+    gcode.writeComment("Layer 2");
+    gcode.writeTravel(Point3(-2500, 123456, 1200), 20); //The feedrate and position continue from the previous layer.
+    gcode.finishLayerBuffer();
+    EXPECT_EQ(std::string(""), output.str()) << "Nothing may be written to the output until the layers are formatted.";
+
+    EXPECT_FALSE(gcode.writeFormattedLayer(2)) << "Two layers may still be formatting.";
+    EXPECT_TRUE(gcode.writeFormattedLayer(1));
+    EXPECT_EQ(std::string(";Layer 1\n"
+        "G0 F600 X2 Y1\n"
+        "G0 X-2.5 Y1 Z1.2\n"), output.str()) << "The oldest layer must be written first.";
+    EXPECT_TRUE(gcode.writeFormattedLayer());
+    EXPECT_FALSE(gcode.writeFormattedLayer()) << "All layers were written.";
+    EXPECT_EQ(std::string(";Layer 1\n"
+        "G0 F600 X2 Y1\n"
+        "G0 X-2.5 Y1 Z1.2\n"
+        ";Layer 2\n"
+        "G0 F1200 X-2.5 Y123.456\n"), output.str()) << "The buffered layers must give the same g-code as writing them directly.";
+}
+
+TEST_F(GCodeExportTest, PackedMovesRejectOtherData)
+{
+    std::stringstream not_packed(";Just g-code\nG0 X1 Y1\n");
+    std::stringstream decoded;
+    EXPECT_FALSE(PackedMoveStream::decode(not_packed, decoded)) << "Data without the header is not a packed move stream.";
+}
+
+TEST_F(GCodeExportTest, WriteExtrusionArc)
+{
+    gcode.currentPosition = Point3(10000, 0, 0);
+    gcode.use_extruder_offset_to_offset_coords = false;
+    gcode.is_volumetric = true;
+    gcode.extruder_attr[0].retraction_e_amount_current = 0;
+    gcode.extruder_attr[0].filament_area = 1.0;
+    Scene& scene = Application::getInstance().current_slice->scene;
+    scene.current_mesh_group->settings.add("layer_height", "0.2");
+    scene.extruders.emplace_back(0, nullptr);
+    scene.extruders.back().settings.add("machine_firmware_retract", "False");
+
+    gcode.writeExtrusionArc(Point(-10000, 0), Point(0, 0), true, 10, 1.0, PrintFeatureType::OuterWall);
+    EXPECT_EQ(std::string("G3 F600 X-10 Y0 I-10 J0 E31.41593\n"), output.str()) << "A half circle with a radius of 10mm is 31.4mm long, and the center is relative to the start.";
+    EXPECT_EQ(Point3(-10000, 0, 0), gcode.currentPosition);
+
+    output.str("");
+    gcode.writeExtrusionArc(Point(0, -10000), Point(0, 0), false, 10, 1.0, PrintFeatureType::OuterWall);
+    EXPECT_EQ(std::string("G2 X0 Y-10 I10 J0 E78.53982\n"), output.str()) << "Going clockwise from the left to the bottom is three quarters of the circle, on top of the previous E.";
+}
+
 } //namespace cura
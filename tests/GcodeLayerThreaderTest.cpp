@@ -0,0 +1,98 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "../src/GcodeLayerThreader.h" //The code under test.
+
+namespace cura
+{
+
+TEST(GcodeLayerThreaderTest, TaskLimitWhenConsumingIsSlow)
+{
+    constexpr int thread_count = 8;
+    EXPECT_EQ(thread_count + 1, GcodeLayerThreader<int>::computeTaskLimit(thread_count, 1.0, 0.5, 0.5, 30)) << "Consuming can't keep up, so more items ahead only hold memory.";
+}
+
+TEST(GcodeLayerThreaderTest, TaskLimitWhenProducingIsSlow)
+{
+    constexpr int thread_count = 8;
+    const int steady = GcodeLayerThreader<int>::computeTaskLimit(thread_count, 1.0, 0.0, 0.01, 30);
+    EXPECT_EQ(2 * thread_count - 1, steady) << "Each other thread makes one item while the next item to consume is produced.";
+
+    const int varying = GcodeLayerThreader<int>::computeTaskLimit(thread_count, 1.0, 1.0, 0.01, 30);
+    EXPECT_GT(varying, steady) << "If some items take much longer to produce, the other threads need to get further ahead.";
+    EXPECT_EQ(30, GcodeLayerThreader<int>::computeTaskLimit(thread_count, 1.0, 10.0, 0.01, 30)) << "Never more than the maximum.";
+
+    EXPECT_EQ(1, GcodeLayerThreader<int>::computeTaskLimit(1, 1.0, 1.0, 0.01, 30)) << "A single thread consumes each item right after producing it.";
+}
+
+TEST(GcodeLayerThreaderTest, MemoryLimit)
+{
+    constexpr int item_count = 100;
+    constexpr size_t item_size = 1000;
+    constexpr size_t max_items_in_memory = 3;
+    std::atomic<size_t> items_alive(0);
+    std::atomic<size_t> peak_items_alive(0);
+    std::vector<int> consumed;
+    const std::function<int* (int)> produce = [&items_alive, &peak_items_alive](int item_nr)
+    {
+        const size_t alive = ++items_alive;
+        size_t peak = peak_items_alive;
+        while (alive > peak && !peak_items_alive.compare_exchange_weak(peak, alive))
+        {
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        return new int(item_nr);
+    };
+    const std::function<void (int*)> consume = [&consumed, &items_alive](int* item)
+    {
+        consumed.push_back(*item);
+        delete item;
+        items_alive--;
+    };
+    const std::function<size_t (const int*)> item_memory = [](const int*)
+    {
+        return item_size;
+    };
+    constexpr unsigned int max_task_count = 30;
+    GcodeLayerThreader<int> threader(0, item_count, produce, consume, max_task_count, item_memory, item_size * max_items_in_memory);
+    threader.run();
+
+    EXPECT_LE(peak_items_alive, max_items_in_memory) << "No more items are produced than fit in the memory.";
+    ASSERT_EQ(consumed.size(), static_cast<size_t>(item_count));
+    for (size_t item_idx = 0; item_idx < consumed.size(); item_idx++)
+    {
+        EXPECT_EQ(consumed[item_idx], static_cast<int>(item_idx)) << "The items are consumed in order.";
+    }
+}
+
+TEST(GcodeLayerThreaderTest, MemoryLimitSmallerThanItem)
+{
+    constexpr int item_count = 20;
+    std::vector<int> consumed;
+    const std::function<int* (int)> produce = [](int item_nr)
+    {
+        return new int(item_nr);
+    };
+    const std::function<void (int*)> consume = [&consumed](int* item)
+    {
+        consumed.push_back(*item);
+        delete item;
+    };
+    const std::function<size_t (const int*)> item_memory = [](const int*)
+    {
+        return size_t(1000);
+    };
+    GcodeLayerThreader<int> threader(0, item_count, produce, consume, 30, item_memory, 10);
+    threader.run();
+
+    EXPECT_EQ(consumed.size(), static_cast<size_t>(item_count)) << "One item at a time is always allowed, so the items are still all produced.";
+}
+
+} //namespace cura
@@ -278,4 +278,38 @@ namespace cura
         ASSERT_LE(std::abs(padded_shape_outline.intersectionPolyLines(result_polygon_lines, restitch).polyLineLength() - result_polygon_lines.polyLineLength()), maximum_error) << "Infill (lines) should not be outside target polygon.";
     }
 
+    /*!
+     * Generating lines infill in tiles must give the same lines as generating
+     * it in one go, since the lines cut at the borders of the tiles are joined
+     * again.
+     */
+    TEST(InfillTilesTest, SameLinesAsWithoutTiles)
+    {
+        Polygons square;
+        PolygonRef square_poly = square.newPoly();
+        square_poly.add(Point(0, 0));
+        square_poly.add(Point(25000, 0));
+        square_poly.add(Point(25000, 25000));
+        square_poly.add(Point(0, 25000));
+
+        constexpr coord_t line_distance = 800;
+        const AngleDegrees angle = 30.;
+        Settings infill_settings;
+        std::vector<Polygons> lines_per_tile_size;
+        for (const coord_t tile_size : { coord_t(0), coord_t(7000) })
+        {
+            Infill infill(EFillMethod::LINES, false, false, square, infill_line_width, line_distance, infill_overlap, infill_multiplier, angle, z, shift, max_resolution, max_deviation,
+                          0, Point(), false, false, false, false, 0, 0, tile_size);
+            std::vector<VariableWidthLines> result_paths;
+            Polygons result_polygons;
+            Polygons result_lines;
+            infill.generate(result_paths, result_polygons, result_lines, infill_settings);
+            EXPECT_TRUE(result_polygons.empty()) << "Straight lines can't be joined into polygons.";
+            lines_per_tile_size.push_back(result_lines);
+        }
+
+        ASSERT_EQ(lines_per_tile_size[0].size(), lines_per_tile_size[1].size()) << "Every line cut at a tile border must be joined again.";
+        EXPECT_NEAR(lines_per_tile_size[0].polyLineLength(), lines_per_tile_size[1].polyLineLength(), 10 * lines_per_tile_size[0].size());
+    }
+
 } //namespace cura
@@ -0,0 +1,117 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For find_if.
+#include <gtest/gtest.h>
+
+#include "../src/layerPart.h" //The code under test.
+#include "../src/settings/Settings.h" //To choose how the parts are created.
+#include "../src/slicer.h" //The sliced layer to split into parts.
+#include "../src/sliceDataStorage.h" //To store the parts in.
+#include "../src/utils/polygon.h" //To compare the parts.
+
+namespace cura
+{
+
+/*!
+ * Polygons of a sliced layer, to split into parts.
+ */
+struct LayerPartParameters
+{
+    std::string name;
+    Polygons polygons;
+};
+
+/*!
+ * Splits the polygons of a layer into parts that the slicer didn't find, so
+ * that it does so without a union where it can, and compares them to the
+ * parts of a union.
+ */
+class LayerPartTest : public testing::TestWithParam<LayerPartParameters>
+{
+public:
+    Settings settings;
+
+    void SetUp() override
+    {
+        settings.add("hole_xy_offset", "0");
+        settings.add("magic_mesh_surface_mode", "normal");
+        settings.add("meshfix_maximum_deviation", "0.025");
+        settings.add("meshfix_maximum_extrusion_area_deviation", "50000");
+        settings.add("meshfix_maximum_resolution", "0.5");
+        settings.add("meshfix_union_all", "false");
+        settings.add("meshfix_union_all_remove_holes", "false");
+        settings.add("wall_line_width_0", "0.4");
+    }
+};
+
+/*!
+ * Create a square.
+ * \param min_x The left side of the square.
+ * \param min_y The bottom side of the square.
+ * \param size The width and height of the square.
+ * \param clockwise Whether to go around clockwise, as for a hole.
+ */
+Polygon makeSquare(const coord_t min_x, const coord_t min_y, const coord_t size, const bool clockwise = false)
+{
+    Polygon result;
+    result.add(Point(min_x, min_y));
+    if (clockwise)
+    {
+        result.add(Point(min_x, min_y + size));
+        result.add(Point(min_x + size, min_y + size));
+        result.add(Point(min_x + size, min_y));
+    }
+    else
+    {
+        result.add(Point(min_x + size, min_y));
+        result.add(Point(min_x + size, min_y + size));
+        result.add(Point(min_x, min_y + size));
+    }
+    return result;
+}
+
+/*!
+ * Put polygons together, in the order in which they're given.
+ */
+Polygons makePolygons(const std::vector<Polygon>& polygons)
+{
+    Polygons result;
+    for (const Polygon& polygon : polygons)
+    {
+        result.add(polygon);
+    }
+    return result;
+}
+
+TEST_P(LayerPartTest, SameAsUnion)
+{
+    const LayerPartParameters& parameters = GetParam();
+    SlicerLayer sliced_layer;
+    sliced_layer.polygons = parameters.polygons;
+    SliceLayer layer;
+    createLayerWithParts(settings, layer, &sliced_layer);
+
+    const std::vector<PolygonsPart> expected = parameters.polygons.splitIntoParts();
+    ASSERT_EQ(layer.parts.size(), expected.size()) << parameters.name << ": There must be as many parts as with a union.";
+    for (const SliceLayerPart& part : layer.parts)
+    {
+        const auto matching = std::find_if(expected.begin(), expected.end(), [&part](const PolygonsPart& expected_part)
+            {
+                return expected_part.size() == part.outline.size() && expected_part.xorPolygons(part.outline).area() == 0;
+            });
+        EXPECT_NE(matching, expected.end()) << parameters.name << ": Each part must cover the same area, with the same holes, as a part of the union.";
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(LayerPartTestInstantiation, LayerPartTest, testing::Values(
+    LayerPartParameters{ "separate", makePolygons({ makeSquare(0, 0, 1000), makeSquare(2000, 0, 1000) }) },
+    LayerPartParameters{ "holed", makePolygons({ makeSquare(0, 0, 3000), makeSquare(1000, 1000, 1000, true) }) },
+    LayerPartParameters{ "nested", makePolygons({ makeSquare(0, 0, 5000), makeSquare(1000, 1000, 3000, true), makeSquare(2000, 2000, 1000) }) },
+    LayerPartParameters{ "holed_twice", makePolygons({ makeSquare(0, 0, 5000), makeSquare(1000, 1000, 1000, true), makeSquare(3000, 3000, 1000, true) }) },
+    LayerPartParameters{ "touching_edge", makePolygons({ makeSquare(0, 0, 1000), makeSquare(1000, 0, 1000) }) },
+    LayerPartParameters{ "touching_corner", makePolygons({ makeSquare(0, 0, 1000), makeSquare(1000, 1000, 1000) }) },
+    LayerPartParameters{ "hole_touching_outline", makePolygons({ makeSquare(0, 0, 3000), makeSquare(0, 1000, 1000, true) }) }
+));
+
+} //namespace cura
@@ -179,6 +179,7 @@ public:
         settings->add("support_roof_extruder_nr", "0");
         settings->add("support_roof_line_width", "0.404");
         settings->add("support_roof_material_flow", "104");
+        settings->add("travel_order_refinement_time", "0");
         settings->add("wall_line_count", "3");
         settings->add("wall_line_width_x", "0.3");
         settings->add("wall_line_width_0", "0.301");
@@ -400,7 +401,9 @@ public:
         }
 
         const Point destination(500000, 500000);
-        return layer_plan.addTravel(destination);
+        GCodePath& result = layer_plan.addTravel(destination);
+        layer_plan.resolveTravels();
+        return result;
     }
 };
 
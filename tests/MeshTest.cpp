@@ -0,0 +1,189 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <map>
+
+#include "StressShapes.h" //To generate larger meshes.
+#include "../src/mesh.h" //The class under test.
+
+namespace cura
+{
+
+class MeshTest : public testing::Test
+{
+public:
+    Mesh mesh;
+
+    /*!
+     * Add a staircase of horizontal squares to the mesh, from the top down,
+     * so that the file order is the opposite of the height order.
+     */
+    void SetUp()
+    {
+        for (coord_t step = 9; step >= 0; step--)
+        {
+            const coord_t z = step * 1000;
+            Point3 a(step * 1000, 0, z);
+            Point3 b(step * 1000 + 1000, 0, z);
+            Point3 c(step * 1000 + 1000, 1000, z);
+            Point3 d(step * 1000, 1000, z);
+            Point3 a_below(step * 1000, 0, z - 1000);
+            mesh.addFace(a, b, c);
+            mesh.addFace(a, c, d);
+            mesh.addFace(a_below, a, d);
+        }
+    }
+};
+
+TEST_F(MeshTest, SortByHeightOrdersFacesAndVertices)
+{
+    const size_t face_count = mesh.faces.size();
+    const size_t vertex_count = mesh.vertices.size();
+    mesh.sortByHeight();
+
+    ASSERT_EQ(mesh.faces.size(), face_count);
+    ASSERT_EQ(mesh.vertices.size(), vertex_count);
+    for (size_t vertex_idx = 1; vertex_idx < mesh.vertices.size(); vertex_idx++)
+    {
+        EXPECT_LE(mesh.vertices[vertex_idx - 1].p.z, mesh.vertices[vertex_idx].p.z) << "The vertices must be sorted by height.";
+    }
+    coord_t last_min_z = std::numeric_limits<coord_t>::lowest();
+    for (const MeshFace& face : mesh.faces)
+    {
+        const coord_t min_z = std::min({ mesh.vertices[face.vertex_index[0]].p.z, mesh.vertices[face.vertex_index[1]].p.z, mesh.vertices[face.vertex_index[2]].p.z });
+        EXPECT_LE(last_min_z, min_z) << "The faces must be sorted by their lowest vertex.";
+        last_min_z = min_z;
+    }
+}
+
+TEST_F(MeshTest, FinishConnectsSortedFaces)
+{
+    mesh.settings.add("mesh_sort_by_height", "true");
+    mesh.settings.add("meshfix_decimate_mesh", "false");
+    mesh.settings.add("slicing_preview", "false");
+    mesh.finish();
+
+    size_t connection_count = 0;
+    for (size_t vertex_idx = 0; vertex_idx < mesh.vertices.size(); vertex_idx++)
+    {
+        const Mesh::FaceRange connected_faces = mesh.getConnectedFaces(vertex_idx);
+        EXPECT_TRUE(std::is_sorted(connected_faces.begin(), connected_faces.end())) << "The connected faces are listed in face order.";
+        for (const uint32_t face_idx : connected_faces)
+        {
+            const int* const vertex_index = mesh.faces[face_idx].vertex_index;
+            EXPECT_NE(std::find(vertex_index, vertex_index + 3, static_cast<int>(vertex_idx)), vertex_index + 3) << "A connected face must contain the vertex.";
+        }
+        connection_count += connected_faces.size();
+    }
+    EXPECT_EQ(connection_count, mesh.faces.size() * 3) << "Each face must be connected through exactly its three vertices.";
+
+    for (size_t face_idx = 0; face_idx < mesh.faces.size(); face_idx++)
+    {
+        for (const int connected_face_idx : mesh.faces[face_idx].connected_face_index)
+        {
+            if (connected_face_idx < 0)
+            {
+                continue; //The staircase is not closed, so some edges have nothing on the other side.
+            }
+            const MeshFace& connected_face = mesh.faces[connected_face_idx];
+            EXPECT_NE(std::find(connected_face.connected_face_index, connected_face.connected_face_index + 3, static_cast<int>(face_idx)), connected_face.connected_face_index + 3) << "Connections between faces go both ways.";
+        }
+    }
+}
+
+TEST(MeshDecimateTest, DecimateKeepsTheShapeOfACube)
+{
+    // A cube of 10mm of which each side is split into a grid of 1mm squares.
+    Mesh cube;
+    constexpr coord_t size = 10000;
+    constexpr coord_t divisions = 10;
+    constexpr coord_t step = size / divisions;
+    const auto add_side = [&cube](const Point3 origin, const Point3 u, const Point3 v)
+    {
+        for (coord_t i = 0; i < divisions; i++)
+        {
+            for (coord_t j = 0; j < divisions; j++)
+            {
+                Point3 a = origin + u * i + v * j;
+                Point3 b = origin + u * (i + 1) + v * j;
+                Point3 c = origin + u * (i + 1) + v * (j + 1);
+                Point3 d = origin + u * i + v * (j + 1);
+                cube.addFace(a, b, c);
+                cube.addFace(a, c, d);
+            }
+        }
+    };
+    add_side(Point3(0, 0, 0), Point3(0, step, 0), Point3(step, 0, 0)); //Bottom, facing down.
+    add_side(Point3(0, 0, size), Point3(step, 0, 0), Point3(0, step, 0)); //Top.
+    add_side(Point3(0, 0, 0), Point3(step, 0, 0), Point3(0, 0, step)); //Front.
+    add_side(Point3(0, size, 0), Point3(0, 0, step), Point3(step, 0, 0)); //Back.
+    add_side(Point3(0, 0, 0), Point3(0, 0, step), Point3(0, step, 0)); //Left.
+    add_side(Point3(size, 0, 0), Point3(0, step, 0), Point3(0, 0, step)); //Right.
+    const size_t original_face_count = cube.faces.size();
+    ASSERT_EQ(original_face_count, 6 * divisions * divisions * 2);
+
+    constexpr coord_t max_deviation = 25;
+    constexpr coord_t max_edge_length = 5000;
+    cube.decimate(max_deviation, max_edge_length);
+
+    EXPECT_LT(cube.faces.size() * 4, original_face_count) << "Flat sides can do with far fewer faces.";
+    EXPECT_EQ(cube.getAABB().min, Point3(0, 0, 0)) << "The corners of the cube must be kept.";
+    EXPECT_EQ(cube.getAABB().max, Point3(size, size, size));
+    for (const MeshVertex& vertex : cube.vertices)
+    {
+        const bool on_side = vertex.p.x == 0 || vertex.p.x == size || vertex.p.y == 0 || vertex.p.y == size || vertex.p.z == 0 || vertex.p.z == size;
+        EXPECT_TRUE(on_side) << "The vertices must stay on the sides of the cube.";
+    }
+
+    // The surface must still be closed: every edge is in exactly two faces, in opposite directions.
+    std::map<std::pair<int, int>, size_t> edge_count;
+    for (const MeshFace& face : cube.faces)
+    {
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            edge_count[std::make_pair(face.vertex_index[corner], face.vertex_index[(corner + 1) % 3])]++;
+        }
+    }
+    for (const std::pair<const std::pair<int, int>, size_t>& edge : edge_count)
+    {
+        EXPECT_EQ(edge.second, 1) << "No edge may be in two faces in the same direction.";
+        EXPECT_EQ(edge_count.count(std::make_pair(edge.first.second, edge.first.first)), 1) << "Every edge must have a face on the other side.";
+    }
+}
+
+TEST(StressShapesTest, StressMeshIsClosed)
+{
+    StressShapeParameters parameters;
+    parameters.part_count = 2;
+    parameters.nesting_depth = 3; //A ring with an island in it.
+    parameters.vertices_per_loop = 8;
+    constexpr size_t sections = 3;
+    Mesh stress_mesh;
+    makeStressMesh(parameters, 10000, sections, 0.5, stress_mesh);
+
+    //Per part and vertex: walls on both sides of the ring and one side of the island, with a top and bottom each.
+    EXPECT_EQ(stress_mesh.faces.size(), parameters.part_count * parameters.vertices_per_loop * (3 * 2 * sections + 2 * 2 + 2));
+    std::map<std::pair<uint32_t, uint32_t>, size_t> edges;
+    for (const MeshFace& face : stress_mesh.faces)
+    {
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            edges[std::make_pair(face.vertex_index[corner], face.vertex_index[(corner + 1) % 3])]++;
+        }
+    }
+    for (const std::pair<const std::pair<uint32_t, uint32_t>, size_t>& edge : edges)
+    {
+        const auto reverse = edges.find(std::make_pair(edge.first.second, edge.first.first));
+        ASSERT_NE(reverse, edges.end()) << "Every edge must have a face on the other side, so the volume is closed.";
+        EXPECT_EQ(reverse->second, edge.second) << "The faces must all face outwards.";
+    }
+
+    const Polygons layer = makeStressPolygons(parameters);
+    ASSERT_EQ(layer.size(), parameters.part_count * parameters.nesting_depth);
+    EXPECT_GT(layer[0].area(), 0) << "Outlines are counter-clockwise.";
+    EXPECT_LT(layer[1].area(), 0) << "Holes are clockwise.";
+    EXPECT_GT(layer[2].area(), 0) << "Islands in the holes are counter-clockwise again.";
+}
+
+} //namespace cura
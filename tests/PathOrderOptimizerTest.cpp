@@ -67,4 +67,279 @@ TEST_F(PathOrderOptimizerTest, ThreeTrianglesShortestOrder)
     EXPECT_EQ(optimizer.paths[2].vertices->front(), Point(1000, 1000)) << "Far triangle last.";
 }
 
+/*!
+ * Tests ordering many polylines, enough to find the nearest ones through a
+ * grid. The order must be the same as when picking the nearest polyline by
+ * checking all of them in every step.
+ */
+TEST_F(PathOrderOptimizerTest, ManyPolylinesNearestOrder)
+{
+    constexpr size_t num_lines = 200;
+    std::vector<Polygon> lines(num_lines);
+    uint64_t seed = 42;
+    const auto next_random = [&seed]() -> coord_t
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull; //Linear congruential generator, to get the same lines on every platform.
+        return static_cast<coord_t>((seed >> 33) % 100000);
+    };
+    for (Polygon& line : lines)
+    {
+        const Point start(next_random(), next_random());
+        line.add(start);
+        line.add(start + Point(next_random() % 1000, next_random() % 1000));
+        optimizer.addPolyline(line);
+    }
+
+    optimizer.optimize();
+
+    //Compute the expected order by checking every remaining line in each step.
+    std::vector<bool> picked(num_lines, false);
+    Point position(0, 0);
+    ASSERT_EQ(optimizer.paths.size(), num_lines);
+    for (const PathOrderPath<ConstPolygonPointer>& path : optimizer.paths)
+    {
+        size_t nearest = 0;
+        coord_t nearest_distance2 = std::numeric_limits<coord_t>::max();
+        bool nearest_backwards = false;
+        for (size_t line_idx = 0; line_idx < num_lines; line_idx++)
+        {
+            if (picked[line_idx])
+            {
+                continue;
+            }
+            const coord_t front_distance2 = vSize2(lines[line_idx].front() - position);
+            const coord_t back_distance2 = vSize2(lines[line_idx].back() - position);
+            const coord_t distance2 = std::min(front_distance2, back_distance2);
+            if (distance2 < nearest_distance2)
+            {
+                nearest = line_idx;
+                nearest_distance2 = distance2;
+                nearest_backwards = back_distance2 < front_distance2;
+            }
+        }
+        picked[nearest] = true;
+        EXPECT_TRUE(path.vertices == ConstPolygonPointer(lines[nearest])) << "The nearest remaining line must be next.";
+        EXPECT_EQ(path.backwards, nearest_backwards) << "The line must start at its nearest end.";
+        position = nearest_backwards ? lines[nearest].front() : lines[nearest].back();
+    }
+}
+
+/*!
+ * Refining the order of many scattered lines must not make the travel moves
+ * longer, nor break any order requirements.
+ */
+TEST_F(PathOrderOptimizerTest, RefineOrderShortensTravel)
+{
+    constexpr size_t num_lines = 200;
+    std::vector<Polygon> lines(num_lines);
+    uint64_t seed = 1337;
+    const auto next_random = [&seed]() -> coord_t
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull; //Linear congruential generator, to get the same lines on every platform.
+        return static_cast<coord_t>((seed >> 33) % 100000);
+    };
+    std::unordered_set<std::pair<ConstPolygonPointer, ConstPolygonPointer>> order_requirements;
+    for (size_t line_idx = 0; line_idx < num_lines; line_idx++)
+    {
+        const Point start(next_random(), next_random());
+        lines[line_idx].add(start);
+        lines[line_idx].add(start + Point(next_random() % 3000, next_random() % 3000));
+        if (line_idx % 5 == 1)
+        {
+            order_requirements.emplace(ConstPolygonPointer(lines[line_idx - 1]), ConstPolygonPointer(lines[line_idx]));
+        }
+    }
+
+    PathOrderOptimizer<ConstPolygonPointer> greedy(Point(0, 0), ZSeamConfig(), false, nullptr, false, order_requirements);
+    PathOrderOptimizer<ConstPolygonPointer> refined(Point(0, 0), ZSeamConfig(), false, nullptr, false, order_requirements);
+    refined.refinement_time_budget = 10.0; //Plenty for 200 lines, so that it always converges.
+    for (const Polygon& line : lines)
+    {
+        greedy.addPolyline(line);
+        refined.addPolyline(line);
+    }
+    greedy.optimize();
+    refined.optimize();
+
+    const auto travel_length = [](const std::vector<PathOrderPath<ConstPolygonPointer>>& order)
+    {
+        double total = 0;
+        Point position(0, 0);
+        for (const PathOrderPath<ConstPolygonPointer>& path : order)
+        {
+            const Point start = path.backwards ? path.vertices->back() : path.vertices->front();
+            total += vSizeMM(start - position);
+            position = path.backwards ? path.vertices->front() : path.vertices->back();
+        }
+        return total;
+    };
+    EXPECT_LT(travel_length(refined.paths), travel_length(greedy.paths)) << "Refining scattered lines should find shorter travel moves than the greedy order.";
+    EXPECT_LT(refined.refinement_time_budget, 10.0) << "The time spent must be subtracted from the budget.";
+
+    ASSERT_EQ(refined.paths.size(), num_lines);
+    std::unordered_map<ConstPolygonPointer, size_t> position_in_order;
+    for (size_t position = 0; position < refined.paths.size(); position++)
+    {
+        position_in_order[refined.paths[position].vertices] = position;
+    }
+    EXPECT_EQ(position_in_order.size(), num_lines) << "Every line must be printed exactly once.";
+    for (const std::pair<ConstPolygonPointer, ConstPolygonPointer>& requirement : order_requirements)
+    {
+        EXPECT_LT(position_in_order[requirement.first], position_in_order[requirement.second]) << "The order requirements must still hold.";
+    }
+}
+
+
+/*!
+ * Group order requirements must hold between every pair of a path in the
+ * first group and a path in the second, also after refining the order.
+ */
+TEST_F(PathOrderOptimizerTest, GroupOrderRequirements)
+{
+    constexpr size_t num_lines = 90;
+    std::vector<Polygon> lines(num_lines);
+    uint64_t seed = 4242;
+    const auto next_random = [&seed]() -> coord_t
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<coord_t>((seed >> 33) % 100000);
+    };
+    std::vector<ConstPolygonPointer> first_group;
+    std::vector<ConstPolygonPointer> second_group;
+    for (size_t line_idx = 0; line_idx < num_lines; line_idx++)
+    {
+        const Point start(next_random(), next_random());
+        lines[line_idx].add(start);
+        lines[line_idx].add(start + Point(next_random() % 3000, next_random() % 3000));
+        if (line_idx % 3 == 0)
+        {
+            first_group.emplace_back(lines[line_idx]);
+        }
+        else if (line_idx % 3 == 1)
+        {
+            second_group.emplace_back(lines[line_idx]);
+        }
+    }
+
+    for (const bool refine : { false, true })
+    {
+        PathOrderOptimizer<ConstPolygonPointer> optimizer(Point(0, 0));
+        optimizer.refinement_time_budget = refine ? 10.0 : 0.0;
+        for (const Polygon& line : lines)
+        {
+            optimizer.addPolyline(line);
+        }
+        optimizer.addGroupOrderRequirement(first_group, second_group);
+        optimizer.optimize();
+
+        ASSERT_EQ(optimizer.paths.size(), num_lines);
+        std::unordered_map<ConstPolygonPointer, size_t> position_in_order;
+        for (size_t position = 0; position < optimizer.paths.size(); position++)
+        {
+            position_in_order[optimizer.paths[position].vertices] = position;
+        }
+        size_t last_of_first_group = 0;
+        for (const ConstPolygonPointer& line : first_group)
+        {
+            last_of_first_group = std::max(last_of_first_group, position_in_order[line]);
+        }
+        for (const ConstPolygonPointer& line : second_group)
+        {
+            EXPECT_GT(position_in_order[line], last_of_first_group) << "All lines of the first group must be printed before any of the second" << (refine ? ", also after refining." : ".");
+        }
+    }
+}
+
+
+/*!
+ * Random seams must come out the same when the same paths are optimized from
+ * the same start point, no matter what else was optimized before.
+ */
+TEST_F(PathOrderOptimizerTest, RandomSeamsAreReproducible)
+{
+    Polygon many_vertices;
+    for (coord_t vertex_idx = 0; vertex_idx < 100; vertex_idx++)
+    {
+        const double angle = vertex_idx * 2 * M_PI / 100;
+        many_vertices.add(Point(std::cos(angle) * 10000, std::sin(angle) * 10000));
+    }
+    const ZSeamConfig random_seam(EZSeamType::RANDOM, Point(0, 0), EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_NONE, 0);
+
+    PathOrderOptimizer<ConstPolygonPointer> first(Point(500, 700), random_seam);
+    first.addPolygon(many_vertices);
+    first.optimize();
+    rand(); //Disturb any shared random generator in between.
+    PathOrderOptimizer<ConstPolygonPointer> second(Point(500, 700), random_seam);
+    second.addPolygon(many_vertices);
+    second.optimize();
+
+    ASSERT_EQ(first.paths.size(), 1);
+    ASSERT_EQ(second.paths.size(), 1);
+    EXPECT_EQ(first.paths[0].start_vertex, second.paths[0].start_vertex) << "The seam must not depend on anything but the input.";
+}
+
+/*!
+ * Random seams must differ between layers that start from the same point, but
+ * still be reproducible for each layer.
+ */
+TEST_F(PathOrderOptimizerTest, RandomSeamsVaryPerLayer)
+{
+    Polygon many_vertices;
+    for (coord_t vertex_idx = 0; vertex_idx < 100; vertex_idx++)
+    {
+        const double angle = vertex_idx * 2 * M_PI / 100;
+        many_vertices.add(Point(std::cos(angle) * 10000, std::sin(angle) * 10000));
+    }
+    const ZSeamConfig random_seam(EZSeamType::RANDOM, Point(0, 0), EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_NONE, 0);
+
+    std::vector<size_t> seams;
+    for (const LayerIndex layer_nr : { 10, 11, 10 })
+    {
+        PathOrderOptimizer<ConstPolygonPointer> optimizer(Point(500, 700), random_seam);
+        optimizer.layer_nr = layer_nr;
+        optimizer.addPolygon(many_vertices);
+        optimizer.optimize();
+        ASSERT_EQ(optimizer.paths.size(), 1);
+        seams.push_back(optimizer.paths[0].start_vertex);
+    }
+    EXPECT_NE(seams[0], seams[1]) << "Layers that start from the same point must not get the same random seam.";
+    EXPECT_EQ(seams[0], seams[2]) << "The seam of a layer must be reproducible.";
+}
+
+/*!
+ * Refining until converged must give the same order every time, and not use
+ * up its time budget.
+ */
+TEST_F(PathOrderOptimizerTest, RefineUntilConvergedIsReproducible)
+{
+    std::vector<Polygon> lines(100);
+    for (size_t line_idx = 0; line_idx < lines.size(); line_idx++)
+    {
+        const Point start((line_idx * 7919) % 50000, (line_idx * 104729) % 50000);
+        lines[line_idx].add(start);
+        lines[line_idx].add(start + Point(1000, (line_idx % 3) * 500));
+    }
+
+    std::vector<std::vector<ConstPolygonPointer>> orders;
+    for (size_t attempt = 0; attempt < 2; attempt++)
+    {
+        PathOrderOptimizer<ConstPolygonPointer> refined(Point(0, 0));
+        refined.refinement_time_budget = 0.000001; //Far too short to converge in, if it were used.
+        refined.refine_until_converged = true;
+        for (const Polygon& line : lines)
+        {
+            refined.addPolyline(line);
+        }
+        refined.optimize();
+        EXPECT_EQ(refined.refinement_time_budget, 0.000001) << "The budget isn't used up when refining until converged.";
+
+        orders.emplace_back();
+        for (const PathOrderPath<ConstPolygonPointer>& path : refined.paths)
+        {
+            orders.back().push_back(path.vertices);
+        }
+    }
+    EXPECT_EQ(orders[0], orders[1]) << "Refining until converged must give the same order every time.";
+}
+
 }
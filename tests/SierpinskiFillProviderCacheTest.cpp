@@ -0,0 +1,55 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/infill/SierpinskiFillProvider.h"
+#include "../src/infill/SierpinskiFillProviderCache.h" //The code under test.
+#include "../src/utils/AABB3D.h"
+
+namespace cura
+{
+
+class SierpinskiFillProviderCacheTest : public testing::Test
+{
+public:
+    SierpinskiFillProviderCache cache;
+    AABB3D aabb;
+
+    SierpinskiFillProviderCacheTest()
+    : aabb(Point3(0, 0, 0), Point3(MM2INT(20), MM2INT(20), MM2INT(10)))
+    {
+    }
+};
+
+TEST_F(SierpinskiFillProviderCacheTest, ReusesSameFractal)
+{
+    cache.startMeshGroup(1);
+    const std::shared_ptr<const SierpinskiFillProvider> first = cache.get(aabb, MM2INT(5), 400, "");
+    ASSERT_NE(first, nullptr);
+
+    const AABB3D taller(aabb.min, Point3(aabb.max.x, aabb.max.y, MM2INT(50)));
+    EXPECT_EQ(first, cache.get(taller, MM2INT(5), 400, "")) << "The fractal only depends on the horizontal bounding box.";
+
+    EXPECT_NE(first, cache.get(aabb, MM2INT(10), 400, "")) << "Another line distance makes another fractal.";
+    const AABB3D wider(aabb.min, Point3(MM2INT(30), aabb.max.y, aabb.max.z));
+    EXPECT_NE(first, cache.get(wider, MM2INT(5), 400, ""));
+    EXPECT_EQ(size_t(3), cache.size());
+}
+
+TEST_F(SierpinskiFillProviderCacheTest, KeepsPreviousSliceOnly)
+{
+    cache.startMeshGroup(1);
+    const std::shared_ptr<const SierpinskiFillProvider> first = cache.get(aabb, MM2INT(5), 400, "");
+
+    cache.startMeshGroup(1);
+    EXPECT_EQ(size_t(1), cache.size()) << "The fractal was used in the previous slice, so it may be needed again.";
+    EXPECT_EQ(first, cache.get(aabb, MM2INT(5), 400, ""));
+
+    cache.startMeshGroup(1);
+    cache.startMeshGroup(1);
+    EXPECT_EQ(size_t(0), cache.size()) << "The previous slice didn't use the fractal.";
+    EXPECT_NE(first->fill_pattern_for_all_layers, std::nullopt) << "A slice that still uses a forgotten fractal keeps it until it's done.";
+}
+
+} //namespace cura
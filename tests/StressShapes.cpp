@@ -0,0 +1,120 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cmath> //For std::ceil, std::sqrt, std::cos and std::sin.
+
+#include "StressShapes.h"
+#include "../src/mesh.h"
+
+namespace cura
+{
+
+namespace
+{
+
+/*!
+ * Get the center of a part in the grid of parts.
+ */
+Point getPartCenter(const StressShapeParameters& parameters, const size_t part_idx)
+{
+    const size_t parts_per_row = std::ceil(std::sqrt(static_cast<double>(parameters.part_count)));
+    const coord_t spacing = parameters.part_radius * 5 / 2; //Leave a gap of half the radius between the parts.
+    return Point(spacing * static_cast<coord_t>(part_idx % parts_per_row), spacing * static_cast<coord_t>(part_idx / parts_per_row));
+}
+
+/*!
+ * Get the radius of one of the nested loops of a part, from the outside in.
+ */
+coord_t getLoopRadius(const StressShapeParameters& parameters, const size_t loop_idx)
+{
+    return parameters.part_radius * static_cast<coord_t>(parameters.nesting_depth - loop_idx) / static_cast<coord_t>(parameters.nesting_depth);
+}
+
+/*!
+ * Get a vertex of a loop, rotated by an angle.
+ */
+Point getLoopVertex(const StressShapeParameters& parameters, const Point center, const coord_t radius, const size_t vertex_idx, const double rotation)
+{
+    const double angle = 2 * M_PI * (vertex_idx % parameters.vertices_per_loop) / parameters.vertices_per_loop + rotation; //Wrap around, so that the loop closes exactly.
+    return center + Point(std::cos(angle) * radius, std::sin(angle) * radius);
+}
+
+/*!
+ * Add a quad as two triangles. The corners must be counter-clockwise when
+ * looking at the outside.
+ */
+void addQuad(std::vector<Point3>& corners, const Point3& a, const Point3& b, const Point3& c, const Point3& d)
+{
+    corners.insert(corners.end(), { a, b, c, a, c, d });
+}
+
+}
+
+Polygons makeStressPolygons(const StressShapeParameters& parameters)
+{
+    Polygons result;
+    for (size_t part_idx = 0; part_idx < parameters.part_count; part_idx++)
+    {
+        const Point center = getPartCenter(parameters, part_idx);
+        for (size_t loop_idx = 0; loop_idx < parameters.nesting_depth; loop_idx++)
+        {
+            const coord_t radius = getLoopRadius(parameters, loop_idx);
+            const bool is_hole = loop_idx % 2 == 1;
+            PolygonRef loop = result.newPoly();
+            for (size_t vertex_idx = 0; vertex_idx < parameters.vertices_per_loop; vertex_idx++)
+            {
+                const size_t ordered_idx = is_hole ? parameters.vertices_per_loop - vertex_idx : vertex_idx; //Holes go clockwise.
+                loop.add(getLoopVertex(parameters, center, radius, ordered_idx, 0.0));
+            }
+        }
+    }
+    return result;
+}
+
+void makeStressMesh(const StressShapeParameters& parameters, const coord_t height, const size_t sections, const double twist, Mesh& mesh_out)
+{
+    std::vector<Point3> corners;
+    const auto vertex = [&parameters, height, sections, twist](const Point center, const coord_t radius, const size_t section, const size_t vertex_idx)
+    {
+        const Point p = getLoopVertex(parameters, center, radius, vertex_idx, twist * section / sections);
+        return Point3(p.X, p.Y, height * static_cast<coord_t>(section) / static_cast<coord_t>(sections));
+    };
+
+    for (size_t part_idx = 0; part_idx < parameters.part_count; part_idx++)
+    {
+        const Point center = getPartCenter(parameters, part_idx);
+        //The material is between each outline and the hole in it, and within the innermost outline if that isn't a hole.
+        for (size_t loop_idx = 0; loop_idx < parameters.nesting_depth; loop_idx += 2)
+        {
+            const coord_t outer_radius = getLoopRadius(parameters, loop_idx);
+            const bool has_hole = loop_idx + 1 < parameters.nesting_depth;
+            const coord_t inner_radius = has_hole ? getLoopRadius(parameters, loop_idx + 1) : 0;
+            for (size_t vertex_idx = 0; vertex_idx < parameters.vertices_per_loop; vertex_idx++)
+            {
+                for (size_t section = 0; section < sections; section++)
+                {
+                    addQuad(corners, vertex(center, outer_radius, section, vertex_idx), vertex(center, outer_radius, section, vertex_idx + 1), vertex(center, outer_radius, section + 1, vertex_idx + 1), vertex(center, outer_radius, section + 1, vertex_idx));
+                    if (has_hole)
+                    {
+                        addQuad(corners, vertex(center, inner_radius, section, vertex_idx + 1), vertex(center, inner_radius, section, vertex_idx), vertex(center, inner_radius, section + 1, vertex_idx), vertex(center, inner_radius, section + 1, vertex_idx + 1));
+                    }
+                }
+                if (has_hole) //Bottom and top are rings.
+                {
+                    addQuad(corners, vertex(center, inner_radius, 0, vertex_idx), vertex(center, inner_radius, 0, vertex_idx + 1), vertex(center, outer_radius, 0, vertex_idx + 1), vertex(center, outer_radius, 0, vertex_idx));
+                    addQuad(corners, vertex(center, inner_radius, sections, vertex_idx), vertex(center, outer_radius, sections, vertex_idx), vertex(center, outer_radius, sections, vertex_idx + 1), vertex(center, inner_radius, sections, vertex_idx + 1));
+                }
+                else //Bottom and top are discs.
+                {
+                    const Point3 bottom_center(center.X, center.Y, 0);
+                    const Point3 top_center(center.X, center.Y, height);
+                    corners.insert(corners.end(), { bottom_center, vertex(center, outer_radius, 0, vertex_idx + 1), vertex(center, outer_radius, 0, vertex_idx) });
+                    corners.insert(corners.end(), { top_center, vertex(center, outer_radius, sections, vertex_idx), vertex(center, outer_radius, sections, vertex_idx + 1) });
+                }
+            }
+        }
+    }
+    mesh_out.addFaces(corners);
+}
+
+} //namespace cura
@@ -0,0 +1,61 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef STRESS_SHAPES_H
+#define STRESS_SHAPES_H
+
+#include "../src/utils/polygon.h"
+
+namespace cura
+{
+
+class Mesh;
+
+/*!
+ * The size of the parametric shapes to test and benchmark with, so that tests
+ * can sweep the size of the problem without storing large models.
+ *
+ * Each part is a disc with nested rings cut out of it, like a target: an
+ * outline, a hole in it, an island in that hole, and so on. The parts are laid
+ * out in a grid.
+ */
+struct StressShapeParameters
+{
+    size_t part_count = 1; //!< How many separate parts there are.
+    size_t nesting_depth = 1; //!< How many nested loops each part has. 1 is a disc, 2 a ring, 3 a ring with an island in it, etc.
+    size_t vertices_per_loop = 32; //!< How many vertices each loop is approximated with.
+    coord_t part_radius = 10000; //!< The radius of the outline of each part.
+};
+
+/*!
+ * Create the outlines of the parts in a single layer.
+ *
+ * The outlines are counter-clockwise and the holes clockwise, as in sliced
+ * layers.
+ * \param parameters The number and shape of the parts.
+ * \return The loops of all parts, each part from the outside in.
+ */
+Polygons makeStressPolygons(const StressShapeParameters& parameters);
+
+/*!
+ * Add the parts to a mesh, extruded upwards into closed volumes.
+ *
+ * The walls are divided vertically into \p sections, which controls the face
+ * count together with the number of vertices per loop. With a \p twist, each
+ * section is rotated a bit further, so that all layers are different.
+ *
+ * The mesh isn't finished, so that the caller can give it the settings for
+ * that first.
+ * \param parameters The number and shape of the parts.
+ * \param height The height of the parts. Divided by the layer height, this
+ * gives the layer count.
+ * \param sections How many times the walls are divided vertically.
+ * \param twist By how much the top is rotated relative to the bottom, in
+ * radians.
+ * \param mesh_out The mesh to add the faces to.
+ */
+void makeStressMesh(const StressShapeParameters& parameters, const coord_t height, const size_t sections, const double twist, Mesh& mesh_out);
+
+} //namespace cura
+
+#endif //STRESS_SHAPES_H
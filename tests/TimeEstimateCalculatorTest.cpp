@@ -303,6 +303,36 @@ TEST_F(TimeEstimateCalculatorTest, DoubleLineNoJerk)
     );
 }
 
+TEST_F(TimeEstimateCalculatorTest, ManyLinesNoJerk)
+{
+    calculator.setFirmwareDefaults(jerkless);
+
+    /*
+     * Many short lines in the same direction behave like a single long line:
+     * Accelerate from 0 to 50mm/s in one second, over many lines.
+     * Cruise at 50mm/s until just before the end.
+     * Decelerate from 50 to 0mm/s in one second, over many lines.
+     */
+    constexpr size_t num_lines = 100000;
+    for(size_t line = 1; line <= num_lines; line++)
+    {
+        calculator.plan(TimeEstimateCalculator::Position(line, 0, 0, 0), 50.0, PrintFeatureType::Infill);
+    }
+
+    //Distance needed to accelerate: 1/2 at² + vt. We accelerate at 50mm/s². No initial velocity, but we decelerate to MINIMUM_PLANNER_SPEED.
+    const double accelerate_distance = 0.5 * 50 * 1 * 1 + 0 * 1;
+    const double decelerate_t = (50.0 - MINIMUM_PLANNER_SPEED) / 50.0;
+    const double decelerate_distance = 0.5 * 50.0 * decelerate_t * decelerate_t + MINIMUM_PLANNER_SPEED * decelerate_t;
+    const double cruise_distance = num_lines - accelerate_distance - decelerate_distance;
+
+    const std::vector<Duration> result = calculator.calculate();
+    EXPECT_NEAR(
+        Duration(1.0 + cruise_distance / 50.0 + decelerate_t), //Accelerate, cruise, decelerate.
+        result[static_cast<size_t>(PrintFeatureType::Infill)],
+        EPSILON
+    );
+}
+
 TEST_F(TimeEstimateCalculatorTest, DiagonalLineNoJerk)
 {
     calculator.setFirmwareDefaults(jerkless);
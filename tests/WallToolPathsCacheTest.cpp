@@ -0,0 +1,54 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/WallToolPathsCache.h" //The class under test.
+
+namespace cura
+{
+
+class WallToolPathsCacheTest : public testing::Test
+{
+public:
+    Polygons square;
+    Polygons other_square;
+    WallToolPathsCache::Parameters parameters;
+
+    void SetUp() override
+    {
+        square.add(makeSquare(0, 10000));
+        other_square.add(makeSquare(20000, 10000));
+        parameters = WallToolPathsCache::Parameters{400, 400, 2, 0};
+    }
+
+    Polygon makeSquare(const coord_t x, const coord_t size)
+    {
+        Polygon result;
+        result.add(Point(x, 0));
+        result.add(Point(x + size, 0));
+        result.add(Point(x + size, size));
+        result.add(Point(x, size));
+        return result;
+    }
+};
+
+/*!
+ * The walls of an outline are found back for the same outline and parameters.
+ */
+TEST_F(WallToolPathsCacheTest, FindInsertedWalls)
+{
+    WallToolPathsCache cache;
+    EXPECT_EQ(cache.find(square, parameters), nullptr) << "Nothing was inserted yet.";
+
+    const std::shared_ptr<const WallToolPathsCache::Result> result = std::make_shared<WallToolPathsCache::Result>();
+    cache.insert(square, parameters, result);
+    EXPECT_EQ(cache.find(square, parameters), result);
+    EXPECT_EQ(cache.find(other_square, parameters), nullptr) << "Another outline has other walls.";
+
+    WallToolPathsCache::Parameters other_parameters = parameters;
+    other_parameters.inset_count++;
+    EXPECT_EQ(cache.find(square, other_parameters), nullptr) << "Other parameters give other walls.";
+}
+
+} //namespace cura
@@ -2,8 +2,10 @@
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
 #include <array>
+#include <chrono> //To check that waiting for socket events doesn't time out.
 #include <gtest/gtest.h>
 #include <fstream>
+#include <thread> //To signal socket events from another thread, like the socket does.
 
 #include "MockSocket.h"
 #include "../../src/Application.h"
@@ -251,4 +253,78 @@ TEST_F(ArcusCommunicationPrivateTest, ReadMeshGroupMessage)
     }
 }
 
+TEST_F(ArcusCommunicationPrivateTest, ReadStreamedObjects)
+{
+    //Three mesh groups, of which the middle one gets no objects.
+    delete Application::getInstance().current_slice;
+    Application::getInstance().current_slice = new Slice(3);
+    Scene& scene = Application::getInstance().current_slice->scene;
+
+    cura::proto::Slice slice_message;
+    std::unordered_map<std::string, std::string> raw_settings;
+    loadTestSettings("../tests/test_global_settings.txt", slice_message.mutable_global_settings(), &raw_settings);
+    instance->readGlobalSettingsMessage(slice_message.global_settings());
+    scene.extruders.emplace_back(0, &scene.settings);
+    for (size_t mesh_group_idx = 0; mesh_group_idx < 3; mesh_group_idx++)
+    {
+        cura::proto::Setting* setting = slice_message.add_object_lists()->add_settings();
+        setting->set_name("mesh_group_name");
+        setting->set_value(std::to_string(mesh_group_idx));
+    }
+    slice_message.set_streamed_object_count(3);
+
+    //A tetrahedron, to send as each object.
+    const std::vector<float> corners = {
+        0, 0, 0,  10, 0, 0,  0, 10, 0,
+        0, 0, 0,  0, 10, 0,  0, 0, 10,
+        0, 0, 0,  0, 0, 10,  10, 0, 0,
+        10, 0, 0,  0, 0, 10,  0, 10, 0,
+    };
+    const std::string vertices(reinterpret_cast<const char*>(corners.data()), corners.size() * sizeof(float));
+    MockSocket* socket = static_cast<MockSocket*>(instance->socket);
+    for (const int mesh_group_idx : {2, 0, 2})
+    {
+        std::shared_ptr<cura::proto::SliceObject> object_message = std::make_shared<cura::proto::SliceObject>();
+        object_message->set_mesh_group(mesh_group_idx);
+        object_message->mutable_object()->set_vertices(vertices);
+        cura::proto::Setting* setting = object_message->mutable_object()->add_settings();
+        setting->set_name("extruder_nr");
+        setting->set_value("0");
+        socket->pushMessageToReceivedQueue(object_message);
+    }
+
+    ASSERT_TRUE(instance->readStreamedObjects(slice_message));
+    EXPECT_TRUE(socket->received_messages.empty());
+    EXPECT_EQ(size_t(2), instance->object_count) << "The mesh group without objects is left out.";
+    ASSERT_EQ(size_t(1), scene.mesh_groups[0].meshes.size());
+    EXPECT_EQ(std::string("0"), scene.mesh_groups[0].settings.get<std::string>("mesh_group_name"));
+    EXPECT_EQ(size_t(4), scene.mesh_groups[0].meshes[0].faces.size());
+    ASSERT_EQ(size_t(2), scene.mesh_groups[1].meshes.size()) << "Both objects of the last mesh group arrive in that mesh group.";
+    EXPECT_EQ(std::string("2"), scene.mesh_groups[1].settings.get<std::string>("mesh_group_name"));
+    EXPECT_TRUE(scene.mesh_groups[2].meshes.empty());
+}
+
+TEST_F(ArcusCommunicationPrivateTest, ReadStreamedObjectsReplacedBySlice)
+{
+    cura::proto::Slice slice_message;
+    slice_message.add_object_lists();
+    slice_message.set_streamed_object_count(1);
+    const std::shared_ptr<cura::proto::Slice> next_slice = std::make_shared<cura::proto::Slice>();
+    static_cast<MockSocket*>(instance->socket)->pushMessageToReceivedQueue(next_slice);
+
+    EXPECT_FALSE(instance->readStreamedObjects(slice_message)) << "A new slice arrived before the object.";
+    EXPECT_EQ(next_slice, instance->next_message) << "The new slice must be handled next.";
+}
+
+TEST_F(ArcusCommunicationPrivateTest, WaitForSocketEventAfterNotify)
+{
+    std::thread socket_thread([this]() { instance->notifySocketEvent(); });
+    socket_thread.join();
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    instance->waitForSocketEvent();
+    const std::chrono::steady_clock::duration waited = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(waited, std::chrono::milliseconds(instance->millisecUntilNextTry)) << "An event that happened before waiting must end the wait right away, not after the time-out.";
+}
+
 } //namespace cura
\ No newline at end of file
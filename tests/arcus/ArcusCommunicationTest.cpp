@@ -5,9 +5,13 @@
 #include <gtest/gtest.h>
 
 #include "MockSocket.h" //To mock out the communication with the front-end.
+#include "../src/Application.h" //To send the progress through the communication under test.
 #include "../src/FffProcessor.h"
+#include "../src/PrintFeature.h"
 #include "../src/communication/ArcusCommunicationPrivate.h" //To access the private fields of this communication class.
+#include "../src/progress/Progress.h" //To report progress of the stages in the statistics.
 #include "../src/settings/types/LayerIndex.h"
+#include "../src/settings/types/Velocity.h"
 #include "../src/utils/polygon.h" //Create test shapes to send over the socket.
 
 namespace cura
@@ -168,4 +172,115 @@ TEST_F(ArcusCommunicationTest, SendProgress)
     EXPECT_EQ(float(25), message->amount());
 }
 
-}
\ No newline at end of file
+TEST_F(ArcusCommunicationTest, SendSliceStatistics)
+{
+    ac->private_data->object_count = 1;
+    ac->sendProgress(0.1);
+    ASSERT_EQ(size_t(1), socket->sent_messages.size()) << "Statistics must not be sent unless they're enabled.";
+
+    ac->enableSliceStatistics();
+    Application::getInstance().communication = ac; //Progress reports through the communication of the application.
+    Progress::init();
+    Progress::messageProgressStage(Progress::Stage::SLICING, nullptr);
+    Progress::messageProgressStage(Progress::Stage::PARTS, nullptr);
+    Progress::messageProgress(Progress::Stage::PARTS, 3, 10); //Also sends the progress and the statistics.
+    ASSERT_EQ(size_t(3), socket->sent_messages.size()) << "The progress, then the statistics with it.";
+    proto::SliceStatistics* message = dynamic_cast<proto::SliceStatistics*>(socket->sent_messages.back().get());
+    ASSERT_NE(message, nullptr);
+    ASSERT_EQ(message->stages_size(), 2) << "Only the stages that started are sent.";
+    EXPECT_EQ(message->stages(0).name(), Progress::getStageName(Progress::Stage::SLICING));
+    EXPECT_EQ(message->stages(1).name(), Progress::getStageName(Progress::Stage::PARTS));
+    EXPECT_EQ(message->stages(1).done(), 3);
+    EXPECT_EQ(message->stages(1).total(), 10);
+    EXPECT_GE(message->thread_utilisation(), 0.0);
+    EXPECT_LE(message->thread_utilisation(), 1.0);
+
+    Progress::messageProgress(Progress::Stage::PARTS, 4, 10);
+    EXPECT_EQ(size_t(4), socket->sent_messages.size()) << "Only the progress, since the statistics were sent less than a second ago.";
+    Application::getInstance().communication = nullptr;
+}
+
+TEST_F(ArcusCommunicationTest, SendLargeLayerInParts)
+{
+    ac->private_data->object_count = 1;
+    ac->private_data->layer_view_chunk_size = 100; //Only a few line segments per part.
+    const LayerIndex layer_nr = 0;
+    ac->sendLayerComplete(layer_nr, 200, 100);
+    ac->sendPolygon(PrintFeatureType::OuterWall, test_circle, 400, 100, Velocity(50));
+    EXPECT_LT(size_t(0), socket->sent_messages.size()) << "The layer is larger than the chunk size, so parts of it must be sent before the slice is finished.";
+
+    ac->sendOptimizedLayerData();
+    size_t total_line_segments = 0;
+    for (const Arcus::MessagePtr& message : socket->sent_messages)
+    {
+        const proto::LayerOptimized* layer = dynamic_cast<const proto::LayerOptimized*>(message.get());
+        ASSERT_NE(nullptr, layer) << "Only layer data was sent.";
+        EXPECT_EQ(static_cast<google::protobuf::int32>(layer_nr), layer->id()) << "All parts must get the ID of the layer so that the front-end can combine them.";
+        EXPECT_EQ(200.0f, layer->height()) << "All parts must get the height of the layer.";
+        for (const proto::PathSegment& segment : layer->path_segment())
+        {
+            total_line_segments += segment.line_type().size();
+            EXPECT_EQ((segment.line_type().size() + 1) * 2 * sizeof(float), segment.points().size()) << "Each part must start with the end point of the previous one.";
+        }
+    }
+    EXPECT_EQ(test_circle.size(), total_line_segments) << "All line segments of the closed polygon must be sent once.";
+}
+
+
+TEST_F(ArcusCommunicationTest, SendCompactLayer)
+{
+    ac->private_data->object_count = 1;
+    ac->private_data->compact_layer_view = true;
+    const LayerIndex layer_nr = 0;
+    ac->sendLayerComplete(layer_nr, 200, 100);
+    ac->sendPolygon(PrintFeatureType::OuterWall, test_square, 400, 100, Velocity(50));
+    ac->sendOptimizedLayerData();
+
+    //Decode the message the way the front-end would.
+    const auto read_varint = [](const std::string& bytes, size_t& position)
+    {
+        uint64_t result = 0;
+        for (size_t shift = 0; position < bytes.size(); shift += 7)
+        {
+            const uint8_t byte = bytes[position++];
+            result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+            {
+                break;
+            }
+        }
+        return result;
+    };
+    ASSERT_EQ(size_t(1), socket->sent_messages.size());
+    const proto::LayerOptimized* layer = dynamic_cast<const proto::LayerOptimized*>(socket->sent_messages.front().get());
+    ASSERT_NE(nullptr, layer);
+    ASSERT_EQ(1, layer->path_segment_size());
+    const proto::PathSegment& segment = layer->path_segment(0);
+    EXPECT_TRUE(segment.points().empty()) << "The float arrays are replaced by the compact encoding.";
+    EXPECT_TRUE(segment.line_width().empty()) << "The float arrays are replaced by the compact encoding.";
+
+    Polygon decoded;
+    Point position(0, 0);
+    for (size_t byte_idx = 0; byte_idx < segment.points_delta().size(); )
+    {
+        const uint64_t zigzag_x = read_varint(segment.points_delta(), byte_idx);
+        const uint64_t zigzag_y = read_varint(segment.points_delta(), byte_idx);
+        position += Point(static_cast<coord_t>(zigzag_x >> 1) ^ -static_cast<coord_t>(zigzag_x & 1), static_cast<coord_t>(zigzag_y >> 1) ^ -static_cast<coord_t>(zigzag_y & 1));
+        decoded.add(position);
+    }
+    ASSERT_EQ(test_square.size() + 1, decoded.size()) << "The closed square has one line segment for each vertex.";
+    for (size_t point_idx = 0; point_idx < decoded.size(); point_idx++)
+    {
+        EXPECT_EQ(test_square[point_idx % test_square.size()], decoded[point_idx]);
+    }
+
+    size_t byte_idx = 0;
+    EXPECT_EQ(test_square.size(), read_varint(segment.line_width_runs(), byte_idx)) << "All line segments have the same width, so they form a single run.";
+    EXPECT_EQ(uint64_t(400), read_varint(segment.line_width_runs(), byte_idx));
+    EXPECT_EQ(segment.line_width_runs().size(), byte_idx);
+    byte_idx = 0;
+    EXPECT_EQ(test_square.size(), read_varint(segment.line_feedrate_runs(), byte_idx));
+    EXPECT_EQ(uint64_t(50000), read_varint(segment.line_feedrate_runs(), byte_idx)) << "The feedrate is sent in microns per second.";
+}
+
+}
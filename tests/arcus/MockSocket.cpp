@@ -22,6 +22,10 @@ void MockSocket::sendMessage(Arcus::MessagePtr message)
 
 Arcus::MessagePtr MockSocket::takeNextMessage()
 {
+    if (received_messages.empty())
+    {
+        return nullptr; //Like the real socket when no message arrived yet.
+    }
     Arcus::MessagePtr result = received_messages.front();
     received_messages.pop_front();
     return result;
@@ -0,0 +1,68 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/Application.h" //To set up a scene to load the models into.
+#include "../src/MeshGroup.h" //The loaders under test.
+#include "../src/Slice.h"
+#include "../src/utils/FMatrix4x3.h"
+
+namespace cura
+{
+
+/*
+ * Tests loading the supported model file formats into a mesh group.
+ */
+class MeshGroupTest : public testing::Test
+{
+public:
+    void SetUp()
+    {
+        Application::getInstance().current_slice = new Slice(1);
+        Scene& scene = Application::getInstance().current_slice->scene;
+        scene.settings.add("mesh_sort_by_height", "false");
+        scene.settings.add("meshfix_decimate_mesh", "false");
+        scene.settings.add("slicing_preview", "false");
+    }
+
+    void TearDown()
+    {
+        delete Application::getInstance().current_slice;
+        Application::getInstance().current_slice = nullptr;
+    }
+};
+
+TEST_F(MeshGroupTest, LoadOBJ)
+{
+    Scene& scene = Application::getInstance().current_slice->scene;
+    MeshGroup& mesh_group = scene.mesh_groups.back();
+
+    const FMatrix4x3 transformation;
+    //Path is relative to CMAKE_CURRENT_SOURCE_DIR/tests. The cube has quads, and one of them uses negative indices.
+    ASSERT_TRUE(loadMeshIntoMeshGroup(&mesh_group, "integration/resources/cube.obj", transformation, scene.settings));
+    ASSERT_EQ(mesh_group.meshes.size(), 1);
+    const Mesh& mesh = mesh_group.meshes[0];
+    EXPECT_EQ(mesh.faces.size(), 12) << "Each of the 6 quads must be split into two triangles.";
+    EXPECT_EQ(mesh.vertices.size(), 8) << "The triangles must share the corners of the cube.";
+    EXPECT_EQ(mesh.getAABB().min, Point3(0, 0, 0));
+    EXPECT_EQ(mesh.getAABB().max, Point3(10000, 10000, 10000));
+}
+
+TEST_F(MeshGroupTest, Load3MF)
+{
+    Scene& scene = Application::getInstance().current_slice->scene;
+    MeshGroup& mesh_group = scene.mesh_groups.back();
+
+    const FMatrix4x3 transformation;
+    //A cube of 1cm in a file that uses centimetres, moved 1cm in X by a component and 2cm in Y by the build item.
+    ASSERT_TRUE(loadMeshIntoMeshGroup(&mesh_group, "integration/resources/cube.3mf", transformation, scene.settings));
+    ASSERT_EQ(mesh_group.meshes.size(), 1);
+    const Mesh& mesh = mesh_group.meshes[0];
+    EXPECT_EQ(mesh.faces.size(), 12);
+    EXPECT_EQ(mesh.vertices.size(), 8);
+    EXPECT_EQ(mesh.getAABB().min, Point3(10000, 20000, 0));
+    EXPECT_EQ(mesh.getAABB().max, Point3(20000, 30000, 10000));
+}
+
+} //namespace cura
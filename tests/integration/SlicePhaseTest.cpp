@@ -1,11 +1,14 @@
 //Copyright (c) 2020 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <cstdio> //For std::remove.
+#include <fstream> //To write a damaged cache file.
 #include <gtest/gtest.h>
 
 #include "../src/Application.h" //To set up a slice with settings.
 #include "../src/Slice.h" //To set up a scene to slice.
 #include "../src/slicer.h" //Starts the slicing phase that we want to test.
+#include "../src/SlicerCache.h" //To test reusing the sliced layers.
 #include "../src/utils/FMatrix4x3.h" //To load STL files.
 #include "../src/utils/polygon.h" //Creating polygons to compare to sliced layers.
 #include "../src/utils/polygonUtils.h" //Comparing similarity of polygons.
@@ -37,12 +40,16 @@ class SlicePhaseTest : public testing::Test
         scene.settings.add("minimum_polygon_circumference", "1");
         scene.settings.add("meshfix_maximum_resolution", "0.04");
         scene.settings.add("meshfix_maximum_deviation", "0.02");
+        scene.settings.add("meshfix_maximum_extrusion_area_deviation", "50000");
         scene.settings.add("xy_offset", "0");
         scene.settings.add("xy_offset_layer_0", "0");
         scene.settings.add("support_mesh", "false");
         scene.settings.add("anti_overhang_mesh", "false");
         scene.settings.add("cutting_mesh", "false");
         scene.settings.add("infill_mesh", "false");
+        scene.settings.add("mesh_sort_by_height", "false");
+        scene.settings.add("meshfix_decimate_mesh", "false");
+        scene.settings.add("slicing_preview", "false");
     }
 };
 
@@ -154,4 +161,118 @@ TEST_F(SlicePhaseTest, Cylinder1000)
     }
 }
 
+TEST_F(SlicePhaseTest, SlicerCacheReusesLayers)
+{
+    Scene& scene = Application::getInstance().current_slice->scene;
+    MeshGroup& mesh_group = scene.mesh_groups.back();
+
+    const FMatrix4x3 transformation;
+    ASSERT_TRUE(loadMeshIntoMeshGroup(&mesh_group, "integration/resources/cube.stl", transformation, scene.settings));
+    Mesh& cube_mesh = mesh_group.meshes[0];
+
+    const coord_t layer_thickness = scene.settings.get<coord_t>("layer_height");
+    const coord_t initial_layer_thickness = scene.settings.get<coord_t>("layer_height_0");
+    const size_t num_layers = (cube_mesh.getAABB().max.z - initial_layer_thickness) / layer_thickness + 1;
+    const std::string key = SlicerCache::getKey(cube_mesh, layer_thickness, num_layers, nullptr);
+
+    scene.settings.add("infill_sparse_density", "50");
+    EXPECT_EQ(SlicerCache::getKey(cube_mesh, layer_thickness, num_layers, nullptr), key) << "Settings that the slicer doesn't use must not change the key.";
+    scene.settings.add("xy_offset", "0.1");
+    EXPECT_NE(SlicerCache::getKey(cube_mesh, layer_thickness, num_layers, nullptr), key) << "Settings that the slicer uses must change the key.";
+    scene.settings.add("xy_offset", "0");
+    EXPECT_NE(SlicerCache::getKey(cube_mesh, layer_thickness * 2, num_layers, nullptr), key) << "The layer height must change the key.";
+
+    SlicerCache cache;
+    cache.startMeshGroup(1);
+    EXPECT_EQ(cache.find(key), nullptr);
+    constexpr bool variable_layer_height = false;
+    Slicer slicer(&cube_mesh, layer_thickness, num_layers, variable_layer_height, nullptr);
+    cache.insert(key, slicer.layers);
+
+    cache.startMeshGroup(1); //The next slice.
+    const std::vector<SlicerLayer>* cached_layers = cache.find(key);
+    ASSERT_NE(cached_layers, nullptr) << "The layers of the previous slice must be kept.";
+    Slicer reused(&cube_mesh, *cached_layers);
+    ASSERT_EQ(reused.layers.size(), slicer.layers.size());
+    for (size_t layer_nr = 0; layer_nr < slicer.layers.size(); layer_nr++)
+    {
+        EXPECT_EQ(reused.layers[layer_nr].z, slicer.layers[layer_nr].z);
+        const Polygons& reused_polygons = reused.layers[layer_nr].polygons;
+        const Polygons& sliced_polygons = slicer.layers[layer_nr].polygons;
+        ASSERT_EQ(reused_polygons.size(), sliced_polygons.size());
+        for (size_t poly_idx = 0; poly_idx < sliced_polygons.size(); poly_idx++)
+        {
+            ASSERT_EQ(reused_polygons[poly_idx].size(), sliced_polygons[poly_idx].size());
+            for (size_t point_idx = 0; point_idx < sliced_polygons[poly_idx].size(); point_idx++)
+            {
+                EXPECT_EQ(reused_polygons[poly_idx][point_idx], sliced_polygons[poly_idx][point_idx]);
+            }
+        }
+    }
+
+    cache.startMeshGroup(1);
+    cache.startMeshGroup(1);
+    EXPECT_EQ(cache.find(key), nullptr) << "Layers that weren't used in the previous slice must be forgotten.";
+}
+
+TEST_F(SlicePhaseTest, SlicerCacheFiles)
+{
+    Scene& scene = Application::getInstance().current_slice->scene;
+    MeshGroup& mesh_group = scene.mesh_groups.back();
+
+    const FMatrix4x3 transformation;
+    ASSERT_TRUE(loadMeshIntoMeshGroup(&mesh_group, "integration/resources/cylinder1000.stl", transformation, scene.settings));
+    Mesh& cylinder_mesh = mesh_group.meshes[0];
+
+    const coord_t layer_thickness = scene.settings.get<coord_t>("layer_height");
+    const coord_t initial_layer_thickness = scene.settings.get<coord_t>("layer_height_0");
+    const size_t num_layers = (cylinder_mesh.getAABB().max.z - initial_layer_thickness) / layer_thickness + 1;
+    const std::string key = SlicerCache::getKey(cylinder_mesh, layer_thickness, num_layers, nullptr);
+    constexpr bool variable_layer_height = false;
+    Slicer slicer(&cylinder_mesh, layer_thickness, num_layers, variable_layer_height, nullptr);
+
+    {
+        SlicerCache first_run;
+        first_run.setDirectory(".");
+        first_run.startMeshGroup(1);
+        first_run.insert(key, slicer.layers);
+    }
+    SlicerCache second_run; //As if CuraEngine is started again.
+    second_run.setDirectory(".");
+    second_run.startMeshGroup(1);
+    const std::vector<SlicerLayer>* cached_layers = second_run.find(key);
+    std::remove(second_run.getFilename(key).c_str());
+    ASSERT_NE(cached_layers, nullptr) << "The layers must be read back from the cache file.";
+    ASSERT_EQ(cached_layers->size(), slicer.layers.size());
+    for (size_t layer_nr = 0; layer_nr < slicer.layers.size(); layer_nr++)
+    {
+        EXPECT_EQ((*cached_layers)[layer_nr].z, slicer.layers[layer_nr].z);
+        EXPECT_EQ((*cached_layers)[layer_nr].polygons.pointCount(), slicer.layers[layer_nr].polygons.pointCount());
+        EXPECT_EQ((*cached_layers)[layer_nr].polygons.area(), slicer.layers[layer_nr].polygons.area());
+    }
+
+    EXPECT_EQ(second_run.find(key + "different"), nullptr) << "A key that was never stored must not be found.";
+}
+
+TEST_F(SlicePhaseTest, SlicerCacheDamagedFile)
+{
+    const std::string key = "damaged";
+    SlicerCache cache;
+    cache.setDirectory(".");
+    cache.startMeshGroup(1);
+    {
+        //A file with the right header and key, but a layer count that is much larger than the rest of the file.
+        std::ofstream file(cache.getFilename(key), std::ios::binary);
+        file.write("CURASLC\x01", 8);
+        const uint32_t key_length = key.size();
+        file.write(reinterpret_cast<const char*>(&key_length), sizeof(key_length));
+        file.write(key.data(), key.size());
+        const uint32_t layer_count = 0xFFFFFFFF;
+        file.write(reinterpret_cast<const char*>(&layer_count), sizeof(layer_count));
+    }
+    const std::vector<SlicerLayer>* cached_layers = cache.find(key);
+    std::remove(cache.getFilename(key).c_str());
+    EXPECT_EQ(cached_layers, nullptr) << "A damaged cache file must be ignored, without allocating the layers it claims to have.";
+}
+
 } //namespace cura
\ No newline at end of file
@@ -0,0 +1,82 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <fstream> //To read the test settings.
+#include <gtest/gtest.h>
+
+#include "../src/Application.h" //To set up a slice with settings.
+#include "../src/FffPolygonGenerator.h" //Generates the support that we want to test.
+#include "../src/Slice.h" //To set up a scene to slice.
+#include "../src/sliceDataStorage.h" //To check which support layers were allocated.
+#include "../src/utils/FMatrix4x3.h" //To load STL files.
+#include "../src/utils/gettime.h" //TimeKeeper for the slicing stages.
+#include "../arcus/MockCommunication.h" //To prevent calls to any missing Communication class.
+
+namespace cura
+{
+
+/*
+ * Integration test on the support layers that are allocated while slicing.
+ * Support layers that don't get any support shouldn't be allocated, so
+ * slicing a model without support shouldn't allocate any.
+ */
+class SupportAllocationTest : public testing::Test
+{
+public:
+    MockCommunication* mock_communication;
+
+    void SetUp() override
+    {
+        mock_communication = new MockCommunication();
+        Application::getInstance().communication = mock_communication;
+        Application::getInstance().current_slice = new Slice(1);
+        Scene& scene = Application::getInstance().current_slice->scene;
+        scene.current_mesh_group = scene.mesh_groups.begin();
+
+        //Path is relative to CMAKE_CURRENT_SOURCE_DIR/tests. These settings have support disabled.
+        std::ifstream test_settings_file("test_global_settings.txt");
+        ASSERT_TRUE(test_settings_file.is_open());
+        std::string line;
+        while (std::getline(test_settings_file, line))
+        {
+            const size_t pos = line.find_first_of('=');
+            if (line.size() < 3 || pos == std::string::npos)
+            {
+                continue;
+            }
+            scene.settings.add(line.substr(0, pos), line.substr(pos + 1));
+        }
+        for (size_t extruder_nr = 0; extruder_nr < scene.settings.get<size_t>("machine_extruder_count"); extruder_nr++)
+        {
+            scene.extruders.emplace_back(extruder_nr, &scene.current_mesh_group->settings);
+        }
+    }
+
+    void TearDown() override
+    {
+        delete Application::getInstance().current_slice;
+        Application::getInstance().current_slice = nullptr;
+        delete mock_communication;
+        Application::getInstance().communication = nullptr;
+    }
+};
+
+TEST_F(SupportAllocationTest, NoSupportLayersWithoutSupport)
+{
+    Scene& scene = Application::getInstance().current_slice->scene;
+    MeshGroup& mesh_group = *scene.current_mesh_group;
+    ASSERT_FALSE(mesh_group.settings.get<bool>("support_enable"));
+
+    const FMatrix4x3 transformation;
+    //Path to cube.stl is relative to CMAKE_CURRENT_SOURCE_DIR/tests.
+    ASSERT_TRUE(loadMeshIntoMeshGroup(&mesh_group, "integration/resources/cube.stl", transformation, mesh_group.settings));
+
+    SliceDataStorage storage;
+    TimeKeeper time_keeper;
+    ASSERT_TRUE(FffPolygonGenerator().generateAreas(storage, &mesh_group, time_keeper));
+
+    ASSERT_GT(storage.support.supportLayers.size(), 0) << "There is a support layer for every layer of the cube.";
+    EXPECT_EQ(storage.support.supportLayers.allocatedCount(), 0) << "None of the layers has any support, so none of them may be allocated.";
+}
+
+} //namespace cura
@@ -0,0 +1,145 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/Application.h" //To set up a scene with meshes.
+#include "../src/Slice.h"
+#include "../src/mesh.h"
+#include "../src/settings/AdaptiveLayerHeights.h" //The class under test.
+
+namespace cura
+{
+
+/*
+ * Tests the layer heights that are chosen for a few simple meshes.
+ */
+class AdaptiveLayerHeightsTest : public testing::Test
+{
+public:
+    //Allows 300, 250, 200, 150 and 100 micron layers.
+    static constexpr coord_t base_layer_height = 200;
+    static constexpr coord_t variation = 100;
+    static constexpr coord_t step_size = 50;
+    static constexpr coord_t threshold = 200;
+
+    void SetUp()
+    {
+        Application::getInstance().current_slice = new Slice(1);
+        Scene& scene = Application::getInstance().current_slice->scene;
+        scene.settings.add("slicing_tolerance", "middle");
+        scene.settings.add("layer_height_0", "0.2");
+        scene.settings.add("infill_mesh", "false");
+        scene.settings.add("cutting_mesh", "false");
+        scene.settings.add("anti_overhang_mesh", "false");
+    }
+
+    void TearDown()
+    {
+        delete Application::getInstance().current_slice;
+        Application::getInstance().current_slice = nullptr;
+    }
+
+    /*!
+     * Add a mesh to the mesh group.
+     */
+    Mesh& addMesh()
+    {
+        MeshGroup& mesh_group = Application::getInstance().current_slice->scene.mesh_groups.back();
+        mesh_group.meshes.emplace_back(mesh_group.settings);
+        return mesh_group.meshes.back();
+    }
+
+    /*!
+     * Add a cube of 10mm to the mesh group, standing on the build plate.
+     */
+    Mesh& addCube()
+    {
+        Mesh& mesh = addMesh();
+        const coord_t size = 10000;
+        Point3 corners[8];
+        for (size_t i = 0; i < 8; i++)
+        {
+            corners[i] = Point3((i & 1) ? size : 0, (i & 2) ? size : 0, (i & 4) ? size : 0);
+        }
+        const size_t quads[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+        for (const size_t* quad : quads)
+        {
+            mesh.addFace(corners[quad[0]], corners[quad[1]], corners[quad[2]]);
+            mesh.addFace(corners[quad[0]], corners[quad[2]], corners[quad[3]]);
+        }
+        return mesh;
+    }
+
+    /*!
+     * Add a low pyramid to the mesh group, with a base of 20 by 20mm and a
+     * height of 2mm. Its sides are very shallow.
+     */
+    Mesh& addPyramid()
+    {
+        Mesh& mesh = addMesh();
+        Point3 base[4] = { Point3(0, 0, 0), Point3(20000, 0, 0), Point3(20000, 20000, 0), Point3(0, 20000, 0) };
+        Point3 apex(10000, 10000, 2000);
+        for (size_t i = 0; i < 4; i++)
+        {
+            mesh.addFace(base[i], base[(i + 1) % 4], apex);
+        }
+        mesh.addFace(base[0], base[2], base[1]);
+        mesh.addFace(base[0], base[3], base[2]);
+        return mesh;
+    }
+};
+
+TEST_F(AdaptiveLayerHeightsTest, VerticalSidesUseThickestLayers)
+{
+    addCube();
+    AdaptiveLayerHeights adaptive_layers(base_layer_height, variation, step_size, threshold);
+    const std::vector<AdaptiveLayer>& layers = *adaptive_layers.getLayers();
+
+    ASSERT_GT(layers.size(), 2);
+    EXPECT_EQ(layers[0].layer_height, 200) << "The first layer always gets the initial layer height.";
+    EXPECT_EQ(layers[1].layer_height, 250) << "The layer height may only change by the step size per layer.";
+    for (size_t layer_nr = 2; layer_nr < layers.size(); layer_nr++)
+    {
+        EXPECT_EQ(layers[layer_nr].layer_height, 300) << "Vertical sides should get the thickest layers.";
+        EXPECT_EQ(layers[layer_nr].z_position, layers[layer_nr - 1].z_position + layers[layer_nr].layer_height);
+    }
+    EXPECT_GE(layers.back().z_position, 10000) << "The layers must reach the top of the cube.";
+    EXPECT_LT(layers[layers.size() - 2].z_position, 10000) << "The layers must stop at the top of the cube.";
+}
+
+TEST_F(AdaptiveLayerHeightsTest, ShallowSlopesUseThinnestLayers)
+{
+    addPyramid();
+    AdaptiveLayerHeights adaptive_layers(base_layer_height, variation, step_size, threshold);
+    const std::vector<AdaptiveLayer>& layers = *adaptive_layers.getLayers();
+
+    ASSERT_GT(layers.size(), 2);
+    for (size_t layer_nr = 1; layer_nr < layers.size(); layer_nr++)
+    {
+        EXPECT_EQ(layers[layer_nr].layer_height, 100) << "Shallow slopes should get the thinnest layers.";
+    }
+    EXPECT_GE(layers.back().z_position, 2000) << "The layers must reach the apex of the pyramid.";
+    EXPECT_LE(layers[layers.size() - 2].z_position, 2000) << "The layers must stop at the apex of the pyramid.";
+}
+
+TEST_F(AdaptiveLayerHeightsTest, IgnoresMeshesThatAreNotPrinted)
+{
+    addCube();
+    AdaptiveLayerHeights cube_layers(base_layer_height, variation, step_size, threshold);
+
+    Mesh& infill_mesh = addPyramid();
+    infill_mesh.settings.add("infill_mesh", "true");
+    AdaptiveLayerHeights cube_and_infill_mesh_layers(base_layer_height, variation, step_size, threshold);
+
+    const std::vector<AdaptiveLayer>& expected = *cube_layers.getLayers();
+    const std::vector<AdaptiveLayer>& actual = *cube_and_infill_mesh_layers.getLayers();
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t layer_nr = 0; layer_nr < actual.size(); layer_nr++)
+    {
+        EXPECT_EQ(actual[layer_nr].layer_height, expected[layer_nr].layer_height);
+        EXPECT_EQ(actual[layer_nr].z_position, expected[layer_nr].z_position);
+    }
+}
+
+} //namespace cura
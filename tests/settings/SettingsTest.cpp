@@ -248,4 +248,64 @@ TEST_F(SettingsTest, LimitToExtruder)
     EXPECT_EQ(limit_extruder_value, settings.get<std::string>("test_setting"));
 }
 
+
+TEST_F(SettingsTest, OverwriteCachedSetting)
+{
+    settings.add("test_setting", "1.5");
+    EXPECT_DOUBLE_EQ(1.5, settings.get<double>("test_setting"));
+    settings.add("test_setting", "2.5");
+    EXPECT_DOUBLE_EQ(2.5, settings.get<double>("test_setting")) << "Overwriting a setting must replace the cached value.";
+    EXPECT_EQ(std::string("2.5"), settings.get<std::string>("test_setting"));
+}
+
+TEST_F(SettingsTest, InheritanceCachedSetting)
+{
+    std::shared_ptr<Slice> current_slice = std::make_shared<Slice>(0);
+    Application::getInstance().current_slice = current_slice.get();
+
+    Settings parent;
+    parent.add("test_setting", "1");
+    settings.setParent(&parent);
+    EXPECT_EQ(1, settings.get<int>("test_setting"));
+
+    parent.add("test_setting", "2");
+    EXPECT_EQ(2, settings.get<int>("test_setting")) << "Changing a parent setting must replace the value cached in the child.";
+
+    Settings other_parent;
+    other_parent.add("test_setting", "3");
+    settings.setParent(&other_parent);
+    EXPECT_EQ(3, settings.get<int>("test_setting")) << "Changing the parent must replace the cached value.";
+}
+
+
+TEST_F(SettingsTest, SettingKey)
+{
+    static const SettingKey<coord_t> test_setting_key("test_setting");
+    settings.add("test_setting", "0.4");
+    EXPECT_EQ(settings.get<coord_t>("test_setting"), settings.get(test_setting_key)) << "Getting a setting by handle must get the same value as by name.";
+    EXPECT_EQ(coord_t(400), settings.get(test_setting_key));
+
+    settings.add("test_setting", "0.8");
+    EXPECT_EQ(coord_t(800), settings.get(test_setting_key)) << "The handle must see changes to the setting.";
+}
+
+TEST_F(SettingsTest, GetOrDefault)
+{
+    std::shared_ptr<Slice> current_slice = std::make_shared<Slice>(0);
+    Application::getInstance().current_slice = current_slice.get();
+
+    EXPECT_EQ(42, settings.getOrDefault<int>("test_setting", 42)) << "A setting without a value must get the default.";
+    static const SettingKey<coord_t> test_setting_key("test_setting");
+    EXPECT_EQ(coord_t(7), settings.getOrDefault(test_setting_key, coord_t(7))) << "A handle to a setting without a value must get the default too.";
+
+    Settings parent;
+    parent.add("test_setting", "0.4");
+    settings.setParent(&parent);
+    EXPECT_EQ(coord_t(400), settings.getOrDefault(test_setting_key, coord_t(7))) << "An inherited value must be used instead of the default.";
+    EXPECT_EQ(coord_t(400), settings.get(test_setting_key));
+
+    settings.add("test_setting", "0.8");
+    EXPECT_EQ(coord_t(800), settings.getOrDefault(test_setting_key, coord_t(7))) << "The default must not hide changes to the setting.";
+}
+
 }
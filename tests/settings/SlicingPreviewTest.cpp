@@ -0,0 +1,94 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include <memory> //For shared_ptr.
+
+#include "../src/Application.h" //To set the current slice, which settings look up extruders in.
+#include "../src/ExtruderTrain.h"
+#include "../src/MeshGroup.h"
+#include "../src/Scene.h"
+#include "../src/Slice.h"
+#include "../src/settings/SlicingPreview.h" //The class under test.
+
+namespace cura
+{
+
+class SlicingPreviewTest : public testing::Test
+{
+public:
+    std::shared_ptr<Slice> current_slice;
+    Scene* scene_ptr;
+
+    void SetUp()
+    {
+        current_slice = std::make_shared<Slice>(1);
+        Application::getInstance().current_slice = current_slice.get();
+        scene_ptr = &current_slice->scene;
+        Scene& scene = *scene_ptr;
+        scene.settings.add("slicing_preview", "true");
+        scene.settings.add("meshfix_maximum_deviation", "0.025");
+        scene.settings.add("meshfix_maximum_resolution", "0.5");
+        scene.settings.add("meshfix_maximum_travel_resolution", "0.8");
+        scene.settings.add("retraction_combing", "noskin");
+        scene.extruders.emplace_back(0, &scene.settings);
+        scene.extruders[0].settings.add("meshfix_maximum_resolution", "0.3"); //A value of its own, finer than the preview.
+        scene.extruders[0].settings.add("retraction_combing", "all");
+    }
+
+    void TearDown()
+    {
+        Application::getInstance().current_slice = nullptr;
+    }
+};
+
+TEST_F(SlicingPreviewTest, Coarsens)
+{
+    Scene& scene = *scene_ptr;
+    MeshGroup& mesh_group = scene.mesh_groups[0];
+    SlicingPreview::apply(scene, mesh_group);
+
+    EXPECT_EQ(scene.settings.get<coord_t>("meshfix_maximum_deviation"), SlicingPreview::preview_maximum_deviation);
+    EXPECT_EQ(scene.settings.get<coord_t>("meshfix_maximum_resolution"), SlicingPreview::preview_maximum_resolution);
+    EXPECT_EQ(scene.settings.get<coord_t>("meshfix_maximum_travel_resolution"), SlicingPreview::preview_maximum_travel_resolution);
+    EXPECT_EQ(scene.settings.get<std::string>("retraction_combing"), "off");
+    EXPECT_EQ(scene.extruders[0].settings.get<coord_t>("meshfix_maximum_resolution"), SlicingPreview::preview_maximum_resolution) << "The own values of extruders must be coarsened too.";
+    EXPECT_EQ(scene.extruders[0].settings.get<std::string>("retraction_combing"), "off");
+    EXPECT_EQ(mesh_group.settings.get<coord_t>("meshfix_maximum_resolution"), SlicingPreview::preview_maximum_resolution) << "Inherited values must be coarse.";
+}
+
+TEST_F(SlicingPreviewTest, KeepsCoarserValues)
+{
+    Scene& scene = *scene_ptr;
+    scene.settings.add("meshfix_maximum_deviation", "0.5");
+    SlicingPreview::apply(scene, scene.mesh_groups[0]);
+    EXPECT_EQ(scene.settings.get<coord_t>("meshfix_maximum_deviation"), MM2INT(0.5)) << "Settings that are coarser already must stay as they are.";
+}
+
+TEST_F(SlicingPreviewTest, ApplyTwice)
+{
+    Scene& scene = *scene_ptr;
+    SlicingPreview::apply(scene, scene.mesh_groups[0]);
+    SlicingPreview::apply(scene, scene.mesh_groups[0]); //Such as for the next mesh group.
+    EXPECT_EQ(scene.settings.get<coord_t>("meshfix_maximum_resolution"), SlicingPreview::preview_maximum_resolution);
+    EXPECT_EQ(SlicingPreview::getMaximumResolution(scene.settings), SlicingPreview::preview_maximum_resolution);
+}
+
+TEST_F(SlicingPreviewTest, Disabled)
+{
+    Scene& scene = *scene_ptr;
+    scene.settings.add("slicing_preview", "false");
+    SlicingPreview::apply(scene, scene.mesh_groups[0]);
+    EXPECT_EQ(scene.settings.get<coord_t>("meshfix_maximum_resolution"), MM2INT(0.5));
+    EXPECT_EQ(scene.settings.get<std::string>("retraction_combing"), "noskin");
+    EXPECT_EQ(SlicingPreview::getMaximumDeviation(scene.settings), MM2INT(0.025));
+}
+
+TEST_F(SlicingPreviewTest, DisabledWithoutValue)
+{
+    Settings settings; //Without a parent, so without the value of the scene.
+    EXPECT_FALSE(SlicingPreview::isEnabled(settings)) << "A front-end that doesn't know the setting must get a normal slice.";
+}
+
+} //namespace cura
@@ -0,0 +1,77 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/utils/AllocationTracker.h" //The class under test.
+#include "../src/utils/Trace.h" //The zones are the stages that allocations are attributed to.
+
+namespace cura
+{
+
+/*!
+ * Storing the allocations here keeps the compiler from leaving them out.
+ */
+void* volatile allocation_sink;
+
+TEST(AllocationTrackerTest, CountsAllocationsOfZone)
+{
+    if (!AllocationTracker::isEnabled())
+    {
+        GTEST_SKIP() << "Allocations are only tracked if compiled with CURA_TRACK_ALLOCATIONS.";
+    }
+    const AllocationTracker::Counts before = AllocationTracker::getCounts("allocating zone");
+    {
+        TraceZone zone("allocating zone");
+        std::vector<char> allocation(1000);
+        allocation_sink = allocation.data();
+        std::unique_ptr<int> other_allocation = std::make_unique<int>(42);
+        allocation_sink = other_allocation.get();
+    }
+    const AllocationTracker::Counts after = AllocationTracker::getCounts("allocating zone");
+    EXPECT_EQ(before.allocations + 2, after.allocations) << "Both allocations were made in the zone.";
+    EXPECT_EQ(before.bytes + 1000 + sizeof(int), after.bytes);
+    EXPECT_GE(after.peak_live_bytes, 1000 + sizeof(int)) << "Both allocations were alive at the same time.";
+
+    {
+        std::vector<char> outside(1000);
+        allocation_sink = outside.data();
+    }
+    EXPECT_EQ(after.allocations, AllocationTracker::getCounts("allocating zone").allocations) << "Allocations after the zone ended are not attributed to it.";
+}
+
+TEST(AllocationTrackerTest, InnermostZoneOfEachThread)
+{
+    if (!AllocationTracker::isEnabled())
+    {
+        GTEST_SKIP() << "Allocations are only tracked if compiled with CURA_TRACK_ALLOCATIONS.";
+    }
+    const size_t outer_before = AllocationTracker::getCounts("outer zone").allocations;
+    const size_t inner_before = AllocationTracker::getCounts("inner zone").allocations;
+    const size_t thread_before = AllocationTracker::getCounts("thread zone").allocations;
+    {
+        TraceZone outer("outer zone");
+        {
+            TraceZone inner("inner zone");
+            std::vector<char> allocation(100);
+            allocation_sink = allocation.data();
+        }
+        std::thread other_thread([]()
+        {
+            TraceZone zone("thread zone");
+            std::vector<char> allocation(100);
+            allocation_sink = allocation.data();
+        });
+        other_thread.join();
+        std::vector<char> allocation(100);
+        allocation_sink = allocation.data();
+    }
+    EXPECT_EQ(inner_before + 1, AllocationTracker::getCounts("inner zone").allocations) << "Allocations are attributed to the innermost zone.";
+    EXPECT_EQ(thread_before + 1, AllocationTracker::getCounts("thread zone").allocations) << "Each thread has its own current zone.";
+    EXPECT_LE(outer_before + 1, AllocationTracker::getCounts("outer zone").allocations) << "After the inner zone ends, allocations are attributed to the outer zone again.";
+}
+
+} //namespace cura
@@ -0,0 +1,96 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cmath>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/utils/ArcFitting.h" //The class under test.
+
+namespace cura
+{
+
+constexpr coord_t tolerance = 25;
+constexpr coord_t max_radius = MM2INT(1000);
+
+/*!
+ * Make the vertices of a polyline along a circle around the origin.
+ * \param radius The radius of the circle.
+ * \param start_angle Where the polyline starts on the circle.
+ * \param end_angle Where the polyline ends. If smaller than the start, the
+ * polyline goes clockwise.
+ * \param segment_count How many line segments the polyline has.
+ * \return The vertices, including the start.
+ */
+std::vector<Point> makeArc(const coord_t radius, const double start_angle, const double end_angle, const size_t segment_count)
+{
+    std::vector<Point> result;
+    for (size_t vertex_idx = 0; vertex_idx <= segment_count; vertex_idx++)
+    {
+        const double angle = start_angle + (end_angle - start_angle) * vertex_idx / segment_count;
+        result.emplace_back(std::llrint(std::cos(angle) * radius), std::llrint(std::sin(angle) * radius));
+    }
+    return result;
+}
+
+TEST(ArcFittingTest, HalfCircle)
+{
+    const std::vector<Point> vertices = makeArc(MM2INT(10), 0, M_PI, 36);
+    const std::vector<ArcFitting::Arc> arcs = ArcFitting::fit(vertices[0], vertices.data() + 1, vertices.size() - 1, tolerance, max_radius);
+
+    ASSERT_EQ(size_t(1), arcs.size()) << "All line segments are on the same circle.";
+    EXPECT_EQ(size_t(0), arcs[0].first_idx);
+    EXPECT_EQ(size_t(35), arcs[0].last_idx) << "The arc ends at the last vertex.";
+    EXPECT_TRUE(arcs[0].counter_clockwise);
+    EXPECT_LE(vSize(arcs[0].center), 2) << "The center must be at the origin, apart from rounding.";
+}
+
+TEST(ArcFittingTest, Clockwise)
+{
+    const std::vector<Point> vertices = makeArc(MM2INT(5), M_PI / 2, -M_PI / 4, 20);
+    const std::vector<ArcFitting::Arc> arcs = ArcFitting::fit(vertices[0], vertices.data() + 1, vertices.size() - 1, tolerance, max_radius);
+
+    ASSERT_EQ(size_t(1), arcs.size());
+    EXPECT_FALSE(arcs[0].counter_clockwise);
+}
+
+TEST(ArcFittingTest, FullCircleIsSplit)
+{
+    const std::vector<Point> vertices = makeArc(MM2INT(10), 0, 2 * M_PI, 72);
+    const std::vector<ArcFitting::Arc> arcs = ArcFitting::fit(vertices[0], vertices.data() + 1, vertices.size() - 1, tolerance, max_radius);
+
+    ASSERT_FALSE(arcs.empty());
+    for (const ArcFitting::Arc& arc : arcs)
+    {
+        EXPECT_LT(arc.last_idx - arc.first_idx, size_t(71)) << "A single arc can't go around the full circle, since its start and end are the same.";
+    }
+}
+
+TEST(ArcFittingTest, StraightAndCorners)
+{
+    const std::vector<Point> straight = {Point(1000, 0), Point(2000, 0), Point(3000, 0), Point(4000, 0), Point(5000, 0)};
+    EXPECT_TRUE(ArcFitting::fit(Point(0, 0), straight.data(), straight.size(), tolerance, max_radius).empty()) << "Straight lines stay line segments.";
+
+    const std::vector<Point> square = {Point(10000, 0), Point(10000, 10000), Point(0, 10000), Point(0, 0)};
+    EXPECT_TRUE(ArcFitting::fit(Point(0, 0), square.data(), square.size(), tolerance, max_radius).empty()) << "The middles of the sides are far from the circle through the corners.";
+
+    const std::vector<Point> zigzag = {Point(1000, 100), Point(2000, 0), Point(3000, 100), Point(4000, 0)};
+    EXPECT_TRUE(ArcFitting::fit(Point(0, 0), zigzag.data(), zigzag.size(), 200, max_radius).empty()) << "Line segments that turn both ways aren't an arc.";
+}
+
+TEST(ArcFittingTest, ArcBetweenLines)
+{
+    //A straight line, then a quarter circle, then another straight line.
+    std::vector<Point> vertices = {Point(-MM2INT(10), MM2INT(10))};
+    const std::vector<Point> arc = makeArc(MM2INT(10), M_PI / 2, 0, 18);
+    vertices.insert(vertices.end(), arc.begin(), arc.end());
+    vertices.emplace_back(MM2INT(10), -MM2INT(10));
+
+    const std::vector<ArcFitting::Arc> arcs = ArcFitting::fit(vertices[0], vertices.data() + 1, vertices.size() - 1, tolerance, max_radius);
+    ASSERT_EQ(size_t(1), arcs.size());
+    EXPECT_EQ(size_t(1), arcs[0].first_idx) << "The arc starts at the end of the first straight line.";
+    EXPECT_EQ(size_t(18), arcs[0].last_idx) << "The arc ends where the quarter circle ends.";
+    EXPECT_FALSE(arcs[0].counter_clockwise);
+}
+
+} //namespace cura
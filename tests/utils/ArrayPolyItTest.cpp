@@ -0,0 +1,105 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <random>
+
+#include "../src/utils/ArrayPolyIt.h" //The class under test.
+#include "../src/utils/ListPolyIt.h" //The results must be the same as those of a ListPolygon.
+
+namespace cura
+{
+
+class ArrayPolyItTest : public testing::Test
+{
+public:
+    Polygon square;
+
+    void SetUp() override
+    {
+        square.add(Point(0, 0));
+        square.add(Point(1000, 0));
+        square.add(Point(1000, 1000));
+        square.add(Point(0, 1000));
+    }
+
+    Polygon toPolygon(const ArrayListPolygon& poly)
+    {
+        Polygon result;
+        poly.toPolygon(result);
+        return result;
+    }
+};
+
+TEST_F(ArrayPolyItTest, Unchanged)
+{
+    ArrayListPolygon poly(square);
+    EXPECT_EQ(size_t(4), poly.size());
+    EXPECT_EQ(*square, *toPolygon(poly));
+
+    ArrayPolyIt it(poly, poly.first());
+    EXPECT_EQ(Point(1000, 0), it.next().p());
+    EXPECT_EQ(Point(0, 1000), it.prev().p()) << "The polygon wraps around at its ends.";
+}
+
+TEST_F(ArrayPolyItTest, FirstVertexLikeList)
+{
+    ArrayListPolygon poly(square);
+    const ArrayPolyIt first(poly, poly.first());
+    ArrayPolyIt::insertPointNonDuplicate(first.prev(), first, Point(0, 500));
+    EXPECT_EQ(Point(0, 500), ArrayPolyIt(poly, poly.first()).p()) << "Inserting in front of the first vertex makes the new vertex the first, like in a list.";
+
+    ArrayPolyIt(poly, poly.first()).remove();
+    EXPECT_EQ(Point(0, 0), ArrayPolyIt(poly, poly.first()).p()) << "Removing the first vertex makes the next one the first.";
+    EXPECT_EQ(*square, *toPolygon(poly)) << "The removed vertex is left out.";
+
+    EXPECT_EQ(first, ArrayPolyIt::insertPointNonDuplicate(first.prev(), first, Point(0, 0))) << "Duplicates are not inserted.";
+    EXPECT_EQ(size_t(4), poly.size());
+}
+
+TEST_F(ArrayPolyItTest, SameAsListPolygon)
+{
+    std::mt19937 random(42);
+    Polygon input;
+    for (coord_t vertex = 0; vertex < 20; vertex++)
+    {
+        input.add(Point(vertex * 100, (vertex % 2) * 100));
+    }
+    ArrayListPolygon array_poly(input);
+    ListPolygon list_poly;
+    ListPolyIt::convertPolygonToList(input, list_poly);
+    ArrayPolyIt array_it(array_poly, array_poly.first());
+    ListPolyIt list_it(list_poly, list_poly.begin());
+
+    for (coord_t step = 0; step < 200; step++)
+    {
+        const size_t move = random() % 5;
+        for (size_t i = 0; i < move; i++)
+        {
+            ++array_it;
+            ++list_it;
+        }
+        if (random() % 2 == 0 && list_poly.size() > 3)
+        {
+            const ArrayPolyIt array_next = array_it.next();
+            const ListPolyIt list_next = list_it.next();
+            array_it.remove();
+            list_it.remove();
+            array_it = array_next;
+            list_it = list_next;
+        }
+        else
+        {
+            const Point to_insert(10000 + step, step);
+            array_it = ArrayPolyIt::insertPointNonDuplicate(array_it.prev(), array_it, to_insert);
+            list_it = ListPolyIt::insertPointNonDuplicate(list_it.prev(), list_it, to_insert);
+        }
+        ASSERT_EQ(list_it.p(), array_it.p());
+    }
+
+    Polygon list_result;
+    ListPolyIt::convertListPolygonToPolygon(list_poly, list_result);
+    EXPECT_EQ(*list_result, *toPolygon(array_poly)) << "The order and the first vertex must be the same as in a list.";
+}
+
+} //namespace cura
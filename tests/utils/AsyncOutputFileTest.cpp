@@ -0,0 +1,199 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cstdio> //For std::remove.
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <zlib.h> //To decompress the output.
+
+#include "../src/utils/AsyncOutputFile.h" //The file under test.
+
+namespace cura
+{
+
+/*!
+ * Write more than a few blocks of data in pieces of all sizes, and check that
+ * the file contains exactly what was written.
+ */
+TEST(AsyncOutputFileTest, WritesEverythingInOrder)
+{
+    const std::string filename = "async_output_file_test.gcode";
+    std::ostringstream expected;
+    {
+        AsyncOutputFile file;
+        file.open(filename.c_str());
+        ASSERT_TRUE(file.is_open()) << "The file must be opened for writing.";
+        for (size_t line_nr = 0; line_nr < 300000; line_nr++)
+        {
+            std::ostringstream line;
+            line << "G1 X" << line_nr << " Y" << line_nr * 3 << " E" << line_nr % 7 << "\n";
+            file << line.str();
+            expected << line.str();
+            if (line_nr % 1000 == 0)
+            {
+                file.put(';');
+                expected.put(';');
+            }
+            if (line_nr % 100000 == 0)
+            {
+                file.flush();
+            }
+        }
+        const std::string large(3 << 20, 'x'); //Larger than a block in one go.
+        file << large;
+        expected << large;
+        file.close();
+        EXPECT_TRUE(file.good()) << "Writing to the file must succeed.";
+    }
+
+    std::ifstream result_file(filename, std::ios::binary);
+    std::ostringstream result;
+    result << result_file.rdbuf();
+    result_file.close();
+    std::remove(filename.c_str());
+    EXPECT_TRUE(result.str() == expected.str()) << "The file must contain exactly what was written to the stream, in the same order.";
+}
+
+/*!
+ * Flushing must make everything written so far available in the file, while
+ * the stream stays open.
+ */
+TEST(AsyncOutputFileTest, FlushWritesToFile)
+{
+    const std::string filename = "async_output_file_flush_test.gcode";
+    AsyncOutputFile file;
+    file.open(filename.c_str());
+    ASSERT_TRUE(file.is_open());
+    file << ";FLAVOR:Marlin\n";
+    file.flush();
+
+    std::ifstream result_file(filename, std::ios::binary);
+    std::string first_line;
+    std::getline(result_file, first_line);
+    EXPECT_EQ(first_line, ";FLAVOR:Marlin") << "After flushing, the data must be in the file.";
+
+    file.close();
+    result_file.close();
+    std::remove(filename.c_str());
+}
+
+/*!
+ * Opening a file that can't be created must fail.
+ */
+TEST(AsyncOutputFileTest, OpenNonExistentDirectory)
+{
+    AsyncOutputFile file;
+    file.open("this/directory/does/not/exist/output.gcode");
+    EXPECT_FALSE(file.is_open());
+    EXPECT_TRUE(file.fail()) << "The stream must indicate that opening failed.";
+}
+
+/*!
+ * When compressing, the file must decompress to exactly what was written, also
+ * after flushing halfway.
+ */
+TEST(AsyncOutputFileTest, CompressedRoundTrip)
+{
+    const std::string filename = "async_output_file_test.gcode.gz";
+    std::ostringstream expected;
+    {
+        AsyncOutputFile file;
+        constexpr bool compress = true;
+        file.open(filename.c_str(), compress);
+        ASSERT_TRUE(file.is_open());
+        for (size_t line_nr = 0; line_nr < 200000; line_nr++)
+        {
+            std::ostringstream line;
+            line << "G1 X" << line_nr % 200 << " Y" << line_nr % 300 << " E" << line_nr << "\n";
+            file << line.str();
+            expected << line.str();
+            if (line_nr == 100000)
+            {
+                file.flush();
+            }
+        }
+        file.close();
+        EXPECT_TRUE(file.good()) << "Compressing and writing the file must succeed.";
+    }
+
+    std::string result;
+    gzFile compressed = gzopen(filename.c_str(), "rb");
+    ASSERT_TRUE(compressed != nullptr) << "The file must be a valid gzip file.";
+    char buffer[4096];
+    int read_size;
+    while ((read_size = gzread(compressed, buffer, sizeof(buffer))) > 0)
+    {
+        result.append(buffer, read_size);
+    }
+    EXPECT_EQ(read_size, 0) << "Decompressing must not fail.";
+    gzclose(compressed);
+
+    std::ifstream raw_file(filename, std::ios::binary | std::ios::ate);
+    const std::streamoff compressed_size = raw_file.tellg();
+    raw_file.close();
+    std::remove(filename.c_str());
+
+    EXPECT_TRUE(result == expected.str()) << "The decompressed file must contain exactly what was written to the stream.";
+    EXPECT_LT(compressed_size, static_cast<std::streamoff>(expected.str().size() / 2)) << "Repetitive g-code must compress well.";
+}
+
+/*!
+ * Data written earlier can be replaced, after which writing continues at the
+ * end of the file.
+ */
+TEST(AsyncOutputFileTest, OverwriteHeader)
+{
+    const std::string filename = "async_output_file_overwrite_test.gcode";
+    {
+        AsyncOutputFile file;
+        file.open(filename.c_str());
+        ASSERT_TRUE(file.is_open());
+        file << ";START\n";
+        const size_t header_position = file.getPosition();
+        EXPECT_EQ(header_position, 7);
+        file << ";TIME:6666\n";
+        for (size_t line_nr = 0; line_nr < 100000; line_nr++) //More than a block, so that the header is already written to the disk.
+        {
+            file << "G1 X" << line_nr << "\n";
+        }
+        EXPECT_TRUE(file.overwrite(header_position, ";TIME:1337\n"));
+        EXPECT_FALSE(file.overwrite(file.getPosition() - 2, ";TIME:1337\n")) << "Can't replace data that wasn't written yet.";
+        file << ";END\n";
+    }
+
+    std::ifstream result_file(filename, std::ios::binary);
+    std::string line;
+    std::getline(result_file, line);
+    EXPECT_EQ(line, ";START");
+    std::getline(result_file, line);
+    EXPECT_EQ(line, ";TIME:1337") << "The header must be replaced.";
+    size_t line_nr = 0;
+    while (std::getline(result_file, line) && line != ";END")
+    {
+        EXPECT_EQ(line, "G1 X" + std::to_string(line_nr)) << "The rest of the file must stay intact.";
+        line_nr++;
+    }
+    EXPECT_EQ(line_nr, 100000);
+    EXPECT_EQ(line, ";END") << "Writing must continue at the end of the file.";
+    result_file.close();
+    std::remove(filename.c_str());
+}
+
+/*!
+ * Compressed data can't be replaced.
+ */
+TEST(AsyncOutputFileTest, OverwriteCompressed)
+{
+    const std::string filename = "async_output_file_overwrite_test.gcode.gz";
+    AsyncOutputFile file;
+    constexpr bool compress = true;
+    file.open(filename.c_str(), compress);
+    ASSERT_TRUE(file.is_open());
+    file << ";TIME:6666\n";
+    EXPECT_FALSE(file.overwrite(0, ";TIME:1337\n"));
+    file.close();
+    std::remove(filename.c_str());
+}
+
+} //namespace cura
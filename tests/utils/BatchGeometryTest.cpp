@@ -0,0 +1,129 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/utils/BatchGeometry.h" //The class under test.
+#include "../src/utils/linearAlg2D.h" //To compare with the functions on single points.
+#include "../src/utils/polygon.h"
+#include "../StressShapes.h" //To get polygons with many vertices.
+
+namespace cura
+{
+
+class BatchGeometryTest : public testing::Test
+{
+public:
+    Polygons shape;
+    std::vector<Point> points;
+
+    void SetUp()
+    {
+        StressShapeParameters parameters;
+        parameters.part_count = 3;
+        parameters.nesting_depth = 2;
+        parameters.vertices_per_loop = 200; //More than one batch of line segments.
+        parameters.part_radius = 5000;
+        shape = makeStressPolygons(parameters);
+
+        for (coord_t x = -3000; x <= 40000; x += 1317)
+        {
+            for (coord_t y = -3000; y <= 40000; y += 1293)
+            {
+                points.emplace_back(x, y);
+            }
+        }
+        for (ConstPolygonRef polygon : shape)
+        {
+            points.insert(points.end(), polygon.begin(), polygon.end()); //Points exactly on the polygons.
+        }
+    }
+};
+
+TEST_F(BatchGeometryTest, ApplyMatrixSameAsPointMatrix)
+{
+    for (const double angle : {0.0, 30.0, 45.0, 90.0, 123.4, -77.0})
+    {
+        const PointMatrix matrix(angle);
+        std::vector<Point> transformed = points;
+        BatchGeometry::applyMatrix(matrix, transformed);
+        ASSERT_EQ(transformed.size(), points.size());
+        for (size_t point_idx = 0; point_idx < points.size(); point_idx++)
+        {
+            ASSERT_EQ(transformed[point_idx], matrix.apply(points[point_idx])) << "Rotating " << points[point_idx] << " by " << angle << " degrees.";
+        }
+    }
+}
+
+TEST_F(BatchGeometryTest, BoundingBox)
+{
+    Point min(POINT_MAX, POINT_MAX);
+    Point max(POINT_MIN, POINT_MIN);
+    BatchGeometry::includeInBoundingBox(points, min, max);
+    AABB expected;
+    for (const Point& point : points)
+    {
+        expected.include(point);
+    }
+    EXPECT_EQ(min, expected.min);
+    EXPECT_EQ(max, expected.max);
+
+    const std::vector<Point> nothing;
+    BatchGeometry::includeInBoundingBox(nothing, min, max);
+    EXPECT_EQ(min, expected.min) << "Including no points must leave the bounding box as it is.";
+    EXPECT_EQ(max, expected.max) << "Including no points must leave the bounding box as it is.";
+}
+
+TEST_F(BatchGeometryTest, Dist2ToLineSegmentSameAsLinearAlg2D)
+{
+    const std::vector<std::pair<Point, Point>> segments = {{Point(0, 0), Point(10000, 3000)}, {Point(5000, 5000), Point(5000, 5000)}, {Point(20000, -1000), Point(-300, 30000)}};
+    for (const std::pair<Point, Point>& segment : segments)
+    {
+        std::vector<coord_t> dist2;
+        BatchGeometry::getDist2ToLineSegment(points, segment.first, segment.second, dist2);
+        ASSERT_EQ(dist2.size(), points.size());
+        for (size_t point_idx = 0; point_idx < points.size(); point_idx++)
+        {
+            const Point closest = LinearAlg2D::getClosestOnLineSegment(points[point_idx], segment.first, segment.second);
+            ASSERT_EQ(dist2[point_idx], vSize2(points[point_idx] - closest)) << "Distance of " << points[point_idx] << " to " << segment.first << " - " << segment.second << ".";
+        }
+    }
+}
+
+TEST_F(BatchGeometryTest, FindClosestSameAsLineSegments)
+{
+    for (ConstPolygonRef polygon : shape)
+    {
+        for (const Point& from : points)
+        {
+            //The search through all line segments, in the same way as PolygonUtils::findClosest with a penalty function.
+            Point expected = polygon[0];
+            size_t expected_idx = 0;
+            for (size_t point_idx = 0; point_idx < polygon.size(); point_idx++)
+            {
+                const Point closest_here = LinearAlg2D::getClosestOnLineSegment(from, polygon[point_idx], polygon[(point_idx + 1) % polygon.size()]);
+                if (vSize2(from - closest_here) < vSize2(from - expected))
+                {
+                    expected = closest_here;
+                    expected_idx = point_idx;
+                }
+            }
+
+            Point result;
+            const size_t result_idx = BatchGeometry::findClosestOnPolygon(from, *polygon, result);
+            ASSERT_EQ(result, expected) << "Closest point to " << from << ".";
+            ASSERT_EQ(result_idx, expected_idx) << "Line segment closest to " << from << ".";
+        }
+    }
+}
+
+TEST_F(BatchGeometryTest, FindClosestSingleVertex)
+{
+    const std::vector<Point> polygon = {Point(100, 200)};
+    Point result;
+    EXPECT_EQ(BatchGeometry::findClosestOnPolygon(Point(0, 0), polygon, result), 0);
+    EXPECT_EQ(result, Point(100, 200));
+}
+
+} //namespace cura
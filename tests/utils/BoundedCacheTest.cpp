@@ -0,0 +1,70 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+#include "../src/utils/BoundedCache.h" //The class under test.
+
+namespace cura
+{
+
+using StringCache = BoundedCache<std::string, std::shared_ptr<int>>;
+
+/*!
+ * Find the value of a string in the cache, by a hash that only looks at its
+ * length, so that different strings can have the same hash.
+ */
+std::shared_ptr<int> findString(const StringCache& cache, const std::string& string)
+{
+    return cache.find(string.size(), [&string](const std::string& key)
+    {
+        return key == string;
+    });
+}
+
+TEST(BoundedCacheTest, FindInserted)
+{
+    StringCache cache(4);
+    EXPECT_EQ(findString(cache, "abc"), nullptr) << "Nothing was inserted yet.";
+
+    const std::shared_ptr<int> value = std::make_shared<int>(1);
+    cache.insert(3, "abc", value);
+    EXPECT_EQ(findString(cache, "abc"), value);
+    EXPECT_EQ(findString(cache, "xyz"), nullptr) << "The hash is the same, but the key isn't.";
+    EXPECT_EQ(findString(cache, "abcd"), nullptr);
+}
+
+/*!
+ * When the cache is full, exactly the entry that was added first is forgotten,
+ * even if other entries have the same hash or the same key.
+ */
+TEST(BoundedCacheTest, ForgetsExactlyTheOldestEntry)
+{
+    StringCache cache(2);
+    const std::shared_ptr<int> oldest = std::make_shared<int>(1);
+    const std::shared_ptr<int> newer = std::make_shared<int>(2);
+    cache.insert(3, "abc", oldest); //Inserted twice, e.g. by two threads that computed the same value at once.
+    cache.insert(3, "abc", newer);
+    cache.insert(3, "xyz", std::make_shared<int>(3));
+
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_EQ(findString(cache, "abc"), newer) << "Only the oldest entry may be forgotten, not the newer one with the same hash and key.";
+    EXPECT_NE(findString(cache, "xyz"), nullptr);
+
+    cache.insert(4, "abcd", std::make_shared<int>(4));
+    EXPECT_EQ(findString(cache, "abc"), nullptr) << "Now the other entry with this key is the oldest.";
+    EXPECT_NE(findString(cache, "xyz"), nullptr);
+    EXPECT_NE(findString(cache, "abcd"), nullptr);
+}
+
+TEST(BoundedCacheTest, ZeroCapacity)
+{
+    StringCache cache(0);
+    cache.insert(3, "abc", std::make_shared<int>(1));
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_EQ(findString(cache, "abc"), nullptr);
+}
+
+} //namespace cura
@@ -0,0 +1,77 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/utils/BoxGrid.h" //The class under test.
+
+namespace cura
+{
+
+class BoxGridTest : public testing::Test
+{
+public:
+    std::vector<AABB> boxes;
+    std::vector<AABB> query_boxes;
+
+    void SetUp()
+    {
+        //A field of small boxes with some overlap, a few large ones and a single point.
+        for (coord_t x = 0; x < 100000; x += 7000)
+        {
+            for (coord_t y = 0; y < 50000; y += 9000)
+            {
+                boxes.emplace_back(Point(x, y), Point(x + 8000, y + 3000));
+            }
+        }
+        boxes.emplace_back(Point(-20000, -20000), Point(120000, 2000));
+        boxes.emplace_back(Point(30000, -5000), Point(31000, 70000));
+        boxes.emplace_back(Point(44444, 22222), Point(44444, 22222));
+
+        for (coord_t x = -30000; x < 130000; x += 3700)
+        {
+            for (coord_t y = -30000; y < 80000; y += 4100)
+            {
+                query_boxes.emplace_back(Point(x, y), Point(x + 2500, y + 1700));
+            }
+        }
+        query_boxes.emplace_back(Point(44444, 22222), Point(44444, 22222)); //Touches the single point.
+        query_boxes.emplace_back(Point(-1000000, -1000000), Point(1000000, 1000000)); //Everything.
+        query_boxes.emplace_back(Point(500000, 500000), Point(600000, 600000)); //Nothing.
+        query_boxes.emplace_back(); //Empty.
+    }
+};
+
+TEST_F(BoxGridTest, SameAsAllBoxes)
+{
+    const BoxGrid grid(boxes);
+    ASSERT_EQ(grid.size(), boxes.size());
+    for (const AABB& query : query_boxes)
+    {
+        std::vector<size_t> expected;
+        for (size_t box_idx = 0; box_idx < boxes.size(); box_idx++)
+        {
+            if (boxes[box_idx].hit(query))
+            {
+                expected.push_back(box_idx);
+            }
+        }
+        EXPECT_EQ(grid.getOverlapping(query), expected) << "Checking the box from " << query.min << " to " << query.max << ".";
+    }
+}
+
+TEST_F(BoxGridTest, Empty)
+{
+    const BoxGrid nothing;
+    EXPECT_EQ(nothing.size(), 0);
+    const BoxGrid from_nothing(std::vector<AABB>{});
+    EXPECT_EQ(from_nothing.size(), 0);
+    for (const AABB& query : query_boxes)
+    {
+        EXPECT_TRUE(nothing.getOverlapping(query).empty());
+        EXPECT_TRUE(from_nothing.getOverlapping(query).empty());
+    }
+}
+
+} //namespace cura
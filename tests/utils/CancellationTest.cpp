@@ -0,0 +1,89 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <atomic>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/GcodeLayerThreader.h" //Stops claiming layers when cancelled.
+#include "../src/utils/algorithm.h" //For parallel_for, which skips the rest of the loop when cancelled.
+#include "../src/utils/Cancellation.h" //The class under test.
+
+namespace cura
+{
+
+class CancellationTest : public testing::Test
+{
+public:
+    void TearDown()
+    {
+        Cancellation::reset(); //Don't cancel the tests that run after this.
+    }
+};
+
+TEST_F(CancellationTest, RequestAndReset)
+{
+    Cancellation::reset();
+    EXPECT_FALSE(Cancellation::isRequested());
+    Cancellation::request();
+    EXPECT_TRUE(Cancellation::isRequested());
+    Cancellation::request();
+    EXPECT_TRUE(Cancellation::isRequested()) << "Requesting it twice is the same as once.";
+    Cancellation::reset();
+    EXPECT_FALSE(Cancellation::isRequested());
+}
+
+TEST_F(CancellationTest, ParallelForSkipsRemainingIndices)
+{
+    Cancellation::reset();
+    std::atomic<size_t> call_count(0);
+    parallel_for<size_t>(0, 10, 1, [&call_count](const size_t)
+    {
+        call_count++;
+    });
+    EXPECT_EQ(call_count, 10) << "Without cancelling, the body is called for every index.";
+
+    Cancellation::request();
+    call_count = 0;
+    parallel_for<size_t>(0, 10, 1, [&call_count](const size_t)
+    {
+        call_count++;
+    });
+    EXPECT_EQ(call_count, 0) << "After cancelling, nothing is computed any more, but the loop still returns.";
+}
+
+TEST_F(CancellationTest, ThreaderConsumesClaimedItemsInOrder)
+{
+    Cancellation::reset();
+    constexpr int item_count = 1000;
+    constexpr int cancel_at = 10;
+    std::atomic<int> produced_count(0);
+    std::vector<int> consumed;
+    const std::function<int* (int)> produce = [&produced_count](int item_nr)
+    {
+        if (item_nr == cancel_at)
+        {
+            Cancellation::request();
+        }
+        produced_count++;
+        return new int(item_nr);
+    };
+    const std::function<void (int*)> consume = [&consumed](int* item)
+    {
+        consumed.push_back(*item);
+        delete item;
+    };
+    constexpr unsigned int max_task_count = 4;
+    GcodeLayerThreader<int> threader(0, item_count, produce, consume, max_task_count);
+    threader.run();
+
+    EXPECT_LT(consumed.size(), static_cast<size_t>(item_count)) << "It stops soon after cancelling.";
+    EXPECT_GT(consumed.size(), static_cast<size_t>(cancel_at)) << "The item that cancelled was claimed, so it's consumed too.";
+    EXPECT_EQ(consumed.size(), static_cast<size_t>(produced_count)) << "Every item that was produced is consumed, so none leak.";
+    for (size_t item_idx = 0; item_idx < consumed.size(); item_idx++)
+    {
+        EXPECT_EQ(consumed[item_idx], static_cast<int>(item_idx)) << "The items are still consumed in order.";
+    }
+}
+
+} //namespace cura
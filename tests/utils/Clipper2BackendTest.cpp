@@ -0,0 +1,182 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For std::max.
+#include <cmath> //For std::abs and std::hypot.
+#include <string>
+
+#include <gtest/gtest.h>
+#include <polyclipping/clipper.hpp>
+
+#include "../src/utils/Clipper2Backend.h" //The class under test.
+#include "../ReadTestPolygons.h"
+
+namespace cura
+{
+
+/*!
+ * Compares the results of the Clipper2 backend to the results of ClipperLib,
+ * on the test polygons in the resources folder.
+ */
+class Clipper2BackendTest : public testing::TestWithParam<std::string>
+{
+public:
+    std::vector<ClipperLib::Paths> shapes;
+
+    void SetUp() override
+    {
+        std::vector<Polygons> polygons;
+        ASSERT_TRUE(readTestPolygons(GetParam(), polygons)) << "Couldn't read test polygons from " << GetParam();
+        for (const Polygons& shape : polygons)
+        {
+            shapes.emplace_back();
+            for (ConstPolygonRef polygon : shape)
+            {
+                shapes.back().emplace_back(polygon.begin(), polygon.end());
+            }
+        }
+    }
+
+    static double area(const ClipperLib::Paths& paths)
+    {
+        double result = 0;
+        for (const ClipperLib::Path& path : paths)
+        {
+            result += ClipperLib::Area(path);
+        }
+        return result;
+    }
+
+    static ClipperLib::Paths clip(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip, const ClipperLib::ClipType clip_type)
+    {
+        ClipperLib::Clipper clipper;
+        clipper.AddPaths(subject, ClipperLib::ptSubject, true);
+        clipper.AddPaths(clip, ClipperLib::ptClip, true);
+        ClipperLib::Paths result;
+        clipper.Execute(clip_type, result);
+        return result;
+    }
+
+    static ClipperLib::Paths offset(const ClipperLib::Paths& paths, const double distance, const ClipperLib::JoinType join_type)
+    {
+        ClipperLib::ClipperOffset clipper;
+        clipper.ArcTolerance = 10.0;
+        clipper.AddPaths(paths, join_type, ClipperLib::etClosedPolygon);
+        ClipperLib::Paths result;
+        clipper.Execute(result, distance);
+        return result;
+    }
+
+    /*!
+     * Check that two areas cover nearly the same region, allowing for rounding
+     * differences along their edges.
+     */
+    static void expectSameArea(const ClipperLib::Paths& expected, const ClipperLib::Paths& actual, const std::string& operation)
+    {
+        const double expected_area = area(expected);
+        const double tolerance = std::max(100.0, std::abs(expected_area) * 0.001);
+        EXPECT_NEAR(area(actual), expected_area, tolerance) << operation << " must produce the same area as ClipperLib.";
+        EXPECT_NEAR(area(clip(expected, actual, ClipperLib::ctXor)), 0.0, tolerance) << operation << " must cover the same region as ClipperLib.";
+    }
+};
+
+TEST_P(Clipper2BackendTest, BooleanOperations)
+{
+    for (const ClipperLib::Paths& shape : shapes)
+    {
+        const ClipperLib::Paths shifted = offset(shape, -200, ClipperLib::jtMiter);
+        ClipperLib::Paths moved = shape;
+        for (ClipperLib::Path& path : moved)
+        {
+            for (ClipperLib::IntPoint& point : path)
+            {
+                point.X += 1000;
+                point.Y += 500;
+            }
+        }
+
+        expectSameArea(clip(shape, shifted, ClipperLib::ctDifference), clipper2::difference(shape, shifted), "Difference");
+        expectSameArea(clip(shape, moved, ClipperLib::ctDifference), clipper2::difference(shape, moved), "Difference");
+        expectSameArea(clip(shape, moved, ClipperLib::ctIntersection), clipper2::intersection(shape, moved), "Intersection");
+
+        ClipperLib::Clipper clipper;
+        clipper.AddPaths(shape, ClipperLib::ptSubject, true);
+        clipper.AddPaths(moved, ClipperLib::ptSubject, true);
+        ClipperLib::Paths expected_union;
+        clipper.Execute(ClipperLib::ctUnion, expected_union, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+        expectSameArea(expected_union, clipper2::unionPaths(shape, moved, ClipperLib::pftNonZero), "Union");
+    }
+}
+
+TEST_P(Clipper2BackendTest, Offset)
+{
+    for (const ClipperLib::Paths& shape : shapes)
+    {
+        for (const double distance : { -400.0, -50.0, 50.0, 400.0 })
+        {
+            for (const ClipperLib::JoinType join_type : { ClipperLib::jtMiter, ClipperLib::jtSquare, ClipperLib::jtRound })
+            {
+                const std::string operation = "Offset by " + std::to_string(distance) + " with join type " + std::to_string(join_type);
+                expectSameArea(offset(shape, distance, join_type), clipper2::offset(shape, distance, join_type, 2.0, 10.0), operation);
+            }
+        }
+    }
+}
+
+TEST_P(Clipper2BackendTest, IntersectionOpenPaths)
+{
+    for (const ClipperLib::Paths& shape : shapes)
+    {
+        //Lines through the bounding box of the shape, to cut with the shape.
+        ClipperLib::Clipper bounds_clipper;
+        bounds_clipper.AddPaths(shape, ClipperLib::ptSubject, true);
+        const ClipperLib::IntRect bounds = bounds_clipper.GetBounds();
+        ClipperLib::Paths lines;
+        constexpr ClipperLib::cInt line_count = 20;
+        for (ClipperLib::cInt line_idx = 0; line_idx <= line_count; line_idx++)
+        {
+            const ClipperLib::cInt y = bounds.top + (bounds.bottom - bounds.top) * line_idx / line_count;
+            lines.push_back({ ClipperLib::IntPoint(bounds.left - 100, y), ClipperLib::IntPoint(bounds.right + 100, y + 50) });
+        }
+
+        ClipperLib::Clipper clipper;
+        clipper.AddPaths(lines, ClipperLib::ptSubject, false);
+        clipper.AddPaths(shape, ClipperLib::ptClip, true);
+        ClipperLib::PolyTree tree;
+        clipper.Execute(ClipperLib::ctIntersection, tree);
+        ClipperLib::Paths expected;
+        ClipperLib::OpenPathsFromPolyTree(tree, expected);
+
+        const ClipperLib::Paths actual = clipper2::intersectionOpenPaths(lines, shape);
+        const auto total_length = [](const ClipperLib::Paths& paths)
+        {
+            double length = 0;
+            for (const ClipperLib::Path& path : paths)
+            {
+                for (size_t point_idx = 1; point_idx < path.size(); point_idx++)
+                {
+                    length += std::hypot(path[point_idx].X - path[point_idx - 1].X, path[point_idx].Y - path[point_idx - 1].Y);
+                }
+            }
+            return length;
+        };
+        EXPECT_NEAR(total_length(actual), total_length(expected), 2.0 * (line_count + 1)) << "The lines must be cut in the same places as ClipperLib does.";
+    }
+}
+
+const std::vector<std::string> polygon_filenames =
+{
+    "resources/polygon_concave.txt",
+    "resources/polygon_concave_hole.txt",
+    "resources/polygon_square.txt",
+    "resources/polygon_square_hole.txt",
+    "resources/polygon_triangle.txt",
+    "resources/polygon_two_squares.txt",
+    "resources/polygon_slant_gap.txt",
+    "resources/polygon_sawtooth.txt",
+    "resources/polygon_letter_y.txt"
+};
+
+INSTANTIATE_TEST_CASE_P(Clipper2BackendTestInstantiation, Clipper2BackendTest, testing::ValuesIn(polygon_filenames));
+
+} //namespace cura
@@ -0,0 +1,94 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/utils/CompactPolygons.h"
+
+namespace cura
+{
+
+/*!
+ * Fixture with a square with a triangular hole, and a separate square far
+ * away, to compact.
+ */
+class CompactPolygonsTest : public testing::Test
+{
+public:
+    Polygons polygons;
+
+    void SetUp() override
+    {
+        PolygonRef outer = polygons.newPoly();
+        outer.emplace_back(-10000, -10000);
+        outer.emplace_back(10000, -10000);
+        outer.emplace_back(10000, 10000);
+        outer.emplace_back(-10000, 10000);
+        PolygonRef hole = polygons.newPoly();
+        hole.emplace_back(0, 0);
+        hole.emplace_back(-1000, 5000);
+        hole.emplace_back(1000, 5000);
+        PolygonRef far = polygons.newPoly();
+        far.emplace_back(1000000, 2000000);
+        far.emplace_back(1000100, 2000000);
+        far.emplace_back(1000100, 2000100);
+        far.emplace_back(1000000, 2000100);
+    }
+};
+
+TEST_F(CompactPolygonsTest, RoundTrip)
+{
+    CompactPolygons compact;
+    ASSERT_TRUE(compact.compact(polygons)) << "These polygons fit in the compact representation.";
+    EXPECT_EQ(compact.size(), polygons.size());
+
+    const Polygons expanded = compact.expand();
+    ASSERT_EQ(expanded.size(), polygons.size());
+    for (size_t poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+    {
+        ASSERT_EQ(expanded[poly_idx].size(), polygons[poly_idx].size());
+        for (size_t point_idx = 0; point_idx < polygons[poly_idx].size(); point_idx++)
+        {
+            EXPECT_EQ(expanded[poly_idx][point_idx], polygons[poly_idx][point_idx]) << "The vertices must be restored exactly.";
+        }
+    }
+}
+
+TEST_F(CompactPolygonsTest, IsSame)
+{
+    CompactPolygons compact;
+    ASSERT_TRUE(compact.compact(polygons));
+    EXPECT_TRUE(compact.isSame(polygons));
+
+    Polygons moved = polygons;
+    moved[1][2].X += 1;
+    EXPECT_FALSE(compact.isSame(moved)) << "One vertex is different.";
+
+    Polygons fewer = polygons;
+    fewer.remove(2);
+    EXPECT_FALSE(compact.isSame(fewer)) << "There is one polygon less.";
+
+    Polygons reordered = polygons;
+    reordered[0].pop_back();
+    reordered[1].emplace_back(-10000, 10000);
+    EXPECT_FALSE(compact.isSame(reordered)) << "The vertices are the same, but divided over the polygons differently.";
+}
+
+TEST_F(CompactPolygonsTest, TooFarApartIsNotCompacted)
+{
+    polygons[0][0] = Point(-5000000000, 0); //Further than 32 bits away from the other vertices.
+
+    CompactPolygons compact;
+    EXPECT_FALSE(compact.compact(polygons));
+    EXPECT_TRUE(compact.empty()) << "If the polygons don't fit, nothing may be stored.";
+}
+
+TEST_F(CompactPolygonsTest, Empty)
+{
+    CompactPolygons compact;
+    EXPECT_TRUE(compact.compact(Polygons()));
+    EXPECT_TRUE(compact.empty());
+    EXPECT_TRUE(compact.expand().empty());
+}
+
+} //namespace cura
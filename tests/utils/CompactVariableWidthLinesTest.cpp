@@ -0,0 +1,129 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <memory_resource>
+
+#include "../src/utils/CompactVariableWidthLines.h"
+
+namespace cura
+{
+
+/*!
+ * Fixture with a set of wall toolpaths to compact: a closed outer wall, and an
+ * odd inner wall with variable width.
+ */
+class CompactVariableWidthLinesTest : public testing::Test
+{
+public:
+    std::vector<VariableWidthLines> toolpaths;
+
+    void SetUp() override
+    {
+        toolpaths.resize(2);
+        ExtrusionLine outer(0, false);
+        outer.is_closed = true;
+        outer.junctions = { ExtrusionJunction(Point(-10000, -10000), 400, 0), ExtrusionJunction(Point(10000, -10000), 400, 0), ExtrusionJunction(Point(10000, 10000), 400, 0), ExtrusionJunction(Point(-10000, 10000), 400, 0) };
+        toolpaths[0].push_back(outer);
+        ExtrusionLine inner(1, true);
+        inner.junctions = { ExtrusionJunction(Point(-5000, 0), 300, 1), ExtrusionJunction(Point(0, 123), 517, 1), ExtrusionJunction(Point(5000, 0), 0, 1) };
+        toolpaths[1].push_back(inner);
+        toolpaths[1].emplace_back(1, false); //An empty line.
+    }
+};
+
+TEST_F(CompactVariableWidthLinesTest, RoundTrip)
+{
+    CompactVariableWidthLines compact;
+    ASSERT_TRUE(compact.compact(toolpaths)) << "These toolpaths fit in the compact representation.";
+    EXPECT_EQ(compact.size(), toolpaths.size());
+
+    const std::vector<VariableWidthLines> expanded = compact.expand();
+    ASSERT_EQ(expanded.size(), toolpaths.size());
+    for (size_t inset_idx = 0; inset_idx < toolpaths.size(); inset_idx++)
+    {
+        ASSERT_EQ(expanded[inset_idx].size(), toolpaths[inset_idx].size());
+        for (size_t line_idx = 0; line_idx < toolpaths[inset_idx].size(); line_idx++)
+        {
+            const ExtrusionLine& original = toolpaths[inset_idx][line_idx];
+            const ExtrusionLine& result = expanded[inset_idx][line_idx];
+            EXPECT_EQ(result.inset_idx, original.inset_idx);
+            EXPECT_EQ(result.is_odd, original.is_odd);
+            EXPECT_EQ(result.is_closed, original.is_closed);
+            EXPECT_EQ(result.junctions, original.junctions) << "The junctions must be restored exactly.";
+        }
+    }
+}
+
+TEST_F(CompactVariableWidthLinesTest, TooWideIsNotCompacted)
+{
+    toolpaths[1][0].junctions[1].w = 100000; //Doesn't fit in 16 bits.
+
+    CompactVariableWidthLines compact;
+    EXPECT_FALSE(compact.compact(toolpaths));
+    EXPECT_TRUE(compact.empty()) << "If the toolpaths don't fit, nothing may be stored.";
+}
+
+TEST_F(CompactVariableWidthLinesTest, TooFarApartIsNotCompacted)
+{
+    toolpaths[0][0].junctions[0].p = Point(-5000000000, 0); //Further than 32 bits away from the other junctions.
+
+    CompactVariableWidthLines compact;
+    EXPECT_FALSE(compact.compact(toolpaths));
+    EXPECT_TRUE(compact.empty()) << "If the toolpaths don't fit, nothing may be stored.";
+}
+
+TEST_F(CompactVariableWidthLinesTest, Empty)
+{
+    CompactVariableWidthLines compact;
+    EXPECT_TRUE(compact.compact({}));
+    EXPECT_TRUE(compact.empty());
+    EXPECT_TRUE(compact.expand().empty());
+}
+
+TEST_F(CompactVariableWidthLinesTest, AllocatesFromMemoryResource)
+{
+    char buffer[1024];
+    std::pmr::monotonic_buffer_resource memory(buffer, sizeof(buffer), std::pmr::null_memory_resource()); //Throws if anything is allocated beyond the buffer.
+
+    CompactVariableWidthLines compact(&memory);
+    ASSERT_TRUE(compact.compact(toolpaths));
+    EXPECT_GT(compact.getMemoryUsage(), size_t(0));
+    const std::vector<VariableWidthLines> expanded = compact.expand();
+    ASSERT_EQ(expanded.size(), toolpaths.size());
+    EXPECT_EQ(expanded[1][0].junctions, toolpaths[1][0].junctions);
+
+    compact.clear();
+    EXPECT_TRUE(compact.compact(toolpaths)) << "After clearing, the arrays must still be allocated from the same memory resource.";
+
+    std::pmr::monotonic_buffer_resource no_memory(std::pmr::null_memory_resource());
+    CompactVariableWidthLines without_memory(&no_memory);
+    EXPECT_THROW(without_memory.compact(toolpaths), std::bad_alloc) << "The arrays must be allocated from the given memory resource, not from the heap.";
+}
+
+TEST_F(CompactVariableWidthLinesTest, SerializeRoundTrip)
+{
+    CompactVariableWidthLines compact;
+    ASSERT_TRUE(compact.compact(toolpaths));
+    std::vector<char> buffer;
+    compact.serialize(buffer);
+
+    CompactVariableWidthLines restored;
+    ASSERT_TRUE(restored.deserialize(buffer.data(), buffer.size()));
+    const std::vector<VariableWidthLines> expanded = restored.expand();
+    ASSERT_EQ(expanded.size(), toolpaths.size());
+    for (size_t inset_idx = 0; inset_idx < toolpaths.size(); inset_idx++)
+    {
+        ASSERT_EQ(expanded[inset_idx].size(), toolpaths[inset_idx].size());
+        for (size_t line_idx = 0; line_idx < toolpaths[inset_idx].size(); line_idx++)
+        {
+            EXPECT_EQ(expanded[inset_idx][line_idx].is_closed, toolpaths[inset_idx][line_idx].is_closed);
+            EXPECT_EQ(expanded[inset_idx][line_idx].junctions, toolpaths[inset_idx][line_idx].junctions);
+        }
+    }
+
+    EXPECT_FALSE(restored.deserialize(buffer.data(), buffer.size() - 1)) << "Data of the wrong length must be rejected.";
+    EXPECT_TRUE(restored.empty());
+}
+
+} //namespace cura
@@ -0,0 +1,125 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/utils/AABB.h"
+#include "../src/utils/IndexedPolygons.h" //The class under test.
+#include "../src/utils/polygonUtils.h" //To compare with the queries on all line segments.
+#include "../StressShapes.h" //To get polygons with many vertices and holes.
+
+namespace cura
+{
+
+class IndexedPolygonsTest : public testing::Test
+{
+public:
+    Polygons shape;
+    std::vector<Point> query_points;
+
+    void SetUp()
+    {
+        StressShapeParameters parameters;
+        parameters.part_count = 4;
+        parameters.nesting_depth = 3;
+        parameters.vertices_per_loop = 50;
+        parameters.part_radius = 5000;
+        shape = makeStressPolygons(parameters);
+
+        //The shape with a margin around it, in a step that doesn't line up with the vertices.
+        AABB box(shape);
+        box.expand(3000);
+        for (coord_t x = box.min.X; x <= box.max.X; x += 317)
+        {
+            for (coord_t y = box.min.Y; y <= box.max.Y; y += 293)
+            {
+                query_points.emplace_back(x, y);
+            }
+        }
+    }
+};
+
+TEST_F(IndexedPolygonsTest, FindClosestSameAsPolygonUtils)
+{
+    const IndexedPolygons index(shape);
+    for (const Point& query : query_points)
+    {
+        const ClosestPolygonPoint expected = PolygonUtils::findClosest(query, shape);
+        const ClosestPolygonPoint result = index.findClosest(query);
+        ASSERT_EQ(result.location, expected.location) << "Closest point to " << query << ".";
+        ASSERT_EQ(result.poly_idx, expected.poly_idx) << "Polygon of the closest point to " << query << ".";
+        ASSERT_EQ(result.point_idx, expected.point_idx) << "Line segment of the closest point to " << query << ".";
+    }
+}
+
+TEST_F(IndexedPolygonsTest, MoveInsideSameAsPolygonUtils)
+{
+    const IndexedPolygons index(shape);
+    for (const int distance : {0, 100, -100, 2000})
+    {
+        for (const int64_t max_dist2 : {std::numeric_limits<int64_t>::max(), int64_t(500 * 500)})
+        {
+            for (const Point& query : query_points)
+            {
+                Point expected = query;
+                const unsigned int expected_poly_idx = PolygonUtils::moveInside(shape, expected, distance, max_dist2);
+                Point result = query;
+                const unsigned int result_poly_idx = index.moveInside(result, distance, max_dist2);
+                ASSERT_EQ(result, expected) << "Moving " << query << " inside by " << distance << ".";
+                ASSERT_EQ(result_poly_idx, expected_poly_idx) << "Polygon that " << query << " was moved inside of by " << distance << ".";
+            }
+        }
+    }
+}
+
+TEST_F(IndexedPolygonsTest, ExistingGrid)
+{
+    const std::unique_ptr<LocToLineGrid> loc_to_line = PolygonUtils::createLocToLineGrid(shape, 400);
+    const IndexedPolygons index(shape, *loc_to_line);
+    for (const Point& query : query_points)
+    {
+        Point expected = query;
+        const unsigned int expected_poly_idx = PolygonUtils::moveInside(shape, expected, 100);
+        Point result = query;
+        const unsigned int result_poly_idx = index.moveInside(result, 100);
+        ASSERT_EQ(result, expected) << "Moving " << query << " inside.";
+        ASSERT_EQ(result_poly_idx, expected_poly_idx) << "Polygon that " << query << " was moved inside of.";
+        ASSERT_EQ(index.findClosest(query).location, PolygonUtils::findClosest(query, shape).location) << "Closest point to " << query << ".";
+    }
+}
+
+TEST_F(IndexedPolygonsTest, FewVertices)
+{
+    Polygon square;
+    square.emplace_back(0, 0);
+    square.emplace_back(1000, 0);
+    square.emplace_back(1000, 1000);
+    square.emplace_back(0, 1000);
+    Polygons small;
+    small.add(square);
+    const IndexedPolygons index(small);
+    for (const Point& query : query_points)
+    {
+        Point expected = query;
+        PolygonUtils::moveInside(small, expected, 100);
+        Point result = query;
+        index.moveInside(result, 100);
+        ASSERT_EQ(result, expected) << "Moving " << query << " inside.";
+    }
+}
+
+TEST_F(IndexedPolygonsTest, Empty)
+{
+    const Polygons empty;
+    const IndexedPolygons index(empty);
+    for (size_t query_idx = 0; query_idx < 20; query_idx++) //More than enough queries to otherwise build a grid.
+    {
+        Point point(100, 100);
+        EXPECT_EQ(index.moveInside(point, 10), NO_INDEX);
+        EXPECT_EQ(point, Point(100, 100));
+        EXPECT_FALSE(index.findClosest(point).isValid());
+    }
+}
+
+} //namespace cura
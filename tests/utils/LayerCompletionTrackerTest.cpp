@@ -0,0 +1,49 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "../src/utils/LayerCompletionTracker.h"
+
+namespace cura
+{
+
+TEST(LayerCompletionTrackerTest, CompleteAfterAllItems)
+{
+    LayerCompletionTracker tracker({ 2, 0, 1 });
+    EXPECT_TRUE(tracker.isComplete(1, 1)) << "A layer without items is complete from the start.";
+    EXPECT_FALSE(tracker.isComplete(0, 2));
+
+    EXPECT_FALSE(tracker.finishItem(0)) << "Layer 0 still has another item.";
+    EXPECT_TRUE(tracker.finishItem(0)) << "That was the last item of layer 0.";
+    EXPECT_FALSE(tracker.isComplete(0, 0)) << "The layer is only complete once it's marked as such.";
+    tracker.complete(0);
+    EXPECT_TRUE(tracker.isComplete(0, 1));
+    EXPECT_FALSE(tracker.isComplete(0, 2));
+
+    EXPECT_TRUE(tracker.finishItem(2));
+    tracker.complete(2);
+    EXPECT_TRUE(tracker.isComplete(0, 2));
+    EXPECT_TRUE(tracker.isComplete(1, 100)) << "Layers past the end are ignored.";
+}
+
+TEST(LayerCompletionTrackerTest, WaitForOtherThread)
+{
+    LayerCompletionTracker tracker({ 1, 1 });
+    std::thread worker([&tracker]()
+    {
+        for (size_t layer_nr = 0; layer_nr < 2; layer_nr++)
+        {
+            if (tracker.finishItem(layer_nr))
+            {
+                tracker.complete(layer_nr);
+            }
+        }
+    });
+    tracker.waitUntilComplete(0, 1);
+    EXPECT_TRUE(tracker.isComplete(0, 1));
+    worker.join();
+}
+
+} //namespace cura
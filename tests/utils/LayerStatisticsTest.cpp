@@ -0,0 +1,59 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cstdio> //For std::remove.
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/utils/LayerStatistics.h" //The class under test.
+#include "../src/utils/Trace.h" //Zones about a layer also record their time.
+
+namespace cura
+{
+
+/*!
+ * Add to counters on several threads, including raft layers, and check that
+ * the file has a column per counter and a row per layer with the sums.
+ */
+TEST(LayerStatisticsTest, WritesCountersOfAllThreads)
+{
+    const std::string filename = "layer_statistics_test.csv";
+    LayerStatistics::start();
+    ASSERT_TRUE(LayerStatistics::isEnabled());
+    LayerStatistics::add("paths", 0, 10);
+    LayerStatistics::add("paths", 2, 5);
+    std::thread other_thread([]()
+    {
+        LayerStatistics::add("paths", 0, 3);
+        LayerStatistics::add("combing fallbacks", -1, 1); //A raft layer.
+        TraceZone zone("write layer", 2);
+    });
+    other_thread.join();
+    ASSERT_TRUE(LayerStatistics::write(filename)) << "The statistics file must be written.";
+
+    std::ifstream file(filename);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        lines.push_back(line);
+    }
+    ASSERT_EQ(lines.size(), 4) << "A heading, and a row for each of the layers -1, 0 and 2. Layer 1 has no counters.";
+    EXPECT_EQ(lines[0], "layer,combing fallbacks,paths,write layer time (s)") << "The counters must be sorted, with the times at the end.";
+    EXPECT_EQ(lines[1], "-1,1,0,0");
+    EXPECT_EQ(lines[2], "0,0,13,0") << "The counters of both threads must be added up.";
+    EXPECT_EQ(lines[3].find("2,0,5,"), 0) << "The time of the zone is recorded for layer 2.";
+
+    //Writing forgets the counters.
+    ASSERT_TRUE(LayerStatistics::write(filename));
+    std::ifstream empty_file(filename);
+    std::getline(empty_file, line);
+    EXPECT_EQ(line, "layer");
+    EXPECT_FALSE(std::getline(empty_file, line)) << "Counters that were written before must not be written again.";
+    std::remove(filename.c_str());
+}
+
+} //namespace cura
@@ -0,0 +1,112 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <atomic>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/utils/logoutput.h" //The logging under test.
+
+namespace cura
+{
+
+/*!
+ * Log from several threads at once, more than fits in the buffers of the
+ * threads, and check that every message is written once, whole, and in the
+ * order in which its thread logged it.
+ */
+TEST(LogOutputTest, WritesAllMessagesOfAllThreads)
+{
+    constexpr int thread_count = 8;
+    constexpr int message_count = 5000;
+
+    flushLog(); //Don't capture what other tests logged.
+    testing::internal::CaptureStderr();
+    #pragma omp parallel for num_threads(thread_count)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int thread_nr = 0; thread_nr < thread_count; thread_nr++)
+    {
+        for (int message_nr = 0; message_nr < message_count; message_nr++)
+        {
+            logAlways("Thread %i logs message %i.\n", thread_nr, message_nr);
+        }
+    }
+    logWarning("Done.\n");
+    flushLog();
+    const std::string output = testing::internal::GetCapturedStderr();
+
+    std::vector<int> next_message(thread_count, 0);
+    std::istringstream lines(output);
+    std::string line;
+    size_t line_count = 0;
+    while (std::getline(lines, line))
+    {
+        line_count++;
+        if (line == "[WARNING] Done.")
+        {
+            EXPECT_EQ(line_count, thread_count * message_count + 1) << "The warning was logged last, so it must be written last.";
+            continue;
+        }
+        int thread_nr = -1;
+        int message_nr = -1;
+        ASSERT_EQ(sscanf(line.c_str(), "Thread %i logs message %i.", &thread_nr, &message_nr), 2) << "Messages must be written whole, not \"" << line << "\".";
+        ASSERT_GE(thread_nr, 0);
+        ASSERT_LT(thread_nr, thread_count);
+        EXPECT_EQ(message_nr, next_message[thread_nr]) << "The messages of each thread must be written in order, once.";
+        next_message[thread_nr] = message_nr + 1;
+    }
+    EXPECT_EQ(line_count, thread_count * message_count + 1);
+    for (int thread_nr = 0; thread_nr < thread_count; thread_nr++)
+    {
+        EXPECT_EQ(next_message[thread_nr], message_count) << "All messages of thread " << thread_nr << " must be written.";
+    }
+}
+
+/*!
+ * Two threads take turns logging, each only after the other logged. Their
+ * messages must be written in the order in which they were logged, even
+ * though they come from different threads.
+ */
+TEST(LogOutputTest, WritesMessagesOfThreadsInOrder)
+{
+    constexpr int turn_count = 2000;
+
+    flushLog(); //Don't capture what other tests logged.
+    testing::internal::CaptureStderr();
+    std::atomic<int> turn(0);
+    auto take_turns = [&turn](const int first_turn)
+    {
+        for (int turn_nr = first_turn; turn_nr < turn_count; turn_nr += 2)
+        {
+            while (turn.load() != turn_nr)
+            {
+                std::this_thread::yield();
+            }
+            logAlways("Turn %i.\n", turn_nr);
+            turn.store(turn_nr + 1);
+        }
+    };
+    std::thread even_turns(take_turns, 0);
+    std::thread odd_turns(take_turns, 1);
+    even_turns.join();
+    odd_turns.join();
+    flushLog();
+    const std::string output = testing::internal::GetCapturedStderr();
+
+    std::istringstream lines(output);
+    std::string line;
+    int next_turn = 0;
+    while (std::getline(lines, line))
+    {
+        int turn_nr = -1;
+        ASSERT_EQ(sscanf(line.c_str(), "Turn %i.", &turn_nr), 1) << "Messages must be written whole, not \"" << line << "\".";
+        ASSERT_EQ(turn_nr, next_turn) << "Each message was logged after the one before it, so it must be written after it.";
+        next_turn++;
+    }
+    EXPECT_EQ(next_turn, turn_count);
+}
+
+} //namespace cura
@@ -141,4 +141,55 @@ namespace cura
             EXPECT_EQ(should_be_leave[i_pt], has(pts[i_pt], leaves)) << "Leaf-'status' of point #" << i_pt << " (start @0) should be the expected one.";
         }
     }
+
+    /*!
+     * Sum the lengths of the edges of a spanning tree.
+     */
+    double totalLength(const MinimumSpanningTree& tree)
+    {
+        double total = 0;
+        for (const Point& vertex : tree.vertices())
+        {
+            for (const Point& neighbour : tree.adjacentNodes(vertex))
+            {
+                total += vSizeMM(vertex - neighbour);
+            }
+        }
+        return total / 2; //Every edge was counted from both ends.
+    }
+
+    TEST(SimpleMinimumSpanningTreeTest, SameLengthAsPrim)
+    {
+        //Scattered points, including duplicates and points in a line, which are degenerate for the Delaunay triangulation.
+        std::vector<Point> vertices;
+        unsigned int seed = 12345;
+        for (size_t i = 0; i < 500; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            const coord_t x = (seed >> 8) % 100000;
+            seed = seed * 1103515245 + 12345;
+            const coord_t y = (seed >> 8) % 100000;
+            vertices.emplace_back(x, y);
+        }
+        vertices.push_back(vertices[10]);
+        for (coord_t x = 0; x < 10; x++)
+        {
+            vertices.emplace_back(x * 1000, -5000);
+        }
+
+        const MinimumSpanningTree tree(vertices);
+        EXPECT_EQ(tree.vertices().size(), vertices.size() - 1) << "All vertices must be in the tree, except the duplicate.";
+        size_t edge_ends = 0;
+        for (const Point& vertex : tree.vertices())
+        {
+            edge_ends += tree.adjacentNodes(vertex).size();
+        }
+        EXPECT_EQ(edge_ends / 2, vertices.size() - 2) << "A tree over all vertices has one edge less than there are vertices.";
+
+        MinimumSpanningTree reference;
+        std::vector<Point> unique_vertices(vertices.begin(), vertices.end() - 11);
+        unique_vertices.insert(unique_vertices.end(), vertices.end() - 10, vertices.end());
+        reference.adjacency_graph = reference.prim(unique_vertices);
+        EXPECT_NEAR(totalLength(tree), totalLength(reference), 0.001) << "The tree must be as short as the one found by Prim's algorithm.";
+    }
 }
@@ -0,0 +1,114 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <atomic>
+#include <gtest/gtest.h>
+
+#include "../src/utils/ParallelSchedule.h" //The class under test.
+
+namespace cura
+{
+
+/*!
+ * Check that the chunks of a plan cover all items exactly once.
+ */
+void expectAllItemsOnce(const ParallelSchedule::Plan& plan, const size_t item_count)
+{
+    std::vector<size_t> times_covered(item_count, 0);
+    for (const ParallelSchedule::Chunk& chunk : plan.chunks)
+    {
+        EXPECT_LT(chunk.begin, chunk.end) << "Chunks must not be empty.";
+        for (size_t item_idx = chunk.begin; item_idx < chunk.end && item_idx < item_count; item_idx++)
+        {
+            times_covered[item_idx]++;
+        }
+    }
+    for (size_t item_idx = 0; item_idx < item_count; item_idx++)
+    {
+        EXPECT_EQ(times_covered[item_idx], 1) << "Item " << item_idx << " must be in exactly one chunk.";
+    }
+}
+
+/*!
+ * Items of equal cost are divided in chunks of about equal numbers of items,
+ * in order.
+ */
+TEST(ParallelScheduleTest, EqualCostsGiveEqualChunks)
+{
+    const std::vector<size_t> costs(1000, 10);
+    const ParallelSchedule::Plan plan = ParallelSchedule::makePlan(costs, 4, 0.0);
+    EXPECT_EQ(plan.thread_count, 4) << "Without knowing how long the stage takes, all threads are used.";
+    EXPECT_FALSE(plan.is_balanced);
+    EXPECT_EQ(plan.chunks.size(), 4 * ParallelSchedule::chunks_per_thread);
+    expectAllItemsOnce(plan, costs.size());
+    for (size_t chunk_idx = 1; chunk_idx < plan.chunks.size(); chunk_idx++)
+    {
+        EXPECT_EQ(plan.chunks[chunk_idx].begin, plan.chunks[chunk_idx - 1].end) << "The chunks must be handed out in order.";
+    }
+}
+
+/*!
+ * A giant item gets a chunk of its own, which is handed out first.
+ */
+TEST(ParallelScheduleTest, GiantItemFirst)
+{
+    std::vector<size_t> costs(100, 10);
+    costs[70] = 100000;
+    const ParallelSchedule::Plan plan = ParallelSchedule::makePlan(costs, 4, 0.0);
+    EXPECT_TRUE(plan.is_balanced) << "The costs are uneven, so the chunks must be balanced by cost.";
+    expectAllItemsOnce(plan, costs.size());
+    ASSERT_FALSE(plan.chunks.empty());
+    EXPECT_EQ(plan.chunks[0].begin, 70) << "The giant item must be handed out first.";
+    EXPECT_EQ(plan.chunks[0].end, 71) << "The giant item must be on its own.";
+    for (size_t chunk_idx = 1; chunk_idx < plan.chunks.size(); chunk_idx++)
+    {
+        EXPECT_GE(plan.chunks[chunk_idx - 1].cost, plan.chunks[chunk_idx].cost) << "The most expensive chunks must be handed out first.";
+    }
+}
+
+/*!
+ * A stage that is known to be cheap uses fewer threads.
+ */
+TEST(ParallelScheduleTest, CheapStageUsesFewerThreads)
+{
+    const std::vector<size_t> costs(100, 9); //1000 units of cost in total.
+    const ParallelSchedule::Plan cheap = ParallelSchedule::makePlan(costs, 8, 1e-9);
+    EXPECT_EQ(cheap.thread_count, 1) << "A microsecond of work isn't worth a second thread.";
+    ASSERT_EQ(cheap.chunks.size(), 1);
+    expectAllItemsOnce(cheap, costs.size());
+
+    const ParallelSchedule::Plan moderate = ParallelSchedule::makePlan(costs, 8, ParallelSchedule::min_seconds_per_thread * 3 / 1000);
+    EXPECT_EQ(moderate.thread_count, 3) << "Each thread must get at least the minimum amount of work.";
+
+    const ParallelSchedule::Plan expensive = ParallelSchedule::makePlan(costs, 8, 1.0);
+    EXPECT_EQ(expensive.thread_count, 8) << "Expensive stages use all threads.";
+}
+
+/*!
+ * Running a schedule processes each item once and remembers how long the
+ * stage took for the next time.
+ */
+TEST(ParallelScheduleTest, RunProcessesAllItems)
+{
+    std::vector<size_t> costs(257);
+    for (size_t item_idx = 0; item_idx < costs.size(); item_idx++)
+    {
+        costs[item_idx] = item_idx * item_idx;
+    }
+    std::vector<std::atomic<int>> times_processed(costs.size());
+    ParallelSchedule("test stage", costs).run([&times_processed](const size_t item_idx)
+    {
+        times_processed[item_idx]++;
+    });
+    for (size_t item_idx = 0; item_idx < costs.size(); item_idx++)
+    {
+        EXPECT_EQ(times_processed[item_idx], 1) << "Item " << item_idx << " must be processed once.";
+    }
+    EXPECT_GT(ParallelSchedule::getSecondsPerCost("test stage"), 0.0) << "The time per unit of cost must be remembered.";
+    EXPECT_EQ(ParallelSchedule::getSecondsPerCost("other stage"), 0.0) << "Stages that didn't run yet are unknown.";
+
+    ParallelSchedule empty("empty stage", {});
+    empty.run([](const size_t) { FAIL() << "There are no items to process."; });
+}
+
+} //namespace cura
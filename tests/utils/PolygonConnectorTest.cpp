@@ -175,4 +175,36 @@ TEST_F(PolygonConnectorTest, connectFourNested)
     EXPECT_EQ(output_polygons.size(), 1) << "All four polygons should've gotten connected into 1 single polygon.";
 }
 
+/*!
+ * Connect many nested squares, and a square far away from them.
+ *
+ * Only the polygons that are close together should get connected.
+ */
+TEST_F(PolygonConnectorTest, connectManyNestedAndFarAway)
+{
+    Polygons connecting;
+    for(coord_t inset = 0; inset < 2000; inset += 100) //20 nested squares, precisely one line width apart.
+    {
+        Polygon square;
+        square.emplace_back(inset, inset);
+        square.emplace_back(5000 - inset, inset);
+        square.emplace_back(5000 - inset, 5000 - inset);
+        square.emplace_back(inset, 5000 - inset);
+        connecting.add(square);
+    }
+    Polygon far_away;
+    far_away.emplace_back(100000, 0);
+    far_away.emplace_back(101000, 0);
+    far_away.emplace_back(101000, 1000);
+    far_away.emplace_back(100000, 1000);
+    connecting.add(far_away);
+
+    pc->add(connecting);
+    Polygons output_polygons;
+    std::vector<VariableWidthLines> output_paths;
+    pc->connect(output_polygons, output_paths);
+
+    EXPECT_EQ(output_polygons.size(), 2) << "The nested squares should've gotten connected into 1 polygon, but not to the square far away.";
+}
+
 }
@@ -92,6 +92,24 @@ TEST_F(PolygonTest, polygonOffsetTest)
     ASSERT_NEAR(expanded_length, contracted_length, 5) << "Offset on outside poly is different from offset on inverted poly!";
 }
 
+TEST_F(PolygonTest, offsetMultiSameAsOffsetTest)
+{
+    Polygons polygons;
+    polygons.add(pointy_square);
+    polygons.add(triangle);
+    const std::vector<coord_t> distances = {-20, 0, 10, 25, 100};
+
+    const std::vector<Polygons> results = polygons.offsetMulti(distances, ClipperLib::jtRound);
+
+    ASSERT_EQ(results.size(), distances.size()) << "There should be a result for every distance.";
+    for (size_t distance_idx = 0; distance_idx < distances.size(); distance_idx++)
+    {
+        const Polygons expected = polygons.offset(distances[distance_idx], ClipperLib::jtRound);
+        EXPECT_EQ(results[distance_idx].area(), expected.area()) << "Offsetting by " << distances[distance_idx] << " should give the same area as a single offset.";
+        EXPECT_EQ(results[distance_idx].xorPolygons(expected).area(), 0) << "Offsetting by " << distances[distance_idx] << " should give the same result as a single offset.";
+    }
+}
+
 TEST_F(PolygonTest, polygonOffsetBugTest)
 {
     Polygons polys;
@@ -216,6 +234,171 @@ TEST_F(PolygonTest, getEmptyHolesTest)
     }
 }
 
+TEST_F(PolygonTest, differenceBoundedFarAwayTest)
+{
+    Polygons subject;
+    subject.add(test_square);
+    Polygons far_away;
+    far_away.add(test_square);
+    far_away.translate(Point(1000, 1000));
+
+    const Polygons result = subject.differenceBounded(far_away);
+
+    ASSERT_EQ(result.size(), 1) << "Subtracting an area that's far away shouldn't change anything.";
+    EXPECT_EQ(result.area(), subject.area());
+}
+
+TEST_F(PolygonTest, differenceBoundedSameAsDifferenceTest)
+{
+    Polygons subject = clockwise_donut;
+    Polygons far_away;
+    far_away.add(test_square);
+    far_away.translate(Point(1000, 1000));
+    subject.add(far_away); //Two separate parts, of which only the donut overlaps with the clip area.
+    Polygons clip;
+    clip.add(triangle);
+    clip.add(pointy_square.offset(-10)[0]);
+
+    const Polygons bounded = subject.differenceBounded(clip);
+    const Polygons expected = subject.difference(clip);
+
+    EXPECT_EQ(bounded.area(), expected.area()) << "The bounded difference should cover the same area as the normal difference.";
+    EXPECT_EQ(bounded.xorPolygons(expected).area(), 0) << "The bounded difference should cover exactly the same area as the normal difference.";
+}
+
+TEST_F(PolygonTest, intersectionBoundedSameAsIntersectionTest)
+{
+    Polygons a = clockwise_donut;
+    Polygons far_away;
+    far_away.add(test_square);
+    far_away.translate(Point(1000, 1000));
+    a.add(far_away);
+    Polygons b;
+    b.add(triangle);
+    b.add(pointy_square);
+
+    const Polygons bounded = a.intersectionBounded(b);
+    const Polygons expected = a.intersection(b);
+
+    EXPECT_EQ(bounded.area(), expected.area()) << "The bounded intersection should cover the same area as the normal intersection.";
+    EXPECT_EQ(bounded.xorPolygons(expected).area(), 0) << "The bounded intersection should cover exactly the same area as the normal intersection.";
+}
+
+TEST_F(PolygonTest, intersectionBoundedFarAwayTest)
+{
+    Polygons a;
+    a.add(test_square);
+    Polygons b;
+    b.add(test_square);
+    b.translate(Point(1000, 1000));
+
+    EXPECT_TRUE(a.intersectionBounded(b).empty()) << "Areas that are far apart don't intersect.";
+}
+
+TEST_F(PolygonTest, inPlaceSameAsCopyTest)
+{
+    Polygons a = clockwise_donut;
+    a.add(triangle);
+    Polygons b;
+    b.add(pointy_square);
+
+    const auto expect_same = [](const Polygons& actual, const Polygons& expected, const std::string& operation)
+    {
+        EXPECT_EQ(actual.area(), expected.area()) << operation << " in place should cover the same area as a copy.";
+        EXPECT_EQ(actual.xorPolygons(expected).area(), 0) << operation << " in place should cover exactly the same area as a copy.";
+    };
+
+    Polygons difference = a;
+    difference.differenceInPlace(b);
+    expect_same(difference, a.difference(b), "Difference");
+
+    Polygons intersection = a;
+    intersection.intersectionInPlace(b);
+    expect_same(intersection, a.intersection(b), "Intersection");
+
+    Polygons united = a;
+    united.unionPolygonsInPlace(b);
+    expect_same(united, a.unionPolygons(b), "Union");
+
+    Polygons offset = a;
+    offset.offsetInPlace(-10).offsetInPlace(25, ClipperLib::jtRound);
+    expect_same(offset, a.offset(-10).offset(25, ClipperLib::jtRound), "Offset");
+
+    Polygons self = a;
+    self.differenceInPlace(self);
+    EXPECT_EQ(self.area(), 0) << "Subtracting an area from itself in place should leave nothing.";
+}
+
+TEST_F(PolygonTest, rvalueSameAsCopyTest)
+{
+    Polygons a = clockwise_donut;
+    a.add(triangle);
+    Polygons b;
+    b.add(pointy_square);
+
+    const Polygons expected = a.offset(15).difference(b);
+    Polygons moved = a;
+    const Polygons actual = std::move(moved).offset(15).difference(b);
+
+    EXPECT_EQ(actual.area(), expected.area()) << "Operations on temporaries should give the same area as on copies.";
+    EXPECT_EQ(actual.xorPolygons(expected).area(), 0) << "Operations on temporaries should give exactly the same result as on copies.";
+}
+
+TEST_F(PolygonTest, addMovedPolygonsTest)
+{
+    Polygons a;
+    a.add(test_square);
+    Polygons b;
+    b.add(triangle);
+    b.add(pointy_square);
+
+    a.add(std::move(b));
+
+    ASSERT_EQ(a.size(), 3) << "All polygons of the moved set should be added.";
+    EXPECT_EQ(a[1].size(), triangle.size()) << "The polygons should be added in order.";
+    EXPECT_TRUE(b.empty()) << "The moved set should be left empty.";
+}
+
+TEST_F(PolygonTest, removeDegenerateVertsAndSmallAreasTest)
+{
+    Polygons polygons;
+    PolygonRef spiked = polygons.newPoly(); //A large square with a spike that goes out and back along the same line.
+    spiked.add(Point(0, 0));
+    spiked.add(Point(5000, 0));
+    spiked.add(Point(5000, -3000));
+    spiked.add(Point(5000, 0));
+    spiked.add(Point(10000, 0));
+    spiked.add(Point(10000, 10000));
+    spiked.add(Point(0, 10000));
+    PolygonRef back_and_forth = polygons.newPoly(); //No area at all.
+    back_and_forth.add(Point(0, 0));
+    back_and_forth.add(Point(1000, 0));
+    back_and_forth.add(Point(2000, 0));
+    back_and_forth.add(Point(1000, 0));
+    PolygonRef small_hole = polygons.newPoly(); //In the large square, so it is kept.
+    small_hole.add(Point(2000, 2000));
+    small_hole.add(Point(2000, 2100));
+    small_hole.add(Point(2100, 2100));
+    small_hole.add(Point(2100, 2000));
+    PolygonRef small_island = polygons.newPoly();
+    small_island.add(Point(20000, 0));
+    small_island.add(Point(20100, 0));
+    small_island.add(Point(20100, 100));
+    small_island.add(Point(20000, 100));
+
+    constexpr double min_area = 0.1; //mm^2.
+    Polygons separate = polygons;
+    separate.removeDegenerateVerts();
+    separate.removeSmallAreas(min_area);
+    polygons.removeDegenerateVertsAndSmallAreas(min_area);
+
+    ASSERT_EQ(polygons.size(), 2) << "The degenerate polygon and the small island must be removed, but not the small hole.";
+    ASSERT_EQ(polygons.size(), separate.size()) << "Removing both in one pass must give the same result as in separate passes.";
+    EXPECT_EQ(polygons[0].size(), 5) << "The spike must be removed from the large square.";
+    EXPECT_EQ(*polygons[0], *separate[0]);
+    EXPECT_EQ(*polygons[1], *separate[1]);
+}
+
 /*
  * The convex hull of a cube should still be a cube
  */
@@ -350,4 +533,45 @@ TEST_F(PolygonTest, convexHullRemoveDuplicatePoints)
     EXPECT_EQ(d[3], Point(0, 10));
 }
 
+/*
+ * Offsetting into parts should give the same area as offsetting, with the
+ * polygons of each part together: first its outline and then its holes.
+ */
+TEST_F(PolygonTest, offsetIntoPartsTest)
+{
+    Polygons polygons;
+    PolygonRef outline = polygons.newPoly();
+    outline.add(Point(0, 0));
+    outline.add(Point(1000, 0));
+    outline.add(Point(1000, 1000));
+    outline.add(Point(0, 1000));
+    PolygonRef hole = polygons.newPoly();
+    hole.add(Point(200, 200));
+    hole.add(Point(200, 800));
+    hole.add(Point(800, 800));
+    hole.add(Point(800, 200));
+    PolygonRef island = polygons.newPoly(); //Inside the hole.
+    island.add(Point(400, 400));
+    island.add(Point(600, 400));
+    island.add(Point(600, 600));
+    island.add(Point(400, 600));
+
+    std::vector<size_t> part_starts;
+    const Polygons result = polygons.offsetIntoParts(20, part_starts);
+
+    EXPECT_EQ(result.size(), 3);
+    ASSERT_EQ(part_starts.size(), 2);
+    EXPECT_NEAR(result.area(), polygons.offset(20).area(), 1.0);
+    for (size_t part_idx = 0; part_idx < part_starts.size(); part_idx++)
+    {
+        const size_t part_end = (part_idx + 1 < part_starts.size()) ? part_starts[part_idx + 1] : result.size();
+        EXPECT_TRUE(result[part_starts[part_idx]].orientation()) << "Each part must start with its outline.";
+        for (size_t poly_idx = part_starts[part_idx] + 1; poly_idx < part_end; poly_idx++)
+        {
+            EXPECT_FALSE(result[poly_idx].orientation()) << "The outline of a part must be followed by its holes.";
+        }
+    }
+    EXPECT_EQ(part_starts[1] - part_starts[0], 2) << "The outer part has one hole, with the island after it.";
+}
+
 }
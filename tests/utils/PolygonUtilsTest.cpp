@@ -472,6 +472,55 @@ TEST_F(PolygonUtilsTest, RelativeHammingLineLineDisjunct)
     ASSERT_EQ(PolygonUtils::relativeHammingDistance(test_line, test_line), 1.0);
 }
 
+TEST_F(PolygonUtilsTest, ApproximateRelativeHammingQuarterOverlap)
+{
+    Polygons shifted_polys = test_squares; //Make a copy.
+    shifted_polys[0].translate(Point(50, 50));
+
+    EXPECT_NEAR(PolygonUtils::approximateRelativeHammingDistance(test_squares, test_squares, 10), 0.0, 1e-9);
+    EXPECT_NEAR(PolygonUtils::approximateRelativeHammingDistance(test_squares, shifted_polys, 10), 0.75, 0.01);
+}
+
+TEST_F(PolygonUtilsTest, ApproximateRelativeHammingCircles)
+{
+    Polygons circle_a;
+    circle_a.add(PolygonUtils::makeCircle(Point(0, 0), 10000, M_PI / 64));
+    Polygons circle_b;
+    circle_b.add(PolygonUtils::makeCircle(Point(3000, 1000), 9000, M_PI / 64));
+
+    const double exact = PolygonUtils::relativeHammingDistance(circle_a, circle_b);
+    constexpr coord_t resolution = 100;
+    const double max_error = resolution * (circle_a.polygonLength() + circle_b.polygonLength()) / (circle_a.area() + circle_b.area());
+    EXPECT_NEAR(PolygonUtils::approximateRelativeHammingDistance(circle_a, circle_b, resolution), exact, max_error);
+}
+
+TEST_F(PolygonUtilsTest, ApproximateRelativeHammingStopsEarly)
+{
+    Polygons shifted_polys = test_squares; //Make a copy.
+    shifted_polys[0].translate(Point(200, 0));
+
+    //Completely disjunct, so the estimate ends up above the threshold even if it stops early.
+    EXPECT_GT(PolygonUtils::approximateRelativeHammingDistance(test_squares, shifted_polys, 1, 0.1), 0.1);
+    EXPECT_NEAR(PolygonUtils::approximateRelativeHammingDistance(test_squares, shifted_polys, 1), 1.0, 1e-9);
+}
+
+TEST_F(PolygonUtilsTest, UnionByCellSameAsUnion)
+{
+    Polygons circles;
+    for (coord_t x = -5000; x <= 5000; x += 700) //Also with negative coordinates, which are in different cells.
+    {
+        for (coord_t y = -3000; y <= 3000; y += 900)
+        {
+            circles.add(PolygonUtils::makeCircle(Point(x, y), 600));
+        }
+    }
+
+    const Polygons expected = circles.unionPolygons();
+    const Polygons result = PolygonUtils::unionByCell(circles, 2000);
+    EXPECT_NEAR(result.area(), expected.area(), 1);
+    EXPECT_NEAR(PolygonUtils::relativeHammingDistance(result, expected), 0.0, 1e-6);
+}
+
 TEST_F(PolygonUtilsTest, DISABLED_RelativeHammingLineLineDifferentVerts) //Disabled because this fails due to a bug in Clipper of testing points inside a line-polygon.
 {
     ASSERT_EQ(PolygonUtils::relativeHammingDistance(test_line, test_line_extra_vertices), 0.0) << "Even though the exact vertices are different, the actual outline is the same.";
@@ -0,0 +1,113 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/utils/AABB.h"
+#include "../src/utils/PreparedPolygons.h" //The class under test.
+#include "../StressShapes.h" //To get polygons with many vertices and holes.
+
+namespace cura
+{
+
+class PreparedPolygonsTest : public testing::Test
+{
+public:
+    Polygons shape;
+    std::vector<Point> query_points;
+
+    void SetUp()
+    {
+        StressShapeParameters parameters;
+        parameters.part_count = 4;
+        parameters.nesting_depth = 3;
+        parameters.vertices_per_loop = 50;
+        parameters.part_radius = 5000;
+        shape = makeStressPolygons(parameters);
+
+        //A long, thin triangle that spans many bands, overlapping the parts.
+        Polygon sliver;
+        sliver.emplace_back(-1000, -1000);
+        sliver.emplace_back(40000, 40000);
+        sliver.emplace_back(-900, -1000);
+        shape.add(sliver);
+
+        //A rectangle with horizontal edges and collinear vertices, to test the borders.
+        Polygon rectangle;
+        rectangle.emplace_back(0, 0);
+        rectangle.emplace_back(1000, 0);
+        rectangle.emplace_back(2000, 0);
+        rectangle.emplace_back(2000, 1000);
+        rectangle.emplace_back(0, 1000);
+        shape.add(rectangle);
+
+        AABB box(shape);
+        box.expand(3000);
+        for (coord_t x = box.min.X; x <= box.max.X; x += 317)
+        {
+            for (coord_t y = box.min.Y; y <= box.max.Y; y += 293)
+            {
+                query_points.emplace_back(x, y);
+            }
+        }
+        //All vertices and the middle of all edges are on the border.
+        for (ConstPolygonRef polygon : shape)
+        {
+            Point previous = polygon.back();
+            for (const Point& vertex : polygon)
+            {
+                query_points.push_back(vertex);
+                query_points.push_back((previous + vertex) / 2);
+                previous = vertex;
+            }
+        }
+        query_points.emplace_back(500, 0);
+        query_points.emplace_back(500, 1000);
+        query_points.emplace_back(3000, 0); //In line with a horizontal edge, but outside.
+    }
+};
+
+TEST_F(PreparedPolygonsTest, SameAsPolygons)
+{
+    const PreparedPolygons prepared(shape);
+    for (const bool border_result : {false, true})
+    {
+        for (const Point& query : query_points)
+        {
+            EXPECT_EQ(prepared.inside(query, border_result), shape.inside(query, border_result)) << "Checking " << query << " with border result " << border_result << ".";
+        }
+    }
+}
+
+TEST_F(PreparedPolygonsTest, BatchSameAsSingle)
+{
+    const PreparedPolygons prepared(shape);
+    for (const bool border_result : {false, true})
+    {
+        const std::vector<bool> result = prepared.inside(query_points, border_result);
+        ASSERT_EQ(result.size(), query_points.size());
+        for (size_t point_idx = 0; point_idx < query_points.size(); point_idx++)
+        {
+            EXPECT_EQ(result[point_idx], prepared.inside(query_points[point_idx], border_result)) << "Checking " << query_points[point_idx] << " in a batch.";
+        }
+    }
+}
+
+TEST_F(PreparedPolygonsTest, Empty)
+{
+    const PreparedPolygons nothing;
+    EXPECT_TRUE(nothing.empty());
+    EXPECT_FALSE(nothing.inside(Point(0, 0), true));
+
+    Polygons degenerate; //Polygons with fewer than 3 vertices don't contain anything.
+    Polygon line;
+    line.emplace_back(0, 0);
+    line.emplace_back(1000, 1000);
+    degenerate.add(line);
+    const PreparedPolygons prepared(degenerate);
+    EXPECT_TRUE(prepared.empty());
+    EXPECT_EQ(prepared.inside(query_points, true), std::vector<bool>(query_points.size(), false));
+}
+
+} //namespace cura
@@ -0,0 +1,64 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cstdio> //For std::remove.
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+
+#include "../src/utils/polygon.h"
+#include "../src/utils/SVG.h" //The class under test.
+
+namespace cura
+{
+
+/*!
+ * All elements are in the file once the image is destroyed, in the order in
+ * which they were drawn, even when there are more than fit in one block of the
+ * output file.
+ */
+TEST(SVGTest, WritesAllElements)
+{
+    const std::string filename = "svg_test.svg";
+    constexpr size_t line_count = 20000;
+    {
+        SVG svg(filename, AABB(Point(0, 0), Point(1000, 1000)));
+        for (size_t line_idx = 0; line_idx < line_count; line_idx++)
+        {
+            svg.writeLine(Point(0, line_idx % 1000), Point(1000, line_idx % 1000));
+        }
+        svg.writeComment(std::string(2000, 'x')); //Longer than the formatting buffer.
+    }
+
+    std::ifstream file(filename);
+    ASSERT_TRUE(file.good()) << "The image must have been written.";
+    std::stringstream contents;
+    contents << file.rdbuf();
+    file.close();
+    std::remove(filename.c_str());
+    const std::string text = contents.str();
+
+    size_t found_lines = 0;
+    for (size_t position = text.find("<line "); position != std::string::npos; position = text.find("<line ", position + 1))
+    {
+        found_lines++;
+    }
+    EXPECT_EQ(found_lines, line_count);
+    EXPECT_NE(text.find("<!-- " + std::string(2000, 'x') + " -->"), std::string::npos) << "Long texts must be written completely.";
+    EXPECT_EQ(text.substr(text.size() - 7), "</svg>\n") << "The image must be closed.";
+}
+
+TEST(SVGTest, LayerFilename)
+{
+    EXPECT_EQ(SVG::getLayerFilename("walls", 12), "walls_layer12.svg");
+    EXPECT_EQ(SVG::getLayerFilename("raft", -2), "raft_layer-2.svg");
+}
+
+TEST(SVGTest, UnopenedFileDrawsNothing)
+{
+    SVG svg("/nonexistent_directory/svg_test.svg", AABB(Point(0, 0), Point(1000, 1000)));
+    svg.writeLine(Point(0, 0), Point(1000, 1000)); //Must not crash.
+    svg.nextLayer();
+}
+
+} //namespace cura
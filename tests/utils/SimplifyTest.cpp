@@ -381,4 +381,54 @@ TEST_F(SimplifyTest, ToDegenerate)
     EXPECT_EQ(segment.size(), 2) << "The segment did not get simplified because that would reduce its vertices to less than 2, making it degenerate.";
 }
 
+/*!
+ * Tests that simplifying a batch gives the same result as simplifying every
+ * polygon by itself, also if the batch is big enough to be done in parallel.
+ */
+TEST_F(SimplifyTest, BatchSameAsSeparate)
+{
+    Polygons polygons;
+    Polygons polylines;
+    for(size_t copy = 0; copy < 200; ++copy) //Enough vertices to be divided in multiple batches.
+    {
+        polygons.add(circle);
+        polygons.add(square_collinear);
+        polylines.add(sine);
+        polylines.add(spiral);
+        polylines.add(zigzag);
+    }
+
+    const Polygons simplified_polygons = simplifier.polygon(polygons);
+    ASSERT_EQ(simplified_polygons.size(), polygons.size());
+    for(size_t i = 0; i < polygons.size(); ++i)
+    {
+        Polygon separate = simplifier.polygon(Polygon(polygons[i]));
+        EXPECT_EQ(*simplified_polygons[i], *separate) << "Polygon " << i << " should be simplified the same in a batch.";
+    }
+
+    const Polygons simplified_polylines = simplifier.polyline(polylines);
+    ASSERT_EQ(simplified_polylines.size(), polylines.size());
+    for(size_t i = 0; i < polylines.size(); ++i)
+    {
+        Polygon separate = simplifier.polyline(Polygon(polylines[i]));
+        EXPECT_EQ(*simplified_polylines[i], *separate) << "Polyline " << i << " should be simplified the same in a batch.";
+    }
+}
+
+/*!
+ * Tests that simplifying polygons in place with reused buffers gives the same
+ * result as simplifying copies of them, whatever was simplified before.
+ */
+TEST_F(SimplifyTest, InPlaceSameAsCopy)
+{
+    Simplify::Scratch scratch;
+    for(const Polygon& polygon : { circle, square_collinear, circle })
+    {
+        Polygon expected = simplifier.polygon(polygon);
+        Polygon working = polygon;
+        Polygon simplified = simplifier.polygon(std::move(working), scratch);
+        EXPECT_EQ(*simplified, *expected) << "Reusing the buffers must not change the result.";
+    }
+}
+
 }
\ No newline at end of file
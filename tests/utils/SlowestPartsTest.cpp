@@ -0,0 +1,70 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "../src/utils/SlowestParts.h" //The class under test.
+
+namespace cura
+{
+
+/*!
+ * Record parts on several threads, and check that only the slowest of all
+ * threads are reported, slowest first.
+ */
+TEST(SlowestPartsTest, ReportsSlowestOfAllThreads)
+{
+    constexpr size_t count = 3;
+    SlowestParts::start(count);
+    ASSERT_TRUE(SlowestParts::isEnabled());
+
+    Polygons square;
+    square.add(Polygon());
+    square.back().add(Point(0, 0));
+    square.back().add(Point(1000, 0));
+    square.back().add(Point(1000, 1000));
+    square.back().add(Point(0, 1000));
+
+    SlowestParts::record("walls", 0, "cube", 0, 1.0, &square);
+    SlowestParts::record("walls", 1, "cube", 0, 4.0, &square);
+    std::thread other_thread([&square]()
+    {
+        SlowestParts::record("walls", 2, "cube", 1, 2.0, nullptr);
+        SlowestParts::record("plan layer", 3, "", SlowestParts::no_part, 5.0, nullptr);
+        SlowestParts::record("walls", 4, "cube", 0, 0.5, &square);
+    });
+    other_thread.join();
+    SlowestParts::record("walls", 5, "cube", 0, 3.0, &square);
+
+    const std::vector<SlowestParts::Entry> slowest = SlowestParts::report();
+    ASSERT_EQ(slowest.size(), count) << "Only the requested number of parts are reported.";
+    EXPECT_EQ(slowest[0].layer_nr, 3) << "The slowest part is reported first, regardless of the thread.";
+    EXPECT_EQ(slowest[1].layer_nr, 1);
+    EXPECT_EQ(slowest[2].layer_nr, 5);
+    EXPECT_EQ(slowest[1].mesh_name, "cube");
+    EXPECT_EQ(slowest[0].part_nr, SlowestParts::no_part);
+    EXPECT_EQ(*slowest[1].outline[0], *square[0]) << "The outline of the part is kept to draw it.";
+    EXPECT_TRUE(slowest[0].outline.empty()) << "Without an outline, there is nothing to draw.";
+
+    EXPECT_TRUE(SlowestParts::report().empty()) << "Parts that were reported before must not be reported again.";
+}
+
+/*!
+ * A zone records the time of its scope.
+ */
+TEST(SlowestPartsTest, ZoneRecordsItsScope)
+{
+    SlowestParts::start(1);
+    {
+        PartZone zone("walls", 7, "cube", 2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const std::vector<SlowestParts::Entry> slowest = SlowestParts::report();
+    ASSERT_EQ(slowest.size(), 1);
+    EXPECT_EQ(slowest[0].layer_nr, 7);
+    EXPECT_EQ(slowest[0].part_nr, 2);
+    EXPECT_GE(slowest[0].seconds, 0.001) << "The zone lasted at least as long as the sleep in it.";
+}
+
+} //namespace cura
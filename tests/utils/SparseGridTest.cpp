@@ -6,6 +6,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include "../src/utils/GridMap.h"
 #include "../src/utils/SparseGrid.h"
 #include "../src/utils/SparsePointGridInclusive.h"
 
@@ -226,4 +227,83 @@ TEST_F(GetNearestTest, Equal)
             ") or " << expected2 << " (distance " << vSize(expected2 - target) << ").";
 }
 
+TEST(FlatGridMapTest, InsertionOrderPerCell)
+{
+    FlatGridMap<int> grid_map;
+    const SquareGrid::GridPoint cell(3, -2);
+    grid_map.emplace(cell, 1);
+    grid_map.emplace(SquareGrid::GridPoint(-2, 3), 2);
+    grid_map.emplace(cell, 3);
+    grid_map.emplace(cell, 4);
+
+    std::vector<int> found;
+    grid_map.processCell(cell, [&found](const int& elem) { found.push_back(elem); return true; });
+    EXPECT_EQ(found, std::vector<int>({ 1, 3, 4 })) << "The elements of a cell must be visited in the order in which they were inserted.";
+
+    found.clear();
+    grid_map.processCell(SquareGrid::GridPoint(0, 0), [&found](const int& elem) { found.push_back(elem); return true; });
+    EXPECT_TRUE(found.empty()) << "Nothing was inserted in this cell.";
+}
+
+TEST(FlatGridMapTest, SameAsUnorderedAfterGrowing)
+{
+    FlatGridMap<int> flat;
+    UnorderedGridMap<int> unordered;
+    constexpr int cells_per_side = 60; //Many more cells than the initial size of the hash table, so it must grow a few times.
+    int elem = 0;
+    for (int repeat = 0; repeat < 2; repeat++)
+    {
+        for (int x = -cells_per_side / 2; x < cells_per_side / 2; x++)
+        {
+            for (int y = -cells_per_side / 2; y < cells_per_side / 2; y += (x % 3) + 1)
+            {
+                flat.emplace(SquareGrid::GridPoint(x, y), elem);
+                unordered.emplace(SquareGrid::GridPoint(x, y), elem);
+                elem++;
+            }
+        }
+    }
+    ASSERT_EQ(flat.size(), unordered.size());
+
+    for (int x = -cells_per_side / 2 - 1; x <= cells_per_side / 2; x++)
+    {
+        for (int y = -cells_per_side / 2 - 1; y <= cells_per_side / 2; y++)
+        {
+            const SquareGrid::GridPoint cell(x, y);
+            std::vector<int> flat_found;
+            flat.processCell(cell, [&flat_found](const int& elem) { flat_found.push_back(elem); return true; });
+            std::vector<int> unordered_found;
+            unordered.processCell(cell, [&unordered_found](const int& elem) { unordered_found.push_back(elem); return true; });
+            std::sort(unordered_found.begin(), unordered_found.end()); //The flat map is already in insertion order.
+            EXPECT_EQ(flat_found, unordered_found) << "Cell " << cell << " must hold the same elements in both maps.";
+        }
+    }
+}
+
+TEST(SparsePointGridInclusiveTest, InsertAllSameAsInsert)
+{
+    constexpr coord_t grid_size = 10;
+    SparsePointGridInclusive<size_t> one_by_one(grid_size);
+    SparsePointGridInclusive<size_t> all_at_once(grid_size);
+    std::vector<typename SparsePointGridInclusive<size_t>::Elem> elems;
+    for (size_t i = 0; i < 500; i++)
+    {
+        const Point point((i * 37) % 211 - 100, (i * 53) % 197 - 100); //Spread out, with several points per cell.
+        one_by_one.insert(point, i);
+        elems.emplace_back(point, i);
+    }
+    all_at_once.insertAll(elems);
+    all_at_once.insert(Point(5, 5), 500); //Adding more after the bulk insertion must still work.
+    one_by_one.insert(Point(5, 5), 500);
+
+    for (coord_t x = -110; x <= 110; x += 7)
+    {
+        for (coord_t y = -110; y <= 110; y += 7)
+        {
+            const Point target(x, y);
+            EXPECT_EQ(one_by_one.getNearbyVals(target, grid_size), all_at_once.getNearbyVals(target, grid_size)) << "Both grids must find the same values, in the same order, near " << target << ".";
+        }
+    }
+}
+
 }
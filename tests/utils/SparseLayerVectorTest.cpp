@@ -0,0 +1,76 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/utils/SparseLayerVector.h" //The class under test.
+
+namespace cura
+{
+
+TEST(SparseLayerVectorTest, ReadingDoesNotAllocate)
+{
+    SparseLayerVector<std::vector<int>> layers;
+    layers.resize(100);
+    EXPECT_EQ(layers.size(), 100);
+    EXPECT_EQ(layers.allocatedCount(), 0);
+
+    const SparseLayerVector<std::vector<int>>& const_layers = layers;
+    EXPECT_TRUE(const_layers[50].empty());
+    EXPECT_FALSE(layers.isAllocated(50)) << "Reading through a const reference must not allocate.";
+
+    layers[50].push_back(3);
+    EXPECT_TRUE(layers.isAllocated(50));
+    EXPECT_EQ(layers.allocatedCount(), 1);
+    EXPECT_EQ(const_layers[50], std::vector<int>({3}));
+    EXPECT_TRUE(const_layers[49].empty()) << "Other layers must stay empty.";
+}
+
+TEST(SparseLayerVectorTest, ResizeKeepsLayers)
+{
+    SparseLayerVector<std::vector<int>> layers;
+    layers.resize(10);
+    layers[2].push_back(2);
+    layers[8].push_back(8);
+    layers.resize(5);
+    EXPECT_EQ(layers.size(), 5);
+    EXPECT_EQ(layers.allocatedCount(), 1);
+    layers.resize(20);
+    EXPECT_EQ(layers[2], std::vector<int>({2}));
+    EXPECT_FALSE(layers.isAllocated(8)) << "Layer 8 was deleted when shrinking, so it must be new when growing again.";
+}
+
+TEST(SparseLayerVectorTest, EraseFront)
+{
+    SparseLayerVector<std::vector<int>> layers;
+    layers.resize(10);
+    layers[1].push_back(1);
+    layers[4].push_back(4);
+    layers[9].push_back(9);
+    layers.eraseFront(3);
+    ASSERT_EQ(layers.size(), 7);
+    EXPECT_EQ(layers.allocatedCount(), 2);
+    EXPECT_EQ(layers[1], std::vector<int>({4}));
+    EXPECT_EQ(layers[6], std::vector<int>({9}));
+}
+
+TEST(SparseLayerVectorTest, ParallelAllocation)
+{
+    SparseLayerVector<std::vector<int>> layers;
+    layers.resize(64);
+    std::vector<std::vector<int>*> addresses(1000);
+#pragma omp parallel for
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int access_idx = 0; access_idx < static_cast<int>(addresses.size()); access_idx++)
+    {
+        addresses[access_idx] = &layers[access_idx % 64]; //Many threads get the same layers at once.
+    }
+    for (size_t access_idx = 0; access_idx < addresses.size(); access_idx++)
+    {
+        EXPECT_EQ(addresses[access_idx], &layers[access_idx % 64]) << "All threads must get the same layer.";
+    }
+    EXPECT_EQ(layers.allocatedCount(), 64);
+}
+
+} //namespace cura
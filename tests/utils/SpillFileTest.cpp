@@ -0,0 +1,46 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cstring> //For memcmp.
+#include <gtest/gtest.h>
+
+#include "../src/utils/SpillFile.h"
+
+namespace cura
+{
+
+TEST(SpillFileTest, WriteAndReadBack)
+{
+    SpillFile file(".");
+    ASSERT_TRUE(file.canWrite()) << "The scratch file must be created in the working directory.";
+
+    const std::vector<char> first = { 'a', 'b', 'c' };
+    std::vector<char> second(100000);
+    for (size_t i = 0; i < second.size(); i++)
+    {
+        second[i] = static_cast<char>(i * 7);
+    }
+    const std::optional<SpillFile::Block> first_block = file.write(first);
+    const std::optional<SpillFile::Block> second_block = file.write(second);
+    ASSERT_TRUE(first_block && second_block);
+    EXPECT_FALSE(file.canRead()) << "The blocks can't be read before writing is finished.";
+
+    file.finishWriting();
+    ASSERT_TRUE(file.canRead());
+    EXPECT_FALSE(file.write(first)) << "No more blocks can be written after writing is finished.";
+    ASSERT_EQ(first_block->size, first.size());
+    ASSERT_EQ(second_block->size, second.size());
+    EXPECT_EQ(std::memcmp(file.read(*first_block), first.data(), first.size()), 0);
+    EXPECT_EQ(std::memcmp(file.read(*second_block), second.data(), second.size()), 0);
+}
+
+TEST(SpillFileTest, MissingDirectory)
+{
+    SpillFile file("this_directory_does_not_exist");
+    EXPECT_FALSE(file.canWrite());
+    EXPECT_FALSE(file.write({ 'a' })) << "A file that couldn't be created can't be written to.";
+    file.finishWriting();
+    EXPECT_FALSE(file.canRead());
+}
+
+} //namespace cura
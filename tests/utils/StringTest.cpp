@@ -70,4 +70,60 @@ INSTANTIATE_TEST_CASE_P(WriteDoubleToStreamTestInstantiation, WriteDoubleToStrea
         testing::Values(-10.000, -1.000, -0.100, -0.010, -0.001, 0.010, 0.100, 1.000, 10.000, 123456.789, 0.00000001,
         std::numeric_limits<double>::min(), std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(), -std::numeric_limits<double>::lowest()));
 
+
+/*
+ * Test the exact characters that are written for a few coordinates, since the
+ * g-code must not change with the implementation.
+ */
+TEST(StringTest, WriteInt2mmExactFormat)
+{
+    const std::vector<std::pair<int32_t, std::string>> expectations = {
+        {0, "0"}, {1, "0.001"}, {-1, "-0.001"}, {10, "0.01"}, {-50, "-0.05"}, {100, "0.1"}, {-500, "-.5"}, {-120, "-.12"},
+        {1000, "1"}, {-1000, "-1"}, {1001, "1.001"}, {1500, "1.5"}, {-1500, "-1.5"}, {12345, "12.345"}, {100000, "100"}
+    };
+    for (const std::pair<int32_t, std::string>& expectation : expectations)
+    {
+        std::ostringstream ss;
+        writeInt2mm(expectation.first, ss);
+        EXPECT_EQ(ss.str(), expectation.second) << "The integer " << expectation.first << " was printed wrongly to a stream.";
+
+        std::string str = "X";
+        writeInt2mm(expectation.first, str);
+        EXPECT_EQ(str, "X" + expectation.second) << "The integer " << expectation.first << " was appended wrongly to a string.";
+    }
+}
+
+/*
+ * Test that writeDoubleToStream rounds the same way as printf does, also for
+ * numbers that are exactly halfway between two rounded values.
+ */
+TEST(StringTest, WriteDoubleToStreamRoundsLikePrintf)
+{
+    const std::vector<std::pair<unsigned int, double>> inputs = {
+        {1, 2.25}, {1, 2.35}, {1, 1.05}, {0, 0.5}, {0, 1.5}, {0, 2.5}, {2, 0.125}, {5, 0.000001}, {5, -0.000001}, {5, -0.0}, {1, 4500.0}, {5, 123.456789}, {5, -98765.432105}
+    };
+    for (const std::pair<unsigned int, double>& input : inputs)
+    {
+        char expected[400];
+        sprintf(expected, "%.*f", input.first, input.second);
+        std::string expected_str(expected);
+        if (input.first > 0) //Remove the trailing zeros.
+        {
+            expected_str.erase(expected_str.find_last_not_of('0') + 1);
+            if (expected_str.back() == '.')
+            {
+                expected_str.pop_back();
+            }
+        }
+
+        std::ostringstream ss;
+        writeDoubleToStream(input.first, input.second, ss);
+        EXPECT_EQ(ss.str(), expected_str) << "The double " << input.second << " was printed wrongly with precision " << input.first << ".";
+
+        std::string str = "F";
+        writeDoubleToString(input.first, input.second, str);
+        EXPECT_EQ(str, "F" + expected_str) << "The double " << input.second << " was appended wrongly with precision " << input.first << ".";
+    }
+}
+
 }
@@ -0,0 +1,107 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cstdio> //For std::remove.
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+
+#include "../src/utils/Trace.h" //The class under test.
+
+namespace cura
+{
+
+/*!
+ * Record zones on several threads, and check that all of them end up in the
+ * trace file, with the layer for the zones that have one.
+ */
+TEST(TraceTest, WritesZonesOfAllThreads)
+{
+    const std::string filename = "trace_test.json";
+    Trace::start();
+    ASSERT_TRUE(Trace::isEnabled());
+    {
+        TraceZone zone("main zone");
+        std::thread other_thread([]()
+        {
+            TraceZone zone("other zone", 42);
+        });
+        other_thread.join();
+    }
+    ASSERT_TRUE(Trace::write(filename)) << "The trace file must be written.";
+
+    std::ifstream file(filename);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    const std::string trace = contents.str();
+    EXPECT_EQ(0, trace.find("{\"traceEvents\":[")) << "The file must be in the Chrome trace event format.";
+    EXPECT_NE(std::string::npos, trace.find("\"name\":\"main zone\"")) << "The zone of the main thread must be recorded.";
+    EXPECT_NE(std::string::npos, trace.find("\"name\":\"other zone\"")) << "The zone of the other thread must be recorded.";
+    EXPECT_NE(std::string::npos, trace.find("\"args\":{\"layer\":42}")) << "The layer of the zone must be recorded.";
+    EXPECT_EQ(trace.find("\"args\""), trace.rfind("\"args\"")) << "Only the zone with a layer must get arguments.";
+
+    //Writing forgets the zones.
+    ASSERT_TRUE(Trace::write(filename));
+    std::ifstream empty_file(filename);
+    std::stringstream empty_contents;
+    empty_contents << empty_file.rdbuf();
+    EXPECT_EQ(std::string::npos, empty_contents.str().find("zone")) << "Zones that were written before must not be written again.";
+    std::remove(filename.c_str());
+}
+
+/*!
+ * The details of a zone are written as its arguments, next to its layer.
+ */
+TEST(TraceTest, WritesDetails)
+{
+    const std::string filename = "trace_details_test.json";
+    Trace::start();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Trace::record("detailed zone", TraceZone::no_layer, start, "\"threads\":4");
+    Trace::record("detailed layer", 7, start, "\"chunks\":2");
+    ASSERT_TRUE(Trace::write(filename));
+
+    std::ifstream file(filename);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    const std::string trace = contents.str();
+    EXPECT_NE(std::string::npos, trace.find("\"args\":{\"threads\":4}")) << "The details must be the arguments of the zone.";
+    EXPECT_NE(std::string::npos, trace.find("\"args\":{\"layer\":7,\"chunks\":2}")) << "The details must be added to the layer of the zone.";
+    std::remove(filename.c_str());
+}
+
+/*!
+ * Stopping the trace forgets the zones that weren't written yet, and doesn't
+ * record any more zones until it's started again.
+ */
+TEST(TraceTest, StopForgetsZones)
+{
+    const std::string filename = "trace_stop_test.json";
+    Trace::start();
+    {
+        TraceZone zone("earlier zone");
+    }
+    Trace::stop();
+    EXPECT_FALSE(Trace::isEnabled());
+    {
+        TraceZone zone("untraced zone");
+    }
+    Trace::start();
+    {
+        TraceZone zone("later zone");
+    }
+    ASSERT_TRUE(Trace::write(filename));
+
+    std::ifstream file(filename);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    const std::string trace = contents.str();
+    EXPECT_EQ(std::string::npos, trace.find("\"name\":\"earlier zone\"")) << "The zones from before stopping must be forgotten.";
+    EXPECT_EQ(std::string::npos, trace.find("\"name\":\"untraced zone\"")) << "No zones may be recorded while stopped.";
+    EXPECT_NE(std::string::npos, trace.find("\"name\":\"later zone\"")) << "The zones after starting again must be recorded.";
+    Trace::stop();
+    std::remove(filename.c_str());
+}
+
+} //namespace cura
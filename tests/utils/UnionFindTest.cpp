@@ -111,4 +111,51 @@ TEST_F(UnionFindTest, UniteSets)
     ASSERT_EQ(b, c) << "A+B and C+D must now be in the same set.";
 }
 
+TEST(IndexUnionFindTest, Singletons)
+{
+    IndexUnionFind union_find(3);
+    EXPECT_EQ(union_find.size(), 3);
+    EXPECT_EQ(union_find.find(0), 0) << "Every item starts as the root of its own set.";
+    EXPECT_EQ(union_find.find(2), 2);
+    EXPECT_EQ(union_find.add(), 3) << "Added items get the next index.";
+    EXPECT_EQ(union_find.find(3), 3);
+}
+
+TEST(IndexUnionFindTest, UniteNonRoots)
+{
+    IndexUnionFind union_find(6);
+    union_find.unite(0, 1);
+    union_find.unite(2, 3);
+    union_find.unite(4, 5);
+    EXPECT_EQ(union_find.find(0), union_find.find(1));
+    EXPECT_NE(union_find.find(1), union_find.find(2));
+
+    union_find.unite(1, 3); //Neither of these needs to be a root.
+    EXPECT_EQ(union_find.find(0), union_find.find(2)) << "Uniting any items unites their whole sets.";
+    EXPECT_EQ(union_find.find(1), union_find.find(3));
+    EXPECT_NE(union_find.find(0), union_find.find(4)) << "The third set must not be affected.";
+
+    const size_t root = union_find.unite(5, 0);
+    for (size_t item = 0; item < 6; item++)
+    {
+        EXPECT_EQ(union_find.find(item), root) << "All items must be in the united set, with the returned root.";
+    }
+    EXPECT_EQ(union_find.unite(2, 4), root) << "Uniting items of the same set changes nothing.";
+}
+
+TEST(IndexUnionFindTest, LongChain)
+{
+    constexpr size_t item_count = 100000;
+    IndexUnionFind union_find(item_count);
+    for (size_t item = 1; item < item_count; item++)
+    {
+        union_find.unite(item - 1, item);
+    }
+    const size_t root = union_find.find(0);
+    for (size_t item = 0; item < item_count; item++)
+    {
+        ASSERT_EQ(union_find.find(item), root);
+    }
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,91 @@
+//Copyright (c) 2022 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/utils/polygon.h"
+#include "../src/utils/VoronoiUtils.h" //The class under test.
+
+namespace cura
+{
+
+class VoronoiUtilsTest : public testing::Test
+{
+public:
+    Polygons outline; //Holds the source segment, from (-100000, 0) to (100000, 0).
+    VoronoiUtils::Segment segment;
+
+    void SetUp()
+    {
+        Polygon line;
+        line.emplace_back(-100000, 0);
+        line.emplace_back(100000, 0);
+        outline.add(line);
+        segment = VoronoiUtils::Segment(&outline, 0, 0);
+    }
+
+    /*!
+     * Get the point on the parabola between the segment and a point at (0, d).
+     */
+    static Point onParabola(const coord_t x, const coord_t d)
+    {
+        return Point(x, (x * x + d * d) / (2 * d));
+    }
+};
+
+TEST_F(VoronoiUtilsTest, DiscretizeParabolaOnParabola)
+{
+    constexpr coord_t d = 2000;
+    const Point source_point(0, d);
+    constexpr coord_t step_size = 200;
+    constexpr float transitioning_angle = M_PI / 4;
+    for (const coord_t start_x : {-9000, -300, 0, 700})
+    {
+        const Point start = onParabola(start_x, d);
+        const Point end = onParabola(start_x + 8000, d);
+        const std::vector<Point> discretized = VoronoiUtils::discretizeParabola(source_point, segment, start, end, step_size, transitioning_angle);
+
+        ASSERT_GE(discretized.size(), 2);
+        EXPECT_EQ(discretized.front(), start);
+        EXPECT_EQ(discretized.back(), end);
+        for (size_t point_idx = 1; point_idx < discretized.size(); point_idx++)
+        {
+            const Point& point = discretized[point_idx];
+            EXPECT_NEAR(point.Y, onParabola(point.X, d).Y, 10) << point << " must lie on the parabola.";
+            EXPECT_GE(point.X, discretized[point_idx - 1].X) << "The points must go from the start to the end.";
+            EXPECT_LE(point.X - discretized[point_idx - 1].X, step_size * 2) << "The steps must not be much bigger than the step size.";
+        }
+    }
+}
+
+TEST_F(VoronoiUtilsTest, DiscretizeParabolaIntoBuffer)
+{
+    constexpr coord_t d = 1500;
+    const Point source_point(0, d);
+    constexpr coord_t step_size = 150;
+    constexpr float transitioning_angle = M_PI / 3;
+    const float marking_bound = VoronoiUtils::getParabolaMarkingBound(transitioning_angle);
+
+    std::vector<Point> buffer;
+    buffer.emplace_back(12, 34); //Must be kept.
+    std::vector<Point> expected = buffer;
+    for (const coord_t start_x : {-5000, -1000, 4000})
+    {
+        for (const bool reverse : {false, true})
+        {
+            Point start = onParabola(start_x, d);
+            Point end = onParabola(start_x + 3000, d);
+            if (reverse)
+            {
+                std::swap(start, end);
+            }
+            const std::vector<Point> single = VoronoiUtils::discretizeParabola(source_point, segment, start, end, step_size, transitioning_angle);
+            expected.insert(expected.end(), single.begin(), single.end());
+            VoronoiUtils::discretizeParabola(source_point, segment, start, end, step_size, marking_bound, buffer);
+        }
+    }
+    EXPECT_EQ(buffer, expected) << "Discretizing into a buffer must append the same points.";
+}
+
+} //namespace cura